@@ -0,0 +1,201 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "AnnotationIndex.h"
+#include <QHash>
+#include <QRect>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Annotations covering more cells than this go to the side list
+const int MaxCellsPerAnnotation = 64;
+
+} // namespace
+
+class AnnotationIndex::Private {
+public:
+    struct Entry {
+        QRectF bounds;
+        quint64 order;  // Insertion order; later annotations are drawn on top
+        bool large;
+    };
+
+    explicit Private(qreal size) : cellSize(size > 0 ? size : 64.0), nextOrder(0) {}
+
+    qreal cellSize;
+    quint64 nextOrder;
+    QHash<Annotation*, Entry> entries;
+    QHash<quint64, QVector<Annotation*>> cells;
+    QVector<Annotation*> large;
+
+    static quint64 cellKey(int x, int y) {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+
+    int cellOf(qreal coordinate) const {
+        return static_cast<int>(std::floor(coordinate / cellSize));
+    }
+
+    // Cells covered by a rectangle, as an inclusive column and row range
+    QRect cellRange(const QRectF& rect) const {
+        return QRect(QPoint(cellOf(rect.left()), cellOf(rect.top())),
+                     QPoint(cellOf(rect.right()), cellOf(rect.bottom())));
+    }
+
+    static qint64 cellCount(const QRect& range) {
+        return qint64(range.width()) * range.height();
+    }
+
+    void link(Annotation* annotation, const Entry& entry) {
+        if (entry.large) {
+            large.append(annotation);
+            return;
+        }
+        const QRect range = cellRange(entry.bounds);
+        for (int x = range.left(); x <= range.right(); ++x) {
+            for (int y = range.top(); y <= range.bottom(); ++y) {
+                cells[cellKey(x, y)].append(annotation);
+            }
+        }
+    }
+
+    void unlink(Annotation* annotation, const Entry& entry) {
+        if (entry.large) {
+            large.removeOne(annotation);
+            return;
+        }
+        const QRect range = cellRange(entry.bounds);
+        for (int x = range.left(); x <= range.right(); ++x) {
+            for (int y = range.top(); y <= range.bottom(); ++y) {
+                auto it = cells.find(cellKey(x, y));
+                if (it == cells.end()) continue;
+                it->removeOne(annotation);
+                if (it->isEmpty()) cells.erase(it);
+            }
+        }
+    }
+};
+
+AnnotationIndex::AnnotationIndex(qreal cellSize)
+    : d(new Private(cellSize))
+{
+}
+
+AnnotationIndex::~AnnotationIndex() = default;
+
+void AnnotationIndex::insert(Annotation* annotation, const QRectF& bounds)
+{
+    if (!annotation) return;
+    auto it = d->entries.find(annotation);
+    if (it != d->entries.end()) {
+        d->unlink(annotation, it.value());
+    } else {
+        it = d->entries.insert(annotation, Private::Entry{QRectF(), d->nextOrder++, false});
+    }
+    it->bounds = bounds.normalized(); // PDF rects may come with the corners swapped
+    it->large = Private::cellCount(d->cellRange(it->bounds)) > MaxCellsPerAnnotation;
+    d->link(annotation, it.value());
+}
+
+void AnnotationIndex::remove(Annotation* annotation)
+{
+    auto it = d->entries.find(annotation);
+    if (it == d->entries.end()) return;
+    d->unlink(annotation, it.value());
+    d->entries.erase(it);
+}
+
+void AnnotationIndex::clear()
+{
+    d->entries.clear();
+    d->cells.clear();
+    d->large.clear();
+}
+
+bool AnnotationIndex::contains(Annotation* annotation) const
+{
+    return d->entries.contains(annotation);
+}
+
+QRectF AnnotationIndex::bounds(Annotation* annotation) const
+{
+    const auto it = d->entries.constFind(annotation);
+    return it != d->entries.constEnd() ? it->bounds : QRectF();
+}
+
+int AnnotationIndex::size() const
+{
+    return d->entries.size();
+}
+
+Annotation* AnnotationIndex::hitTest(const QPointF& point) const
+{
+    Annotation* best = nullptr;
+    quint64 bestOrder = 0;
+    auto consider = [&](Annotation* annotation) {
+        const Private::Entry& entry = d->entries.constFind(annotation).value();
+        if ((!best || entry.order > bestOrder) && entry.bounds.contains(point)) {
+            best = annotation;
+            bestOrder = entry.order;
+        }
+    };
+
+    const auto cell = d->cells.constFind(Private::cellKey(d->cellOf(point.x()), d->cellOf(point.y())));
+    if (cell != d->cells.constEnd()) {
+        for (Annotation* annotation : cell.value()) consider(annotation);
+    }
+    for (Annotation* annotation : d->large) consider(annotation);
+    return best;
+}
+
+QList<Annotation*> AnnotationIndex::intersecting(const QRectF& rect) const
+{
+    const QRectF area = rect.normalized();
+    QVector<QPair<quint64, Annotation*>> hits;
+    auto consider = [&](Annotation* annotation) {
+        const Private::Entry& entry = d->entries.constFind(annotation).value();
+        if (entry.bounds.intersects(area)) hits.append(qMakePair(entry.order, annotation));
+    };
+
+    const QRect range = d->cellRange(area);
+    if (Private::cellCount(range) > d->entries.size()) {
+        // Cheaper to check every annotation than to walk a huge cell range
+        for (auto it = d->entries.constBegin(); it != d->entries.constEnd(); ++it) consider(it.key());
+    } else {
+        QSet<Annotation*> seen;
+        for (int x = range.left(); x <= range.right(); ++x) {
+            for (int y = range.top(); y <= range.bottom(); ++y) {
+                const auto cell = d->cells.constFind(Private::cellKey(x, y));
+                if (cell == d->cells.constEnd()) continue;
+                for (Annotation* annotation : cell.value()) {
+                    if (!seen.contains(annotation)) {
+                        seen.insert(annotation);
+                        consider(annotation);
+                    }
+                }
+            }
+        }
+        for (Annotation* annotation : d->large) consider(annotation);
+    }
+
+    std::sort(hits.begin(), hits.end(),
+              [](const QPair<quint64, Annotation*>& a, const QPair<quint64, Annotation*>& b) { return a.first < b.first; });
+    QList<Annotation*> result;
+    result.reserve(hits.size());
+    for (const auto& hit : hits) result.append(hit.second);
+    return result;
+}
+
+} // namespace QuantilyxDoc
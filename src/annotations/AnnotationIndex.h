@@ -0,0 +1,103 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_ANNOTATIONINDEX_H
+#define QUANTILYX_ANNOTATIONINDEX_H
+
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Annotation;
+
+/**
+ * @brief Spatial index of the annotations on one page.
+ *
+ * Annotation bounds are bucketed into a uniform grid, so a hit test looks
+ * at one cell instead of every annotation on the page. Annotations that
+ * span too many cells are kept in a short side list. Not thread-safe;
+ * AnnotationManager serializes access.
+ */
+class AnnotationIndex
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param cellSize Grid cell edge in points.
+     */
+    explicit AnnotationIndex(qreal cellSize = 64.0);
+
+    /**
+     * @brief Destructor.
+     */
+    ~AnnotationIndex();
+
+    /**
+     * @brief Add an annotation, or move it if already indexed.
+     * @param annotation Annotation to index.
+     * @param bounds Its bounds in page coordinates.
+     */
+    void insert(Annotation* annotation, const QRectF& bounds);
+
+    /**
+     * @brief Remove an annotation.
+     * @param annotation Annotation to drop.
+     */
+    void remove(Annotation* annotation);
+
+    /**
+     * @brief Remove every annotation.
+     */
+    void clear();
+
+    /**
+     * @brief Check if an annotation is indexed.
+     * @param annotation Annotation to look up.
+     * @return True if indexed.
+     */
+    bool contains(Annotation* annotation) const;
+
+    /**
+     * @brief Get the bounds an annotation is indexed under.
+     * @param annotation Annotation to look up.
+     * @return Its bounds, or a null rect if not indexed.
+     */
+    QRectF bounds(Annotation* annotation) const;
+
+    /**
+     * @brief Get the number of indexed annotations.
+     * @return Annotation count.
+     */
+    int size() const;
+
+    /**
+     * @brief Find the topmost annotation under a point.
+     * @param point Point in page coordinates.
+     * @return The most recently inserted annotation containing the point, or nullptr.
+     */
+    Annotation* hitTest(const QPointF& point) const;
+
+    /**
+     * @brief Find the annotations touching a rectangle.
+     * @param rect Rectangle in page coordinates.
+     * @return Matching annotations in insertion order.
+     */
+    QList<Annotation*> intersecting(const QRectF& rect) const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_ANNOTATIONINDEX_H
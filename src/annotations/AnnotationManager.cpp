@@ -8,17 +8,20 @@
  * (at your option) any later version.
  */
 #include "AnnotationManager.h"
+#include "AnnotationIndex.h"
 #include "../core/Document.h"
 #include "../core/Page.h"
 #include "Annotation.h" // Assuming base Annotation class exists
 #include "../core/Logger.h"
 #include <QHash>
 #include <QList>
+#include <QVector>
 #include <QPointer>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QCoreApplication>
 #include <QDebug>
+#include <memory>
 
 namespace QuantilyxDoc {
 
@@ -47,6 +50,118 @@ public:
     QHash<Document*, QSet<Annotation*>> docToAnnotations; // Map Document* -> Set of its annotations
     QHash<Document*, QHash<int, QSet<Annotation*>>> docPageToAnnotations; // Map Document* -> (PageIndex -> Set of its annotations)
     QSet<Document*> modifiedDocs; // Set of documents with modified annotations
+    // Per document and page, the grid of its annotations' bounds
+    QHash<Document*, QHash<int, std::shared_ptr<AnnotationIndex>>> pageIndexes;
+    QHash<Annotation*, QPair<Document*, int>> indexedPages; // Page each indexed annotation is on
+
+    // Net changes of a document since its last save, one entry per annotation
+    struct Journal {
+        QVector<AnnotationChange> changes;     // In the order annotations were first changed
+        QHash<Annotation*, int> positions;     // Entry of each annotation in changes
+    };
+    QHash<Document*, Journal> journals;
+    quint64 revision = 0; // Bumped on every record
+
+    // Helper to journal a change, folding it into the annotation's pending
+    // entry so a save sees only the net effect. Called with mutex held.
+    void recordLocked(Document* doc, AnnotationChange::Kind kind, int pageIndex, Annotation* annot,
+                      const QRectF& originalBounds) {
+        Journal& journal = journals[doc];
+        const auto pos = journal.positions.constFind(annot);
+        if (pos == journal.positions.constEnd()) {
+            AnnotationChange change;
+            change.kind = kind;
+            change.originalBounds = originalBounds;
+            if (kind != AnnotationChange::Removed) journal.positions.insert(annot, journal.changes.size());
+            journal.changes.append(change);
+            snapshotLocked(journal.changes.last(), pageIndex, annot);
+            return;
+        }
+
+        const int i = pos.value();
+        AnnotationChange& change = journal.changes[i];
+        if (kind == AnnotationChange::Removed) {
+            journal.positions.remove(annot); // Adding it back later is a new entry
+            if (change.kind == AnnotationChange::Added) {
+                // Never written, so there is nothing to undo in the file
+                journal.changes.remove(i);
+                for (auto it = journal.positions.begin(); it != journal.positions.end(); ++it) {
+                    if (it.value() > i) --it.value();
+                }
+                if (journal.changes.isEmpty()) journals.remove(doc);
+                return;
+            }
+            change.kind = AnnotationChange::Removed;
+        }
+        snapshotLocked(change, pageIndex, annot);
+    }
+
+    // Helper to stop folding changes into a destroyed annotation's entry;
+    // the entry keeps the state it had. Called with mutex held.
+    void forgetLocked(Annotation* annot) {
+        for (Journal& journal : journals) journal.positions.remove(annot);
+    }
+
+    void snapshotLocked(AnnotationChange& change, int pageIndex, Annotation* annot) {
+        change.pageIndex = pageIndex;
+        change.annotation = annot;
+        change.bounds = annot->bounds();
+        change.contents = annot->contents();
+        change.color = annot->color();
+        change.revision = ++revision;
+    }
+
+    // Helper to put an annotation in its page's grid, or move it there;
+    // returns true if it was not indexed before. Called with mutex held.
+    bool indexLocked(Document* doc, int pageIndex, Annotation* annot) {
+        const auto previous = indexedPages.constFind(annot);
+        const bool first = previous == indexedPages.constEnd();
+        if (!first && previous.value() != qMakePair(doc, pageIndex)) unindexLocked(annot);
+        std::shared_ptr<AnnotationIndex>& index = pageIndexes[doc][pageIndex];
+        if (!index) index = std::make_shared<AnnotationIndex>();
+        index->insert(annot, annot->bounds());
+        indexedPages.insert(annot, qMakePair(doc, pageIndex));
+        return first;
+    }
+
+    // Helper to drop an annotation from its page's grid; returns true if it
+    // was indexed. Called with mutex held.
+    bool unindexLocked(Annotation* annot) {
+        const auto it = indexedPages.find(annot);
+        if (it == indexedPages.end()) return false;
+        const QPair<Document*, int> page = it.value();
+        indexedPages.erase(it);
+        auto docIt = pageIndexes.find(page.first);
+        if (docIt == pageIndexes.end()) return true;
+        auto pageIt = docIt->find(page.second);
+        if (pageIt != docIt->end()) {
+            pageIt.value()->remove(annot);
+            if (pageIt.value()->size() == 0) docIt->erase(pageIt);
+        }
+        if (docIt->isEmpty()) pageIndexes.erase(docIt);
+        return true;
+    }
+
+    // Helper to get a page's grid; null if none of its annotations is indexed. Called with mutex held.
+    const AnnotationIndex* indexForLocked(Document* doc, int pageIndex) const {
+        const auto docIt = pageIndexes.constFind(doc);
+        if (docIt == pageIndexes.constEnd()) return nullptr;
+        const auto pageIt = docIt->constFind(pageIndex);
+        return pageIt != docIt->constEnd() ? pageIt.value().get() : nullptr;
+    }
+
+    // Helper to drop an annotation from the index when it is destroyed
+    void watchDestruction(Annotation* annot) {
+        QObject::connect(annot, &QObject::destroyed, q, [this, annot]() {
+            QMutexLocker locker(&mutex);
+            unindexLocked(annot);
+            forgetLocked(annot);
+        });
+    }
+
+    void unwatchDestruction(Annotation* annot) {
+        QObject::disconnect(annot, &QObject::destroyed, q, nullptr);
+    }
 
     // Helper to remove an annotation from all internal maps
     void removeAnnotationInternal(Document* doc, Annotation* annot, int pageIndex) {
@@ -110,53 +225,66 @@ void AnnotationManager::unregisterDocument(Document* doc)
 {
     if (!doc) return;
 
-    QMutexLocker locker(&d->mutex);
-    // Remove all annotations associated with this document
-    auto it = d->docToAnnotations.find(doc);
-    if (it != d->docToAnnotations.end()) {
-        const QSet<Annotation*>& annots = it.value();
-        for (Annotation* annot : annots) {
-            // Find the page index for this annotation (requires annotation to know its page)
-            // This is tricky if the annotation object itself doesn't store its page index.
-            // A better map might be QHash<Annotation*, QPair<Document*, int>>.
-            // For now, assume we can find it or iterate the page map.
-            for (auto pageIt = d->docPageToAnnotations[doc].begin(); pageIt != d->docPageToAnnotations[doc].end(); ++pageIt) {
-                if (pageIt.value().contains(annot)) {
-                    d->removeAnnotationInternal(doc, annot, pageIt.key());
-                    emit annotationRemoved(doc, annot);
-                    break; // Found on this page, stop searching
-                }
+    QList<Annotation*> removed;
+    QList<Annotation*> unindexed;
+    {
+        QMutexLocker locker(&d->mutex);
+        // Remove all annotations associated with this document
+        removed = d->docToAnnotations.value(doc).values();
+        for (auto it = d->annotations.begin(); it != d->annotations.end();) {
+            if (it.key().document == doc) {
+                it = d->annotations.erase(it);
+            } else {
+                ++it;
             }
         }
-        d->docToAnnotations.erase(it);
+        d->docToAnnotations.remove(doc);
         d->docPageToAnnotations.remove(doc);
         d->modifiedDocs.remove(doc);
-        emit annotationsChanged(doc);
-        LOG_DEBUG("Unregistered document and removed its annotations from AnnotationManager: " << doc->filePath());
+        d->journals.remove(doc);
+
+        // Its pages go away with it, so the annotations they indexed do too
+        for (auto it = d->indexedPages.begin(); it != d->indexedPages.end();) {
+            if (it.value().first == doc) {
+                unindexed.append(it.key());
+                it = d->indexedPages.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        d->pageIndexes.remove(doc);
     }
+
+    for (Annotation* annot : unindexed) d->unwatchDestruction(annot);
+    if (removed.isEmpty()) return;
+    emit annotationsChanged(doc); // Every page at once
+    LOG_DEBUG("Unregistered document and removed its annotations from AnnotationManager: " << doc->filePath());
 }
 
 bool AnnotationManager::addAnnotation(Document* doc, int pageIndex, Annotation* annotation)
 {
     if (!doc || !annotation) return false;
 
-    QMutexLocker locker(&d->mutex);
+    {
+        QMutexLocker locker(&d->mutex);
 
-    AnnotationKey key{doc, pageIndex, annotation};
-    if (d->annotations.contains(key)) {
-        LOG_WARN("Annotation already registered with AnnotationManager for doc/page.");
-        return false; // Or maybe update? For now, prevent duplicates.
-    }
+        AnnotationKey key{doc, pageIndex, annotation};
+        if (d->annotations.contains(key)) {
+            LOG_WARN("Annotation already registered with AnnotationManager for doc/page.");
+            return false; // Or maybe update? For now, prevent duplicates.
+        }
 
-    d->annotations.insert(key, annotation);
-    d->docToAnnotations[doc].insert(annotation);
-    d->docPageToAnnotations[doc][pageIndex].insert(annotation);
+        d->annotations.insert(key, annotation);
+        d->docToAnnotations[doc].insert(annotation);
+        d->docPageToAnnotations[doc][pageIndex].insert(annotation);
+        if (d->indexLocked(doc, pageIndex, annotation)) d->watchDestruction(annotation);
+        d->recordLocked(doc, AnnotationChange::Added, pageIndex, annotation, QRectF());
+    }
 
     // Mark document as modified as adding an annotation is a change
     markDocumentAsModified(doc);
 
     emit annotationAdded(doc, pageIndex, annotation);
-    emit annotationsChanged(doc);
     LOG_DEBUG("Added annotation to AnnotationManager for doc: " << doc->filePath() << ", page: " << pageIndex);
     return true;
 }
@@ -165,25 +293,27 @@ bool AnnotationManager::removeAnnotation(Document* doc, Annotation* annotation)
 {
     if (!doc || !annotation) return false;
 
-    QMutexLocker locker(&d->mutex);
-
-    // Find the page index for this annotation
     int pageIndex = -1;
-    auto docPageIt = d->docPageToAnnotations.find(doc);
-    if (docPageIt != d->docPageToAnnotations.end()) {
-        for (auto pageIt = docPageIt.value().begin(); pageIt != docPageIt.value().end(); ++pageIt) {
-            if (pageIt.value().contains(annotation)) {
-                pageIndex = pageIt.key();
-                break;
-            }
+    {
+        QMutexLocker locker(&d->mutex);
+
+        // The index knows the page of every managed annotation
+        const auto pageIt = d->indexedPages.constFind(annotation);
+        if (pageIt != d->indexedPages.constEnd() && pageIt.value().first == doc
+            && d->annotations.contains(AnnotationKey{doc, pageIt.value().second, annotation})) {
+            pageIndex = pageIt.value().second;
+            const AnnotationIndex* index = d->indexForLocked(doc, pageIndex);
+            d->recordLocked(doc, AnnotationChange::Removed, pageIndex, annotation,
+                            index ? index->bounds(annotation) : annotation->bounds());
+            d->removeAnnotationInternal(doc, annotation, pageIndex);
+            d->unindexLocked(annotation);
         }
     }
 
     if (pageIndex != -1) {
-        d->removeAnnotationInternal(doc, annotation, pageIndex);
+        d->unwatchDestruction(annotation);
         markDocumentAsModified(doc); // Removing an annotation is also a change
-        emit annotationRemoved(doc, annotation);
-        emit annotationsChanged(doc);
+        emit annotationRemoved(doc, pageIndex, annotation);
         LOG_DEBUG("Removed annotation from AnnotationManager for doc: " << doc->filePath() << ", page: " << pageIndex);
         return true;
     } else {
@@ -221,23 +351,113 @@ QList<Annotation*> AnnotationManager::annotationsForPage(Document* doc, int page
 
 QList<Annotation*> AnnotationManager::findAnnotationsInRect(Document* doc, int pageIndex, const QRectF& rect) const
 {
-    QList<Annotation*> results;
-    if (!doc) return results;
+    if (!doc) return {};
 
     QMutexLocker locker(&d->mutex);
-    auto docIt = d->docPageToAnnotations.constFind(doc);
-    if (docIt != d->docPageToAnnotations.constEnd()) {
-        auto pageIt = docIt.value().constFind(pageIndex);
-        if (pageIt != docIt.value().constEnd()) {
-            for (Annotation* annot : pageIt.value()) {
-                // This requires the Annotation class to have a 'bounds()' method returning QRectF
-                if (annot->bounds().intersects(rect)) { // Assuming bounds() exists and returns QRectF
-                    results.append(annot);
+    const AnnotationIndex* index = d->indexForLocked(doc, pageIndex);
+    return index ? index->intersecting(rect) : QList<Annotation*>();
+}
+
+Annotation* AnnotationManager::hitTest(Document* doc, int pageIndex, const QPointF& point) const
+{
+    if (!doc) return nullptr;
+
+    QMutexLocker locker(&d->mutex);
+    const AnnotationIndex* index = d->indexForLocked(doc, pageIndex);
+    return index ? index->hitTest(point) : nullptr;
+}
+
+void AnnotationManager::indexAnnotation(Document* doc, int pageIndex, Annotation* annotation)
+{
+    if (!doc || !annotation) return;
+
+    bool first;
+    {
+        QMutexLocker locker(&d->mutex);
+        first = d->indexLocked(doc, pageIndex, annotation);
+    }
+    if (first) d->watchDestruction(annotation);
+}
+
+void AnnotationManager::unindexAnnotation(Annotation* annotation)
+{
+    if (!annotation) return;
+
+    bool indexed;
+    {
+        QMutexLocker locker(&d->mutex);
+        indexed = d->unindexLocked(annotation);
+    }
+    if (indexed) d->unwatchDestruction(annotation);
+}
+
+void AnnotationManager::noteAnnotationModified(Annotation* annotation)
+{
+    if (!annotation) return;
+
+    Document* doc;
+    {
+        QMutexLocker locker(&d->mutex);
+        const auto it = d->indexedPages.constFind(annotation);
+        if (it == d->indexedPages.constEnd()) return;
+        const QPair<Document*, int> page = it.value();
+        doc = page.first;
+        // The bounds it is indexed under are the ones the file has, if this is its first change
+        const AnnotationIndex* index = d->indexForLocked(page.first, page.second);
+        d->recordLocked(page.first, AnnotationChange::Modified, page.second, annotation,
+                        index ? index->bounds(annotation) : QRectF());
+        d->indexLocked(page.first, page.second, annotation);
+    }
+    markDocumentAsModified(doc);
+}
+
+QList<AnnotationChange> AnnotationManager::pendingChanges(Document* doc, quint64* revision) const
+{
+    QMutexLocker locker(&d->mutex);
+    if (revision) *revision = d->revision;
+    if (!doc) return {};
+    const auto it = d->journals.constFind(doc);
+    return it != d->journals.constEnd() ? it->changes.toList() : QList<AnnotationChange>();
+}
+
+int AnnotationManager::pendingChangeCount(Document* doc) const
+{
+    if (!doc) return 0;
+
+    QMutexLocker locker(&d->mutex);
+    const auto it = d->journals.constFind(doc);
+    return it != d->journals.constEnd() ? it->changes.size() : 0;
+}
+
+void AnnotationManager::markChangesSaved(Document* doc, quint64 revision)
+{
+    if (!doc) return;
+
+    bool clean = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        auto it = d->journals.find(doc);
+        if (it != d->journals.end()) {
+            Private::Journal& journal = it.value();
+            QVector<AnnotationChange> kept;
+            journal.positions.clear();
+            for (const AnnotationChange& change : qAsConst(journal.changes)) {
+                if (change.revision <= revision) continue;
+                if (change.kind != AnnotationChange::Removed && change.annotation) {
+                    journal.positions.insert(change.annotation.data(), kept.size());
                 }
+                kept.append(change);
             }
+            journal.changes = kept;
+            if (journal.changes.isEmpty()) d->journals.erase(it);
         }
+        if (!d->journals.contains(doc)) clean = d->modifiedDocs.remove(doc);
+    }
+
+    if (clean) {
+        LOG_DEBUG("AnnotationManager: Saved all annotation changes of document: " << doc->filePath());
+        emit documentModifiedChanged(doc, false);
     }
-    return results;
 }
 
 int AnnotationManager::totalAnnotationCount() const
@@ -255,30 +475,6 @@ int AnnotationManager::annotationCountForDocument(Document* doc) const
     return (it != d->docToAnnotations.constEnd()) ? it.value().size() : 0;
 }
 
-QList<Annotation*> AnnotationManager::getModifiedAnnotationsForDocument(Document* doc) const
-{
-    if (!doc) return {};
-
-    QMutexLocker locker(&d->mutex);
-    QList<Annotation*> results;
-
-    // Iterate through all annotations associated with the document
-    auto docAnnotsIt = d->docToAnnotations.constFind(doc);
-    if (docAnnotsIt != d->docToAnnotations.constEnd()) {
-        for (Annotation* annot : docAnnotsIt.value()) {
-            // Check if the specific annotation object reports itself as modified
-            // This requires the Annotation base class or its subclasses (like PdfAnnotation) to have an isModified() method.
-            // Assuming PdfAnnotation implements isModified().
-            PdfAnnotation* pdfAnnot = dynamic_cast<PdfAnnotation*>(annot);
-            if (pdfAnnot && pdfAnnot->isModified()) {
-                results.append(annot);
-            }
-        }
-    }
-    LOG_DEBUG("AnnotationManager: Found " << results.size() << " modified annotations for document: " << (doc ? doc->filePath() : "nullptr"));
-    return results;
-}
-
 void AnnotationManager::markDocumentAsModified(Document* doc)
 {
     if (!doc) return;
@@ -312,54 +508,11 @@ bool AnnotationManager::prepareAnnotationsForSave(Document* doc)
 {
     if (!doc) return false;
 
-    QMutexLocker locker(&d->mutex);
-    if (!d->modifiedDocs.contains(doc)) {
-        LOG_DEBUG("No modified annotations to prepare for save for doc: " << doc->filePath());
-        return true; // Nothing to do, technically successful
-    }
-
-    // This is where the complexity of read-only annotations (like Poppler::Annotation) comes in.
-    // We need to iterate through the annotations associated with this document.
-    // For each annotation that has been modified (requires tracking in the Annotation class itself,
-    // e.g., a `bool isModified` flag set by its setters), we need to figure out how to apply
-    // that change back to the underlying document format.
-    // For PDF (Poppler), this requires an external library or tool capable of writing PDFs.
-
-    auto docAnnots = annotationsForDocument(doc); // Get list under lock
-    locker.unlock(); // Release lock before potentially long-running external processes
-
-    bool allPrepared = true;
-    for (Annotation* annot : docAnnots) {
-        // Check if the annotation object itself thinks it's modified
-        // This requires the Annotation base class or its subclasses to track modification.
-        // For PdfAnnotation, this would involve checking if local properties (color, contents)
-        // differ from the original Poppler::Annotation values.
-        // if (annot->isModified()) { ... }
-        // Then, somehow, update the source document format. This is the hard part with Poppler-Qt5.
-
-        // A potential approach:
-        // 1. Serialize the modified annotation state (type, bounds, color, contents, etc.).
-        // 2. Store this serialized state associated with the document.
-        // 3. During Document::save(), check for these serialized modifications.
-        // 4. Use an external tool (e.g., QPDF, mutool, PoDoFo) to apply the serialized changes
-        //    to the PDF file before or during the save process.
-
-        // For now, this is a significant undertaking beyond basic Poppler integration.
-        // We can log the intent or prepare serialized data structures.
-        LOG_WARN("AnnotationManager::prepareAnnotationsForSave: Preparing annotations for save requires external PDF writing tool. Serialization/flagging for doc: " << doc->filePath());
-        // Example serialization placeholder:
-        // SerializedAnnotationData data = serializeAnnotation(annot);
-        // doc->addPendingAnnotationChange(data); // Hypothetical method on Document
-    }
-
-    if (allPrepared) {
-        locker.relock(); // Re-acquire lock to update modification state
-        d->modifiedDocs.remove(doc); // Mark as no longer modified internally
-        emit documentModifiedChanged(doc, false);
-        LOG_INFO("Prepared annotations for save for doc: " << doc->filePath());
-    }
-
-    return allPrepared;
+    // The journal already holds the net change of every annotation; the
+    // document's writer takes it from pendingChanges() and reports back
+    // through markChangesSaved() once it is on disk
+    LOG_DEBUG("AnnotationManager: " << pendingChangeCount(doc) << " annotation changes to save for doc: " << doc->filePath());
+    return true;
 }
 
 } // namespace QuantilyxDoc
\ No newline at end of file
@@ -11,9 +11,12 @@
 #define QUANTILYX_ANNOTATIONMANAGER_H
 
 #include <QObject>
+#include <QColor>
 #include <QHash>
 #include <QList>
 #include <QPointer>
+#include <QPointF>
+#include <QRectF>
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -22,6 +25,32 @@ class Document;
 class Page;
 class Annotation; // Assuming a base Annotation class exists
 
+/**
+ * @brief Net change to one annotation since its document was last saved.
+ *
+ * Changes are coalesced per annotation as they are recorded: an annotation
+ * added and then edited is one Added entry with its latest state, one
+ * edited and then removed is one Removed entry, and one added and removed
+ * again leaves no entry. The state is a copy, so an entry can be written
+ * after its annotation is gone.
+ */
+struct AnnotationChange {
+    enum Kind {
+        Added,    ///< Not in the file; write it
+        Modified, ///< In the file; rewrite it with the state below
+        Removed   ///< In the file; drop it
+    };
+
+    Kind kind;
+    int pageIndex;
+    QPointer<Annotation> annotation; // Null once the annotation is destroyed
+    QRectF bounds;                   // State when last recorded
+    QString contents;
+    QColor color;
+    QRectF originalBounds;           // Bounds before the first change, to find the object in the file
+    quint64 revision;                // Journal revision of the last record
+};
+
 /**
  * @brief Manages annotations across all open documents.
  * 
@@ -30,6 +59,17 @@ class Annotation; // Assuming a base Annotation class exists
  * annotation implementations (e.g., PdfAnnotation). It also manages the lifecycle
  * and persistence of annotations, especially considering the read-only nature of
  * many format-specific annotation objects (like those from Poppler).
+ *
+ * Each page's annotations are kept in an AnnotationIndex, so hit tests and
+ * rectangle queries look at a grid cell rather than every annotation on
+ * the page. Besides the annotations added here, pages index the ones they
+ * read from the file through indexAnnotation(), so a single query finds
+ * both. Whoever moves, resizes or edits an annotation calls
+ * noteAnnotationModified().
+ *
+ * Every add, edit and removal is also recorded in a per-document journal,
+ * coalesced per annotation, so a save applies only the net change since
+ * the last one: pendingChanges(), then markChangesSaved() once written.
  */
 class AnnotationManager : public QObject
 {
@@ -104,10 +144,64 @@ public:
      * @param doc The document containing the page.
      * @param pageIndex The 0-based index of the page.
      * @param rect The rectangle in page coordinates to search within.
-     * @return List of annotation objects whose bounds intersect the rectangle.
+     * @return Annotation objects whose bounds intersect the rectangle, managed or
+     *         indexed, in the order they were indexed.
      */
     QList<Annotation*> findAnnotationsInRect(Document* doc, int pageIndex, const QRectF& rect) const;
 
+    /**
+     * @brief Find the topmost annotation under a point on a page.
+     * @param doc The document containing the page.
+     * @param pageIndex The 0-based index of the page.
+     * @param point The point in page coordinates.
+     * @return The most recently indexed annotation containing the point, or nullptr.
+     */
+    Annotation* hitTest(Document* doc, int pageIndex, const QPointF& point) const;
+
+    /**
+     * @brief Make an annotation a page holds itself, such as one read from the file, found by queries.
+     * It is not put under management: no signals are emitted and the document is not modified.
+     * @param doc The document containing the page.
+     * @param pageIndex The 0-based index of the page.
+     * @param annotation The annotation; dropped from the index when destroyed.
+     */
+    void indexAnnotation(Document* doc, int pageIndex, Annotation* annotation);
+
+    /**
+     * @brief Stop finding an annotation indexed with indexAnnotation().
+     * @param annotation The annotation.
+     */
+    void unindexAnnotation(Annotation* annotation);
+
+    /**
+     * @brief Re-index and journal an annotation after it was moved, resized or edited.
+     * @param annotation The annotation, managed or indexed.
+     */
+    void noteAnnotationModified(Annotation* annotation);
+
+    /**
+     * @brief Get the net annotation changes of a document since it was last saved.
+     * @param doc The document.
+     * @param revision Set to the journal revision the changes go up to, for markChangesSaved().
+     * @return One change per annotation, in the order they were first changed.
+     */
+    QList<AnnotationChange> pendingChanges(Document* doc, quint64* revision = nullptr) const;
+
+    /**
+     * @brief Get the number of annotations changed since the document was last saved.
+     * @param doc The document.
+     * @return Count of pending changes.
+     */
+    int pendingChangeCount(Document* doc) const;
+
+    /**
+     * @brief Drop the changes a save has written.
+     * Changes recorded after pendingChanges() are kept for the next save.
+     * @param doc The document saved.
+     * @param revision Revision from pendingChanges().
+     */
+    void markChangesSaved(Document* doc, quint64 revision);
+
     /**
      * @brief Get the total number of annotations managed.
      * @return Count of all annotations.
@@ -157,12 +251,15 @@ signals:
     /**
      * @brief Emitted when an annotation is removed.
      * @param doc The document the annotation was removed from.
+     * @param pageIndex The page index the annotation was on.
      * @param annotation The removed annotation object.
      */
-    void annotationRemoved(QuantilyxDoc::Document* doc, QuantilyxDoc::Annotation* annotation);
+    void annotationRemoved(QuantilyxDoc::Document* doc, int pageIndex, QuantilyxDoc::Annotation* annotation);
 
     /**
-     * @brief Emitted when the list of annotations for a document changes.
+     * @brief Emitted when many annotations of a document change at once.
+     * Single additions and removals emit only annotationAdded() and
+     * annotationRemoved(), so views can repaint just their page.
      * @param doc The document whose annotation list changed.
      */
     void annotationsChanged(QuantilyxDoc::Document* doc);
@@ -177,6 +274,7 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static AnnotationManager* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,313 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "BatchRunner.h"
+#include "ScriptingEngine.h"
+#include "../core/Document.h"
+#include "../core/DocumentFactory.h"
+#include "../core/Logger.h"
+#include "../core/Settings.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Worker stderr kept for the report when a document fails
+const int MaxErrorTail = 4096;
+
+QJsonObject resultToJson(const BatchRunner::Result& result)
+{
+    QJsonObject object;
+    object.insert("input", result.input);
+    object.insert("success", result.success);
+    object.insert("exitCode", result.exitCode);
+    object.insert("elapsedMs", double(result.elapsedMs));
+    if (!result.error.isEmpty()) object.insert("error", result.error);
+    return object;
+}
+
+} // namespace
+
+class BatchRunner::Private {
+public:
+    Private(BatchRunner* q_ptr) : q(q_ptr) {}
+
+    struct Worker {
+        QProcess* process = nullptr;
+        QTimer* timeout = nullptr;
+        int index = -1;
+        QElapsedTimer elapsed;
+        QByteArray errorTail;
+        bool timedOut = false;
+    };
+
+    BatchRunner* q;
+    QString scriptPath;
+    int jobs = 0;
+    int timeoutSeconds = 0;
+    QStringList inputs;
+    QVector<Result> results;
+    int nextInput = 0;
+    int finished = 0;
+    qint64 elapsedMs = 0;
+    QEventLoop* loop = nullptr;
+
+    int jobCount() const {
+        return jobs > 0 ? jobs : qMax(1, QThread::idealThreadCount());
+    }
+
+    // Start the next unclaimed document; false once all are handed out
+    bool startNext() {
+        if (nextInput >= inputs.size()) return false;
+        auto worker = std::make_shared<Worker>();
+        worker->index = nextInput++;
+        worker->process = new QProcess(q);
+
+        // Workers create no windows, so they need no display either
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        if (!environment.contains("QT_QPA_PLATFORM")) environment.insert("QT_QPA_PLATFORM", "offscreen");
+        worker->process->setProcessEnvironment(environment);
+
+        QObject::connect(worker->process, &QProcess::readyReadStandardError, q, [worker]() {
+            worker->errorTail += worker->process->readAllStandardError();
+            if (worker->errorTail.size() > MaxErrorTail) worker->errorTail = worker->errorTail.right(MaxErrorTail);
+        });
+        QObject::connect(worker->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), q,
+                         [this, worker](int exitCode, QProcess::ExitStatus status) { finish(worker, exitCode, status); });
+        // Queued: a failed start is reported from inside start(), which must not start the next worker
+        QObject::connect(worker->process, &QProcess::errorOccurred, q, [this, worker](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) finish(worker, -1, QProcess::CrashExit);
+        }, Qt::QueuedConnection);
+
+        if (timeoutSeconds > 0) {
+            worker->timeout = new QTimer(worker->process);
+            worker->timeout->setSingleShot(true);
+            QObject::connect(worker->timeout, &QTimer::timeout, q, [worker]() {
+                worker->timedOut = true;
+                worker->process->kill(); // Ends in finished() as a crash
+            });
+            worker->timeout->start(timeoutSeconds * 1000);
+        }
+
+        worker->elapsed.start();
+        worker->process->start(QCoreApplication::applicationFilePath(),
+                               {"--no-plugins", "--run-script", scriptPath, "--script-input", inputs.at(worker->index)});
+        return true;
+    }
+
+    void finish(const std::shared_ptr<Worker>& worker, int exitCode, QProcess::ExitStatus status) {
+        if (!worker->process) return; // errorOccurred and finished can both arrive
+        Result& result = results[worker->index];
+        result.input = inputs.at(worker->index);
+        result.elapsedMs = worker->elapsed.elapsed();
+        result.exitCode = status == QProcess::NormalExit ? exitCode : -1;
+
+        // The worker's last stdout line is its verdict; logs and script output come before it
+        const QList<QByteArray> lines = worker->process->readAllStandardOutput().trimmed().split('\n');
+        const QJsonObject verdict = QJsonDocument::fromJson(lines.isEmpty() ? QByteArray() : lines.last()).object();
+        if (worker->timedOut) {
+            result.error = QStringLiteral("Timed out after %1 s").arg(timeoutSeconds);
+        } else if (status != QProcess::NormalExit) {
+            result.error = worker->process->error() == QProcess::FailedToStart
+                ? worker->process->errorString() : QStringLiteral("Worker crashed");
+        } else {
+            result.error = verdict.value("error").toString();
+        }
+        result.success = result.exitCode == 0 && verdict.value("success").toBool();
+        if (!result.success && result.error.isEmpty()) {
+            result.error = QString::fromLocal8Bit(worker->errorTail).trimmed();
+            if (result.error.isEmpty()) result.error = QStringLiteral("Exited with code %1").arg(exitCode);
+        }
+
+        worker->process->deleteLater();
+        worker->process = nullptr;
+        ++finished;
+        if (result.success) LOG_INFO("BatchRunner: " << result.input << " done in " << result.elapsedMs << " ms");
+        else LOG_WARN("BatchRunner: " << result.input << " failed: " << result.error);
+        emit q->itemFinished(result, finished, inputs.size());
+
+        if (!startNext() && finished == inputs.size() && loop) loop->quit();
+    }
+};
+
+BatchRunner::BatchRunner(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+BatchRunner::~BatchRunner() = default;
+
+void BatchRunner::setScript(const QString& scriptPath)
+{
+    d->scriptPath = QFileInfo(scriptPath).absoluteFilePath();
+}
+
+void BatchRunner::setJobs(int jobs)
+{
+    d->jobs = jobs;
+}
+
+int BatchRunner::jobs() const
+{
+    return d->jobCount();
+}
+
+void BatchRunner::setTimeoutSeconds(int seconds)
+{
+    d->timeoutSeconds = qMax(0, seconds);
+}
+
+int BatchRunner::run(const QStringList& inputs)
+{
+    d->inputs = inputs;
+    d->results = QVector<Result>(inputs.size());
+    d->nextInput = 0;
+    d->finished = 0;
+    if (inputs.isEmpty()) return 0;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const int workers = qMin(d->jobCount(), inputs.size());
+    LOG_INFO("BatchRunner: Running " << d->scriptPath << " over " << inputs.size() << " documents with " << workers << " workers");
+
+    QEventLoop loop;
+    d->loop = &loop;
+    for (int i = 0; i < workers; ++i) d->startNext();
+    loop.exec();
+    d->loop = nullptr;
+    d->elapsedMs = elapsed.elapsed();
+
+    int failed = 0;
+    for (const Result& result : qAsConst(d->results)) {
+        if (!result.success) ++failed;
+    }
+    LOG_INFO("BatchRunner: " << (inputs.size() - failed) << " of " << inputs.size() << " documents succeeded in " << d->elapsedMs << " ms");
+    return failed;
+}
+
+QList<BatchRunner::Result> BatchRunner::results() const
+{
+    return d->results.toList();
+}
+
+QJsonObject BatchRunner::report() const
+{
+    QJsonArray items;
+    int failed = 0;
+    for (const Result& result : qAsConst(d->results)) {
+        items.append(resultToJson(result));
+        if (!result.success) ++failed;
+    }
+    QJsonObject report;
+    report.insert("script", d->scriptPath);
+    report.insert("jobs", d->jobCount());
+    report.insert("total", d->results.size());
+    report.insert("succeeded", d->results.size() - failed);
+    report.insert("failed", failed);
+    report.insert("elapsedMs", double(d->elapsedMs));
+    report.insert("results", items);
+    return report;
+}
+
+QStringList BatchRunner::expandInputs(const QStringList& arguments)
+{
+    QStringList files;
+    QSet<QString> seen;
+    auto add = [&files, &seen](const QString& path) {
+        const QString absolute = QFileInfo(path).absoluteFilePath();
+        if (!seen.contains(absolute)) {
+            seen.insert(absolute);
+            files.append(absolute);
+        }
+    };
+
+    std::function<void(const QString&, const QDir&)> expand = [&](const QString& argument, const QDir& base) {
+        if (argument.startsWith('@')) {
+            // List files name one path or pattern per line, relative to the list
+            const QString listPath = base.filePath(argument.mid(1));
+            QFile list(listPath);
+            if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                LOG_WARN("BatchRunner: Cannot read input list: " << listPath);
+                return;
+            }
+            QTextStream stream(&list);
+            const QDir listDir = QFileInfo(listPath).absoluteDir();
+            while (!stream.atEnd()) {
+                const QString line = stream.readLine().trimmed();
+                if (!line.isEmpty() && !line.startsWith('#')) expand(line, listDir);
+            }
+            return;
+        }
+
+        const QFileInfo info(base.filePath(argument));
+        if (!argument.contains(QRegularExpression("[*?\\[]"))) {
+            if (info.isFile()) add(info.absoluteFilePath());
+            else LOG_WARN("BatchRunner: Input not found: " << argument);
+            return;
+        }
+        // Wildcards are matched in the last path component only
+        const QDir dir = info.absoluteDir();
+        const QStringList matches = dir.entryList({info.fileName()}, QDir::Files, QDir::Name);
+        if (matches.isEmpty()) LOG_WARN("BatchRunner: No files match: " << argument);
+        for (const QString& name : matches) add(dir.filePath(name));
+    };
+
+    for (const QString& argument : arguments) expand(argument, QDir::current());
+    return files;
+}
+
+int BatchRunner::runOne(const QString& scriptPath, const QString& inputPath)
+{
+    QTextStream out(stdout);
+    auto verdict = [&out, &inputPath](bool success, const QString& error) {
+        QJsonObject object;
+        object.insert("input", inputPath);
+        object.insert("success", success);
+        if (!error.isEmpty()) object.insert("error", error);
+        out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+        out.flush();
+        return success ? 0 : 1;
+    };
+
+    QString error;
+    std::unique_ptr<Document> document(DocumentFactory::instance().loadDocumentAndWait(inputPath, QString(), &error));
+    if (!document) return verdict(false, error.isEmpty() ? QStringLiteral("Cannot open document") : error);
+
+    ScriptingEngine& engine = ScriptingEngine::instance();
+    const QString language = Settings::instance().value<QString>("Scripting/Language", "python");
+    if (!engine.isReady() && !engine.initialize(language)) return verdict(false, QStringLiteral("Scripting engine unavailable"));
+
+    QString scriptError;
+    QObject::connect(&engine, &ScriptingEngine::scriptFailed, [&scriptError](const QString&, const QString& message) {
+        scriptError = message;
+    });
+    const bool success = engine.executeScriptFile(scriptPath, document.get());
+    return verdict(success, success ? QString() : (scriptError.isEmpty() ? QStringLiteral("Script failed") : scriptError));
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,137 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_BATCHRUNNER_H
+#define QUANTILYX_BATCHRUNNER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Runs one script over many documents without a user interface.
+ *
+ * Each document is handled by a worker process: this executable started
+ * with --run-script, which loads the document, runs the script on it
+ * through ScriptingEngine and prints its result as one JSON line. Up to
+ * jobs() workers run at once. A worker that crashes or times out fails
+ * only its own document, and the interpreter state of one document never
+ * leaks into the next.
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Outcome of the script on one document.
+     */
+    struct Result {
+        QString input;          // Document path
+        bool success = false;
+        int exitCode = 0;       // Worker exit code, -1 if it crashed or timed out
+        QString error;          // Why it failed; empty on success
+        qint64 elapsedMs = 0;
+    };
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit BatchRunner(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~BatchRunner() override;
+
+    /**
+     * @brief Set the script to run.
+     * @param scriptPath Path to the script file.
+     */
+    void setScript(const QString& scriptPath);
+
+    /**
+     * @brief Set how many workers run at once.
+     * @param jobs Worker count; 0 or less means one per CPU.
+     */
+    void setJobs(int jobs);
+
+    /**
+     * @brief Get how many workers run at once.
+     * @return Worker count.
+     */
+    int jobs() const;
+
+    /**
+     * @brief Set the time a worker gets for one document.
+     * @param seconds Timeout; 0 waits as long as it takes.
+     */
+    void setTimeoutSeconds(int seconds);
+
+    /**
+     * @brief Run the script over documents, blocking until all are done.
+     * Runs a local event loop, so it is called from the main thread.
+     * @param inputs Document paths.
+     * @return Number of documents that failed.
+     */
+    int run(const QStringList& inputs);
+
+    /**
+     * @brief Get the results of the last run, in input order.
+     * @return One result per input.
+     */
+    QList<Result> results() const;
+
+    /**
+     * @brief Get the results of the last run as a JSON report.
+     * @return Object with the script, totals, elapsed time and one entry per input.
+     */
+    QJsonObject report() const;
+
+    /**
+     * @brief Turn input arguments into document paths.
+     * An argument is a file, a wildcard pattern ("scans/*.pdf"), or
+     * "@list.txt" naming a file with one path or pattern per line.
+     * @param arguments Input arguments.
+     * @return Matching files, each once, in argument order.
+     */
+    static QStringList expandInputs(const QStringList& arguments);
+
+    /**
+     * @brief Run a script on one document in this process; the worker side of run().
+     * Prints the result as one JSON line on standard output.
+     * @param scriptPath Path to the script file.
+     * @param inputPath Document path.
+     * @return Process exit code: 0 on success.
+     */
+    static int runOne(const QString& scriptPath, const QString& inputPath);
+
+signals:
+    /**
+     * @brief Emitted as each document finishes.
+     * @param result Outcome for the document.
+     * @param finished Documents finished so far.
+     * @param total Documents in the run.
+     */
+    void itemFinished(const QuantilyxDoc::BatchRunner::Result& result, int finished, int total);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_BATCHRUNNER_H
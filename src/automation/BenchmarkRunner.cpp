@@ -0,0 +1,742 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "BenchmarkRunner.h"
+#include "../core/Document.h"
+#include "../core/DocumentFactory.h"
+#include "../core/IntelligentCache.h"
+#include "../core/Logger.h"
+#include "../core/Page.h"
+#include "../core/PageCache.h"
+#include "../core/ThreadPool.h"
+#include "../search/ContentComparison.h"
+#include "../search/FullTextIndex.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QSemaphore>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const quint32 TextSeed = 20250101;
+const int VocabularySize = 4096;
+const int WordsPerPage = 400;
+const int MarkdownWords = 40000;
+const int BatchSize = 1000;             // Operations per iteration of the micro benchmarks
+const int QueryCount = 256;             // More than the query cache holds, so every query is answered afresh
+const int CacheItemBytes = 4096;
+const int ThroughputPagesPerDocument = 16;
+const qint64 MaxIterations = 1000000;
+const double SignificanceLevel = 0.05;
+const int MinRankTestSamples = 3;
+const qint64 MinRssGrowthBytes = qint64(4) << 20;
+
+/**
+ * One benchmark. body() is timed and returns the items it processed;
+ * prepare() runs untimed before each call, setUp() once before the first.
+ */
+struct Case {
+    QString name;
+    std::function<QString()> setUp;     // Returns why it cannot run, empty if ready
+    std::function<void()> prepare;
+    std::function<qint64()> body;
+    std::function<void()> tearDown;
+};
+
+// Words from fixed syllables and a fixed seed; picked with a skew so a
+// few are common and most rare, as in real text
+class TextGenerator
+{
+public:
+    explicit TextGenerator(quint32 seed)
+        : m_random(seed)
+    {
+        static const char* const syllables[] = {"ka", "lo", "mi", "ne", "ra", "tu", "vo", "si", "pe", "da",
+                                                "qua", "ber", "fin", "gol", "hey", "jun", "zel", "wor"};
+        const int count = int(sizeof(syllables) / sizeof(syllables[0]));
+        std::uniform_int_distribution<int> syllable(0, count - 1);
+        std::uniform_int_distribution<int> length(1, 4);
+        while (m_vocabulary.size() < VocabularySize) {
+            QString word;
+            for (int i = length(m_random); i > 0; --i) word += QLatin1String(syllables[syllable(m_random)]);
+            if (!m_vocabulary.contains(word)) m_vocabulary.append(word);
+        }
+    }
+
+    const QStringList& vocabulary() const { return m_vocabulary; }
+
+    QString word()
+    {
+        const double u = std::uniform_real_distribution<double>(0, 1)(m_random);
+        return m_vocabulary.at(qMin(VocabularySize - 1, int(VocabularySize * u * u * u)));
+    }
+
+    QString words(int count)
+    {
+        QStringList out;
+        out.reserve(count);
+        for (int i = 0; i < count; ++i) out.append(word());
+        return out.join(QLatin1Char(' '));
+    }
+
+private:
+    std::mt19937 m_random;
+    QStringList m_vocabulary;
+};
+
+// Loads a document as BatchRunner's workers do, waiting out background loading
+std::unique_ptr<Document> loadAndWait(const QString& path, QString* error)
+{
+    return std::unique_ptr<Document>(DocumentFactory::instance().loadDocumentAndWait(path, QString(), error));
+}
+
+qint64 renderPages(Document* document, int maxPages, qreal scale)
+{
+    qint64 rendered = 0;
+    const int count = qMin(document->pageCount(), maxPages);
+    for (int i = 0; i < count; ++i) {
+        Page* page = document->page(i);
+        if (!page) continue;
+        const QSizeF size = page->size() * scale;
+        const QImage image = page->render(qMax(1, qRound(size.width())), qMax(1, qRound(size.height())));
+        if (!image.isNull()) ++rendered;
+    }
+    return rendered;
+}
+
+// Starts a new peak resident set; on Linux the kernel keeps one per process
+void resetPeakRss()
+{
+#ifdef Q_OS_LINUX
+    QFile clearRefs(QStringLiteral("/proc/self/clear_refs"));
+    if (clearRefs.open(QIODevice::WriteOnly)) clearRefs.write("5");
+#endif
+}
+
+qint64 peakRss()
+{
+#ifdef Q_OS_LINUX
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) return 0;
+    for (const QByteArray& line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) return line.mid(6).trimmed().split(' ').value(0).toLongLong() * 1024;
+    }
+#endif
+    return 0;
+}
+
+// One-sided p-value of the current samples being larger, by the normal
+// approximation of the Mann-Whitney U statistic; ties count half
+double mannWhitneyGreater(const QVector<double>& current, const QVector<double>& baseline)
+{
+    double u = 0;
+    for (double x : current) {
+        for (double y : baseline) u += x > y ? 1 : (x == y ? 0.5 : 0);
+    }
+    const double n1 = current.size();
+    const double n2 = baseline.size();
+    const double sigma = std::sqrt(n1 * n2 * (n1 + n2 + 1) / 12);
+    if (sigma <= 0) return 1;
+    const double z = (u - n1 * n2 / 2 - 0.5) / sigma; // With continuity correction
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+double toNanoseconds(double time, const QString& unit)
+{
+    if (unit == QLatin1String("us")) return time * 1e3;
+    if (unit == QLatin1String("ms")) return time * 1e6;
+    if (unit == QLatin1String("s")) return time * 1e9;
+    return time;
+}
+
+double median(QVector<double> values)
+{
+    if (values.isEmpty()) return 0;
+    std::sort(values.begin(), values.end());
+    const int middle = values.size() / 2;
+    return values.size() % 2 ? values.at(middle) : (values.at(middle - 1) + values.at(middle)) / 2;
+}
+
+QJsonObject entryJson(const QString& name, const QString& runType, qint64 iterations, double timeNs, double itemsPerSecond)
+{
+    QJsonObject object;
+    object.insert("name", name);
+    object.insert("run_type", runType);
+    object.insert("iterations", double(iterations));
+    object.insert("real_time", timeNs);
+    object.insert("cpu_time", timeNs); // Wall time; several benchmarks do their work on other threads
+    object.insert("time_unit", "ns");
+    if (itemsPerSecond > 0) object.insert("items_per_second", itemsPerSecond);
+    return object;
+}
+
+} // namespace
+
+class BenchmarkRunner::Private {
+public:
+    Private(BenchmarkRunner* q) : q(q) {}
+
+    BenchmarkRunner* q;
+    QRegularExpression filter;
+    QString corpusPath;
+    int repetitions = 5;
+    int minTimeMs = 200;
+    QVector<Result> results;
+
+    // Generated inputs, shared by the benchmarks of one run
+    std::unique_ptr<QTemporaryDir> workDir;
+    QString markdownPath;
+    QString editedMarkdownPath;
+
+    QStringList corpusFiles() const {
+        if (corpusPath.isEmpty()) return QStringList();
+        QStringList files;
+        const QFileInfoList entries = QDir(corpusPath).entryInfoList(
+            QStringList() << "*.pdf" << "*.epub" << "*.cbz", QDir::Files | QDir::Readable, QDir::Name);
+        for (const QFileInfo& entry : entries) files.append(entry.absoluteFilePath());
+        return files;
+    }
+
+    // Writes the Markdown inputs once; the edited copy changes one word in twenty
+    QString prepareInputs() {
+        if (workDir) return QString();
+        workDir.reset(new QTemporaryDir());
+        if (!workDir->isValid()) {
+            workDir.reset();
+            return QStringLiteral("Cannot create a temporary directory");
+        }
+        markdownPath = workDir->filePath("generated.md");
+        editedMarkdownPath = workDir->filePath("generated-edited.md");
+        TextGenerator original(TextSeed);
+        TextGenerator edits(TextSeed + 1);
+        QFile left(markdownPath);
+        QFile right(editedMarkdownPath);
+        if (!left.open(QIODevice::WriteOnly) || !right.open(QIODevice::WriteOnly)) {
+            return QStringLiteral("Cannot write generated documents");
+        }
+        for (int written = 0, section = 1; written < MarkdownWords; ++section) {
+            const QByteArray heading = QStringLiteral("## Section %1\n\n").arg(section).toUtf8();
+            left.write(heading);
+            right.write(heading);
+            for (int paragraph = 0; paragraph < 4; ++paragraph) {
+                QStringList leftWords;
+                QStringList rightWords;
+                for (int i = 0; i < 60; ++i, ++written) {
+                    const QString word = original.word();
+                    leftWords.append(word);
+                    rightWords.append(written % 20 == 7 ? edits.word() : word);
+                }
+                left.write((leftWords.join(QLatin1Char(' ')) + "\n\n").toUtf8());
+                right.write((rightWords.join(QLatin1Char(' ')) + "\n\n").toUtf8());
+            }
+        }
+        return QString();
+    }
+
+    QList<Case> cases();
+    Result runCase(const Case& benchmark);
+};
+
+QList<Case> BenchmarkRunner::Private::cases()
+{
+    Private* self = this;
+    QList<Case> cases;
+
+    // --- PageCache: tiles of 256 x 256, as DocumentView requests them ---
+    auto pageCache = std::make_shared<std::unique_ptr<PageCache>>();
+    auto tile = std::make_shared<QImage>();
+    auto keyFor = [](int i) {
+        return PageCache::CacheKey{1, i / 64, 1.0, 0, QSize(2048, 2048), i % 8, (i / 8) % 8};
+    };
+    auto makeCache = [pageCache, tile](qint64 maxBytes) {
+        *tile = QImage(256, 256, QImage::Format_ARGB32_Premultiplied);
+        tile->fill(Qt::white);
+        pageCache->reset(new PageCache());
+        (*pageCache)->setMaxSizeBytes(maxBytes);
+        return QString();
+    };
+    auto dropCache = [pageCache]() { pageCache->reset(); };
+
+    cases.append({QStringLiteral("PageCache/Put"),
+                  [makeCache]() { return makeCache(qint64(4) << 30); },
+                  [pageCache]() { (*pageCache)->clear(); },
+                  [pageCache, tile, keyFor]() {
+                      for (int i = 0; i < BatchSize; ++i) (*pageCache)->put(keyFor(i), *tile);
+                      return qint64(BatchSize);
+                  },
+                  dropCache});
+    cases.append({QStringLiteral("PageCache/Get"),
+                  [makeCache, pageCache, tile, keyFor]() {
+                      makeCache(qint64(4) << 30);
+                      for (int i = 0; i < BatchSize; ++i) (*pageCache)->put(keyFor(i), *tile);
+                      return QString();
+                  },
+                  nullptr,
+                  [pageCache, keyFor]() {
+                      qint64 hits = 0;
+                      for (int i = 0; i < BatchSize; ++i) hits += (*pageCache)->get(keyFor(i)).isNull() ? 0 : 1;
+                      return hits;
+                  },
+                  dropCache});
+    auto evictNext = std::make_shared<int>(0);
+    cases.append({QStringLiteral("PageCache/Evict"),
+                  [makeCache, evictNext]() {
+                      *evictNext = 0;
+                      return makeCache(qint64(BatchSize / 4) * 256 * 256 * 4); // Holds a quarter of a batch
+                  },
+                  nullptr,
+                  [pageCache, tile, keyFor, evictNext]() {
+                      for (int i = 0; i < BatchSize; ++i) (*pageCache)->put(keyFor((*evictNext)++), *tile);
+                      return qint64(BatchSize);
+                  },
+                  dropCache});
+
+    // --- IntelligentCache: eviction under each policy, with skewed reuse ---
+    const QList<QPair<QString, IntelligentCache::EvictionPolicy>> policies = {
+        {QStringLiteral("LRU"), IntelligentCache::EvictionPolicy::LRU},
+        {QStringLiteral("LFU"), IntelligentCache::EvictionPolicy::LFU},
+        {QStringLiteral("Priority"), IntelligentCache::EvictionPolicy::Priority}};
+    for (const auto& policy : policies) {
+        auto cache = std::make_shared<std::unique_ptr<IntelligentCache>>();
+        auto next = std::make_shared<int>(0);
+        const IntelligentCache::EvictionPolicy evictionPolicy = policy.second;
+        cases.append({QStringLiteral("IntelligentCache/Evict/%1").arg(policy.first),
+                      [cache, next, evictionPolicy]() {
+                          *next = 0;
+                          cache->reset(new IntelligentCache());
+                          (*cache)->setEvictionPolicy(evictionPolicy);
+                          (*cache)->setMaxSizeBytes(qint64(BatchSize / 4) * CacheItemBytes);
+                          return QString();
+                      },
+                      nullptr,
+                      [cache, next]() {
+                          const QVariant data(QByteArray(CacheItemBytes, 'x'));
+                          for (int i = 0; i < BatchSize; ++i, ++*next) {
+                              (*cache)->put(QString::number(*next), data, CacheItemBytes);
+                              if (i % 4 == 0) (*cache)->get(QString::number(*next / 2));
+                          }
+                          return qint64(BatchSize);
+                      },
+                      [cache]() { cache->reset(); }});
+    }
+
+    // --- FullTextIndex: indexing generated pages, then queries against them ---
+    struct IndexFixture {
+        std::unique_ptr<QTemporaryDir> directory;
+        std::unique_ptr<FullTextIndex> index;
+        std::unique_ptr<Document> document;
+        QStringList pages;
+        QStringList queries;
+
+        // The index goes before the document it refers to and the directory it lives in
+        void reset() {
+            index.reset();
+            document.reset();
+            directory.reset();
+            pages.clear();
+            queries.clear();
+        }
+    };
+    auto makeIndex = [self](IndexFixture& fixture, int pageCount) -> QString {
+        const QString error = self->prepareInputs();
+        if (!error.isEmpty()) return error;
+        QString loadError;
+        fixture.document = loadAndWait(self->markdownPath, &loadError);
+        if (!fixture.document) return QStringLiteral("Cannot open generated Markdown: ") + loadError;
+        fixture.directory.reset(new QTemporaryDir());
+        fixture.index.reset(new FullTextIndex());
+        if (!fixture.directory->isValid() || !fixture.index->initialize(fixture.directory->path())) {
+            return QStringLiteral("Cannot create a search index");
+        }
+        TextGenerator text(TextSeed);
+        for (int i = 0; i < pageCount; ++i) fixture.pages.append(text.words(WordsPerPage));
+        const QStringList& vocabulary = text.vocabulary();
+        for (int i = 0; i < QueryCount; ++i) {
+            // One common and one rarer word, then a prefix every eighth query
+            QString query = vocabulary.at(i % 64) + QLatin1Char(' ') + vocabulary.at(64 + (i * 37) % 1024);
+            if (i % 8 == 0) query = vocabulary.at(i).left(3) + QLatin1Char('*');
+            fixture.queries.append(query);
+        }
+        return QString();
+    };
+    auto indexing = std::make_shared<IndexFixture>();
+    cases.append({QStringLiteral("FullTextIndex/Index"),
+                  [indexing, makeIndex]() { return makeIndex(*indexing, 50); },
+                  [indexing]() { indexing->index->removeDocument(indexing->document.get()); },
+                  [indexing]() {
+                      indexing->index->indexText(indexing->document.get(), indexing->pages);
+                      return qint64(indexing->pages.size());
+                  },
+                  [indexing]() { indexing->reset(); }});
+    auto querying = std::make_shared<IndexFixture>();
+    cases.append({QStringLiteral("FullTextIndex/Query"),
+                  [querying, makeIndex]() -> QString {
+                      const QString error = makeIndex(*querying, 500);
+                      if (!error.isEmpty()) return error;
+                      querying->index->indexText(querying->document.get(), querying->pages);
+                      querying->index->commit();
+                      return QString();
+                  },
+                  nullptr,
+                  [querying]() {
+                      for (const QString& query : qAsConst(querying->queries)) querying->index->query(query, 20);
+                      return qint64(querying->queries.size());
+                  },
+                  [querying]() { querying->reset(); }});
+
+    // --- ContentComparison: the generated document against its edited copy ---
+    struct PairFixture {
+        std::unique_ptr<Document> left;
+        std::unique_ptr<Document> right;
+    };
+    auto pair = std::make_shared<PairFixture>();
+    cases.append({QStringLiteral("ContentComparison/Diff"),
+                  [self, pair]() -> QString {
+                      const QString error = self->prepareInputs();
+                      if (!error.isEmpty()) return error;
+                      QString loadError;
+                      pair->left = loadAndWait(self->markdownPath, &loadError);
+                      pair->right = loadAndWait(self->editedMarkdownPath, &loadError);
+                      if (!pair->left || !pair->right) return QStringLiteral("Cannot open generated Markdown: ") + loadError;
+                      return QString();
+                  },
+                  nullptr,
+                  [pair]() {
+                      ContentComparison::instance().compareDocuments(pair->left.get(), pair->right.get());
+                      return qint64(pair->left->pageCount() + pair->right->pageCount());
+                  },
+                  [pair]() { *pair = PairFixture(); }});
+
+    // --- ThreadPool: submitting empty tasks to a pool of fixed size ---
+    auto pool = std::make_shared<std::unique_ptr<ThreadPool>>();
+    cases.append({QStringLiteral("ThreadPool/SubmitDetached"),
+                  [pool]() {
+                      pool->reset(new ThreadPool(QStringLiteral("Benchmark"), 4));
+                      return QString();
+                  },
+                  nullptr,
+                  [pool]() {
+                      QSemaphore done;
+                      for (int i = 0; i < BatchSize; ++i) {
+                          (*pool)->submitDetached([&done]() { done.release(); });
+                      }
+                      done.acquire(BatchSize);
+                      return qint64(BatchSize);
+                  },
+                  [pool]() { pool->reset(); }});
+
+    // --- Parsing: loading the generated Markdown ---
+    auto parsed = std::make_shared<std::unique_ptr<Document>>();
+    cases.append({QStringLiteral("Parse/Markdown"),
+                  [self]() { return self->prepareInputs(); },
+                  [parsed]() { parsed->reset(); }, // The previous document is freed untimed
+                  [self, parsed]() {
+                      *parsed = loadAndWait(self->markdownPath, nullptr);
+                      return qint64(*parsed ? 1 : 0);
+                  },
+                  [parsed]() { parsed->reset(); }});
+
+    // --- Macro: open and render the first page, then the whole corpus ---
+    const QStringList corpus = corpusFiles();
+    for (const QString& path : corpus) {
+        auto document = std::make_shared<std::unique_ptr<Document>>();
+        cases.append({QStringLiteral("Macro/Open/%1").arg(QFileInfo(path).fileName()),
+                      nullptr,
+                      [document]() { document->reset(); },
+                      [document, path]() {
+                          *document = loadAndWait(path, nullptr);
+                          return qint64(*document ? 1 : 0);
+                      },
+                      [document]() { document->reset(); }});
+        cases.append({QStringLiteral("Macro/OpenFirstPage/%1").arg(QFileInfo(path).fileName()),
+                      nullptr,
+                      [document]() { document->reset(); },
+                      [document, path]() {
+                          *document = loadAndWait(path, nullptr);
+                          return *document ? renderPages(document->get(), 1, 1.0) : qint64(0);
+                      },
+                      [document]() { document->reset(); }});
+    }
+    cases.append({QStringLiteral("Macro/CorpusThroughput"),
+                  [corpus]() { return corpus.isEmpty() ? QStringLiteral("No corpus; pass --benchmark-corpus") : QString(); },
+                  nullptr,
+                  [corpus]() {
+                      qint64 pages = 0;
+                      for (const QString& path : corpus) {
+                          std::unique_ptr<Document> document = loadAndWait(path, nullptr);
+                          if (document) pages += renderPages(document.get(), ThroughputPagesPerDocument, 0.5);
+                      }
+                      return pages;
+                  },
+                  nullptr});
+
+    QList<Case> selected;
+    for (const Case& benchmark : qAsConst(cases)) {
+        if (filter.pattern().isEmpty() || filter.match(benchmark.name).hasMatch()) selected.append(benchmark);
+    }
+    return selected;
+}
+
+BenchmarkRunner::Result BenchmarkRunner::Private::runCase(const Case& benchmark)
+{
+    Result result;
+    result.name = benchmark.name;
+    resetPeakRss();
+    if (benchmark.setUp) result.skipped = benchmark.setUp();
+    if (!result.skipped.isEmpty()) {
+        LOG_WARN("BenchmarkRunner: Skipping " << benchmark.name << ": " << result.skipped);
+        if (benchmark.tearDown) benchmark.tearDown();
+        return result;
+    }
+
+    auto timedIteration = [&benchmark](qint64* items) {
+        if (benchmark.prepare) benchmark.prepare();
+        QElapsedTimer timer;
+        timer.start();
+        *items += benchmark.body();
+        return timer.nsecsElapsed();
+    };
+
+    qint64 warmupItems = 0;
+    timedIteration(&warmupItems);
+
+    // The first repetition finds the iteration count; the others repeat it so their samples compare
+    const qint64 minTimeNs = qint64(minTimeMs) * 1000000;
+    qint64 items = 0;
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+        qint64 elapsedNs = 0;
+        qint64 iterations = 0;
+        while (result.iterations > 0 ? iterations < result.iterations
+                                     : (elapsedNs < minTimeNs && iterations < MaxIterations)) {
+            elapsedNs += timedIteration(&items);
+            ++iterations;
+            QCoreApplication::processEvents(); // Queued results of the work must not pile up
+        }
+        result.iterations = iterations;
+        result.samplesNs.append(double(elapsedNs) / iterations);
+    }
+    result.peakRssBytes = peakRss();
+    if (benchmark.tearDown) benchmark.tearDown();
+
+    double sum = 0;
+    for (double sample : qAsConst(result.samplesNs)) sum += sample;
+    result.meanNs = sum / result.samplesNs.size();
+    double squares = 0;
+    for (double sample : qAsConst(result.samplesNs)) squares += (sample - result.meanNs) * (sample - result.meanNs);
+    result.stddevNs = result.samplesNs.size() > 1 ? std::sqrt(squares / (result.samplesNs.size() - 1)) : 0;
+    result.minNs = *std::min_element(result.samplesNs.constBegin(), result.samplesNs.constEnd());
+    result.medianNs = median(result.samplesNs);
+    const double itemsPerIteration = double(items) / (double(result.iterations) * repetitions);
+    if (itemsPerIteration > 0 && result.medianNs > 0) result.itemsPerSecond = itemsPerIteration * 1e9 / result.medianNs;
+    return result;
+}
+
+BenchmarkRunner::BenchmarkRunner(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+BenchmarkRunner::~BenchmarkRunner() = default;
+
+void BenchmarkRunner::setFilter(const QString& pattern)
+{
+    d->filter.setPattern(pattern);
+    if (!d->filter.isValid()) LOG_WARN("BenchmarkRunner: Invalid filter " << pattern << ": " << d->filter.errorString());
+}
+
+void BenchmarkRunner::setCorpus(const QString& directory)
+{
+    d->corpusPath = directory;
+}
+
+void BenchmarkRunner::setRepetitions(int repetitions)
+{
+    d->repetitions = qMax(1, repetitions);
+}
+
+int BenchmarkRunner::repetitions() const
+{
+    return d->repetitions;
+}
+
+void BenchmarkRunner::setMinTimeMs(int milliseconds)
+{
+    d->minTimeMs = qMax(1, milliseconds);
+}
+
+int BenchmarkRunner::minTimeMs() const
+{
+    return d->minTimeMs;
+}
+
+QStringList BenchmarkRunner::names() const
+{
+    QStringList names;
+    for (const Case& benchmark : d->cases()) names.append(benchmark.name);
+    return names;
+}
+
+int BenchmarkRunner::run()
+{
+    const QList<Case> cases = d->cases();
+    d->results.clear();
+    LOG_INFO("BenchmarkRunner: Running " << cases.size() << " benchmarks, " << d->repetitions
+             << " repetitions of at least " << d->minTimeMs << " ms each");
+    int ran = 0;
+    for (const Case& benchmark : cases) {
+        const Result result = d->runCase(benchmark);
+        if (result.skipped.isEmpty()) ++ran;
+        d->results.append(result);
+        emit benchmarkFinished(result, d->results.size(), cases.size());
+    }
+    d->workDir.reset();
+    return ran;
+}
+
+QList<BenchmarkRunner::Result> BenchmarkRunner::results() const
+{
+    return d->results.toList();
+}
+
+QJsonObject BenchmarkRunner::report() const
+{
+    QJsonObject context;
+    context.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+    context.insert("host_name", QSysInfo::machineHostName());
+    context.insert("executable", QCoreApplication::applicationFilePath());
+    context.insert("version", QCoreApplication::applicationVersion());
+    context.insert("num_cpus", QThread::idealThreadCount());
+#ifdef QT_NO_DEBUG
+    context.insert("library_build_type", "release");
+#else
+    context.insert("library_build_type", "debug");
+#endif
+    context.insert("corpus", d->corpusPath);
+    context.insert("repetitions", d->repetitions);
+    context.insert("min_time_ms", d->minTimeMs);
+
+    QJsonArray benchmarks;
+    for (const Result& result : qAsConst(d->results)) {
+        if (!result.skipped.isEmpty()) {
+            QJsonObject skipped;
+            skipped.insert("name", result.name);
+            skipped.insert("run_type", "iteration");
+            skipped.insert("error_occurred", true);
+            skipped.insert("error_message", result.skipped);
+            benchmarks.append(skipped);
+            continue;
+        }
+        for (int i = 0; i < result.samplesNs.size(); ++i) {
+            QJsonObject entry = entryJson(result.name, "iteration", result.iterations, result.samplesNs.at(i),
+                                          result.itemsPerSecond * result.medianNs / result.samplesNs.at(i));
+            entry.insert("run_name", result.name);
+            entry.insert("repetitions", result.samplesNs.size());
+            entry.insert("repetition_index", i);
+            if (result.peakRssBytes > 0) entry.insert("peak_rss_bytes", double(result.peakRssBytes));
+            benchmarks.append(entry);
+        }
+        const QList<QPair<QString, double>> aggregates = {
+            {QStringLiteral("mean"), result.meanNs},
+            {QStringLiteral("median"), result.medianNs},
+            {QStringLiteral("stddev"), result.stddevNs}};
+        for (const auto& aggregate : aggregates) {
+            QJsonObject entry = entryJson(result.name + QLatin1Char('_') + aggregate.first, "aggregate",
+                                          result.iterations, aggregate.second,
+                                          aggregate.first == QLatin1String("median") ? result.itemsPerSecond : 0);
+            entry.insert("run_name", result.name);
+            entry.insert("aggregate_name", aggregate.first);
+            if (result.peakRssBytes > 0) entry.insert("peak_rss_bytes", double(result.peakRssBytes));
+            entry.insert("repetitions", result.samplesNs.size());
+            benchmarks.append(entry);
+        }
+    }
+
+    QJsonObject report;
+    report.insert("context", context);
+    report.insert("benchmarks", benchmarks);
+    return report;
+}
+
+QStringList BenchmarkRunner::reportNames(const QJsonObject& baseline)
+{
+    QStringList names;
+    for (const QJsonValue& value : baseline.value("benchmarks").toArray()) {
+        const QJsonObject entry = value.toObject();
+        if (entry.value("run_type").toString() != QLatin1String("iteration") || entry.value("error_occurred").toBool()) continue;
+        const QString name = entry.value("run_name").toString(entry.value("name").toString());
+        if (!names.contains(name)) names.append(name);
+    }
+    return names;
+}
+
+QList<BenchmarkRunner::Comparison> BenchmarkRunner::compareWith(const QJsonObject& baseline, double thresholdPercent) const
+{
+    struct Stored {
+        QVector<double> samplesNs;
+        double peakRssBytes = 0;
+    };
+    QHash<QString, Stored> stored;
+    for (const QJsonValue& value : baseline.value("benchmarks").toArray()) {
+        const QJsonObject entry = value.toObject();
+        if (entry.value("run_type").toString() != QLatin1String("iteration") || entry.value("error_occurred").toBool()) continue;
+        Stored& item = stored[entry.value("run_name").toString(entry.value("name").toString())];
+        item.samplesNs.append(toNanoseconds(entry.value("real_time").toDouble(), entry.value("time_unit").toString()));
+        item.peakRssBytes = qMax(item.peakRssBytes, entry.value("peak_rss_bytes").toDouble());
+    }
+
+    QList<Comparison> comparisons;
+    for (const Result& result : qAsConst(d->results)) {
+        const auto it = stored.constFind(result.name);
+        if (!result.skipped.isEmpty() || it == stored.constEnd() || it->samplesNs.isEmpty()) continue;
+
+        Comparison time;
+        time.name = result.name;
+        time.metric = QStringLiteral("time");
+        time.baseline = median(it->samplesNs);
+        time.current = result.medianNs;
+        time.changePercent = time.baseline > 0 ? 100 * (time.current - time.baseline) / time.baseline : 0;
+        const bool enoughSamples = result.samplesNs.size() >= MinRankTestSamples && it->samplesNs.size() >= MinRankTestSamples;
+        if (enoughSamples) time.pValue = mannWhitneyGreater(result.samplesNs, it->samplesNs);
+        time.regression = time.changePercent > thresholdPercent && (!enoughSamples || time.pValue < SignificanceLevel);
+        comparisons.append(time);
+
+        if (it->peakRssBytes > 0 && result.peakRssBytes > 0) {
+            Comparison memory;
+            memory.name = result.name;
+            memory.metric = QStringLiteral("peak_rss");
+            memory.baseline = it->peakRssBytes;
+            memory.current = double(result.peakRssBytes);
+            memory.changePercent = 100 * (memory.current - memory.baseline) / memory.baseline;
+            memory.regression = memory.changePercent > thresholdPercent
+                && memory.current - memory.baseline > MinRssGrowthBytes;
+            comparisons.append(memory);
+        }
+    }
+    return comparisons;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,187 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_BENCHMARKRUNNER_H
+#define QUANTILYX_BENCHMARKRUNNER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Times the hot paths of the application without a user interface.
+ *
+ * Microbenchmarks cover PageCache put, get and eviction, IntelligentCache
+ * eviction, FullTextIndex indexing and queries, ContentComparison diffing,
+ * ThreadPool submission and Markdown parsing. They work on text and
+ * documents generated from fixed seeds, so two runs time the same work.
+ * Macrobenchmarks open each document of a corpus directory (PDF, EPUB
+ * and CBZ files), open it and render its first page, and render the
+ * corpus from end to end for throughput; they are skipped when no corpus
+ * is set.
+ *
+ * Each benchmark runs once to warm up, then repetitions() times; a
+ * repetition repeats the benchmark until minTimeMs() of timed work has
+ * passed. report() is in the JSON format of Google Benchmark, so its
+ * tools can compare two runs. A report kept as a baseline gates a later
+ * run: compareWith() flags the benchmarks that got slower by more than a
+ * threshold, when a rank test of the repetitions agrees that the change
+ * is not noise, and those whose peak resident memory grew past it.
+ */
+class BenchmarkRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Timings of one benchmark.
+     */
+    struct Result {
+        QString name;
+        QString skipped;                // Why it did not run; empty if it did
+        qint64 iterations = 0;          // Per repetition
+        QVector<double> samplesNs;      // Time per iteration of each repetition
+        double meanNs = 0;
+        double medianNs = 0;
+        double stddevNs = 0;
+        double minNs = 0;
+        double itemsPerSecond = 0;      // At the median; 0 if the benchmark counts no items
+        qint64 peakRssBytes = 0;        // Highest resident memory while it ran; 0 where not known
+    };
+
+    /**
+     * @brief One metric of one benchmark against its baseline.
+     */
+    struct Comparison {
+        QString name;
+        QString metric;                 // "time" (median ns per iteration) or "peak_rss" (bytes)
+        double baseline = 0;
+        double current = 0;
+        double changePercent = 0;       // Positive when worse
+        double pValue = 1;              // One-sided Mann-Whitney U; 1 where there are too few samples
+        bool regression = false;
+    };
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit BenchmarkRunner(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~BenchmarkRunner() override;
+
+    /**
+     * @brief Only run the benchmarks whose name matches a pattern.
+     * @param pattern Regular expression; empty runs all of them.
+     */
+    void setFilter(const QString& pattern);
+
+    /**
+     * @brief Set the directory of documents the macrobenchmarks open.
+     * @param directory Directory searched for PDF, EPUB and CBZ files, in name order.
+     */
+    void setCorpus(const QString& directory);
+
+    /**
+     * @brief Set how many times each benchmark is timed.
+     * @param repetitions Repetitions, at least 1 (default 5).
+     */
+    void setRepetitions(int repetitions);
+
+    /**
+     * @brief Get how many times each benchmark is timed.
+     * @return Repetitions.
+     */
+    int repetitions() const;
+
+    /**
+     * @brief Set the least timed work in one repetition.
+     * @param milliseconds Minimum time (default 200).
+     */
+    void setMinTimeMs(int milliseconds);
+
+    /**
+     * @brief Get the least timed work in one repetition.
+     * @return Minimum time in milliseconds.
+     */
+    int minTimeMs() const;
+
+    /**
+     * @brief Get the names of the benchmarks the filter selects.
+     * Corpus benchmarks are named after their files, so set the corpus first.
+     * @return Names, in run order.
+     */
+    QStringList names() const;
+
+    /**
+     * @brief Run the selected benchmarks, blocking until all are done.
+     * Called from the main thread; document loading may run its event loop.
+     * @return Number of benchmarks that ran.
+     */
+    int run();
+
+    /**
+     * @brief Get the results of the last run, in run order.
+     * @return One result per selected benchmark.
+     */
+    QList<Result> results() const;
+
+    /**
+     * @brief Get the results of the last run as Google Benchmark JSON.
+     * @return Object with "context" and "benchmarks": one entry per
+     * repetition, then the mean, median and stddev aggregates.
+     */
+    QJsonObject report() const;
+
+    /**
+     * @brief Get the names of the benchmarks in a report.
+     * @param baseline Report written by report().
+     * @return Names, skipped ones excluded.
+     */
+    static QStringList reportNames(const QJsonObject& baseline);
+
+    /**
+     * @brief Compare the last run against a baseline report.
+     * A time regression needs the median to be more than thresholdPercent
+     * slower and, with three or more repetitions on each side, the
+     * repetitions to be slower with p below 0.05. A memory regression needs
+     * the peak to grow by more than thresholdPercent and 4 MiB.
+     * Benchmarks only one side ran are left out.
+     * @param baseline Report written by report().
+     * @param thresholdPercent Allowed slowdown or growth, in percent.
+     * @return One comparison per metric of each benchmark both ran.
+     */
+    QList<Comparison> compareWith(const QJsonObject& baseline, double thresholdPercent) const;
+
+signals:
+    /**
+     * @brief Emitted as each benchmark finishes.
+     * @param result Its timings.
+     * @param finished Benchmarks finished so far.
+     * @param total Benchmarks in the run.
+     */
+    void benchmarkFinished(const QuantilyxDoc::BenchmarkRunner::Result& result, int finished, int total);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_BENCHMARKRUNNER_H
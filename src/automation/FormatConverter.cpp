@@ -0,0 +1,531 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "FormatConverter.h"
+#include "PageExporter.h"
+#include "../core/Document.h"
+#include "../core/DocumentFactory.h"
+#include "../core/Logger.h"
+#include "../core/Page.h"
+#include "../core/ThreadPool.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <qpdf/QPDFObjectHandle.hh>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const int QueueSlotsPerWorker = 2;  // Pages each stage may run ahead of the next, per worker
+const int FlateLevel = 6;
+
+// Queue between two stages. push() blocks while full and pop() while
+// empty; the queue closes once every producer is done, or at once on cancel.
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(int capacity, int producers) : m_capacity(qMax(1, capacity)), m_producers(producers) {}
+
+    bool push(T item) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_closed && int(m_items.size()) >= m_capacity) m_notFull.wait(&m_mutex);
+        if (m_closed) return false;
+        m_items.push_back(std::move(item));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(T* item) {
+        QMutexLocker locker(&m_mutex);
+        while (m_items.empty() && !m_closed) m_notEmpty.wait(&m_mutex);
+        if (m_items.empty()) return false;
+        *item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void producerFinished() {
+        QMutexLocker locker(&m_mutex);
+        if (--m_producers <= 0) closeLocked();
+    }
+
+    // Drops what is queued and wakes everyone
+    void cancel() {
+        QMutexLocker locker(&m_mutex);
+        m_items.clear();
+        closeLocked();
+    }
+
+private:
+    void closeLocked() {
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    std::deque<T> m_items;
+    const int m_capacity;
+    int m_producers;
+    bool m_closed = false;
+};
+
+struct DecodedPage {
+    int position = 0;   // Place in the page list, and so in the output
+    int pageIndex = 0;
+    QSizeF size;        // In points
+    QImage image;       // Null if the page failed
+    QString error;
+};
+
+struct EncodedPage {
+    int position = 0;
+    int pageIndex = 0;
+    QSizeF size;
+    QByteArray data;    // Empty if the page failed
+    int width = 0;
+    int height = 0;
+    bool gray = false;
+    bool jpeg = false;
+    QString error;
+};
+
+QByteArray writerFormat(const QString& format)
+{
+    const QString lower = format.toLower();
+    if (lower == QLatin1String("jpg")) return QByteArrayLiteral("jpeg");
+    return lower.toLatin1();
+}
+
+QByteArray reference(int objectId)
+{
+    return QByteArray::number(objectId) + " 0 R";
+}
+
+QByteArray number(double value)
+{
+    return QByteArray::number(value, 'f', 2);
+}
+
+// Appends a PDF to a file page by page: objects are written as pages
+// arrive, in any order, and the page tree that orders them at the end.
+// Only byte offsets are kept per page.
+class PdfStreamWriter
+{
+public:
+    // Object 1 is the catalog, 2 the page tree, 3 the document information;
+    // page k has its page object, content stream and image after them
+    static constexpr int FixedObjects = 3;
+    static constexpr int ObjectsPerPage = 3;
+
+    PdfStreamWriter(const QString& path, int pageCount)
+        : m_file(path), m_pageCount(pageCount), m_offsets(FixedObjects + ObjectsPerPage * pageCount + 1, 0) {}
+
+    bool open() {
+        // The binary comment marks the file as binary for transfer tools
+        return m_file.open(QIODevice::WriteOnly) && write(QByteArrayLiteral("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n"));
+    }
+
+    bool writePage(const EncodedPage& page) {
+        const int pageObject = FixedObjects + 1 + ObjectsPerPage * page.position;
+        const int contentObject = pageObject + 1;
+        const int imageObject = pageObject + 2;
+        const QSizeF size = page.size.isEmpty() ? QSizeF(612, 792) : page.size;
+
+        QByteArray content;
+        if (!page.data.isEmpty()) {
+            content = "q " + number(size.width()) + " 0 0 " + number(size.height()) + " 0 0 cm /Im0 Do Q";
+            QPDFObjectHandle image = QPDFObjectHandle::newDictionary();
+            image.replaceKey("/Type", QPDFObjectHandle::newName("/XObject"));
+            image.replaceKey("/Subtype", QPDFObjectHandle::newName("/Image"));
+            image.replaceKey("/Width", QPDFObjectHandle::newInteger(page.width));
+            image.replaceKey("/Height", QPDFObjectHandle::newInteger(page.height));
+            image.replaceKey("/ColorSpace", QPDFObjectHandle::newName(page.gray ? "/DeviceGray" : "/DeviceRGB"));
+            image.replaceKey("/BitsPerComponent", QPDFObjectHandle::newInteger(8));
+            image.replaceKey("/Filter", QPDFObjectHandle::newName(page.jpeg ? "/DCTDecode" : "/FlateDecode"));
+            image.replaceKey("/Length", QPDFObjectHandle::newInteger(page.data.size()));
+            if (!writeStream(imageObject, image, page.data)) return false;
+        } else if (!writeObject(imageObject, "null")) {
+            return false; // A failed page keeps its numbers, as a blank page
+        }
+
+        QPDFObjectHandle contents = QPDFObjectHandle::newDictionary();
+        contents.replaceKey("/Length", QPDFObjectHandle::newInteger(content.size()));
+        if (!writeStream(contentObject, contents, content)) return false;
+
+        const QPDFObjectHandle mediaBox = QPDFObjectHandle::newArray({
+            QPDFObjectHandle::newInteger(0), QPDFObjectHandle::newInteger(0),
+            QPDFObjectHandle::newReal(size.width(), 2), QPDFObjectHandle::newReal(size.height(), 2)
+        });
+        QByteArray body = "<< /Type /Page /Parent " + reference(2)
+                        + " /MediaBox " + QByteArray::fromStdString(mediaBox.unparse())
+                        + " /Contents " + reference(contentObject);
+        body += page.data.isEmpty() ? QByteArray(" /Resources << >>")
+                                    : " /Resources << /XObject << /Im0 " + reference(imageObject) + " >> >>";
+        return writeObject(pageObject, body + " >>");
+    }
+
+    // Writes the page tree, catalog and cross-reference table, and replaces the target
+    bool finish(const QString& title) {
+        QByteArray kids;
+        for (int k = 0; k < m_pageCount; ++k) kids += reference(FixedObjects + 1 + ObjectsPerPage * k) + ' ';
+        QPDFObjectHandle info = QPDFObjectHandle::newDictionary();
+        info.replaceKey("/Producer", QPDFObjectHandle::newUnicodeString("QuantilyxDoc"));
+        if (!title.isEmpty()) info.replaceKey("/Title", QPDFObjectHandle::newUnicodeString(title.toStdString()));
+        if (!writeObject(1, "<< /Type /Catalog /Pages " + reference(2) + " >>")
+            || !writeObject(2, "<< /Type /Pages /Kids [ " + kids + "] /Count " + QByteArray::number(m_pageCount) + " >>")
+            || !writeObject(3, QByteArray::fromStdString(info.unparse()))) {
+            return false;
+        }
+
+        const qint64 xrefOffset = m_position;
+        QByteArray xref = "xref\n0 " + QByteArray::number(m_offsets.size()) + "\n0000000000 65535 f\r\n";
+        for (int id = 1; id < m_offsets.size(); ++id) {
+            xref += QByteArray::number(m_offsets[id]).rightJustified(10, '0') + " 00000 n\r\n";
+        }
+        xref += "trailer\n<< /Size " + QByteArray::number(m_offsets.size()) + " /Root " + reference(1)
+              + " /Info " + reference(3) + " >>\nstartxref\n" + QByteArray::number(xrefOffset) + "\n%%EOF\n";
+        return write(xref) && m_file.commit();
+    }
+
+    void discard() { m_file.cancelWriting(); }
+
+    QString errorString() const { return m_file.errorString(); }
+
+private:
+    bool write(const QByteArray& bytes) {
+        if (m_file.write(bytes) != bytes.size()) return false;
+        m_position += bytes.size();
+        return true;
+    }
+
+    bool writeObject(int id, const QByteArray& body) {
+        m_offsets[id] = m_position;
+        return write(QByteArray::number(id) + " 0 obj\n" + body + "\nendobj\n");
+    }
+
+    bool writeStream(int id, const QPDFObjectHandle& dictionary, const QByteArray& data) {
+        m_offsets[id] = m_position;
+        return write(QByteArray::number(id) + " 0 obj\n" + QByteArray::fromStdString(dictionary.unparse()) + "\nstream\n")
+               && write(data) && write(QByteArrayLiteral("\nendstream\nendobj\n"));
+    }
+
+    QSaveFile m_file;
+    const int m_pageCount;
+    QVector<qint64> m_offsets; // By object ID
+    qint64 m_position = 0;
+};
+
+} // namespace
+
+class FormatConverter::Private {
+public:
+    Private(FormatConverter* q) : q(q) {}
+
+    FormatConverter* q;
+    QByteArray format = QByteArrayLiteral("pdf");
+    int dpi = 150;
+    int quality = -1;
+    int jobs = 0;
+    QString outputPattern;
+    QString error;
+    std::atomic<bool> cancelRequested{false};
+
+    bool toPdf() const { return format == "pdf"; }
+
+    QString outputPath(int pageIndex, int pageCount) const {
+        const int width = QString::number(pageCount).size();
+        return outputPattern.contains(QLatin1String("%1"))
+                   ? outputPattern.arg(pageIndex + 1, width, 10, QLatin1Char('0'))
+                   : outputPattern;
+    }
+
+    DecodedPage decode(Page* page, int position, int pageIndex) const {
+        DecodedPage decoded;
+        decoded.position = position;
+        decoded.pageIndex = pageIndex;
+        if (!page) {
+            decoded.error = QStringLiteral("The page cannot be loaded");
+            return decoded;
+        }
+        decoded.size = page->size();
+        const QSizeF pixels = decoded.size * dpi / 72.0;
+        decoded.image = page->render(qMax(1, qRound(pixels.width())), qMax(1, qRound(pixels.height())), dpi);
+        if (decoded.image.isNull()) decoded.error = QStringLiteral("Rendering failed");
+        return decoded;
+    }
+
+    EncodedPage encode(DecodedPage decoded) const {
+        EncodedPage encoded;
+        encoded.position = decoded.position;
+        encoded.pageIndex = decoded.pageIndex;
+        encoded.size = decoded.size;
+        encoded.error = decoded.error;
+        if (decoded.image.isNull()) return encoded;
+
+        QImage image = std::move(decoded.image);
+        const bool lossy = toPdf() ? quality >= 0 : format == "jpeg";
+        if (image.hasAlphaChannel() && (toPdf() || lossy)) {
+            // Neither PDF images nor JPEG carry alpha here; flatten on paper white
+            QImage flat(image.size(), QImage::Format_RGB32);
+            flat.fill(Qt::white);
+            QPainter painter(&flat);
+            painter.drawImage(0, 0, image);
+            painter.end();
+            image = std::move(flat);
+        }
+
+        if (!toPdf()) {
+            QBuffer buffer(&encoded.data);
+            buffer.open(QIODevice::WriteOnly);
+            QImageWriter writer(&buffer, format);
+            if (quality >= 0) writer.setQuality(quality);
+            if (!writer.write(image)) {
+                encoded.data.clear();
+                encoded.error = writer.errorString();
+            }
+            return encoded;
+        }
+
+        // Scanned comics and DjVu pages are often gray; a third of the bytes
+        encoded.gray = image.allGray();
+        image = image.convertToFormat(encoded.gray ? QImage::Format_Grayscale8 : QImage::Format_RGB888);
+        encoded.width = image.width();
+        encoded.height = image.height();
+        encoded.jpeg = lossy;
+        if (lossy) {
+            QBuffer buffer(&encoded.data);
+            buffer.open(QIODevice::WriteOnly);
+            QImageWriter writer(&buffer, "jpeg");
+            writer.setQuality(quality);
+            if (!writer.write(image)) {
+                encoded.data.clear();
+                encoded.error = writer.errorString();
+            }
+            return encoded;
+        }
+        // FlateDecode takes the rows unpadded; qCompress() puts a length before the zlib stream
+        const int rowBytes = image.width() * (encoded.gray ? 1 : 3);
+        QByteArray rows;
+        rows.reserve(rowBytes * image.height());
+        for (int y = 0; y < image.height(); ++y) rows.append(reinterpret_cast<const char*>(image.constScanLine(y)), rowBytes);
+        image = QImage();
+        encoded.data = qCompress(rows, FlateLevel).mid(4);
+        return encoded;
+    }
+
+    bool writeImage(const EncodedPage& page, int pageCount, QString* message) const {
+        QSaveFile file(outputPath(page.pageIndex, pageCount));
+        if (!file.open(QIODevice::WriteOnly) || file.write(page.data) != page.data.size() || !file.commit()) {
+            *message = file.errorString();
+            return false;
+        }
+        return true;
+    }
+};
+
+FormatConverter::FormatConverter(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+FormatConverter::~FormatConverter() = default;
+
+bool FormatConverter::setFormat(const QString& format)
+{
+    const QByteArray name = writerFormat(format);
+    if (name != "pdf" && !QImageWriter::supportedImageFormats().contains(name)) return false;
+    d->format = name;
+    return true;
+}
+
+QString FormatConverter::format() const
+{
+    return QString::fromLatin1(d->format);
+}
+
+void FormatConverter::setDpi(int dpi)
+{
+    d->dpi = qBound(1, dpi, 2400);
+}
+
+void FormatConverter::setQuality(int quality)
+{
+    d->quality = qBound(-1, quality, 100);
+}
+
+void FormatConverter::setJobs(int jobs)
+{
+    d->jobs = jobs;
+}
+
+void FormatConverter::setOutput(const QString& pattern)
+{
+    d->outputPattern = pattern;
+}
+
+void FormatConverter::cancel()
+{
+    d->cancelRequested = true;
+}
+
+QString FormatConverter::errorString() const
+{
+    return d->error;
+}
+
+int FormatConverter::run(const QString& inputPath, const QString& pageRanges)
+{
+    d->error.clear();
+    d->cancelRequested = false;
+    if (d->outputPattern.isEmpty()) {
+        d->error = QStringLiteral("No output file");
+        return -1;
+    }
+
+    QString error;
+    std::unique_ptr<Document> document(DocumentFactory::instance().loadDocumentAndWait(inputPath, QString(), &error));
+    if (!document) {
+        d->error = error.isEmpty() ? QStringLiteral("Cannot open %1").arg(inputPath) : error;
+        return -1;
+    }
+
+    const int pageCount = document->pageCount();
+    const QVector<int> pages = PageExporter::selectPages(pageRanges, pageCount, d->outputPattern, d->toPdf(), &d->error);
+    if (pages.isEmpty()) return -1;
+    std::unique_ptr<PdfStreamWriter> pdf;
+    if (d->toPdf()) {
+        pdf.reset(new PdfStreamWriter(d->outputPattern, pages.size()));
+        if (!pdf->open()) {
+            d->error = QStringLiteral("Cannot write %1: %2").arg(d->outputPattern, pdf->errorString());
+            return -1;
+        }
+    }
+
+    // Rendering is usually the slower half, so decoders get the odd thread
+    const int threads = qMax(2, d->jobs > 0 ? d->jobs : QThread::idealThreadCount());
+    const int decoders = qMin(pages.size(), (threads + 1) / 2);
+    const int encoders = qMin(pages.size(), qMax(1, threads - decoders));
+    LOG_INFO("FormatConverter: Converting " << pages.size() << " pages of " << inputPath << " to " << d->format
+             << " at " << d->dpi << " dpi with " << decoders << " decoders and " << encoders << " encoders");
+
+    BoundedQueue<DecodedPage> decodedQueue(encoders * QueueSlotsPerWorker, decoders);
+    BoundedQueue<EncodedPage> encodedQueue(encoders * QueueSlotsPerWorker, encoders);
+    std::atomic<int> next{0};
+    std::atomic<int> failed{0};
+    bool writeFailed = false;
+    QString writeError;
+    Document* source = document.get();
+
+    // Every stage blocks on its queues, so each worker needs a thread of
+    // its own: the shared pools could run out with producers waiting on
+    // consumers that never start
+    const int workers = decoders + encoders + 1;
+    ThreadPool pool(QStringLiteral("Conversion"), workers);
+    auto stage = [&](int worker) {
+        if (worker < decoders) {
+            for (int position = next++; position < pages.size() && !d->cancelRequested; position = next++) {
+                if (!decodedQueue.push(d->decode(source->page(pages.at(position)), position, pages.at(position)))) break;
+            }
+            decodedQueue.producerFinished();
+        } else if (worker < decoders + encoders) {
+            DecodedPage decoded;
+            while (decodedQueue.pop(&decoded)) {
+                if (!encodedQueue.push(d->encode(std::move(decoded)))) break;
+            }
+            encodedQueue.producerFinished();
+        } else {
+            EncodedPage encoded;
+            int done = 0;
+            while (encodedQueue.pop(&encoded)) {
+                QString message = encoded.error;
+                bool written = !encoded.data.isEmpty();
+                if (pdf) {
+                    if (!pdf->writePage(encoded)) {
+                        writeFailed = true;
+                        writeError = pdf->errorString();
+                    }
+                } else if (written && !d->writeImage(encoded, pageCount, &message)) {
+                    written = false;
+                }
+                if (writeFailed || d->cancelRequested) {
+                    // Stop the stages before; what they hold is dropped
+                    d->cancelRequested = true;
+                    decodedQueue.cancel();
+                    encodedQueue.cancel();
+                    break;
+                }
+                ++done;
+                const int pageIndex = encoded.pageIndex;
+                const qint64 bytes = encoded.data.size();
+                if (written) {
+                    QMetaObject::invokeMethod(this, [this, pageIndex, bytes]() {
+                        emit pageConverted(pageIndex, bytes);
+                    }, Qt::QueuedConnection);
+                } else {
+                    ++failed;
+                    QMetaObject::invokeMethod(this, [this, pageIndex, message]() {
+                        emit pageFailed(pageIndex, message);
+                    }, Qt::QueuedConnection);
+                }
+                const int total = pages.size();
+                QMetaObject::invokeMethod(this, [this, done, total]() {
+                    emit progress(done, total);
+                }, Qt::QueuedConnection);
+                encoded = EncodedPage();
+            }
+        }
+    };
+
+    QEventLoop loop;
+    ThreadPool::instance().submitDetached([&pool, &stage, &loop, workers]() {
+        pool.forEach(workers, stage);
+        QMetaObject::invokeMethod(&loop, "quit", Qt::QueuedConnection);
+    });
+    loop.exec();
+    QCoreApplication::sendPostedEvents(this); // Progress of the last pages
+
+    if (pdf) {
+        if (writeFailed || d->cancelRequested || !pdf->finish(QFileInfo(inputPath).completeBaseName())) {
+            if (!writeFailed && !d->cancelRequested) writeError = pdf->errorString();
+            pdf->discard();
+            d->error = d->cancelRequested && !writeFailed ? QStringLiteral("Canceled")
+                                                         : QStringLiteral("Cannot write %1: %2").arg(d->outputPattern, writeError);
+            return -1;
+        }
+    } else if (d->cancelRequested) {
+        d->error = QStringLiteral("Canceled");
+        return -1;
+    }
+
+    LOG_INFO("FormatConverter: " << (pages.size() - failed) << " of " << pages.size() << " pages of " << inputPath
+             << " written to " << d->outputPattern);
+    return failed;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,140 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FORMATCONVERTER_H
+#define QUANTILYX_FORMATCONVERTER_H
+
+#include <QObject>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Converts documents of any supported format to PDF or images, page by page.
+ *
+ * Conversion streams through three stages joined by bounded queues:
+ * decoders render pages of the Document, encoders compress them, and one
+ * writer appends them to the output as they arrive. A full queue stalls
+ * the stage before it, so at most a few pages per worker are in memory
+ * however long the document is, and decoders and encoders both use every
+ * core given to them.
+ *
+ * A PDF is written object by object, each page's image, content and page
+ * object as soon as it is encoded, with the page tree and cross-reference
+ * table at the end; the file only replaces the target once complete.
+ * Images go to one file per page.
+ */
+class FormatConverter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit FormatConverter(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~FormatConverter() override;
+
+    /**
+     * @brief Set the output format.
+     * @param format "pdf", or an image format PageExporter writes ("png", "jpg", "webp").
+     * @return False if the format cannot be written here.
+     */
+    bool setFormat(const QString& format);
+
+    /**
+     * @brief Get the output format.
+     * @return Format name, "pdf" by default.
+     */
+    QString format() const;
+
+    /**
+     * @brief Set the resolution pages are rendered at.
+     * @param dpi Dots per inch (default 150).
+     */
+    void setDpi(int dpi);
+
+    /**
+     * @brief Set the encoder quality.
+     * For PDF, a quality embeds pages as JPEG; without one they are
+     * compressed losslessly.
+     * @param quality 0 to 100, or -1 for lossless PDF pages and the encoder's default for images.
+     */
+    void setQuality(int quality);
+
+    /**
+     * @brief Set how many threads decode and encode.
+     * @param jobs Thread count, split between decoders and encoders; 0 or less means one per CPU.
+     */
+    void setJobs(int jobs);
+
+    /**
+     * @brief Set where the output goes.
+     * @param pattern PDF path, or an image path where "%1" stands for the page number as in PageExporter.
+     */
+    void setOutput(const QString& pattern);
+
+    /**
+     * @brief Convert pages of a document, blocking until all are written.
+     * Called from the main thread; document loading may run its event loop.
+     * @param inputPath Document path.
+     * @param pageRanges Pages as PageExporter::parsePageRanges() reads them; empty for all.
+     * @return Number of pages that failed, or -1 if nothing could be written.
+     */
+    int run(const QString& inputPath, const QString& pageRanges = QString());
+
+    /**
+     * @brief Stop a run after the pages in progress. A PDF being written is discarded.
+     * Safe to call from any thread.
+     */
+    void cancel();
+
+    /**
+     * @brief Get why the last run() returned -1.
+     * @return Error message; empty if it did not.
+     */
+    QString errorString() const;
+
+signals:
+    /**
+     * @brief Emitted as each page is written, from the main thread.
+     * @param pageIndex Page index from 0.
+     * @param bytes Encoded size of the page.
+     */
+    void pageConverted(int pageIndex, qint64 bytes);
+
+    /**
+     * @brief Emitted when a page could not be converted, from the main thread.
+     * A PDF gets a blank page in its place, so the page count is kept.
+     * @param pageIndex Page index from 0.
+     * @param error What went wrong.
+     */
+    void pageFailed(int pageIndex, const QString& error);
+
+    /**
+     * @brief Emitted after each page, from the main thread.
+     * @param pagesDone Pages written or failed.
+     * @param pageCount Pages being converted.
+     */
+    void progress(int pagesDone, int pageCount);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FORMATCONVERTER_H
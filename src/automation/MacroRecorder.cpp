@@ -8,6 +8,7 @@
  * (at your option) any later version.
  */
 #include "MacroRecorder.h"
+#include "../core/Document.h"
 #include "../core/Logger.h"
 #include <QList>
 #include <QVariantMap>
@@ -20,9 +21,24 @@
 #include <QFile>
 #include <QTextStream>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QPointer>
+#include <QSignalBlocker>
+#include <QTimer>
+#include <QVector>
+#include <limits>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Longest run of steps at maximum speed before the event loop gets a turn
+const int MaxSpeedSliceMs = 20;
+
+} // namespace
+
 class MacroRecorder::Private {
 public:
     Private(MacroRecorder* q_ptr)
@@ -38,6 +54,173 @@ public:
     QList<RecordedAction> actions;
     QDateTime recordingStartTime;
     QDateTime playbackStartTime;
+    QHash<QString, CommandCompiler> compilers;
+
+    // One step of a playback program
+    struct Step {
+        int delayMs = 0; // Recorded time since the previous step, before playback speed
+        RecordedAction action;
+        Command command; // Set in compiled mode
+    };
+
+    // Playback state; playback runs on the main thread only, so it is not under the mutex
+    PlaybackMode mode = PlaybackMode::Compiled;
+    bool maxSpeed = false;
+    bool paused = false;
+    QPointer<Document> target;
+    QVector<Step> program;
+    int nextStep = 0;
+    int lastProgress = -1;
+    QTimer* stepTimer = nullptr;
+    std::unique_ptr<QSignalBlocker> targetBlocker; // Holds the document's signals back in compiled mode
+    int startPageIndex = 0;
+    int startPageCount = 0;
+
+    // Turn the recorded actions into steps; commands too in compiled mode. Called with mutex held.
+    bool buildProgram(PlaybackMode buildMode, QVector<Step>& steps, QStringList* errors) const {
+        steps.clear();
+        qint64 carriedMs = 0; // Time of dropped actions, added to the next step's delay
+        for (int i = 0; i < actions.size(); ++i) {
+            const RecordedAction& action = actions.at(i);
+            if (i > 0) carriedMs += qMax<qint64>(0, actions.at(i - 1).timestamp.msecsTo(action.timestamp));
+
+            Step step;
+            step.action = action;
+            if (buildMode == PlaybackMode::Compiled) {
+                if (action.actionType.startsWith(QLatin1String("View."))) continue; // Nothing for the document to do
+                const auto compiler = compilers.constFind(action.actionType);
+                if (compiler == compilers.constEnd()) {
+                    if (errors) errors->append(QString("Action %1 (%2) has no compiled command").arg(i + 1).arg(action.actionType));
+                    continue;
+                }
+                QString error;
+                step.command = compiler.value()(action.parameters, &error);
+                if (!step.command) {
+                    if (errors) errors->append(QString("Action %1 (%2): %3").arg(i + 1).arg(action.actionType, error));
+                    continue;
+                }
+            }
+            step.delayMs = int(qMin<qint64>(carriedMs, std::numeric_limits<int>::max()));
+            carriedMs = 0;
+            steps.append(step);
+        }
+        return !errors || errors->isEmpty();
+    }
+
+    void registerBuiltInCommands() {
+        compilers.insert("Document.GoToPage", [](const QVariantMap& parameters, QString* error) -> Command {
+            bool ok = false;
+            const int pageIndex = parameters.value("pageIndex").toInt(&ok);
+            if (!ok || pageIndex < 0) {
+                *error = "Missing or invalid pageIndex";
+                return Command();
+            }
+            return [pageIndex](Document* document) {
+                if (pageIndex >= document->pageCount()) return false;
+                document->setCurrentPageIndex(pageIndex);
+                return true;
+            };
+        });
+        compilers.insert("Document.AddBookmark", [](const QVariantMap& parameters, QString* error) -> Command {
+            bool ok = false;
+            const QString name = parameters.value("name").toString();
+            const int pageIndex = parameters.value("pageIndex").toInt(&ok);
+            if (name.isEmpty() || !ok || pageIndex < 0) {
+                *error = "Missing name or pageIndex";
+                return Command();
+            }
+            return [name, pageIndex](Document* document) {
+                if (pageIndex >= document->pageCount()) return false;
+                document->addBookmark(name, pageIndex);
+                return true;
+            };
+        });
+        compilers.insert("Document.RemoveBookmark", [](const QVariantMap& parameters, QString* error) -> Command {
+            const QString name = parameters.value("name").toString();
+            if (name.isEmpty()) {
+                *error = "Missing name";
+                return Command();
+            }
+            return [name](Document* document) {
+                document->removeBookmark(name);
+                return true;
+            };
+        });
+        compilers.insert("File.Save", [](const QVariantMap& parameters, QString*) -> Command {
+            const QString filePath = parameters.value("filePath").toString(); // Empty saves in place
+            return [filePath](Document* document) { return document->save(filePath); };
+        });
+    }
+
+    int stepDelay(int index) const {
+        return int(program.at(index).delayMs / playbackSpeedMultiplier);
+    }
+
+    // Run steps until one has to wait for its time, the slice is used up, or playback ends
+    void runSteps() {
+        QElapsedTimer slice;
+        slice.start();
+        while (playingBack && !paused) {
+            const Step& step = program.at(nextStep);
+            if (mode == PlaybackMode::Stepwise) {
+                emit q->actionTriggered(step.action.actionType, step.action.parameters);
+            } else if (!target) {
+                fail("The playback document was closed");
+                return;
+            } else if (!step.command(target.data())) {
+                fail(QString("Step %1 (%2) failed").arg(nextStep + 1).arg(step.action.actionType));
+                return;
+            }
+            if (!playingBack) return; // Stopped by a slot of actionTriggered()
+
+            const int progress = (nextStep + 1) * 100 / program.size();
+            if (progress != lastProgress) {
+                lastProgress = progress;
+                emit q->playbackProgress(progress);
+            }
+            if (++nextStep == program.size()) {
+                if (!looping) {
+                    finish();
+                    return;
+                }
+                nextStep = 0;
+                lastProgress = -1;
+            }
+
+            if (!maxSpeed) {
+                stepTimer->start(stepDelay(nextStep));
+                return;
+            }
+            if (slice.elapsed() >= MaxSpeedSliceMs) {
+                stepTimer->start(0);
+                return;
+            }
+        }
+    }
+
+    void fail(const QString& error) {
+        LOG_ERROR("MacroRecorder: Playback failed: " << error);
+        finish();
+        emit q->playbackFailed(error);
+    }
+
+    // End playback and let views catch up on what the document did meanwhile
+    void finish() {
+        stepTimer->stop();
+        playingBack = false;
+        paused = false;
+        program.clear();
+        if (targetBlocker) {
+            targetBlocker.reset();
+            if (target) {
+                if (target->pageCount() != startPageCount) emit target->pageCountChanged();
+                if (target->currentPageIndex() != startPageIndex) emit target->currentPageChanged(target->currentPageIndex());
+                if (target->isModified()) emit target->modified();
+            }
+        }
+        LOG_INFO("MacroRecorder: Finished playback.");
+        emit q->playbackStopped();
+    }
 
     // Helper to convert RecordedAction to/from JSON
     QJsonObject actionToJson(const RecordedAction& action) const {
@@ -74,6 +257,10 @@ MacroRecorder::MacroRecorder(QObject* parent)
     : QObject(parent)
     , d(new Private(this))
 {
+    d->registerBuiltInCommands();
+    d->stepTimer = new QTimer(this);
+    d->stepTimer->setSingleShot(true);
+    connect(d->stepTimer, &QTimer::timeout, this, [this]() { d->runSteps(); });
     LOG_INFO("MacroRecorder created.");
 }
 
@@ -125,97 +312,78 @@ bool MacroRecorder::isRecording() const
 
 void MacroRecorder::playBack()
 {
-    QMutexLocker locker(&d->mutex);
     if (d->playingBack) {
         LOG_WARN("MacroRecorder: Playback already in progress.");
         return;
     }
 
-    if (d->actions.isEmpty()) {
-        LOG_WARN("MacroRecorder: No actions to play back.");
+    QStringList errors;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->actions.isEmpty()) {
+            LOG_WARN("MacroRecorder: No actions to play back.");
+            return;
+        }
+        d->buildProgram(d->mode, d->program, &errors);
+    }
+    if (d->mode == PlaybackMode::Compiled && !d->target) errors.prepend("No playback document set");
+    if (!errors.isEmpty() || d->program.isEmpty()) {
+        const QString error = errors.isEmpty() ? QString("Nothing in the macro changes the document") : errors.join("; ");
+        LOG_ERROR("MacroRecorder: Cannot play back macro: " << error);
+        d->program.clear();
+        emit playbackFailed(error);
         return;
     }
 
     d->playingBack = true;
+    d->paused = false;
+    d->nextStep = 0;
+    d->lastProgress = -1;
     d->playbackStartTime = QDateTime::currentDateTime();
-    LOG_INFO("MacroRecorder: Started playback of " << d->actions.size() << " actions.");
-    emit playbackStarted();
-
-    // This is where the actual playback logic happens.
-    // It needs to iterate through d->actions and execute them.
-    // This is complex as it requires mapping action types ("File.Open") back to actual application functions.
-    // A common approach is to have a central "Action Registry" where each action type is associated with a callable function.
-    // For this example, we'll use a simplified approach with a lookup table or signal emission.
-
-    // Example using signals (requires UI/mainwindow to connect and handle them):
-    int totalActions = d->actions.size();
-    int currentActionIndex = 0;
-    for (const auto& action : d->actions) {
-        if (!d->playingBack) break; // Check if playback was stopped during iteration
-
-        // Calculate delay based on timestamps and playback speed
-        if (currentActionIndex > 0) {
-            qint64 prevTimestampMs = d->actions[currentActionIndex - 1].timestamp.toMSecsSinceEpoch();
-            qint64 currentTimestampMs = action.timestamp.toMSecsSinceEpoch();
-            qint64 deltaTimeMs = currentTimestampMs - prevTimestampMs;
-            int delayMs = static_cast<int>(deltaTimeMs / d->playbackSpeedMultiplier);
-            if (delayMs > 0) {
-                QThread::msleep(delayMs); // Sleep for the calculated delay (blocks thread!)
-            }
-        }
-
-        // Emit signal for the action
-        emit actionTriggered(action.actionType, action.parameters);
-
-        // Emit progress
-        int progress = (currentActionIndex + 1) * 100 / totalActions;
-        emit playbackProgress(progress);
-
-        currentActionIndex++;
+    if (d->mode == PlaybackMode::Compiled) {
+        d->startPageIndex = d->target->currentPageIndex();
+        d->startPageCount = d->target->pageCount();
+        d->targetBlocker.reset(new QSignalBlocker(d->target.data()));
     }
+    LOG_INFO("MacroRecorder: Started " << (d->mode == PlaybackMode::Compiled ? "compiled" : "step-wise")
+             << " playback of " << d->program.size() << " actions" << (d->maxSpeed ? " at maximum speed." : "."));
+    emit playbackStarted();
 
-    // Playback finished (or was stopped)
-    d->playingBack = false;
-    LOG_INFO("MacroRecorder: Finished playback.");
-    emit playbackStopped();
+    // The first step runs from the event loop too, so playbackStarted() handlers see the whole run
+    d->stepTimer->start(d->maxSpeed ? 0 : d->stepDelay(0));
 }
 
 void MacroRecorder::pausePlayback()
 {
-    QMutexLocker locker(&d->mutex);
-    if (d->playingBack) {
-        // Pausing is complex with a simple loop. Requires more sophisticated scheduling.
-        // For now, just log.
-        LOG_WARN("MacroRecorder::pausePlayback: Not implemented with current playback mechanism.");
-        // d->playingBack = false; // Would effectively stop it
-        // emit playbackPaused();
-    }
+    if (!d->playingBack || d->paused) return;
+    d->paused = true;
+    d->stepTimer->stop();
+    LOG_DEBUG("MacroRecorder: Playback paused at step " << d->nextStep + 1);
+    emit playbackPaused();
 }
 
 void MacroRecorder::resumePlayback()
 {
-    QMutexLocker locker(&d->mutex);
-    if (!d->playingBack) {
+    if (!d->playingBack || !d->paused) {
         LOG_WARN("MacroRecorder::resumePlayback: Not paused.");
-        // This would require storing the state at which it was paused.
-        LOG_WARN("MacroRecorder::resumePlayback: Not implemented with current playback mechanism.");
+        return;
     }
+    d->paused = false;
+    d->stepTimer->start(0);
+    LOG_DEBUG("MacroRecorder: Playback resumed.");
+    emit playbackResumed();
 }
 
 void MacroRecorder::stopPlayback()
 {
-    QMutexLocker locker(&d->mutex);
     if (d->playingBack) {
-        d->playingBack = false;
         LOG_INFO("MacroRecorder: Playback stopped by user.");
-        // The loop in playBack() will check d->playingBack and exit.
-        // emit playbackStopped(); // This is emitted at the end of playBack()
+        d->finish();
     }
 }
 
 bool MacroRecorder::isPlayingBack() const
 {
-    QMutexLocker locker(&d->mutex);
     return d->playingBack;
 }
 
@@ -342,6 +510,53 @@ double MacroRecorder::playbackSpeed() const
     return d->playbackSpeedMultiplier;
 }
 
+void MacroRecorder::setPlaybackMode(PlaybackMode mode)
+{
+    d->mode = mode;
+}
+
+MacroRecorder::PlaybackMode MacroRecorder::playbackMode() const
+{
+    return d->mode;
+}
+
+void MacroRecorder::setMaxSpeed(bool enabled)
+{
+    d->maxSpeed = enabled;
+}
+
+bool MacroRecorder::isMaxSpeed() const
+{
+    return d->maxSpeed;
+}
+
+void MacroRecorder::setPlaybackDocument(Document* document)
+{
+    d->target = document;
+}
+
+Document* MacroRecorder::playbackDocument() const
+{
+    return d->target.data();
+}
+
+void MacroRecorder::registerCommand(const QString& actionType, const CommandCompiler& compiler)
+{
+    QMutexLocker locker(&d->mutex);
+    d->compilers.insert(actionType, compiler);
+    LOG_DEBUG("MacroRecorder: Registered command for '" << actionType << "'");
+}
+
+bool MacroRecorder::compile(QStringList* errors) const
+{
+    QMutexLocker locker(&d->mutex);
+    QVector<Private::Step> steps;
+    QStringList messages;
+    d->buildProgram(PlaybackMode::Compiled, steps, &messages);
+    if (errors) *errors = messages;
+    return messages.isEmpty();
+}
+
 bool MacroRecorder::isLooping() const
 {
     QMutexLocker locker(&d->mutex);
@@ -15,10 +15,13 @@
 #include <QVariant>
 #include <QDateTime>
 #include <QMutex>
+#include <functional>
 #include <memory>
 
 namespace QuantilyxDoc {
 
+class Document;
+
 /**
  * @brief Represents a single action/event recorded by the macro recorder.
  */
@@ -34,12 +37,41 @@ struct RecordedAction {
  * 
  * Captures user interactions like menu clicks, toolbar button presses, keyboard shortcuts,
  * and document modifications, allowing them to be replayed later.
+ *
+ * Playback compiles the macro first: each action becomes a command bound
+ * to its parameters that runs straight against the playback document, and
+ * the document's signals are held back until the end, so views repaint
+ * once instead of after every step. View-only actions (View.*) have no
+ * effect on the document and are dropped. Step-wise playback, which
+ * replays each action through actionTriggered() for the UI to dispatch,
+ * is kept for debugging macros.
+ *
+ * Playback runs from the event loop, so it can be paused and stopped.
  */
 class MacroRecorder : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief How recorded actions are replayed.
+     */
+    enum class PlaybackMode {
+        Compiled,   // Commands run directly on the playback document
+        Stepwise    // Each action goes through actionTriggered() and the UI
+    };
+
+    /**
+     * @brief A compiled action; returns false if it failed.
+     */
+    using Command = std::function<bool(Document* document)>;
+
+    /**
+     * @brief Turns the parameters of one action type into a command.
+     * Returns an empty command, with the reason in error, if they are invalid.
+     */
+    using CommandCompiler = std::function<Command(const QVariantMap& parameters, QString* error)>;
+
     /**
      * @brief Constructor.
      * @param parent Parent object.
@@ -155,6 +187,57 @@ public:
      */
     double playbackSpeed() const;
 
+    /**
+     * @brief Set how recorded actions are replayed.
+     * @param mode Playback mode; Compiled by default.
+     */
+    void setPlaybackMode(PlaybackMode mode);
+
+    /**
+     * @brief Get how recorded actions are replayed.
+     * @return Playback mode.
+     */
+    PlaybackMode playbackMode() const;
+
+    /**
+     * @brief Ignore the recorded timing and replay as fast as possible.
+     * @param enabled Whether to run at maximum speed.
+     */
+    void setMaxSpeed(bool enabled);
+
+    /**
+     * @brief Check if playback ignores the recorded timing.
+     * @return True at maximum speed.
+     */
+    bool isMaxSpeed() const;
+
+    /**
+     * @brief Set the document compiled playback runs against.
+     * @param document Target document.
+     */
+    void setPlaybackDocument(Document* document);
+
+    /**
+     * @brief Get the document compiled playback runs against.
+     * @return Target document, or null.
+     */
+    Document* playbackDocument() const;
+
+    /**
+     * @brief Make an action type playable in compiled mode.
+     * Replaces any compiler registered for the type before.
+     * @param actionType Action type (e.g., "Document.GoToPage").
+     * @param compiler Builds the command for one recorded action.
+     */
+    void registerCommand(const QString& actionType, const CommandCompiler& compiler);
+
+    /**
+     * @brief Check that every recorded action can be compiled.
+     * @param errors Receives one message per action that cannot, if not null.
+     * @return True if the macro compiles.
+     */
+    bool compile(QStringList* errors = nullptr) const;
+
     /**
      * @brief Check if the macro should loop when playback reaches the end.
      * @return True if looping is enabled.
@@ -233,12 +316,27 @@ signals:
      */
     void playbackProgress(int progress);
 
+    /**
+     * @brief Emitted in step-wise playback for the UI to perform an action.
+     * @param actionType The action type.
+     * @param parameters The recorded parameters.
+     */
+    void actionTriggered(const QString& actionType, const QVariantMap& parameters);
+
+    /**
+     * @brief Emitted when playback cannot start or a step fails; playback stops.
+     * @param error Error message.
+     */
+    void playbackFailed(const QString& error);
+
 private:
     class Private;
     std::unique_ptr<Private> d;
 
     // Helper to register actions from the application's event system
     void registerAction(const QString& type, const QVariantMap& params);
+
+    static MacroRecorder* s_instance;
 };
 
 } // namespace QuantilyxDoc
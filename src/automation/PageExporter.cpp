@@ -0,0 +1,309 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "PageExporter.h"
+#include "../core/Document.h"
+#include "../core/DocumentFactory.h"
+#include "../core/Logger.h"
+#include "../core/Page.h"
+#include "../core/ThreadPool.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const double InchesPerMeter = 39.3700787;
+
+QByteArray writerFormat(const QString& format)
+{
+    const QString lower = format.toLower();
+    if (lower == QLatin1String("jpg")) return QByteArrayLiteral("jpeg");
+    return lower.toLatin1();
+}
+
+} // namespace
+
+class PageExporter::Private {
+public:
+    Private(PageExporter* q) : q(q) {}
+
+    PageExporter* q;
+    QByteArray format = QByteArrayLiteral("png");
+    int dpi = 150;
+    int quality = -1;
+    int jobs = 0;
+    QString outputPattern = QStringLiteral("-");
+    QString error;
+
+    // Standard output takes the images in page order, whichever finishes first
+    QMutex streamMutex;
+    QFile stream;
+    QMap<int, QByteArray> pendingImages; // Encoded images waiting for the ones before them, by position
+    int nextPosition = 0;
+
+    bool toStream() const { return outputPattern == QLatin1String("-"); }
+
+    QString outputPath(int pageIndex, int pageCount) const {
+        const int width = QString::number(pageCount).size();
+        return outputPattern.contains(QLatin1String("%1"))
+                   ? outputPattern.arg(pageIndex + 1, width, 10, QLatin1Char('0'))
+                   : outputPattern;
+    }
+
+    QImage render(Page* page) const {
+        const QSizeF size = page->size() * dpi / 72.0;
+        QImage image = page->render(qMax(1, qRound(size.width())), qMax(1, qRound(size.height())), dpi);
+        if (image.isNull()) return image;
+        if (format == "jpeg" && image.hasAlphaChannel()) {
+            // JPEG has no alpha; flatten on paper white rather than black
+            QImage flat(image.size(), QImage::Format_RGB32);
+            flat.fill(Qt::white);
+            QPainter painter(&flat);
+            painter.drawImage(0, 0, image);
+            painter.end();
+            image = flat;
+        }
+        const int dotsPerMeter = qRound(dpi * InchesPerMeter);
+        image.setDotsPerMeterX(dotsPerMeter);
+        image.setDotsPerMeterY(dotsPerMeter);
+        return image;
+    }
+
+    bool encode(const QImage& image, QIODevice* device, QString* message) const {
+        QImageWriter writer(device, format);
+        if (quality >= 0) writer.setQuality(quality);
+        if (writer.write(image)) return true;
+        *message = writer.errorString();
+        return false;
+    }
+
+    // Writes the image at a position once all before it are out
+    bool streamImage(int position, QByteArray encoded, QString* message) {
+        QMutexLocker locker(&streamMutex);
+        pendingImages.insert(position, std::move(encoded));
+        while (!pendingImages.isEmpty() && pendingImages.firstKey() == nextPosition) {
+            const QByteArray data = pendingImages.take(nextPosition);
+            ++nextPosition;
+            if (stream.write(data) != data.size() || !stream.flush()) {
+                *message = stream.errorString();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A page that failed still takes its turn, so the pages after it are not held back
+    void skipStreamPosition(int position) {
+        QString ignored;
+        streamImage(position, QByteArray(), &ignored);
+    }
+
+    bool exportPage(Page* page, int position, int pageCount, QString* message) {
+        const QImage image = page ? render(page) : QImage();
+        if (image.isNull()) {
+            *message = QStringLiteral("Rendering failed");
+            return false;
+        }
+        if (toStream()) {
+            QByteArray encoded;
+            QBuffer buffer(&encoded);
+            buffer.open(QIODevice::WriteOnly);
+            if (!encode(image, &buffer, message)) return false;
+            return streamImage(position, encoded, message);
+        }
+        QSaveFile file(outputPath(page->pageIndex(), pageCount));
+        if (!file.open(QIODevice::WriteOnly)) {
+            *message = file.errorString();
+            return false;
+        }
+        if (!encode(image, &file, message)) return false;
+        if (!file.commit()) {
+            *message = file.errorString();
+            return false;
+        }
+        return true;
+    }
+};
+
+PageExporter::PageExporter(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+PageExporter::~PageExporter() = default;
+
+bool PageExporter::setFormat(const QString& format)
+{
+    const QByteArray name = writerFormat(format);
+    if (!QImageWriter::supportedImageFormats().contains(name)) return false;
+    d->format = name;
+    return true;
+}
+
+QString PageExporter::format() const
+{
+    return QString::fromLatin1(d->format);
+}
+
+void PageExporter::setDpi(int dpi)
+{
+    d->dpi = qBound(1, dpi, 2400);
+}
+
+void PageExporter::setQuality(int quality)
+{
+    d->quality = qBound(-1, quality, 100);
+}
+
+void PageExporter::setJobs(int jobs)
+{
+    d->jobs = jobs;
+}
+
+void PageExporter::setOutput(const QString& pattern)
+{
+    d->outputPattern = pattern.isEmpty() ? QStringLiteral("-") : pattern;
+}
+
+QString PageExporter::errorString() const
+{
+    return d->error;
+}
+
+int PageExporter::run(const QString& inputPath, const QString& pageRanges)
+{
+    d->error.clear();
+    QString error;
+    std::unique_ptr<Document> document(DocumentFactory::instance().loadDocumentAndWait(inputPath, QString(), &error));
+    if (!document) {
+        d->error = error.isEmpty() ? QStringLiteral("Cannot open %1").arg(inputPath) : error;
+        return -1;
+    }
+
+    const int pageCount = document->pageCount();
+    const QVector<int> pages = selectPages(pageRanges, pageCount, d->outputPattern, d->toStream(), &d->error);
+    if (pages.isEmpty()) return -1;
+    if (d->toStream() && !d->stream.isOpen() && !d->stream.open(stdout, QIODevice::WriteOnly)) {
+        d->error = QStringLiteral("Cannot write to standard output: ") + d->stream.errorString();
+        return -1;
+    }
+    d->pendingImages.clear();
+    d->nextPosition = 0;
+
+    const int jobs = qMin(pages.size(), d->jobs > 0 ? d->jobs : QThread::idealThreadCount());
+    LOG_INFO("PageExporter: Rendering " << pages.size() << " pages of " << inputPath << " at " << d->dpi
+             << " dpi as " << d->format << " with " << jobs << " jobs");
+
+    // The pages are handed out from one counter to `jobs` workers, so at
+    // most that many pages are in memory; the main thread reports progress
+    std::atomic<int> next{0};
+    std::atomic<int> failed{0};
+    QEventLoop loop;
+    Document* source = document.get();
+    ThreadPool::instance().submitDetached([this, &next, &failed, &loop, pages, jobs, pageCount, source]() {
+        ThreadPool::instance().forEach(jobs, [&](int) {
+            for (int position = next++; position < pages.size(); position = next++) {
+                const int pageIndex = pages.at(position);
+                QElapsedTimer timer;
+                timer.start();
+                QString message;
+                if (d->exportPage(source->page(pageIndex), position, pageCount, &message)) {
+                    const QString path = d->toStream() ? QStringLiteral("-") : d->outputPath(pageIndex, pageCount);
+                    const qint64 elapsed = timer.elapsed();
+                    QMetaObject::invokeMethod(this, [this, pageIndex, path, elapsed]() {
+                        emit pageExported(pageIndex, path, elapsed);
+                    }, Qt::QueuedConnection);
+                } else {
+                    if (d->toStream()) d->skipStreamPosition(position);
+                    ++failed;
+                    QMetaObject::invokeMethod(this, [this, pageIndex, message]() {
+                        emit pageFailed(pageIndex, message);
+                    }, Qt::QueuedConnection);
+                }
+            }
+        });
+        QMetaObject::invokeMethod(&loop, "quit", Qt::QueuedConnection);
+    });
+    loop.exec();
+    QCoreApplication::sendPostedEvents(this); // Progress of the last pages
+
+    LOG_INFO("PageExporter: " << (pages.size() - failed) << " of " << pages.size() << " pages written");
+    return failed;
+}
+
+QVector<int> PageExporter::selectPages(const QString& pageRanges, int pageCount, const QString& outputPattern,
+                                       bool oneOutput, QString* error)
+{
+    QString rangeError;
+    const QVector<int> pages = parsePageRanges(pageRanges, pageCount, &rangeError);
+    QString problem;
+    if (!rangeError.isEmpty() || pages.isEmpty()) {
+        problem = rangeError.isEmpty() ? QStringLiteral("The document has no pages") : rangeError;
+    } else if (!oneOutput && pages.size() > 1 && !outputPattern.contains(QLatin1String("%1"))) {
+        problem = QStringLiteral("Several pages need %1 in the output pattern for the page number");
+    }
+    if (error) *error = problem;
+    return problem.isEmpty() ? pages : QVector<int>();
+}
+
+QVector<int> PageExporter::parsePageRanges(const QString& text, int pageCount, QString* error)
+{
+    QVector<int> pages;
+    QSet<int> seen;
+    auto add = [&pages, &seen](int index) {
+        if (!seen.contains(index)) {
+            seen.insert(index);
+            pages.append(index);
+        }
+    };
+    if (error) error->clear();
+    if (text.trimmed().isEmpty()) {
+        for (int i = 0; i < pageCount; ++i) add(i);
+        return pages;
+    }
+
+    for (const QString& part : text.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        const QString range = part.trimmed();
+        const int dash = range.indexOf(QLatin1Char('-'));
+        bool firstOk = true;
+        bool lastOk = true;
+        int first = dash == 0 ? 1 : range.left(dash < 0 ? range.size() : dash).toInt(&firstOk);
+        int last = dash < 0 ? first : (dash == range.size() - 1 ? pageCount : range.mid(dash + 1).toInt(&lastOk));
+        if (!firstOk || !lastOk || first < 1 || last < first) {
+            if (error) *error = QStringLiteral("Invalid page range \"%1\"").arg(range);
+            return QVector<int>();
+        }
+        if (first > pageCount) {
+            if (error) *error = QStringLiteral("Page %1 is past the last page, %2").arg(first).arg(pageCount);
+            return QVector<int>();
+        }
+        for (int page = first; page <= qMin(last, pageCount); ++page) add(page - 1);
+    }
+    return pages;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,148 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_PAGEEXPORTER_H
+#define QUANTILYX_PAGEEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Renders pages of a document to image files without a user interface.
+ *
+ * Pages of any supported format are rendered at a resolution and encoded
+ * as PNG, JPEG or WebP (the last where Qt's image formats plugin is
+ * installed). Pages are rendered and encoded in parallel on the CPU pool, and
+ * each file is written as soon as its page is done. On standard output
+ * the images follow one another in page order; each format marks its own
+ * end, so a reader can split them.
+ */
+class PageExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit PageExporter(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~PageExporter() override;
+
+    /**
+     * @brief Set the image format.
+     * @param format "png", "jpg"/"jpeg" or "webp".
+     * @return False if Qt cannot write the format here.
+     */
+    bool setFormat(const QString& format);
+
+    /**
+     * @brief Get the image format.
+     * @return Format name, "png" by default.
+     */
+    QString format() const;
+
+    /**
+     * @brief Set the resolution pages are rendered at.
+     * @param dpi Dots per inch (default 150).
+     */
+    void setDpi(int dpi);
+
+    /**
+     * @brief Set the encoder quality of lossy formats.
+     * @param quality 0 to 100, or -1 for the encoder's default.
+     */
+    void setQuality(int quality);
+
+    /**
+     * @brief Set how many pages are rendered at once.
+     * @param jobs Page count; 0 or less means one per CPU.
+     */
+    void setJobs(int jobs);
+
+    /**
+     * @brief Set where the images go.
+     * "%1" in the pattern is replaced by the page number, counted from 1
+     * and padded to the width of the last one, so "page-%1.png" gives
+     * page-01.png to page-12.png. "-" writes every image to standard output.
+     * @param pattern Output path pattern, or "-".
+     */
+    void setOutput(const QString& pattern);
+
+    /**
+     * @brief Render pages of a document, blocking until all are written.
+     * Called from the main thread; document loading may run its event loop.
+     * @param inputPath Document path.
+     * @param pageRanges Pages as parsePageRanges() reads them; empty for all.
+     * @return Number of pages that failed, or -1 if nothing could be rendered.
+     */
+    int run(const QString& inputPath, const QString& pageRanges);
+
+    /**
+     * @brief Get why the last run() returned -1.
+     * @return Error message; empty if it did not.
+     */
+    QString errorString() const;
+
+    /**
+     * @brief Read a page range list such as "1-3,7,10-".
+     * Pages are counted from 1; an open range runs to the last page.
+     * @param text Comma separated pages and ranges.
+     * @param pageCount Pages in the document.
+     * @param error Set to what is wrong, if anything.
+     * @return Page indices from 0, in the order given, each once.
+     */
+    static QVector<int> parsePageRanges(const QString& text, int pageCount, QString* error = nullptr);
+
+    /**
+     * @brief Pick the pages a headless run writes, as parsePageRanges() reads
+     * them, and check that the output can take them.
+     * @param pageRanges Pages and ranges; empty for all.
+     * @param pageCount Pages in the document.
+     * @param outputPattern Output path; several pages need %1 in it unless
+     * they all go to one output.
+     * @param oneOutput True if every page goes to the same output.
+     * @param error Set to what is wrong, if anything.
+     * @return Page indices from 0; empty on error.
+     */
+    static QVector<int> selectPages(const QString& pageRanges, int pageCount, const QString& outputPattern,
+                                    bool oneOutput, QString* error);
+
+signals:
+    /**
+     * @brief Emitted as each page is written, from the main thread.
+     * @param pageIndex Page index from 0.
+     * @param outputPath File written, or "-" for standard output.
+     * @param elapsedMs Time to render and encode it.
+     */
+    void pageExported(int pageIndex, const QString& outputPath, qint64 elapsedMs);
+
+    /**
+     * @brief Emitted when a page could not be rendered or written, from the main thread.
+     * @param pageIndex Page index from 0.
+     * @param error What went wrong.
+     */
+    void pageFailed(int pageIndex, const QString& error);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_PAGEEXPORTER_H
@@ -0,0 +1,174 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ScriptBuffer.h"
+#include "../core/Document.h"
+#include "../core/Logger.h"
+#include "../core/Page.h"
+#include "../core/PageCache.h"
+#include "../ocr/OcrEngine.h"
+
+namespace QuantilyxDoc {
+
+struct ScriptBuffer::Storage {
+    // Exactly one of these holds the memory. Both are implicitly shared
+    // and only ever read through const access, so neither detaches.
+    QImage image;
+    QByteArray bytes;
+
+    ElementType type = ElementType::UInt8;
+    QVector<qint64> shape;
+    QVector<qint64> strides;
+
+    const uchar* data() const {
+        return image.isNull() ? reinterpret_cast<const uchar*>(bytes.constData()) : image.constBits();
+    }
+};
+
+ScriptBuffer::ScriptBuffer() = default;
+
+ScriptBuffer ScriptBuffer::fromImage(const QImage& image)
+{
+    ScriptBuffer buffer;
+    if (image.isNull()) return buffer;
+
+    int channels = 4;
+    QImage shared = image;
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        break;
+    case QImage::Format_RGB888:
+        channels = 3;
+        break;
+    case QImage::Format_Grayscale8:
+        channels = 1;
+        break;
+    default:
+        // Packed and indexed formats have no per-channel layout to describe
+        shared = image.convertToFormat(QImage::Format_ARGB32);
+        break;
+    }
+
+    auto storage = std::make_shared<Storage>();
+    storage->image = shared;
+    storage->shape = {shared.height(), shared.width(), channels};
+    storage->strides = {shared.bytesPerLine(), channels, 1};
+    buffer.d = storage;
+    return buffer;
+}
+
+ScriptBuffer ScriptBuffer::fromOcrBoxes(const OcrResult& result)
+{
+    const int count = result.boundingBoxes.size();
+    const int columns = 5;
+    QByteArray bytes(count * columns * int(sizeof(float)), Qt::Uninitialized);
+    float* row = reinterpret_cast<float*>(bytes.data());
+    for (int i = 0; i < count; ++i, row += columns) {
+        const QRectF& box = result.boundingBoxes.at(i);
+        row[0] = float(box.x());
+        row[1] = float(box.y());
+        row[2] = float(box.width());
+        row[3] = float(box.height());
+        row[4] = i < result.elementConfidences.size() ? result.elementConfidences.at(i) : result.confidence;
+    }
+
+    auto storage = std::make_shared<Storage>();
+    storage->bytes = bytes;
+    storage->type = ElementType::Float32;
+    storage->shape = {count, columns};
+    storage->strides = {qint64(columns * sizeof(float)), qint64(sizeof(float))};
+    ScriptBuffer buffer;
+    buffer.d = storage;
+    return buffer;
+}
+
+ScriptBuffer ScriptBuffer::renderedPage(Document* document, int pageIndex, qreal zoom)
+{
+    if (!document || pageIndex < 0 || pageIndex >= document->pageCount() || zoom <= 0) return ScriptBuffer();
+    Page* page = document->page(pageIndex);
+    if (!page) return ScriptBuffer();
+
+    // Same key the views use for an unrotated whole page at this zoom
+    PageCache::CacheKey key;
+    key.documentId = reinterpret_cast<quintptr>(document);
+    key.pageIndex = pageIndex;
+    key.zoomLevel = zoom;
+    key.rotation = 0;
+    key.targetSize = (page->size() * zoom).toSize();
+    if (key.targetSize.isEmpty()) return ScriptBuffer();
+
+    QImage image = PageCache::instance().get(key);
+    if (image.isNull()) {
+        image = page->render(key.targetSize.width(), key.targetSize.height());
+        if (image.isNull()) {
+            LOG_WARN("ScriptBuffer: Cannot render page " << pageIndex << " of " << document->filePath());
+            return ScriptBuffer();
+        }
+        PageCache::instance().put(key, image);
+    }
+    return fromImage(image);
+}
+
+bool ScriptBuffer::isNull() const
+{
+    return !d;
+}
+
+const uchar* ScriptBuffer::data() const
+{
+    return d ? d->data() : nullptr;
+}
+
+qint64 ScriptBuffer::sizeBytes() const
+{
+    if (!d) return 0;
+    return d->image.isNull() ? d->bytes.size() : d->image.sizeInBytes();
+}
+
+ScriptBuffer::ElementType ScriptBuffer::elementType() const
+{
+    return d ? d->type : ElementType::UInt8;
+}
+
+int ScriptBuffer::itemSize() const
+{
+    return elementType() == ElementType::Float32 ? int(sizeof(float)) : 1;
+}
+
+QByteArray ScriptBuffer::formatCode() const
+{
+    return elementType() == ElementType::Float32 ? QByteArrayLiteral("f") : QByteArrayLiteral("B");
+}
+
+QVector<qint64> ScriptBuffer::shape() const
+{
+    return d ? d->shape : QVector<qint64>();
+}
+
+QVector<qint64> ScriptBuffer::strides() const
+{
+    return d ? d->strides : QVector<qint64>();
+}
+
+QImage::Format ScriptBuffer::imageFormat() const
+{
+    return d ? d->image.format() : QImage::Format_Invalid;
+}
+
+QImage ScriptBuffer::image() const
+{
+    return d ? d->image : QImage();
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,148 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_SCRIPTBUFFER_H
+#define QUANTILYX_SCRIPTBUFFER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMetaType>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document;
+struct OcrResult;
+
+/**
+ * @brief Read-only block of memory handed to scripts without copying it.
+ *
+ * Describes its memory the way the Python buffer protocol and typed
+ * arrays over a JavaScript ArrayBuffer want it: a format code, a shape
+ * and strides. A buffer made from an image points at the image's own
+ * pixels (for a page, the PageCache entry's), and the handle keeps them
+ * alive; copies of a ScriptBuffer share them. Bindings hold a copy for
+ * as long as the script's view of the memory exists.
+ */
+class ScriptBuffer
+{
+public:
+    /**
+     * @brief Type of each element.
+     */
+    enum class ElementType {
+        UInt8,
+        Float32
+    };
+
+    /**
+     * @brief Constructor for a null buffer.
+     */
+    ScriptBuffer();
+
+    /**
+     * @brief Share an image's pixels.
+     * 32-bit images are height x width x 4 bytes in memory order (B, G, R, A
+     * on little-endian machines), Grayscale8 height x width x 1 and RGB888
+     * height x width x 3; other formats are converted to ARGB32 first.
+     * @param image Image to share.
+     * @return Buffer over the pixels, null for a null image.
+     */
+    static ScriptBuffer fromImage(const QImage& image);
+
+    /**
+     * @brief Pack OCR boxes as an N x 5 float array: x, y, width, height, confidence.
+     * @param result OCR result; a box without its own confidence gets the result's.
+     * @return Buffer of the boxes.
+     */
+    static ScriptBuffer fromOcrBoxes(const OcrResult& result);
+
+    /**
+     * @brief Get a page rendered at a zoom level, from PageCache if it has it.
+     * A page not cached is rendered and put in the cache, so the next
+     * script or view asking for it shares the same pixels.
+     * @param document The document.
+     * @param pageIndex Page index.
+     * @param zoom Zoom level; 1.0 is 72 pixels per inch.
+     * @return Image buffer, null if the page cannot be rendered.
+     */
+    static ScriptBuffer renderedPage(Document* document, int pageIndex, qreal zoom = 1.0);
+
+    /**
+     * @brief Check if this holds no memory.
+     * @return True for a null buffer.
+     */
+    bool isNull() const;
+
+    /**
+     * @brief Get the memory.
+     * @return First byte; valid while any copy of this buffer exists.
+     */
+    const uchar* data() const;
+
+    /**
+     * @brief Get the size of the memory, padding included.
+     * @return Size in bytes.
+     */
+    qint64 sizeBytes() const;
+
+    /**
+     * @brief Get the type of each element.
+     * @return Element type.
+     */
+    ElementType elementType() const;
+
+    /**
+     * @brief Get the size of one element.
+     * @return Size in bytes.
+     */
+    int itemSize() const;
+
+    /**
+     * @brief Get the element type as a Python struct format code.
+     * @return "B" or "f".
+     */
+    QByteArray formatCode() const;
+
+    /**
+     * @brief Get the length of each dimension, outermost first.
+     * @return Shape.
+     */
+    QVector<qint64> shape() const;
+
+    /**
+     * @brief Get the bytes between neighbours in each dimension.
+     * Image rows may be padded, so they are not always width x channels apart.
+     * @return Strides, one per dimension.
+     */
+    QVector<qint64> strides() const;
+
+    /**
+     * @brief Get the pixel format of an image buffer.
+     * @return Image format, Format_Invalid for other buffers.
+     */
+    QImage::Format imageFormat() const;
+
+    /**
+     * @brief Get the image an image buffer shares.
+     * @return The image, sharing the same pixels; null for other buffers.
+     */
+    QImage image() const;
+
+private:
+    struct Storage;
+    std::shared_ptr<const Storage> d;
+};
+
+} // namespace QuantilyxDoc
+
+Q_DECLARE_METATYPE(QuantilyxDoc::ScriptBuffer)
+
+#endif // QUANTILYX_SCRIPTBUFFER_H
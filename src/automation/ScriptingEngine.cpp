@@ -8,7 +8,10 @@
  * (at your option) any later version.
  */
 #include "ScriptingEngine.h"
+#include "ScriptBuffer.h"
+#include "../core/Document.h"
 #include "../core/Logger.h"
+#include "../ocr/OcrEngine.h"
 #include <QList>
 #include <QVariant>
 #include <QMutex>
@@ -67,6 +70,52 @@ public:
         }
         return file.readAll();
     }
+
+    // The document a script is running on. Callables run inside a script
+    // execution, which already holds the mutex, so they read it unlocked.
+    Document* scriptDocument() const {
+        return qobject_cast<Document*>(objectRegistry.value("document"));
+    }
+
+    // Built-in callables handing page pixels and OCR boxes to scripts as
+    // read-only ScriptBuffers over the PageCache entry, not as copies
+    void registerBufferCallables() {
+        // pageImage(pageIndex, zoom = 1.0) -> height x width x channels bytes
+        callableRegistry.insert("pageImage", [this](const QVariantList& args) -> QVariant {
+            if (args.isEmpty()) return QVariant();
+            const qreal zoom = args.size() > 1 ? args.at(1).toReal() : 1.0;
+            const ScriptBuffer buffer = ScriptBuffer::renderedPage(scriptDocument(), args.at(0).toInt(), zoom);
+            return buffer.isNull() ? QVariant() : QVariant::fromValue(buffer);
+        });
+        // ocrBoxes(pageIndex, zoom = 1.0) -> {"boxes": N x 5 floats in pixels of pageImage at that zoom, "texts": [...]}
+        callableRegistry.insert("ocrBoxes", [this](const QVariantList& args) -> QVariant {
+            if (args.isEmpty() || !OcrEngine::instance().isReady()) return QVariant();
+            const qreal zoom = args.size() > 1 ? args.at(1).toReal() : 1.0;
+            const ScriptBuffer page = ScriptBuffer::renderedPage(scriptDocument(), args.at(0).toInt(), zoom);
+            if (page.isNull()) return QVariant();
+            const OcrResult result = OcrEngine::instance().recognizeDetailed(page.image());
+            QVariantMap boxes;
+            boxes.insert("boxes", QVariant::fromValue(ScriptBuffer::fromOcrBoxes(result)));
+            boxes.insert("texts", result.elementTexts);
+            return boxes;
+        });
+
+        // Each interpreter exposes a ScriptBuffer through its own zero-copy
+        // protocol, keeping a copy of the handle alive as the owner.
+        // Example for Python with pybind11:
+        // py::class_<ScriptBuffer>(module, "ScriptBuffer", py::buffer_protocol())
+        //     .def_buffer([](ScriptBuffer& b) {
+        //         const QVector<qint64> shape = b.shape(), strides = b.strides();
+        //         return py::buffer_info(const_cast<uchar*>(b.data()), b.itemSize(), b.formatCode().toStdString(),
+        //                                shape.size(), std::vector<py::ssize_t>(shape.begin(), shape.end()),
+        //                                std::vector<py::ssize_t>(strides.begin(), strides.end()), true); // readonly
+        //     });
+        // Example for V8:
+        // auto* owner = new ScriptBuffer(buffer);
+        // auto store = v8::ArrayBuffer::NewBackingStore(const_cast<uchar*>(owner->data()), owner->sizeBytes(),
+        //     [](void*, size_t, void* owner) { delete static_cast<ScriptBuffer*>(owner); }, owner);
+        // v8::Local<v8::ArrayBuffer> array = v8::ArrayBuffer::New(isolate, std::move(store));
+    }
 };
 
 // Static instance pointer
@@ -84,6 +133,8 @@ ScriptingEngine::ScriptingEngine(QObject* parent)
     : QObject(parent)
     , d(new Private(this))
 {
+    qRegisterMetaType<ScriptBuffer>();
+    d->registerBufferCallables();
     LOG_INFO("ScriptingEngine created.");
 }
 
@@ -166,34 +217,32 @@ bool ScriptingEngine::executeScript(const QString& scriptCode, const QString& sc
     return true; // Placeholder success
 }
 
-bool ScriptingEngine::executeScriptFile(const QString& filePath)
+bool ScriptingEngine::executeScriptFile(const QString& filePath, Document* document)
 {
     if (!isReady()) {
         LOG_ERROR("ScriptingEngine::executeScriptFile: Engine is not ready.");
         return false;
     }
 
-    QMutexLocker locker(&d->mutex);
+    QFileInfo fileInfo(filePath);
+    QString scriptId = fileInfo.absoluteFilePath(); // Use full path as ID
 
-    QString content = d->readScriptFile(filePath);
-    if (content.isEmpty()) {
-        emit scriptFailed("unknown_id", "Could not read script file.");
+    // Load script into registry first if not already loaded; loadScript() takes the lock itself
+    Script script = getScriptById(scriptId);
+    if (script.id.isEmpty()) script = loadScript(filePath); // This will add it to the registry
+    if (script.id.isEmpty()) {
+        LOG_ERROR("ScriptingEngine::executeScriptFile: Failed to load script: " << filePath);
+        emit scriptFailed(scriptId, "Could not read script file.");
         return false;
     }
 
-    QFileInfo fileInfo(filePath);
-    QString scriptId = fileInfo.absoluteFilePath(); // Use full path as ID
+    QMutexLocker locker(&d->mutex);
+    const QString content = script.content;
     emit scriptStarted(scriptId);
 
-    // Load script into registry first if not already loaded
-    if (!d->scriptRegistry.contains(scriptId)) {
-        Script script = loadScript(filePath); // This will add it to the registry
-        if (script.id.isEmpty()) {
-             LOG_ERROR("ScriptingEngine::executeScriptFile: Failed to load script: " << filePath);
-             emit scriptFailed(scriptId, "Failed to load script.");
-             return false;
-        }
-    }
+    // The document is the script's for this run only
+    QObject* previousDocument = d->objectRegistry.value("document");
+    if (document) d->objectRegistry.insert("document", document);
 
     // Execute the script content using the underlying engine.
     // This is similar to executeScript but uses the content from the file.
@@ -209,6 +258,11 @@ bool ScriptingEngine::executeScriptFile(const QString& filePath)
     // }
 
     LOG_WARN("ScriptingEngine::executeScriptFile: Requires specific library integration. Executing stub for: " << filePath);
+    Q_UNUSED(content);
+    if (document) {
+        if (previousDocument) d->objectRegistry.insert("document", previousDocument);
+        else d->objectRegistry.remove("document");
+    }
     emit scriptFinished(scriptId, true);
     return true; // Placeholder success
 }
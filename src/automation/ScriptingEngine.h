@@ -93,9 +93,11 @@ public:
     /**
      * @brief Execute a script file.
      * @param filePath Path to the script file.
+     * @param document Document the script works on, available to it as
+     * "document" for this run; may be null.
      * @return True if execution was successful.
      */
-    bool executeScriptFile(const QString& filePath);
+    bool executeScriptFile(const QString& filePath, Document* document = nullptr);
 
     /**
      * @brief Evaluate a script expression and return the result.
@@ -240,6 +242,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static ScriptingEngine* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -12,18 +12,41 @@
 #include "Logger.h"
 #include "ConfigManager.h"
 #include "Document.h"
+#include "DiskPageCache.h"
+#include "IntelligentCache.h"
+#include "MemoryBudget.h"
+#include "RemoteFile.h"
+#include "ThumbnailStore.h"
+#include "../formats/cad/DwgDocument.h"
+#include "../formats/image/ImagePyramid.h"
 #include "../ui/MainWindow.h"
 #include "../plugins/PluginInterface.h"
 #include "utils/Version.h"
 
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QPluginLoader>
 #include <QLocalSocket>
 #include <QLocalServer>
 #include <QDataStream>
 #include <QCoreApplication>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 namespace QuantilyxDoc {
 
@@ -33,10 +56,28 @@ class Application::Private
 public:
     Private() : mainWindow(nullptr), localServer(nullptr) {}
 
+    // What a plugin provides, known without loading its library
+    struct PluginRecord {
+        QString path;
+        QString name;
+        QString version;
+        QStringList formats;  // File extensions, lower case
+        QStringList commands;
+        QStringList features;
+        qint64 size = 0;      // Library size and modification time, to tell a cached entry is current
+        qint64 modified = 0;
+        bool failed = false;  // Loading was tried and failed; not retried this session
+    };
+
     MainWindow* mainWindow;
-    QMap<QString, PluginInterface*> plugins;
+    QMap<QString, PluginInterface*> plugins;     // Loaded plugins
+    QMap<QString, PluginRecord> pluginIndex;     // Every enabled plugin, by name
     QList<Document*> documents;
+    QHash<QString, Document*> documentsByPath;  // Canonical path -> the one document views share
+    QHash<Document*, QString> documentPaths;    // Reverse, as the path was at registration
+    QHash<Document*, int> documentReferences;
     QLocalServer* localServer;
+    QStringList pendingFiles; // Received from other instances, opened together on the next event loop pass
     
     QString tempDir;
     QString cacheDir;
@@ -48,6 +89,111 @@ public:
     QMap<QString, bool> ocrEngines;
     
     static const QString IPC_SERVER_NAME;
+    static const QDataStream::Version IPC_STREAM_VERSION = QDataStream::Qt_5_0;
+    static const int IPC_TIMEOUT_MS = 1000;
+
+    // One message: the files as a QDataStream QStringList
+    static QByteArray encodeFiles(const QStringList& files) {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(IPC_STREAM_VERSION);
+        stream << files;
+        return data;
+    }
+
+    static const int PluginIndexVersion = 1;
+
+    QString pluginIndexPath() const {
+        return QDir(cacheDir).filePath("plugin-index.json");
+    }
+
+    static QStringList toStringList(const QJsonValue& value, bool lowerCase = false) {
+        QStringList list;
+        for (const QJsonValue& item : value.toArray()) {
+            const QString text = item.toString();
+            if (!text.isEmpty()) list.append(lowerCase ? text.toLower() : text);
+        }
+        return list;
+    }
+
+    // Fill a record from plugin metadata: the object given to Q_PLUGIN_METADATA,
+    // or the same object in a manifest next to the library
+    static void readMetadata(const QJsonObject& metadata, PluginRecord& record) {
+        record.name = metadata.value("name").toString();
+        record.version = metadata.value("version").toString();
+        record.formats = toStringList(metadata.value("formats"), true);
+        record.commands = toStringList(metadata.value("commands"));
+        record.features = toStringList(metadata.value("features"));
+        if (record.name.isEmpty()) record.name = QFileInfo(record.path).completeBaseName();
+    }
+
+    static QJsonObject recordToJson(const PluginRecord& record) {
+        QJsonObject object;
+        object.insert("path", record.path);
+        object.insert("size", double(record.size));
+        object.insert("modified", double(record.modified));
+        object.insert("name", record.name);
+        object.insert("version", record.version);
+        object.insert("formats", QJsonArray::fromStringList(record.formats));
+        object.insert("commands", QJsonArray::fromStringList(record.commands));
+        object.insert("features", QJsonArray::fromStringList(record.features));
+        return object;
+    }
+
+    QHash<QString, PluginRecord> readPluginIndex() const {
+        QHash<QString, PluginRecord> cached;
+        QFile file(pluginIndexPath());
+        if (!file.open(QIODevice::ReadOnly)) return cached;
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        if (root.value("version").toInt() != PluginIndexVersion) return cached;
+        for (const QJsonValue& value : root.value("plugins").toArray()) {
+            const QJsonObject object = value.toObject();
+            PluginRecord record;
+            record.path = object.value("path").toString();
+            readMetadata(object, record);
+            record.size = qint64(object.value("size").toDouble());
+            record.modified = qint64(object.value("modified").toDouble());
+            cached.insert(record.path, record);
+        }
+        return cached;
+    }
+
+    void writePluginIndex(const QList<PluginRecord>& records) const {
+        QJsonArray array;
+        for (const PluginRecord& record : records) array.append(recordToJson(record));
+        QJsonObject root;
+        root.insert("version", PluginIndexVersion);
+        root.insert("plugins", array);
+        QSaveFile file(pluginIndexPath());
+        if (!file.open(QIODevice::WriteOnly)) return;
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        if (!file.commit()) LOG_WARN("Cannot write plugin index: " << file.fileName());
+    }
+
+    // Describe a plugin library without loading it. A manifest next to the
+    // library wins; else a current index entry; else the metadata Qt embeds
+    // in the library, which QPluginLoader reads from the file without dlopen.
+    PluginRecord describePlugin(const QFileInfo& library, const QHash<QString, PluginRecord>& cached, bool* fromCache) const {
+        PluginRecord record;
+        record.path = library.absoluteFilePath();
+        record.size = library.size();
+        record.modified = library.lastModified().toMSecsSinceEpoch();
+        *fromCache = false;
+
+        QFile manifest(library.absoluteDir().filePath(library.completeBaseName() + ".json"));
+        if (manifest.open(QIODevice::ReadOnly)) {
+            const QJsonObject object = QJsonDocument::fromJson(manifest.readAll()).object();
+            readMetadata(object.contains("MetaData") ? object.value("MetaData").toObject() : object, record);
+            return record;
+        }
+        const auto it = cached.constFind(record.path);
+        if (it != cached.constEnd() && it->size == record.size && it->modified == record.modified) {
+            *fromCache = true;
+            return *it;
+        }
+        readMetadata(QPluginLoader(record.path).metaData().value("MetaData").toObject(), record);
+        return record;
+    }
 };
 
 const QString Application::Private::IPC_SERVER_NAME = "quantilyxdoc-ipc";
@@ -114,28 +260,84 @@ bool Application::sendFilesToExistingInstance(const QStringList& files)
         return false;
     }
     
+    // Connecting is the check for a running instance, so there is no separate handshake
     QLocalSocket socket;
     socket.connectToServer(Private::IPC_SERVER_NAME);
     
-    if (!socket.waitForConnected(1000)) {
-        LOG_ERROR("Failed to connect to existing instance");
+    if (!socket.waitForConnected(Private::IPC_TIMEOUT_MS)) {
+        LOG_DEBUG("No existing instance to send files to");
         return false;
     }
     
-    // Send files list
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream << files;
-    
-    socket.write(data);
+    // Send files list, all in one message; the one byte reply says it was taken
+    socket.write(Private::encodeFiles(files));
     socket.flush();
-    socket.waitForBytesWritten(1000);
+    const bool acknowledged = socket.waitForBytesWritten(Private::IPC_TIMEOUT_MS)
+        && socket.waitForReadyRead(Private::IPC_TIMEOUT_MS) && socket.read(1) == "1";
     socket.disconnectFromServer();
     
+    if (!acknowledged) {
+        LOG_ERROR("Existing instance did not take the files");
+        return false;
+    }
     LOG_INFO("Sent " << files.size() << " files to existing instance");
     return true;
 }
 
+bool Application::forwardToRunningInstance(int argc, char* argv[])
+{
+#ifdef Q_OS_UNIX
+    // Only plain file launches are forwarded; any other option needs the full startup
+    QStringList files;
+    for (int i = 1; i < argc; ++i) {
+        const QString argument = QString::fromLocal8Bit(argv[i]);
+        if ((argument == "-f" || argument == "--file") && i + 1 < argc) {
+            files.append(QString::fromLocal8Bit(argv[++i]));
+        } else if (argument.startsWith("--file=")) {
+            files.append(argument.mid(7));
+        } else if (argument.startsWith('-')) {
+            return false;
+        } else {
+            files.append(argument);
+        }
+    }
+    if (files.isEmpty()) return false;
+    // The running instance has its own working directory
+    for (QString& file : files) file = QFileInfo(file).absoluteFilePath();
+
+    // QLocalServer listens on a socket file in the temporary directory, named as given
+    const QByteArray path = QFile::encodeName(QDir::tempPath() + '/' + Private::IPC_SERVER_NAME);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= int(sizeof(address.sun_path))) return false;
+    memcpy(address.sun_path, path.constData(), path.size());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    // No socket file or a stale one fails at once, so a first launch loses nothing
+    bool forwarded = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (forwarded) {
+        const QByteArray message = Private::encodeFiles(files);
+        qint64 written = 0;
+        while (forwarded && written < message.size()) {
+            const ssize_t n = ::send(fd, message.constData() + written, size_t(message.size() - written), MSG_NOSIGNAL);
+            if (n > 0) written += n;
+            else forwarded = n < 0 && errno == EINTR;
+        }
+        pollfd reply = {fd, POLLIN, 0};
+        char ack = 0;
+        forwarded = forwarded && ::poll(&reply, 1, Private::IPC_TIMEOUT_MS) == 1 && ::read(fd, &ack, 1) == 1 && ack == '1';
+    }
+    ::close(fd);
+    return forwarded;
+#else
+    // Named pipes elsewhere; main() falls back to sendFilesToExistingInstance() once Qt is up
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+    return false;
+#endif
+}
+
 bool Application::initialize()
 {
     LOG_INFO("Initializing application...");
@@ -147,6 +349,9 @@ bool Application::initialize()
     QDir().mkpath(d->dataDir);
     QDir().mkpath(d->pluginsDir);
     
+    // One memory ceiling for every cache, checked from the main thread
+    MemoryBudget::instance().startMonitoring();
+    
     LOG_INFO("Application initialized successfully");
     return true;
 }
@@ -163,26 +368,35 @@ void Application::loadPlugins()
         return;
     }
     
-    QDir pluginsDir(d->pluginsDir);
-    QStringList pluginFiles = pluginsDir.entryList(QDir::Files);
-    
-    int loadedCount = 0;
-    int failedCount = 0;
+    // Only the index is built here; each library is loaded when its plugin,
+    // format, command or feature is first asked for
+    QStringList enabledPlugins = config.getString("Plugins", "enabled_plugins", "").split(',', Qt::SkipEmptyParts);
+    const QHash<QString, Private::PluginRecord> cached = d->readPluginIndex();
+    QList<Private::PluginRecord> records;
+    bool indexChanged = false;
     
-    for (const QString& fileName : pluginFiles) {
+    QDir pluginsDir(d->pluginsDir);
+    const QFileInfoList pluginFiles = pluginsDir.entryInfoList(QDir::Files, QDir::Name);
+    for (const QFileInfo& fileInfo : pluginFiles) {
+        const QString fileName = fileInfo.fileName();
         if (!fileName.endsWith(".so") && !fileName.endsWith(".dll") && !fileName.endsWith(".dylib")) {
             continue;
         }
         
-        QString pluginPath = pluginsDir.absoluteFilePath(fileName);
-        if (loadPlugin(pluginPath)) {
-            loadedCount++;
-        } else {
-            failedCount++;
+        bool fromCache = false;
+        Private::PluginRecord record = d->describePlugin(fileInfo, cached, &fromCache);
+        if (!fromCache) indexChanged = true;
+        records.append(record);
+        
+        if (!enabledPlugins.isEmpty() && !enabledPlugins.contains(record.name)) {
+            LOG_INFO("Plugin " << record.name << " is disabled in configuration");
+            continue;
         }
+        if (!d->pluginIndex.contains(record.name)) d->pluginIndex.insert(record.name, record);
     }
+    if (indexChanged || records.size() != cached.size()) d->writePluginIndex(records);
     
-    LOG_INFO("Loaded " << loadedCount << " plugins, " << failedCount << " failed");
+    LOG_INFO("Indexed " << d->pluginIndex.size() << " plugins; they load on first use");
 }
 
 bool Application::loadPlugin(const QString& pluginPath)
@@ -206,15 +420,6 @@ bool Application::loadPlugin(const QString& pluginPath)
     
     QString pluginName = plugin->name();
     
-    // Check if plugin is enabled
-    ConfigManager& config = ConfigManager::instance();
-    QStringList enabledPlugins = config.getString("Plugins", "enabled_plugins", "").split(',');
-    
-    if (!enabledPlugins.isEmpty() && !enabledPlugins.contains(pluginName)) {
-        LOG_INFO("Plugin " << pluginName << " is disabled in configuration");
-        return false;
-    }
-    
     // Initialize plugin
     if (!plugin->initialize(this)) {
         LOG_ERROR("Plugin initialization failed: " << pluginName);
@@ -261,9 +466,25 @@ const QMap<QString, PluginInterface*>& Application::plugins() const
     return d->plugins;
 }
 
-PluginInterface* Application::getPlugin(const QString& name) const
+PluginInterface* Application::getPlugin(const QString& name)
 {
-    return d->plugins.value(name, nullptr);
+    if (PluginInterface* plugin = d->plugins.value(name, nullptr)) {
+        return plugin;
+    }
+    
+    auto it = d->pluginIndex.find(name);
+    if (it == d->pluginIndex.end() || it->failed) {
+        return nullptr;
+    }
+    if (!loadPlugin(it->path)) {
+        it->failed = true;
+        return nullptr;
+    }
+    PluginInterface* plugin = d->plugins.value(name, nullptr);
+    if (!plugin) {
+        LOG_WARN("Plugin " << it->path << " did not register as " << name << "; check its metadata");
+    }
+    return plugin;
 }
 
 bool Application::hasPlugin(const QString& name) const
@@ -271,6 +492,42 @@ bool Application::hasPlugin(const QString& name) const
     return d->plugins.contains(name);
 }
 
+QStringList Application::availablePlugins() const
+{
+    return d->pluginIndex.keys();
+}
+
+PluginInterface* Application::pluginForFormat(const QString& extension)
+{
+    const QString suffix = extension.startsWith('.') ? extension.mid(1).toLower() : extension.toLower();
+    for (const Private::PluginRecord& record : qAsConst(d->pluginIndex)) {
+        if (record.formats.contains(suffix)) {
+            if (PluginInterface* plugin = getPlugin(record.name)) return plugin;
+        }
+    }
+    return nullptr;
+}
+
+PluginInterface* Application::pluginForCommand(const QString& command)
+{
+    for (const Private::PluginRecord& record : qAsConst(d->pluginIndex)) {
+        if (record.commands.contains(command)) {
+            if (PluginInterface* plugin = getPlugin(record.name)) return plugin;
+        }
+    }
+    return nullptr;
+}
+
+PluginInterface* Application::pluginForFeature(const QString& feature)
+{
+    for (const Private::PluginRecord& record : qAsConst(d->pluginIndex)) {
+        if (record.features.contains(feature)) {
+            if (PluginInterface* plugin = getPlugin(record.name)) return plugin;
+        }
+    }
+    return nullptr;
+}
+
 QString Application::version()
 {
     return QUANTILYXDOC_VERSION_STRING;
@@ -296,23 +553,83 @@ QList<Document*> Application::openDocuments() const
     return d->documents;
 }
 
-void Application::registerDocument(Document* doc)
+// Same key for every path to a file, so symlinks and relative paths share one document
+static QString documentKey(const QString& filePath)
 {
-    if (!d->documents.contains(doc)) {
-        d->documents.append(doc);
-        LOG_INFO("Document registered: " << doc->filePath());
-        emit documentRegistered(doc);
+    if (filePath.isEmpty()) return QString();
+    const QFileInfo info(filePath);
+    const QString canonical = info.canonicalFilePath();
+    return canonical.isEmpty() ? QDir::cleanPath(info.absoluteFilePath()) : canonical;
+}
+
+Document* Application::registerDocument(Document* doc)
+{
+    if (!doc) return nullptr;
+    if (d->documents.contains(doc)) {
+        ++d->documentReferences[doc];
+        return doc;
     }
+    const QString key = documentKey(doc->filePath());
+    if (Document* existing = d->documentsByPath.value(key)) {
+        // Views of the same file share its pages, tiles and text
+        ++d->documentReferences[existing];
+        LOG_INFO("Document already open, sharing it: " << doc->filePath()
+                 << " (" << d->documentReferences.value(existing) << " references)");
+        return existing;
+    }
+    d->documents.append(doc);
+    d->documentReferences.insert(doc, 1);
+    if (!key.isEmpty()) {
+        d->documentsByPath.insert(key, doc);
+        d->documentPaths.insert(doc, key);
+    }
+    DiskPageCache::instance().registerDocument(reinterpret_cast<quintptr>(doc), doc->filePath());
+    IntelligentCache::instance().trackDocument(doc);
+    ThumbnailStore::instance().generateFor(doc); // Only renders what is not stored yet
+    LOG_INFO("Document registered: " << doc->filePath());
+    emit documentRegistered(doc);
+    return doc;
 }
 
 void Application::unregisterDocument(Document* doc)
 {
     if (d->documents.removeOne(doc)) {
+        d->documentReferences.remove(doc);
+        const QString key = d->documentPaths.take(doc);
+        if (d->documentsByPath.value(key) == doc) d->documentsByPath.remove(key);
+        DiskPageCache::instance().unregisterDocument(reinterpret_cast<quintptr>(doc));
         LOG_INFO("Document unregistered: " << doc->filePath());
         emit documentUnregistered(doc);
     }
 }
 
+Document* Application::findDocument(const QString& filePath) const
+{
+    const QString key = documentKey(filePath);
+    return key.isEmpty() ? nullptr : d->documentsByPath.value(key);
+}
+
+void Application::retainDocument(Document* doc)
+{
+    auto it = d->documentReferences.find(doc);
+    if (it != d->documentReferences.end()) ++it.value();
+}
+
+void Application::releaseDocument(Document* doc)
+{
+    auto it = d->documentReferences.find(doc);
+    if (it == d->documentReferences.end()) return;
+    if (--it.value() > 0) return;
+    unregisterDocument(doc);
+    doc->close(); // Views and caches drop it on closed()
+    doc->deleteLater();
+}
+
+int Application::documentReferenceCount(Document* doc) const
+{
+    return d->documentReferences.value(doc);
+}
+
 MainWindow* Application::mainWindow() const
 {
     return d->mainWindow;
@@ -357,9 +674,13 @@ void Application::clearCaches()
 {
     LOG_INFO("Clearing all caches...");
     
-    QDir cacheDir(d->cacheDir);
-    cacheDir.removeRecursively();
-    cacheDir.mkpath(".");
+    // Each cache is cleared by its owner, which keeps what is in use; the
+    // log and clipboard spill files in the same directory are not caches
+    DiskPageCache::instance().clear();
+    ThumbnailStore::instance().clear();
+    RemoteFile::clearCache();
+    ImagePyramid::clearDiskCache();
+    DwgDocument::clearConversionCache();
     
     LOG_INFO("Caches cleared");
 }
@@ -412,41 +733,53 @@ void Application::initializeDirectories()
 
 void Application::setupIPC()
 {
-    // Remove any existing server
-    QLocalServer::removeServer(Private::IPC_SERVER_NAME);
-    
     // Create local server for IPC
     d->localServer = new QLocalServer(this);
     
     connect(d->localServer, &QLocalServer::newConnection, this, [this]() {
         QLocalSocket* socket = d->localServer->nextPendingConnection();
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
         
         connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
-            QByteArray data = socket->readAll();
-            QDataStream stream(&data, QIODevice::ReadOnly);
+            QDataStream stream(socket);
+            stream.setVersion(Private::IPC_STREAM_VERSION);
+            stream.startTransaction();
             QStringList files;
             stream >> files;
+            if (!stream.commitTransaction()) return; // Rest of the message still to come
+            socket->write("1");
+            socket->flush();
+            socket->disconnectFromServer();
             
             LOG_INFO("Received " << files.size() << " files from another instance");
             
-            // Open files in main window
-            if (d->mainWindow) {
-                for (const QString& file : files) {
+            // Launches arriving together are opened in one pass, raising the window once
+            const bool scheduled = !d->pendingFiles.isEmpty();
+            d->pendingFiles.append(files);
+            if (scheduled) return;
+            QTimer::singleShot(0, this, [this]() {
+                const QStringList pending = d->pendingFiles;
+                d->pendingFiles.clear();
+                if (!d->mainWindow) return;
+                
+                // Open files in main window
+                for (const QString& file : pending) {
                     d->mainWindow->openDocument(file);
                 }
-            }
-            
-            // Bring window to front
-            if (d->mainWindow) {
+                
+                // Bring window to front
                 d->mainWindow->raise();
                 d->mainWindow->activateWindow();
-            }
-            
-            socket->disconnectFromServer();
+            });
         });
     });
     
-    if (!d->localServer->listen(Private::IPC_SERVER_NAME)) {
+    // A socket file left by a crashed instance blocks listening; a live instance keeps its own
+    if (!d->localServer->listen(Private::IPC_SERVER_NAME) && !isAlreadyRunning()) {
+        QLocalServer::removeServer(Private::IPC_SERVER_NAME);
+        d->localServer->listen(Private::IPC_SERVER_NAME);
+    }
+    if (!d->localServer->isListening()) {
         LOG_WARNING("Failed to start IPC server: " << d->localServer->errorString());
     } else {
         LOG_INFO("IPC server started");
@@ -58,6 +58,20 @@ public:
      */
     static bool sendFilesToExistingInstance(const QStringList& files);
 
+    /**
+     * @brief Hand a plain file launch to the running instance before Qt starts.
+     * Meant to be called first thing in main(), before QApplication,
+     * Settings or plugins exist: when the arguments are only files, they
+     * are sent in one message over the instance's local socket, with no
+     * separate running check. Any other option, or no running instance,
+     * returns false at once for the normal startup to go ahead. Unix only;
+     * elsewhere it returns false and sendFilesToExistingInstance() is used.
+     * @param argc Argument count from main()
+     * @param argv Arguments from main()
+     * @return true if the running instance took the files
+     */
+    static bool forwardToRunningInstance(int argc, char* argv[]);
+
     /**
      * @brief Initialize the application
      * @return true if initialization succeeded
@@ -65,7 +79,14 @@ public:
     bool initialize();
 
     /**
-     * @brief Load all plugins
+     * @brief Index the plugins in the plugins directory without loading them
+     *
+     * What each plugin provides comes from a manifest next to its library
+     * (foo.json beside foo.so), from the cached index of the last scan
+     * while the library is unchanged, or from the metadata Qt embeds in the
+     * library, read without loading it. A plugin is loaded and initialized
+     * the first time it, or one of its formats, commands or features, is
+     * asked for. Metadata keys: name, version, formats, commands, features.
      */
     void loadPlugins();
 
@@ -81,11 +102,11 @@ public:
     const QMap<QString, PluginInterface*>& plugins() const;
 
     /**
-     * @brief Get plugin by name
+     * @brief Get plugin by name, loading it if it is not loaded yet
      * @param name Plugin name
-     * @return Plugin interface or nullptr if not found
+     * @return Plugin interface or nullptr if not found or it failed to load
      */
-    PluginInterface* getPlugin(const QString& name) const;
+    PluginInterface* getPlugin(const QString& name);
 
     /**
      * @brief Check if plugin is loaded
@@ -94,6 +115,33 @@ public:
      */
     bool hasPlugin(const QString& name) const;
 
+    /**
+     * @brief Get the names of every indexed plugin, loaded or not
+     * @return Plugin names
+     */
+    QStringList availablePlugins() const;
+
+    /**
+     * @brief Get the plugin that opens a file format, loading it if needed
+     * @param extension File extension, with or without the dot
+     * @return Plugin interface or nullptr if no plugin declares the format
+     */
+    PluginInterface* pluginForFormat(const QString& extension);
+
+    /**
+     * @brief Get the plugin that provides a command, loading it if needed
+     * @param command Command identifier
+     * @return Plugin interface or nullptr if no plugin declares the command
+     */
+    PluginInterface* pluginForCommand(const QString& command);
+
+    /**
+     * @brief Get the plugin that provides a feature, loading it if needed
+     * @param feature Feature identifier
+     * @return Plugin interface or nullptr if no plugin declares the feature
+     */
+    PluginInterface* pluginForFeature(const QString& feature);
+
     /**
      * @brief Get application version
      * @return Version string
@@ -125,17 +173,47 @@ public:
     QList<Document*> openDocuments() const;
 
     /**
-     * @brief Register a document
+     * @brief Register a document, taking one reference to it
+     * Documents are shared by canonical path: if a document for the same
+     * file is already registered, that one gains the reference and is
+     * returned, and the caller should delete its own copy.
      * @param doc Document to register
+     * @return The registered document for the file, doc or the one already open
      */
-    void registerDocument(Document* doc);
+    Document* registerDocument(Document* doc);
 
     /**
-     * @brief Unregister a document
+     * @brief Unregister a document regardless of its references
      * @param doc Document to unregister
      */
     void unregisterDocument(Document* doc);
 
+    /**
+     * @brief Find the registered document for a file
+     * @param filePath Any path to the file; symlinks and relative parts are resolved
+     * @return Document pointer, or nullptr if the file is not open
+     */
+    Document* findDocument(const QString& filePath) const;
+
+    /**
+     * @brief Take another reference to a registered document, e.g. for a second view
+     * @param doc Registered document
+     */
+    void retainDocument(Document* doc);
+
+    /**
+     * @brief Drop a reference; the last one closes and deletes the document
+     * @param doc Registered document
+     */
+    void releaseDocument(Document* doc);
+
+    /**
+     * @brief Get the number of references to a document
+     * @param doc Document
+     * @return Reference count, 0 if not registered
+     */
+    int documentReferenceCount(Document* doc) const;
+
     /**
      * @brief Get main window
      * @return Pointer to main window
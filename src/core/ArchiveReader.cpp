@@ -0,0 +1,290 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ArchiveReader.h"
+#include "MappedFile.h"
+#include "ZipArchive.h"
+#include "Logger.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <limits>
+
+#ifdef HAVE_LIBARCHIVE
+#include <archive.h>
+#include <archive_entry.h>
+#else
+struct archive;
+#endif
+
+namespace QuantilyxDoc {
+
+class ArchiveReader::Private {
+public:
+    Private() : hasEncrypted(false), maxIdleReaders(qMax(2, QThread::idealThreadCount() + 1)) {}
+
+    // A libarchive reader and how far it has walked; next is the ordinal
+    // of the header it returns next
+    struct Cursor {
+        archive* handle = nullptr;
+        int next = 0;
+    };
+
+    QString filePath;
+    QByteArray password;                 // UTF-8, as libarchive takes it
+    std::shared_ptr<MappedFile> mapping; // Bytes every reader reads from, if the file could be mapped
+    QVector<Entry> entries;              // In archive order
+    QHash<QString, int> lookup;          // Normalized path -> position in entries
+    bool hasEncrypted;
+
+    mutable QMutex readerMutex;
+    mutable QVector<Cursor> idleReaders;
+    int maxIdleReaders; // Readers beyond this are closed when returned
+
+    // Opens another reader at the start of the archive; returns null and
+    // sets message on failure
+    archive* openReader(QString* message) const {
+#ifdef HAVE_LIBARCHIVE
+        archive* handle = archive_read_new();
+        if (!handle) {
+            if (message) *message = QStringLiteral("Out of memory");
+            return nullptr;
+        }
+        archive_read_support_filter_all(handle);
+        archive_read_support_format_all(handle);
+        if (!password.isEmpty()) archive_read_add_passphrase(handle, password.constData());
+
+        const int result = mapping
+            ? archive_read_open_memory(handle, mapping->data(), static_cast<size_t>(mapping->size()))
+            : archive_read_open_filename(handle, filePath.toUtf8().constData(), 64 * 1024);
+        if (result != ARCHIVE_OK) {
+            if (message) *message = QString::fromUtf8(archive_error_string(handle));
+            archive_read_free(handle);
+            return nullptr;
+        }
+        return handle;
+#else
+        if (message) *message = QStringLiteral("Built without libarchive");
+        return nullptr;
+#endif
+    }
+
+    // The idle reader that has walked furthest without passing ordinal,
+    // or a fresh one
+    Cursor acquire(int ordinal) const {
+        {
+            QMutexLocker locker(&readerMutex);
+            int best = -1;
+            for (int i = 0; i < idleReaders.size(); ++i) {
+                if (idleReaders[i].next <= ordinal && (best < 0 || idleReaders[i].next > idleReaders[best].next)) {
+                    best = i;
+                }
+            }
+            if (best >= 0) return idleReaders.takeAt(best);
+        }
+        Cursor cursor;
+        cursor.handle = openReader(nullptr);
+        return cursor;
+    }
+
+    void release(const Cursor& cursor) const {
+        if (!cursor.handle) return;
+        {
+            QMutexLocker locker(&readerMutex);
+            if (idleReaders.size() < maxIdleReaders) {
+                idleReaders.append(cursor);
+                return;
+            }
+        }
+#ifdef HAVE_LIBARCHIVE
+        archive_read_free(cursor.handle);
+#endif
+    }
+
+    bool buildIndex(archive* handle, QString* message) {
+#ifdef HAVE_LIBARCHIVE
+        archive_entry* header = nullptr;
+        int ordinal = 0;
+        int result;
+        while ((result = archive_read_next_header(handle, &header)) >= ARCHIVE_WARN) {
+            if (archive_entry_filetype(header) == AE_IFREG && ordinal < std::numeric_limits<int>::max()) {
+                Entry entry;
+                entry.ordinal = ordinal;
+                const char* utf8Name = archive_entry_pathname_utf8(header);
+                entry.name = utf8Name ? QString::fromUtf8(utf8Name) : QString::fromLocal8Bit(archive_entry_pathname(header));
+                entry.size = archive_entry_size_is_set(header) ? static_cast<qint64>(archive_entry_size(header)) : -1;
+                entry.encrypted = archive_entry_is_encrypted(header);
+                if (entry.encrypted) hasEncrypted = true;
+
+                // First entry wins, as with ZipArchive
+                const QString key = ZipArchive::normalizePath(entry.name);
+                if (!key.isEmpty() && !lookup.contains(key)) lookup.insert(key, entries.size());
+                entries.append(entry);
+            }
+            ++ordinal; // Its data is skipped by the next header read
+        }
+        if (result != ARCHIVE_EOF) {
+            if (message) *message = QString::fromUtf8(archive_error_string(handle));
+            return false;
+        }
+        return true;
+#else
+        Q_UNUSED(handle);
+        if (message) *message = QStringLiteral("Built without libarchive");
+        return false;
+#endif
+    }
+};
+
+ArchiveReader::ArchiveReader()
+    : d(new Private())
+{
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    close();
+}
+
+bool ArchiveReader::open(const QString& filePath, const QString& password, QString* error)
+{
+    close();
+
+    d->filePath = filePath;
+    d->password = password.toUtf8();
+    d->mapping = MappedFile::open(filePath);
+    QString message;
+    archive* handle = d->openReader(&message);
+    if (!handle) {
+        if (error) *error = message;
+        close();
+        return false;
+    }
+    const bool indexed = d->buildIndex(handle, &message);
+#ifdef HAVE_LIBARCHIVE
+    archive_read_free(handle); // Walked to the end; of no use to later reads
+#endif
+    if (!indexed) {
+        if (error) *error = message;
+        close();
+        return false;
+    }
+    LOG_DEBUG("ArchiveReader: Indexed " << d->entries.size() << " entries in " << filePath);
+    return true;
+}
+
+void ArchiveReader::close()
+{
+    QMutexLocker locker(&d->readerMutex);
+#ifdef HAVE_LIBARCHIVE
+    for (const Private::Cursor& cursor : d->idleReaders) {
+        archive_read_free(cursor.handle);
+    }
+#endif
+    d->idleReaders.clear();
+    d->entries.clear();
+    d->lookup.clear();
+    d->hasEncrypted = false;
+    d->mapping.reset();
+    d->password.clear();
+    d->filePath.clear();
+}
+
+bool ArchiveReader::isOpen() const
+{
+    return !d->filePath.isEmpty();
+}
+
+QString ArchiveReader::filePath() const
+{
+    return d->filePath;
+}
+
+bool ArchiveReader::hasEncryptedEntries() const
+{
+    return d->hasEncrypted;
+}
+
+QStringList ArchiveReader::entryNames() const
+{
+    QStringList names;
+    names.reserve(d->entries.size());
+    for (const Entry& entry : d->entries) {
+        names.append(entry.name);
+    }
+    return names;
+}
+
+const ArchiveReader::Entry* ArchiveReader::entry(const QString& path) const
+{
+    const auto it = d->lookup.constFind(ZipArchive::normalizePath(path));
+    return it != d->lookup.constEnd() ? &d->entries.at(it.value()) : nullptr;
+}
+
+bool ArchiveReader::contains(const QString& path) const
+{
+    return d->lookup.contains(ZipArchive::normalizePath(path));
+}
+
+QByteArray ArchiveReader::read(const QString& path) const
+{
+    const Entry* found = entry(path);
+    if (!found) {
+        LOG_ERROR("ArchiveReader: No entry " << path << " in " << d->filePath);
+        return QByteArray();
+    }
+    if (found->size > std::numeric_limits<int>::max()) {
+        LOG_ERROR("ArchiveReader: Entry too large to read: " << path);
+        return QByteArray();
+    }
+
+    Private::Cursor cursor = d->acquire(found->ordinal);
+    if (!cursor.handle) {
+        LOG_ERROR("ArchiveReader: Cannot open another reader on " << d->filePath);
+        return QByteArray();
+    }
+
+#ifdef HAVE_LIBARCHIVE
+    // Walk to the entry; skipped entries' data is passed over, not extracted
+    archive_entry* header = nullptr;
+    while (cursor.next <= found->ordinal) {
+        if (archive_read_next_header(cursor.handle, &header) < ARCHIVE_WARN) {
+            LOG_ERROR("ArchiveReader: Failed to reach " << path << ": " << archive_error_string(cursor.handle));
+            archive_read_free(cursor.handle);
+            return QByteArray();
+        }
+        ++cursor.next;
+    }
+
+    QByteArray data;
+    if (found->size >= 0) data.reserve(static_cast<int>(found->size));
+    char chunk[64 * 1024];
+    la_ssize_t bytesRead;
+    while ((bytesRead = archive_read_data(cursor.handle, chunk, sizeof(chunk))) > 0) {
+        if (data.size() > std::numeric_limits<int>::max() - bytesRead) {
+            bytesRead = ARCHIVE_FATAL;
+            break;
+        }
+        data.append(chunk, static_cast<int>(bytesRead));
+    }
+    if (bytesRead < 0) {
+        LOG_ERROR("ArchiveReader: Failed to read " << path << ": " << archive_error_string(cursor.handle));
+        archive_read_free(cursor.handle); // Its position is unknown after an error
+        return QByteArray();
+    }
+    d->release(cursor);
+    return data;
+#else
+    return QByteArray(); // No reader opens without libarchive
+#endif
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,115 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_ARCHIVEREADER_H
+#define QUANTILYX_ARCHIVEREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Read-only archive in any format libarchive reads (RAR, RAR5, 7z, tar).
+ *
+ * The counterpart of ZipArchive for archives that can only be read front
+ * to back. The headers are walked once when the archive is opened to build
+ * an entry index. A read then continues from a reader already positioned
+ * before the entry when one is idle, so reading the entries in order, as
+ * page turns do, never walks the archive again. Entries are decompressed
+ * straight into memory. Every concurrent read uses its own reader, and all
+ * of them read from the same MappedFile when the file can be mapped. Used
+ * by the CBR backend.
+ */
+class ArchiveReader
+{
+public:
+    /**
+     * @brief One file in the archive, as found in its headers.
+     */
+    struct Entry {
+        int ordinal = 0;        ///< Position among all headers in the archive
+        QString name;           ///< Name as stored in the archive
+        qint64 size = -1;       ///< Uncompressed size, or -1 if the header does not say
+        bool encrypted = false; ///< Needs the password to read
+    };
+
+    ArchiveReader();
+    ~ArchiveReader();
+
+    /**
+     * @brief Open an archive and index its entries. Closes any open archive first.
+     * @param filePath Archive to open.
+     * @param password Password for encrypted entries; may be empty.
+     * @param error Receives libarchive's message on failure; may be null.
+     * @return True on success.
+     */
+    bool open(const QString& filePath, const QString& password = QString(), QString* error = nullptr);
+
+    /**
+     * @brief Close every reader and drop the index.
+     * Must not be called while another thread is reading.
+     */
+    void close();
+
+    /**
+     * @brief Check if an archive is open.
+     * @return True if open.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the open archive's path.
+     * @return File path, or empty if closed.
+     */
+    QString filePath() const;
+
+    /**
+     * @brief Check if any entry is encrypted.
+     * @return True if some entry needs a password.
+     */
+    bool hasEncryptedEntries() const;
+
+    /**
+     * @brief Get every file name in archive order. Directories are left out.
+     * @return Names as stored in the archive.
+     */
+    QStringList entryNames() const;
+
+    /**
+     * @brief Look up an entry.
+     * @param path Path inside the archive; normalized with ZipArchive::normalizePath().
+     * @return The entry, or nullptr. Valid until close().
+     */
+    const Entry* entry(const QString& path) const;
+
+    /**
+     * @brief Check if the archive has an entry.
+     * @param path Path inside the archive.
+     * @return True if present.
+     */
+    bool contains(const QString& path) const;
+
+    /**
+     * @brief Decompress an entry. Safe to call from several threads at once.
+     * @param path Path inside the archive.
+     * @return Entry contents, or empty if missing or unreadable.
+     */
+    QByteArray read(const QString& path) const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_ARCHIVEREADER_H
@@ -0,0 +1,66 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "Arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace QuantilyxDoc {
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(qMax<size_t>(blockSize, 256))
+{
+}
+
+Arena::~Arena() = default;
+
+char* Arena::newBlock(size_t minimumSize)
+{
+    const size_t size = std::max(m_blockSize, minimumSize);
+    m_blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    m_cursor = m_blocks.back().data.get();
+    m_end = m_cursor + size;
+    return m_cursor;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    if (size == 0) size = 1;
+    auto aligned = [alignment](char* at) {
+        return reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(at) + alignment - 1) & ~std::uintptr_t(alignment - 1));
+    };
+    char* at = m_cursor ? aligned(m_cursor) : nullptr;
+    if (!at || at + size > m_end) at = aligned(newBlock(size + alignment));
+    m_cursor = at + size;
+    m_used += size;
+    return at;
+}
+
+void Arena::reset()
+{
+    // Blocks after the first go; the first stays for the next round
+    if (!m_blocks.empty()) m_blocks.resize(1);
+    m_cursor = m_blocks.empty() ? nullptr : m_blocks.front().data.get();
+    m_end = m_blocks.empty() ? nullptr : m_cursor + m_blocks.front().size;
+    m_used = 0;
+}
+
+size_t Arena::bytesUsed() const
+{
+    return m_used;
+}
+
+size_t Arena::bytesReserved() const
+{
+    size_t total = 0;
+    for (const Block& block : m_blocks) total += block.size;
+    return total;
+}
+
+} // namespace QuantilyxDoc
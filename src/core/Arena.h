@@ -0,0 +1,131 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_ARENA_H
+#define QUANTILYX_ARENA_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Hands out memory for short-lived objects from a few large blocks.
+ *
+ * Allocation bumps a pointer and freeing does nothing; reset() takes
+ * everything back at once and keeps the first block for the next round.
+ * Meant for per-page or per-request scratch such as search hits, where
+ * the objects all die together. Objects that own heap memory themselves
+ * (QString, QList) gain nothing here; keep them out, or their destructors
+ * must be run by hand.
+ *
+ * Not thread-safe; use one arena per thread.
+ */
+class Arena
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param blockSize Bytes of each block; larger requests get a block of their own.
+     */
+    explicit Arena(size_t blockSize = 16 * 1024);
+
+    /**
+     * @brief Destructor. Frees every block.
+     */
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Allocate memory, valid until reset() or destruction.
+     * @param size Bytes.
+     * @param alignment Alignment, a power of two.
+     * @return Pointer to the memory.
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * @brief Take back everything allocated; the first block is kept.
+     */
+    void reset();
+
+    /**
+     * @brief Get the bytes handed out since the last reset().
+     * @return Byte count.
+     */
+    size_t bytesUsed() const;
+
+    /**
+     * @brief Get the bytes of the blocks held.
+     * @return Byte count.
+     */
+    size_t bytesReserved() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    char* newBlock(size_t minimumSize);
+
+    std::vector<Block> m_blocks;
+    const size_t m_blockSize;
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    size_t m_used = 0;
+};
+
+/**
+ * @brief Standard allocator drawing from an Arena, for containers of trivial types.
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) noexcept : m_arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.arena()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {} // Taken back by Arena::reset()
+
+    Arena* arena() const noexcept { return m_arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return m_arena == other.arena(); }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return m_arena != other.arena(); }
+
+private:
+    Arena* m_arena;
+};
+
+/**
+ * @brief Vector whose storage lives in an Arena.
+ * It must be gone, or at least not grown again, before the arena resets.
+ */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_ARENA_H
@@ -10,6 +10,8 @@
 #include "AuditTrail.h"
 #include "Document.h"
 #include "Logger.h"
+#include "Settings.h"
+#include "ThreadPool.h"
 #include "utils/FileUtils.h" // Assuming this exists for file operations
 #include <QStandardPaths>
 #include <QDir>
@@ -20,32 +22,140 @@
 #include <QCryptographicHash>
 #include <QCoreApplication>
 #include <QThread> // For current thread ID in logs
+#include <QVector>
+#include <QWaitCondition>
+#include <algorithm>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// An index point every this many entries
+const int IndexStride = 64;
+// Hash the chain of a new log starts from
+const QByteArray ChainSeed(64, '0');
+
+// Fields of one log line, without the hash
+QByteArray formatEntry(const AuditEntry& entry)
+{
+    // Format: ID|Timestamp|Type|User|Document|Action|Details|IP|Result|SessionID
+    // Use a delimiter unlikely to appear in data, or escape/quote fields properly.
+    // For simplicity here, we'll use a pipe, assuming user/document names don't contain it often.
+    QString line;
+    QTextStream stream(&line);
+    stream << entry.id << "|"
+           << entry.timestamp.toString(Qt::ISODateWithMs) << "|"
+           << static_cast<int>(entry.type) << "|"
+           << entry.user << "|"
+           << entry.documentPath << "|"
+           << entry.action << "|"
+           << entry.details << "|"
+           << entry.ipAddress.toString() << "|"
+           << entry.result << "|"
+           << entry.sessionId;
+    stream.flush();
+    return line.toUtf8();
+}
+
+QByteArray chainHash(const QByteArray& previous, const QByteArray& fields)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(previous);
+    hash.addData(fields);
+    return hash.result().toHex();
+}
+
+// Split a line into its fields and its hash; false for other lines
+bool splitLine(const QByteArray& rawLine, QByteArray& fields, QByteArray& hash)
+{
+    QByteArray line = rawLine;
+    while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+    if (line.isEmpty() || line.startsWith('#')) return false;
+    const int bar = line.lastIndexOf('|');
+    if (bar < 0 || line.size() - bar - 1 != 64) return false; // Lines from before the chain
+    fields = line.left(bar);
+    hash = line.mid(bar + 1);
+    return true;
+}
+
+bool parseEntry(const QByteArray& fields, AuditEntry& entry)
+{
+    const QStringList parts = QString::fromUtf8(fields).split('|');
+    if (parts.size() < 10) return false; // Malformed line
+
+    bool ok;
+    entry.id = parts[0].toULongLong(&ok);
+    if (!ok) return false;
+    entry.timestamp = QDateTime::fromString(parts[1], Qt::ISODateWithMs);
+    if (!entry.timestamp.isValid()) return false;
+    entry.type = static_cast<AuditEntry::EventType>(parts[2].toInt(&ok));
+    if (!ok) return false;
+    entry.user = parts[3];
+    entry.documentPath = parts[4];
+    entry.action = parts[5];
+    entry.details = parts[6];
+    entry.ipAddress = QHostAddress(parts[7]);
+    entry.result = parts[8];
+    entry.sessionId = parts[9];
+    return true;
+}
+
+} // namespace
+
 class AuditTrail::Private {
 public:
     Private(AuditTrail* q_ptr)
         : q(q_ptr), file(nullptr), maxFileSizeBytes(10 * 1024 * 1024), // 10 MB default
-          enabled(true), nextId(1) {}
+          enabled(true), nextId(1), queueCapacity(4096), writerScheduled(false),
+          lastQueuedId(0), lastWrittenId(0), lastMsecs(0), loaded(false),
+          fileEntries(0), writtenSize(0), tornTail(false), verifiedOffset(0) {}
+
+    // An entry waiting for the writer
+    struct PendingLine {
+        quint64 id;
+        qint64 msecs;
+        QByteArray previousHash; // Chain head before this entry
+        QByteArray line;         // Fields, hash and newline
+    };
+
+    // Time of an entry and where its line starts
+    struct IndexPoint {
+        qint64 msecs;
+        qint64 offset;
+    };
 
     AuditTrail* q;
-    mutable QMutex mutex; // Protect access to log file and entries list
-    QFile* file;
+    mutable QMutex mutex; // Protects everything below except the file the writer owns
+    QFile* file;          // Writer only, or with the queue drained
     QString logFilePath;
     qint64 maxFileSizeBytes;
     bool enabled;
     quint64 nextId;
-    QList<AuditEntry> recentEntries; // Keep a short-term in-memory list if needed, or just use file
-
-    // Helper to open the log file
-    bool openLogFile() {
-        if (!enabled) return false;
-
-        if (file && file->isOpen()) {
-            return true; // Already open
-        }
 
+    // Group commit queue
+    QList<PendingLine> queue;
+    int queueCapacity;
+    bool writerScheduled;
+    quint64 lastQueuedId;
+    quint64 lastWrittenId;
+    mutable QWaitCondition queueNotFull;
+    mutable QWaitCondition written; // The writer finished a group
+
+    // State of the current file, loaded from it on first use
+    QByteArray chainHead;   // Hash of the last queued entry
+    qint64 lastMsecs;       // Time of the last queued entry
+    bool loaded;
+    QVector<IndexPoint> index; // Sorted by time
+    quint64 fileEntries;
+    qint64 writtenSize;     // Bytes of whole lines in the file
+    bool tornTail;          // The file ends inside a line
+
+    // Where the last successful integrity check stopped, and the hash there
+    mutable qint64 verifiedOffset;
+    mutable QByteArray verifiedHash;
+
+    // Helper to pick the default path when none is set
+    void ensurePath() {
         if (logFilePath.isEmpty()) {
             // Generate default path
             QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
@@ -53,60 +163,178 @@ public:
             if (!dir.exists()) dir.mkpath(".");
             logFilePath = dir.filePath("audit_trail.log");
         }
+    }
 
-        file = new QFile(logFilePath);
-        bool opened = file->open(QIODevice::Append | QIODevice::Text);
-        if (!opened) {
-            LOG_ERROR("Failed to open audit log file: " << file->errorString());
-            delete file;
-            file = nullptr;
-            return false;
+    // Read the current file once for its last ID, chain head and time index.
+    // Called with the mutex held and nothing queued for this file.
+    void ensureLoadedLocked() {
+        if (loaded) return;
+        loaded = true;
+        ensurePath();
+        chainHead = ChainSeed;
+        index.clear();
+        fileEntries = 0;
+        writtenSize = 0;
+        tornTail = false;
+        verifiedOffset = 0;
+        verifiedHash.clear();
+
+        QFile readFile(logFilePath);
+        if (!readFile.open(QIODevice::ReadOnly)) return;
+        qint64 offset = 0;
+        while (!readFile.atEnd()) {
+            const QByteArray line = readFile.readLine();
+            if (!line.endsWith('\n')) {
+                tornTail = true; // Cut off by a crash; the next write ends it first
+                break;
+            }
+            QByteArray fields, hash;
+            AuditEntry entry;
+            if (line.startsWith("# Chain: ")) {
+                chainHead = line.mid(9).trimmed();
+            } else if (splitLine(line, fields, hash) && parseEntry(fields, entry)) {
+                addToIndexLocked(entry.timestamp.toMSecsSinceEpoch(), offset);
+                chainHead = hash;
+                nextId = qMax(nextId, entry.id + 1);
+                lastMsecs = qMax(lastMsecs, entry.timestamp.toMSecsSinceEpoch());
+            }
+            offset += line.size();
         }
+        writtenSize = offset;
+    }
 
-        // Optionally, write a header or separator if file was just created/reopened
-        if (file->size() == 0) {
-            QTextStream stream(file);
-            stream << "# QuantilyxDoc Audit Trail\n";
-            stream << "# Format: ID|Timestamp|Type|User|Document|Action|Details|IP|Result|SessionID\n";
-            stream.flush();
-        }
+    void addToIndexLocked(qint64 msecs, qint64 offset) {
+        if (fileEntries % IndexStride == 0) index.append({ msecs, offset });
+        ++fileEntries;
+    }
 
-        LOG_INFO("Opened audit log file: " << logFilePath);
-        return true;
+    // Byte offset to start reading entries at or after a time
+    qint64 seekLocked(const QDateTime& startTime) const {
+        if (!startTime.isValid() || index.isEmpty()) return 0;
+        const qint64 msecs = startTime.toMSecsSinceEpoch();
+        // Last point before the time; entries between it and the next point may match
+        auto it = std::lower_bound(index.constBegin(), index.constEnd(), msecs,
+                                   [](const IndexPoint& point, qint64 value) { return point.msecs < value; });
+        if (it == index.constBegin()) return 0;
+        return (it - 1)->offset;
+    }
+
+    // Queue an entry, waiting for room. Called with the mutex held.
+    void enqueueLocked(AuditEntry& entry) {
+        while (queue.size() >= queueCapacity) queueNotFull.wait(&mutex);
+        ensureLoadedLocked();
+
+        entry.id = nextId++;
+        // Entries stay in time order so queries can seek; a clock step
+        // backwards holds the time at the last entry
+        const qint64 now = qMax(QDateTime::currentMSecsSinceEpoch(), lastMsecs);
+        lastMsecs = now;
+        entry.timestamp = QDateTime::fromMSecsSinceEpoch(now);
+
+        PendingLine pending;
+        pending.id = entry.id;
+        pending.msecs = now;
+        pending.previousHash = chainHead;
+        const QByteArray fields = formatEntry(entry);
+        chainHead = chainHash(chainHead, fields);
+        pending.line = fields + '|' + chainHead + '\n';
+        queue.append(std::move(pending));
+        lastQueuedId = entry.id;
+
+        if (!writerScheduled) {
+            writerScheduled = true;
+            ThreadPool::ioInstance().submitDetached([this]() { drain(); }, Task::Priority::Low);
+        }
     }
 
-    // Helper to write an entry to the file
-    bool writeEntryToFile(const AuditEntry& entry) {
-        if (!file || !file->isOpen()) {
-            if (!openLogFile()) return false;
+    // Writer task: write what has queued up, one flush per group
+    void drain() {
+        QMutexLocker locker(&mutex);
+        while (!queue.isEmpty()) {
+            QList<PendingLine> group;
+            group.swap(queue);
+            queueNotFull.wakeAll();
+            const QString path = logFilePath;
+            const qint64 maxSize = maxFileSizeBytes;
+            locker.unlock();
+
+            QByteArray data;
+            QVector<IndexPoint> offsets;
+            offsets.reserve(group.size());
+            const bool ok = writeGroup(path, maxSize, group, data, offsets);
+
+            locker.relock();
+            if (ok) {
+                for (const IndexPoint& point : qAsConst(offsets)) addToIndexLocked(point.msecs, point.offset);
+                writtenSize = offsets.last().offset + group.last().line.size();
+            } else {
+                LOG_ERROR("AuditTrail: Failed to write " << group.size() << " audit events to " << path);
+            }
+            lastWrittenId = group.last().id;
+            written.wakeAll();
         }
+        writerScheduled = false;
+        written.wakeAll();
+    }
+
+    // Write a group to the file, rotating first if the file is full.
+    // Writer only; fills the offset of each line for the index.
+    bool writeGroup(const QString& path, qint64 maxSize, const QList<PendingLine>& group,
+                    QByteArray& data, QVector<IndexPoint>& offsets) {
+        if (!openLogFile(path, group.first().previousHash)) return false;
 
         // Check file size and rotate if necessary
-        if (file->size() >= maxFileSizeBytes) {
+        if (file->size() >= maxSize) {
             rotateLog();
-            if (!openLogFile()) return false; // Re-open new file
+            if (!openLogFile(path, group.first().previousHash)) return false; // Re-open new file
         }
 
-        QTextStream stream(file);
-        // Format: ID|Timestamp|Type|User|Document|Action|Details|IP|Result|SessionID
-        // Use a delimiter unlikely to appear in data, or escape/quote fields properly.
-        // For simplicity here, we'll use a pipe, assuming user/document names don't contain it often.
-        stream << entry.id << "|"
-               << entry.timestamp.toString(Qt::ISODateWithMs) << "|"
-               << static_cast<int>(entry.type) << "|"
-               << entry.user << "|"
-               << entry.documentPath << "|"
-               << entry.action << "|"
-               << entry.details << "|"
-               << entry.ipAddress.toString() << "|"
-               << entry.result << "|"
-               << entry.sessionId << "\n";
-        stream.flush(); // Ensure data is written
+        qint64 offset = file->size();
+        if (tornTail) {
+            data.append('\n');
+            ++offset;
+            tornTail = false;
+        }
+        for (const PendingLine& pending : group) {
+            offsets.append({ pending.msecs, offset });
+            data.append(pending.line);
+            offset += pending.line.size();
+        }
+        if (file->write(data) != data.size()) {
+            LOG_ERROR("Failed to write audit log: " << file->errorString());
+            return false;
+        }
+        return file->flush(); // Ensure data is written
+    }
+
+    // Helper to open the log file; a new file records the hash its chain starts from
+    bool openLogFile(const QString& path, const QByteArray& chainStart) {
+        if (file && file->isOpen() && file->fileName() == path) {
+            return true; // Already open
+        }
+        delete file;
+
+        file = new QFile(path);
+        bool opened = file->open(QIODevice::Append);
+        if (!opened) {
+            LOG_ERROR("Failed to open audit log file: " << file->errorString());
+            delete file;
+            file = nullptr;
+            return false;
+        }
 
-        // Optionally, keep a small in-memory cache
-        // recentEntries.append(entry);
-        // if (recentEntries.size() > 100) recentEntries.removeFirst(); // Keep last 100
+        // Write a header if file was just created
+        if (file->size() == 0) {
+            QByteArray header;
+            header += "# QuantilyxDoc Audit Trail\n";
+            header += "# Format: ID|Timestamp|Type|User|Document|Action|Details|IP|Result|SessionID|Hash\n";
+            header += "# Chain: " + chainStart + "\n";
+            file->write(header);
+            QMutexLocker locker(&mutex);
+            writtenSize = file->size();
+        }
 
+        LOG_INFO("Opened audit log file: " << path);
         return true;
     }
 
@@ -115,15 +343,32 @@ public:
         if (!file || !file->isOpen()) return;
 
         file->close();
-        QString oldPath = logFilePath;
-        QString newPath = logFilePath + "." + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".old";
+        QString oldPath = file->fileName();
+        QString newPath = oldPath + "." + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".old";
         QFile::rename(oldPath, newPath); // Rename current to timestamped old file
         LOG_INFO("Rotated audit log: " << oldPath << " -> " << newPath);
-        emit q->logRotated();
+        {
+            // The index and integrity checkpoint described the old file
+            QMutexLocker locker(&mutex);
+            index.clear();
+            fileEntries = 0;
+            writtenSize = 0;
+            tornTail = false;
+            verifiedOffset = 0;
+            verifiedHash.clear();
+        }
+        QMetaObject::invokeMethod(q, "logRotated", Qt::QueuedConnection);
+    }
+
+    // Wait until everything queued so far is written. Called with the mutex held.
+    void waitWrittenLocked() const {
+        const quint64 target = lastQueuedId;
+        while (lastWrittenId < target) written.wait(&mutex);
     }
 
     // Helper to convert EventType enum to string for logging/reading
-    QString eventTypeToString(EventType type) {
+    QString eventTypeToString(AuditEntry::EventType type) {
+        using EventType = AuditEntry::EventType;
         switch (type) {
             case EventType::DocumentOpen: return "DOC_OPEN";
             case EventType::DocumentSave: return "DOC_SAVE";
@@ -156,6 +401,7 @@ AuditTrail::AuditTrail(QObject* parent)
     , d(new Private(this))
 {
     d->logFilePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/audit_trail.log";
+    d->queueCapacity = qMax(1, Settings::instance().value<int>("Advanced/AuditQueueSize", 4096));
     // Ensure directory exists
     QFileInfo info(d->logFilePath);
     QDir dir(info.absolutePath());
@@ -166,6 +412,11 @@ AuditTrail::AuditTrail(QObject* parent)
 
 AuditTrail::~AuditTrail()
 {
+    {
+        // The writer task uses d; let it finish what is queued
+        QMutexLocker locker(&d->mutex);
+        while (d->writerScheduled) d->written.wait(&d->mutex);
+    }
     if (d->file && d->file->isOpen()) {
         d->file->close();
     }
@@ -174,27 +425,22 @@ AuditTrail::~AuditTrail()
 
 bool AuditTrail::logEvent(const AuditEntry& entry)
 {
-    if (!d->enabled) return true; // Silently succeed if disabled
+    if (!isEnabled()) return true; // Silently succeed if disabled
 
-    QMutexLocker locker(&d->mutex);
-    AuditEntry mutableEntry = entry; // Copy to set ID
-    mutableEntry.id = d->nextId++;
-    mutableEntry.timestamp = QDateTime::currentDateTime();
-
-    bool success = d->writeEntryToFile(mutableEntry);
-    if (success) {
-        emit eventLogged(mutableEntry);
-    } else {
-        LOG_ERROR("Failed to log audit event: " << mutableEntry.action);
+    AuditEntry mutableEntry = entry; // Copy to set ID and time
+    {
+        QMutexLocker locker(&d->mutex);
+        d->enqueueLocked(mutableEntry);
     }
-    return success;
+    emit eventLogged(mutableEntry);
+    return true;
 }
 
 bool AuditTrail::logEvent(AuditEntry::EventType type, const QString& user, Document* document,
                           const QString& action, const QString& details,
                           const QString& result, const QVariantMap& extraData)
 {
-    if (!d->enabled) return true;
+    if (!isEnabled()) return true;
 
     AuditEntry entry;
     entry.type = type;
@@ -211,49 +457,47 @@ bool AuditTrail::logEvent(AuditEntry::EventType type, const QString& user, Docum
     return logEvent(entry);
 }
 
+void AuditTrail::flush()
+{
+    QMutexLocker locker(&d->mutex);
+    d->waitWrittenLocked();
+}
+
 QList<AuditEntry> AuditTrail::getEntries(const QDateTime& startTime, const QDateTime& endTime,
                                          const QString& userFilter, const QString& docPathFilter,
                                          AuditEntry::EventType typeFilter, int limit) const
 {
-    QMutexLocker locker(&d->mutex);
     QList<AuditEntry> results;
+    QString path;
+    qint64 offset = 0;
+    qint64 size = 0;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->waitWrittenLocked(); // Include what was logged before the call
+        d->ensureLoadedLocked();
+        path = d->logFilePath;
+        offset = d->seekLocked(startTime);
+        size = d->writtenSize;
+    }
 
-    // This is a simplified implementation that reads the log file.
-    // For performance with large logs, an index or database would be better.
-    QFile readFile(d->logFilePath);
-    if (!readFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    // Entries are in time order; start at the index point before startTime
+    // and stop after endTime. The writer only appends past size.
+    QFile readFile(path);
+    if (!readFile.open(QIODevice::ReadOnly)) {
         LOG_ERROR("Failed to open audit log for reading: " << readFile.errorString());
         return results;
     }
+    if (!readFile.seek(offset)) return results;
 
-    QTextStream stream(&readFile);
-    QString line;
-    while (readFile.canReadLine()) {
-        line = readFile.readLine();
-        if (line.startsWith('#')) continue; // Skip header/comment lines
-
-        QStringList parts = line.split('|');
-        if (parts.size() < 10) continue; // Malformed line
-
-        bool ok;
+    while (readFile.pos() < size && !readFile.atEnd()) {
+        const QByteArray line = readFile.readLine();
+        QByteArray fields, hash;
         AuditEntry entry;
-        entry.id = parts[0].toULongLong(&ok);
-        if (!ok) continue;
-        entry.timestamp = QDateTime::fromString(parts[1], Qt::ISODateWithMs);
-        if (!entry.timestamp.isValid()) continue;
-        entry.type = static_cast<AuditEntry::EventType>(parts[2].toInt(&ok));
-        if (!ok) continue;
-        entry.user = parts[3];
-        entry.documentPath = parts[4];
-        entry.action = parts[5];
-        entry.details = parts[6];
-        entry.ipAddress = QHostAddress(parts[7]);
-        entry.result = parts[8];
-        entry.sessionId = parts[9];
+        if (!splitLine(line, fields, hash) || !parseEntry(fields, entry)) continue;
 
         // Apply filters
         if (startTime.isValid() && entry.timestamp < startTime) continue;
-        if (endTime.isValid() && entry.timestamp > endTime) continue;
+        if (endTime.isValid() && entry.timestamp > endTime) break;
         if (!userFilter.isEmpty() && entry.user != userFilter) continue;
         if (!docPathFilter.isEmpty() && entry.documentPath != docPathFilter) continue;
         if (typeFilter != AuditEntry::EventType::Unknown && entry.type != typeFilter) continue;
@@ -273,21 +517,11 @@ QList<AuditEntry> AuditTrail::getEntries(const QDateTime& startTime, const QDate
 
 quint64 AuditTrail::entryCount() const
 {
-    // This requires counting lines in the file or maintaining a counter.
-    // Counting lines is slow for large files.
-    // A better approach is to maintain a counter in memory and persist it.
-    // For now, we'll count lines.
+    // Entries of the current file, counted as they are written
     QMutexLocker locker(&d->mutex);
-    QFile countFile(d->logFilePath);
-    if (!countFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return 0;
-    }
-    quint64 count = 0;
-    while (countFile.readLine().size() > 0) {
-        if (!countFile.atEnd()) count++; // Read one past the last line
-    }
-    if (!countFile.readLine().isEmpty()) count++; // Count the last line if it doesn't end with \n
-    return count;
+    d->waitWrittenLocked();
+    d->ensureLoadedLocked();
+    return d->fileEntries;
 }
 
 QString AuditTrail::logFilePath() const
@@ -300,10 +534,13 @@ void AuditTrail::setLogFilePath(const QString& path)
 {
     QMutexLocker locker(&d->mutex);
     if (d->logFilePath != path) {
+        // Entries queued so far belong in the old file
+        d->waitWrittenLocked();
         if (d->file && d->file->isOpen()) {
             d->file->close();
         }
         d->logFilePath = path;
+        d->loaded = false;
         // Directory check is done on write
         LOG_INFO("Audit log file path changed to: " << path);
     }
@@ -353,11 +590,10 @@ void AuditTrail::purgeOldEntries()
 }
 
 bool AuditTrail::exportEntries(const QString& filePath, const QDateTime& startTime,
-                               const QString& userFilter, const QString& docPathFilter,
-                               AuditEntry::EventType typeFilter)
+                               const QDateTime& endTime, const QString& userFilter,
+                               const QString& docPathFilter, AuditEntry::EventType typeFilter)
 {
-    QMutexLocker locker(&d->mutex);
-    QList<AuditEntry> entries = getEntries(startTime, QDateTime(), userFilter, docPathFilter, typeFilter, 0);
+    QList<AuditEntry> entries = getEntries(startTime, endTime, userFilter, docPathFilter, typeFilter, 0);
 
     QFile exportFile(filePath);
     if (!exportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
@@ -384,15 +620,74 @@ bool AuditTrail::exportEntries(const QString& filePath, const QDateTime& startTi
     return true;
 }
 
-bool AuditTrail::verifyIntegrity() const
+bool AuditTrail::verifyIntegrity(bool fullCheck) const
 {
-    // This is a basic check. A full implementation would require:
-    // 1. Writing a hash/checksum for each entry or blocks of entries.
-    // 2. Storing the hash securely (e.g., signed file, separate file).
-    // 3. Re-calculating and comparing hashes on verification.
-    LOG_WARN("verifyIntegrity: Basic implementation only. Full tamper-proofing requires cryptographic checksums per entry/block.");
-    QFile verifyFile(d->logFilePath);
-    return verifyFile.exists() && verifyFile.size() > 0;
+    QString path;
+    qint64 offset = 0;
+    qint64 size = 0;
+    QByteArray expected;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->waitWrittenLocked();
+        d->ensureLoadedLocked();
+        path = d->logFilePath;
+        size = d->writtenSize;
+        if (!fullCheck && d->verifiedOffset > 0 && d->verifiedOffset <= size) {
+            offset = d->verifiedOffset;
+            expected = d->verifiedHash;
+        }
+    }
+
+    auto fail = [this](const QString& message) {
+        LOG_ERROR("AuditTrail: " << message);
+        emit d->q->integrityCheckFailed(message);
+        return false;
+    };
+
+    QFile verifyFile(path);
+    if (!verifyFile.open(QIODevice::ReadOnly)) return fail(QStringLiteral("Cannot read the audit log: %1").arg(verifyFile.errorString()));
+    if (verifyFile.size() < size) return fail(QStringLiteral("The audit log is shorter than what was written"));
+
+    QByteArray previous;
+    if (offset > 0) {
+        // The line before the checkpoint must still end the chain that was verified
+        const qint64 back = qMin<qint64>(offset, 4096);
+        verifyFile.seek(offset - back);
+        QByteArray tail = verifyFile.read(back);
+        tail.chop(1);
+        const QByteArray lastLine = tail.mid(tail.lastIndexOf('\n') + 1);
+        QByteArray fields, hash;
+        if (lastLine.startsWith("# Chain: ")) hash = lastLine.mid(9).trimmed();
+        else splitLine(lastLine, fields, hash);
+        if (hash != expected) {
+            return fail(QStringLiteral("The audit log changed before offset %1").arg(offset));
+        }
+        previous = expected;
+        verifyFile.seek(offset);
+    }
+
+    qint64 position = offset;
+    while (position < size && !verifyFile.atEnd()) {
+        const QByteArray line = verifyFile.readLine();
+        QByteArray fields, hash;
+        if (line.startsWith("# Chain: ")) {
+            previous = line.mid(9).trimmed();
+        } else if (splitLine(line, fields, hash)) {
+            if (previous.isEmpty()) return fail(QStringLiteral("The audit log has no chain header"));
+            if (chainHash(previous, fields) != hash) {
+                return fail(QStringLiteral("Audit log entry at offset %1 does not match its hash").arg(position));
+            }
+            previous = hash;
+        }
+        position += line.size();
+    }
+
+    QMutexLocker locker(&d->mutex);
+    if (d->logFilePath == path && !previous.isEmpty()) {
+        d->verifiedOffset = position;
+        d->verifiedHash = previous;
+    }
+    return true;
 }
 
 bool AuditTrail::signLog() const
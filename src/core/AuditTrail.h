@@ -60,6 +60,11 @@ struct AuditEntry {
  * Logs significant events like document opens, saves, edits, user logins,
  * and security-related actions to a secure, tamper-evident log file.
  * Supports filtering and querying the log.
+ *
+ * Events are queued and written by a background task in groups, one flush
+ * per group. Each line carries a SHA-256 hash chained to the line before
+ * it, and a sparse in-memory index of entry times lets time-range queries
+ * seek instead of reading the whole file.
  */
 class AuditTrail : public QObject
 {
@@ -85,8 +90,10 @@ public:
 
     /**
      * @brief Log an event to the audit trail.
+     * The entry is queued for the background writer; when the queue is full
+     * (Advanced/AuditQueueSize) this waits for room rather than drop it.
      * @param entry The audit entry to log.
-     * @return True if logging was successful.
+     * @return True if the entry was queued.
      */
     bool logEvent(const AuditEntry& entry);
 
@@ -122,6 +129,11 @@ public:
                                  AuditEntry::EventType typeFilter = AuditEntry::EventType::Unknown,
                                  int limit = 0) const;
 
+    /**
+     * @brief Wait until every queued entry is written and flushed.
+     */
+    void flush();
+
     /**
      * @brief Get the total number of entries in the log.
      * @return Entry count.
@@ -187,10 +199,13 @@ public:
                        AuditEntry::EventType typeFilter = AuditEntry::EventType::Unknown);
 
     /**
-     * @brief Verify the integrity of the audit log file.
-     * @return True if the log appears unmodified since last verification/checksum.
+     * @brief Verify the hash chain of the audit log file.
+     * By default only the lines added since the last successful check are
+     * hashed, after confirming the last checked line is unchanged.
+     * @param fullCheck Rehash the whole file instead.
+     * @return True if the chain is intact.
      */
-    bool verifyIntegrity() const;
+    bool verifyIntegrity(bool fullCheck = false) const;
 
     /**
      * @brief Sign the current audit log file with a digital signature (if enabled).
@@ -219,6 +234,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static AuditTrail* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -8,8 +8,10 @@
  * (at your option) any later version.
  */
 #include "BackupManager.h"
+#include "ChunkStore.h"
 #include "Document.h"
 #include "Logger.h"
+#include "ThreadPool.h"
 #include <QTimer>
 #include <QDir>
 #include <QFileInfo>
@@ -19,7 +21,11 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QCoreApplication>
+#include <QTemporaryFile>
 #include <QThread>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <atomic>
 
 namespace QuantilyxDoc {
 
@@ -29,34 +35,42 @@ public:
         : autoSaveIntervalSecs(300) // Default 5 minutes
         , maxBackupsPerDoc(5)
         , enabled(true)
-        , autoSaveTimer(nullptr) {}
+        , autoSaveTimer(nullptr)
+        , store(QDir()) {}
 
     QMutex mutex; // Protect access to watchedDocs and backupDir
+    QMutex storeMutex; // Serializes backups, restores and chunk cleanup; taken before mutex
     QHash<Document*, QString> watchedDocs; // Maps Document* to its original path
     QDir backupDir;
     int autoSaveIntervalSecs;
     int maxBackupsPerDoc;
     bool enabled;
     QTimer* autoSaveTimer;
+    ChunkStore store;
+    QHash<Document*, std::shared_ptr<std::atomic_bool>> activeBackups; // Cancel flags of running background backups; GUI thread only
 
-    // Helper to generate a unique backup filename
+    // Helper to generate a unique backup filename; backups are chunk manifests
     QString generateBackupFilename(const QString& originalPath, const QDateTime& timestamp) {
         QFileInfo info(originalPath);
         QString baseName = info.completeBaseName();
-        QString suffix = info.suffix();
         QString timestampStr = timestamp.toString("yyyyMMdd_hhmmss");
         QString hashPart = QCryptographicHash::hash(originalPath.toUtf8(), QCryptographicHash::Md5).toHex().left(8);
-        if (suffix.isEmpty()) {
-            return QString("%1_backup_%2_%3").arg(baseName, timestampStr, hashPart);
-        } else {
-            return QString("%1_backup_%2_%3.%4").arg(baseName, timestampStr, hashPart, suffix);
-        }
+        return QString("%1_backup_%2_%3.qbm").arg(baseName, timestampStr, hashPart);
+    }
+
+    // Delete the chunks no manifest uses any more. Called with storeMutex held.
+    void collectGarbage(const QDir& dir) {
+        QStringList manifests;
+        for (const QString& name : dir.entryList({QStringLiteral("*.qbm")}, QDir::Files)) manifests.append(dir.filePath(name));
+        store.setRoot(dir);
+        const int removed = store.collectGarbage(manifests);
+        if (removed > 0) LOG_DEBUG("Removed " << removed << " unreferenced backup chunks");
     }
 
-    // Helper to clean up old backups for a specific document path
-    void cleanupOldBackupsForPath(const QString& originalPath) {
-        QMutexLocker locker(&mutex);
-        if (!backupDir.exists()) return;
+    // Helper to clean up old backups for a specific document path.
+    // Called with mutex held; returns how many backups were removed.
+    int cleanupOldBackupsForPath(const QString& originalPath) {
+        if (!backupDir.exists()) return 0;
 
         QString escapedOriginalBasename = QFileInfo(originalPath).completeBaseName();
         // Escape characters that might be interpreted by regex in file filters
@@ -69,17 +83,20 @@ public:
         std::reverse(backupFiles.begin(), backupFiles.end());
 
         int filesToRemove = backupFiles.size() - maxBackupsPerDoc;
-        if (filesToRemove <= 0) return; // Within limit
+        if (filesToRemove <= 0) return 0; // Within limit
 
+        int removed = 0;
         for (int i = 0; i < filesToRemove; ++i) {
             QString fullPath = backupDir.filePath(backupFiles[i]);
             QFile file(fullPath);
             if (file.remove()) {
                 LOG_DEBUG("Removed old backup: " << fullPath);
+                ++removed;
             } else {
                 LOG_WARN("Failed to remove old backup: " << fullPath << ", Error: " << file.errorString());
             }
         }
+        return removed;
     }
 };
 
@@ -100,6 +117,7 @@ BackupManager::BackupManager(QObject* parent)
 {
     d->backupDir.setPath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/backups");
     QDir().mkpath(d->backupDir.absolutePath()); // Ensure directory exists
+    d->store.setRoot(d->backupDir);
 
     d->autoSaveTimer = new QTimer(this);
     d->autoSaveTimer->setSingleShot(false);
@@ -117,7 +135,7 @@ BackupManager::~BackupManager()
 
 void BackupManager::watchDocument(Document* doc)
 {
-    if (!doc || !doc->filePath().isEmpty()) return;
+    if (!doc || doc->filePath().isEmpty()) return;
 
     QMutexLocker locker(&d->mutex);
     if (!d->watchedDocs.contains(doc)) {
@@ -153,38 +171,161 @@ bool BackupManager::saveNow(Document* doc)
 {
     if (!doc || !isEnabled()) return false;
 
-    QMutexLocker locker(&d->mutex);
-    QString originalPath = d->watchedDocs.value(doc);
+    QString originalPath;
+    QDir dir;
+    {
+        QMutexLocker locker(&d->mutex);
+        originalPath = d->watchedDocs.value(doc);
+        dir = d->backupDir;
+    }
     if (originalPath.isEmpty()) {
         LOG_WARN("Document is not being watched: " << doc->filePath());
         return false;
     }
 
-    // Determine temporary backup path
-    QString backupFileName = d->generateBackupFilename(originalPath, QDateTime::currentDateTime());
-    QString backupPath = d->backupDir.filePath(backupFileName);
-
-    // Attempt to save document to backup location
-    // This assumes the Document class has a save method that can save to a different path
-    // In a real scenario, you might want to copy the original file directly or implement
-    // a 'saveAs' functionality in the Document class.
-    // For now, let's assume doc->save(backupPath) exists.
-    // If not, you'd need to implement a method to serialize the document's internal state
-    // or copy the original file if it hasn't been modified since last save.
-    // This is a simplification.
-    bool success = doc->save(backupPath);
+    // The manager mutex stays free while the document is written and chunked
+    QMutexLocker storeLocker(&d->storeMutex);
+    const QDateTime now = QDateTime::currentDateTime();
+    const QString backupPath = dir.filePath(d->generateBackupFilename(originalPath, now));
+
+    // Documents only serialize to a file, so the document is staged in the
+    // backup directory and only the chunks that changed are kept from it
+    QDir().mkpath(dir.filePath("staging"));
+    QTemporaryFile staging(dir.filePath("staging/XXXXXX." + QFileInfo(originalPath).suffix()));
+    if (!staging.open()) {
+        LOG_ERROR("Failed to create backup staging file in: " << dir.absolutePath() << ", Error: " << staging.errorString());
+        emit backupFailed(doc, staging.errorString());
+        return false;
+    }
+    staging.close(); // Keeps the name; the document writes it by path
 
-    if (success) {
-        LOG_INFO("Backup created: " << backupPath);
-        emit backupCreated(doc, backupPath);
-        // Cleanup old backups for this document path
-        d->cleanupOldBackupsForPath(originalPath);
-    } else {
+    if (!doc->save(staging.fileName())) {
         LOG_ERROR("Failed to create backup for: " << originalPath << ", Error: " << doc->lastError());
         emit backupFailed(doc, doc->lastError());
+        return false;
     }
 
-    return success;
+    ChunkStore::Manifest manifest;
+    manifest.originalPath = originalPath;
+    manifest.title = doc->title();
+    manifest.timestamp = now;
+    qint64 written = 0;
+    d->store.setRoot(dir);
+    if (!d->store.storeFile(staging.fileName(), manifest, &written)
+        || !d->store.writeManifest(backupPath, manifest)) {
+        LOG_ERROR("Failed to create backup for: " << originalPath << ", Error: " << d->store.errorString());
+        emit backupFailed(doc, d->store.errorString());
+        return false;
+    }
+
+    LOG_INFO("Backup created: " << backupPath << " (" << written << " of " << manifest.size << " bytes new)");
+    emit backupCreated(doc, backupPath);
+
+    // Cleanup old backups for this document path, then the chunks only they used
+    int removed;
+    {
+        QMutexLocker locker(&d->mutex);
+        removed = d->cleanupOldBackupsForPath(originalPath);
+    }
+    if (removed > 0) d->collectGarbage(dir);
+    return true;
+}
+
+bool BackupManager::backupInBackground(Document* doc)
+{
+    if (!doc || !isEnabled() || d->activeBackups.contains(doc)) return false;
+
+    QString originalPath;
+    QDir dir;
+    {
+        QMutexLocker locker(&d->mutex);
+        originalPath = d->watchedDocs.value(doc);
+        dir = d->backupDir;
+    }
+    if (originalPath.isEmpty()) return false;
+
+    // Everything the job needs is taken here; the document may change or go away while it runs
+    Document::SnapshotWriter writer = doc->captureSnapshot();
+    if (!writer) return false;
+    const QString title = doc->title();
+    const QDateTime now = QDateTime::currentDateTime();
+    const QString backupPath = dir.filePath(d->generateBackupFilename(originalPath, now));
+    auto cancelled = std::make_shared<std::atomic_bool>(false);
+    d->activeBackups.insert(doc, cancelled);
+
+    QPointer<Document> guard(doc);
+    Private* priv = d.get(); // The manager is a singleton; it outlives the I/O pool's jobs
+    ThreadPool::ioInstance().submitDetached([this, priv, doc, guard, writer, title, now, backupPath, originalPath, dir, cancelled]() {
+        auto finish = [this, priv, doc, guard, cancelled](const QString& path, const QString& error) {
+            QMetaObject::invokeMethod(this, [this, priv, doc, guard, cancelled, path, error]() {
+                if (priv->activeBackups.value(doc) == cancelled) priv->activeBackups.remove(doc);
+                if (!guard) return; // Closed while it was backed up
+                if (error.isEmpty()) emit backupCreated(doc, path);
+                else emit backupFailed(doc, error);
+            }, Qt::QueuedConnection);
+        };
+        const auto isCancelled = [cancelled]() { return cancelled->load(); };
+
+        QMutexLocker storeLocker(&priv->storeMutex);
+        QDir().mkpath(dir.filePath("staging"));
+        QTemporaryFile staging(dir.filePath("staging/XXXXXX." + QFileInfo(originalPath).suffix()));
+        if (!staging.open()) {
+            LOG_ERROR("Failed to create backup staging file in: " << dir.absolutePath() << ", Error: " << staging.errorString());
+            finish(QString(), staging.errorString());
+            return;
+        }
+        staging.close();
+        if (!writer(staging.fileName(), isCancelled)) {
+            const QString error = isCancelled() ? QStringLiteral("Cancelled") : QStringLiteral("Failed to write document snapshot");
+            if (!isCancelled()) LOG_ERROR("Failed to create backup for: " << originalPath << ", Error: " << error);
+            finish(QString(), error);
+            return;
+        }
+
+        // Progress is posted at most every 100 ms so the event loop is not flooded
+        QElapsedTimer sincePost;
+        sincePost.start();
+        const ChunkStore::Progress progress = [this, doc, guard, cancelled, &sincePost](qint64 done, qint64 total) {
+            if (cancelled->load()) return false;
+            if (done == total || sincePost.elapsed() >= 100) {
+                sincePost.restart();
+                QMetaObject::invokeMethod(this, [this, doc, guard, done, total]() {
+                    if (guard) emit backupProgress(doc, done, total);
+                }, Qt::QueuedConnection);
+            }
+            return true;
+        };
+
+        ChunkStore::Manifest manifest;
+        manifest.originalPath = originalPath;
+        manifest.title = title;
+        manifest.timestamp = now;
+        qint64 written = 0;
+        priv->store.setRoot(dir);
+        if (!priv->store.storeFile(staging.fileName(), manifest, &written, progress)
+            || !priv->store.writeManifest(backupPath, manifest)) {
+            if (!isCancelled()) LOG_ERROR("Failed to create backup for: " << originalPath << ", Error: " << priv->store.errorString());
+            finish(QString(), priv->store.errorString());
+            priv->collectGarbage(dir); // Chunks a cancelled store already wrote
+            return;
+        }
+        LOG_INFO("Backup created: " << backupPath << " (" << written << " of " << manifest.size << " bytes new)");
+
+        int removed;
+        {
+            QMutexLocker locker(&priv->mutex);
+            removed = priv->cleanupOldBackupsForPath(originalPath);
+        }
+        if (removed > 0) priv->collectGarbage(dir);
+        finish(backupPath, QString());
+    }, Task::Priority::Low);
+    return true;
+}
+
+void BackupManager::cancelBackup(Document* doc)
+{
+    const auto cancelled = d->activeBackups.value(doc);
+    if (cancelled) cancelled->store(true);
 }
 
 QDir BackupManager::backupDirectory() const
@@ -230,12 +371,13 @@ int BackupManager::maxBackupsPerDocument() const
 
 void BackupManager::setMaxBackupsPerDocument(int count)
 {
-    QMutexLocker locker(&d->mutex);
-    if (count > 0 && d->maxBackupsPerDoc != count) {
+    {
+        QMutexLocker locker(&d->mutex);
+        if (count <= 0 || d->maxBackupsPerDoc == count) return;
         d->maxBackupsPerDoc = count;
         LOG_INFO("Max backups per document changed to " << count << ". Cleaning up now.");
-        cleanupOldBackups(); // Clean up immediately based on new limit
     }
+    cleanupOldBackups(); // Clean up immediately based on new limit
 }
 
 bool BackupManager::isEnabled() const
@@ -282,9 +424,17 @@ QList<BackupInfo> BackupManager::getBackupsForDocument(Document* doc) const
         QFileInfo fileInfo(fullPath);
         BackupInfo info;
         info.filePath = fullPath;
-        info.timestamp = fileInfo.lastModified(); // Or extract from filename if more precise
-        info.originalSize = fileInfo.size();
-        info.documentTitle = doc->title();
+        ChunkStore::Manifest manifest;
+        if (ChunkStore::readManifest(fullPath, manifest)) {
+            info.timestamp = manifest.timestamp;
+            info.originalSize = manifest.size;
+            info.documentTitle = manifest.title;
+        } else {
+            // A full copy from before backups were chunked
+            info.timestamp = fileInfo.lastModified(); // Or extract from filename if more precise
+            info.originalSize = fileInfo.size();
+            info.documentTitle = doc->title();
+        }
         backups.append(info);
     }
     return backups;
@@ -292,13 +442,26 @@ QList<BackupInfo> BackupManager::getBackupsForDocument(Document* doc) const
 
 bool BackupManager::restoreFromBackup(const QString& backupFilePath, const QString& targetDocumentPath)
 {
-    QMutexLocker locker(&d->mutex);
+    QMutexLocker storeLocker(&d->storeMutex);
     QFile backupFile(backupFilePath);
     if (!backupFile.exists()) {
         LOG_ERROR("Backup file does not exist: " << backupFilePath);
         return false;
     }
 
+    ChunkStore::Manifest manifest;
+    if (ChunkStore::readManifest(backupFilePath, manifest)) {
+        // Chunks live next to the manifest
+        d->store.setRoot(QFileInfo(backupFilePath).absoluteDir());
+        if (!d->store.restore(manifest, targetDocumentPath)) {
+            LOG_ERROR("Failed to restore backup: " << backupFilePath << " -> " << targetDocumentPath << ", Error: " << d->store.errorString());
+            return false;
+        }
+        LOG_INFO("Document restored from backup: " << backupFilePath << " -> " << targetDocumentPath);
+        emit documentRestored(targetDocumentPath, backupFilePath);
+        return true;
+    }
+
     // Attempt to copy the backup file to the target path
     QFile targetFile(targetDocumentPath);
     if (targetFile.exists()) {
@@ -318,11 +481,18 @@ bool BackupManager::restoreFromBackup(const QString& backupFilePath, const QStri
 
 void BackupManager::cleanupOldBackups()
 {
-    QMutexLocker locker(&d->mutex);
-    // Iterate through all watched documents and clean up their backups
-    for (auto it = d->watchedDocs.constBegin(); it != d->watchedDocs.constEnd(); ++it) {
-        d->cleanupOldBackupsForPath(it.value());
+    QMutexLocker storeLocker(&d->storeMutex);
+    int removed = 0;
+    QDir dir;
+    {
+        QMutexLocker locker(&d->mutex);
+        // Iterate through all watched documents and clean up their backups
+        for (auto it = d->watchedDocs.constBegin(); it != d->watchedDocs.constEnd(); ++it) {
+            removed += d->cleanupOldBackupsForPath(it.value());
+        }
+        dir = d->backupDir;
     }
+    if (removed > 0) d->collectGarbage(dir);
     emit cleanupFinished();
 }
 
@@ -330,6 +500,7 @@ void BackupManager::purgeBackupsForDocument(Document* doc)
 {
     if (!doc) return;
 
+    QMutexLocker storeLocker(&d->storeMutex);
     QMutexLocker locker(&d->mutex);
     QString originalPath = d->watchedDocs.value(doc);
     if (originalPath.isEmpty()) return; // Not watched
@@ -351,10 +522,14 @@ void BackupManager::purgeBackupsForDocument(Document* doc)
         }
     }
     LOG_INFO("Purged " << purgedCount << " backups for document: " << originalPath);
+    const QDir dir = d->backupDir;
+    locker.unlock();
+    d->collectGarbage(dir);
 }
 
 void BackupManager::purgeAllBackups()
 {
+    QMutexLocker storeLocker(&d->storeMutex);
     QMutexLocker locker(&d->mutex);
     QStringList backupFiles = d->backupDir.entryList(QDir::Files | QDir::NoDotAndDotDot);
 
@@ -369,59 +544,30 @@ void BackupManager::purgeAllBackups()
         }
     }
     LOG_INFO("Purged all " << purgedCount << " backup files.");
+    const QDir dir = d->backupDir;
+    locker.unlock();
+    d->collectGarbage(dir); // No manifests are left, so this empties the chunk store
 }
 
 void BackupManager::onAutoSaveTimer()
 {
-    // Run auto-save for all watched documents
-    QMutexLocker locker(&d->mutex);
-    if (!d->enabled) return;
-
-    for (auto it = d->watchedDocs.constBegin(); it != d->watchedDocs.constEnd(); ++it) {
-        Document* doc = it.key();
-        // Only save if the document is modified (or always, depending on strategy)
-        if (doc && doc->isModified()) {
-             // We cannot call saveNow here directly as it locks again. We unlock first.
-             // A better design might involve queuing these saves on the main thread.
-             // For simplicity in this example, we'll call it, assuming re-entrancy is handled carefully elsewhere.
-             // In practice, consider using QMetaObject::invokeMethod to post the save request.
-             QCoreApplication::postEvent(this, new QEvent(static_cast<QEvent::Type>(QEvent::User + 1))); // Custom event
-             // Or, for direct call (less safe if saveNow also locks):
-             // locker.unlock(); // Temporarily unlock
-             // saveNow(doc);
-             // locker.relock(); // Re-lock
+    // Run auto-save for all watched documents; saveNow() takes the lock itself
+    QList<Document*> modified;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (!d->enabled) return;
+        for (auto it = d->watchedDocs.constBegin(); it != d->watchedDocs.constEnd(); ++it) {
+            Document* doc = it.key();
+            // Only save if the document is modified (or always, depending on strategy)
+            if (doc && doc->isModified()) modified.append(doc);
         }
     }
+    for (Document* doc : qAsConst(modified)) {
+        // A running backup will be followed by the next tick; documents
+        // without a snapshot are written out here as before
+        if (d->activeBackups.contains(doc)) continue;
+        if (!backupInBackground(doc)) saveNow(doc);
+    }
 }
 
-// To handle the posted event safely:
-// bool BackupManager::event(QEvent *e) {
-//     if (e->type() == QEvent::User + 1) {
-//         // Re-implement the auto-save loop here with proper locking.
-//         // This avoids recursive locking.
-//         return true;
-//     }
-//     return QObject::event(e);
-// }
-
-// For now, simplify the timer slot to avoid recursive lock issues in this example snippet:
-// Instead of calling saveNow directly, just emit a signal to trigger it on the main thread
-// where the document modification check can happen safely.
-// This requires adding a signal like void requestAutoSave(Document*) and connecting it.
-// For brevity, we'll adjust the timer slot to emit such a signal for each modified doc.
-// void BackupManager::onAutoSaveTimer() {
-//     QMutexLocker locker(&d->mutex);
-//     if (!d->enabled) return;
-//
-//     for (auto it = d->watchedDocs.constBegin(); it != d->watchedDocs.constEnd(); ++it) {
-//         Document* doc = it.key();
-//         if (doc && doc->isModified()) {
-//              emit requestAutoSave(doc);
-//         }
-//     }
-// }
-
-// Assuming the signal requestAutoSave is added to the header and connected appropriately,
-// the actual saveNow call happens on the main thread safely.
-
 } // namespace QuantilyxDoc
\ No newline at end of file
@@ -33,6 +33,12 @@ struct BackupInfo {
  *
  * Handles periodic auto-saves and maintains backup copies in a designated
  * directory. Can restore documents from backups if the original is lost/corrupted.
+ *
+ * Backups are deduplicated: each one is a small manifest (.qbm) listing
+ * content-defined chunks kept once in a ChunkStore under the backup
+ * directory, so a backup writes only what changed since the last one.
+ * Auto-saves run in the background from a snapshot of the document, so a
+ * large document does not stall the UI while it is stored.
  */
 class BackupManager : public QObject
 {
@@ -75,6 +81,24 @@ public:
      */
     bool saveNow(Document* doc);
 
+    /**
+     * @brief Back up a document without blocking the caller.
+     *
+     * The document's state is captured on the calling thread
+     * (Document::captureSnapshot()); writing, chunking and storing it run on
+     * the I/O pool. The result arrives as backupCreated() or backupFailed().
+     * @param doc The document to back up.
+     * @return False if the document cannot be snapshotted or a backup of it
+     * is already running; use saveNow() for the former.
+     */
+    bool backupInBackground(Document* doc);
+
+    /**
+     * @brief Cancel a running background backup; it ends with backupFailed().
+     * @param doc The document whose backup to cancel.
+     */
+    void cancelBackup(Document* doc);
+
     /**
      * @brief Get the backup directory path.
      * @return Path to the backup directory.
@@ -169,6 +193,14 @@ signals:
      */
     void backupFailed(Document* doc, const QString& error);
 
+    /**
+     * @brief Emitted as a background backup stores the document.
+     * @param doc The document being backed up.
+     * @param done Bytes stored so far.
+     * @param total Size of the document.
+     */
+    void backupProgress(Document* doc, qint64 done, qint64 total);
+
     /**
      * @brief Emitted when a document is restored from backup.
      * @param originalPath Original document path.
@@ -187,6 +219,8 @@ private slots:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static BackupManager* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,133 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "BandedRenderer.h"
+#include "CancellationToken.h"
+#include "ImageBufferPool.h"
+#include "Page.h"
+#include "PixelFormat.h"
+#include "ThreadPool.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QWaitCondition>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Shared by the caller and the helper tasks; helpers that start after every
+// band was claimed only touch this, never the page.
+struct BandJob {
+    Page* page = nullptr;
+    int width = 0;
+    qreal scale = 1.0;
+    QVector<int> edges;          // Band i spans rows edges[i] to edges[i + 1]
+    QVector<QImage> bands;
+    QAtomicInt nextBand;
+    QMutex mutex;
+    QWaitCondition finished;
+    int remaining = 0;
+
+    int bandCount() const { return edges.size() - 1; }
+
+    // Render unclaimed bands until none are left. Helpers run under the
+    // caller's token, so once it is canceled the remaining bands are only
+    // counted off.
+    void drain() {
+        int index;
+        while ((index = nextBand.fetchAndAddOrdered(1)) < bandCount()) {
+            const int top = edges.at(index);
+            const int height = edges.at(index + 1) - top;
+            // A region of exactly width x height pixels at the shared scale
+            const QRectF region(0, top / scale, width / scale, height / scale);
+            QImage band;
+            if (!CancellationToken::currentIsCanceled()) {
+                band = page->renderRectangle(region, width, height);
+            }
+
+            QMutexLocker locker(&mutex);
+            bands[index] = band;
+            if (--remaining == 0) {
+                finished.wakeAll();
+            }
+        }
+    }
+};
+
+} // namespace
+
+qint64 BandedRenderer::thresholdPixels()
+{
+    const qint64 megapixels = Settings::snapshot().bandedRenderMegapixels;
+    return megapixels > 0 ? megapixels * 1000 * 1000 : 0;
+}
+
+bool BandedRenderer::shouldBand(const Page* page, const QSize& size)
+{
+    if (!page || !page->rendersRegionsDirectly() || size.height() < 2 * MinBandHeight) return false;
+    const qint64 threshold = thresholdPixels();
+    return threshold > 0 && static_cast<qint64>(size.width()) * size.height() >= threshold;
+}
+
+QImage BandedRenderer::render(Page* page, const QSize& size)
+{
+    const QSizeF pageSize = page ? page->size() : QSizeF();
+    if (pageSize.isEmpty() || size.isEmpty()) return QImage();
+
+    const int bandCount = qBound(1, size.height() / MinBandHeight, qMax(1, ThreadPool::instance().maxThreadCount()));
+    if (bandCount < 2) {
+        return page->render(size.width(), size.height());
+    }
+
+    auto job = std::make_shared<BandJob>();
+    job->page = page;
+    job->width = size.width();
+    job->scale = qMin(size.width() / pageSize.width(), size.height() / pageSize.height());
+    for (int i = 0; i <= bandCount; ++i) {
+        job->edges.append(static_cast<int>(static_cast<qint64>(size.height()) * i / bandCount));
+    }
+    job->bands.resize(bandCount);
+    job->remaining = bandCount;
+
+    for (int i = 1; i < bandCount; ++i) {
+        ThreadPool::instance().submitDetached([job]() { job->drain(); }, Task::Priority::High);
+    }
+    job->drain();
+    {
+        // Every band is claimed by now; wait for the ones still rendering
+        QMutexLocker locker(&job->mutex);
+        while (job->remaining > 0) {
+            job->finished.wait(&job->mutex);
+        }
+    }
+
+    if (CancellationToken::currentIsCanceled()) return QImage();
+
+    QImage result = ImageBufferPool::instance().acquire(size);
+    if (result.isNull()) return QImage();
+    result.fill(Qt::white);
+    for (int i = 0; i < bandCount; ++i) {
+        const QImage& band = job->bands.at(i);
+        if (band.isNull()) {
+            LOG_ERROR("BandedRenderer: Band " << i << " of page " << page->pageIndex() << " failed to render.");
+            return QImage();
+        }
+        // Copied by the kernel of the band's format; no painter to set up per page
+        PixelFormat::composite(result, QPoint(0, job->edges.at(i)), band);
+    }
+    LOG_DEBUG("BandedRenderer: Rendered page " << page->pageIndex() << " at " << size << " in " << bandCount << " bands.");
+    return result;
+}
+
+} // namespace QuantilyxDoc
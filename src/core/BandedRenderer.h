@@ -0,0 +1,63 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_BANDEDRENDERER_H
+#define QUANTILYX_BANDEDRENDERER_H
+
+#include <QImage>
+#include <QSize>
+
+namespace QuantilyxDoc {
+
+class Page;
+
+/**
+ * @brief Renders one large page as horizontal bands on several cores.
+ *
+ * The page is cut into bands that are rasterized concurrently with
+ * Page::renderRectangle() on the shared ThreadPool and composited into a
+ * single image. The calling thread renders bands as well and only waits
+ * for bands other threads have already started, so it is safe to call
+ * from a ThreadPool task. Only pages that rasterize regions directly are
+ * banded; for the others every band would cost a full-page render.
+ */
+class BandedRenderer
+{
+public:
+    /**
+     * @brief Minimum height of a band in pixels.
+     */
+    static constexpr int MinBandHeight = 256;
+
+    /**
+     * @brief Get the pixel count above which whole-page renders are banded.
+     * @return Threshold in pixels (Advanced/BandedRenderMegapixels, 0 disables banding).
+     */
+    static qint64 thresholdPixels();
+
+    /**
+     * @brief Check if a render of a page at a size should be banded.
+     * @param page Page to render.
+     * @param size Target size in pixels, unrotated.
+     * @return True if the render is large enough and the page renders regions directly.
+     */
+    static bool shouldBand(const Page* page, const QSize& size);
+
+    /**
+     * @brief Render a whole page in bands.
+     * @param page Page to render.
+     * @param size Target size in pixels, unrotated.
+     * @return Composited image, or a null image if a band failed.
+     */
+    static QImage render(Page* page, const QSize& size);
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_BANDEDRENDERER_H
@@ -0,0 +1,254 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "BinaryLog.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+namespace BinaryLog {
+
+bool readVarint(const char*& pos, const char* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        const quint8 byte = quint8(*pos++);
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void forEachLiteral(const QByteArray& args, const std::function<void(quint32)>& visit)
+{
+    const char* pos = args.constData();
+    const char* end = pos + args.size();
+    quint64 value;
+    while (pos < end) {
+        const char tag = *pos++;
+        switch (tag) {
+        case LiteralArg:
+            if (!readVarint(pos, end, value)) return;
+            visit(quint32(value));
+            break;
+        case StringArg:
+            if (!readVarint(pos, end, value) || quint64(end - pos) < value) return;
+            pos += value;
+            break;
+        case SignedArg:
+        case UnsignedArg:
+        case PointerArg:
+            if (!readVarint(pos, end, value)) return;
+            break;
+        case DoubleArg:
+            pos += qMin<qint64>(end - pos, qint64(sizeof(double)));
+            break;
+        case BoolArg:
+        case CharArg:
+            if (pos < end) ++pos;
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+QString decodeArguments(const QByteArray& args, const std::function<QString(quint32)>& literal)
+{
+    QString text;
+    const char* pos = args.constData();
+    const char* end = pos + args.size();
+    quint64 value;
+    while (pos < end) {
+        const char tag = *pos++;
+        switch (tag) {
+        case LiteralArg:
+            if (!readVarint(pos, end, value)) return text;
+            text += literal(quint32(value));
+            break;
+        case StringArg:
+            if (!readVarint(pos, end, value) || quint64(end - pos) < value) return text;
+            text += QString::fromUtf8(pos, int(value));
+            pos += value;
+            break;
+        case SignedArg:
+            if (!readVarint(pos, end, value)) return text;
+            text += QString::number(unzigzag(value));
+            break;
+        case UnsignedArg:
+            if (!readVarint(pos, end, value)) return text;
+            text += QString::number(value);
+            break;
+        case DoubleArg: {
+            if (end - pos < qint64(sizeof(double))) return text;
+            double number;
+            std::memcpy(&number, pos, sizeof(double));
+            pos += sizeof(double);
+            text += QString::number(number, 'g', 6); // As std::ostream prints it
+            break;
+        }
+        case BoolArg:
+            if (pos >= end) return text;
+            text += QLatin1Char(*pos++ ? '1' : '0');
+            break;
+        case CharArg:
+            if (pos >= end) return text;
+            text += QLatin1Char(*pos++);
+            break;
+        case PointerArg:
+            if (!readVarint(pos, end, value)) return text;
+            text += QStringLiteral("0x") + QString::number(value, 16);
+            break;
+        default:
+            return text; // Unknown tag; the rest cannot be parsed
+        }
+    }
+    return text;
+}
+
+} // namespace BinaryLog
+
+class BinaryLogReader::Private {
+public:
+    QFile file;
+    QByteArray data; // Whole file; logs are read once, front to back
+    const char* pos = nullptr;
+    const char* end = nullptr;
+    qint64 lastTimestamp = 0;
+    QHash<quint32, QString> literals;
+    QString error;
+
+    QString literal(quint32 id) const {
+        return literals.value(id, QStringLiteral("<?%1>").arg(id));
+    }
+};
+
+BinaryLogReader::BinaryLogReader()
+    : d(new Private())
+{
+}
+
+BinaryLogReader::~BinaryLogReader() = default;
+
+bool BinaryLogReader::open(const QString& path)
+{
+    d->file.setFileName(path);
+    if (!d->file.open(QIODevice::ReadOnly)) {
+        d->error = d->file.errorString();
+        return false;
+    }
+    d->data = d->file.readAll();
+    BinaryLog::FileHeader header;
+    if (d->data.size() < int(sizeof(header))) {
+        d->error = QStringLiteral("File is too short for a binary log");
+        return false;
+    }
+    std::memcpy(&header, d->data.constData(), sizeof(header));
+    if (header.magic != BinaryLog::Magic || header.version != BinaryLog::Version) {
+        d->error = QStringLiteral("Not a binary log, or a version this build cannot read");
+        return false;
+    }
+    d->pos = d->data.constData() + sizeof(header);
+    d->end = d->data.constData() + d->data.size();
+    d->lastTimestamp = 0;
+    d->literals.clear();
+    d->error.clear();
+    return true;
+}
+
+bool BinaryLogReader::next(Entry& entry)
+{
+    auto truncated = [this]() {
+        d->error = QStringLiteral("Truncated record at offset %1").arg(d->pos - d->data.constData());
+        return false;
+    };
+
+    while (d->pos && d->pos < d->end) {
+        const quint8 type = quint8(*d->pos++);
+        quint64 a, b;
+        if (type == BinaryLog::DefinitionRecord) {
+            if (!BinaryLog::readVarint(d->pos, d->end, a) || !BinaryLog::readVarint(d->pos, d->end, b)
+                || quint64(d->end - d->pos) < b) {
+                return truncated();
+            }
+            d->literals.insert(quint32(a), QString::fromUtf8(d->pos, int(b)));
+            d->pos += b;
+            continue;
+        }
+        if (type == BinaryLog::SessionRecord) {
+            // A new process run: its literal IDs and times start over
+            if (!BinaryLog::readVarint(d->pos, d->end, a)) return truncated();
+            d->lastTimestamp = qint64(a);
+            d->literals.clear();
+            continue;
+        }
+        if (type != BinaryLog::MessageRecord) {
+            d->error = QStringLiteral("Unknown record type %1").arg(type);
+            return false;
+        }
+
+        if (d->pos >= d->end) return truncated();
+        entry.level = quint8(*d->pos++);
+        quint64 delta, thread, fileId, line, functionId, argsLength;
+        if (!BinaryLog::readVarint(d->pos, d->end, delta) || !BinaryLog::readVarint(d->pos, d->end, thread)
+            || !BinaryLog::readVarint(d->pos, d->end, fileId) || !BinaryLog::readVarint(d->pos, d->end, line)
+            || !BinaryLog::readVarint(d->pos, d->end, functionId) || !BinaryLog::readVarint(d->pos, d->end, argsLength)
+            || quint64(d->end - d->pos) < argsLength) {
+            return truncated();
+        }
+        d->lastTimestamp += BinaryLog::unzigzag(delta);
+        entry.timestamp = d->lastTimestamp;
+        entry.threadId = thread;
+        entry.file = fileId ? QFileInfo(d->literal(quint32(fileId - 1))).fileName() : QString();
+        entry.line = int(line);
+        entry.function = functionId ? d->literal(quint32(functionId - 1)) : QString();
+        const QByteArray args(d->pos, int(argsLength));
+        d->pos += argsLength;
+        entry.message = BinaryLog::decodeArguments(args, [this](quint32 id) { return d->literal(id); });
+        return true;
+    }
+    return false;
+}
+
+QString BinaryLogReader::errorString() const
+{
+    return d->error;
+}
+
+QString BinaryLogReader::toText(const Entry& entry)
+{
+    static const char* const levels[] = { "DEBUG", "INFO ", "WARN ", "ERROR", "CRIT " };
+    QString line = QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString("[yyyy-MM-dd HH:mm:ss.zzz] ");
+    line += QStringLiteral("[%1] ").arg(QLatin1String(entry.level >= 0 && entry.level < 5 ? levels[entry.level] : "?????"));
+    line += QStringLiteral("[Thread 0x%1] ").arg(entry.threadId, 0, 16);
+    if (!entry.function.isEmpty()) line += QStringLiteral("[%1] ").arg(entry.function);
+    if (!entry.file.isEmpty() && entry.line > 0) line += QStringLiteral("[%1:%2] ").arg(entry.file).arg(entry.line);
+    line += entry.message;
+    return line;
+}
+
+QJsonObject BinaryLogReader::toJson(const Entry& entry)
+{
+    static const char* const levels[] = { "debug", "info", "warning", "error", "critical" };
+    QJsonObject object;
+    object.insert("level", QLatin1String(entry.level >= 0 && entry.level < 5 ? levels[entry.level] : "unknown"));
+    object.insert("time", QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString(Qt::ISODateWithMs));
+    object.insert("thread", QStringLiteral("0x%1").arg(entry.threadId, 0, 16));
+    if (!entry.file.isEmpty()) {
+        object.insert("file", entry.file);
+        object.insert("line", entry.line);
+    }
+    if (!entry.function.isEmpty()) object.insert("function", entry.function);
+    object.insert("message", entry.message);
+    return object;
+}
+
+} // namespace QuantilyxDoc
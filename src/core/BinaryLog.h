@@ -0,0 +1,178 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_BINARYLOG_H
+#define QUANTILYX_BINARYLOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Compact log encoding shared by Logger and the log decoder.
+ *
+ * A message is kept as its arguments, not as text: string literals by an
+ * interned ID, numbers raw, other strings as UTF-8. The same encoding is
+ * what LogStream builds on the calling thread, so streaming a value
+ * costs a few byte appends.
+ *
+ * A binary log file starts with a FileHeader and holds three kinds of
+ * records. A session record starts the output of one process run: literal
+ * IDs are per process, and message times count from its timestamp. A
+ * definition record gives the text of a literal ID the first time the
+ * session uses it, so every file decodes on its own. A message record
+ * holds the level, a zigzag varint of the time since the previous message,
+ * the thread ID, the file, line and function of the call site, and the
+ * arguments.
+ */
+namespace BinaryLog {
+
+const quint32 Magic = 0x51584C47; // 'QXLG'
+const quint16 Version = 1;
+
+struct FileHeader {
+    quint32 magic;
+    quint16 version;
+    quint16 reserved;
+};
+
+// Record tags
+enum RecordType : quint8 {
+    DefinitionRecord = 1, // varint ID, varint length, UTF-8 text
+    MessageRecord = 2,    // level byte, then varints: time delta, thread, file ID + 1, line, function ID + 1, argument bytes
+    SessionRecord = 3     // varint milliseconds since the epoch
+};
+
+// Argument tags
+enum ArgumentType : char {
+    LiteralArg = 'L',  // varint literal ID
+    StringArg = 'S',   // varint length, UTF-8 bytes
+    SignedArg = 'i',   // zigzag varint
+    UnsignedArg = 'u', // varint
+    DoubleArg = 'd',   // 8 bytes, host order
+    BoolArg = 'b',     // 1 byte
+    CharArg = 'c',     // 1 byte
+    PointerArg = 'p'   // varint
+};
+
+inline void appendVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+inline quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+inline qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+/**
+ * @brief Read a varint.
+ * @param pos Read position; advanced past the varint.
+ * @param end End of the data.
+ * @param value Receives the value.
+ * @return False if the data ends inside the varint.
+ */
+bool readVarint(const char*& pos, const char* end, quint64& value);
+
+/**
+ * @brief Call a function for each literal ID the encoded arguments use.
+ * @param args Encoded arguments.
+ * @param visit Called with each ID, in order.
+ */
+void forEachLiteral(const QByteArray& args, const std::function<void(quint32)>& visit);
+
+/**
+ * @brief Turn encoded arguments into the text streaming them would have given.
+ * @param args Encoded arguments.
+ * @param literal Text of a literal ID.
+ * @return Message text.
+ */
+QString decodeArguments(const QByteArray& args, const std::function<QString(quint32)>& literal);
+
+} // namespace BinaryLog
+
+/**
+ * @brief Reads a binary log file back, for the log decoder.
+ */
+class BinaryLogReader
+{
+public:
+    /**
+     * @brief One decoded message.
+     */
+    struct Entry {
+        int level = 0;          // LogLevel value
+        qint64 timestamp = 0;   // Milliseconds since the epoch
+        quint64 threadId = 0;
+        QString file;
+        int line = 0;
+        QString function;
+        QString message;
+    };
+
+    BinaryLogReader();
+    ~BinaryLogReader();
+
+    /**
+     * @brief Open a binary log file.
+     * @param path File path.
+     * @return True if it is one.
+     */
+    bool open(const QString& path);
+
+    /**
+     * @brief Read the next message.
+     * @param entry Receives the message.
+     * @return False at the end of the file, or at a truncated record.
+     */
+    bool next(Entry& entry);
+
+    /**
+     * @brief Get the reason open() or next() failed.
+     * @return Error text; empty at a clean end of file.
+     */
+    QString errorString() const;
+
+    /**
+     * @brief Format a message as a text log line.
+     * @param entry Message.
+     * @return Line without a newline.
+     */
+    static QString toText(const Entry& entry);
+
+    /**
+     * @brief Format a message as a JSON object.
+     * @param entry Message.
+     * @return Object with level, time, thread, file, line, function and message.
+     */
+    static QJsonObject toJson(const Entry& entry);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_BINARYLOG_H
@@ -0,0 +1,63 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "CancellationToken.h"
+
+namespace QuantilyxDoc {
+
+namespace {
+
+thread_local CancellationToken t_current;
+
+} // namespace
+
+CancellationToken CancellationToken::create(const CancellationToken& parent)
+{
+    CancellationToken token;
+    token.d = std::make_shared<State>();
+    token.d->parent = parent.d;
+    return token;
+}
+
+void CancellationToken::cancel() const
+{
+    if (d) d->canceled.store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::isCanceled() const
+{
+    // Chains are a task and the few it spawned, so walking them is cheap
+    for (const State* state = d.get(); state; state = state->parent.get()) {
+        if (state->canceled.load(std::memory_order_relaxed)) return true;
+    }
+    return false;
+}
+
+CancellationToken CancellationToken::current()
+{
+    return t_current;
+}
+
+bool CancellationToken::currentIsCanceled()
+{
+    return t_current.isCanceled();
+}
+
+CancellationScope::CancellationScope(const CancellationToken& token)
+    : previous(t_current)
+{
+    t_current = token;
+}
+
+CancellationScope::~CancellationScope()
+{
+    t_current = previous;
+}
+
+} // namespace QuantilyxDoc
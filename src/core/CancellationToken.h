@@ -0,0 +1,109 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_CANCELLATIONTOKEN_H
+#define QUANTILYX_CANCELLATIONTOKEN_H
+
+#include <atomic>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Cooperative cancellation of work that is already running.
+ *
+ * Long operations check isCanceled() at fine granularity (per band, per
+ * word, per page pair) and return early. Copies share one flag. A token
+ * created while another is current is its child: canceling the parent
+ * cancels it as well, so work a canceled task fans out stops with it.
+ *
+ * Each thread has a current token, installed by CancellationScope. Tasks run by
+ * ThreadPool, helpers of ThreadPool::forEach and render workers run
+ * under their own, so code deep in a call, such as a Page::render
+ * backend, asks CancellationToken::current() instead of being handed one
+ * through every signature. A default token is never canceled and costs
+ * nothing to check.
+ */
+class CancellationToken
+{
+public:
+    /**
+     * @brief Construct a token that is never canceled.
+     */
+    CancellationToken() = default;
+
+    /**
+     * @brief Create a cancelable token.
+     * @param parent Token whose cancellation cancels this one; the current one by default.
+     * @return New token.
+     */
+    static CancellationToken create(const CancellationToken& parent = current());
+
+    /**
+     * @brief Cancel the token and its children. Does nothing on a default token.
+     */
+    void cancel() const;
+
+    /**
+     * @brief Check if the token or one of its parents was canceled. Safe from any thread.
+     * @return True once canceled.
+     */
+    bool isCanceled() const;
+
+    /**
+     * @brief Check if the token can be canceled at all.
+     * @return False for a default token.
+     */
+    bool isCancelable() const { return d != nullptr; }
+
+    /**
+     * @brief Get the token of the operation the calling thread is running.
+     * @return Current token; a default one outside any CancellationScope.
+     */
+    static CancellationToken current();
+
+    /**
+     * @brief Shorthand for current().isCanceled(), for checks in inner loops.
+     * @return True if the calling thread's operation was canceled.
+     */
+    static bool currentIsCanceled();
+
+private:
+    friend class CancellationScope;
+
+    struct State {
+        std::atomic<bool> canceled{false};
+        std::shared_ptr<const State> parent;
+    };
+    std::shared_ptr<State> d;
+};
+
+/**
+ * @brief Makes a token the calling thread's current one for its lifetime.
+ */
+class CancellationScope
+{
+public:
+    /**
+     * @brief Install a token; the previous one is restored on destruction.
+     * @param token Token for the work done in this scope.
+     */
+    explicit CancellationScope(const CancellationToken& token);
+    ~CancellationScope();
+
+    CancellationScope(const CancellationScope&) = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+
+private:
+    CancellationToken previous;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_CANCELLATIONTOKEN_H
@@ -0,0 +1,365 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ChunkStore.h"
+#include "Logger.h"
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const int MinChunk = 16 * 1024;
+const int AverageChunk = 64 * 1024;
+const int MaxChunk = 256 * 1024;
+const int ReadSize = 1024 * 1024;
+
+// Stricter mask below the average size and looser above it, which keeps
+// chunk sizes close to the average (normalized chunking)
+const quint64 MaskSmall = 0xa52a529529400000ull; // 18 bits
+const quint64 MaskLarge = 0x9244924892400000ull; // 14 bits
+
+const quint32 ManifestMagic = 0x5158424D; // "QXBM"
+const quint32 ManifestVersion = 1;
+const int HashBytes = 32;
+
+struct ManifestHeader {
+    quint32 magic;
+    quint32 version;
+    qint64 size;
+    qint64 timestamp;  // Milliseconds since the epoch
+    quint32 chunkCount;
+    quint32 pathBytes;  // UTF-8 original path, then title, follow the header
+    quint32 titleBytes;
+    quint32 reserved;
+};
+
+struct ChunkRecord {
+    char hash[HashBytes];
+    quint32 length;
+};
+
+// Random values per byte for the gear hash; fixed, since chunk boundaries
+// must come out the same in every run
+struct GearTable {
+    quint64 values[256];
+
+    GearTable() {
+        quint64 state = 0x5158424d43444331ull;
+        for (quint64& value : values) {
+            // splitmix64
+            state += 0x9e3779b97f4a7c15ull;
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            value = z ^ (z >> 31);
+        }
+    }
+};
+
+const GearTable& gearTable()
+{
+    static const GearTable table;
+    return table;
+}
+
+} // namespace
+
+class ChunkStore::Private {
+public:
+    QDir root;
+    QSet<QByteArray> known; // Chunks seen on disk or written by this store
+    QString error;
+
+    QString chunkPath(const QByteArray& hash) const {
+        const QString hex = QString::fromLatin1(hash.toHex());
+        return root.filePath(QStringLiteral("chunks/%1/%2").arg(hex.left(2), hex));
+    }
+
+    bool writeChunk(const QByteArray& data, ChunkStore::Manifest& manifest, qint64& written) {
+        ChunkStore::ChunkRef ref;
+        ref.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+        ref.length = quint32(data.size());
+        manifest.chunks.append(ref);
+        manifest.size += data.size();
+
+        if (known.contains(ref.hash)) return true;
+        const QString path = chunkPath(ref.hash);
+        if (QFileInfo(path).size() == data.size()) {
+            known.insert(ref.hash);
+            return true;
+        }
+
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            error = QStringLiteral("Failed to write chunk %1: %2").arg(path, file.errorString());
+            return false;
+        }
+        known.insert(ref.hash);
+        written += data.size();
+        return true;
+    }
+};
+
+ChunkStore::ChunkStore(const QDir& root)
+    : d(new Private())
+{
+    d->root = root;
+}
+
+ChunkStore::~ChunkStore() = default;
+
+void ChunkStore::setRoot(const QDir& root)
+{
+    if (root == d->root) return;
+    d->root = root;
+    d->known.clear();
+}
+
+bool ChunkStore::storeFile(const QString& sourcePath, Manifest& manifest, qint64* bytesWritten,
+                           const Progress& progress)
+{
+    QFile in(sourcePath);
+    if (!in.open(QIODevice::ReadOnly)) {
+        d->error = QStringLiteral("Failed to read %1: %2").arg(sourcePath, in.errorString());
+        return false;
+    }
+
+    manifest.chunks.clear();
+    manifest.size = 0;
+    qint64 written = 0;
+    const quint64* gear = gearTable().values;
+
+    QByteArray buffer(ReadSize, Qt::Uninitialized);
+    QByteArray chunk;
+    chunk.reserve(MaxChunk);
+    quint64 hash = 0;
+    qint64 n;
+    qint64 done = 0;
+    const qint64 total = in.size();
+    while ((n = in.read(buffer.data(), ReadSize)) > 0) {
+        done += n;
+        if (progress && !progress(done, total)) {
+            d->error = QStringLiteral("Cancelled");
+            return false;
+        }
+        const uchar* data = reinterpret_cast<const uchar*>(buffer.constData());
+        int start = 0; // Start of the part of the buffer not yet in chunk
+        for (int i = 0; i < int(n); ++i) {
+            hash = (hash << 1) + gear[data[i]];
+            const int length = chunk.size() + (i - start + 1);
+            if (length < MinChunk) continue;
+            const quint64 mask = length < AverageChunk ? MaskSmall : MaskLarge;
+            if ((hash & mask) != 0 && length < MaxChunk) continue;
+
+            chunk.append(buffer.constData() + start, i - start + 1);
+            start = i + 1;
+            if (!d->writeChunk(chunk, manifest, written)) return false;
+            chunk.clear();
+            hash = 0;
+        }
+        chunk.append(buffer.constData() + start, int(n) - start);
+    }
+    if (n < 0) {
+        d->error = QStringLiteral("Failed to read %1: %2").arg(sourcePath, in.errorString());
+        return false;
+    }
+    if (!chunk.isEmpty() && !d->writeChunk(chunk, manifest, written)) return false;
+
+    if (bytesWritten) *bytesWritten = written;
+    return true;
+}
+
+bool ChunkStore::writeManifest(const QString& path, const Manifest& manifest)
+{
+    const QByteArray originalPath = manifest.originalPath.toUtf8();
+    const QByteArray title = manifest.title.toUtf8();
+
+    ManifestHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = ManifestMagic;
+    header.version = ManifestVersion;
+    header.size = manifest.size;
+    header.timestamp = manifest.timestamp.toMSecsSinceEpoch();
+    header.chunkCount = quint32(manifest.chunks.size());
+    header.pathBytes = quint32(originalPath.size());
+    header.titleBytes = quint32(title.size());
+
+    QByteArray data;
+    data.reserve(int(sizeof(header)) + originalPath.size() + title.size() + manifest.chunks.size() * int(sizeof(ChunkRecord)));
+    data.append(reinterpret_cast<const char*>(&header), int(sizeof(header)));
+    data.append(originalPath);
+    data.append(title);
+    for (const ChunkRef& ref : manifest.chunks) {
+        ChunkRecord record;
+        std::memcpy(record.hash, ref.hash.constData(), HashBytes);
+        record.length = ref.length;
+        data.append(reinterpret_cast<const char*>(&record), int(sizeof(record)));
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        d->error = QStringLiteral("Failed to write manifest %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool ChunkStore::readManifest(const QString& path, Manifest& manifest)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray data = file.readAll();
+
+    ManifestHeader header;
+    if (data.size() < int(sizeof(header))) return false;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    if (header.magic != ManifestMagic || header.version != ManifestVersion) return false;
+    const qint64 expected = qint64(sizeof(header)) + header.pathBytes + header.titleBytes
+                            + qint64(header.chunkCount) * qint64(sizeof(ChunkRecord));
+    if (data.size() != expected) return false;
+
+    const char* pos = data.constData() + sizeof(header);
+    manifest.originalPath = QString::fromUtf8(pos, int(header.pathBytes));
+    pos += header.pathBytes;
+    manifest.title = QString::fromUtf8(pos, int(header.titleBytes));
+    pos += header.titleBytes;
+    manifest.timestamp = QDateTime::fromMSecsSinceEpoch(header.timestamp);
+    manifest.size = header.size;
+    manifest.chunks.clear();
+    manifest.chunks.reserve(int(header.chunkCount));
+    for (quint32 i = 0; i < header.chunkCount; ++i) {
+        ChunkRecord record;
+        std::memcpy(&record, pos, sizeof(record));
+        pos += sizeof(record);
+        ChunkRef ref;
+        ref.hash = QByteArray(record.hash, HashBytes);
+        ref.length = record.length;
+        manifest.chunks.append(ref);
+    }
+    return true;
+}
+
+bool ChunkStore::restore(const Manifest& manifest, const QString& targetPath)
+{
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly)) {
+        d->error = QStringLiteral("Failed to write %1: %2").arg(targetPath, target.errorString());
+        return false;
+    }
+
+    for (const ChunkRef& ref : manifest.chunks) {
+        const QString path = d->chunkPath(ref.hash);
+        QFile chunk(path);
+        if (!chunk.open(QIODevice::ReadOnly)) {
+            d->error = QStringLiteral("Missing chunk %1").arg(path);
+            target.cancelWriting();
+            return false;
+        }
+        const QByteArray data = chunk.readAll();
+        if (data.size() != int(ref.length) || QCryptographicHash::hash(data, QCryptographicHash::Sha256) != ref.hash) {
+            d->error = QStringLiteral("Corrupt chunk %1").arg(path);
+            d->known.remove(ref.hash);
+            target.cancelWriting();
+            return false;
+        }
+        if (target.write(data) != data.size()) {
+            d->error = QStringLiteral("Failed to write %1: %2").arg(targetPath, target.errorString());
+            target.cancelWriting();
+            return false;
+        }
+    }
+
+    if (!target.commit()) {
+        d->error = QStringLiteral("Failed to write %1: %2").arg(targetPath, target.errorString());
+        return false;
+    }
+    return true;
+}
+
+int ChunkStore::collectGarbage(const QStringList& manifestPaths)
+{
+    QSet<QString> referenced;
+    for (const QString& path : manifestPaths) {
+        Manifest manifest;
+        if (!readManifest(path, manifest)) {
+            // Deleting on a partial picture could lose chunks a backup needs
+            LOG_WARN("ChunkStore: Unreadable manifest " << path << "; skipping garbage collection.");
+            return 0;
+        }
+        for (const ChunkRef& ref : qAsConst(manifest.chunks)) referenced.insert(QString::fromLatin1(ref.hash.toHex()));
+    }
+
+    int removed = 0;
+    QDirIterator it(d->root.filePath(QStringLiteral("chunks")), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        const QString name = it.fileName();
+        if (name.size() != HashBytes * 2 || referenced.contains(name)) continue; // Also skips QSaveFile temporaries
+        if (QFile::remove(path)) {
+            d->known.remove(QByteArray::fromHex(name.toLatin1()));
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+bool ChunkStore::cloneFile(const QString& sourcePath, const QString& targetPath)
+{
+#ifdef Q_OS_LINUX
+    const int source = ::open(QFile::encodeName(sourcePath).constData(), O_RDONLY | O_CLOEXEC);
+    if (source >= 0) {
+        struct stat info;
+        const int target = fstat(source, &info) == 0
+            ? ::open(QFile::encodeName(targetPath).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, info.st_mode & 0777)
+            : -1;
+        bool copied = false;
+        if (target >= 0) {
+            copied = ioctl(target, FICLONE, source) == 0;
+            if (!copied) {
+                // No reflinks here; copy_file_range still keeps the data in the kernel
+                off_t remaining = info.st_size;
+                while (remaining > 0) {
+                    const ssize_t n = copy_file_range(source, nullptr, target, nullptr, size_t(remaining), 0);
+                    if (n <= 0) break;
+                    remaining -= n;
+                }
+                copied = remaining == 0;
+            }
+            ::close(target);
+        }
+        ::close(source);
+        if (copied) return true;
+    }
+#endif
+    if (QFile::exists(targetPath)) QFile::remove(targetPath);
+    return QFile::copy(sourcePath, targetPath);
+}
+
+QString ChunkStore::errorString() const
+{
+    return d->error;
+}
+
+} // namespace QuantilyxDoc
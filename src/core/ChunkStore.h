@@ -0,0 +1,148 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_CHUNKSTORE_H
+#define QUANTILYX_CHUNKSTORE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Deduplicating store of file contents, split at content-defined boundaries.
+ *
+ * Files are cut into chunks of 16 KB to 256 KB (64 KB on average) where a
+ * rolling gear hash of the last bytes hits a mask, so an edit only moves
+ * the boundaries next to it. Each chunk is kept once, named by its
+ * SHA-256, under chunks/ in the store directory; a stored file is a
+ * manifest listing its chunks. Storing a new version of a file writes
+ * only the chunks the edit changed.
+ *
+ * A store is not thread-safe; its owner serializes storeFile(), restore()
+ * and collectGarbage().
+ */
+class ChunkStore
+{
+public:
+    /**
+     * @brief One chunk of a stored file.
+     */
+    struct ChunkRef {
+        QByteArray hash; ///< Raw SHA-256
+        quint32 length = 0;
+    };
+
+    /**
+     * @brief A stored file: what it was and the chunks it is made of.
+     */
+    struct Manifest {
+        QString originalPath;
+        QString title;
+        QDateTime timestamp;
+        qint64 size = 0;
+        QVector<ChunkRef> chunks;
+    };
+
+    /**
+     * @brief Constructor.
+     * @param root Store directory; chunks go in its chunks/ subdirectory.
+     */
+    explicit ChunkStore(const QDir& root);
+
+    /**
+     * @brief Destructor.
+     */
+    ~ChunkStore();
+
+    /**
+     * @brief Set the store directory.
+     * @param root Store directory.
+     */
+    void setRoot(const QDir& root);
+
+    /**
+     * @brief Reports storeFile() progress.
+     * Called with the bytes read so far and the file size; returning false
+     * cancels the store.
+     */
+    using Progress = std::function<bool(qint64 done, qint64 total)>;
+
+    /**
+     * @brief Split a file into chunks and store the ones not yet stored.
+     * @param sourcePath File to store.
+     * @param manifest Receives the chunk list and size; other fields are left alone.
+     * @param bytesWritten Receives the bytes of new chunks written, if not null.
+     * @param progress Called after each read, if set.
+     * @return True on success; false on failure or when cancelled.
+     */
+    bool storeFile(const QString& sourcePath, Manifest& manifest, qint64* bytesWritten = nullptr,
+                   const Progress& progress = Progress());
+
+    /**
+     * @brief Write a manifest file.
+     * @param path Manifest path.
+     * @param manifest Manifest to write.
+     * @return True on success.
+     */
+    bool writeManifest(const QString& path, const Manifest& manifest);
+
+    /**
+     * @brief Read a manifest file.
+     * @param path Manifest path.
+     * @param manifest Receives the manifest.
+     * @return False if the file is not a manifest.
+     */
+    static bool readManifest(const QString& path, Manifest& manifest);
+
+    /**
+     * @brief Rebuild a stored file from its chunks.
+     * @param manifest Manifest of the file.
+     * @param targetPath File to write; replaced only once every chunk checked out.
+     * @return True on success.
+     */
+    bool restore(const Manifest& manifest, const QString& targetPath);
+
+    /**
+     * @brief Delete the chunks no remaining manifest refers to.
+     * @param manifestPaths Every manifest that still uses the store.
+     * @return Number of chunks deleted.
+     */
+    int collectGarbage(const QStringList& manifestPaths);
+
+    /**
+     * @brief Copy a file as cheaply as the filesystem allows.
+     * Shares the source's blocks copy-on-write where supported (reflink),
+     * else copies inside the kernel (copy_file_range), else through QFile.
+     * @param sourcePath File to copy.
+     * @param targetPath Copy to create or replace.
+     * @return True on success.
+     */
+    static bool cloneFile(const QString& sourcePath, const QString& targetPath);
+
+    /**
+     * @brief Get the reason the last operation failed.
+     * @return Error text.
+     */
+    QString errorString() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_CHUNKSTORE_H
@@ -9,6 +9,10 @@
  */
 #include "Clipboard.h"
 #include "Logger.h"
+#include "ImageCodec.h"
+#include "MemoryBudget.h"
+#include "Settings.h"
+#include "ThreadPool.h"
 #include <QApplication>
 #include <QClipboard>
 #include <QMimeData>
@@ -19,6 +23,13 @@
 #include <QMutexLocker>
 #include <QRegularExpression>
 #include <QDebug>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QVector>
 
 namespace QuantilyxDoc {
 
@@ -29,11 +40,43 @@ public:
           historyEnabled(true),
           maxHistorySizeVal(20) {}
 
+    // Clipboard data as plain values, so it can be encoded off the GUI thread
+    struct Payload {
+        QImage image;
+        QVariant color;
+        QVector<QPair<QString, QByteArray>> formats;
+
+        qint64 bytes() const {
+            qint64 size = image.sizeInBytes();
+            for (const auto& format : formats) size += format.first.size() * qint64(sizeof(QChar)) + format.second.size();
+            return size;
+        }
+    };
+
+    // A history entry: its preview, and its data in one of three places
+    struct StoredEntry {
+        quint64 id = 0;
+        HistoryEntry info;
+        std::shared_ptr<const Payload> payload; // Full data, until it is packed
+        QByteArray packed;                      // Encoded data kept in memory
+        QString spillPath;                      // Encoded data kept on disk
+        bool packing = false;
+
+        qint64 memoryBytes() const { return (payload ? payload->bytes() : 0) + packed.size(); }
+    };
+
+    static const quint32 PackMagic = 0x51584342; // 'QXCB'
+    static const int ThumbnailSize = 128;
+
     Clipboard* q;
     mutable QMutex mutex; // Protect access to history list and system clipboard connection
-    QList<HistoryEntry> history;
+    QList<StoredEntry> history;
     bool historyEnabled;
     int maxHistorySizeVal;
+    qint64 maxHistoryBytesVal = qint64(qMax(1, Settings::instance().value<int>("Advanced/ClipboardHistoryMB", 64))) * 1024 * 1024;
+    qint64 spillThreshold = qint64(Settings::instance().value<int>("Advanced/ClipboardSpillKB", 256)) * 1024;
+    quint64 nextId = 1;
+    int memoryConsumerId = 0;
 
     // Helper to get system clipboard
     QClipboard* getSystemClipboard() const {
@@ -48,61 +91,221 @@ public:
         if (!sysData) return;
 
         // Check if this exact data is already the most recent in history
-        if (!history.isEmpty() && dataEquals(history.last().data, sysData)) {
+        if (!history.isEmpty() && history.last().payload && dataEquals(*history.last().payload, sysData)) {
              LOG_DEBUG("Current clipboard data matches last history entry. Skipping.");
              return;
         }
 
-        HistoryEntry entry;
-        entry.data = cloneMimeData(sysData);
-        entry.timestamp = QDateTime::currentDateTime();
-        entry.dataType = sysData->formats().isEmpty() ? "unknown" : sysData->formats().first();
-        entry.previewText = generatePreviewText(sysData);
-        entry.dataSize = approximateDataSize(sysData);
+        // The entry before this one is no longer what a paste gives, so its data can be packed away
+        if (!history.isEmpty()) packLater(history.last());
+
+        StoredEntry entry;
+        entry.id = nextId++;
+        entry.payload = std::make_shared<const Payload>(capture(sysData));
+        entry.info.timestamp = QDateTime::currentDateTime();
+        entry.info.dataType = sysData->formats().isEmpty() ? "unknown" : sysData->formats().first();
+        entry.info.previewText = generatePreviewText(sysData);
+        entry.info.dataSize = entry.payload->bytes();
+        if (!entry.payload->image.isNull()) {
+            entry.info.thumbnail = entry.payload->image.scaled(ThumbnailSize, ThumbnailSize, Qt::KeepAspectRatio, Qt::FastTransformation);
+        }
 
         history.append(entry);
-        LOG_DEBUG("Added clipboard content to history. Type: " << entry.dataType << ", Size: " << entry.dataSize << " bytes.");
+        LOG_DEBUG("Added clipboard content to history. Type: " << entry.info.dataType << ", Size: " << entry.info.dataSize << " bytes.");
 
-        // Maintain max size
-        while (history.size() > maxHistorySizeVal) {
-            HistoryEntry oldEntry = history.takeFirst(); // Remove oldest
-            LOG_DEBUG("Evicted old clipboard history entry.");
-        }
+        trimLocked();
 
         emit q->historyChanged();
-        emit q->historyItemAdded(entry);
+        emit q->historyItemAdded(entry.info);
     }
 
-    // Helper to check if two QMimeData objects are equivalent
-    bool dataEquals(const QMimeData* a, const QMimeData* b) const {
-        if (!a && !b) return true;
-        if (!a || !b) return false;
+    // Helper to check if the newest entry holds this data
+    bool dataEquals(const Payload& a, const QMimeData* b) const {
+        if (!b) return false;
         // Compare formats and primary content (simplified check)
-        return a->formats() == b->formats() &&
-               a->text() == b->text() &&
-               a->html() == b->html() &&
-               a->hasImage() == b->hasImage(); // Could be more thorough
-    }
-
-    // Helper to deep clone QMimeData
-    QMimeData* cloneMimeData(const QMimeData* original) const {
-        if (!original) return nullptr;
-
-        QMimeData* clone = new QMimeData();
-        // Copy standard formats
-        if (original->hasText()) clone->setText(original->text());
-        if (original->hasHtml()) clone->setHtml(original->html());
-        if (original->hasImage()) clone->setImageData(original->imageData());
-        if (original->hasUrls()) clone->setUrls(original->urls());
-        if (original->hasColor()) clone->setColorData(original->colorData());
-
-        // Copy custom formats
-        for (const QString& format : original->formats()) {
-            if (!clone->hasFormat(format)) { // Avoid overwriting standard ones set above
-                clone->setData(format, original->data(format));
+        QStringList formats;
+        for (const auto& format : a.formats) formats.append(format.first);
+        const QImage image = b->hasImage() ? qvariant_cast<QImage>(b->imageData()) : QImage();
+        return formats == payloadFormats(b) &&
+               formatData(a, "text/plain") == b->data("text/plain") &&
+               formatData(a, "text/html") == b->data("text/html") &&
+               a.image.cacheKey() == image.cacheKey(); // Same shared image; a pixel compare is too slow here
+    }
+
+    static QByteArray formatData(const Payload& payload, const QString& format) {
+        for (const auto& entry : payload.formats) {
+            if (entry.first == format) return entry.second;
+        }
+        return QByteArray();
+    }
+
+    // Formats whose bytes are kept. Image data is kept once, as the image;
+    // the image/* types a platform clipboard offers are conversions of it
+    static QStringList payloadFormats(const QMimeData* data) {
+        QStringList formats;
+        const bool image = data->hasImage();
+        for (const QString& format : data->formats()) {
+            if (format == QLatin1String("application/x-qt-image") || format == QLatin1String("application/x-color")) continue;
+            if (image && format.startsWith(QLatin1String("image/"))) continue;
+            formats.append(format);
+        }
+        return formats;
+    }
+
+    static Payload capture(const QMimeData* data) {
+        Payload payload;
+        if (data->hasImage()) payload.image = qvariant_cast<QImage>(data->imageData());
+        if (data->hasColor()) payload.color = data->colorData();
+        for (const QString& format : payloadFormats(data)) payload.formats.append(qMakePair(format, data->data(format)));
+        return payload;
+    }
+
+    static QMimeData* toMimeData(const Payload& payload) {
+        QMimeData* mime = new QMimeData();
+        if (!payload.image.isNull()) mime->setImageData(payload.image);
+        if (payload.color.isValid()) mime->setColorData(payload.color);
+        for (const auto& format : payload.formats) mime->setData(format.first, format.second);
+        return mime;
+    }
+
+    // Encode a payload: the image with ImageCodec, the other formats with zlib
+    static QByteArray pack(const Payload& payload) {
+        QByteArray formats;
+        {
+            QDataStream stream(&formats, QIODevice::WriteOnly);
+            stream << payload.color << quint32(payload.formats.size());
+            for (const auto& format : payload.formats) stream << format.first << format.second;
+        }
+        const ImageCodec::Encoded image = ImageCodec::encode(payload.image);
+
+        QByteArray packed;
+        QDataStream stream(&packed, QIODevice::WriteOnly);
+        stream << PackMagic << qint32(image.width) << qint32(image.height) << qint32(image.bytesPerLine)
+               << qint32(image.format) << qint32(image.method) << image.data << qCompress(formats, 1);
+        return packed;
+    }
+
+    static bool unpack(const QByteArray& packed, Payload& payload) {
+        QDataStream stream(packed);
+        quint32 magic = 0;
+        qint32 width, height, bytesPerLine, format, method;
+        ImageCodec::Encoded image;
+        QByteArray compressed;
+        stream >> magic >> width >> height >> bytesPerLine >> format >> method >> image.data >> compressed;
+        if (stream.status() != QDataStream::Ok || magic != PackMagic) return false;
+        image.width = width;
+        image.height = height;
+        image.bytesPerLine = bytesPerLine;
+        image.format = QImage::Format(format);
+        image.method = ImageCodec::Method(method);
+        payload.image = ImageCodec::decode(image);
+        if (!image.isNull() && payload.image.isNull()) return false;
+
+        QDataStream formats(qUncompress(compressed));
+        quint32 count = 0;
+        formats >> payload.color >> count;
+        for (quint32 i = 0; i < count && formats.status() == QDataStream::Ok; ++i) {
+            QPair<QString, QByteArray> entry;
+            formats >> entry.first >> entry.second;
+            payload.formats.append(entry);
+        }
+        return formats.status() == QDataStream::Ok;
+    }
+
+    StoredEntry* findEntry(quint64 id) {
+        for (StoredEntry& entry : history) {
+            if (entry.id == id) return &entry;
+        }
+        return nullptr;
+    }
+
+    // Encode an entry's data on the I/O pool and, past the spill threshold, move it to disk.
+    // Called with mutex held.
+    void packLater(StoredEntry& entry) {
+        if (!entry.payload || entry.packing) return;
+        entry.packing = true;
+        const quint64 id = entry.id;
+        const std::shared_ptr<const Payload> payload = entry.payload;
+        const qint64 threshold = spillThreshold;
+        const QString spillPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + QStringLiteral("/clipboard/%1-%2.qcb").arg(QCoreApplication::applicationPid()).arg(id);
+        ThreadPool::ioInstance().submitDetached([this, id, payload, threshold, spillPath]() {
+            QByteArray packed = pack(*payload);
+            QString spilled;
+            if (packed.size() >= threshold) {
+                QDir().mkpath(QFileInfo(spillPath).absolutePath());
+                QFile file(spillPath);
+                if (file.open(QIODevice::WriteOnly) && file.write(packed) == packed.size()) {
+                    spilled = spillPath;
+                    packed.clear();
+                } else {
+                    // Kept in memory instead; the byte budget still bounds it
+                    LOG_WARN("Failed to spill clipboard history entry: " << spillPath << ", Error: " << file.errorString());
+                    file.remove();
+                }
             }
+
+            QMutexLocker locker(&mutex);
+            StoredEntry* entry = findEntry(id);
+            if (!entry) {
+                if (!spilled.isEmpty()) QFile::remove(spilled); // Evicted while it was packed
+                return;
+            }
+            entry->packing = false;
+            entry->payload.reset();
+            entry->packed = packed;
+            entry->spillPath = spilled;
+        }, Task::Priority::Low);
+    }
+
+    // Get an entry's full data back from wherever it is kept. Called with mutex held.
+    bool loadPayload(const StoredEntry& entry, Payload& payload) const {
+        if (entry.payload) {
+            payload = *entry.payload;
+            return true;
+        }
+        if (!entry.packed.isEmpty()) return unpack(entry.packed, payload);
+        QFile file(entry.spillPath);
+        if (entry.spillPath.isEmpty() || !file.open(QIODevice::ReadOnly)) return false;
+        return unpack(file.readAll(), payload);
+    }
+
+    static void discard(const StoredEntry& entry) {
+        if (!entry.spillPath.isEmpty()) QFile::remove(entry.spillPath);
+    }
+
+    void removeAt(int index) {
+        discard(history.at(index));
+        history.removeAt(index);
+    }
+
+    qint64 memoryBytesLocked() const {
+        qint64 total = 0;
+        for (const StoredEntry& entry : history) total += entry.memoryBytes();
+        return total;
+    }
+
+    // Drop the oldest entries past the entry count and the byte budget; the
+    // newest is kept even on its own over budget. Called with mutex held.
+    bool trimLocked() {
+        bool removed = false;
+        while (history.size() > maxHistorySizeVal) {
+            removeAt(0);
+            removed = true;
+        }
+        qint64 bytes = memoryBytesLocked();
+        while (history.size() > 1 && bytes > maxHistoryBytesVal) {
+            bytes -= history.first().memoryBytes();
+            removeAt(0);
+            removed = true;
+            LOG_DEBUG("Evicted old clipboard history entry.");
         }
-        return clone;
+        return removed;
+    }
+
+    void clearLocked() {
+        for (const StoredEntry& entry : qAsConst(history)) discard(entry);
+        history.clear();
     }
 
     // Helper to generate a short preview text
@@ -135,21 +338,6 @@ public:
         return formats.isEmpty() ? "[Unknown Data]" : "[" + formats.first() + "]";
     }
 
-    // Helper to estimate data size (very rough approximation)
-    qint64 approximateDataSize(const QMimeData* data) const {
-        if (!data) return 0;
-        qint64 size = 0;
-        if (data->hasText()) size += data->text().length() * sizeof(QChar);
-        if (data->hasHtml()) size += data->html().length() * sizeof(QChar);
-        if (data->hasImage()) {
-            QImage img = qvariant_cast<QImage>(data->imageData());
-            if (!img.isNull()) size += img.sizeInBytes();
-        }
-        size += data->urls().size() * 100; // Rough estimate per URL
-        // Add sizes for other formats if needed
-        return size;
-    }
-
     // Helper to sanitize HTML content
     QString sanitizeHtml(const QString& html) const {
         QString sanitized = html;
@@ -182,12 +370,20 @@ Clipboard::Clipboard(QObject* parent)
         connect(sysClipboard, &QClipboard::dataChanged,
                 this, &Clipboard::onSystemClipboardChanged);
     }
+
+    // History is user data, so it is the last thing shrunk under memory pressure
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "Clipboard history", MemoryBudget::Priority::High,
+        [this]() { return historyBytes(); },
+        [this](qint64 bytes) { return releaseHistoryMemory(bytes); });
 }
 
 Clipboard::~Clipboard()
 {
-    // Clear history to delete contained QMimeData objects
-    d->history.clear();
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+    // Clear history to delete spilled entries
+    QMutexLocker locker(&d->mutex);
+    d->clearLocked();
 }
 
 void Clipboard::setText(const QString& text)
@@ -305,8 +501,10 @@ void Clipboard::clear()
 
 void Clipboard::setHistoryEnabled(bool enabled)
 {
-    QMutexLocker locker(&d->mutex);
-    d->historyEnabled = enabled;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->historyEnabled = enabled;
+    }
     if (!enabled) {
         clearHistory(); // Optionally clear history when disabling
     }
@@ -321,7 +519,9 @@ bool Clipboard::isHistoryEnabled() const
 QList<Clipboard::HistoryEntry> Clipboard::history() const
 {
     QMutexLocker locker(&d->mutex);
-    return d->history; // Returns a copy
+    QList<HistoryEntry> entries;
+    for (const Private::StoredEntry& entry : d->history) entries.append(entry.info);
+    return entries;
 }
 
 int Clipboard::historySize() const
@@ -343,44 +543,90 @@ void Clipboard::setMaxHistorySize(int size)
     if (d->maxHistorySizeVal != size) {
         d->maxHistorySizeVal = size;
         // Trim history if new size is smaller
-        while (d->history.size() > d->maxHistorySizeVal) {
-            d->history.removeFirst();
-        }
+        d->trimLocked();
         LOG_DEBUG("Set clipboard history max size to " << size);
     }
 }
 
-bool Clipboard::restoreFromHistory(int index)
+qint64 Clipboard::maxHistoryBytes() const
 {
     QMutexLocker locker(&d->mutex);
-    if (index < 0 || index >= d->history.size()) {
-        LOG_WARN("Cannot restore from clipboard history: invalid index " << index);
-        return false;
+    return d->maxHistoryBytesVal;
+}
+
+void Clipboard::setMaxHistoryBytes(qint64 bytes)
+{
+    if (bytes <= 0) return;
+    bool removed;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->maxHistoryBytesVal == bytes) return;
+        d->maxHistoryBytesVal = bytes;
+        removed = d->trimLocked();
+        LOG_DEBUG("Set clipboard history byte budget to " << bytes);
+    }
+    if (removed) emit historyChanged();
+}
+
+qint64 Clipboard::historyBytes() const
+{
+    // Spilled entries cost only their preview, which is not counted
+    QMutexLocker locker(&d->mutex);
+    return d->memoryBytesLocked();
+}
+
+qint64 Clipboard::releaseHistoryMemory(qint64 bytes)
+{
+    qint64 freed = 0;
+    {
+        QMutexLocker locker(&d->mutex);
+        // Oldest first; entries already on disk free nothing and are kept
+        for (int i = 0; freed < bytes && i < d->history.size() - 1;) {
+            const qint64 held = d->history.at(i).memoryBytes();
+            if (held == 0) {
+                ++i;
+                continue;
+            }
+            freed += held;
+            d->removeAt(i);
+        }
     }
+    if (freed > 0) {
+        LOG_DEBUG("Released " << freed << " bytes of clipboard history.");
+        emit historyChanged();
+    }
+    return freed;
+}
 
+bool Clipboard::restoreFromHistory(int index)
+{
     QClipboard* sysClipboard = d->getSystemClipboard();
     if (!sysClipboard) return false;
 
-    const HistoryEntry& entry = d->history.at(index);
-    if (!entry.data) {
-        LOG_WARN("Cannot restore from clipboard history: null data at index " << index);
-        return false;
+    Private::Payload payload;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (index < 0 || index >= d->history.size()) {
+            LOG_WARN("Cannot restore from clipboard history: invalid index " << index);
+            return false;
+        }
+        // Decoded only now that it is pasted
+        if (!d->loadPayload(d->history.at(index), payload)) {
+            LOG_WARN("Cannot restore from clipboard history: data lost at index " << index);
+            return false;
+        }
     }
 
-    // Clone the data from history to set on the system clipboard
-    QMimeData* clonedData = d->cloneMimeData(entry.data);
-    if (clonedData) {
-        sysClipboard->setMimeData(clonedData); // System clipboard takes ownership
-        LOG_DEBUG("Restored clipboard content from history index " << index);
-        return true;
-    }
-    return false;
+    // The clipboard reports the change straight back into onSystemClipboardChanged(), so the lock is released first
+    sysClipboard->setMimeData(Private::toMimeData(payload)); // System clipboard takes ownership
+    LOG_DEBUG("Restored clipboard content from history index " << index);
+    return true;
 }
 
 void Clipboard::clearHistory()
 {
     QMutexLocker locker(&d->mutex);
-    d->history.clear();
+    d->clearLocked();
     emit historyChanged();
     LOG_DEBUG("Cleared clipboard history.");
 }
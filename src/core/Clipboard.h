@@ -14,6 +14,7 @@
 #include <QMimeData>
 #include <QImage>
 #include <QByteArray>
+#include <QDateTime>
 #include <QUrl>
 #include <memory>
 
@@ -25,6 +26,13 @@ namespace QuantilyxDoc {
  * Provides a higher-level interface for interacting with the system clipboard,
  * handling complex data types relevant to document editing (e.g., formatted text,
  * images, document fragments) and managing clipboard history.
+ *
+ * History entries keep only their preview in memory once they are no
+ * longer the newest. Their data is then encoded on the I/O pool (images
+ * with ImageCodec, the rest with zlib), and large payloads are spilled to
+ * the cache directory; it is decoded again only when the entry is
+ * restored. The history is capped both in entries and in the bytes it
+ * holds in memory.
  */
 class Clipboard : public QObject
 {
@@ -35,14 +43,11 @@ public:
      * @brief Represents an entry in the clipboard history.
      */
     struct HistoryEntry {
-        QMimeData* data;                  // The clipboard data
         QDateTime timestamp;              // When it was added
         QString previewText;              // Short preview string
+        QImage thumbnail;                 // Small preview of image data, null otherwise
         QString dataType;                 // Primary data type (e.g., "text/plain", "image/png", "application/pdf")
-        qint64 dataSize;                  // Approximate size in bytes
-
-        HistoryEntry() : data(nullptr), dataSize(0) {}
-        ~HistoryEntry() { delete data; } // Ensure data is cleaned up
+        qint64 dataSize = 0;              // Approximate size of the full data in bytes
     };
 
     /**
@@ -188,11 +193,38 @@ public:
      */
     bool restoreFromHistory(int index);
 
+    /**
+     * @brief Get the most memory the history may hold.
+     * @return Budget in bytes.
+     */
+    qint64 maxHistoryBytes() const;
+
+    /**
+     * @brief Set the most memory the history may hold.
+     * Oldest entries are dropped past it; the most recent entry is always kept.
+     * @param bytes New budget in bytes.
+     */
+    void setMaxHistoryBytes(qint64 bytes);
+
     /**
      * @brief Clear the clipboard history.
      */
     void clearHistory();
 
+    /**
+     * @brief Get the approximate memory held by the clipboard history.
+     * @return Size in bytes.
+     */
+    qint64 historyBytes() const;
+
+    /**
+     * @brief Drop the oldest history entries to free memory.
+     * The most recent entry is always kept.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 releaseHistoryMemory(qint64 bytes);
+
     /**
      * @brief Get the MIME types currently available on the clipboard.
      * @return List of MIME type strings.
@@ -249,6 +281,8 @@ private slots:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static Clipboard* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,630 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ColorTransform.h"
+#include "ImageBufferPool.h"
+#include "PixelFormat.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <vector>
+
+#ifdef HAVE_LCMS2
+#include <lcms2.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define QUANTILYX_COLOR_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define QUANTILYX_COLOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Matrix weights are fixed point with this many fractional bits. Three
+// channels and alpha times a weight stay well inside an int32.
+constexpr int Precision = 12;
+constexpr qint32 One = 1 << Precision;
+constexpr qint32 Rounding = 1 << (Precision - 1);
+
+// Transforms kept for IDs still found in PageCache keys
+constexpr int MaxKnownTransforms = 8;
+
+// out = m * rgb + o * alpha, on premultiplied channels, clamped to [0, alpha]
+struct Affine {
+    qint32 m[3][3]; // Rows and columns red, green, blue
+    qint32 o[3];    // Offset for a fully opaque pixel
+};
+
+// Grid of unpremultiplied results, red slowest; read with tetrahedral interpolation
+struct Lut3D {
+    static constexpr int N = 33;
+    std::vector<QRgb> table;
+
+    static int index(int r, int g, int b) { return (r * N + g) * N + b; }
+};
+
+struct Transform {
+    quint32 id = 0;
+    Affine affine;
+    std::unique_ptr<Lut3D> lut; // Replaces the affine map when set; includes it
+};
+
+Affine affineFor(ColorTransform::Mode mode, const QColor& paper, const QColor& ink)
+{
+    qreal m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    qreal o[3] = {0, 0, 0}; // In 0..255
+    switch (mode) {
+    case ColorTransform::Mode::Normal:
+        break;
+    case ColorTransform::Mode::Invert:
+        for (int c = 0; c < 3; ++c) {
+            m[c][c] = -1;
+            o[c] = 255;
+        }
+        break;
+    case ColorTransform::Mode::Sepia: {
+        const qreal sepia[3][3] = {{0.393, 0.769, 0.189}, {0.349, 0.686, 0.168}, {0.272, 0.534, 0.131}};
+        std::copy(&sepia[0][0], &sepia[0][0] + 9, &m[0][0]);
+        break;
+    }
+    case ColorTransform::Mode::Night: {
+        // Inversion, then a 180 degree hue rotation to turn the hues back;
+        // rows of the rotation sum to one, so white still lands on black
+        const qreal hue[3][3] = {{-0.574, 1.430, 0.144}, {0.426, 0.430, 0.144}, {0.426, 1.430, -0.856}};
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) m[r][c] = -hue[r][c];
+            o[r] = 255;
+        }
+        break;
+    }
+    case ColorTransform::Mode::Paper: {
+        // Luminance picks the point between ink and paper
+        const qreal luma[3] = {0.2126, 0.7152, 0.0722};
+        const int paperRgb[3] = {paper.red(), paper.green(), paper.blue()};
+        const int inkRgb[3] = {ink.red(), ink.green(), ink.blue()};
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) m[r][c] = (paperRgb[r] - inkRgb[r]) / 255.0 * luma[c];
+            o[r] = inkRgb[r];
+        }
+        break;
+    }
+    }
+
+    Affine affine;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) affine.m[r][c] = qRound(m[r][c] * One);
+        affine.o[r] = qRound(o[r] / 255.0 * One);
+    }
+    return affine;
+}
+
+inline QRgb affinePixel(QRgb pixel, const Affine& t)
+{
+    const int a = qAlpha(pixel);
+    const int in[3] = {qRed(pixel), qGreen(pixel), qBlue(pixel)};
+    int out[3];
+    for (int c = 0; c < 3; ++c) {
+        const qint32 v = (t.m[c][0] * in[0] + t.m[c][1] * in[1] + t.m[c][2] * in[2] + t.o[c] * a + Rounding) >> Precision;
+        out[c] = qBound(0, v, a);
+    }
+    return qRgba(out[0], out[1], out[2], a);
+}
+
+void affineScalar(const QRgb* src, QRgb* dst, int count, const Affine& t)
+{
+    for (int i = 0; i < count; ++i) dst[i] = affinePixel(src[i], t);
+}
+
+using AffineKernel = void (*)(const QRgb*, QRgb*, int, const Affine&);
+
+#if defined(QUANTILYX_COLOR_X86)
+
+__attribute__((target("sse4.1")))
+void affineSse41(const QRgb* src, QRgb* dst, int count, const Affine& t)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i rounding = _mm_set1_epi32(Rounding);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i m[3][3];
+    __m128i o[3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) m[r][c] = _mm_set1_epi32(t.m[r][c]);
+        o[r] = _mm_set1_epi32(t.o[r]);
+    }
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i in[3] = {_mm_and_si128(_mm_srli_epi32(pixels, 16), mask),
+                               _mm_and_si128(_mm_srli_epi32(pixels, 8), mask),
+                               _mm_and_si128(pixels, mask)};
+        const __m128i alpha = _mm_srli_epi32(pixels, 24);
+        __m128i out[3];
+        for (int c = 0; c < 3; ++c) {
+            __m128i v = _mm_add_epi32(_mm_mullo_epi32(m[c][0], in[0]), _mm_mullo_epi32(m[c][1], in[1]));
+            v = _mm_add_epi32(v, _mm_add_epi32(_mm_mullo_epi32(m[c][2], in[2]), _mm_mullo_epi32(o[c], alpha)));
+            v = _mm_srai_epi32(_mm_add_epi32(v, rounding), Precision);
+            out[c] = _mm_min_epi32(_mm_max_epi32(v, zero), alpha);
+        }
+        const __m128i result = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(alpha, 24), _mm_slli_epi32(out[0], 16)),
+                                            _mm_or_si128(_mm_slli_epi32(out[1], 8), out[2]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+    }
+    affineScalar(src + i, dst + i, count - i, t);
+}
+
+__attribute__((target("avx2")))
+void affineAvx2(const QRgb* src, QRgb* dst, int count, const Affine& t)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const __m256i rounding = _mm256_set1_epi32(Rounding);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i m[3][3];
+    __m256i o[3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) m[r][c] = _mm256_set1_epi32(t.m[r][c]);
+        o[r] = _mm256_set1_epi32(t.o[r]);
+    }
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i in[3] = {_mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask),
+                               _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask),
+                               _mm256_and_si256(pixels, mask)};
+        const __m256i alpha = _mm256_srli_epi32(pixels, 24);
+        __m256i out[3];
+        for (int c = 0; c < 3; ++c) {
+            __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(m[c][0], in[0]), _mm256_mullo_epi32(m[c][1], in[1]));
+            v = _mm256_add_epi32(v, _mm256_add_epi32(_mm256_mullo_epi32(m[c][2], in[2]), _mm256_mullo_epi32(o[c], alpha)));
+            v = _mm256_srai_epi32(_mm256_add_epi32(v, rounding), Precision);
+            out[c] = _mm256_min_epi32(_mm256_max_epi32(v, zero), alpha);
+        }
+        const __m256i result = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(alpha, 24), _mm256_slli_epi32(out[0], 16)),
+                                               _mm256_or_si256(_mm256_slli_epi32(out[1], 8), out[2]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+    affineScalar(src + i, dst + i, count - i, t);
+}
+
+#endif // QUANTILYX_COLOR_X86
+
+#ifdef QUANTILYX_COLOR_NEON
+
+void affineNeon(const QRgb* src, QRgb* dst, int count, const Affine& t)
+{
+    const uint32x4_t mask = vdupq_n_u32(0xFF);
+    const int32x4_t rounding = vdupq_n_s32(Rounding);
+    const int32x4_t zero = vdupq_n_s32(0);
+    int32x4_t m[3][3];
+    int32x4_t o[3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) m[r][c] = vdupq_n_s32(t.m[r][c]);
+        o[r] = vdupq_n_s32(t.o[r]);
+    }
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t pixels = vld1q_u32(src + i);
+        const int32x4_t in[3] = {vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(pixels, 16), mask)),
+                                 vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(pixels, 8), mask)),
+                                 vreinterpretq_s32_u32(vandq_u32(pixels, mask))};
+        const int32x4_t alpha = vreinterpretq_s32_u32(vshrq_n_u32(pixels, 24));
+        uint32x4_t out[3];
+        for (int c = 0; c < 3; ++c) {
+            int32x4_t v = vmlaq_s32(rounding, m[c][0], in[0]);
+            v = vmlaq_s32(v, m[c][1], in[1]);
+            v = vmlaq_s32(v, m[c][2], in[2]);
+            v = vmlaq_s32(v, o[c], alpha);
+            v = vshrq_n_s32(v, Precision);
+            out[c] = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(v, zero), alpha));
+        }
+        const uint32x4_t result = vorrq_u32(vorrq_u32(vshlq_n_u32(vreinterpretq_u32_s32(alpha), 24), vshlq_n_u32(out[0], 16)),
+                                            vorrq_u32(vshlq_n_u32(out[1], 8), out[2]));
+        vst1q_u32(dst + i, result);
+    }
+    affineScalar(src + i, dst + i, count - i, t);
+}
+
+#endif // QUANTILYX_COLOR_NEON
+
+struct Kernels {
+    AffineKernel affine;
+    const char* name;
+};
+
+Kernels selectKernels()
+{
+#if defined(QUANTILYX_COLOR_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {affineAvx2, "AVX2"};
+    if (__builtin_cpu_supports("sse4.1")) return {affineSse41, "SSE4.1"};
+#elif defined(QUANTILYX_COLOR_NEON)
+    return {affineNeon, "NEON"};
+#endif
+    return {affineScalar, "scalar"};
+}
+
+const Kernels& kernels()
+{
+    static const Kernels selected = [] {
+        const Kernels k = selectKernels();
+        LOG_DEBUG("ColorTransform: Using " << k.name << " kernels.");
+        return k;
+    }();
+    return selected;
+}
+
+// Tetrahedral interpolation between the four grid points around a color
+inline QRgb lookup(const Lut3D& lut, int r, int g, int b)
+{
+    constexpr int Steps = Lut3D::N - 1;
+    // Grid position in 1/256ths of a cell
+    const int pr = r * Steps * 256 / 255;
+    const int pg = g * Steps * 256 / 255;
+    const int pb = b * Steps * 256 / 255;
+    const int ir = qMin(pr >> 8, Steps - 1), ig = qMin(pg >> 8, Steps - 1), ib = qMin(pb >> 8, Steps - 1);
+    const int fr = pr - (ir << 8), fg = pg - (ig << 8), fb = pb - (ib << 8);
+
+    const QRgb* t = lut.table.data();
+    const QRgb c000 = t[Lut3D::index(ir, ig, ib)];
+    const QRgb c111 = t[Lut3D::index(ir + 1, ig + 1, ib + 1)];
+    QRgb c1, c2;
+    int f1, f2, f3;
+    if (fr >= fg) {
+        if (fg >= fb) {
+            c1 = t[Lut3D::index(ir + 1, ig, ib)]; c2 = t[Lut3D::index(ir + 1, ig + 1, ib)]; f1 = fr; f2 = fg; f3 = fb;
+        } else if (fr >= fb) {
+            c1 = t[Lut3D::index(ir + 1, ig, ib)]; c2 = t[Lut3D::index(ir + 1, ig, ib + 1)]; f1 = fr; f2 = fb; f3 = fg;
+        } else {
+            c1 = t[Lut3D::index(ir, ig, ib + 1)]; c2 = t[Lut3D::index(ir + 1, ig, ib + 1)]; f1 = fb; f2 = fr; f3 = fg;
+        }
+    } else {
+        if (fb >= fg) {
+            c1 = t[Lut3D::index(ir, ig, ib + 1)]; c2 = t[Lut3D::index(ir, ig + 1, ib + 1)]; f1 = fb; f2 = fg; f3 = fr;
+        } else if (fb >= fr) {
+            c1 = t[Lut3D::index(ir, ig + 1, ib)]; c2 = t[Lut3D::index(ir, ig + 1, ib + 1)]; f1 = fg; f2 = fb; f3 = fr;
+        } else {
+            c1 = t[Lut3D::index(ir, ig + 1, ib)]; c2 = t[Lut3D::index(ir + 1, ig + 1, ib)]; f1 = fg; f2 = fr; f3 = fb;
+        }
+    }
+    const int w0 = 256 - f1, w1 = f1 - f2, w2 = f2 - f3, w3 = f3;
+    auto mix = [&](int (*channel)(QRgb)) {
+        return (w0 * channel(c000) + w1 * channel(c1) + w2 * channel(c2) + w3 * channel(c111) + 128) >> 8;
+    };
+    return qRgb(mix(qRed), mix(qGreen), mix(qBlue));
+}
+
+void applyLut(const QRgb* src, QRgb* dst, int count, const Lut3D& lut)
+{
+    // Pages are mostly runs of one color; the last result is reused for them
+    QRgb lastIn = 0;
+    QRgb lastOut = 0;
+    for (int i = 0; i < count; ++i) {
+        const QRgb pixel = src[i];
+        if (pixel == lastIn) {
+            dst[i] = lastOut;
+            continue;
+        }
+        const int a = qAlpha(pixel);
+        QRgb out = 0;
+        if (a == 255) {
+            out = lookup(lut, qRed(pixel), qGreen(pixel), qBlue(pixel)) | 0xFF000000u;
+        } else if (a > 0) {
+            const QRgb straight = qUnpremultiply(pixel);
+            out = qPremultiply(qRgba(0, 0, 0, a) | (lookup(lut, qRed(straight), qGreen(straight), qBlue(straight)) & 0x00FFFFFFu));
+        }
+        lastIn = pixel;
+        lastOut = out;
+        dst[i] = out;
+    }
+}
+
+// A transform over rows of premultiplied pixels
+void applyRow(const Transform& transform, AffineKernel affine, const QRgb* in, QRgb* out, int count)
+{
+    if (transform.lut) {
+        applyLut(in, out, count, *transform.lut);
+    } else {
+        affine(in, out, count, transform.affine);
+    }
+}
+
+// The transform of one source format. Grey images map through a table of
+// their 256 levels, the transform run once over a ramp, and stay grey when
+// every level maps to a grey; a Mono image only has its two palette colors
+// transformed. Other formats are expanded row by row into the kernels.
+template <typename Traits>
+QImage transformImage(const QImage& source, const Transform& transform, AffineKernel affine)
+{
+    const PixelPalette palette = PixelFormat::palette(source);
+    if constexpr (Traits::Format == QImage::Format_Mono) {
+        QRgb colors[2];
+        applyRow(transform, affine, palette.colors, colors, 2);
+        QImage result = source;
+        result.setColorTable({qUnpremultiply(colors[0]), qUnpremultiply(colors[1])});
+        return result;
+    } else if constexpr (Traits::IsGray) {
+        QRgb ramp[256];
+        QRgb table[256];
+        for (int level = 0; level < 256; ++level) ramp[level] = 0xff000000u | (quint32(level) * 0x010101u);
+        applyRow(transform, affine, ramp, table, 256);
+        const bool staysGray = std::all_of(std::begin(table), std::end(table), [](QRgb c) {
+            return qRed(c) == qGreen(c) && qGreen(c) == qBlue(c);
+        });
+
+        QImage result = ImageBufferPool::instance().acquire(source.size(), staysGray ? QImage::Format_Grayscale8
+                                                                                     : ImageBufferPool::PipelineFormat);
+        if (result.isNull()) return QImage();
+        uchar levels[256];
+        for (int level = 0; level < 256; ++level) levels[level] = uchar(qRed(table[level]));
+        for (int y = 0; y < source.height(); ++y) {
+            const uchar* in = source.constScanLine(y);
+            if (staysGray) {
+                uchar* out = result.scanLine(y);
+                for (int x = 0; x < source.width(); ++x) out[x] = levels[in[x]];
+            } else {
+                QRgb* out = reinterpret_cast<QRgb*>(result.scanLine(y));
+                for (int x = 0; x < source.width(); ++x) out[x] = table[in[x]];
+            }
+        }
+        return result;
+    } else {
+        QImage result = ImageBufferPool::instance().acquire(source.size());
+        if (result.isNull()) return QImage();
+        constexpr bool expands = Traits::Format != ImageBufferPool::PipelineFormat;
+        std::vector<QRgb> row(expands ? size_t(source.width()) : 0);
+        for (int y = 0; y < source.height(); ++y) {
+            const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+            if (expands) {
+                Traits::toArgb(source.constScanLine(y), row.data(), source.width(), palette);
+                in = row.data();
+            }
+            applyRow(transform, affine, in, reinterpret_cast<QRgb*>(result.scanLine(y)), source.width());
+        }
+        return result;
+    }
+}
+
+#ifdef HAVE_LCMS2
+// The mode's colors for every grid point, then sRGB to the display profile
+std::unique_ptr<Lut3D> buildLut(const Affine& affine, const QString& profilePath)
+{
+    cmsHPROFILE display = cmsOpenProfileFromFile(QFile::encodeName(profilePath).constData(), "r");
+    if (!display) return nullptr;
+    cmsHPROFILE srgb = cmsCreate_sRGBProfile();
+    cmsHTRANSFORM transform = cmsCreateTransform(srgb, TYPE_RGB_8, display, TYPE_RGB_8, INTENT_PERCEPTUAL, 0);
+    cmsCloseProfile(srgb);
+    cmsCloseProfile(display);
+    if (!transform) return nullptr;
+
+    constexpr int N = Lut3D::N;
+    std::vector<quint8> grid(static_cast<size_t>(N * N * N * 3));
+    for (int r = 0; r < N; ++r) {
+        for (int g = 0; g < N; ++g) {
+            for (int b = 0; b < N; ++b) {
+                const QRgb mapped = affinePixel(qRgb(r * 255 / (N - 1), g * 255 / (N - 1), b * 255 / (N - 1)), affine);
+                quint8* p = grid.data() + Lut3D::index(r, g, b) * 3;
+                p[0] = quint8(qRed(mapped));
+                p[1] = quint8(qGreen(mapped));
+                p[2] = quint8(qBlue(mapped));
+            }
+        }
+    }
+    cmsDoTransform(transform, grid.data(), grid.data(), N * N * N);
+    cmsDeleteTransform(transform);
+
+    std::unique_ptr<Lut3D> lut(new Lut3D);
+    lut->table.resize(static_cast<size_t>(N * N * N));
+    for (size_t i = 0; i < lut->table.size(); ++i) {
+        lut->table[i] = qRgb(grid[i * 3], grid[i * 3 + 1], grid[i * 3 + 2]);
+    }
+    return lut;
+}
+#endif
+
+} // namespace
+
+class ColorTransform::Private {
+public:
+    Private() : currentId(0), mode(Mode::Normal) {}
+
+    std::atomic<quint32> currentId;
+    Mode mode;
+    QColor paper;
+    QColor ink;
+    QString profilePath;
+
+    mutable QMutex mutex;
+    QHash<quint32, std::shared_ptr<const Transform>> transforms;
+    QList<quint32> order; // Oldest first
+
+    std::shared_ptr<const Transform> find(quint32 id) const {
+        QMutexLocker locker(&mutex);
+        return transforms.value(id);
+    }
+
+    // Builds the transform the settings describe and makes it current
+    bool reload() {
+        Settings& settings = Settings::instance();
+        mode = modeFromName(settings.value<QString>("Display/ColorMode", QStringLiteral("normal")));
+        paper = QColor(settings.value<QString>("Display/PaperColor", QStringLiteral("#f8f0dc")));
+        ink = QColor(settings.value<QString>("Display/InkColor", QStringLiteral("#3a3027")));
+        if (!paper.isValid()) paper = QColor(0xf8, 0xf0, 0xdc);
+        if (!ink.isValid()) ink = QColor(0x3a, 0x30, 0x27);
+        profilePath = settings.value<QString>("Display/IccProfile", QString());
+
+        const QFileInfo profile(profilePath);
+        quint32 id = 0;
+        if (mode != Mode::Normal || !profilePath.isEmpty()) {
+            id = qHash(static_cast<int>(mode));
+            if (mode == Mode::Paper) id = id * 31 + qHash(paper.rgba()) * 17 + qHash(ink.rgba());
+            if (!profilePath.isEmpty()) {
+                id = id * 31 + qHash(profile.absoluteFilePath()) + qHash(profile.lastModified().toMSecsSinceEpoch());
+            }
+            if (id == 0) id = 1; // 0 is the untransformed image
+        }
+
+        if (id != 0 && !find(id)) {
+            std::shared_ptr<Transform> transform = std::make_shared<Transform>();
+            transform->id = id;
+            transform->affine = affineFor(mode, paper, ink);
+            if (!profilePath.isEmpty()) {
+#ifdef HAVE_LCMS2
+                transform->lut = buildLut(transform->affine, profilePath);
+                if (!transform->lut) LOG_WARN("ColorTransform: Cannot use the display profile " << profilePath);
+#else
+                LOG_WARN("ColorTransform: Built without lcms2; the display profile " << profilePath << " is ignored.");
+#endif
+            }
+            QMutexLocker locker(&mutex);
+            transforms.insert(id, transform);
+            order.append(id);
+            while (order.size() > MaxKnownTransforms) {
+                transforms.remove(order.takeFirst());
+            }
+        }
+
+        const quint32 previous = currentId.exchange(id);
+        if (previous != id) {
+            LOG_INFO("ColorTransform: Showing pages in " << modeName(mode) << " mode"
+                     << (profilePath.isEmpty() ? QString() : QStringLiteral(" for %1").arg(profilePath)) << " (transform " << id << ")");
+        }
+        return previous != id;
+    }
+};
+
+ColorTransform* ColorTransform::s_instance = nullptr;
+
+ColorTransform& ColorTransform::instance()
+{
+    if (!s_instance) {
+        s_instance = new ColorTransform();
+    }
+    return *s_instance;
+}
+
+ColorTransform::ColorTransform(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    // Settings changes arrive on the main thread; so must this object live
+    if (QCoreApplication::instance() && thread() != QCoreApplication::instance()->thread()) {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+    d->reload();
+    connect(&Settings::instance(), &Settings::valueChanged, this, [this](const QString& key, const QVariant&) {
+        if (key == "Display/ColorMode" || key == "Display/PaperColor" || key == "Display/InkColor" || key == "Display/IccProfile") {
+            if (d->reload()) emit transformChanged(d->currentId);
+        }
+    });
+}
+
+ColorTransform::~ColorTransform() = default;
+
+quint32 ColorTransform::currentId() const
+{
+    return d->currentId;
+}
+
+ColorTransform::Mode ColorTransform::mode() const
+{
+    return d->mode;
+}
+
+void ColorTransform::setMode(Mode mode)
+{
+    Settings::instance().setValue("Display/ColorMode", modeName(mode));
+}
+
+void ColorTransform::setPaperColors(const QColor& paper, const QColor& ink)
+{
+    Settings::instance().setValue("Display/PaperColor", paper.name());
+    Settings::instance().setValue("Display/InkColor", ink.name());
+}
+
+bool ColorTransform::setDisplayProfile(const QString& filePath)
+{
+    if (!filePath.isEmpty()) {
+#ifdef HAVE_LCMS2
+        cmsHPROFILE profile = cmsOpenProfileFromFile(QFile::encodeName(filePath).constData(), "r");
+        if (!profile) {
+            LOG_ERROR("ColorTransform: Cannot read the ICC profile " << filePath);
+            return false;
+        }
+        cmsCloseProfile(profile);
+#else
+        LOG_ERROR("ColorTransform: Built without lcms2; cannot use the ICC profile " << filePath);
+        return false;
+#endif
+    }
+    Settings::instance().setValue("Display/IccProfile", filePath);
+    return true;
+}
+
+QImage ColorTransform::apply(const QImage& image, quint32 id) const
+{
+    if (id == 0 || image.isNull()) return image;
+    const std::shared_ptr<const Transform> transform = d->find(id);
+    if (!transform) return QImage();
+
+    // One kernel per source format, picked once for the whole image
+    const QImage source = PixelFormat::isSpecialized(image.format()) ? image : ImageBufferPool::toPipelineFormat(image);
+    const AffineKernel affine = kernels().affine;
+    QImage result;
+    PixelFormat::dispatch(source.format(), [&](auto traits) {
+        result = transformImage<decltype(traits)>(source, *transform, affine);
+    });
+    if (!result.isNull()) result.setDevicePixelRatio(image.devicePixelRatio());
+    return result;
+}
+
+QString ColorTransform::modeName(Mode mode)
+{
+    switch (mode) {
+    case Mode::Invert: return QStringLiteral("invert");
+    case Mode::Sepia: return QStringLiteral("sepia");
+    case Mode::Night: return QStringLiteral("night");
+    case Mode::Paper: return QStringLiteral("paper");
+    case Mode::Normal: break;
+    }
+    return QStringLiteral("normal");
+}
+
+ColorTransform::Mode ColorTransform::modeFromName(const QString& name)
+{
+    const QString lower = name.trimmed().toLower();
+    if (lower == QLatin1String("invert")) return Mode::Invert;
+    if (lower == QLatin1String("sepia")) return Mode::Sepia;
+    if (lower == QLatin1String("night")) return Mode::Night;
+    if (lower == QLatin1String("paper")) return Mode::Paper;
+    return Mode::Normal;
+}
+
+QString ColorTransform::instructionSet()
+{
+    return QString::fromLatin1(kernels().name);
+}
+
+} // namespace QuantilyxDoc
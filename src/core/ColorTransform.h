@@ -0,0 +1,153 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_COLORTRANSFORM_H
+#define QUANTILYX_COLORTRANSFORM_H
+
+#include <QColor>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Display color modes and color management applied to rendered tiles.
+ *
+ * A mode is an affine map of premultiplied RGB (inversion, sepia, night,
+ * paper and ink colors), run by SIMD kernels picked once at runtime: AVX2
+ * or SSE4.1 on x86, NEON on ARM, plain C++ elsewhere. Grey and bilevel
+ * images go through a table of their levels instead. A display ICC profile,
+ * when set and built with lcms2, is baked once into a 3D lookup table that
+ * follows the mode and is interpolated per pixel.
+ *
+ * Each distinct transform has an ID, 0 for pages as rendered. PageCache
+ * keys carry it: tiles are rendered once, untransformed, and the current
+ * transform of each is cached beside it, so scrolling never transforms
+ * again and switching modes transforms cached tiles instead of rendering.
+ *
+ * The transform follows Display/ColorMode ("normal", "invert", "sepia",
+ * "night" or "paper"), Display/PaperColor, Display/InkColor and
+ * Display/IccProfile.
+ */
+class ColorTransform : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief How page colors are shown.
+     */
+    enum class Mode {
+        Normal,  // As rendered
+        Invert,  // Negative
+        Sepia,   // Warm brown tones
+        Night,   // Inverted lightness, hues kept
+        Paper    // White becomes the paper color and black the ink color
+    };
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit ColorTransform(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~ColorTransform() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global ColorTransform instance.
+     */
+    static ColorTransform& instance();
+
+    /**
+     * @brief Get the ID of the current transform. Safe from any thread.
+     * @return ID for PageCache keys; 0 when pages are shown as rendered.
+     */
+    quint32 currentId() const;
+
+    /**
+     * @brief Get the current mode.
+     * @return Mode.
+     */
+    Mode mode() const;
+
+    /**
+     * @brief Set the mode; stored in Display/ColorMode.
+     * @param mode New mode.
+     */
+    void setMode(Mode mode);
+
+    /**
+     * @brief Set the colors of Mode::Paper; stored in Display/PaperColor and Display/InkColor.
+     * @param paper Color white turns into.
+     * @param ink Color black turns into.
+     */
+    void setPaperColors(const QColor& paper, const QColor& ink);
+
+    /**
+     * @brief Set the display's ICC profile; stored in Display/IccProfile.
+     * @param filePath Profile file; empty to show sRGB as is.
+     * @return False if the profile cannot be read, or lcms2 support is missing.
+     */
+    bool setDisplayProfile(const QString& filePath);
+
+    /**
+     * @brief Apply a transform to an image. Safe from any thread.
+     * @param image Image in any format.
+     * @param id Transform ID, as from currentId().
+     * @return Transformed image with the source's device pixel ratio: Mono
+     *         stays Mono with its two colors transformed, Grayscale8 stays
+     *         Grayscale8 while the transform keeps greys grey, and anything
+     *         else is ImageBufferPool::PipelineFormat. The image itself for
+     *         ID 0; null if the ID is no longer known.
+     */
+    QImage apply(const QImage& image, quint32 id) const;
+
+    /**
+     * @brief Convert a mode to its Display/ColorMode name.
+     * @param mode Mode.
+     * @return Name.
+     */
+    static QString modeName(Mode mode);
+
+    /**
+     * @brief Convert a Display/ColorMode name to a mode.
+     * @param name Name; unknown names are Mode::Normal.
+     * @return Mode.
+     */
+    static Mode modeFromName(const QString& name);
+
+    /**
+     * @brief Get the instruction set the kernels use on this machine.
+     * @return "AVX2", "SSE4.1", "NEON" or "scalar".
+     */
+    static QString instructionSet();
+
+signals:
+    /**
+     * @brief Emitted when the current transform changes.
+     * @param id New transform ID.
+     */
+    void transformChanged(quint32 id);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static ColorTransform* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_COLORTRANSFORM_H
@@ -16,6 +16,13 @@
 #include <QDir>
 #include <QFile>
 #include <QColor>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QTimer>
+#include <atomic>
+#include <functional>
 
 namespace QuantilyxDoc {
 
@@ -23,25 +30,150 @@ namespace QuantilyxDoc {
 class ConfigManager::Private
 {
 public:
-    Private() : settings(nullptr) {}
+    Private(ConfigManager* q_ptr) : q(q_ptr), settings(nullptr), saveTimer(nullptr), dirty(false) {}
     
     ~Private() {
         delete settings;
     }
 
-    QSettings* settings;
+    // An immutable copy of every value, keyed "section/key". Readers use
+    // the one published last; writers copy it, change the copy and publish
+    // that, so a read never waits for a write or a save.
+    struct Snapshot {
+        QHash<QString, QVariant> values;
+        quint64 generation = 0;
+    };
+    using Values = QHash<QString, QVariant>;
+
+    ConfigManager* q;
+    QSettings* settings;  // Used only to read and write the file
     QString configPath;
     QString lastError;
+    QTimer* saveTimer;
+    
+    QMutex writeMutex;            // Serializes writers and guards dirty
+    mutable QMutex publishMutex;  // Guards current; held only to swap or copy the pointer
+    std::shared_ptr<const Snapshot> current = std::make_shared<Snapshot>();
+    std::atomic<quint64> generation{0};
+    bool dirty;                   // Changed since the file was last written
     
     // Default configuration file name
     static const QString CONFIG_FILENAME;
+    // Changes within this long of each other reach the file in one write
+    static const int SaveDelayMs = 1000;
+
+    static QString storeKey(const QString& section, const QString& key) {
+        return section + QLatin1Char('/') + key;
+    }
+
+    // The snapshot this thread reads. Each thread keeps the last one it
+    // got and only takes the pointer lock after a write moved the
+    // generation on; ConfigManager is a singleton, so one slot per thread does.
+    const Snapshot& read() const {
+        thread_local std::shared_ptr<const Snapshot> cached;
+        if (!cached || cached->generation != generation.load(std::memory_order_acquire)) {
+            QMutexLocker locker(&publishMutex);
+            cached = current;
+        }
+        return *cached;
+    }
+
+    std::shared_ptr<const Snapshot> latest() const {
+        QMutexLocker locker(&publishMutex);
+        return current;
+    }
+
+    // Apply one batch of edits and publish it as one snapshot, then notify
+    // each key that changed and schedule one write for the batch
+    void apply(const std::function<void(Values&)>& edit, bool persist = true) {
+        QStringList changed;
+        {
+            QMutexLocker writeLocker(&writeMutex);
+            const std::shared_ptr<const Snapshot> previous = latest();
+            auto next = std::make_shared<Snapshot>();
+            next->values = previous->values;
+            edit(next->values);
+
+            QSet<QString> keys = QSet<QString>::fromList(previous->values.keys());
+            keys.unite(QSet<QString>::fromList(next->values.keys()));
+            for (const QString& key : qAsConst(keys)) {
+                if (previous->values.value(key) != next->values.value(key)) changed.append(key);
+            }
+            if (changed.isEmpty()) return;
+
+            next->generation = previous->generation + 1;
+            {
+                QMutexLocker locker(&publishMutex);
+                current = next;
+            }
+            generation.store(next->generation, std::memory_order_release);
+            if (persist) dirty = true;
+        }
+
+        for (const QString& key : qAsConst(changed)) {
+            const int slash = key.indexOf(QLatin1Char('/'));
+            emit q->configChanged(key.left(slash), key.mid(slash + 1));
+        }
+        if (persist) scheduleSave();
+    }
+
+    // Start or restart the write timer on the thread that owns it
+    void scheduleSave() {
+        QMetaObject::invokeMethod(saveTimer, "start", Qt::QueuedConnection);
+    }
+
+    static Values readFile(QSettings& file) {
+        Values values;
+        for (const QString& group : file.childGroups()) {
+            file.beginGroup(group);
+            for (const QString& key : file.childKeys()) {
+                values.insert(storeKey(group, key), file.value(key));
+            }
+            file.endGroup();
+        }
+        return values;
+    }
+
+    // Replace a file's contents with the values. QSettings writes the file
+    // through a temporary and renames it over the old one.
+    static bool writeFile(QSettings& file, const Values& values) {
+        file.clear();
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            const int slash = it.key().indexOf(QLatin1Char('/'));
+            file.beginGroup(it.key().left(slash));
+            file.setValue(it.key().mid(slash + 1), it.value());
+            file.endGroup();
+        }
+        file.sync();
+        return file.status() == QSettings::NoError;
+    }
+
+    // Write the current values if they changed since the last write
+    bool flush() {
+        saveTimer->stop();
+        {
+            QMutexLocker writeLocker(&writeMutex);
+            if (!dirty) return true;
+            dirty = false;
+        }
+        if (!writeFile(*settings, latest()->values)) {
+            lastError = "Failed to save configuration file: " + configPath;
+            LOG_ERROR(lastError);
+            QMutexLocker writeLocker(&writeMutex);
+            dirty = true; // Try again with the next change
+            return false;
+        }
+        LOG_DEBUG("Configuration written to " << configPath);
+        emit q->configSaved();
+        return true;
+    }
 };
 
 const QString ConfigManager::Private::CONFIG_FILENAME = "quantilyxdoc.ini";
 
 ConfigManager::ConfigManager()
     : QObject(nullptr)
-    , d(new Private())
+    , d(new Private(this))
 {
     // Determine configuration file path
     QString configDir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + 
@@ -52,14 +184,23 @@ ConfigManager::ConfigManager()
     
     d->configPath = configDir + "/" + Private::CONFIG_FILENAME;
     
-    // Create QSettings instance
+    // Create QSettings instance and take the values in memory
     d->settings = new QSettings(d->configPath, QSettings::IniFormat);
+    const Private::Values values = Private::readFile(*d->settings);
+    d->apply([&values](Private::Values& store) { store = values; }, false);
+    
+    // Bursts of changes are written once, after they stop
+    d->saveTimer = new QTimer(this);
+    d->saveTimer->setSingleShot(true);
+    d->saveTimer->setInterval(Private::SaveDelayMs);
+    connect(d->saveTimer, &QTimer::timeout, this, [this]() { d->flush(); });
     
     LOG_INFO("ConfigManager initialized with file: " << d->configPath);
 }
 
 ConfigManager::~ConfigManager()
 {
+    d->flush(); // Changes still waiting for the timer
     LOG_INFO("ConfigManager destroyed");
 }
 
@@ -69,6 +210,22 @@ ConfigManager& ConfigManager::instance()
     return instance;
 }
 
+bool ConfigManager::initialize(const QString& filePath)
+{
+    if (!filePath.isEmpty() && filePath != d->configPath) {
+        if (QFile::exists(filePath)) {
+            if (!loadFromFile(filePath)) return false;
+        } else {
+            // A new file: start it from the defaults
+            delete d->settings;
+            d->configPath = filePath;
+            d->settings = new QSettings(filePath, QSettings::IniFormat);
+        }
+    }
+    initializeDefaults();
+    return true;
+}
+
 void ConfigManager::loadDefaults()
 {
     LOG_INFO("Loading default configuration...");
@@ -91,15 +248,21 @@ bool ConfigManager::loadFromFile(const QString& filePath)
         return false;
     }
     
-    delete d->settings;
-    d->settings = new QSettings(path, QSettings::IniFormat);
-    
-    if (d->settings->status() != QSettings::NoError) {
+    std::unique_ptr<QSettings> file(new QSettings(path, QSettings::IniFormat));
+    if (file->status() != QSettings::NoError) {
         d->lastError = "Failed to load configuration file: " + path;
         LOG_ERROR(d->lastError);
         return false;
     }
     
+    // Pending changes belong to the file being replaced
+    d->flush();
+    const Private::Values values = Private::readFile(*file);
+    delete d->settings;
+    d->settings = file.release();
+    d->configPath = path;
+    d->apply([&values](Private::Values& store) { store = values; }, false);
+    
     emit configLoaded();
     LOG_INFO("Configuration loaded successfully");
     return true;
@@ -111,9 +274,12 @@ bool ConfigManager::saveToFile(const QString& filePath)
     
     LOG_INFO("Saving configuration to: " << path);
     
-    d->settings->sync();
+    if (path == d->configPath) {
+        return d->flush();
+    }
     
-    if (d->settings->status() != QSettings::NoError) {
+    QSettings file(path, QSettings::IniFormat);
+    if (!Private::writeFile(file, d->latest()->values)) {
         d->lastError = "Failed to save configuration file: " + path;
         LOG_ERROR(d->lastError);
         return false;
@@ -142,22 +308,13 @@ bool ConfigManager::importFrom(const QString& filePath)
         return false;
     }
     
-    // Copy all settings
-    QStringList groups = importSettings.childGroups();
-    for (const QString& group : groups) {
-        importSettings.beginGroup(group);
-        QStringList keys = importSettings.childKeys();
-        
-        d->settings->beginGroup(group);
-        for (const QString& key : keys) {
-            d->settings->setValue(key, importSettings.value(key));
+    // Copy all settings as one change
+    const Private::Values imported = Private::readFile(importSettings);
+    d->apply([&imported](Private::Values& store) {
+        for (auto it = imported.constBegin(); it != imported.constEnd(); ++it) {
+            store.insert(it.key(), it.value());
         }
-        d->settings->endGroup();
-        
-        importSettings.endGroup();
-    }
-    
-    d->settings->sync();
+    });
     
     LOG_INFO("Configuration imported successfully");
     return true;
@@ -167,15 +324,9 @@ bool ConfigManager::exportTo(const QString& filePath)
 {
     LOG_INFO("Exporting configuration to: " << filePath);
     
-    // Save current settings first
-    d->settings->sync();
-    
-    // Copy file
-    if (QFile::exists(filePath)) {
-        QFile::remove(filePath);
-    }
-    
-    if (!QFile::copy(d->configPath, filePath)) {
+    // Written from memory, so changes not yet saved are included
+    QSettings file(filePath, QSettings::IniFormat);
+    if (!Private::writeFile(file, d->latest()->values)) {
         d->lastError = "Failed to export configuration to: " + filePath;
         LOG_ERROR(d->lastError);
         return false;
@@ -257,31 +408,40 @@ void ConfigManager::setStringList(const QString& section, const QString& key,
 
 bool ConfigManager::contains(const QString& section, const QString& key) const
 {
-    d->settings->beginGroup(section);
-    bool result = d->settings->contains(key);
-    d->settings->endGroup();
-    return result;
+    return d->read().values.contains(Private::storeKey(section, key));
 }
 
 void ConfigManager::remove(const QString& section, const QString& key)
 {
-    d->settings->beginGroup(section);
-    d->settings->remove(key);
-    d->settings->endGroup();
-    
-    emit configChanged(section, key);
+    const QString name = Private::storeKey(section, key);
+    d->apply([&name](Private::Values& store) { store.remove(name); });
 }
 
 QStringList ConfigManager::sections() const
 {
-    return d->settings->childGroups();
+    QStringList result;
+    QSet<QString> seen;
+    const Private::Values& values = d->read().values;
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        const QString section = it.key().left(it.key().indexOf(QLatin1Char('/')));
+        if (!seen.contains(section)) {
+            seen.insert(section);
+            result.append(section);
+        }
+    }
+    result.sort();
+    return result;
 }
 
 QStringList ConfigManager::keys(const QString& section) const
 {
-    d->settings->beginGroup(section);
-    QStringList keysList = d->settings->childKeys();
-    d->settings->endGroup();
+    QStringList keysList;
+    const QString prefix = section + QLatin1Char('/');
+    const Private::Values& values = d->read().values;
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) keysList.append(it.key().mid(prefix.size()));
+    }
+    keysList.sort();
     return keysList;
 }
 
@@ -289,9 +449,9 @@ void ConfigManager::resetToDefaults()
 {
     LOG_INFO("Resetting configuration to defaults...");
     
-    d->settings->clear();
+    d->apply([](Private::Values& store) { store.clear(); });
     initializeDefaults();
-    d->settings->sync();
+    d->flush();
     
     LOG_INFO("Configuration reset to defaults");
     emit configLoaded();
@@ -307,33 +467,37 @@ QString ConfigManager::lastError() const
     return d->lastError;
 }
 
+QMetaObject::Connection ConfigManager::watch(const QString& section, const QString& key, QObject* context,
+                                             std::function<void(const QVariant&)> callback)
+{
+    return connect(this, &ConfigManager::configChanged, context,
+                   [this, section, key, callback](const QString& changedSection, const QString& changedKey) {
+                       if (changedSection == section && changedKey == key) {
+                           callback(d->read().values.value(Private::storeKey(section, key)));
+                       }
+                   });
+}
+
 QVariant ConfigManager::getValue(const QString& section, const QString& key, 
                                 const QVariant& defaultValue) const
 {
-    d->settings->beginGroup(section);
-    QVariant value = d->settings->value(key, defaultValue);
-    d->settings->endGroup();
-    return value;
+    return d->read().values.value(Private::storeKey(section, key), defaultValue);
 }
 
 void ConfigManager::setValue(const QString& section, const QString& key, const QVariant& value)
 {
-    d->settings->beginGroup(section);
-    d->settings->setValue(key, value);
-    d->settings->endGroup();
-    
-    emit configChanged(section, key);
+    const QString name = Private::storeKey(section, key);
+    d->apply([&name, &value](Private::Values& store) { store.insert(name, value); });
 }
 
 void ConfigManager::initializeDefaults()
 {
     LOG_INFO("Initializing default configuration values...");
     
-    // Only set if not already present
-    auto setDefault = [this](const QString& section, const QString& key, const QVariant& value) {
-        if (!contains(section, key)) {
-            setValue(section, key, value);
-        }
+    // Only set if not already present; collected and applied as one change
+    Private::Values defaults;
+    auto setDefault = [&defaults](const QString& section, const QString& key, const QVariant& value) {
+        defaults.insert(Private::storeKey(section, key), value);
     };
     
     // [General] section (17 settings)
@@ -415,6 +579,12 @@ void ConfigManager::initializeDefaults()
     
     // Add more sections as needed...
     
+    d->apply([&defaults](Private::Values& store) {
+        for (auto it = defaults.constBegin(); it != defaults.constEnd(); ++it) {
+            if (!store.contains(it.key())) store.insert(it.key(), it.value());
+        }
+    });
+    
     LOG_INFO("Default configuration values initialized");
 }
 
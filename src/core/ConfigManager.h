@@ -15,6 +15,7 @@
 #include <QString>
 #include <QVariant>
 #include <QColor>
+#include <functional>
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -24,6 +25,13 @@ namespace QuantilyxDoc {
  * 
  * Manages all application configuration stored in INI format.
  * Provides type-safe access to 500+ configuration options.
+ *
+ * Values live in memory as an immutable snapshot. A read takes the
+ * thread's copy of the latest snapshot without waiting on writers; a
+ * change publishes a new snapshot, emits configChanged() for each key it
+ * changed, and is written to the file a second after the last change of
+ * a burst, in one atomic replace. Loading a file or importing one is a
+ * single change however many keys it sets.
  */
 class ConfigManager : public QObject
 {
@@ -41,6 +49,13 @@ public:
      */
     ~ConfigManager();
 
+    /**
+     * @brief Load the configuration file and fill in defaults
+     * @param filePath Path to INI file; empty for the standard location
+     * @return true if initialized successfully
+     */
+    bool initialize(const QString& filePath = QString());
+
     /**
      * @brief Load default configuration
      */
@@ -54,7 +69,7 @@ public:
     bool loadFromFile(const QString& filePath = QString());
 
     /**
-     * @brief Save configuration to file
+     * @brief Save configuration to file now rather than after the save delay
      * @param filePath Path to INI file
      * @return true if saved successfully
      */
@@ -224,6 +239,17 @@ public:
      */
     QString lastError() const;
 
+    /**
+     * @brief Call back whenever one key changes
+     * @param section Section name
+     * @param key Key name
+     * @param context Object the callback runs on; it is disconnected when destroyed
+     * @param callback Called with the new value, invalid if the key was removed
+     * @return Connection, for QObject::disconnect()
+     */
+    QMetaObject::Connection watch(const QString& section, const QString& key, QObject* context,
+                                  std::function<void(const QVariant&)> callback);
+
 signals:
     /**
      * @brief Emitted when configuration changes
@@ -0,0 +1,415 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DiskPageCache.h"
+#include "Application.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include "Logger.h"
+#include "ImageCodec.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// On-disk layout: FileHeader followed by the ImageCodec payload, the same
+// bytes PageCache keeps for its compressed tier. Native byte order is fine,
+// the cache never leaves this machine.
+struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    qint32 bytesPerLine;
+    qint32 method;
+    qint32 payloadSize;
+    quint32 palette[2]; // Colors of a Mono image, unused otherwise
+};
+
+const quint32 FileMagic = 0x51585043; // "QXPC"
+const quint32 FileVersion = 3;
+const char* const FileSuffix = ".qpc";
+const qint64 FingerprintSampleBytes = 64 * 1024;
+
+} // namespace
+
+class DiskPageCache::Private {
+public:
+    struct IndexEntry {
+        qint64 sizeBytes;
+        qint64 lastAccess; // msecs since epoch, mirrored in the file mtime
+    };
+
+    Private()
+        : maxSizeBytes(1024LL * 1024 * 1024) // Default 1 GB
+        , currentSizeBytes(0) {}
+
+    mutable QMutex mutex;
+    QString dirPath;
+    qint64 maxSizeBytes;
+    qint64 currentSizeBytes;
+    QHash<quintptr, QByteArray> fingerprints; // documentId -> document fingerprint
+    QHash<QString, IndexEntry> index;          // file name -> entry
+    QSet<QString> pendingWrites;               // file names queued for writing
+
+    // Helper to fingerprint a document file. The path, size and mtime catch
+    // the usual edits; hashing the head and tail catches in-place rewrites.
+    static QByteArray fingerprintFile(const QString& filePath) {
+        QFileInfo info(filePath);
+        QFile file(filePath);
+        if (!info.exists() || !file.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+
+        QCryptographicHash hasher(QCryptographicHash::Sha1);
+        hasher.addData(info.absoluteFilePath().toUtf8());
+        hasher.addData(QByteArray::number(info.size()));
+        hasher.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        hasher.addData(file.read(FingerprintSampleBytes));
+        if (info.size() > FingerprintSampleBytes) {
+            file.seek(qMax<qint64>(FingerprintSampleBytes, info.size() - FingerprintSampleBytes));
+            hasher.addData(file.read(FingerprintSampleBytes));
+        }
+        return hasher.result();
+    }
+
+    // Helper to build the file name for a key; caller holds the mutex.
+    // Returns an empty string when the document is not registered.
+    QString fileNameForLocked(const PageCache::CacheKey& key) const {
+        auto it = fingerprints.constFind(key.documentId);
+        if (it == fingerprints.constEnd()) return QString();
+
+        QCryptographicHash hasher(QCryptographicHash::Sha1);
+        hasher.addData(it.value());
+        hasher.addData(QString("%1|%2|%3|%4x%5|%6,%7")
+                           .arg(key.pageIndex)
+                           .arg(PageCache::zoomBucket(key.zoomLevel)) // Same equality as CacheKey
+                           .arg(key.rotation)
+                           .arg(key.targetSize.width())
+                           .arg(key.targetSize.height())
+                           .arg(key.tileX)
+                           .arg(key.tileY)
+                           .toLatin1());
+        return QString::fromLatin1(hasher.result().toHex()) + FileSuffix;
+    }
+
+    QString filePathFor(const QString& fileName) const {
+        return dirPath + QLatin1Char('/') + fileName;
+    }
+
+    // Helper to rebuild the index from the files left by previous sessions
+    void scanDirectory() {
+        QDirIterator it(dirPath, QStringList() << QString("*%1").arg(FileSuffix), QDir::Files);
+        while (it.hasNext()) {
+            it.next();
+            QFileInfo info = it.fileInfo();
+            IndexEntry entry;
+            entry.sizeBytes = info.size();
+            entry.lastAccess = info.lastModified().toMSecsSinceEpoch();
+            index.insert(info.fileName(), entry);
+            currentSizeBytes += entry.sizeBytes;
+        }
+    }
+
+    // Helper to drop least recently read files until the cap is met.
+    // Collects victims under the mutex and deletes them after releasing it.
+    void trim() {
+        QStringList victims;
+        {
+            QMutexLocker locker(&mutex);
+            if (currentSizeBytes <= maxSizeBytes) return;
+
+            std::vector<std::pair<qint64, QString>> byAge;
+            byAge.reserve(static_cast<size_t>(index.size()));
+            for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+                byAge.emplace_back(it.value().lastAccess, it.key());
+            }
+            std::sort(byAge.begin(), byAge.end());
+
+            for (const auto& candidate : byAge) {
+                if (currentSizeBytes <= maxSizeBytes) break;
+                currentSizeBytes -= index.value(candidate.second).sizeBytes;
+                index.remove(candidate.second);
+                victims.append(candidate.second);
+            }
+        }
+
+        for (const QString& fileName : victims) {
+            QFile::remove(filePathFor(fileName));
+        }
+        LOG_DEBUG("DiskPageCache: Evicted " << victims.size() << " files to stay within cap.");
+    }
+
+    // Helper run on the thread pool: write a single compressed image
+    void writeFile(const QString& fileName, const ImageCodec::Encoded& encoded) {
+        const QByteArray& payload = encoded.data;
+
+        FileHeader header;
+        header.magic = FileMagic;
+        header.version = FileVersion;
+        header.width = encoded.width;
+        header.height = encoded.height;
+        header.format = static_cast<qint32>(encoded.format);
+        header.bytesPerLine = encoded.bytesPerLine;
+        header.method = static_cast<qint32>(encoded.method);
+        header.payloadSize = payload.size();
+        header.palette[0] = encoded.colorTable.value(0, qRgb(0, 0, 0));
+        header.palette[1] = encoded.colorTable.value(1, qRgb(255, 255, 255));
+
+        QSaveFile file(filePathFor(fileName));
+        // The directory may have been removed behind our back, e.g. by the OS cleaning caches
+        bool ok = (file.open(QIODevice::WriteOnly) || (QDir().mkpath(dirPath) && file.open(QIODevice::WriteOnly)))
+                  && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+                  && file.write(payload) == payload.size()
+                  && file.commit();
+
+        QMutexLocker locker(&mutex);
+        pendingWrites.remove(fileName);
+        if (!ok) {
+            LOG_WARNING("DiskPageCache: Failed to write " << fileName);
+            return;
+        }
+        IndexEntry entry;
+        entry.sizeBytes = static_cast<qint64>(sizeof(header)) + payload.size();
+        entry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+        auto existing = index.constFind(fileName);
+        if (existing != index.constEnd()) {
+            currentSizeBytes -= existing.value().sizeBytes;
+        }
+        index.insert(fileName, entry);
+        currentSizeBytes += entry.sizeBytes;
+    }
+
+    // Helper to decode a mapped file; returns a deep copy independent of the mapping
+    static QImage decode(const uchar* data, qint64 size) {
+        if (size < static_cast<qint64>(sizeof(FileHeader))) return QImage();
+
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != FileMagic || header.version != FileVersion) return QImage();
+        if (header.payloadSize <= 0 || sizeof(header) + header.payloadSize > static_cast<quint64>(size)) return QImage();
+
+        // Decode straight out of the mapping; fromRawData does not copy
+        ImageCodec::Encoded encoded;
+        encoded.data = QByteArray::fromRawData(reinterpret_cast<const char*>(data + sizeof(header)), header.payloadSize);
+        encoded.width = header.width;
+        encoded.height = header.height;
+        encoded.bytesPerLine = header.bytesPerLine;
+        encoded.format = static_cast<QImage::Format>(header.format);
+        encoded.method = static_cast<ImageCodec::Method>(header.method);
+        if (encoded.format == QImage::Format_Mono) {
+            encoded.colorTable = {header.palette[0], header.palette[1]};
+        }
+        return ImageCodec::decode(encoded);
+    }
+};
+
+// Static instance pointer
+DiskPageCache* DiskPageCache::s_instance = nullptr;
+
+DiskPageCache& DiskPageCache::instance()
+{
+    if (!s_instance) {
+        s_instance = new DiskPageCache();
+    }
+    return *s_instance;
+}
+
+DiskPageCache::DiskPageCache(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    d->dirPath = Application::instance()->cacheDirectory() + QLatin1String("/pages");
+    QDir().mkpath(d->dirPath);
+    d->maxSizeBytes = static_cast<qint64>(Settings::instance().value<int>("Advanced/DiskCacheSizeMB", 1024)) * 1024 * 1024;
+    d->scanDirectory();
+    LOG_INFO("DiskPageCache initialized at " << d->dirPath << " with " << d->index.size() << " files (" << d->currentSizeBytes << " bytes).");
+}
+
+DiskPageCache::~DiskPageCache() = default;
+
+void DiskPageCache::registerDocument(quintptr documentId, const QString& filePath)
+{
+    QByteArray fingerprint = Private::fingerprintFile(filePath);
+    if (fingerprint.isEmpty()) {
+        LOG_DEBUG("DiskPageCache: Not caching document without a readable file: " << filePath);
+        return;
+    }
+    QMutexLocker locker(&d->mutex);
+    d->fingerprints.insert(documentId, fingerprint);
+}
+
+void DiskPageCache::unregisterDocument(quintptr documentId)
+{
+    QMutexLocker locker(&d->mutex);
+    d->fingerprints.remove(documentId);
+}
+
+void DiskPageCache::store(const PageCache::CacheKey& key, const QImage& image)
+{
+    if (image.isNull()) return;
+    queueWrite(key, [image]() { return ImageCodec::encode(image); });
+}
+
+void DiskPageCache::store(const PageCache::CacheKey& key, const ImageCodec::Encoded& encoded)
+{
+    if (encoded.isNull()) return;
+    queueWrite(key, [encoded]() { return encoded; });
+}
+
+void DiskPageCache::queueWrite(const PageCache::CacheKey& key, std::function<ImageCodec::Encoded()> produce)
+{
+    QString fileName;
+    {
+        QMutexLocker locker(&d->mutex);
+        fileName = d->fileNameForLocked(key);
+        if (fileName.isEmpty() || d->index.contains(fileName) || d->pendingWrites.contains(fileName)) {
+            return; // Unknown document, or already on disk / on its way there
+        }
+        d->pendingWrites.insert(fileName);
+    }
+
+    Private* priv = d.get();
+    auto write = [this, priv, fileName](const ImageCodec::Encoded& encoded) {
+        priv->writeFile(fileName, encoded);
+        priv->trim();
+        qint64 size = 0;
+        int count = 0;
+        {
+            QMutexLocker locker(&priv->mutex);
+            size = priv->currentSizeBytes;
+            count = priv->index.size();
+        }
+        QMetaObject::invokeMethod(this, [this, size, count]() {
+            emit statisticsChanged(size, count);
+        }, Qt::QueuedConnection);
+    };
+    // Compress on a CPU worker, then hand the file write to the I/O pool
+    ThreadPool::instance().submitDetached([produce, write]() {
+        const ImageCodec::Encoded encoded = produce();
+        ThreadPool::ioInstance().submitDetached([write, encoded]() { write(encoded); }, Task::Priority::Low);
+    }, Task::Priority::Low);
+}
+
+QImage DiskPageCache::load(const PageCache::CacheKey& key)
+{
+    QString fileName;
+    {
+        QMutexLocker locker(&d->mutex);
+        fileName = d->fileNameForLocked(key);
+        if (fileName.isEmpty() || !d->index.contains(fileName)) return QImage();
+    }
+
+    QFile file(d->filePathFor(fileName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        // Removed behind our back (e.g. by the OS cleaning the cache directory)
+        QMutexLocker locker(&d->mutex);
+        auto it = d->index.find(fileName);
+        if (it != d->index.end()) {
+            d->currentSizeBytes -= it.value().sizeBytes;
+            d->index.erase(it);
+        }
+        return QImage();
+    }
+
+    QImage image;
+    const qint64 size = file.size();
+    if (uchar* mapped = file.map(0, size)) {
+        image = Private::decode(mapped, size);
+        file.unmap(mapped);
+    }
+    if (image.isNull()) {
+        LOG_WARNING("DiskPageCache: Discarding unreadable cache file " << fileName);
+        file.close();
+        file.remove();
+        QMutexLocker locker(&d->mutex);
+        auto it = d->index.find(fileName);
+        if (it != d->index.end()) {
+            d->currentSizeBytes -= it.value().sizeBytes;
+            d->index.erase(it);
+        }
+        return QImage();
+    }
+
+    // Record the access in the file mtime so LRU order survives a restart
+    const QDateTime now = QDateTime::currentDateTime();
+    file.setFileTime(now, QFileDevice::FileModificationTime);
+    QMutexLocker locker(&d->mutex);
+    auto it = d->index.find(fileName);
+    if (it != d->index.end()) {
+        it.value().lastAccess = now.toMSecsSinceEpoch();
+    }
+    return image;
+}
+
+bool DiskPageCache::contains(const PageCache::CacheKey& key) const
+{
+    QMutexLocker locker(&d->mutex);
+    QString fileName = d->fileNameForLocked(key);
+    return !fileName.isEmpty() && d->index.contains(fileName);
+}
+
+void DiskPageCache::clear()
+{
+    QStringList fileNames;
+    {
+        QMutexLocker locker(&d->mutex);
+        fileNames = d->index.keys();
+        d->index.clear();
+        d->currentSizeBytes = 0;
+    }
+    for (const QString& fileName : fileNames) {
+        QFile::remove(d->filePathFor(fileName));
+    }
+    LOG_INFO("DiskPageCache: Cleared " << fileNames.size() << " files.");
+    emit statisticsChanged(0, 0);
+}
+
+qint64 DiskPageCache::maxSizeBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maxSizeBytes;
+}
+
+void DiskPageCache::setMaxSizeBytes(qint64 size)
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->maxSizeBytes = size;
+    }
+    d->trim(); // Enforce new limit immediately
+}
+
+qint64 DiskPageCache::currentSizeBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->currentSizeBytes;
+}
+
+QString DiskPageCache::directory() const
+{
+    return d->dirPath;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,148 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DISKPAGECACHE_H
+#define QUANTILYX_DISKPAGECACHE_H
+
+#include "PageCache.h"
+#include "ImageCodec.h"
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Second-tier page cache stored under Application::cacheDirectory().
+ *
+ * Images dropped by PageCache are compressed and written to one file per
+ * page/zoom/rotation/size. Files are named after a fingerprint of the source
+ * document (path, size, mtime and a hash of its head and tail), so entries
+ * stay valid across restarts and go stale automatically when the file changes.
+ * Reads memory-map the file and decompress straight from the mapping.
+ *
+ * The tier has its own byte cap; the least recently read files are deleted
+ * when it is exceeded. Images are compressed on the CPU ThreadPool and
+ * written on the I/O pool, so eviction from PageCache never blocks on disk.
+ */
+class DiskPageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit DiskPageCache(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~DiskPageCache() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global DiskPageCache instance.
+     */
+    static DiskPageCache& instance();
+
+    /**
+     * @brief Associate a runtime document ID with its file on disk.
+     * Only registered documents are cached; the fingerprint is computed here.
+     * @param documentId Runtime ID used in PageCache::CacheKey.
+     * @param filePath Path of the document file.
+     */
+    void registerDocument(quintptr documentId, const QString& filePath);
+
+    /**
+     * @brief Forget a runtime document ID. Files on disk are kept.
+     * @param documentId Runtime ID used in PageCache::CacheKey.
+     */
+    void unregisterDocument(quintptr documentId);
+
+    /**
+     * @brief Queue an image to be written to disk.
+     * @param key Cache key of the image.
+     * @param image Image to store.
+     */
+    void store(const PageCache::CacheKey& key, const QImage& image);
+
+    /**
+     * @brief Queue an already compressed image to be written to disk.
+     * @param key Cache key of the image.
+     * @param encoded Image compressed with ImageCodec.
+     */
+    void store(const PageCache::CacheKey& key, const ImageCodec::Encoded& encoded);
+
+    /**
+     * @brief Load an image from disk.
+     * @param key Cache key of the image.
+     * @return The image, or a null image if not cached.
+     */
+    QImage load(const PageCache::CacheKey& key);
+
+    /**
+     * @brief Check if an image is cached on disk.
+     * @param key Cache key of the image.
+     * @return True if a file exists for the key.
+     */
+    bool contains(const PageCache::CacheKey& key) const;
+
+    /**
+     * @brief Delete all cached files.
+     */
+    void clear();
+
+    /**
+     * @brief Get the maximum size of the disk cache in bytes.
+     * @return Maximum size.
+     */
+    qint64 maxSizeBytes() const;
+
+    /**
+     * @brief Set the maximum size of the disk cache in bytes.
+     * @param size New maximum size.
+     */
+    void setMaxSizeBytes(qint64 size);
+
+    /**
+     * @brief Get the current size of the disk cache in bytes.
+     * @return Current size.
+     */
+    qint64 currentSizeBytes() const;
+
+    /**
+     * @brief Get the directory holding the cached files.
+     * @return Directory path.
+     */
+    QString directory() const;
+
+signals:
+    /**
+     * @brief Emitted when the disk cache size changes.
+     * @param currentSize Current size in bytes.
+     * @param fileCount Number of cached files.
+     */
+    void statisticsChanged(qint64 currentSize, int fileCount);
+
+private:
+    void queueWrite(const PageCache::CacheKey& key, std::function<ImageCodec::Encoded()> produce);
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static DiskPageCache* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DISKPAGECACHE_H
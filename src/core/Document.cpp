@@ -8,13 +8,19 @@
  * (at your option) any later version.
  */
 #include "Document.h"
+#include "ChunkStore.h"
+#include "MemoryBudget.h"
+#include "Page.h"
+#include "RemoteFile.h"
 #include "../utils/FileUtils.h"
+#include "../search/DocumentSearch.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QMimeDatabase>
 #include <QDebug>
 #include <QDir>
+#include <QUrl>
 namespace QuantilyxDoc {
 
 class Document::Private {
@@ -54,6 +60,19 @@ Document::Document(QObject* parent)
 
 Document::~Document()
 {
+    MemoryBudget::instance().forgetDocument(MemoryBudget::documentId(this));
+}
+
+Document::SnapshotWriter Document::captureSnapshot() const
+{
+    const QString source = filePath();
+    if (isModified() || source.isEmpty()) return SnapshotWriter();
+
+    // The file is the state; take a copy-on-write clone where the filesystem can
+    return [source](const QString& targetPath, const std::function<bool()>& cancelled) {
+        if (cancelled()) return false;
+        return ChunkStore::cloneFile(source, targetPath);
+    };
 }
 
 void Document::close()
@@ -98,6 +117,21 @@ QDateTime Document::modificationDate() const
     return d->modificationDate;
 }
 
+QList<Page*> Document::loadedPages() const
+{
+    QList<Page*> pages;
+    for (int i = 0; i < pageCount(); ++i) {
+        if (Page* existing = page(i)) pages.append(existing);
+    }
+    return pages;
+}
+
+QSizeF Document::pageSize(int index) const
+{
+    Page* existing = page(index);
+    return existing ? existing->size() : QSizeF();
+}
+
 int Document::currentPageIndex() const
 {
     return d->currentPageIndex;
@@ -204,6 +238,52 @@ QVariantList Document::tableOfContents() const
     return QVariantList();
 }
 
+namespace {
+
+TocEntry tocEntryFromMap(const QVariantMap& item)
+{
+    TocEntry entry;
+    entry.title = item.value("title").toString();
+    entry.destination = item.value("destination");
+    entry.hasChildren = !item.value("children").toList().isEmpty();
+    return entry;
+}
+
+bool visitTocList(const QVariantList& items, QVector<int>& path,
+                  const std::function<bool(const TocEntry&, const QVector<int>&)>& visitor)
+{
+    path.append(0);
+    for (int i = 0; i < items.size(); ++i) {
+        path.last() = i;
+        const QVariantMap item = items.at(i).toMap();
+        if (!visitor(tocEntryFromMap(item), path)) return false;
+        if (!visitTocList(item.value("children").toList(), path, visitor)) return false;
+    }
+    path.removeLast();
+    return true;
+}
+
+} // namespace
+
+QList<TocEntry> Document::tableOfContentsChildren(const QVector<int>& path) const
+{
+    QVariantList level = tableOfContents();
+    for (int index : path) {
+        if (index < 0 || index >= level.size()) return QList<TocEntry>();
+        level = level.at(index).toMap().value("children").toList();
+    }
+    QList<TocEntry> entries;
+    entries.reserve(level.size());
+    for (const QVariant& item : qAsConst(level)) entries.append(tocEntryFromMap(item.toMap()));
+    return entries;
+}
+
+bool Document::visitTableOfContents(const std::function<bool(const TocEntry&, const QVector<int>&)>& visitor) const
+{
+    QVector<int> path;
+    return visitTocList(tableOfContents(), path, visitor);
+}
+
 QStringList Document::bookmarks() const
 {
     return QStringList();
@@ -224,10 +304,34 @@ void Document::removeBookmark(const QString& name)
 
 QList<int> Document::search(const QString& text, bool caseSensitive, bool wholeWords) const
 {
-    Q_UNUSED(text);
-    Q_UNUSED(caseSensitive);
-    Q_UNUSED(wholeWords);
-    return QList<int>();
+    // Pages are scanned in parallel; DocumentSearch streams hits instead
+    return DocumentSearch::findPages(this, text, caseSensitive, wholeWords);
+}
+
+QVariantMap Document::memoryStatistics() const
+{
+    const MemoryBudget& budget = MemoryBudget::instance();
+    const quintptr id = MemoryBudget::documentId(this);
+    QVariantMap statistics;
+    qint64 total = 0;
+    const QHash<QString, qint64> usage = budget.documentUsage(id);
+    for (auto it = usage.constBegin(); it != usage.constEnd(); ++it) {
+        statistics.insert(it.key(), it.value());
+        total += it.value();
+    }
+    statistics.insert("Total", total);
+    statistics.insert("Limit", budget.documentLimitBytes(id));
+    return statistics;
+}
+
+qint64 Document::memoryLimit() const
+{
+    return MemoryBudget::instance().documentLimitBytes(MemoryBudget::documentId(this));
+}
+
+void Document::setMemoryLimit(qint64 bytes)
+{
+    MemoryBudget::instance().setDocumentLimitBytes(MemoryBudget::documentId(this), bytes);
 }
 
 void Document::setState(State state)
@@ -245,7 +349,14 @@ void Document::setFilePath(const QString& path)
     d->filePath = path;
     
     // Update file info if path is not empty
-    if (!path.isEmpty()) {
+    if (RemoteFile::isRemote(path)) {
+        // Open already while its backend loads, so this costs no request
+        const std::shared_ptr<RemoteFile> remote = RemoteFile::open(path);
+        d->fileSize = remote ? remote->size() : 0;
+        if (d->title.isEmpty()) {
+            d->title = QFileInfo(QUrl(path).fileName()).baseName();
+        }
+    } else if (!path.isEmpty()) {
         QFileInfo fileInfo(path);
         d->fileSize = fileInfo.size();
         
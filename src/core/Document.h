@@ -14,8 +14,12 @@
 #include <QObject>
 #include <QString>
 #include <QSize>
+#include <QSizeF>
 #include <QImage>
 #include <QList>
+#include <QVariant>
+#include <QVector>
+#include <functional>
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -46,6 +50,16 @@ enum class DocumentType
     Office
 };
 
+/**
+ * @brief One table of contents entry, without its children.
+ */
+struct TocEntry
+{
+    QString title;
+    QVariant destination;       // As in tableOfContents(), e.g. {"type": "page", "page": 4}
+    bool hasChildren = false;
+};
+
 /**
  * @brief Base document class
  * 
@@ -88,6 +102,23 @@ public:
      */
     virtual bool save(const QString& filePath = QString()) = 0;
 
+    /**
+     * @brief Writes a captured copy of a document to a file.
+     * Called with the target path and a function that returns true once the
+     * write should stop; returns true if the whole copy was written.
+     */
+    using SnapshotWriter = std::function<bool(const QString& targetPath, const std::function<bool()>& cancelled)>;
+
+    /**
+     * @brief Capture the current state for writing on another thread
+     * Capturing is cheap and happens on the document's thread; the writer
+     * uses only what it captured, so it may run on any thread while the
+     * document is edited or closed. The default handles unmodified
+     * documents by copying their file.
+     * @return Snapshot writer; empty if only save() can write this state
+     */
+    virtual SnapshotWriter captureSnapshot() const;
+
     /**
      * @brief Close document
      */
@@ -154,6 +185,23 @@ public:
      */
     virtual Page* page(int index) const = 0;
 
+    /**
+     * @brief Get the pages that exist now, without creating any.
+     * The default returns every page, for formats that build their pages
+     * at load; formats that create pages on demand list only those made.
+     * @return Existing pages
+     */
+    virtual QList<Page*> loadedPages() const;
+
+    /**
+     * @brief Get the size of a page in points
+     * Formats that create pages on demand answer without creating the
+     * page, so laying out every page stays cheap.
+     * @param index Page index (0-based)
+     * @return Page size, empty if there is no such page
+     */
+    virtual QSizeF pageSize(int index) const;
+
     /**
      * @brief Get current page index
      * @return Current page index
@@ -253,6 +301,26 @@ public:
      */
     virtual QVariantList tableOfContents() const;
 
+    /**
+     * @brief Get one level of the table of contents.
+     * For outlines too large to build whole: only the level asked for is
+     * read. The default takes it from tableOfContents(); formats with a
+     * lazily read outline override it. Call on the document's thread.
+     * @param path Child indexes from the top level down to the parent;
+     *             empty for the top level
+     * @return Entries of that level, in order
+     */
+    virtual QList<TocEntry> tableOfContentsChildren(const QVector<int>& path) const;
+
+    /**
+     * @brief Walk the whole table of contents, depth first.
+     * Safe on a worker thread while the document is open; used to build
+     * search indexes without blocking the user interface.
+     * @param visitor Called with each entry and its path; returns false to stop
+     * @return false if the walk was stopped or the outline could not be read
+     */
+    virtual bool visitTableOfContents(const std::function<bool(const TocEntry&, const QVector<int>&)>& visitor) const;
+
     // Bookmarks support
     /**
      * @brief Get bookmarks
@@ -276,6 +344,8 @@ public:
     // Search support
     /**
      * @brief Search for text in document
+     * Blocks until every page is scanned; use DocumentSearch to stream
+     * results to the UI instead.
      * @param text Text to search
      * @param caseSensitive Case sensitive search
      * @param wholeWords Whole words only
@@ -285,6 +355,26 @@ public:
                              bool caseSensitive = false,
                              bool wholeWords = false) const;
 
+    // Memory accounting
+    /**
+     * @brief Get the memory held for this document, as MemoryBudget sees it
+     * @return Bytes by consumer name, plus "Total" and "Limit" (0 if none)
+     */
+    QVariantMap memoryStatistics() const;
+
+    /**
+     * @brief Get the soft memory limit of this document
+     * Above it, MemoryBudget shrinks this document's caches before anyone else's.
+     * @return Limit in bytes; 0 if none
+     */
+    qint64 memoryLimit() const;
+
+    /**
+     * @brief Set the soft memory limit of this document
+     * @param bytes Limit in bytes; 0 for none, -1 for the share set in Advanced/DocumentMemoryLimitPercent
+     */
+    void setMemoryLimit(qint64 bytes);
+
 signals:
     /**
      * @brief Emitted when document is loaded
@@ -313,6 +403,23 @@ signals:
      */
     void currentPageChanged(int index);
 
+    /**
+     * @brief Emitted when the number of pages changes, for example when a
+     * progressive load finishes
+     */
+    void pageCountChanged();
+
+    /**
+     * @brief Emitted when the table of contents becomes available or changes
+     */
+    void tableOfContentsChanged();
+
+    /**
+     * @brief Emitted when page sizes change without the page count changing,
+     * for example when reflowable content finishes laying out
+     */
+    void pageSizesChanged();
+
     /**
      * @brief Emitted when document is closed
      */
@@ -9,6 +9,12 @@
  */
 #include "DocumentFactory.h"
 #include "Document.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "Page.h"
+#include "ThreadPool.h"
+#include "RemoteFile.h"
+#include "ZipArchive.h"
 #include "../formats/pdf/PdfDocument.h"
 #include "../formats/epub/EpubDocument.h"
 #include "../formats/djvu/DjvuDocument.h"
@@ -24,20 +30,152 @@
 #include "../formats/cad/DxfDocument.h"
 #include "../formats/office/OdtDocument.h"
 #include "../formats/office/DocxDocument.h"
+#include <QFile>
 #include <QFileInfo>
 #include <QMimeDatabase>
 #include <QMimeType>
 #include <QDir>
 #include <QCoreApplication>
+#include <QEventLoop>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QThread>
+#include <QWriteLocker>
+#include <QUrl>
 #include <QDebug>
+#include <atomic>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Enough for every signature below, including PDF's leading garbage
+const int SniffBytes = 4096;
+
+// What a ZIP container holds decides which format it is
+QString sniffZip(const QString& filePath)
+{
+    ZipArchive zip;
+    if (!zip.open(filePath)) return QString();
+    const QByteArray mimetype = zip.read("mimetype").trimmed();
+    if (mimetype == "application/epub+zip") return ".epub";
+    if (mimetype == "application/vnd.oasis.opendocument.text") return ".odt";
+    if (zip.contains("word/document.xml")) return ".docx";
+    const QStringList names = zip.entryNames();
+    for (const QString& name : names) {
+        if (name.endsWith(QLatin1String(".fdseq"), Qt::CaseInsensitive)) return ".xps";
+    }
+    static const char* const imageSuffixes[] = { ".jpg", ".jpeg", ".png", ".gif", ".webp", ".bmp" };
+    for (const QString& name : names) {
+        for (const char* suffix : imageSuffixes) {
+            if (name.endsWith(QLatin1String(suffix), Qt::CaseInsensitive)) return ".cbz";
+        }
+    }
+    return QString();
+}
+
+} // namespace
+
 class DocumentFactory::Private {
 public:
-    Private() {}
+    Private() : batchCounter(0) {}
     QMap<QString, DocumentTypeRegistration> extensionRegistry;
     QMap<QString, DocumentTypeRegistration> mimeRegistry;
+    mutable QReadWriteLock registryLock; // Batch loads read the registries from I/O workers
+    int batchCounter;
+
+    // The registered extension whose signature the file starts with, or
+    // empty when the content says nothing (Markdown, unknown data)
+    static QString sniffExtension(const QString& filePath, const QByteArray& head) {
+        if (head.startsWith("%!PS")) return ".ps";
+        if (head.left(1024).contains("%PDF-")) return ".pdf"; // May follow up to 1 KB of junk
+        if (head.startsWith("AT&TFORM")) return ".djvu";
+        if (head.startsWith("\xC5\xD0\xD3\xC6")) return ".eps"; // DOS EPS binary header
+        if (head.startsWith("ITSF")) return ".chm";
+        if (head.startsWith("Rar!\x1A\x07")) return ".cbr";
+        if (head.startsWith("PK\x03\x04")) return sniffZip(filePath);
+        if (head.mid(60, 8) == "BOOKMOBI" || head.mid(60, 8) == "TEXtREAd") return ".mobi";
+        if (head.startsWith("\x89PNG\r\n\x1A\n")) return ".png";
+        if (head.startsWith("\xFF\xD8\xFF")) return ".jpg";
+        if (head.startsWith("GIF87a") || head.startsWith("GIF89a")) return ".gif";
+        if (head.startsWith(QByteArray("II*\0", 4)) || head.startsWith(QByteArray("MM\0*", 4))) return ".tiff";
+        if (head.startsWith("RIFF") && head.mid(8, 4) == "WEBP") return ".webp";
+        if (head.startsWith("BM") && head.size() >= 14 && head.mid(6, 4) == QByteArray(4, '\0')) return ".bmp";
+        if (head.startsWith("AC10")) return ".dwg";
+        if (head.startsWith("AutoCAD Binary DXF")) return ".dxf";
+        if (head.left(64).simplified().startsWith("0 SECTION")) return ".dxf";
+        if (head.contains("<FictionBook")) return ".fb2";
+        return QString();
+    }
+
+    // Registrations to try, best first: the sniffed type, then the
+    // extension, then the MIME database. Types that share a MIME type are
+    // tried once.
+    QList<DocumentTypeRegistration> candidates(const QString& filePath, const QByteArray& head) const {
+        // A URL's query is no part of its extension
+        const QString fileName = RemoteFile::isRemote(filePath) ? QUrl(filePath).fileName() : filePath;
+        const QString extension = "." + QFileInfo(fileName).suffix().toLower();
+        const QString sniffed = sniffExtension(filePath, head);
+        QMimeDatabase mimeDb;
+        const QString mimeName = head.isEmpty() ? mimeDb.mimeTypeForFile(fileName).name()
+                                                : mimeDb.mimeTypeForFileNameAndData(fileName, head).name();
+
+        QReadLocker locker(&registryLock);
+        QList<DocumentTypeRegistration> result;
+        auto add = [&result](const DocumentTypeRegistration& reg) {
+            for (const DocumentTypeRegistration& existing : result) {
+                if (existing.mimeType == reg.mimeType) return;
+            }
+            result.append(reg);
+        };
+        const auto byExtension = extensionRegistry.constFind(extension);
+        const auto bySniffing = extensionRegistry.constFind(sniffed);
+        if (bySniffing != extensionRegistry.constEnd()) {
+            if (byExtension != extensionRegistry.constEnd() && byExtension->mimeType != bySniffing->mimeType) {
+                LOG_INFO("DocumentFactory: " << filePath << " looks like " << sniffed << ", not " << extension);
+            }
+            add(*bySniffing);
+        }
+        if (byExtension != extensionRegistry.constEnd()) add(*byExtension);
+        const auto byMime = mimeRegistry.constFind(mimeName);
+        if (byMime != mimeRegistry.constEnd()) add(*byMime);
+        return result;
+    }
+
+    // Create and load a document without a parent. Safe from any thread.
+    Document* loadDocument(const QString& filePath, const QString& password, QString* error) const {
+        // Map the file once for the duration of the load; backends that open
+        // the same path through MappedFile share this mapping instead of copying
+        // Remote files are held open the same way, so the backend reuses the
+        // connection's probe and the blocks sniffing fetched
+        const std::shared_ptr<RemoteFile> remote = RemoteFile::isRemote(filePath) ? RemoteFile::open(filePath, error) : nullptr;
+        if (RemoteFile::isRemote(filePath) && !remote) return nullptr;
+        const std::shared_ptr<MappedFile> mapping = remote ? nullptr : MappedFile::open(filePath);
+        QByteArray head;
+        if (remote) {
+            head = remote->read(0, SniffBytes);
+        } else if (mapping) {
+            head = mapping->bytes(0, SniffBytes);
+        } else {
+            QFile file(filePath);
+            if (file.open(QIODevice::ReadOnly)) head = file.read(SniffBytes);
+        }
+
+        const QList<DocumentTypeRegistration> regs = candidates(filePath, head);
+        if (regs.isEmpty()) {
+            if (error) *error = DocumentFactory::tr("Unsupported file format.");
+            return nullptr;
+        }
+        for (const DocumentTypeRegistration& reg : regs) {
+            Document* doc = reg.creator();
+            if (!doc) continue;
+            if (doc->load(filePath, password)) return doc;
+            if (error) *error = doc->lastError();
+            LOG_WARN("DocumentFactory: Loading " << filePath << " as " << reg.extension << " failed: " << doc->lastError());
+            delete doc;
+        }
+        return nullptr;
+    }
 };
 
 DocumentFactory* DocumentFactory::s_instance = nullptr;
@@ -92,6 +230,7 @@ void DocumentFactory::registerDocumentType(const QString& extension, const QStri
     reg.mimeType = mimeType;
     reg.creator = creator;
     
+    QWriteLocker locker(&d->registryLock);
     d->extensionRegistry.insert(ext, reg);
     d->mimeRegistry.insert(mimeType, reg);
 }
@@ -101,43 +240,83 @@ Document* DocumentFactory::createDocument(const QString& filePath, const QString
     if (filePath.isEmpty()) {
         return nullptr;
     }
-    
-    QFileInfo fileInfo(filePath);
-    QString extension = "." + fileInfo.suffix().toLower();
-    
-    // Find registration by extension
-    if (d->extensionRegistry.contains(extension)) {
-        Document* doc = d->extensionRegistry[extension].creator();
-        if (doc) {
-            doc->setParent(this);
-            bool success = doc->load(filePath, password);
-            if (!success) {
-                delete doc;
-                return nullptr;
-            }
-            return doc;
-        }
+
+    QString error;
+    Document* doc = d->loadDocument(filePath, password, &error);
+    if (doc) {
+        doc->setParent(this);
     }
-    
-    // Try MIME type detection as fallback
-    QMimeDatabase mimeDb;
-    QMimeType mimeType = mimeDb.mimeTypeForFile(filePath);
-    
-    if (d->mimeRegistry.contains(mimeType.name())) {
-        Document* doc = d->mimeRegistry[mimeType.name()].creator();
-        if (doc) {
-            doc->setParent(this);
-            bool success = doc->load(filePath, password);
-            if (!success) {
-                delete doc;
-                return nullptr;
+    return doc;
+}
+
+Document* DocumentFactory::loadDocument(const QString& filePath, const QString& password, QString* error) const
+{
+    if (filePath.isEmpty()) {
+        return nullptr;
+    }
+    return d->loadDocument(filePath, password, error);
+}
+
+Document* DocumentFactory::loadDocumentAndWait(const QString& filePath, const QString& password, QString* error) const
+{
+    std::unique_ptr<Document> document(loadDocument(filePath, password, error));
+    if (!document || document->state() != Document::Loading) {
+        if (document && document->state() != Document::Loaded) document.reset();
+        return document.release();
+    }
+
+    // Some backends finish loading in the background
+    QEventLoop loop;
+    QObject::connect(document.get(), &Document::loaded, &loop, &QEventLoop::quit);
+    QObject::connect(document.get(), &Document::loadFailed, &loop, [&loop, error](const QString& message) {
+        if (error) *error = message;
+        loop.quit();
+    });
+    if (document->state() == Document::Loading) loop.exec();
+    if (document->state() != Document::Loaded) document.reset();
+    return document.release();
+}
+
+int DocumentFactory::openDocuments(const QStringList& filePaths, const QString& password)
+{
+    const int batchId = ++d->batchCounter;
+    if (filePaths.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, batchId]() { emit batchOpenFinished(batchId); }, Qt::QueuedConnection);
+        return batchId;
+    }
+
+    auto remaining = std::make_shared<std::atomic<int>>(filePaths.size());
+    QThread* mainThread = thread();
+    const Private* priv = d.get();
+    for (const QString& filePath : filePaths) {
+        ThreadPool::ioInstance().submitDetached([this, priv, filePath, password, batchId, remaining, mainThread]() {
+            QString error;
+            Document* doc = priv->loadDocument(filePath, password, &error);
+            if (doc) {
+                // Objects can only be pushed from the thread that owns them.
+                // Pages are not children of their document, so they go one by
+                // one; only those made so far, as later ones are created on
+                // the document's thread.
+                for (Page* page : doc->loadedPages()) {
+                    if (!page->parent()) page->moveToThread(mainThread);
+                }
+                doc->moveToThread(mainThread);
             }
-            return doc;
-        }
+            QMetaObject::invokeMethod(this, [this, doc, filePath, error, batchId, remaining]() {
+                if (doc) {
+                    doc->setParent(this);
+                    emit documentOpened(batchId, filePath, doc);
+                } else {
+                    emit documentOpenFailed(batchId, filePath, error);
+                }
+                if (--*remaining == 0) {
+                    emit batchOpenFinished(batchId);
+                }
+            }, Qt::QueuedConnection);
+        });
     }
-    
-    // No matching handler found
-    return nullptr;
+    LOG_INFO("DocumentFactory: Opening " << filePaths.size() << " files in batch " << batchId);
+    return batchId;
 }
 
 QStringList DocumentFactory::supportedExtensions() const
@@ -179,28 +358,25 @@ bool DocumentFactory::isMimeTypeSupported(const QString& mimeType) const
 
 DocumentType DocumentFactory::documentTypeFromPath(const QString& filePath) const
 {
-    QFileInfo fileInfo(filePath);
-    QString extension = "." + fileInfo.suffix().toLower();
-    
-    if (d->extensionRegistry.contains(extension)) {
-        return d->extensionRegistry[extension].creator()->type();
+    QByteArray head;
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        head = file.read(SniffBytes);
     }
-    
-    // Fallback to MIME type
-    QMimeDatabase mimeDb;
-    QMimeType mimeType = mimeDb.mimeTypeForFile(filePath);
-    
-    if (d->mimeRegistry.contains(mimeType.name())) {
-        return d->mimeRegistry[mimeType.name()].creator()->type();
+
+    const QList<DocumentTypeRegistration> regs = d->candidates(filePath, head);
+    if (!regs.isEmpty()) {
+        const std::unique_ptr<Document> probe(regs.first().creator());
+        if (probe) return probe->type();
     }
-    
     return DocumentType::Unknown;
 }
 
 DocumentType DocumentFactory::documentTypeFromMimeType(const QString& mimeType) const
 {
     if (d->mimeRegistry.contains(mimeType)) {
-        return d->mimeRegistry[mimeType].creator()->type();
+        const std::unique_ptr<Document> probe(d->mimeRegistry[mimeType].creator());
+        return probe->type();
     }
     return DocumentType::Unknown;
 }
@@ -209,7 +385,8 @@ DocumentType DocumentFactory::documentTypeFromExtension(const QString& extension
 {
     QString ext = extension.startsWith('.') ? extension : ("." + extension);
     if (d->extensionRegistry.contains(ext)) {
-        return d->extensionRegistry[ext].creator()->type();
+        const std::unique_ptr<Document> probe(d->extensionRegistry[ext].creator());
+        return probe->type();
     }
     return DocumentType::Unknown;
 }
@@ -12,6 +12,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QMap>
 #include <memory>
 
@@ -25,6 +26,10 @@ class Page;
  * 
  * Creates document instances based on file type. Uses a registry pattern
  * to allow format handlers to register themselves.
+ *
+ * The type is taken from the file's first few KB where its signature is
+ * recognizable, so a mislabelled file goes straight to the right backend;
+ * the extension and the MIME database are tried after it.
  */
 class DocumentFactory : public QObject
 {
@@ -52,6 +57,43 @@ public:
      * @return Document instance or nullptr if creation failed
      */
     Document* createDocument(const QString& filePath, const QString& password = QString());
+
+    /**
+     * @brief Create and load a document without a parent, from any thread
+     *
+     * The document belongs to the calling thread and to the caller, who
+     * deletes it. Backends that finish loading in the background report it
+     * through Document::loaded() on the main thread.
+     * @param filePath Path to file
+     * @param password Password for encrypted documents
+     * @param error Receives the reason on failure; may be null
+     * @return Document instance or nullptr if loading failed
+     */
+    Document* loadDocument(const QString& filePath, const QString& password = QString(), QString* error = nullptr) const;
+
+    /**
+     * @brief Load a document as loadDocument() does and wait until it is loaded
+     *
+     * A backend that finishes loading in the background is waited for in a
+     * local event loop, so the headless modes get a document ready to use.
+     * @param filePath Path to file
+     * @param password Password for encrypted documents
+     * @param error Receives the reason on failure; may be null
+     * @return Loaded document, owned by the caller, or nullptr if loading failed
+     */
+    Document* loadDocumentAndWait(const QString& filePath, const QString& password = QString(), QString* error = nullptr) const;
+
+    /**
+     * @brief Open several documents concurrently on the I/O pool
+     *
+     * Each file is created and loaded on an I/O worker, then moved to the
+     * main thread and handed over through documentOpened() or
+     * documentOpenFailed() as soon as it finishes, in completion order.
+     * @param filePaths Paths to files
+     * @param password Password for encrypted documents
+     * @return Batch id reported by the signals
+     */
+    int openDocuments(const QStringList& filePaths, const QString& password = QString());
     
     /**
      * @brief Get supported file formats
@@ -106,6 +148,29 @@ public:
      */
     QString fileDialogFilter() const;
 
+signals:
+    /**
+     * @brief Emitted when a document of a batch has loaded
+     * @param batchId Id returned by openDocuments()
+     * @param filePath Path to file
+     * @param document The document, owned by the factory
+     */
+    void documentOpened(int batchId, const QString& filePath, QuantilyxDoc::Document* document);
+
+    /**
+     * @brief Emitted when a document of a batch could not be loaded
+     * @param batchId Id returned by openDocuments()
+     * @param filePath Path to file
+     * @param error Description of the failure
+     */
+    void documentOpenFailed(int batchId, const QString& filePath, const QString& error);
+
+    /**
+     * @brief Emitted after every file of a batch was reported
+     * @param batchId Id returned by openDocuments()
+     */
+    void batchOpenFinished(int batchId);
+
 private:
     /**
      * @brief Private constructor for singleton
@@ -0,0 +1,91 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DocumentHandle.h"
+#include "Application.h"
+#include "Document.h"
+#include "DocumentFactory.h"
+#include "Logger.h"
+#include <utility>
+
+namespace QuantilyxDoc {
+
+DocumentHandle::DocumentHandle(Document* document)
+    : m_document(document)
+{
+    if (document) Application::instance()->retainDocument(document);
+}
+
+DocumentHandle DocumentHandle::open(const QString& filePath)
+{
+    Application* app = Application::instance();
+    if (Document* open = app->findDocument(filePath)) {
+        return DocumentHandle(open);
+    }
+    Document* created = DocumentFactory::instance().createDocument(filePath);
+    if (!created) return DocumentHandle();
+
+    Document* shared = app->registerDocument(created);
+    if (shared != created) {
+        delete created; // Opened elsewhere meanwhile under another path
+    }
+    return adopt(shared);
+}
+
+DocumentHandle DocumentHandle::adopt(Document* registered)
+{
+    DocumentHandle handle;
+    handle.m_document = registered;
+    return handle;
+}
+
+DocumentHandle::DocumentHandle(const DocumentHandle& other)
+    : DocumentHandle(other.m_document.data())
+{
+}
+
+DocumentHandle& DocumentHandle::operator=(const DocumentHandle& other)
+{
+    if (this != &other) {
+        DocumentHandle copy(other);
+        std::swap(m_document, copy.m_document);
+    }
+    return *this;
+}
+
+DocumentHandle::DocumentHandle(DocumentHandle&& other) noexcept
+    : m_document(other.m_document)
+{
+    other.m_document.clear();
+}
+
+DocumentHandle& DocumentHandle::operator=(DocumentHandle&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        m_document = other.m_document;
+        other.m_document.clear();
+    }
+    return *this;
+}
+
+DocumentHandle::~DocumentHandle()
+{
+    reset();
+}
+
+void DocumentHandle::reset()
+{
+    if (m_document) {
+        Application::instance()->releaseDocument(m_document.data());
+        m_document.clear();
+    }
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,86 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DOCUMENTHANDLE_H
+#define QUANTILYX_DOCUMENTHANDLE_H
+
+#include <QPointer>
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Counted reference to a document registered with Application.
+ *
+ * Every view of a file holds a handle to the same Document, so its pages,
+ * rendered tiles, text layers and OCR results exist once however many
+ * views show it; each view keeps its own scroll position and zoom. Copying
+ * a handle takes another reference and destroying one drops it; the last
+ * handle to go closes and deletes the document.
+ */
+class DocumentHandle
+{
+public:
+    /**
+     * @brief Constructor for an empty handle.
+     */
+    DocumentHandle() = default;
+
+    /**
+     * @brief Take a reference to a registered document.
+     * @param document Document, or nullptr for an empty handle.
+     */
+    explicit DocumentHandle(Document* document);
+
+    /**
+     * @brief Open a file, sharing the document if the file is already open.
+     * @param filePath Path of the file.
+     * @return Handle, empty if the file could not be opened.
+     */
+    static DocumentHandle open(const QString& filePath);
+
+    /**
+     * @brief Wrap the reference Application::registerDocument() returned with.
+     * @param registered Document returned by registerDocument().
+     * @return Handle owning that reference, without taking another.
+     */
+    static DocumentHandle adopt(Document* registered);
+
+    DocumentHandle(const DocumentHandle& other);
+    DocumentHandle& operator=(const DocumentHandle& other);
+    DocumentHandle(DocumentHandle&& other) noexcept;
+    DocumentHandle& operator=(DocumentHandle&& other) noexcept;
+
+    /**
+     * @brief Destructor. Drops the reference.
+     */
+    ~DocumentHandle();
+
+    /**
+     * @brief Drop the reference and empty the handle.
+     */
+    void reset();
+
+    /**
+     * @brief Get the document.
+     * @return Document, or nullptr if empty or deleted elsewhere.
+     */
+    Document* get() const { return m_document.data(); }
+
+    Document* operator->() const { return m_document.data(); }
+    explicit operator bool() const { return !m_document.isNull(); }
+
+private:
+    QPointer<Document> m_document;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DOCUMENTHANDLE_H
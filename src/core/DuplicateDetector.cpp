@@ -9,26 +9,127 @@
  */
 #include "DuplicateDetector.h"
 #include "Document.h"
+#include "Page.h"
+#include "Application.h"
+#include "CancellationToken.h"
 #include "Logger.h"
+#include "MetadataDatabase.h"
+#include "MinHashIndex.h"
+#include "PerceptualHash.h"
+#include "ThreadPool.h"
+#include "ThumbnailStore.h"
 #include <QCryptographicHash>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
-#include <QTextDocument> // For text fingerprinting
-#include <QTextBlock>
-#include <QTextFragment>
+#include <QDateTime>
+#include <QStandardPaths>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
 #include <QDebug>
+#include <QSet>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Bytes read from each end of a file before it is read in full
+const qint64 PartialHashBytes = 64 * 1024;
+
+// Bytes hashed between cancellation checks when a file is read in full
+const qint64 HashChunkBytes = 1024 * 1024;
+
+// Files sharing a size hashed per batch of a directory scan, whose groups
+// are reported before the next batch is read
+const int HashBatchFiles = 256;
+
+// Hash of a file's first and last PartialHashBytes; the whole content for
+// files up to twice that. Empty if the file cannot be read.
+QByteArray partialHash(const QString& filePath, qint64 size)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    QCryptographicHash hasher(QCryptographicHash::Md5);
+    hasher.addData(file.read(PartialHashBytes));
+    if (size > PartialHashBytes) {
+        if (!file.seek(qMax(PartialHashBytes, size - PartialHashBytes))) return QByteArray();
+        hasher.addData(file.read(PartialHashBytes));
+    }
+    return hasher.result();
+}
+
+// Just the key of a retrieved fingerprint, to store one field under it
+DocumentFingerprint fingerprintKey(const DocumentFingerprint& fingerprint)
+{
+    DocumentFingerprint key;
+    key.filePath = fingerprint.filePath;
+    key.fileSize = fingerprint.fileSize;
+    key.modified = fingerprint.modified;
+    return key;
+}
+
+// Leading pages whose looks make up a document's perceptual fingerprint
+const int PerceptualPages = 4;
+
+// Joins matched documents into groups; a group scores its least similar
+// matched pair
+class Grouping
+{
+public:
+    explicit Grouping(int count) : parent(count), weakest(count, 1.0f) {
+        for (int i = 0; i < count; ++i) parent[i] = i;
+    }
+
+    void join(int i, int j, float similarity) {
+        const int a = root(i);
+        const int b = root(j);
+        const float linkScore = qMin(similarity, qMin(weakest[a], weakest[b]));
+        if (a != b) parent[b] = a;
+        weakest[a] = linkScore;
+    }
+
+    // One group per set of joined documents, in the order of their first member
+    QList<DuplicateGroup> groups(const QList<Document*>& documents, const QVector<bool>& included) {
+        QHash<int, int> groupOfRoot;
+        QList<DuplicateGroup> result;
+        for (int i = 0; i < documents.size(); ++i) {
+            if (!included[i]) continue;
+            const int r = root(i);
+            auto it = groupOfRoot.constFind(r);
+            if (it == groupOfRoot.constEnd()) {
+                DuplicateGroup group;
+                group.similarityScore = weakest[r];
+                group.representativeFilePath = documents[i]->filePath();
+                it = groupOfRoot.insert(r, result.size());
+                result.append(group);
+            }
+            result[it.value()].documents.append(documents[i]);
+        }
+        return result;
+    }
+
+private:
+    QVector<int> parent;
+    QVector<float> weakest;
+
+    int root(int i) {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];
+        return i;
+    }
+};
+
+} // namespace
+
 class DuplicateDetector::Private {
 public:
     Private(DuplicateDetector* q_ptr)
-        : q(q_ptr), analyzing(false), lastDocCount(0), lastDupCount(0), similarityThresholdVal(0.95f), activeMethodStr("hash") {}
+        : q(q_ptr), analyzing(false), lastDocCount(0), lastDupCount(0), similarityThresholdVal(0.95f), activeMethodStr("hash"), indexReady(false) {}
 
     DuplicateDetector* q;
     mutable QMutex mutex; // Protect access to state and results during analysis
@@ -38,6 +139,344 @@ public:
     float similarityThresholdVal;
     QString activeMethodStr;
     QList<DuplicateGroup> lastResults;
+    MinHashIndex minHashes; // Text signatures of every document seen, kept across sessions
+    QString indexPathStr;
+    bool indexReady;
+
+    // All of a document's text, pages separated by line breaks
+    static QString documentText(Document* document) {
+        QString text;
+        for (int i = 0; i < document->pageCount(); ++i) {
+            Page* page = document->page(i);
+            if (!page) continue;
+            if (i > 0) text += QLatin1Char('\n');
+            text += page->text();
+        }
+        return text;
+    }
+
+    static bool hasWords(const QString& text) {
+        for (const QChar c : text) {
+            if (c.isLetterOrNumber()) return true;
+        }
+        return false;
+    }
+
+    // A document's MinHash signature, from the index or the fingerprint
+    // store if its file has not changed and otherwise from its text, which
+    // both then keep. False for documents without text, which text cannot
+    // tell apart.
+    bool signatureOf(Document* document, MinHashIndex::Signature* signature) {
+        const QString filePath = document->filePath();
+        DocumentFingerprint fingerprint = MetadataDatabase::instance().retrieveFingerprint(filePath);
+        const bool onDisk = !fingerprint.filePath.isEmpty();
+        if (onDisk) {
+            QMutexLocker locker(&mutex);
+            if (minHashes.find(filePath, fingerprint.fileSize, fingerprint.modified, signature)) return true;
+            if (fingerprint.minHash.size() == int(sizeof(MinHashIndex::Signature))) {
+                memcpy(signature, fingerprint.minHash.constData(), sizeof(MinHashIndex::Signature));
+                minHashes.insert(filePath, fingerprint.fileSize, fingerprint.modified, *signature);
+                return true;
+            }
+        }
+
+        const QString text = documentText(document);
+        if (!hasWords(text)) return false;
+        *signature = MinHashIndex::signature(text);
+        if (onDisk) {
+            {
+                QMutexLocker locker(&mutex);
+                minHashes.insert(filePath, fingerprint.fileSize, fingerprint.modified, *signature);
+            }
+            DocumentFingerprint update = fingerprintKey(fingerprint);
+            update.minHash = QByteArray(reinterpret_cast<const char*>(signature), sizeof(MinHashIndex::Signature));
+            MetadataDatabase::instance().storeFingerprint(update);
+        }
+        return true;
+    }
+
+    // Groups documents whose texts are near-duplicates, through a
+    // MinHash index of the list itself, keyed by position, so each
+    // document is only compared with those sharing a band with it
+    QList<DuplicateGroup> groupByText(const QList<Document*>& documents, float similarityThreshold) {
+        MinHashIndex listIndex;
+        QVector<MinHashIndex::Signature> signatures(documents.size());
+        QVector<bool> hasSignature(documents.size(), false);
+        for (int i = 0; i < documents.size(); ++i) {
+            Document* document = documents[i];
+            if (!document) continue;
+            emit q->analysisStarted(document);
+            hasSignature[i] = signatureOf(document, &signatures[i]);
+            if (hasSignature[i]) listIndex.insert(QString::number(i), 0, 0, signatures[i]);
+            emit q->analysisProgress((i + 1) * 80 / documents.size());
+        }
+
+        Grouping grouping(documents.size());
+        for (int i = 0; i < documents.size(); ++i) {
+            if (!hasSignature[i]) continue;
+            QList<Document*> duplicates;
+            for (const MinHashIndex::Match& match : listIndex.similar(signatures[i], similarityThreshold, QString::number(i))) {
+                const int j = match.filePath.toInt();
+                duplicates.append(documents[j]);
+                if (j < i) continue; // Each pair once
+                emit q->duplicateFound(documents[i], documents[j], match.similarity);
+                grouping.join(i, j, match.similarity);
+            }
+            emit q->analysisFinished(documents[i], duplicates);
+        }
+        return grouping.groups(documents, hasSignature);
+    }
+
+    // pHashes of a document's first pages, from the stored thumbnails
+    // where there are any; pages rendered here are stored as thumbnails
+    // in turn, so the thumbnail list and the next run find them
+    static QVector<quint64> perceptualHashes(Document* document) {
+        const QString filePath = document->filePath();
+        const DocumentFingerprint fingerprint = MetadataDatabase::instance().retrieveFingerprint(filePath);
+        if (!fingerprint.pageHashes.isEmpty()) return fingerprint.pageHashes;
+
+        QVector<quint64> hashes;
+        ThumbnailStore& thumbnails = ThumbnailStore::instance();
+        for (int i = 0; i < qMin(document->pageCount(), PerceptualPages); ++i) {
+            Page* page = document->page(i);
+            if (!page) break;
+            QImage image = thumbnails.isReady() ? thumbnails.image(filePath, i) : QImage();
+            if (image.isNull()) {
+                const QSizeF size = page->size();
+                const qreal longest = qMax(size.width(), size.height());
+                if (longest <= 0.0) break;
+                const qreal scale = ThumbnailStore::ThumbnailEdge / longest;
+                image = page->render(qMax(1, qRound(size.width() * scale)), qMax(1, qRound(size.height() * scale)),
+                                     qMax(1, qRound(72.0 * scale)));
+                if (CancellationToken::currentIsCanceled()) return {}; // The image may be partial; nothing is stored
+                if (image.isNull()) break;
+                if (thumbnails.isReady()) thumbnails.storeImage(filePath, i, image);
+            }
+            hashes.append(PerceptualHash::pHash(image));
+        }
+        if (!hashes.isEmpty() && !fingerprint.filePath.isEmpty()) {
+            DocumentFingerprint update = fingerprintKey(fingerprint);
+            update.pageHashes = hashes;
+            MetadataDatabase::instance().storeFingerprint(update);
+        }
+        return hashes;
+    }
+
+    // Groups documents that look alike page by page, for scans and images
+    // that have no text to compare. Candidates come from a BK-tree of the
+    // first pages' hashes; a pair matches if it has as many leading pages
+    // and each page pair is within the distance the threshold allows.
+    QList<DuplicateGroup> groupByLooks(const QList<Document*>& documents, float similarityThreshold) {
+        for (Document* document : documents) {
+            if (document) emit q->analysisStarted(document);
+        }
+        QVector<QVector<quint64>> prints(documents.size());
+        ThreadPool::instance().forEach(documents.size(), [&](int i) {
+            if (documents[i]) prints[i] = perceptualHashes(documents[i]);
+        });
+        if (CancellationToken::currentIsCanceled()) return {};
+        emit q->analysisProgress(80);
+
+        const int radius = qBound(0, int((1.0f - similarityThreshold) * 64.0f + 0.001f), 64);
+        HammingTree tree;
+        QVector<bool> hasPrint(documents.size(), false);
+        for (int i = 0; i < documents.size(); ++i) {
+            hasPrint[i] = !prints[i].isEmpty();
+            if (hasPrint[i]) tree.insert(prints[i].first(), i);
+        }
+
+        Grouping grouping(documents.size());
+        for (int i = 0; i < documents.size(); ++i) {
+            if (!hasPrint[i]) continue;
+            QList<Document*> duplicates;
+            for (const QPair<int, int>& candidate : tree.find(prints[i].first(), radius)) {
+                const int j = candidate.first;
+                if (j == i || prints[j].size() != prints[i].size()) continue;
+                int total = 0;
+                bool close = true;
+                for (int page = 0; page < prints[i].size() && close; ++page) {
+                    const int distance = PerceptualHash::distance(prints[i][page], prints[j][page]);
+                    close = distance <= radius;
+                    total += distance;
+                }
+                if (!close) continue;
+                const float similarity = 1.0f - float(total) / (64.0f * prints[i].size());
+                duplicates.append(documents[j]);
+                if (j < i) continue; // Each pair once
+                emit q->duplicateFound(documents[i], documents[j], similarity);
+                grouping.join(i, j, similarity);
+            }
+            emit q->analysisFinished(documents[i], duplicates);
+        }
+        emit q->analysisProgress(100);
+        return grouping.groups(documents, hasPrint);
+    }
+
+    // A file and its size, as listed
+    struct SizedFile {
+        QString path;
+        qint64 size;
+    };
+
+    // The files matching filters under a directory, listed a level at a
+    // time with the directories of each level read in parallel on the I/O
+    // pool. Symbolic links to directories are not followed.
+    static QVector<SizedFile> listFiles(const QString& root, const QStringList& filters, bool recursive) {
+        QVector<SizedFile> files;
+        QStringList level(root);
+        QMutex resultMutex;
+        while (!level.isEmpty() && !CancellationToken::currentIsCanceled()) {
+            QStringList next;
+            ThreadPool::ioInstance().forEach(level.size(), [&](int i) {
+                const QDir dir(level[i]);
+                QVector<SizedFile> found;
+                for (const QFileInfo& info : dir.entryInfoList(filters, QDir::Files)) {
+                    found.append({info.absoluteFilePath(), info.size()}); // Sizes come with the listing
+                }
+                QStringList subdirectories;
+                if (recursive) {
+                    for (const QFileInfo& info : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks)) {
+                        subdirectories.append(info.absoluteFilePath());
+                    }
+                }
+                QMutexLocker locker(&resultMutex);
+                files += found;
+                next += subdirectories;
+            });
+            level = next;
+        }
+        return files;
+    }
+
+    // Groups the files of identical content, two or more to a group, in
+    // stages that each read only the files still tied: sizes from the file
+    // system, then the first and last PartialHashBytes, then, for longer
+    // files, the full content. Reads run in parallel on the I/O pool, so a
+    // tree of distinct files costs little more than listing it.
+    //
+    // Files sharing a size are hashed in batches of about HashBatchFiles,
+    // smallest sizes first, and each batch's groups are handed to onGroup
+    // as soon as it is hashed: no other file can join them, and memory
+    // holds the hashes of one batch only. Groups come sorted by path within
+    // a batch.
+    void groupIdenticalFiles(const QVector<SizedFile>& files, const std::function<void(const QStringList&)>& onGroup) const {
+        std::map<qint64, QStringList> bySize;
+        QSet<QString> seen;
+        for (const SizedFile& file : files) {
+            if (file.size == 0 || seen.contains(file.path)) continue;
+            seen.insert(file.path);
+            bySize[file.size].append(file.path);
+        }
+        seen.clear();
+
+        int candidateCount = 0;
+        for (const auto& bucket : bySize) {
+            if (bucket.second.size() > 1) candidateCount += bucket.second.size();
+        }
+        emit q->analysisProgress(10);
+
+        int hashed = 0;
+        int readInFull = 0;
+        int groupCount = 0;
+        QStringList batch;
+        QVector<qint64> sizes;
+        for (auto bucket = bySize.cbegin(); bucket != bySize.cend(); ++bucket) {
+            if (bucket->second.size() > 1) {
+                for (const QString& path : bucket->second) {
+                    batch.append(path);
+                    sizes.append(bucket->first);
+                }
+            }
+            // Buckets are never split, so a batch's groups are final
+            if (batch.isEmpty() || (batch.size() < HashBatchFiles && std::next(bucket) != bySize.cend())) continue;
+
+            QVector<QStringList> groups = hashBatch(batch, sizes, &readInFull);
+            if (CancellationToken::currentIsCanceled()) return;
+            for (QStringList& group : groups) group.sort();
+            std::sort(groups.begin(), groups.end(), [](const QStringList& a, const QStringList& b) { return a.first() < b.first(); });
+            for (const QStringList& group : qAsConst(groups)) onGroup(group);
+            groupCount += groups.size();
+
+            hashed += batch.size();
+            emit q->analysisProgress(10 + hashed * 90 / candidateCount);
+            batch.clear();
+            sizes.clear();
+        }
+        emit q->analysisProgress(100);
+        LOG_DEBUG("DuplicateDetector: " << files.size() << " files, " << candidateCount << " sharing a size, "
+                  << readInFull << " read in full, " << groupCount << " duplicate groups.");
+    }
+
+    // The groups of identical files among files sharing sizes with each
+    // other. Hashes are taken from the fingerprint store for files
+    // unchanged since, and stored for the next run otherwise. Empty if
+    // canceled: files skipped by a cancel have no hash and would look unique.
+    QVector<QStringList> hashBatch(const QStringList& candidates, const QVector<qint64>& sizes, int* readInFull) const {
+        MetadataDatabase& store = MetadataDatabase::instance();
+        QVector<QByteArray> partials(candidates.size());
+        ThreadPool::ioInstance().forEach(candidates.size(), [&](int i) {
+            const DocumentFingerprint fingerprint = store.retrieveFingerprint(candidates[i]);
+            if (fingerprint.fileSize == sizes[i] && !fingerprint.partialHash.isEmpty()) {
+                partials[i] = fingerprint.partialHash;
+                return;
+            }
+            partials[i] = partialHash(candidates[i], sizes[i]);
+            if (!partials[i].isEmpty() && fingerprint.fileSize == sizes[i]) {
+                DocumentFingerprint update = fingerprintKey(fingerprint);
+                update.partialHash = partials[i];
+                store.storeFingerprint(update);
+            }
+        });
+        if (CancellationToken::currentIsCanceled()) return {};
+
+        // Groups tied on size and partial hash; for short files that is final
+        QHash<QByteArray, int> byPartial;
+        QVector<QStringList> tied;
+        QVector<qint64> tiedSizes;
+        for (int i = 0; i < candidates.size(); ++i) {
+            if (partials[i].isEmpty()) continue;
+            const QByteArray key = QByteArray::number(sizes[i]) + ':' + partials[i];
+            auto it = byPartial.constFind(key);
+            if (it == byPartial.constEnd()) {
+                it = byPartial.insert(key, tied.size());
+                tied.append(QStringList());
+                tiedSizes.append(sizes[i]);
+            }
+            tied[it.value()].append(candidates[i]);
+        }
+        QVector<QStringList> groups;
+        QStringList fullCandidates;
+        for (int i = 0; i < tied.size(); ++i) {
+            if (tied[i].size() < 2) continue;
+            if (tiedSizes[i] <= 2 * PartialHashBytes) groups.append(tied[i]);
+            else fullCandidates.append(tied[i]);
+        }
+        *readInFull += fullCandidates.size();
+
+        QVector<QString> fullHashes(fullCandidates.size());
+        ThreadPool::ioInstance().forEach(fullCandidates.size(), [&](int i) {
+            const DocumentFingerprint fingerprint = store.retrieveFingerprint(fullCandidates[i]);
+            if (!fingerprint.contentHash.isEmpty()) {
+                fullHashes[i] = QString::fromLatin1(fingerprint.contentHash.toHex());
+                return;
+            }
+            fullHashes[i] = calculateFileHash(fullCandidates[i]);
+            if (!fullHashes[i].isEmpty() && !fingerprint.filePath.isEmpty()) {
+                DocumentFingerprint update = fingerprintKey(fingerprint);
+                update.contentHash = QByteArray::fromHex(fullHashes[i].toLatin1());
+                store.storeFingerprint(update);
+            }
+        });
+        if (CancellationToken::currentIsCanceled()) return {};
+        QHash<QString, QStringList> byFull;
+        for (int i = 0; i < fullCandidates.size(); ++i) {
+            if (!fullHashes[i].isEmpty()) byFull[fullHashes[i]].append(fullCandidates[i]);
+        }
+        for (const QStringList& group : qAsConst(byFull)) {
+            if (group.size() > 1) groups.append(group);
+        }
+        return groups;
+    }
 
     // Helper to calculate SHA256 hash of a file
     QString calculateFileHash(const QString& filePath) const {
@@ -47,10 +486,16 @@ public:
             return QString();
         }
 
+        // Read in chunks so that a cancel stops even a large file quickly
         QCryptographicHash hasher(QCryptographicHash::Sha256);
-        if (!hasher.addData(&file)) {
-            LOG_ERROR("DuplicateDetector: Failed to calculate hash for: " << filePath);
-            return QString();
+        while (!file.atEnd()) {
+            if (CancellationToken::currentIsCanceled()) return QString();
+            const QByteArray chunk = file.read(HashChunkBytes);
+            if (chunk.isEmpty()) {
+                LOG_ERROR("DuplicateDetector: Failed to calculate hash for: " << filePath);
+                return QString();
+            }
+            hasher.addData(chunk);
         }
 
         QString hash = hasher.result().toHex();
@@ -120,26 +565,84 @@ DuplicateDetector::DuplicateDetector(QObject* parent)
     : QObject(parent)
     , d(new Private(this))
 {
+    qRegisterMetaType<DuplicateGroup>("QuantilyxDoc::DuplicateGroup");
     LOG_INFO("DuplicateDetector created.");
 }
 
 DuplicateDetector::~DuplicateDetector()
 {
+    saveState();
     LOG_INFO("DuplicateDetector destroyed.");
 }
 
+bool DuplicateDetector::initialize(const QString& indexPath)
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->indexReady) {
+        LOG_WARN("DuplicateDetector::initialize: Already initialized.");
+        return true;
+    }
+
+    QString path = indexPath;
+    if (path.isEmpty()) {
+        path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/duplicates.idx";
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QString error;
+    if (!d->minHashes.load(path, &error)) {
+        // A damaged index only costs the signatures it held
+        LOG_WARN("DuplicateDetector: Discarding index " << path << ": " << error);
+    }
+    d->indexPathStr = path;
+    d->indexReady = true;
+    LOG_INFO("DuplicateDetector: Loaded " << d->minHashes.size() << " text signatures from " << path);
+    return true;
+}
+
+bool DuplicateDetector::saveState()
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->indexReady || !d->minHashes.isModified()) return true;
+    QString error;
+    if (!d->minHashes.save(d->indexPathStr, &error)) {
+        LOG_ERROR("DuplicateDetector: Failed to save index " << d->indexPathStr << ": " << error);
+        return false;
+    }
+    return true;
+}
+
 QList<Document*> DuplicateDetector::findDuplicatesForDocument(Document* document, float similarityThreshold) const
+{
+    const QStringList filePaths = findDuplicateFilesForDocument(document, similarityThreshold);
+    QList<Document*> duplicates;
+    if (filePaths.isEmpty() || !Application::instance()) return duplicates;
+    for (Document* open : Application::instance()->openDocuments()) {
+        if (open != document && filePaths.contains(open->filePath())) duplicates.append(open);
+    }
+    return duplicates;
+}
+
+QStringList DuplicateDetector::findDuplicateFilesForDocument(Document* document, float similarityThreshold) const
 {
     if (!document) {
         LOG_ERROR("DuplicateDetector::findDuplicatesForDocument: Null document provided.");
         return {};
     }
 
-    // This would require a pre-built index/database of fingerprints from other documents.
-    // For now, this is a stub that might compare against a list of known documents.
-    LOG_WARN("DuplicateDetector::findDuplicatesForDocument: Requires a pre-built index/database. Stub implementation.");
-    Q_UNUSED(similarityThreshold);
-    return {}; // Placeholder
+    emit d->q->analysisStarted(document);
+    MinHashIndex::Signature signature;
+    QStringList filePaths;
+    if (d->signatureOf(document, &signature)) {
+        QMutexLocker locker(&d->mutex);
+        for (const MinHashIndex::Match& match : d->minHashes.similar(signature, similarityThreshold, document->filePath())) {
+            filePaths.append(match.filePath);
+        }
+    } else {
+        LOG_DEBUG("DuplicateDetector: " << document->filePath() << " has no text to compare.");
+    }
+    LOG_DEBUG("DuplicateDetector: " << document->filePath() << " has " << filePaths.size() << " near-duplicates in the index.");
+    return filePaths;
 }
 
 QList<DuplicateGroup> DuplicateDetector::findDuplicatesInList(const QList<Document*>& documents, float similarityThreshold) const
@@ -153,86 +656,70 @@ QList<DuplicateGroup> DuplicateDetector::findDuplicatesInList(const QList<Docume
     d->lastDocCount = documents.size();
     d->lastDupCount = 0;
     d->lastResults.clear();
+    const QString method = d->activeMethodStr;
 
     emit batchAnalysisStarted();
 
-    // Use QtConcurrent for parallel processing of documents if possible
-    // For simplicity here, we'll do a sequential, pairwise comparison.
     QList<DuplicateGroup> groups;
-    QHash<QString, DuplicateGroup> hashToGroup; // Map fingerprint -> group for hash-based method
-
-    for (int i = 0; i < documents.size(); ++i) {
-        Document* doc1 = documents[i];
-        if (!doc1) continue;
-
-        emit analysisStarted(doc1);
-
-        QString fingerprint1;
-        if (d->activeMethodStr == "hash") {
-            fingerprint1 = d->calculateFileHash(doc1->filePath());
-        } else if (d->activeMethodStr == "text") {
-            fingerprint1 = d->q->fingerprintContent(doc1);
-        } else {
-            LOG_WARN("DuplicateDetector::findDuplicatesInList: Unknown method: " << d->activeMethodStr);
-            continue;
+    if (method == "text" || method == "perceptual") {
+        // Signatures are looked up and stored under the lock; the text is
+        // extracted and pages rendered without it
+        locker.unlock();
+        groups = method == "text" ? d->groupByText(documents, similarityThreshold)
+                                  : d->groupByLooks(documents, similarityThreshold);
+        locker.relock();
+        for (DuplicateGroup& group : groups) {
+            for (Document* document : group.documents) group.filePaths.append(document->filePath());
+        }
+    } else if (method == "hash") {
+        QHash<QString, QList<Document*>> byPath;
+        QStringList filePaths;
+        for (Document* document : documents) {
+            if (!document || document->filePath().isEmpty()) continue;
+            emit d->q->analysisStarted(document);
+            const QString path = QFileInfo(document->filePath()).absoluteFilePath();
+            if (!byPath.contains(path)) filePaths.append(path);
+            byPath[path].append(document);
         }
 
-        if (fingerprint1.isEmpty()) continue; // Could not fingerprint
-
-        // Check against already processed documents
-        bool addedToExistingGroup = false;
-        if (d->activeMethodStr == "hash") {
-            // For hash, if fingerprint matches, it's a duplicate
-            if (hashToGroup.contains(fingerprint1)) {
-                hashToGroup[fingerprint1].documents.append(doc1);
-                addedToExistingGroup = true;
-            } else {
-                DuplicateGroup newGroup;
-                newGroup.documents.append(doc1);
-                newGroup.similarityScore = 1.0f; // Exact hash match
-                newGroup.representativeFilePath = doc1->filePath();
-                hashToGroup.insert(fingerprint1, newGroup);
-                groups.append(newGroup);
-                d->lastDupCount++; // A new group with more than one doc is a duplicate group
-            }
-        } else { // text or other method requiring similarity comparison
-            for (auto& group : groups) {
-                if (!group.documents.isEmpty()) {
-                    Document* repDoc = group.documents.first(); // Use first doc in group as representative for comparison
-                    QString repFingerprint;
-                    if (d->activeMethodStr == "hash") {
-                        repFingerprint = d->calculateFileHash(repDoc->filePath());
-                    } else if (d->activeMethodStr == "text") {
-                        repFingerprint = d->q->fingerprintContent(repDoc);
-                    }
-
-                    float similarity = (d->activeMethodStr == "hash") ?
-                                      d->compareHashes(fingerprint1, repFingerprint) :
-                                      d->compareTextFingerprints(fingerprint1, repFingerprint);
+        // Files are read without the lock
+        locker.unlock();
+        QVector<Private::SizedFile> files;
+        for (const QString& path : qAsConst(filePaths)) {
+            const QFileInfo info(path);
+            if (info.isFile()) files.append({path, info.size()});
+        }
+        QVector<QStringList> fileGroups;
+        d->groupIdenticalFiles(files, [&](const QStringList& fileGroup) { fileGroups.append(fileGroup); });
+        locker.relock();
+        // The same file open more than once is its own duplicate
+        QSet<QString> grouped;
+        for (const QStringList& fileGroup : qAsConst(fileGroups)) {
+            for (const QString& path : fileGroup) grouped.insert(path);
+        }
+        for (const QString& path : qAsConst(filePaths)) {
+            if (byPath.value(path).size() > 1 && !grouped.contains(path)) fileGroups.append(QStringList(path));
+        }
 
-                    if (similarity >= similarityThreshold) {
-                        group.documents.append(doc1);
-                        group.similarityScore = qMax(group.similarityScore, similarity); // Update score to highest found
-                        addedToExistingGroup = true;
-                        d->lastDupCount++; // Increment for each new doc added to an existing group
-                        break; // Found a group, stop looking
-                    }
-                }
-            }
-            if (!addedToExistingGroup) {
-                // Create a new group for this document
-                DuplicateGroup newGroup;
-                newGroup.documents.append(doc1);
-                newGroup.similarityScore = 0.0f; // Will be updated if merged with another
-                newGroup.representativeFilePath = doc1->filePath();
-                groups.append(newGroup);
+        for (const QStringList& fileGroup : qAsConst(fileGroups)) {
+            DuplicateGroup group;
+            group.similarityScore = 1.0f; // Exact content match
+            group.representativeFilePath = fileGroup.first();
+            group.filePaths = fileGroup;
+            for (const QString& path : fileGroup) group.documents += byPath.value(path);
+            for (int i = 1; i < group.documents.size(); ++i) emit d->q->duplicateFound(group.documents.first(), group.documents[i], 1.0f);
+            for (Document* document : qAsConst(group.documents)) {
+                QList<Document*> others = group.documents;
+                others.removeOne(document);
+                emit d->q->analysisFinished(document, others);
             }
+            groups.append(group);
         }
-
-        emit analysisFinished(doc1, addedToExistingGroup ? groups.last().documents : QList<Document*>());
+    } else {
+        LOG_WARN("DuplicateDetector::findDuplicatesInList: Unknown method: " << method);
     }
 
-    // Finalize groups: remove groups with only one document (not duplicates)
+    // A document matching nothing is not a duplicate
     auto it = groups.begin();
     while (it != groups.end()) {
         if (it->documents.size() <= 1) {
@@ -260,30 +747,45 @@ QList<DuplicateGroup> DuplicateDetector::findDuplicatesInDirectory(const QString
     }
 
     QStringList filters = {"*.pdf", "*.epub", "*.djvu", "*.cbz", "*.cbr", "*.ps", "*.xps", "*.chm", "*.md", "*.fb2", "*.mobi", "*.txt", "*.rtf"}; // Add more as needed
-    QStringList fileNames = dir.entryList(filters, QDir::Files | (recursive ? QDir::NoDotAndDotDot | QDir::AllDirs : QDir::NoDotAndDotDot), QDir::Name);
-    // Recursively get files if requested (QDirIterator is better for this)
-    if (recursive) {
-        fileNames.clear(); // Clear initial list
-        QDirIterator it(directoryPath, filters, QDir::Files, QDirIterator::Subdirectories);
-        while (it.hasNext()) {
-            fileNames.append(it.next());
-        }
+
+    QMutexLocker locker(&d->mutex);
+    if (d->analyzing) {
+        LOG_WARN("DuplicateDetector::findDuplicatesInDirectory: Analysis already in progress.");
+        return {};
+    }
+    if (d->activeMethodStr != "hash") {
+        // Comparing text needs every file loaded as a Document
+        LOG_WARN("DuplicateDetector::findDuplicatesInDirectory: Method '" << d->activeMethodStr << "' needs loaded documents; use findDuplicatesInList().");
+        return {};
     }
+    Q_UNUSED(similarityThreshold); // Identical content only
+    d->analyzing = true;
+    locker.unlock();
+
+    emit d->q->batchAnalysisStarted();
+    const QVector<Private::SizedFile> files = Private::listFiles(directoryPath, filters, recursive);
+
+    // Each group is final once its batch is hashed and reported right away
+    QList<DuplicateGroup> groups;
+    d->groupIdenticalFiles(files, [&](const QStringList& fileGroup) {
+        DuplicateGroup group;
+        group.similarityScore = 1.0f;
+        group.representativeFilePath = fileGroup.first();
+        group.filePaths = fileGroup;
+        groups.append(group);
+        emit d->q->duplicateGroupFound(group);
+    });
+
+    locker.relock();
+    d->lastDocCount = files.size();
+    d->lastDupCount = groups.size();
+    d->lastResults = groups;
+    d->analyzing = false;
+    locker.unlock();
 
-    // This requires loading Document objects for each file to pass to findDuplicatesInList.
-    // This is expensive. A more efficient method would fingerprint files directly without full Document loading.
-    LOG_WARN("DuplicateDetector::findDuplicatesInDirectory: Loading full Document objects for each file. Consider optimizing by fingerprinting files directly.");
-    QList<Document*> docs;
-    // QList<Document*> docs = loadDocumentsFromFilePaths(fileNames); // Hypothetical function to load docs from paths
-
-    // For now, let's assume we have a list of Document* objects loaded from the file paths.
-    // This is a critical performance bottleneck and needs a better implementation.
-    // A real implementation would fingerprint files directly (e.g., hash, text fingerprint) and store/process them without Document objects.
-    // This is a stub.
-    Q_UNUSED(docs);
-    Q_UNUSED(similarityThreshold);
-    LOG_WARN("DuplicateDetector::findDuplicatesInDirectory: Requires efficient file fingerprinting. Returning empty list.");
-    return {}; // Placeholder
+    emit d->q->batchAnalysisFinished(groups);
+    LOG_INFO("DuplicateDetector: Scanned " << files.size() << " files in " << directoryPath << ", found " << groups.size() << " duplicate groups.");
+    return groups;
 }
 
 bool DuplicateDetector::isAnalyzing() const
@@ -321,7 +823,7 @@ void DuplicateDetector::setSimilarityThreshold(float threshold)
 
 QStringList DuplicateDetector::supportedMethods() const
 {
-    return QStringList() << "hash" << "text"; // Add more as implemented
+    return QStringList() << "hash" << "text" << "perceptual"; // Add more as implemented
 }
 
 QString DuplicateDetector::activeMethod() const
@@ -15,6 +15,7 @@
 #include <QPair>
 #include <QHash>
 #include <QMutex>
+#include <QStringList>
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -28,6 +29,7 @@ struct DuplicateGroup {
     QList<Document*> documents; // List of documents in this group
     float similarityScore;      // Overall similarity score for the group (0.0 - 1.0, 1.0 = exact duplicate)
     QString representativeFilePath; // A path chosen as the "representative" of the group
+    QStringList filePaths;      // Files of the group; the only members of a directory scan's groups
 };
 
 /**
@@ -35,6 +37,33 @@ struct DuplicateGroup {
  * 
  * Uses techniques like file hashing, content fingerprinting, or metadata comparison
  * to identify documents that are identical or highly similar.
+ *
+ * The "text" method compares MinHash signatures of the documents' word
+ * shingles through LSH bands (see MinHashIndex), so a document is only
+ * compared with the few that share a band with it. Every signature
+ * computed is kept in an index saved by saveState() and loaded by
+ * initialize(), so documents are checked against all documents seen
+ * before, and a file's text is extracted again only once it changed.
+ *
+ * The "hash" method finds files of identical content. Files are grouped
+ * by size first; only those sharing a size are read, their first and last
+ * 64 KB hashed, and only those still tied are hashed in full, with the
+ * reads spread over the I/O thread pool. A directory scan therefore reads
+ * little beyond the directory listing and loads no documents. Its
+ * directories are listed in parallel too, and files are hashed in batches
+ * of sizes, smallest first, each batch's groups reported through
+ * duplicateGroupFound() before the next is read; only one batch's hashes
+ * are held at a time.
+ *
+ * Hashes, signatures and page hashes are kept in MetadataDatabase's
+ * fingerprint store by file path, size and modification time, so a run
+ * over unchanged files reads none of them again.
+ *
+ * The "perceptual" method compares how the first pages look, for scans
+ * and images without text: each page's pHash (see PerceptualHash) is taken
+ * from its stored thumbnail, or from a render that is then stored as one,
+ * and candidates are looked up in a BK-tree by Hamming distance. The
+ * threshold allows (1 - threshold) * 64 differing bits per page.
  */
 class DuplicateDetector : public QObject
 {
@@ -58,14 +87,39 @@ public:
      */
     static DuplicateDetector& instance();
 
+    /**
+     * @brief Load the index of text signatures.
+     * @param indexPath Index file; empty for duplicates.idx in the application data directory.
+     * @return True once the detector is ready; a damaged index is started afresh.
+     */
+    bool initialize(const QString& indexPath = QString());
+
+    /**
+     * @brief Save the index of text signatures if it changed.
+     * @return False on a write error.
+     */
+    bool saveState();
+
     /**
      * @brief Analyze a single document for duplicates against the database/index.
+     * Only the open documents among findDuplicateFilesForDocument() are returned.
      * @param document The document to analyze.
      * @param similarityThreshold Minimum similarity score to consider a match (0.0 - 1.0).
      * @return List of documents considered duplicates/similars to the input document.
      */
     QList<Document*> findDuplicatesForDocument(Document* document, float similarityThreshold = 0.95f) const;
 
+    /**
+     * @brief Find the files in the index whose text is a near-duplicate of a document's.
+     * The document's signature is added to the index. Similarity is
+     * estimated from the signatures; pairs much below 0.8 are found less
+     * and less reliably.
+     * @param document The document to analyze.
+     * @param similarityThreshold Minimum similarity score to consider a match (0.0 - 1.0).
+     * @return Paths of the similar files, most similar first.
+     */
+    QStringList findDuplicateFilesForDocument(Document* document, float similarityThreshold = 0.95f) const;
+
     /**
      * @brief Analyze a list of documents to find all duplicates/similars among them.
      * @param documents The list of documents to analyze.
@@ -76,10 +130,12 @@ public:
 
     /**
      * @brief Analyze documents in a specific directory for duplicates.
+     * Only the "hash" method works on files that are not loaded; the
+     * groups list filePaths and no documents.
      * @param directoryPath Path to the directory to scan.
      * @param recursive Whether to scan subdirectories.
-     * @param similarityThreshold Minimum similarity score to consider a match (0.0 - 1.0).
-     * @return List of groups of duplicate/similar documents.
+     * @param similarityThreshold Unused; files match only if identical.
+     * @return List of groups of identical files, also emitted one by one as found.
      */
     QList<DuplicateGroup> findDuplicatesInDirectory(const QString& directoryPath, bool recursive = true, float similarityThreshold = 0.95f) const;
 
@@ -127,7 +183,7 @@ public:
 
     /**
      * @brief Set the active analysis method.
-     * @param method Method name (e.g., "hash", "text").
+     * @param method Method name: "hash", "text" or "perceptual".
      */
     void setActiveMethod(const QString& method);
 
@@ -170,9 +226,17 @@ signals:
      */
     void duplicateFound(QuantilyxDoc::Document* document1, QuantilyxDoc::Document* document2, float similarityScore);
 
+    /**
+     * @brief Emitted during a directory scan as soon as a group is complete.
+     * Emitted from the scanning thread; batchAnalysisFinished() lists all groups.
+     * @param group Group of identical files.
+     */
+    void duplicateGroupFound(const QuantilyxDoc::DuplicateGroup& group);
+
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static DuplicateDetector* s_instance;
 
     // Helper to calculate a hash for a document (e.g., SHA256 of file content)
     QString calculateFileHash(const QString& filePath) const;
@@ -186,4 +250,6 @@ private:
 
 } // namespace QuantilyxDoc
 
+Q_DECLARE_METATYPE(QuantilyxDoc::DuplicateGroup)
+
 #endif // QUANTILYX_DUPLICATEDETECTOR_H
\ No newline at end of file
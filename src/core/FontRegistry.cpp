@@ -0,0 +1,122 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "FontRegistry.h"
+#include "Logger.h"
+#include <QCryptographicHash>
+#include <QFontDatabase>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+class FontRegistry::Private {
+public:
+    struct Font {
+        int id = -1; // QFontDatabase application font ID
+        QStringList families;
+        QSet<const void*> owners;
+    };
+
+    mutable QMutex mutex;
+    QHash<QByteArray, Font> fonts;                // By SHA-1 of the data
+    QHash<const void*, QList<QByteArray>> owned;  // Hashes each owner added
+    std::atomic<qint64> shared{0};
+};
+
+FontRegistry* FontRegistry::s_instance = nullptr;
+
+FontRegistry& FontRegistry::instance()
+{
+    if (!s_instance) {
+        s_instance = new FontRegistry();
+    }
+    return *s_instance;
+}
+
+FontRegistry::FontRegistry()
+    : d(new Private())
+{
+}
+
+FontRegistry::~FontRegistry() = default;
+
+QStringList FontRegistry::addFont(const QByteArray& data, const void* owner)
+{
+    if (data.isEmpty()) return QStringList();
+    const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+    QMutexLocker locker(&d->mutex);
+    auto it = d->fonts.find(hash);
+    if (it == d->fonts.end()) {
+        Private::Font font;
+        font.id = QFontDatabase::addApplicationFontFromData(data);
+        if (font.id < 0) {
+            LOG_WARN("FontRegistry: Qt cannot load an embedded font of " << data.size() << " bytes");
+            return QStringList();
+        }
+        font.families = QFontDatabase::applicationFontFamilies(font.id);
+        LOG_DEBUG("FontRegistry: Registered " << font.families.join(", ") << " (" << data.size() << " bytes)");
+        it = d->fonts.insert(hash, font);
+    } else if (!it->owners.contains(owner)) {
+        d->shared.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!it->owners.contains(owner)) {
+        it->owners.insert(owner);
+        d->owned[owner].append(hash);
+    }
+    return it->families;
+}
+
+void FontRegistry::release(const void* owner)
+{
+    QMutexLocker locker(&d->mutex);
+    const QList<QByteArray> hashes = d->owned.take(owner);
+    for (const QByteArray& hash : hashes) {
+        auto it = d->fonts.find(hash);
+        if (it == d->fonts.end()) continue;
+        it->owners.remove(owner);
+        if (it->owners.isEmpty()) {
+            QFontDatabase::removeApplicationFont(it->id);
+            LOG_DEBUG("FontRegistry: Removed " << it->families.join(", "));
+            d->fonts.erase(it);
+        }
+    }
+}
+
+int FontRegistry::fontCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->fonts.size();
+}
+
+qint64 FontRegistry::sharedCount() const
+{
+    return d->shared.load(std::memory_order_relaxed);
+}
+
+QByteArray FontRegistry::deobfuscateOfficeFont(const QByteArray& data, const QString& fontKey)
+{
+    QString hex = fontKey;
+    hex.remove(QLatin1Char('{')).remove(QLatin1Char('}')).remove(QLatin1Char('-'));
+    const QByteArray key = QByteArray::fromHex(hex.toLatin1());
+    if (key.size() != 16 || data.size() < 32) return data;
+
+    // ECMA-376 part 2: the key bytes run backwards over each of the first two 16-byte blocks
+    QByteArray plain = data;
+    for (int i = 0; i < 32; ++i) {
+        plain[i] = char(plain[i] ^ key[15 - (i % 16)]);
+    }
+    return plain;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,89 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FONTREGISTRY_H
+#define QUANTILYX_FONTREGISTRY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Application fonts embedded in documents, shared between them.
+ *
+ * Reflowable backends (EPUB, DOCX, ODT) hand their embedded fonts here
+ * instead of to QFontDatabase directly. Fonts are keyed by a SHA-1 hash of
+ * their data, so a font that ten open books embed is registered once, and
+ * every document laying text out in it resolves to the same font engine,
+ * whose glyph cache then serves all their pages. A font is removed from
+ * the font database when the last document that added it releases it.
+ *
+ * Safe to call from any thread.
+ */
+class FontRegistry
+{
+public:
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global FontRegistry instance.
+     */
+    static FontRegistry& instance();
+
+    ~FontRegistry();
+
+    /**
+     * @brief Add an embedded font on behalf of a document.
+     * @param data TrueType, OpenType or WOFF data.
+     * @param owner Document the font belongs to; see release().
+     * @return Family names the font provides; empty if Qt cannot load it.
+     */
+    QStringList addFont(const QByteArray& data, const void* owner);
+
+    /**
+     * @brief Release every font an owner added.
+     * @param owner Document, as passed to addFont().
+     */
+    void release(const void* owner);
+
+    /**
+     * @brief Get the number of distinct fonts registered.
+     * @return Font count.
+     */
+    int fontCount() const;
+
+    /**
+     * @brief Get the number of addFont() calls served by a font already registered.
+     * @return Count since startup.
+     */
+    qint64 sharedCount() const;
+
+    /**
+     * @brief Undo the obfuscation of a font embedded in a DOCX file.
+     * Word XORs the first 32 bytes with the font key GUID from fontTable.xml.
+     * @param data Font data as stored (usually a .odttf part).
+     * @param fontKey The w:fontKey attribute, such as "{6C0D1A8F-...}".
+     * @return Plain font data; data itself if the key is malformed.
+     */
+    static QByteArray deobfuscateOfficeFont(const QByteArray& data, const QString& fontKey);
+
+private:
+    FontRegistry();
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static FontRegistry* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FONTREGISTRY_H
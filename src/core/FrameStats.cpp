@@ -0,0 +1,330 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "FrameStats.h"
+#include "RenderThread.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Fixed-size buffer that overwrites its oldest entry when full
+template <typename T>
+class Ring {
+public:
+    void push(const T& item) {
+        if (items.size() < FrameStats::Capacity) {
+            items.append(item);
+        } else {
+            items[next] = item;
+        }
+        next = (next + 1) % FrameStats::Capacity;
+    }
+
+    QVector<T> ordered() const {
+        if (items.size() < FrameStats::Capacity) return items;
+        QVector<T> result;
+        result.reserve(items.size());
+        for (int i = 0; i < items.size(); ++i) {
+            result.append(items.at((next + i) % items.size()));
+        }
+        return result;
+    }
+
+    void clear() {
+        items.clear();
+        next = 0;
+    }
+
+private:
+    QVector<T> items;
+    int next = 0;
+};
+
+} // namespace
+
+class FrameStats::Private {
+public:
+    struct Pending {
+        qint64 requestedUs;
+        int pageIndex;
+        int tileX;
+        int tileY;
+    };
+
+    Private() : enabled(false), queuedRenders(0), activeRenders(0) {}
+
+    std::atomic<bool> enabled;
+    QElapsedTimer clock;
+
+    mutable QMutex mutex;
+    Ring<Frame> frames;
+    Ring<RenderLatency> renders;
+    QHash<quintptr, Pending> pending; // Requested renders not completed yet
+    int queuedRenders;
+    int activeRenders;
+
+    void renderCompleted(const RenderThread::RenderResult& result) {
+        const qint64 now = clock.nsecsElapsed() / 1000;
+        QMutexLocker locker(&mutex);
+        auto it = pending.find(result.requestId);
+        if (it == pending.end()) return; // Not requested through a view, or dropped
+        renders.push(RenderLatency{result.requestId, it->requestedUs, now - it->requestedUs,
+                                   result.renderTimeMs * 1000, it->pageIndex, it->tileX, it->tileY,
+                                   result.success});
+        pending.erase(it);
+    }
+};
+
+// Static instance pointer
+FrameStats* FrameStats::s_instance = nullptr;
+
+FrameStats& FrameStats::instance()
+{
+    if (!s_instance) {
+        s_instance = new FrameStats();
+    }
+    return *s_instance;
+}
+
+FrameStats::FrameStats(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    d->clock.start();
+
+    // Queued to this object's thread, so latencies include the hop to the view
+    connect(&RenderThread::instance(), &RenderThread::renderCompleted, this,
+            [this](const RenderThread::RenderResult& result) {
+                if (isEnabled()) d->renderCompleted(result);
+            });
+
+    setEnabled(Settings::instance().value<bool>("Advanced/FrameStats", false));
+}
+
+FrameStats::~FrameStats() = default;
+
+bool FrameStats::isEnabled() const
+{
+    return d->enabled.load(std::memory_order_relaxed);
+}
+
+void FrameStats::setEnabled(bool enabled)
+{
+    if (d->enabled.exchange(enabled) == enabled) return;
+    if (enabled) {
+        clear();
+        d->clock.restart();
+    }
+    LOG_INFO("FrameStats: Recording " << (enabled ? "started." : "stopped."));
+    emit enabledChanged(enabled);
+}
+
+qint64 FrameStats::nowUs() const
+{
+    return d->clock.nsecsElapsed() / 1000;
+}
+
+void FrameStats::recordFrame(qint64 startUs, int cacheHits, int cacheMisses)
+{
+    if (!isEnabled()) return;
+    const qint64 now = nowUs();
+    // Sampled per frame rather than taken from queueStatusChanged(), which fires per render
+    const int queued = RenderThread::instance().pendingRequestCount();
+    const int active = RenderThread::instance().activeRequestCount();
+    QMutexLocker locker(&d->mutex);
+    d->queuedRenders = queued;
+    d->activeRenders = active;
+    d->frames.push(Frame{startUs, now - startUs, cacheHits, cacheMisses, d->queuedRenders, d->activeRenders});
+}
+
+void FrameStats::noteRenderRequested(quintptr requestId, int pageIndex, int tileX, int tileY)
+{
+    if (!isEnabled()) return;
+    const qint64 now = nowUs();
+    QMutexLocker locker(&d->mutex);
+    // Canceled requests never complete; drop them once they pile up
+    if (d->pending.size() >= Capacity) {
+        d->pending.clear();
+    }
+    d->pending.insert(requestId, Private::Pending{now, pageIndex, tileX, tileY});
+}
+
+QVector<FrameStats::Frame> FrameStats::frames() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->frames.ordered();
+}
+
+QVector<FrameStats::RenderLatency> FrameStats::renderLatencies() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->renders.ordered();
+}
+
+FrameStats::Summary FrameStats::summary(int windowMs) const
+{
+    const QVector<Frame> allFrames = frames();
+    const QVector<RenderLatency> allRenders = renderLatencies();
+    const qint64 since = nowUs() - static_cast<qint64>(windowMs) * 1000;
+
+    Summary summary;
+    {
+        QMutexLocker locker(&d->mutex);
+        summary.queuedRenders = d->queuedRenders;
+        summary.activeRenders = d->activeRenders;
+    }
+
+    qint64 paintTotal = 0;
+    qint64 paintMax = 0;
+    qint64 hits = 0;
+    qint64 lookups = 0;
+    for (const Frame& frame : allFrames) {
+        if (frame.timestampUs < since) continue;
+        ++summary.frames;
+        paintTotal += frame.paintUs;
+        paintMax = qMax(paintMax, frame.paintUs);
+        hits += frame.cacheHits;
+        lookups += frame.cacheHits + frame.cacheMisses;
+    }
+    if (summary.frames > 0) {
+        summary.framesPerSecond = summary.frames * 1000.0 / qMax(1, windowMs);
+        summary.averagePaintMs = paintTotal / 1000.0 / summary.frames;
+        summary.maxPaintMs = paintMax / 1000.0;
+    }
+    if (lookups > 0) {
+        summary.cacheHitRate = static_cast<qreal>(hits) / lookups;
+    }
+
+    qint64 latencyTotal = 0;
+    qint64 latencyMax = 0;
+    for (const RenderLatency& render : allRenders) {
+        if (render.requestedUs + render.latencyUs < since) continue;
+        ++summary.renders;
+        latencyTotal += render.latencyUs;
+        latencyMax = qMax(latencyMax, render.latencyUs);
+    }
+    if (summary.renders > 0) {
+        summary.averageLatencyMs = latencyTotal / 1000.0 / summary.renders;
+        summary.maxLatencyMs = latencyMax / 1000.0;
+    }
+    return summary;
+}
+
+void FrameStats::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->frames.clear();
+    d->renders.clear();
+    d->pending.clear();
+}
+
+bool FrameStats::exportCsv(const QString& filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        LOG_ERROR("FrameStats: Cannot write " << filePath << ": " << file.errorString());
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "kind,timestamp_us,duration_us,cache_hits,cache_misses,queued_renders,active_renders,"
+           "request_id,page,tile_x,tile_y,worker_us,success\n";
+    for (const Frame& frame : frames()) {
+        out << "paint," << frame.timestampUs << ',' << frame.paintUs << ','
+            << frame.cacheHits << ',' << frame.cacheMisses << ','
+            << frame.queuedRenders << ',' << frame.activeRenders << ",,,,,,\n";
+    }
+    for (const RenderLatency& render : renderLatencies()) {
+        out << "render," << render.requestedUs << ',' << render.latencyUs << ",,,,,"
+            << render.requestId << ',' << render.pageIndex << ',' << render.tileX << ','
+            << render.tileY << ',' << render.renderUs << ',' << (render.success ? 1 : 0) << '\n';
+    }
+    out.flush();
+    if (out.status() != QTextStream::Ok) {
+        LOG_ERROR("FrameStats: Failed writing " << filePath);
+        return false;
+    }
+    LOG_INFO("FrameStats: Exported CSV to " << filePath);
+    return true;
+}
+
+bool FrameStats::exportChromeTrace(const QString& filePath) const
+{
+    // Paints on one track, queue depth as a counter, and renders as async
+    // spans since they overlap each other
+    QJsonArray events;
+    auto event = [](const QString& name, const QString& phase, qint64 ts) {
+        QJsonObject object;
+        object["name"] = name;
+        object["ph"] = phase;
+        object["ts"] = static_cast<double>(ts);
+        object["pid"] = 1;
+        object["tid"] = 1;
+        return object;
+    };
+
+    for (const Frame& frame : frames()) {
+        QJsonObject paint = event("paint", "X", frame.timestampUs);
+        paint["cat"] = "frame";
+        paint["dur"] = static_cast<double>(frame.paintUs);
+        paint["args"] = QJsonObject{{"cacheHits", frame.cacheHits}, {"cacheMisses", frame.cacheMisses}};
+        events.append(paint);
+
+        QJsonObject queue = event("render queue", "C", frame.timestampUs);
+        queue["args"] = QJsonObject{{"queued", frame.queuedRenders}, {"active", frame.activeRenders}};
+        events.append(queue);
+    }
+
+    for (const RenderLatency& render : renderLatencies()) {
+        const QString name = QString("page %1").arg(render.pageIndex + 1);
+        const QString id = QString::number(static_cast<qulonglong>(render.requestId));
+        QJsonObject begin = event(name, "b", render.requestedUs);
+        begin["cat"] = "render";
+        begin["id"] = id;
+        begin["args"] = QJsonObject{{"tileX", render.tileX}, {"tileY", render.tileY},
+                                    {"workerMs", render.renderUs / 1000.0}, {"success", render.success}};
+        events.append(begin);
+        QJsonObject end = event(name, "e", render.requestedUs + render.latencyUs);
+        end["cat"] = "render";
+        end["id"] = id;
+        events.append(end);
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        LOG_ERROR("FrameStats: Cannot write " << filePath << ": " << file.errorString());
+        return false;
+    }
+    const QByteArray json = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+    if (file.write(json) != json.size()) {
+        LOG_ERROR("FrameStats: Failed writing " << filePath);
+        return false;
+    }
+    LOG_INFO("FrameStats: Exported Chrome trace to " << filePath);
+    return true;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,186 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FRAMESTATS_H
+#define QUANTILYX_FRAMESTATS_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Records paint and render timings for diagnosing stutter.
+ *
+ * Views report each paint with its duration and tile cache hits and misses,
+ * and each tile render they request. The render queue depth is sampled
+ * at each frame and completions are taken from
+ * RenderThread::renderCompleted(), so latencies are measured up to the
+ * moment the view can use the result. The last Capacity frames and renders
+ * are kept and can be exported as CSV or as a Chrome trace (chrome://tracing,
+ * Perfetto). Recording is off unless enabled (Advanced/FrameStats) and
+ * costs one flag check per call when off.
+ */
+class FrameStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Frames and renders kept; older ones are overwritten.
+     */
+    static constexpr int Capacity = 4096;
+
+    /**
+     * @brief One paint of a view.
+     */
+    struct Frame {
+        qint64 timestampUs;  // Start of the paint since recording started
+        qint64 paintUs;      // Duration of the paint
+        int cacheHits;       // Tiles drawn from the caches
+        int cacheMisses;     // Tiles drawn as placeholders
+        int queuedRenders;   // Render queue depth at the time
+        int activeRenders;   // Renders in progress at the time
+    };
+
+    /**
+     * @brief Timing of one requested render, from request to completion.
+     */
+    struct RenderLatency {
+        quintptr requestId;
+        qint64 requestedUs;  // Time of the request since recording started
+        qint64 latencyUs;    // Time until renderCompleted() reached the main thread
+        qint64 renderUs;     // Time a worker spent on it, 0 if it joined another render
+        int pageIndex;
+        int tileX;
+        int tileY;
+        bool success;
+    };
+
+    /**
+     * @brief Aggregates over a recent time window.
+     */
+    struct Summary {
+        int frames = 0;
+        qreal framesPerSecond = 0.0;
+        qreal averagePaintMs = 0.0;
+        qreal maxPaintMs = 0.0;
+        qreal cacheHitRate = 0.0;   // 0..1
+        int queuedRenders = 0;       // Latest sample
+        int activeRenders = 0;       // Latest sample
+        int renders = 0;
+        qreal averageLatencyMs = 0.0;
+        qreal maxLatencyMs = 0.0;
+    };
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global FrameStats instance.
+     */
+    static FrameStats& instance();
+
+    /**
+     * @brief Destructor.
+     */
+    ~FrameStats() override;
+
+    /**
+     * @brief Check if recording is on.
+     * @return True if recording.
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Turn recording on or off. Turning it on starts a new recording.
+     * @param enabled True to record.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Get the current time on the recording clock.
+     * @return Microseconds since recording started.
+     */
+    qint64 nowUs() const;
+
+    /**
+     * @brief Record one paint.
+     * @param startUs Start of the paint, from nowUs().
+     * @param cacheHits Tiles drawn from the caches.
+     * @param cacheMisses Tiles drawn as placeholders.
+     */
+    void recordFrame(qint64 startUs, int cacheHits, int cacheMisses);
+
+    /**
+     * @brief Note that a render was requested, to time it to completion.
+     * @param requestId ID of the render request.
+     * @param pageIndex Page being rendered.
+     * @param tileX Tile column, or -1 for a whole page.
+     * @param tileY Tile row, or -1 for a whole page.
+     */
+    void noteRenderRequested(quintptr requestId, int pageIndex, int tileX, int tileY);
+
+    /**
+     * @brief Get the recorded frames, oldest first.
+     * @return Frames.
+     */
+    QVector<Frame> frames() const;
+
+    /**
+     * @brief Get the completed renders, oldest first.
+     * @return Render latencies.
+     */
+    QVector<RenderLatency> renderLatencies() const;
+
+    /**
+     * @brief Summarize the most recent frames and renders.
+     * @param windowMs Length of the window in milliseconds.
+     * @return Summary.
+     */
+    Summary summary(int windowMs = 1000) const;
+
+    /**
+     * @brief Drop everything recorded so far.
+     */
+    void clear();
+
+    /**
+     * @brief Write frames and renders as CSV, one row each.
+     * @param filePath Output file.
+     * @return True on success.
+     */
+    bool exportCsv(const QString& filePath) const;
+
+    /**
+     * @brief Write frames, queue depth and renders in Chrome trace event format.
+     * @param filePath Output file.
+     * @return True on success.
+     */
+    bool exportChromeTrace(const QString& filePath) const;
+
+signals:
+    /**
+     * @brief Emitted when recording is turned on or off.
+     * @param enabled True if now recording.
+     */
+    void enabledChanged(bool enabled);
+
+private:
+    explicit FrameStats(QObject* parent = nullptr);
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static FrameStats* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FRAMESTATS_H
@@ -0,0 +1,158 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ImageBufferPool.h"
+#include "MemoryBudget.h"
+#include "PixelFormat.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <climits>
+#include <cstdlib>
+
+namespace QuantilyxDoc {
+
+class ImageBufferPool::Private {
+public:
+    // Header placed in front of every pooled buffer so the cleanup
+    // function knows its size without a lookup
+    struct Buffer {
+        qint64 bytes;
+    };
+
+    Private() : idleTotal(0), memoryConsumerId(0) {}
+
+    mutable QMutex mutex;
+    QHash<qint64, QVector<Buffer*>> idle; // Idle buffers by capacity
+    qint64 idleTotal;
+    int memoryConsumerId;
+
+    static qint64 maxIdleBytes() {
+        return static_cast<qint64>(Settings::snapshot().imageBufferPoolMB) * 1024 * 1024;
+    }
+
+    static uchar* pixels(Buffer* buffer) {
+        return reinterpret_cast<uchar*>(buffer) + HeaderSize;
+    }
+
+    // Keeps the pixels 16-byte aligned for SIMD blending
+    static constexpr qint64 HeaderSize = 16;
+};
+
+ImageBufferPool* ImageBufferPool::s_instance = nullptr;
+
+ImageBufferPool& ImageBufferPool::instance()
+{
+    if (!s_instance) {
+        s_instance = new ImageBufferPool();
+    }
+    return *s_instance;
+}
+
+ImageBufferPool::ImageBufferPool()
+    : d(new Private())
+{
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "Image buffer pool", MemoryBudget::Priority::Low,
+        [this]() { return idleBytes(); },
+        [this](qint64 bytes) { return releaseIdle(bytes); });
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+    releaseIdle(idleBytes());
+}
+
+QImage ImageBufferPool::acquire(const QSize& size, QImage::Format format)
+{
+    if (size.isEmpty() || format == QImage::Format_Invalid) return QImage();
+
+    const qint64 bytesPerLine = PixelFormat::bytesPerLine(format, size.width());
+    const qint64 bytes = bytesPerLine * size.height();
+    if (bytesPerLine > INT_MAX) return QImage();
+
+    Private::Buffer* buffer = nullptr;
+    {
+        QMutexLocker locker(&d->mutex);
+        auto it = d->idle.find(bytes);
+        if (it != d->idle.end() && !it->isEmpty()) {
+            buffer = it->takeLast();
+            d->idleTotal -= bytes;
+        }
+    }
+    if (!buffer) {
+        buffer = static_cast<Private::Buffer*>(std::malloc(static_cast<size_t>(Private::HeaderSize + bytes)));
+        if (!buffer) {
+            LOG_ERROR("ImageBufferPool: Out of memory for a " << size << " image.");
+            return QImage();
+        }
+        buffer->bytes = bytes;
+    }
+
+    return QImage(Private::pixels(buffer), size.width(), size.height(), static_cast<int>(bytesPerLine),
+                  format, &ImageBufferPool::recycle, buffer);
+}
+
+void ImageBufferPool::recycle(void* info)
+{
+    Private::Buffer* buffer = static_cast<Private::Buffer*>(info);
+    ImageBufferPool& pool = instance();
+    {
+        QMutexLocker locker(&pool.d->mutex);
+        if (pool.d->idleTotal + buffer->bytes <= Private::maxIdleBytes()) {
+            pool.d->idle[buffer->bytes].append(buffer);
+            pool.d->idleTotal += buffer->bytes;
+            return;
+        }
+    }
+    std::free(buffer);
+}
+
+QImage ImageBufferPool::toPipelineFormat(QImage image)
+{
+    if (image.isNull() || image.format() == PipelineFormat) return image;
+    // Narrower formats expand into a pooled buffer through their own kernel
+    if (PixelFormat::isSpecialized(image.format())) return PixelFormat::toPipelineFormat(image);
+    // Same-depth conversions run in place on an unshared rvalue
+    return std::move(image).convertToFormat(PipelineFormat);
+}
+
+qint64 ImageBufferPool::idleBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->idleTotal;
+}
+
+qint64 ImageBufferPool::releaseIdle(qint64 bytes)
+{
+    QVector<Private::Buffer*> freed;
+    qint64 released = 0;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (auto it = d->idle.begin(); it != d->idle.end() && released < bytes;) {
+            while (!it->isEmpty() && released < bytes) {
+                Private::Buffer* buffer = it->takeLast();
+                released += buffer->bytes;
+                freed.append(buffer);
+            }
+            it = it->isEmpty() ? d->idle.erase(it) : it + 1;
+        }
+        d->idleTotal -= released;
+    }
+    for (Private::Buffer* buffer : freed) {
+        std::free(buffer);
+    }
+    return released;
+}
+
+} // namespace QuantilyxDoc
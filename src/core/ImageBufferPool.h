@@ -0,0 +1,89 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_IMAGEBUFFERPOOL_H
+#define QUANTILYX_IMAGEBUFFERPOOL_H
+
+#include <QImage>
+#include <QSize>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Recycles the pixel buffers of rendered and decoded page images.
+ *
+ * acquire() returns a QImage over a pooled buffer. When the last copy of
+ * that image goes away (say, when PageCache evicts it) the buffer returns
+ * to the pool instead of the heap, so scrolling through tiles of one size
+ * stops allocating. Idle buffers are capped by Advanced/ImageBufferPoolMB
+ * and are released first under memory pressure.
+ *
+ * The whole render-to-screen pipeline uses PipelineFormat: it is what
+ * QPainter blends fastest onto the widget backing store, and converting
+ * to it from ARGB32 happens in place, and from RGB888, Grayscale8 and Mono
+ * through PixelFormat's kernels into a pooled buffer.
+ */
+class ImageBufferPool
+{
+public:
+    /**
+     * @brief Pixel format of every image the render pipeline hands on.
+     */
+    static constexpr QImage::Format PipelineFormat = QImage::Format_ARGB32_Premultiplied;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global ImageBufferPool instance.
+     */
+    static ImageBufferPool& instance();
+
+    /**
+     * @brief Get an image backed by a pooled buffer. Pixels are not initialized.
+     * @param size Image size.
+     * @param format Pixel format.
+     * @return Image, or a null image if the size is invalid or memory ran out.
+     */
+    QImage acquire(const QSize& size, QImage::Format format = PipelineFormat);
+
+    /**
+     * @brief Convert an image to PipelineFormat, in place when possible.
+     * @param image Image to convert; pass an rvalue so the buffer can be reused.
+     * @return Image in PipelineFormat.
+     */
+    static QImage toPipelineFormat(QImage image);
+
+    /**
+     * @brief Get the memory held by idle buffers.
+     * @return Size in bytes.
+     */
+    qint64 idleBytes() const;
+
+    /**
+     * @brief Free idle buffers.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 releaseIdle(qint64 bytes);
+
+    ~ImageBufferPool();
+
+private:
+    ImageBufferPool();
+    static void recycle(void* info);
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static ImageBufferPool* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_IMAGEBUFFERPOOL_H
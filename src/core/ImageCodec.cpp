@@ -0,0 +1,220 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ImageCodec.h"
+#include "ImageBufferPool.h"
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// QOI opcodes. The pixel's four bytes are treated as opaque channels in
+// memory order, so every 32-bit QImage format round-trips unchanged.
+const quint8 OpIndex = 0x00; // 00xxxxxx: colour from the 64-entry index
+const quint8 OpDiff  = 0x40; // 01rrggbb: small delta on the first three channels
+const quint8 OpLuma  = 0x80; // 10gggggg + rrrrbbbb: delta steered by the second channel
+const quint8 OpRun   = 0xc0; // 11xxxxxx: repeat previous pixel 1..62 times
+const quint8 OpRgb   = 0xfe; // three literal channels
+const quint8 OpRgba  = 0xff; // four literal channels
+const quint8 Mask2   = 0xc0;
+
+struct Pixel {
+    quint8 c[4];
+
+    bool operator==(const Pixel& other) const { return std::memcmp(c, other.c, 4) == 0; }
+    bool operator!=(const Pixel& other) const { return !(*this == other); }
+    int indexPosition() const { return (c[0] * 3 + c[1] * 5 + c[2] * 7 + c[3] * 11) % 64; }
+};
+
+bool isQoiFormat(const QImage& image)
+{
+    return image.depth() == 32;
+}
+
+QByteArray encodeQoi(const QImage& image)
+{
+    const int width = image.width();
+    const int height = image.height();
+
+    // Worst case is one tag byte plus four channel bytes per pixel
+    QByteArray out(width * height * 5, Qt::Uninitialized);
+    quint8* dst = reinterpret_cast<quint8*>(out.data());
+    qint64 pos = 0;
+
+    Pixel index[64];
+    std::memset(index, 0, sizeof(index));
+    Pixel prev = {{0, 0, 0, 255}};
+    int run = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const quint8* line = image.constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            Pixel px;
+            std::memcpy(px.c, line + x * 4, 4);
+
+            if (px == prev) {
+                if (++run == 62) {
+                    dst[pos++] = OpRun | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                dst[pos++] = OpRun | (run - 1);
+                run = 0;
+            }
+
+            const int slot = px.indexPosition();
+            if (index[slot] == px) {
+                dst[pos++] = OpIndex | slot;
+            } else {
+                index[slot] = px;
+                if (px.c[3] == prev.c[3]) {
+                    const int d0 = static_cast<qint8>(px.c[0] - prev.c[0]);
+                    const int d1 = static_cast<qint8>(px.c[1] - prev.c[1]);
+                    const int d2 = static_cast<qint8>(px.c[2] - prev.c[2]);
+                    const int d01 = d0 - d1;
+                    const int d21 = d2 - d1;
+                    if (d0 > -3 && d0 < 2 && d1 > -3 && d1 < 2 && d2 > -3 && d2 < 2) {
+                        dst[pos++] = OpDiff | ((d0 + 2) << 4) | ((d1 + 2) << 2) | (d2 + 2);
+                    } else if (d01 > -9 && d01 < 8 && d1 > -33 && d1 < 32 && d21 > -9 && d21 < 8) {
+                        dst[pos++] = OpLuma | (d1 + 32);
+                        dst[pos++] = ((d01 + 8) << 4) | (d21 + 8);
+                    } else {
+                        dst[pos++] = OpRgb;
+                        dst[pos++] = px.c[0];
+                        dst[pos++] = px.c[1];
+                        dst[pos++] = px.c[2];
+                    }
+                } else {
+                    dst[pos++] = OpRgba;
+                    std::memcpy(dst + pos, px.c, 4);
+                    pos += 4;
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0) {
+        dst[pos++] = OpRun | (run - 1);
+    }
+
+    out.truncate(static_cast<int>(pos));
+    out.squeeze(); // Release the worst-case reservation
+    return out;
+}
+
+bool decodeQoi(const QByteArray& data, QImage& image)
+{
+    const quint8* src = reinterpret_cast<const quint8*>(data.constData());
+    const qint64 size = data.size();
+    qint64 pos = 0;
+
+    Pixel index[64];
+    std::memset(index, 0, sizeof(index));
+    Pixel px = {{0, 0, 0, 255}};
+    int run = 0;
+
+    for (int y = 0; y < image.height(); ++y) {
+        quint8* line = image.scanLine(y);
+        for (int x = 0; x < image.width(); ++x) {
+            if (run > 0) {
+                --run;
+            } else {
+                if (pos >= size) return false;
+                const quint8 tag = src[pos++];
+                if (tag == OpRgb) {
+                    if (pos + 3 > size) return false;
+                    px.c[0] = src[pos++];
+                    px.c[1] = src[pos++];
+                    px.c[2] = src[pos++];
+                } else if (tag == OpRgba) {
+                    if (pos + 4 > size) return false;
+                    std::memcpy(px.c, src + pos, 4);
+                    pos += 4;
+                } else if ((tag & Mask2) == OpIndex) {
+                    px = index[tag];
+                } else if ((tag & Mask2) == OpDiff) {
+                    px.c[0] += ((tag >> 4) & 0x03) - 2;
+                    px.c[1] += ((tag >> 2) & 0x03) - 2;
+                    px.c[2] += (tag & 0x03) - 2;
+                } else if ((tag & Mask2) == OpLuma) {
+                    if (pos >= size) return false;
+                    const quint8 next = src[pos++];
+                    const int d1 = (tag & 0x3f) - 32;
+                    px.c[0] += d1 - 8 + ((next >> 4) & 0x0f);
+                    px.c[1] += d1;
+                    px.c[2] += d1 - 8 + (next & 0x0f);
+                } else { // OpRun
+                    run = tag & 0x3f;
+                }
+                index[px.indexPosition()] = px;
+            }
+            std::memcpy(line + x * 4, px.c, 4);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ImageCodec::Encoded ImageCodec::encode(const QImage& image)
+{
+    Encoded encoded;
+    if (image.isNull()) return encoded;
+
+    encoded.width = image.width();
+    encoded.height = image.height();
+    encoded.bytesPerLine = image.bytesPerLine();
+    encoded.format = image.format();
+    encoded.colorTable = image.colorTable();
+
+    if (isQoiFormat(image)) {
+        encoded.data = encodeQoi(image);
+        encoded.method = Method::Qoi;
+    } else {
+        QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(image.constBits()),
+                                                 static_cast<int>(image.sizeInBytes()));
+        encoded.data = qCompress(raw, 1);
+        encoded.method = Method::Zlib;
+    }
+    return encoded;
+}
+
+QImage ImageCodec::decode(const Encoded& encoded)
+{
+    if (encoded.isNull()) return QImage();
+
+    // Pooled, so decoding a cold tile reuses the buffer of an evicted one
+    QImage image = ImageBufferPool::instance().acquire(QSize(encoded.width, encoded.height), encoded.format);
+    if (image.isNull() || image.bytesPerLine() != encoded.bytesPerLine) return QImage();
+
+    switch (encoded.method) {
+        case Method::Qoi:
+            if (!decodeQoi(encoded.data, image)) return QImage();
+            break;
+        case Method::Zlib: {
+            QByteArray raw = qUncompress(encoded.data);
+            if (raw.size() != image.sizeInBytes()) return QImage();
+            std::memcpy(image.bits(), raw.constData(), static_cast<size_t>(raw.size()));
+            break;
+        }
+        case Method::None:
+            return QImage();
+    }
+    if (!encoded.colorTable.isEmpty()) {
+        image.setColorTable(encoded.colorTable);
+    } else if (image.format() == QImage::Format_Mono) {
+        image.setColorTable({qRgb(0, 0, 0), qRgb(255, 255, 255)}); // Stores that keep no palette
+    }
+    return image;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,81 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_IMAGECODEC_H
+#define QUANTILYX_IMAGECODEC_H
+
+#include <QByteArray>
+#include <QImage>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Fast lossless in-memory compression for rendered page bitmaps.
+ *
+ * 32-bit images use a QOI-style byte stream (pixel runs, a small colour
+ * index and short channel deltas), which encodes and decodes in a single
+ * pass and does well on the flat backgrounds of document pages. Other pixel
+ * formats, such as the Grayscale8 and Mono images of scanned pages, fall
+ * back to zlib at its fastest level; a Mono image keeps its palette.
+ */
+class ImageCodec
+{
+public:
+    /**
+     * @brief Compression method used for an encoded image.
+     */
+    enum class Method {
+        None,   // Null image
+        Qoi,    // QOI-style stream, 32-bit formats only
+        Zlib    // qCompress() of the raw scanlines
+    };
+
+    /**
+     * @brief A compressed image plus what is needed to rebuild it.
+     */
+    struct Encoded {
+        QByteArray data;
+        int width = 0;
+        int height = 0;
+        int bytesPerLine = 0;
+        QImage::Format format = QImage::Format_Invalid;
+        QVector<QRgb> colorTable; // Indexed formats only
+        Method method = Method::None;
+
+        /**
+         * @brief Memory held by this encoded image.
+         * @return Size in bytes.
+         */
+        qint64 sizeBytes() const { return static_cast<qint64>(data.size()) + static_cast<qint64>(sizeof(Encoded)); }
+
+        /**
+         * @brief Check if this holds no image.
+         * @return True for a default-constructed or failed encoding.
+         */
+        bool isNull() const { return method == Method::None; }
+    };
+
+    /**
+     * @brief Compress an image.
+     * @param image Image to compress.
+     * @return Encoded image, null if the input is null.
+     */
+    static Encoded encode(const QImage& image);
+
+    /**
+     * @brief Decompress an image produced by encode().
+     * @param encoded Encoded image.
+     * @return Decoded image, or a null image if the data is corrupt.
+     */
+    static QImage decode(const Encoded& encoded);
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_IMAGECODEC_H
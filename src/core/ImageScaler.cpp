@@ -0,0 +1,459 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ImageScaler.h"
+#include "ImageBufferPool.h"
+#include "Logger.h"
+#include "PixelFormat.h"
+#include <QVector>
+#include <QtMath>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define QUANTILYX_SCALER_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define QUANTILYX_SCALER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Filter weights are fixed point with this many fractional bits. A channel
+// times a weight, summed over all taps, still fits an int32.
+constexpr int Precision = 14;
+constexpr qint32 Rounding = 1 << (Precision - 1);
+
+// Weights of the source pixels that make up each output pixel of one axis
+struct Coefficients {
+    int taps = 0;            // Weight slots per output pixel
+    QVector<int> first;      // First source pixel per output pixel
+    QVector<int> count;      // Source pixels used per output pixel, <= taps
+    QVector<qint32> weights; // taps slots per output pixel, summing to 1 << Precision
+
+    const qint32* weightsFor(int index) const { return weights.constData() + index * taps; }
+};
+
+qreal boxFilter(qreal x)
+{
+    return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+}
+
+qreal sinc(qreal x)
+{
+    if (x == 0.0) return 1.0;
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+qreal lanczos3Filter(qreal x)
+{
+    return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+Coefficients computeCoefficients(int inSize, int outSize, ImageScaler::Filter filter)
+{
+    qreal (*kernel)(qreal) = filter == ImageScaler::Filter::Box ? boxFilter : lanczos3Filter;
+    const qreal support = filter == ImageScaler::Filter::Box ? 0.5 : 3.0;
+
+    // When reducing, the filter is stretched over the source pixels it covers
+    const qreal scale = qreal(inSize) / outSize;
+    const qreal filterScale = qMax<qreal>(scale, 1.0);
+    const qreal radius = support * filterScale;
+
+    Coefficients c;
+    c.taps = int(std::ceil(radius)) * 2 + 1;
+    c.first.resize(outSize);
+    c.count.resize(outSize);
+    c.weights.fill(0, outSize * c.taps);
+
+    QVector<qreal> raw(c.taps);
+    for (int x = 0; x < outSize; ++x) {
+        const qreal center = (x + 0.5) * scale;
+        const int first = qMax(0, int(center - radius + 0.5));
+        const int last = qMin(inSize, int(center + radius + 0.5));
+        const int count = qBound(1, last - first, c.taps);
+
+        qreal total = 0.0;
+        for (int k = 0; k < count; ++k) {
+            raw[k] = kernel((first + k + 0.5 - center) / filterScale);
+            total += raw[k];
+        }
+
+        qint32* weights = c.weights.data() + x * c.taps;
+        if (total == 0.0) {
+            weights[0] = 1 << Precision;
+        } else {
+            qint32 sum = 0;
+            int largest = 0;
+            for (int k = 0; k < count; ++k) {
+                weights[k] = qRound(raw[k] / total * (1 << Precision));
+                sum += weights[k];
+                if (weights[k] > weights[largest]) largest = k;
+            }
+            weights[largest] += (1 << Precision) - sum; // Rounding error goes to the centre tap
+        }
+        c.first[x] = first;
+        c.count[x] = count;
+    }
+    return c;
+}
+
+inline quint8 clampChannel(qint32 value)
+{
+    value >>= Precision;
+    return quint8(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// One row of the horizontal pass: src is a source row, dst an output row
+using HorizontalKernel = void (*)(const quint32* src, quint32* dst, int outWidth, const Coefficients& c);
+// One row of the vertical pass: count source rows starting at row first.
+// Channels are filtered independently, so it serves every byte format.
+using VerticalKernel = void (*)(const uchar* src, int bytesPerLine, int first, int count,
+                                const qint32* weights, quint8* dst, int bytes);
+
+void horizontalScalar(const quint32* src, quint32* dst, int outWidth, const Coefficients& c)
+{
+    for (int x = 0; x < outWidth; ++x) {
+        const quint8* p = reinterpret_cast<const quint8*>(src + c.first[x]);
+        const qint32* w = c.weightsFor(x);
+        qint32 acc[4] = {Rounding, Rounding, Rounding, Rounding};
+        for (int k = 0; k < c.count[x]; ++k, p += 4) {
+            acc[0] += p[0] * w[k];
+            acc[1] += p[1] * w[k];
+            acc[2] += p[2] * w[k];
+            acc[3] += p[3] * w[k];
+        }
+        quint8* out = reinterpret_cast<quint8*>(dst + x);
+        for (int ch = 0; ch < 4; ++ch) {
+            out[ch] = clampChannel(acc[ch]);
+        }
+    }
+}
+
+void verticalScalarBytes(const uchar* src, int bytesPerLine, int first, int count,
+                         const qint32* weights, quint8* dst, int begin, int end)
+{
+    const uchar* base = src + qptrdiff(first) * bytesPerLine;
+    for (int i = begin; i < end; ++i) {
+        qint32 acc = Rounding;
+        const uchar* p = base + i;
+        for (int k = 0; k < count; ++k, p += bytesPerLine) {
+            acc += *p * weights[k];
+        }
+        dst[i] = clampChannel(acc);
+    }
+}
+
+void verticalScalar(const uchar* src, int bytesPerLine, int first, int count,
+                    const qint32* weights, quint8* dst, int bytes)
+{
+    verticalScalarBytes(src, bytesPerLine, first, count, weights, dst, 0, bytes);
+}
+
+// Horizontal pass of the formats with fewer than four channels; the
+// compiler unrolls the channel loop of each instantiation
+template <int Channels>
+void horizontalBytes(const uchar* src, uchar* dst, int outWidth, const Coefficients& c)
+{
+    for (int x = 0; x < outWidth; ++x, dst += Channels) {
+        const uchar* p = src + c.first[x] * Channels;
+        const qint32* w = c.weightsFor(x);
+        qint32 acc[Channels];
+        for (int ch = 0; ch < Channels; ++ch) acc[ch] = Rounding;
+        for (int k = 0; k < c.count[x]; ++k, p += Channels) {
+            for (int ch = 0; ch < Channels; ++ch) acc[ch] += p[ch] * w[k];
+        }
+        for (int ch = 0; ch < Channels; ++ch) dst[ch] = clampChannel(acc[ch]);
+    }
+}
+
+#ifdef QUANTILYX_SCALER_X86
+
+__attribute__((target("sse4.1")))
+void horizontalSse41(const quint32* src, quint32* dst, int outWidth, const Coefficients& c)
+{
+    for (int x = 0; x < outWidth; ++x) {
+        const quint32* p = src + c.first[x];
+        const qint32* w = c.weightsFor(x);
+        __m128i acc = _mm_set1_epi32(Rounding);
+        for (int k = 0; k < c.count[x]; ++k) {
+            const __m128i pixel = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(int(p[k])));
+            acc = _mm_add_epi32(acc, _mm_mullo_epi32(pixel, _mm_set1_epi32(w[k])));
+        }
+        acc = _mm_srai_epi32(acc, Precision);
+        acc = _mm_packs_epi32(acc, acc);
+        acc = _mm_packus_epi16(acc, acc);
+        dst[x] = quint32(_mm_cvtsi128_si32(acc));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void verticalSse41(const uchar* src, int bytesPerLine, int first, int count,
+                   const qint32* weights, quint8* dst, int bytes)
+{
+    const uchar* base = src + qptrdiff(first) * bytesPerLine;
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) { // Four pixels per step
+        __m128i a0 = _mm_set1_epi32(Rounding);
+        __m128i a1 = a0, a2 = a0, a3 = a0;
+        const uchar* p = base + i;
+        for (int k = 0; k < count; ++k, p += bytesPerLine) {
+            const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i w = _mm_set1_epi32(weights[k]);
+            a0 = _mm_add_epi32(a0, _mm_mullo_epi32(_mm_cvtepu8_epi32(row), w));
+            a1 = _mm_add_epi32(a1, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(row, 4)), w));
+            a2 = _mm_add_epi32(a2, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(row, 8)), w));
+            a3 = _mm_add_epi32(a3, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(row, 12)), w));
+        }
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(a0, Precision), _mm_srai_epi32(a1, Precision));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(a2, Precision), _mm_srai_epi32(a3, Precision));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    verticalScalarBytes(src, bytesPerLine, first, count, weights, dst, i, bytes);
+}
+
+__attribute__((target("avx2")))
+void horizontalAvx2(const quint32* src, quint32* dst, int outWidth, const Coefficients& c)
+{
+    for (int x = 0; x < outWidth; ++x) {
+        const quint32* p = src + c.first[x];
+        const qint32* w = c.weightsFor(x);
+        const int count = c.count[x];
+        __m256i acc = _mm256_setzero_si256();
+        int k = 0;
+        for (; k + 2 <= count; k += 2) { // Two taps per step, one per 128-bit lane
+            const __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + k));
+            const __m256i weight = _mm256_setr_epi32(w[k], w[k], w[k], w[k], w[k + 1], w[k + 1], w[k + 1], w[k + 1]);
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(pair), weight));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_set1_epi32(Rounding));
+        if (k < count) {
+            const __m128i pixel = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(int(p[k])));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(pixel, _mm_set1_epi32(w[k])));
+        }
+        sum = _mm_srai_epi32(sum, Precision);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packus_epi16(sum, sum);
+        dst[x] = quint32(_mm_cvtsi128_si32(sum));
+    }
+}
+
+__attribute__((target("avx2")))
+void verticalAvx2(const uchar* src, int bytesPerLine, int first, int count,
+                  const qint32* weights, quint8* dst, int bytes)
+{
+    const uchar* base = src + qptrdiff(first) * bytesPerLine;
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) { // Four pixels per step in two 8-lane accumulators
+        __m256i a0 = _mm256_set1_epi32(Rounding);
+        __m256i a1 = a0;
+        const uchar* p = base + i;
+        for (int k = 0; k < count; ++k, p += bytesPerLine) {
+            const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m256i w = _mm256_set1_epi32(weights[k]);
+            a0 = _mm256_add_epi32(a0, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(row), w));
+            a1 = _mm256_add_epi32(a1, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(row, 8)), w));
+        }
+        a0 = _mm256_srai_epi32(a0, Precision);
+        a1 = _mm256_srai_epi32(a1, Precision);
+        const __m128i lo = _mm_packs_epi32(_mm256_castsi256_si128(a0), _mm256_extracti128_si256(a0, 1));
+        const __m128i hi = _mm_packs_epi32(_mm256_castsi256_si128(a1), _mm256_extracti128_si256(a1, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    verticalScalarBytes(src, bytesPerLine, first, count, weights, dst, i, bytes);
+}
+
+#endif // QUANTILYX_SCALER_X86
+
+#ifdef QUANTILYX_SCALER_NEON
+
+void horizontalNeon(const quint32* src, quint32* dst, int outWidth, const Coefficients& c)
+{
+    for (int x = 0; x < outWidth; ++x) {
+        const quint32* p = src + c.first[x];
+        const qint32* w = c.weightsFor(x);
+        int32x4_t acc = vdupq_n_s32(Rounding);
+        for (int k = 0; k < c.count[x]; ++k) {
+            const uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(p[k])));
+            const int32x4_t pixel = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(wide)));
+            acc = vmlaq_n_s32(acc, pixel, w[k]);
+        }
+        const uint16x4_t narrow = vqmovun_s32(vshrq_n_s32(acc, Precision));
+        const uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+        dst[x] = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+    }
+}
+
+void verticalNeon(const uchar* src, int bytesPerLine, int first, int count,
+                  const qint32* weights, quint8* dst, int bytes)
+{
+    const uchar* base = src + qptrdiff(first) * bytesPerLine;
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) { // Four pixels per step
+        int32x4_t a0 = vdupq_n_s32(Rounding);
+        int32x4_t a1 = a0, a2 = a0, a3 = a0;
+        const uchar* p = base + i;
+        for (int k = 0; k < count; ++k, p += bytesPerLine) {
+            const uint8x16_t row = vld1q_u8(p);
+            const uint16x8_t lo = vmovl_u8(vget_low_u8(row));
+            const uint16x8_t hi = vmovl_u8(vget_high_u8(row));
+            a0 = vmlaq_n_s32(a0, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lo))), weights[k]);
+            a1 = vmlaq_n_s32(a1, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lo))), weights[k]);
+            a2 = vmlaq_n_s32(a2, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(hi))), weights[k]);
+            a3 = vmlaq_n_s32(a3, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(hi))), weights[k]);
+        }
+        const uint16x8_t lo = vcombine_u16(vqmovun_s32(vshrq_n_s32(a0, Precision)), vqmovun_s32(vshrq_n_s32(a1, Precision)));
+        const uint16x8_t hi = vcombine_u16(vqmovun_s32(vshrq_n_s32(a2, Precision)), vqmovun_s32(vshrq_n_s32(a3, Precision)));
+        vst1q_u8(dst + i, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+    verticalScalarBytes(src, bytesPerLine, first, count, weights, dst, i, bytes);
+}
+
+#endif // QUANTILYX_SCALER_NEON
+
+struct Kernels {
+    HorizontalKernel horizontal;
+    VerticalKernel vertical;
+    const char* name;
+};
+
+Kernels selectKernels()
+{
+#if defined(QUANTILYX_SCALER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {horizontalAvx2, verticalAvx2, "AVX2"};
+    if (__builtin_cpu_supports("sse4.1")) return {horizontalSse41, verticalSse41, "SSE4.1"};
+#elif defined(QUANTILYX_SCALER_NEON)
+    return {horizontalNeon, verticalNeon, "NEON"};
+#endif
+    return {horizontalScalar, verticalScalar, "scalar"};
+}
+
+const Kernels& kernels()
+{
+    static const Kernels selected = [] {
+        const Kernels k = selectKernels();
+        LOG_DEBUG("ImageScaler: Using " << k.name << " kernels.");
+        return k;
+    }();
+    return selected;
+}
+
+// Lanczos rings, which can push a premultiplied channel above its alpha
+void clampToAlpha(QImage& image)
+{
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int a = qAlpha(line[x]);
+            if (a == 255) continue;
+            line[x] = qRgba(qMin(qRed(line[x]), a), qMin(qGreen(line[x]), a), qMin(qBlue(line[x]), a), a);
+        }
+    }
+}
+
+// Both passes over an image of Channels bytes per pixel: Grayscale8,
+// RGB888 or, for four, PipelineFormat with the SIMD horizontal kernels
+template <int Channels>
+QImage scaleChannels(const QImage& input, const QSize& size, ImageScaler::Filter filter)
+{
+    const Kernels& k = kernels();
+    const QImage::Format format = input.format();
+    const Coefficients vertical = computeCoefficients(input.height(), size.height(), filter);
+
+    // The horizontal pass only needs the source rows the vertical pass reads
+    QImage intermediate;
+    int rowOffset = 0;
+    if (size.width() == input.width()) {
+        intermediate = input;
+    } else {
+        const Coefficients horizontal = computeCoefficients(input.width(), size.width(), filter);
+        rowOffset = vertical.first.first();
+        const int rowEnd = vertical.first.last() + vertical.count.last();
+        intermediate = ImageBufferPool::instance().acquire(QSize(size.width(), rowEnd - rowOffset), format);
+        if (intermediate.isNull()) return QImage();
+        for (int y = rowOffset; y < rowEnd; ++y) {
+            if constexpr (Channels == 4) {
+                k.horizontal(reinterpret_cast<const quint32*>(input.constScanLine(y)),
+                             reinterpret_cast<quint32*>(intermediate.scanLine(y - rowOffset)),
+                             size.width(), horizontal);
+            } else {
+                horizontalBytes<Channels>(input.constScanLine(y), intermediate.scanLine(y - rowOffset),
+                                          size.width(), horizontal);
+            }
+        }
+    }
+
+    QImage result = ImageBufferPool::instance().acquire(size, format);
+    if (result.isNull()) return QImage();
+    const uchar* rows = intermediate.constBits();
+    for (int y = 0; y < size.height(); ++y) {
+        k.vertical(rows, intermediate.bytesPerLine(), vertical.first[y] - rowOffset, vertical.count[y],
+                   vertical.weightsFor(y), result.scanLine(y), size.width() * Channels);
+    }
+    if (Channels == 4 && filter == ImageScaler::Filter::Lanczos3) {
+        clampToAlpha(result); // Only premultiplied channels have a bound below 255
+    }
+    return result;
+}
+
+} // namespace
+
+QImage ImageScaler::scaled(const QImage& source, const QSize& requested, Qt::AspectRatioMode mode, Filter filter)
+{
+    if (source.isNull()) return QImage();
+    const QSize size = source.size().scaled(requested, mode);
+    if (size.isEmpty()) return QImage();
+
+    // Grey and RGB images are filtered in their own channels; bilevel ones
+    // turn grey, since scaling them makes intermediate levels anyway
+    QImage input;
+    switch (source.format()) {
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB888:
+        input = source;
+        break;
+    case QImage::Format_Mono:
+        if (size == source.size()) return source;
+        input = PixelFormat::toGrayscale8(source);
+        break;
+    default:
+        input = ImageBufferPool::toPipelineFormat(source);
+        break;
+    }
+    if (input.isNull()) return QImage();
+    if (size == input.size()) return input;
+
+    if (filter == Filter::Auto) {
+        const bool largeReduction = size.width() * 2 <= input.width() && size.height() * 2 <= input.height();
+        filter = largeReduction ? Filter::Box : Filter::Lanczos3;
+    }
+
+    switch (input.format()) {
+    case QImage::Format_Grayscale8: return scaleChannels<1>(input, size, filter);
+    case QImage::Format_RGB888: return scaleChannels<3>(input, size, filter);
+    default: return scaleChannels<4>(input, size, filter);
+    }
+}
+
+QImage ImageScaler::scaled(const QImage& source, int width, int height, Qt::AspectRatioMode mode, Filter filter)
+{
+    return scaled(source, QSize(width, height), mode, filter);
+}
+
+QString ImageScaler::instructionSet()
+{
+    return QString::fromLatin1(kernels().name);
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,75 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_IMAGESCALER_H
+#define QUANTILYX_IMAGESCALER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Separable image resampler with SIMD kernels.
+ *
+ * Replaces QImage::scaled() with Qt::SmoothTransformation for page images.
+ * Scaling runs in two fixed-point passes, horizontal then vertical, on
+ * premultiplied ARGB32. The kernels are picked once at runtime: AVX2 or
+ * SSE4.1 on x86, NEON on ARM, plain C++ everywhere else. Results come
+ * from ImageBufferPool in ImageBufferPool::PipelineFormat, except for
+ * narrower sources, which are filtered in their own channels: Grayscale8
+ * and Mono give Grayscale8 and RGB888 gives RGB888, a quarter and three
+ * quarters of the work and memory.
+ */
+class ImageScaler
+{
+public:
+    /**
+     * @brief Resampling filter.
+     */
+    enum class Filter {
+        Auto,     // Box for reductions of 2x or more, Lanczos3 otherwise
+        Box,      // Area average; fastest, fine for large reductions
+        Lanczos3  // Sharpest; for small reductions and enlargements
+    };
+
+    /**
+     * @brief Scale an image.
+     * @param source Image to scale; any format.
+     * @param size Requested size.
+     * @param mode How the requested size relates to the aspect ratio.
+     * @param filter Resampling filter.
+     * @return Scaled image, or a null image on failure.
+     */
+    static QImage scaled(const QImage& source, const QSize& size,
+                         Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio, Filter filter = Filter::Auto);
+
+    /**
+     * @brief Scale an image.
+     * @param source Image to scale; any format.
+     * @param width Requested width.
+     * @param height Requested height.
+     * @param mode How the requested size relates to the aspect ratio.
+     * @param filter Resampling filter.
+     * @return Scaled image, or a null image on failure.
+     */
+    static QImage scaled(const QImage& source, int width, int height,
+                         Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio, Filter filter = Filter::Auto);
+
+    /**
+     * @brief Get the instruction set the kernels use on this machine.
+     * @return "AVX2", "SSE4.1", "NEON" or "scalar".
+     */
+    static QString instructionSet();
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_IMAGESCALER_H
@@ -8,6 +8,8 @@
  * (at your option) any later version.
  */
 #include "IntelligentCache.h"
+#include "Document.h"
+#include "MemoryBudget.h"
 #include "Logger.h"
 #include <QMutex>
 #include <QMutexLocker>
@@ -15,15 +17,216 @@
 #include <QVariant>
 #include <QImage> // For size calculation example
 #include <QDebug>
+#include <QReadLocker>
+#include <QWriteLocker>
 #include <algorithm> // For std::sort, std::find_if
+#include <vector>
 
 namespace QuantilyxDoc {
 
+const char* const IntelligentCache::DocumentIdKey = "documentId";
+const char* const IntelligentCache::PageIndexKey = "pageIndex";
+
+namespace {
+
+// Blend of the Predictive policy's evidence sources. Only the ranking of
+// scores matters, so the weights need not sum to one.
+const qreal ExactTransitionWeight = 0.4;  // seen this exact from->to jump before
+const qreal RelativeMoveWeight = 0.3;     // seen this page delta (e.g. +1) anywhere
+const qreal PopularPageWeight = 0.2;      // page is a frequent target (e.g. the TOC)
+const qreal DistancePriorWeight = 0.1;    // nearby pages are more likely
+const qreal HintBonus = 0.5;              // hinted since the last navigation
+
+const char* policyName(IntelligentCache::EvictionPolicy policy)
+{
+    switch (policy) {
+        case IntelligentCache::EvictionPolicy::LRU: return "LRU";
+        case IntelligentCache::EvictionPolicy::LFU: return "LFU";
+        case IntelligentCache::EvictionPolicy::Priority: return "Priority";
+        case IntelligentCache::EvictionPolicy::Predictive: return "Predictive";
+    }
+    return "Unknown";
+}
+
+} // namespace
+
 class IntelligentCache::Private {
 public:
+    // Navigation history of one document, learnt from page changes
+    struct TransitionModel {
+        int currentPage = -1;
+        QHash<int, QHash<int, int>> transitions; // from -> (to -> count)
+        QHash<int, int> transitionTotals;        // from -> count
+        QHash<int, int> deltaCounts;             // to - from -> count
+        QHash<int, int> targetCounts;            // to -> count
+        int totalMoves = 0;
+
+        // Estimated likelihood that 'page' is visited next
+        qreal score(int page) const {
+            if (currentPage < 0) return 0.0;
+            qreal score = DistancePriorWeight / (1 + qAbs(page - currentPage));
+            if (totalMoves == 0) return score;
+
+            const int fromTotal = transitionTotals.value(currentPage);
+            if (fromTotal > 0) {
+                score += ExactTransitionWeight * transitions.value(currentPage).value(page) / fromTotal;
+            }
+            score += RelativeMoveWeight * deltaCounts.value(page - currentPage) / totalMoves;
+            score += PopularPageWeight * targetCounts.value(page) / totalMoves;
+            return score;
+        }
+
+        // The page the model currently thinks is most likely next
+        int bestGuess() const {
+            if (currentPage < 0) return -1;
+            auto exact = transitions.constFind(currentPage);
+            if (exact != transitions.constEnd() && !exact->isEmpty()) {
+                int best = -1;
+                int bestCount = 0;
+                for (auto it = exact->constBegin(); it != exact->constEnd(); ++it) {
+                    if (it.value() > bestCount) { best = it.key(); bestCount = it.value(); }
+                }
+                return best;
+            }
+            int bestDelta = 1; // With no history, assume reading forward
+            int bestCount = 0;
+            for (auto it = deltaCounts.constBegin(); it != deltaCounts.constEnd(); ++it) {
+                if (it.value() > bestCount) { bestDelta = it.key(); bestCount = it.value(); }
+            }
+            return currentPage + bestDelta;
+        }
+
+        void record(int page) {
+            if (currentPage >= 0 && page != currentPage) {
+                transitions[currentPage][page]++;
+                transitionTotals[currentPage]++;
+                deltaCounts[page - currentPage]++;
+                targetCounts[page]++;
+                totalMoves++;
+            }
+            currentPage = page;
+        }
+    };
+
+    // Eviction order of an item under LRU/LFU/Priority; smallest goes first
+    struct Rank {
+        qreal primary;
+        qint64 secondary; // last access, breaks ties towards the older item
+
+        bool operator<(const Rank& other) const {
+            return primary != other.primary ? primary < other.primary : secondary < other.secondary;
+        }
+    };
+
+    // Binary min-heap over cache keys that also records where each key sits,
+    // so an item whose rank changes on access is sifted in place (O(log n))
+    // rather than searched for.
+    class IndexedHeap {
+    public:
+        bool isEmpty() const { return nodes.empty(); }
+        const QString& topKey() const { return nodes.front().key; }
+
+        void clear() {
+            nodes.clear();
+            positions.clear();
+        }
+
+        // Insert a key or move it to reflect a new rank
+        void upsert(const QString& key, const Rank& rank) {
+            auto it = positions.find(key);
+            if (it == positions.end()) {
+                nodes.push_back({rank, key});
+                positions.insert(key, nodes.size() - 1);
+                siftUp(nodes.size() - 1);
+                return;
+            }
+            const size_t pos = it.value();
+            const bool smaller = rank < nodes[pos].rank;
+            nodes[pos].rank = rank;
+            if (smaller) siftUp(pos); else siftDown(pos);
+        }
+
+        void remove(const QString& key) {
+            auto it = positions.find(key);
+            if (it == positions.end()) return;
+            const size_t pos = it.value();
+            positions.erase(it);
+            const size_t last = nodes.size() - 1;
+            if (pos != last) {
+                nodes[pos] = std::move(nodes[last]);
+                positions[nodes[pos].key] = pos;
+                nodes.pop_back();
+                siftDown(pos);
+                siftUp(pos);
+            } else {
+                nodes.pop_back();
+            }
+        }
+
+        // Replace the contents in O(n) with Floyd's heap construction
+        void rebuild(std::vector<std::pair<QString, Rank>>&& entries) {
+            clear();
+            nodes.reserve(entries.size());
+            positions.reserve(static_cast<int>(entries.size()));
+            for (auto& entry : entries) {
+                positions.insert(entry.first, nodes.size());
+                nodes.push_back({entry.second, std::move(entry.first)});
+            }
+            for (size_t i = nodes.size() / 2; i-- > 0;) {
+                siftDown(i);
+            }
+        }
+
+    private:
+        struct Node {
+            Rank rank;
+            QString key;
+        };
+
+        void swapNodes(size_t a, size_t b) {
+            std::swap(nodes[a], nodes[b]);
+            positions[nodes[a].key] = a;
+            positions[nodes[b].key] = b;
+        }
+
+        void siftUp(size_t pos) {
+            while (pos > 0) {
+                const size_t parent = (pos - 1) / 2;
+                if (!(nodes[pos].rank < nodes[parent].rank)) break;
+                swapNodes(pos, parent);
+                pos = parent;
+            }
+        }
+
+        void siftDown(size_t pos) {
+            const size_t count = nodes.size();
+            forever {
+                const size_t left = 2 * pos + 1;
+                const size_t right = left + 1;
+                size_t smallest = pos;
+                if (left < count && nodes[left].rank < nodes[smallest].rank) smallest = left;
+                if (right < count && nodes[right].rank < nodes[smallest].rank) smallest = right;
+                if (smallest == pos) break;
+                swapNodes(pos, smallest);
+                pos = smallest;
+            }
+        }
+
+        std::vector<Node> nodes;
+        QHash<QString, size_t> positions;
+    };
+
+    // Lookup counters for one policy
+    struct PolicyCounters {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+    };
+
     Private(IntelligentCache* q_ptr)
         : q(q_ptr), maxSizeBytes(50 * 1024 * 1024), currentSizeBytes(0), // 50 MB default
-          evictionPolicy(EvictionPolicy::LRU) {} // Default policy
+          evictionPolicy(EvictionPolicy::LRU), // Default policy
+          navigationSerial(0), predictionsMade(0), predictionsCorrect(0) {}
 
     IntelligentCache* q;
     mutable QReadWriteLock dataLock; // Use R/W lock for better concurrent access
@@ -31,75 +234,137 @@ public:
     qint64 maxSizeBytes;
     qint64 currentSizeBytes;
     EvictionPolicy evictionPolicy;
-    // For predictive models, we might need access logs, graph structures, etc.
-    // For this stub, we'll implement LRU and a simple priority bump on access.
-    // A real predictive model would be much more complex.
+    // Predictive policy state
+    QHash<quintptr, TransitionModel> navigation; // documentId -> model
+    QHash<QString, qint64> hintSerials;          // key -> navigationSerial at hint time
+    qint64 navigationSerial;
+    qint64 predictionsMade;
+    qint64 predictionsCorrect;
+
+    // Statistics
+    QHash<int, PolicyCounters> counters; // EvictionPolicy -> counters
+    int memoryConsumerId = 0;
+
+    // Eviction order for the active LRU/LFU/Priority policy. Left empty
+    // under Predictive, whose scores move with every page change.
+    IndexedHeap evictionHeap;
+
+    bool usesHeap() const {
+        return evictionPolicy != EvictionPolicy::Predictive;
+    }
+
+    Rank rankFor(const CachedItem& item) const {
+        const qint64 lastAccess = item.lastAccessTime.toMSecsSinceEpoch();
+        switch (evictionPolicy) {
+            case EvictionPolicy::LFU: return {static_cast<qreal>(item.accessCount), lastAccess};
+            case EvictionPolicy::Priority: return {item.priority, lastAccess};
+            case EvictionPolicy::LRU:
+            case EvictionPolicy::Predictive:
+                break;
+        }
+        return {static_cast<qreal>(lastAccess), 0};
+    }
+
+    // Helper to keep the heap in step after an item is added or touched
+    void updateRank(const CachedItem& item) {
+        if (usesHeap()) evictionHeap.upsert(item.key, rankFor(item));
+    }
+
+    // Helper to rebuild the heap after a policy change
+    void rebuildHeap() {
+        if (!usesHeap()) {
+            evictionHeap.clear();
+            return;
+        }
+        std::vector<std::pair<QString, Rank>> entries;
+        entries.reserve(static_cast<size_t>(cacheData.size()));
+        for (auto it = cacheData.constBegin(); it != cacheData.constEnd(); ++it) {
+            entries.emplace_back(it.key(), rankFor(it.value()));
+        }
+        evictionHeap.rebuild(std::move(entries));
+    }
+
+    PolicyCounters& activeCounters() {
+        return counters[static_cast<int>(evictionPolicy)];
+    }
+
+    // Helper to score an item for the Predictive policy; lowest is evicted first
+    qreal predictiveScore(const CachedItem& item, qint64 nowMs) const {
+        qreal score = 0.0;
+        bool ok = false;
+        const quintptr documentId = static_cast<quintptr>(item.metadata.value(DocumentIdKey).toULongLong(&ok));
+        if (ok && item.metadata.contains(PageIndexKey)) {
+            auto model = navigation.constFind(documentId);
+            if (model != navigation.constEnd()) {
+                score = model->score(item.metadata.value(PageIndexKey).toInt());
+            }
+        } else {
+            // Not tied to a page: decay with age, roughly on the prior's scale
+            const qreal ageMinutes = (nowMs - item.lastAccessTime.toMSecsSinceEpoch()) / 60000.0;
+            score = DistancePriorWeight / (1.0 + qMax<qreal>(0.0, ageMinutes));
+        }
+        auto hint = hintSerials.constFind(item.key);
+        if (hint != hintSerials.constEnd() && hint.value() == navigationSerial) {
+            score += HintBonus;
+        }
+        return score;
+    }
+
+    // Helper to evict by predicted likelihood of reuse. Scores are computed
+    // once per batch, so trimming many items costs one sort, not one scan each.
+    void evictPredictive(qint64 targetBytes) {
+        const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+        struct Candidate {
+            qreal score;
+            qint64 lastAccess;
+            QString key;
+        };
+        std::vector<Candidate> candidates;
+        candidates.reserve(static_cast<size_t>(cacheData.size()));
+        for (auto it = cacheData.constBegin(); it != cacheData.constEnd(); ++it) {
+            candidates.push_back({predictiveScore(it.value(), nowMs), it.value().lastAccessTime.toMSecsSinceEpoch(), it.key()});
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.score != b.score ? a.score < b.score : a.lastAccess < b.lastAccess;
+        });
+        for (const Candidate& candidate : candidates) {
+            if (currentSizeBytes <= targetBytes) break;
+            removeForEviction(candidate.key);
+        }
+    }
+
+    // Helper to drop one item as an eviction and report it. The key is a
+    // copy: callers may pass the heap node's key, which remove() overwrites
+    void removeForEviction(QString key) {
+        CachedItem item = cacheData.take(key);
+        currentSizeBytes -= item.sizeBytes;
+        hintSerials.remove(key);
+        evictionHeap.remove(key);
+        activeCounters().evictions++;
+        LOG_DEBUG("Evicted item from cache: " << key << ", Size: " << item.sizeBytes);
+        emit q->itemRemoved(key, item.sizeBytes);
+    }
 
     // Helper to evict items based on current policy
     void evictIfNeeded() {
-        // This should be called after acquiring a Write lock on dataLock
-        while (currentSizeBytes > maxSizeBytes && !cacheData.isEmpty()) {
-            QString keyToEvict;
-            switch (evictionPolicy) {
-                case EvictionPolicy::LRU: {
-                    // Find oldest accessed item
-                    QDateTime oldestTime = QDateTime::currentDateTime();
-                    for (auto it = cacheData.constBegin(); it != cacheData.constEnd(); ++it) {
-                        if (it.value().lastAccessTime < oldestTime) {
-                            oldestTime = it.value().lastAccessTime;
-                            keyToEvict = it.key();
-                        }
-                    }
-                    break;
-                }
-                case EvictionPolicy::LFU: {
-                    // Find least frequently accessed item
-                    int minCount = INT_MAX;
-                    for (auto it = cacheData.constBegin(); it != cacheData.constEnd(); ++it) {
-                        if (it.value().accessCount < minCount) {
-                            minCount = it.value().accessCount;
-                            keyToEvict = it.key();
-                        }
-                    }
-                    break;
-                }
-                case EvictionPolicy::Priority: {
-                    // Find item with lowest priority
-                    qreal minPriority = std::numeric_limits<qreal>::max();
-                    for (auto it = cacheData.constBegin(); it != cacheData.constEnd(); ++it) {
-                        if (it.value().priority < minPriority) {
-                            minPriority = it.value().priority;
-                            keyToEvict = it.key();
-                        }
-                    }
-                    break;
-                }
-                case EvictionPolicy::Predictive: {
-                    // A stub for a predictive model.
-                    // In reality, this would use access history, graph traversal, ML models, etc.
-                    // to predict which item is least likely to be needed.
-                    // For now, fall back to LRU.
-                    QDateTime oldestTime = QDateTime::currentDateTime();
-                    for (auto it = cacheData.constBegin(); it != cacheData.constEnd(); ++it) {
-                        if (it.value().lastAccessTime < oldestTime) {
-                            oldestTime = it.value().lastAccessTime;
-                            keyToEvict = it.key();
-                        }
-                    }
-                    break;
-                }
-            }
+        evictDownTo(maxSizeBytes);
+    }
 
-            if (!keyToEvict.isEmpty()) {
-                CachedItem item = cacheData.take(keyToEvict);
-                currentSizeBytes -= item.sizeBytes;
-                LOG_DEBUG("Evicted item from cache: " << keyToEvict << ", Size: " << item.sizeBytes);
-                emit q->itemRemoved(keyToEvict, item.sizeBytes);
-            } else {
-                // Should not happen if cacheData is not empty
-                LOG_WARN("Cache size exceeded limit but no item found for eviction!");
-                break; // Avoid infinite loop
-            }
+    // Helper to evict by the active policy until at most targetBytes remain
+    void evictDownTo(qint64 targetBytes) {
+        // This should be called after acquiring a Write lock on dataLock
+        if (evictionPolicy == EvictionPolicy::Predictive) {
+            evictPredictive(targetBytes);
+            emit q->cacheSizeChanged(currentSizeBytes, cacheData.size());
+            return;
+        }
+        // Each eviction pops the heap's minimum: O(k log n) for k victims
+        while (currentSizeBytes > targetBytes && !evictionHeap.isEmpty()) {
+            removeForEviction(evictionHeap.topKey());
+        }
+        if (currentSizeBytes > targetBytes && !cacheData.isEmpty()) {
+            // Should not happen: every cached item has a heap entry
+            LOG_WARNING("Cache size exceeded limit but no item found for eviction!");
         }
         emit q->cacheSizeChanged(currentSizeBytes, cacheData.size());
     }
@@ -139,11 +404,15 @@ IntelligentCache::IntelligentCache(QObject* parent)
     : QObject(parent)
     , d(new Private(this))
 {
-    // Initialization happens in Private constructor
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "IntelligentCache", MemoryBudget::Priority::Normal,
+        [this]() { return currentSizeBytes(); },
+        [this](qint64 bytes) { return releaseMemory(bytes); });
 }
 
 IntelligentCache::~IntelligentCache()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     // d->cacheData will be cleared automatically
 }
 
@@ -173,6 +442,7 @@ bool IntelligentCache::put(const QString& key, const QVariant& data, qint64 size
 
     d->cacheData.insert(key, item);
     d->currentSizeBytes += itemSize;
+    d->updateRank(item);
 
     // Check if we need to evict
     d->evictIfNeeded();
@@ -192,10 +462,13 @@ QVariant IntelligentCache::get(const QString& key)
         it->accessCount++;
         // Optionally bump priority based on access or prediction model
         it->priority += 0.1; // Simple bump
+        d->updateRank(it.value());
+        d->activeCounters().hits++;
 
-        emit q->statisticsChanged(); // Access stats changed
+        emit statisticsChanged(); // Access stats changed
         return it->data;
     }
+    d->activeCounters().misses++;
     return QVariant(); // Not found
 }
 
@@ -213,6 +486,8 @@ bool IntelligentCache::remove(const QString& key)
         qint64 size = it->sizeBytes;
         d->currentSizeBytes -= size;
         d->cacheData.erase(it);
+        d->hintSerials.remove(key);
+        d->evictionHeap.remove(key);
         emit itemRemoved(key, size);
         emit cacheSizeChanged(d->currentSizeBytes, d->cacheData.size());
         return true;
@@ -226,6 +501,8 @@ void IntelligentCache::clear()
     qint64 oldSize = d->currentSizeBytes;
     int oldCount = d->cacheData.size();
     d->cacheData.clear();
+    d->hintSerials.clear();
+    d->evictionHeap.clear();
     d->currentSizeBytes = 0;
     LOG_DEBUG("Cleared entire cache. Removed " << oldCount << " items, freed " << oldSize << " bytes.");
     emit cacheSizeChanged(0, 0);
@@ -248,6 +525,15 @@ void IntelligentCache::setMaxSizeBytes(qint64 size)
     }
 }
 
+qint64 IntelligentCache::releaseMemory(qint64 bytes)
+{
+    if (bytes <= 0) return 0;
+    QWriteLocker locker(&d->dataLock);
+    const qint64 before = d->currentSizeBytes;
+    d->evictDownTo(qMax<qint64>(0, before - bytes));
+    return before - d->currentSizeBytes;
+}
+
 qint64 IntelligentCache::currentSizeBytes() const
 {
     QReadLocker locker(&d->dataLock);
@@ -272,8 +558,7 @@ void IntelligentCache::setEvictionPolicy(EvictionPolicy policy)
     if (d->evictionPolicy != policy) {
         d->evictionPolicy = policy;
         LOG_INFO("Cache eviction policy changed to " << static_cast<int>(policy));
-        // Consider re-sorting/triggering eviction based on new policy immediately?
-        // This could be expensive. Maybe just apply the new policy on next put/evict.
+        d->rebuildHeap(); // O(n) once, instead of a scan on every eviction
     }
 }
 
@@ -291,11 +576,13 @@ QList<IntelligentCache::CachedItem> IntelligentCache::items() const
 void IntelligentCache::hintAccess(const QString& key)
 {
     QWriteLocker locker(&d->dataLock);
+    d->hintSerials.insert(key, d->navigationSerial); // Boosts Predictive score until the next page change
     auto it = d->cacheData.find(key);
     if (it != d->cacheData.end()) {
         // Bump priority or move to front based on policy
         it->priority += 0.5; // Significant bump for a hint
         it->lastAccessTime = QDateTime::currentDateTime(); // Update time
+        d->updateRank(it.value());
         LOG_DEBUG("Hinted access for item: " << key);
     } else {
         // Item not in cache, could trigger a pre-load based on prediction
@@ -311,10 +598,79 @@ QVariantMap IntelligentCache::statistics() const
     stats["currentSizeBytes"] = d->currentSizeBytes;
     stats["itemCount"] = d->cacheData.size();
     stats["evictionPolicy"] = static_cast<int>(d->evictionPolicy);
-    // Could add hit/miss rates if tracked separately
+
+    qint64 hits = 0;
+    qint64 misses = 0;
+    qint64 evictions = 0;
+    QVariantMap policies;
+    for (auto it = d->counters.constBegin(); it != d->counters.constEnd(); ++it) {
+        const Private::PolicyCounters& c = it.value();
+        QVariantMap policyStats;
+        policyStats["hits"] = c.hits;
+        policyStats["misses"] = c.misses;
+        policyStats["evictions"] = c.evictions;
+        policyStats["hitRate"] = (c.hits + c.misses) > 0 ? static_cast<double>(c.hits) / (c.hits + c.misses) : 0.0;
+        policies[policyName(static_cast<EvictionPolicy>(it.key()))] = policyStats;
+        hits += c.hits;
+        misses += c.misses;
+        evictions += c.evictions;
+    }
+    stats["hits"] = hits;
+    stats["misses"] = misses;
+    stats["evictions"] = evictions;
+    stats["hitRate"] = (hits + misses) > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    stats["missRate"] = (hits + misses) > 0 ? static_cast<double>(misses) / (hits + misses) : 0.0;
+    stats["policies"] = policies;
+
+    stats["navigationEvents"] = d->navigationSerial;
+    stats["predictionsMade"] = d->predictionsMade;
+    stats["predictionAccuracy"] = d->predictionsMade > 0 ? static_cast<double>(d->predictionsCorrect) / d->predictionsMade : 0.0;
     return stats;
 }
 
+void IntelligentCache::trackDocument(Document* document)
+{
+    if (!document) return;
+    const quintptr documentId = reinterpret_cast<quintptr>(document);
+    connect(document, &Document::currentPageChanged, this, [this, documentId](int index) {
+        recordNavigation(documentId, index);
+    });
+    connect(document, &QObject::destroyed, this, [this, documentId]() {
+        QWriteLocker locker(&d->dataLock);
+        d->navigation.remove(documentId);
+    });
+    recordNavigation(documentId, document->currentPageIndex());
+}
+
+void IntelligentCache::recordNavigation(quintptr documentId, int pageIndex)
+{
+    if (pageIndex < 0) return;
+    QWriteLocker locker(&d->dataLock);
+    Private::TransitionModel& model = d->navigation[documentId];
+    if (model.currentPage == pageIndex) return;
+
+    if (model.currentPage >= 0 && model.totalMoves > 0) {
+        // Score the model before it learns from this move
+        d->predictionsMade++;
+        if (model.bestGuess() == pageIndex) {
+            d->predictionsCorrect++;
+        }
+    }
+    model.record(pageIndex);
+    d->navigationSerial++;
+}
+
+void IntelligentCache::resetStatistics()
+{
+    {
+        QWriteLocker locker(&d->dataLock);
+        d->counters.clear();
+        d->predictionsMade = 0;
+        d->predictionsCorrect = 0;
+    }
+    emit statisticsChanged();
+}
+
 qint64 IntelligentCache::calculateItemSizeBytes(const CachedItem& item)
 {
     return Private::calculateItemSizeBytes(item);
@@ -22,6 +22,8 @@
 
 namespace QuantilyxDoc {
 
+class Document;
+
 /**
  * @brief A cache that uses predictive algorithms and access patterns to optimize storage.
  * 
@@ -58,6 +60,14 @@ public:
         Predictive      // Based on access pattern prediction
     };
 
+    /**
+     * @brief Metadata keys that tie an item to a document page.
+     * Items carrying both are ranked by the Predictive policy using the
+     * navigation model of their document; other items fall back to recency.
+     */
+    static const char* const DocumentIdKey;   // quintptr as qulonglong
+    static const char* const PageIndexKey;    // int
+
     /**
      * @brief Constructor.
      * @param parent Parent object.
@@ -123,6 +133,13 @@ public:
      */
     void setMaxSizeBytes(qint64 size);
 
+    /**
+     * @brief Free memory on request of MemoryBudget, using the eviction policy.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 releaseMemory(qint64 bytes);
+
     /**
      * @brief Get the current size of the cache in bytes.
      * @return Current size.
@@ -160,8 +177,32 @@ public:
      */
     void hintAccess(const QString& key);
 
+    /**
+     * @brief Feed a document's page changes into the navigation model.
+     * Connects to Document::currentPageChanged until the document is destroyed.
+     * @param document The document to follow.
+     */
+    void trackDocument(Document* document);
+
+    /**
+     * @brief Record that the reader moved to a page.
+     * Updates the per-document transition model used by the Predictive policy.
+     * @param documentId Document ID (as used in item metadata).
+     * @param pageIndex Page navigated to.
+     */
+    void recordNavigation(quintptr documentId, int pageIndex);
+
+    /**
+     * @brief Reset hit, miss, eviction and prediction counters.
+     */
+    void resetStatistics();
+
     /**
      * @brief Get cache statistics.
+     * Besides size and count this reports hits, misses, hitRate and evictions
+     * overall and per policy (under "policies", keyed by policy name, counting
+     * lookups made while that policy was active), plus predictionAccuracy:
+     * how often the navigation model's top guess was the next page visited.
      * @return Map containing stats like hit rate, miss rate, size, count.
      */
     QVariantMap statistics() const;
@@ -203,6 +244,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static IntelligentCache* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,68 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "LatencyHistogram.h"
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const qint64 BoundsUs[LatencyHistogram::BoundCount] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+
+} // namespace
+
+LatencyHistogram::Scope::Scope(LatencyHistogram& histogram)
+    : m_histogram(histogram)
+{
+    m_timer.start();
+}
+
+LatencyHistogram::Scope::~Scope()
+{
+    m_histogram.record(m_timer.nsecsElapsed() / 1000);
+}
+
+LatencyHistogram::LatencyHistogram()
+    : m_sumUs(0)
+{
+    for (std::atomic<quint64>& count : m_counts) count.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(qint64 microseconds)
+{
+    microseconds = qMax<qint64>(0, microseconds);
+    int bucket = 0;
+    while (bucket < BoundCount && microseconds > BoundsUs[bucket]) ++bucket;
+    m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(quint64(microseconds), std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.counts.reserve(BoundCount + 1);
+    for (const std::atomic<quint64>& count : m_counts) {
+        const quint64 value = count.load(std::memory_order_relaxed);
+        snapshot.counts.append(value);
+        snapshot.count += value; // Summed here so the buckets always add up to the count
+    }
+    snapshot.sumSeconds = m_sumUs.load(std::memory_order_relaxed) / 1e6;
+    return snapshot;
+}
+
+QVector<double> LatencyHistogram::upperBoundsSeconds()
+{
+    QVector<double> bounds;
+    bounds.reserve(BoundCount);
+    for (qint64 bound : BoundsUs) bounds.append(bound / 1e6);
+    return bounds;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,85 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_LATENCYHISTOGRAM_H
+#define QUANTILYX_LATENCYHISTOGRAM_H
+
+#include <QElapsedTimer>
+#include <QVector>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Counts durations into fixed buckets, from any thread without a lock.
+ *
+ * The buckets run from 1 ms to 10 s, so the histograms of all subsystems
+ * line up when MetricsServer exports them. Recording is two relaxed
+ * atomic additions.
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @brief Number of buckets with an upper bound; one more holds the rest.
+     */
+    static constexpr int BoundCount = 13;
+
+    /**
+     * @brief Counts at one moment.
+     */
+    struct Snapshot {
+        QVector<quint64> counts;    // Per bucket, not cumulative; the last one is above every bound
+        quint64 count = 0;
+        double sumSeconds = 0;
+    };
+
+    /**
+     * @brief Times a scope and records it when the scope ends.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(LatencyHistogram& histogram);
+        ~Scope();
+
+    private:
+        LatencyHistogram& m_histogram;
+        QElapsedTimer m_timer;
+    };
+
+    LatencyHistogram();
+
+    /**
+     * @brief Record one duration.
+     * @param microseconds Duration.
+     */
+    void record(qint64 microseconds);
+
+    /**
+     * @brief Get the counts so far.
+     * @return Snapshot; the buckets are read one by one, so a concurrent
+     * record() may be half in it.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Get the upper bound of each bucket.
+     * @return BoundCount bounds in seconds, ascending.
+     */
+    static QVector<double> upperBoundsSeconds();
+
+private:
+    std::atomic<quint64> m_counts[BoundCount + 1];
+    std::atomic<quint64> m_sumUs;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_LATENCYHISTOGRAM_H
@@ -0,0 +1,57 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "LayoutDocument.h"
+#include "Logger.h"
+#include <QBuffer>
+#include <QImageReader>
+
+namespace QuantilyxDoc {
+
+LayoutDocument::LayoutDocument(qreal width)
+    : imageWidth(width)
+    , imageBytes(0)
+{
+}
+
+qint64 LayoutDocument::decodedImageBytes() const
+{
+    return imageBytes;
+}
+
+qint64 LayoutDocument::estimatedBytes() const
+{
+    return characterCount() * qint64(sizeof(QChar)) * 8 + imageBytes;
+}
+
+QVariant LayoutDocument::decodeImage(QByteArray data, const QString& name)
+{
+    QBuffer buffer(&data);
+    if (data.isEmpty() || !buffer.open(QIODevice::ReadOnly)) return QVariant();
+    QImageReader reader(&buffer);
+    const QSize size = reader.size();
+    if (imageWidth > 0 && size.width() > imageWidth) {
+        reader.setScaledSize(size.scaled(QSize(qRound(imageWidth), size.height()), Qt::KeepAspectRatio));
+    }
+    const QImage image = reader.read();
+    if (image.isNull()) {
+        LOG_WARN("LayoutDocument: Failed to decode image " << name << ": " << reader.errorString());
+        return QVariant();
+    }
+    return keepImage(image);
+}
+
+QVariant LayoutDocument::keepImage(const QImage& image)
+{
+    if (image.isNull()) return QVariant();
+    imageBytes += image.sizeInBytes();
+    return image;
+}
+
+} // namespace QuantilyxDoc
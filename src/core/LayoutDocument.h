@@ -0,0 +1,76 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_LAYOUTDOCUMENT_H
+#define QUANTILYX_LAYOUTDOCUMENT_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <QTextDocument>
+#include <QVariant>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief A QTextDocument laid out once for the pages of a reflowable format.
+ *
+ * The e-book, help and office formats keep their text laid out while
+ * MemoryBudget allows and charge it estimatedBytes(). QTextDocument keeps
+ * fragments, formats and line layouts besides the text; a few times the
+ * text size is a fair estimate of those. The images a subclass resolves in
+ * loadResource() go through decodeImage() or keepImage(), so their decoded
+ * size is charged as well.
+ */
+class LayoutDocument : public QTextDocument
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param imageWidth Widest image decodeImage() produces, usually the
+     * text column; 0 for no limit.
+     */
+    explicit LayoutDocument(qreal imageWidth = 0);
+
+    /**
+     * @brief Get the memory held by decoded images.
+     * @return Size in bytes.
+     */
+    qint64 decodedImageBytes() const;
+
+    /**
+     * @brief Estimate the memory held by the laid out document.
+     * @return Size in bytes, images included.
+     */
+    qint64 estimatedBytes() const;
+
+protected:
+    /**
+     * @brief Decode an embedded image no wider than the image width.
+     * @param data Encoded image.
+     * @param name Resource name, for the log.
+     * @return The image, or an invalid QVariant if it cannot be decoded.
+     */
+    QVariant decodeImage(QByteArray data, const QString& name);
+
+    /**
+     * @brief Count an image decoded elsewhere.
+     * @param image The image.
+     * @return The image, or an invalid QVariant for a null one.
+     */
+    QVariant keepImage(const QImage& image);
+
+private:
+    qreal imageWidth;
+    qint64 imageBytes;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_LAYOUTDOCUMENT_H
@@ -10,47 +10,117 @@
 #include "LazyLoader.h"
 #include "Logger.h"
 #include "ThreadPool.h" // Use our custom ThreadPool
+#include "Tracing.h"
 #include <QMutex>
 #include <QMutexLocker>
 #include <QDateTime>
 #include <QCoreApplication>
 #include <QThread>
 #include <QDebug>
-#include <algorithm> // For std::sort, std::find, std::remove
+#include <QVector>
 
 namespace QuantilyxDoc {
 
 class LazyLoader::Private {
 public:
+    // One pending or running load; duplicate requests attach their callbacks
+    struct Entry {
+        LoadRequest request;
+        QVector<std::function<void(QVariant)>> successCallbacks;
+        QVector<std::function<void(QString)>> errorCallbacks;
+        quint64 sequence = 0; // FIFO order among equal priorities
+        int heapIndex = -1;   // Position in the heap, -1 once running
+
+        void addCallbacks(const LoadRequest& from) {
+            if (from.onSuccess) successCallbacks.append(from.onSuccess);
+            if (from.onError) errorCallbacks.append(from.onError);
+        }
+    };
+
     Private(LazyLoader* q_ptr)
-        : q(q_ptr), maxConcurrent(4), activeCount(0) {} // Default 4 threads
+        : q(q_ptr), maxConcurrent(4), activeCount(0), nextSequence(0),
+          mergedCount(0), expiredCount(0) {} // Default 4 threads
+
+    ~Private() {
+        qDeleteAll(entries);
+    }
 
     LazyLoader* q;
     mutable QMutex mutex; // Protect access to queues and counts
-    QQueue<LoadRequest> requestQueue;
-    QSet<QString> activeRequests; // Keys of requests currently being processed
+    QHash<QString, Entry*> entries; // Queued and running loads by key
+    QVector<Entry*> heap;           // Queued loads, most urgent at the top
     int maxConcurrent;
     int activeCount;
+    quint64 nextSequence;
+    quint64 mergedCount;  // Requests folded into an existing load
+    quint64 expiredCount; // Requests dropped after their deadline
     // Could add prediction structures here (e.g., access patterns, graphs)
 
-    // Helper to find request index in queue by key
-    int findRequestIndex(const QString& key) const {
-        for (int i = 0; i < requestQueue.size(); ++i) {
-            if (requestQueue[i].key == key) {
-                return i;
-            }
+    // Higher priority first, then FIFO for same priority
+    static bool before(const Entry* a, const Entry* b) {
+        if (a->request.priority != b->request.priority) {
+            return a->request.priority > b->request.priority;
         }
-        return -1;
+        return a->sequence < b->sequence;
     }
 
-    // Helper to sort queue based on priority and request time (higher priority first, then FIFO for same priority)
-    void sortQueue() {
-        std::sort(requestQueue.begin(), requestQueue.end(), [](const LoadRequest& a, const LoadRequest& b) {
-            if (a.priority != b.priority) {
-                return a.priority > b.priority; // Higher priority first
-            }
-            return a.requestTime < b.requestTime; // FIFO for same priority
-        });
+    void place(int index, Entry* entry) {
+        heap[index] = entry;
+        entry->heapIndex = index;
+    }
+
+    void siftUp(int index) {
+        Entry* entry = heap[index];
+        while (index > 0) {
+            const int parent = (index - 1) / 2;
+            if (!before(entry, heap[parent])) break;
+            place(index, heap[parent]);
+            index = parent;
+        }
+        place(index, entry);
+    }
+
+    void siftDown(int index) {
+        Entry* entry = heap[index];
+        const int count = heap.size();
+        for (;;) {
+            int child = 2 * index + 1;
+            if (child >= count) break;
+            if (child + 1 < count && before(heap[child + 1], heap[child])) ++child;
+            if (!before(heap[child], entry)) break;
+            place(index, heap[child]);
+            index = child;
+        }
+        place(index, entry);
+    }
+
+    void push(Entry* entry) {
+        heap.append(entry);
+        entry->heapIndex = heap.size() - 1;
+        siftUp(entry->heapIndex);
+    }
+
+    // Removes a queued entry from the heap; the entry stays in entries
+    void removeFromHeap(Entry* entry) {
+        const int index = entry->heapIndex;
+        Entry* last = heap.takeLast();
+        entry->heapIndex = -1;
+        if (last == entry) return;
+        place(index, last);
+        siftUp(index);
+        siftDown(last->heapIndex);
+    }
+
+    // Raises a queued entry's priority in O(log n)
+    void raisePriority(Entry* entry, qint64 priority) {
+        if (priority <= entry->request.priority) return;
+        entry->request.priority = priority;
+        entry->sequence = nextSequence++; // FIFO among the new priority
+        siftUp(entry->heapIndex);
+    }
+
+    static bool isExpired(const Entry* entry, const QDateTime& now) {
+        return entry->request.deadline.isValid() && entry->request.deadline < now;
     }
 };
 
@@ -84,23 +154,39 @@ void LazyLoader::queueRequest(const LoadRequest& request)
 {
     QMutexLocker locker(&d->mutex);
 
-    // Check if already queued or active
-    if (d->requestQueue.contains(request) || d->activeRequests.contains(request.key)) {
-        LOG_DEBUG("Request already exists (queued or active): " << request.key);
-        return; // Or maybe update the request? For now, ignore duplicates.
+    // Merge with a queued or running load of the same resource
+    auto it = d->entries.constFind(request.key);
+    if (it != d->entries.constEnd()) {
+        Private::Entry* entry = it.value();
+        entry->addCallbacks(request);
+        if (entry->heapIndex >= 0) {
+            d->raisePriority(entry, request.priority);
+            // Keep the later deadline; one without a deadline never expires
+            if (!request.deadline.isValid() || (entry->request.deadline.isValid() && request.deadline > entry->request.deadline)) {
+                entry->request.deadline = request.deadline;
+            }
+        }
+        d->mergedCount++;
+        LOG_DEBUG("Merged lazy load request into existing load: " << request.key);
+        return;
     }
 
-    LoadRequest req = request;
-    req.requestTime = QDateTime::currentDateTime();
-    d->requestQueue.enqueue(req);
-    d->sortQueue(); // Maintain priority order
+    Private::Entry* entry = new Private::Entry;
+    entry->request = request;
+    entry->request.requestTime = QDateTime::currentDateTime();
+    entry->request.onSuccess = nullptr; // Kept in the callback lists instead
+    entry->request.onError = nullptr;
+    entry->addCallbacks(request);
+    entry->sequence = d->nextSequence++;
+    d->entries.insert(request.key, entry);
+    d->push(entry); // Maintain priority order
 
     LOG_DEBUG("Queued lazy load request: " << request.key << " (Priority: " << request.priority << ")");
 
     // Potentially trigger processing if below concurrency limit
     // A better approach might be a QTimer or idle event to process the queue smoothly.
     // For now, we'll rely on processNextRequest being called externally or via a timer.
-    // emit queueStatusChanged(d->requestQueue.size(), d->activeCount); // Emit later after processing
+    // emit queueStatusChanged(d->heap.size(), d->activeCount); // Emit later after processing
     QMetaObject::invokeMethod(this, &LazyLoader::processNextRequest, Qt::QueuedConnection);
 }
 
@@ -123,8 +209,14 @@ bool LazyLoader::cancelRequest(const QString& key)
 {
     QMutexLocker locker(&d->mutex);
 
+    Private::Entry* entry = d->entries.value(key, nullptr);
+    if (!entry) {
+        LOG_DEBUG("Request to cancel not found in queue: " << key);
+        return false;
+    }
+
     // Check active requests first
-    if (d->activeRequests.contains(key)) {
+    if (entry->heapIndex < 0) {
         // Cancellation of *active* requests is complex and often not possible
         // without cooperative cancellation points in the loading code itself.
         // For this stub, we'll just log and return false for active requests.
@@ -133,31 +225,45 @@ bool LazyLoader::cancelRequest(const QString& key)
     }
 
     // Remove from queue
-    int index = d->findRequestIndex(key);
-    if (index >= 0) {
-        d->requestQueue.removeAt(index);
-        LOG_DEBUG("Canceled queued request: " << key);
-        emit queueStatusChanged(d->requestQueue.size(), d->activeCount);
-        return true;
-    }
-
-    LOG_DEBUG("Request to cancel not found in queue: " << key);
-    return false;
+    d->removeFromHeap(entry);
+    d->entries.remove(key);
+    const int queued = d->heap.size();
+    const int active = d->activeCount;
+    locker.unlock();
+
+    // Requests merged into this one wait on it as well
+    const QString error = "Request was canceled";
+    for (const auto& onError : entry->errorCallbacks) onError(error);
+    LOG_DEBUG("Canceled queued request: " << key << " (" << entry->errorCallbacks.size() << " callers notified)");
+    delete entry;
+    emit queueStatusChanged(queued, active);
+    return true;
 }
 
 void LazyLoader::cancelAllRequests()
 {
     QMutexLocker locker(&d->mutex);
-    int count = d->requestQueue.size();
-    d->requestQueue.clear();
-    LOG_DEBUG("Canceled all " << count << " queued requests.");
-    emit queueStatusChanged(0, d->activeCount);
+    const QVector<Private::Entry*> canceled = d->heap;
+    for (Private::Entry* entry : canceled) {
+        d->entries.remove(entry->request.key);
+    }
+    d->heap.clear();
+    const int active = d->activeCount;
+    locker.unlock();
+
+    const QString error = "Request was canceled";
+    for (Private::Entry* entry : canceled) {
+        for (const auto& onError : entry->errorCallbacks) onError(error);
+        delete entry;
+    }
+    LOG_DEBUG("Canceled all " << canceled.size() << " queued requests.");
+    emit queueStatusChanged(0, active);
 }
 
 int LazyLoader::queuedRequestCount() const
 {
     QMutexLocker locker(&d->mutex);
-    return d->requestQueue.size();
+    return d->heap.size();
 }
 
 int LazyLoader::activeRequestCount() const
@@ -199,11 +305,9 @@ void LazyLoader::hintResourceNeeded(const QString& key)
 {
     QMutexLocker locker(&d->mutex);
     // Find the request in the queue and bump its priority
-    int index = d->findRequestIndex(key);
-    if (index >= 0) {
-        d->requestQueue[index].priority += 1000; // Significant bump
-        d->requestQueue[index].requestTime = QDateTime::currentDateTime(); // Update time to maintain FIFO for same new priority
-        d->sortQueue(); // Re-sort the queue
+    Private::Entry* entry = d->entries.value(key, nullptr);
+    if (entry && entry->heapIndex >= 0) {
+        d->raisePriority(entry, entry->request.priority + 1000); // Significant bump
         LOG_DEBUG("Hinted resource needed, bumped priority: " << key);
     } else {
         // Resource not queued. Could queue a low-priority hint request or just remember the hint.
@@ -228,23 +332,52 @@ QVariantMap LazyLoader::statistics() const
     stats["queuedRequestCount"] = queuedRequestCount();
     stats["activeRequestCount"] = activeRequestCount();
     stats["maxConcurrentLoads"] = maxConcurrentLoads();
+    {
+        QMutexLocker locker(&d->mutex);
+        stats["mergedRequestCount"] = d->mergedCount;
+        stats["expiredRequestCount"] = d->expiredCount;
+    }
     // More stats from ThreadPool or internal tracking could be added
     return stats;
 }
 
 void LazyLoader::processNextRequest()
 {
+    TRACE_ZONE("LazyLoader::processNextRequest");
     QMutexLocker locker(&d->mutex);
 
+    // Stale preloads are dropped when they reach the top of the heap
+    QList<Private::Entry*> expired;
+    const QDateTime now = QDateTime::currentDateTime();
+    while (!d->heap.isEmpty() && Private::isExpired(d->heap.first(), now)) {
+        Private::Entry* entry = d->heap.first();
+        d->removeFromHeap(entry);
+        d->entries.remove(entry->request.key);
+        d->expiredCount++;
+        expired.append(entry);
+    }
+    if (!expired.isEmpty()) {
+        locker.unlock();
+        const QString error = "Request expired before it could be loaded";
+        for (Private::Entry* entry : expired) {
+            for (const auto& onError : entry->errorCallbacks) onError(error);
+            emit resourceLoadFailed(entry->request.key, error);
+            LOG_DEBUG("Dropped expired lazy load request: " << entry->request.key);
+            delete entry;
+        }
+        locker.relock();
+    }
+
     // Check if we can start another request
-    if (d->activeCount >= d->maxConcurrent || d->requestQueue.isEmpty()) {
+    if (d->activeCount >= d->maxConcurrent || d->heap.isEmpty()) {
         // Nothing to do or at concurrency limit
-        emit queueStatusChanged(d->requestQueue.size(), d->activeCount);
+        emit queueStatusChanged(d->heap.size(), d->activeCount);
         return;
     }
 
-    LoadRequest request = d->requestQueue.dequeue();
-    d->activeRequests.insert(request.key);
+    Private::Entry* next = d->heap.first();
+    d->removeFromHeap(next); // Stays in entries, so duplicates merge into it while it runs
+    const LoadRequest request = next->request;
     d->activeCount++;
 
     LOG_DEBUG("Processing lazy load request: " << request.key << " on thread " << QThread::currentThreadId());
@@ -283,20 +416,25 @@ void LazyLoader::processNextRequest()
 
         // Process result on the main thread
         QMetaObject::invokeMethod(this, [this, request, resultData, error, success]() {
-             QMutexLocker resultLocker(&d->mutex); // Lock again to update state
-             d->activeRequests.remove(request.key);
-             d->activeCount--;
+             Private::Entry* entry = nullptr;
+             {
+                 QMutexLocker resultLocker(&d->mutex); // Lock again to update state
+                 entry = d->entries.take(request.key);
+                 d->activeCount--;
+             }
              // Remove from any prediction/hint lists if necessary
 
-             if (success && request.onSuccess) {
-                 request.onSuccess(resultData);
+             // Callbacks run unlocked so they may queue further requests
+             if (entry && success) {
+                 for (const auto& onSuccess : entry->successCallbacks) onSuccess(resultData);
                  emit resourceLoaded(request.key, resultData);
                  LOG_DEBUG("Successfully loaded resource: " << request.key);
-             } else if (!success && request.onError) {
-                 request.onError(error);
+             } else if (entry) {
+                 for (const auto& onError : entry->errorCallbacks) onError(error);
                  emit resourceLoadFailed(request.key, error);
                  LOG_WARN("Failed to load resource: " << request.key << ", Error: " << error);
              }
+             delete entry;
 
              // Process the next request in the queue
              QMetaObject::invokeMethod(this, &LazyLoader::processNextRequest, Qt::QueuedConnection);
@@ -304,11 +442,11 @@ void LazyLoader::processNextRequest()
 
     }, "LazyLoadTask_" + request.key, Task::Priority::Normal);
 
-    // Submit the task to the global ThreadPool
-    ThreadPool::instance().submitTask(loadTask);
+    // Loads mostly wait on files and archives; keep them off the CPU pool
+    ThreadPool::ioInstance().submitTask(loadTask);
 
     // Update queue status after dequeuing
-    emit queueStatusChanged(d->requestQueue.size(), d->activeCount);
+    emit queueStatusChanged(d->heap.size(), d->activeCount);
 }
 
 } // namespace QuantilyxDoc
\ No newline at end of file
@@ -12,7 +12,7 @@
 
 #include <QObject>
 #include <QHash>
-#include <QQueue>
+#include <QDateTime>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QRunnable>
@@ -60,6 +60,7 @@ public:
         std::function<void(QString)> onError;   // Callback on error
         qint64 priority;                // Priority of the request (higher = more urgent)
         QDateTime requestTime;          // When the request was made
+        QDateTime deadline;             // Dropped if not started by then; invalid = never
 
         LoadRequest() : priority(0) {}
     };
@@ -83,6 +84,11 @@ public:
 
     /**
      * @brief Queue a request to load a resource lazily.
+     * A request for a key that is already queued or loading is merged into
+     * that load: its callbacks are added, and the queued load takes the
+     * higher priority and the later deadline. A request that has not
+     * started by its deadline fails with an "expired" error, which suits
+     * speculative preloads.
      * @param request The load request.
      */
     void queueRequest(const LoadRequest& request);
@@ -103,13 +109,15 @@ public:
 
     /**
      * @brief Cancel a pending load request by its key.
+     * Every caller waiting on it, including those merged into it, gets its
+     * error callback.
      * @param key The key of the request to cancel.
      * @return True if the request was found and canceled.
      */
     bool cancelRequest(const QString& key);
 
     /**
-     * @brief Cancel all pending requests.
+     * @brief Cancel all pending requests. Their callers get their error callbacks.
      */
     void cancelAllRequests();
 
@@ -0,0 +1,359 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "LibraryScanner.h"
+#include "Document.h"
+#include "DocumentFactory.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+#include "ZipArchive.h"
+#include <poppler-qt5.h>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QSet>
+#include <QXmlStreamReader>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Files read between two storeMetadataBatch() calls and progress reports
+const int BatchSize = 256;
+
+bool readPdf(const QString& filePath, DocumentMetadata* metadata)
+{
+    // Poppler reads the trailer, the xref and the catalog on load; pages,
+    // fonts and content streams stay untouched
+    std::unique_ptr<Poppler::Document> document(Poppler::Document::load(filePath));
+    if (!document) return false;
+    int major = 1;
+    int minor = 0;
+    document->getPdfVersion(&major, &minor);
+    metadata->format = QStringLiteral("PDF %1.%2").arg(major).arg(minor);
+    if (document->isLocked()) return true; // The Info dictionary is encrypted too
+
+    metadata->title = document->info(QStringLiteral("Title"));
+    metadata->author = document->info(QStringLiteral("Author"));
+    metadata->subject = document->info(QStringLiteral("Subject"));
+    metadata->creator = document->info(QStringLiteral("Creator"));
+    metadata->producer = document->info(QStringLiteral("Producer"));
+    static const QRegularExpression separators(QStringLiteral("[,;]"));
+    for (const QString& keyword : document->info(QStringLiteral("Keywords")).split(separators, Qt::SkipEmptyParts)) {
+        if (!keyword.trimmed().isEmpty()) metadata->keywords.append(keyword.trimmed());
+    }
+    metadata->creationDate = document->date(QStringLiteral("CreationDate"));
+    metadata->modificationDate = document->date(QStringLiteral("ModDate"));
+    metadata->pageCount = document->numPages();
+    return true;
+}
+
+bool readEpub(const QString& filePath, DocumentMetadata* metadata)
+{
+    ZipArchive archive;
+    if (!archive.open(filePath)) return false;
+
+    QString packagePath;
+    QXmlStreamReader container(archive.read(QStringLiteral("META-INF/container.xml")));
+    while (!container.atEnd() && packagePath.isEmpty()) {
+        container.readNext();
+        if (container.isStartElement() && container.name() == QLatin1String("rootfile")) {
+            packagePath = container.attributes().value(QLatin1String("full-path")).toString();
+        }
+    }
+    if (packagePath.isEmpty()) return false;
+
+    QXmlStreamReader package(archive.read(packagePath));
+    bool inMetadata = false;
+    int spineItems = 0;
+    while (!package.atEnd()) {
+        package.readNext();
+        if (package.isEndElement() && package.name() == QLatin1String("metadata")) {
+            inMetadata = false;
+            continue;
+        }
+        if (!package.isStartElement()) continue;
+        const QStringRef name = package.name();
+        if (name == QLatin1String("package")) {
+            metadata->format = QStringLiteral("EPUB %1").arg(package.attributes().value(QLatin1String("version")).toString());
+        } else if (name == QLatin1String("metadata")) {
+            inMetadata = true;
+        } else if (name == QLatin1String("itemref")) {
+            ++spineItems;
+        } else if (inMetadata) {
+            // Dublin Core elements; the first of each wins, subjects are keywords
+            if (name == QLatin1String("title") && metadata->title.isEmpty()) {
+                metadata->title = package.readElementText().simplified();
+            } else if (name == QLatin1String("creator") && metadata->author.isEmpty()) {
+                metadata->author = package.readElementText().simplified();
+            } else if (name == QLatin1String("subject")) {
+                metadata->keywords.append(package.readElementText().simplified());
+            } else if (name == QLatin1String("description") && metadata->subject.isEmpty()) {
+                metadata->subject = package.readElementText().simplified();
+            } else if (name == QLatin1String("language") && metadata->language.isEmpty()) {
+                metadata->language = package.readElementText().trimmed();
+            } else if (name == QLatin1String("publisher") && metadata->producer.isEmpty()) {
+                metadata->producer = package.readElementText().simplified();
+            } else if (name == QLatin1String("date") && !metadata->creationDate.isValid()) {
+                metadata->creationDate = QDateTime::fromString(package.readElementText().trimmed(), Qt::ISODate);
+            }
+        }
+    }
+    if (package.hasError() && metadata->format.isEmpty()) return false;
+    metadata->pageCount = spineItems; // One page per spine chapter, as EpubDocument lays them out
+    return true;
+}
+
+bool readCbz(const QString& filePath, DocumentMetadata* metadata)
+{
+    ZipArchive archive;
+    if (!archive.open(filePath)) return false;
+    metadata->format = QStringLiteral("CBZ");
+
+    static const QSet<QString> imageSuffixes = {
+        QStringLiteral("jpg"), QStringLiteral("jpeg"), QStringLiteral("png"), QStringLiteral("gif"),
+        QStringLiteral("webp"), QStringLiteral("bmp"), QStringLiteral("tif"), QStringLiteral("tiff")
+    };
+    int images = 0;
+    QString comicInfo;
+    for (const QString& name : archive.entryNames()) {
+        if (imageSuffixes.contains(QFileInfo(name).suffix().toLower())) ++images;
+        else if (QFileInfo(name).fileName().compare(QLatin1String("ComicInfo.xml"), Qt::CaseInsensitive) == 0) comicInfo = name;
+    }
+    metadata->pageCount = images;
+    if (comicInfo.isEmpty()) return true;
+
+    QString series;
+    QString number;
+    int year = 0, month = 1, day = 1;
+    QXmlStreamReader xml(archive.read(comicInfo));
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (!xml.isStartElement() || xml.name() == QLatin1String("ComicInfo")) continue;
+        const QString name = xml.name().toString();
+        if (name == QLatin1String("Pages")) {
+            xml.skipCurrentElement(); // Per-page entries; the image count is the page count
+            continue;
+        }
+        const QString value = xml.readElementText().simplified();
+        if (name == QLatin1String("Title")) metadata->title = value;
+        else if (name == QLatin1String("Series")) series = value;
+        else if (name == QLatin1String("Number")) number = value;
+        else if (name == QLatin1String("Writer")) metadata->author = value;
+        else if (name == QLatin1String("Summary")) metadata->subject = value;
+        else if (name == QLatin1String("Publisher")) metadata->producer = value;
+        else if (name == QLatin1String("LanguageISO")) metadata->language = value;
+        else if (name == QLatin1String("Genre") || name == QLatin1String("Tags")) {
+            for (const QString& tag : value.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+                if (!tag.trimmed().isEmpty()) metadata->keywords.append(tag.trimmed());
+            }
+        } else if (name == QLatin1String("PageCount") && value.toInt() > 0) metadata->pageCount = value.toInt();
+        else if (name == QLatin1String("Year")) year = value.toInt();
+        else if (name == QLatin1String("Month")) month = qBound(1, value.toInt(), 12);
+        else if (name == QLatin1String("Day")) day = qBound(1, value.toInt(), 31);
+    }
+    if (metadata->title.isEmpty() && !series.isEmpty()) {
+        metadata->title = number.isEmpty() ? series : QStringLiteral("%1 #%2").arg(series, number);
+    }
+    if (year > 0) metadata->creationDate = QDateTime(QDate(year, month, day));
+    return true;
+}
+
+bool readThroughFactory(const QString& filePath, DocumentMetadata* metadata)
+{
+    QString error;
+    std::unique_ptr<Document> document(DocumentFactory::instance().loadDocument(filePath, QString(), &error));
+    if (!document) {
+        LOG_DEBUG("LibraryScanner: Cannot load " << filePath << ": " << error);
+        return false;
+    }
+    *metadata = MetadataDatabase::metadataFromDocument(document.get());
+    return true;
+}
+
+} // namespace
+
+class LibraryScanner::Private {
+public:
+    // One scan, shared with its background task
+    struct Scan {
+        std::atomic<bool> canceled{false};
+    };
+
+    std::shared_ptr<Scan> current;
+
+    // Supported files under the roots, each once
+    static QStringList collect(const QStringList& roots, bool recursive, const std::shared_ptr<Scan>& scan) {
+        const DocumentFactory& factory = DocumentFactory::instance();
+        QStringList files;
+        QSet<QString> seen;
+        auto add = [&](const QFileInfo& info) {
+            if (!factory.isExtensionSupported(info.suffix().toLower())) return;
+            const QString path = info.absoluteFilePath();
+            if (!seen.contains(path)) {
+                seen.insert(path);
+                files.append(path);
+            }
+        };
+        for (const QString& root : roots) {
+            const QFileInfo info(root);
+            if (info.isFile()) {
+                add(info);
+                continue;
+            }
+            QDirIterator it(info.absoluteFilePath(), QDir::Files | QDir::Readable,
+                            recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+            while (it.hasNext() && !scan->canceled) {
+                it.next();
+                add(it.fileInfo());
+            }
+        }
+        return files;
+    }
+
+    // Files indexed at their current size and not modified since
+    static QSet<QString> unchanged(const QStringList& roots, const QStringList& files) {
+        QHash<QString, QPair<qint64, QDateTime>> indexed;
+        for (const QString& root : roots) {
+            const QFileInfo info(root);
+            const auto part = MetadataDatabase::instance().indexedFiles(info.isFile() ? info.absolutePath() : info.absoluteFilePath());
+            for (auto it = part.constBegin(); it != part.constEnd(); ++it) {
+                indexed.insert(it.key(), it.value());
+            }
+        }
+        QSet<QString> result;
+        for (const QString& path : files) {
+            auto it = indexed.constFind(path);
+            if (it == indexed.constEnd()) continue;
+            const QFileInfo info(path);
+            if (info.size() == it->first && it->second.isValid() && info.lastModified() <= it->second) {
+                result.insert(path);
+            }
+        }
+        return result;
+    }
+};
+
+LibraryScanner::LibraryScanner(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    qRegisterMetaType<Result>("QuantilyxDoc::LibraryScanner::Result");
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    cancel();
+}
+
+void LibraryScanner::scan(const QStringList& paths, bool recursive)
+{
+    cancel();
+    std::shared_ptr<Private::Scan> scan = std::make_shared<Private::Scan>();
+    d->current = scan;
+
+    // Signals are emitted on the main thread, where the scanner is deleted
+    QPointer<LibraryScanner> self(this);
+    auto report = [self, scan](std::function<void(LibraryScanner*)> emitter) {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, scan, emitter]() {
+            if (self && self->d->current == scan) emitter(self.data());
+        }, Qt::QueuedConnection);
+    };
+
+    ThreadPool::ioInstance().submitDetached([scan, paths, recursive, report]() {
+        QElapsedTimer timer;
+        timer.start();
+        Result result;
+        const QStringList files = Private::collect(paths, recursive, scan);
+        const QSet<QString> skip = Private::unchanged(paths, files);
+        result.found = files.size();
+        result.skipped = skip.size();
+
+        QStringList changed;
+        for (const QString& path : files) {
+            if (!skip.contains(path)) changed.append(path);
+        }
+        LOG_INFO("LibraryScanner: " << files.size() << " files found, " << changed.size() << " new or changed");
+        report([done = result.skipped, total = result.found](LibraryScanner* scanner) { emit scanner->progress(done, total); });
+
+        for (int start = 0; start < changed.size() && !scan->canceled; start += BatchSize) {
+            const int count = qMin(BatchSize, changed.size() - start);
+            QVector<DocumentMetadata> read(count);
+            QVector<char> ok(count, 0);
+            ThreadPool::ioInstance().forEach(count, [&](int i) {
+                if (scan->canceled) return;
+                ok[i] = readMetadata(changed[start + i], &read[i]) ? 1 : 0;
+            }, Task::Priority::Low);
+
+            QList<DocumentMetadata> batch;
+            for (int i = 0; i < count; ++i) {
+                if (ok[i]) batch.append(read[i]);
+                else if (!scan->canceled) ++result.failed;
+            }
+            if (!batch.isEmpty() && MetadataDatabase::instance().storeMetadataBatch(batch)) {
+                result.indexed += batch.size();
+            } else {
+                result.failed += batch.size();
+            }
+            report([done = result.skipped + start + count, total = result.found](LibraryScanner* scanner) {
+                emit scanner->progress(done, total);
+            });
+        }
+
+        result.canceled = scan->canceled;
+        result.elapsedMs = timer.elapsed();
+        LOG_INFO("LibraryScanner: Indexed " << result.indexed << ", skipped " << result.skipped << ", failed "
+                 << result.failed << " in " << result.elapsedMs << " ms" << (result.canceled ? " (canceled)" : ""));
+        report([result](LibraryScanner* scanner) {
+            scanner->d->current.reset();
+            emit scanner->finished(result);
+        });
+    }, Task::Priority::Low);
+}
+
+void LibraryScanner::cancel()
+{
+    if (d->current) {
+        d->current->canceled = true;
+        // finished() of a canceled scan is dropped once another starts
+    }
+}
+
+bool LibraryScanner::isScanning() const
+{
+    return d->current != nullptr;
+}
+
+bool LibraryScanner::readMetadata(const QString& filePath, DocumentMetadata* metadata)
+{
+    const QFileInfo info(filePath);
+    if (!info.isFile() || !info.isReadable()) return false;
+
+    *metadata = DocumentMetadata();
+    metadata->pageCount = 0;
+    const QString suffix = info.suffix().toLower();
+    bool read = false;
+    if (suffix == QLatin1String("pdf")) read = readPdf(filePath, metadata);
+    else if (suffix == QLatin1String("epub")) read = readEpub(filePath, metadata);
+    else if (suffix == QLatin1String("cbz")) read = readCbz(filePath, metadata);
+    else read = readThroughFactory(filePath, metadata);
+    if (!read) return false;
+
+    metadata->filePath = info.absoluteFilePath();
+    metadata->fileSize = info.size();
+    if (metadata->title.isEmpty()) metadata->title = info.completeBaseName();
+    metadata->lastIndexed = QDateTime::currentDateTime();
+    return true;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,113 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_LIBRARYSCANNER_H
+#define QUANTILYX_LIBRARYSCANNER_H
+
+#include "MetadataDatabase.h"
+#include <QObject>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Imports files and directory trees into MetadataDatabase.
+ *
+ * Files already indexed with the same size, and not modified since, are
+ * skipped, which one MetadataDatabase::indexedFiles() query per root
+ * decides. The rest are read in parallel on the I/O thread pool and stored
+ * through storeMetadataBatch().
+ *
+ * Common formats are read through metadata-only paths that load no
+ * document: for PDF, the trailer, the xref, the Info dictionary and the
+ * page count through Poppler; for EPUB, container.xml and the package
+ * document; for CBZ, ComicInfo.xml and the archive's directory. Other
+ * formats are loaded through DocumentFactory as before.
+ */
+class LibraryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Counts of one scan.
+     */
+    struct Result {
+        int found = 0;     // Supported files under the roots
+        int skipped = 0;   // Unchanged since they were indexed
+        int indexed = 0;   // Read and stored
+        int failed = 0;    // Could not be read
+        qint64 elapsedMs = 0;
+        bool canceled = false;
+    };
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit LibraryScanner(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor. Cancels a scan in progress.
+     */
+    ~LibraryScanner() override;
+
+    /**
+     * @brief Start scanning in the background.
+     * Starting a scan while one runs cancels the running one.
+     * @param paths Files and directories to import.
+     * @param recursive Descend into subdirectories.
+     */
+    void scan(const QStringList& paths, bool recursive = true);
+
+    /**
+     * @brief Cancel the running scan; finished() still follows.
+     */
+    void cancel();
+
+    /**
+     * @brief Check if a scan is running.
+     * @return True until finished() is emitted.
+     */
+    bool isScanning() const;
+
+    /**
+     * @brief Read the metadata of one file, through a fast path where there is one.
+     * Safe to call from any thread.
+     * @param filePath File to read.
+     * @param metadata Receives the metadata, with filePath, fileSize and lastIndexed set.
+     * @return False if the file cannot be read.
+     */
+    static bool readMetadata(const QString& filePath, DocumentMetadata* metadata);
+
+signals:
+    /**
+     * @brief Emitted as files are read.
+     * @param done Files read or skipped so far.
+     * @param total Files found.
+     */
+    void progress(int done, int total);
+
+    /**
+     * @brief Emitted when a scan ends, completed or canceled.
+     * @param result Counts of the scan.
+     */
+    void finished(const QuantilyxDoc::LibraryScanner::Result& result);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+Q_DECLARE_METATYPE(QuantilyxDoc::LibraryScanner::Result)
+
+#endif // QUANTILYX_LIBRARYSCANNER_H
@@ -0,0 +1,112 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "LoadTrace.h"
+#include "MetadataDatabase.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QStringList>
+
+namespace QuantilyxDoc {
+
+const char* const LoadTrace::Io = "I/O";
+const char* const LoadTrace::Parse = "Parse";
+const char* const LoadTrace::Metadata = "Metadata";
+const char* const LoadTrace::Toc = "TOC";
+const char* const LoadTrace::Pages = "Pages";
+const char* const LoadTrace::Extras = "Extras";
+
+class LoadTrace::Private {
+public:
+    Private(const QString& path, const QString& fmt)
+        : filePath(path), format(fmt), currentStartUs(0), finished(false) {}
+
+    QString filePath;
+    QString format;
+    QElapsedTimer clock;
+    QVector<QPair<QString, qint64>> phases;
+    QString current;
+    qint64 currentStartUs;
+    bool finished;
+
+    qint64 nowUs() const { return clock.nsecsElapsed() / 1000; }
+
+    void closeCurrent() {
+        if (current.isEmpty()) return;
+        const qint64 spent = nowUs() - currentStartUs;
+        for (auto& phase : phases) {
+            if (phase.first == current) {
+                phase.second += spent;
+                current.clear();
+                return;
+            }
+        }
+        phases.append(qMakePair(current, spent));
+        current.clear();
+    }
+};
+
+LoadTrace::LoadTrace(const QString& filePath, const QString& format)
+    : d(new Private(filePath, format))
+{
+    d->clock.start();
+}
+
+LoadTrace::~LoadTrace()
+{
+    finish(false);
+}
+
+void LoadTrace::phase(const char* name)
+{
+    if (d->finished) return;
+    d->closeCurrent();
+    d->current = QString::fromLatin1(name);
+    d->currentStartUs = d->nowUs();
+}
+
+void LoadTrace::finish(bool success)
+{
+    if (d->finished) return;
+    d->closeCurrent();
+    d->finished = true;
+
+    LoadTiming timing;
+    timing.filePath = QFileInfo(d->filePath).canonicalFilePath();
+    if (timing.filePath.isEmpty()) timing.filePath = d->filePath;
+    timing.format = d->format;
+    timing.fileSize = QFileInfo(d->filePath).size();
+    timing.totalUs = d->nowUs();
+    timing.phases = d->phases;
+    timing.success = success;
+    timing.recordedAt = QDateTime::currentDateTime();
+
+    QStringList parts;
+    for (const auto& phase : timing.phases) {
+        parts.append(QStringLiteral("%1 %2 ms").arg(phase.first).arg(phase.second / 1000.0, 0, 'f', 1));
+    }
+    LOG_INFO("Load of " << d->filePath << " (" << d->format << (success ? "" : ", failed") << ") took "
+             << QString::number(timing.totalUs / 1000.0, 'f', 1) << " ms: " << parts.join(", "));
+
+    if (!Settings::instance().value<bool>("Advanced/RecordLoadTimings", true)) return;
+    // Loads may run on I/O workers; the database connection belongs to its own thread
+    MetadataDatabase* database = &MetadataDatabase::instance();
+    QMetaObject::invokeMethod(database, [database, timing]() {
+        database->storeLoadTiming(timing);
+    }, Qt::QueuedConnection);
+}
+
+bool LoadTrace::isFinished() const
+{
+    return d->finished;
+}
+
+} // namespace QuantilyxDoc
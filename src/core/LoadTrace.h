@@ -0,0 +1,83 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_LOADTRACE_H
+#define QUANTILYX_LOADTRACE_H
+
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Times the phases of one document load.
+ *
+ * A backend's load() creates a trace and names each phase as it starts;
+ * starting a phase ends the previous one, and a phase entered again adds
+ * to its earlier time. When the trace is finished, or destroyed without
+ * being finished (a load that bailed out), the breakdown is logged and
+ * stored in MetadataDatabase as the file's latest load, so slow files in
+ * a corpus can be found with MetadataDatabase::slowestLoads(). Storing is
+ * on unless Advanced/RecordLoadTimings is false.
+ *
+ * Backends use the phase names below so formats can be compared. A trace
+ * is not thread-safe, but may be handed to a background parse and
+ * finished there.
+ */
+class LoadTrace
+{
+public:
+    static const char* const Io;       ///< Opening, mapping or reading the file
+    static const char* const Parse;    ///< Decoding the container and document structure
+    static const char* const Metadata; ///< Title, author and other properties
+    static const char* const Toc;      ///< Outline or table of contents
+    static const char* const Pages;    ///< Constructing page objects or paginating
+    static const char* const Extras;   ///< Annotations, form fields, attachments, fonts
+
+    /**
+     * @brief Start timing a load.
+     * @param filePath File being loaded.
+     * @param format Backend name, e.g. "PDF".
+     */
+    LoadTrace(const QString& filePath, const QString& format);
+
+    /**
+     * @brief Finish as failed if finish() was not called.
+     */
+    ~LoadTrace();
+
+    LoadTrace(const LoadTrace&) = delete;
+    LoadTrace& operator=(const LoadTrace&) = delete;
+
+    /**
+     * @brief End the current phase and start the next.
+     * @param name Phase name, normally one of the constants above.
+     */
+    void phase(const char* name);
+
+    /**
+     * @brief End the last phase, then log and store the breakdown. Later calls do nothing.
+     * @param success Whether the document loaded.
+     */
+    void finish(bool success = true);
+
+    /**
+     * @brief Check whether finish() has run.
+     * @return True once finished.
+     */
+    bool isFinished() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_LOADTRACE_H
@@ -1,7 +1,7 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
@@ -11,22 +11,108 @@
 #include "Logger.h"
 
 #include <QFile>
-#include <QTextStream>
 #include <QDateTime>
 #include <QThread>
 #include <QDir>
 #include <QStandardPaths>
 #include <QFileInfo>
-#include <iostream>
+#include <QHash>
+#include <QMap>
+#include <QMetaMethod>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Messages the ring buffer holds; a power of two
+const size_t QueueCapacity = 8192;
+// Messages the writer takes before it writes and flushes
+const int BatchSize = 256;
+// How long the writer sleeps when the buffer is empty
+const std::chrono::milliseconds IdleWait(100);
+
+// One entry of the ring buffer: a message, or an instruction for the writer
+struct Record {
+    enum Kind { Message, Flush, Clear, Rotate, Reopen };
+
+    Kind kind = Message;
+    LogLevel level = LogLevel::Info;
+    QByteArray args;       // Message, as BinaryLog arguments
+    QString text;          // Path to reopen
+    const char* file = nullptr;
+    int line = 0;
+    const char* function = nullptr;
+    qint64 timestamp = 0;  // Milliseconds since the epoch
+    quintptr threadId = 0;
+    quint64 ticket = 0;    // For Flush: flushes at or below it are done once written
+};
+
+// Bounded multi-producer, single-consumer queue. Producers claim a slot by
+// advancing the enqueue position, then publish it through the slot's
+// sequence number; the writer is the only consumer.
+class RecordQueue {
+public:
+    RecordQueue() : slots(QueueCapacity), enqueuePos(0), dequeuePos(0) {
+        for (size_t i = 0; i < QueueCapacity; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(Record&& record) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & (QueueCapacity - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->record = std::move(record);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(Record& record) {
+        Slot& slot = slots[dequeuePos & (QueueCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) return false;
+        record = std::move(slot.record);
+        slot.record = Record();
+        slot.sequence.store(dequeuePos + QueueCapacity, std::memory_order_release);
+        ++dequeuePos;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    std::vector<Slot> slots;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos; // Writer thread only
+};
+
+} // namespace
+
 // Private implementation
 class Logger::Private
 {
 public:
-    Private() 
-        : level(LogLevel::Info)
+    Private(Logger* q_ptr)
+        : q(q_ptr)
         , consoleOutput(false)
         , fileOutput(true)
         , timestamps(true)
@@ -34,17 +120,27 @@ public:
         , functionNames(true)
         , maxFileSizeMB(10)
         , maxFiles(5)
-        , logFile(nullptr)
-    {}
-    
+        , binaryOutput(qgetenv("QUANTILYX_LOG_BINARY") == "1")
+        , dropped(0)
+        , writerSleeping(false)
+        , stopping(false)
+        , flushTickets(0)
+        , flushedTicket(0)
+    {
+        writer = std::thread([this]() { run(); });
+    }
+
     ~Private() {
-        if (logFile) {
-            logFile->close();
-            delete logFile;
-        }
+        stopping.store(true);
+        wakeWriter();
+        writer.join();
+        if (logFile) logFile->close();
     }
 
-    LogLevel level;
+    Logger* q;
+
+    // Output options; written by the setters, read by the writer per batch
+    mutable std::mutex optionsMutex;
     bool consoleOutput;
     bool fileOutput;
     bool timestamps;
@@ -52,19 +148,439 @@ public:
     bool functionNames;
     int maxFileSizeMB;
     int maxFiles;
+    bool binaryOutput;
     QString logFilePath;
-    QFile* logFile;
+
+    RecordQueue queue;
+    std::atomic<quint64> dropped; // Messages lost to a full buffer since the last report
+
+    // Writer thread and its wakeups; producers only notify when it sleeps
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> writerSleeping;
+    std::atomic<bool> stopping;
+
+    // flush() callers wait here for their ticket to be written
+    std::mutex flushMutex;
+    std::condition_variable flushed;
+    std::atomic<quint64> flushTickets;
+    quint64 flushedTicket; // Protected by flushMutex
+
+    std::unique_ptr<QFile> logFile; // Writer thread only, once it runs
+
+    // Interned literals; IDs index literalTexts
+    std::mutex literalMutex;
+    QHash<QByteArray, quint32> literalIds;
+    std::vector<QByteArray> literalTexts;
+
+    // Writer thread only: literal texts it has looked up, literals defined in
+    // the current binary file, and the time the file's last message counts from
+    std::vector<QByteArray> literalCache;
+    std::vector<bool> definedLiterals;
+    qint64 lastBinaryTimestamp = 0;
+    std::unordered_map<const char*, quint32> siteLiterals; // __FILE__ and __FUNCTION__ strings
+
+    // Categories of call sites, and the levels set for category subtrees
+    mutable std::mutex categoryMutex;
+    QHash<QString, std::shared_ptr<LogCategory>> categories;
+    QMap<QString, int> categoryRules;
+
+    // Helper to find the level of the most specific rule covering a category;
+    // -1 if none does. Called with categoryMutex held.
+    int levelForLocked(const QString& name) const {
+        int level = -1;
+        int matched = -1;
+        for (auto it = categoryRules.constBegin(); it != categoryRules.constEnd(); ++it) {
+            const QString& rule = it.key();
+            const bool covers = name == rule || name.startsWith(rule + QLatin1Char('/'));
+            if (covers && rule.size() > matched) {
+                matched = rule.size();
+                level = it.value();
+            }
+        }
+        return level;
+    }
+
+    // Source directory below src/; files directly in src/ are "app"
+    static QString categoryName(const char* file) {
+        QString path = QString::fromUtf8(file ? file : "");
+        path.replace(QLatin1Char('\\'), QLatin1Char('/'));
+        const int src = path.lastIndexOf(QLatin1String("/src/"));
+        if (src >= 0) {
+            path = path.mid(src + 5);
+        } else if (path.startsWith(QLatin1String("src/"))) {
+            path = path.mid(4);
+        } else {
+            const QString dir = QFileInfo(path).dir().dirName();
+            return dir.isEmpty() || dir == QLatin1String(".") ? QStringLiteral("app") : dir;
+        }
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        return slash < 0 ? QStringLiteral("app") : path.left(slash);
+    }
+
+    // Read rules like "formats/pdf=debug,ui=warning"
+    void parseRules(const QByteArray& spec) {
+        for (const QByteArray& part : spec.split(',')) {
+            const int eq = part.indexOf('=');
+            if (eq <= 0) continue;
+            const QString name = QString::fromUtf8(part.left(eq).trimmed());
+            const QByteArray value = part.mid(eq + 1).trimmed().toLower();
+            int level = -1;
+            if (value == "debug") level = int(LogLevel::Debug);
+            else if (value == "info") level = int(LogLevel::Info);
+            else if (value == "warning" || value == "warn") level = int(LogLevel::Warning);
+            else if (value == "error") level = int(LogLevel::Error);
+            else if (value == "critical") level = int(LogLevel::Critical);
+            if (level >= 0) categoryRules.insert(name, level);
+        }
+    }
+
+    void wakeWriter() {
+        if (writerSleeping.load(std::memory_order_acquire) || stopping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wake.notify_one();
+        }
+    }
+
+    // Queue a record. Messages that matter wait for room; the rest are dropped.
+    void enqueue(Record&& record) {
+        const bool mustKeep = record.kind != Record::Message || record.level >= LogLevel::Warning;
+        while (!queue.tryPush(std::move(record))) {
+            if (!mustKeep) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wakeWriter();
+            std::this_thread::yield();
+        }
+        wakeWriter();
+    }
+
+    // Queue an instruction and wait until the writer has carried it out
+    void enqueueAndWait(Record::Kind kind, const QString& text = QString()) {
+        Record record;
+        record.kind = kind;
+        record.text = text;
+        record.ticket = flushTickets.fetch_add(1) + 1;
+        const quint64 ticket = record.ticket;
+        if (std::this_thread::get_id() == writer.get_id()) return; // Logged from a messageLogged() handler
+        enqueue(std::move(record));
+        std::unique_lock<std::mutex> lock(flushMutex);
+        flushed.wait(lock, [this, ticket]() { return flushedTicket >= ticket; });
+    }
+
+    void run() {
+        std::vector<Record> batch;
+        batch.reserve(BatchSize);
+        for (;;) {
+            Record record;
+            while (int(batch.size()) < BatchSize && queue.tryPop(record)) batch.push_back(std::move(record));
+            if (batch.empty()) {
+                if (stopping.load()) break;
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                writerSleeping.store(true, std::memory_order_release);
+                // A push that raced with going to sleep is picked up after the timeout
+                wake.wait_for(lock, IdleWait);
+                writerSleeping.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            writeBatch(batch);
+            batch.clear();
+        }
+        if (logFile) logFile->flush();
+    }
+
+    void writeBatch(std::vector<Record>& batch) {
+        std::unique_lock<std::mutex> options(optionsMutex);
+        QByteArray fileBuffer;
+        QByteArray outBuffer;
+        QByteArray errBuffer;
+        quint64 doneTicket = 0;
+        QList<QPair<LogLevel, QString>> logged;
+
+        auto writeOut = [&]() {
+            if (!outBuffer.isEmpty()) std::fwrite(outBuffer.constData(), 1, size_t(outBuffer.size()), stdout);
+            if (!errBuffer.isEmpty()) std::fwrite(errBuffer.constData(), 1, size_t(errBuffer.size()), stderr);
+            std::fflush(stdout);
+            outBuffer.clear();
+            errBuffer.clear();
+            if (logFile && logFile->isOpen() && !fileBuffer.isEmpty()) {
+                logFile->write(fileBuffer);
+                logFile->flush();
+            }
+            fileBuffer.clear();
+        };
+
+        const quint64 lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            Record note = makeNote(QStringLiteral("%1 log messages dropped; the log buffer was full").arg(lost));
+            note.level = LogLevel::Warning;
+            batch.insert(batch.begin(), std::move(note));
+        }
+
+        // In binary mode, text is only made for the console and messageLogged()
+        static const QMetaMethod loggedSignal = QMetaMethod::fromSignal(&Logger::messageLogged);
+        const bool binaryFile = binaryOutput && fileOutput && logFile;
+        const bool needText = !binaryFile || consoleOutput || q->isSignalConnected(loggedSignal);
+
+        for (Record& record : batch) {
+            switch (record.kind) {
+            case Record::Message: {
+                if (binaryFile) {
+                    appendBinary(record, fileBuffer);
+                    checkRotation(fileBuffer.size(), writeOut);
+                }
+                if (!needText) break;
+                const QString formatted = formatMessage(record);
+                const QByteArray line = formatted.toUtf8() + '\n';
+                if (consoleOutput) (record.level >= LogLevel::Error ? errBuffer : outBuffer).append(line);
+                if (fileOutput && logFile && !binaryFile) {
+                    fileBuffer.append(line);
+                    checkRotation(fileBuffer.size(), writeOut);
+                }
+                logged.append(qMakePair(record.level, formatted));
+                break;
+            }
+            case Record::Flush:
+                break;
+            case Record::Clear:
+                writeOut();
+                if (logFile) {
+                    logFile->close();
+                    logFile->open(QIODevice::WriteOnly | QIODevice::Truncate | openMode());
+                    startBinaryFile();
+                }
+                break;
+            case Record::Rotate:
+                writeOut();
+                rotateFiles();
+                break;
+            case Record::Reopen:
+                writeOut();
+                openFile();
+                break;
+            }
+            doneTicket = qMax(doneTicket, record.ticket);
+        }
+        writeOut();
+        options.unlock();
+
+        // Handlers may log; that only enqueues
+        for (const auto& message : qAsConst(logged)) emit q->messageLogged(message.first, message.second);
+
+        if (doneTicket > 0) {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            flushedTicket = qMax(flushedTicket, doneTicket);
+            flushed.notify_all();
+        }
+    }
+
+    QString formatMessage(const Record& record) {
+        QString formatted;
+        formatted.reserve(record.args.size() + 96);
+
+        // Timestamp
+        if (timestamps) {
+            formatted += QDateTime::fromMSecsSinceEpoch(record.timestamp).toString("[yyyy-MM-dd HH:mm:ss.zzz] ");
+        }
+
+        // Level
+        formatted += QLatin1Char('[') + levelString(record.level) + QLatin1String("] ");
+
+        // Thread ID
+        if (threadIds) {
+            formatted += QString("[Thread 0x%1] ").arg(record.threadId, 0, 16);
+        }
+
+        // Function name
+        if (functionNames && record.function) {
+            formatted += QString("[%1] ").arg(QLatin1String(record.function));
+        }
+
+        // File and line
+        if (record.file && record.line > 0) {
+            formatted += QString("[%1:%2] ").arg(QFileInfo(QString::fromUtf8(record.file)).fileName()).arg(record.line);
+        }
+
+        // Message
+        formatted += BinaryLog::decodeArguments(record.args, [this](quint32 id) {
+            return QString::fromUtf8(literalText(id));
+        });
+        return formatted;
+    }
+
+    // Text of a literal; the writer keeps its own copy of each it has used
+    const QByteArray& literalText(quint32 id) {
+        if (id >= literalCache.size() || literalCache[id].isNull()) {
+            std::lock_guard<std::mutex> lock(literalMutex);
+            if (id >= literalTexts.size()) {
+                static const QByteArray unknown("");
+                return unknown;
+            }
+            if (id >= literalCache.size()) literalCache.resize(literalTexts.size());
+            literalCache[id] = literalTexts[id];
+        }
+        return literalCache[id];
+    }
+
+    // Literal ID of a call site's file or function, or -1 without one
+    qint64 siteLiteral(const char* text) {
+        if (!text) return -1;
+        auto it = siteLiterals.find(text);
+        if (it == siteLiterals.end()) {
+            it = siteLiterals.emplace(text, Logger::internLiteral(text, int(std::strlen(text)))).first;
+        }
+        return it->second;
+    }
+
+    // Append a message record, preceded by definitions of the literals the
+    // file has not seen yet
+    void appendBinary(const Record& record, QByteArray& out) {
+        auto define = [&](quint32 id) {
+            if (id >= definedLiterals.size()) definedLiterals.resize(id + 1, false);
+            if (definedLiterals[id]) return;
+            definedLiterals[id] = true;
+            const QByteArray& text = literalText(id);
+            out.append(char(BinaryLog::DefinitionRecord));
+            BinaryLog::appendVarint(out, id);
+            BinaryLog::appendVarint(out, quint64(text.size()));
+            out.append(text);
+        };
+        const qint64 fileId = siteLiteral(record.file);
+        const qint64 functionId = siteLiteral(record.function);
+        if (fileId >= 0) define(quint32(fileId));
+        if (functionId >= 0) define(quint32(functionId));
+        BinaryLog::forEachLiteral(record.args, define);
+
+        out.append(char(BinaryLog::MessageRecord));
+        out.append(char(record.level));
+        BinaryLog::appendVarint(out, BinaryLog::zigzag(record.timestamp - lastBinaryTimestamp));
+        lastBinaryTimestamp = record.timestamp;
+        BinaryLog::appendVarint(out, quint64(record.threadId));
+        BinaryLog::appendVarint(out, quint64(fileId + 1));
+        BinaryLog::appendVarint(out, quint64(qMax(record.line, 0)));
+        BinaryLog::appendVarint(out, quint64(functionId + 1));
+        BinaryLog::appendVarint(out, quint64(record.args.size()));
+        out.append(record.args);
+    }
+
+    // Start a session in a freshly opened binary file; new files get the header first
+    void startBinaryFile() {
+        definedLiterals.clear();
+        if (!binaryOutput || !logFile || !logFile->isOpen()) return;
+        QByteArray out;
+        if (logFile->size() == 0) {
+            BinaryLog::FileHeader header = { BinaryLog::Magic, BinaryLog::Version, 0 };
+            out.append(reinterpret_cast<const char*>(&header), int(sizeof(header)));
+        }
+        lastBinaryTimestamp = QDateTime::currentMSecsSinceEpoch();
+        out.append(char(BinaryLog::SessionRecord));
+        BinaryLog::appendVarint(out, quint64(lastBinaryTimestamp));
+        logFile->write(out);
+    }
+
+    QIODevice::OpenMode openMode() const {
+        return binaryOutput ? QIODevice::NotOpen : QIODevice::Text;
+    }
+
+    QString currentFilePath() const {
+        return binaryOutput ? logFilePath + QStringLiteral(".qlb") : logFilePath;
+    }
+
+    static QString levelString(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug:    return "DEBUG";
+            case LogLevel::Info:     return "INFO ";
+            case LogLevel::Warning:  return "WARN ";
+            case LogLevel::Error:    return "ERROR";
+            case LogLevel::Critical: return "CRIT ";
+            default:                 return "?????";
+        }
+    }
+
+    void openFile() {
+        if (logFile) logFile->close();
+        logFile.reset(new QFile(currentFilePath()));
+        if (!logFile->open(QIODevice::Append | openMode())) {
+            std::fprintf(stderr, "Failed to open log file: %s\n", logFile->fileName().toLocal8Bit().constData());
+            logFile.reset();
+            fileOutput = false;
+            return;
+        }
+        startBinaryFile();
+    }
+
+    // Rotate once the file and the pending part of the batch reach the limit
+    void checkRotation(qint64 pendingBytes, const std::function<void()>& writeOut) {
+        if (!logFile || !logFile->isOpen()) return;
+        const qint64 maxSize = static_cast<qint64>(maxFileSizeMB) * 1024 * 1024;
+        if (logFile->size() + pendingBytes < maxSize) return;
+        writeOut();
+        rotateFiles();
+    }
+
+    void rotateFiles() {
+        if (!logFile) return;
+        logFile->close();
+
+        // Rotate existing log files
+        const QString path = logFile->fileName();
+        for (int i = maxFiles - 1; i >= 1; --i) {
+            const QString oldName = path + QString(".%1").arg(i);
+            const QString newName = path + QString(".%1").arg(i + 1);
+            if (QFile::exists(newName)) QFile::remove(newName);
+            if (QFile::exists(oldName)) QFile::rename(oldName, newName);
+        }
+
+        // Move current log to .1
+        const QString rotatedName = path + ".1";
+        if (QFile::exists(rotatedName)) QFile::remove(rotatedName);
+        QFile::rename(path, rotatedName);
+
+        // Open new log file
+        logFile->open(QIODevice::Append | openMode());
+        startBinaryFile();
+        const Record note = makeNote(QStringLiteral("=== Log rotated ==="));
+        QByteArray line;
+        if (binaryOutput) appendBinary(note, line);
+        else line = formatMessage(note).toUtf8() + '\n';
+        logFile->write(line);
+    }
+
+    static Record makeNote(const QString& text) {
+        Record record;
+        record.level = LogLevel::Info;
+        record.args = encodeText(text);
+        record.timestamp = QDateTime::currentMSecsSinceEpoch();
+        record.threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+        return record;
+    }
+
+    // A message that is already text, as a single string argument
+    static QByteArray encodeText(const QString& text) {
+        const QByteArray utf8 = text.toUtf8();
+        QByteArray args;
+        args.reserve(utf8.size() + 4);
+        args.append(char(BinaryLog::StringArg));
+        BinaryLog::appendVarint(args, quint64(utf8.size()));
+        args.append(utf8);
+        return args;
+    }
 };
 
 Logger::Logger()
     : QObject(nullptr)
-    , d(new Private())
+    , m_level(static_cast<int>(LogLevel::Info))
 {
+    d.reset(new Private(this));
+    d->parseRules(qgetenv("QUANTILYX_LOG_LEVELS"));
 }
 
 Logger::~Logger()
 {
     flush();
+    // d's destructor drains the buffer and stops the writer
 }
 
 Logger& Logger::instance()
@@ -75,276 +591,220 @@ Logger& Logger::instance()
 
 void Logger::initialize(LogLevel level, const QString& logFile)
 {
-    QMutexLocker locker(&mutex);
-    
-    d->level = level;
-    
+    setLogLevel(level);
+
     // Determine log file path
-    if (logFile.isEmpty()) {
-        QString logDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + 
+    QString path = logFile;
+    if (path.isEmpty()) {
+        QString logDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
                         "/quantilyxdoc/logs";
         QDir().mkpath(logDir);
-        d->logFilePath = logDir + "/quantilyxdoc.log";
-    } else {
-        d->logFilePath = logFile;
-    }
-    
-    // Open log file
-    if (d->logFile) {
-        d->logFile->close();
-        delete d->logFile;
-    }
-    
-    d->logFile = new QFile(d->logFilePath);
-    if (!d->logFile->open(QIODevice::Append | QIODevice::Text)) {
-        std::cerr << "Failed to open log file: " << d->logFilePath.toStdString() << std::endl;
-        d->fileOutput = false;
-    }
-    
+        path = logDir + "/quantilyxdoc.log";
+    }
+    setLogFilePath(path);
+
     // Log initialization
     log(LogLevel::Info, "=== Logger initialized ===");
-    log(LogLevel::Info, QString("Log file: %1").arg(d->logFilePath));
-    log(LogLevel::Info, QString("Log level: %1").arg(levelString(d->level)));
+    log(LogLevel::Info, QString("Log file: %1").arg(path));
+    log(LogLevel::Info, QString("Log level: %1").arg(Private::levelString(level)));
 }
 
 void Logger::setLogLevel(LogLevel level)
 {
-    QMutexLocker locker(&mutex);
-    d->level = level;
+    m_level.store(static_cast<int>(level), std::memory_order_relaxed);
 }
 
 LogLevel Logger::logLevel() const
 {
-    QMutexLocker locker(&const_cast<QMutex&>(mutex));
-    return d->level;
+    return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed));
 }
 
 void Logger::setConsoleOutput(bool enable)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->consoleOutput = enable;
 }
 
 void Logger::setFileOutput(bool enable)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->fileOutput = enable;
 }
 
 void Logger::setLogFilePath(const QString& filePath)
 {
-    QMutexLocker locker(&mutex);
-    
-    if (d->logFile) {
-        d->logFile->close();
-        delete d->logFile;
-        d->logFile = nullptr;
-    }
-    
-    d->logFilePath = filePath;
-    
-    d->logFile = new QFile(d->logFilePath);
-    if (!d->logFile->open(QIODevice::Append | QIODevice::Text)) {
-        std::cerr << "Failed to open log file: " << d->logFilePath.toStdString() << std::endl;
-        d->fileOutput = false;
+    {
+        std::lock_guard<std::mutex> lock(d->optionsMutex);
+        d->logFilePath = filePath;
+    }
+    // The writer owns the file; it reopens it in line with the messages
+    d->enqueueAndWait(Record::Reopen, filePath);
+}
+
+void Logger::setBinaryOutput(bool enable)
+{
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock(d->optionsMutex);
+        if (d->binaryOutput == enable) return;
+        d->binaryOutput = enable;
+        path = d->logFilePath;
     }
+    // Switch files in line with the messages
+    if (!path.isEmpty()) d->enqueueAndWait(Record::Reopen, path);
+}
+
+bool Logger::isBinaryOutput() const
+{
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
+    return d->binaryOutput;
 }
 
 QString Logger::logFilePath() const
 {
-    QMutexLocker locker(&const_cast<QMutex&>(mutex));
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     return d->logFilePath;
 }
 
 void Logger::setTimestamps(bool enable)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->timestamps = enable;
 }
 
 void Logger::setThreadIds(bool enable)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->threadIds = enable;
 }
 
 void Logger::setFunctionNames(bool enable)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->functionNames = enable;
 }
 
 void Logger::setMaxFileSize(int sizeMB)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->maxFileSizeMB = sizeMB;
 }
 
 void Logger::setMaxFiles(int count)
 {
-    QMutexLocker locker(&mutex);
+    std::lock_guard<std::mutex> lock(d->optionsMutex);
     d->maxFiles = count;
 }
 
-void Logger::log(LogLevel level, const QString& message, 
-                const char* file, int line, const char* function)
+void Logger::setCategoryLevel(const QString& category, LogLevel level)
 {
-    QMutexLocker locker(&mutex);
-    
-    // Check if message should be logged
-    if (level < d->level) {
-        return;
-    }
-    
-    // Format message
-    QString formattedMessage = formatMessage(level, message, file, line, function);
-    
-    // Output to console
-    if (d->consoleOutput) {
-        if (level >= LogLevel::Error) {
-            std::cerr << formattedMessage.toStdString() << std::endl;
-        } else {
-            std::cout << formattedMessage.toStdString() << std::endl;
-        }
+    std::lock_guard<std::mutex> lock(d->categoryMutex);
+    d->categoryRules.insert(category, static_cast<int>(level));
+    for (const auto& known : qAsConst(d->categories)) {
+        known->m_level.store(d->levelForLocked(known->m_name), std::memory_order_relaxed);
     }
-    
-    // Output to file
-    if (d->fileOutput && d->logFile) {
-        checkRotation();
-        writeToFile(formattedMessage);
-    }
-    
-    // Emit signal
-    emit messageLogged(level, formattedMessage);
 }
 
-void Logger::flush()
+void Logger::resetCategoryLevel(const QString& category)
 {
-    QMutexLocker locker(&mutex);
-    
-    if (d->logFile) {
-        d->logFile->flush();
+    std::lock_guard<std::mutex> lock(d->categoryMutex);
+    d->categoryRules.remove(category);
+    for (const auto& known : qAsConst(d->categories)) {
+        known->m_level.store(d->levelForLocked(known->m_name), std::memory_order_relaxed);
     }
 }
 
-void Logger::clear()
+QStringList Logger::categories() const
 {
-    QMutexLocker locker(&mutex);
-    
-    if (d->logFile) {
-        d->logFile->close();
-        d->logFile->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    std::lock_guard<std::mutex> lock(d->categoryMutex);
+    QStringList names = d->categories.keys();
+    names.sort();
+    return names;
+}
+
+LogCategory* Logger::categoryForFile(const char* file)
+{
+    // Called once per call site; the macros keep the result in a static
+    Logger& logger = instance();
+    const QString name = Private::categoryName(file);
+    std::lock_guard<std::mutex> lock(logger.d->categoryMutex);
+    std::shared_ptr<LogCategory>& category = logger.d->categories[name];
+    if (!category) {
+        category = std::make_shared<LogCategory>(name);
+        category->m_level.store(logger.d->levelForLocked(name), std::memory_order_relaxed);
     }
+    return category.get();
 }
 
-void Logger::rotate()
+void Logger::log(LogLevel level, const QString& message,
+                const char* file, int line, const char* function)
 {
-    QMutexLocker locker(&mutex);
-    
-    if (!d->logFile) {
+    // Check if message should be logged
+    if (!isEnabled(level)) {
         return;
     }
-    
-    d->logFile->close();
-    
-    // Rotate existing log files
-    for (int i = d->maxFiles - 1; i >= 1; --i) {
-        QString oldName = d->logFilePath + QString(".%1").arg(i);
-        QString newName = d->logFilePath + QString(".%1").arg(i + 1);
-        
-        if (QFile::exists(newName)) {
-            QFile::remove(newName);
-        }
-        
-        if (QFile::exists(oldName)) {
-            QFile::rename(oldName, newName);
-        }
-    }
-    
-    // Move current log to .1
-    QString rotatedName = d->logFilePath + ".1";
-    if (QFile::exists(rotatedName)) {
-        QFile::remove(rotatedName);
-    }
-    QFile::rename(d->logFilePath, rotatedName);
-    
-    // Open new log file
-    d->logFile->open(QIODevice::Append | QIODevice::Text);
-    
-    log(LogLevel::Info, "=== Log rotated ===");
+    enqueue(level, Private::encodeText(message), file, line, function);
 }
 
-QString Logger::formatMessage(LogLevel level, const QString& message,
-                              const char* file, int line, const char* function) const
+void Logger::enqueue(LogLevel level, QByteArray&& args,
+                     const char* file, int line, const char* function)
 {
-    QString formatted;
-    
-    // Timestamp
-    if (d->timestamps) {
-        formatted += QDateTime::currentDateTime().toString("[yyyy-MM-dd HH:mm:ss.zzz] ");
-    }
-    
-    // Level
-    formatted += QString("[%1] ").arg(levelString(level));
-    
-    // Thread ID
-    if (d->threadIds) {
-        formatted += QString("[Thread 0x%1] ")
-                    .arg(reinterpret_cast<quintptr>(QThread::currentThreadId()), 0, 16);
-    }
-    
-    // Function name
-    if (d->functionNames && function) {
-        formatted += QString("[%1] ").arg(function);
-    }
-    
-    // File and line
-    if (file && line > 0) {
-        QString filename = QFileInfo(file).fileName();
-        formatted += QString("[%1:%2] ").arg(filename).arg(line);
-    }
-    
-    // Message
-    formatted += message;
-    
-    return formatted;
+    // Formatting and output happen on the writer thread
+    Record record;
+    record.level = level;
+    record.args = std::move(args);
+    record.file = file;
+    record.line = line;
+    record.function = function;
+    record.timestamp = QDateTime::currentMSecsSinceEpoch();
+    record.threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    d->enqueue(std::move(record));
 }
 
-QString Logger::levelString(LogLevel level) const
+quint32 Logger::internLiteral(const char* text, int length)
 {
-    switch (level) {
-        case LogLevel::Debug:    return "DEBUG";
-        case LogLevel::Info:     return "INFO ";
-        case LogLevel::Warning:  return "WARN ";
-        case LogLevel::Error:    return "ERROR";
-        case LogLevel::Critical: return "CRIT ";
-        default:                 return "?????";
+    // A call site passes the same literal each time; each thread remembers
+    // the IDs it has seen by address, and checks the text in case the
+    // address was a buffer that now holds something else
+    thread_local std::unordered_map<const char*, std::pair<QByteArray, quint32>> seen;
+    auto it = seen.find(text);
+    if (it != seen.end() && it->second.first.size() == length
+        && std::memcmp(it->second.first.constData(), text, size_t(length)) == 0) {
+        return it->second.second;
     }
+
+    Private* d = instance().d.get();
+    const QByteArray key(text, length);
+    quint32 id;
+    {
+        std::lock_guard<std::mutex> lock(d->literalMutex);
+        auto known = d->literalIds.constFind(key);
+        if (known != d->literalIds.constEnd()) {
+            id = known.value();
+        } else {
+            id = quint32(d->literalTexts.size());
+            d->literalTexts.push_back(key);
+            d->literalIds.insert(key, id);
+        }
+    }
+    if (seen.size() > 4096) seen.clear();
+    seen[text] = std::make_pair(key, id);
+    return id;
 }
 
-void Logger::writeToFile(const QString& message)
+void Logger::flush()
 {
-    if (!d->logFile || !d->logFile->isOpen()) {
-        return;
-    }
-    
-    QTextStream stream(d->logFile);
-    stream << message << Qt::endl;
-    stream.flush();
+    d->enqueueAndWait(Record::Flush);
 }
 
-void Logger::checkRotation()
+void Logger::clear()
 {
-    if (!d->logFile || !d->logFile->isOpen()) {
-        return;
-    }
-    
-    qint64 currentSize = d->logFile->size();
-    qint64 maxSize = static_cast<qint64>(d->maxFileSizeMB) * 1024 * 1024;
-    
-    if (currentSize >= maxSize) {
-        rotate();
-    }
+    d->enqueueAndWait(Record::Clear);
+}
+
+void Logger::rotate()
+{
+    d->enqueueAndWait(Record::Rotate);
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -11,11 +11,17 @@
 #ifndef QUANTILYX_LOGGER_H
 #define QUANTILYX_LOGGER_H
 
+#include "BinaryLog.h"
 #include <QString>
+#include <QStringList>
 #include <QObject>
-#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <type_traits>
 
 namespace QuantilyxDoc {
 
@@ -31,10 +37,62 @@ enum class LogLevel
     Critical    ///< Critical error messages
 };
 
+/**
+ * @brief Source area whose messages can have their own level
+ *
+ * Every logging call site belongs to the category of its source directory
+ * below src/, such as "formats/pdf" or "core". A level set for a category
+ * also covers the categories below it; categories without one follow the
+ * logger's level.
+ */
+class LogCategory
+{
+public:
+    /**
+     * @brief Constructor
+     * @param name Category name
+     */
+    explicit LogCategory(const QString& name) : m_name(name), m_level(-1) {}
+
+    /**
+     * @brief Get category name
+     * @return Name
+     */
+    QString name() const { return m_name; }
+
+    /**
+     * @brief Check if messages of a level are logged for this category
+     * @param level Log level
+     * @return true if at or above the category's level
+     */
+    inline bool isEnabled(LogLevel level) const;
+
+private:
+    friend class Logger;
+
+    QString m_name;
+    std::atomic<int> m_level; // -1: follows the logger's level
+};
+
 /**
  * @brief Logger class - Singleton pattern
  * 
  * Thread-safe logging system with file rotation and multiple outputs.
+ *
+ * Callers only enqueue: log() checks the level, stamps the message with the
+ * time and thread, and puts it in a lock-free ring buffer. A writer thread
+ * takes messages in batches, formats them, writes them to the console and
+ * the file with one flush per batch, rotates the file, and emits
+ * messageLogged() from its own thread. When the buffer is full, Debug and
+ * Info messages are dropped and counted; warnings and errors wait for room.
+ * flush() waits until everything logged before it is written.
+ *
+ * The LOG_* macros check the level before the message is evaluated, so a
+ * filtered-out statement costs one comparison. Levels below
+ * QUANTILYX_LOG_MIN_LEVEL are compiled out entirely; it defaults to Info in
+ * release builds. setCategoryLevel() overrides the level per source area,
+ * and so does QUANTILYX_LOG_LEVELS in the environment, as in
+ * "formats/pdf=debug,ui=warning".
  */
 class Logger : public QObject
 {
@@ -71,6 +129,41 @@ public:
      */
     LogLevel logLevel() const;
 
+    /**
+     * @brief Set the level of a category and the categories below it
+     * @param category Category name, such as "formats/pdf"
+     * @param level Minimum log level
+     */
+    void setCategoryLevel(const QString& category, LogLevel level);
+
+    /**
+     * @brief Make a category follow the logger's level again
+     * @param category Category name
+     */
+    void resetCategoryLevel(const QString& category);
+
+    /**
+     * @brief Get the categories that have logged or been checked so far
+     * @return Category names
+     */
+    QStringList categories() const;
+
+    /**
+     * @brief Get the category of a source file, creating it on first use
+     * @param file Source file path, as in __FILE__
+     * @return Category; lives as long as the logger
+     */
+    static LogCategory* categoryForFile(const char* file);
+
+    /**
+     * @brief Check if messages of a level are logged
+     * @param level Log level
+     * @return true if at or above the current level
+     */
+    bool isEnabled(LogLevel level) const {
+        return static_cast<int>(level) >= m_level.load(std::memory_order_relaxed);
+    }
+
     /**
      * @brief Enable/disable console output
      * @param enable true to enable console output
@@ -83,6 +176,21 @@ public:
      */
     void setFileOutput(bool enable);
 
+    /**
+     * @brief Write the log file in the compact binary format
+     * The file gets a ".qlb" suffix; `quantilyxdoc --decode-log` turns it
+     * back into text or JSON. QUANTILYX_LOG_BINARY=1 in the environment
+     * turns it on from the start.
+     * @param enable true for binary, false for text
+     */
+    void setBinaryOutput(bool enable);
+
+    /**
+     * @brief Check if the log file is binary
+     * @return true if binary
+     */
+    bool isBinaryOutput() const;
+
     /**
      * @brief Set log file path
      * @param filePath Path to log file
@@ -137,7 +245,7 @@ public:
             const char* file = nullptr, int line = 0, const char* function = nullptr);
 
     /**
-     * @brief Flush log buffers
+     * @brief Wait until all messages logged so far are written and flushed
      */
     void flush();
 
@@ -153,7 +261,7 @@ public:
 
 signals:
     /**
-     * @brief Emitted when a message is logged
+     * @brief Emitted when a message is logged, from the writer thread
      * @param level Log level
      * @param message Log message
      */
@@ -175,44 +283,25 @@ private:
      */
     Logger& operator=(const Logger&) = delete;
 
-    /**
-     * @brief Format log message
-     * @param level Log level
-     * @param message Message
-     * @param file Source file
-     * @param line Line number
-     * @param function Function name
-     * @return Formatted message
-     */
-    QString formatMessage(LogLevel level, const QString& message,
-                         const char* file, int line, const char* function) const;
-
-    /**
-     * @brief Get level string
-     * @param level Log level
-     * @return Level string
-     */
-    QString levelString(LogLevel level) const;
+    friend class LogStream;
 
-    /**
-     * @brief Write to file
-     * @param message Message to write
-     */
-    void writeToFile(const QString& message);
+    // Queue a message that passed its level check, as BinaryLog arguments
+    void enqueue(LogLevel level, QByteArray&& args, const char* file, int line, const char* function);
 
-    /**
-     * @brief Check if log file needs rotation
-     */
-    void checkRotation();
+    // ID of a string literal, interned on first use
+    static quint32 internLiteral(const char* text, int length);
 
-private:
     class Private;
     std::unique_ptr<Private> d;
-    QMutex mutex;
+    std::atomic<int> m_level; // Read by every caller without locking
 };
 
 /**
  * @brief Log stream helper class
+ *
+ * Collects the streamed values as BinaryLog arguments: literals by ID,
+ * numbers raw. The writer thread turns them into text, or writes them as
+ * they are to a binary log.
  */
 class LogStream
 {
@@ -221,41 +310,113 @@ public:
         : m_level(level), m_file(file), m_line(line), m_function(function) {}
     
     ~LogStream() {
-        Logger::instance().log(m_level, QString::fromStdString(m_stream.str()), 
-                              m_file, m_line, m_function);
+        // The LOG_* macros only create a stream for messages that pass
+        Logger::instance().enqueue(m_level, std::move(m_args), m_file, m_line, m_function);
     }
     
-    template<typename T>
-    LogStream& operator<<(const T& value) {
-        m_stream << value;
+    // String literals, and char arrays in general, go by ID
+    template<size_t N>
+    LogStream& operator<<(const char (&text)[N]) {
+        m_args.append(char(BinaryLog::LiteralArg));
+        BinaryLog::appendVarint(m_args, Logger::internLiteral(text, int(std::find(text, text + N, '\0') - text)));
         return *this;
     }
-    
-    LogStream& operator<<(const QString& value) {
-        m_stream << value.toStdString();
+
+    // Writable buffers change between calls; they go as strings
+    template<size_t N>
+    LogStream& operator<<(char (&text)[N]) {
+        appendString(text, int(std::find(text, text + N, '\0') - text));
         return *this;
     }
-    
-    LogStream& operator<<(const QByteArray& value) {
-        m_stream << value.constData();
+
+    template<typename T>
+    LogStream& operator<<(const T& value) {
+        if constexpr (std::is_same<T, bool>::value) {
+            m_args.append(char(BinaryLog::BoolArg));
+            m_args.append(char(value ? 1 : 0));
+        } else if constexpr (std::is_same<T, char>::value) {
+            m_args.append(char(BinaryLog::CharArg));
+            m_args.append(value);
+        } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            m_args.append(char(BinaryLog::SignedArg));
+            BinaryLog::appendVarint(m_args, BinaryLog::zigzag(qint64(value)));
+        } else if constexpr (std::is_integral<T>::value) {
+            m_args.append(char(BinaryLog::UnsignedArg));
+            BinaryLog::appendVarint(m_args, quint64(value));
+        } else if constexpr (std::is_floating_point<T>::value) {
+            const double number = double(value);
+            m_args.append(char(BinaryLog::DoubleArg));
+            m_args.append(reinterpret_cast<const char*>(&number), int(sizeof(number)));
+        } else if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value) {
+            appendString(value ? value : "", value ? int(std::strlen(value)) : 0);
+        } else if constexpr (std::is_same<T, std::string>::value) {
+            appendString(value.data(), int(value.size()));
+        } else if constexpr (std::is_same<T, QString>::value) {
+            const QByteArray utf8 = value.toUtf8();
+            appendString(utf8.constData(), utf8.size());
+        } else if constexpr (std::is_same<T, QByteArray>::value) {
+            appendString(value.constData(), int(qstrlen(value.constData())));
+        } else if constexpr (std::is_pointer<T>::value) {
+            m_args.append(char(BinaryLog::PointerArg));
+            BinaryLog::appendVarint(m_args, quint64(reinterpret_cast<quintptr>(value)));
+        } else {
+            // Anything else prints through std::ostream, as before
+            std::ostringstream stream;
+            stream << value;
+            const std::string text = stream.str();
+            appendString(text.data(), int(text.size()));
+        }
         return *this;
     }
 
 private:
+    void appendString(const char* text, int length) {
+        m_args.append(char(BinaryLog::StringArg));
+        BinaryLog::appendVarint(m_args, quint64(length));
+        m_args.append(text, length);
+    }
+
     LogLevel m_level;
     const char* m_file;
     int m_line;
     const char* m_function;
-    std::ostringstream m_stream;
+    QByteArray m_args;
 };
 
+inline bool LogCategory::isEnabled(LogLevel level) const
+{
+    const int categoryLevel = m_level.load(std::memory_order_relaxed);
+    return categoryLevel < 0 ? Logger::instance().isEnabled(level) : static_cast<int>(level) >= categoryLevel;
+}
+
 } // namespace QuantilyxDoc
 
+// Levels below this are compiled out; 0 is Debug, 4 is Critical
+#ifndef QUANTILYX_LOG_MIN_LEVEL
+#  if defined(NDEBUG) || defined(QT_NO_DEBUG)
+#    define QUANTILYX_LOG_MIN_LEVEL 1
+#  else
+#    define QUANTILYX_LOG_MIN_LEVEL 0
+#  endif
+#endif
+
+// The message is only evaluated when the statement's level is enabled
+#define QUANTILYX_LOG(level, ...) \
+    do { \
+        if (static_cast<int>(level) >= QUANTILYX_LOG_MIN_LEVEL) { \
+            static QuantilyxDoc::LogCategory* const quantilyxLogCategory = QuantilyxDoc::Logger::categoryForFile(__FILE__); \
+            if (quantilyxLogCategory->isEnabled(level)) { \
+                QuantilyxDoc::LogStream(level, __FILE__, __LINE__, __FUNCTION__) << __VA_ARGS__; \
+            } \
+        } \
+    } while (0)
+
 // Convenient logging macros
-#define LOG_DEBUG   QuantilyxDoc::LogStream(QuantilyxDoc::LogLevel::Debug, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_INFO    QuantilyxDoc::LogStream(QuantilyxDoc::LogLevel::Info, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_WARNING QuantilyxDoc::LogStream(QuantilyxDoc::LogLevel::Warning, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_ERROR   QuantilyxDoc::LogStream(QuantilyxDoc::LogLevel::Error, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_CRITICAL QuantilyxDoc::LogStream(QuantilyxDoc::LogLevel::Critical, __FILE__, __LINE__, __FUNCTION__)
+#define LOG_DEBUG(...)    QUANTILYX_LOG(QuantilyxDoc::LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...)     QUANTILYX_LOG(QuantilyxDoc::LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...)  QUANTILYX_LOG(QuantilyxDoc::LogLevel::Warning, __VA_ARGS__)
+#define LOG_WARN(...)     LOG_WARNING(__VA_ARGS__)
+#define LOG_ERROR(...)    QUANTILYX_LOG(QuantilyxDoc::LogLevel::Error, __VA_ARGS__)
+#define LOG_CRITICAL(...) QUANTILYX_LOG(QuantilyxDoc::LogLevel::Critical, __VA_ARGS__)
 
 #endif // QUANTILYX_LOGGER_H
\ No newline at end of file
@@ -0,0 +1,120 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MappedFile.h"
+#include "Logger.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <limits>
+
+namespace QuantilyxDoc {
+
+class MappedFile::Private {
+public:
+    Private() : mapped(nullptr), size(0) {}
+
+    QFile file;
+    uchar* mapped;
+    qint64 size;
+    QDateTime modified; // File time at mapping; a newer file gets a new mapping
+
+    // Live mappings by path; weak so the last user unmaps the file
+    static QMutex& registryMutex() {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    static QHash<QString, std::weak_ptr<MappedFile>>& registry() {
+        static QHash<QString, std::weak_ptr<MappedFile>> mappings;
+        return mappings;
+    }
+};
+
+MappedFile::MappedFile()
+    : d(new Private())
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if (d->mapped) d->file.unmap(d->mapped);
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const QString& filePath)
+{
+    const QFileInfo info(filePath);
+    const QString path = info.absoluteFilePath();
+    if (!info.isFile() || info.size() <= 0) return nullptr;
+
+    QMutexLocker locker(&Private::registryMutex());
+    auto& registry = Private::registry();
+    auto it = registry.find(path);
+    if (it != registry.end()) {
+        std::shared_ptr<MappedFile> existing = it->lock();
+        if (existing && existing->d->size == info.size() && existing->d->modified == info.lastModified()) {
+            return existing;
+        }
+        registry.erase(it); // Expired, or the file was rewritten or appended to
+    }
+
+    std::shared_ptr<MappedFile> mapping(new MappedFile());
+    mapping->d->file.setFileName(path);
+    if (!mapping->d->file.open(QIODevice::ReadOnly)) {
+        LOG_WARN("MappedFile: Cannot open " << path << ": " << mapping->d->file.errorString());
+        return nullptr;
+    }
+    mapping->d->size = mapping->d->file.size();
+    mapping->d->modified = info.lastModified();
+    mapping->d->mapped = mapping->d->file.map(0, mapping->d->size);
+    if (!mapping->d->mapped) {
+        LOG_WARN("MappedFile: Cannot map " << path << ": " << mapping->d->file.errorString());
+        return nullptr;
+    }
+
+    // Drop entries whose mappings are gone
+    for (auto stale = registry.begin(); stale != registry.end();) {
+        if (stale->expired()) {
+            stale = registry.erase(stale);
+        } else {
+            ++stale;
+        }
+    }
+    registry.insert(path, mapping);
+    LOG_DEBUG("MappedFile: Mapped " << path << " (" << mapping->d->size << " bytes)");
+    return mapping;
+}
+
+QString MappedFile::filePath() const
+{
+    return d->file.fileName();
+}
+
+const uchar* MappedFile::data() const
+{
+    return d->mapped;
+}
+
+qint64 MappedFile::size() const
+{
+    return d->size;
+}
+
+QByteArray MappedFile::bytes(qint64 offset, qint64 length) const
+{
+    if (offset < 0 || offset > d->size) return QByteArray();
+    if (length < 0 || offset + length > d->size) length = d->size - offset;
+    if (length > std::numeric_limits<int>::max()) return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(d->mapped + offset), static_cast<int>(length));
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,77 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MAPPEDFILE_H
+#define QUANTILYX_MAPPEDFILE_H
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Read-only memory mapping of a whole document file.
+ *
+ * Loaders read from the mapping instead of copying the file into their own
+ * buffers. The pages are backed by the file, so the OS page cache decides
+ * what stays resident. Opening a path that is already mapped returns the
+ * same mapping, as long as the file has not changed on disk. This lets
+ * DocumentFactory map a file once and have the backend it picks reuse it.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Map a file, or return the live mapping of it.
+     * @param filePath File to map.
+     * @return The mapping; null if the file cannot be opened or mapped.
+     */
+    static std::shared_ptr<MappedFile> open(const QString& filePath);
+
+    ~MappedFile();
+
+    /**
+     * @brief Get the mapped file's path.
+     * @return Absolute file path.
+     */
+    QString filePath() const;
+
+    /**
+     * @brief Get the start of the mapped bytes.
+     * @return Pointer valid for the lifetime of this object.
+     */
+    const uchar* data() const;
+
+    /**
+     * @brief Get the mapped size.
+     * @return Size in bytes at the time of mapping.
+     */
+    qint64 size() const;
+
+    /**
+     * @brief Wrap a range of the mapping without copying it.
+     * The returned array must not outlive this object. Ranges of 2 GB and
+     * more cannot be represented and come back empty.
+     * @param offset First byte.
+     * @param length Number of bytes, or -1 for the rest of the file.
+     * @return Raw-data QByteArray over the mapping.
+     */
+    QByteArray bytes(qint64 offset = 0, qint64 length = -1) const;
+
+private:
+    MappedFile();
+
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MAPPEDFILE_H
@@ -0,0 +1,439 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MemoryBudget.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Available memory below this share of the usable total counts as pressure;
+// caches are then shrunk until it is back above ReliefShare.
+const qreal PressureShare = 0.10;
+const qreal ReliefShare = 0.15;
+// Without an explicit setting, caches may use this share of usable memory
+const qreal DefaultCeilingShare = 0.25;
+// Without a setting, one document may hold this share of the ceiling
+const int DefaultDocumentLimitPercent = 50;
+// cgroup v1 reports "no limit" as a huge number rather than "max"
+const qint64 UnlimitedThreshold = Q_INT64_C(1) << 60;
+
+qint64 readFirstNumber(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return -1;
+    const QByteArray value = file.readLine().trimmed();
+    if (value == "max") return -1;
+    bool ok = false;
+    const qint64 number = value.toLongLong(&ok);
+    return (ok && number < UnlimitedThreshold) ? number : -1;
+}
+
+} // namespace
+
+class MemoryBudget::Private {
+public:
+    struct Consumer {
+        int id;
+        QString name;
+        Priority priority;
+        UsageFunction usage;
+        ReleaseFunction release;
+        quintptr document = 0; // The one document a per-document consumer holds memory for
+        DocumentUsageFunction documentUsage;
+        DocumentReleaseFunction documentRelease;
+
+        // Bytes held for each document, added to `usage`
+        void addDocumentUsage(QHash<quintptr, qint64>* usage) const {
+            if (document != 0) {
+                const qint64 bytes = this->usage();
+                if (bytes > 0) (*usage)[document] += bytes;
+            } else if (documentUsage) {
+                const QHash<quintptr, qint64> byDocument = documentUsage();
+                for (auto it = byDocument.constBegin(); it != byDocument.constEnd(); ++it) {
+                    if (it.value() > 0) (*usage)[it.key()] += it.value();
+                }
+            }
+        }
+    };
+
+    // Snapshot of what the system reports; -1 where unknown
+    struct SystemMemory {
+        qint64 totalBytes = -1;      // MemTotal
+        qint64 availableBytes = -1;  // MemAvailable
+        qint64 cgroupLimit = -1;     // memory.max / memory.limit_in_bytes
+        qint64 cgroupUsage = -1;     // memory.current / memory.usage_in_bytes
+
+        // Memory this process can actually use
+        qint64 usableBytes() const {
+            if (cgroupLimit > 0 && (totalBytes <= 0 || cgroupLimit < totalBytes)) return cgroupLimit;
+            return totalBytes;
+        }
+
+        // Memory still available to this process
+        qint64 headroomBytes() const {
+            qint64 headroom = availableBytes;
+            if (cgroupLimit > 0 && cgroupUsage >= 0) {
+                const qint64 cgroupHeadroom = cgroupLimit - cgroupUsage;
+                headroom = headroom < 0 ? cgroupHeadroom : qMin(headroom, cgroupHeadroom);
+            }
+            return headroom;
+        }
+    };
+
+    Private() : nextId(1), explicitCeiling(0), underPressure(false), timer(nullptr) {}
+
+    mutable QMutex mutex;
+    QVector<Consumer> consumers; // Kept sorted by priority, then registration order
+    int nextId;
+    qint64 explicitCeiling;
+    bool underPressure;
+    QTimer* timer;
+    QHash<quintptr, qint64> documentLimits; // Set per document; -1 is never stored
+
+    QVector<Consumer> snapshot() const {
+        QMutexLocker locker(&mutex);
+        return consumers;
+    }
+
+    static SystemMemory readSystemMemory() {
+        SystemMemory mem;
+#ifdef Q_OS_LINUX
+        QFile meminfo("/proc/meminfo");
+        if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream in(&meminfo);
+            QString line;
+            while (in.readLineInto(&line)) {
+                const QStringList parts = line.simplified().split(' ');
+                if (parts.size() < 2) continue;
+                const qint64 kib = parts.at(1).toLongLong();
+                if (parts.at(0) == "MemTotal:") mem.totalBytes = kib * 1024;
+                else if (parts.at(0) == "MemAvailable:") mem.availableBytes = kib * 1024;
+            }
+        }
+
+        // cgroup v2: find our group in /proc/self/cgroup ("0::/path")
+        QString cgroupPath;
+        QFile selfCgroup("/proc/self/cgroup");
+        if (selfCgroup.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            const QStringList lines = QString::fromUtf8(selfCgroup.readAll()).split('\n');
+            for (const QString& line : lines) {
+                if (line.startsWith("0::")) {
+                    cgroupPath = line.mid(3).trimmed();
+                    break;
+                }
+            }
+        }
+        if (!cgroupPath.isNull()) {
+            const QString base = "/sys/fs/cgroup" + (cgroupPath == "/" ? QString() : cgroupPath);
+            mem.cgroupLimit = readFirstNumber(base + "/memory.max");
+            mem.cgroupUsage = readFirstNumber(base + "/memory.current");
+        }
+        if (mem.cgroupLimit < 0) {
+            // cgroup v1
+            mem.cgroupLimit = readFirstNumber("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+            mem.cgroupUsage = readFirstNumber("/sys/fs/cgroup/memory/memory.usage_in_bytes");
+        }
+#endif
+        return mem;
+    }
+
+    qint64 ceilingFor(const SystemMemory& mem) const {
+        if (explicitCeiling > 0) return explicitCeiling;
+        const qint64 configuredMB = Settings::instance().value<int>("Advanced/MemoryBudgetMB", 0);
+        if (configuredMB > 0) return configuredMB * 1024 * 1024;
+        const qint64 usable = mem.usableBytes();
+        if (usable > 0) return static_cast<qint64>(usable * DefaultCeilingShare);
+        return Q_INT64_C(1024) * 1024 * 1024; // 1 GB when nothing is known
+    }
+
+    // Called with mutex held
+    qint64 documentLimitFor(quintptr documentId, qint64 ceiling) const {
+        const auto it = documentLimits.constFind(documentId);
+        if (it != documentLimits.constEnd()) return *it;
+        const int percent = qBound(0, Settings::instance().value<int>("Advanced/DocumentMemoryLimitPercent",
+                                                                      DefaultDocumentLimitPercent), 100);
+        return ceiling / 100 * percent;
+    }
+
+    static QHash<quintptr, qint64> usageByDocument(const QVector<Consumer>& list) {
+        QHash<quintptr, qint64> usage;
+        for (const Consumer& consumer : list) consumer.addDocumentUsage(&usage);
+        return usage;
+    }
+
+    static qint64 totalUsage(const QVector<Consumer>& list) {
+        qint64 total = 0;
+        for (const Consumer& consumer : list) {
+            total += qMax<qint64>(0, consumer.usage());
+        }
+        return total;
+    }
+};
+
+// Static instance pointer
+MemoryBudget* MemoryBudget::s_instance = nullptr;
+
+MemoryBudget& MemoryBudget::instance()
+{
+    if (!s_instance) {
+        s_instance = new MemoryBudget();
+    }
+    return *s_instance;
+}
+
+MemoryBudget::MemoryBudget(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+}
+
+MemoryBudget::~MemoryBudget() = default;
+
+int MemoryBudget::registerConsumer(const QString& name, Priority priority, UsageFunction usage, ReleaseFunction release)
+{
+    QMutexLocker locker(&d->mutex);
+    Private::Consumer consumer{d->nextId++, name, priority, std::move(usage), std::move(release)};
+    // Insert after every consumer of the same or lower priority
+    auto pos = std::upper_bound(d->consumers.begin(), d->consumers.end(), priority,
+                                [](Priority p, const Private::Consumer& c) { return p < c.priority; });
+    d->consumers.insert(pos, consumer);
+    LOG_DEBUG("MemoryBudget: Registered consumer " << name << " (id " << consumer.id << ")");
+    return consumer.id;
+}
+
+void MemoryBudget::unregisterConsumer(int id)
+{
+    QMutexLocker locker(&d->mutex);
+    auto it = std::find_if(d->consumers.begin(), d->consumers.end(),
+                           [id](const Private::Consumer& c) { return c.id == id; });
+    if (it != d->consumers.end()) {
+        d->consumers.erase(it);
+    }
+}
+
+int MemoryBudget::registerDocumentConsumer(const QString& name, Priority priority, quintptr documentId,
+                                           UsageFunction usage, ReleaseFunction release)
+{
+    const int id = registerConsumer(name, priority, std::move(usage), std::move(release));
+    QMutexLocker locker(&d->mutex);
+    for (Private::Consumer& consumer : d->consumers) {
+        if (consumer.id == id) consumer.document = documentId;
+    }
+    return id;
+}
+
+void MemoryBudget::setDocumentAccounting(int id, DocumentUsageFunction usage, DocumentReleaseFunction release)
+{
+    QMutexLocker locker(&d->mutex);
+    for (Private::Consumer& consumer : d->consumers) {
+        if (consumer.id != id) continue;
+        consumer.documentUsage = std::move(usage);
+        consumer.documentRelease = std::move(release);
+        return;
+    }
+}
+
+quintptr MemoryBudget::documentId(const Document* document)
+{
+    return reinterpret_cast<quintptr>(document);
+}
+
+QHash<QString, qint64> MemoryBudget::documentUsage(quintptr documentId) const
+{
+    QHash<QString, qint64> usage;
+    for (const Private::Consumer& consumer : d->snapshot()) {
+        QHash<quintptr, qint64> byDocument;
+        consumer.addDocumentUsage(&byDocument);
+        const qint64 bytes = byDocument.value(documentId);
+        if (bytes > 0) usage[consumer.name] += bytes;
+    }
+    return usage;
+}
+
+QHash<quintptr, qint64> MemoryBudget::usageByDocument() const
+{
+    return Private::usageByDocument(d->snapshot());
+}
+
+qint64 MemoryBudget::documentLimitBytes(quintptr documentId) const
+{
+    const Private::SystemMemory mem = Private::readSystemMemory();
+    QMutexLocker locker(&d->mutex);
+    return d->documentLimitFor(documentId, d->ceilingFor(mem));
+}
+
+void MemoryBudget::setDocumentLimitBytes(quintptr documentId, qint64 bytes)
+{
+    QMutexLocker locker(&d->mutex);
+    if (bytes < 0) d->documentLimits.remove(documentId);
+    else d->documentLimits.insert(documentId, bytes);
+}
+
+void MemoryBudget::forgetDocument(quintptr documentId)
+{
+    QMutexLocker locker(&d->mutex);
+    d->documentLimits.remove(documentId);
+}
+
+qint64 MemoryBudget::releaseForDocument(quintptr documentId, qint64 bytes)
+{
+    if (bytes <= 0) return 0;
+
+    const QVector<Private::Consumer> consumers = d->snapshot();
+    qint64 released = 0;
+    for (const Private::Consumer& consumer : consumers) {
+        if (released >= bytes) break;
+        qint64 freed = 0;
+        if (consumer.document != 0) {
+            if (consumer.document == documentId) freed = consumer.release(bytes - released);
+        } else if (consumer.documentRelease) {
+            freed = consumer.documentRelease(documentId, bytes - released);
+        }
+        if (freed > 0) {
+            LOG_DEBUG("MemoryBudget: " << consumer.name << " released " << freed << " bytes of document " << documentId << ".");
+            released += freed;
+        }
+    }
+    return released;
+}
+
+void MemoryBudget::startMonitoring(int intervalMs)
+{
+    if (!d->timer) {
+        d->timer = new QTimer(this);
+        connect(d->timer, &QTimer::timeout, this, &MemoryBudget::check);
+    }
+    d->timer->start(intervalMs);
+    LOG_INFO("MemoryBudget: Monitoring every " << intervalMs << " ms, ceiling " << ceilingBytes() << " bytes.");
+}
+
+void MemoryBudget::stopMonitoring()
+{
+    if (d->timer) {
+        d->timer->stop();
+    }
+}
+
+qint64 MemoryBudget::ceilingBytes() const
+{
+    const Private::SystemMemory mem = Private::readSystemMemory();
+    QMutexLocker locker(&d->mutex);
+    return d->ceilingFor(mem);
+}
+
+void MemoryBudget::setCeilingBytes(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->explicitCeiling = qMax<qint64>(0, bytes);
+    }
+    check(); // Enforce a lower ceiling right away
+}
+
+qint64 MemoryBudget::usedBytes() const
+{
+    return Private::totalUsage(d->snapshot());
+}
+
+bool MemoryBudget::isUnderPressure() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->underPressure;
+}
+
+qint64 MemoryBudget::release(qint64 bytes)
+{
+    if (bytes <= 0) return 0;
+
+    // Callbacks run without our lock so they may take their own
+    const QVector<Private::Consumer> consumers = d->snapshot();
+    qint64 released = 0;
+    for (const Private::Consumer& consumer : consumers) {
+        if (released >= bytes) break;
+        const qint64 freed = consumer.release(bytes - released);
+        if (freed > 0) {
+            LOG_DEBUG("MemoryBudget: " << consumer.name << " released " << freed << " bytes.");
+            released += freed;
+        }
+    }
+    emit memoryReleased(bytes, released);
+    return released;
+}
+
+void MemoryBudget::check()
+{
+    const Private::SystemMemory mem = Private::readSystemMemory();
+    const QVector<Private::Consumer> consumers = d->snapshot();
+    qint64 used = Private::totalUsage(consumers);
+
+    qint64 ceiling = 0;
+    QHash<quintptr, qint64> documentLimits;
+    const QHash<quintptr, qint64> byDocument = Private::usageByDocument(consumers);
+    {
+        QMutexLocker locker(&d->mutex);
+        ceiling = d->ceilingFor(mem);
+        for (auto it = byDocument.constBegin(); it != byDocument.constEnd(); ++it) {
+            documentLimits.insert(it.key(), d->documentLimitFor(it.key(), ceiling));
+        }
+    }
+
+    // Documents over their soft limit give back their own entries first
+    for (auto it = byDocument.constBegin(); it != byDocument.constEnd(); ++it) {
+        const qint64 limit = documentLimits.value(it.key());
+        if (limit <= 0 || it.value() <= limit) continue;
+        const qint64 released = releaseForDocument(it.key(), it.value() - limit);
+        used -= released;
+        LOG_DEBUG("MemoryBudget: Document " << it.key() << " held " << it.value() << " bytes over its limit of "
+                  << limit << ", released " << released << ".");
+    }
+
+    qint64 excess = used - ceiling;
+
+    // System pressure: shrink enough to get headroom back above the relief level
+    bool pressure = false;
+    const qint64 usable = mem.usableBytes();
+    const qint64 headroom = mem.headroomBytes();
+    if (usable > 0 && headroom >= 0 && headroom < static_cast<qint64>(usable * PressureShare)) {
+        pressure = true;
+        excess = qMax(excess, static_cast<qint64>(usable * ReliefShare) - headroom);
+    }
+
+    bool pressureToggled = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        pressureToggled = (pressure != d->underPressure);
+        d->underPressure = pressure;
+    }
+    if (pressureToggled) {
+        if (pressure) {
+            LOG_WARNING("MemoryBudget: Memory pressure detected, headroom " << headroom << " of " << usable << " bytes.");
+        } else {
+            LOG_INFO("MemoryBudget: Memory pressure relieved.");
+        }
+        emit pressureChanged(pressure);
+    }
+
+    excess = qMin(excess, used); // Caches cannot free more than they hold
+    if (excess > 0) {
+        const qint64 released = release(excess);
+        LOG_DEBUG("MemoryBudget: Needed " << excess << " bytes, caches released " << released << " (used " << used << ", ceiling " << ceiling << ").");
+    }
+}
+
+} // namespace QuantilyxDoc
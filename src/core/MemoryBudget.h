@@ -0,0 +1,248 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MEMORYBUDGET_H
+#define QUANTILYX_MEMORYBUDGET_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Process-wide memory ceiling shared by all in-memory caches.
+ *
+ * Caches register a usage probe and a release callback. A periodic check
+ * sums their usage and compares it with the ceiling (Advanced/MemoryBudgetMB,
+ * or a quarter of the usable memory when that is 0). On Linux it also reads
+ * the cgroup memory limit and /proc/meminfo, and treats low available memory
+ * as pressure. When over the ceiling or under pressure, it asks caches to
+ * release memory in priority order, lowest first, until the excess is gone.
+ *
+ * Consumers can also report what they hold per document, by the document
+ * ID the page caches use (the Document pointer). Each document then has a
+ * soft limit, Advanced/DocumentMemoryLimitPercent of the ceiling (50 by
+ * default, 0 for none) unless set for it. A document over its limit has its
+ * own entries shrunk first at each check, so one huge scan cannot evict
+ * every other document's pages.
+ */
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Shrink order of a consumer. Low consumers are shrunk first.
+     */
+    enum class Priority {
+        Low,     // Duplicates of data cached elsewhere, cheap to rebuild
+        Normal,  // Primary caches
+        High     // Holds user data, shrunk only as a last resort
+    };
+
+    /**
+     * @brief Reports the bytes a consumer currently holds.
+     */
+    using UsageFunction = std::function<qint64()>;
+
+    /**
+     * @brief Asks a consumer to free about the given number of bytes.
+     * Returns the bytes actually freed.
+     */
+    using ReleaseFunction = std::function<qint64(qint64 bytes)>;
+
+    /**
+     * @brief Reports the bytes a consumer holds for each document, by document ID.
+     */
+    using DocumentUsageFunction = std::function<QHash<quintptr, qint64>()>;
+
+    /**
+     * @brief Asks a consumer to free about the given number of bytes held for one document.
+     * Returns the bytes actually freed.
+     */
+    using DocumentReleaseFunction = std::function<qint64(quintptr documentId, qint64 bytes)>;
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit MemoryBudget(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~MemoryBudget() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global MemoryBudget instance.
+     */
+    static MemoryBudget& instance();
+
+    /**
+     * @brief Register a cache with the budget.
+     * @param name Human-readable name for logs and statistics.
+     * @param priority Shrink order.
+     * @param usage Usage probe; called from the monitoring thread.
+     * @param release Release callback; called from the monitoring thread.
+     * @return Consumer ID for unregisterConsumer().
+     */
+    int registerConsumer(const QString& name, Priority priority, UsageFunction usage, ReleaseFunction release);
+
+    /**
+     * @brief Remove a consumer.
+     * @param id ID returned by registerConsumer().
+     */
+    void unregisterConsumer(int id);
+
+    /**
+     * @brief Register a consumer that holds memory for one document only.
+     * @param name Human-readable name for logs and statistics.
+     * @param priority Shrink order.
+     * @param documentId Document the memory is held for.
+     * @param usage Usage probe; called from the monitoring thread.
+     * @param release Release callback; called from the monitoring thread.
+     * @return Consumer ID for unregisterConsumer().
+     */
+    int registerDocumentConsumer(const QString& name, Priority priority, quintptr documentId,
+                                 UsageFunction usage, ReleaseFunction release);
+
+    /**
+     * @brief Let a consumer shared by documents report and release per document.
+     * @param id ID returned by registerConsumer().
+     * @param usage Per-document usage probe; called from the monitoring thread.
+     * @param release Per-document release callback; called from the monitoring thread.
+     */
+    void setDocumentAccounting(int id, DocumentUsageFunction usage, DocumentReleaseFunction release);
+
+    /**
+     * @brief Get the ID consumers know a document by.
+     * @param document The document.
+     * @return Document ID, as in PageCache::CacheKey.
+     */
+    static quintptr documentId(const Document* document);
+
+    /**
+     * @brief Get the memory held for a document, per consumer.
+     * @param documentId Document ID.
+     * @return Bytes by consumer name; consumers holding nothing for it are left out.
+     */
+    QHash<QString, qint64> documentUsage(quintptr documentId) const;
+
+    /**
+     * @brief Get the memory held for each document.
+     * @return Bytes by document ID.
+     */
+    QHash<quintptr, qint64> usageByDocument() const;
+
+    /**
+     * @brief Get the soft limit of a document.
+     * @param documentId Document ID.
+     * @return Limit in bytes, or 0 for none.
+     */
+    qint64 documentLimitBytes(quintptr documentId) const;
+
+    /**
+     * @brief Set the soft limit of a document.
+     * @param documentId Document ID.
+     * @param bytes Limit in bytes, 0 for none, or -1 for the default share of the ceiling.
+     */
+    void setDocumentLimitBytes(quintptr documentId, qint64 bytes);
+
+    /**
+     * @brief Drop what is kept about a closed document.
+     * @param documentId Document ID.
+     */
+    void forgetDocument(quintptr documentId);
+
+    /**
+     * @brief Ask consumers to free memory held for one document, lowest priority first.
+     * @param documentId Document ID.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 releaseForDocument(quintptr documentId, qint64 bytes);
+
+    /**
+     * @brief Start periodic checks. Call from the main thread.
+     * @param intervalMs Interval between checks in milliseconds.
+     */
+    void startMonitoring(int intervalMs = 2000);
+
+    /**
+     * @brief Stop periodic checks.
+     */
+    void stopMonitoring();
+
+    /**
+     * @brief Get the memory ceiling for all registered caches.
+     * @return Ceiling in bytes.
+     */
+    qint64 ceilingBytes() const;
+
+    /**
+     * @brief Set an explicit memory ceiling.
+     * @param bytes Ceiling in bytes, or 0 to derive it from the system.
+     */
+    void setCeilingBytes(qint64 bytes);
+
+    /**
+     * @brief Get the total memory currently held by registered caches.
+     * @return Usage in bytes.
+     */
+    qint64 usedBytes() const;
+
+    /**
+     * @brief Check if the system was under memory pressure at the last check.
+     * @return True if under pressure.
+     */
+    bool isUnderPressure() const;
+
+    /**
+     * @brief Ask consumers to free memory, lowest priority first.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 release(qint64 bytes);
+
+public slots:
+    /**
+     * @brief Check usage and pressure now, and shrink caches if needed.
+     */
+    void check();
+
+signals:
+    /**
+     * @brief Emitted when the pressure state changes.
+     * @param underPressure True if the system is now under memory pressure.
+     */
+    void pressureChanged(bool underPressure);
+
+    /**
+     * @brief Emitted after caches were asked to shrink.
+     * @param requestedBytes Bytes that needed to be freed.
+     * @param releasedBytes Bytes actually freed.
+     */
+    void memoryReleased(qint64 requestedBytes, qint64 releasedBytes);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static MemoryBudget* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MEMORYBUDGET_H
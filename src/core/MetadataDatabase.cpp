@@ -10,32 +10,176 @@
 #include "MetadataDatabase.h"
 #include "Document.h" // For updateMetadataFromDocument
 #include "Logger.h"
+#include "Settings.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QSqlDriver>
 #include <QDir>
+#include <QHash>
+#include <QFileInfo>
 #include <QStandardPaths>
 #include <QDateTime>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QThreadStorage>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDebug>
+#include <atomic>
+#include <cstring>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Rows storeMetadataBatch() commits at once; bounds the WAL a huge import grows
+const int MaxRowsPerTransaction = 10000;
+
+const char* const FingerprintSql = "SELECT * FROM fingerprints WHERE file_path = :file_path;";
+
+const char* const UpsertMetadataSql = R"(
+    INSERT OR REPLACE INTO document_metadata
+    (file_path, title, author, subject, keywords, creation_date, modification_date, format, creator, producer, file_size, page_count, language, custom_fields, last_indexed)
+    VALUES (:file_path, :title, :author, :subject, :keywords, :creation_date, :modification_date, :format, :creator, :producer, :file_size, :page_count, :language, :custom_fields, :last_indexed)
+)";
+
+} // namespace
+
 class MetadataDatabase::Private {
 public:
     Private(MetadataDatabase* q_ptr)
-        : q(q_ptr), ready(false) {}
+        : q(q_ptr), ready(false), readerCount(0), ftsAvailable(false) {}
 
     MetadataDatabase* q;
     mutable QMutex mutex; // Protect access to the QSqlDatabase connection
-    bool ready;
+    std::atomic<bool> ready; // Read without the mutex, which a long write may hold
     QString dbPathStr;
+    QString openPathStr; // File the connections are open on; set before ready
+    std::atomic<int> readerCount;
+    std::atomic<bool> ftsAvailable; // metadata_fts exists; SQLite may lack FTS5
     QSqlDatabase sqlDb;
+    QHash<QString, QSqlQuery> statements; // Prepared once, by SQL text
+
+    // The statement for sql, prepared on first use and reused after; a
+    // SELECT must be finish()ed once read. Mutex must be held.
+    QSqlQuery& statementLocked(const QString& sql) {
+        auto it = statements.find(sql);
+        if (it == statements.end()) {
+            QSqlQuery query(sqlDb);
+            if (!query.prepare(sql)) {
+                LOG_ERROR("MetadataDatabase: Failed to prepare statement: " << query.lastError().text() << ", Query: " << sql);
+            }
+            it = statements.insert(sql, query);
+        }
+        return it.value();
+    }
+
+    // WAL lets readers go on while a write is in progress, and with
+    // synchronous=NORMAL a commit no longer waits for the disk. Cache and
+    // mmap sizes come from Advanced/MetadataCacheMB and Advanced/MetadataMmapMB.
+    static void applyPragmas(QSqlDatabase& db, bool writer) {
+        const int cacheMB = qMax(1, Settings::instance().value<int>("Advanced/MetadataCacheMB", 16));
+        const qint64 mmapMB = qMax(0, Settings::instance().value<int>("Advanced/MetadataMmapMB", 256));
+        QSqlQuery query(db);
+        if (writer && (!query.exec("PRAGMA journal_mode=WAL;") || !query.next()
+                       || query.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0)) {
+            LOG_WARN("MetadataDatabase: WAL journaling unavailable; using the default journal.");
+        }
+        QStringList pragmas = {
+            QString("PRAGMA cache_size=%1;").arg(-cacheMB * 1024), // Negative: in KiB
+            QString("PRAGMA mmap_size=%1;").arg(mmapMB * 1024 * 1024),
+            "PRAGMA temp_store=MEMORY;"
+        };
+        // Recursive triggers make INSERT OR REPLACE fire the delete trigger
+        // that keeps metadata_fts in step
+        pragmas.append(writer ? "PRAGMA synchronous=NORMAL;" : "PRAGMA query_only=1;");
+        if (writer) pragmas.append("PRAGMA recursive_triggers=ON;");
+        for (const QString& pragma : pragmas) {
+            if (!query.exec(pragma)) {
+                LOG_WARN("MetadataDatabase: Failed to apply " << pragma << ": " << query.lastError().text()); // Non-fatal
+            }
+        }
+    }
+
+    // A read-only connection of one thread, with its own statements;
+    // closed when the thread ends
+    struct ReadConnection {
+        QString name;
+        QHash<QString, QSqlQuery> statements;
+
+        ~ReadConnection() {
+            statements.clear();
+            {
+                QSqlDatabase db = QSqlDatabase::database(name, false);
+                db.close();
+            }
+            QSqlDatabase::removeDatabase(name);
+        }
+    };
+    QThreadStorage<ReadConnection*> readConnections;
+
+    // The statement for sql on this thread's read-only connection, opened
+    // on first use; null if none can be opened. Under WAL a reader sees the
+    // last commit and neither waits for the writer nor holds it up.
+    QSqlQuery* readerStatement(const QString& sql) {
+        if (!ready) return nullptr;
+        if (!readConnections.hasLocalData()) {
+            ReadConnection* connection = new ReadConnection;
+            connection->name = QString("metadata_db_reader_%1").arg(++readerCount);
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection->name);
+            db.setDatabaseName(openPathStr);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_OPEN_URI;QSQLITE_BUSY_TIMEOUT=5000");
+            if (db.open()) {
+                applyPragmas(db, false);
+            } else {
+                LOG_WARN("MetadataDatabase: Failed to open a read connection; reading through the writer: " << db.lastError().text());
+            }
+            readConnections.setLocalData(connection);
+        }
+        ReadConnection* connection = readConnections.localData();
+        QSqlDatabase db = QSqlDatabase::database(connection->name, false);
+        if (!db.isOpen()) return nullptr;
+        auto it = connection->statements.find(sql);
+        if (it == connection->statements.end()) {
+            QSqlQuery query(db);
+            if (!query.prepare(sql)) {
+                LOG_ERROR("MetadataDatabase: Failed to prepare statement: " << query.lastError().text() << ", Query: " << sql);
+            }
+            it = connection->statements.insert(sql, query);
+        }
+        return &it.value();
+    }
+
+    // Runs read(query) on sql's statement on this thread's read
+    // connection, or on the writer's under the mutex if there is none
+    template <typename Read>
+    void readWith(const QString& sql, Read read) {
+        if (QSqlQuery* query = readerStatement(sql)) {
+            read(*query);
+            query->finish();
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        QSqlQuery& query = statementLocked(sql);
+        read(query);
+        query.finish();
+    }
+
+    // Binds and runs the upsert of one document. Mutex must be held.
+    bool upsertLocked(const DocumentMetadata& metadata) {
+        QSqlQuery& query = statementLocked(UpsertMetadataSql);
+        const QVariantMap values = metadataToSqlValues(metadata);
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            query.bindValue(it.key(), it.value());
+        }
+        if (!query.exec()) {
+            LOG_ERROR("MetadataDatabase: Failed to store metadata for " << metadata.filePath << ": " << query.lastError().text());
+            return false;
+        }
+        return true;
+    }
 
     // Helper to create the necessary tables
     bool createTables() {
@@ -82,6 +226,44 @@ public:
             );
         )";
 
+        // Phase breakdown of each document's latest load, from LoadTrace
+        QString createLoadTimingsTable = R"(
+            CREATE TABLE IF NOT EXISTS load_timings (
+                file_path TEXT PRIMARY KEY,
+                format TEXT,
+                file_size INTEGER,
+                total_us INTEGER,
+                phases TEXT, -- JSON array of {name, us}
+                success INTEGER,
+                recorded_at TEXT -- ISO datetime string
+            );
+        )";
+
+        // Content fingerprints, valid for the recorded size and mtime
+        QString createFingerprintsTable = R"(
+            CREATE TABLE IF NOT EXISTS fingerprints (
+                file_path TEXT PRIMARY KEY,
+                file_size INTEGER,
+                mtime INTEGER, -- ms since the epoch
+                content_hash BLOB,
+                partial_hash BLOB,
+                min_hash BLOB,
+                page_hashes BLOB, -- quint64 per page, native byte order
+                page_shingles BLOB
+            );
+        )";
+
+        // Page sizes of reflowable books, per layout they were paginated with
+        QString createPaginationTable = R"(
+            CREATE TABLE IF NOT EXISTS pagination (
+                book_id TEXT,
+                layout_hash BLOB,
+                page_sizes BLOB, -- Width and height per page as doubles, native byte order
+                stored_at INTEGER, -- ms since the epoch
+                PRIMARY KEY(book_id, layout_hash)
+            );
+        )";
+
         QSqlQuery query(sqlDb);
         if (!query.exec(createMetadataTable)) {
             LOG_ERROR("MetadataDatabase: Failed to create metadata table: " << query.lastError().text());
@@ -98,24 +280,177 @@ public:
             sqlDb.rollback();
             return false;
         }
+        if (!query.exec(createLoadTimingsTable)) {
+            LOG_ERROR("MetadataDatabase: Failed to create load_timings table: " << query.lastError().text());
+            sqlDb.rollback();
+            return false;
+        }
+        if (!query.exec(createFingerprintsTable)) {
+            LOG_ERROR("MetadataDatabase: Failed to create fingerprints table: " << query.lastError().text());
+            sqlDb.rollback();
+            return false;
+        }
+        if (!query.exec(createPaginationTable)) {
+            LOG_ERROR("MetadataDatabase: Failed to create pagination table: " << query.lastError().text());
+            sqlDb.rollback();
+            return false;
+        }
 
         // Create indexes for faster queries
         QString createPathIndex = "CREATE INDEX IF NOT EXISTS idx_doc_path ON document_metadata(file_path);";
         QString createAuthorIndex = "CREATE INDEX IF NOT EXISTS idx_author ON document_metadata(author);";
         QString createFormatIndex = "CREATE INDEX IF NOT EXISTS idx_format ON document_metadata(format);";
         QString createKeywordIndex = "CREATE INDEX IF NOT EXISTS idx_keywords ON document_metadata(keywords);"; // Might be slow on JSON, consider full-text search
+        QString createLoadTimeIndex = "CREATE INDEX IF NOT EXISTS idx_load_total ON load_timings(total_us);";
 
-        for (const QString& indexSql : {createPathIndex, createAuthorIndex, createFormatIndex, createKeywordIndex}) {
+        for (const QString& indexSql : {createPathIndex, createAuthorIndex, createFormatIndex, createKeywordIndex, createLoadTimeIndex}) {
             if (!query.exec(indexSql)) {
                 LOG_WARN("MetadataDatabase: Failed to create index: " << query.lastError().text()); // Non-fatal
             }
         }
 
+        ftsAvailable = createFullTextTable(query);
+
         sqlDb.commit();
         LOG_DEBUG("MetadataDatabase: Tables created/verified successfully.");
         return true;
     }
 
+    // Creates metadata_fts over title, author, keywords and tags, kept in
+    // step with document_metadata and document_tags by triggers, and fills
+    // it if it is new. False if SQLite was built without FTS5.
+    bool createFullTextTable(QSqlQuery& query) {
+        const bool existed = query.exec("SELECT 1 FROM sqlite_master WHERE name = 'metadata_fts';") && query.next();
+        const QString tagsOf = "(SELECT group_concat(t.tag_name, ' ') FROM document_tags dt JOIN tags t ON t.id = dt.tag_id "
+                               "WHERE dt.doc_file_path = %1)";
+        const QStringList statements = {
+            "CREATE VIRTUAL TABLE IF NOT EXISTS metadata_fts USING fts5("
+            "title, author, keywords, tags, tokenize = 'unicode61 remove_diacritics 2');",
+            "CREATE TRIGGER IF NOT EXISTS metadata_fts_insert AFTER INSERT ON document_metadata BEGIN "
+            "INSERT INTO metadata_fts(rowid, title, author, keywords, tags) "
+            "VALUES (new.rowid, new.title, new.author, new.keywords, " + tagsOf.arg("new.file_path") + "); END;",
+            "CREATE TRIGGER IF NOT EXISTS metadata_fts_delete AFTER DELETE ON document_metadata BEGIN "
+            "DELETE FROM metadata_fts WHERE rowid = old.rowid; END;",
+            "CREATE TRIGGER IF NOT EXISTS metadata_fts_update AFTER UPDATE ON document_metadata BEGIN "
+            "UPDATE metadata_fts SET title = new.title, author = new.author, keywords = new.keywords "
+            "WHERE rowid = old.rowid; END;",
+            "CREATE TRIGGER IF NOT EXISTS metadata_fts_tag_insert AFTER INSERT ON document_tags BEGIN "
+            "UPDATE metadata_fts SET tags = " + tagsOf.arg("new.doc_file_path") + " "
+            "WHERE rowid = (SELECT rowid FROM document_metadata WHERE file_path = new.doc_file_path); END;",
+            "CREATE TRIGGER IF NOT EXISTS metadata_fts_tag_delete AFTER DELETE ON document_tags BEGIN "
+            "UPDATE metadata_fts SET tags = " + tagsOf.arg("old.doc_file_path") + " "
+            "WHERE rowid = (SELECT rowid FROM document_metadata WHERE file_path = old.doc_file_path); END;",
+            // Order of every listing, so a page can start where the last ended
+            "CREATE INDEX IF NOT EXISTS idx_title_order ON document_metadata(coalesce(title, '') COLLATE NOCASE, file_path);"
+        };
+        for (const QString& sql : statements) {
+            if (!query.exec(sql)) {
+                LOG_WARN("MetadataDatabase: Full-text search unavailable, matching with LIKE: " << query.lastError().text());
+                return false;
+            }
+        }
+        if (!existed && !query.exec("INSERT INTO metadata_fts(rowid, title, author, keywords, tags) "
+                                    "SELECT m.rowid, m.title, m.author, m.keywords, " + tagsOf.arg("m.file_path") + " "
+                                    "FROM document_metadata m;")) {
+            LOG_WARN("MetadataDatabase: Failed to fill the full-text table: " << query.lastError().text());
+            return false;
+        }
+        return true;
+    }
+
+    // The FTS5 expression for free text: every word must begin a word of
+    // some column. Words are quoted, so no syntax gets through.
+    static QString matchExpression(const QString& text) {
+        QStringList terms;
+        for (const QString& word : text.simplified().split(QLatin1Char(' '), QString::SkipEmptyParts)) {
+            terms.append('"' + QString(word).replace('"', "\"\"") + "\"*");
+        }
+        return terms.join(QLatin1Char(' '));
+    }
+
+    // The LIKE pattern for matching text as a substring, if FTS5 is missing
+    static QString likePattern(const QString& text) {
+        QString escaped = text.simplified();
+        escaped.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+        return '%' + escaped + '%';
+    }
+
+    // Listing of the documents matching a query, if filtered, in title and
+    // path order; keyset starts after :after_title, :after_path, else
+    // :offset rows are skipped
+    QString listingSql(bool filtered, bool keyset) const {
+        const QString order = "coalesce(m.title, '') COLLATE NOCASE";
+        QString sql = "SELECT m.* FROM document_metadata m ";
+        QStringList conditions;
+        if (filtered && ftsAvailable) {
+            sql += "JOIN metadata_fts f ON f.rowid = m.rowid ";
+            conditions.append("metadata_fts MATCH :match");
+        } else if (filtered) {
+            conditions.append("(m.title LIKE :match ESCAPE '\\' OR m.author LIKE :match_author ESCAPE '\\' "
+                              "OR m.keywords LIKE :match_keywords ESCAPE '\\')");
+        }
+        if (keyset) {
+            // Split so SQLite seeks idx_title_order rather than scanning it
+            conditions.append(order + " >= :after_title AND (" + order + " > :after_title_strict OR m.file_path > :after_path)");
+        }
+        if (!conditions.isEmpty()) sql += "WHERE " + conditions.join(" AND ") + " ";
+        sql += "ORDER BY " + order + ", m.file_path LIMIT :limit";
+        if (!keyset) sql += " OFFSET :offset";
+        return sql + ";";
+    }
+
+    // Runs a listing built by listingSql()
+    QList<DocumentMetadata> list(const QString& text, const DocumentMetadata* after, int limit, int offset) {
+        const bool filtered = !text.simplified().isEmpty();
+        QList<DocumentMetadata> results;
+        const QString sql = listingSql(filtered, after != nullptr);
+        readWith(sql, [&](QSqlQuery& query) {
+            // Each placeholder appears once; the driver binds repeated names unreliably
+            if (filtered && ftsAvailable) {
+                query.bindValue(":match", matchExpression(text));
+            } else if (filtered) {
+                for (const char* name : {":match", ":match_author", ":match_keywords"}) query.bindValue(name, likePattern(text));
+            }
+            if (after) {
+                const QString title = after->title.isNull() ? QString("") : after->title;
+                query.bindValue(":after_title", title);
+                query.bindValue(":after_title_strict", title);
+                query.bindValue(":after_path", after->filePath);
+            } else {
+                query.bindValue(":offset", qMax(0, offset));
+            }
+            query.bindValue(":limit", limit > 0 ? limit : -1); // -1: no limit
+            if (!query.exec()) {
+                LOG_ERROR("MetadataDatabase: Query failed: " << query.lastError().text() << ", Query: " << sql);
+                return;
+            }
+            while (query.next()) {
+                results.append(sqlValuesToMetadata(query));
+            }
+        });
+        return results;
+    }
+
+    // Reads the stored row for a file into fingerprint if it was taken at
+    // the size and mtime fingerprint carries, with query the prepared
+    // FingerprintSql
+    static bool readFingerprint(QSqlQuery& query, DocumentFingerprint& fingerprint) {
+        query.bindValue(":file_path", fingerprint.filePath);
+        if (!query.exec() || !query.next()) return false;
+        if (query.value("file_size").toLongLong() != fingerprint.fileSize
+            || query.value("mtime").toLongLong() != fingerprint.modified) {
+            return false;
+        }
+        fingerprint.contentHash = query.value("content_hash").toByteArray();
+        fingerprint.partialHash = query.value("partial_hash").toByteArray();
+        fingerprint.minHash = query.value("min_hash").toByteArray();
+        const QByteArray pageHashes = query.value("page_hashes").toByteArray();
+        fingerprint.pageHashes.resize(pageHashes.size() / int(sizeof(quint64)));
+        memcpy(fingerprint.pageHashes.data(), pageHashes.constData(), fingerprint.pageHashes.size() * sizeof(quint64));
+        fingerprint.pageShingles = query.value("page_shingles").toByteArray();
+        return true;
+    }
+
     // Helper to convert DocumentMetadata to SQL query values
     QVariantMap metadataToSqlValues(const DocumentMetadata& metadata) const {
         QVariantMap values;
@@ -194,6 +529,8 @@ MetadataDatabase::MetadataDatabase(QObject* parent)
 
 MetadataDatabase::~MetadataDatabase()
 {
+    d->readConnections.setLocalData(nullptr); // This thread's reader; others close as their threads end
+    d->statements.clear(); // Statements must go before their connection
     if (d->sqlDb.isOpen()) {
         d->sqlDb.close();
     }
@@ -230,6 +567,8 @@ bool MetadataDatabase::initialize(const QString& dbPath)
         return false;
     }
 
+    Private::applyPragmas(d->sqlDb, true);
+
     if (!d->createTables()) {
         LOG_ERROR("MetadataDatabase: Failed to create tables.");
         d->ready = false;
@@ -238,6 +577,7 @@ bool MetadataDatabase::initialize(const QString& dbPath)
     }
 
     d->dbPathStr = path;
+    d->openPathStr = path;
     d->ready = true;
     LOG_INFO("MetadataDatabase: Initialized successfully at: " << path);
     return true;
@@ -245,7 +585,6 @@ bool MetadataDatabase::initialize(const QString& dbPath)
 
 bool MetadataDatabase::isReady() const
 {
-    QMutexLocker locker(&d->mutex);
     return d->ready;
 }
 
@@ -258,22 +597,8 @@ bool MetadataDatabase::storeMetadata(const DocumentMetadata& metadata)
 
     QMutexLocker locker(&d->mutex);
 
-    QSqlQuery query(d->sqlDb);
-    query.prepare(R"(
-        INSERT OR REPLACE INTO document_metadata
-        (file_path, title, author, subject, keywords, creation_date, modification_date, format, creator, producer, file_size, page_count, language, custom_fields, last_indexed)
-        VALUES (:file_path, :title, :author, :subject, :keywords, :creation_date, :modification_date, :format, :creator, :producer, :file_size, :page_count, :language, :custom_fields, :last_indexed)
-    )");
-
-    QVariantMap values = d->metadataToSqlValues(metadata);
-    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
-        query.bindValue(it.key(), it.value());
-    }
-
-    if (!query.exec()) {
-        LOG_ERROR("MetadataDatabase: Failed to store metadata for " << metadata.filePath << ": " << query.lastError().text());
-        return false;
-    }
+    if (!d->upsertLocked(metadata)) return false;
+    locker.unlock();
 
     LOG_DEBUG("MetadataDatabase: Stored metadata for: " << metadata.filePath);
     emit metadataStored(metadata.filePath);
@@ -281,33 +606,95 @@ bool MetadataDatabase::storeMetadata(const DocumentMetadata& metadata)
     return true;
 }
 
-DocumentMetadata MetadataDatabase::retrieveMetadata(const QString& filePath) const
+bool MetadataDatabase::storeMetadataBatch(const QList<DocumentMetadata>& metadataList)
 {
     if (!isReady()) {
-        LOG_ERROR("MetadataDatabase::retrieveMetadata: Database is not ready.");
-        return DocumentMetadata(); // Return invalid metadata
+        LOG_ERROR("MetadataDatabase::storeMetadataBatch: Database is not ready.");
+        return false;
+    }
+    if (metadataList.isEmpty()) return true;
+
+    QStringList stored;
+    bool ok = true;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (int start = 0; start < metadataList.size() && ok; start += MaxRowsPerTransaction) {
+            const int end = qMin(metadataList.size(), start + MaxRowsPerTransaction);
+            if (!d->sqlDb.transaction()) {
+                LOG_ERROR("MetadataDatabase: Failed to begin batch: " << d->sqlDb.lastError().text());
+                ok = false;
+                break;
+            }
+            for (int i = start; i < end && ok; ++i) ok = d->upsertLocked(metadataList[i]);
+            if (!ok || !d->sqlDb.commit()) {
+                LOG_ERROR("MetadataDatabase: Batch of " << (end - start) << " rows rolled back: " << d->sqlDb.lastError().text());
+                d->sqlDb.rollback();
+                ok = false;
+                break;
+            }
+            for (int i = start; i < end; ++i) stored.append(metadataList[i].filePath);
+        }
     }
 
-    QMutexLocker locker(&d->mutex);
-
-    QSqlQuery query(d->sqlDb);
-    query.prepare("SELECT * FROM document_metadata WHERE file_path = :file_path;");
-    query.bindValue(":file_path", filePath);
+    LOG_DEBUG("MetadataDatabase: Stored metadata for " << stored.size() << " of " << metadataList.size() << " documents in a batch.");
+    for (const QString& filePath : qAsConst(stored)) emit metadataStored(filePath);
+    if (!stored.isEmpty()) emit databaseContentChanged();
+    return ok;
+}
 
-    if (!query.exec() || !query.next()) {
-        if (query.lastError().isValid()) {
-            LOG_ERROR("MetadataDatabase: Query failed for " << filePath << ": " << query.lastError().text());
-        } else {
-            LOG_DEBUG("MetadataDatabase: No metadata found for: " << filePath);
-        }
+DocumentMetadata MetadataDatabase::retrieveMetadata(const QString& filePath) const
+{
+    if (!isReady()) {
+        LOG_ERROR("MetadataDatabase::retrieveMetadata: Database is not ready.");
         return DocumentMetadata(); // Return invalid metadata
     }
 
-    DocumentMetadata metadata = d->sqlValuesToMetadata(query);
-    LOG_DEBUG("MetadataDatabase: Retrieved metadata for: " << filePath);
+    DocumentMetadata metadata;
+    d->readWith("SELECT * FROM document_metadata WHERE file_path = :file_path;", [&](QSqlQuery& query) {
+        query.bindValue(":file_path", filePath);
+        if (!query.exec() || !query.next()) {
+            if (query.lastError().isValid()) {
+                LOG_ERROR("MetadataDatabase: Query failed for " << filePath << ": " << query.lastError().text());
+            } else {
+                LOG_DEBUG("MetadataDatabase: No metadata found for: " << filePath);
+            }
+            return;
+        }
+        metadata = d->sqlValuesToMetadata(query);
+        LOG_DEBUG("MetadataDatabase: Retrieved metadata for: " << filePath);
+    });
     return metadata;
 }
 
+QHash<QString, QPair<qint64, QDateTime>> MetadataDatabase::indexedFiles(const QString& directory) const
+{
+    QHash<QString, QPair<qint64, QDateTime>> files;
+    if (!isReady()) return files;
+
+    // Paths under the directory sort between "dir/" and "dir0", '0' following '/'
+    QString prefix = directory.isEmpty() ? QString() : QDir::cleanPath(QFileInfo(directory).absoluteFilePath());
+    if (!prefix.isEmpty() && !prefix.endsWith(QLatin1Char('/'))) prefix += QLatin1Char('/');
+    const QString end = prefix.isEmpty() ? QString() : prefix.left(prefix.size() - 1) + QLatin1Char('0');
+    const QString sql = prefix.isEmpty()
+        ? QStringLiteral("SELECT file_path, file_size, last_indexed FROM document_metadata;")
+        : QStringLiteral("SELECT file_path, file_size, last_indexed FROM document_metadata WHERE file_path >= :from AND file_path < :to;");
+    d->readWith(sql, [&](QSqlQuery& query) {
+        if (!prefix.isEmpty()) {
+            query.bindValue(":from", prefix);
+            query.bindValue(":to", end);
+        }
+        if (!query.exec()) {
+            LOG_ERROR("MetadataDatabase: Failed to list indexed files: " << query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            files.insert(query.value(0).toString(),
+                         qMakePair(query.value(1).toLongLong(), QDateTime::fromString(query.value(2).toString(), Qt::ISODateWithMs)));
+        }
+    });
+    return files;
+}
+
 bool MetadataDatabase::removeMetadata(const QString& filePath)
 {
     if (!isReady()) {
@@ -318,8 +705,7 @@ bool MetadataDatabase::removeMetadata(const QString& filePath)
     QMutexLocker locker(&d->mutex);
 
     // Deleting from document_metadata will cascade delete from document_tags due to foreign key constraint
-    QSqlQuery query(d->sqlDb);
-    query.prepare("DELETE FROM document_metadata WHERE file_path = :file_path;");
+    QSqlQuery& query = d->statementLocked("DELETE FROM document_metadata WHERE file_path = :file_path;");
     query.bindValue(":file_path", filePath);
 
     if (!query.exec()) {
@@ -337,93 +723,228 @@ bool MetadataDatabase::removeMetadata(const QString& filePath)
     return true;
 }
 
-QList<DocumentMetadata> MetadataDatabase::queryMetadata(const QString& queryString, int limit, int offset) const
+bool MetadataDatabase::storeLoadTiming(const LoadTiming& timing)
 {
     if (!isReady()) {
-        LOG_ERROR("MetadataDatabase::queryMeta Database is not ready.");
-        return {}; // Return empty list
+        LOG_DEBUG("MetadataDatabase::storeLoadTiming: Database is not ready.");
+        return false;
+    }
+
+    QJsonArray phases;
+    for (const auto& phase : timing.phases) {
+        QJsonObject entry;
+        entry["name"] = phase.first;
+        entry["us"] = double(phase.second);
+        phases.append(entry);
     }
 
     QMutexLocker locker(&d->mutex);
 
-    // WARNING: Directly inserting the queryString into the SQL is DANGEROUS if it comes from user input.
-    // This example assumes queryString is a trusted, pre-sanitized internal query string or a specific field name/value pair.
-    // A safer approach would be to build the WHERE clause programmatically based on a structured query object.
-    // Example of safer query building:
-    // QString baseQuery = "SELECT * FROM document_metadata ";
-    // QStringList conditions;
-    // QVariantMap params; // Use bound values for user-provided data
-    // if (!author.isEmpty()) {
-    //     conditions.append("author = :author");
-    //     params[":author"] = author;
-    // }
-    // if (!titleKeyword.isEmpty()) {
-    //     conditions.append("title LIKE :title");
-    //     params[":title"] = "%" + titleKeyword + "%";
-    // }
-    // QString fullQuery = baseQuery;
-    // if (!conditions.isEmpty()) {
-    //     fullQuery += "WHERE " + conditions.join(" AND ");
-    // }
-    // fullQuery += " LIMIT :limit OFFSET :offset;";
-    // query.prepare(fullQuery);
-    // for (auto it = params.constBegin(); it != params.constEnd(); ++it) {
-    //     query.bindValue(it.key(), it.value());
-    // }
-    // query.bindValue(":limit", limit);
-    // query.bindValue(":offset", offset);
-
-    // For now, let's use a placeholder query that just selects everything with limit/offset
-    QString fullQuery = "SELECT * FROM document_metadata "; // Add WHERE clause based on queryString if it's a structured query
-    if (limit > 0) {
-        fullQuery += QString("LIMIT %1 ").arg(limit);
-        if (offset > 0) {
-            fullQuery += QString("OFFSET %1 ").arg(offset);
-        }
-    }
-    fullQuery += ";"; // Ensure query ends
+    QSqlQuery& query = d->statementLocked(R"(
+        INSERT OR REPLACE INTO load_timings
+        (file_path, format, file_size, total_us, phases, success, recorded_at)
+        VALUES (:file_path, :format, :file_size, :total_us, :phases, :success, :recorded_at)
+    )");
+    query.bindValue(":file_path", timing.filePath);
+    query.bindValue(":format", timing.format);
+    query.bindValue(":file_size", timing.fileSize);
+    query.bindValue(":total_us", timing.totalUs);
+    query.bindValue(":phases", QString::fromUtf8(QJsonDocument(phases).toJson(QJsonDocument::Compact)));
+    query.bindValue(":success", timing.success ? 1 : 0);
+    query.bindValue(":recorded_at", timing.recordedAt.toString(Qt::ISODateWithMs));
 
-    QSqlQuery query(d->sqlDb);
-    // For a real implementation, queryString should be used to build the WHERE clause safely.
-    // query.prepare(queryString); // DO NOT DO THIS WITH USER INPUT
-    query.prepare(fullQuery); // Use the built query
+    if (!query.exec()) {
+        LOG_ERROR("MetadataDatabase: Failed to store load timing for " << timing.filePath << ": " << query.lastError().text());
+        return false;
+    }
+    return true;
+}
+
+QList<LoadTiming> MetadataDatabase::slowestLoads(int limit) const
+{
+    QList<LoadTiming> results;
+    if (!isReady()) {
+        LOG_ERROR("MetadataDatabase::slowestLoads: Database is not ready.");
+        return results;
+    }
+
+    d->readWith("SELECT * FROM load_timings ORDER BY total_us DESC LIMIT :limit;", [&](QSqlQuery& query) {
+        query.bindValue(":limit", qMax(1, limit));
+        if (!query.exec()) {
+            LOG_ERROR("MetadataDatabase: Failed to query load timings: " << query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            LoadTiming timing;
+            timing.filePath = query.value("file_path").toString();
+            timing.format = query.value("format").toString();
+            timing.fileSize = query.value("file_size").toLongLong();
+            timing.totalUs = query.value("total_us").toLongLong();
+            timing.success = query.value("success").toInt() != 0;
+            timing.recordedAt = QDateTime::fromString(query.value("recorded_at").toString(), Qt::ISODateWithMs);
+            const QJsonDocument phases = QJsonDocument::fromJson(query.value("phases").toString().toUtf8());
+            for (const auto& value : phases.array()) {
+                const QJsonObject entry = value.toObject();
+                timing.phases.append(qMakePair(entry["name"].toString(), qint64(entry["us"].toDouble())));
+            }
+            results.append(timing);
+        }
+    });
+    return results;
+}
+
+DocumentFingerprint MetadataDatabase::retrieveFingerprint(const QString& filePath) const
+{
+    DocumentFingerprint fingerprint;
+    const QFileInfo info(filePath);
+    if (!info.isFile()) return fingerprint;
+    fingerprint.filePath = info.absoluteFilePath();
+    fingerprint.fileSize = info.size();
+    fingerprint.modified = info.lastModified().toMSecsSinceEpoch();
+
+    if (d->ready) {
+        d->readWith(FingerprintSql, [&fingerprint](QSqlQuery& query) { Private::readFingerprint(query, fingerprint); });
+    }
+    return fingerprint;
+}
+
+bool MetadataDatabase::storeFingerprint(const DocumentFingerprint& fingerprint)
+{
+    if (fingerprint.filePath.isEmpty()) return false;
+
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) {
+        LOG_DEBUG("MetadataDatabase::storeFingerprint: Database is not ready.");
+        return false;
+    }
+
+    DocumentFingerprint stored;
+    stored.filePath = fingerprint.filePath;
+    stored.fileSize = fingerprint.fileSize;
+    stored.modified = fingerprint.modified;
+    QSqlQuery& lookup = d->statementLocked(FingerprintSql);
+    Private::readFingerprint(lookup, stored);
+    lookup.finish();
+    auto pick = [](const QByteArray& given, const QByteArray& kept) { return given.isEmpty() ? kept : given; };
+    const QVector<quint64>& pageHashes = fingerprint.pageHashes.isEmpty() ? stored.pageHashes : fingerprint.pageHashes;
+
+    QSqlQuery& query = d->statementLocked(R"(
+        INSERT OR REPLACE INTO fingerprints
+        (file_path, file_size, mtime, content_hash, partial_hash, min_hash, page_hashes, page_shingles)
+        VALUES (:file_path, :file_size, :mtime, :content_hash, :partial_hash, :min_hash, :page_hashes, :page_shingles)
+    )");
+    query.bindValue(":file_path", fingerprint.filePath);
+    query.bindValue(":file_size", fingerprint.fileSize);
+    query.bindValue(":mtime", fingerprint.modified);
+    query.bindValue(":content_hash", pick(fingerprint.contentHash, stored.contentHash));
+    query.bindValue(":partial_hash", pick(fingerprint.partialHash, stored.partialHash));
+    query.bindValue(":min_hash", pick(fingerprint.minHash, stored.minHash));
+    query.bindValue(":page_hashes", QByteArray(reinterpret_cast<const char*>(pageHashes.constData()), int(pageHashes.size() * sizeof(quint64))));
+    query.bindValue(":page_shingles", pick(fingerprint.pageShingles, stored.pageShingles));
+
+    if (!query.exec()) {
+        LOG_ERROR("MetadataDatabase: Failed to store fingerprint for " << fingerprint.filePath << ": " << query.lastError().text());
+        return false;
+    }
+    return true;
+}
+
+QVector<QSizeF> MetadataDatabase::retrievePagination(const QString& bookId, const QByteArray& layoutHash) const
+{
+    QVector<QSizeF> pageSizes;
+    if (bookId.isEmpty() || !d->ready) return pageSizes;
+
+    d->readWith("SELECT page_sizes FROM pagination WHERE book_id = :book_id AND layout_hash = :layout_hash;", [&](QSqlQuery& query) {
+        query.bindValue(":book_id", bookId);
+        query.bindValue(":layout_hash", layoutHash);
+        if (!query.exec() || !query.next()) return;
+        const QByteArray packed = query.value(0).toByteArray();
+        const int count = packed.size() / int(2 * sizeof(double));
+        pageSizes.resize(count);
+        const double* values = reinterpret_cast<const double*>(packed.constData());
+        for (int i = 0; i < count; ++i) {
+            pageSizes[i] = QSizeF(values[2 * i], values[2 * i + 1]);
+        }
+    });
+    return pageSizes;
+}
+
+bool MetadataDatabase::storePagination(const QString& bookId, const QByteArray& layoutHash, const QVector<QSizeF>& pageSizes)
+{
+    if (bookId.isEmpty()) return false;
+
+    QVector<double> values;
+    values.reserve(pageSizes.size() * 2);
+    for (const QSizeF& size : pageSizes) {
+        values.append(size.width());
+        values.append(size.height());
+    }
+
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) {
+        LOG_DEBUG("MetadataDatabase::storePagination: Database is not ready.");
+        return false;
+    }
+
+    QSqlQuery& query = d->statementLocked(R"(
+        INSERT OR REPLACE INTO pagination (book_id, layout_hash, page_sizes, stored_at)
+        VALUES (:book_id, :layout_hash, :page_sizes, :stored_at)
+    )");
+    query.bindValue(":book_id", bookId);
+    query.bindValue(":layout_hash", layoutHash);
+    query.bindValue(":page_sizes", QByteArray(reinterpret_cast<const char*>(values.constData()), int(values.size() * sizeof(double))));
+    query.bindValue(":stored_at", QDateTime::currentMSecsSinceEpoch());
 
     if (!query.exec()) {
-        LOG_ERROR("MetadataDatabase: Query failed: " << query.lastError().text() << ", Query: " << fullQuery);
-        return {}; // Return empty list on error
+        LOG_ERROR("MetadataDatabase: Failed to store pagination for " << bookId << ": " << query.lastError().text());
+        return false;
     }
+    return true;
+}
 
-    QList<DocumentMetadata> results;
-    while (query.next()) {
-        results.append(d->sqlValuesToMetadata(query));
+QList<DocumentMetadata> MetadataDatabase::queryMetadata(const QString& queryString, int limit, int offset) const
+{
+    if (!isReady()) {
+        LOG_ERROR("MetadataDatabase::queryMetadata: Database is not ready.");
+        return {}; // Return empty list
     }
 
+    const QList<DocumentMetadata> results = d->list(queryString, nullptr, limit, offset);
     LOG_DEBUG("MetadataDatabase: Query returned " << results.size() << " results.");
     emit queryExecuted(results);
     return results;
 }
 
-QStringList MetadataDatabase::getAllTags() const
+QList<DocumentMetadata> MetadataDatabase::queryMetadataAfter(const QString& queryString, const DocumentMetadata& after, int limit) const
 {
     if (!isReady()) {
-        LOG_ERROR("MetadataDatabase::getAllTags: Database is not ready.");
+        LOG_ERROR("MetadataDatabase::queryMetadataAfter: Database is not ready.");
         return {}; // Return empty list
     }
 
-    QMutexLocker locker(&d->mutex);
-
-    QSqlQuery query(d->sqlDb);
-    query.prepare("SELECT DISTINCT tag_name FROM tags ORDER BY tag_name ASC;");
+    const QList<DocumentMetadata> results = d->list(queryString, after.filePath.isEmpty() ? nullptr : &after, limit, 0);
+    LOG_DEBUG("MetadataDatabase: Query returned " << results.size() << " results after " << after.filePath);
+    emit queryExecuted(results);
+    return results;
+}
 
-    if (!query.exec()) {
-        LOG_ERROR("MetadataDatabase: Failed to get all tags: " << query.lastError().text());
-        return {}; // Return empty list on error
+QStringList MetadataDatabase::getAllTags() const
+{
+    if (!isReady()) {
+        LOG_ERROR("MetadataDatabase::getAllTags: Database is not ready.");
+        return {}; // Return empty list
     }
 
     QStringList tags;
-    while (query.next()) {
-        tags.append(query.value("tag_name").toString());
-    }
+    d->readWith("SELECT DISTINCT tag_name FROM tags ORDER BY tag_name ASC;", [&](QSqlQuery& query) {
+        if (!query.exec()) {
+            LOG_ERROR("MetadataDatabase: Failed to get all tags: " << query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            tags.append(query.value("tag_name").toString());
+        }
+    });
 
     LOG_DEBUG("MetadataDatabase: Retrieved " << tags.size() << " unique tags.");
     return tags;
@@ -436,20 +957,16 @@ QStringList MetadataDatabase::getAllAuthors() const
         return {}; // Return empty list
     }
 
-    QMutexLocker locker(&d->mutex);
-
-    QSqlQuery query(d->sqlDb);
-    query.prepare("SELECT DISTINCT author FROM document_metadata WHERE author IS NOT NULL AND author != '' ORDER BY author ASC;");
-
-    if (!query.exec()) {
-        LOG_ERROR("MetadataDatabase: Failed to get all authors: " << query.lastError().text());
-        return {}; // Return empty list on error
-    }
-
     QStringList authors;
-    while (query.next()) {
-        authors.append(query.value("author").toString());
-    }
+    d->readWith("SELECT DISTINCT author FROM document_metadata WHERE author IS NOT NULL AND author != '' ORDER BY author ASC;", [&](QSqlQuery& query) {
+        if (!query.exec()) {
+            LOG_ERROR("MetadataDatabase: Failed to get all authors: " << query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            authors.append(query.value("author").toString());
+        }
+    });
 
     LOG_DEBUG("MetadataDatabase: Retrieved " << authors.size() << " unique authors.");
     return authors;
@@ -462,20 +979,16 @@ QStringList MetadataDatabase::getAllFormats() const
         return {}; // Return empty list
     }
 
-    QMutexLocker locker(&d->mutex);
-
-    QSqlQuery query(d->sqlDb);
-    query.prepare("SELECT DISTINCT format FROM document_metadata WHERE format IS NOT NULL AND format != '' ORDER BY format ASC;");
-
-    if (!query.exec()) {
-        LOG_ERROR("MetadataDatabase: Failed to get all formats: " << query.lastError().text());
-        return {}; // Return empty list on error
-    }
-
     QStringList formats;
-    while (query.next()) {
-        formats.append(query.value("format").toString());
-    }
+    d->readWith("SELECT DISTINCT format FROM document_metadata WHERE format IS NOT NULL AND format != '' ORDER BY format ASC;", [&](QSqlQuery& query) {
+        if (!query.exec()) {
+            LOG_ERROR("MetadataDatabase: Failed to get all formats: " << query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            formats.append(query.value("format").toString());
+        }
+    });
 
     LOG_DEBUG("MetadataDatabase: Retrieved " << formats.size() << " unique formats.");
     return formats;
@@ -488,17 +1001,14 @@ int MetadataDatabase::documentCount() const
         return 0; // Return 0 on error
     }
 
-    QMutexLocker locker(&d->mutex);
-
-    QSqlQuery query(d->sqlDb);
-    query.prepare("SELECT COUNT(*) AS count FROM document_metadata;");
-
-    if (!query.exec() || !query.next()) {
-        LOG_ERROR("MetadataDatabase: Failed to count documents: " << (query.lastError().isValid() ? query.lastError().text() : "No result"));
-        return 0; // Return 0 on error
-    }
-
-    int count = query.value("count").toInt();
+    int count = 0;
+    d->readWith("SELECT COUNT(*) AS count FROM document_metadata;", [&](QSqlQuery& query) {
+        if (!query.exec() || !query.next()) {
+            LOG_ERROR("MetadataDatabase: Failed to count documents: " << (query.lastError().isValid() ? query.lastError().text() : "No result"));
+            return;
+        }
+        count = query.value("count").toInt();
+    });
     LOG_DEBUG("MetadataDatabase: Total documents indexed: " << count);
     return count;
 }
@@ -510,28 +1020,20 @@ qint64 MetadataDatabase::totalDocumentsSize() const
         return 0; // Return 0 on error
     }
 
-    QMutexLocker locker(&d->mutex);
-
-    QSqlQuery query(d->sqlDb);
-    query.prepare("SELECT SUM(file_size) AS total_size FROM document_metadata;");
-
-    if (!query.exec() || !query.next()) {
-        LOG_ERROR("MetadataDatabase: Failed to calculate total size: " << (query.lastError().isValid() ? query.lastError().text() : "No result"));
-        return 0; // Return 0 on error
-    }
-
-    qint64 totalSize = query.value("total_size").toLongLong();
+    qint64 totalSize = 0;
+    d->readWith("SELECT SUM(file_size) AS total_size FROM document_metadata;", [&](QSqlQuery& query) {
+        if (!query.exec() || !query.next()) {
+            LOG_ERROR("MetadataDatabase: Failed to calculate total size: " << (query.lastError().isValid() ? query.lastError().text() : "No result"));
+            return;
+        }
+        totalSize = query.value("total_size").toLongLong();
+    });
     LOG_DEBUG("MetadataDatabase: Total size of indexed documents: " << totalSize << " bytes.");
     return totalSize;
 }
 
-bool MetadataDatabase::updateMetadataFromDocument(Document* document)
+DocumentMetadata MetadataDatabase::metadataFromDocument(Document* document)
 {
-    if (!document) {
-        LOG_ERROR("MetadataDatabase::updateMetadataFromDocument: Null document provided.");
-        return false;
-    }
-
     // Extract metadata from the Document object.
     // This requires the Document class to have methods for all metadata fields.
     DocumentMetadata metadata;
@@ -550,8 +1052,16 @@ bool MetadataDatabase::updateMetadataFromDocument(Document* document)
     metadata.language = document->language(); // Assuming Document has this
     // metadata.customFields = ...; // Could store format-specific fields as JSON
     metadata.lastIndexed = QDateTime::currentDateTime();
+    return metadata;
+}
 
-    return storeMetadata(metadata);
+bool MetadataDatabase::updateMetadataFromDocument(Document* document)
+{
+    if (!document) {
+        LOG_ERROR("MetadataDatabase::updateMetadataFromDocument: Null document provided.");
+        return false;
+    }
+    return storeMetadata(metadataFromDocument(document));
 }
 
 void MetadataDatabase::vacuum()
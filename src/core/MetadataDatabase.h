@@ -11,11 +11,15 @@
 #define QUANTILYX_METADATADATABASE_H
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QVariantMap>
 #include <QDateTime>
 #include <QMutex>
+#include <QPair>
+#include <QSizeF>
+#include <QVector>
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -43,11 +47,52 @@ struct DocumentMetadata {
     QDateTime lastIndexed;      // Last time this entry was updated in the DB
 };
 
+/**
+ * @brief Time one load of a document took, phase by phase.
+ */
+struct LoadTiming {
+    QString filePath;                       // Canonical file path (key)
+    QString format;                         // Backend that loaded it (e.g., "PDF")
+    qint64 fileSize = 0;                    // Size in bytes
+    qint64 totalUs = 0;                     // Whole load() call
+    QVector<QPair<QString, qint64>> phases; // Phase name and microseconds, in order
+    bool success = false;                   // False if the load failed
+    QDateTime recordedAt;                   // When the load finished
+};
+
+/**
+ * @brief Content fingerprints of one file, shared by duplicate detection and comparison.
+ *
+ * Valid only for the file's size and modification time they were taken
+ * at. Each user fills in the fields it computes and leaves the others
+ * empty; storing merges them with those already stored.
+ */
+struct DocumentFingerprint {
+    QString filePath;            // Canonical file path (key)
+    qint64 fileSize = 0;         // Size in bytes when fingerprinted
+    qint64 modified = 0;         // Modification time when fingerprinted, ms since the epoch
+    QByteArray contentHash;      // SHA-256 of the whole file
+    QByteArray partialHash;      // MD5 of the first and last 64 KB
+    QByteArray minHash;          // MinHashIndex::Signature of the whole text
+    QVector<quint64> pageHashes; // PerceptualHash::pHash of the leading pages
+    QByteArray pageShingles;     // ContentComparison's per-page text and image fingerprints
+};
+
 /**
  * @brief Stores and queries document metadata and tags.
  * 
  * Uses an underlying database engine (e.g., SQLite) to provide fast search and retrieval
  * of document metadata and user-assigned tags.
+ *
+ * The database is journaled in WAL mode with synchronous=NORMAL, and its
+ * page cache and memory map are sized by Advanced/MetadataCacheMB and
+ * Advanced/MetadataMmapMB, read at initialization. Statements are
+ * prepared once and reused.
+ *
+ * Writes go through one connection under a mutex. Reads go through a
+ * read-only connection per calling thread, opened on first use, so the
+ * library view can query while an import is writing: under WAL each
+ * read sees the last committed state and never waits for the writer.
  */
 class MetadataDatabase : public QObject
 {
@@ -92,6 +137,16 @@ public:
      */
     bool storeMetadata(const DocumentMetadata& metadata);
 
+    /**
+     * @brief Store or update metadata for many documents, thousands to a transaction.
+     * Much faster than storeMetadata() per document for imports, which
+     * otherwise pay for one commit each. A failed batch is rolled back;
+     * batches committed before it stay.
+     * @param metadataList The metadata structures to store.
+     * @return True if every document was stored.
+     */
+    bool storeMetadataBatch(const QList<DocumentMetadata>& metadataList);
+
     /**
      * @brief Retrieve metadata for a specific document from the database.
      * @param filePath Path to the document.
@@ -99,6 +154,15 @@ public:
      */
     DocumentMetadata retrieveMetadata(const QString& filePath) const;
 
+    /**
+     * @brief Get the size and indexing time of every document under a directory.
+     * One query for a whole library scan, which skips files unchanged since
+     * they were indexed.
+     * @param directory Directory; empty for every document.
+     * @return File path to file size and lastIndexed.
+     */
+    QHash<QString, QPair<qint64, QDateTime>> indexedFiles(const QString& directory = QString()) const;
+
     /**
      * @brief Remove metadata for a document from the database.
      * @param filePath Path to the document.
@@ -106,15 +170,81 @@ public:
      */
     bool removeMetadata(const QString& filePath);
 
+    /**
+     * @brief Store the timing of a document's latest load, replacing the previous one.
+     * @param timing Phase breakdown from LoadTrace.
+     * @return True if the operation was successful.
+     */
+    bool storeLoadTiming(const LoadTiming& timing);
+
+    /**
+     * @brief Get the documents whose latest load took longest.
+     * @param limit Maximum number of results.
+     * @return Timings, slowest first.
+     */
+    QList<LoadTiming> slowestLoads(int limit = 50) const;
+
+    /**
+     * @brief Get the stored fingerprints of a file, if it has not changed since.
+     * @param filePath Path to the file.
+     * @return The file's current size and modification time, with the stored
+     *         fields if they were taken at those; filePath is empty if the file is missing.
+     */
+    DocumentFingerprint retrieveFingerprint(const QString& filePath) const;
+
+    /**
+     * @brief Store fingerprints of a file.
+     * Empty fields keep what is stored for the same size and modification
+     * time; a fingerprint taken at another one replaces the row.
+     * @param fingerprint Fingerprints, usually filled in from retrieveFingerprint().
+     * @return True if the operation was successful.
+     */
+    bool storeFingerprint(const DocumentFingerprint& fingerprint);
+
+    /**
+     * @brief Get the stored pagination of a reflowable book.
+     * @param bookId Identifier of the book, such as its EPUB unique identifier.
+     * @param layoutHash Hash of the layout settings and content it was paginated with.
+     * @return Size in points of every page in reading order; empty if none is stored.
+     */
+    QVector<QSizeF> retrievePagination(const QString& bookId, const QByteArray& layoutHash) const;
+
+    /**
+     * @brief Store the pagination of a reflowable book.
+     * Paginations for other layout hashes of the book are kept, so switching
+     * back to earlier settings finds theirs too.
+     * @param bookId Identifier of the book.
+     * @param layoutHash Hash of the layout settings and content it was paginated with.
+     * @param pageSizes Size in points of every page in reading order.
+     * @return True if the operation was successful.
+     */
+    bool storePagination(const QString& bookId, const QByteArray& layoutHash, const QVector<QSizeF>& pageSizes);
+
     /**
      * @brief Query the database for documents matching certain criteria.
-     * @param query A string or structured query (e.g., SQL WHERE clause, or a more abstract format).
+     * Every word of the query must begin a word of the title, author,
+     * keywords or tags, through an FTS5 index; without FTS5 in SQLite the
+     * query is matched as a substring instead. Results are ordered by
+     * title, then path. Deep pages cost more with every page skipped; use
+     * queryMetadataAfter() to scroll through many.
+     * @param query Words to match; empty for all documents.
      * @param limit Maximum number of results to return (0 for no limit).
      * @param offset Offset for pagination.
      * @return List of matching DocumentMetadata structures.
      */
     QList<DocumentMetadata> queryMetadata(const QString& query, int limit = 0, int offset = 0) const;
 
+    /**
+     * @brief Get the page of query results following a given result.
+     * Pages start with an index seek rather than by skipping rows, so
+     * the thousandth page costs what the first does.
+     * @param query Words to match, as for queryMetadata().
+     * @param after Last result of the previous page; one without filePath for the first page.
+     * @param limit Maximum number of results to return (0 for no limit).
+     * @return Matching DocumentMetadata structures, in queryMetadata() order.
+     */
+    QList<DocumentMetadata> queryMetadataAfter(const QString& query, const DocumentMetadata& after, int limit) const;
+
     /**
      * @brief Get a list of all unique tags present in the database.
      * @return List of tag strings.
@@ -153,6 +283,13 @@ public:
      */
     bool updateMetadataFromDocument(Document* document);
 
+    /**
+     * @brief Extract the metadata of a loaded Document object.
+     * @param document The loaded document object; not null.
+     * @return Metadata, with lastIndexed set to now.
+     */
+    static DocumentMetadata metadataFromDocument(Document* document);
+
     /**
      * @brief Vacuum/optimize the database file.
      * This compacts the database and frees unused space (for SQLite).
@@ -199,6 +336,7 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static MetadataDatabase* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,107 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MetricsHub.h"
+#include "DiskPageCache.h"
+#include "LazyLoader.h"
+#include "Logger.h"
+#include "PageCache.h"
+#include "RenderThread.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include <QTimer>
+
+namespace QuantilyxDoc {
+
+MetricsHub* MetricsHub::s_instance = nullptr;
+
+bool MetricsHub::Snapshot::operator==(const Snapshot& other) const
+{
+    return cpuQueuedTasks == other.cpuQueuedTasks && cpuRunningTasks == other.cpuRunningTasks
+        && ioQueuedTasks == other.ioQueuedTasks && ioRunningTasks == other.ioRunningTasks
+        && pendingRenders == other.pendingRenders && activeRenders == other.activeRenders
+        && queuedLoads == other.queuedLoads && activeLoads == other.activeLoads
+        && pageCacheBytes == other.pageCacheBytes && pageCacheItems == other.pageCacheItems
+        && diskCacheBytes == other.diskCacheBytes;
+}
+
+class MetricsHub::Private {
+public:
+    QTimer timer;
+    Snapshot last;
+};
+
+MetricsHub& MetricsHub::instance()
+{
+    if (!s_instance) {
+        s_instance = new MetricsHub();
+    }
+    return *s_instance;
+}
+
+MetricsHub::MetricsHub(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    qRegisterMetaType<MetricsHub::Snapshot>("QuantilyxDoc::MetricsHub::Snapshot");
+    d->timer.setTimerType(Qt::CoarseTimer);
+    connect(&d->timer, &QTimer::timeout, this, &MetricsHub::sample);
+}
+
+MetricsHub::~MetricsHub() = default;
+
+void MetricsHub::start()
+{
+    const int hz = qBound(1, Settings::instance().value<int>("Advanced/MetricsHubHz", 10), 60);
+    d->timer.start(1000 / hz);
+    sample();
+    LOG_DEBUG("MetricsHub: Sampling at " << hz << " Hz");
+}
+
+void MetricsHub::stop()
+{
+    d->timer.stop();
+}
+
+bool MetricsHub::isRunning() const
+{
+    return d->timer.isActive();
+}
+
+MetricsHub::Snapshot MetricsHub::snapshot() const
+{
+    return d->last;
+}
+
+void MetricsHub::sample()
+{
+    // Only counters are read, so a sample costs a few atomic loads and short locks
+    Snapshot s;
+    ThreadPool& cpu = ThreadPool::instance();
+    ThreadPool& io = ThreadPool::ioInstance();
+    s.cpuQueuedTasks = cpu.queuedTaskCount();
+    s.cpuRunningTasks = cpu.runningTaskCount();
+    s.ioQueuedTasks = io.queuedTaskCount();
+    s.ioRunningTasks = io.runningTaskCount();
+    RenderThread& render = RenderThread::instance();
+    s.pendingRenders = render.pendingRequestCount();
+    s.activeRenders = render.activeRequestCount();
+    LazyLoader& loader = LazyLoader::instance();
+    s.queuedLoads = loader.queuedRequestCount();
+    s.activeLoads = loader.activeRequestCount();
+    s.pageCacheBytes = PageCache::instance().currentSizeBytes();
+    s.pageCacheItems = PageCache::instance().itemCount();
+    s.diskCacheBytes = DiskPageCache::instance().currentSizeBytes();
+
+    if (s == d->last) return;
+    d->last = s;
+    emit metricsUpdated(s);
+}
+
+} // namespace QuantilyxDoc
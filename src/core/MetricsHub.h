@@ -0,0 +1,112 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_METRICSHUB_H
+#define QUANTILYX_METRICSHUB_H
+
+#include <QObject>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Samples background subsystem state at a fixed rate for display.
+ *
+ * The thread pools, render thread, caches and lazy loader signal every
+ * queue change, which under load is thousands of queued events a second.
+ * Widgets that only show the state read it from here instead: a timer on
+ * the main thread reads each subsystem's counters (Advanced/MetricsHubHz
+ * times a second, 10 by default) and emits one metricsUpdated() when
+ * anything changed.
+ */
+class MetricsHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Subsystem state at one sample.
+     */
+    struct Snapshot {
+        int cpuQueuedTasks = 0;
+        int cpuRunningTasks = 0;
+        int ioQueuedTasks = 0;
+        int ioRunningTasks = 0;
+        int pendingRenders = 0;
+        int activeRenders = 0;
+        int queuedLoads = 0;
+        int activeLoads = 0;
+        qint64 pageCacheBytes = 0;
+        int pageCacheItems = 0;
+        qint64 diskCacheBytes = 0;
+
+        bool isIdle() const {
+            return cpuQueuedTasks + cpuRunningTasks + ioQueuedTasks + ioRunningTasks
+                + pendingRenders + activeRenders + queuedLoads + activeLoads == 0;
+        }
+
+        bool operator==(const Snapshot& other) const;
+        bool operator!=(const Snapshot& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global MetricsHub instance.
+     */
+    static MetricsHub& instance();
+
+    /**
+     * @brief Destructor.
+     */
+    ~MetricsHub() override;
+
+    /**
+     * @brief Start sampling. Called once the subsystems exist.
+     */
+    void start();
+
+    /**
+     * @brief Stop sampling.
+     */
+    void stop();
+
+    /**
+     * @brief Check if sampling.
+     * @return True if started.
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Get the latest sample.
+     * @return Snapshot, all zero before the first sample.
+     */
+    Snapshot snapshot() const;
+
+signals:
+    /**
+     * @brief Emitted after a sample that differs from the previous one.
+     * @param snapshot The new sample.
+     */
+    void metricsUpdated(const QuantilyxDoc::MetricsHub::Snapshot& snapshot);
+
+private:
+    explicit MetricsHub(QObject* parent = nullptr);
+    void sample();
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static MetricsHub* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+Q_DECLARE_METATYPE(QuantilyxDoc::MetricsHub::Snapshot)
+
+#endif // QUANTILYX_METRICSHUB_H
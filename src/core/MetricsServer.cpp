@@ -0,0 +1,315 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MetricsServer.h"
+#include "Application.h"
+#include "DiskPageCache.h"
+#include "Document.h"
+#include "IntelligentCache.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "PageCache.h"
+#include "RenderThread.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include "../ocr/OcrEngine.h"
+#include "../search/FullTextIndex.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <functional>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const int MaxRequestBytes = 8192;
+const int RequestTimeoutMs = 5000;
+
+QByteArray escapeLabel(const QString& value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return escaped;
+}
+
+// Writes metric families in the text exposition format
+class Exposition
+{
+public:
+    void family(const char* name, const char* type, const char* help)
+    {
+        m_text += "# HELP ";
+        m_text += name;
+        m_text += ' ';
+        m_text += help;
+        m_text += "\n# TYPE ";
+        m_text += name;
+        m_text += ' ';
+        m_text += type;
+        m_text += '\n';
+    }
+
+    void sample(const QByteArray& name, double value, const QByteArray& labels = QByteArray())
+    {
+        m_text += name;
+        if (!labels.isEmpty()) m_text += '{' + labels + '}';
+        m_text += ' ';
+        m_text += QByteArray::number(value, 'g', 15);
+        m_text += '\n';
+    }
+
+    void gauge(const char* name, const char* help, double value)
+    {
+        family(name, "gauge", help);
+        sample(name, value);
+    }
+
+    void counter(const char* name, const char* help, double value)
+    {
+        family(name, "counter", help);
+        sample(name, value);
+    }
+
+    void histogram(const char* name, const char* help, const LatencyHistogram& histogram)
+    {
+        family(name, "histogram", help);
+        const LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+        const QVector<double> bounds = LatencyHistogram::upperBoundsSeconds();
+        const QByteArray base(name);
+        quint64 cumulative = 0;
+        for (int i = 0; i < bounds.size(); ++i) {
+            cumulative += snapshot.counts.at(i);
+            sample(base + "_bucket", double(cumulative), "le=\"" + QByteArray::number(bounds.at(i), 'g', 6) + '"');
+        }
+        sample(base + "_bucket", double(snapshot.count), "le=\"+Inf\"");
+        sample(base + "_sum", snapshot.sumSeconds);
+        sample(base + "_count", double(snapshot.count));
+    }
+
+    const QByteArray& text() const { return m_text; }
+
+private:
+    QByteArray m_text;
+};
+
+qint64 residentBytes()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) return 0;
+    return statm.readAll().split(' ').value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+// One family with a sample per pool; the text format wants a family's samples together
+void writePools(Exposition& out, const char* name, const char* type, const char* help,
+                const std::function<double(const ThreadPool&)>& value)
+{
+    out.family(name, type, help);
+    out.sample(name, value(ThreadPool::instance()), "pool=\"cpu\"");
+    out.sample(name, value(ThreadPool::ioInstance()), "pool=\"io\"");
+}
+
+} // namespace
+
+class MetricsServer::Private {
+public:
+    Private(MetricsServer* q) : q(q) {}
+
+    MetricsServer* q;
+    QTcpServer server;
+
+    void accept() {
+        while (QTcpSocket* socket = server.nextPendingConnection()) {
+            QObject::connect(socket, &QTcpSocket::disconnected, q, [this, socket]() {
+                requests.remove(socket);
+                socket->deleteLater();
+            });
+            QObject::connect(socket, &QTcpSocket::readyRead, q, [this, socket]() { serve(socket); });
+            QPointer<QTcpSocket> guard(socket);
+            QTimer::singleShot(RequestTimeoutMs, socket, [guard]() {
+                if (guard) guard->abort();
+            });
+        }
+    }
+
+    void serve(QTcpSocket* socket) {
+        if (socket->state() != QAbstractSocket::ConnectedState) return; // Answered already
+        QByteArray& request = requests[socket];
+        request += socket->readAll();
+        if (request.size() > MaxRequestBytes) {
+            reply(socket, "431 Request Header Fields Too Large", "text/plain", "Request too large\n");
+            return;
+        }
+        if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) return; // Headers not complete yet
+
+        const QList<QByteArray> requestLine = request.left(request.indexOf('\n')).trimmed().split(' ');
+        const QByteArray method = requestLine.value(0);
+        QByteArray path = requestLine.value(1);
+        path = path.left(path.indexOf('?') >= 0 ? path.indexOf('?') : path.size());
+        if (method != "GET" && method != "HEAD") {
+            reply(socket, "405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+        } else if (path != "/metrics") {
+            reply(socket, "404 Not Found", "text/plain", "Metrics are at /metrics\n");
+        } else {
+            const QByteArray body = q->exposition();
+            reply(socket, "200 OK", "text/plain; version=0.0.4; charset=utf-8", method == "HEAD" ? QByteArray() : body,
+                  body.size());
+        }
+    }
+
+    void reply(QTcpSocket* socket, const char* status, const char* contentType, const QByteArray& body,
+               qint64 contentLength = -1) {
+        requests.remove(socket);
+        QByteArray response = QByteArray("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType
+            + "\r\nContent-Length: " + QByteArray::number(contentLength >= 0 ? contentLength : body.size())
+            + "\r\nConnection: close\r\n\r\n" + body;
+        socket->write(response);
+        socket->disconnectFromHost();
+    }
+
+    QHash<QTcpSocket*, QByteArray> requests; // Bytes received from each connection so far
+};
+
+MetricsServer* MetricsServer::s_instance = nullptr;
+
+MetricsServer& MetricsServer::instance()
+{
+    if (!s_instance) {
+        s_instance = new MetricsServer(qApp);
+    }
+    return *s_instance;
+}
+
+MetricsServer::MetricsServer(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+    connect(&d->server, &QTcpServer::newConnection, this, [this]() { d->accept(); });
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(const QHostAddress& address, quint16 port)
+{
+    if (d->server.isListening()) return true;
+    if (!d->server.listen(address, port)) {
+        LOG_ERROR("MetricsServer: Cannot listen on " << address.toString() << ":" << port << ": " << d->server.errorString());
+        return false;
+    }
+    LOG_INFO("MetricsServer: Serving /metrics on " << address.toString() << ":" << d->server.serverPort());
+    return true;
+}
+
+bool MetricsServer::startFromSettings()
+{
+    const int port = Settings::instance().value<int>("Advanced/MetricsPort", 0);
+    if (port <= 0 || port > 65535) return false;
+    const QHostAddress address(Settings::instance().value<QString>("Advanced/MetricsAddress", "127.0.0.1"));
+    if (address.isNull()) {
+        LOG_ERROR("MetricsServer: Advanced/MetricsAddress is not an IP address");
+        return false;
+    }
+    return start(address, quint16(port));
+}
+
+void MetricsServer::stop()
+{
+    d->server.close();
+    const QList<QTcpSocket*> sockets = d->requests.keys();
+    d->requests.clear();
+    for (QTcpSocket* socket : sockets) socket->abort();
+}
+
+bool MetricsServer::isListening() const
+{
+    return d->server.isListening();
+}
+
+quint16 MetricsServer::serverPort() const
+{
+    return d->server.isListening() ? d->server.serverPort() : 0;
+}
+
+QByteArray MetricsServer::exposition() const
+{
+    Exposition out;
+
+    PageCache& pageCache = PageCache::instance();
+    out.gauge("quantilyx_page_cache_bytes", "Bytes held by the page cache, both tiers.", pageCache.currentSizeBytes());
+    out.gauge("quantilyx_page_cache_max_bytes", "Page cache budget in bytes.", pageCache.maxSizeBytes());
+    out.gauge("quantilyx_page_cache_items", "Images in the page cache.", pageCache.itemCount());
+    out.counter("quantilyx_page_cache_hits_total", "Page cache lookups that found an image.", pageCache.hitCount());
+    out.counter("quantilyx_page_cache_misses_total", "Page cache lookups that found nothing.", pageCache.missCount());
+    out.gauge("quantilyx_disk_cache_bytes", "Bytes held by the on-disk page cache.", DiskPageCache::instance().currentSizeBytes());
+
+    const QVariantMap cache = IntelligentCache::instance().statistics();
+    out.gauge("quantilyx_intelligent_cache_bytes", "Bytes held by the intelligent cache.", cache.value("currentSizeBytes").toDouble());
+    out.gauge("quantilyx_intelligent_cache_items", "Items in the intelligent cache.", cache.value("itemCount").toDouble());
+    out.counter("quantilyx_intelligent_cache_hits_total", "Intelligent cache lookups that found an item.", cache.value("hits").toDouble());
+    out.counter("quantilyx_intelligent_cache_misses_total", "Intelligent cache lookups that found nothing.", cache.value("misses").toDouble());
+    out.counter("quantilyx_intelligent_cache_evictions_total", "Items evicted from the intelligent cache.", cache.value("evictions").toDouble());
+
+    RenderThread& render = RenderThread::instance();
+    out.gauge("quantilyx_render_queue_depth", "Render requests waiting for a worker.", render.pendingRequestCount());
+    out.gauge("quantilyx_render_active", "Renders in progress.", render.activeRequestCount());
+    out.gauge("quantilyx_render_workers", "Render worker threads.", render.workerCount());
+    out.histogram("quantilyx_render_duration_seconds", "Time a worker spent on a render.", render.renderLatency());
+
+    writePools(out, "quantilyx_threadpool_threads", "gauge", "Worker threads of a pool.",
+               [](const ThreadPool& pool) { return double(pool.maxThreadCount()); });
+    writePools(out, "quantilyx_threadpool_active_threads", "gauge", "Workers of a pool running a task.",
+               [](const ThreadPool& pool) { return double(pool.activeThreadCount()); });
+    writePools(out, "quantilyx_threadpool_utilization", "gauge", "Share of a pool's workers running a task.",
+               [](const ThreadPool& pool) {
+                   return pool.maxThreadCount() > 0 ? double(pool.activeThreadCount()) / pool.maxThreadCount() : 0.0;
+               });
+    writePools(out, "quantilyx_threadpool_queued_tasks", "gauge", "Tasks waiting in a pool.",
+               [](const ThreadPool& pool) { return double(pool.queuedTaskCount()); });
+    writePools(out, "quantilyx_threadpool_tasks_completed_total", "counter", "Tasks a pool finished or canceled.",
+               [](const ThreadPool& pool) { return double(pool.totalTasksCompleted()); });
+
+    out.histogram("quantilyx_ocr_recognition_seconds", "Backend time per recognized image; the count is images recognized.",
+                  OcrEngine::instance().recognitionLatency());
+
+    FullTextIndex& index = FullTextIndex::instance();
+    out.gauge("quantilyx_search_index_documents", "Documents in the full-text index.", index.documentCount());
+    out.gauge("quantilyx_search_index_terms", "Terms in the full-text index, counted once per segment.", index.termCount());
+    out.histogram("quantilyx_search_query_duration_seconds", "Time to answer a full-text query.", index.queryLatency());
+
+    const QHash<quintptr, qint64> cachedBytes = pageCache.sizeBytesByDocument();
+    out.family("quantilyx_document_cache_bytes", "gauge", "Page cache bytes held for an open document.");
+    QList<Document*> documents;
+    if (Application* application = Application::instance()) documents = application->openDocuments();
+    for (Document* document : qAsConst(documents)) {
+        out.sample("quantilyx_document_cache_bytes", double(cachedBytes.value(reinterpret_cast<quintptr>(document))),
+                   "document=\"" + escapeLabel(document->filePath()) + '"');
+    }
+    out.gauge("quantilyx_open_documents", "Documents open in the application.", documents.size());
+
+    const qint64 resident = residentBytes();
+    if (resident > 0) out.gauge("quantilyx_process_resident_bytes", "Resident memory of the process.", double(resident));
+    return out.text();
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,104 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_METRICSSERVER_H
+#define QUANTILYX_METRICSSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHostAddress>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Serves the application's metrics over HTTP for Prometheus.
+ *
+ * GET /metrics answers in the Prometheus text format with the sizes and
+ * hit counts of the page, disk and intelligent caches, the render queue
+ * and render durations, the utilization of both thread pools, OCR
+ * recognition times (their count gives throughput), the search index size
+ * and query durations, and the cache memory of each open document.
+ * Everything else gets 404. Durations are histograms with the buckets of
+ * LatencyHistogram.
+ *
+ * The server runs on the main thread and collects on each scrape, so
+ * nothing is spent while nobody is scraping. It listens on
+ * Advanced/MetricsAddress (127.0.0.1 by default) at Advanced/MetricsPort,
+ * and is off while the port is 0, the default.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit MetricsServer(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~MetricsServer() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global MetricsServer instance.
+     */
+    static MetricsServer& instance();
+
+    /**
+     * @brief Start listening, unless already listening.
+     * @param address Address to bind.
+     * @param port Port; 0 picks a free one.
+     * @return True if listening.
+     */
+    bool start(const QHostAddress& address, quint16 port);
+
+    /**
+     * @brief Start as configured by Advanced/MetricsAddress and Advanced/MetricsPort.
+     * @return True if listening; false if disabled or the port is taken.
+     */
+    bool startFromSettings();
+
+    /**
+     * @brief Stop listening. Scrapes in progress are dropped.
+     */
+    void stop();
+
+    /**
+     * @brief Check if the server is listening.
+     * @return True if listening.
+     */
+    bool isListening() const;
+
+    /**
+     * @brief Get the port listened on.
+     * @return Port, 0 if not listening.
+     */
+    quint16 serverPort() const;
+
+    /**
+     * @brief Collect the current metrics.
+     * @return Metrics in the Prometheus text exposition format, version 0.0.4.
+     */
+    QByteArray exposition() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static MetricsServer* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_METRICSSERVER_H
@@ -0,0 +1,309 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MinHashIndex.h"
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <limits>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// On-disk layout: FileHeader, then per entry an EntryHeader, the path in
+// UTF-8 and the signature. Native byte order; the index stays on this
+// machine.
+struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 signatureSize;
+    quint32 bands;
+    quint32 shingleWords;
+    quint32 entryCount;
+};
+
+struct EntryHeader {
+    qint64 fileSize;
+    qint64 modified;
+    quint32 pathBytes;
+    quint32 reserved;
+};
+
+const quint32 FileMagic = 0x5158484D; // "QXHM"
+const quint32 FileVersion = 1;
+
+// Band keys added since the table was last sorted that a lookup scans
+// rather than sorts in
+const int MaxUnsortedBands = 4096;
+
+const int RowsPerBand = MinHashIndex::SignatureSize / MinHashIndex::Bands;
+
+quint32 mixHash(quint32 h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+bool isWordPart(QChar c)
+{
+    return c.isLetterOrNumber() || c.isMark() || c.isSurrogate();
+}
+
+} // namespace
+
+MinHashIndex::MinHashIndex()
+    : m_sortedBands(0), m_removed(0), m_modified(false)
+{
+}
+
+MinHashIndex::~MinHashIndex() = default;
+
+MinHashIndex::Signature MinHashIndex::signature(const QString& text)
+{
+    QVector<quint32> words;
+    int start = 0;
+    while (start < text.size()) {
+        if (!isWordPart(text.at(start))) {
+            ++start;
+            continue;
+        }
+        int end = start + 1;
+        while (end < text.size() && isWordPart(text.at(end))) ++end;
+        words.append(qHash(text.mid(start, end - start).toCaseFolded()));
+        start = end;
+    }
+
+    quint32 seeds[SignatureSize];
+    for (int slot = 0; slot < SignatureSize; ++slot) seeds[slot] = mixHash(0x9e3779b9u * quint32(slot + 1));
+
+    Signature result;
+    std::fill(result.values, result.values + SignatureSize, std::numeric_limits<quint32>::max());
+    const int shingleCount = words.isEmpty() ? 0 : qMax(1, words.size() - ShingleWords + 1);
+    for (int i = 0; i < shingleCount; ++i) {
+        quint32 shingle = 0;
+        for (int w = i; w < qMin(words.size(), i + ShingleWords); ++w) shingle = mixHash(shingle ^ words[w]) + 0x9e3779b9u;
+        for (int slot = 0; slot < SignatureSize; ++slot) {
+            result.values[slot] = qMin(result.values[slot], mixHash(shingle ^ seeds[slot]));
+        }
+    }
+    return result;
+}
+
+float MinHashIndex::similarity(const Signature& a, const Signature& b)
+{
+    int equal = 0;
+    for (int slot = 0; slot < SignatureSize; ++slot) equal += a.values[slot] == b.values[slot];
+    return float(equal) / SignatureSize;
+}
+
+quint32 MinHashIndex::bandKey(const Signature& signature, int band)
+{
+    quint32 key = mixHash(quint32(band) + 1);
+    for (int row = band * RowsPerBand; row < (band + 1) * RowsPerBand; ++row) {
+        key = mixHash(key ^ signature.values[row]) + 0x9e3779b9u;
+    }
+    return key;
+}
+
+void MinHashIndex::sortBands() const
+{
+    auto less = [](const BandKey& a, const BandKey& b) {
+        return a.key < b.key || (a.key == b.key && a.entry < b.entry);
+    };
+    std::sort(m_bands.begin() + m_sortedBands, m_bands.end(), less);
+    std::inplace_merge(m_bands.begin(), m_bands.begin() + m_sortedBands, m_bands.end(), less);
+    m_sortedBands = m_bands.size();
+}
+
+bool MinHashIndex::load(const QString& filePath, QString* error)
+{
+    m_entries.clear();
+    m_byPath.clear();
+    m_bands.clear();
+    m_sortedBands = 0;
+    m_removed = 0;
+    m_modified = false;
+
+    QFile file(filePath);
+    if (!file.exists()) return true;
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    FileHeader header;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header)
+        || header.magic != FileMagic || header.version != FileVersion
+        || header.signatureSize != quint32(SignatureSize) || header.bands != quint32(Bands)
+        || header.shingleWords != quint32(ShingleWords)) {
+        if (error) *error = QStringLiteral("not a MinHash index of this version");
+        return false;
+    }
+
+    m_entries.reserve(int(qMin<quint32>(header.entryCount, 1u << 24)));
+    for (quint32 i = 0; i < header.entryCount; ++i) {
+        EntryHeader entryHeader;
+        Entry entry;
+        if (file.read(reinterpret_cast<char*>(&entryHeader), sizeof(entryHeader)) != sizeof(entryHeader)
+            || entryHeader.pathBytes > 1u << 16) {
+            break;
+        }
+        const QByteArray path = file.read(entryHeader.pathBytes);
+        if (path.size() != int(entryHeader.pathBytes)
+            || file.read(reinterpret_cast<char*>(entry.signature.values), sizeof(entry.signature.values)) != sizeof(entry.signature.values)) {
+            break;
+        }
+        entry.filePath = QString::fromUtf8(path);
+        entry.fileSize = entryHeader.fileSize;
+        entry.modified = entryHeader.modified;
+        entry.removed = false;
+        m_byPath.insert(entry.filePath, m_entries.size());
+        m_entries.append(entry);
+    }
+    if (m_entries.size() != int(header.entryCount)) {
+        m_entries.clear();
+        m_byPath.clear();
+        if (error) *error = QStringLiteral("truncated index file");
+        return false;
+    }
+
+    m_bands.reserve(m_entries.size() * Bands);
+    for (int i = 0; i < m_entries.size(); ++i) {
+        for (int band = 0; band < Bands; ++band) m_bands.append({bandKey(m_entries[i].signature, band), quint32(i)});
+    }
+    sortBands();
+    return true;
+}
+
+bool MinHashIndex::save(const QString& filePath, QString* error)
+{
+    // Removed entries are dropped from memory as well as from the file
+    if (m_removed > 0) {
+        QVector<Entry> live;
+        live.reserve(m_entries.size() - m_removed);
+        for (const Entry& entry : m_entries) {
+            if (!entry.removed) live.append(entry);
+        }
+        m_entries.swap(live);
+        m_byPath.clear();
+        m_bands.clear();
+        m_bands.reserve(m_entries.size() * Bands);
+        for (int i = 0; i < m_entries.size(); ++i) {
+            m_byPath.insert(m_entries[i].filePath, i);
+            for (int band = 0; band < Bands; ++band) m_bands.append({bandKey(m_entries[i].signature, band), quint32(i)});
+        }
+        m_sortedBands = 0;
+        m_removed = 0;
+        sortBands();
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    const FileHeader header = {FileMagic, FileVersion, quint32(SignatureSize), quint32(Bands),
+                               quint32(ShingleWords), quint32(m_entries.size())};
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+    for (int i = 0; ok && i < m_entries.size(); ++i) {
+        const Entry& entry = m_entries[i];
+        const QByteArray path = entry.filePath.toUtf8();
+        const EntryHeader entryHeader = {entry.fileSize, entry.modified, quint32(path.size()), 0};
+        ok = file.write(reinterpret_cast<const char*>(&entryHeader), sizeof(entryHeader)) == sizeof(entryHeader)
+             && file.write(path) == path.size()
+             && file.write(reinterpret_cast<const char*>(entry.signature.values), sizeof(entry.signature.values)) == sizeof(entry.signature.values);
+    }
+    if (!ok || !file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    m_modified = false;
+    return true;
+}
+
+void MinHashIndex::insert(const QString& filePath, qint64 fileSize, qint64 modified, const Signature& signature)
+{
+    remove(filePath);
+    const int index = m_entries.size();
+    m_entries.append({filePath, fileSize, modified, signature, false});
+    m_byPath.insert(filePath, index);
+    for (int band = 0; band < Bands; ++band) m_bands.append({bandKey(signature, band), quint32(index)});
+    m_modified = true;
+}
+
+bool MinHashIndex::remove(const QString& filePath)
+{
+    auto it = m_byPath.find(filePath);
+    if (it == m_byPath.end()) return false;
+    // Its band keys stay until the next save and are skipped
+    m_entries[it.value()].removed = true;
+    m_byPath.erase(it);
+    ++m_removed;
+    m_modified = true;
+    return true;
+}
+
+bool MinHashIndex::find(const QString& filePath, qint64 fileSize, qint64 modified, Signature* signature) const
+{
+    const auto it = m_byPath.constFind(filePath);
+    if (it == m_byPath.constEnd()) return false;
+    const Entry& entry = m_entries[it.value()];
+    if (entry.fileSize != fileSize || entry.modified != modified) return false;
+    *signature = entry.signature;
+    return true;
+}
+
+QVector<MinHashIndex::Match> MinHashIndex::similar(const Signature& signature, float threshold, const QString& exclude) const
+{
+    // Sorting waits for a lookup, so inserting many entries sorts once
+    if (m_bands.size() - m_sortedBands > MaxUnsortedBands) sortBands();
+
+    // Entries sharing at least one band are candidates
+    QVector<quint32> candidates;
+    for (int band = 0; band < Bands; ++band) {
+        const quint32 key = bandKey(signature, band);
+        auto at = std::lower_bound(m_bands.constBegin(), m_bands.constBegin() + m_sortedBands, key,
+                                   [](const BandKey& entry, quint32 value) { return entry.key < value; });
+        for (; at != m_bands.constBegin() + m_sortedBands && at->key == key; ++at) candidates.append(at->entry);
+        for (int i = m_sortedBands; i < m_bands.size(); ++i) {
+            if (m_bands[i].key == key) candidates.append(m_bands[i].entry);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    QVector<Match> matches;
+    for (quint32 index : candidates) {
+        const Entry& entry = m_entries[int(index)];
+        if (entry.removed || entry.filePath == exclude) continue;
+        const float score = similarity(signature, entry.signature);
+        if (score >= threshold) matches.append({entry.filePath, score});
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.similarity > b.similarity || (a.similarity == b.similarity && a.filePath < b.filePath);
+    });
+    return matches;
+}
+
+int MinHashIndex::size() const
+{
+    return m_byPath.size();
+}
+
+bool MinHashIndex::isModified() const
+{
+    return m_modified;
+}
+
+} // namespace QuantilyxDoc
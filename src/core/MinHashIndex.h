@@ -0,0 +1,172 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MINHASHINDEX_H
+#define QUANTILYX_MINHASHINDEX_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Finds near-duplicate texts among many by MinHash and LSH banding.
+ *
+ * A text's signature holds, for each of SignatureSize hash seeds, the
+ * smallest hash of its shingles, the runs of ShingleWords case-folded
+ * words; the share of equal slots between two signatures estimates the
+ * Jaccard similarity of their shingle sets. Signatures are cut into Bands
+ * bands, and only texts agreeing on a whole band are compared, which a
+ * pair at similarity 0.8 does with a probability of 95% and a pair at 0.5
+ * with one of 6%. A lookup is a few binary searches into a sorted band
+ * table instead of a pass over the corpus.
+ *
+ * Each entry keeps its file's size and modification time, so a signature
+ * is only recomputed when the file changed. The index is saved to and
+ * loaded from one file and is not thread-safe.
+ */
+class MinHashIndex
+{
+public:
+    /// Hash seeds per signature
+    static const int SignatureSize = 128;
+
+    /// Bands a signature is cut into; SignatureSize / Bands rows each
+    static const int Bands = 16;
+
+    /// Words per shingle
+    static const int ShingleWords = 4;
+
+    /**
+     * @brief A text's MinHash signature.
+     */
+    struct Signature {
+        quint32 values[SignatureSize];
+    };
+
+    /**
+     * @brief A file similar to the one looked up.
+     */
+    struct Match {
+        QString filePath;
+        float similarity;  // Estimated Jaccard similarity of the shingle sets
+    };
+
+    MinHashIndex();
+    ~MinHashIndex();
+
+    /**
+     * @brief Compute the signature of a text.
+     * @param text Text; words are runs of letters and digits.
+     * @return Signature; that of an empty text matches only other empty texts.
+     */
+    static Signature signature(const QString& text);
+
+    /**
+     * @brief Estimate the similarity of two texts from their signatures.
+     * @param a First signature.
+     * @param b Second signature.
+     * @return Share of equal slots, 0.0 to 1.0.
+     */
+    static float similarity(const Signature& a, const Signature& b);
+
+    /**
+     * @brief Replace the entries with those of an index file.
+     * @param filePath Index file.
+     * @param error Receives a description on failure; may be null.
+     * @return False if the file is damaged or in another format; a missing file leaves the index empty and succeeds.
+     */
+    bool load(const QString& filePath, QString* error = nullptr);
+
+    /**
+     * @brief Write the entries to an index file, through QSaveFile.
+     * @param filePath Index file.
+     * @param error Receives a description on failure; may be null.
+     * @return True if the file is on disk.
+     */
+    bool save(const QString& filePath, QString* error = nullptr);
+
+    /**
+     * @brief Add a file's signature, replacing any earlier one.
+     * @param filePath File the signature is of.
+     * @param fileSize Size of the file.
+     * @param modified Modification time of the file, in milliseconds since the epoch.
+     * @param signature Signature of its text.
+     */
+    void insert(const QString& filePath, qint64 fileSize, qint64 modified, const Signature& signature);
+
+    /**
+     * @brief Drop a file's signature.
+     * @param filePath File to drop.
+     * @return True if it was indexed.
+     */
+    bool remove(const QString& filePath);
+
+    /**
+     * @brief Get a file's signature if the file has not changed since it was indexed.
+     * @param filePath File to look up.
+     * @param fileSize Current size of the file.
+     * @param modified Current modification time of the file.
+     * @param signature Receives the signature.
+     * @return False if the file is not indexed or has changed.
+     */
+    bool find(const QString& filePath, qint64 fileSize, qint64 modified, Signature* signature) const;
+
+    /**
+     * @brief Find the indexed files similar to a signature.
+     * @param signature Signature to look up.
+     * @param threshold Lowest estimated similarity returned.
+     * @param exclude File left out of the results, e.g. the one looked up.
+     * @return Matches, most similar first.
+     */
+    QVector<Match> similar(const Signature& signature, float threshold, const QString& exclude = QString()) const;
+
+    /**
+     * @brief Get the number of indexed files.
+     * @return File count.
+     */
+    int size() const;
+
+    /**
+     * @brief Check whether entries changed since the last load() or save().
+     * @return True if there is something to save.
+     */
+    bool isModified() const;
+
+private:
+    struct Entry {
+        QString filePath;
+        qint64 fileSize;
+        qint64 modified;
+        Signature signature;
+        bool removed;
+    };
+
+    // One band of one entry; sorted by key, then entry
+    struct BandKey {
+        quint32 key;
+        quint32 entry;
+    };
+
+    static quint32 bandKey(const Signature& signature, int band);
+    void sortBands() const;
+
+    QVector<Entry> m_entries;
+    QHash<QString, int> m_byPath;
+    mutable QVector<BandKey> m_bands;
+    mutable int m_sortedBands; // Leading entries of m_bands in order
+    int m_removed;
+    bool m_modified;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MINHASHINDEX_H
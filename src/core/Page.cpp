@@ -127,11 +127,60 @@ PageRenderer* Page::renderer() const
     return d->renderer;
 }
 
+QImage Page::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    QSizeF pageSize = size();
+    if (rect.isEmpty() || pageSize.isEmpty() || width <= 0 || height <= 0) return QImage();
+
+    qreal scaleX = width / rect.width();
+    qreal scaleY = height / rect.height();
+    QImage fullPage = render(qRound(pageSize.width() * scaleX), qRound(pageSize.height() * scaleY), dpi);
+    if (fullPage.isNull()) return QImage();
+
+    QRect cropRect(qRound(rect.left() * scaleX), qRound(rect.top() * scaleY), width, height);
+    return fullPage.copy(cropRect);
+}
+
+QImage Page::renderFitted(int width, int height, int dpi)
+{
+    const QSizeF pageSize = size();
+    if (pageSize.isEmpty() || width <= 0 || height <= 0) return QImage();
+
+    const QSize target = pageSize.scaled(QSizeF(width, height), Qt::KeepAspectRatio).toSize().expandedTo(QSize(1, 1));
+    return renderRectangle(QRectF(QPointF(0, 0), pageSize), target.width(), target.height(), dpi);
+}
+
+bool Page::rendersRegionsDirectly() const
+{
+    return false;
+}
+
+QImage Page::renderDraft(const QRectF& rect, int width, int height)
+{
+    return rect.isEmpty() ? render(width, height) : renderRectangle(rect, width, height);
+}
+
+QByteArray Page::contentDigest() const
+{
+    return QByteArray();
+}
+
+bool Page::isBlank() const
+{
+    return false;
+}
+
 QString Page::text() const
 {
     return QString();
 }
 
+QString Page::textInRegion(const QRectF& region) const
+{
+    // Without a text layout only a whole-page region can be answered
+    return region.contains(QRectF(QPointF(0, 0), size())) ? text() : QString();
+}
+
 QList<QRectF> Page::searchText(const QString& text, bool caseSensitive, bool wholeWords) const
 {
     Q_UNUSED(text);
@@ -140,6 +189,12 @@ QList<QRectF> Page::searchText(const QString& text, bool caseSensitive, bool who
     return QList<QRectF>();
 }
 
+void Page::findText(const QString& text, bool caseSensitive, bool wholeWords, ArenaVector<QRectF>& hits) const
+{
+    const QList<QRectF> found = searchText(text, caseSensitive, wholeWords);
+    hits.insert(hits.end(), found.begin(), found.end());
+}
+
 QObject* Page::hitTest(const QPointF& position) const
 {
     Q_UNUSED(position);
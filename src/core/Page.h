@@ -15,6 +15,7 @@
 #include <QRectF>
 #include <QImage>
 #include <QList>
+#include "Arena.h"
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -146,12 +147,66 @@ public:
      * @return Rendered image
      */
     virtual QImage render(int width, int height, int dpi = 72) = 0;
+
+    /**
+     * @brief Render part of the page to an image
+     * The default implementation renders the whole page at the implied scale
+     * and crops; formats that can rasterize a region directly should override.
+     * @param rect Region to render, in page points with a top-left origin
+     * @param width Target width in pixels for the region
+     * @param height Target height in pixels for the region
+     * @param dpi DPI for rendering
+     * @return Rendered image of the region
+     */
+    virtual QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72);
+
+    /**
+     * @brief Check if renderRectangle() rasterizes only the requested region
+     * When false, region renders cost as much as a full-page render, so
+     * callers should not split pages into tiles or bands to save time.
+     * @return true if regions are rendered directly
+     */
+    virtual bool rendersRegionsDirectly() const;
+
+    /**
+     * @brief Render a fast, lower-fidelity preview of the page
+     * Used for the first pass of a progressive render. The default renders
+     * at full quality; formats with costly antialiasing should override.
+     * @param rect Region to render in page points, or an empty rect for the whole page
+     * @param width Target width in pixels
+     * @param height Target height in pixels
+     * @return Rendered preview image
+     */
+    virtual QImage renderDraft(const QRectF& rect, int width, int height);
+
+    /**
+     * @brief Get a digest of everything the page's rendering depends on
+     * Pages with equal digests render identically, in any document, so
+     * PageCache shares one rendering between them. The default has none.
+     * @return Digest, or an empty array if the page cannot be content-addressed
+     */
+    virtual QByteArray contentDigest() const;
+
+    /**
+     * @brief Check if the page is known to draw nothing on its white background
+     * Blank pages are filled with white instead of rendered. The default
+     * knows of none.
+     * @return true for a blank page
+     */
+    virtual bool isBlank() const;
     
     /**
      * @brief Get text content of page
      * @return Text content
      */
     virtual QString text() const;
+
+    /**
+     * @brief Get the text inside a region of the page
+     * @param region Region in page coordinates
+     * @return Text of the runs touching the region, in reading order
+     */
+    virtual QString textInRegion(const QRectF& region) const;
     
     /**
      * @brief Search for text on page
@@ -163,6 +218,20 @@ public:
     virtual QList<QRectF> searchText(const QString& text, 
                                    bool caseSensitive = false,
                                    bool wholeWords = false) const;
+
+    /**
+     * @brief Search for text on page, appending the hits to a caller's buffer
+     * The search path of DocumentSearch: hits go to per-request arena
+     * storage and are copied into a QList only for pages that have any.
+     * The default appends searchText(); formats with a text layout should
+     * override this and have searchText() call it.
+     * @param text Text to search
+     * @param caseSensitive Case sensitive search
+     * @param wholeWords Whole words only
+     * @param hits Receives the text rectangles where text was found
+     */
+    virtual void findText(const QString& text, bool caseSensitive, bool wholeWords,
+                          ArenaVector<QRectF>& hits) const;
     
     /**
      * @brief Hit test - find object at position
@@ -206,6 +275,18 @@ protected:
      * @param parent Parent object
      */
     explicit Page(Document* document, QObject* parent = nullptr);
+
+    /**
+     * @brief Render the whole page through renderRectangle()
+     * The page is fitted in the width x height box, keeping its aspect
+     * ratio, as render() is expected to. Formats that rasterize regions
+     * directly implement render() with this.
+     * @param width Box width in pixels
+     * @param height Box height in pixels
+     * @param dpi DPI for rendering
+     * @return Rendered page, or a null image
+     */
+    QImage renderFitted(int width, int height, int dpi);
     
     /**
      * @brief Set page number
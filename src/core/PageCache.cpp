@@ -1,7 +1,7 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
@@ -10,50 +10,535 @@
 #include "PageCache.h"
 #include "Page.h"
 #include "Document.h"
+#include "ColorTransform.h"
+#include "DiskPageCache.h"
+#include "ImageBufferPool.h"
+#include "ImageCodec.h"
+#include "MemoryBudget.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
 #include <QMutex>
 #include <QMutexLocker>
 #include <QImage>
+#include <QDateTime>
+#include <QCoreApplication>
 #include <QDebug>
-#include <QFileInfo>
-#include <algorithm> // For std::find_if
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Define the QHash specialization outside the namespace
 uint qHash(const QuantilyxDoc::PageCache::CacheKey& key, uint seed)
 {
-    return QuantilyxDoc::PageCache::CacheKeyHash{}(key);
+    return static_cast<uint>(QuantilyxDoc::PageCache::CacheKeyHash{}(key)) ^ seed;
 }
 
 namespace QuantilyxDoc {
 
 class PageCache::Private {
 public:
-    Private()
-        : maxSizeBytes(50 * 1024 * 1024) // Default 50 MB
-        , currentSizeBytes(0) {}
-
-    mutable QMutex mutex; // Protect access to cache maps
-    QHash<CacheKey, CachedItem, CacheKeyHash> cacheMap;
-    QQueue<CacheKey> lruQueue; // Tracks access order
-    qint64 maxSizeBytes;
-    qint64 currentSizeBytes;
-
-    // Helper to remove an item from the cache and update size
-    void removeItem(const CacheKey& key) {
-        auto it = cacheMap.find(key);
-        if (it != cacheMap.end()) {
-            currentSizeBytes -= calculateImageSizeBytes(it->image);
+    // Recency list: front = least recently used, back = most recently used.
+    using LruList = std::list<CacheKey>;
+
+    // Each map entry remembers its position in the recency list so that
+    // touching or removing it never requires a scan.
+    struct Entry {
+        CachedItem item;
+        qint64 sizeBytes;
+        LruList::iterator lruPos;
+    };
+
+    // A cold entry: an image demoted from the hot tier and kept compressed
+    struct ColdEntry {
+        ImageCodec::Encoded encoded;
+        qint64 sizeBytes;
+        LruList::iterator lruPos;
+        bool promoting = false; // A promotion to the hot tier is scheduled
+    };
+
+    using EntryMap = std::unordered_map<CacheKey, Entry, CacheKeyHash>;
+    using ColdMap = std::unordered_map<CacheKey, ColdEntry, CacheKeyHash>;
+
+    // Images leaving a tier, processed once every shard lock has been released
+    using EvictedList = std::vector<std::pair<CacheKey, QImage>>;
+    using DroppedList = std::vector<std::pair<CacheKey, ImageCodec::Encoded>>;
+
+    // Byte accounting shared by all shards. Hot bitmaps may use at most
+    // half of the budget; compressed entries fill the remainder.
+    struct Budget {
+        static constexpr qint64 HotShareDivisor = 2;
+
+        Budget() : maxSizeBytes(50 * 1024 * 1024), totalSizeBytes(0), hotSizeBytes(0) {} // Default 50 MB
+
+        std::atomic<qint64> maxSizeBytes;
+        std::atomic<qint64> totalSizeBytes; // hot + cold
+        std::atomic<qint64> hotSizeBytes;
+
+        bool overLimit() const { return totalSizeBytes.load() > maxSizeBytes.load(); }
+        bool hotOverShare() const { return hotSizeBytes.load() > maxSizeBytes.load() / HotShareDivisor; }
+    };
+
+    // Which renderings of each page have tiles cached, in either tier. Keys
+    // of one page are spread over all shards, so this has its own lock,
+    // always taken after a shard lock and never the other way round.
+    struct ZoomIndex {
+        struct PageRef {
+            quintptr documentId;
+            int pageIndex;
+            int rotation;
+
+            bool operator<(const PageRef& other) const {
+                return std::tie(documentId, pageIndex, rotation) <
+                       std::tie(other.documentId, other.pageIndex, other.rotation);
+            }
+        };
+
+        struct Rendering {
+            qreal zoomLevel;
+            QSize targetSize;
+            int tileCount;
+        };
+
+        QMutex mutex;
+        std::map<PageRef, std::vector<Rendering>> pages;
+
+        static PageRef pageOf(const CacheKey& key) {
+            return PageRef{key.documentId, key.pageIndex, key.rotation};
+        }
+
+        void added(const CacheKey& key) {
+            if (key.tileX < 0 || key.colorTransform != 0) return; // Transformed copies follow their rendering
+            QMutexLocker locker(&mutex);
+            std::vector<Rendering>& renderings = pages[pageOf(key)];
+            for (Rendering& rendering : renderings) {
+                if (rendering.targetSize == key.targetSize) {
+                    ++rendering.tileCount;
+                    return;
+                }
+            }
+            renderings.push_back(Rendering{key.zoomLevel, key.targetSize, 1});
+        }
+
+        void removed(const CacheKey& key) {
+            if (key.tileX < 0 || key.colorTransform != 0) return; // Transformed copies follow their rendering
+            QMutexLocker locker(&mutex);
+            auto pageIt = pages.find(pageOf(key));
+            if (pageIt == pages.end()) return;
+            std::vector<Rendering>& renderings = pageIt->second;
+            for (auto it = renderings.begin(); it != renderings.end(); ++it) {
+                if (it->targetSize == key.targetSize) {
+                    if (--it->tileCount <= 0) renderings.erase(it);
+                    break;
+                }
+            }
+            if (renderings.empty()) pages.erase(pageIt);
+        }
+
+        void clear() {
+            QMutexLocker locker(&mutex);
+            pages.clear();
+        }
+    };
+
+    // Renderings by page content (see Page::contentDigest()), so identical
+    // pages of any document share one image. It is cached under the key of
+    // the page first rendered, its owner; the keys of the others are aliases
+    // that resolve to it and hold no memory. Owners are forgotten when their
+    // image leaves memory, aliases lazily when their owner turns out gone.
+    // Own lock, never held together with a shard lock.
+    struct ContentIndex {
+        using KeyMap = std::unordered_map<CacheKey, CacheKey, CacheKeyHash>;
+
+        QMutex mutex;
+        QHash<QByteArray, CacheKey> owners; // Content key -> owner
+        std::unordered_map<CacheKey, QByteArray, CacheKeyHash> contentOf; // Owner -> content key
+        KeyMap aliases; // Key of an identical page -> owner
+
+        // The digest plus every render parameter of the key but the page
+        static QByteArray contentKey(const CacheKey& key, const QByteArray& digest) {
+            return digest + ':' + QByteArray::number(zoomBucket(key.zoomLevel)) + ',' +
+                   QByteArray::number(key.rotation) + ',' + QByteArray::number(key.targetSize.width()) + 'x' +
+                   QByteArray::number(key.targetSize.height()) + ',' + QByteArray::number(key.tileX) + ',' +
+                   QByteArray::number(key.tileY);
+        }
+
+        void removeOwnerLocked(const CacheKey& key) {
+            auto it = contentOf.find(key);
+            if (it == contentOf.end()) return;
+            auto owner = owners.find(it->second);
+            if (owner != owners.end() && owner.value() == key) owners.erase(owner);
+            contentOf.erase(it);
+        }
+
+        void addOwner(const CacheKey& key, const QByteArray& digest) {
+            const QByteArray content = contentKey(key, digest);
+            QMutexLocker locker(&mutex);
+            aliases.erase(key);
+            removeOwnerLocked(key);
+            owners.insert(content, key);
+            contentOf.emplace(key, content);
+        }
+
+        bool findOwner(const CacheKey& key, const QByteArray& digest, CacheKey* owner) {
+            const QByteArray content = contentKey(key, digest);
+            QMutexLocker locker(&mutex);
+            auto it = owners.constFind(content);
+            if (it == owners.constEnd()) return false;
+            *owner = it.value();
+            return true;
+        }
+
+        void addAlias(const CacheKey& key, const CacheKey& owner) {
+            QMutexLocker locker(&mutex);
+            removeOwnerLocked(key);
+            aliases[key] = owner;
+        }
+
+        bool aliasOf(const CacheKey& key, CacheKey* owner) {
+            QMutexLocker locker(&mutex);
+            if (aliases.empty()) return false;
+            auto it = aliases.find(key);
+            if (it == aliases.end()) return false;
+            *owner = it->second;
+            return true;
+        }
+
+        void removeAlias(const CacheKey& key) {
+            QMutexLocker locker(&mutex);
+            aliases.erase(key);
+        }
+
+        void removeOwner(const CacheKey& key) {
+            QMutexLocker locker(&mutex);
+            removeOwnerLocked(key);
+        }
+
+        // Document IDs may be reused, so nothing may point at a cleared document
+        void forgetDocument(quintptr documentId) {
+            QMutexLocker locker(&mutex);
+            for (auto it = contentOf.begin(); it != contentOf.end();) {
+                if (it->first.documentId == documentId) {
+                    owners.remove(it->second);
+                    it = contentOf.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for (auto it = aliases.begin(); it != aliases.end();) {
+                if (it->first.documentId == documentId || it->second.documentId == documentId) it = aliases.erase(it);
+                else ++it;
+            }
+        }
+
+        void clear() {
+            QMutexLocker locker(&mutex);
+            owners.clear();
+            contentOf.clear();
+            aliases.clear();
+        }
+    };
+
+    // One independently locked slice of the cache. A key always lands in the
+    // same shard, so LRU order is exact within a shard and approximate overall.
+    struct Shard {
+        Shard() : zoomIndex(nullptr) {}
+
+        mutable QMutex mutex;
+        EntryMap cacheMap;
+        LruList lruList;
+        ColdMap coldMap;
+        LruList coldList;
+        // Changed under the mutex, read by totals() without it
+        std::atomic<qint64> currentSizeBytes{0}; // hot + cold
+        std::atomic<qint64> itemCount{0};        // hot + cold
+        ZoomIndex* zoomIndex;
+
+        // Helper to mark an entry as most recently used (O(1))
+        void touch(Entry& entry) {
+            lruList.splice(lruList.end(), lruList, entry.lruPos);
+        }
+
+        // Helper to add an image at the hot MRU end; the key must not be hot
+        void insertHotLocked(const CacheKey& key, const QImage& image, qint64 sizeBytes, Budget& budget) {
+            Entry entry;
+            entry.item.image = image;
+            entry.item.accessCount = 1;
+            entry.item.timestamp = QDateTime::currentMSecsSinceEpoch();
+            entry.sizeBytes = sizeBytes;
+            entry.lruPos = lruList.insert(lruList.end(), key);
+            cacheMap.emplace(key, std::move(entry));
+            ++itemCount;
+            currentSizeBytes += sizeBytes;
+            budget.totalSizeBytes += sizeBytes;
+            budget.hotSizeBytes += sizeBytes;
+            zoomIndex->added(key);
+        }
+
+        // Helper to remove a hot item from the shard and update sizes (O(1))
+        void removeItem(EntryMap::iterator it, Budget& budget) {
+            currentSizeBytes -= it->second.sizeBytes;
+            budget.totalSizeBytes -= it->second.sizeBytes;
+            budget.hotSizeBytes -= it->second.sizeBytes;
+            lruList.erase(it->second.lruPos);
+            zoomIndex->removed(it->first);
             cacheMap.erase(it);
-            
-            // Remove from LRU queue
-            lruQueue.removeAll(key);
+            --itemCount;
+        }
+
+        // Helper to remove a cold item from the shard and update sizes (O(1))
+        void removeColdItem(ColdMap::iterator it, Budget& budget) {
+            currentSizeBytes -= it->second.sizeBytes;
+            budget.totalSizeBytes -= it->second.sizeBytes;
+            coldList.erase(it->second.lruPos);
+            zoomIndex->removed(it->first);
+            coldMap.erase(it);
+            --itemCount;
+        }
+
+        // Helper to move this shard's hot LRU tail out while the hot tier is
+        // over its share, leaving at least keepCount entries. The shard that
+        // just received a put keeps its newest entry so a single page image
+        // larger than the budget is still usable. Caller holds the shard mutex.
+        void demoteLocked(Budget& budget, size_t keepCount, EvictedList* demoted) {
+            while (budget.hotOverShare() && lruList.size() > keepCount) {
+                auto it = cacheMap.find(lruList.front());
+                if (it == cacheMap.end()) {
+                    // Should not happen: list and map are kept in lockstep
+                    lruList.pop_front();
+                    continue;
+                }
+                demoted->emplace_back(it->first, it->second.item.image);
+                removeItem(it, budget);
+            }
+        }
+
+        // Helper to add a freshly compressed image at the cold MRU end.
+        // Skipped if the image was put back into the hot tier meanwhile.
+        void insertColdLocked(const CacheKey& key, ImageCodec::Encoded&& encoded, Budget& budget) {
+            if (cacheMap.find(key) != cacheMap.end()) return;
+            auto existing = coldMap.find(key);
+            if (existing != coldMap.end()) {
+                removeColdItem(existing, budget);
+            }
+            ColdEntry entry;
+            entry.sizeBytes = encoded.sizeBytes();
+            entry.encoded = std::move(encoded);
+            entry.lruPos = coldList.insert(coldList.end(), key);
+            currentSizeBytes += entry.sizeBytes;
+            budget.totalSizeBytes += entry.sizeBytes;
+            coldMap.emplace(key, std::move(entry));
+            ++itemCount;
+            zoomIndex->added(key);
+        }
+
+        // Helper to drop this shard's cold LRU tail while the cache as a
+        // whole is above targetBytes. Caller holds the shard mutex.
+        void dropColdLocked(Budget& budget, qint64 targetBytes, DroppedList* dropped) {
+            while (budget.totalSizeBytes.load() > targetBytes && !coldList.empty()) {
+                auto it = coldMap.find(coldList.front());
+                if (it == coldMap.end()) {
+                    coldList.pop_front();
+                    continue;
+                }
+                dropped->emplace_back(it->first, it->second.encoded);
+                removeColdItem(it, budget);
+            }
+        }
+
+        // Helper to drop this shard's hot LRU tail without compressing it,
+        // while the cache as a whole is above targetBytes. Used when memory
+        // must actually be given back. Caller holds the shard mutex.
+        void dropHotLocked(Budget& budget, qint64 targetBytes, EvictedList* evicted) {
+            while (budget.totalSizeBytes.load() > targetBytes && !lruList.empty()) {
+                auto it = cacheMap.find(lruList.front());
+                if (it == cacheMap.end()) {
+                    lruList.pop_front();
+                    continue;
+                }
+                evicted->emplace_back(it->first, it->second.item.image);
+                removeItem(it, budget);
+            }
+        }
+
+        // Helper to drop one document's least recently used entries, cold
+        // ones before hot, until `bytes` are freed. Walks the LRU lists, so
+        // it is for the budget check rather than paint paths. Caller holds
+        // the shard mutex. Returns the bytes freed.
+        qint64 dropDocumentLocked(quintptr documentId, qint64 bytes, Budget& budget,
+                                  DroppedList* dropped, EvictedList* evicted) {
+            qint64 freed = 0;
+            for (auto pos = coldList.begin(); pos != coldList.end() && freed < bytes;) {
+                const auto current = pos++;
+                if (current->documentId != documentId) continue;
+                auto it = coldMap.find(*current);
+                if (it == coldMap.end()) continue;
+                freed += it->second.sizeBytes;
+                dropped->emplace_back(it->first, it->second.encoded);
+                removeColdItem(it, budget);
+            }
+            for (auto pos = lruList.begin(); pos != lruList.end() && freed < bytes;) {
+                const auto current = pos++;
+                if (current->documentId != documentId) continue;
+                auto it = cacheMap.find(*current);
+                if (it == cacheMap.end()) continue;
+                freed += it->second.sizeBytes;
+                evicted->emplace_back(it->first, it->second.item.image);
+                removeItem(it, budget);
+            }
+            return freed;
+        }
+    };
+
+    // Power of two so shard selection is a mask of the key hash
+    static constexpr int ShardCount = 16;
+
+    Private() {
+        for (Shard& shard : shards) {
+            shard.zoomIndex = &zoomIndex;
+        }
+    }
+
+    Budget budget;
+    ZoomIndex zoomIndex;
+    ContentIndex contentIndex;
+    std::array<Shard, ShardCount> shards;
+    int memoryConsumerId = 0;
+    std::atomic<quint64> hits{0};     // get() calls answered, from either tier
+    std::atomic<quint64> misses{0};
+
+    // CacheKeyHash is a plain xor of the key fields, so mix it before taking
+    // the low bits; otherwise neighbouring pages of one document would cluster.
+    static int shardIndex(const CacheKey& key) {
+        quint64 h = static_cast<quint64>(CacheKeyHash{}(key));
+        h ^= h >> 33;
+        h *= Q_UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 33;
+        return static_cast<int>(h & (ShardCount - 1));
+    }
+
+    Shard& shardFor(const CacheKey& key) {
+        return shards[shardIndex(key)];
+    }
+
+    const Shard& shardFor(const CacheKey& key) const {
+        return shards[shardIndex(key)];
+    }
+
+    // Bring both tiers back within budget: demote hot LRU tails into the
+    // compressed tier, then drop compressed LRU tails to the disk tier.
+    // Compression runs with no lock held. protectedShard (if any) keeps its
+    // most recently used hot entry.
+    void enforceBudget(const Shard* protectedShard = nullptr) {
+        EvictedList demoted;
+        for (Shard& shard : shards) {
+            if (!budget.hotOverShare()) break;
+            QMutexLocker locker(&shard.mutex);
+            shard.demoteLocked(budget, &shard == protectedShard ? 1 : 0, &demoted);
+        }
+
+        for (auto& item : demoted) {
+            ImageCodec::Encoded encoded = ImageCodec::encode(item.second);
+            if (encoded.isNull()) continue;
+            Shard& shard = shardFor(item.first);
+            QMutexLocker locker(&shard.mutex);
+            shard.insertColdLocked(item.first, std::move(encoded), budget);
+        }
+
+        DroppedList dropped;
+        for (Shard& shard : shards) {
+            if (!budget.overLimit()) break;
+            QMutexLocker locker(&shard.mutex);
+            shard.dropColdLocked(budget, budget.maxSizeBytes.load(), &dropped);
+        }
+        spillToDisk(dropped, EvictedList());
+    }
+
+    // Give memory back to the system: drop compressed entries first, then
+    // hot ones, all to the disk tier. Returns the bytes freed.
+    qint64 shrinkBy(qint64 bytes) {
+        const qint64 before = budget.totalSizeBytes.load();
+        const qint64 target = qMax<qint64>(0, before - bytes);
+
+        DroppedList dropped;
+        for (Shard& shard : shards) {
+            if (budget.totalSizeBytes.load() <= target) break;
+            QMutexLocker locker(&shard.mutex);
+            shard.dropColdLocked(budget, target, &dropped);
+        }
+        EvictedList evicted;
+        for (Shard& shard : shards) {
+            if (budget.totalSizeBytes.load() <= target) break;
+            QMutexLocker locker(&shard.mutex);
+            shard.dropHotLocked(budget, target, &evicted);
         }
+        spillToDisk(dropped, evicted);
+        return qMax<qint64>(0, before - budget.totalSizeBytes.load());
+    }
+
+    // Give back memory held for one document only, shard by shard until
+    // enough is freed. Returns the bytes freed.
+    qint64 shrinkDocumentBy(quintptr documentId, qint64 bytes) {
+        DroppedList dropped;
+        EvictedList evicted;
+        qint64 freed = 0;
+        for (Shard& shard : shards) {
+            if (freed >= bytes) break;
+            QMutexLocker locker(&shard.mutex);
+            freed += shard.dropDocumentLocked(documentId, bytes - freed, budget, &dropped, &evicted);
+        }
+        spillToDisk(dropped, evicted);
+        return freed;
+    }
+
+    // Helper to demote dropped images to the disk tier instead of losing them.
+    // Images on disk cannot be shared, so their owners are forgotten.
+    void spillToDisk(const DroppedList& dropped, const EvictedList& evicted) {
+        if (dropped.empty() && evicted.empty()) return;
+        DiskPageCache& disk = DiskPageCache::instance();
+        // Transformed tiles are cheaper to recreate from the rendered ones than to read back
+        for (const auto& item : dropped) {
+            if (item.first.colorTransform != 0) continue;
+            disk.store(item.first, item.second);
+            contentIndex.removeOwner(item.first);
+        }
+        for (const auto& item : evicted) {
+            if (item.first.colorTransform != 0) continue;
+            disk.store(item.first, item.second);
+            contentIndex.removeOwner(item.first);
+        }
+    }
+
+    // Aggregate statistics from the shards' counters without taking their
+    // locks; changes in flight on other threads may or may not be counted
+    void totals(qint64* sizeBytes, int* count) const {
+        qint64 size = 0;
+        qint64 items = 0;
+        for (const Shard& shard : shards) {
+            size += shard.currentSizeBytes.load(std::memory_order_relaxed);
+            items += shard.itemCount.load(std::memory_order_relaxed);
+        }
+        if (sizeBytes) *sizeBytes = size;
+        if (count) *count = static_cast<int>(items);
+    }
+
+    // Helper to check if images of a format are cached as they are
+    static bool isStoredFormat(QImage::Format format) {
+        return format == ImageBufferPool::PipelineFormat || format == QImage::Format_Grayscale8 ||
+               format == QImage::Format_Mono;
     }
 
     // Helper to calculate image size in bytes
     static qint64 calculateImageSizeBytes(const QImage& image) {
         if (image.isNull()) return 0;
-        // Size = width * height * bytesPerPixel (format-dependent)
-        return static_cast<qint64>(image.width()) * image.height() * (image.depth() / 8);
+        // Use the real buffer size so padded scanlines and sub-byte formats are accounted for
+        return static_cast<qint64>(image.sizeInBytes());
     }
 };
 
@@ -76,132 +561,398 @@ PageCache::PageCache(QObject* parent)
     if (qApp) {
         qRegisterMetaType<CacheKey>("QuantilyxDoc::PageCache::CacheKey");
     }
+
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "PageCache", MemoryBudget::Priority::Normal,
+        [this]() { return currentSizeBytes(); },
+        [this](qint64 bytes) { return releaseMemory(bytes); });
+    MemoryBudget::instance().setDocumentAccounting(d->memoryConsumerId,
+        [this]() { return sizeBytesByDocument(); },
+        [this](quintptr documentId, qint64 bytes) { return releaseMemoryForDocument(documentId, bytes); });
 }
 
 PageCache::~PageCache()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     clear(); // Ensure cache is cleared properly
 }
 
 QImage PageCache::get(const CacheKey& key)
 {
-    QMutexLocker locker(&d->mutex);
-    auto it = d->cacheMap.find(key);
-    if (it != d->cacheMap.end()) {
+    TRACE_ZONE("PageCache::get");
+    Private::Shard& shard = d->shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    auto it = shard.cacheMap.find(key);
+    if (it != shard.cacheMap.end()) {
         // Update access count and timestamp for LRU
-        it->accessCount++;
-        it->timestamp = QDateTime::currentMSecsSinceEpoch();
-        // Move key to end of LRU queue (most recently used)
-        d->lruQueue.removeAll(key);
-        d->lruQueue.enqueue(key);
-        return it->image;
+        it->second.item.accessCount++;
+        it->second.item.timestamp = QDateTime::currentMSecsSinceEpoch();
+        shard.touch(it->second);
+        d->hits.fetch_add(1, std::memory_order_relaxed);
+        return it->second.item.image;
+    }
+
+    // A compressed hit: decompress without the lock and answer with the
+    // image; moving it back to the hot tier, and compressing what that
+    // pushes out, is left to the pool so the paint path does neither
+    auto coldIt = shard.coldMap.find(key);
+    if (coldIt == shard.coldMap.end()) {
+        locker.unlock();
+        // A page identical to another is shown through that page's images
+        CacheKey renderedKey = key;
+        renderedKey.colorTransform = 0;
+        CacheKey owner;
+        if (d->contentIndex.aliasOf(renderedKey, &owner)) {
+            owner.colorTransform = key.colorTransform;
+            const QImage image = get(owner); // Counts the hit or miss
+            if (image.isNull() && key.colorTransform == 0) d->contentIndex.removeAlias(key);
+            return image;
+        }
+        if (key.colorTransform != 0) {
+            return transformRendered(key);
+        }
+        d->misses.fetch_add(1, std::memory_order_relaxed);
+        return QImage(); // Return null image if not found
+    }
+    d->hits.fetch_add(1, std::memory_order_relaxed);
+    const ImageCodec::Encoded encoded = coldIt->second.encoded; // Shared, not copied
+    const bool schedule = !coldIt->second.promoting;
+    coldIt->second.promoting = true;
+    locker.unlock();
+
+    const QImage image = ImageCodec::decode(encoded);
+    if (schedule) {
+        ThreadPool::instance().submitDetached([this, key, image]() { promote(key, image); }, Task::Priority::Low);
     }
-    return QImage(); // Return null image if not found
+    return image;
 }
 
-void PageCache::put(const CacheKey& key, const QImage& image)
+void PageCache::promote(const CacheKey& key, const QImage& image)
 {
-    QMutexLocker locker(&d->mutex);
+    Private::Shard& shard = d->shardFor(key);
+    {
+        QMutexLocker locker(&shard.mutex);
+        auto coldIt = shard.coldMap.find(key);
+        // Dropped, or superseded by a put() meanwhile
+        if (coldIt == shard.coldMap.end() || shard.cacheMap.find(key) != shard.cacheMap.end()) return;
+        if (image.isNull()) {
+            coldIt->second.promoting = false; // Undecodable; the next hit tries again
+            return;
+        }
+        shard.removeColdItem(coldIt, d->budget);
+        shard.insertHotLocked(key, image, calculateImageSizeBytes(image), d->budget);
+    }
+    if (d->budget.hotOverShare() || d->budget.overLimit()) {
+        d->enforceBudget(&shard);
+    }
+
+    qint64 totalSize = 0;
+    int totalCount = 0;
+    d->totals(&totalSize, &totalCount);
+    emit statisticsChanged(totalSize, totalCount);
+}
+
+void PageCache::put(const CacheKey& key, const QImage& source, const QByteArray& contentDigest)
+{
+    TRACE_ZONE("PageCache::put");
+    // Renderers already hand over PipelineFormat or a compact scan; anything
+    // else is converted once here rather than on every paint
+    const QImage image = Private::isStoredFormat(source.format()) ? source : ImageBufferPool::toPipelineFormat(source);
 
     // Calculate size of new image
     qint64 imageSize = calculateImageSizeBytes(image);
     if (imageSize == 0) return; // Don't cache null images
 
-    // Check if item already exists
-    auto existingIt = d->cacheMap.find(key);
-    if (existingIt != d->cacheMap.end()) {
-        // Replace existing item and adjust size accordingly
-        qint64 oldSize = calculateImageSizeBytes(existingIt->image);
-        d->currentSizeBytes += (imageSize - oldSize);
-        existingIt->image = image;
-        existingIt->accessCount = 1;
-        existingIt->timestamp = QDateTime::currentMSecsSinceEpoch();
-        // Update LRU queue: remove old, add new
-        d->lruQueue.removeAll(key);
-        d->lruQueue.enqueue(key);
-    } else {
-        // Add new item
-        CachedItem item;
-        item.image = image;
-        item.accessCount = 1;
-        item.timestamp = QDateTime::currentMSecsSinceEpoch();
-        d->cacheMap.insert(key, item);
-        d->currentSizeBytes += imageSize;
-        d->lruQueue.enqueue(key);
+    Private::Shard& shard = d->shardFor(key);
+    bool replaced = false;
+    {
+        QMutexLocker locker(&shard.mutex);
+
+        // A fresh image supersedes any compressed copy
+        auto coldIt = shard.coldMap.find(key);
+        if (coldIt != shard.coldMap.end()) {
+            shard.removeColdItem(coldIt, d->budget);
+            replaced = true;
+        }
+
+        auto existingIt = shard.cacheMap.find(key);
+        if (existingIt != shard.cacheMap.end()) {
+            replaced = true;
+            // Replace existing item and adjust size accordingly
+            Private::Entry& entry = existingIt->second;
+            shard.currentSizeBytes += (imageSize - entry.sizeBytes);
+            d->budget.totalSizeBytes += (imageSize - entry.sizeBytes);
+            d->budget.hotSizeBytes += (imageSize - entry.sizeBytes);
+            entry.sizeBytes = imageSize;
+            entry.item.image = image;
+            entry.item.accessCount = 1;
+            entry.item.timestamp = QDateTime::currentMSecsSinceEpoch();
+            shard.touch(entry);
+        } else {
+            shard.insertHotLocked(key, image, imageSize, d->budget);
+        }
+    }
+
+    if (replaced) emit imageReplaced(key);
+
+    // Registered before the budget is enforced, so an owner evicted at once is forgotten
+    if (key.colorTransform == 0) {
+        if (!contentDigest.isEmpty()) d->contentIndex.addOwner(key, contentDigest);
+        else d->contentIndex.removeAlias(key); // Its own image now
+    }
+
+    if (d->budget.hotOverShare() || d->budget.overLimit()) {
+        d->enforceBudget(&shard);
+    }
+
+    // Transform here, on the rendering thread, so the view finds the tile ready
+    const quint32 transformId = ColorTransform::instance().currentId();
+    if (key.colorTransform == 0 && transformId != 0) {
+        CacheKey shownKey = key;
+        shownKey.colorTransform = transformId;
+        const QImage transformed = ColorTransform::instance().apply(image, transformId);
+        if (!transformed.isNull()) {
+            put(shownKey, transformed);
+            return; // That put() reports the statistics
+        }
+    }
+
+    qint64 totalSize = 0;
+    int totalCount = 0;
+    d->totals(&totalSize, &totalCount);
+    emit statisticsChanged(totalSize, totalCount);
+}
+
+QImage PageCache::transformRendered(const CacheKey& key)
+{
+    CacheKey renderedKey = key;
+    renderedKey.colorTransform = 0;
+    const QImage rendered = get(renderedKey); // Counts the hit or miss
+    if (rendered.isNull()) return QImage();
+
+    // Promoting a compressed rendering may have cached the transformed copy already
+    {
+        Private::Shard& shard = d->shardFor(key);
+        QMutexLocker locker(&shard.mutex);
+        auto it = shard.cacheMap.find(key);
+        if (it != shard.cacheMap.end()) {
+            shard.touch(it->second);
+            return it->second.item.image;
+        }
+    }
+
+    const QImage transformed = ColorTransform::instance().apply(rendered, key.colorTransform);
+    if (!transformed.isNull()) {
+        put(key, transformed);
     }
+    return transformed;
+}
 
-    // Check if we exceed max size and evict if necessary
-    evictIfNecessary();
-    emit statisticsChanged(d->currentSizeBytes, d->cacheMap.size());
+QImage PageCache::findContent(const CacheKey& key, const QByteArray& contentDigest)
+{
+    if (contentDigest.isEmpty() || key.colorTransform != 0) return QImage();
+    CacheKey owner;
+    if (!d->contentIndex.findOwner(key, contentDigest, &owner) || owner == key) return QImage();
+    const QImage image = get(owner);
+    if (image.isNull()) {
+        d->contentIndex.removeOwner(owner);
+        return QImage();
+    }
+    d->contentIndex.addAlias(key, owner);
+    return image;
 }
 
 bool PageCache::contains(const CacheKey& key) const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->cacheMap.contains(key);
+    {
+        const Private::Shard& shard = d->shardFor(key);
+        QMutexLocker locker(&shard.mutex);
+        if (shard.cacheMap.find(key) != shard.cacheMap.end() || shard.coldMap.find(key) != shard.coldMap.end()) {
+            return true;
+        }
+    }
+    CacheKey owner;
+    if (!d->contentIndex.aliasOf(key, &owner)) return false;
+    const Private::Shard& shard = d->shardFor(owner);
+    QMutexLocker locker(&shard.mutex);
+    return shard.cacheMap.find(owner) != shard.cacheMap.end() || shard.coldMap.find(owner) != shard.coldMap.end();
+}
+
+bool PageCache::findNearestZoom(const CacheKey& key, CacheKey* nearest) const
+{
+    QMutexLocker locker(&d->zoomIndex.mutex);
+    auto pageIt = d->zoomIndex.pages.find(Private::ZoomIndex::pageOf(key));
+    if (pageIt == d->zoomIndex.pages.end()) return false;
+
+    const Private::ZoomIndex::Rendering* best = nullptr;
+    qreal bestDistance = 0;
+    for (const auto& rendering : pageIt->second) {
+        if (rendering.targetSize == key.targetSize || rendering.zoomLevel <= 0) continue;
+        // Distance in zoom steps, so 50% and 200% are equally far from 100%
+        const qreal distance = std::abs(std::log2(rendering.zoomLevel / key.zoomLevel));
+        if (!best || distance < bestDistance ||
+            (qFuzzyCompare(distance, bestDistance) && rendering.zoomLevel > best->zoomLevel)) {
+            best = &rendering;
+            bestDistance = distance;
+        }
+    }
+    if (!best) return false;
+
+    if (nearest) {
+        *nearest = key;
+        nearest->zoomLevel = best->zoomLevel;
+        nearest->targetSize = best->targetSize;
+        nearest->tileX = -1;
+        nearest->tileY = -1;
+    }
+    return true;
 }
 
 void PageCache::clearForDocument(quintptr documentId)
 {
-    QMutexLocker locker(&d->mutex);
-    auto it = d->cacheMap.begin();
-    while (it != d->cacheMap.end()) {
-        if (it.key().documentId == documentId) {
-            d->currentSizeBytes -= calculateImageSizeBytes(it.value().image);
-            it = d->cacheMap.erase(it);
-            // Also remove from LRU queue
-            d->lruQueue.removeAll(it.key());
-        } else {
-            ++it;
+    for (Private::Shard& shard : d->shards) {
+        QMutexLocker locker(&shard.mutex);
+        auto it = shard.cacheMap.begin();
+        while (it != shard.cacheMap.end()) {
+            if (it->first.documentId == documentId) {
+                auto victim = it++;
+                shard.removeItem(victim, d->budget);
+            } else {
+                ++it;
+            }
+        }
+        auto coldIt = shard.coldMap.begin();
+        while (coldIt != shard.coldMap.end()) {
+            if (coldIt->first.documentId == documentId) {
+                auto victim = coldIt++;
+                shard.removeColdItem(victim, d->budget);
+            } else {
+                ++coldIt;
+            }
         }
     }
-    emit statisticsChanged(d->currentSizeBytes, d->cacheMap.size());
+
+    d->contentIndex.forgetDocument(documentId);
+    emit documentCleared(documentId);
+
+    qint64 totalSize = 0;
+    int totalCount = 0;
+    d->totals(&totalSize, &totalCount);
+    emit statisticsChanged(totalSize, totalCount);
 }
 
 void PageCache::clear()
 {
-    QMutexLocker locker(&d->mutex);
-    d->cacheMap.clear();
-    d->lruQueue.clear();
-    d->currentSizeBytes = 0;
-    emit statisticsChanged(d->currentSizeBytes, 0);
+    for (Private::Shard& shard : d->shards) {
+        QMutexLocker locker(&shard.mutex);
+        for (const auto& entry : shard.cacheMap) {
+            d->budget.hotSizeBytes -= entry.second.sizeBytes;
+        }
+        d->budget.totalSizeBytes -= shard.currentSizeBytes.load();
+        shard.cacheMap.clear();
+        shard.lruList.clear();
+        shard.coldMap.clear();
+        shard.coldList.clear();
+        shard.currentSizeBytes = 0;
+        shard.itemCount = 0;
+    }
+    d->zoomIndex.clear();
+    d->contentIndex.clear();
+    emit cleared();
+    emit statisticsChanged(0, 0);
 }
 
 qint64 PageCache::maxSizeBytes() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->maxSizeBytes;
+    return d->budget.maxSizeBytes.load();
 }
 
 void PageCache::setMaxSizeBytes(qint64 size)
 {
-    QMutexLocker locker(&d->mutex);
-    d->maxSizeBytes = size;
-    evictIfNecessary(); // Enforce new limit immediately
+    d->budget.maxSizeBytes = size;
+    d->enforceBudget(); // Enforce new limit immediately, shard by shard
+
+    qint64 totalSize = 0;
+    int totalCount = 0;
+    d->totals(&totalSize, &totalCount);
+    emit statisticsChanged(totalSize, totalCount);
 }
 
 qint64 PageCache::currentSizeBytes() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->currentSizeBytes;
+    qint64 totalSize = 0;
+    d->totals(&totalSize, nullptr);
+    return totalSize;
 }
 
 int PageCache::itemCount() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->cacheMap.size();
+    int totalCount = 0;
+    d->totals(nullptr, &totalCount);
+    return totalCount;
+}
+
+quint64 PageCache::hitCount() const
+{
+    return d->hits.load(std::memory_order_relaxed);
+}
+
+quint64 PageCache::missCount() const
+{
+    return d->misses.load(std::memory_order_relaxed);
+}
+
+QHash<quintptr, qint64> PageCache::sizeBytesByDocument() const
+{
+    QHash<quintptr, qint64> sizes;
+    for (const Private::Shard& shard : d->shards) {
+        QMutexLocker locker(&shard.mutex);
+        for (const auto& entry : shard.cacheMap) sizes[entry.first.documentId] += entry.second.sizeBytes;
+        for (const auto& entry : shard.coldMap) sizes[entry.first.documentId] += entry.second.sizeBytes;
+    }
+    return sizes;
 }
 
 void PageCache::evictIfNecessary()
 {
-    // Lock is assumed to be held by caller
-    while (d->currentSizeBytes > d->maxSizeBytes && !d->lruQueue.isEmpty()) {
-        CacheKey lruKey = d->lruQueue.dequeue();
-        // The key might have been removed already by clearForDocument or put
-        if (d->cacheMap.contains(lruKey)) {
-            d->removeItem(lruKey);
-        }
+    d->enforceBudget();
+}
+
+qint64 PageCache::releaseMemory(qint64 bytes)
+{
+    if (bytes <= 0) return 0;
+    const qint64 freed = d->shrinkBy(bytes);
+
+    qint64 totalSize = 0;
+    int totalCount = 0;
+    d->totals(&totalSize, &totalCount);
+    emit statisticsChanged(totalSize, totalCount);
+    return freed;
+}
+
+qint64 PageCache::releaseMemoryForDocument(quintptr documentId, qint64 bytes)
+{
+    if (bytes <= 0) return 0;
+    const qint64 freed = d->shrinkDocumentBy(documentId, bytes);
+    if (freed > 0) {
+        qint64 totalSize = 0;
+        int totalCount = 0;
+        d->totals(&totalSize, &totalCount);
+        emit statisticsChanged(totalSize, totalCount);
     }
+    return freed;
+}
+
+int PageCache::zoomBucket(qreal zoomLevel)
+{
+    if (zoomLevel <= 0) return std::numeric_limits<int>::min();
+    return qRound(std::log2(zoomLevel) * ZoomBucketsPerDoubling);
+}
+
+qreal PageCache::snapZoom(qreal zoomLevel)
+{
+    if (zoomLevel <= 0) return zoomLevel;
+    return std::exp2(static_cast<qreal>(zoomBucket(zoomLevel)) / ZoomBucketsPerDoubling);
 }
 
 qint64 PageCache::calculateImageSizeBytes(const QImage& image)
@@ -209,4 +960,4 @@ qint64 PageCache::calculateImageSizeBytes(const QImage& image)
     return Private::calculateImageSizeBytes(image);
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
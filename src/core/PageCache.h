@@ -12,7 +12,6 @@
 
 #include <QObject>
 #include <QHash>
-#include <QQueue>
 #include <QImage>
 #include <QSize>
 #include <memory>
@@ -25,31 +24,83 @@ class Page;
  * @brief Manages cached page renderings for performance.
  *
  * Implements an LRU (Least Recently Used) cache to store pre-rendered
- * page images at various resolutions and zoom levels.
+ * page images at various resolutions and zoom levels. Recency is kept in an
+ * intrusive list addressed through the hash map, so get, put and evict are
+ * all constant time regardless of how many images are cached.
+ *
+ * The cache is split into shards selected by CacheKeyHash. Each shard has its
+ * own lock and recency list and trims its own LRU tail against the shared byte
+ * budget, so a GUI-thread lookup never waits behind a render worker inserting
+ * into or evicting from a different shard.
+ *
+ * The budget covers two tiers. Hot images are kept as plain QImages in up to
+ * half of it; older ones are demoted to a compressed tier (see ImageCodec)
+ * that fills the rest and is decompressed on a hit instead of re-rendering.
+ * Compressed images pushed out of the budget go to DiskPageCache rather than
+ * being dropped; clearing the cache discards them outright.
+ *
+ * Zoom levels are compared in logarithmic buckets (see snapZoom()), and
+ * findNearestZoom() reports the closest zoom a page has tiles cached at,
+ * so a view can show a scaled copy while the exact render is pending.
+ *
+ * Keys with a nonzero colorTransform hold tiles passed through ColorTransform.
+ * Putting a rendered tile also caches its copy for the current transform, and
+ * a miss on a transformed key transforms the cached rendered tile, so color
+ * modes never re-render. Transformed tiles are not spilled to disk.
+ *
+ * Grayscale8 and Mono images are kept as they are, which is how renderers
+ * hand over scanned pages unless Advanced/CompactScannedPages is off (see
+ * PixelFormat::compact()). Views expand them when they draw, so the same
+ * budget holds four to thirty-two times as many scanned pages.
+ *
+ * Pages with a content digest (see Page::contentDigest()), such as cover
+ * sheets, forms and blank pages repeated across documents, are cached once:
+ * renderers look them up by content through findContent() before rendering
+ * and put() them with their digest afterwards.
  */
 class PageCache : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief Edge length in pixels of the square tiles pages are cached in.
+     * Edge tiles of a page are clipped to the page and may be smaller.
+     */
+    static constexpr int TileSize = 512;
+
+    /**
+     * @brief Number of zoom buckets per doubling of the zoom level.
+     * Neighbouring buckets are about 1.5% apart; 1.0 and every power of two
+     * fall exactly on a bucket.
+     */
+    static constexpr int ZoomBucketsPerDoubling = 48;
+
     /**
      * @brief Unique identifier for a cached page image.
-     * Combines document ID, page index, zoom level, and rotation.
+     * Combines document ID, page index, zoom level, rotation and, for
+     * tiled entries, the tile's column and row within the rendered page.
      */
     struct CacheKey {
         quintptr documentId;
         int pageIndex;
-        qreal zoomLevel;
+        qreal zoomLevel; // Image pixels per point: view zoom times the device pixel ratio
         int rotation; // 0, 90, 180, 270
-        QSize targetSize; // Size in pixels requested
+        QSize targetSize; // Size in image (device) pixels of the whole rendered page
+        int tileX = -1; // Tile column, or -1 for a whole-page image
+        int tileY = -1; // Tile row, or -1 for a whole-page image
+        quint32 colorTransform = 0; // ColorTransform ID the image was passed through, 0 for as rendered
 
         // Required for use as a hash key
         bool operator==(const CacheKey& other) const {
             return documentId == other.documentId &&
                    pageIndex == other.pageIndex &&
-                   qFuzzyCompare(zoomLevel, other.zoomLevel) &&
+                   zoomBucket(zoomLevel) == zoomBucket(other.zoomLevel) &&
                    rotation == other.rotation &&
-                   targetSize == other.targetSize;
+                   targetSize == other.targetSize &&
+                   tileX == other.tileX &&
+                   tileY == other.tileY &&
+                   colorTransform == other.colorTransform;
         }
     };
 
@@ -61,10 +112,12 @@ public:
             // Combine hashes of all key components
             std::size_t h1 = std::hash<quintptr>{}(k.documentId);
             std::size_t h2 = std::hash<int>{}(k.pageIndex);
-            std::size_t h3 = std::hash<double>{}(static_cast<double>(k.zoomLevel));
+            std::size_t h3 = std::hash<int>{}(zoomBucket(k.zoomLevel));
             std::size_t h4 = std::hash<int>{}(k.rotation);
             std::size_t h5 = std::hash<size_t>{}(qHash(k.targetSize));
-            return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3) ^ (h5 << 4);
+            std::size_t h6 = std::hash<int>{}((k.tileY << 16) ^ k.tileX);
+            std::size_t h7 = std::hash<quint32>{}(k.colorTransform);
+            return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3) ^ (h5 << 4) ^ (h6 << 5) ^ (h7 << 6);
         }
     };
 
@@ -105,15 +158,38 @@ public:
      * @brief Store a page image in the cache.
      * @param key The cache key identifying the page and its rendering parameters.
      * @param image The rendered image to store.
+     * @param contentDigest The page's Page::contentDigest(), if any; identical
+     * pages of other documents are then answered with this image by findContent().
      */
-    void put(const CacheKey& key, const QImage& image);
+    void put(const CacheKey& key, const QImage& image, const QByteArray& contentDigest = QByteArray());
+
+    /**
+     * @brief Find the image of an identical page rendered with the same parameters.
+     * On success the key becomes an alias of that image: get() answers it,
+     * and no memory is taken for it.
+     * @param key The cache key of the page to render.
+     * @param contentDigest The page's Page::contentDigest().
+     * @return The shared image, or a null image if no identical page is cached.
+     */
+    QImage findContent(const CacheKey& key, const QByteArray& contentDigest);
+
+    /**
+     * @brief Find the cached rendering of a page closest to a zoom level.
+     * Only tiled entries are considered. When two renderings are equally
+     * close the larger one wins, since scaling down looks better.
+     * @param key Page, rotation and zoom to match; tile fields are ignored.
+     * @param nearest Receives the key of the rendering found, with tileX and
+     * tileY set to -1. Its targetSize gives the tile grid to look up.
+     * @return True if a rendering with a different target size is cached.
+     */
+    bool findNearestZoom(const CacheKey& key, CacheKey* nearest) const;
 
     /**
      * @brief Check if a specific page image is cached.
      * @param key The cache key to check.
      * @return True if the image exists in the cache.
      */
-    bool contains(const Cache-Key& key) const;
+    bool contains(const CacheKey& key) const;
 
     /**
      * @brief Clear all cached images for a specific document.
@@ -150,11 +226,65 @@ public:
      */
     int itemCount() const;
 
+    /**
+     * @brief Get the number of get() calls that found an image.
+     * @return Hits since the cache was created, compressed ones included.
+     */
+    quint64 hitCount() const;
+
+    /**
+     * @brief Get the number of get() calls that found nothing.
+     * @return Misses since the cache was created.
+     */
+    quint64 missCount() const;
+
+    /**
+     * @brief Get the bytes held for each document, in both tiers.
+     * Visits every entry, so it is meant for monitoring rather than paint paths.
+     * @return Bytes by document ID.
+     */
+    QHash<quintptr, qint64> sizeBytesByDocument() const;
+
     /**
      * @brief Evict least recently used items if the cache exceeds max size.
      */
     void evictIfNecessary();
 
+    /**
+     * @brief Free memory on request of MemoryBudget.
+     * Compressed entries go first, then the least recently used images;
+     * both are handed to DiskPageCache.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 releaseMemory(qint64 bytes);
+
+    /**
+     * @brief Free memory held for one document on request of MemoryBudget,
+     * when that document is over its soft limit. Its compressed entries go
+     * first, then its least recently used images, all to DiskPageCache.
+     * @param documentId Document ID as used in cache keys.
+     * @param bytes Number of bytes to free.
+     * @return Bytes actually freed.
+     */
+    qint64 releaseMemoryForDocument(quintptr documentId, qint64 bytes);
+
+    /**
+     * @brief Get the zoom bucket a zoom level falls into.
+     * @param zoomLevel Zoom level, 1.0 = 100%.
+     * @return Bucket index; 0 for 100%.
+     */
+    static int zoomBucket(qreal zoomLevel);
+
+    /**
+     * @brief Round a zoom level to the centre of its bucket.
+     * Rendering at snapped zoom levels lets nearby zooms, such as those of a
+     * fit-to-width view being resized, share cached tiles.
+     * @param zoomLevel Zoom level, 1.0 = 100%.
+     * @return Snapped zoom level.
+     */
+    static qreal snapZoom(qreal zoomLevel);
+
     /**
      * @brief Calculate memory usage of a single image.
      * @param image The image to calculate size for.
@@ -170,9 +300,35 @@ signals:
      */
     void statisticsChanged(qint64 currentSize, int itemCount);
 
+    /**
+     * @brief Emitted when put() replaces a cached image, so copies of it
+     * kept elsewhere, such as textures in video memory, are stale.
+     * Emitted from the thread that called put().
+     * @param key Key whose image changed.
+     */
+    void imageReplaced(const QuantilyxDoc::PageCache::CacheKey& key);
+
+    /**
+     * @brief Emitted when clearForDocument() has dropped a document's images.
+     * @param documentId The document's ID.
+     */
+    void documentCleared(quintptr documentId);
+
+    /**
+     * @brief Emitted when clear() has dropped every image.
+     */
+    void cleared();
+
 private:
+    // Miss on a transformed key: transform the rendered tile and cache the result
+    QImage transformRendered(const CacheKey& key);
+    // Move an image decoded by a compressed hit back to the hot tier. Runs on the pool.
+    void promote(const CacheKey& key, const QImage& image);
+
     class Private;
     std::unique_ptr<Private> d;
+
+    static PageCache* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,146 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "PerceptualHash.h"
+#include "ImageScaler.h"
+#include "PixelFormat.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Side of the thumbnail pHash transforms, and of the block of its lowest
+// frequencies that is kept
+const int DctSize = 32;
+const int DctKept = 8;
+
+QImage greyThumbnail(const QImage& image, int width, int height)
+{
+    return PixelFormat::toGrayscale8(ImageScaler::scaled(image, width, height, Qt::IgnoreAspectRatio,
+                                                         ImageScaler::Filter::Box));
+}
+
+} // namespace
+
+quint64 PerceptualHash::dHash(const QImage& image)
+{
+    if (image.isNull()) return 0;
+    const QImage thumbnail = greyThumbnail(image, 9, 8);
+    if (thumbnail.isNull()) return 0;
+    quint64 hash = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uchar* line = thumbnail.constScanLine(y);
+        for (int x = 0; x < 8; ++x) hash = (hash << 1) | (line[x] > line[x + 1] ? 1u : 0u);
+    }
+    return hash;
+}
+
+quint64 PerceptualHash::pHash(const QImage& image)
+{
+    if (image.isNull()) return 0;
+    const QImage thumbnail = greyThumbnail(image, DctSize, DctSize);
+    if (thumbnail.isNull()) return 0;
+
+    static const QVector<double> basis = [] {
+        QVector<double> table(DctKept * DctSize);
+        for (int u = 0; u < DctKept; ++u) {
+            for (int x = 0; x < DctSize; ++x) table[u * DctSize + x] = std::cos((2 * x + 1) * u * M_PI / (2 * DctSize));
+        }
+        return table;
+    }();
+
+    // Only the kept frequencies are computed: rows first, then columns
+    double rows[DctSize][DctKept];
+    for (int y = 0; y < DctSize; ++y) {
+        const uchar* line = thumbnail.constScanLine(y);
+        for (int u = 0; u < DctKept; ++u) {
+            double sum = 0.0;
+            for (int x = 0; x < DctSize; ++x) sum += basis[u * DctSize + x] * line[x];
+            rows[y][u] = sum;
+        }
+    }
+    double coefficients[DctKept * DctKept];
+    for (int v = 0; v < DctKept; ++v) {
+        for (int u = 0; u < DctKept; ++u) {
+            double sum = 0.0;
+            for (int y = 0; y < DctSize; ++y) sum += basis[v * DctSize + y] * rows[y][u];
+            coefficients[v * DctKept + u] = sum;
+        }
+    }
+
+    // The DC term only says how bright the image is and is left out
+    double ac[DctKept * DctKept - 1];
+    std::copy(coefficients + 1, coefficients + DctKept * DctKept, ac);
+    const int middle = (DctKept * DctKept - 1) / 2;
+    std::nth_element(ac, ac + middle, ac + DctKept * DctKept - 1);
+    const double median = ac[middle];
+
+    quint64 hash = 0;
+    for (int i = 1; i < DctKept * DctKept; ++i) hash = (hash << 1) | (coefficients[i] > median ? 1u : 0u);
+    return hash;
+}
+
+int PerceptualHash::distance(quint64 a, quint64 b)
+{
+    return int(qPopulationCount(a ^ b));
+}
+
+void HammingTree::insert(quint64 hash, int id)
+{
+    const int index = m_nodes.size();
+    m_nodes.append({hash, id, -1, -1, 0});
+    if (index == 0) return;
+
+    int node = 0;
+    for (;;) {
+        const int d = PerceptualHash::distance(hash, m_nodes[node].hash);
+        int child = m_nodes[node].firstChild;
+        while (child >= 0 && m_nodes[child].distance != d) child = m_nodes[child].nextSibling;
+        if (child < 0) {
+            m_nodes[index].distance = d;
+            m_nodes[index].nextSibling = m_nodes[node].firstChild;
+            m_nodes[node].firstChild = index;
+            return;
+        }
+        node = child;
+    }
+}
+
+QVector<QPair<int, int>> HammingTree::find(quint64 hash, int radius) const
+{
+    QVector<QPair<int, int>> matches;
+    if (m_nodes.isEmpty()) return matches;
+
+    QVector<int> pending;
+    pending.append(0);
+    while (!pending.isEmpty()) {
+        const Node& node = m_nodes[pending.takeLast()];
+        const int d = PerceptualHash::distance(hash, node.hash);
+        if (d <= radius) matches.append(qMakePair(node.id, d));
+        for (int child = node.firstChild; child >= 0; child = m_nodes[child].nextSibling) {
+            if (std::abs(m_nodes[child].distance - d) <= radius) pending.append(child);
+        }
+    }
+    return matches;
+}
+
+int HammingTree::size() const
+{
+    return m_nodes.size();
+}
+
+void HammingTree::clear()
+{
+    m_nodes.clear();
+}
+
+} // namespace QuantilyxDoc
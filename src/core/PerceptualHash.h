@@ -0,0 +1,105 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_PERCEPTUALHASH_H
+#define QUANTILYX_PERCEPTUALHASH_H
+
+#include <QImage>
+#include <QPair>
+#include <QVector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief 64-bit hashes of how an image looks, compared by Hamming distance.
+ *
+ * Unlike a hash of the bytes, these barely change when an image is scaled,
+ * re-encoded at another quality or scanned again, so near-equal images
+ * have hashes a few bits apart. dHash() is the cheaper and follows the
+ * brightness gradient; pHash() follows the lowest spatial frequencies and
+ * holds up better against contrast and gamma changes.
+ */
+class PerceptualHash
+{
+public:
+    /**
+     * @brief Difference hash: whether each cell of a 9x8 grey thumbnail is brighter than its right neighbour.
+     * @param image Image; any format and size.
+     * @return Hash; 0 for a null image.
+     */
+    static quint64 dHash(const QImage& image);
+
+    /**
+     * @brief DCT hash: whether each of the 63 lowest-frequency coefficients of a 32x32 grey thumbnail is above their median.
+     * @param image Image; any format and size.
+     * @return Hash in the low 63 bits; 0 for a null image.
+     */
+    static quint64 pHash(const QImage& image);
+
+    /**
+     * @brief Count the bits two hashes differ in.
+     * @param a First hash.
+     * @param b Second hash.
+     * @return Hamming distance, 0 to 64.
+     */
+    static int distance(quint64 a, quint64 b);
+};
+
+/**
+ * @brief BK-tree of 64-bit hashes for lookups within a Hamming distance.
+ *
+ * Each node's children are keyed by their distance to it; by the triangle
+ * inequality a lookup within radius r only descends into children keyed
+ * d - r to d + r, d being the query's distance to the node, so small
+ * radii visit a small share of the tree. Not thread-safe.
+ */
+class HammingTree
+{
+public:
+    /**
+     * @brief Add a hash.
+     * @param hash Hash to add; equal hashes may be added several times.
+     * @param id Caller's value returned by lookups.
+     */
+    void insert(quint64 hash, int id);
+
+    /**
+     * @brief Find the hashes within a distance.
+     * @param hash Hash to look up.
+     * @param radius Largest distance returned.
+     * @return Ids with their distance, in no particular order.
+     */
+    QVector<QPair<int, int>> find(quint64 hash, int radius) const;
+
+    /**
+     * @brief Get the number of hashes added.
+     * @return Hash count.
+     */
+    int size() const;
+
+    /**
+     * @brief Remove all hashes.
+     */
+    void clear();
+
+private:
+    struct Node {
+        quint64 hash;
+        int id;
+        int firstChild;  // Index in m_nodes, or -1
+        int nextSibling; // Next child of the same parent, or -1
+        int distance;    // To the parent
+    };
+
+    QVector<Node> m_nodes;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_PERCEPTUALHASH_H
@@ -0,0 +1,225 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "PixelFormat.h"
+#include "ImageBufferPool.h"
+#include <QVector>
+#include <vector>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+template <typename Traits>
+QImage grayscaleOf(const QImage& image)
+{
+    QImage result = ImageBufferPool::instance().acquire(image.size(), QImage::Format_Grayscale8);
+    if (result.isNull()) return QImage();
+    const PixelPalette palette = PixelFormat::palette(image);
+    for (int y = 0; y < image.height(); ++y) {
+        Traits::toGray(image.constScanLine(y), result.scanLine(y), image.width(), palette);
+    }
+    result.setDevicePixelRatio(image.devicePixelRatio());
+    return result;
+}
+
+template <typename Traits>
+QImage pipelineOf(const QImage& image)
+{
+    QImage result = ImageBufferPool::instance().acquire(image.size());
+    if (result.isNull()) return QImage();
+    const PixelPalette palette = PixelFormat::palette(image);
+    for (int y = 0; y < image.height(); ++y) {
+        Traits::toArgb(image.constScanLine(y), reinterpret_cast<QRgb*>(result.scanLine(y)), image.width(), palette);
+    }
+    result.setDevicePixelRatio(image.devicePixelRatio());
+    return result;
+}
+
+// d = s + d * (255 - sa) / 255 on premultiplied channels
+inline QRgb sourceOver(QRgb source, QRgb destination)
+{
+    const quint32 alpha = qAlpha(source);
+    if (alpha == 255) return source;
+    if (alpha == 0) return destination;
+    const quint32 inverse = 255 - alpha;
+    // Red and blue, then alpha and green, two channels per multiply
+    quint32 rb = (destination & 0x00ff00ffu) * inverse;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ffu) + 0x00800080u) >> 8) & 0x00ff00ffu;
+    quint32 ag = ((destination >> 8) & 0x00ff00ffu) * inverse;
+    ag = (ag + ((ag >> 8) & 0x00ff00ffu) + 0x00800080u) & 0xff00ff00u;
+    return source + rb + ag;
+}
+
+template <typename Traits>
+void compositeRows(QImage& destination, const QRect& target, const QPoint& sourceOrigin, const QImage& source)
+{
+    const PixelPalette palette = PixelFormat::palette(source);
+    QVector<QRgb> row;
+    if (Traits::HasAlpha || Traits::BitsPerPixel < 8) row.resize(source.width());
+    for (int y = target.top(); y <= target.bottom(); ++y) {
+        const uchar* in = source.constScanLine(y - target.top() + sourceOrigin.y());
+        QRgb* out = reinterpret_cast<QRgb*>(destination.scanLine(y)) + target.left();
+        if (Traits::BitsPerPixel < 8) {
+            // Expanded from the start of the line; bits do not address single pixels
+            Traits::toArgb(in, row.data(), sourceOrigin.x() + target.width(), palette);
+            std::memcpy(out, row.constData() + sourceOrigin.x(), size_t(target.width()) * sizeof(QRgb));
+            continue;
+        }
+        in += sourceOrigin.x() * (Traits::BitsPerPixel / 8);
+        if (!Traits::HasAlpha) {
+            // Opaque, so the source replaces the destination
+            Traits::toArgb(in, out, target.width(), palette);
+            continue;
+        }
+        Traits::toArgb(in, row.data(), target.width(), palette);
+        for (int x = 0; x < target.width(); ++x) out[x] = sourceOver(row[x], out[x]);
+    }
+}
+
+// Marks the grey levels of an image in seen; false at the first pixel that
+// is not an opaque grey
+template <typename Traits>
+bool grayLevels(const QImage& image, bool (&seen)[256])
+{
+    const PixelPalette palette = PixelFormat::palette(image);
+    constexpr bool expands = !Traits::IsGray && Traits::Format != ImageBufferPool::PipelineFormat;
+    std::vector<QRgb> row(expands ? size_t(image.width()) : 0);
+    std::vector<quint8> levels(Traits::IsGray ? size_t(image.width()) : 0);
+    for (int y = 0; y < image.height(); ++y) {
+        const uchar* line = image.constScanLine(y);
+        if constexpr (Traits::IsGray) {
+            Traits::toGray(line, levels.data(), image.width(), palette);
+            for (quint8 level : levels) seen[level] = true;
+            continue;
+        }
+        const QRgb* pixels = reinterpret_cast<const QRgb*>(line);
+        if constexpr (expands) {
+            Traits::toArgb(line, row.data(), image.width(), palette);
+            pixels = row.data();
+        }
+        for (int x = 0; x < image.width(); ++x) {
+            const quint32 level = pixels[x] & 0xff;
+            if (pixels[x] != (0xff000000u | (level * 0x010101u))) return false;
+            seen[level] = true;
+        }
+    }
+    return true;
+}
+
+// One bit per pixel, set where the grey level is high
+template <typename Traits>
+QImage monoOf(const QImage& image, int high)
+{
+    QImage result = ImageBufferPool::instance().acquire(image.size(), QImage::Format_Mono);
+    if (result.isNull()) return QImage();
+    const PixelPalette palette = PixelFormat::palette(image);
+    std::vector<quint8> levels(size_t(image.width()));
+    for (int y = 0; y < image.height(); ++y) {
+        Traits::toGray(image.constScanLine(y), levels.data(), image.width(), palette);
+        uchar* out = result.scanLine(y);
+        std::memset(out, 0, size_t(result.bytesPerLine()));
+        for (int x = 0; x < image.width(); ++x) {
+            if (levels[size_t(x)] == high) out[x >> 3] |= uchar(0x80 >> (x & 7));
+        }
+    }
+    result.setDevicePixelRatio(image.devicePixelRatio());
+    return result;
+}
+
+} // namespace
+
+bool PixelFormat::isSpecialized(QImage::Format format)
+{
+    return dispatch(format, [](auto) {});
+}
+
+PixelPalette PixelFormat::palette(const QImage& image)
+{
+    PixelPalette palette;
+    if (image.format() != QImage::Format_Mono) return palette;
+    const QVector<QRgb> table = image.colorTable();
+    for (int i = 0; i < 2 && i < table.size(); ++i) {
+        palette.colors[i] = qPremultiply(table[i]);
+        palette.grays[i] = quint8(qGray(table[i]));
+    }
+    return palette;
+}
+
+qint64 PixelFormat::bytesPerLine(QImage::Format format, int width)
+{
+    if (format == QImage::Format_Invalid || width <= 0) return 0;
+    const int depth = QImage::toPixelFormat(format).bitsPerPixel();
+    return ((static_cast<qint64>(width) * depth + 31) / 32) * 4;
+}
+
+QImage PixelFormat::toGrayscale8(const QImage& image)
+{
+    if (image.isNull() || image.format() == QImage::Format_Grayscale8) return image;
+    QImage result;
+    if (dispatch(image.format(), [&](auto traits) { result = grayscaleOf<decltype(traits)>(image); })) {
+        return result;
+    }
+    return grayscaleOf<PixelTraits<ImageBufferPool::PipelineFormat>>(ImageBufferPool::toPipelineFormat(image));
+}
+
+QImage PixelFormat::toPipelineFormat(const QImage& image)
+{
+    if (image.isNull() || image.format() == ImageBufferPool::PipelineFormat) return image;
+    QImage result;
+    if (dispatch(image.format(), [&](auto traits) { result = pipelineOf<decltype(traits)>(image); })) {
+        return result;
+    }
+    return image.convertToFormat(ImageBufferPool::PipelineFormat);
+}
+
+void PixelFormat::composite(QImage& destination, const QPoint& position, const QImage& source)
+{
+    if (destination.format() != ImageBufferPool::PipelineFormat || source.isNull()) return;
+    const QRect target = QRect(position, source.size()).intersected(destination.rect());
+    if (target.isEmpty()) return;
+    const QPoint sourceOrigin = target.topLeft() - position;
+    if (dispatch(source.format(), [&](auto traits) {
+            compositeRows<decltype(traits)>(destination, target, sourceOrigin, source);
+        })) {
+        return;
+    }
+    compositeRows<PixelTraits<ImageBufferPool::PipelineFormat>>(destination, target, sourceOrigin,
+                                                                 source.convertToFormat(ImageBufferPool::PipelineFormat));
+}
+
+QImage PixelFormat::compact(const QImage& image)
+{
+    if (image.isNull() || image.format() == QImage::Format_Mono) return image;
+    bool seen[256] = {};
+    bool gray = false;
+    if (!dispatch(image.format(), [&](auto traits) { gray = grayLevels<decltype(traits)>(image, seen); }) || !gray) {
+        return image;
+    }
+
+    int levels[2] = {0, 0};
+    int count = 0;
+    for (int level = 0; level < 256 && count <= 2; ++level) {
+        if (!seen[level]) continue;
+        if (count < 2) levels[count] = level;
+        ++count;
+    }
+    if (count > 2) return toGrayscale8(image);
+
+    // One level is a blank page; no bit is set and the palette's first color shows
+    const int high = count == 2 ? levels[1] : 256;
+    QImage result;
+    dispatch(image.format(), [&](auto traits) { result = monoOf<decltype(traits)>(image, high); });
+    if (result.isNull()) return image;
+    result.setColorTable({qRgb(levels[0], levels[0], levels[0]),
+                          qRgb(levels[count - 1], levels[count - 1], levels[count - 1])});
+    return result;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,202 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_PIXELFORMAT_H
+#define QUANTILYX_PIXELFORMAT_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRgb>
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief The two colors of a Mono image, premultiplied, and their grey levels.
+ */
+struct PixelPalette {
+    QRgb colors[2] = {0xff000000u, 0xffffffffu};
+    quint8 grays[2] = {0, 255};
+};
+
+/**
+ * @brief Compile-time description of one pixel format.
+ *
+ * Specialized for the formats the render pipeline keeps images in. Each
+ * specialization reads rows of its format into premultiplied ARGB32 or
+ * grey levels with loops of its own, so kernels written against the traits
+ * have no per-pixel format test.
+ */
+template <QImage::Format F>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<QImage::Format_ARGB32_Premultiplied> {
+    static constexpr QImage::Format Format = QImage::Format_ARGB32_Premultiplied;
+    static constexpr int BitsPerPixel = 32;
+    static constexpr bool HasAlpha = true;
+    static constexpr bool IsGray = false;
+
+    static void toArgb(const uchar* line, QRgb* out, int width, const PixelPalette&) {
+        std::memcpy(out, line, size_t(width) * sizeof(QRgb));
+    }
+    static void toGray(const uchar* line, quint8* out, int width, const PixelPalette&) {
+        const QRgb* in = reinterpret_cast<const QRgb*>(line);
+        for (int x = 0; x < width; ++x) out[x] = quint8(qGray(in[x])); // Premultiplied; pages are opaque
+    }
+};
+
+template <>
+struct PixelTraits<QImage::Format_RGB888> {
+    static constexpr QImage::Format Format = QImage::Format_RGB888;
+    static constexpr int BitsPerPixel = 24;
+    static constexpr bool HasAlpha = false;
+    static constexpr bool IsGray = false;
+
+    static void toArgb(const uchar* line, QRgb* out, int width, const PixelPalette&) {
+        for (int x = 0; x < width; ++x, line += 3) out[x] = qRgb(line[0], line[1], line[2]);
+    }
+    static void toGray(const uchar* line, quint8* out, int width, const PixelPalette&) {
+        for (int x = 0; x < width; ++x, line += 3) out[x] = quint8(qGray(line[0], line[1], line[2]));
+    }
+};
+
+template <>
+struct PixelTraits<QImage::Format_Grayscale8> {
+    static constexpr QImage::Format Format = QImage::Format_Grayscale8;
+    static constexpr int BitsPerPixel = 8;
+    static constexpr bool HasAlpha = false;
+    static constexpr bool IsGray = true;
+
+    static void toArgb(const uchar* line, QRgb* out, int width, const PixelPalette&) {
+        for (int x = 0; x < width; ++x) out[x] = 0xff000000u | (quint32(line[x]) * 0x010101u);
+    }
+    static void toGray(const uchar* line, quint8* out, int width, const PixelPalette&) {
+        std::memcpy(out, line, size_t(width));
+    }
+};
+
+template <>
+struct PixelTraits<QImage::Format_Mono> {
+    static constexpr QImage::Format Format = QImage::Format_Mono;
+    static constexpr int BitsPerPixel = 1;
+    static constexpr bool HasAlpha = false;
+    static constexpr bool IsGray = true;
+
+    // Most significant bit first; whole bytes while they last
+    template <typename T>
+    static void expand(const uchar* line, T* out, int width, const T (&values)[2]) {
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            const uchar bits = line[x >> 3];
+            for (int bit = 0; bit < 8; ++bit) out[x + bit] = values[(bits >> (7 - bit)) & 1];
+        }
+        for (; x < width; ++x) out[x] = values[(line[x >> 3] >> (7 - (x & 7))) & 1];
+    }
+    static void toArgb(const uchar* line, QRgb* out, int width, const PixelPalette& palette) {
+        expand(line, out, width, palette.colors);
+    }
+    static void toGray(const uchar* line, quint8* out, int width, const PixelPalette& palette) {
+        expand(line, out, width, palette.grays);
+    }
+};
+
+/**
+ * @brief Picks the kernels of an image's pixel format and converts between formats.
+ *
+ * Scaling (ImageScaler), color transforms (ColorTransform), compositing
+ * and image diffs (ImageDiff) are written once as templates over
+ * PixelTraits and instantiated for ARGB32_Premultiplied, RGB888,
+ * Grayscale8 and Mono. dispatch() selects the instantiation once per
+ * image or tile, so a greyscale scan takes one-byte paths from end to end
+ * instead of being widened to 32 bits first. Images in any other format
+ * are converted to ImageBufferPool::PipelineFormat before they reach a
+ * kernel.
+ */
+class PixelFormat
+{
+public:
+    /**
+     * @brief Check if a format has specialized kernels.
+     * @param format Pixel format.
+     * @return True for ARGB32_Premultiplied, RGB888, Grayscale8 and Mono.
+     */
+    static bool isSpecialized(QImage::Format format);
+
+    /**
+     * @brief Call a function with the traits of a format.
+     * @param format Pixel format.
+     * @param function Generic callable taking a PixelTraits instance.
+     * @return False, without calling, if the format is not specialized.
+     */
+    template <typename Function>
+    static bool dispatch(QImage::Format format, Function&& function) {
+        switch (format) {
+        case QImage::Format_ARGB32_Premultiplied: function(PixelTraits<QImage::Format_ARGB32_Premultiplied>()); return true;
+        case QImage::Format_RGB888: function(PixelTraits<QImage::Format_RGB888>()); return true;
+        case QImage::Format_Grayscale8: function(PixelTraits<QImage::Format_Grayscale8>()); return true;
+        case QImage::Format_Mono: function(PixelTraits<QImage::Format_Mono>()); return true;
+        default: return false;
+        }
+    }
+
+    /**
+     * @brief Get the palette kernels read a Mono image with.
+     * @param image Image; other formats get the default black and white.
+     * @return Palette.
+     */
+    static PixelPalette palette(const QImage& image);
+
+    /**
+     * @brief Get the bytes per line of an image, 32-bit aligned as QImage lays it out.
+     * @param format Pixel format.
+     * @param width Width in pixels.
+     * @return Bytes per line; 0 for an invalid format.
+     */
+    static qint64 bytesPerLine(QImage::Format format, int width);
+
+    /**
+     * @brief Convert an image to grey levels.
+     * @param image Image in any format; Grayscale8 is returned as is.
+     * @return Grayscale8 image from ImageBufferPool, with the source's device pixel ratio.
+     */
+    static QImage toGrayscale8(const QImage& image);
+
+    /**
+     * @brief Expand an image to ImageBufferPool::PipelineFormat.
+     * @param image Image in any format; PipelineFormat is returned as is.
+     * @return Image from ImageBufferPool, with the source's device pixel ratio.
+     */
+    static QImage toPipelineFormat(const QImage& image);
+
+    /**
+     * @brief Draw an image onto another, source over, without a QPainter.
+     * @param destination Image in ImageBufferPool::PipelineFormat.
+     * @param position Where the source's top left corner goes; clipped to the destination.
+     * @param source Image in any format.
+     */
+    static void composite(QImage& destination, const QPoint& position, const QImage& source);
+
+    /**
+     * @brief Store an opaque grey image in as few bits as it needs.
+     *
+     * Scanned pages are mostly black and white or grey, yet render to
+     * 32 bits a pixel. An image of at most two grey levels becomes Mono
+     * with those levels as its palette, one with more becomes Grayscale8;
+     * the scan stops at the first pixel with color or transparency. The
+     * pixels shown are the same either way.
+     * @param image Image in any format.
+     * @return Mono or Grayscale8 image from ImageBufferPool, or the image as is if it has color.
+     */
+    static QImage compact(const QImage& image);
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_PIXELFORMAT_H
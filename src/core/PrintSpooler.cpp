@@ -0,0 +1,361 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "PrintSpooler.h"
+#include "BandedRenderer.h"
+#include "Document.h"
+#include "Page.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include "Tracing.h"
+#include "Logger.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPageLayout>
+#include <QPainter>
+#include <QPair>
+#include <QPrinter>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const int DefaultWindowMB = 256;
+// Bands per render thread that fit in the window, so every thread can work ahead
+const int BandsPerWorker = 2;
+
+using BandKey = QPair<int, int>; // Position in the job, band within the page
+
+// How one page is laid onto the printer and cut into bands
+struct PagePlan {
+    int pageIndex = -1;
+    Page* page = nullptr;
+    QSize pixels;       // Rendered size, fitted to the paint rectangle
+    qreal scale = 1.0;  // Pixels per point
+    int bandHeight = 0;
+    int bandCount = 0;  // 1 for a page rendered whole, 0 for a page that cannot be rendered
+
+    QRect bandRect(int band) const {
+        const int top = band * bandHeight;
+        return QRect(0, top, pixels.width(), qMin(bandHeight, pixels.height() - top));
+    }
+};
+
+struct RenderedBand {
+    QImage image;   // Null if the band failed
+    qint64 bytes = 0;
+};
+
+// Hands bands from the render threads to the printing one in print order,
+// holding no more than capacity bytes of bands rendered ahead. The band
+// the printer waits for is always let in, so the window cannot deadlock.
+class BandWindow
+{
+public:
+    explicit BandWindow(qint64 capacity) : m_capacity(capacity) {}
+
+    // Wait for room for a band about to be rendered
+    bool reserve(const BandKey& key, qint64 bytes) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_canceled && m_used + bytes > m_capacity && key != m_next) m_changed.wait(&m_mutex);
+        if (m_canceled) return false;
+        m_used += bytes;
+        return true;
+    }
+
+    void put(const BandKey& key, RenderedBand band) {
+        QMutexLocker locker(&m_mutex);
+        if (m_canceled) {
+            m_used -= band.bytes;
+            return;
+        }
+        m_ready.insert(key, std::move(band));
+        m_changed.wakeAll();
+    }
+
+    // Wait for the band the printer needs next
+    bool take(const BandKey& key, RenderedBand* band) {
+        QMutexLocker locker(&m_mutex);
+        m_next = key;
+        m_changed.wakeAll(); // A thread waiting to reserve this band may go ahead
+        while (!m_canceled && !m_ready.contains(key)) m_changed.wait(&m_mutex);
+        if (m_canceled) return false;
+        *band = m_ready.take(key);
+        return true;
+    }
+
+    void release(qint64 bytes) {
+        QMutexLocker locker(&m_mutex);
+        m_used -= bytes;
+        m_changed.wakeAll();
+    }
+
+    void cancel() {
+        QMutexLocker locker(&m_mutex);
+        m_canceled = true;
+        m_ready.clear();
+        m_changed.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_changed;
+    QMap<BandKey, RenderedBand> m_ready;
+    const qint64 m_capacity;
+    qint64 m_used = 0;
+    BandKey m_next{0, 0};
+    bool m_canceled = false;
+};
+
+} // namespace
+
+class PrintSpooler::Private {
+public:
+    Private(PrintSpooler* q_ptr) : q(q_ptr) {}
+
+    PrintSpooler* q;
+    int jobs = 0;
+    qint64 windowBytes = 0;
+    QString error;
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<bool> running{false};
+
+    qint64 windowCapacity() const {
+        if (windowBytes > 0) return windowBytes;
+        const qint64 megabytes = qMax(16, Settings::instance().value<int>("Advanced/PrintMemoryMB", DefaultWindowMB));
+        return megabytes * 1024 * 1024;
+    }
+
+    // Fit a page into the paint rectangle and cut it into bands of at most bandBytes
+    static PagePlan plan(Document* document, int pageIndex, const QSize& area, qint64 bandBytes) {
+        PagePlan plan;
+        plan.pageIndex = pageIndex;
+        plan.page = document->page(pageIndex);
+        const QSizeF size = plan.page ? plan.page->size() : QSizeF();
+        if (size.isEmpty() || area.isEmpty()) return plan;
+
+        plan.scale = qMin(area.width() / size.width(), area.height() / size.height());
+        plan.pixels = QSize(qMax(1, qRound(size.width() * plan.scale)), qMax(1, qRound(size.height() * plan.scale)));
+        const qint64 rowBytes = qint64(plan.pixels.width()) * 4;
+        const bool banded = plan.page->rendersRegionsDirectly() && rowBytes * plan.pixels.height() > bandBytes;
+        plan.bandHeight = banded ? int(qBound<qint64>(BandedRenderer::MinBandHeight, bandBytes / rowBytes, plan.pixels.height()))
+                                 : plan.pixels.height();
+        plan.bandCount = (plan.pixels.height() + plan.bandHeight - 1) / plan.bandHeight;
+        return plan;
+    }
+
+    static RenderedBand render(const PagePlan& plan, int band) {
+        TRACE_ZONE("PrintSpooler::render");
+        const QRect rect = plan.bandRect(band);
+        const int dpi = qMax(1, qRound(72.0 * plan.scale));
+        RenderedBand rendered;
+        rendered.bytes = qint64(rect.width()) * rect.height() * 4;
+        if (plan.bandCount == 1) {
+            rendered.image = plan.page->render(rect.width(), rect.height(), dpi);
+        } else {
+            const QRectF region(0, rect.top() / plan.scale, rect.width() / plan.scale, rect.height() / plan.scale);
+            rendered.image = plan.page->renderRectangle(region, rect.width(), rect.height(), dpi);
+        }
+        return rendered;
+    }
+};
+
+PrintSpooler::PrintSpooler(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+PrintSpooler::~PrintSpooler() = default;
+
+void PrintSpooler::setJobs(int jobs)
+{
+    d->jobs = jobs;
+}
+
+void PrintSpooler::setWindowBytes(qint64 bytes)
+{
+    d->windowBytes = bytes;
+}
+
+void PrintSpooler::cancel()
+{
+    d->cancelRequested = true;
+}
+
+bool PrintSpooler::isRunning() const
+{
+    return d->running;
+}
+
+QString PrintSpooler::errorString() const
+{
+    return d->error;
+}
+
+bool PrintSpooler::print(Document* document, QPrinter* printer, const QVector<int>& pageList)
+{
+    d->error.clear();
+    if (d->running) {
+        d->error = QStringLiteral("A print is already running");
+        return false;
+    }
+    if (!document || !printer || document->pageCount() == 0) {
+        d->error = QStringLiteral("Nothing to print");
+        return false;
+    }
+    QVector<int> pages = pageList;
+    if (pages.isEmpty()) {
+        for (int i = 0; i < document->pageCount(); ++i) pages.append(i);
+    }
+
+    d->running = true;
+    d->cancelRequested = false;
+    const QSize area = printer->pageLayout().paintRectPixels(printer->resolution()).size();
+    const int renderers = d->jobs > 0 ? d->jobs : qMax(1, QThread::idealThreadCount());
+    const qint64 capacity = d->windowCapacity();
+    const qint64 bandBytes = qMax<qint64>(1024 * 1024, capacity / (renderers * BandsPerWorker));
+    LOG_INFO("PrintSpooler: Printing " << pages.size() << " pages of " << document->filePath() << " at "
+             << printer->resolution() << " dpi with " << renderers << " render threads and a "
+             << capacity / (1024 * 1024) << " MB window");
+
+    BandWindow window(capacity);
+    QMutex planMutex; // Guards plans and the claim cursor
+    QVector<PagePlan> plans(pages.size());
+    QVector<bool> planned(pages.size(), false);
+    BandKey cursor{0, 0};
+    std::atomic<int> failedPages{0};
+    QString printError;
+
+    // Plans are made by whoever first needs them, in print order
+    auto planFor = [&](int position) -> const PagePlan& {
+        if (!planned.at(position)) {
+            plans[position] = Private::plan(document, pages.at(position), area, bandBytes);
+            planned[position] = true;
+        }
+        return plans.at(position);
+    };
+
+    // Each render thread blocks on the window and the printing thread on
+    // the renderers, so every one needs a thread of its own
+    ThreadPool pool(QStringLiteral("Printing"), renderers + 1);
+    auto stage = [&](int worker) {
+        if (worker < renderers) {
+            for (;;) {
+                BandKey key;
+                PagePlan plan;
+                {
+                    QMutexLocker locker(&planMutex);
+                    while (cursor.first < pages.size() && cursor.second >= qMax(1, planFor(cursor.first).bandCount)) {
+                        cursor = BandKey(cursor.first + 1, 0);
+                    }
+                    if (cursor.first >= pages.size()) break;
+                    key = cursor;
+                    plan = planFor(key.first);
+                    ++cursor.second;
+                }
+                if (plan.bandCount == 0) {
+                    // Nothing to render; the printer takes the empty band as a failure
+                    window.put(key, RenderedBand());
+                    continue;
+                }
+                if (d->cancelRequested) {
+                    window.cancel(); // Wakes the printing thread if it waits for a band
+                    break;
+                }
+                const QRect rect = plan.bandRect(key.second);
+                if (!window.reserve(key, qint64(rect.width()) * rect.height() * 4)) break;
+                window.put(key, Private::render(plan, key.second));
+            }
+            return;
+        }
+
+        QPainter painter;
+        if (!painter.begin(printer)) {
+            printError = QStringLiteral("The printer cannot be opened");
+            d->cancelRequested = true;
+            window.cancel();
+            return;
+        }
+        for (int position = 0; position < pages.size() && !d->cancelRequested; ++position) {
+            if (position > 0 && !printer->newPage()) {
+                printError = QStringLiteral("The printer did not take page %1").arg(position + 1);
+                break;
+            }
+            bool pageFailed = false;
+            PagePlan plan;
+            for (int band = 0; band == 0 || band < plan.bandCount; ++band) {
+                RenderedBand rendered;
+                if (!window.take(BandKey(position, band), &rendered)) break;
+                if (band == 0) {
+                    QMutexLocker locker(&planMutex);
+                    plan = plans.at(position);
+                }
+                if (rendered.image.isNull()) {
+                    pageFailed = true;
+                } else {
+                    TRACE_ZONE("PrintSpooler::paint");
+                    // Centred in the paint rectangle
+                    const QPoint origin((area.width() - plan.pixels.width()) / 2, (area.height() - plan.pixels.height()) / 2);
+                    painter.drawImage(plan.bandRect(band).translated(origin), rendered.image);
+                }
+                window.release(rendered.bytes);
+                if (plan.bandCount == 0 || d->cancelRequested) break;
+            }
+            if (d->cancelRequested) break;
+            if (pageFailed) {
+                ++failedPages;
+                LOG_WARN("PrintSpooler: Page " << pages.at(position) << " could not be rendered; left blank.");
+            }
+            const int pageIndex = pages.at(position);
+            const int printed = position + 1;
+            const int total = pages.size();
+            QMetaObject::invokeMethod(this, [this, pageIndex, printed, total]() {
+                emit pagePrinted(pageIndex, printed, total);
+            }, Qt::QueuedConnection);
+        }
+        if (d->cancelRequested || !printError.isEmpty()) {
+            d->cancelRequested = true;
+            window.cancel();
+            printer->abort();
+        }
+        painter.end();
+    };
+
+    QEventLoop loop;
+    ThreadPool::instance().submitDetached([&pool, &stage, &loop, renderers]() {
+        pool.forEach(renderers + 1, stage);
+        QMetaObject::invokeMethod(&loop, "quit", Qt::QueuedConnection);
+    });
+    loop.exec();
+    QCoreApplication::sendPostedEvents(this); // Progress of the last pages
+    d->running = false;
+
+    if (!printError.isEmpty()) {
+        d->error = printError;
+    } else if (d->cancelRequested) {
+        d->error = QStringLiteral("Canceled");
+    } else if (failedPages > 0) {
+        d->error = QStringLiteral("%1 pages could not be rendered").arg(failedPages.load());
+    }
+    if (!d->error.isEmpty()) {
+        LOG_WARN("PrintSpooler: Printing " << document->filePath() << " stopped: " << d->error);
+        return false;
+    }
+    LOG_INFO("PrintSpooler: " << pages.size() << " pages of " << document->filePath() << " sent to the printer.");
+    return true;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,110 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_PRINTSPOOLER_H
+#define QUANTILYX_PRINTSPOOLER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+class QPrinter;
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Prints pages rendered on worker threads at the printer's resolution.
+ *
+ * Each page is scaled to fit the printer's paint rectangle and rendered at
+ * the resolution that gives, in horizontal bands when the page renders
+ * regions directly and is larger than the band budget. Workers render
+ * bands ahead in print order while one thread paints them onto the printer
+ * in order; bands rendered but not yet printed never hold more than the
+ * memory window (Advanced/PrintMemoryMB, 256 by default), beyond the one
+ * band the printer is waiting for. A 600-dpi job therefore holds a few
+ * bands at a time rather than whole pages.
+ *
+ * print() runs a local event loop, so the window stays responsive and
+ * cancel() can be called from it.
+ */
+class PrintSpooler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit PrintSpooler(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~PrintSpooler() override;
+
+    /**
+     * @brief Set how many threads render bands.
+     * @param jobs Thread count; 0 or less means one per CPU.
+     */
+    void setJobs(int jobs);
+
+    /**
+     * @brief Set the memory rendered bands may hold while they wait to print.
+     * @param bytes Window in bytes; 0 or less for Advanced/PrintMemoryMB.
+     */
+    void setWindowBytes(qint64 bytes);
+
+    /**
+     * @brief Print pages of a document, blocking until done or canceled.
+     * Runs a local event loop, so it is called from the main thread.
+     * @param document Document to print; must outlive the call.
+     * @param printer Printer, set up by the caller (e.g. through QPrintDialog).
+     * @param pages Page indices in print order; empty for every page.
+     * @return True if every page was printed.
+     */
+    bool print(Document* document, QPrinter* printer, const QVector<int>& pages = QVector<int>());
+
+    /**
+     * @brief Stop printing after the band in progress. The printer job is aborted.
+     */
+    void cancel();
+
+    /**
+     * @brief Check if a print is running.
+     * @return True during print().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Get why the last print() failed.
+     * @return Error message; empty on success.
+     */
+    QString errorString() const;
+
+signals:
+    /**
+     * @brief Emitted after each page is painted onto the printer.
+     * @param pageIndex Index of the page in the document.
+     * @param printed Pages printed so far.
+     * @param total Pages in the job.
+     */
+    void pagePrinted(int pageIndex, int printed, int total);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_PRINTSPOOLER_H
@@ -10,6 +10,7 @@
 #include "ProfileManager.h"
 #include "Logger.h"
 #include "Settings.h" // Use our central Settings manager
+#include "PageCache.h"
 #include "utils/FileUtils.h" // Assuming this exists
 #include <QStandardPaths>
 #include <QDir>
@@ -22,6 +23,9 @@
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QSettings>
 
 namespace QuantilyxDoc {
 
@@ -38,6 +42,89 @@ public:
     QDir profilesDir;
     QString defaultProfileId;
 
+    // Every profile's settings.conf, read once, so a switch needs no disk
+    // reads. Profiles without the file are absent: their settings have not
+    // been captured yet, and switching to one keeps the current values.
+    using Values = QHash<QString, QVariant>;
+    QHash<QString, Values> profileSettings;
+
+    QString settingsPath(const QString& profileId) const {
+        return profileDir(profileId).filePath("settings.conf");
+    }
+
+    static Values readValues(const QString& path) {
+        Values values;
+        QSettings file(path, QSettings::IniFormat);
+        for (const QString& key : file.allKeys()) values.insert(key, file.value(key));
+        return values;
+    }
+
+    static bool writeValues(const QString& path, const Values& values) {
+        QSettings file(path, QSettings::IniFormat);
+        file.clear();
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) file.setValue(it.key(), it.value());
+        file.sync();
+        return file.status() == QSettings::NoError;
+    }
+
+    // The values Settings holds now
+    static Values currentSettings() {
+        Values values;
+        QSettings* settings = Settings::instance().qsettings();
+        for (const QString& key : settings->allKeys()) values.insert(key, settings->value(key));
+        return values;
+    }
+
+    // Keep a profile's settings, writing the file only if they changed
+    void storeProfileSettings(const QString& profileId, const Values& values) {
+        auto it = profileSettings.constFind(profileId);
+        if (it != profileSettings.constEnd() && *it == values) return;
+        profileSettings.insert(profileId, values);
+        if (!writeValues(settingsPath(profileId), values)) {
+            LOG_ERROR("Failed to write settings of profile " << profileId);
+        }
+    }
+
+    // Settings whose change alters rendered page images, so cached renders go stale
+    static const QSet<QString>& renderKeys() {
+        static const QSet<QString> keys = {"Display/EpubFont", "Display/EpubLayoutWidth", "Display/UseHighDpiPixmaps"};
+        return keys;
+    }
+
+    // Bring Settings to the target values, touching only the keys that
+    // differ, so only their valueChanged() receivers run. Must be called
+    // without the mutex, as receivers may call back in.
+    static QStringList applySettings(const Values& target) {
+        Settings& settings = Settings::instance();
+        const Values current = currentSettings();
+        QStringList changed;
+        for (auto it = target.constBegin(); it != target.constEnd(); ++it) {
+            if (current.value(it.key()) != it.value()) {
+                settings.setValue<QVariant>(it.key(), it.value());
+                changed.append(it.key());
+            }
+        }
+        for (auto it = current.constBegin(); it != current.constEnd(); ++it) {
+            if (target.contains(it.key())) continue;
+            if (settings.isRegistered(it.key())) settings.resetToDefault(it.key());
+            else settings.remove(it.key());
+            changed.append(it.key());
+        }
+
+        bool renderChanged = false;
+        for (const QString& key : qAsConst(changed)) {
+            if (renderKeys().contains(key)) {
+                renderChanged = true;
+                break;
+            }
+        }
+        if (renderChanged) {
+            PageCache::instance().clear();
+            LOG_INFO("Profile changes how pages render; cleared cached pages.");
+        }
+        return changed;
+    }
+
     // Helper to ensure profiles directory exists
     bool ensureProfilesDirExists() {
         if (!profilesDir.exists()) {
@@ -132,28 +219,24 @@ public:
         return success;
     }
 
-    // Helper to set the current profile, loading its settings
-    bool setCurrentProfileInternal(const QString& profileId) {
+    // Helper to make a profile current. Keeps the settings of the one
+    // left and returns the target's for the caller to apply unlocked;
+    // has is false when the target has none captured.
+    bool setCurrentProfileInternal(const QString& profileId, Values* target, bool* has) {
         if (!profiles.contains(profileId)) {
             LOG_ERROR("Cannot set current profile to non-existent ID: " << profileId);
             return false;
         }
 
-        QString oldProfileId = currentProfileId;
+        if (!currentProfileId.isEmpty()) storeProfileSettings(currentProfileId, currentSettings());
         currentProfileId = profileId;
         Profile& profile = profiles[profileId];
         profile.lastUsedTime = QDateTime::currentDateTime();
         saveProfileMetadataToDisk(profile); // Update last used time
 
-        // Load settings from the new profile's directory
-        Settings& settings = Settings::instance();
-        QDir settingsDir = profile.settingsDirectory;
-        QString settingsPath = settingsDir.filePath("settings.conf");
-        // This assumes Settings class can load from a specific path.
-        // settings.loadFromPath(settingsPath); // Hypothetical method
-        // For now, we'll just log the switch.
-        LOG_INFO("Switched profile from '" << oldProfileId << "' to '" << profileId << "'");
-        emit q->profileChanged(oldProfileId, profileId);
+        auto it = profileSettings.constFind(profileId);
+        *has = it != profileSettings.constEnd();
+        if (*has) *target = *it;
         return true;
     }
 };
@@ -199,6 +282,9 @@ bool ProfileManager::initialize()
         Profile profile = d->loadProfileFromDisk(dirName);
         if (!profile.id.isEmpty()) { // Check if loading was successful
             d->profiles.insert(profile.id, profile);
+            if (QFile::exists(d->settingsPath(profile.id))) {
+                d->profileSettings.insert(profile.id, Private::readValues(d->settingsPath(profile.id)));
+            }
             LOG_DEBUG("Loaded profile: " << profile.name << " (ID: " << profile.id << ")");
         }
     }
@@ -206,7 +292,9 @@ bool ProfileManager::initialize()
     // Ensure default profile exists
     if (!d->profiles.contains(d->defaultProfileId)) {
         LOG_INFO("Default profile '" << d->defaultProfileId << "' does not exist, creating it.");
+        locker.unlock(); // createProfile() takes the lock itself
         createProfile("Default Profile", "The default application profile.");
+        locker.relock();
     }
 
     // Set the current profile to the default (or the first one if default is missing)
@@ -215,15 +303,20 @@ bool ProfileManager::initialize()
         initialProfileId = d->profiles.begin().key(); // Fallback to first profile
     }
 
-    if (!initialProfileId.isEmpty()) {
-        d->setCurrentProfileInternal(initialProfileId);
-    } else {
+    Private::Values target;
+    bool hasSettings = false;
+    if (initialProfileId.isEmpty() || !d->setCurrentProfileInternal(initialProfileId, &target, &hasSettings)) {
         LOG_ERROR("No profiles found and could not create default. ProfileManager failed to initialize correctly.");
         return false;
     }
+    const int profileCount = d->profiles.size();
+    locker.unlock();
 
+    // Settings normally hold this profile's values already, leaving nothing to apply
+    if (hasSettings) Private::applySettings(target);
+    emit profileChanged(QString(), initialProfileId);
     emit profilesListChanged();
-    LOG_INFO("ProfileManager initialized with " << d->profiles.size() << " profiles. Current: " << d->currentProfileId);
+    LOG_INFO("ProfileManager initialized with " << profileCount << " profiles. Current: " << initialProfileId);
     return true;
 }
 
@@ -239,18 +332,29 @@ const ProfileManager::Profile* ProfileManager::currentProfile() const
 
 bool ProfileManager::switchToProfile(const QString& profileId)
 {
-    if (profileId == d->currentProfileId) return true; // Already active
-
-    QMutexLocker locker(&d->mutex);
-    if (!d->profiles.contains(profileId)) {
-        LOG_WARN("Cannot switch to non-existent profile: " << profileId);
-        return false;
+    QElapsedTimer timer;
+    timer.start();
+    QString oldProfileId;
+    Private::Values target;
+    bool hasSettings = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (profileId == d->currentProfileId) return true; // Already active
+        if (!d->profiles.contains(profileId)) {
+            LOG_WARN("Cannot switch to non-existent profile: " << profileId);
+            return false;
+        }
+        oldProfileId = d->currentProfileId;
+        // Keeps the current profile's state before switching
+        if (!d->setCurrentProfileInternal(profileId, &target, &hasSettings)) return false;
     }
 
-    // Save current profile's state before switching
-    saveCurrentProfile();
-
-    return d->setCurrentProfileInternal(profileId);
+    // Only the settings that differ between the profiles change
+    const QStringList changed = hasSettings ? Private::applySettings(target) : QStringList();
+    LOG_INFO("Switched profile from '" << oldProfileId << "' to '" << profileId << "' in " << timer.elapsed()
+             << " ms; " << changed.size() << " settings changed");
+    emit profileChanged(oldProfileId, profileId);
+    return true;
 }
 
 QString ProfileManager::createProfile(const QString& name, const QString& description)
@@ -279,6 +383,7 @@ QString ProfileManager::createProfile(const QString& name, const QString& descri
 
     if (d->saveProfileMetadataToDisk(newProfile)) {
         d->profiles.insert(profileId, newProfile);
+        d->storeProfileSettings(profileId, Private::currentSettings()); // Starts as a copy of the current settings
         LOG_INFO("Created new profile: " << name << " (ID: " << profileId << ")");
         emit profileCreated(profileId);
         emit profilesListChanged();
@@ -312,13 +417,18 @@ bool ProfileManager::removeProfile(const QString& profileId)
     }
 
     d->profiles.erase(it);
+    d->profileSettings.remove(profileId);
+    const bool wasCurrent = profileId == d->currentProfileId;
+    if (wasCurrent) d->currentProfileId.clear(); // Nothing left to keep its settings in
+    const QString defaultId = d->defaultProfileId;
+    locker.unlock();
     LOG_INFO("Removed profile: " << profileId);
     emit profileRemoved(profileId);
     emit profilesListChanged();
 
     // If the removed profile was current, switch to default
-    if (profileId == d->currentProfileId) {
-        switchToProfile(d->defaultProfileId);
+    if (wasCurrent) {
+        switchToProfile(defaultId);
     }
 
     return true;
@@ -461,8 +571,7 @@ void ProfileManager::saveCurrentProfile()
     auto it = d->profiles.find(d->currentProfileId);
     if (it != d->profiles.end()) {
         QDir settingsDir = it->settingsDirectory;
-        QString settingsPath = settingsDir.filePath("settings.conf");
-        // Settings::instance().saveToPath(settingsPath); // Hypothetical method
+        d->storeProfileSettings(d->currentProfileId, Private::currentSettings()); // Written only if changed
         LOG_DEBUG("Saved current profile state to: " << settingsDir.absolutePath());
     } else {
         LOG_WARN("saveCurrentProfile: Current profile ID '" << d->currentProfileId << "' not found in profiles list.");
@@ -484,8 +593,13 @@ void ProfileManager::loadCurrentProfile()
     auto it = d->profiles.find(d->currentProfileId);
     if (it != d->profiles.end()) {
         QDir settingsDir = it->settingsDirectory;
-        QString settingsPath = settingsDir.filePath("settings.conf");
-        // Settings::instance().loadFromPath(settingsPath); // Hypothetical method
+        // Read from disk again, as the file may have been edited outside the application
+        const QString settingsPath = d->settingsPath(d->currentProfileId);
+        if (!QFile::exists(settingsPath)) return;
+        const Private::Values values = Private::readValues(settingsPath);
+        d->profileSettings.insert(d->currentProfileId, values);
+        locker.unlock();
+        Private::applySettings(values);
         LOG_DEBUG("Loaded current profile state from: " << settingsDir.absolutePath());
     } else {
         LOG_WARN("loadCurrentProfile: Current profile ID '" << d->currentProfileId << "' not found in profiles list.");
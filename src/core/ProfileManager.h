@@ -79,6 +79,11 @@ public:
     /**
      * @brief Switch to a different profile.
      * Loads the settings and layout associated with the specified profile.
+     * Every profile's settings are read at initialize(), so a switch reads
+     * nothing from disk: it keeps the current settings for the profile
+     * left (writing them only if they changed) and sets only the keys that
+     * differ in the new one. Cached page renders are dropped only if a
+     * setting that changes how pages render differs.
      * @param profileId The ID of the profile to switch to.
      * @return True if the switch was successful.
      */
@@ -224,6 +229,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static ProfileManager* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -8,18 +8,30 @@
  * (at your option) any later version.
  */
 #include "ProgressiveRenderer.h"
+#include "BandedRenderer.h"
+#include "ImageBufferPool.h"
 #include "Page.h"
 #include "Document.h"
 #include "Logger.h"
+#include "PageCache.h"
+#include "PixelFormat.h"
+#include "RenderRegistry.h"
+#include "Settings.h"
+#include "ThreadRender.h"
+#include "Tracing.h"
 #include "ThreadPool.h" // Use our custom ThreadPool for passes
 #include "Task.h"       // Use our custom Task
 #include <QMutex>
 #include <QMutexLocker>
 #include <QDateTime>
 #include <QImage>
-#include <QPainter>
 #include <QCoreApplication>
 #include <QThread>
+#include <QTransform>
+#include <QVector>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QtMath>
 #include <QDebug>
 #include <algorithm> // For std::find, std::remove
 
@@ -34,11 +46,13 @@ struct RenderRequestInternal {
     int rotation;
     QRectF clipRect;
     int qualityLevels;
-    QList<RenderPass> passes;
+    QList<ProgressiveRenderer::RenderPass> passes;
     bool canceled;
     QDateTime requestTime;
+    quintptr documentId; // Non-zero if the final pass is claimed in RenderRegistry
+    PageCache::CacheKey cacheKey; // Key claimed for the final pass
 
-    RenderRequestInternal(quintptr reqId) : id(reqId), canceled(false) {}
+    RenderRequestInternal(quintptr reqId) : id(reqId), canceled(false), documentId(0) {}
 };
 
 class ProgressiveRenderer::Private {
@@ -51,6 +65,7 @@ public:
     QHash<quintptr, RenderRequestInternal> requestMap; // All requests (queued, active)
     QQueue<quintptr> requestQueue; // IDs of queued requests
     QSet<quintptr> activeRequestIds; // IDs of currently processing requests
+    QHash<quintptr, PageCache::CacheKey> joinedRequests; // IDs waiting on another render of the same key
     int maxConcurrent;
     bool enabled;
     int defaultQualityLvls;
@@ -94,6 +109,78 @@ public:
         }
     }
 
+    // True if the remaining passes of a request are no longer wanted. A
+    // canceled owner whose result others are waiting for keeps going for them.
+    bool isStale(quintptr requestId) const {
+        QMutexLocker locker(&mutex);
+        auto it = requestMap.constFind(requestId);
+        if (it == requestMap.constEnd()) return true;
+        if (!it->canceled) return false;
+        return it->documentId == 0 || RenderRegistry::instance().waiterCount(it->cacheKey) == 0;
+    }
+
+    // Cancel older requests for the same region of the same page; a newer
+    // zoom or rotation makes their passes useless. Call with the mutex held
+    // and emit renderCanceled() for the returned IDs once it is released.
+    QVector<quintptr> supersedeOlder(const RenderRequestInternal& newer) {
+        QVector<quintptr> superseded;
+        for (auto it = requestMap.begin(); it != requestMap.end();) {
+            if (it->canceled || it->page != newer.page || it->clipRect != newer.clipRect) {
+                ++it;
+                continue;
+            }
+            const quintptr id = it->id;
+            LOG_DEBUG("Progressive render request " << id << " superseded by " << newer.id);
+            if (activeRequestIds.contains(id)) {
+                // Its running pass sees the flag and drops the entry
+                it->canceled = true;
+                ++it;
+            } else {
+                // Never dequeued again, so nothing else would erase it
+                requestQueue.removeAll(id);
+                if (it->documentId != 0) {
+                    RenderRegistry::instance().abandon(it->cacheKey, id);
+                }
+                it = requestMap.erase(it);
+            }
+            superseded.append(id);
+        }
+        return superseded;
+    }
+
+    // Rasterize one pass. targetSize is the rotated page; a valid clipRect
+    // limits rendering to that region, in unrotated page points.
+    static QImage renderPass(Page* page, const ProgressiveRenderer::RenderPass& pass, bool draft) {
+        QSizeF pageSize = page->size();
+        if (pageSize.isEmpty() || pass.targetSize.isEmpty()) return QImage();
+
+        QSize unrotatedSize = pass.targetSize;
+        if (pass.rotation == 90 || pass.rotation == 270) {
+            unrotatedSize.transpose();
+        }
+        qreal scale = qMin(unrotatedSize.width() / pageSize.width(), unrotatedSize.height() / pageSize.height());
+
+        QImage image;
+        if (pass.clipRect.isValid()) {
+            QSize regionSize(qMax(1, qRound(pass.clipRect.width() * scale)), qMax(1, qRound(pass.clipRect.height() * scale)));
+            image = draft ? page->renderDraft(pass.clipRect, regionSize.width(), regionSize.height())
+                          : page->renderRectangle(pass.clipRect, regionSize.width(), regionSize.height());
+        } else {
+            if (draft) {
+                image = page->renderDraft(QRectF(), unrotatedSize.width(), unrotatedSize.height());
+            } else if (BandedRenderer::shouldBand(page, unrotatedSize)) {
+                image = BandedRenderer::render(page, unrotatedSize);
+            } else {
+                image = page->render(unrotatedSize.width(), unrotatedSize.height());
+            }
+        }
+        image = ImageBufferPool::toPipelineFormat(std::move(image));
+        if (!image.isNull() && pass.rotation != 0) {
+            image = image.transformed(QTransform().rotate(pass.rotation));
+        }
+        return image;
+    }
+
     // Helper to find next request to process
     quintptr getNextRequestIdToProcess() {
         while (!requestQueue.isEmpty()) {
@@ -136,12 +223,44 @@ ProgressiveRenderer::~ProgressiveRenderer()
 
 quintptr ProgressiveRenderer::requestRender(Page* page, const QSize& initialSize, const QSize& finalSize,
                                            qreal zoomLevel, int rotation, const QRectF& clipRect,
-                                           int qualityLevels)
+                                           int qualityLevels, quintptr documentId)
 {
     if (!page || !enabled()) return 0;
 
     QMutexLocker locker(&d->mutex);
-    quintptr requestId = reinterpret_cast<quintptr>(this) ^ QDateTime::currentMSecsSinceEpoch() ^ d->requestMap.size(); // Simple ID generation
+    const quintptr requestId = RenderThread::nextRequestId();
+
+    PageCache::CacheKey cacheKey;
+    if (documentId != 0) {
+        cacheKey.documentId = documentId;
+        cacheKey.pageIndex = page->pageIndex();
+        cacheKey.zoomLevel = zoomLevel;
+        cacheKey.rotation = rotation;
+        cacheKey.targetSize = finalSize;
+
+        // Join a render already producing this page at this size. The result
+        // is delivered through the event loop: finish() may be called while
+        // our mutex is held.
+        bool owner = RenderRegistry::instance().beginOrJoin(cacheKey, requestId,
+            [this, requestId](const QImage& image, bool success) {
+                QMetaObject::invokeMethod(this, [this, requestId, image, success]() {
+                    {
+                        QMutexLocker resLocker(&d->mutex);
+                        if (!d->joinedRequests.remove(requestId)) return; // Canceled meanwhile
+                    }
+                    if (success) {
+                        emit renderCompleted(requestId, image);
+                    } else {
+                        emit renderFailed(requestId, "Shared render failed or was canceled");
+                    }
+                }, Qt::QueuedConnection);
+            });
+        if (!owner) {
+            d->joinedRequests.insert(requestId, cacheKey);
+            LOG_DEBUG("Progressive render request " << requestId << " joined an in-flight render of page " << page->pageIndex());
+            return requestId;
+        }
+    }
 
     RenderRequestInternal request(requestId);
     request.page = page;
@@ -152,15 +271,23 @@ quintptr ProgressiveRenderer::requestRender(Page* page, const QSize& initialSize
     request.clipRect = clipRect;
     request.qualityLevels = (qualityLevels > 0) ? qualityLevels : d->defaultQualityLvls;
     request.requestTime = QDateTime::currentDateTime();
+    request.documentId = documentId;
+    request.cacheKey = cacheKey;
 
     d->generatePasses(request); // Calculate the rendering passes needed
+    const QVector<quintptr> superseded = d->supersedeOlder(request);
 
     d->requestMap.insert(requestId, request);
     d->requestQueue.enqueue(requestId);
+    const int queuedCount = d->requestQueue.size();
+    const int activeCount = d->activeCount;
 
     LOG_DEBUG("Queued progressive render request: " << requestId << " for page " << page->pageIndex());
 
-    emit queueStatusChanged(d->requestQueue.size(), d->activeCount);
+    // Slots connected directly may call back in, so nothing is emitted under the mutex
+    locker.unlock();
+    for (quintptr id : superseded) emit renderCanceled(id);
+    emit queueStatusChanged(queuedCount, activeCount);
 
     // Potentially trigger processing
     QMetaObject::invokeMethod(this, &ProgressiveRenderer::processNextRequest, Qt::QueuedConnection);
@@ -171,6 +298,15 @@ quintptr ProgressiveRenderer::requestRender(Page* page, const QSize& initialSize
 void ProgressiveRenderer::cancelRequest(quintptr requestId)
 {
     QMutexLocker locker(&d->mutex);
+    auto joined = d->joinedRequests.find(requestId);
+    if (joined != d->joinedRequests.end()) {
+        // Only stop waiting; the shared render goes on for its owner
+        RenderRegistry::instance().withdraw(joined.value(), requestId);
+        d->joinedRequests.erase(joined);
+        emit renderCanceled(requestId);
+        return;
+    }
+
     auto it = d->requestMap.find(requestId);
     if (it != d->requestMap.end()) {
         it->canceled = true; // Mark for cancellation
@@ -181,6 +317,10 @@ void ProgressiveRenderer::cancelRequest(quintptr requestId)
         } else {
             // Remove from queue if it's still there
             d->requestQueue.removeAll(requestId);
+            if (it->documentId != 0) {
+                RenderRegistry::instance().abandon(it->cacheKey, requestId);
+            }
+            d->requestMap.erase(it);
             LOG_DEBUG("Removed queued request for cancellation: " << requestId);
         }
         emit renderCanceled(requestId);
@@ -194,9 +334,21 @@ void ProgressiveRenderer::cancelAllRequests()
 {
     QMutexLocker locker(&d->mutex);
     int count = d->requestMap.size();
-    for (auto& request : d->requestMap) {
-        request.canceled = true;
+    for (auto it = d->requestMap.begin(); it != d->requestMap.end();) {
+        if (d->activeRequestIds.contains(it->id)) {
+            it->canceled = true; // Its running pass drops the entry
+            ++it;
+            continue;
+        }
+        if (it->documentId != 0) {
+            RenderRegistry::instance().abandon(it->cacheKey, it->id);
+        }
+        it = d->requestMap.erase(it); // The queue is cleared below
     }
+    for (auto it = d->joinedRequests.constBegin(); it != d->joinedRequests.constEnd(); ++it) {
+        RenderRegistry::instance().withdraw(it.value(), it.key());
+    }
+    d->joinedRequests.clear();
     d->requestQueue.clear();
     LOG_DEBUG("Marked all " << count << " requests for cancellation.");
     emit queueStatusChanged(0, d->activeCount);
@@ -280,6 +432,7 @@ QVariantMap ProgressiveRenderer::statistics() const
 
 void ProgressiveRenderer::processNextRequest()
 {
+    TRACE_ZONE("ProgressiveRenderer::processNextRequest");
     QMutexLocker locker(&d->mutex);
 
     // Check if we can start another request
@@ -309,23 +462,24 @@ void ProgressiveRenderer::processNextRequest()
 
     LOG_DEBUG("Starting progressive render request: " << requestId << " with " << request.passes.size() << " passes.");
 
-    // Create a Task that will handle all passes for this request sequentially
+    // Create a Task that will handle all passes for this request sequentially.
+    // The captured copy is only read for its parameters; cancellation is
+    // checked against the live map between passes.
     Task* renderTask = new Task([this, requestId, request]() {
-        // Capture request by value to avoid lifetime issues with the main thread's map
-        // In a real implementation, you'd need a more robust way to ensure the Page object is valid.
-        if (!request.page || request.canceled) {
+        if (!request.page || d->isStale(requestId)) {
              LOG_DEBUG("Render task started but request was canceled or page invalid: " << requestId);
-             // Report cancellation/failure on main thread
-             QMetaObject::invokeMethod(this, [this, requestId]() {
+             QMetaObject::invokeMethod(this, [this, requestId, request]() {
                  QMutexLocker resLocker(&d->mutex); // Lock to update active count
                  d->activeRequestIds.remove(requestId);
                  d->activeCount--;
-                 if (request.canceled) {
-                     emit renderCanceled(requestId);
-                 } else {
+                 const bool canceled = !d->requestMap.contains(requestId) || d->requestMap.value(requestId).canceled;
+                 d->requestMap.remove(requestId);
+                 if (request.documentId != 0) {
+                     RenderRegistry::instance().abandon(request.cacheKey, requestId);
+                 }
+                 if (!canceled) { // renderCanceled was emitted when it was canceled
                      emit renderFailed(requestId, "Page became invalid");
                  }
-                 // Process next
                  QMetaObject::invokeMethod(this, &ProgressiveRenderer::processNextRequest, Qt::QueuedConnection);
              }, Qt::QueuedConnection);
              return;
@@ -337,79 +491,70 @@ void ProgressiveRenderer::processNextRequest()
         QString overallError;
 
         for (const auto& pass : request.passes) {
-            if (request.canceled) {
-                LOG_DEBUG("Render request " << requestId << " was canceled during pass " << pass.passNumber);
+            if (pass.passNumber > 0 && d->isStale(requestId)) {
+                LOG_DEBUG("Render request " << requestId << " was canceled or superseded before pass " << pass.passNumber);
                 overallSuccess = false;
                 overallError = "Request canceled";
                 break;
             }
 
-            // --- Simulated Rendering Pass ---
-            // In a real implementation, this would call the page's renderer with the specific pass parameters.
-            // It might involve scaling, applying filters, rendering specific layers, etc.
-            // For this stub, we'll create a placeholder image based on the pass size and page info.
-            QThread::msleep(50 + (pass.passNumber * 20)); // Simulate increasing time for higher quality passes
-
-            QImage image(pass.targetSize, QImage::Format_ARGB32_Premultiplied);
-            if (image.isNull()) {
-                overallSuccess = false;
-                overallError = "Failed to create image buffer for pass " + QString::number(pass.passNumber);
-                LOG_ERROR(overallError);
-                break;
-            }
-            image.fill(Qt::lightGray); // Placeholder background
-            QPainter painter(&image);
-            if (!painter.isActive()) {
-                 overallSuccess = false;
-                 overallError = "Failed to initialize painter for pass " + QString::number(pass.passNumber);
-                 LOG_ERROR(overallError);
-                 break;
-            }
-            // Draw a simple representation of the page content
-            painter.fillRect(5, 5, image.width() - 10, 20, QColor(200, 220, 255)); // Header
-            painter.setPen(Qt::black);
-            painter.drawText(QRect(10, 10, image.width() - 20, 15), Qt::AlignLeft, QString("Page %1 - Pass %2").arg(page->pageIndex()).arg(pass.passNumber));
-            painter.fillRect(5, 35, image.width() - 10, image.height() - 40, QColor(240, 240, 240)); // Body
-            painter.end();
-            // --- End Simulated Pass ---
+            // The first of several passes skips antialiasing so something
+            // readable shows up quickly; the rest render at full quality.
+            const bool draft = (pass.passNumber == 0 && !pass.isFinalPass);
+            QElapsedTimer timer;
+            timer.start();
+            QImage image = Private::renderPass(page, pass, draft);
 
             PassResult result;
             result.passNumber = pass.passNumber;
-            result.image = image;
-            result.success = true; // Assume success in this stub
-            result.errorMessage = "";
-            result.durationMs = pass.timer.elapsed(); // Timer not actually started in stub
+            result.success = !image.isNull();
+            result.image = std::move(image);
+            result.errorMessage = result.success ? QString() : "Page rendering failed in pass " + QString::number(pass.passNumber);
+            result.durationMs = timer.elapsed();
             result.isFinal = pass.isFinalPass;
 
-            if (result.success) {
-                finalImage = result.image; // Update final image if this was the last pass
-                LOG_DEBUG("Completed render pass " << pass.passNumber << " for request " << requestId);
-            } else {
+            if (!result.success) {
                 overallSuccess = false;
                 overallError = result.errorMessage;
                 LOG_ERROR("Render pass " << pass.passNumber << " failed for request " << requestId << ": " << result.errorMessage);
                 break; // Stop further passes on failure
             }
+            finalImage = result.image;
+            LOG_DEBUG("Completed render pass " << pass.passNumber << " for request " << requestId << " in " << result.durationMs << " ms");
 
             // Emit pass completion on main thread
             QMetaObject::invokeMethod(this, [this, requestId, result]() {
                  emit passCompleted(requestId, result);
             }, Qt::QueuedConnection);
+        }
 
-            // Small delay between passes to simulate real rendering and allow UI updates
-            // QThread::msleep(10); // Maybe not needed if rendering is already slow enough
+        if (overallSuccess && request.documentId != 0) {
+            if (Settings::snapshot().compactScannedPages) {
+                finalImage = PixelFormat::compact(finalImage); // See RenderThread
+            }
+            // Registered by content, so identical pages can share it (see RenderThread)
+            const QByteArray digest = Settings::snapshot().contentAddressedPages ? page->contentDigest() : QByteArray();
+            PageCache::instance().put(request.cacheKey, finalImage, digest);
         }
 
         // Report final result on main thread
-        QMetaObject::invokeMethod(this, [this, requestId, finalImage, overallSuccess, overallError]() {
+        QMetaObject::invokeMethod(this, [this, requestId, request, finalImage, overallSuccess, overallError]() {
              QMutexLocker resLocker(&d->mutex); // Lock to update active count
              d->activeRequestIds.remove(requestId);
              d->activeCount--;
 
              // Remove the request from the map as it's done
+             const bool canceled = !d->requestMap.contains(requestId) || d->requestMap.value(requestId).canceled;
              d->requestMap.remove(requestId);
 
-             if (overallSuccess) {
+             // Share the final image with requests that joined this render
+             if (request.documentId != 0) {
+                 RenderRegistry::instance().finish(request.cacheKey, requestId, finalImage, overallSuccess);
+             }
+
+             if (canceled) {
+                 LOG_DEBUG("Progressive render request ended after cancellation: " << requestId);
+             } else if (overallSuccess) {
                  emit renderCompleted(requestId, finalImage);
                  LOG_DEBUG("Successfully completed progressive render request: " << requestId);
              } else {
@@ -92,11 +92,14 @@ public:
      * @param rotation Page rotation.
      * @param clipRect Optional clipping rectangle.
      * @param qualityLevels Number of quality levels/steps to render (default 3).
+     * @param documentId PageCache document ID. When set, the final pass is
+     * claimed in RenderRegistry; if that page is already being rendered at
+     * finalSize, no passes run and renderCompleted() carries the shared result.
      * @return A unique request ID.
      */
     quintptr requestRender(Page* page, const QSize& initialSize, const QSize& finalSize,
                            qreal zoomLevel, int rotation, const QRectF& clipRect = QRectF(),
-                           int qualityLevels = 3);
+                           int qualityLevels = 3, quintptr documentId = 0);
 
     /**
      * @brief Cancel a pending progressive render request.
@@ -204,6 +207,8 @@ private slots:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static ProgressiveRenderer* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,207 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ReadAhead.h"
+#include "ThreadPool.h"
+#include "Settings.h"
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Ranges closer than this are fetched as one
+const qint64 MergeGap = 64 * 1024;
+// Fallback reads are split into chunks so several I/O workers share a range
+const qint64 ChunkSize = 1024 * 1024;
+const qint64 ScratchSize = 256 * 1024;
+// Descriptors kept open for hints, so repeated hints skip the open round trip
+const int MaxOpenFiles = 8;
+
+} // namespace
+
+class ReadAhead::Private {
+public:
+    struct Range {
+        qint64 offset;
+        qint64 end; // Exclusive; -1 for the end of the file
+    };
+
+    struct OpenFile {
+        std::shared_ptr<QFile> file; // QHash values must be copyable
+        quint64 lastUse = 0;
+    };
+
+    Private()
+        : dispatchQueued(false), useCounter(0), prefetched(0),
+          enabled(Settings::instance().value<bool>("Advanced/ReadAhead", true)),
+          window(qMax(64, Settings::instance().value<int>("Advanced/ReadAheadKB", 4096)) * Q_INT64_C(1024)) {}
+
+    QMutex mutex; // Protects pending and dispatchQueued
+    QHash<QString, QVector<Range>> pending;
+    bool dispatchQueued;
+
+    QMutex fileMutex; // Protects files
+    QHash<QString, OpenFile> files;
+    quint64 useCounter;
+
+    std::atomic<quint64> prefetched;
+    bool enabled;
+    qint64 window;
+
+    // Sorted, clamped to the file and with near neighbours joined
+    static QVector<Range> normalize(QVector<Range> ranges, qint64 fileSize) {
+        for (Range& range : ranges) {
+            if (range.end < 0 || range.end > fileSize) range.end = fileSize;
+        }
+        std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.offset < b.offset; });
+        QVector<Range> merged;
+        for (const Range& range : ranges) {
+            if (range.offset >= range.end) continue;
+            if (!merged.isEmpty() && range.offset <= merged.last().end + MergeGap) {
+                merged.last().end = qMax(merged.last().end, range.end);
+            } else {
+                merged.append(range);
+            }
+        }
+        return merged;
+    }
+
+    // Call with fileMutex held
+    QFile* openFile(const QString& path) {
+        auto it = files.find(path);
+        if (it == files.end()) {
+            std::shared_ptr<QFile> file = std::make_shared<QFile>(path);
+            if (!file->open(QIODevice::ReadOnly)) return nullptr;
+            if (files.size() >= MaxOpenFiles) {
+                auto oldest = std::min_element(files.begin(), files.end(),
+                                               [](const OpenFile& a, const OpenFile& b) { return a.lastUse < b.lastUse; });
+                files.erase(oldest);
+            }
+            it = files.insert(path, OpenFile());
+            it->file = std::move(file);
+        }
+        it->lastUse = ++useCounter;
+        return it->file.get();
+    }
+
+    // Starts an asynchronous kernel read; false if the OS cannot
+    static bool advise(QFile* file, const Range& range) {
+#ifdef Q_OS_LINUX
+        return posix_fadvise(file->handle(), range.offset, range.end - range.offset, POSIX_FADV_WILLNEED) == 0;
+#else
+        Q_UNUSED(file);
+        Q_UNUSED(range);
+        return false;
+#endif
+    }
+
+    void readChunks(const QString& path, const Range& range) {
+        for (qint64 offset = range.offset; offset < range.end; offset += ChunkSize) {
+            const qint64 end = qMin(range.end, offset + ChunkSize);
+            ThreadPool::ioInstance().submitDetached([this, path, offset, end]() {
+                QFile file(path);
+                if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) return;
+                QByteArray scratch(static_cast<int>(qMin(ScratchSize, end - offset)), Qt::Uninitialized);
+                qint64 position = offset;
+                while (position < end) {
+                    const qint64 read = file.read(scratch.data(), qMin<qint64>(scratch.size(), end - position));
+                    if (read <= 0) break;
+                    position += read;
+                }
+                prefetched += position - offset;
+            }, Task::Priority::Low);
+        }
+    }
+
+    void dispatch() {
+        QHash<QString, QVector<Range>> batch;
+        {
+            QMutexLocker locker(&mutex);
+            batch.swap(pending);
+            dispatchQueued = false;
+        }
+        for (auto it = batch.begin(); it != batch.end(); ++it) {
+            QMutexLocker locker(&fileMutex);
+            QFile* file = openFile(it.key());
+            if (!file) continue;
+            for (const Range& range : normalize(it.value(), file->size())) {
+                if (advise(file, range)) {
+                    prefetched += range.end - range.offset;
+                } else {
+                    readChunks(it.key(), range);
+                }
+            }
+        }
+    }
+};
+
+// Static instance pointer
+ReadAhead* ReadAhead::s_instance = nullptr;
+
+ReadAhead& ReadAhead::instance()
+{
+    if (!s_instance) {
+        s_instance = new ReadAhead();
+    }
+    return *s_instance;
+}
+
+ReadAhead::ReadAhead()
+    : d(new Private())
+{
+}
+
+ReadAhead::~ReadAhead() = default;
+
+bool ReadAhead::isEnabled() const
+{
+    return d->enabled;
+}
+
+void ReadAhead::prefetch(const QString& filePath, qint64 offset, qint64 length)
+{
+    if (!d->enabled || filePath.isEmpty() || offset < 0 || length < 0) return;
+
+    QMutexLocker locker(&d->mutex);
+    d->pending[filePath].append(Private::Range{offset, length > 0 ? offset + length : -1});
+    if (d->dispatchQueued) return; // Joins the batch already on its way
+    d->dispatchQueued = true;
+    locker.unlock();
+
+    Private* priv = d.get();
+    ThreadPool::ioInstance().submitDetached([priv]() { priv->dispatch(); }, Task::Priority::Low);
+}
+
+void ReadAhead::prefetchAfter(const QString& filePath, qint64 offset)
+{
+    prefetch(filePath, offset, d->window);
+}
+
+qint64 ReadAhead::windowBytes() const
+{
+    return d->window;
+}
+
+quint64 ReadAhead::prefetchedBytes() const
+{
+    return d->prefetched.load();
+}
+
+} // namespace QuantilyxDoc
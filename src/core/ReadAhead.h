@@ -0,0 +1,88 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_READAHEAD_H
+#define QUANTILYX_READAHEAD_H
+
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Warms the OS page cache for file ranges that will be read soon.
+ *
+ * Hints are queued and handed to the I/O ThreadPool in batches. Each batch
+ * merges nearby ranges of the same file. On Linux a batch becomes
+ * posix_fadvise(POSIX_FADV_WILLNEED) calls, which start asynchronous
+ * kernel reads and return at once, so many requests are in flight in
+ * parallel even on high-latency network mounts. Where that is not
+ * available, ranges are read into a scratch buffer in chunks spread over
+ * the I/O workers. The actual reader then finds the data in memory.
+ *
+ * Disabled with Advanced/ReadAhead; the default window for
+ * prefetchAfter() comes from Advanced/ReadAheadKB.
+ */
+class ReadAhead
+{
+public:
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global ReadAhead instance.
+     */
+    static ReadAhead& instance();
+
+    ~ReadAhead();
+
+    /**
+     * @brief Check if read-ahead hints are acted on.
+     * @return True if enabled.
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Ask for a file range to be brought into memory in the background.
+     * @param filePath File to read.
+     * @param offset First byte of the range.
+     * @param length Range length in bytes, or 0 for the rest of the file.
+     */
+    void prefetch(const QString& filePath, qint64 offset = 0, qint64 length = 0);
+
+    /**
+     * @brief Prefetch the read-ahead window that follows a position, for
+     * readers that walk a file from front to back.
+     * @param filePath File to read.
+     * @param offset Position just read up to.
+     */
+    void prefetchAfter(const QString& filePath, qint64 offset);
+
+    /**
+     * @brief Get the read-ahead window used by prefetchAfter().
+     * @return Window in bytes.
+     */
+    qint64 windowBytes() const;
+
+    /**
+     * @brief Get the number of bytes handed to the OS or read so far.
+     * @return Prefetched bytes.
+     */
+    quint64 prefetchedBytes() const;
+
+private:
+    ReadAhead();
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static ReadAhead* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_READAHEAD_H
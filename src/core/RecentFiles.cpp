@@ -9,6 +9,12 @@
  */
 #include "RecentFiles.h"
 #include "Logger.h"
+#include "MetadataDatabase.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include "ThumbnailStore.h"
+#include <QFile>
+#include <QPointer>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QFileInfo>
@@ -16,10 +22,58 @@
 #include <QDateTime>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QTimer>
 #include <algorithm> // For std::stable_sort
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// What one background check found about a file
+struct FileCheck {
+    QString filePath;
+    bool exists = false;
+    qint64 size = 0;
+    int pageCount = 0;
+    QString thumbnailKey; // ThumbnailStore content key, looked up on the GUI thread
+};
+
+// Mount points, longest first so the first prefix match is the closest mount
+QStringList mountPoints()
+{
+    QStringList mounts;
+#ifdef Q_OS_LINUX
+    // Reading /proc stats nothing on the mounts themselves, so it cannot hang
+    QFile file(QStringLiteral("/proc/self/mounts"));
+    if (file.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : file.readAll().split('\n')) {
+            QByteArray mount = line.split(' ').value(1);
+            if (mount.isEmpty()) continue;
+            // Spaces and the like are written as octal escapes
+            mount.replace("\\040", " ").replace("\\011", "\t").replace("\\134", "\\");
+            mounts.append(QString::fromLocal8Bit(mount));
+        }
+    }
+#endif
+    std::sort(mounts.begin(), mounts.end(), [](const QString& a, const QString& b) { return a.size() > b.size(); });
+    return mounts;
+}
+
+// The mount a path lives on, worked out from the path alone
+QString mountOf(const QString& filePath, const QStringList& mounts)
+{
+    const QString path = QDir::fromNativeSeparators(filePath);
+    for (const QString& mount : mounts) {
+        if (mount == "/" || path == mount || path.startsWith(mount + '/')) return mount;
+    }
+    // No mount table: share roots for UNC paths, drives or the first directory otherwise
+    const QStringList parts = path.split('/', Qt::SkipEmptyParts);
+    if (path.startsWith("//")) return "//" + parts.mid(0, 2).join('/');
+    return parts.isEmpty() ? QStringLiteral("/") : parts.first();
+}
+
+} // namespace
+
 class RecentFiles::Private {
 public:
     Private()
@@ -31,17 +85,96 @@ public:
     int maxCount;
     QString storagePath;
 
-    // Helper to find index of file in list
+    // Validation state, all on the GUI thread
+    QHash<QString, qint64> checkedAt;           // File -> when last checked, ms since epoch
+    QHash<QString, QImage> thumbnails;          // File -> first page thumbnail from ThumbnailStore
+    QHash<QString, quint64> mountsInFlight;     // Mount -> token of the check running on it
+    QHash<QString, qint64> unreachableUntil;    // Mount -> when to try it again
+    quint64 nextToken = 1;
+
+    // Stored paths are canonical, so the query is only cleaned, not resolved:
+    // resolving stats the file, which may sit on a mount that hangs
     int findFileIndex(const QString& path) const {
+        const QString cleaned = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
         for (int i = 0; i < recentFiles.size(); ++i) {
-            if (QFileInfo(recentFiles[i].filePath).canonicalFilePath() ==
-                QFileInfo(path).canonicalFilePath()) {
+            if (recentFiles[i].filePath == cleaned) {
                 return i;
             }
         }
         return -1;
     }
 
+    // Runs on the I/O pool; blocks as long as the mount does
+    static QList<FileCheck> checkFiles(const QStringList& paths) {
+        QList<FileCheck> checks;
+        for (const QString& path : paths) {
+            FileCheck check;
+            check.filePath = path;
+            const QFileInfo info(path);
+            check.exists = info.exists();
+            if (check.exists) {
+                check.size = info.size();
+                // MetadataDatabase reads through this thread's own connection. The
+                // thumbnail's key is read from the file here, outside the store's
+                // lock; its database is only used on the GUI thread
+                if (MetadataDatabase::instance().isReady()) {
+                    check.pageCount = MetadataDatabase::instance().retrieveMetadata(path).pageCount;
+                }
+                if (ThumbnailStore::instance().isReady()) {
+                    check.thumbnailKey = ThumbnailStore::instance().contentKey(path);
+                }
+            }
+            checks.append(check);
+        }
+        return checks;
+    }
+
+    // Takes in a mount's results on the GUI thread; returns the files dropped
+    QStringList applyChecks(const QString& mount, quint64 token, const QList<FileCheck>& checks) {
+        if (mountsInFlight.value(mount) == token) mountsInFlight.remove(mount);
+        unreachableUntil.remove(mount); // It answered, however late
+
+        QStringList removed;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QMutexLocker locker(&mutex);
+        for (const FileCheck& check : checks) {
+            checkedAt.insert(check.filePath, now);
+            const int index = findFileIndex(check.filePath);
+            if (index < 0) continue; // Removed while it was checked
+            if (!check.exists) {
+                LOG_DEBUG("Removing non-existent file from recent files: " << check.filePath);
+                recentFiles.removeAt(index);
+                thumbnails.remove(check.filePath);
+                removed.append(check.filePath);
+                continue;
+            }
+            RecentFileInfo& info = recentFiles[index];
+            info.fileSize = check.size;
+            info.availability = RecentFileInfo::Availability::Available;
+            if (check.pageCount > 0) info.pageCount = check.pageCount;
+            if (!check.thumbnailKey.isEmpty()) {
+                const QImage thumbnail = ThumbnailStore::instance().imageForKey(check.thumbnailKey, check.filePath, 0);
+                if (!thumbnail.isNull()) thumbnails.insert(check.filePath, thumbnail);
+            }
+        }
+        return removed;
+    }
+
+    // A mount that did not answer in time: its entries stay, marked, and it is not asked again for a while
+    bool markUnreachable(const QString& mount, quint64 token, const QStringList& paths) {
+        if (mountsInFlight.value(mount) != token) return false; // Answered in time
+        const int retryMs = Settings::instance().value<int>("Advanced/RecentFilesMountRetryMs", 60000);
+        unreachableUntil.insert(mount, QDateTime::currentMSecsSinceEpoch() + retryMs);
+        LOG_WARN("Recent files on " << mount << " did not answer; not checking them again for " << retryMs << " ms");
+        QMutexLocker locker(&mutex);
+        for (const QString& path : paths) {
+            const int index = findFileIndex(path);
+            if (index >= 0) recentFiles[index].availability = RecentFileInfo::Availability::Unreachable;
+        }
+        return true;
+    }
+
+
     // Helper to sort list by last access time (descending)
     void sortByLastAccess() {
         std::stable_sort(recentFiles.begin(), recentFiles.end(),
@@ -125,6 +258,10 @@ void RecentFiles::addFile(const QString& filePath, const QVariantMap& metadata)
         d->recentFiles.prepend(info);
     }
 
+    // Just opened, so there is no need to check it again soon
+    d->recentFiles.first().availability = RecentFileInfo::Availability::Available;
+    d->checkedAt.insert(d->recentFiles.first().filePath, QDateTime::currentMSecsSinceEpoch());
+
     // Prune list to max size
     d->pruneToListSize();
 
@@ -140,6 +277,7 @@ void RecentFiles::removeFile(const QString& filePath)
     int index = d->findFileIndex(filePath);
     if (index >= 0) {
         RecentFileInfo removedInfo = d->recentFiles.takeAt(index);
+        d->thumbnails.remove(removedInfo.filePath);
         emit recentFilesChanged();
         emit fileRemoved(removedInfo.filePath);
     }
@@ -149,6 +287,7 @@ void RecentFiles::clear()
 {
     QMutexLocker locker(&d->mutex);
     d->recentFiles.clear();
+    d->thumbnails.clear();
     emit recentFilesChanged();
     emit cleared();
 }
@@ -210,12 +349,21 @@ RecentFileInfo RecentFiles::fileInfo(const QString& filePath) const
     return RecentFileInfo(); // Return invalid/default info
 }
 
+QImage RecentFiles::thumbnail(const QString& filePath) const
+{
+    QMutexLocker locker(&d->mutex);
+    const int index = d->findFileIndex(filePath);
+    return index >= 0 ? d->thumbnails.value(d->recentFiles[index].filePath) : QImage();
+}
+
 void RecentFiles::load()
 {
     QSettings settings(d->storagePath, QSettings::IniFormat);
     QMutexLocker locker(&d->mutex);
 
     d->recentFiles.clear();
+    d->thumbnails.clear();
+    d->checkedAt.clear();
     int size = settings.beginReadArray("RecentFiles");
     for (int i = 0; i < size; ++i) {
         settings.setArrayIndex(i);
@@ -227,13 +375,10 @@ void RecentFiles::load()
         info.documentType = settings.value("DocumentType").toString();
         info.lastKnownTitle = settings.value("LastKnownTitle").toString();
         info.accessCount = settings.value("AccessCount", 1).toInt();
+        info.pageCount = settings.value("PageCount", 0).toInt();
 
-        // Only add if the file actually exists
-        if (QFileInfo(info.filePath).exists()) {
-            d->recentFiles.append(info);
-        } else {
-            LOG_DEBUG("Skipping non-existent file from recent files list: " << info.filePath);
-        }
+        // Listed until validate() finds it gone
+        if (!info.filePath.isEmpty()) d->recentFiles.append(info);
     }
     settings.endArray();
 
@@ -241,8 +386,10 @@ void RecentFiles::load()
     d->sortByLastAccess();
     // Prune in case the stored count exceeded the current max
     d->pruneToListSize();
+    locker.unlock();
 
     emit recentFilesChanged();
+    validate();
 }
 
 void RecentFiles::save()
@@ -260,6 +407,7 @@ void RecentFiles::save()
         settings.setValue("DocumentType", d->recentFiles[i].documentType);
         settings.setValue("LastKnownTitle", d->recentFiles[i].lastKnownTitle);
         settings.setValue("AccessCount", d->recentFiles[i].accessCount);
+        settings.setValue("PageCount", d->recentFiles[i].pageCount);
     }
     settings.endArray();
     settings.sync(); // Force write to disk
@@ -267,20 +415,46 @@ void RecentFiles::save()
 
 void RecentFiles::validate()
 {
-    QMutexLocker locker(&d->mutex);
-    bool changed = false;
-    auto it = d->recentFiles.begin();
-    while (it != d->recentFiles.end()) {
-        if (!QFileInfo(it->filePath).exists()) {
-            LOG_DEBUG("Removing non-existent file from recent files: " << it->filePath);
-            it = d->recentFiles.erase(it);
-            changed = true;
-        } else {
-            ++it;
+    const int timeoutMs = Settings::instance().value<int>("Advanced/RecentFilesMountTimeoutMs", 2000);
+    const int recheckMs = Settings::instance().value<int>("Advanced/RecentFilesRecheckMs", 30000);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    // Group the files due a check by mount
+    const QStringList mounts = mountPoints();
+    QHash<QString, QStringList> byMount;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (const RecentFileInfo& info : qAsConst(d->recentFiles)) {
+            auto checked = d->checkedAt.constFind(info.filePath);
+            if (checked != d->checkedAt.constEnd() && now - *checked < recheckMs) continue;
+            byMount[mountOf(info.filePath, mounts)].append(info.filePath);
         }
     }
-    if (changed) {
-        emit recentFilesChanged();
+
+    for (auto it = byMount.constBegin(); it != byMount.constEnd(); ++it) {
+        const QString mount = it.key();
+        const QStringList paths = it.value();
+        // A mount still busy with an earlier check would only tie up another pool thread
+        if (d->mountsInFlight.contains(mount)) continue;
+        if (d->unreachableUntil.value(mount) > now) continue;
+
+        const quint64 token = d->nextToken++;
+        d->mountsInFlight.insert(mount, token);
+        QPointer<RecentFiles> self(this);
+        ThreadPool::ioInstance().submitDetached([self, mount, token, paths]() {
+            const QList<FileCheck> checks = Private::checkFiles(paths);
+            if (!self) return;
+            QMetaObject::invokeMethod(self, [self, mount, token, checks]() {
+                if (!self) return;
+                const QStringList removed = self->d->applyChecks(mount, token, checks);
+                emit self->recentFilesChanged();
+                for (const QString& path : removed) emit self->fileRemoved(path);
+            }, Qt::QueuedConnection);
+        }, Task::Priority::Low);
+
+        QTimer::singleShot(timeoutMs, this, [this, mount, token, paths]() {
+            if (d->markUnreachable(mount, token, paths)) emit recentFilesChanged();
+        });
     }
 }
 
@@ -14,6 +14,7 @@
 #include <QStringList>
 #include <QHash>
 #include <QDateTime>
+#include <QImage>
 #include <QMetaType>
 #include <memory>
 
@@ -23,6 +24,15 @@ namespace QuantilyxDoc {
  * @brief Stores information about a recent file.
  */
 struct RecentFileInfo {
+    /**
+     * @brief Whether the file could be reached when last checked.
+     */
+    enum class Availability {
+        Unknown,        // Not checked since loading the list
+        Available,      // Found, and size and page count refreshed
+        Unreachable     // Its mount did not answer in time; kept in the list
+    };
+
     QString filePath;           // Absolute path to the file
     QDateTime lastAccessTime;   // Time the file was last opened/accessed
     qint64 fileSize;            // Size of the file at last access
@@ -30,11 +40,13 @@ struct RecentFileInfo {
     QString documentType;       // Detected document type (e.g., "PDF", "EPUB")
     QString lastKnownTitle;     // Title from document metadata (if available)
     int accessCount;            // How many times the file was accessed
+    int pageCount;              // Page count from MetadataDatabase, 0 if not known
+    Availability availability;  // Result of the last validation
 
     // Needed for QMetaType registration
-    RecentFileInfo() : fileSize(0), accessCount(0) {}
+    RecentFileInfo() : fileSize(0), accessCount(0), pageCount(0), availability(Availability::Unknown) {}
     RecentFileInfo(const QString& path)
-        : filePath(path), fileSize(0), accessCount(1) {}
+        : filePath(path), fileSize(0), accessCount(1), pageCount(0), availability(Availability::Unknown) {}
 };
 
 Q_DECLARE_METATYPE(QuantilyxDoc::RecentFileInfo)
@@ -44,6 +56,12 @@ Q_DECLARE_METATYPE(QuantilyxDoc::RecentFileInfo)
  *
  * Maintains a list of recently accessed documents, stores metadata,
  * and provides signals for UI updates.
+ *
+ * Nothing here touches the files on the GUI thread except addFile(), whose
+ * file was just opened. Entries are checked on the I/O pool, one task per
+ * mount, so a network mount that stops answering holds up only its own
+ * entries: after Advanced/RecentFilesMountTimeoutMs they are marked
+ * Unreachable and the mount is left alone for a while.
  */
 class RecentFiles : public QObject
 {
@@ -123,8 +141,18 @@ public:
      */
     RecentFileInfo fileInfo(const QString& filePath) const;
 
+    /**
+     * @brief Get the stored thumbnail of a file's first page.
+     * Fetched from ThumbnailStore by validate(), without opening the
+     * document, and kept in memory.
+     * @param filePath Path to the file.
+     * @return Thumbnail image, or a null image if none is stored or it is not fetched yet.
+     */
+    QImage thumbnail(const QString& filePath) const;
+
     /**
      * @brief Load recent files list from persistent storage.
+     * Entries are listed at once and start validate() in the background.
      */
     void load();
 
@@ -135,7 +163,10 @@ public:
 
     /**
      * @brief Validate the recent files list by checking if files still exist.
-     * Removes entries for files that no longer exist.
+     * Returns at once; the checks run on the I/O pool and recentFilesChanged()
+     * follows each mount's results. Removes entries for files that no longer
+     * exist and fills in page counts and thumbnails. Files checked within
+     * Advanced/RecentFilesRecheckMs are not checked again.
      */
     void validate();
 
@@ -177,6 +208,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static RecentFiles* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,225 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ReflowablePage.h"
+#include "Document.h"
+#include "ImageBufferPool.h"
+#include "Logger.h"
+#include "MemoryBudget.h"
+#include <QPainter>
+#include <QPair>
+#include <QPointer>
+#include <algorithm>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+class ReflowablePage::Private {
+public:
+    Private(Document* doc, const QSizeF& sheetSize, qreal pageMargin)
+        : document(doc), sheet(sheetSize), margin(pageMargin), layoutLastUse(0) {}
+
+    struct Layout {
+        QString key;
+        qreal width = 0;
+        qreal height = 0;
+        std::unique_ptr<LayoutDocument> document;
+        QString plainText;
+        qint64 bytes = 0;
+        QMutex paintMutex; // QTextDocument is not reentrant
+    };
+
+    Document* document;
+    QSizeF sheet;
+    qreal margin;
+    mutable std::shared_ptr<Layout> layout;
+    mutable quint64 layoutLastUse;
+    mutable QMutex layoutMutex; // Protects layout and layoutLastUse
+    mutable QMutex buildMutex;  // One layout build per page at a time
+
+    static std::atomic<quint64>& layoutClock() {
+        static std::atomic<quint64> clock(0);
+        return clock;
+    }
+
+    std::shared_ptr<Layout> cachedLayout(const QString& key) const {
+        QMutexLocker locker(&layoutMutex);
+        if (!layout || layout->key != key) return nullptr;
+        layoutLastUse = ++layoutClock();
+        return layout;
+    }
+
+    std::shared_ptr<Layout> currentLayout(const ReflowablePage* q) const {
+        const QString key = q->layoutKey();
+        if (std::shared_ptr<Layout> cached = cachedLayout(key)) return cached;
+        QMutexLocker buildLocker(&buildMutex);
+        if (std::shared_ptr<Layout> cached = cachedLayout(key)) return cached; // Built while we waited
+
+        std::unique_ptr<LayoutDocument> text = q->createLayout();
+        if (!text) return nullptr;
+        std::shared_ptr<Layout> built = std::make_shared<Layout>();
+        built->key = key;
+        built->width = q->layoutWidth();
+        text->setTextWidth(built->width);
+        built->height = text->size().height(); // Lays out, decoding the images
+        built->plainText = text->toPlainText();
+        built->document = std::move(text);
+        built->bytes = sizeof(Layout) + built->document->estimatedBytes();
+        LOG_DEBUG(q->metaObject()->className() << ": Laid out at width " << built->width << ", " << built->bytes << " bytes");
+
+        QMutexLocker locker(&layoutMutex);
+        layout = built;
+        layoutLastUse = ++layoutClock();
+        return layout;
+    }
+
+    QSizeF pageSizeOf(const Layout& laidOut) const {
+        return QSizeF(laidOut.width + 2 * margin, qMax(sheet.height(), laidOut.height + 2 * margin));
+    }
+};
+
+ReflowablePage::ReflowablePage(Document* document, const QSizeF& sheet, qreal margin, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(document, sheet, margin))
+{
+    // Until laid out, assume one sheet
+    setSize(sheet);
+}
+
+ReflowablePage::~ReflowablePage() = default;
+
+QImage ReflowablePage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage ReflowablePage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+    const std::shared_ptr<Private::Layout> layout = d->currentLayout(this);
+    if (!layout) return QImage();
+
+    // The page runs as long as its text; the first layout tells how long
+    const QSizeF actual = d->pageSizeOf(*layout);
+    if (qAbs(actual.width() - size().width()) > 0.5 || qAbs(actual.height() - size().height()) > 0.5) {
+        QPointer<ReflowablePage> self(this);
+        QMetaObject::invokeMethod(this, [self, actual]() {
+            if (!self) return;
+            self->setSize(actual);
+            if (self->d->document) emit self->d->document->pageSizesChanged();
+        }, Qt::QueuedConnection);
+    }
+
+    QImage image = ImageBufferPool::instance().acquire(QSize(width, height));
+    if (image.isNull()) return QImage();
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    const qreal scale = qMin(width / rect.width(), height / rect.height());
+    painter.scale(scale, scale);
+    painter.translate(-rect.topLeft() + QPointF(d->margin, d->margin));
+    {
+        QMutexLocker locker(&layout->paintMutex);
+        layout->document->drawContents(&painter, rect.translated(-d->margin, -d->margin) & QRectF(0, 0, layout->width, layout->height));
+    }
+    painter.end();
+    return image;
+}
+
+bool ReflowablePage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QString ReflowablePage::text() const
+{
+    const std::shared_ptr<Private::Layout> layout = d->currentLayout(this);
+    return layout ? layout->plainText : QString();
+}
+
+QSizeF ReflowablePage::ensureLayout() const
+{
+    const std::shared_ptr<Private::Layout> layout = d->currentLayout(this);
+    return layout ? d->pageSizeOf(*layout) : QSizeF();
+}
+
+bool ReflowablePage::isLaidOut() const
+{
+    return d->cachedLayout(layoutKey()) != nullptr;
+}
+
+qint64 ReflowablePage::layoutBytes() const
+{
+    QMutexLocker locker(&d->layoutMutex);
+    return d->layout ? d->layout->bytes : 0;
+}
+
+quint64 ReflowablePage::layoutLastUse() const
+{
+    QMutexLocker locker(&d->layoutMutex);
+    return d->layout ? d->layoutLastUse : 0;
+}
+
+qint64 ReflowablePage::releaseLayout()
+{
+    QMutexLocker locker(&d->layoutMutex);
+    const qint64 freed = d->layout ? d->layout->bytes : 0;
+    d->layout.reset();
+    return freed;
+}
+
+qint64 ReflowablePage::layoutBytes(const QVector<ReflowablePage*>& pages)
+{
+    qint64 total = 0;
+    for (const ReflowablePage* page : pages) total += page->layoutBytes();
+    return total;
+}
+
+qint64 ReflowablePage::releaseLayouts(const QVector<ReflowablePage*>& pages, qint64 bytes)
+{
+    QVector<QPair<quint64, ReflowablePage*>> candidates;
+    for (ReflowablePage* page : pages) {
+        const quint64 lastUse = page->layoutLastUse();
+        if (lastUse) candidates.append(qMakePair(lastUse, page));
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const QPair<quint64, ReflowablePage*>& a, const QPair<quint64, ReflowablePage*>& b) { return a.first < b.first; });
+    qint64 freed = 0;
+    for (const auto& candidate : candidates) {
+        if (freed >= bytes) break;
+        freed += candidate.second->releaseLayout();
+    }
+    return freed;
+}
+
+int ReflowablePage::registerLayoutConsumer(const QString& name, Document* document, PagesAccess access)
+{
+    return MemoryBudget::instance().registerDocumentConsumer(
+        name, MemoryBudget::Priority::Normal, MemoryBudget::documentId(document),
+        [access]() { return access([](const QVector<ReflowablePage*>& pages) { return layoutBytes(pages); }); },
+        [access](qint64 bytes) {
+            return access([bytes](const QVector<ReflowablePage*>& pages) { return releaseLayouts(pages, bytes); });
+        });
+}
+
+qreal ReflowablePage::layoutWidth() const
+{
+    return d->sheet.width() - 2 * d->margin;
+}
+
+QString ReflowablePage::layoutKey() const
+{
+    return QString();
+}
+
+} // namespace QuantilyxDoc
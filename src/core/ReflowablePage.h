@@ -0,0 +1,173 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_REFLOWABLEPAGE_H
+#define QUANTILYX_REFLOWABLEPAGE_H
+
+#include "Page.h"
+#include "LayoutDocument.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief A page of HTML laid out with QTextDocument, as one continuous sheet.
+ *
+ * The e-book and help formats turn each chapter, section or topic into one
+ * page of this kind. The text is laid out on first use, from any thread,
+ * into the LayoutDocument the subclass creates, and kept until the layout
+ * is released under memory pressure; the next use builds it again. A
+ * layout is shared with renders in flight, so a release never deletes a
+ * document that is being painted.
+ *
+ * The page is as wide as the text plus its margins and runs as long as the
+ * text, but no shorter than the sheet it starts as. A page laid out to a
+ * new height resizes itself on its own thread and tells its document
+ * through pageSizesChanged().
+ */
+class ReflowablePage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Destructor.
+     */
+    ~ReflowablePage() override;
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QString text() const override;
+
+    /**
+     * @brief Lay the page out now. Safe from any thread.
+     * @return Laid-out page size in points; empty if there is no content.
+     */
+    QSizeF ensureLayout() const;
+
+    /**
+     * @brief Check if a layout for the current layout key is held.
+     * @return True if laid out.
+     */
+    bool isLaidOut() const;
+
+    // --- Layout memory, for MemoryBudget ---
+    /**
+     * @brief Get the memory the layout holds, images included.
+     * @return Approximate size in bytes; 0 if not laid out.
+     */
+    qint64 layoutBytes() const;
+
+    /**
+     * @brief Get when the layout was last used.
+     * @return Value of a clock shared by all reflowable pages; 0 if not laid out.
+     */
+    quint64 layoutLastUse() const;
+
+    /**
+     * @brief Drop the layout; the next use builds it again.
+     * @return Bytes freed.
+     */
+    qint64 releaseLayout();
+
+    /**
+     * @brief Sum the memory held by the layouts of some pages.
+     * @param pages The pages.
+     * @return Size in bytes.
+     */
+    static qint64 layoutBytes(const QVector<ReflowablePage*>& pages);
+
+    /**
+     * @brief Release layouts, least recently used first.
+     * @param pages The pages to release from.
+     * @param bytes Bytes wanted.
+     * @return Bytes freed; may exceed the request by one layout.
+     */
+    static qint64 releaseLayouts(const QVector<ReflowablePage*>& pages, qint64 bytes);
+
+    // Called with the pages and returns bytes counted or freed
+    using PagesVisitor = std::function<qint64(const QVector<ReflowablePage*>&)>;
+    // Calls a visitor with the pages, guarded against their deletion
+    using PagesAccess = std::function<qint64(const PagesVisitor&)>;
+
+    /**
+     * @brief Report a document's page layouts to MemoryBudget as one consumer.
+     * @param name Consumer name.
+     * @param document Document the layouts are charged to.
+     * @param access Gives the consumer the document's pages.
+     * @return Consumer ID, for MemoryBudget::unregisterConsumer().
+     */
+    static int registerLayoutConsumer(const QString& name, Document* document, PagesAccess access);
+
+    /**
+     * @brief Report a document's page layouts to MemoryBudget as one consumer.
+     * @param name Consumer name.
+     * @param document Document the layouts are charged to.
+     * @param mutex Guards @p pages against the consumer.
+     * @param pages The document's pages, held by smart pointers.
+     * @return Consumer ID, for MemoryBudget::unregisterConsumer().
+     */
+    template <typename PageList>
+    static int registerLayoutConsumer(const QString& name, Document* document, QMutex* mutex, const PageList* pages)
+    {
+        return registerLayoutConsumer(name, document, [mutex, pages](const PagesVisitor& visit) {
+            QMutexLocker locker(mutex);
+            QVector<ReflowablePage*> list;
+            list.reserve(pages->size());
+            for (const auto& page : *pages) list.append(page.get());
+            return visit(list);
+        });
+    }
+
+protected:
+    /**
+     * @brief Constructor. The page starts as the sheet.
+     * @param document Parent document.
+     * @param sheet Width of the page, and its least height, in points.
+     * @param margin Space around the text, in points.
+     * @param parent Parent object.
+     */
+    ReflowablePage(Document* document, const QSizeF& sheet, qreal margin, QObject* parent = nullptr);
+
+    /**
+     * @brief Create the page's text, its HTML set. Called from any thread.
+     * The text width is set afterwards.
+     * @return The document, or nullptr if the content is gone.
+     */
+    virtual std::unique_ptr<LayoutDocument> createLayout() const = 0;
+
+    /**
+     * @brief Get the width to lay the text out at. Called from any thread.
+     * The default is the sheet width less the margins.
+     * @return Width in points.
+     */
+    virtual qreal layoutWidth() const;
+
+    /**
+     * @brief Get what the layout depends on besides the content. Called
+     * from any thread; a layout made under another key is built again.
+     * The default is empty.
+     * @return Key.
+     */
+    virtual QString layoutKey() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_REFLOWABLEPAGE_H
@@ -0,0 +1,455 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "RemoteFile.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include "Logger.h"
+#include <QBitArray>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const quint32 MetaMagic = 0x51585243; // "QXRC"
+const quint32 MetaVersion = 1;
+// One request never asks for more, so a waiting reader gets its block soon
+const qint64 MaxRequestBytes = 4 * 1024 * 1024;
+
+struct FetchResult {
+    int status = 0;
+    QByteArray data;
+    QString error;
+    qint64 totalSize = -1;   // From Content-Range, or the body of a 200
+    QByteArray validator;    // ETag, or Last-Modified without one
+};
+
+// A request handed to the network thread and waited for by the reader
+struct PendingFetch {
+    QMutex mutex;
+    QWaitCondition finished;
+    bool done = false;
+    FetchResult result;
+};
+
+// Lives in the network thread; QNetworkAccessManager is bound to its thread
+QObject* networkContext()
+{
+    static QObject* context = []() {
+        QThread* thread = new QThread();
+        thread->setObjectName(QStringLiteral("Remote I/O"));
+        QObject* object = new QObject();
+        object->moveToThread(thread);
+        new QNetworkAccessManager(object); // Child; created here, used only in the thread
+        thread->start();
+        if (QCoreApplication::instance()) {
+            QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, thread, [thread]() {
+                thread->quit();
+                thread->wait();
+            }, Qt::DirectConnection);
+        }
+        return object;
+    }();
+    return context;
+}
+
+// Fetch a range, or the whole file for length < 0, blocking the calling thread
+FetchResult fetch(const QUrl& url, qint64 offset, qint64 length)
+{
+    auto pending = std::make_shared<PendingFetch>();
+    QObject* context = networkContext();
+    QMetaObject::invokeMethod(context, [context, url, offset, length, pending]() {
+        QNetworkAccessManager* manager = context->findChild<QNetworkAccessManager*>();
+        QNetworkRequest request(url);
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        if (length > 0) {
+            request.setRawHeader("Range", "bytes=" + QByteArray::number(offset) + '-' + QByteArray::number(offset + length - 1));
+        }
+        QNetworkReply* reply = manager->get(request);
+        QObject::connect(reply, &QNetworkReply::finished, reply, [reply, pending]() {
+            FetchResult result;
+            result.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            result.data = reply->readAll();
+            if (reply->error() != QNetworkReply::NoError) result.error = reply->errorString();
+            const QRegularExpressionMatch range = QRegularExpression(QStringLiteral("/(\\d+)\\s*$"))
+                                                      .match(QString::fromLatin1(reply->rawHeader("Content-Range")));
+            if (range.hasMatch()) {
+                result.totalSize = range.captured(1).toLongLong();
+            } else if (result.status == 200) {
+                result.totalSize = result.data.size();
+            }
+            result.validator = reply->rawHeader("ETag");
+            if (result.validator.isEmpty()) result.validator = reply->rawHeader("Last-Modified");
+            reply->deleteLater();
+
+            QMutexLocker locker(&pending->mutex);
+            pending->result = std::move(result);
+            pending->done = true;
+            pending->finished.wakeAll();
+        });
+    }, Qt::QueuedConnection);
+
+    const unsigned long timeoutMs = 1000ul * qMax(1, Settings::instance().value<int>("Advanced/RemoteTimeoutSeconds", 30));
+    QMutexLocker locker(&pending->mutex);
+    while (!pending->done) {
+        if (!pending->finished.wait(&pending->mutex, timeoutMs)) {
+            FetchResult timedOut;
+            timedOut.error = QStringLiteral("Timed out");
+            return timedOut; // The reply finishes into pending, which it shares
+        }
+    }
+    return pending->result;
+}
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/remote");
+}
+
+} // namespace
+
+class RemoteFile::Private {
+public:
+    ~Private() {
+        saveMeta();
+    }
+
+    QUrl url;
+    QString urlString;
+    qint64 size = 0;
+    qint64 blockSize = 64 * 1024;
+    int readAheadBlocks = 4;
+    QByteArray validator;
+    QString cachePath;          // Block data, sparse, at the offsets of the document
+    QString metaPath;           // Validator and which blocks the data holds
+    std::atomic<qint64> fetched{0};
+
+    mutable QMutex mutex;       // Guards the cache file and the block maps
+    mutable QWaitCondition arrived;
+    mutable QFile cache;
+    QBitArray present;
+    QBitArray inFlight;
+
+    int blockCount() const {
+        return int((size + blockSize - 1) / blockSize);
+    }
+
+    bool loadMeta() {
+        QFile file(metaPath);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        QDataStream in(&file);
+        quint32 magic = 0, version = 0;
+        QString storedUrl;
+        qint64 storedSize = 0, storedBlockSize = 0;
+        QByteArray storedValidator;
+        QBitArray storedPresent;
+        in >> magic >> version >> storedUrl >> storedSize >> storedBlockSize >> storedValidator >> storedPresent;
+        if (in.status() != QDataStream::Ok || magic != MetaMagic || version != MetaVersion || storedUrl != urlString
+            || storedSize != size || storedBlockSize != blockSize || validator.isEmpty() || storedValidator != validator
+            || storedPresent.size() != blockCount()) {
+            return false;
+        }
+        present = storedPresent;
+        return true;
+    }
+
+    void saveMeta() const {
+        if (metaPath.isEmpty() || validator.isEmpty()) return;
+        QMutexLocker locker(&mutex);
+        QSaveFile file(metaPath);
+        if (!file.open(QIODevice::WriteOnly)) return;
+        QDataStream out(&file);
+        out << MetaMagic << MetaVersion << urlString << size << blockSize << validator << present;
+        if (out.status() != QDataStream::Ok || !file.commit()) {
+            LOG_WARN("RemoteFile: Cannot save the block map of " << urlString);
+        }
+    }
+
+    // Called with mutex held
+    bool storeLocked(qint64 offset, const QByteArray& data) {
+        if (!cache.seek(offset) || cache.write(data) != data.size()) {
+            LOG_ERROR("RemoteFile: Cannot write the block cache " << cachePath << ": " << cache.errorString());
+            return false;
+        }
+        const int first = int(offset / blockSize);
+        const qint64 end = offset + data.size();
+        // A block counts only once complete; the last one ends with the file
+        for (int block = first; block < blockCount(); ++block) {
+            const qint64 blockEnd = qMin(size, (block + 1) * blockSize);
+            if (blockEnd > end) break;
+            present.setBit(block);
+        }
+        return true;
+    }
+
+    // Make the blocks first to last present, along with up to ahead missing
+    // blocks after them. Blocks another reader is fetching are waited for.
+    bool ensure(int first, int last, int ahead) {
+        QMutexLocker locker(&mutex);
+        for (;;) {
+            int start = -1;
+            bool waiting = false;
+            for (int block = first; block <= last; ++block) {
+                if (present.testBit(block)) continue;
+                if (inFlight.testBit(block)) {
+                    waiting = true;
+                    continue;
+                }
+                start = block;
+                break;
+            }
+            if (start < 0) {
+                if (!waiting) return true;
+                arrived.wait(&mutex);
+                continue;
+            }
+
+            // One request for the run of missing blocks, and the read-ahead after it
+            const int limit = qMin(blockCount() - 1, last + ahead);
+            const int maxBlocks = int(qMax<qint64>(1, MaxRequestBytes / blockSize));
+            int end = start;
+            while (end + 1 <= limit && end + 1 - start < maxBlocks && !present.testBit(end + 1) && !inFlight.testBit(end + 1)) {
+                ++end;
+            }
+            inFlight.fill(true, start, end + 1);
+            const qint64 offset = start * blockSize;
+            const qint64 length = qMin(size, (end + 1) * blockSize) - offset;
+
+            locker.unlock();
+            const FetchResult result = fetch(url, offset, length);
+            locker.relock();
+            inFlight.fill(false, start, end + 1);
+            arrived.wakeAll();
+
+            bool stored = false;
+            if (result.status == 206 && result.data.size() == length) {
+                stored = storeLocked(offset, result.data);
+            } else if (result.status == 200 && result.data.size() == size) {
+                stored = storeLocked(0, result.data); // Range ignored; the whole file came
+            }
+            if (!stored) {
+                LOG_ERROR("RemoteFile: Fetching bytes " << offset << "-" << offset + length - 1 << " of " << urlString
+                          << " failed: " << (result.error.isEmpty() ? QStringLiteral("HTTP %1").arg(result.status) : result.error));
+                return false;
+            }
+            fetched += result.data.size();
+        }
+    }
+
+    QByteArray read(qint64 offset, qint64 length) {
+        if (offset < 0 || offset >= size || length <= 0) return QByteArray();
+        length = qMin(length, size - offset);
+        const int first = int(offset / blockSize);
+        const int last = int((offset + length - 1) / blockSize);
+        if (!ensure(first, last, readAheadBlocks)) return QByteArray();
+
+        QMutexLocker locker(&mutex);
+        if (!cache.seek(offset)) return QByteArray();
+        return cache.read(length);
+    }
+
+    // Live files by URL; weak so the last user closes the file
+    static QMutex& registryMutex() {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    static QHash<QString, std::weak_ptr<RemoteFile>>& registry() {
+        static QHash<QString, std::weak_ptr<RemoteFile>> files;
+        return files;
+    }
+};
+
+// A position of its own over the shared blocks
+class RemoteDevice : public QIODevice
+{
+public:
+    explicit RemoteDevice(std::shared_ptr<RemoteFile::Private> file) : m_file(std::move(file)) {
+        QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_file->size; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override {
+        if (pos() >= m_file->size) return 0;
+        const QByteArray bytes = m_file->read(pos(), maxSize);
+        if (bytes.isEmpty()) {
+            setErrorString(QStringLiteral("Cannot fetch %1").arg(m_file->urlString));
+            return -1;
+        }
+        std::memcpy(data, bytes.constData(), size_t(bytes.size()));
+        return bytes.size();
+    }
+
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    std::shared_ptr<RemoteFile::Private> m_file;
+};
+
+RemoteFile::RemoteFile()
+    : d(std::make_shared<Private>())
+{
+}
+
+RemoteFile::~RemoteFile() = default;
+
+bool RemoteFile::isRemote(const QString& path)
+{
+    return path.startsWith(QLatin1String("http://"), Qt::CaseInsensitive)
+        || path.startsWith(QLatin1String("https://"), Qt::CaseInsensitive);
+}
+
+std::shared_ptr<RemoteFile> RemoteFile::open(const QString& url, QString* error)
+{
+    auto fail = [&](const QString& message) -> std::shared_ptr<RemoteFile> {
+        LOG_ERROR("RemoteFile: Cannot open " << url << ": " << message);
+        if (error) *error = message;
+        return nullptr;
+    };
+    if (!isRemote(url) || !QUrl(url).isValid()) return fail(QStringLiteral("Not an HTTP URL"));
+
+    QMutexLocker locker(&Private::registryMutex());
+    auto& registry = Private::registry();
+    const auto it = registry.constFind(url);
+    if (it != registry.constEnd()) {
+        if (std::shared_ptr<RemoteFile> existing = it->lock()) return existing;
+    }
+
+    std::shared_ptr<RemoteFile> file(new RemoteFile());
+    Private* priv = file->d.get();
+    priv->url = QUrl(url);
+    priv->urlString = url;
+    priv->blockSize = qint64(qBound(4, Settings::instance().value<int>("Advanced/RemoteBlockKB", 64), 4096)) * 1024;
+    priv->readAheadBlocks = int(qint64(qMax(0, Settings::instance().value<int>("Advanced/RemoteReadAheadKB", 256))) * 1024 / priv->blockSize);
+
+    // The first block tells the size, whether ranges work and the validator
+    const FetchResult probe = fetch(priv->url, 0, priv->blockSize);
+    if (probe.status != 200 && probe.status != 206) {
+        return fail(probe.error.isEmpty() ? QStringLiteral("HTTP %1").arg(probe.status) : probe.error);
+    }
+    if (probe.totalSize <= 0) return fail(QStringLiteral("The server did not report the size"));
+    priv->size = probe.totalSize;
+    priv->validator = probe.validator;
+
+    const QString key = QString::fromLatin1(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex());
+    QDir().mkpath(cacheDirectory());
+    priv->cachePath = cacheDirectory() + QLatin1Char('/') + key + QStringLiteral(".blocks");
+    priv->metaPath = cacheDirectory() + QLatin1Char('/') + key + QStringLiteral(".map");
+    priv->present = QBitArray(priv->blockCount());
+    priv->inFlight = QBitArray(priv->blockCount());
+    const bool reused = priv->loadMeta();
+    priv->cache.setFileName(priv->cachePath);
+    if (!priv->cache.open(reused ? QIODevice::ReadWrite : QIODevice::ReadWrite | QIODevice::Truncate)
+        || (!reused && !priv->cache.resize(priv->size))) {
+        return fail(QStringLiteral("Cannot create the block cache %1").arg(priv->cachePath));
+    }
+    {
+        QMutexLocker cacheLocker(&priv->mutex);
+        if (!priv->storeLocked(0, probe.data)) return fail(QStringLiteral("Cannot write the block cache"));
+    }
+    priv->fetched += probe.data.size();
+
+    if (probe.status == 200) {
+        LOG_WARN("RemoteFile: " << url << " ignores range requests; downloaded in full (" << priv->size << " bytes).");
+    }
+    LOG_INFO("RemoteFile: Opened " << url << " (" << priv->size << " bytes"
+             << (reused ? QStringLiteral(", %1 blocks cached").arg(priv->present.count(true)) : QString()) << ")");
+
+    for (auto stale = registry.begin(); stale != registry.end();) {
+        if (stale->expired()) {
+            stale = registry.erase(stale);
+        } else {
+            ++stale;
+        }
+    }
+    registry.insert(url, file);
+    return file;
+}
+
+void RemoteFile::clearCache()
+{
+    QMutexLocker locker(&Private::registryMutex());
+    QSet<QString> inUse;
+    for (const std::weak_ptr<RemoteFile>& entry : Private::registry()) {
+        if (std::shared_ptr<RemoteFile> file = entry.lock()) {
+            inUse << QFileInfo(file->d->cachePath).absoluteFilePath() << QFileInfo(file->d->metaPath).absoluteFilePath();
+        }
+    }
+    int removed = 0;
+    const QStringList patterns = { QStringLiteral("*.blocks"), QStringLiteral("*.map") };
+    for (const QFileInfo& entry : QDir(cacheDirectory()).entryInfoList(patterns, QDir::Files)) {
+        if (!inUse.contains(entry.absoluteFilePath()) && QFile::remove(entry.absoluteFilePath())) ++removed;
+    }
+    LOG_INFO("RemoteFile: Cleared " << removed << " cache files; " << inUse.size() / 2 << " open files keep theirs");
+}
+
+QString RemoteFile::url() const
+{
+    return d->urlString;
+}
+
+QString RemoteFile::fileName() const
+{
+    return d->url.fileName();
+}
+
+qint64 RemoteFile::size() const
+{
+    return d->size;
+}
+
+QByteArray RemoteFile::read(qint64 offset, qint64 length) const
+{
+    return d->read(offset, length);
+}
+
+void RemoteFile::prefetch(qint64 offset, qint64 length) const
+{
+    if (offset < 0 || offset >= d->size || length <= 0) return;
+    const int first = int(offset / d->blockSize);
+    const int last = int((qMin(d->size, offset + length) - 1) / d->blockSize);
+    std::shared_ptr<Private> priv = d;
+    ThreadPool::ioInstance().submitDetached([priv, first, last]() { priv->ensure(first, last, 0); }, Task::Priority::Low);
+}
+
+qint64 RemoteFile::bytesFetched() const
+{
+    return d->fetched;
+}
+
+std::unique_ptr<QIODevice> RemoteFile::openDevice() const
+{
+    return std::unique_ptr<QIODevice>(new RemoteDevice(d));
+}
+
+} // namespace QuantilyxDoc
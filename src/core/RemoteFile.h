@@ -0,0 +1,121 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_REMOTEFILE_H
+#define QUANTILYX_REMOTEFILE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief A document on an HTTP server, read in blocks fetched on demand.
+ *
+ * Reads are served from a block cache on disk, in the application cache
+ * directory; missing blocks are fetched with HTTP range requests, runs of
+ * neighbouring blocks in one request, with a little read-ahead for the reads
+ * that follow. Nothing is downloaded that no reader asked for, so a
+ * backend that reads the trailer and the first page of a large PDF fetches
+ * only those bytes. The cache survives the session while the server reports
+ * the same ETag or modification time and size.
+ *
+ * Servers that ignore Range are downloaded in full on open, as before.
+ *
+ * Opening a URL that is already open returns the same object, so
+ * DocumentFactory's sniffing and the backend it picks share one cache.
+ * Reads are safe from any thread but the network thread; they block until
+ * their blocks arrive.
+ */
+class RemoteFile
+{
+public:
+    /**
+     * @brief Check if a path names a remote document.
+     * @param path Path or URL.
+     * @return True for http:// and https:// URLs.
+     */
+    static bool isRemote(const QString& path);
+
+    /**
+     * @brief Open a URL, or return the open file of it.
+     * Fetches the first block to learn the size and whether ranges work.
+     * @param url Document URL.
+     * @param error Receives the reason on failure; may be null.
+     * @return The file; null if the server cannot be reached or refuses it.
+     */
+    static std::shared_ptr<RemoteFile> open(const QString& url, QString* error = nullptr);
+
+    /**
+     * @brief Delete the block caches of the URLs that are not open.
+     * Open files keep theirs, as they still read and write them.
+     */
+    static void clearCache();
+
+    ~RemoteFile();
+
+    /**
+     * @brief Get the URL.
+     * @return URL as opened.
+     */
+    QString url() const;
+
+    /**
+     * @brief Get the file name part of the URL, for type detection and titles.
+     * @return Last path segment, without query.
+     */
+    QString fileName() const;
+
+    /**
+     * @brief Get the document size.
+     * @return Size in bytes.
+     */
+    qint64 size() const;
+
+    /**
+     * @brief Read bytes, fetching missing blocks first.
+     * @param offset First byte.
+     * @param length Number of bytes; clamped to the end of the file.
+     * @return The bytes, or empty if a fetch failed.
+     */
+    QByteArray read(qint64 offset, qint64 length) const;
+
+    /**
+     * @brief Fetch a range into the cache without waiting for it.
+     * @param offset First byte.
+     * @param length Number of bytes.
+     */
+    void prefetch(qint64 offset, qint64 length) const;
+
+    /**
+     * @brief Get the bytes fetched from the server since the file was opened.
+     * @return Byte count.
+     */
+    qint64 bytesFetched() const;
+
+    /**
+     * @brief Open a random-access device over the file.
+     * Each device has its own position; several may be open at once.
+     * @return Read-only device.
+     */
+    std::unique_ptr<QIODevice> openDevice() const;
+
+private:
+    RemoteFile();
+    friend class RemoteDevice;
+
+    class Private;
+    std::shared_ptr<Private> d; // Shared with devices and fetches in flight
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_REMOTEFILE_H
@@ -0,0 +1,143 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "RenderRegistry.h"
+#include "Logger.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QMetaType>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace QuantilyxDoc {
+
+class RenderRegistry::Private {
+public:
+    struct Waiter {
+        quintptr token;
+        Callback callback;
+    };
+
+    struct InFlight {
+        quintptr owner;
+        std::vector<Waiter> waiters;
+    };
+
+    mutable QMutex mutex;
+    std::unordered_map<PageCache::CacheKey, InFlight, PageCache::CacheKeyHash> renders;
+
+    // Helper to take a render out of the registry if token owns it.
+    // Caller holds the mutex.
+    bool takeLocked(const PageCache::CacheKey& key, quintptr token, std::vector<Waiter>* waiters) {
+        auto it = renders.find(key);
+        if (it == renders.end() || it->second.owner != token) return false;
+        *waiters = std::move(it->second.waiters);
+        renders.erase(it);
+        return true;
+    }
+};
+
+// Static instance pointer
+RenderRegistry* RenderRegistry::s_instance = nullptr;
+
+RenderRegistry& RenderRegistry::instance()
+{
+    if (!s_instance) {
+        s_instance = new RenderRegistry();
+    }
+    return *s_instance;
+}
+
+RenderRegistry::RenderRegistry(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    // renderFinished() is delivered to views through queued connections
+    qRegisterMetaType<PageCache::CacheKey>("QuantilyxDoc::PageCache::CacheKey");
+}
+
+RenderRegistry::~RenderRegistry() = default;
+
+bool RenderRegistry::beginOrJoin(const PageCache::CacheKey& key, quintptr token, Callback callback)
+{
+    QMutexLocker locker(&d->mutex);
+    auto it = d->renders.find(key);
+    if (it == d->renders.end()) {
+        d->renders.emplace(key, Private::InFlight{token, {}});
+        return true;
+    }
+    it->second.waiters.push_back(Private::Waiter{token, std::move(callback)});
+    LOG_DEBUG("RenderRegistry: Request " << token << " joined render " << it->second.owner << " for page " << key.pageIndex);
+    return false;
+}
+
+void RenderRegistry::finish(const PageCache::CacheKey& key, quintptr token, const QImage& image, bool success)
+{
+    std::vector<Private::Waiter> waiters;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (!d->takeLocked(key, token, &waiters)) return;
+    }
+
+    // Callbacks run without the lock so they may submit new work
+    for (const Private::Waiter& waiter : waiters) {
+        if (waiter.callback) waiter.callback(image, success);
+    }
+    emit renderFinished(key, success);
+}
+
+void RenderRegistry::abandon(const PageCache::CacheKey& key, quintptr token)
+{
+    std::vector<Private::Waiter> waiters;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (!d->takeLocked(key, token, &waiters)) return;
+    }
+
+    for (const Private::Waiter& waiter : waiters) {
+        if (waiter.callback) waiter.callback(QImage(), false);
+    }
+    emit renderFinished(key, false);
+}
+
+void RenderRegistry::withdraw(const PageCache::CacheKey& key, quintptr token)
+{
+    QMutexLocker locker(&d->mutex);
+    auto it = d->renders.find(key);
+    if (it == d->renders.end()) return;
+    std::vector<Private::Waiter>& waiters = it->second.waiters;
+    for (auto waiter = waiters.begin(); waiter != waiters.end(); ++waiter) {
+        if (waiter->token == token) {
+            waiters.erase(waiter);
+            return;
+        }
+    }
+}
+
+bool RenderRegistry::isInFlight(const PageCache::CacheKey& key) const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->renders.find(key) != d->renders.end();
+}
+
+int RenderRegistry::waiterCount(const PageCache::CacheKey& key) const
+{
+    QMutexLocker locker(&d->mutex);
+    auto it = d->renders.find(key);
+    return it == d->renders.end() ? 0 : static_cast<int>(it->second.waiters.size());
+}
+
+int RenderRegistry::inFlightCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return static_cast<int>(d->renders.size());
+}
+
+} // namespace QuantilyxDoc
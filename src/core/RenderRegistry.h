@@ -0,0 +1,132 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_RENDERREGISTRY_H
+#define QUANTILYX_RENDERREGISTRY_H
+
+#include "PageCache.h"
+#include <QObject>
+#include <QImage>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Registry of page renders that are queued or running.
+ *
+ * PageCache only knows about finished images, so it cannot tell a renderer
+ * that the same key is already being produced. Renderers claim a
+ * PageCache::CacheKey here before queueing work. The first claimant owns the
+ * render; later ones are attached as waiters and are called back with the
+ * owner's result instead of rendering the key again.
+ *
+ * Used by RenderThread and ProgressiveRenderer; views check isInFlight()
+ * before submitting and repaint on renderFinished().
+ */
+class RenderRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Called once with the result of the render a waiter joined.
+     * Runs on the thread that finished the render.
+     */
+    using Callback = std::function<void(const QImage& image, bool success)>;
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit RenderRegistry(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~RenderRegistry() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global RenderRegistry instance.
+     */
+    static RenderRegistry& instance();
+
+    /**
+     * @brief Claim a key, or join the render already in flight for it.
+     * @param key Cache key the render produces.
+     * @param token Caller's request ID; identifies the owner or the waiter.
+     * @param callback Invoked with the result if the caller joins.
+     * @return True if the caller now owns the render and must perform it,
+     * false if it was attached as a waiter.
+     */
+    bool beginOrJoin(const PageCache::CacheKey& key, quintptr token, Callback callback);
+
+    /**
+     * @brief Report the result of an owned render and notify all waiters.
+     * Ignored if token no longer owns the key, e.g. after abandon().
+     * @param key Cache key the render produced.
+     * @param token Owner's request ID.
+     * @param image Rendered image, null on failure.
+     * @param success Whether the render succeeded.
+     */
+    void finish(const PageCache::CacheKey& key, quintptr token, const QImage& image, bool success);
+
+    /**
+     * @brief Give up an owned render. Waiters are told it failed.
+     * @param key Cache key of the render.
+     * @param token Owner's request ID.
+     */
+    void abandon(const PageCache::CacheKey& key, quintptr token);
+
+    /**
+     * @brief Detach a waiter; its callback will not be invoked.
+     * @param key Cache key the waiter joined.
+     * @param token Waiter's request ID.
+     */
+    void withdraw(const PageCache::CacheKey& key, quintptr token);
+
+    /**
+     * @brief Check if a render for a key is queued or running.
+     * @param key Cache key to check.
+     * @return True if in flight.
+     */
+    bool isInFlight(const PageCache::CacheKey& key) const;
+
+    /**
+     * @brief Get the number of waiters attached to a render.
+     * @param key Cache key of the render.
+     * @return Waiter count, 0 if none or not in flight.
+     */
+    int waiterCount(const PageCache::CacheKey& key) const;
+
+    /**
+     * @brief Get the number of distinct renders in flight.
+     * @return In-flight count.
+     */
+    int inFlightCount() const;
+
+signals:
+    /**
+     * @brief Emitted when an in-flight render finishes or is abandoned.
+     * @param key Cache key of the render.
+     * @param success Whether an image was produced.
+     */
+    void renderFinished(const QuantilyxDoc::PageCache::CacheKey& key, bool success);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static RenderRegistry* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_RENDERREGISTRY_H
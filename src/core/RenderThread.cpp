@@ -8,37 +8,317 @@
  * (at your option) any later version.
  */
 #include "RenderThread.h"
+#include "BandedRenderer.h"
+#include "CancellationToken.h"
+#include "ImageBufferPool.h"
 #include "Page.h"
 #include "Document.h"
+#include "PageCache.h"
+#include "PixelFormat.h"
+#include "DiskPageCache.h"
+#include "RenderRegistry.h"
+#include "Settings.h"
 #include "Logger.h"
+#include "Tracing.h"
 #include <QMutex>
 #include <QMutexLocker>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
 #include <QWaitCondition>
-#include <QQueue>
+#include <QHash>
+#include <QSet>
 #include <QImage>
 #include <QPainter>
+#include <QTransform>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QMetaType>
 #include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace QuantilyxDoc {
 
 class RenderThread::Private {
 public:
-    Private(RenderThread* q_ptr) : q(q_ptr), shouldQuit(false), isProcessing(false) {}
+    // One worker's queue, in submission order. Workers pick by priority,
+    // so a queue is scanned rather than popped.
+    struct WorkerQueue {
+        QMutex mutex;
+        std::deque<RenderRequest> requests;
+    };
+
+    class Worker : public QThread {
+    public:
+        Worker(Private* pool, int index) : pool(pool), index(index) {}
+
+    protected:
+        void run() override { pool->workerLoop(index); }
+
+    private:
+        Private* pool;
+        int index;
+    };
+
+    Private(RenderThread* q_ptr)
+        : q(q_ptr), priority(QThread::HighestPriority), queuedCount(0), shouldQuit(false), nextQueue(0) {}
 
     RenderThread* q;
-    mutable QMutex mutex;
-    QWaitCondition condition;
-    QQueue<RenderRequest> requestQueue;
-    QSet<quintptr> activeRequestIds; // IDs currently being processed
-    volatile bool shouldQuit;
-    bool isProcessing; // Flag to indicate if a request is actively being worked on
+    // A request being processed, with the token its render checks
+    struct ActiveRender {
+        Page* page = nullptr;
+        bool claimed = false; // Holds a RenderRegistry claim on key
+        PageCache::CacheKey key;
+        CancellationToken token;
+    };
+
+    mutable QMutex mutex; // Protects activeRenders and joinedRequests
+    QHash<quintptr, ActiveRender> activeRenders; // Requests currently being processed, by ID
+    QHash<quintptr, PageCache::CacheKey> joinedRequests; // IDs waiting on another render of the same key
+    // Workers read queues without the lock: it is filled before they start
+    // and emptied after they stop. Every other thread reads both vectors
+    // under queuesLock, which setWorkerCount() holds to replace them.
+    mutable QReadWriteLock queuesLock;
+    QMutex resizeMutex; // Serializes setWorkerCount()
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // One per worker, same index
+    std::vector<std::unique_ptr<Worker>> workers;
+    QThread::Priority priority;
+
+    // Idle workers sleep here until a request is queued
+    QMutex sleepMutex;
+    QWaitCondition wakeCondition;
+    std::atomic<int> queuedCount;
+    std::atomic<bool> shouldQuit;
+    std::atomic<unsigned> nextQueue;
+    LatencyHistogram renderLatency;
+
+    // Pages being rendered whole to be cut into tiles, by their whole-page key
+    QMutex cuttingMutex;
+    QWaitCondition cuttingDone;
+    QSet<PageCache::CacheKey> pagesBeingCut;
+
+    static int defaultWorkerCount() {
+        const int configured = Settings::instance().value<int>("Advanced/RenderWorkers", 0);
+        if (configured > 0) return configured;
+        // Leave a core to the GUI thread
+        return qMax(1, QThread::idealThreadCount() - 1);
+    }
+
+    // Call with queuesLock held for writing
+    void startWorkers(int count) {
+        shouldQuit = false;
+        for (int i = 0; i < count; ++i) {
+            queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+        }
+        for (int i = 0; i < count; ++i) {
+            workers.push_back(std::unique_ptr<Worker>(new Worker(this, i)));
+            workers.back()->start(priority);
+        }
+        LOG_INFO("RenderThread: Started " << count << " render workers.");
+    }
+
+    // Stop all workers after their current render. Requests queued
+    // meanwhile stay in the queues for takeQueued().
+    void joinWorkers() {
+        {
+            QMutexLocker locker(&sleepMutex);
+            shouldQuit = true;
+            wakeCondition.wakeAll();
+        }
+        QReadLocker locker(&queuesLock);
+        for (auto& worker : workers) {
+            worker->wait();
+        }
+    }
+
+    // Drop the stopped workers and their queues and return what was still
+    // queued. Call after joinWorkers(), with queuesLock held for writing.
+    QList<RenderRequest> takeQueued() {
+        workers.clear();
+
+        QList<RenderRequest> leftover;
+        for (auto& queue : queues) {
+            for (const RenderRequest& req : queue->requests) {
+                leftover.append(req);
+            }
+        }
+        queues.clear();
+        queuedCount = 0;
+        return leftover;
+    }
+
+    void enqueue(const RenderRequest& request) {
+        QReadLocker locker(&queuesLock);
+        enqueueLocked(request);
+    }
+
+    // Call with queuesLock held
+    void enqueueLocked(const RenderRequest& request) {
+        WorkerQueue& queue = *queues[nextQueue++ % queues.size()];
+        {
+            QMutexLocker locker(&queue.mutex);
+            queue.requests.push_back(request);
+        }
+        ++queuedCount;
+        QMutexLocker locker(&sleepMutex);
+        wakeCondition.wakeOne();
+    }
+
+    // Helper to take the most urgent queued request for a worker. Queues are
+    // scanned one lock at a time; on equal priority its own queue and then
+    // the oldest request win. Retries if the pick was taken meanwhile.
+    bool takeNext(int index, RenderRequest* request) {
+        const int count = static_cast<int>(queues.size());
+        while (queuedCount.load() > 0) {
+            int bestQueue = -1;
+            quintptr bestId = 0;
+            int bestPriority = 0;
+            for (int offset = 0; offset < count; ++offset) {
+                const int queueIndex = (index + offset) % count;
+                WorkerQueue& queue = *queues[queueIndex];
+                QMutexLocker locker(&queue.mutex);
+                for (const RenderRequest& req : queue.requests) {
+                    if (bestQueue < 0 || req.priority < bestPriority) {
+                        bestQueue = queueIndex;
+                        bestId = req.requestId;
+                        bestPriority = req.priority;
+                    }
+                }
+            }
+            if (bestQueue < 0) return false;
+
+            WorkerQueue& queue = *queues[bestQueue];
+            QMutexLocker locker(&queue.mutex);
+            auto it = std::find_if(queue.requests.begin(), queue.requests.end(),
+                                   [bestId](const RenderRequest& r) { return r.requestId == bestId; });
+            if (it == queue.requests.end()) continue; // Another worker took it
+            *request = *it;
+            queue.requests.erase(it);
+            --queuedCount;
+            return true;
+        }
+        return false;
+    }
+
+    // Helper to visit every queued request under its queue's lock
+    template <typename Function>
+    void forEachQueued(Function function) {
+        QReadLocker queuesLocker(&queuesLock);
+        for (auto& queue : queues) {
+            QMutexLocker locker(&queue->mutex);
+            for (RenderRequest& req : queue->requests) {
+                function(req);
+            }
+        }
+    }
+
+    void workerLoop(int index) {
+        forever {
+            if (shouldQuit) break;
+
+            RenderRequest request;
+            if (!takeNext(index, &request)) {
+                // Wait until there's work to do or we need to quit
+                QMutexLocker locker(&sleepMutex);
+                if (queuedCount.load() <= 0 && !shouldQuit) {
+                    wakeCondition.wait(&sleepMutex);
+                }
+                continue;
+            }
+
+            ActiveRender active;
+            active.page = request.page;
+            active.claimed = request.documentId != 0 && request.page;
+            if (active.claimed) active.key = cacheKeyFor(request);
+            active.token = CancellationToken::create(CancellationToken());
+            {
+                QMutexLocker locker(&mutex);
+                activeRenders.insert(request.requestId, active);
+            }
+
+            // Process the request without any lock held; backends and band
+            // helpers find the token as the current one
+            QElapsedTimer renderTimer;
+            renderTimer.start();
+            RenderResult result;
+            {
+                CancellationScope scope(active.token);
+                result = processRequest(request);
+            }
+            result.renderTimeMs = renderTimer.elapsed();
+            renderLatency.record(renderTimer.nsecsElapsed() / 1000);
+
+            int activeCount = 0;
+            {
+                QMutexLocker locker(&mutex);
+                activeRenders.remove(request.requestId);
+                activeCount = activeRenders.size();
+            }
+            emit q->queueStatusChanged(queuedCount.load(), activeCount);
+
+            // Hand the result to requests that joined this render, then to the owner
+            if (request.documentId != 0 && request.page) {
+                RenderRegistry::instance().finish(cacheKeyFor(request), request.requestId,
+                                                  result.image, result.success);
+            }
+
+            // Emit the result on the thread where this object lives (usually main thread due to queued connections)
+            emit q->renderCompleted(result);
+        }
+        LOG_DEBUG("Render worker " << index << " exiting run loop.");
+    }
+
+    // Helper to build the PageCache key a request renders into
+    static PageCache::CacheKey cacheKeyFor(const RenderRequest& req) {
+        PageCache::CacheKey key;
+        key.documentId = req.documentId;
+        key.pageIndex = req.page->pageIndex();
+        key.zoomLevel = req.zoomLevel;
+        key.rotation = req.rotation;
+        key.targetSize = req.targetSize;
+        key.tileX = req.tileX;
+        key.tileY = req.tileY;
+        return key;
+    }
+
+    // Helper to stop active renders the filter accepts; they finish as
+    // canceled at their next check. Waiters joined to them are told the
+    // render failed, as for queued requests.
+    template <typename Filter>
+    int cancelActive(Filter filter) {
+        QMutexLocker locker(&mutex);
+        int count = 0;
+        for (auto it = activeRenders.cbegin(); it != activeRenders.cend(); ++it) {
+            if (!it.value().token.isCanceled() && filter(it.key(), it.value())) {
+                it.value().token.cancel();
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    // Helper to release the registry claims of requests that were just
+    // canceled. Waiters joined to them are told the render failed. Must be
+    // called without the mutex, since waiters' callbacks take it.
+    static void abandonClaims(const QList<RenderRequest>& canceled) {
+        for (const RenderRequest& req : canceled) {
+            if (req.documentId != 0 && req.page) {
+                RenderRegistry::instance().abandon(cacheKeyFor(req), req.requestId);
+            }
+        }
+    }
 
     // Helper to process a single request
     RenderResult processRequest(const RenderRequest& req) {
+        TRACE_ZONE("RenderThread::processRequest");
         RenderResult result;
         result.requestId = req.requestId;
         result.success = false;
+        result.renderTimeMs = 0;
 
         if (req.canceled) {
             result.errorMessage = "Request was canceled.";
@@ -52,205 +332,383 @@ public:
             return result;
         }
 
-        // --- Simulated Rendering Logic ---
-        // In a real implementation, this would call page->render(targetSize, zoom, rotation, clipRect, highQuality)
-        // Here, we create a placeholder image based on page size and request parameters.
+        // A page evicted from memory earlier may still be on disk; reading it
+        // back is far cheaper than rendering it again.
+        if (req.documentId != 0) {
+            PageCache::CacheKey key = cacheKeyFor(req);
+            QImage diskImage = DiskPageCache::instance().load(key); // Stored as PageCache keeps it
+            if (!diskImage.isNull()) {
+                diskImage.setDevicePixelRatio(req.devicePixelRatio); // Not kept on disk
+                PageCache::instance().put(key, diskImage);
+                result.image = std::move(diskImage);
+                result.success = true;
+                LOG_DEBUG("Loaded page " << req.page->pageIndex() << " from disk cache for request " << req.requestId);
+                return result;
+            }
+        }
+
         QSizeF pageSize = req.page->size(); // Size in points
-        if (pageSize.isEmpty()) {
+        if (pageSize.isEmpty() || req.targetSize.isEmpty()) {
             result.errorMessage = "Page has invalid size.";
             LOG_ERROR("Page " << req.page->pageIndex() << " has invalid size for render request " << req.requestId);
             return result;
         }
 
-        // Calculate scaling factors to convert from points to pixels
-        qreal dpi = 72.0; // Base DPI
-        qreal scaleX = (req.targetSize.width() > 0) ? (req.targetSize.width() / pageSize.width()) * 72.0 / dpi : 1.0;
-        qreal scaleY = (req.targetSize.height() > 0) ? (req.targetSize.height() / pageSize.height()) * 72.0 / dpi : 1.0;
-        // Use average scale or take min/max depending on fit strategy (FitWidth, FitHeight, FitBoth)
-        qreal scale = qMin(scaleX, scaleY);
+        // targetSize is the rotated page; rasterize unrotated and turn the result
+        QSize unrotatedSize = req.targetSize;
+        if (req.rotation == 90 || req.rotation == 270) {
+            unrotatedSize.transpose();
+        }
+        qreal scale = qMin(unrotatedSize.width() / pageSize.width(), unrotatedSize.height() / pageSize.height());
+
+        // Pages identical to one already rendered, in any document, share its image
+        QByteArray digest;
+        const bool contentAddressed = req.documentId != 0 && Settings::snapshot().contentAddressedPages;
+        if (contentAddressed) {
+            digest = req.page->contentDigest();
+            QImage shared = PageCache::instance().findContent(cacheKeyFor(req), digest);
+            if (!shared.isNull()) {
+                result.image = std::move(shared);
+                result.success = true;
+                LOG_DEBUG("Page " << req.page->pageIndex() << " shares the rendering of an identical page for request " << req.requestId);
+                return result;
+            }
+        }
 
-        QSize renderSize = QSize(qRound(pageSize.width() * scale), qRound(pageSize.height() * scale));
+        const bool blank = contentAddressed && req.page->isBlank();
+        if (req.clipRect.isValid() && req.documentId != 0 && !blank && !req.page->rendersRegionsDirectly()) {
+            return renderTileFromPage(req, unrotatedSize, digest);
+        }
 
-        // Create image
-        QImage image(renderSize, QImage::Format_ARGB32_Premultiplied);
-        if (image.isNull()) {
-            result.errorMessage = "Failed to create image buffer.";
-            LOG_ERROR("Failed to create image buffer for render request " << req.requestId);
+        QImage image;
+        QSize regionSize = unrotatedSize;
+        if (req.clipRect.isValid()) {
+            regionSize = QSize(qMax(1, qRound(req.clipRect.width() * scale)), qMax(1, qRound(req.clipRect.height() * scale)));
+        }
+        if (blank) {
+            // Nothing to rasterize; stored as one bit a pixel below
+            image = ImageBufferPool::instance().acquire(regionSize);
+            if (!image.isNull()) image.fill(Qt::white);
+        } else if (req.clipRect.isValid()) {
+            // Tile request: only the clipped region is rasterized
+            image = req.page->renderRectangle(req.clipRect, regionSize.width(), regionSize.height());
+        } else {
+            image = BandedRenderer::shouldBand(req.page, unrotatedSize)
+                        ? BandedRenderer::render(req.page, unrotatedSize)
+                        : req.page->render(unrotatedSize.width(), unrotatedSize.height());
+        }
+        // An aborted render may return a partial image, which must not be cached
+        if (CancellationToken::currentIsCanceled()) {
+            result.errorMessage = "Request was canceled.";
+            LOG_DEBUG("Render request " << req.requestId << " was canceled while rendering.");
             return result;
         }
-        image.fill(Qt::lightGray); // Placeholder background
-
-        QPainter painter(&image);
-        if (!painter.isActive()) {
-            result.errorMessage = "Failed to initialize painter.";
-            LOG_ERROR("Failed to initialize painter for render request " << req.requestId);
+        if (image.isNull()) {
+            result.errorMessage = "Page rendering failed.";
+            LOG_ERROR("Failed to render page " << req.page->pageIndex() << " for render request " << req.requestId);
             return result;
         }
 
-        // Apply transformations based on rotation
-        switch (req.rotation) {
-            case 90:
-                painter.translate(image.width(), 0);
-                painter.rotate(90);
-                break;
-            case 180:
-                painter.translate(image.width(), image.height());
-                painter.rotate(180);
-                break;
-            case 270:
-                painter.translate(0, image.height());
-                painter.rotate(270);
-                break;
-            default:
-                break; // No rotation
-        }
-
-        // Simulate drawing page content (placeholder)
-        painter.fillRect(0, 0, pageSize.width() * scale, pageSize.height() * scale, QColor(200, 220, 255)); // Light blue page
-        painter.setPen(Qt::black);
-        painter.drawText(QRectF(10, 10, pageSize.width() * scale - 20, 20), Qt::AlignLeft, QString("Page %1").arg(req.page->pageIndex()));
-
-        painter.end();
-
-        result.image = image;
+        image = finishImage(std::move(image), req);
+        if (req.documentId != 0) {
+            PageCache::instance().put(cacheKeyFor(req), image, digest);
+        }
+        result.image = std::move(image);
         result.success = true;
         LOG_DEBUG("Successfully rendered page " << req.page->pageIndex() << " for request " << req.requestId);
 
         return result;
     }
+
+    // Helper to turn a rendered, unrotated image into the one cached and shown
+    static QImage finishImage(QImage image, const RenderRequest& req) {
+        // Converted once here, so painting never converts per frame
+        image = ImageBufferPool::toPipelineFormat(std::move(image));
+        if (req.rotation != 0) {
+            image = image.transformed(QTransform().rotate(req.rotation));
+        }
+        // Scans are cached in grey levels or one bit a pixel; views expand them when drawing
+        if (Settings::snapshot().compactScannedPages) {
+            image = PixelFormat::compact(image);
+        }
+        // Tagged before caching, so no painter ever detaches a cached tile to tag it
+        image.setDevicePixelRatio(req.devicePixelRatio);
+        return image;
+    }
+
+    // Helper to render a tile of a page that cannot rasterize a region by
+    // itself. Each tile would cost a whole-page render, so the page is
+    // rendered once and cut into all its tiles, which go to PageCache;
+    // workers holding other tiles of it wait and take theirs from there.
+    RenderResult renderTileFromPage(const RenderRequest& req, const QSize& unrotatedSize, const QByteArray& digest) {
+        RenderResult result;
+        result.requestId = req.requestId;
+        result.success = false;
+        result.renderTimeMs = 0;
+
+        const PageCache::CacheKey key = cacheKeyFor(req);
+        PageCache::CacheKey pageKey = key;
+        pageKey.tileX = -1;
+        pageKey.tileY = -1;
+        {
+            QMutexLocker locker(&cuttingMutex);
+            while (pagesBeingCut.contains(pageKey)) cuttingDone.wait(&cuttingMutex);
+            QImage cached = PageCache::instance().get(key);
+            if (!cached.isNull()) {
+                result.image = std::move(cached);
+                result.success = true;
+                LOG_DEBUG("Tile of page " << req.page->pageIndex() << " was cut from its page for request " << req.requestId);
+                return result;
+            }
+            pagesBeingCut.insert(pageKey);
+        }
+
+        QImage page = req.page->render(unrotatedSize.width(), unrotatedSize.height());
+        if (CancellationToken::currentIsCanceled()) {
+            result.errorMessage = "Request was canceled.";
+            LOG_DEBUG("Render request " << req.requestId << " was canceled while rendering.");
+        } else if (page.isNull()) {
+            result.errorMessage = "Page rendering failed.";
+            LOG_ERROR("Failed to render page " << req.page->pageIndex() << " for render request " << req.requestId);
+        } else {
+            page = finishImage(std::move(page), req);
+            const int tileSize = PageCache::TileSize;
+            PageCache::CacheKey tileKey = key;
+            for (int row = 0; row * tileSize < page.height(); ++row) {
+                for (int column = 0; column * tileSize < page.width(); ++column) {
+                    QImage tile = page.copy(QRect(column * tileSize, row * tileSize, tileSize, tileSize).intersected(page.rect()));
+                    tile.setDevicePixelRatio(req.devicePixelRatio);
+                    tileKey.tileX = column;
+                    tileKey.tileY = row;
+                    if (column == req.tileX && row == req.tileY) result.image = tile;
+                    PageCache::instance().put(tileKey, tile, digest);
+                }
+            }
+            result.success = !result.image.isNull();
+            if (!result.success) result.errorMessage = "Tile is outside the page.";
+            LOG_DEBUG("Rendered page " << req.page->pageIndex() << " whole and cut it into tiles for request " << req.requestId);
+        }
+
+        QMutexLocker locker(&cuttingMutex);
+        pagesBeingCut.remove(pageKey);
+        cuttingDone.wakeAll();
+        return result;
+    }
 };
 
+// Static instance pointer
+RenderThread* RenderThread::s_instance = nullptr;
+
+quintptr RenderThread::nextRequestId()
+{
+    static std::atomic<quintptr> counter{0};
+    return ++counter;
+}
+
+RenderThread& RenderThread::instance()
+{
+    if (!s_instance) {
+        s_instance = new RenderThread();
+    }
+    return *s_instance;
+}
+
 RenderThread::RenderThread(QObject* parent)
-    : QThread(parent)
+    : QObject(parent)
     , d(new Private(this))
 {
-    // Start the thread upon construction
-    start(HighestPriority); // Rendering should be fast, but prioritize responsiveness
+    // Results reach the GUI thread through queued connections
+    qRegisterMetaType<RenderResult>("QuantilyxDoc::RenderThread::RenderResult");
+
+    // Start the workers upon construction
+    QWriteLocker locker(&d->queuesLock);
+    d->startWorkers(Private::defaultWorkerCount());
 }
 
 RenderThread::~RenderThread()
 {
-    d->shouldQuit = true;
-    d->condition.wakeAll(); // Wake up the thread if it's waiting
-    wait(); // Wait for the thread to finish its current task and exit
-    // Mutex lock is implicit in member functions accessing d->requestQueue
-    QMutexLocker locker(&d->mutex);
-    // Clear any remaining requests
-    while (!d->requestQueue.isEmpty()) {
-        auto req = d->requestQueue.dequeue();
+    d->joinWorkers();
+    QList<RenderRequest> discarded;
+    {
+        QWriteLocker locker(&d->queuesLock);
+        discarded = d->takeQueued();
+    }
+    for (const RenderRequest& req : discarded) {
         LOG_WARN("Discarding render request " << req.requestId << " during shutdown.");
     }
+    {
+        QMutexLocker locker(&d->mutex);
+        d->joinedRequests.clear(); // Nobody is left to receive their results
+    }
+    Private::abandonClaims(discarded);
 }
 
 void RenderThread::submitRequest(const RenderRequest& request)
 {
-    QMutexLocker locker(&d->mutex);
-    d->requestQueue.enqueue(request);
-    d->condition.wakeOne(); // Notify the thread that a new request is available
-    emit queueStatusChanged(d->requestQueue.size(), d->activeRequestIds.size());
+    if (request.documentId != 0 && request.page) {
+        // Join a render of the same key instead of queueing a duplicate
+        const PageCache::CacheKey key = Private::cacheKeyFor(request);
+        const quintptr requestId = request.requestId;
+        {
+            // Recorded first: the shared render may finish before beginOrJoin returns
+            QMutexLocker locker(&d->mutex);
+            d->joinedRequests.insert(requestId, key);
+        }
+        bool owner = RenderRegistry::instance().beginOrJoin(key, requestId,
+            [this, requestId](const QImage& image, bool success) {
+                {
+                    QMutexLocker locker(&d->mutex);
+                    if (!d->joinedRequests.remove(requestId)) return; // Canceled meanwhile
+                }
+                RenderResult result;
+                result.requestId = requestId;
+                result.image = image;
+                result.success = success;
+                result.renderTimeMs = 0;
+                if (!success) result.errorMessage = "Shared render failed or was canceled.";
+                emit renderCompleted(result);
+            });
+        if (!owner) return;
+        QMutexLocker locker(&d->mutex);
+        d->joinedRequests.remove(requestId);
+    }
+
+    d->enqueue(request); // Wakes one idle worker
+    emit queueStatusChanged(pendingRequestCount(), activeRequestCount());
 }
 
 void RenderThread::cancelRequest(quintptr requestId)
 {
-    QMutexLocker locker(&d->mutex);
-    // Mark the specific request as canceled if it's queued
-    auto it = std::find_if(d->requestQueue.begin(), d->requestQueue.end(),
-                           [requestId](const RenderRequest& r) { return r.requestId == requestId; });
-    if (it != d->requestQueue.end()) {
-        it->canceled = true;
-        LOG_DEBUG("Marked render request " << requestId << " as canceled (queued).");
+    {
+        QMutexLocker locker(&d->mutex);
+        // A joined request only stops waiting; the shared render goes on
+        auto joined = d->joinedRequests.find(requestId);
+        if (joined != d->joinedRequests.end()) {
+            RenderRegistry::instance().withdraw(joined.value(), requestId);
+            d->joinedRequests.erase(joined);
+            LOG_DEBUG("Withdrew joined render request " << requestId << ".");
+            return;
+        }
     }
-    // If the request is already active, the processing logic in run() will check the flag.
-    // Adding the ID to a separate 'cancelledActive' set could make this more efficient if needed.
-    // For now, the active request processing loop checks the flag inside the request object itself.
+
+    // Mark the specific request as canceled if it's queued, unless other
+    // requests are waiting for its result
+    QList<RenderRequest> canceled;
+    d->forEachQueued([&](RenderRequest& req) {
+        if (req.requestId != requestId || req.canceled) return;
+        if (req.documentId != 0 && req.page &&
+            RenderRegistry::instance().waiterCount(Private::cacheKeyFor(req)) > 0) {
+            LOG_DEBUG("Keeping render request " << requestId << ", other requests wait for it.");
+            return;
+        }
+        req.canceled = true;
+        canceled.append(req);
+        LOG_DEBUG("Marked render request " << requestId << " as canceled (queued).");
+    });
+    Private::abandonClaims(canceled);
+
+    // An active request stops too, under the same condition
+    const int stopped = d->cancelActive([requestId](quintptr id, const Private::ActiveRender& active) {
+        if (id != requestId) return false;
+        return !active.claimed || RenderRegistry::instance().waiterCount(active.key) == 0;
+    });
+    if (stopped > 0) LOG_DEBUG("Canceled active render request " << requestId << ".");
 }
 
 void RenderThread::cancelRequestsForPage(Page* page)
 {
-    QMutexLocker locker(&d->mutex);
     if (!page) return;
-
+    QList<RenderRequest> canceled;
     // Mark all queued requests for this page as canceled
-    for (auto& req : d->requestQueue) {
-        if (req.page == page) {
+    d->forEachQueued([&](RenderRequest& req) {
+        if (req.page == page && !req.canceled) {
             req.canceled = true;
+            canceled.append(req);
             LOG_DEBUG("Marked render request " << req.requestId << " for page " << page->pageIndex() << " as canceled (queued).");
         }
-    }
-    // Active requests for this page will be checked similarly during processing.
+    });
+    // Requests joined to these are told the render failed
+    Private::abandonClaims(canceled);
+    d->cancelActive([page](quintptr, const Private::ActiveRender& active) { return active.page == page; });
 }
 
 void RenderThread::cancelAllRequests()
 {
-    QMutexLocker locker(&d->mutex);
+    QList<RenderRequest> canceled;
     // Mark all queued requests as canceled
-    for (auto& req : d->requestQueue) {
-        req.canceled = true;
-    }
-    LOG_DEBUG("Marked all " << d->requestQueue.size() << " queued render requests as canceled.");
-    // Active requests will also be checked.
+    d->forEachQueued([&](RenderRequest& req) {
+        if (!req.canceled) {
+            req.canceled = true;
+            canceled.append(req);
+        }
+    });
+    const int stopped = d->cancelActive([](quintptr, const Private::ActiveRender&) { return true; });
+    LOG_DEBUG("Marked all " << canceled.size() << " queued render requests as canceled, stopped "
+              << stopped << " active ones.");
+    Private::abandonClaims(canceled);
+}
+
+void RenderThread::reprioritize(quintptr documentId, const std::function<int(int pageIndex)>& priorityForPage)
+{
+    if (documentId == 0 || !priorityForPage) return;
+    d->forEachQueued([&](RenderRequest& req) {
+        if (req.documentId == documentId && req.page && !req.canceled) {
+            req.priority = priorityForPage(req.page->pageIndex());
+        }
+    });
 }
 
 bool RenderThread::isBusy() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->isProcessing || !d->requestQueue.isEmpty();
+    return pendingRequestCount() > 0 || activeRequestCount() > 0;
 }
 
 int RenderThread::pendingRequestCount() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->requestQueue.size();
+    return qMax(0, d->queuedCount.load());
 }
 
 int RenderThread::activeRequestCount() const
 {
     QMutexLocker locker(&d->mutex);
-    return d->activeRequestIds.size();
+    return d->activeRenders.size();
 }
 
-void RenderThread::setPriority(Priority priority)
+const LatencyHistogram& RenderThread::renderLatency() const
 {
-    QThread::setPriority(priority);
+    return d->renderLatency;
 }
 
-void RenderThread::run()
+int RenderThread::workerCount() const
 {
-    forever {
-        RenderRequest request;
-        {
-            QMutexLocker locker(&d->mutex);
-            // Wait until there's work to do or we need to quit
-            while (d->requestQueue.isEmpty() && !d->shouldQuit) {
-                d->condition.wait(&d->mutex);
-            }
-
-            if (d->shouldQuit) {
-                break; // Exit the loop and terminate the thread
-            }
-
-            // Dequeue the next request
-            request = d->requestQueue.dequeue();
-            d->activeRequestIds.insert(request.requestId);
-            d->isProcessing = true;
-        }
-
-        // Process the request *outside* the mutex lock to avoid blocking other threads submitting requests
-        RenderResult result = processRequest(request);
-
-        // Acquire lock again to emit signal and update state
-        {
-            QMutexLocker locker(&d->mutex);
-            d->activeRequestIds.remove(request.requestId);
-            d->isProcessing = false;
-            emit queueStatusChanged(d->requestQueue.size(), d->activeRequestIds.size());
-        }
+    QReadLocker locker(&d->queuesLock);
+    return static_cast<int>(d->workers.size());
+}
 
-        // Emit the result on the thread where this object lives (usually main thread due to queued connections)
-        emit renderCompleted(result);
+void RenderThread::setWorkerCount(int count)
+{
+    if (count <= 0) count = Private::defaultWorkerCount();
+    QMutexLocker resizeLocker(&d->resizeMutex);
+    if (count == workerCount()) return;
+
+    // Requests queued on the old workers move to the new ones;
+    // submitRequest() and the cancel calls wait while the queues are replaced
+    d->joinWorkers();
+    QWriteLocker locker(&d->queuesLock);
+    QList<RenderRequest> pending = d->takeQueued();
+    d->startWorkers(count);
+    for (const RenderRequest& req : pending) {
+        d->enqueueLocked(req);
+    }
+}
 
-    } // forever
-    LOG_DEBUG("RenderThread " << QThread::currentThreadId() << " exiting run loop.");
+void RenderThread::setPriority(QThread::Priority priority)
+{
+    QReadLocker locker(&d->queuesLock);
+    d->priority = priority;
+    for (auto& worker : d->workers) {
+        worker->setPriority(priority);
+    }
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
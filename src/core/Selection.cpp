@@ -11,24 +11,133 @@
 #include "Document.h"
 #include "Page.h"
 #include "Clipboard.h" // Assuming a core Clipboard manager exists
+#include "Logger.h"
+#include "ThreadPool.h"
 #include <QRectF>
 #include <QPointF>
 #include <QApplication> // For clipboard access if needed
 #include <QClipboard>
 #include <QMimeData>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QVector>
+#include <QWaitCondition>
 #include <algorithm> // For std::find_if, std::sort, std::unique
+#include <atomic>
+#include <functional>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Text extraction for one copy, shared by every thread working on it.
+// Segments are claimed in any order; their text lands at their own slot,
+// so the joined result keeps the selection's order.
+struct Extraction {
+    QVector<Page*> pages;
+    QVector<QRectF> regions;
+    QVector<QString> texts;
+
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    std::atomic<bool> canceled{false};
+    int claimed = -1; // Set by close()
+
+    QMutex mutex;
+    QWaitCondition segmentDone;
+
+    // Called on the extracting thread
+    std::function<void(int)> onProgress;
+    std::function<void()> onFinished;
+
+    void run() {
+        for (;;) {
+            const int slot = next++;
+            if (slot >= pages.size()) return;
+            if (!canceled) texts[slot] = pages.at(slot)->textInRegion(regions.at(slot));
+            const int count = ++done;
+            if (!canceled) {
+                if (count == pages.size()) {
+                    if (onFinished) onFinished();
+                } else if (onProgress) {
+                    onProgress(count);
+                }
+            }
+            QMutexLocker locker(&mutex);
+            segmentDone.wakeAll();
+        }
+    }
+
+    // Stop handing out segments; returns how many were claimed before
+    int close() {
+        claimed = qMin(next.exchange(pages.size()), pages.size());
+        return claimed;
+    }
+
+    // Wait until the claimed segments are finished, after close()
+    void wait() {
+        QMutexLocker locker(&mutex);
+        while (done.load() < claimed) {
+            segmentDone.wait(&mutex);
+        }
+    }
+};
+
+} // namespace
+
 class Selection::Private {
 public:
     Private() : document(nullptr) {}
     QList<Segment> segments;
     QPointer<Document> document; // Use QPointer for safety
+    std::shared_ptr<Extraction> extraction; // Running copy, if any
+    quint64 generation = 0; // Bumped when a copy is replaced; stale queued results are dropped
+    QMetaObject::Connection closedConnection;
+
+    static bool needsText(const Segment& seg) {
+        return (seg.type == Text || seg.type == Mixed) && !seg.content.isValid() && seg.page;
+    }
+
+    // Stop the running copy and wait for the pages it is reading
+    void cancelExtraction() {
+        if (!extraction) return;
+        extraction->canceled = true;
+        extraction->close();
+        extraction->wait();
+        extraction.reset();
+        ++generation;
+        QObject::disconnect(closedConnection);
+    }
+
+    QString joinedText() const {
+        QStringList texts;
+        for (const auto& seg : segments) {
+            if (seg.type == Text || seg.type == Mixed) {
+                texts << seg.content.toString(); // Assumes content is stored as QString for Text type
+            }
+        }
+        return texts.join("\n---\n"); // Join multi-segment text with a separator
+    }
+
+    void setClipboardText(const QString& text) const {
+        QClipboard* clipboard = QApplication::clipboard();
+        if (!clipboard) return;
+        QMimeData* mimeData = new QMimeData();
+        mimeData->setText(text);
+        mimeData->setHtml(text.toHtmlEscaped()); // Basic HTML representation
+        clipboard->setMimeData(mimeData);
+    }
 
     // Helper to update internal state based on segments
     void updateState() {
+        if (extraction) {
+            // The copy was of the old selection
+            cancelExtraction();
+            emit q->copyFinished(false);
+        }
+
         bool wasEmpty = segments.isEmpty();
         bool wasMultiPage = isMultiPageInternal();
         ContentType oldType = contentTypeInternal();
@@ -117,7 +226,8 @@ Selection::Selection(QObject* parent)
 
 Selection::~Selection()
 {
-    clear(); // Ensure segments are cleared properly
+    d->cancelExtraction(); // Workers read the selected pages
+    d->segments.clear(); // Signals are not emitted from a destructor
 }
 
 void Selection::clear()
@@ -186,13 +296,10 @@ QString Selection::selectedText() const
     if (contentType() != Text && contentType() != Mixed) {
         return QString(); // Only return text if primarily text content
     }
-    QStringList texts;
-    for (const auto& seg : d->segments) {
-        if (seg.type == Text || seg.type == Mixed) {
-            texts << seg.content.toString(); // Assumes content is stored as QString for Text type
-        }
+    for (auto& seg : d->segments) {
+        if (Private::needsText(seg)) seg.content = seg.page->textInRegion(seg.bounds);
     }
-    return texts.join("\n---\n"); // Join multi-segment text with a separator
+    return d->joinedText();
 }
 
 bool Selection::selectRegion(Page* page, const QRectF& region, ContentType typeHint)
@@ -206,7 +313,10 @@ bool Selection::selectRegion(Page* page, const QRectF& region, ContentType typeH
     seg.page = page;
     seg.bounds = region;
     seg.type = typeHint; // Use hint or try to determine from page
-    seg.content = QString("Selected region on page %1").arg(page->pageIndex()); // Dummy content
+    // Text is left unextracted until it is asked for
+    if (typeHint != Text && typeHint != Mixed) {
+        seg.content = QString("Selected region on page %1").arg(page->pageIndex()); // Dummy content
+    }
     seg.context = QString("Context for region %1").arg(region.toString()); // Dummy context
     seg.startIndex = -1; // Unknown
     seg.endIndex = -1;   // Unknown
@@ -225,8 +335,7 @@ bool Selection::extendSelection(Page* page, const QRectF& region)
     Segment seg;
     seg.page = page;
     seg.bounds = region;
-    seg.type = Text; // Default assumption
-    seg.content = QString("Extended selection on page %1").arg(page->pageIndex());
+    seg.type = Text; // Default assumption; the text is extracted when it is asked for
     seg.context = QString("Extended context for region %1").arg(region.toString());
     seg.startIndex = -1;
     seg.endIndex = -1;
@@ -269,27 +378,94 @@ bool Selection::copyToClipboard() const
 {
     if (isEmpty() || !canCopy()) return false;
 
-    QClipboard* clipboard = QApplication::clipboard();
-    if (!clipboard) return false;
-
-    QMimeData* mimeData = new QMimeData();
+    if (!QApplication::clipboard()) return false;
 
     ContentType type = contentType();
-    if (type == Text || type == Mixed) {
-        mimeData->setText(selectedText());
-        mimeData->setHtml(selectedText()); // Basic HTML representation
+    if (type != Text && type != Mixed) {
+        // Add other formats based on content type (images, etc.)
+        return false;
+    }
+
+    if (d->extraction) {
+        d->cancelExtraction();
+        emit d->q->copyFinished(false);
+    }
+
+    std::shared_ptr<Extraction> extraction = std::make_shared<Extraction>();
+    QVector<int> segmentIndices; // Segment index of each extraction slot
+    for (int i = 0; i < d->segments.size(); ++i) {
+        const Segment& seg = d->segments.at(i);
+        if (!Private::needsText(seg)) continue;
+        segmentIndices.append(i);
+        extraction->pages.append(seg.page);
+        extraction->regions.append(seg.bounds);
+    }
+    if (segmentIndices.isEmpty()) {
+        d->setClipboardText(d->joinedText());
+        LOG_INFO("Copied selection to clipboard.");
+        return true;
+    }
+    extraction->texts.resize(segmentIndices.size());
+
+    Private* priv = d.get();
+    const quint64 generation = ++d->generation;
+    const int total = segmentIndices.size();
+    extraction->onProgress = [priv, generation, total](int extracted) {
+        QMetaObject::invokeMethod(priv->q, [priv, generation, extracted, total]() {
+            if (generation == priv->generation) emit priv->q->copyProgress(extracted, total);
+        }, Qt::QueuedConnection);
+    };
+    extraction->onFinished = [priv, generation, total, segmentIndices]() {
+        QMetaObject::invokeMethod(priv->q, [priv, generation, total, segmentIndices]() {
+            if (generation != priv->generation || !priv->extraction) return;
+            // Keep the text, so copying again or selectedText() need not extract it
+            const std::shared_ptr<Extraction> finished = priv->extraction;
+            priv->extraction.reset();
+            QObject::disconnect(priv->closedConnection);
+            for (int i = 0; i < segmentIndices.size(); ++i) priv->segments[segmentIndices.at(i)].content = finished->texts.at(i);
+            priv->setClipboardText(priv->joinedText());
+            LOG_INFO("Copied selection to clipboard (" << total << " segments extracted).");
+            emit priv->q->copyProgress(total, total);
+            emit priv->q->copyFinished(true);
+        }, Qt::QueuedConnection);
+    };
+
+    // Pages must not be read once their document starts closing
+    if (d->document) {
+        d->closedConnection = connect(d->document.data(), &Document::closed, d->q, [priv]() {
+            if (!priv->extraction) return;
+            priv->cancelExtraction();
+            emit priv->q->copyFinished(false);
+        });
     }
-    // Add other formats based on content type (images, etc.)
 
-    clipboard->setMimeData(mimeData);
-    LOG_INFO("Copied selection to clipboard.");
+    d->extraction = extraction;
+    const int helpers = qMin(total, ThreadPool::instance().maxThreadCount());
+    for (int i = 0; i < helpers; ++i) {
+        ThreadPool::instance().submitDetached([extraction]() { extraction->run(); }, Task::Priority::Normal);
+    }
+    LOG_DEBUG("Selection: Extracting text of " << total << " segments for the clipboard");
     return true;
 }
 
+bool Selection::isCopying() const
+{
+    return d->extraction != nullptr;
+}
+
+void Selection::cancelCopy()
+{
+    if (!d->extraction) return;
+    d->cancelExtraction();
+    emit copyFinished(false);
+}
+
 bool Selection::cutToClipboard()
 {
     if (isEmpty() || !canCut()) return false;
 
+    // A cut is of one page; its text is extracted here so the copy is done before the content goes
+    selectedText();
     bool copied = copyToClipboard();
     if (copied) {
         // After copying, delete the original content
@@ -28,6 +28,11 @@ class Document;
  * Can represent selections of text, images, annotations, or other objects
  * across one or multiple pages. Provides methods to manipulate and query
  * the selected content.
+ *
+ * Text is extracted only when it is needed. copyToClipboard() extracts it
+ * page by page on the CPU pool and sets the clipboard when the last page
+ * is in, reporting copyProgress() on the way, so copying hundreds of
+ * pages does not block the GUI thread.
  */
 class Selection : public QObject
 {
@@ -55,7 +60,7 @@ public:
         Page* page;           // Page containing this segment
         QRectF bounds;        // Bounds of the segment in page coordinates
         ContentType type;     // Type of content selected
-        QVariant content;     // Actual content data (e.g., QString for text)
+        QVariant content;     // Actual content data (e.g., QString for text); invalid until text is extracted
         QString context;      // Surrounding context for verification
         int startIndex;       // Index within the page's content (e.g., character index)
         int endIndex;         // End index within the page's content
@@ -134,7 +139,9 @@ public:
 
     /**
      * @brief Get the selected text content.
-     * Only applicable if contentType() is Text or Mixed.
+     * Only applicable if contentType() is Text or Mixed. Text not extracted
+     * yet is extracted here, on the calling thread; copyToClipboard() does
+     * it in the background.
      * @return Selected text string.
      */
     QString selectedText() const;
@@ -179,10 +186,24 @@ public:
 
     /**
      * @brief Copy the selected content to the clipboard.
-     * @return True if the copy operation was successful.
+     * Text that still has to be extracted is extracted in the background;
+     * the clipboard is set, and copyFinished() emitted, once it is done.
+     * A copy already running is replaced.
+     * @return True if the copy was made or started.
      */
     bool copyToClipboard() const;
 
+    /**
+     * @brief Check if copyToClipboard() is still extracting text.
+     * @return True while a copy is running.
+     */
+    bool isCopying() const;
+
+    /**
+     * @brief Stop a running copy; the clipboard is left alone.
+     */
+    void cancelCopy();
+
     /**
      * @brief Cut the selected content to the clipboard.
      * This removes the content from the document.
@@ -242,6 +263,19 @@ signals:
     void canCutChanged();
     void canDeleteChanged();
 
+    /**
+     * @brief Emitted as a copy extracts the text of its segments.
+     * @param extracted Segments extracted so far.
+     * @param total Segments to extract.
+     */
+    void copyProgress(int extracted, int total);
+
+    /**
+     * @brief Emitted when a copy that needed background extraction ends.
+     * @param success False if it was cancelled or the selection changed first.
+     */
+    void copyFinished(bool success);
+
 private:
     class Private;
     std::unique_ptr<Private> d;
@@ -17,6 +17,9 @@
 #include <QMetaObject>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QSet>
+#include <atomic>
+#include <vector>
 
 namespace QuantilyxDoc {
 
@@ -38,6 +41,44 @@ public:
     QHash<QString, RegisteredSetting> registeredSettings;
     QMutex mutex; // Protect access to registeredSettings and qtSettings
 
+    // The hot-path snapshot. Replaced ones are kept until destruction, as
+    // readers on other threads may still be looking at them; settings
+    // change rarely, so they stay few.
+    std::atomic<const SettingsSnapshot*> snapshot{nullptr};
+    std::vector<std::unique_ptr<const SettingsSnapshot>> snapshots;
+    QMutex snapshotMutex; // Serializes publishSnapshot()
+
+    static const QSet<QString>& snapshotKeys() {
+        static const QSet<QString> keys = {
+            "Display/BackgroundColor", "Advanced/PrefetchPages", "Advanced/BandedRenderMegapixels",
+            "Advanced/GpuTextureCacheMB", "Advanced/ImageBufferPoolMB", "Advanced/ComicKeepOriginals",
+            "Advanced/CompactScannedPages", "Advanced/ContentAddressedPages"
+        };
+        return keys;
+    }
+
+    // Build a snapshot from the current values and make it the one readers get.
+    // Reads through Settings::value(), so must not be called with the mutex held.
+    const SettingsSnapshot* publishSnapshot() {
+        QMutexLocker locker(&snapshotMutex);
+        const SettingsSnapshot defaults;
+        const SettingsSnapshot* previous = snapshot.load(std::memory_order_relaxed);
+        auto next = std::make_unique<SettingsSnapshot>();
+        next->backgroundColor = q->value<QColor>("Display/BackgroundColor", defaults.backgroundColor);
+        next->prefetchPages = q->value<int>("Advanced/PrefetchPages", defaults.prefetchPages);
+        next->bandedRenderMegapixels = q->value<int>("Advanced/BandedRenderMegapixels", defaults.bandedRenderMegapixels);
+        next->gpuTextureCacheMB = q->value<int>("Advanced/GpuTextureCacheMB", defaults.gpuTextureCacheMB);
+        next->imageBufferPoolMB = q->value<int>("Advanced/ImageBufferPoolMB", defaults.imageBufferPoolMB);
+        next->comicKeepOriginals = q->value<bool>("Advanced/ComicKeepOriginals", defaults.comicKeepOriginals);
+        next->compactScannedPages = q->value<bool>("Advanced/CompactScannedPages", defaults.compactScannedPages);
+        next->contentAddressedPages = q->value<bool>("Advanced/ContentAddressedPages", defaults.contentAddressedPages);
+        next->generation = previous ? previous->generation + 1 : 1;
+        const SettingsSnapshot* published = next.get();
+        snapshots.push_back(std::move(next));
+        snapshot.store(published, std::memory_order_release);
+        return published;
+    }
+
     // Helper to get or create the QSettings instance
     QSettings* getOrCreateQSettings() {
         if (!qtSettings) {
@@ -81,6 +122,15 @@ Settings::Settings(QObject* parent)
         registerSetting("General/CheckForUpdates", true, "Automatically check for application updates", "General");
         LOG_DEBUG("Registered default settings.");
     }
+
+    // The first snapshot() builds the snapshot, so the settings file is not opened here.
+    // Direct, so a change made on any thread is in the snapshot before setValue() returns.
+    connect(this, &Settings::valueChanged, this, [this](const QString& key, const QVariant&) {
+        if (d->snapshot.load(std::memory_order_relaxed) && Private::snapshotKeys().contains(key)) d->publishSnapshot();
+    }, Qt::DirectConnection);
+    connect(this, &Settings::reloaded, this, [this]() {
+        if (d->snapshot.load(std::memory_order_relaxed)) d->publishSnapshot();
+    }, Qt::DirectConnection);
 }
 
 Settings::~Settings()
@@ -122,6 +172,8 @@ void Settings::remove(const QString& key)
         LOG_DEBUG("Removed setting: " << key);
         // Note: This does NOT emit valueChanged, as the value isn't changing to a new value, it's being removed.
         // The application should handle removal explicitly if needed.
+        locker.unlock();
+        if (d->snapshot.load(std::memory_order_relaxed) && Private::snapshotKeys().contains(key)) d->publishSnapshot();
     }
 }
 
@@ -188,7 +240,9 @@ void Settings::resetToDefault(const QString& key)
         if (d->getOrCreateQSettings()->value(key) != it->defaultValue) {
             d->getOrCreateQSettings()->setValue(key, it->defaultValue);
             LOG_DEBUG("Reset setting " << key << " to default: " << it->defaultValue.toString());
-            emit valueChanged(key, it->defaultValue);
+            const QVariant value = it->defaultValue;
+            locker.unlock(); // Receivers may read settings
+            emit valueChanged(key, value);
         }
     } else {
         LOG_WARN("Cannot reset unregistered setting: " << key);
@@ -214,6 +268,8 @@ void Settings::resetAllToDefaults()
         // For simplicity, we'll emit a generic signal or rely on UI to refresh entirely.
         // A more granular approach would require storing original values or iterating again.
         // emit settingsReset(); // Add this signal if needed.
+        locker.unlock();
+        if (d->snapshot.load(std::memory_order_relaxed)) d->publishSnapshot();
     }
 }
 
@@ -224,6 +280,7 @@ void Settings::reload()
         d->qtSettings->sync(); // Flush writes
         d->qtSettings->readIniFile(d->qtSettings->fileName()); // Re-read from file
         LOG_INFO("Reloaded settings from file.");
+        locker.unlock(); // Receivers may read settings
         emit reloaded();
     }
 }
@@ -260,6 +317,14 @@ QMetaObject::Connection Settings::registerChangeCallback(const QString& key,
                    });
 }
 
+const SettingsSnapshot& Settings::snapshot()
+{
+    Settings& settings = instance();
+    const SettingsSnapshot* current = settings.d->snapshot.load(std::memory_order_acquire);
+    if (!current) current = settings.d->publishSnapshot();
+    return *current;
+}
+
 void Settings::unregisterChangeCallback(const QString& key, QMetaObject::Connection connectionId)
 {
     // Disconnecting arbitrary connections is tricky with QMetaObject::Connection.
@@ -11,6 +11,7 @@
 #define QUANTILYX_SETTINGS_H
 
 #include <QObject>
+#include <QColor>
 #include <QSettings>
 #include <QHash>
 #include <QVariant>
@@ -19,6 +20,24 @@
 
 namespace QuantilyxDoc {
 
+/**
+ * @brief Typed copy of the settings read on every paint, render or buffer release.
+ *
+ * Got through Settings::snapshot(). Each field follows the setting named
+ * beside it, with the same default as the code that used to read it.
+ */
+struct SettingsSnapshot {
+    QColor backgroundColor = Qt::white;  // Display/BackgroundColor
+    int prefetchPages = 6;               // Advanced/PrefetchPages
+    int bandedRenderMegapixels = 8;      // Advanced/BandedRenderMegapixels
+    int gpuTextureCacheMB = 256;         // Advanced/GpuTextureCacheMB
+    int imageBufferPoolMB = 64;          // Advanced/ImageBufferPoolMB
+    bool comicKeepOriginals = false;     // Advanced/ComicKeepOriginals
+    bool compactScannedPages = true;     // Advanced/CompactScannedPages
+    bool contentAddressedPages = true;   // Advanced/ContentAddressedPages
+    quint64 generation = 0;              // Goes up each time a field may have changed
+};
+
 /**
  * @brief Centralized settings manager.
  *
@@ -187,6 +206,17 @@ public:
      */
     void unregisterChangeCallback(const QString& key, QMetaObject::Connection connectionId);
 
+    /**
+     * @brief Get the hot-path settings without locking or looking keys up.
+     * The snapshot is rebuilt when one of its settings changes, the settings
+     * reload or are reset, and swapped in atomically, so a reader on any
+     * thread sees either the old or the new one whole. A snapshot stays
+     * valid until Settings is destroyed; read what is needed and do not
+     * hold the reference across a change you want to see.
+     * @return Current snapshot.
+     */
+    static const SettingsSnapshot& snapshot();
+
 signals:
     /**
      * @brief Emitted when any setting value changes.
@@ -208,6 +238,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static Settings* s_instance;
 };
 
 // Inline template implementations
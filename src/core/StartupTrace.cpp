@@ -0,0 +1,214 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "StartupTrace.h"
+#include "Logger.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+struct Event {
+    const char* name;
+    char phase;     // 'X' complete, 'i' instant
+    qint64 startUs;
+    qint64 durationUs;
+    int thread;
+};
+
+struct TraceState {
+    std::atomic_bool enabled{false};
+    QMutex mutex;
+    QElapsedTimer clock;
+    qint64 originUs = 0; // Time from process start to begin(), so process start is 0
+    QString outputPath;
+    QVector<Event> events;
+    QHash<Qt::HANDLE, int> threads; // Small ids, in order of first event
+};
+
+TraceState& state()
+{
+    static TraceState s;
+    return s;
+}
+
+qint64 nowUs()
+{
+    TraceState& s = state();
+    return s.originUs + s.clock.nsecsElapsed() / 1000;
+}
+
+// Must be called with the mutex held
+int threadId(TraceState& s)
+{
+    const Qt::HANDLE handle = QThread::currentThreadId();
+    auto it = s.threads.constFind(handle);
+    if (it != s.threads.constEnd()) return *it;
+    const int id = s.threads.size() + 1;
+    s.threads.insert(handle, id);
+    return id;
+}
+
+void record(const char* name, char phase, qint64 startUs, qint64 durationUs)
+{
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    if (!s.enabled) return;
+    s.events.append({name, phase, startUs, durationUs, threadId(s)});
+}
+
+// Microseconds the process ran before this call; 0 where that is not known.
+// Process start times are kept in clock ticks, so this is to about 10 ms.
+qint64 timeSinceProcessStartUs()
+{
+#ifdef Q_OS_LINUX
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    QFile uptime(QStringLiteral("/proc/uptime"));
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly)) return 0;
+    // The command name may hold spaces, so fields are counted after its closing parenthesis
+    const QByteArray line = stat.readAll();
+    const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    const int StartTimeField = 19; // Field 22 of the file, counted from field 3
+    if (fields.size() <= StartTimeField) return 0;
+    const double ticks = double(sysconf(_SC_CLK_TCK));
+    const double startedSeconds = fields.at(StartTimeField).toDouble() / ticks;
+    const double upSeconds = uptime.readAll().split(' ').value(0).toDouble();
+    return qMax<qint64>(0, qint64((upSeconds - startedSeconds) * 1e6));
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+StartupTrace::Scope::Scope(const char* name)
+    : m_name(name)
+    , m_startUs(StartupTrace::isEnabled() ? nowUs() : -1)
+{
+}
+
+StartupTrace::Scope::~Scope()
+{
+    end();
+}
+
+void StartupTrace::Scope::end()
+{
+    if (m_startUs < 0) return;
+    record(m_name, 'X', m_startUs, nowUs() - m_startUs);
+    m_startUs = -1;
+}
+
+void StartupTrace::begin(const QString& outputPath)
+{
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    if (s.enabled) return;
+    s.outputPath = outputPath;
+    s.originUs = timeSinceProcessStartUs();
+    s.clock.start();
+    s.events.clear();
+    s.threads.clear();
+    threadId(s); // The thread starting the trace is the main thread, id 1
+    if (s.originUs > 0) s.events.append({"Process start to main", 'X', 0, s.originUs, 1});
+    s.enabled = true;
+}
+
+bool StartupTrace::isEnabled()
+{
+    return state().enabled.load(std::memory_order_relaxed);
+}
+
+void StartupTrace::instant(const char* name)
+{
+    if (!isEnabled()) return;
+    record(name, 'i', nowUs(), 0);
+}
+
+bool StartupTrace::finish()
+{
+    TraceState& s = state();
+    QVector<Event> events;
+    QHash<Qt::HANDLE, int> threads;
+    QString path;
+    qint64 totalUs = 0;
+    {
+        QMutexLocker locker(&s.mutex);
+        if (!s.enabled) return false;
+        s.enabled = false;
+        events.swap(s.events);
+        threads.swap(s.threads);
+        path = s.outputPath;
+        totalUs = nowUs();
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    for (auto it = threads.constBegin(); it != threads.constEnd(); ++it) {
+        QJsonObject name;
+        name.insert("name", it.value() == 1 ? QStringLiteral("Main") : QStringLiteral("Worker %1").arg(it.value()));
+        QJsonObject metadata;
+        metadata.insert("name", "thread_name");
+        metadata.insert("ph", "M");
+        metadata.insert("pid", double(pid));
+        metadata.insert("tid", it.value());
+        metadata.insert("args", name);
+        traceEvents.append(metadata);
+    }
+    for (const Event& event : qAsConst(events)) {
+        QJsonObject object;
+        object.insert("name", QString::fromUtf8(event.name));
+        object.insert("cat", "startup");
+        object.insert("ph", QString(QLatin1Char(event.phase)));
+        object.insert("ts", double(event.startUs));
+        if (event.phase == 'X') object.insert("dur", double(event.durationUs));
+        else object.insert("s", "p"); // Instant events span the process
+        object.insert("pid", double(pid));
+        object.insert("tid", event.thread);
+        traceEvents.append(object);
+    }
+
+    QJsonObject otherData;
+    otherData.insert("application", QCoreApplication::applicationName());
+    otherData.insert("version", QCoreApplication::applicationVersion());
+    otherData.insert("totalUs", double(totalUs));
+    QJsonObject root;
+    root.insert("traceEvents", traceEvents);
+    root.insert("displayTimeUnit", "ms");
+    root.insert("otherData", otherData);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0
+        || !file.commit()) {
+        LOG_ERROR("StartupTrace: Cannot write " << path << ": " << file.errorString());
+        return false;
+    }
+    LOG_INFO("StartupTrace: " << events.size() << " events over " << QString::number(totalUs / 1000.0, 'f', 1)
+             << " ms written to " << path);
+    return true;
+}
+
+} // namespace QuantilyxDoc
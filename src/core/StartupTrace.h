@@ -0,0 +1,89 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_STARTUPTRACE_H
+#define QUANTILYX_STARTUPTRACE_H
+
+#include <QString>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Records how long each startup phase takes, as a Chrome trace.
+ *
+ * Turned on by --trace-startup. While on, each Scope becomes one
+ * complete event ("ph": "X") with its start and duration in microseconds,
+ * on the thread it ran on; scopes inside scopes nest in the viewer. On
+ * Linux, the time from process start to begin() is recorded too, which is
+ * mostly loading and relocating shared libraries. finish() writes the
+ * file, to be opened in chrome://tracing or Perfetto.
+ *
+ * While off, a Scope costs one atomic load. Scopes may run on any thread.
+ */
+class StartupTrace
+{
+public:
+    /**
+     * @brief Times a phase from construction until end() or destruction.
+     */
+    class Scope
+    {
+    public:
+        /**
+         * @brief Start a phase.
+         * @param name Phase name; must outlive the scope, normally a literal.
+         */
+        explicit Scope(const char* name);
+
+        /**
+         * @brief End the phase if end() was not called.
+         */
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        /**
+         * @brief End the phase early, for phases that construct objects outliving the scope.
+         */
+        void end();
+
+    private:
+        const char* m_name;
+        qint64 m_startUs;
+    };
+
+    /**
+     * @brief Start recording.
+     * @param outputPath File finish() writes the trace to.
+     */
+    static void begin(const QString& outputPath);
+
+    /**
+     * @brief Check whether recording is on.
+     * @return True between begin() and finish().
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief Record a point in time, such as the window first showing.
+     * @param name Event name.
+     */
+    static void instant(const char* name);
+
+    /**
+     * @brief Stop recording and write the trace file. Later calls do nothing.
+     * @return True if the file was written.
+     */
+    static bool finish();
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_STARTUPTRACE_H
@@ -8,14 +8,30 @@
  * (at your option) any later version.
  */
 #include "ThreadPool.h"
+#include "CancellationToken.h"
 #include "Logger.h"
-#include <QThreadPool>
+#include "Settings.h"
 #include <QMutex>
 #include <QMutexLocker>
+#include <QWaitCondition>
+#include <QHash>
+#include <QSet>
 #include <QDateTime>
 #include <QTime>
+#include <QElapsedTimer>
 #include <QCoreApplication>
 #include <QThread>
+#include <QTimer>
+#include <QStringList>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace QuantilyxDoc {
 
@@ -23,24 +39,76 @@ class Task::Private {
 public:
     Private(std::function<void()> runnable_func, const QString& name_val, Priority priority_val)
         : runnable(std::move(runnable_func)), name(name_val), priority(priority_val),
-          state(State::Queued), canceled(false), autoDelete(true) {}
+          state(State::Queued), canceled(false), autoDelete(true), pooled(false), detached(false),
+          id(nextId++), enqueueMs(0), startMs(0), finishMs(0), readyUs(0), pendingDependencies(0) {}
     std::function<void()> runnable;
     QString name;
     Priority priority;
     State state;
-    QDateTime enqueueTime;
-    QDateTime startTime;
-    QDateTime finishTime;
     mutable QMutex stateMutex; // Protect state changes
     bool canceled;
+    // Parent token while queued: the current one of the submitting thread.
+    // A tracked task replaces it with a child of its own when it starts.
+    CancellationToken token;
     QVariant userData;
     bool autoDelete;
+    bool pooled;   // Created by ThreadPool and recycled once retired
+    bool detached; // Submitted fire-and-forget: untracked, no signals
+    quintptr id;   // Serial number; not the address, which is reused by recycling
+
+    // Milliseconds since the epoch, 0 if not reached. Cheaper to take than
+    // QDateTime::currentDateTime(), which resolves the time zone.
+    qint64 enqueueMs;
+    qint64 startMs;
+    qint64 finishMs;
+
+    qint64 readyUs; // Monotonic time it entered a run queue, for queue wait statistics
+
+    // Task graph links, guarded by the pool mutex
+    int pendingDependencies; // Unfinished tasks this one waits for
+    QVector<Task*> dependents; // Tasks waiting for this one
+
+    static std::atomic<quintptr> nextId;
+
+    static QDateTime toDateTime(qint64 msecs) {
+        return msecs > 0 ? QDateTime::fromMSecsSinceEpoch(msecs) : QDateTime();
+    }
+
+    QString displayName(const Task* task) const {
+        return name.isEmpty() ? QString::number(reinterpret_cast<quintptr>(task)) : name;
+    }
 };
 
+std::atomic<quintptr> Task::Private::nextId(1);
+
 Task::Task(std::function<void()> runnable, const QString& name, Priority priority)
     : d(new Private(std::move(runnable), name, priority))
 {
-    d->enqueueTime = QDateTime::currentDateTime();
+    d->enqueueMs = QDateTime::currentMSecsSinceEpoch();
+    d->token = CancellationToken::current();
+}
+
+Task::~Task() = default;
+
+void Task::reset(std::function<void()> runnable, const QString& name, Priority priority)
+{
+    QMutexLocker locker(&d->stateMutex);
+    d->runnable = std::move(runnable);
+    d->name = name;
+    d->priority = priority;
+    d->state = State::Queued;
+    d->canceled = false;
+    d->token = CancellationToken::current();
+    d->userData = QVariant();
+    d->autoDelete = true;
+    QRunnable::setAutoDelete(true);
+    d->detached = false;
+    d->id = Private::nextId++;
+    d->enqueueMs = d->runnable ? QDateTime::currentMSecsSinceEpoch() : 0;
+    d->startMs = 0;
+    d->finishMs = 0;
+    d->pendingDependencies = 0;
+    d->dependents.clear();
 }
 
 void Task::run()
@@ -48,32 +116,50 @@ void Task::run()
     QMutexLocker locker(&d->stateMutex);
     if (d->canceled) {
         d->state = State::Canceled;
-        LOG_DEBUG("Task " << (d->name.isEmpty() ? QString::number(reinterpret_cast<quintptr>(this)) : d->name) << " was canceled before execution.");
+        LOG_DEBUG("Task " << d->displayName(this) << " was canceled before execution.");
         return;
     }
     d->state = State::Running;
-    d->startTime = QDateTime::currentDateTime();
+    d->startMs = QDateTime::currentMSecsSinceEpoch();
+    if (!d->detached) {
+        // Only tracked tasks can be canceled once running; detached ones
+        // just inherit, which costs no allocation
+        d->token = CancellationToken::create(d->token);
+    }
+    const CancellationToken token = d->token;
     locker.unlock(); // Unlock while running the task function
 
     try {
+        CancellationScope scope(token);
         if (d->runnable) {
             d->runnable();
         }
     } catch (const std::exception& e) {
-        LOG_ERROR("Task " << (d->name.isEmpty() ? QString::number(reinterpret_cast<quintptr>(this)) : d->name) << " threw exception: " << e.what());
+        LOG_ERROR("Task " << d->displayName(this) << " threw exception: " << e.what());
     } catch (...) {
-        LOG_ERROR("Task " << (d->name.isEmpty() ? QString::number(reinterpret_cast<quintptr>(this)) : d->name) << " threw unknown exception.");
+        LOG_ERROR("Task " << d->displayName(this) << " threw unknown exception.");
     }
 
     locker.relock(); // Re-lock to update final state
+    if (!d->detached && token.isCanceled()) {
+        // Stopped early; its dependents must not take the result for a full one
+        d->canceled = true;
+        d->state = State::Canceled;
+        d->finishMs = QDateTime::currentMSecsSinceEpoch();
+        LOG_DEBUG("Task " << d->displayName(this) << " was canceled while running.");
+        return;
+    }
     d->state = State::Finished;
-    d->finishTime = QDateTime::currentDateTime();
-    LOG_DEBUG("Task " << (d->name.isEmpty() ? QString::number(reinterpret_cast<quintptr>(this)) : d->name) << " finished execution.");
+    d->finishMs = QDateTime::currentMSecsSinceEpoch();
+    if (!d->detached) {
+        LOG_DEBUG("Task " << d->displayName(this) << " finished execution.");
+    }
 }
 
 quintptr Task::id() const
 {
-    return reinterpret_cast<quintptr>(this);
+    QMutexLocker locker(&d->stateMutex);
+    return d->id;
 }
 
 QString Task::name() const
@@ -97,27 +183,26 @@ Task::State Task::state() const
 QDateTime Task::enqueueTime() const
 {
     QMutexLocker locker(&d->stateMutex);
-    return d->enqueueTime;
+    return Private::toDateTime(d->enqueueMs);
 }
 
 QDateTime Task::startTime() const
 {
     QMutexLocker locker(&d->stateMutex);
-    return d->startTime;
+    return Private::toDateTime(d->startMs);
 }
 
 QDateTime Task::finishTime() const
 {
     QMutexLocker locker(&d->stateMutex);
-    return d->finishTime;
+    return Private::toDateTime(d->finishMs);
 }
 
 QTime Task::executionTime() const
 {
     QMutexLocker locker(&d->stateMutex);
-    if (d->startTime.isValid() && d->finishTime.isValid()) {
-        qint64 ms = d->startTime.msecsTo(d->finishTime);
-        return QTime(0, 0).addMSecs(ms);
+    if (d->startMs > 0 && d->finishMs > 0) {
+        return QTime(0, 0).addMSecs(static_cast<int>(d->finishMs - d->startMs));
     }
     return QTime(); // Invalid time if not finished
 }
@@ -128,10 +213,20 @@ bool Task::cancel()
     if (d->state == State::Queued) {
         d->canceled = true;
         d->state = State::Canceled;
-        LOG_DEBUG("Task " << (d->name.isEmpty() ? QString::number(reinterpret_cast<quintptr>(this)) : d->name) << " was canceled.");
+        LOG_DEBUG("Task " << d->displayName(this) << " was canceled.");
         return true;
     }
-    return false; // Cannot cancel if already running or finished
+    if (d->state == State::Running) {
+        // Its function sees the token canceled and returns when it next checks
+        d->token.cancel();
+    }
+    return false; // Not dequeued: running or already finished
+}
+
+CancellationToken Task::token() const
+{
+    QMutexLocker locker(&d->stateMutex);
+    return d->token;
 }
 
 bool Task::wasCanceled() const
@@ -156,52 +251,576 @@ void Task::setAutoDelete(bool autoDel)
 {
     QMutexLocker locker(&d->stateMutex);
     d->autoDelete = autoDel;
+    QRunnable::setAutoDelete(autoDel); // Read back by the pool through autoDelete()
+}
+
+// --- TaskGraph Implementation ---
+
+TaskGraph::Node TaskGraph::addTask(std::function<void()> func, const QString& name,
+                                   Task::Priority priority, const QList<Node>& dependencies)
+{
+    const Node node = m_nodes.size();
+    m_nodes.append(NodeData{std::move(func), name, priority, QList<Node>()});
+    for (Node dependency : dependencies) {
+        addDependency(node, dependency);
+    }
+    return node;
+}
+
+bool TaskGraph::addDependency(Node node, Node dependency)
+{
+    // Only earlier nodes, which keeps the graph acyclic
+    if (node < 0 || node >= m_nodes.size() || dependency < 0 || dependency >= node) {
+        LOG_WARN("TaskGraph: Ignoring invalid dependency " << node << " -> " << dependency);
+        return false;
+    }
+    QList<Node>& dependencies = m_nodes[node].dependencies;
+    if (!dependencies.contains(dependency)) {
+        dependencies.append(dependency);
+    }
+    return true;
+}
+
+int TaskGraph::size() const
+{
+    return m_nodes.size();
+}
+
+bool TaskGraph::isEmpty() const
+{
+    return m_nodes.isEmpty();
 }
 
 // --- ThreadPool Implementation ---
 
+namespace {
+
+// Lanes in scheduling order; a lower lane always runs first
+const int LaneCount = 4;
+
+int laneFor(Task::Priority priority)
+{
+    switch (priority) {
+        case Task::Priority::Critical: return 0;
+        case Task::Priority::High:     return 1;
+        case Task::Priority::Normal:   return 2;
+        case Task::Priority::Low:      return 3;
+    }
+    return 2;
+}
+
+// Fixed-size Chase-Lev work-stealing deque. The owning worker pushes and
+// pops at the bottom; any thread may steal from the top.
+class WorkStealingDeque {
+public:
+    static constexpr qint64 Capacity = 1024; // Power of two
+
+    WorkStealingDeque() : top(0), bottom(0) {
+        for (auto& slot : slots) slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // Owner only. Returns false when full.
+    bool push(Task* task) {
+        const qint64 b = bottom.load(std::memory_order_relaxed);
+        const qint64 t = top.load(std::memory_order_acquire);
+        if (b - t >= Capacity) return false;
+        slots[b & (Capacity - 1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only: newest task first
+    Task* pop() {
+        const qint64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        qint64 t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed); // Was empty
+            return nullptr;
+        }
+        Task* task = slots[b & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last task: race thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // Any thread: oldest task first. May fail spuriously under contention.
+    Task* steal() {
+        qint64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const qint64 b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Task* task = slots[t & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+
+private:
+    std::atomic<qint64> top;
+    std::atomic<qint64> bottom;
+    std::array<std::atomic<Task*>, Capacity> slots;
+};
+
+// Log-linear histogram in the style of HdrHistogram: exact below 32 us,
+// then 16 buckets per power of two, so any value is off by at most 1/16.
+class LatencyHistogram {
+public:
+    static constexpr int MaxBits = 36; // About 19 hours in microseconds
+    static constexpr int BucketCount = 32 + (MaxBits - 4) * 16;
+
+    LatencyHistogram() : total(0), maxValue(0) { counts.fill(0); }
+
+    void record(qint64 us) {
+        us = qBound<qint64>(0, us, (Q_INT64_C(1) << MaxBits) - 1);
+        ++counts[indexFor(us)];
+        ++total;
+        maxValue = qMax(maxValue, us);
+    }
+
+    quint64 count() const { return total; }
+    qint64 max() const { return maxValue; }
+
+    // Upper edge of the bucket holding the given quantile (0..1)
+    qint64 percentile(qreal quantile) const {
+        if (total == 0) return 0;
+        const quint64 rank = qMax<quint64>(1, static_cast<quint64>(std::ceil(quantile * total)));
+        quint64 seen = 0;
+        for (int i = 0; i < BucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return qMin(upperEdge(i), maxValue);
+        }
+        return maxValue;
+    }
+
+private:
+    static int indexFor(qint64 us) {
+        if (us < 32) return static_cast<int>(us);
+        int msb = 63;
+        while (!(us >> msb)) --msb;
+        const int shift = msb - 4; // us >> shift lands in [16, 31]
+        return 32 + (shift - 1) * 16 + static_cast<int>((us >> shift) - 16);
+    }
+
+    static qint64 upperEdge(int index) {
+        if (index < 32) return index;
+        const int shift = (index - 32) / 16 + 1;
+        const qint64 sub = (index - 32) % 16 + 16;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::array<quint64, BucketCount> counts;
+    quint64 total;
+    qint64 maxValue;
+};
+
+// Indices of one forEach() call, claimed by the helpers and the caller
+struct ForEachWork {
+    int count = 0;
+    std::function<void(int)> job;
+    CancellationToken token; // The caller's, installed in every helper
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    QMutex mutex;
+    QWaitCondition finished;
+
+    void run() {
+        CancellationScope scope(token);
+        for (;;) {
+            const int index = next++;
+            if (index >= count) return;
+            // Canceled indices are counted as done so that the caller returns
+            if (!token.isCanceled()) job(index);
+            if (++done == count) {
+                QMutexLocker locker(&mutex);
+                finished.wakeAll();
+            }
+        }
+    }
+};
+
+qint64 monotonicUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
 class ThreadPool::Private {
 public:
-    Private(ThreadPool* q_ptr) : q(q_ptr), qtThreadPool(nullptr), maxCount(0), totalSubmitted(0), totalCompleted(0) {}
+    class Worker : public QThread {
+    public:
+        Worker(Private* pool, int index) : pool(pool), index(index) {}
+
+        std::array<WorkStealingDeque, LaneCount> deques;
+
+        bool belongsTo(const Private* other) const { return pool == other; }
+
+    protected:
+        void run() override { pool->workerLoop(index); }
+
+    private:
+        Private* pool;
+        int index;
+    };
+
+    // Spare Task objects kept for reuse by submitTask(func) and submitDetached()
+    static constexpr int MaxFreeTasks = 256;
+    // Further task names are counted under OverflowCategory
+    static constexpr int MaxCategories = 64;
+
+    struct CategoryHistograms {
+        LatencyHistogram queueWait;
+        LatencyHistogram execution;
+        qint64 totalExecutionUs = 0;
+    };
+
+    Private(ThreadPool* q_ptr, const QString& name_val)
+        : q(q_ptr), name(name_val), maxCount(0), retainLimit(256), totalSubmitted(0), totalCompleted(0),
+          doneWaiters(0), queuedCount(0), busyCount(0), shouldQuit(false),
+          busyUs(0), statsStartUs(monotonicUs()), statsTimer(nullptr) {
+        for (auto& count : injectedCount) count.store(0);
+    }
+
+    ~Private() {
+        for (Task* task : freeTasks) delete task;
+    }
 
     ThreadPool* q;
-    QScopedPointer<QThreadPool> qtThreadPool;
+    QString name; // Names the worker threads and log lines
     mutable QMutex mutex; // Protect access to task lists/maps
     QHash<quintptr, Task*> allTasks; // All tasks (queued, running, finished)
     QHash<Task::State, QSet<Task*>> tasksByState; // Group tasks by state
-    int maxCount; // Cached max thread count
-    quint64 totalSubmitted;
-    quint64 totalCompleted;
+    int maxCount; // Worker count
+    std::deque<Task*> retired; // Finished tracked tasks, oldest first
+    int retainLimit;           // Retired tasks kept before the oldest is dropped
+    std::atomic<quint64> totalSubmitted;
+    std::atomic<quint64> totalCompleted;
+    std::atomic<int> doneWaiters; // Threads blocked in waitForDone
     QWaitCondition condition; // For waitForDone
 
-    // Helper to get or create the QThreadPool instance
-    QThreadPool* getOrCreateQtThreadPool() {
-        if (!qtThreadPool) {
-            qtThreadPool.reset(QThreadPool::globalInstance()); // Use global instance by default
-            // Or create a new one: qtThreadPool.reset(new QThreadPool());
+    QMutex freeMutex;
+    std::vector<Task*> freeTasks;
+
+    QMutex resizeMutex; // Serializes setMaxThreadCount()
+
+    // Tasks submitted from outside the pool, one FIFO per lane
+    QMutex injectionMutex;
+    std::array<std::deque<Task*>, LaneCount> injected;
+    std::array<std::atomic<int>, LaneCount> injectedCount; // Lets workers skip empty lanes without the lock
+
+    // Changed only under mutex, and only while no worker of the pool runs:
+    // startWorkers() fills it before starting any, stopWorkers() empties it
+    // after joining them all. Workers read it without the lock; other
+    // threads never read it.
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Idle workers sleep here until a task is queued
+    QMutex sleepMutex;
+    QWaitCondition wakeCondition;
+    std::atomic<int> queuedCount; // Tasks in any queue or deque
+    std::atomic<int> busyCount;   // Workers running a task
+    std::atomic<bool> shouldQuit;
+
+    // Per-category latency statistics
+    QMutex statsMutex;
+    QHash<QString, CategoryHistograms> categories;
+    std::atomic<qint64> busyUs; // Time workers spent running tasks
+    qint64 statsStartUs;        // Guarded by statsMutex
+    QTimer* statsTimer;
+
+    // The worker running on the current thread, if it is one of ours
+    static thread_local Worker* currentWorker;
+
+    static int defaultWorkerCount() {
+        return qMax(1, QThread::idealThreadCount());
+    }
+
+    // Blocked threads cost little, so the I/O pool oversubscribes the cores
+    static int defaultIoWorkerCount() {
+        const int configured = Settings::instance().value<int>("Advanced/IoThreadCount", 0);
+        if (configured > 0) return configured;
+        return qBound(4, 2 * defaultWorkerCount(), 16);
+    }
+
+    // Call with the mutex held
+    void startWorkers(int count) {
+        shouldQuit = false;
+        for (int i = 0; i < count; ++i) {
+            workers.push_back(std::unique_ptr<Worker>(new Worker(this, i)));
+            workers.back()->setObjectName(QString("%1 worker %2").arg(name).arg(i));
+        }
+        for (auto& worker : workers) {
+            worker->start();
         }
-        return qtThreadPool.data();
+        maxCount = count;
     }
 
-    // Helper to update task state and internal tracking
-    void updateTaskState(Task* task, Task::State oldState, Task::State newState) {
+    // Stop all workers after their current task; tasks left in their
+    // deques move to the shared queues
+    void stopWorkers() {
+        {
+            QMutexLocker locker(&sleepMutex);
+            shouldQuit = true;
+            wakeCondition.wakeAll();
+        }
+        for (auto& worker : workers) {
+            worker->wait();
+        }
         QMutexLocker locker(&mutex);
-        // Remove from old state group
-        if (tasksByState.contains(oldState)) {
-            tasksByState[oldState].remove(task);
+        QMutexLocker injectionLocker(&injectionMutex);
+        for (auto& worker : workers) {
+            for (int lane = 0; lane < LaneCount; ++lane) {
+                while (Task* task = worker->deques[lane].steal()) {
+                    injected[lane].push_back(task);
+                    ++injectedCount[lane];
+                }
+            }
+        }
+        workers.clear();
+    }
+
+    void enqueue(Task* task) {
+        task->d->readyUs = monotonicUs();
+        const int lane = laneFor(task->priority());
+        Worker* self = currentWorker;
+        bool local = false;
+        if (self && self->belongsTo(this)) {
+            // One of our workers, so running and not about to be removed
+            local = self->deques[lane].push(task);
+        }
+        if (!local) {
+            QMutexLocker locker(&injectionMutex);
+            injected[lane].push_back(task);
+            ++injectedCount[lane];
+        }
+        ++queuedCount;
+        QMutexLocker locker(&sleepMutex);
+        wakeCondition.wakeOne();
+    }
+
+    // Most urgent task for a worker: its own deque, then the shared queue,
+    // then other workers' deques, lane by lane
+    Task* findTask(int index) {
+        Worker* self = workers[index].get();
+        const int count = static_cast<int>(workers.size());
+        for (int lane = 0; lane < LaneCount; ++lane) {
+            if (Task* task = self->deques[lane].pop()) return task;
+            if (injectedCount[lane].load(std::memory_order_acquire) > 0) {
+                QMutexLocker locker(&injectionMutex);
+                if (!injected[lane].empty()) {
+                    Task* task = injected[lane].front();
+                    injected[lane].pop_front();
+                    --injectedCount[lane];
+                    return task;
+                }
+            }
+            for (int i = 1; i < count; ++i) {
+                if (Task* task = workers[(index + i) % count]->deques[lane].steal()) return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void workerLoop(int index) {
+        currentWorker = workers[index].get();
+        while (!shouldQuit) {
+            Task* task = findTask(index);
+            if (!task) {
+                QMutexLocker locker(&sleepMutex);
+                if (shouldQuit) break;
+                if (queuedCount.load() == 0) {
+                    wakeCondition.wait(&sleepMutex);
+                } else {
+                    // A steal lost a race; the task is still there
+                    locker.unlock();
+                    QThread::yieldCurrentThread();
+                }
+                continue;
+            }
+            --queuedCount;
+            execute(task);
+        }
+        currentWorker = nullptr;
+    }
+
+    void execute(Task* task) {
+        if (task->d->detached) {
+            // No bookkeeping and no signals; only waitForDone sees it
+            ++busyCount;
+            const qint64 startUs = monotonicUs();
+            task->run();
+            recordRun(QStringLiteral("(detached)"), startUs - task->d->readyUs, monotonicUs() - startUs);
+            --busyCount;
+            recycle(task);
+            completeOne();
+            return;
+        }
+        if (task->state() != Task::State::Canceled) {
+            ++busyCount;
+            moveTask(task, Task::State::Queued, Task::State::Running);
+            const qint64 startUs = monotonicUs();
+            task->run(); // Re-checks cancellation under the task's lock
+            const Task::State finalState = task->state();
+            if (finalState == Task::State::Finished) {
+                recordRun(categoryFor(task->d->name), startUs - task->d->readyUs, monotonicUs() - startUs);
+            }
+            --busyCount;
+            if (finalState == Task::State::Finished) {
+                moveTask(task, Task::State::Running, Task::State::Finished);
+            } else {
+                moveTask(task, Task::State::Running, Task::State::Canceled);
+            }
+        }
+        releaseDependents(task, task->state() == Task::State::Canceled);
+        // Counted once, when it leaves the queues, whether it ran or not
+        completeOne();
+        retire(task);
+        emit q->queueStatusChanged(queuedCount.load(), busyCount.load(), busyCount.load());
+    }
+
+    // Queues the dependents that no longer wait for anything. A canceled
+    // task cancels them instead; they are still queued so that a worker
+    // drops them and they are counted as completed.
+    void releaseDependents(Task* task, bool canceled) {
+        QVector<Task*> dependents;
+        QVector<Task*> ready;
+        {
+            QMutexLocker locker(&mutex);
+            dependents.swap(task->d->dependents);
+            for (Task* dependent : dependents) {
+                if (--dependent->d->pendingDependencies == 0) ready.append(dependent);
+            }
         }
-        // Add to new state group
-        tasksByState[newState].insert(task);
+        if (canceled) {
+            for (Task* dependent : dependents) cancelWithDependents(dependent);
+        }
+        for (Task* dependent : ready) enqueue(dependent);
+    }
+
+    // Cancels a queued task and everything downstream of it
+    void cancelWithDependents(Task* task) {
+        if (!task->cancel()) return;
+        moveTask(task, Task::State::Queued, Task::State::Canceled);
+        cancelDependents(task);
+    }
 
-        // Update counters
-        if (newState == Task::State::Finished || newState == Task::State::Canceled) {
-            totalCompleted++;
+    void cancelDependents(Task* task) {
+        QVector<Task*> dependents;
+        {
+            QMutexLocker locker(&mutex);
+            dependents = task->d->dependents;
         }
+        for (Task* dependent : dependents) cancelWithDependents(dependent);
+    }
+
+    // "Render_12" and "Render_13" are both counted as "Render"
+    static QString categoryFor(const QString& name) {
+        if (name.isEmpty()) return QStringLiteral("(unnamed)");
+        const int separator = name.indexOf('_');
+        return separator > 0 ? name.left(separator) : name;
+    }
 
-        // Wake up waitForDone if necessary
-        if (newState == Task::State::Finished || newState == Task::State::Canceled) {
+    void recordRun(const QString& category, qint64 waitUs, qint64 runUs) {
+        busyUs += runUs;
+        QMutexLocker locker(&statsMutex);
+        auto it = categories.find(category);
+        if (it == categories.end()) {
+            const QString key = categories.size() < MaxCategories ? category : QStringLiteral("(other)");
+            it = categories.find(key);
+            if (it == categories.end()) it = categories.insert(key, CategoryHistograms());
+        }
+        it->queueWait.record(waitUs);
+        it->execution.record(runUs);
+        it->totalExecutionUs += runUs;
+    }
+
+    void completeOne() {
+        ++totalCompleted;
+        if (doneWaiters.load() > 0) {
+            QMutexLocker locker(&mutex);
             condition.wakeAll();
         }
+    }
+
+    // A pooled task if one is free, else a new one that will be pooled
+    Task* obtainTask(std::function<void()> func, const QString& name, Task::Priority priority) {
+        Task* task = nullptr;
+        {
+            QMutexLocker locker(&freeMutex);
+            if (!freeTasks.empty()) {
+                task = freeTasks.back();
+                freeTasks.pop_back();
+            }
+        }
+        if (task) {
+            task->reset(std::move(func), name, priority);
+        } else {
+            task = new Task(std::move(func), name, priority);
+            task->d->pooled = true;
+        }
+        return task;
+    }
+
+    void recycle(Task* task) {
+        task->reset(nullptr, QString(), Task::Priority::Normal); // Drop captured state now
+        QMutexLocker locker(&freeMutex);
+        if (static_cast<int>(freeTasks.size()) < MaxFreeTasks) {
+            freeTasks.push_back(task);
+            return;
+        }
+        locker.unlock();
+        delete task;
+    }
+
+    // Called once a task is untracked
+    void dispose(Task* task) {
+        if (!task->autoDelete()) return; // The caller owns it
+        if (task->d->pooled) {
+            recycle(task);
+        } else {
+            delete task;
+        }
+    }
+
+    // Removes a dequeued task from tracking. Call with the mutex held.
+    void untrack(Task* task) {
+        allTasks.remove(task->id());
+        tasksByState[task->state()].remove(task);
+    }
+
+    // Keeps the most recent finished tasks queryable and drops older ones
+    void retire(Task* task) {
+        std::vector<Task*> dropped;
+        {
+            QMutexLocker locker(&mutex);
+            retired.push_back(task);
+            while (static_cast<int>(retired.size()) > retainLimit) {
+                Task* oldest = retired.front();
+                retired.pop_front();
+                untrack(oldest);
+                dropped.push_back(oldest);
+            }
+        }
+        for (Task* oldest : dropped) dispose(oldest);
+    }
+
+    // Helper to update task state and internal tracking
+    void moveTask(Task* task, Task::State oldState, Task::State newState) {
+        {
+            QMutexLocker locker(&mutex);
+            tasksByState[oldState].remove(task);
+            tasksByState[newState].insert(task);
+        }
 
         emit q->taskStateChanged(task, newState);
         switch (newState) {
@@ -215,15 +834,17 @@ public:
             case Task::State::Canceled:
                 emit q->taskFinished(task);
                 break;
-            default:
-                break;
         }
     }
 };
 
+thread_local ThreadPool::Private::Worker* ThreadPool::Private::currentWorker = nullptr;
+
 // Static instance pointer
 ThreadPool* ThreadPool::s_instance = nullptr;
 
+ThreadPool* ThreadPool::s_ioInstance = nullptr;
+
 ThreadPool& ThreadPool::instance()
 {
     if (!s_instance) {
@@ -232,21 +853,43 @@ ThreadPool& ThreadPool::instance()
     return *s_instance;
 }
 
+ThreadPool& ThreadPool::ioInstance()
+{
+    if (!s_ioInstance) {
+        s_ioInstance = new ThreadPool("I/O", Private::defaultIoWorkerCount());
+    }
+    return *s_ioInstance;
+}
+
 ThreadPool::ThreadPool(QObject* parent)
+    : ThreadPool("CPU", 0, parent)
+{
+}
+
+ThreadPool::ThreadPool(const QString& name, int threadCount, QObject* parent)
     : QObject(parent)
-    , d(new Private(this))
+    , d(new Private(this, name))
 {
-    // Initialize Qt's global thread pool settings if needed
-    QThreadPool* pool = d->getOrCreateQtThreadPool();
-    d->maxCount = pool->maxThreadCount(); // Cache initial value
-    LOG_INFO("ThreadPool initialized with max threads: " << d->maxCount);
+    d->retainLimit = qMax(0, Settings::instance().value<int>("Advanced/ThreadPoolRetainedTasks", 256));
+    {
+        QMutexLocker locker(&d->mutex);
+        d->startWorkers(threadCount > 0 ? threadCount : Private::defaultWorkerCount());
+    }
+    LOG_INFO("ThreadPool " << d->name << " initialized with max threads: " << d->maxCount);
+
+    // The log timer needs an event loop, so only a pool made on the GUI thread starts it
+    const int logSeconds = Settings::instance().value<int>("Advanced/ThreadPoolStatsLogSeconds", 0);
+    if (logSeconds > 0 && QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        setStatisticsLogInterval(logSeconds);
+    }
 }
 
 ThreadPool::~ThreadPool()
 {
     // Ensure all tasks are finished before destruction
     waitForDone();
-    // QThreadPool will handle cleanup of running tasks gracefully on application exit
+    d->stopWorkers();
+    clearCompletedTasks();
 }
 
 void ThreadPool::submitTask(Task* task)
@@ -259,31 +902,95 @@ void ThreadPool::submitTask(Task* task)
         d->tasksByState[Task::State::Queued].insert(task);
         d->totalSubmitted++;
     }
+    d->enqueue(task);
+    emit taskQueued(task);
     emit queueStatusChanged(queuedTaskCount(), runningTaskCount(), activeThreadCount());
 
-    // Submit to Qt's underlying pool
-    // Qt's QThreadPool doesn't directly support custom priorities for individual tasks.
-    // The priority of the QThread running the task is set globally or per thread.
-    // We'll submit it normally. Priority could be handled by a custom queue implementation.
-    QThreadPool* pool = d->getOrCreateQtThreadPool();
-    pool->start(task, static_cast<int>(task->priority())); // QThreadPool accepts int priority
-
     LOG_DEBUG("Submitted task: " << task->name() << " (ID: " << task->id() << ")");
 }
 
 Task* ThreadPool::submitTask(std::function<void()> func, const QString& name, Task::Priority priority)
 {
-    Task* task = new Task(std::move(func), name, priority);
+    Task* task = d->obtainTask(std::move(func), name, priority);
     submitTask(task); // Takes ownership
     return task;
 }
 
+void ThreadPool::submitDetached(std::function<void()> func, Task::Priority priority)
+{
+    if (!func) return;
+    Task* task = d->obtainTask(std::move(func), QString(), priority);
+    task->d->detached = true;
+    ++d->totalSubmitted;
+    d->enqueue(task);
+}
+
+void ThreadPool::forEach(int count, const std::function<void(int)>& job, Task::Priority priority)
+{
+    if (count <= 0 || !job) return;
+    // Shared with helpers that may only start once every index is done
+    auto work = std::make_shared<ForEachWork>();
+    work->count = count;
+    work->job = job;
+    work->token = CancellationToken::current();
+    const int helpers = qMin(count - 1, maxThreadCount());
+    for (int i = 0; i < helpers; ++i) {
+        submitDetached([work]() { work->run(); }, priority);
+    }
+    work->run();
+    QMutexLocker locker(&work->mutex);
+    while (work->done.load() < count) {
+        work->finished.wait(&work->mutex);
+    }
+}
+
+QList<quintptr> ThreadPool::submitGraph(const TaskGraph& graph)
+{
+    QVector<Task*> tasks;
+    QList<quintptr> ids;
+    tasks.reserve(graph.size());
+    for (const TaskGraph::NodeData& node : graph.m_nodes) {
+        Task* task = d->obtainTask(node.func, node.name, node.priority);
+        tasks.append(task);
+        ids.append(task->id());
+    }
+
+    // Link everything before the first task can run
+    QVector<Task*> ready;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (int i = 0; i < tasks.size(); ++i) {
+            Task* task = tasks.at(i);
+            for (TaskGraph::Node dependency : graph.m_nodes.at(i).dependencies) {
+                tasks.at(dependency)->d->dependents.append(task);
+                ++task->d->pendingDependencies;
+            }
+            if (task->d->pendingDependencies == 0) ready.append(task);
+            d->allTasks.insert(task->id(), task);
+            d->tasksByState[Task::State::Queued].insert(task);
+        }
+        d->totalSubmitted += tasks.size();
+    }
+    for (Task* task : tasks) {
+        emit taskQueued(task);
+    }
+    for (Task* task : ready) {
+        d->enqueue(task);
+    }
+    emit queueStatusChanged(queuedTaskCount(), runningTaskCount(), activeThreadCount());
+
+    LOG_DEBUG("Submitted task graph of " << tasks.size() << " tasks, " << ready.size() << " ready.");
+    return ids;
+}
+
 bool ThreadPool::cancelTask(Task* task)
 {
-    if (!task) return false;
-    return task->cancel(); // Let the Task object handle its own state change
-    // The Task::run() method checks the canceled flag.
-    // If it's already running, it cannot be canceled by this mechanism.
+    if (!task || !task->cancel()) return false;
+    // Still in a queue, or waiting for its dependencies; the worker that
+    // dequeues it drops it
+    d->moveTask(task, Task::State::Queued, Task::State::Canceled);
+    d->cancelDependents(task);
+    return true;
 }
 
 bool ThreadPool::cancelTaskById(quintptr taskId)
@@ -294,21 +1001,15 @@ bool ThreadPool::cancelTaskById(quintptr taskId)
 
 int ThreadPool::cancelAllQueuedTasks()
 {
-    QMutexLocker locker(&d->mutex);
+    QList<Task*> queuedTasks;
+    {
+        QMutexLocker locker(&d->mutex);
+        queuedTasks = d->tasksByState.value(Task::State::Queued).values();
+    }
     int canceledCount = 0;
-    QSet<Task*> queuedTasks = d->tasksByState.value(Task::State::Queued, QSet<Task*>());
     for (Task* task : queuedTasks) {
-        if (task->cancel()) { // This updates the task's internal state
-             // The state change signal will update our internal lists via updateTaskState
-             // which is ideally called from a watcher on the task's state or after run().
-             // Since we can't easily hook into QRunnable's lifecycle that way,
-             // we manually update our lists here for canceled tasks.
-             d->tasksByState[Task::State::Queued].remove(task);
-             d->tasksByState[Task::State::Canceled].insert(task);
-             d->totalCompleted++;
-             canceledCount++;
-             emit taskStateChanged(task, Task::State::Canceled);
-             emit taskFinished(task);
+        if (cancelTask(task)) {
+            canceledCount++;
         }
     }
     emit queueStatusChanged(queuedTaskCount(), runningTaskCount(), activeThreadCount());
@@ -319,25 +1020,33 @@ int ThreadPool::cancelAllQueuedTasks()
 int ThreadPool::maxThreadCount() const
 {
     QMutexLocker locker(&d->mutex);
-    QThreadPool* pool = d->getOrCreateQtThreadPool();
-    d->maxCount = pool->maxThreadCount(); // Update cache
     return d->maxCount;
 }
 
 void ThreadPool::setMaxThreadCount(int count)
 {
-    QMutexLocker locker(&d->mutex);
-    QThreadPool* pool = d->getOrCreateQtThreadPool();
-    pool->setMaxThreadCount(count);
-    d->maxCount = count; // Update cache
-    LOG_INFO("ThreadPool max thread count set to: " << count);
+    if (count <= 0) count = Private::defaultWorkerCount();
+    QMutexLocker resizeLocker(&d->resizeMutex); // One resize at a time
+    {
+        QMutexLocker locker(&d->mutex);
+        if (count == d->maxCount) return;
+    }
+    d->stopWorkers();
+    {
+        QMutexLocker locker(&d->mutex);
+        d->startWorkers(count);
+    }
+    {
+        // The new workers may have gone to sleep before the moved tasks were counted
+        QMutexLocker locker(&d->sleepMutex);
+        d->wakeCondition.wakeAll();
+    }
+    LOG_INFO("ThreadPool " << d->name << " max thread count set to: " << count);
 }
 
 int ThreadPool::activeThreadCount() const
 {
-    QMutexLocker locker(&d->mutex);
-    QThreadPool* pool = d->getOrCreateQtThreadPool();
-    return pool->activeThreadCount();
+    return d->busyCount.load();
 }
 
 int ThreadPool::runningTaskCount() const
@@ -354,52 +1063,128 @@ int ThreadPool::queuedTaskCount() const
 
 quint64 ThreadPool::totalTasksSubmitted() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->totalSubmitted;
+    return d->totalSubmitted.load();
 }
 
 quint64 ThreadPool::totalTasksCompleted() const
 {
-    QMutexLocker locker(&d->mutex);
-    return d->totalCompleted;
+    return d->totalCompleted.load();
 }
 
 void ThreadPool::waitForDone(int msecs)
 {
     QMutexLocker locker(&d->mutex);
-    // Wait until the 'finished' or 'canceled' task set is equal to the total submitted
-    // Or use QWaitCondition if we signal completion properly from Task::run.
-    // A simpler way with QThreadPool is to call its waitForDone.
-    QThreadPool* pool = d->getOrCreateQtThreadPool();
-    // pool->waitForDone(msecs); // This waits for Qt's internal queue to drain, not our state tracking
-    // Use condition variable based on our state tracking
-    while (d->totalCompleted < d->totalSubmitted && (msecs == UINT_MAX || msecs > 0)) {
-        QTime timer;
-        timer.start();
-        d->condition.wait(&d->mutex, 100); // Wait 100ms or until signaled
-        if (msecs != UINT_MAX) {
-            msecs -= timer.elapsed();
+    // Registered before checking, so a completer either sees us or we see its count
+    ++d->doneWaiters;
+    QElapsedTimer timer;
+    timer.start();
+    while (d->totalCompleted.load() < d->totalSubmitted.load()) {
+        if (msecs < 0 || msecs == INT_MAX) {
+            d->condition.wait(&d->mutex);
+            continue;
         }
+        const qint64 remaining = msecs - timer.elapsed();
+        if (remaining <= 0) {
+            LOG_WARN("waitForDone: Timeout reached.");
+            break;
+        }
+        d->condition.wait(&d->mutex, static_cast<unsigned long>(remaining));
     }
-    if (msecs <= 0) {
-        LOG_WARN("waitForDone: Timeout reached.");
-    }
+    --d->doneWaiters;
 }
 
 void ThreadPool::clearCompletedTasks()
 {
-    QMutexLocker locker(&d->mutex);
-    QSet<Task*> completedTasks;
-    completedTasks.unite(d->tasksByState.value(Task::State::Finished, QSet<Task*>()));
-    completedTasks.unite(d->tasksByState.value(Task::State::Canceled, QSet<Task*>()));
-
+    std::deque<Task*> completedTasks;
+    {
+        QMutexLocker locker(&d->mutex);
+        // Canceled tasks still in a queue are retired once a worker drops them
+        completedTasks.swap(d->retired);
+        for (Task* task : completedTasks) {
+            d->untrack(task);
+        }
+    }
     for (Task* task : completedTasks) {
-        d->allTasks.remove(task->id());
-        // State sets are already updated by updateTaskState or manual update in cancel
+        d->dispose(task);
     }
     LOG_DEBUG("Cleared " << completedTasks.size() << " completed tasks from tracking.");
 }
 
+QList<ThreadPool::CategoryStatistics> ThreadPool::categoryStatistics() const
+{
+    QList<CategoryStatistics> result;
+    {
+        QMutexLocker locker(&d->statsMutex);
+        for (auto it = d->categories.cbegin(); it != d->categories.cend(); ++it) {
+            CategoryStatistics stats;
+            stats.category = it.key();
+            stats.count = it->execution.count();
+            stats.queueWaitP50Us = it->queueWait.percentile(0.50);
+            stats.queueWaitP95Us = it->queueWait.percentile(0.95);
+            stats.queueWaitP99Us = it->queueWait.percentile(0.99);
+            stats.queueWaitMaxUs = it->queueWait.max();
+            stats.executionP50Us = it->execution.percentile(0.50);
+            stats.executionP95Us = it->execution.percentile(0.95);
+            stats.executionP99Us = it->execution.percentile(0.99);
+            stats.executionMaxUs = it->execution.max();
+            stats.totalExecutionUs = it->totalExecutionUs;
+            result.append(stats);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const CategoryStatistics& a, const CategoryStatistics& b) {
+        return a.totalExecutionUs > b.totalExecutionUs;
+    });
+    return result;
+}
+
+qreal ThreadPool::workerUtilization() const
+{
+    qint64 startUs = 0;
+    {
+        QMutexLocker locker(&d->statsMutex);
+        startUs = d->statsStartUs;
+    }
+    const qint64 capacityUs = (monotonicUs() - startUs) * maxThreadCount();
+    if (capacityUs <= 0) return 0.0;
+    return qBound(0.0, static_cast<qreal>(d->busyUs.load()) / capacityUs, 1.0);
+}
+
+void ThreadPool::resetStatistics()
+{
+    QMutexLocker locker(&d->statsMutex);
+    d->categories.clear();
+    d->busyUs = 0;
+    d->statsStartUs = monotonicUs();
+}
+
+void ThreadPool::setStatisticsLogInterval(int seconds)
+{
+    if (seconds <= 0) {
+        if (d->statsTimer) d->statsTimer->stop();
+        return;
+    }
+    if (!d->statsTimer) {
+        d->statsTimer = new QTimer(this);
+        connect(d->statsTimer, &QTimer::timeout, this, &ThreadPool::logStatistics);
+    }
+    d->statsTimer->start(seconds * 1000);
+}
+
+void ThreadPool::logStatistics() const
+{
+    const auto ms = [](qint64 us) { return QString::number(us / 1000.0, 'f', 1); };
+    QStringList parts;
+    for (const CategoryStatistics& stats : categoryStatistics()) {
+        parts << QString("%1 n=%2 wait p50/p99/max %3/%4/%5 ms, run p50/p99/max %6/%7/%8 ms")
+                     .arg(stats.category).arg(stats.count)
+                     .arg(ms(stats.queueWaitP50Us), ms(stats.queueWaitP99Us), ms(stats.queueWaitMaxUs))
+                     .arg(ms(stats.executionP50Us), ms(stats.executionP99Us), ms(stats.executionMaxUs));
+    }
+    LOG_INFO("ThreadPool " << d->name << ": " << maxThreadCount() << " workers, "
+             << QString::number(workerUtilization() * 100.0, 'f', 0) << "% busy, "
+             << queuedTaskCount() << " queued; " << (parts.isEmpty() ? QString("no tasks run") : parts.join("; ")));
+}
+
 QList<Task*> ThreadPool::allTasks() const
 {
     QMutexLocker locker(&d->mutex);
@@ -418,4 +1203,4 @@ Task* ThreadPool::taskById(quintptr id) const
     return d->allTasks.value(id, nullptr);
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
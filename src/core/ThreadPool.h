@@ -10,13 +10,14 @@
 #ifndef QUANTILYX_THREADPOOL_H
 #define QUANTILYX_THREADPOOL_H
 
+#include "CancellationToken.h"
 #include <QObject>
 #include <QRunnable>
-#include <QThreadPool>
-#include <QMutex>
-#include <QWaitCondition>
-#include <QQueue>
+#include <QThread>
 #include <QDateTime>
+#include <QVariant>
+#include <QList>
+#include <QVector>
 #include <memory>
 #include <functional>
 
@@ -51,6 +52,11 @@ public:
      */
     explicit Task(std::function<void()> runnable, const QString& name = QString(), Priority priority = Priority::Normal);
 
+    /**
+     * @brief Destructor.
+     */
+    ~Task() override;
+
     /**
      * @brief Run the task's function.
      * This is called by the thread pool.
@@ -58,7 +64,8 @@ public:
     void run() override;
 
     /**
-     * @brief Get the task's unique ID.
+     * @brief Get the task's unique ID. IDs are never reused, even when the
+     * pool recycles the Task object.
      * @return Unique ID.
      */
     quintptr id() const;
@@ -106,11 +113,21 @@ public:
     QTime executionTime() const;
 
     /**
-     * @brief Cancel the task if it's still queued.
-     * @return True if cancellation was successful (i.e., task was queued).
+     * @brief Cancel the task.
+     * A queued task is dropped. A running one has its token canceled, so it
+     * stops at its next check and ends Canceled; work it started through
+     * the pool, under that token, stops with it.
+     * @return True if the task was dequeued; false if it was running or finished.
      */
     bool cancel();
 
+    /**
+     * @brief Get the task's cancellation token.
+     * It is the current token of its function while it runs.
+     * @return Token; while queued, the one of the thread that submitted it.
+     */
+    CancellationToken token() const;
+
     /**
      * @brief Check if the task was canceled.
      * @return True if canceled.
@@ -129,29 +146,105 @@ public:
      */
     QVariant userData() const;
 
-    // Required by QRunnable
-    void setAutoDelete(bool autoDel) override;
+    /**
+     * @brief Set whether the pool deletes the task once it is no longer tracked.
+     * @param autoDel True to delete automatically (the default).
+     */
+    void setAutoDelete(bool autoDel);
+
+private:
+    friend class ThreadPool;
+
+    // Prepares a pooled task for another use
+    void reset(std::function<void()> runnable, const QString& name, Priority priority);
+
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+/**
+ * @brief A batch of tasks with dependencies between them, submitted to
+ * the pool in one go with ThreadPool::submitGraph().
+ *
+ * A task starts once every task it depends on has finished, so the
+ * stages of a per-page pipeline (render, OCR, indexing, ...) overlap
+ * across pages. When a task is canceled, every task that depends on it,
+ * directly or not, is canceled too. Dependencies can only point to nodes
+ * added earlier, so a graph never has cycles.
+ */
+class TaskGraph
+{
+public:
+    /**
+     * @brief Index of a task in the graph, as returned by addTask().
+     */
+    using Node = int;
+
+    /**
+     * @brief Add a task to the graph.
+     * @param func The function to run.
+     * @param name Optional name for the task.
+     * @param priority Priority of the task.
+     * @param dependencies Nodes that must finish before this one starts.
+     * @return Node of the new task.
+     */
+    Node addTask(std::function<void()> func, const QString& name = QString(),
+                 Task::Priority priority = Task::Priority::Normal, const QList<Node>& dependencies = QList<Node>());
+
+    /**
+     * @brief Make a task wait for another one.
+     * @param node The waiting task.
+     * @param dependency An earlier node that must finish first.
+     * @return True if added, false if the nodes are invalid.
+     */
+    bool addDependency(Node node, Node dependency);
+
+    /**
+     * @brief Get the number of tasks in the graph.
+     * @return Task count.
+     */
+    int size() const;
+
+    /**
+     * @brief Check if the graph has no tasks.
+     * @return True if empty.
+     */
+    bool isEmpty() const;
 
 private:
-    quintptr m_id;
-    QString m_name;
-    Priority m_priority;
-    State m_state;
-    QDateTime m_enqueueTime;
-    QDateTime m_startTime;
-    QDateTime m_finishTime;
-    std::function<void()> m_runnable;
-    mutable QMutex m_stateMutex; // Protect state changes
-    bool m_canceled;
-    QVariant m_userData;
-    bool m_autoDelete;
+    friend class ThreadPool;
+
+    struct NodeData {
+        std::function<void()> func;
+        QString name;
+        Task::Priority priority;
+        QList<Node> dependencies;
+    };
+    QVector<NodeData> m_nodes;
 };
 
 /**
  * @brief Enhanced thread pool manager.
- * 
- * Provides a higher-level interface around Qt's QThreadPool, adding
- * features like task tracking, priority queues, and performance monitoring.
+ *
+ * Owns its worker threads and schedules tasks in four strict priority
+ * lanes: a worker always runs the most urgent task it can find, so
+ * interactive renders overtake indexing and OCR jobs in the same pool.
+ * Each worker has a lock-free deque per lane for tasks submitted from
+ * inside pool tasks; tasks from other threads go to shared lane queues.
+ * Idle workers steal from the other workers' deques. Tasks of one lane
+ * start in submission order, except that a worker runs the tasks it
+ * spawned itself newest first.
+ *
+ * Finished tasks stay queryable until Advanced/ThreadPoolRetainedTasks
+ * (default 256) newer ones have finished; older ones are then untracked
+ * and, if set to auto-delete, deleted or recycled. Keep a task's ID rather
+ * than its pointer and look it up with taskById() once it may have finished.
+ *
+ * There are two shared pools. instance() has one worker per core and is
+ * meant for CPU-bound work such as rendering and encoding. ioInstance()
+ * has more workers (Advanced/IoThreadCount) for work that mostly waits
+ * on files, archives or subprocesses, so blocked I/O never holds up a
+ * render.
  */
 class ThreadPool : public QObject
 {
@@ -159,11 +252,38 @@ class ThreadPool : public QObject
 
 public:
     /**
-     * @brief Constructor.
+     * @brief Latency statistics of one task category. Tasks are grouped by
+     * name, up to the first underscore ("Render_12" counts as "Render").
+     * Percentiles are accurate to within 1/16 of the value.
+     */
+    struct CategoryStatistics {
+        QString category;
+        quint64 count = 0;          // Tasks that ran to completion
+        qint64 queueWaitP50Us = 0;  // Time from becoming runnable to starting
+        qint64 queueWaitP95Us = 0;
+        qint64 queueWaitP99Us = 0;
+        qint64 queueWaitMaxUs = 0;
+        qint64 executionP50Us = 0;  // Time spent running
+        qint64 executionP95Us = 0;
+        qint64 executionP99Us = 0;
+        qint64 executionMaxUs = 0;
+        qint64 totalExecutionUs = 0;
+    };
+
+    /**
+     * @brief Constructor. Starts one worker per core.
      * @param parent Parent object.
      */
     explicit ThreadPool(QObject* parent = nullptr);
 
+    /**
+     * @brief Constructor.
+     * @param name Pool name, used for worker thread names and logs.
+     * @param threadCount Worker count, or 0 for one per core.
+     * @param parent Parent object.
+     */
+    ThreadPool(const QString& name, int threadCount, QObject* parent = nullptr);
+
     /**
      * @brief Destructor.
      */
@@ -171,10 +291,16 @@ public:
 
     /**
      * @brief Get singleton instance.
-     * @return Reference to the global ThreadPool instance.
+     * @return Reference to the global ThreadPool instance for CPU-bound work.
      */
     static ThreadPool& instance();
 
+    /**
+     * @brief Get the pool for blocking I/O.
+     * @return Reference to the global I/O ThreadPool instance.
+     */
+    static ThreadPool& ioInstance();
+
     /**
      * @brief Submit a task to the pool.
      * @param task The task to submit. The pool takes ownership.
@@ -187,11 +313,46 @@ public:
      * @param name Optional name for the task.
      * @param priority Priority of the task.
      * @return Pointer to the created Task object (for tracking/cancellation).
+     * The object comes from a pool and is reused once the task is retired.
      */
     Task* submitTask(std::function<void()> func, const QString& name = QString(), Task::Priority priority = Task::Priority::Normal);
 
     /**
-     * @brief Cancel a specific task if it's still queued.
+     * @brief Run a function on the pool without tracking it.
+     * No Task is exposed, no signals are emitted and the task cannot be
+     * canceled itself; it runs under the submitting thread's current
+     * CancellationToken. waitForDone() still waits for it. Meant for short, frequent
+     * background jobs.
+     * @param func The function to run.
+     * @param priority Priority of the task.
+     */
+    void submitDetached(std::function<void()> func, Task::Priority priority = Task::Priority::Normal);
+
+    /**
+     * @brief Call a function for every index of a range, in parallel, and wait for all calls.
+     * Indices are handed out one at a time to up to maxThreadCount()
+     * detached tasks and to the calling thread, which works too; so the
+     * call cannot starve even from one of the pool's own threads.
+     * Helpers run under the caller's current CancellationToken; once it is
+     * canceled, the indices not yet started are skipped.
+     * @param count Number of indices, 0 to count - 1.
+     * @param job Called once per index, from any of the threads.
+     * @param priority Priority of the helper tasks.
+     */
+    void forEach(int count, const std::function<void(int)>& job, Task::Priority priority = Task::Priority::Normal);
+
+    /**
+     * @brief Submit a graph of dependent tasks. Tasks without dependencies
+     * are queued right away, the others as soon as their inputs finish.
+     * @param graph The tasks and their dependencies.
+     * @return IDs of the created tasks, indexed by node.
+     */
+    QList<quintptr> submitGraph(const TaskGraph& graph);
+
+    /**
+     * @brief Cancel a specific task if it's still queued. Tasks of the same
+     * graph that depend on it are canceled as well. A running task is
+     * asked to stop through its token; see Task::cancel().
      * @param task The task to cancel.
      * @return True if cancellation was successful.
      */
@@ -217,13 +378,15 @@ public:
     int maxThreadCount() const;
 
     /**
-     * @brief Set the maximum number of threads in the pool.
-     * @param count New max thread count.
+     * @brief Set the maximum number of threads in the pool. Queued tasks are
+     * kept; workers finish their current task before they are replaced.
+     * Must not be called from a pool task.
+     * @param count New max thread count, or 0 to size from the hardware.
      */
     void setMaxThreadCount(int count);
 
     /**
-     * @brief Get the current number of active threads.
+     * @brief Get the number of workers currently running a task.
      * @return Active thread count.
      */
     int activeThreadCount() const;
@@ -259,8 +422,9 @@ public:
     void waitForDone(int msecs = UINT_MAX);
 
     /**
-     * @brief Clear completed tasks from internal tracking lists.
-     * This helps manage memory if many short tasks are run.
+     * @brief Clear all retired tasks from internal tracking lists now
+     * instead of waiting for newer tasks to push them out. Tasks set to
+     * auto-delete are deleted or recycled.
      */
     void clearCompletedTasks();
 
@@ -284,6 +448,36 @@ public:
      */
     Task* taskById(quintptr id) const;
 
+    /**
+     * @brief Get queue wait and execution time statistics per task category.
+     * @return Statistics since the last reset, busiest category first.
+     */
+    QList<CategoryStatistics> categoryStatistics() const;
+
+    /**
+     * @brief Get the share of worker time spent running tasks.
+     * @return Utilization since the last reset, from 0 to 1.
+     */
+    qreal workerUtilization() const;
+
+    /**
+     * @brief Clear all statistics and restart the utilization window.
+     */
+    void resetStatistics();
+
+    /**
+     * @brief Log a statistics summary periodically. Call from the main thread.
+     * The initial interval comes from Advanced/ThreadPoolStatsLogSeconds.
+     * @param seconds Interval in seconds, or 0 to stop.
+     */
+    void setStatisticsLogInterval(int seconds);
+
+public slots:
+    /**
+     * @brief Log utilization and per-category latencies in one line.
+     */
+    void logStatistics() const;
+
 signals:
     /**
      * @brief Emitted when a task state changes.
@@ -321,6 +515,9 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static ThreadPool* s_instance;
+    static ThreadPool* s_ioInstance;
 };
 
 } // namespace QuantilyxDoc
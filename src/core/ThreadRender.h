@@ -17,6 +17,9 @@
 #include <QMutex>
 #include <QWaitCondition>
 #include <QQueue>
+#include "LatencyHistogram.h"
+#include <functional>
+#include <limits>
 #include <memory>
 
 namespace QuantilyxDoc {
@@ -25,13 +28,20 @@ class Page;
 class Document;
 
 /**
- * @brief A dedicated thread for rendering document pages.
+ * @brief A pool of threads for rendering document pages.
  *
  * Takes rendering requests from the main thread and processes them
  * asynchronously. This prevents the UI from freezing during expensive
  * rendering operations.
+ *
+ * Requests are spread round-robin over the workers' own queues. Each
+ * worker takes the request with the lowest priority (distance from the
+ * viewport) across all queues, preferring its own on ties, so all workers
+ * stay busy and the most urgent page is always rendered next. The
+ * pool size comes from Advanced/RenderWorkers, or one less than the number
+ * of cores when that is 0.
  */
-class RenderThread : public QThread
+class RenderThread : public QObject
 {
     Q_OBJECT
 
@@ -41,18 +51,33 @@ public:
      */
     struct RenderRequest {
         Page* page;               // The page to render
-        QSize targetSize;         // Target size in pixels
+        QSize targetSize;         // Size in pixels of the whole (rotated) page
         qreal zoomLevel;          // Zoom level for the render
         int rotation;             // Rotation (0, 90, 180, 270)
-        QRectF clipRect;          // Optional clipping rectangle (in page coordinates)
+        QRectF clipRect;          // Optional region to render, in unrotated page points
         bool highQuality;         // Whether to use high-quality rendering
         quintptr requestId;       // Unique identifier for the request
         bool canceled;            // Flag set by main thread to cancel request
+        quintptr documentId;      // PageCache document ID; 0 disables cache lookup and fill
+        int tileX;                // PageCache tile column for clipRect, or -1 for the whole page
+        int tileY;                // PageCache tile row for clipRect, or -1 for the whole page
+        int priority;             // Distance from the viewport in pixels; lowest is rendered first
+        qreal devicePixelRatio;   // Tagged on the image; targetSize and zoomLevel are in device pixels already
+
+        RenderRequest()
+            : page(nullptr), zoomLevel(1.0), rotation(0), highQuality(false), requestId(0), canceled(false),
+              documentId(0), tileX(-1), tileY(-1), priority(0), devicePixelRatio(1.0) {}
 
         RenderRequest(Page* p, const QSize& sz, qreal z, int rot, const QRectF& clip, bool hq, quintptr id)
-            : page(p), targetSize(sz), zoomLevel(z), rotation(rot), clipRect(clip), highQuality(hq), requestId(id), canceled(false) {}
+            : page(p), targetSize(sz), zoomLevel(z), rotation(rot), clipRect(clip), highQuality(hq), requestId(id), canceled(false),
+              documentId(0), tileX(-1), tileY(-1), priority(0), devicePixelRatio(1.0) {}
     };
 
+    /**
+     * @brief Priority for work nobody is looking at, such as thumbnails.
+     */
+    static constexpr int BackgroundPriority = std::numeric_limits<int>::max();
+
     /**
      * @brief Structure holding the result of a rendering request.
      */
@@ -61,6 +86,7 @@ public:
         QImage image;             // The rendered image
         bool success;             // Whether the render was successful
         QString errorMessage;     // Error message if success is false
+        qint64 renderTimeMs;      // Time a worker spent on the request, 0 if it joined another render
     };
 
     /**
@@ -75,8 +101,26 @@ public:
      */
     ~RenderThread() override;
 
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global RenderThread instance.
+     */
+    static RenderThread& instance();
+
+    /**
+     * @brief Get a request ID no other request of this process has.
+     * Results of every requester come through the one renderCompleted()
+     * signal, and IDs key the joined renders, so they must be unique
+     * across views, not just within one.
+     * @return New ID, never 0.
+     */
+    static quintptr nextRequestId();
+
     /**
      * @brief Submit a rendering request.
+     * Requests with a documentId are claimed in RenderRegistry first. If the
+     * same cache key is already being rendered, the request is not queued;
+     * renderCompleted() is emitted for it with the shared result instead.
      * @param request The render request to submit.
      */
     void submitRequest(const RenderRequest& request);
@@ -99,7 +143,16 @@ public:
     void cancelAllRequests();
 
     /**
-     * @brief Check if the thread is currently processing a request.
+     * @brief Recompute the priority of a document's queued requests.
+     * Called by views on every scroll so the page the user stops on is
+     * rendered next.
+     * @param documentId PageCache document ID of the requests to update.
+     * @param priorityForPage Returns the new priority for a page index.
+     */
+    void reprioritize(quintptr documentId, const std::function<int(int pageIndex)>& priorityForPage);
+
+    /**
+     * @brief Check if any worker is processing or has queued requests.
      * @return True if busy.
      */
     bool isBusy() const;
@@ -112,15 +165,34 @@ public:
 
     /**
      * @brief Get the number of requests currently being processed.
-     * @return Processing count (usually 0 or 1 for a single-threaded renderer).
+     * @return Processing count, at most workerCount().
      */
     int activeRequestCount() const;
 
     /**
-     * @brief Set the priority of the rendering thread.
+     * @brief Get the time workers spent on each render.
+     * @return Histogram of render durations, success or not.
+     */
+    const LatencyHistogram& renderLatency() const;
+
+    /**
+     * @brief Get the number of render workers.
+     * @return Worker count.
+     */
+    int workerCount() const;
+
+    /**
+     * @brief Resize the pool. Queued requests are kept; workers finish
+     * their current render before they are replaced.
+     * @param count New worker count, or 0 to size from the hardware.
+     */
+    void setWorkerCount(int count);
+
+    /**
+     * @brief Set the priority of the rendering threads.
      * @param priority Thread priority.
      */
-    void setPriority(Priority priority);
+    void setPriority(QThread::Priority priority);
 
 signals:
     /**
@@ -136,16 +208,11 @@ signals:
      */
     void queueStatusChanged(int pendingCount, int activeCount);
 
-protected:
-    /**
-     * @brief The main execution point of the thread.
-     * Contains the loop that processes requests from the queue.
-     */
-    void run() override;
-
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static RenderThread* s_instance;
 };
 
 } // namespace QuantilyxDoc
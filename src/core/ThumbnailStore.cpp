@@ -0,0 +1,545 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ThumbnailStore.h"
+#include "Document.h"
+#include "Page.h"
+#include "ImageCodec.h"
+#include "ImageScaler.h"
+#include "Settings.h"
+#include "Logger.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QStringList>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Bytes hashed from each end of a file to identify its content
+const qint64 ContentSampleBytes = 64 * 1024;
+// Pages that get a thumbnail when a document is opened
+const int ThumbnailPageLimit = 32;
+// Pages that get a full-view preview: what the first screen shows
+const int PreviewPageCount = 2;
+// Documents whose images are kept decoded in memory
+const int LoadedDocumentLimit = 8;
+
+} // namespace
+
+class ThumbnailStore::Private {
+public:
+    // Content identity of a file: hash of size, head and tail, plus mtime
+    struct ContentKey {
+        QString contentHash;
+        qint64 mtime = 0;
+
+        bool isNull() const { return contentHash.isEmpty(); }
+        QString id() const { return contentHash + QLatin1Char(':') + QString::number(mtime); }
+
+        static ContentKey fromId(const QString& id) {
+            ContentKey key;
+            const int colon = id.lastIndexOf(QLatin1Char(':'));
+            bool ok = false;
+            const qint64 mtime = colon > 0 ? id.mid(colon + 1).toLongLong(&ok) : 0;
+            if (!ok) return key;
+            key.contentHash = id.left(colon);
+            key.mtime = mtime;
+            return key;
+        }
+    };
+
+    // A path's key, remembered until its size or mtime changes
+    struct KnownFile {
+        qint64 size;
+        qint64 mtime;
+        ContentKey key;
+    };
+
+    // Decoded images of one document
+    struct LoadedDocument {
+        QHash<int, QImage> thumbnails;
+        QHash<int, QImage> previews;
+        QHash<int, QImage> viewports;
+
+        QHash<int, QImage>& images(Kind kind) {
+            return kind == Kind::Preview ? previews : kind == Kind::Viewport ? viewports : thumbnails;
+        }
+        const QHash<int, QImage>& images(Kind kind) const {
+            return const_cast<LoadedDocument*>(this)->images(kind);
+        }
+        bool isEmpty() const {
+            return thumbnails.isEmpty() && previews.isEmpty() && viewports.isEmpty();
+        }
+    };
+
+    // A render submitted by generateFor()
+    struct PendingRender {
+        QString filePath;
+        int pageIndex;
+        Kind kind;
+    };
+
+    Private() : ready(false), maxDocs(200), connectedToRenderer(false) {}
+
+    mutable QMutex mutex; // Protect access to the QSqlDatabase connection and caches
+    bool ready;
+    QString dbPathStr;
+    QSqlDatabase sqlDb;
+    int maxDocs;
+    QHash<QString, KnownFile> knownFiles;        // file path -> content key
+    QHash<QString, LoadedDocument> loaded;       // ContentKey::id() -> images
+    QStringList loadedOrder;                     // Most recently used last
+    QHash<quintptr, PendingRender> pendingRenders;
+    bool connectedToRenderer;
+
+    bool createTables() {
+        sqlDb.transaction();
+
+        QString createDocumentsTable = R"(
+            CREATE TABLE IF NOT EXISTS documents (
+                content_hash TEXT NOT NULL,
+                mtime INTEGER NOT NULL,
+                file_path TEXT, -- Last path the content was seen at
+                last_used INTEGER, -- msecs since epoch, for pruning
+                PRIMARY KEY(content_hash, mtime)
+            );
+        )";
+
+        QString createImagesTable = R"(
+            CREATE TABLE IF NOT EXISTS page_images (
+                content_hash TEXT NOT NULL,
+                mtime INTEGER NOT NULL,
+                page_index INTEGER NOT NULL,
+                kind INTEGER NOT NULL, -- ThumbnailStore::Kind
+                width INTEGER,
+                height INTEGER,
+                format INTEGER, -- QImage::Format
+                bytes_per_line INTEGER,
+                method INTEGER, -- ImageCodec::Method
+                data BLOB,
+                PRIMARY KEY(content_hash, mtime, page_index, kind)
+            );
+        )";
+
+        QSqlQuery query(sqlDb);
+        for (const QString& sql : {createDocumentsTable, createImagesTable}) {
+            if (!query.exec(sql)) {
+                LOG_ERROR("ThumbnailStore: Failed to create table: " << query.lastError().text());
+                sqlDb.rollback();
+                return false;
+            }
+        }
+        if (!query.exec("CREATE INDEX IF NOT EXISTS idx_last_used ON documents(last_used);")) {
+            LOG_WARN("ThumbnailStore: Failed to create index: " << query.lastError().text()); // Non-fatal
+        }
+
+        sqlDb.commit();
+        return true;
+    }
+
+    // Helper to get the content key of a file. The file is read without
+    // the mutex, so a slow mount holds up only the caller; caller must not
+    // hold the mutex
+    ContentKey keyFor(const QString& filePath) {
+        QFileInfo info(filePath);
+        if (!info.exists()) return ContentKey();
+        const qint64 size = info.size();
+        const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+        {
+            QMutexLocker locker(&mutex);
+            auto known = knownFiles.constFind(filePath);
+            if (known != knownFiles.constEnd() && known->size == size && known->mtime == mtime) {
+                return known->key;
+            }
+        }
+
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) return ContentKey();
+        QCryptographicHash hasher(QCryptographicHash::Sha1);
+        hasher.addData(QByteArray::number(size));
+        hasher.addData(file.read(ContentSampleBytes));
+        if (size > ContentSampleBytes) {
+            file.seek(qMax<qint64>(ContentSampleBytes, size - ContentSampleBytes));
+            hasher.addData(file.read(ContentSampleBytes));
+        }
+
+        ContentKey key;
+        key.contentHash = QString::fromLatin1(hasher.result().toHex());
+        key.mtime = mtime;
+        QMutexLocker locker(&mutex);
+        knownFiles.insert(filePath, KnownFile{size, mtime, key});
+        return key;
+    }
+
+    // Helper to get a document's decoded images, reading them from the
+    // database on first use; caller holds the mutex
+    LoadedDocument& loadLocked(const ContentKey& key, const QString& filePath) {
+        const QString id = key.id();
+        auto it = loaded.find(id);
+        if (it != loaded.end()) {
+            loadedOrder.removeOne(id);
+            loadedOrder.append(id);
+            return it.value();
+        }
+
+        LoadedDocument document;
+        QSqlQuery query(sqlDb);
+        query.prepare("SELECT page_index, kind, width, height, format, bytes_per_line, method, data "
+                      "FROM page_images WHERE content_hash = :hash AND mtime = :mtime;");
+        query.bindValue(":hash", key.contentHash);
+        query.bindValue(":mtime", key.mtime);
+        if (query.exec()) {
+            while (query.next()) {
+                ImageCodec::Encoded encoded;
+                encoded.width = query.value(2).toInt();
+                encoded.height = query.value(3).toInt();
+                encoded.format = static_cast<QImage::Format>(query.value(4).toInt());
+                encoded.bytesPerLine = query.value(5).toInt();
+                encoded.method = static_cast<ImageCodec::Method>(query.value(6).toInt());
+                encoded.data = query.value(7).toByteArray();
+                QImage image = ImageCodec::decode(encoded);
+                if (image.isNull()) continue;
+                const int pageIndex = query.value(0).toInt();
+                document.images(static_cast<Kind>(query.value(1).toInt())).insert(pageIndex, image);
+            }
+            if (!document.isEmpty()) {
+                touchDocumentLocked(key, filePath);
+            }
+        } else {
+            LOG_ERROR("ThumbnailStore: Failed to read images: " << query.lastError().text());
+        }
+
+        while (loadedOrder.size() >= LoadedDocumentLimit) {
+            loaded.remove(loadedOrder.takeFirst());
+        }
+        loadedOrder.append(id);
+        return loaded.insert(id, document).value();
+    }
+
+    // Helper to record that a document was used; caller holds the mutex
+    void touchDocumentLocked(const ContentKey& key, const QString& filePath) {
+        QSqlQuery query(sqlDb);
+        query.prepare("INSERT OR REPLACE INTO documents (content_hash, mtime, file_path, last_used) "
+                      "VALUES (:hash, :mtime, :path, :used);");
+        query.bindValue(":hash", key.contentHash);
+        query.bindValue(":mtime", key.mtime);
+        query.bindValue(":path", filePath);
+        query.bindValue(":used", QDateTime::currentMSecsSinceEpoch());
+        if (!query.exec()) {
+            LOG_WARN("ThumbnailStore: Failed to update document entry: " << query.lastError().text());
+        }
+    }
+
+    // Helper to delete the least recently used documents beyond the limit;
+    // caller holds the mutex
+    void pruneLocked() {
+        QSqlQuery select(sqlDb);
+        select.prepare("SELECT content_hash, mtime FROM documents ORDER BY last_used DESC LIMIT -1 OFFSET :keep;");
+        select.bindValue(":keep", maxDocs);
+        if (!select.exec()) return;
+
+        QList<ContentKey> stale;
+        while (select.next()) {
+            ContentKey key;
+            key.contentHash = select.value(0).toString();
+            key.mtime = select.value(1).toLongLong();
+            stale.append(key);
+        }
+        for (const ContentKey& key : stale) {
+            removeLocked(key);
+        }
+        if (!stale.isEmpty()) {
+            LOG_DEBUG("ThumbnailStore: Pruned " << stale.size() << " documents.");
+        }
+    }
+
+    // Helper to delete one document's rows and decoded images; caller holds the mutex
+    void removeLocked(const ContentKey& key) {
+        for (const char* sql : {"DELETE FROM page_images WHERE content_hash = :hash AND mtime = :mtime;",
+                                "DELETE FROM documents WHERE content_hash = :hash AND mtime = :mtime;"}) {
+            QSqlQuery query(sqlDb);
+            query.prepare(QString::fromLatin1(sql));
+            query.bindValue(":hash", key.contentHash);
+            query.bindValue(":mtime", key.mtime);
+            if (!query.exec()) {
+                LOG_WARN("ThumbnailStore: Failed to remove document: " << query.lastError().text());
+            }
+        }
+        loaded.remove(key.id());
+        loadedOrder.removeOne(key.id());
+    }
+
+    static int edgeFor(Kind kind) {
+        return kind == Kind::Preview ? PreviewEdge : kind == Kind::Viewport ? ViewportEdge : ThumbnailEdge;
+    }
+};
+
+// Static instance pointer
+ThumbnailStore* ThumbnailStore::s_instance = nullptr;
+
+ThumbnailStore& ThumbnailStore::instance()
+{
+    if (!s_instance) {
+        s_instance = new ThumbnailStore();
+    }
+    return *s_instance;
+}
+
+ThumbnailStore::ThumbnailStore(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    d->maxDocs = Settings::instance().value<int>("Advanced/ThumbnailStoreDocuments", 200);
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    if (d->sqlDb.isOpen()) {
+        d->sqlDb.close();
+    }
+}
+
+bool ThumbnailStore::initialize(const QString& dbPath)
+{
+    QMutexLocker locker(&d->mutex);
+
+    if (d->ready) {
+        LOG_WARN("ThumbnailStore::initialize: Already initialized.");
+        return true;
+    }
+
+    QString path = dbPath;
+    if (path.isEmpty()) {
+        // Next to the metadata database, with the data that outlives the caches
+        path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/thumbnails.db";
+        QDir().mkpath(QFileInfo(path).absolutePath());
+    }
+
+    d->sqlDb = QSqlDatabase::addDatabase("QSQLITE", "thumbnail_db_connection");
+    d->sqlDb.setDatabaseName(path);
+    if (!d->sqlDb.open()) {
+        LOG_ERROR("ThumbnailStore: Failed to open database: " << d->sqlDb.lastError().text());
+        return false;
+    }
+    if (!d->createTables()) {
+        LOG_ERROR("ThumbnailStore: Failed to create tables.");
+        d->sqlDb.close();
+        return false;
+    }
+
+    d->dbPathStr = path;
+    d->ready = true;
+    d->pruneLocked();
+    LOG_INFO("ThumbnailStore: Initialized successfully at: " << path);
+    return true;
+}
+
+bool ThumbnailStore::isReady() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->ready;
+}
+
+QImage ThumbnailStore::image(const QString& filePath, int pageIndex, Kind kind)
+{
+    if (!isReady()) return QImage();
+    return imageForKey(contentKey(filePath), filePath, pageIndex, kind);
+}
+
+QString ThumbnailStore::contentKey(const QString& filePath)
+{
+    const Private::ContentKey key = d->keyFor(filePath);
+    return key.isNull() ? QString() : key.id();
+}
+
+QImage ThumbnailStore::imageForKey(const QString& contentKey, const QString& filePath, int pageIndex, Kind kind)
+{
+    const Private::ContentKey key = Private::ContentKey::fromId(contentKey);
+    if (key.isNull()) return QImage();
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) return QImage();
+    const Private::LoadedDocument& document = d->loadLocked(key, filePath);
+    return document.images(kind).value(pageIndex);
+}
+
+QImage ThumbnailStore::bestImage(const QString& filePath, int pageIndex)
+{
+    QImage preview = image(filePath, pageIndex, Kind::Preview);
+    return preview.isNull() ? image(filePath, pageIndex, Kind::Thumbnail) : preview;
+}
+
+bool ThumbnailStore::storeImage(const QString& filePath, int pageIndex, const QImage& image, Kind kind)
+{
+    if (image.isNull()) return false;
+
+    QImage scaled = image;
+    const int edge = Private::edgeFor(kind);
+    if (image.width() > edge || image.height() > edge) {
+        scaled = ImageScaler::scaled(image, edge, edge, Qt::KeepAspectRatio);
+    }
+    const ImageCodec::Encoded encoded = ImageCodec::encode(scaled);
+    if (encoded.isNull()) return false;
+
+    {
+        const Private::ContentKey key = d->keyFor(filePath);
+        if (key.isNull()) return false;
+        QMutexLocker locker(&d->mutex);
+        if (!d->ready) return false;
+
+        QSqlQuery query(d->sqlDb);
+        query.prepare("INSERT OR REPLACE INTO page_images "
+                      "(content_hash, mtime, page_index, kind, width, height, format, bytes_per_line, method, data) "
+                      "VALUES (:hash, :mtime, :page, :kind, :width, :height, :format, :bpl, :method, :data);");
+        query.bindValue(":hash", key.contentHash);
+        query.bindValue(":mtime", key.mtime);
+        query.bindValue(":page", pageIndex);
+        query.bindValue(":kind", static_cast<int>(kind));
+        query.bindValue(":width", encoded.width);
+        query.bindValue(":height", encoded.height);
+        query.bindValue(":format", static_cast<int>(encoded.format));
+        query.bindValue(":bpl", encoded.bytesPerLine);
+        query.bindValue(":method", static_cast<int>(encoded.method));
+        query.bindValue(":data", encoded.data);
+        if (!query.exec()) {
+            LOG_ERROR("ThumbnailStore: Failed to store image for " << filePath << ": " << query.lastError().text());
+            return false;
+        }
+
+        Private::LoadedDocument& document = d->loadLocked(key, filePath);
+        const bool firstImage = document.isEmpty();
+        document.images(kind).insert(pageIndex, scaled);
+        if (firstImage) {
+            d->touchDocumentLocked(key, filePath);
+            d->pruneLocked();
+        }
+    }
+
+    emit imageStored(filePath, pageIndex);
+    return true;
+}
+
+bool ThumbnailStore::contains(const QString& filePath)
+{
+    if (!isReady()) return false;
+    const Private::ContentKey key = d->keyFor(filePath);
+    if (key.isNull()) return false;
+    QMutexLocker locker(&d->mutex);
+    const Private::LoadedDocument& document = d->loadLocked(key, filePath);
+    return !document.isEmpty();
+}
+
+void ThumbnailStore::generateFor(Document* document)
+{
+    if (!document || !isReady()) return;
+    const QString filePath = document->filePath();
+
+    if (!d->connectedToRenderer) {
+        connect(&RenderThread::instance(), &RenderThread::renderCompleted,
+                this, &ThumbnailStore::onRenderCompleted, Qt::QueuedConnection);
+        d->connectedToRenderer = true;
+    }
+
+    const int pageCount = document->pageCount();
+    for (int i = 0; i < qMin(pageCount, ThumbnailPageLimit); ++i) {
+        Page* page = document->page(i);
+        if (!page || page->size().isEmpty()) continue;
+
+        for (Kind kind : {Kind::Thumbnail, Kind::Preview}) {
+            if (kind == Kind::Preview && i >= PreviewPageCount) continue;
+            if (!image(filePath, i, kind).isNull()) continue;
+
+            const QSizeF pointSize = page->size();
+            const qreal scale = Private::edgeFor(kind) / qMax(pointSize.width(), pointSize.height());
+            const QSize targetSize(qMax(1, qRound(pointSize.width() * scale)), qMax(1, qRound(pointSize.height() * scale)));
+
+            const quintptr requestId = RenderThread::nextRequestId();
+            {
+                QMutexLocker locker(&d->mutex);
+                d->pendingRenders.insert(requestId, Private::PendingRender{filePath, i, kind});
+            }
+            RenderThread::RenderRequest request(page, targetSize, scale, 0, QRectF(), false, requestId);
+            request.priority = RenderThread::BackgroundPriority; // Anything on screen goes first
+            RenderThread::instance().submitRequest(request);
+        }
+    }
+}
+
+void ThumbnailStore::onRenderCompleted(const RenderThread::RenderResult& result)
+{
+    Private::PendingRender pending;
+    {
+        QMutexLocker locker(&d->mutex);
+        auto it = d->pendingRenders.find(result.requestId);
+        if (it == d->pendingRenders.end()) return; // Not ours
+        pending = it.value();
+        d->pendingRenders.erase(it);
+    }
+    if (result.success) {
+        storeImage(pending.filePath, pending.pageIndex, result.image, pending.kind);
+    }
+}
+
+void ThumbnailStore::removeDocument(const QString& filePath)
+{
+    if (!isReady()) return;
+    const Private::ContentKey key = d->keyFor(filePath);
+    if (key.isNull()) return;
+    QMutexLocker locker(&d->mutex);
+    d->removeLocked(key);
+}
+
+void ThumbnailStore::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->loaded.clear();
+    d->loadedOrder.clear();
+    if (!d->ready) return;
+    QSqlQuery query(d->sqlDb);
+    if (!query.exec("DELETE FROM page_images;") || !query.exec("DELETE FROM documents;")) {
+        LOG_ERROR("ThumbnailStore: Failed to clear: " << query.lastError().text());
+        return;
+    }
+    query.exec("VACUUM;");
+    LOG_INFO("ThumbnailStore: Cleared.");
+}
+
+int ThumbnailStore::maxDocuments() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maxDocs;
+}
+
+void ThumbnailStore::setMaxDocuments(int count)
+{
+    if (count < 1) return;
+    QMutexLocker locker(&d->mutex);
+    d->maxDocs = count;
+    if (d->ready) {
+        d->pruneLocked();
+    }
+}
+
+QString ThumbnailStore::databasePath() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->dbPathStr;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,207 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_THUMBNAILSTORE_H
+#define QUANTILYX_THUMBNAILSTORE_H
+
+#include "ThreadRender.h"
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Persistent store of small pre-rendered page images.
+ *
+ * Keeps page thumbnails and first-screen previews in an SQLite database
+ * next to MetadataDatabase, so a reopened document can show something
+ * immediately instead of waiting for its first render. Entries are keyed by
+ * a hash of the file's content (size plus its head and tail) together with
+ * its modification time, so they survive renames and moves and go stale when
+ * the file is rewritten.
+ *
+ * Images are stored compressed with ImageCodec. Looked-up documents are
+ * decoded once and kept in memory, so queries from paint events are cheap.
+ * The least recently used documents are pruned beyond maxDocuments().
+ */
+class ThumbnailStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Kind of stored image.
+     */
+    enum class Kind {
+        Thumbnail,  // Small image for thumbnail lists and recent files
+        Preview,    // First-screen page, sized for the document view
+        Viewport    // The view's last screen, for session restore; stored at page index 0
+    };
+
+    /**
+     * @brief Longest edge in pixels of thumbnails.
+     */
+    static constexpr int ThumbnailEdge = 256;
+
+    /**
+     * @brief Longest edge in pixels of previews.
+     */
+    static constexpr int PreviewEdge = 1024;
+
+    /**
+     * @brief Longest edge in pixels of viewport images.
+     */
+    static constexpr int ViewportEdge = 4096;
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit ThumbnailStore(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~ThumbnailStore() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global ThumbnailStore instance.
+     */
+    static ThumbnailStore& instance();
+
+    /**
+     * @brief Open the database, creating tables if they don't exist.
+     * @param dbPath Path to the database file; empty for the default location.
+     * @return True if initialization was successful.
+     */
+    bool initialize(const QString& dbPath = QString());
+
+    /**
+     * @brief Check if the database is initialized and ready.
+     * @return True if ready.
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Get a stored image for a page.
+     * @param filePath Path of the document file.
+     * @param pageIndex Zero-based page index.
+     * @param kind Kind of image.
+     * @return The image, or a null image if none is stored.
+     */
+    QImage image(const QString& filePath, int pageIndex, Kind kind = Kind::Thumbnail);
+
+    /**
+     * @brief Get the key a file's images are stored under.
+     * The file's head and tail are read without holding the store's lock
+     * or using its database, so this may be called from any thread; it
+     * blocks only the caller if the file sits on a slow mount.
+     * @param filePath Path of the document file.
+     * @return Content key, or an empty string if the file cannot be read.
+     */
+    QString contentKey(const QString& filePath);
+
+    /**
+     * @brief Get a stored image by content key, without touching the file.
+     * Uses the database, so call it from the thread that initialized the store.
+     * @param contentKey Key from contentKey().
+     * @param filePath Path of the document file, recorded as last seen.
+     * @param pageIndex Zero-based page index.
+     * @param kind Kind of image.
+     * @return The image, or a null image if none is stored.
+     */
+    QImage imageForKey(const QString& contentKey, const QString& filePath, int pageIndex, Kind kind = Kind::Thumbnail);
+
+    /**
+     * @brief Get the best stored image for showing a page on screen.
+     * @param filePath Path of the document file.
+     * @param pageIndex Zero-based page index.
+     * @return The preview if stored, else the thumbnail, else a null image.
+     */
+    QImage bestImage(const QString& filePath, int pageIndex);
+
+    /**
+     * @brief Store an image for a page, replacing any previous one.
+     * @param filePath Path of the document file.
+     * @param pageIndex Zero-based page index.
+     * @param image Image to store; scaled down if larger than the kind allows.
+     * @param kind Kind of image.
+     * @return True if stored.
+     */
+    bool storeImage(const QString& filePath, int pageIndex, const QImage& image, Kind kind = Kind::Thumbnail);
+
+    /**
+     * @brief Check if any images are stored for the current content of a file.
+     * @param filePath Path of the document file.
+     * @return True if stored.
+     */
+    bool contains(const QString& filePath);
+
+    /**
+     * @brief Render and store missing thumbnails and previews for a document.
+     * Renders go through RenderThread and are stored as they complete.
+     * @param document Loaded document.
+     */
+    void generateFor(Document* document);
+
+    /**
+     * @brief Remove all images stored for a file.
+     * @param filePath Path of the document file.
+     */
+    void removeDocument(const QString& filePath);
+
+    /**
+     * @brief Remove all stored images.
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of documents kept before the oldest are pruned.
+     * @return Maximum document count.
+     */
+    int maxDocuments() const;
+
+    /**
+     * @brief Set the number of documents kept before the oldest are pruned.
+     * @param count New maximum document count.
+     */
+    void setMaxDocuments(int count);
+
+    /**
+     * @brief Get the path to the database file.
+     * @return Database file path string.
+     */
+    QString databasePath() const;
+
+signals:
+    /**
+     * @brief Emitted when an image has been stored.
+     * @param filePath Path of the document file.
+     * @param pageIndex Zero-based page index.
+     */
+    void imageStored(const QString& filePath, int pageIndex);
+
+private slots:
+    void onRenderCompleted(const QuantilyxDoc::RenderThread::RenderResult& result);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+
+    static ThumbnailStore* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_THUMBNAILSTORE_H
@@ -0,0 +1,222 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "Tracing.h"
+#include "Logger.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+struct Event {
+    const char* name;
+    char phase;      // 'X' complete, 'i' instant
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+// One thread's latest events. Only its thread writes, so its mutex is
+// uncontended except while finish() collects.
+struct ThreadBuffer {
+    QMutex mutex;
+    std::vector<Event> events;
+    size_t next = 0;
+    bool wrapped = false;
+    int session = 0; // The begin() the events belong to
+    int id = 0;
+    QString name;
+};
+
+struct TraceState {
+    std::atomic_bool enabled{false};
+    std::atomic_int session{0};
+    QMutex mutex; // Protects the fields below
+    QElapsedTimer clock;
+    QString outputPath;
+    int eventsPerThread = Tracing::DefaultEventsPerThread;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers; // Kept past their threads, until finish()
+};
+
+TraceState& state()
+{
+    static TraceState s;
+    return s;
+}
+
+qint64 nowNs()
+{
+    return state().clock.nsecsElapsed();
+}
+
+ThreadBuffer& threadBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    TraceState& s = state();
+    const int session = s.session.load(std::memory_order_acquire);
+    if (!buffer || buffer->session != session) {
+        // First event of this thread in this session
+        buffer = std::make_shared<ThreadBuffer>();
+        QMutexLocker locker(&s.mutex);
+        buffer->session = session;
+        buffer->events.resize(size_t(s.eventsPerThread));
+        buffer->id = int(s.buffers.size()) + 1;
+        const QThread* thread = QThread::currentThread();
+        buffer->name = thread && !thread->objectName().isEmpty() ? thread->objectName()
+                     : QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()
+                           ? QStringLiteral("Main") : QStringLiteral("Thread %1").arg(buffer->id);
+        s.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void record(const char* name, char phase, qint64 startNs, qint64 durationNs)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    QMutexLocker locker(&buffer.mutex);
+    buffer.events[buffer.next] = {name, phase, startNs, durationNs};
+    if (++buffer.next == buffer.events.size()) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+QByteArray jsonString(const QString& text)
+{
+    QByteArray escaped = text.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+QByteArray microseconds(qint64 ns)
+{
+    return QByteArray::number(double(ns) / 1000.0, 'f', 3);
+}
+
+} // namespace
+
+Tracing::Zone::Zone(const char* name)
+    : m_name(name)
+    , m_startNs(Tracing::isEnabled() ? nowNs() : -1)
+{
+}
+
+Tracing::Zone::~Zone()
+{
+    if (m_startNs < 0 || !Tracing::isEnabled()) return;
+    record(m_name, 'X', m_startNs, nowNs() - m_startNs);
+}
+
+bool Tracing::isAvailable()
+{
+#ifdef QUANTILYX_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Tracing::begin(const QString& outputPath, int eventsPerThread)
+{
+    if (!isAvailable()) {
+        LOG_WARN("Tracing: This build has no trace zones; configure with ENABLE_TRACING to record them.");
+        return false;
+    }
+    TraceState& s = state();
+    QMutexLocker locker(&s.mutex);
+    if (s.enabled) return false;
+    s.outputPath = outputPath;
+    s.eventsPerThread = qMax(1024, eventsPerThread);
+    s.buffers.clear();
+    s.clock.start();
+    ++s.session; // Buffers of an earlier session are replaced on their next event
+    s.enabled = true;
+    LOG_INFO("Tracing: Recording trace zones to " << outputPath);
+    return true;
+}
+
+bool Tracing::isEnabled()
+{
+    return state().enabled.load(std::memory_order_relaxed);
+}
+
+void Tracing::instant(const char* name)
+{
+    if (!isEnabled()) return;
+    record(name, 'i', nowNs(), 0);
+}
+
+bool Tracing::finish()
+{
+    TraceState& s = state();
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    QString path;
+    {
+        QMutexLocker locker(&s.mutex);
+        if (!s.enabled) return false;
+        s.enabled = false;
+        buffers.swap(s.buffers);
+        path = s.outputPath;
+    }
+
+    // Written as it goes: a busy session holds far more events than a JSON tree should
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_ERROR("Tracing: Cannot write " << path << ": " << file.errorString());
+        return false;
+    }
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    qint64 eventCount = 0;
+    int wrappedThreads = 0;
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        QMutexLocker locker(&buffer->mutex);
+        const QByteArray tid = QByteArray::number(buffer->id);
+        QByteArray chunk = QByteArray(first ? "" : ",") + "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid
+                         + ",\"tid\":" + tid + ",\"args\":{\"name\":" + jsonString(buffer->name) + "}}";
+        first = false;
+        // Oldest first: after a wrap the ring starts at next
+        const size_t count = buffer->wrapped ? buffer->events.size() : buffer->next;
+        const size_t start = buffer->wrapped ? buffer->next : 0;
+        if (buffer->wrapped) ++wrappedThreads;
+        for (size_t k = 0; k < count; ++k) {
+            const Event& event = buffer->events[(start + k) % buffer->events.size()];
+            chunk += ",{\"name\":" + jsonString(QString::fromUtf8(event.name)) + ",\"cat\":\"hotpath\",\"ph\":\""
+                   + event.phase + "\",\"ts\":" + microseconds(event.startNs);
+            chunk += event.phase == 'X' ? ",\"dur\":" + microseconds(event.durationNs) : QByteArray(",\"s\":\"t\"");
+            chunk += ",\"pid\":" + pid + ",\"tid\":" + tid + '}';
+            if (chunk.size() > 1 << 20) {
+                file.write(chunk);
+                chunk.clear();
+            }
+        }
+        eventCount += qint64(count);
+        file.write(chunk);
+    }
+    file.write("]}\n");
+    if (!file.commit()) {
+        LOG_ERROR("Tracing: Cannot write " << path << ": " << file.errorString());
+        return false;
+    }
+    LOG_INFO("Tracing: " << eventCount << " events of " << buffers.size() << " threads written to " << path
+             << (wrappedThreads > 0 ? QStringLiteral("; %1 threads kept only their latest events").arg(wrappedThreads) : QString()));
+    return true;
+}
+
+} // namespace QuantilyxDoc
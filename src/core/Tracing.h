@@ -0,0 +1,116 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_TRACING_H
+#define QUANTILYX_TRACING_H
+
+#include <QString>
+
+/*
+ * Trace zones on the hot paths of rendering, caching, loading and search.
+ *
+ *     void PageCache::put(...)
+ *     {
+ *         TRACE_ZONE("PageCache::put");
+ *         ...
+ *     }
+ *
+ * The zones compile to nothing unless the build asks for them:
+ * - ENABLE_TRACING (QUANTILYX_TRACING) records them into per-thread
+ *   ring buffers while --trace is given, written at exit as a Chrome trace
+ *   that Perfetto and chrome://tracing open. Without --trace a zone costs
+ *   one atomic load.
+ * - ENABLE_TRACY (QUANTILYX_TRACY) hands them to the Tracy profiler,
+ *   which shows them live; --trace then does nothing.
+ *
+ * Zone names must be string literals.
+ */
+#if defined(QUANTILYX_TRACY)
+#include <tracy/Tracy.hpp>
+#define TRACE_ZONE(name) ZoneScopedN(name)
+#define TRACE_INSTANT(name) TracyMessageL(name)
+#elif defined(QUANTILYX_TRACING)
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) ::QuantilyxDoc::Tracing::Zone TRACE_CONCAT(traceZone_, __LINE__)(name)
+#define TRACE_INSTANT(name) ::QuantilyxDoc::Tracing::instant(name)
+#else
+#define TRACE_ZONE(name) do {} while (false)
+#define TRACE_INSTANT(name) do {} while (false)
+#endif
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Records the trace zones of a QUANTILYX_TRACING build.
+ *
+ * Each thread keeps its latest events in a ring buffer of its own, so
+ * recording takes no shared lock and a long session keeps the moments
+ * before the stutter being chased rather than the first minutes. Each
+ * zone becomes one complete event ("ph": "X") on the thread it ran on.
+ */
+class Tracing
+{
+public:
+    /// Events each thread keeps; older ones are overwritten
+    static const int DefaultEventsPerThread = 1 << 16;
+
+    /**
+     * @brief Times a zone from construction to destruction. Use TRACE_ZONE.
+     */
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name);
+        ~Zone();
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* m_name;
+        qint64 m_startNs;
+    };
+
+    /**
+     * @brief Check whether the zones of this build are recorded by Tracing.
+     * @return True in QUANTILYX_TRACING builds.
+     */
+    static bool isAvailable();
+
+    /**
+     * @brief Start recording.
+     * @param outputPath File finish() writes the trace to.
+     * @param eventsPerThread Ring buffer size of each thread.
+     * @return False if this build has no zones to record, or already recording.
+     */
+    static bool begin(const QString& outputPath, int eventsPerThread = DefaultEventsPerThread);
+
+    /**
+     * @brief Check whether recording is on.
+     * @return True between begin() and finish().
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief Record a point in time.
+     * @param name Event name, a string literal.
+     */
+    static void instant(const char* name);
+
+    /**
+     * @brief Stop recording and write the trace file. Later calls do nothing.
+     * @return True if the file was written.
+     */
+    static bool finish();
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_TRACING_H
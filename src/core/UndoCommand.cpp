@@ -0,0 +1,139 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "UndoCommand.h"
+#include "Logger.h"
+#include "Settings.h"
+#include <QElapsedTimer>
+#include <QFile>
+
+namespace QuantilyxDoc {
+
+class UndoCommand::Private {
+public:
+    Private() : storage(Storage::Resident), spillOffset(0), spillLength(0) {
+        lastChange.start();
+    }
+
+    Storage storage;
+    QByteArray compressed;          // Payload while Compressed
+    std::shared_ptr<QFile> spillFile; // File and range of the payload while Spilled
+    qint64 spillOffset;
+    qint64 spillLength;
+    QElapsedTimer lastChange;       // Since creation or the last merge
+};
+
+UndoCommand::UndoCommand(const QString& text, QUndoCommand* parent)
+    : QUndoCommand(text, parent)
+    , d(new Private())
+{
+}
+
+UndoCommand::~UndoCommand() = default;
+
+void UndoCommand::undo()
+{
+    if (!ensureResident()) {
+        LOG_ERROR("UndoCommand: Could not restore the payload of '" << text() << "'; not undoing it.");
+        return;
+    }
+    QUndoCommand::undo(); // Children of a hand-built macro
+    doUndo();
+}
+
+void UndoCommand::redo()
+{
+    if (!ensureResident()) {
+        LOG_ERROR("UndoCommand: Could not restore the payload of '" << text() << "'; not redoing it.");
+        return;
+    }
+    doRedo();
+    QUndoCommand::redo();
+}
+
+bool UndoCommand::mergeWith(const QUndoCommand* other)
+{
+    const UndoCommand* command = dynamic_cast<const UndoCommand*>(other);
+    if (!command || command->id() != id()) return false;
+
+    const int windowMs = Settings::instance().value<int>("Advanced/UndoMergeWindowMs", 1000);
+    if (d->lastChange.elapsed() > windowMs) return false;
+    if (!ensureResident() || !mergePayload(command)) return false;
+    d->lastChange.restart();
+    return true;
+}
+
+qint64 UndoCommand::byteCost() const
+{
+    switch (d->storage) {
+    case Storage::Resident: return payloadSize();
+    case Storage::Compressed: return d->compressed.size();
+    case Storage::Spilled: return 0;
+    }
+    return 0;
+}
+
+UndoCommand::Storage UndoCommand::storage() const
+{
+    return d->storage;
+}
+
+bool UndoCommand::compress()
+{
+    if (d->storage != Storage::Resident) return true;
+    if (payloadSize() <= 0) return false;
+
+    const QByteArray raw = savePayload();
+    if (raw.isEmpty()) return false; // The command keeps its payload
+    d->compressed = qCompress(raw, 1); // Fast level; bitmaps shrink well enough with it
+    d->storage = Storage::Compressed;
+    return true;
+}
+
+bool UndoCommand::spill(const std::shared_ptr<QFile>& file)
+{
+    if (d->storage == Storage::Spilled) return true;
+    if (!file || !compress()) return false;
+
+    const qint64 offset = file->size();
+    if (!file->seek(offset) || file->write(d->compressed) != d->compressed.size()) {
+        LOG_WARN("UndoCommand: Failed to spill '" << text() << "' to " << file->fileName() << ": " << file->errorString());
+        return false;
+    }
+    d->spillFile = file;
+    d->spillOffset = offset;
+    d->spillLength = d->compressed.size();
+    d->compressed.clear();
+    d->storage = Storage::Spilled;
+    return true;
+}
+
+bool UndoCommand::ensureResident()
+{
+    if (d->storage == Storage::Resident) return true;
+
+    if (d->storage == Storage::Spilled) {
+        if (!d->spillFile->seek(d->spillOffset)) return false;
+        d->compressed = d->spillFile->read(d->spillLength);
+        if (d->compressed.size() != d->spillLength) {
+            d->compressed.clear();
+            return false;
+        }
+        d->spillFile.reset();
+        d->storage = Storage::Compressed;
+    }
+
+    const QByteArray raw = qUncompress(d->compressed);
+    if (raw.isEmpty() || !restorePayload(raw)) return false;
+    d->compressed.clear();
+    d->storage = Storage::Resident;
+    return true;
+}
+
+} // namespace QuantilyxDoc
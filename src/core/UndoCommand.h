@@ -0,0 +1,139 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_UNDOCOMMAND_H
+#define QUANTILYX_UNDOCOMMAND_H
+
+#include <QUndoCommand>
+#include <QByteArray>
+#include <memory>
+
+class QFile;
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Undo command whose payload UndoStack can account for and move out of memory.
+ *
+ * Subclasses implement doUndo() and doRedo() instead of undo() and redo(),
+ * report the bytes their payload (bitmaps, page data, text) holds through
+ * payloadSize(), and can hand it over as bytes with savePayload() and take
+ * it back with restorePayload(). UndoStack uses that to keep the stack under
+ * its memory budget: commands far from the current position are compressed,
+ * then spilled to a file. Before a command is undone or redone it is brought
+ * back into memory.
+ *
+ * Consecutive commands with the same id() merge if they come within
+ * Advanced/UndoMergeWindowMs of each other and mergePayload() accepts, so a
+ * drag or a run of typing is one undo step.
+ */
+class UndoCommand : public QUndoCommand
+{
+public:
+    /**
+     * @brief Where the payload of a command is held.
+     */
+    enum class Storage {
+        Resident,   ///< In memory, ready to undo or redo
+        Compressed, ///< In memory, compressed
+        Spilled     ///< Compressed, in UndoStack's spill file
+    };
+
+    /**
+     * @brief Constructor.
+     * @param text Text shown for the command.
+     * @param parent Parent command, when part of a macro built by hand.
+     */
+    explicit UndoCommand(const QString& text = QString(), QUndoCommand* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~UndoCommand() override;
+
+    void undo() final;
+    void redo() final;
+    bool mergeWith(const QUndoCommand* other) final;
+
+    /**
+     * @brief Get the memory the command takes now.
+     * @return payloadSize() when resident, the compressed size when compressed, 0 when spilled.
+     */
+    qint64 byteCost() const;
+
+    /**
+     * @brief Get where the payload is held.
+     * @return Storage state.
+     */
+    Storage storage() const;
+
+    /**
+     * @brief Move the payload into a compressed copy in memory.
+     * @return True if the payload is no longer resident.
+     */
+    bool compress();
+
+    /**
+     * @brief Move the payload, compressing it first if needed, to the end of a file.
+     * @param file Open, writable spill file shared by the commands of a stack.
+     * @return True if the payload is now on disk.
+     */
+    bool spill(const std::shared_ptr<QFile>& file);
+
+    /**
+     * @brief Bring the payload back into memory.
+     * @return True if it is resident.
+     */
+    bool ensureResident();
+
+protected:
+    /**
+     * @brief Revert the change.
+     */
+    virtual void doUndo() = 0;
+
+    /**
+     * @brief Apply the change.
+     */
+    virtual void doRedo() = 0;
+
+    /**
+     * @brief Get the bytes the in-memory payload holds.
+     * @return Payload size; 0 for commands with nothing worth moving out.
+     */
+    virtual qint64 payloadSize() const { return 0; }
+
+    /**
+     * @brief Serialize the payload and release it from memory.
+     * @return The payload as bytes; empty if the command keeps it.
+     */
+    virtual QByteArray savePayload() { return QByteArray(); }
+
+    /**
+     * @brief Take back a payload from savePayload().
+     * @param data Bytes savePayload() returned.
+     * @return True on success.
+     */
+    virtual bool restorePayload(const QByteArray& data) { Q_UNUSED(data); return true; }
+
+    /**
+     * @brief Fold a following command with the same id() into this one.
+     * @param other The later command; deleted after a successful merge.
+     * @return True if merged.
+     */
+    virtual bool mergePayload(const UndoCommand* other) { Q_UNUSED(other); return false; }
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_UNDOCOMMAND_H
@@ -8,20 +8,98 @@
  * (at your option) any later version.
  */
 #include "UndoStack.h"
+#include "UndoCommand.h"
 #include "Document.h"
+#include "Logger.h"
+#include "Settings.h"
+#include <QDir>
 #include <QUndoStack>
 #include <QUndoCommand>
 #include <QPointer>
+#include <QTemporaryFile>
+#include <QVector>
 #include <QDebug>
+#include <algorithm>
+#include <functional>
 
 namespace QuantilyxDoc {
 
 class UndoStack::Private {
 public:
-    Private() : q(nullptr), qtUndoStack(nullptr), document(nullptr) {}
+    Private()
+        : q(nullptr), qtUndoStack(nullptr), document(nullptr)
+        , memoryLimit(qint64(Settings::instance().value<int>("Advanced/UndoMemoryMB", 256)) * 1024 * 1024)
+        , residentWindow(qMax(1, Settings::instance().value<int>("Advanced/UndoResidentCommands", 8)))
+        , memoryUsage(0) {}
     UndoStack* q;
     QUndoStack* qtUndoStack;
     QPointer<Document> document; // Use QPointer to handle potential Document destruction
+    qint64 memoryLimit;
+    int residentWindow;  // Commands on either side of the current position never moved out
+    qint64 memoryUsage;
+    std::shared_ptr<QFile> spillFile; // Opened on first spill
+
+    struct Entry {
+        UndoCommand* command;
+        int distance; // Steps from the current position
+    };
+
+    // Helper to gather the UndoCommands of a stack entry, including macro children
+    static void collect(QUndoCommand* command, int distance, QVector<Entry>& entries) {
+        if (UndoCommand* undoCommand = dynamic_cast<UndoCommand*>(command)) {
+            entries.append(Entry{undoCommand, distance});
+        }
+        for (int i = 0; i < command->childCount(); ++i) {
+            collect(const_cast<QUndoCommand*>(command->child(i)), distance, entries);
+        }
+    }
+
+    std::shared_ptr<QFile> openSpillFile() {
+        if (spillFile) return spillFile;
+        auto file = std::make_shared<QTemporaryFile>(QDir::tempPath() + QStringLiteral("/quantilyx-undo-XXXXXX"));
+        if (!file->open()) {
+            LOG_WARN("UndoStack: Cannot open an undo spill file: " << file->errorString());
+            return nullptr;
+        }
+        spillFile = file;
+        return spillFile;
+    }
+
+    // Helper to bring the commands' payloads under the memory limit,
+    // furthest from the current position first
+    void enforceBudget() {
+        const int count = qtUndoStack->count();
+        const int index = qtUndoStack->index();
+        QVector<Entry> entries;
+        for (int i = 0; i < count; ++i) {
+            // QUndoStack hands out its commands as const; the stack owns them
+            QUndoCommand* command = const_cast<QUndoCommand*>(qtUndoStack->command(i));
+            collect(command, i < index ? index - 1 - i : i - index, entries);
+        }
+        memoryUsage = 0;
+        for (const Entry& entry : qAsConst(entries)) memoryUsage += entry.command->byteCost();
+        if (memoryLimit <= 0 || memoryUsage <= memoryLimit) return;
+
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.distance > b.distance;
+        });
+        auto moveOut = [&](UndoCommand::Storage from, const std::function<bool(UndoCommand*)>& move) {
+            for (const Entry& entry : qAsConst(entries)) {
+                if (memoryUsage <= memoryLimit || entry.distance < residentWindow) break;
+                if (entry.command->storage() != from) continue;
+                const qint64 before = entry.command->byteCost();
+                if (move(entry.command)) memoryUsage += entry.command->byteCost() - before;
+            }
+        };
+        moveOut(UndoCommand::Storage::Resident, [](UndoCommand* command) { return command->compress(); });
+        if (memoryUsage > memoryLimit && Settings::instance().value<bool>("Advanced/UndoSpillToDisk", true)) {
+            const std::shared_ptr<QFile> file = openSpillFile();
+            if (file) moveOut(UndoCommand::Storage::Compressed, [&file](UndoCommand* command) { return command->spill(file); });
+        }
+        if (memoryUsage > memoryLimit) {
+            LOG_DEBUG("UndoStack: " << memoryUsage << " bytes held, over the " << memoryLimit << " byte limit; the rest is near the current position.");
+        }
+    }
 };
 
 // Static instance pointer
@@ -63,7 +141,9 @@ UndoStack::~UndoStack()
 void UndoStack::push(QUndoCommand* cmd)
 {
     if (d->qtUndoStack) {
+        // A command with the same id() may merge into the previous one instead
         d->qtUndoStack->push(cmd);
+        d->enforceBudget();
     }
 }
 
@@ -71,6 +151,7 @@ void UndoStack::undo()
 {
     if (d->qtUndoStack) {
         d->qtUndoStack->undo();
+        d->enforceBudget(); // The command undone was brought back into memory
     }
 }
 
@@ -78,6 +159,7 @@ void UndoStack::redo()
 {
     if (d->qtUndoStack) {
         d->qtUndoStack->redo();
+        d->enforceBudget();
     }
 }
 
@@ -85,6 +167,8 @@ void UndoStack::clear()
 {
     if (d->qtUndoStack) {
         d->qtUndoStack->clear();
+        d->memoryUsage = 0;
+        d->spillFile.reset(); // No command refers to it any more
     }
 }
 
@@ -130,6 +214,22 @@ int UndoStack::undoLimit() const
     return d->qtUndoStack ? d->qtUndoStack->undoLimit() : 0;
 }
 
+void UndoStack::setMemoryLimit(qint64 bytes)
+{
+    d->memoryLimit = qMax<qint64>(0, bytes);
+    if (d->qtUndoStack) d->enforceBudget();
+}
+
+qint64 UndoStack::memoryLimit() const
+{
+    return d->memoryLimit;
+}
+
+qint64 UndoStack::memoryUsage() const
+{
+    return d->memoryUsage;
+}
+
 void UndoStack::beginMacro(const QString& text)
 {
     if (d->qtUndoStack) {
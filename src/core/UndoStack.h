@@ -27,7 +27,13 @@ class Document;
  * - Visual undo/redo tree visualization (requires UndoVisualization).
  * - Better integration with document states.
  * - Custom command grouping.
- * For now, it acts as a wrapper around QUndoStack.
+ *
+ * Besides the command count limit, the stack keeps the payloads of its
+ * UndoCommands under a memory limit (Advanced/UndoMemoryMB). When over it,
+ * commands furthest from the current position are compressed first, then
+ * spilled to a temporary file; the Advanced/UndoResidentCommands nearest
+ * on either side always stay as they are, so stepping back and forth is
+ * immediate. Spilled space is reclaimed when the stack is cleared.
  */
 class UndoStack : public QObject
 {
@@ -120,6 +126,24 @@ public:
      */
     int undoLimit() const;
 
+    /**
+     * @brief Set the memory the payloads of the stack's commands may hold.
+     * @param bytes Limit in bytes (0 means unlimited).
+     */
+    void setMemoryLimit(qint64 bytes);
+
+    /**
+     * @brief Get the memory limit.
+     * @return Limit in bytes.
+     */
+    qint64 memoryLimit() const;
+
+    /**
+     * @brief Get the memory the payloads of the stack's commands hold.
+     * @return Bytes, as of the last push, undo or redo.
+     */
+    qint64 memoryUsage() const;
+
     /**
      * @brief Begin a macro command group.
      * Commands pushed after this call will be grouped together.
@@ -165,6 +189,8 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+
+    static UndoStack* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -11,6 +11,13 @@
 #include "UndoStack.h"
 #include "Document.h"
 #include "Logger.h"
+#include "ImageScaler.h"
+#include "Page.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QSet>
 #include <QUndoStack>
 #include <QUndoCommand>
 #include <QMutex>
@@ -19,13 +26,109 @@
 #include <QImage>
 #include <QApplication> // For thumbnail generation context
 #include <QThread>      // To check if running on main thread
+#include <list>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Thumbnails of states, shared by states that look the same. Filled from
+// background renders, so it has its own lock.
+struct ThumbnailCache {
+    struct Entry {
+        QImage image;
+        int refs; // States showing it
+        std::list<QByteArray>::iterator lru;
+    };
+
+    QMutex mutex;
+    QHash<QByteArray, Entry> images;     // Pixel hash -> thumbnail
+    std::list<QByteArray> lru;           // Most recently used first
+    QHash<quintptr, QByteArray> states;  // State ID -> pixel hash
+    qint64 bytes = 0;
+    qint64 limit = 0;
+
+    // Give a state its thumbnail, sharing an identical one already held
+    QImage insert(quintptr state, const QByteArray& hash, const QImage& image) {
+        QMutexLocker locker(&mutex);
+        releaseLocked(state);
+        auto it = images.find(hash);
+        if (it == images.end()) {
+            lru.push_front(hash);
+            it = images.insert(hash, Entry{image, 0, lru.begin()});
+            bytes += image.sizeInBytes();
+        } else {
+            lru.splice(lru.begin(), lru, it->lru);
+        }
+        ++it->refs;
+        states.insert(state, hash);
+        const QImage shared = it->image;
+        evictLocked();
+        return shared;
+    }
+
+    QImage find(quintptr state) {
+        QMutexLocker locker(&mutex);
+        const auto stateIt = states.constFind(state);
+        if (stateIt == states.constEnd()) return QImage();
+        auto it = images.find(stateIt.value());
+        lru.splice(lru.begin(), lru, it->lru);
+        return it->image;
+    }
+
+    // Drop the thumbnails of a state and all states after it
+    void forgetFrom(quintptr firstState) {
+        QMutexLocker locker(&mutex);
+        const QList<quintptr> ids = states.keys();
+        for (quintptr id : ids) {
+            if (id >= firstState) releaseLocked(id);
+        }
+    }
+
+    void clear() {
+        QMutexLocker locker(&mutex);
+        images.clear();
+        lru.clear();
+        states.clear();
+        bytes = 0;
+    }
+
+    void releaseLocked(quintptr state) {
+        const auto stateIt = states.find(state);
+        if (stateIt == states.end()) return;
+        auto it = images.find(stateIt.value());
+        states.erase(stateIt);
+        if (--it->refs == 0) dropLocked(it);
+    }
+
+    void dropLocked(QHash<QByteArray, Entry>::iterator it) {
+        bytes -= it->image.sizeInBytes();
+        lru.erase(it->lru);
+        images.erase(it);
+    }
+
+    // Least recently used thumbnails go first; their states show none until rendered again
+    void evictLocked() {
+        while (bytes > limit && lru.size() > 1) {
+            const QByteArray hash = lru.back();
+            for (auto it = states.begin(); it != states.end();) {
+                it = it.value() == hash ? states.erase(it) : std::next(it);
+            }
+            dropLocked(images.find(hash));
+        }
+    }
+};
+
+} // namespace
+
 class UndoVisualization::Private {
 public:
     Private(UndoVisualization* q_ptr)
-        : q(q_ptr), document(nullptr), maxStates(100), autoThumbnailEnabled(false) {}
+        : q(q_ptr), document(nullptr), maxStates(100), autoThumbnailEnabled(false)
+        , thumbnails(std::make_shared<ThumbnailCache>())
+        , thumbnailEdge(qBound(16, Settings::instance().value<int>("Advanced/UndoThumbnailSize", 96), 256)) {
+        thumbnails->limit = qint64(Settings::instance().value<int>("Advanced/UndoThumbnailCacheMB", 8)) * 1024 * 1024;
+    }
 
     UndoVisualization* q;
     QPointer<Document> document; // Use QPointer for safety
@@ -37,6 +140,57 @@ public:
     int maxStates;
     bool autoThumbnailEnabled;
     quintptr nextId; // For generating unique node IDs
+    std::shared_ptr<ThumbnailCache> thumbnails; // Shared with the background renders
+    QSet<quintptr> pendingThumbnails; // States with a render queued; main thread only
+    int thumbnailEdge; // Longest side of a thumbnail, in pixels
+
+    // Helper to render the document as it is now for the current state, on a
+    // low-priority worker. Identical-looking states share one image.
+    void requestThumbnail(quintptr stateId) {
+        Document* doc = document.data();
+        if (!doc || doc->pageCount() == 0 || pendingThumbnails.contains(stateId)) return;
+        pendingThumbnails.insert(stateId);
+
+        QPointer<Document> docRef(doc);
+        QPointer<UndoVisualization> self(q);
+        const std::shared_ptr<ThumbnailCache> cache = thumbnails;
+        const int pageIndex = qBound(0, doc->currentPageIndex(), doc->pageCount() - 1);
+        const int edge = thumbnailEdge;
+        ThreadPool::instance().submitDetached([docRef, self, cache, stateId, pageIndex, edge]() {
+            QImage thumbnail;
+            Page* page = docRef ? docRef->page(pageIndex) : nullptr;
+            if (page) {
+                // Straight at thumbnail size; only a tiny image is ever kept
+                const QSizeF size = page->size().scaled(edge, edge, Qt::KeepAspectRatio);
+                const int width = qMax(1, qRound(size.width()));
+                const int height = qMax(1, qRound(size.height()));
+                const QImage rendered = page->render(width, height, qMax(1, qRound(72.0 * width / qMax(1.0, page->size().width()))));
+                thumbnail = rendered.width() > edge || rendered.height() > edge
+                    ? ImageScaler::scaled(rendered, edge, edge, Qt::KeepAspectRatio) : rendered;
+            }
+            if (!thumbnail.isNull()) {
+                thumbnail = thumbnail.convertToFormat(QImage::Format_RGB32);
+                QCryptographicHash hash(QCryptographicHash::Sha1);
+                hash.addData(reinterpret_cast<const char*>(thumbnail.constBits()), int(thumbnail.sizeInBytes()));
+                thumbnail = cache->insert(stateId, hash.result(), thumbnail);
+            }
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [self, stateId, thumbnail]() {
+                if (self) self->d->thumbnailReady(stateId, thumbnail);
+            }, Qt::QueuedConnection);
+        }, Task::Priority::Low);
+    }
+
+    void thumbnailReady(quintptr stateId, const QImage& thumbnail) {
+        pendingThumbnails.remove(stateId);
+        if (thumbnail.isNull()) return;
+        {
+            QMutexLocker locker(&mutex);
+            auto it = treeNodes.find(stateId);
+            if (it == treeNodes.end()) return;
+            it->thumbnail = thumbnail;
+        }
+        emit q->thumbnailGenerated(stateId, thumbnail);
+    }
 
     // Helper to get current node from UndoStack index
     quintptr getCurrentStateIdFromStack() const {
@@ -73,7 +227,8 @@ public:
         int currentIndex = qtUndoStack->index(); // Current position
 
         for (int i = 0; i <= count; ++i) { // count+1 because index can be at 'count' (after last command)
-            quintptr id = nextId++;
+            quintptr id = quintptr(i) + 1; // Stable across rebuilds, so thumbnails stay attached
+            nextId = qMax(nextId, id + 1);
             UndoStateNode node;
             node.id = id;
             node.parentId = (i > 0) ? (id - 1) : 0; // Simple linear parent
@@ -90,6 +245,7 @@ public:
                  node.commandText = "Initial State";
             }
 
+            node.thumbnail = thumbnails->find(id);
             treeNodes.insert(id, node);
             if (node.isCurrent) {
                 currentId = id;
@@ -257,26 +413,19 @@ QString UndoVisualization::annotationForState(quintptr nodeId) const
 
 QImage UndoVisualization::generateThumbnailForState(quintptr nodeId)
 {
-    QMutexLocker locker(&d->mutex);
-    auto it = d->treeNodes.find(nodeId);
-    if (it == d->treeNodes.end()) return QImage();
-
-    // This is a major challenge. To get a thumbnail of a *past* state,
-    // you need to reconstruct the document as it was at that point.
-    // This requires either:
-    // 1. Storing document snapshots (memory intensive).
-    // 2. Replaying all commands up to that state (CPU intensive, potentially unsafe).
-    // 3. Having a sophisticated state management system in UndoStack that can diff/restore states.
-    // This is beyond the scope of a simple stub. We'll return a placeholder.
-    LOG_WARN("generateThumbnailForState: Full implementation requires document state restoration. Returning placeholder.");
-    QImage placeholder(100, 140, QImage::Format_RGB32); // Common aspect ratio hint
-    placeholder.fill(Qt::lightGray);
-    // Draw a simple icon or text indicating "State X"
-    // QPainter painter(&placeholder);
-    // painter.drawText(placeholder.rect(), Qt::AlignCenter, QString("State\n%1").arg(nodeId));
-    it->thumbnail = placeholder;
-    emit thumbnailGenerated(nodeId, placeholder);
-    return placeholder;
+    bool current;
+    {
+        QMutexLocker locker(&d->mutex);
+        auto it = d->treeNodes.find(nodeId);
+        if (it == d->treeNodes.end()) return QImage();
+        if (!it->thumbnail.isNull()) return it->thumbnail;
+        current = nodeId == d->currentId;
+    }
+
+    // Only the current state can be rendered; a past one shows what it
+    // looked like when it was current, until that thumbnail is evicted
+    if (current) d->requestThumbnail(nodeId);
+    return QImage();
 }
 
 int UndoVisualization::maxVisualizedStates() const
@@ -313,6 +462,7 @@ bool UndoVisualization::isAutoThumbnailGenerationEnabled() const
 void UndoVisualization::clear()
 {
     QMutexLocker locker(&d->mutex);
+    d->thumbnails->clear();
     d->treeNodes.clear();
     d->rootNodeId = 0;
     d->currentId = 0;
@@ -331,6 +481,10 @@ void UndoVisualization::onUndoStackIndexChanged()
     d->rebuildTreeFromLinearHistory();
     emit currentStateChanged();
     emit treeChanged();
+    if (d->autoThumbnailEnabled) {
+        const UndoStateNode currentNode = getCurrentNode();
+        if (currentNode.id != 0 && currentNode.thumbnail.isNull()) d->requestThumbnail(currentNode.id);
+    }
 }
 
 void UndoVisualization::onUndoCommandExecuted(const QUndoCommand* cmd)
@@ -340,15 +494,14 @@ void UndoVisualization::onUndoCommandExecuted(const QUndoCommand* cmd)
     // This requires UndoStack to emit this signal *after* the command is added and the index is updated.
     // We need the new index to create the node correctly.
     Q_UNUSED(cmd);
+    // The new state replaces whatever was at its position and after it
+    if (d->qtUndoStack) d->thumbnails->forgetFrom(quintptr(d->qtUndoStack->index()) + 1);
     d->rebuildTreeFromLinearHistory(); // For now, rebuild
+    const UndoStateNode currentNode = getCurrentNode();
     emit treeChanged();
-    if (d->autoThumbnailEnabled) {
-        // Request thumbnail generation for the new current state
-        // This should ideally happen on a background thread.
-        UndoStateNode currentNode = getCurrentNode();
-        if (currentNode.id != 0) {
-            // generateThumbnailForState(currentNode.id); // This might block UI, better to use ThreadPool
-        }
+    if (d->autoThumbnailEnabled && currentNode.id != 0) {
+        // Rendered on a low-priority worker; thumbnailGenerated() follows
+        d->requestThumbnail(currentNode.id);
     }
 }
 
@@ -141,10 +141,14 @@ public:
     QString annotationForState(quintptr nodeId) const;
 
     /**
-     * @brief Generate a thumbnail for a specific state node.
-     * This might involve temporarily applying commands up to that state.
+     * @brief Get the thumbnail of a state node, queueing a render if it has none.
+     * Renders run on low-priority workers at Advanced/UndoThumbnailSize and
+     * report through thumbnailGenerated(). Only the current state can be
+     * rendered; past states keep the thumbnail taken while they were current.
+     * States that look the same share one image, and the least recently used
+     * are evicted beyond Advanced/UndoThumbnailCacheMB.
      * @param nodeId The ID of the node to generate a thumbnail for.
-     * @return The generated thumbnail image, or a null image.
+     * @return The thumbnail held now, or a null image.
      */
     QImage generateThumbnailForState(quintptr nodeId);
 
@@ -162,6 +166,7 @@ public:
 
     /**
      * @brief Enable or disable automatic thumbnail generation for new states.
+     * Thumbnails are rendered in the background, as for generateThumbnailForState().
      * @param enabled True to enable.
      */
     void setAutoThumbnailGenerationEnabled(bool enabled);
@@ -0,0 +1,580 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ZipArchive.h"
+#include "MappedFile.h"
+#include "RemoteFile.h"
+#include "ReadAhead.h"
+#include "Logger.h"
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <QtEndian>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <zip.h>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// What remote archives prefetch past an entry that was just read
+const qint64 RemotePrefetchBytes = 256 * 1024;
+
+// End of central directory record: 22 bytes and a comment of up to 64 KB
+const qint64 EndRecordSize = 22;
+const qint64 EndRecordSearch = EndRecordSize + 0xFFFF;
+const quint32 EndRecordSignature = 0x06054b50;
+const quint32 Zip64LocatorSignature = 0x07064b50;
+const quint32 Zip64EndRecordSignature = 0x06064b50;
+const quint32 CentralHeaderSignature = 0x02014b50;
+const qint64 CentralHeaderSize = 46;
+
+quint16 le16(const QByteArray& bytes, qint64 at)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(bytes.constData() + at));
+}
+
+quint32 le32(const QByteArray& bytes, qint64 at)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(bytes.constData() + at));
+}
+
+quint64 le64(const QByteArray& bytes, qint64 at)
+{
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(bytes.constData() + at));
+}
+
+// A libzip source reading a remote file through its block cache; one per
+// handle, since each keeps its own position
+struct RemoteSource {
+    std::shared_ptr<RemoteFile> file;
+    zip_uint64_t position = 0;
+    zip_error_t error;
+};
+
+zip_int64_t remoteSourceCallback(void* userdata, void* data, zip_uint64_t length, zip_source_cmd_t command)
+{
+    RemoteSource* source = static_cast<RemoteSource*>(userdata);
+    switch (command) {
+    case ZIP_SOURCE_OPEN:
+        source->position = 0;
+        return 0;
+    case ZIP_SOURCE_READ: {
+        const QByteArray bytes = source->file->read(static_cast<qint64>(source->position),
+                                                    static_cast<qint64>(qMin<zip_uint64_t>(length, std::numeric_limits<int>::max())));
+        if (bytes.isEmpty() && static_cast<qint64>(source->position) < source->file->size()) {
+            zip_error_set(&source->error, ZIP_ER_READ, EIO);
+            return -1;
+        }
+        memcpy(data, bytes.constData(), static_cast<size_t>(bytes.size()));
+        source->position += static_cast<zip_uint64_t>(bytes.size());
+        return bytes.size();
+    }
+    case ZIP_SOURCE_CLOSE:
+        return 0;
+    case ZIP_SOURCE_STAT: {
+        zip_stat_t* stat = ZIP_SOURCE_GET_ARGS(zip_stat_t, data, length, &source->error);
+        if (!stat) return -1;
+        zip_stat_init(stat);
+        stat->size = static_cast<zip_uint64_t>(source->file->size());
+        stat->valid |= ZIP_STAT_SIZE;
+        return sizeof(zip_stat_t);
+    }
+    case ZIP_SOURCE_ERROR:
+        return zip_error_to_data(&source->error, data, length);
+    case ZIP_SOURCE_FREE:
+        zip_error_fini(&source->error);
+        delete source;
+        return 0;
+    case ZIP_SOURCE_SEEK: {
+        const zip_int64_t position = zip_source_seek_compute_offset(source->position, static_cast<zip_uint64_t>(source->file->size()),
+                                                                    data, length, &source->error);
+        if (position < 0) return -1;
+        source->position = static_cast<zip_uint64_t>(position);
+        return 0;
+    }
+    case ZIP_SOURCE_TELL:
+        return static_cast<zip_int64_t>(source->position);
+    case ZIP_SOURCE_SUPPORTS:
+        return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT,
+                                              ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, ZIP_SOURCE_SEEK, ZIP_SOURCE_TELL,
+                                              ZIP_SOURCE_SUPPORTS, -1);
+    default:
+        zip_error_set(&source->error, ZIP_ER_OPNOTSUPP, 0);
+        return -1;
+    }
+}
+
+// One entry being inflated on its own leased handle; QIODevice's read
+// buffer keeps what is held in memory to a chunk at a time
+class ZipEntryDevice : public QIODevice
+{
+public:
+    ZipEntryDevice(zip_t* handle, zip_file_t* file, qint64 size, std::function<void(zip_t*)> release,
+                   std::function<void()> finished)
+        : handle(handle), file(file), entrySize(size), position(0),
+          releaseHandle(std::move(release)), onFinished(std::move(finished)) {}
+
+    ~ZipEntryDevice() override {
+        close();
+        releaseFile();
+    }
+
+    bool isSequential() const override { return true; }
+    qint64 size() const override { return entrySize; }
+    bool atEnd() const override { return position >= entrySize && QIODevice::bytesAvailable() == 0; }
+    qint64 bytesAvailable() const override { return QIODevice::bytesAvailable() + (entrySize - position); }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override {
+        if (!file || position >= entrySize) return position >= entrySize ? 0 : -1;
+        const zip_int64_t bytesRead = zip_fread(file, data, static_cast<zip_uint64_t>(qMin(maxSize, entrySize - position)));
+        if (bytesRead < 0) {
+            setErrorString(QString::fromUtf8(zip_file_strerror(file)));
+            return -1;
+        }
+        position += bytesRead;
+        if (position >= entrySize || bytesRead == 0) {
+            releaseFile();
+            if (onFinished) onFinished();
+        }
+        return bytesRead;
+    }
+
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    void releaseFile() {
+        if (file) zip_fclose(file);
+        file = nullptr;
+        if (handle && releaseHandle) releaseHandle(handle);
+        handle = nullptr;
+    }
+
+    zip_t* handle;
+    zip_file_t* file;
+    qint64 entrySize;
+    qint64 position;
+    std::function<void(zip_t*)> releaseHandle;
+    std::function<void()> onFinished;
+};
+
+} // namespace
+
+class ZipArchive::Private {
+public:
+    Private() : maxIdleHandles(qMax(2, QThread::idealThreadCount() + 1)) {}
+
+    QString filePath;
+    std::shared_ptr<MappedFile> mapping; // Bytes every handle reads from, if the file could be mapped
+    std::shared_ptr<RemoteFile> remote;  // Block cache every handle reads from, for an HTTP URL
+    QVector<Entry> entries;              // In central directory order
+    QHash<QString, int> lookup;          // Normalized path -> position in entries
+
+    mutable QMutex handleMutex;
+    mutable QVector<zip_t*> idleHandles;
+    int maxIdleHandles; // Handles beyond this are closed when returned
+
+    // Opens another handle on the same file; returns null and sets
+    // message on failure
+    zip_t* openHandle(QString* message) const {
+        zip_t* handle = nullptr;
+        if (remote) {
+            // Only the central directory and the entries read are fetched
+            zip_error_t error;
+            zip_error_init(&error);
+            RemoteSource* state = new RemoteSource;
+            state->file = remote;
+            zip_error_init(&state->error);
+            zip_source_t* source = zip_source_function_create(remoteSourceCallback, state, &error);
+            if (source) {
+                handle = zip_open_from_source(source, ZIP_RDONLY, &error);
+                if (!handle) zip_source_free(source); // Frees state
+            } else {
+                zip_error_fini(&state->error);
+                delete state;
+            }
+            if (!handle && message) *message = QString::fromUtf8(zip_error_strerror(&error));
+            zip_error_fini(&error);
+            return handle;
+        }
+        if (mapping) {
+            zip_error_t error;
+            zip_error_init(&error);
+            zip_source_t* source = zip_source_buffer_create(mapping->data(), static_cast<zip_uint64_t>(mapping->size()), 0, &error);
+            if (source) {
+                handle = zip_open_from_source(source, ZIP_RDONLY, &error);
+                if (!handle) zip_source_free(source);
+            }
+            if (!handle && message) *message = QString::fromUtf8(zip_error_strerror(&error));
+            zip_error_fini(&error);
+            if (handle) return handle;
+        }
+
+        int zipError = 0;
+        handle = zip_open(filePath.toUtf8().constData(), ZIP_RDONLY, &zipError);
+        if (!handle && message) {
+            char errorBuffer[256];
+            zip_error_to_str(errorBuffer, sizeof(errorBuffer), zipError, errno);
+            *message = QString::fromUtf8(errorBuffer);
+        }
+        return handle;
+    }
+
+    zip_t* acquire() const {
+        {
+            QMutexLocker locker(&handleMutex);
+            if (!idleHandles.isEmpty()) return idleHandles.takeLast();
+        }
+        return openHandle(nullptr);
+    }
+
+    void release(zip_t* handle) const {
+        if (!handle) return;
+        {
+            QMutexLocker locker(&handleMutex);
+            if (idleHandles.size() < maxIdleHandles) {
+                idleHandles.append(handle);
+                return;
+            }
+        }
+        zip_discard(handle);
+    }
+
+    // Reads bytes of the archive file, from whichever the handles read
+    QByteArray readAt(qint64 offset, qint64 length) const {
+        if (offset < 0 || length <= 0) return QByteArray();
+        if (remote) return remote->read(offset, length);
+        if (mapping) {
+            if (offset >= mapping->size()) return QByteArray();
+            length = qMin(length, mapping->size() - offset);
+            return QByteArray(reinterpret_cast<const char*>(mapping->data()) + offset, static_cast<int>(length));
+        }
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) return QByteArray();
+        return file.read(length);
+    }
+
+    qint64 archiveSize() const {
+        if (remote) return remote->size();
+        if (mapping) return mapping->size();
+        return QFile(filePath).size();
+    }
+
+    // Gets where each entry's local header starts, by libzip index, from
+    // the central directory; libzip keeps these offsets to itself. Empty
+    // if the directory cannot be read.
+    QVector<qint64> localHeaderOffsets(qint64* directoryStart) const {
+        const qint64 size = archiveSize();
+        if (size < EndRecordSize) return QVector<qint64>();
+        const qint64 tailStart = qMax<qint64>(0, size - EndRecordSearch);
+        const QByteArray tail = readAt(tailStart, size - tailStart);
+        if (tail.size() != size - tailStart) return QVector<qint64>();
+        qint64 end = tail.size() - EndRecordSize;
+        while (end >= 0 && le32(tail, end) != EndRecordSignature) --end;
+        if (end < 0) return QVector<qint64>();
+
+        quint64 count = le16(tail, end + 10);
+        quint64 directorySize = le32(tail, end + 12);
+        quint64 directoryOffset = le32(tail, end + 16);
+        qint64 recordStart = tailStart + end; // Where the directory's trailer begins
+        if (count == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF) {
+            if (end < 20 || le32(tail, end - 20) != Zip64LocatorSignature) return QVector<qint64>();
+            const qint64 zip64End = static_cast<qint64>(le64(tail, end - 12));
+            const QByteArray record = readAt(zip64End, 56);
+            if (record.size() != 56 || le32(record, 0) != Zip64EndRecordSignature) return QVector<qint64>();
+            count = le64(record, 32);
+            directorySize = le64(record, 40);
+            directoryOffset = le64(record, 48);
+            recordStart = zip64End;
+        }
+        // Data prepended to the archive, as in self-extractors, shifts every offset
+        const qint64 shift = recordStart - static_cast<qint64>(directorySize) - static_cast<qint64>(directoryOffset);
+        if (static_cast<qint64>(directorySize) > recordStart || shift < 0
+            || count > static_cast<quint64>(directorySize) / CentralHeaderSize) {
+            return QVector<qint64>();
+        }
+        const QByteArray directory = readAt(recordStart - static_cast<qint64>(directorySize), static_cast<qint64>(directorySize));
+        if (directory.size() != static_cast<int>(directorySize)) return QVector<qint64>();
+
+        QVector<qint64> offsets;
+        offsets.reserve(static_cast<int>(count));
+        qint64 at = 0;
+        for (quint64 i = 0; i < count; ++i) {
+            if (at + CentralHeaderSize > directory.size() || le32(directory, at) != CentralHeaderSignature) return QVector<qint64>();
+            const qint64 nameLength = le16(directory, at + 28);
+            const qint64 extraLength = le16(directory, at + 30);
+            const qint64 commentLength = le16(directory, at + 32);
+            const qint64 extraStart = at + CentralHeaderSize + nameLength;
+            if (extraStart + extraLength + commentLength > directory.size()) return QVector<qint64>();
+            quint64 offset = le32(directory, at + 42);
+            if (offset == 0xFFFFFFFF) {
+                // The ZIP64 extra field holds, in order, whichever of the
+                // sizes and the offset did not fit
+                qint64 field = extraStart;
+                while (field + 4 <= extraStart + extraLength) {
+                    const quint16 id = le16(directory, field);
+                    const qint64 fieldLength = le16(directory, field + 2);
+                    if (id == 0x0001) {
+                        qint64 value = field + 4;
+                        if (le32(directory, at + 24) == 0xFFFFFFFF) value += 8;
+                        if (le32(directory, at + 20) == 0xFFFFFFFF) value += 8;
+                        if (value + 8 <= field + 4 + fieldLength) offset = le64(directory, value);
+                        break;
+                    }
+                    field += 4 + fieldLength;
+                }
+            }
+            offsets.append(static_cast<qint64>(offset) + shift);
+            at = extraStart + extraLength + commentLength;
+        }
+        if (directoryStart) *directoryStart = recordStart - static_cast<qint64>(directorySize);
+        return offsets;
+    }
+
+    // An entry's data ends where the next local header in the file begins,
+    // or the central directory for the last one. Without the directory's
+    // offsets, local headers are taken as 30 bytes plus the name and the
+    // entries as stored in index order.
+    bool buildIndex(zip_t* handle) {
+        const zip_int64_t count = zip_get_num_entries(handle, 0);
+        if (count < 0 || count > std::numeric_limits<int>::max()) return false;
+        entries.reserve(static_cast<int>(count));
+        lookup.reserve(static_cast<int>(count));
+        qint64 position = 0;
+        for (zip_int64_t i = 0; i < count; ++i) {
+            zip_stat_t stat;
+            zip_stat_init(&stat);
+            if (zip_stat_index(handle, static_cast<zip_uint64_t>(i), 0, &stat) != 0 || !(stat.valid & ZIP_STAT_NAME)) {
+                continue;
+            }
+            Entry entry;
+            entry.index = static_cast<quint64>(i);
+            entry.name = QString::fromUtf8(stat.name);
+            entry.size = (stat.valid & ZIP_STAT_SIZE) ? static_cast<qint64>(stat.size) : 0;
+            entry.compressedSize = (stat.valid & ZIP_STAT_COMP_SIZE) ? static_cast<qint64>(stat.comp_size) : 0;
+            entry.compressionMethod = (stat.valid & ZIP_STAT_COMP_METHOD) ? stat.comp_method : ZIP_CM_DEFAULT;
+            position += 30 + qstrlen(stat.name) + entry.compressedSize;
+            entry.estimatedEnd = position;
+            entry.offset = -1;
+
+            // First entry wins, as with zip_name_locate()
+            const QString key = normalizePath(entry.name);
+            if (!lookup.contains(key)) lookup.insert(key, entries.size());
+            entries.append(entry);
+        }
+
+        qint64 directoryStart = 0;
+        const QVector<qint64> offsets = localHeaderOffsets(&directoryStart);
+        if (offsets.size() != static_cast<int>(count)) {
+            LOG_DEBUG("ZipArchive: Estimating entry ends; cannot read the central directory offsets of " << filePath);
+            return true;
+        }
+        QVector<qint64> starts(offsets);
+        starts.append(directoryStart);
+        std::sort(starts.begin(), starts.end());
+        for (Entry& entry : entries) {
+            entry.offset = offsets.at(static_cast<int>(entry.index));
+            const auto next = std::upper_bound(starts.cbegin(), starts.cend(), entry.offset);
+            entry.estimatedEnd = next != starts.cend() ? *next : directoryStart;
+        }
+        return true;
+    }
+};
+
+ZipArchive::ZipArchive()
+    : d(new Private())
+{
+}
+
+ZipArchive::~ZipArchive()
+{
+    close();
+}
+
+bool ZipArchive::open(const QString& filePath, QString* error)
+{
+    close();
+
+    // Through the shared mapping when possible, so libzip reads the
+    // mapped pages instead of copying the file through its own buffers
+    d->filePath = filePath;
+    if (RemoteFile::isRemote(filePath)) {
+        d->remote = RemoteFile::open(filePath, error);
+        if (!d->remote) {
+            close();
+            return false;
+        }
+    } else {
+        d->mapping = MappedFile::open(filePath);
+    }
+    QString message;
+    zip_t* handle = d->openHandle(&message);
+    if (!handle) {
+        if (error) *error = message;
+        close();
+        return false;
+    }
+    if (!d->buildIndex(handle)) {
+        zip_discard(handle);
+        if (error) *error = QStringLiteral("Cannot read the archive's central directory");
+        close();
+        return false;
+    }
+    d->release(handle);
+    LOG_DEBUG("ZipArchive: Indexed " << d->entries.size() << " entries in " << filePath);
+    return true;
+}
+
+void ZipArchive::close()
+{
+    QMutexLocker locker(&d->handleMutex);
+    for (zip_t* handle : d->idleHandles) {
+        zip_discard(handle);
+    }
+    d->idleHandles.clear();
+    d->entries.clear();
+    d->lookup.clear();
+    d->mapping.reset();
+    d->remote.reset();
+    d->filePath.clear();
+}
+
+bool ZipArchive::isOpen() const
+{
+    return !d->filePath.isEmpty();
+}
+
+QString ZipArchive::filePath() const
+{
+    return d->filePath;
+}
+
+QStringList ZipArchive::entryNames() const
+{
+    QStringList names;
+    names.reserve(d->entries.size());
+    for (const Entry& entry : d->entries) {
+        names.append(entry.name);
+    }
+    return names;
+}
+
+const ZipArchive::Entry* ZipArchive::entry(const QString& path) const
+{
+    const auto it = d->lookup.constFind(normalizePath(path));
+    return it != d->lookup.constEnd() ? &d->entries.at(it.value()) : nullptr;
+}
+
+bool ZipArchive::contains(const QString& path) const
+{
+    return d->lookup.contains(normalizePath(path));
+}
+
+QByteArray ZipArchive::read(const QString& path) const
+{
+    const Entry* found = entry(path);
+    if (!found) {
+        LOG_ERROR("ZipArchive: No entry " << path << " in " << d->filePath);
+        return QByteArray();
+    }
+    if (found->size > std::numeric_limits<int>::max()) {
+        LOG_ERROR("ZipArchive: Entry too large to read: " << path);
+        return QByteArray();
+    }
+
+    zip_t* handle = d->acquire();
+    if (!handle) {
+        LOG_ERROR("ZipArchive: Cannot open another handle on " << d->filePath);
+        return QByteArray();
+    }
+
+    QByteArray data;
+    zip_file_t* file = zip_fopen_index(handle, found->index, 0);
+    if (file) {
+        data.resize(static_cast<int>(found->size));
+        const zip_int64_t bytesRead = zip_fread(file, data.data(), static_cast<zip_uint64_t>(found->size));
+        zip_fclose(file);
+        if (bytesRead != found->size) {
+            LOG_ERROR("ZipArchive: Failed to read full file content: " << path);
+            data.clear();
+        }
+    } else {
+        LOG_ERROR("ZipArchive: Failed to open file in archive: " << path);
+    }
+    d->release(handle);
+
+    // Content is mostly read front to back; warm the cache for what follows
+    if (!data.isEmpty()) {
+        if (d->remote) {
+            d->remote->prefetch(found->estimatedEnd, RemotePrefetchBytes);
+        } else {
+            ReadAhead::instance().prefetchAfter(d->filePath, found->estimatedEnd);
+        }
+    }
+    return data;
+}
+
+std::unique_ptr<QIODevice> ZipArchive::openStream(const QString& path) const
+{
+    const Entry* found = entry(path);
+    if (!found) {
+        LOG_ERROR("ZipArchive: No entry " << path << " in " << d->filePath);
+        return nullptr;
+    }
+
+    zip_t* handle = d->acquire();
+    if (!handle) {
+        LOG_ERROR("ZipArchive: Cannot open another handle on " << d->filePath);
+        return nullptr;
+    }
+    zip_file_t* file = zip_fopen_index(handle, found->index, 0);
+    if (!file) {
+        LOG_ERROR("ZipArchive: Failed to open file in archive: " << path);
+        d->release(handle);
+        return nullptr;
+    }
+
+    const Private* archive = d.get();
+    const QString filePath = d->filePath;
+    const std::shared_ptr<RemoteFile> remote = d->remote;
+    const qint64 estimatedEnd = found->estimatedEnd;
+    std::unique_ptr<QIODevice> device(new ZipEntryDevice(
+        handle, file, found->size,
+        [archive](zip_t* released) { archive->release(released); },
+        [filePath, remote, estimatedEnd]() {
+            if (remote) {
+                remote->prefetch(estimatedEnd, RemotePrefetchBytes);
+            } else {
+                ReadAhead::instance().prefetchAfter(filePath, estimatedEnd);
+            }
+        }));
+    device->open(QIODevice::ReadOnly);
+    return device;
+}
+
+QString ZipArchive::normalizePath(const QString& path)
+{
+    QString normalized = path;
+    normalized.replace(QLatin1Char('\\'), QLatin1Char('/'));
+    normalized = QDir::cleanPath(normalized);
+    while (normalized.startsWith(QLatin1Char('/'))) normalized.remove(0, 1);
+    if (normalized == QLatin1String(".")) normalized.clear();
+    return normalized;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,132 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_ZIPARCHIVE_H
+#define QUANTILYX_ZIPARCHIVE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Read-only ZIP archive shared by the threads of one document.
+ *
+ * The central directory is indexed once when the archive is opened, so a
+ * lookup by path is a hash probe instead of a libzip name search. libzip
+ * handles are not safe to share between threads, so every concurrent
+ * read leases its own handle from a small pool; all of them read from the
+ * same MappedFile when the file can be mapped. Large entries can be read
+ * through openStream() instead of read(). An http:// or https:// URL is read
+ * through RemoteFile, fetching only the directory and the entries read.
+ * Used by the EPUB and CBZ backends.
+ */
+class ZipArchive
+{
+public:
+    /**
+     * @brief One file in the archive, as found in the central directory.
+     */
+    struct Entry {
+        quint64 index = 0;          ///< libzip entry index
+        QString name;               ///< Name as stored in the archive
+        qint64 size = 0;            ///< Uncompressed size
+        qint64 compressedSize = 0;  ///< Size of the data in the file
+        int compressionMethod = 0;  ///< ZIP_CM_* value
+        qint64 offset = -1;         ///< File offset of the entry's local header; -1 if unknown
+        qint64 estimatedEnd = 0;    ///< File offset where the entry's data ends; estimated if offset is unknown
+    };
+
+    ZipArchive();
+    ~ZipArchive();
+
+    /**
+     * @brief Open an archive and index its entries. Closes any open archive first.
+     * @param filePath Archive to open.
+     * @param error Receives libzip's message on failure; may be null.
+     * @return True on success.
+     */
+    bool open(const QString& filePath, QString* error = nullptr);
+
+    /**
+     * @brief Close every handle and drop the index.
+     * Must not be called while another thread is reading.
+     */
+    void close();
+
+    /**
+     * @brief Check if an archive is open.
+     * @return True if open.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the open archive's path.
+     * @return File path, or empty if closed.
+     */
+    QString filePath() const;
+
+    /**
+     * @brief Get every entry name in central directory order.
+     * @return Names as stored in the archive.
+     */
+    QStringList entryNames() const;
+
+    /**
+     * @brief Look up an entry.
+     * @param path Path inside the archive; normalized with normalizePath().
+     * @return The entry, or nullptr. Valid until close().
+     */
+    const Entry* entry(const QString& path) const;
+
+    /**
+     * @brief Check if the archive has an entry.
+     * @param path Path inside the archive.
+     * @return True if present.
+     */
+    bool contains(const QString& path) const;
+
+    /**
+     * @brief Decompress an entry. Safe to call from several threads at once.
+     * @param path Path inside the archive.
+     * @return Entry contents, or empty if missing or unreadable.
+     */
+    QByteArray read(const QString& path) const;
+
+    /**
+     * @brief Open an entry for streaming decompression.
+     * The device inflates the entry in chunks as it is read, so image
+     * decoders and parsers can consume a large entry without it ever being
+     * held in memory whole. It leases its own handle until destroyed, and
+     * must not outlive this archive. Safe to call from several threads.
+     * @param path Path inside the archive.
+     * @return Sequential, read-only device, or null if the entry is missing.
+     */
+    std::unique_ptr<QIODevice> openStream(const QString& path) const;
+
+    /**
+     * @brief Normalize a path the way the entry index keys it.
+     * Backslashes become slashes, and leading slashes, "." and ".."
+     * segments are resolved away.
+     * @param path Path inside an archive.
+     * @return Normalized path.
+     */
+    static QString normalizePath(const QString& path);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_ZIPARCHIVE_H
@@ -8,20 +8,153 @@
  * (at your option) any later version.
  */
 #include "DwgDocument.h"
-#include "DwgPage.h" // Assuming this will be created
+#include "DxfDocument.h"
+#include "../../core/Application.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/Page.h"
+#include "../../core/Settings.h"
+#include "../../core/ThreadPool.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QImage>
+#include <QPointer>
 #include <QProcess>
 #include <QStandardPaths>
+#include <QTemporaryDir>
 #include <QDebug>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Output the converter is asked for; part of the cache key
+const char* const ConversionVersion = "ACAD2018";
+const char* const ConversionType = "DXF";
+
+// Converted drawings kept when nothing else is configured
+constexpr int DefaultCachedConversions = 32;
+
+QString conversionCacheDirectory()
+{
+    return Application::instance()->cacheDirectory() + QLatin1String("/dwg");
+}
+
+// Identifies the converter build: upgrading it replaces the executable
+QByteArray converterFingerprint(const QString& converterPath)
+{
+    const QFileInfo info(converterPath);
+    return info.canonicalFilePath().toUtf8() + '|' + QByteArray::number(info.size()) + '|'
+           + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+// Cache file name for a drawing: its content hash plus everything that
+// changes the converter's output
+QString conversionKey(const QString& filePath, const QByteArray& converter)
+{
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    const std::shared_ptr<MappedFile> mapping = MappedFile::open(filePath);
+    if (mapping) {
+        const char* data = reinterpret_cast<const char*>(mapping->data());
+        constexpr qint64 Chunk = 1 << 24;
+        for (qint64 offset = 0; offset < mapping->size(); offset += Chunk) {
+            hasher.addData(data + offset, static_cast<int>(qMin(Chunk, mapping->size() - offset)));
+        }
+    } else {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly) || !hasher.addData(&file)) return QString();
+    }
+    hasher.addData(converter);
+    hasher.addData(ConversionVersion);
+    hasher.addData(ConversionType);
+    return QString::fromLatin1(hasher.result().toHex()) + QLatin1String(".dxf");
+}
+
+// Drop the least recently used conversions beyond the configured count
+void trimConversionCache(const QString& directory, int limit)
+{
+    const QFileInfoList entries = QDir(directory).entryInfoList(QStringList() << QStringLiteral("*.dxf"), QDir::Files, QDir::Time);
+    for (int i = limit; i < entries.size(); ++i) {
+        QFile::remove(entries[i].absoluteFilePath());
+    }
+}
+
+// Convert a drawing, or find its earlier conversion. Runs on a pool thread.
+// Returns the DXF path, or an empty string with error set.
+QString convertDrawing(const QString& filePath, const QString& converterPath, QString* error)
+{
+    const QString cacheDir = conversionCacheDirectory();
+    if (!QDir().mkpath(cacheDir)) {
+        *error = QCoreApplication::translate("DwgDocument", "Cannot create the DWG conversion cache in %1.").arg(cacheDir);
+        return QString();
+    }
+    const QString key = conversionKey(filePath, converterFingerprint(converterPath));
+    if (key.isEmpty()) {
+        *error = QCoreApplication::translate("DwgDocument", "Cannot read %1.").arg(filePath);
+        return QString();
+    }
+    const QString cachedPath = cacheDir + QLatin1Char('/') + key;
+    if (QFile::exists(cachedPath)) {
+        // Mark it recently used so trimming keeps it
+        QFile cached(cachedPath);
+        if (cached.open(QIODevice::ReadWrite)) cached.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        LOG_DEBUG("DwgDocument: Reusing conversion " << cachedPath << " for " << filePath);
+        return cachedPath;
+    }
+
+    // The converter works on folders: give it one holding only this drawing.
+    // Work happens next to the cache so the result can be renamed in place.
+    QTemporaryDir workDir(cacheDir + QLatin1String("/convert-XXXXXX"));
+    const QString inputDir = workDir.path() + QLatin1String("/in");
+    const QString outputDir = workDir.path() + QLatin1String("/out");
+    if (!workDir.isValid() || !QDir().mkpath(inputDir) || !QDir().mkpath(outputDir)) {
+        *error = QCoreApplication::translate("DwgDocument", "Failed to create temporary directory for DWG conversion.");
+        return QString();
+    }
+    const QString input = inputDir + QLatin1String("/drawing.dwg");
+    if (!QFile::link(QFileInfo(filePath).absoluteFilePath(), input) && !QFile::copy(filePath, input)) {
+        *error = QCoreApplication::translate("DwgDocument", "Cannot read %1.").arg(filePath);
+        return QString();
+    }
+
+    // ODAFileConverter <input folder> <output folder> <version> <type> <recurse> <audit> <filter>
+    QStringList args;
+    args << inputDir << outputDir << QLatin1String(ConversionVersion) << QLatin1String(ConversionType)
+         << QStringLiteral("0") << QStringLiteral("1") << QStringLiteral("*.DWG");
+
+    QProcess converterProcess;
+    converterProcess.start(converterPath, args);
+    if (!converterProcess.waitForFinished(-1)) {
+        *error = QCoreApplication::translate("DwgDocument", "ODA File Converter process did not finish.");
+        return QString();
+    }
+    const QString output = outputDir + QLatin1String("/drawing.dxf");
+    if (converterProcess.exitCode() != 0 || !QFile::exists(output)) {
+        *error = QCoreApplication::translate("DwgDocument", "ODA File Converter failed: %1")
+                     .arg(QString::fromLocal8Bit(converterProcess.readAllStandardError()));
+        return QString();
+    }
+
+    // Another window may have converted the same drawing meanwhile
+    if (!QFile::rename(output, cachedPath) && !QFile::exists(cachedPath)) {
+        *error = QCoreApplication::translate("DwgDocument", "Cannot store the converted drawing in %1.").arg(cacheDir);
+        return QString();
+    }
+    trimConversionCache(cacheDir, qMax(1, Settings::instance().value<int>("Advanced/DwgCachedConversions", DefaultCachedConversions)));
+    LOG_INFO("DwgDocument: Converted " << filePath << " to " << cachedPath);
+    return cachedPath;
+}
+
+} // namespace
+
 class DwgDocument::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(1), entityCountVal(0), is3dVal(false) {} // Assume single page/layouts for now
+    Private() : isLoaded(false), pageCountVal(0), entityCountVal(0), is3dVal(false), loadGeneration(0) {}
     ~Private() = default;
 
     bool isLoaded;
@@ -31,8 +164,10 @@ public:
     QList<QString> layers;
     int entityCountVal;
     bool is3dVal;
-    QList<std::unique_ptr<DwgPage>> pages;
-
+    quint64 loadGeneration;              // Bumped by load(); stale conversions are dropped
+    QString convertedPath;               // Cached DXF conversion of the drawing
+    std::unique_ptr<DxfDocument> drawing; // The conversion, which provides the pages
+    std::unique_ptr<LoadTrace> loadTrace; // Carried from load() into completeLoad()
     // Helper to find the ODA File Converter executable
     QString findOdaConverterExecutable() const {
         // Common names and locations for ODA File Converter
@@ -83,8 +218,14 @@ DwgDocument::~DwgDocument()
 bool DwgDocument::load(const QString& filePath, const QString& password)
 {
     Q_UNUSED(password); // DWG passwords are handled by the ODA converter if at all
+    ++d->loadGeneration; // Drops a conversion still in flight
     d->isLoaded = false;
-    d->pages.clear();
+    d->drawing.reset();
+    d->convertedPath.clear();
+    d->pageCountVal = 0;
+
+    std::unique_ptr<LoadTrace> trace(new LoadTrace(filePath, QStringLiteral("DWG")));
+    trace->phase(LoadTrace::Io);
 
     // Find the ODA File Converter executable
     QString converterPath = findOdaConverterExecutable();
@@ -93,64 +234,82 @@ bool DwgDocument::load(const QString& filePath, const QString& password)
         LOG_ERROR(lastError());
         return false;
     }
-
-    // Use ODA File Converter to export to a more manageable format (e.g., DXF or SVG) temporarily
-    // Example command: ODAFileConverter input.dwg output_directory/ DXF 0 ACAD2018 0
-    QTemporaryDir tempDir;
-    if (!tempDir.isValid()) {
-        setLastError(tr("Failed to create temporary directory for DWG conversion."));
+    if (!QFileInfo(filePath).isReadable()) {
+        setLastError(tr("Cannot read %1.").arg(filePath));
         LOG_ERROR(lastError());
         return false;
     }
 
-    QString outputDir = tempDir.path();
-    QString outputFilePath = outputDir + "/converted_output.dxf"; // Convert to DXF first
-
-    QStringList args;
-    args << filePath // Input file
-         << outputDir // Output directory
-         << "DXF" // Output format
-         << "0" // Version (0 = latest)
-         << "ACAD2018" // Specific version if needed
-         << "0"; // Sheet set (0 = no)
-
-    QProcess converterProcess;
-    converterProcess.start(converterPath, args);
-    bool finished = converterProcess.waitForFinished(-1); // Wait indefinitely
+    // Hashing and converting take seconds on large drawings; the pages
+    // appear when the DXF is ready, from the cache when it was seen before
+    setFilePath(filePath);
+    d->drawingName = QFileInfo(filePath).baseName();
+    setState(Loading);
+    trace->phase(LoadTrace::Parse); // Conversion and reading the DXF
+    d->loadTrace = std::move(trace);
+
+    const quint64 generation = d->loadGeneration;
+    QPointer<DwgDocument> self(this);
+    ThreadPool::ioInstance().submitDetached([self, generation, filePath, converterPath]() {
+        QString error;
+        const QString dxfPath = convertDrawing(filePath, converterPath, &error);
+        // self is only checked on the main thread, where the document is deleted
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, generation, dxfPath, error]() {
+            if (self) self->completeLoad(generation, dxfPath, error);
+        }, Qt::QueuedConnection);
+    }, Task::Priority::High);
+
+    LOG_INFO("Converting DWG document in the background: " << filePath);
+    return true;
+}
 
-    if (!finished) {
-        setLastError(tr("ODA File Converter process did not finish."));
-        LOG_ERROR(lastError());
-        return false;
+void DwgDocument::completeLoad(quint64 generation, const QString& dxfPath, const QString& error)
+{
+    if (generation != d->loadGeneration) return; // A later load() replaced this document
+    const std::unique_ptr<LoadTrace> trace = std::move(d->loadTrace);
+
+    std::unique_ptr<DxfDocument> drawing;
+    QString failure = error;
+    if (failure.isEmpty()) {
+        drawing = std::make_unique<DxfDocument>();
+        if (!drawing->load(dxfPath)) {
+            failure = tr("Failed to read the converted drawing: %1").arg(drawing->lastError());
+            // A damaged conversion must not be served again
+            QFile::remove(dxfPath);
+            drawing.reset();
+        }
     }
-
-    if (converterProcess.exitCode() != 0) {
-        QString errorOutput = converterProcess.readAllStandardError();
-        setLastError(tr("ODA File Converter failed: %1").arg(errorOutput));
-        LOG_ERROR(lastError());
-        return false;
+    if (!drawing) {
+        if (trace) trace->finish(false);
+        setLastError(failure);
+        LOG_ERROR(failure << " " << filePath());
+        setState(Error);
+        emit loadFailed(failure);
+        return;
     }
 
-    // At this point, a DXF file should exist in the temp directory.
-    // We could then load this temporary DXF file using our existing DxfDocument class.
-    // This is a complex workaround but avoids direct DWG library integration for now.
-
-    // For this stub, let's assume the conversion worked and we have some basic info.
-    // In a real implementation, you'd load the converted file (e.g., DxfDocument) and extract metadata/pages.
-    d->drawingName = QFileInfo(filePath).baseName(); // Fallback name
-    d->units = "Unitless"; // Fallback
-    d->layers = QStringList() << "0"; // Default layer
-    d->entityCountVal = 100; // Fallback count
-    d->is3dVal = false; // Determine from conversion output if possible
-
-    setFilePath(filePath);
+    d->drawing = std::move(drawing);
+    d->convertedPath = dxfPath;
+    d->pageCountVal = d->drawing->pageCount();
+    d->units = d->drawing->drawingUnits();
+    d->layers = d->drawing->layerNames();
+    d->entityCountVal = d->drawing->entityCount();
+    d->is3dVal = d->drawing->is3dDrawing();
+    if (trace) trace->phase(LoadTrace::Pages);
     createPages();
+    if (trace) trace->finish();
 
     d->isLoaded = true;
     setState(Loaded);
+    emit pageCountChanged();
+    emit loaded();
     emit dwgLoaded();
-    LOG_INFO("Successfully loaded DWG document (via ODA converter): " << filePath << " (Entities: " << d->entityCountVal << ", 3D: " << d->is3dVal << ")");
-    return true;
+    LOG_INFO("Successfully loaded DWG document (via ODA converter): " << filePath() << " (Entities: " << d->entityCountVal << ", 3D: " << d->is3dVal << ")");
+}
+
+QString DwgDocument::findOdaConverterExecutable() const
+{
+    return d->findOdaConverterExecutable();
 }
 
 bool DwgDocument::save(const QString& filePath)
@@ -174,12 +333,8 @@ int DwgDocument::pageCount() const
 
 Page* DwgDocument::page(int index) const
 {
-    if (index >= 0 && index < d->pages.size()) {
-        // return d->pages[index].get(); // Placeholder
-        LOG_DEBUG("DwgDocument::page: Planned page " << index);
-        return nullptr; // Placeholder
-    }
-    return nullptr;
+    // Pages come from the converted drawing
+    return d->drawing ? d->drawing->page(index) : nullptr;
 }
 
 bool DwgDocument::isLocked() const
@@ -235,61 +390,41 @@ bool DwgDocument::is3dDrawing() const
 
 bool DwgDocument::exportAsImage(const QString& outputPath, const QString& format, int resolution) const
 {
-    // This would use ODA File Converter to export directly to an image format.
-    // Example command: ODAFileConverter input.dwg output_dir PNG 300 1 0
-    QString converterPath = d->findOdaConverterExecutable();
-    if (converterPath.isEmpty()) {
-        LOG_ERROR("DwgDocument::exportAsImage: ODA File Converter not found.");
+    // The converted drawing is already at hand; the converter does not run again
+    Page* drawingPage = page(0);
+    if (!drawingPage || resolution <= 0) {
+        LOG_ERROR("DwgDocument::exportAsImage: Drawing is not loaded.");
         return false;
     }
 
-    QFileInfo outputInfo(outputPath);
-    QString outputDir = outputInfo.absolutePath();
-    QString outputFileBase = outputInfo.baseName();
-
-    QStringList args;
-    args << filePath()
-         << outputDir
-         << format.toUpper() // Output format (PNG, TIFF, etc.)
-         << QString::number(resolution) // Resolution
-         << "1" // Raster version (1 = latest)
-         << "0"; // Sheet set
-
-    QProcess exportProcess;
-    exportProcess.start(converterPath, args);
-    bool finished = exportProcess.waitForFinished(-1);
-
-    if (!finished) {
-        LOG_ERROR("DwgDocument::exportAsImage: ODA export process did not finish.");
+    const QSizeF pageSize = drawingPage->size();
+    const int width = qMax(1, qRound(pageSize.width() * resolution / 72.0));
+    const int height = qMax(1, qRound(pageSize.height() * resolution / 72.0));
+    QImage image = drawingPage->render(width, height, resolution);
+    if (image.isNull()) {
+        LOG_ERROR("DwgDocument::exportAsImage: Failed to render " << filePath());
         return false;
     }
-
-    if (exportProcess.exitCode() != 0) {
-        QString errorOutput = exportProcess.readAllStandardError();
-        LOG_ERROR("DwgDocument::exportAsImage: ODA export failed: " << errorOutput);
+    image.setDotsPerMeterX(qRound(resolution / 0.0254));
+    image.setDotsPerMeterY(qRound(resolution / 0.0254));
+    if (!image.save(outputPath, format.toUpper().toLatin1().constData())) {
+        LOG_ERROR("DwgDocument::exportAsImage: Cannot write " << outputPath);
         return false;
     }
+    LOG_INFO("DwgDocument::exportAsImage: Successfully exported to: " << outputPath);
+    return true;
+}
 
-    // Check if the expected output file was created
-    QString expectedOutput = outputDir + "/" + outputFileBase + "." + format.toLower();
-    if (QFile::exists(expectedOutput)) {
-        LOG_INFO("DwgDocument::exportAsImage: Successfully exported to: " << expectedOutput);
-        return true;
-    } else {
-        LOG_ERROR("DwgDocument::exportAsImage: Expected output file not found: " << expectedOutput);
-        return false;
-    }
+void DwgDocument::clearConversionCache()
+{
+    trimConversionCache(conversionCacheDirectory(), 0);
+    LOG_INFO("DwgDocument: Cleared the conversion cache");
 }
 
 void DwgDocument::createPages()
 {
-    d->pages.clear();
-    d->pages.reserve(d->pageCountVal);
-    for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<DwgPage>(this, i)); // Placeholder
-        LOG_DEBUG("DwgDocument: Planned page " << i);
-    }
-    LOG_INFO("DwgDocument: Created " << d->pages.size() << " page objects.");
+    // The converted DXF owns the page objects
+    LOG_INFO("DwgDocument: " << d->pageCountVal << " pages from " << d->convertedPath);
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -17,14 +17,15 @@
 
 namespace QuantilyxDoc {
 
-class DwgPage; // Forward declaration
-
 /**
  * @brief DWG (AutoCAD Drawing) document implementation.
  * 
  * Handles loading and parsing of DWG files.
  * Requires ODA Teigha library or ODA File Converter tool.
- * This implementation uses the ODA File Converter via QProcess.
+ * This implementation uses the ODA File Converter via QProcess to produce a
+ * DXF, which provides the pages. Conversions run in the background and are
+ * kept in Application::cacheDirectory(), keyed by the drawing's content hash
+ * and the converter build, so reopening a drawing skips the converter.
  */
 class DwgDocument : public Document
 {
@@ -35,6 +36,10 @@ public:
     ~DwgDocument() override;
 
     // --- Document Interface Implementation ---
+    /**
+     * @brief Start loading. Returns once the conversion is under way, in
+     * the Loading state; loaded() or loadFailed() follows.
+     */
     bool load(const QString& filePath, const QString& password = QString()) override;
     bool save(const QString& filePath = QString()) override;
     DocumentType type() const override;
@@ -54,7 +59,8 @@ public:
 
     // --- DWG-Specific Functionality ---
     /**
-     * @brief Export the drawing as a high-quality image.
+     * @brief Export the drawing as a high-quality image, rendered from the
+     * converted drawing.
      * @param outputPath Path to save the image.
      * @param format Output image format (e.g., "png", "tiff").
      * @param resolution DPI for rendering.
@@ -62,6 +68,12 @@ public:
      */
     bool exportAsImage(const QString& outputPath, const QString& format = "png", int resolution = 300) const;
 
+    /**
+     * @brief Delete the cached conversions. Open drawings are not affected,
+     * as they hold what they read; conversions under way finish as usual.
+     */
+    static void clearConversionCache();
+
 signals:
     void dwgLoaded();
 
@@ -71,6 +83,8 @@ private:
 
     // Helper to find the ODA File Converter executable
     QString findOdaConverterExecutable() const;
+    // Take the converted drawing, on the main thread, unless load() was called again
+    void completeLoad(quint64 generation, const QString& dxfPath, const QString& error);
 
     void createPages();
 };
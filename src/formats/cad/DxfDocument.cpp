@@ -9,44 +9,413 @@
  */
 #include "DxfDocument.h"
 #include "DxfPage.h"
+#include "DxfSpatialIndex.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/Settings.h"
+#include <QColor>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
-#include <QRegularExpression>
-#include <QTextStream>
+#include <QFont>
+#include <QHash>
+#include <QSet>
+#include <QPainter>
+#include <QPolygonF>
+#include <QVector>
+#include <QtMath>
 #include <QDebug>
-// #include "libdxfrw/libdxfrw.h" // Hypothetical DXF reader library
+#include <cmath>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Page side limits in points; drawings in metres or millimetres would
+// otherwise give pages too large or too small to zoom sensibly
+const qreal MinPageSide = 72.0;
+const qreal MaxPageSide = 14400.0;
+
+// Level of detail defaults, in device pixels
+const double DefaultMinEntityPixels = 0.5; // Smaller entities are not drawn
+const double DefaultTextBoxPixels = 4.0;   // Lower text is drawn as its box
+
+// Rough advance of a character, as a share of the text height
+const qreal CharacterWidth = 0.6;
+
+// Points per drawing unit for the $INSUNITS codes; 0 is unitless
+qreal pointsPerUnit(int insUnits)
+{
+    switch (insUnits) {
+    case 1: return 72.0;                 // Inches
+    case 2: return 72.0 * 12.0;          // Feet
+    case 4: return 72.0 / 25.4;          // Millimetres
+    case 5: return 72.0 / 2.54;          // Centimetres
+    case 6: return 72000.0 / 25.4;       // Metres
+    case 8: return 72.0 / 1000.0;        // Mils
+    case 10: return 72.0 * 36.0;         // Yards
+    default: return 1.0;
+    }
+}
+
+QString unitName(int insUnits)
+{
+    switch (insUnits) {
+    case 1: return QStringLiteral("Inches");
+    case 2: return QStringLiteral("Feet");
+    case 4: return QStringLiteral("Millimeters");
+    case 5: return QStringLiteral("Centimeters");
+    case 6: return QStringLiteral("Meters");
+    case 8: return QStringLiteral("Mils");
+    case 10: return QStringLiteral("Yards");
+    default: return QStringLiteral("Unitless");
+    }
+}
+
+// AutoCAD Color Index; white (7) prints black on paper
+QRgb aciColor(int index)
+{
+    switch (index) {
+    case 1: return qRgb(255, 0, 0);
+    case 2: return qRgb(255, 255, 0);
+    case 3: return qRgb(0, 255, 0);
+    case 4: return qRgb(0, 255, 255);
+    case 5: return qRgb(0, 0, 255);
+    case 6: return qRgb(255, 0, 255);
+    case 8: return qRgb(128, 128, 128);
+    case 9: return qRgb(192, 192, 192);
+    case 7:
+    case 0:
+        return qRgb(0, 0, 0);
+    default:
+        return index > 9 && index < 250 ? qRgb(96, 96, 96) : qRgb(0, 0, 0);
+    }
+}
+
+} // namespace
+
 class DxfDocument::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(1), entityCountVal(0), is3dVal(false) {}
+    Private() : isLoaded(false), pageCountVal(1), entityCountVal(0), is3dVal(false),
+                unitScale(1.0), minEntityPixels(DefaultMinEntityPixels), textBoxPixels(DefaultTextBoxPixels) {}
     ~Private() = default;
 
+    enum EntityType : quint8 { Line, Polyline, Circle, Arc, Text, Point };
+
+    // One drawable entity; geometry lives in the shared point and text pools
+    struct Entity {
+        EntityType type;
+        bool closed;     // Polylines
+        QRgb color;
+        int firstPoint;  // Into points; lines and polylines use several
+        int pointCount;
+        double size;     // Radius, or text height
+        double angle;    // Arc start or text rotation, degrees counter-clockwise
+        double endAngle; // Arc end
+        int text;        // Into texts, or -1
+    };
+
     bool isLoaded;
     int pageCountVal; // Usually 1 for 2D
     QString drawingName;
     QString units;
+    QString version;
     QList<QString> layers;
     int entityCountVal;
     bool is3dVal;
     QList<std::unique_ptr<DxfPage>> pages;
 
-    // Helper to load and parse the DXF file
-    bool loadAndParseDxf(const QString& filePath) {
-        // This requires a DXF parsing library like libdxfrw, ezdxf (Python), or Open Design Alliance.
-        // LOG_ERROR("DxfDocument::loadAndParseDxf: Requires DXF parsing library, not implemented.");
-        // return false;
-        // Placeholder implementation
-        drawingName = "Sample Drawing";
-        units = "Millimeters";
-        layers = QStringList() << "Layer0" << "Layer1" << "Dimensions";
-        entityCountVal = 150;
+    QVector<Entity> entities;
+    QVector<QPointF> points;
+    QVector<QString> texts;
+    DxfSpatialIndex index;  // Entity bounds, in drawing units
+    QRectF extent;          // Drawing area, in drawing units
+    qreal unitScale;        // Points per drawing unit on the page
+    QSizeF pageSize;
+    double minEntityPixels;
+    double textBoxPixels;
+
+    // Entity being read, until the next group 0 ends it
+    struct Pending {
+        QByteArray type;
+        int color = 256;  // BYLAYER
+        int layer = -1;
+        QVector<QPointF> points;
+        QPointF first;
+        QPointF second;
+        double x = 0;     // Vertex x waiting for its y
+        double size = 0;
+        double angle = 0;
+        double endAngle = 360;
+        int flags = 0;
+        QString text;
+
+        void reset(const QByteArray& entityType) { *this = Pending(); type = entityType; }
+    };
+
+    QVector<QRgb> layerColors;   // By layer
+    QVector<bool> layerVisible;  // Layers with a negative color are off
+    QHash<QByteArray, int> layerIds;
+
+    int layerId(const QByteArray& name) {
+        auto it = layerIds.constFind(name);
+        if (it != layerIds.constEnd()) return it.value();
+        const int id = layers.size();
+        layerIds.insert(QByteArray(name.constData(), name.size()), id); // name may point into the file
+        layers.append(QString::fromUtf8(name));
+        layerColors.append(qRgb(0, 0, 0));
+        layerVisible.append(true);
+        return id;
+    }
+
+    static QRectF pointBounds(const QVector<QPointF>& pts, int first, int count) {
+        qreal minX = pts[first].x(), maxX = minX, minY = pts[first].y(), maxY = minY;
+        for (int i = first + 1; i < first + count; ++i) {
+            minX = qMin(minX, pts[i].x());
+            maxX = qMax(maxX, pts[i].x());
+            minY = qMin(minY, pts[i].y());
+            maxY = qMax(maxY, pts[i].y());
+        }
+        return QRectF(QPointF(minX, minY), QPointF(maxX, maxY));
+    }
+
+    // Corners of a text's box, in drawing units
+    QPolygonF textBox(const Entity& entity) const {
+        const QPointF origin = points[entity.firstPoint];
+        const qreal width = entity.size * CharacterWidth * qMax(1, texts[entity.text].size());
+        const qreal radians = qDegreesToRadians(entity.angle);
+        const QPointF along(std::cos(radians), std::sin(radians));
+        const QPointF up(-along.y(), along.x());
+        QPolygonF box;
+        box << origin << origin + along * width << origin + along * width + up * entity.size << origin + up * entity.size;
+        return box;
+    }
+
+    void finishEntity(Pending& pending, QVector<QRectF>& bounds) {
+        if (pending.type.isEmpty()) return;
+        if (pending.layer < 0) pending.layer = layerId(QByteArrayLiteral("0"));
+        if (!layerVisible[pending.layer]) {
+            pending.type.clear();
+            return;
+        }
+
+        Entity entity{Line, false, 0, points.size(), 0, pending.size, pending.angle, pending.endAngle, -1};
+        entity.color = pending.color == 256 || pending.color < 0 ? layerColors[pending.layer] : aciColor(pending.color);
+        QRectF box;
+        if (pending.type == "LINE") {
+            points << pending.first << pending.second;
+            entity.pointCount = 2;
+            box = pointBounds(points, entity.firstPoint, 2);
+        } else if (pending.type == "LWPOLYLINE" || pending.type == "POLYLINE") {
+            if (pending.points.size() < 2) {
+                pending.type.clear();
+                return;
+            }
+            entity.type = Polyline;
+            entity.closed = pending.flags & 1;
+            points += pending.points;
+            entity.pointCount = pending.points.size();
+            box = pointBounds(points, entity.firstPoint, entity.pointCount);
+        } else if (pending.type == "CIRCLE" || pending.type == "ARC") {
+            entity.type = pending.type == "ARC" ? Arc : Circle;
+            points << pending.first;
+            entity.pointCount = 1;
+            box = QRectF(pending.first.x() - pending.size, pending.first.y() - pending.size, pending.size * 2, pending.size * 2);
+        } else if (pending.type == "TEXT" || pending.type == "MTEXT") {
+            if (pending.text.isEmpty() || pending.size <= 0) {
+                pending.type.clear();
+                return;
+            }
+            entity.type = Text;
+            points << pending.first;
+            entity.pointCount = 1;
+            entity.text = texts.size();
+            // MTEXT paragraph breaks; other inline formatting is kept as is
+            texts.append(pending.text.replace(QLatin1String("\\P"), QLatin1String(" ")));
+            box = textBox(entity).boundingRect();
+        } else if (pending.type == "POINT") {
+            entity.type = Point;
+            points << pending.first;
+            entity.pointCount = 1;
+            box = QRectF(pending.first, pending.first);
+        } else {
+            pending.type.clear();
+            return;
+        }
+        entities.append(entity);
+        bounds.append(box);
+        pending.type.clear();
+    }
+
+    bool loadAndParseDxf(const QString& filePath, QString* error) {
+        const std::shared_ptr<MappedFile> mapping = MappedFile::open(filePath);
+        QByteArray data = mapping ? mapping->bytes() : QByteArray();
+        if (data.isEmpty()) {
+            QFile file(filePath);
+            if (file.open(QIODevice::ReadOnly)) data = file.readAll();
+        }
+        if (data.isEmpty()) {
+            *error = QObject::tr("Cannot read %1.").arg(filePath);
+            return false;
+        }
+        if (data.startsWith("AutoCAD Binary DXF")) {
+            *error = QObject::tr("Binary DXF files are not supported.");
+            return false;
+        }
+
+        entities.clear();
+        points.clear();
+        texts.clear();
+        layers.clear();
+        layerColors.clear();
+        layerVisible.clear();
+        layerIds.clear();
         is3dVal = false;
-        LOG_WARN("DxfDocument::loadAndParseDxf: Placeholder implementation. Requires libdxfrw or similar.");
-        return true; // Placeholder success
+        int insUnits = 0;
+        version.clear();
+
+        QVector<QRectF> bounds;
+        Pending pending;
+        Pending vertex;              // VERTEX of the POLYLINE being read
+        bool inPolyline = false;
+        QByteArray section;
+        QByteArray headerVariable;
+        bool expectSectionName = false;
+        bool inLayerRecord = false;
+        QByteArray layerName;
+        int layerColor = 7;
+
+        int pos = 0;
+        auto nextLine = [&data, &pos]() {
+            int end = pos;
+            while (end < data.size() && data[end] != '\n' && data[end] != '\r') ++end;
+            const QByteArray line = QByteArray::fromRawData(data.constData() + pos, end - pos).trimmed();
+            pos = end + 1;
+            if (end + 1 < data.size() && data[end] == '\r' && data[end + 1] == '\n') ++pos;
+            return line;
+        };
+        auto finishLayer = [&]() {
+            if (!inLayerRecord) return;
+            inLayerRecord = false;
+            if (layerName.isEmpty()) return;
+            const int id = layerId(layerName);
+            layerColors[id] = aciColor(qAbs(layerColor));
+            layerVisible[id] = layerColor >= 0;
+        };
+
+        while (pos < data.size()) {
+            bool ok = false;
+            const int code = nextLine().toInt(&ok);
+            if (pos >= data.size() && !ok) break;
+            const QByteArray value = nextLine();
+            if (!ok) {
+                *error = QObject::tr("Malformed DXF group code near byte %1.").arg(pos);
+                return false;
+            }
+
+            if (code == 0) {
+                if (section == "ENTITIES") {
+                    if (inPolyline && !vertex.type.isEmpty()) {
+                        pending.points.append(vertex.first);
+                        vertex.type.clear();
+                    }
+                    if (value == "VERTEX" && inPolyline) {
+                        vertex.reset(value);
+                        continue;
+                    }
+                    if (value == "SEQEND" && inPolyline) {
+                        inPolyline = false;
+                        finishEntity(pending, bounds);
+                        continue;
+                    }
+                    if (!inPolyline) finishEntity(pending, bounds);
+                    pending.reset(value);
+                    inPolyline = value == "POLYLINE";
+                } else if (section == "TABLES") {
+                    finishLayer();
+                    inLayerRecord = value == "LAYER";
+                    layerName.clear();
+                    layerColor = 7;
+                }
+                if (value == "SECTION") {
+                    expectSectionName = true;
+                } else if (value == "ENDSEC") {
+                    section.clear();
+                } else if (value == "EOF") {
+                    break;
+                }
+                continue;
+            }
+            if (expectSectionName) {
+                if (code == 2) section = value;
+                expectSectionName = false;
+                continue;
+            }
+
+            if (section == "HEADER") {
+                if (code == 9) {
+                    headerVariable = value;
+                } else if (headerVariable == "$INSUNITS" && code == 70) {
+                    insUnits = value.toInt();
+                } else if (headerVariable == "$ACADVER" && code == 1) {
+                    version = QString::fromLatin1(value);
+                }
+            } else if (section == "TABLES" && inLayerRecord) {
+                if (code == 2) layerName = value;
+                else if (code == 62) layerColor = value.toInt();
+            } else if (section == "ENTITIES") {
+                Pending& target = inPolyline && !vertex.type.isEmpty() ? vertex : pending;
+                switch (code) {
+                case 1: target.text += QString::fromUtf8(value); break;
+                case 3: target.text += QString::fromUtf8(value); break; // MTEXT chunks before group 1
+                case 8: target.layer = layerId(value); break;
+                case 10:
+                    target.x = value.toDouble();
+                    target.first.setX(target.x);
+                    break;
+                case 20:
+                    target.first.setY(value.toDouble());
+                    if (target.type == "LWPOLYLINE") target.points.append(QPointF(target.x, target.first.y()));
+                    break;
+                case 11: target.second.setX(value.toDouble()); break;
+                case 21: target.second.setY(value.toDouble()); break;
+                case 30:
+                case 31:
+                    if (value.toDouble() != 0.0) is3dVal = true;
+                    break;
+                case 40: target.size = value.toDouble(); break;
+                case 50: target.angle = value.toDouble(); break;
+                case 51: target.endAngle = value.toDouble(); break;
+                case 62: target.color = value.toInt(); break;
+                case 70: target.flags = value.toInt(); break;
+                default: break;
+                }
+            }
+        }
+        finishEntity(pending, bounds);
+        layerIds.clear();
+
+        index.build(bounds);
+        entityCountVal = entities.size();
+        units = unitName(insUnits);
+        drawingName = QFileInfo(filePath).baseName();
+
+        // Page in points: the drawing at its real size, within sane limits
+        extent = index.extent();
+        if (extent.isNull()) extent = QRectF(0, 0, 612, 792);
+        extent.setWidth(qMax<qreal>(extent.width(), 1e-6));
+        extent.setHeight(qMax<qreal>(extent.height(), 1e-6));
+        unitScale = pointsPerUnit(insUnits);
+        const qreal longest = qMax(extent.width(), extent.height()) * unitScale;
+        if (longest > MaxPageSide) unitScale *= MaxPageSide / longest;
+        else if (longest < MinPageSide) unitScale *= MinPageSide / longest;
+        pageSize = QSizeF(extent.width() * unitScale, extent.height() * unitScale);
+
+        minEntityPixels = Settings::instance().value<double>("Advanced/DxfMinEntityPixels", DefaultMinEntityPixels);
+        textBoxPixels = Settings::instance().value<double>("Advanced/DxfTextBoxPixels", DefaultTextBoxPixels);
+        return true;
     }
 };
 
@@ -54,7 +423,7 @@ DxfDocument::DxfDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
-    LOG_INFO("DxfDocument created. Note: DXF support requires a parser like libdxfrw.");
+    LOG_INFO("DxfDocument created.");
 }
 
 DxfDocument::~DxfDocument()
@@ -68,14 +437,19 @@ bool DxfDocument::load(const QString& filePath, const QString& password)
     d->isLoaded = false;
     d->pages.clear();
 
-    if (!d->loadAndParseDxf(filePath)) {
-        setLastError("DXF loading requires a DXF parser, which is not available.");
+    LoadTrace trace(filePath, QStringLiteral("DXF"));
+    trace.phase(LoadTrace::Parse);
+    QString error;
+    if (!d->loadAndParseDxf(filePath, &error)) {
+        setLastError(tr("Failed to load DXF document: %1").arg(error));
         LOG_ERROR(lastError());
         return false;
     }
 
     setFilePath(filePath);
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -92,17 +466,186 @@ bool DxfDocument::save(const QString& filePath)
     return false;
 }
 
-// ... (Rest of DxfDocument methods similar to others) ...
+Document::DocumentType DxfDocument::type() const
+{
+    return DocumentType::CAD;
+}
+
+int DxfDocument::pageCount() const
+{
+    return d->pages.size();
+}
+
+Page* DxfDocument::page(int index) const
+{
+    if (index >= 0 && index < d->pages.size()) {
+        return d->pages[index].get();
+    }
+    return nullptr;
+}
+
+bool DxfDocument::isLocked() const
+{
+    return false;
+}
+
+bool DxfDocument::isEncrypted() const
+{
+    return false;
+}
+
+QString DxfDocument::formatVersion() const
+{
+    return d->version;
+}
+
+bool DxfDocument::supportsFeature(const QString& feature) const
+{
+    static const QSet<QString> supportedFeatures = {
+        "VectorGraphics", "CADData", "Layers"
+    };
+    return supportedFeatures.contains(feature);
+}
+
+QString DxfDocument::drawingName() const
+{
+    return d->drawingName;
+}
+
+QString DxfDocument::drawingUnits() const
+{
+    return d->units;
+}
+
+QList<QString> DxfDocument::layerNames() const
+{
+    return d->layers;
+}
+
+int DxfDocument::entityCount() const
+{
+    return d->entityCountVal;
+}
+
+bool DxfDocument::is3dDrawing() const
+{
+    return d->is3dVal;
+}
+
+QImage DxfDocument::renderRegion(const QRectF& rect, int width, int height) const
+{
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+    QImage image = ImageBufferPool::instance().acquire(QSize(width, height));
+    if (image.isNull()) return QImage();
+    image.fill(Qt::white);
+
+    // Device pixels per drawing unit, and the region in drawing units;
+    // drawing y grows upwards, page y downwards
+    const qreal pixelsPerPoint = qMin(width / rect.width(), height / rect.height());
+    const qreal scale = pixelsPerPoint * d->unitScale;
+    const qreal left = d->extent.left() + rect.left() / d->unitScale;
+    const qreal top = d->extent.bottom() - rect.top() / d->unitScale;
+    const qreal margin = 1.0 / scale; // Lines are a pixel wide
+    const QRectF area(QPointF(left - margin, top - rect.height() / d->unitScale - margin),
+                      QPointF(left + rect.width() / d->unitScale + margin, top + margin));
+    auto map = [left, top, scale](const QPointF& p) { return QPointF((p.x() - left) * scale, (top - p.y()) * scale); };
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::TextAntialiasing, true);
+    QPen pen(Qt::black, 0); // Cosmetic: one pixel at any zoom
+    painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+
+    const QVector<int> visible = d->index.intersecting(area);
+    int drawn = 0;
+    QPolygonF polygon;
+    for (int id : visible) {
+        const Private::Entity& entity = d->entities[id];
+        const QRectF bounds = d->index.bounds(id);
+        if (entity.type != Private::Point && qMax(bounds.width(), bounds.height()) * scale < d->minEntityPixels) continue;
+
+        if (pen.color().rgb() != entity.color) {
+            pen.setColor(QColor::fromRgb(entity.color));
+            painter.setPen(pen);
+        }
+        ++drawn;
+        switch (entity.type) {
+        case Private::Line:
+            painter.drawLine(map(d->points[entity.firstPoint]), map(d->points[entity.firstPoint + 1]));
+            break;
+        case Private::Polyline: {
+            // Vertices closer than a pixel to the last one kept add nothing
+            polygon.clear();
+            QPointF last = map(d->points[entity.firstPoint]);
+            polygon.append(last);
+            const int end = entity.firstPoint + entity.pointCount;
+            for (int i = entity.firstPoint + 1; i < end; ++i) {
+                const QPointF next = map(d->points[i]);
+                if ((next - last).manhattanLength() >= 1.0 || i == end - 1) {
+                    polygon.append(next);
+                    last = next;
+                }
+            }
+            if (entity.closed) painter.drawPolygon(polygon);
+            else painter.drawPolyline(polygon);
+            break;
+        }
+        case Private::Circle:
+            painter.drawEllipse(map(d->points[entity.firstPoint]), entity.size * scale, entity.size * scale);
+            break;
+        case Private::Arc: {
+            const QPointF center = map(d->points[entity.firstPoint]);
+            const qreal radius = entity.size * scale;
+            qreal span = std::fmod(entity.endAngle - entity.angle + 360.0, 360.0);
+            if (span == 0.0) span = 360.0;
+            painter.drawArc(QRectF(center.x() - radius, center.y() - radius, radius * 2, radius * 2),
+                            qRound(entity.angle * 16), qRound(span * 16));
+            break;
+        }
+        case Private::Text: {
+            const qreal pixelHeight = entity.size * scale;
+            if (pixelHeight < d->textBoxPixels) {
+                // Unreadable at this scale: the box shows where the text is
+                QPolygonF box = d->textBox(entity);
+                for (QPointF& corner : box) corner = map(corner);
+                QColor fill = pen.color();
+                fill.setAlpha(64);
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(fill);
+                painter.drawPolygon(box);
+                painter.setBrush(Qt::NoBrush);
+                painter.setPen(pen);
+                break;
+            }
+            QFont font;
+            font.setPixelSize(qMax(1, qRound(pixelHeight)));
+            painter.save();
+            painter.translate(map(d->points[entity.firstPoint]));
+            painter.rotate(-entity.angle);
+            painter.setFont(font);
+            painter.drawText(QPointF(0, 0), d->texts[entity.text]);
+            painter.restore();
+            break;
+        }
+        case Private::Point:
+            painter.drawPoint(map(d->points[entity.firstPoint]));
+            break;
+        }
+    }
+    painter.end();
+    LOG_DEBUG("DxfDocument: Drew " << drawn << " of " << visible.size() << " entities in " << rect << " at " << QSize(width, height));
+    return image;
+}
 
 void DxfDocument::createPages()
 {
     d->pages.clear();
     d->pages.reserve(d->pageCountVal);
     for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<DxfPage>(this, i)); // Placeholder
-        LOG_DEBUG("DxfDocument: Planned page " << i);
+        d->pages.append(std::make_unique<DxfPage>(this, i, d->pageSize));
     }
     LOG_INFO("DxfDocument: Created " << d->pages.size() << " page objects.");
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -12,7 +12,9 @@
 
 #include "../../core/Document.h"
 #include <memory>
+#include <QImage>
 #include <QList>
+#include <QRectF>
 
 namespace QuantilyxDoc {
 
@@ -21,8 +23,11 @@ class DxfPage; // Forward declaration
 /**
  * @brief DXF (Drawing Exchange Format) document implementation.
  * 
- * Handles loading and parsing of DXF files (2D/3D CAD data).
- * Rendering typically requires a CAD library or conversion to vector graphics.
+ * Handles loading and parsing of ASCII DXF files (2D/3D CAD data). The
+ * model space entities are read into a spatial index, so a render draws
+ * only what lies in the requested region. Entities smaller than a pixel at
+ * the render's scale are skipped and unreadably small text is drawn as its
+ * box, which keeps the cost of a tile bounded by what is visible on it.
  */
 class DxfDocument : public Document
 {
@@ -54,9 +59,14 @@ signals:
     void dxfLoaded();
 
 private:
+    friend class DxfPage; // Draws through the document's entities
+
     class Private;
     std::unique_ptr<Private> d;
 
+    // Draw a region of the drawing; rect is in page points. Safe from any thread.
+    QImage renderRegion(const QRectF& rect, int width, int height) const;
+
     void createPages();
 };
 
@@ -0,0 +1,58 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DxfPage.h"
+#include "DxfDocument.h"
+#include "../../core/Logger.h"
+#include <QImage>
+
+namespace QuantilyxDoc {
+
+class DxfPage::Private {
+public:
+    Private(DxfDocument* doc, int pIndex) : document(doc), pageIndexVal(pIndex) {}
+
+    DxfDocument* document;
+    int pageIndexVal;
+};
+
+DxfPage::DxfPage(DxfDocument* document, int pageIndex, const QSizeF& pageSize, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(document, pageIndex))
+{
+    setSize(pageSize);
+    LOG_DEBUG("DxfPage created for index " << pageIndex << ", " << pageSize << " pt");
+}
+
+DxfPage::~DxfPage()
+{
+    LOG_DEBUG("DxfPage for index " << d->pageIndexVal << " destroyed.");
+}
+
+QImage DxfPage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage DxfPage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    QImage image = d->document->renderRegion(rect, width, height);
+    if (image.isNull()) {
+        LOG_ERROR("Failed to render rectangle " << rect << " of DxfPage " << d->pageIndexVal);
+    }
+    return image;
+}
+
+bool DxfPage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,57 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DXFPAGE_H
+#define QUANTILYX_DXFPAGE_H
+
+#include "../../core/Page.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class DxfDocument;
+
+/**
+ * @brief The model space of a DXF drawing, as one page.
+ *
+ * Renders regions directly: each tile draws only the entities its document's
+ * spatial index finds under it, at a level of detail fitting the scale.
+ */
+class DxfPage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent DxfDocument.
+     * @param pageIndex The 0-based index of this page.
+     * @param pageSize Page size in points.
+     * @param parent Parent object.
+     */
+    DxfPage(DxfDocument* document, int pageIndex, const QSizeF& pageSize, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~DxfPage() override;
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DXFPAGE_H
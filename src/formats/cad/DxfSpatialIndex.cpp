@@ -0,0 +1,189 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DxfSpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Children per node; wide nodes keep the tree shallow for millions of entities
+const int Fanout = 16;
+
+// Closed box: unlike QRectF::intersects, a point or a horizontal line
+// still overlaps what it touches
+struct Box {
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+
+    static Box fromRect(const QRectF& rect) {
+        const QRectF r = rect.normalized();
+        Box box;
+        box.minX = r.left();
+        box.minY = r.top();
+        box.maxX = r.right();
+        box.maxY = r.bottom();
+        return box;
+    }
+
+    bool isValid() const { return minX <= maxX && minY <= maxY; }
+
+    void unite(const Box& other) {
+        minX = std::min(minX, other.minX);
+        minY = std::min(minY, other.minY);
+        maxX = std::max(maxX, other.maxX);
+        maxY = std::max(maxY, other.maxY);
+    }
+
+    bool overlaps(const Box& other) const {
+        return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+
+    double centerX() const { return (minX + maxX) * 0.5; }
+    double centerY() const { return (minY + maxY) * 0.5; }
+
+    QRectF toRect() const {
+        return isValid() ? QRectF(QPointF(minX, minY), QPointF(maxX, maxY)) : QRectF();
+    }
+};
+
+struct Node {
+    Box box;
+    int first; // Into the level below, or into the entity order for leaves
+    int count;
+};
+
+} // namespace
+
+class DxfSpatialIndex::Private {
+public:
+    QVector<Box> entityBoxes;   // By entity
+    QVector<int> order;         // Entities in leaf order
+    QVector<QVector<Node>> levels; // Leaves first; the last level is the root
+
+    // Sort-tile-recursive packing of one level: orders the children so each
+    // run of Fanout becomes a node, and returns those nodes
+    static QVector<Node> pack(const QVector<Box>& boxes, QVector<int>* permutation) {
+        const int count = boxes.size();
+        QVector<int>& perm = *permutation;
+        perm.resize(count);
+        std::iota(perm.begin(), perm.end(), 0);
+
+        const int nodeCount = (count + Fanout - 1) / Fanout;
+        const int slices = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+        const int sliceSize = slices * Fanout;
+        std::sort(perm.begin(), perm.end(), [&boxes](int a, int b) { return boxes[a].centerX() < boxes[b].centerX(); });
+        for (int start = 0; start < count; start += sliceSize) {
+            const int end = std::min(count, start + sliceSize);
+            std::sort(perm.begin() + start, perm.begin() + end,
+                      [&boxes](int a, int b) { return boxes[a].centerY() < boxes[b].centerY(); });
+        }
+
+        QVector<Node> nodes;
+        nodes.reserve(nodeCount);
+        for (int start = 0; start < count; start += Fanout) {
+            Node node{Box(), start, std::min(Fanout, count - start)};
+            for (int i = start; i < start + node.count; ++i) node.box.unite(boxes[perm[i]]);
+            nodes.append(node);
+        }
+        return nodes;
+    }
+};
+
+DxfSpatialIndex::DxfSpatialIndex()
+    : d(new Private())
+{
+}
+
+DxfSpatialIndex::~DxfSpatialIndex() = default;
+
+void DxfSpatialIndex::build(const QVector<QRectF>& bounds)
+{
+    clear();
+    if (bounds.isEmpty()) return;
+
+    d->entityBoxes.reserve(bounds.size());
+    for (const QRectF& rect : bounds) d->entityBoxes.append(Box::fromRect(rect));
+
+    QVector<int> permutation;
+    d->levels.append(Private::pack(d->entityBoxes, &d->order));
+    while (d->levels.last().size() > 1) {
+        QVector<Node>& children = d->levels.last();
+        QVector<Box> childBoxes;
+        childBoxes.reserve(children.size());
+        for (const Node& child : children) childBoxes.append(child.box);
+        QVector<Node> parents = Private::pack(childBoxes, &permutation);
+
+        // Children move so each parent covers a contiguous run of them
+        QVector<Node> reordered;
+        reordered.reserve(children.size());
+        for (int index : permutation) reordered.append(children[index]);
+        children = reordered;
+        d->levels.append(parents);
+    }
+}
+
+void DxfSpatialIndex::clear()
+{
+    d->entityBoxes.clear();
+    d->order.clear();
+    d->levels.clear();
+}
+
+int DxfSpatialIndex::size() const
+{
+    return d->entityBoxes.size();
+}
+
+QRectF DxfSpatialIndex::extent() const
+{
+    return d->levels.isEmpty() ? QRectF() : d->levels.last().first().box.toRect();
+}
+
+QRectF DxfSpatialIndex::bounds(int entity) const
+{
+    if (entity < 0 || entity >= d->entityBoxes.size()) return QRectF();
+    return d->entityBoxes[entity].toRect();
+}
+
+QVector<int> DxfSpatialIndex::intersecting(const QRectF& rect) const
+{
+    QVector<int> result;
+    if (d->levels.isEmpty()) return result;
+    const Box area = Box::fromRect(rect);
+
+    // Depth-first from the root; a pair is (level, node)
+    QVector<QPair<int, int>> stack;
+    stack.append(qMakePair(d->levels.size() - 1, 0));
+    while (!stack.isEmpty()) {
+        const QPair<int, int> top = stack.takeLast();
+        const Node& node = d->levels[top.first][top.second];
+        if (!node.box.overlaps(area)) continue;
+        if (top.first == 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                const int entity = d->order[i];
+                if (d->entityBoxes[entity].overlaps(area)) result.append(entity);
+            }
+        } else {
+            for (int i = node.first; i < node.first + node.count; ++i) stack.append(qMakePair(top.first - 1, i));
+        }
+    }
+
+    // Later entities are drawn over earlier ones
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+} // namespace QuantilyxDoc
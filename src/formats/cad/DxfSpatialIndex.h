@@ -0,0 +1,85 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DXFSPATIALINDEX_H
+#define QUANTILYX_DXFSPATIALINDEX_H
+
+#include <QRectF>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Static R-tree over the entity bounds of a drawing.
+ *
+ * Built once by sort-tile-recursive packing, which fills every node and
+ * keeps neighbouring entities in the same subtree, so a query for a
+ * viewport tile visits only the nodes that overlap it. Entities are the
+ * indices of the bounds passed to build(). The index is immutable after
+ * build(), so queries are safe from any number of threads.
+ */
+class DxfSpatialIndex
+{
+public:
+    /**
+     * @brief Constructor. The index starts empty.
+     */
+    DxfSpatialIndex();
+
+    /**
+     * @brief Destructor.
+     */
+    ~DxfSpatialIndex();
+
+    /**
+     * @brief Replace the contents with these entities.
+     * @param bounds Bounds of each entity, in drawing coordinates.
+     */
+    void build(const QVector<QRectF>& bounds);
+
+    /**
+     * @brief Remove every entity.
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of indexed entities.
+     * @return Entity count.
+     */
+    int size() const;
+
+    /**
+     * @brief Get the bounds of all entities together.
+     * @return Union of the bounds, or a null rect when empty.
+     */
+    QRectF extent() const;
+
+    /**
+     * @brief Get the bounds an entity was indexed with.
+     * @param entity Entity index.
+     * @return Its bounds.
+     */
+    QRectF bounds(int entity) const;
+
+    /**
+     * @brief Find the entities touching a rectangle.
+     * @param rect Rectangle in drawing coordinates.
+     * @return Matching entities in ascending order, which is drawing order.
+     */
+    QVector<int> intersecting(const QRectF& rect) const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DXFSPATIALINDEX_H
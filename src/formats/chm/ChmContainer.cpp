@@ -0,0 +1,374 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ChmContainer.h"
+#include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QTextCodec>
+#include <QUrl>
+#include <QVector>
+#include <limits>
+
+#ifdef HAVE_CHMLIB
+#include <chm_lib.h>
+#else
+struct chmFile;
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// chmlib keeps this many decompressed LZX reset blocks; each is up to 32 KB
+const int MaxLzxBlocksCached = 8;
+
+// #SYSTEM entry codes
+const quint16 SystemContentsFile = 0;
+const quint16 SystemDefaultTopic = 2;
+const quint16 SystemTitle = 3;
+const quint16 SystemLocale = 4;
+
+quint16 readU16(const uchar* p) { return quint16(p[0] | (p[1] << 8)); }
+quint32 readU32(const uchar* p) { return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24); }
+
+// The ANSI code page Windows uses for a locale, which CHM text is written in
+QByteArray codecForLcid(quint32 lcid)
+{
+    switch (lcid & 0x3FF) {
+    case 0x02: case 0x19: case 0x22: case 0x23: return "windows-1251";
+    case 0x05: case 0x0E: case 0x15: case 0x18: case 0x1A: case 0x1B: case 0x24: return "windows-1250";
+    case 0x08: return "windows-1253";
+    case 0x1F: return "windows-1254";
+    case 0x0D: return "windows-1255";
+    case 0x01: return "windows-1256";
+    case 0x25: case 0x26: case 0x27: return "windows-1257";
+    case 0x2A: return "windows-1258";
+    case 0x1E: return "windows-874";
+    case 0x11: return "Shift_JIS";
+    case 0x12: return "EUC-KR";
+    case 0x04: return (lcid == 0x0804 || lcid == 0x1004) ? "GBK" : "Big5";
+    default: return "windows-1252";
+    }
+}
+
+} // namespace
+
+class ChmContainer::Private {
+public:
+    Private() : handle(nullptr), useClock(0), memoryConsumerId(0) {}
+
+    // Where a file is, as the directory gave it
+    struct Entry {
+        QString path;
+        quint64 start = 0;
+        quint64 length = 0;
+        int space = 0;
+    };
+
+    struct CachedObject {
+        QByteArray data;
+        quint64 lastUse = 0;
+    };
+
+    chmFile* handle;
+    mutable QMutex handleMutex; // chmlib is not reentrant
+    QVector<Entry> entries;     // Directory order
+    QHash<QString, int> index;  // Lower-case path -> entry
+    QString title;
+    QString defaultTopic;
+    QString contentsFile;
+    QByteArray codecName;
+
+    mutable QMutex cacheMutex; // Protects cache and useClock
+    mutable QHash<int, CachedObject> cache;
+    mutable quint64 useClock;
+    int memoryConsumerId;
+
+    static qint64 cacheLimit() {
+        return qint64(qMax(1, Settings::instance().value<int>("Advanced/ChmObjectCacheMB", 16))) * 1024 * 1024;
+    }
+
+#ifdef HAVE_CHMLIB
+    static int collect(chmFile* file, chmUnitInfo* info, void* context) {
+        Q_UNUSED(file);
+        Private* priv = static_cast<Private*>(context);
+        const QString path = QString::fromUtf8(info->path);
+        if (path.isEmpty() || path.endsWith(QLatin1Char('/'))) return CHM_ENUMERATOR_CONTINUE;
+        Entry entry;
+        entry.path = path;
+        entry.start = info->start;
+        entry.length = info->length;
+        entry.space = info->space;
+        priv->index.insert(path.toLower(), priv->entries.size());
+        priv->entries.append(entry);
+        return CHM_ENUMERATOR_CONTINUE;
+    }
+#endif
+
+    // Caller holds handleMutex
+    QByteArray retrieve(quint64 start, quint64 length, int space) const {
+#ifdef HAVE_CHMLIB
+        if (!handle || length > quint64(std::numeric_limits<int>::max())) return QByteArray();
+        chmUnitInfo info = {};
+        info.start = start;
+        info.length = length;
+        info.space = space;
+        QByteArray data(int(length), Qt::Uninitialized);
+        const LONGINT64 got = chm_retrieve_object(handle, &info, reinterpret_cast<unsigned char*>(data.data()), 0, LONGINT64(length));
+        if (got != LONGINT64(length)) return QByteArray();
+        return data;
+#else
+        Q_UNUSED(start);
+        Q_UNUSED(length);
+        Q_UNUSED(space);
+        return QByteArray();
+#endif
+    }
+
+    // Special files are not in the walk, so they are looked up by name
+    QByteArray readSpecial(const char* path) const {
+#ifdef HAVE_CHMLIB
+        QMutexLocker locker(&handleMutex);
+        chmUnitInfo info;
+        if (!handle || chm_resolve_object(handle, path, &info) != CHM_RESOLVE_SUCCESS) return QByteArray();
+        return retrieve(info.start, info.length, info.space);
+#else
+        Q_UNUSED(path);
+        return QByteArray();
+#endif
+    }
+
+    void parseSystem() {
+        const QByteArray system = readSpecial("/#SYSTEM");
+        const uchar* data = reinterpret_cast<const uchar*>(system.constData());
+        codecName = "windows-1252";
+        QByteArray rawTitle;
+        for (int pos = 4; pos + 4 <= system.size();) {
+            const quint16 code = readU16(data + pos);
+            const quint16 length = readU16(data + pos + 2);
+            pos += 4;
+            if (pos + length > system.size()) break;
+            const QByteArray value = system.mid(pos, length);
+            const QByteArray text = value.left(value.indexOf('\0') >= 0 ? value.indexOf('\0') : value.size());
+            switch (code) {
+            case SystemContentsFile: contentsFile = ChmContainer::resolve(QStringLiteral("/"), QString::fromLatin1(text)); break;
+            case SystemDefaultTopic: defaultTopic = ChmContainer::resolve(QStringLiteral("/"), QString::fromLatin1(text)); break;
+            case SystemTitle: rawTitle = text; break;
+            case SystemLocale:
+                if (length >= 4) codecName = codecForLcid(readU32(data + pos));
+                break;
+            default: break;
+            }
+            pos += length;
+        }
+        // The locale may follow the title, so it is decoded last
+        QTextCodec* codec = QTextCodec::codecForName(codecName);
+        title = codec ? codec->toUnicode(rawTitle) : QString::fromLatin1(rawTitle);
+    }
+
+    qint64 cachedBytes() const {
+        QMutexLocker locker(&cacheMutex);
+        qint64 total = 0;
+        for (const CachedObject& object : cache) total += object.data.size();
+        return total;
+    }
+
+    // Least recently used files go first, until the cache fits maxBytes
+    // and bytes have been freed. Caller holds cacheMutex.
+    qint64 trim(qint64 maxBytes, qint64 bytes) const {
+        qint64 total = 0;
+        for (const CachedObject& object : cache) total += object.data.size();
+        qint64 freed = 0;
+        while (!cache.isEmpty() && (total > maxBytes || freed < bytes)) {
+            auto oldest = cache.begin();
+            for (auto it = cache.begin(); it != cache.end(); ++it) {
+                if (it->lastUse < oldest->lastUse) oldest = it;
+            }
+            total -= oldest->data.size();
+            freed += oldest->data.size();
+            cache.erase(oldest);
+        }
+        return freed;
+    }
+};
+
+ChmContainer::ChmContainer()
+    : d(new Private())
+{
+    // Files are decompressed again from the archive, so they go early
+    Private* priv = d.get();
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "CHM decompressed files", MemoryBudget::Priority::Low,
+        [priv]() { return priv->cachedBytes(); },
+        [priv](qint64 bytes) {
+            QMutexLocker locker(&priv->cacheMutex);
+            return priv->trim(0, bytes);
+        });
+}
+
+ChmContainer::~ChmContainer()
+{
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+    close();
+}
+
+bool ChmContainer::open(const QString& filePath, QString* error)
+{
+    close();
+#ifndef HAVE_CHMLIB
+    LOG_ERROR("ChmContainer: Built without chmlib; cannot open " << filePath);
+    if (error) *error = QCoreApplication::translate("ChmContainer", "CHM support is not available in this build.");
+    return false;
+#else
+    QMutexLocker locker(&d->handleMutex);
+    d->handle = chm_open(QFile::encodeName(filePath).constData());
+    if (!d->handle) {
+        if (error) *error = QCoreApplication::translate("ChmContainer", "Failed to open CHM file.");
+        return false;
+    }
+    chm_set_param(d->handle, CHM_PARAM_MAX_BLOCKS_CACHED, MaxLzxBlocksCached);
+
+    // The one walk of the directory; reads use the locations it records
+    if (chm_enumerate(d->handle, CHM_ENUMERATE_NORMAL | CHM_ENUMERATE_FILES, &Private::collect, d.get()) == CHM_ENUMERATOR_FAILURE) {
+        chm_close(d->handle);
+        d->handle = nullptr;
+        d->entries.clear();
+        d->index.clear();
+        if (error) *error = QCoreApplication::translate("ChmContainer", "CHM directory is damaged.");
+        return false;
+    }
+    locker.unlock();
+
+    d->parseSystem();
+    LOG_DEBUG("ChmContainer: Indexed " << d->entries.size() << " files in " << filePath);
+    return true;
+#endif
+}
+
+void ChmContainer::close()
+{
+    {
+        QMutexLocker locker(&d->handleMutex);
+#ifdef HAVE_CHMLIB
+        if (d->handle) chm_close(d->handle);
+#endif
+        d->handle = nullptr;
+        d->entries.clear();
+        d->index.clear();
+    }
+    QMutexLocker locker(&d->cacheMutex);
+    d->cache.clear();
+    d->title.clear();
+    d->defaultTopic.clear();
+    d->contentsFile.clear();
+}
+
+QStringList ChmContainer::entryNames() const
+{
+    QStringList names;
+    names.reserve(d->entries.size());
+    for (const Private::Entry& entry : d->entries) names.append(entry.path);
+    return names;
+}
+
+bool ChmContainer::contains(const QString& path) const
+{
+    return d->index.contains(path.toLower());
+}
+
+qint64 ChmContainer::size(const QString& path) const
+{
+    const auto it = d->index.constFind(path.toLower());
+    return it == d->index.constEnd() ? -1 : qint64(d->entries[*it].length);
+}
+
+QByteArray ChmContainer::read(const QString& path) const
+{
+    const auto it = d->index.constFind(path.toLower());
+    if (it == d->index.constEnd()) return QByteArray();
+    const int entry = *it;
+    {
+        QMutexLocker locker(&d->cacheMutex);
+        auto cached = d->cache.find(entry);
+        if (cached != d->cache.end()) {
+            cached->lastUse = ++d->useClock;
+            return cached->data;
+        }
+    }
+
+    QByteArray data;
+    {
+        QMutexLocker locker(&d->handleMutex);
+        const Private::Entry& location = d->entries[entry];
+        data = d->retrieve(location.start, location.length, location.space);
+    }
+    if (data.isEmpty()) {
+        if (d->entries[entry].length > 0) LOG_WARN("ChmContainer: Failed to decompress " << path);
+        return data;
+    }
+
+    QMutexLocker locker(&d->cacheMutex);
+    auto cached = d->cache.find(entry);
+    if (cached == d->cache.end()) cached = d->cache.insert(entry, Private::CachedObject{data, 0});
+    cached->lastUse = ++d->useClock;
+    const QByteArray result = cached->data;
+    d->trim(Private::cacheLimit(), 0);
+    return result;
+}
+
+QString ChmContainer::title() const
+{
+    return d->title;
+}
+
+QString ChmContainer::defaultTopic() const
+{
+    return d->defaultTopic;
+}
+
+QString ChmContainer::contentsFile() const
+{
+    return d->contentsFile;
+}
+
+QByteArray ChmContainer::codecName() const
+{
+    return d->codecName;
+}
+
+QString ChmContainer::resolve(const QString& base, const QString& link)
+{
+    QString target = link.trimmed();
+    const int archiveSeparator = target.indexOf(QLatin1String("::")); // ms-its:book.chm::/page.htm
+    if (archiveSeparator >= 0) target = target.mid(archiveSeparator + 2);
+    const int cut = target.indexOf(QRegularExpression(QStringLiteral("[#?]")));
+    if (cut >= 0) target.truncate(cut);
+    target = QUrl::fromPercentEncoding(target.toUtf8()).replace(QLatin1Char('\\'), QLatin1Char('/'));
+
+    if (!target.startsWith(QLatin1Char('/'))) target = base.left(base.lastIndexOf(QLatin1Char('/')) + 1) + target;
+    QStringList segments;
+    for (const QString& segment : target.split(QLatin1Char('/'), Qt::SkipEmptyParts)) {
+        if (segment == QLatin1String(".")) continue;
+        if (segment == QLatin1String("..")) {
+            if (!segments.isEmpty()) segments.removeLast();
+            continue;
+        }
+        segments.append(segment);
+    }
+    return QLatin1Char('/') + segments.join(QLatin1Char('/'));
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,98 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_CHMCONTAINER_H
+#define QUANTILYX_CHMCONTAINER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Indexed access to a CHM (ITSS) archive through chmlib.
+ *
+ * open() walks the directory once and keeps every file entry's location,
+ * so later reads never search the directory chunks again. Files are
+ * decompressed from their LZX section only when read, into an LRU bounded
+ * by Advanced/ChmObjectCacheMB that MemoryBudget can also trim; chmlib's
+ * own cache of LZX reset blocks is capped too. Nothing is unpacked to disk.
+ *
+ * chmlib is not reentrant, so reads are serialized; cache hits are not.
+ */
+class ChmContainer
+{
+public:
+    ChmContainer();
+    ~ChmContainer();
+
+    /**
+     * @brief Open an archive and index its directory.
+     * @param filePath CHM file.
+     * @param error Receives a description on failure; may be null.
+     * @return True on success.
+     */
+    bool open(const QString& filePath, QString* error = nullptr);
+
+    /**
+     * @brief Close the archive and drop the cache.
+     */
+    void close();
+
+    /**
+     * @brief Get the paths of all files, in directory order.
+     * @return Paths, each starting with '/'.
+     */
+    QStringList entryNames() const;
+
+    /**
+     * @brief Check whether a file exists.
+     * @param path Path in the archive; matched case-insensitively.
+     * @return True if present.
+     */
+    bool contains(const QString& path) const;
+
+    /**
+     * @brief Get a file's uncompressed size, without reading it.
+     * @param path Path in the archive.
+     * @return Size, or -1 if missing.
+     */
+    qint64 size(const QString& path) const;
+
+    /**
+     * @brief Read a file, decompressing it on first use. Safe from any thread.
+     * @param path Path in the archive; matched case-insensitively.
+     * @return Contents, or empty if missing or unreadable.
+     */
+    QByteArray read(const QString& path) const;
+
+    // --- From the #SYSTEM file ---
+    QString title() const;
+    QString defaultTopic() const;  ///< Path of the start page
+    QString contentsFile() const;  ///< Path of the .hhc table of contents
+    QByteArray codecName() const;  ///< Text encoding from the LCID
+
+    /**
+     * @brief Resolve a link relative to a file in the archive.
+     * @param base Path of the linking file.
+     * @param link Relative or absolute link; query and fragment are dropped.
+     * @return Normalized absolute path.
+     */
+    static QString resolve(const QString& base, const QString& link);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_CHMCONTAINER_H
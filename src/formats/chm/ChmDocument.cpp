@@ -1,49 +1,97 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
  */
 #include "ChmDocument.h"
+#include "ChmContainer.h"
 #include "ChmPage.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
-#include <QFile>
-#include <QFileInfo>
-#include <QDir>
+#include "../../core/MemoryBudget.h"
+#include "../../core/ReflowablePage.h"
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegularExpression>
-#include <QTextStream>
-#include <QDebug>
-// #include <chm_lib.h> // Hypothetical chmlib header
+#include <QSet>
+#include <QTextCodec>
+#include <QVector>
 
 namespace QuantilyxDoc {
 
 class ChmDocument::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(0) {}
+    Private() : isLoaded(false), pageCountVal(0), memoryConsumerId(0) {}
     ~Private() = default;
 
+    struct Topic {
+        QString path;
+        QString title;
+    };
+
     bool isLoaded;
     int pageCountVal;
     QString title;
     QString defaultTopic;
     QMap<QString, QString> fileList; // URL -> Description
+    QVector<Topic> topics;
+    ChmContainer container;
     QList<std::unique_ptr<ChmPage>> pages;
-    // struct chmFile* chmHandle; // Hypothetical chmlib handle
-
-    // Helper to load and parse the CHM using chmlib
-    bool loadAndParseChm(const QString& filePath) {
-        // This is a complex integration requiring chmlib
-        // int result = chm_open(CHM_FILE_PATH, &chmHandle);
-        // if (result != CHM_OPEN_SUCCESS) {
-        //     LOG_ERROR("ChmDocument: chmlib open failed.");
-        //     return false;
-        // }
-        // Then enumerate files, parse .hhc/.hhp for TOC, etc.
-        LOG_ERROR("ChmDocument::loadAndParseChm: Requires chmlib integration, not implemented.");
-        return false; // Placeholder for now
+    mutable QMutex pagesMutex; // Guards pages against the memory consumer
+    int memoryConsumerId;
+
+    static bool isTopic(const QString& path) {
+        return path.endsWith(QLatin1String(".htm"), Qt::CaseInsensitive) || path.endsWith(QLatin1String(".html"), Qt::CaseInsensitive);
+    }
+
+    QString decode(const QByteArray& data) const {
+        QTextCodec* fallback = QTextCodec::codecForName(container.codecName());
+        QTextCodec* codec = QTextCodec::codecForHtml(data, fallback ? fallback : QTextCodec::codecForName("windows-1252"));
+        return codec->toUnicode(data);
+    }
+
+    // Topics in table of contents order. The .hhc is a sitemap of
+    // <object type="text/sitemap"> entries with Name and Local params.
+    void collectTopics() {
+        static const QRegularExpression objectPattern(QStringLiteral("<object[^>]*text/sitemap[^>]*>(.*?)</object>"),
+                                                      QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+        static const QRegularExpression paramPattern(QStringLiteral("<param\\s+name\\s*=\\s*\"([^\"]*)\"\\s+value\\s*=\\s*\"([^\"]*)\""),
+                                                     QRegularExpression::CaseInsensitiveOption);
+        QSet<QString> seen;
+        auto add = [&](const QString& path, const QString& topicTitle) {
+            if (path.isEmpty() || !isTopic(path) || !container.contains(path) || seen.contains(path.toLower())) return;
+            seen.insert(path.toLower());
+            topics.append(Topic{path, topicTitle});
+            fileList.insert(path, topicTitle);
+        };
+
+        const QString contents = container.contentsFile();
+        if (!contents.isEmpty()) {
+            const QString sitemap = decode(container.read(contents));
+            for (auto object = objectPattern.globalMatch(sitemap); object.hasNext();) {
+                const QString body = object.next().captured(1);
+                QString name;
+                QString local;
+                for (auto param = paramPattern.globalMatch(body); param.hasNext();) {
+                    const QRegularExpressionMatch match = param.next();
+                    if (match.captured(1).compare(QLatin1String("Name"), Qt::CaseInsensitive) == 0) name = match.captured(2);
+                    else if (match.captured(1).compare(QLatin1String("Local"), Qt::CaseInsensitive) == 0) local = match.captured(2);
+                }
+                if (!local.isEmpty()) add(ChmContainer::resolve(contents, local), name);
+            }
+        }
+
+        // Without a usable table of contents, every topic in directory order
+        if (topics.isEmpty()) {
+            add(defaultTopic, title);
+            for (const QString& path : container.entryNames()) {
+                if (!path.startsWith(QLatin1String("/#")) && !path.startsWith(QLatin1String("/$"))) add(path, QString());
+            }
+        }
     }
 };
 
@@ -51,11 +99,13 @@ ChmDocument::ChmDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
-    LOG_INFO("ChmDocument created. Note: CHM support requires chmlib.");
+    d->memoryConsumerId = ReflowablePage::registerLayoutConsumer("CHM page layouts", this, &d->pagesMutex, &d->pages);
+    LOG_INFO("ChmDocument created.");
 }
 
 ChmDocument::~ChmDocument()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     LOG_INFO("ChmDocument destroyed.");
 }
 
@@ -63,22 +113,44 @@ bool ChmDocument::load(const QString& filePath, const QString& password)
 {
     Q_UNUSED(password);
     d->isLoaded = false;
-    d->pages.clear();
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+    }
+    d->topics.clear();
+    d->fileList.clear();
+    d->pageCountVal = 0;
+
+    LoadTrace trace(filePath, QStringLiteral("CHM"));
 
-    // Load and parse using chmlib
-    if (!d->loadAndParseChm(filePath)) {
-        setLastError("CHM loading requires chmlib, which is not available.");
-        LOG_ERROR(lastError());
+    // The directory is indexed once; topics are decompressed when shown
+    trace.phase(LoadTrace::Parse);
+    QString error;
+    if (!d->container.open(filePath, &error)) {
+        setLastError(error);
+        LOG_ERROR("ChmDocument: " << error << " " << filePath);
+        return false;
+    }
+    d->title = d->container.title();
+    d->defaultTopic = d->container.defaultTopic();
+    trace.phase(LoadTrace::Toc);
+    d->collectTopics();
+    if (d->topics.isEmpty()) {
+        setLastError(tr("The CHM file contains no HTML topics."));
+        LOG_ERROR(lastError() << " " << filePath);
+        d->container.close();
         return false;
     }
 
     setFilePath(filePath);
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
     emit chmLoaded();
-    LOG_INFO("Successfully loaded CHM document: " << filePath);
+    LOG_INFO("Successfully loaded CHM document: " << filePath << " (" << d->pageCountVal << " topics)");
     return true;
 }
 
@@ -90,18 +162,86 @@ bool ChmDocument::save(const QString& filePath)
     return false;
 }
 
-// ... (Rest of ChmDocument methods similar to others, returning placeholders or parsed data) ...
+Document::DocumentType ChmDocument::type() const
+{
+    return DocumentType::CHM;
+}
+
+int ChmDocument::pageCount() const
+{
+    return d->pageCountVal;
+}
+
+Page* ChmDocument::page(int index) const
+{
+    if (index >= 0 && index < d->pages.size()) {
+        return d->pages.at(index).get();
+    }
+    return nullptr;
+}
+
+bool ChmDocument::isLocked() const
+{
+    return false;
+}
+
+bool ChmDocument::isEncrypted() const
+{
+    return false;
+}
+
+QString ChmDocument::formatVersion() const
+{
+    return "ITSF 3";
+}
+
+bool ChmDocument::supportsFeature(const QString& feature) const
+{
+    static const QSet<QString> supportedFeatures = {
+        "Text", "Images", "Hyperlinks"
+    };
+    return supportedFeatures.contains(feature);
+}
+
+QString ChmDocument::helpTitle() const
+{
+    return d->title;
+}
+
+QString ChmDocument::helpDefaultTopic() const
+{
+    return d->defaultTopic;
+}
+
+QMap<QString, QString> ChmDocument::helpFileList() const
+{
+    return d->fileList;
+}
+
+QString ChmDocument::getHelpFileContent(const QString& urlPath) const
+{
+    const QByteArray data = d->container.read(ChmContainer::resolve(QStringLiteral("/"), urlPath));
+    return data.isEmpty() ? QString() : d->decode(data);
+}
+
+QByteArray ChmDocument::helpFileData(const QString& path) const
+{
+    return d->container.read(path);
+}
 
 void ChmDocument::createPages()
 {
-    // Create one page per HTML file in the CHM
-    d->pages.clear();
-    d->pages.reserve(d->pageCountVal);
-    for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<ChmPage>(this, i)); // Placeholder
-        LOG_DEBUG("ChmDocument: Planned page " << i);
+    // One page per topic in the table of contents
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+        d->pages.reserve(d->topics.size());
+        for (int i = 0; i < d->topics.size(); ++i) {
+            d->pages.append(std::make_unique<ChmPage>(this, i, d->topics[i].path, d->topics[i].title));
+        }
     }
+    d->pageCountVal = d->pages.size();
     LOG_INFO("ChmDocument: Created " << d->pages.size() << " page objects.");
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -22,7 +22,9 @@ class ChmPage; // Forward declaration
 /**
  * @brief CHM (Compiled HTML Help) document implementation.
  * 
- * Handles loading and parsing of CHM files using a library like chmlib.
+ * Handles loading and parsing of CHM files using chmlib, through a
+ * ChmContainer that indexes the archive's directory at load. Each topic
+ * of the table of contents is one page, decompressed when first shown.
  */
 class ChmDocument : public Document
 {
@@ -49,6 +51,13 @@ public:
     QMap<QString, QString> helpFileList() const; // URL -> Description
     QString getHelpFileContent(const QString& urlPath) const;
 
+    /**
+     * @brief Get the raw bytes of a file in the archive. Safe from any thread.
+     * @param path Absolute path in the archive.
+     * @return Contents, or empty if missing.
+     */
+    QByteArray helpFileData(const QString& path) const;
+
 signals:
     void chmLoaded();
 
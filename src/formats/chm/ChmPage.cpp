@@ -0,0 +1,101 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ChmPage.h"
+#include "ChmContainer.h"
+#include "ChmDocument.h"
+#include "../../core/Logger.h"
+#include <QUrl>
+#include <QVariantMap>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Help topics are laid out for a window; a Letter-width sheet holds them
+const qreal PageWidth = 612.0;
+const qreal PageHeight = 792.0;
+const qreal Margin = 36.0;
+const qreal TextWidth = PageWidth - 2 * Margin;
+
+// Resolves images and style sheets from the archive as the layout needs
+// them, relative to the topic; images are decoded no wider than the text
+class ChmTextDocument : public LayoutDocument
+{
+public:
+    ChmTextDocument(const ChmDocument* document, const QString& topicPath)
+        : LayoutDocument(TextWidth), book(document), topic(topicPath) {}
+
+protected:
+    QVariant loadResource(int type, const QUrl& name) override {
+        if (!book || (type != QTextDocument::ImageResource && type != QTextDocument::StyleSheetResource)
+            || (!name.scheme().isEmpty() && name.scheme() != QLatin1String("ms-its") && name.scheme() != QLatin1String("mk"))) {
+            return QTextDocument::loadResource(type, name);
+        }
+        const QByteArray data = book->helpFileData(ChmContainer::resolve(topic, name.toString()));
+        if (data.isEmpty()) return QVariant();
+        if (type == QTextDocument::StyleSheetResource) return QString::fromUtf8(data);
+        return decodeImage(data, name.toString());
+    }
+
+private:
+    const ChmDocument* book;
+    QString topic;
+};
+
+} // namespace
+
+class ChmPage::Private {
+public:
+    Private(ChmDocument* doc, int pIndex, const QString& topicPath, const QString& pageTitle)
+        : document(doc), pageIndexVal(pIndex), path(topicPath), title(pageTitle) {}
+
+    ChmDocument* document;
+    int pageIndexVal;
+    QString path;
+    QString title;
+};
+
+ChmPage::ChmPage(ChmDocument* document, int pageIndex, const QString& path, const QString& title, QObject* parent)
+    : ReflowablePage(document, QSizeF(PageWidth, PageHeight), Margin, parent)
+    , d(new Private(document, pageIndex, path, title))
+{
+    if (!title.isEmpty()) setTitle(title);
+    LOG_DEBUG("ChmPage created for index " << pageIndex);
+}
+
+ChmPage::~ChmPage()
+{
+    LOG_DEBUG("ChmPage for index " << d->pageIndexVal << " destroyed.");
+}
+
+QVariantMap ChmPage::metadata() const
+{
+    QVariantMap map;
+    map["PageIndex"] = d->pageIndexVal;
+    map["Title"] = d->title;
+    map["Path"] = d->path;
+    return map;
+}
+
+QString ChmPage::path() const
+{
+    return d->path;
+}
+
+std::unique_ptr<LayoutDocument> ChmPage::createLayout() const
+{
+    if (!d->document) return nullptr;
+    std::unique_ptr<LayoutDocument> layout(new ChmTextDocument(d->document, d->path));
+    layout->setDocumentMargin(0);
+    layout->setHtml(d->document->getHelpFileContent(d->path)); // Decompresses the topic
+    return layout;
+}
+
+} // namespace QuantilyxDoc
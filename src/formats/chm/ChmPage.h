@@ -0,0 +1,66 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_CHMPAGE_H
+#define QUANTILYX_CHMPAGE_H
+
+#include "../../core/ReflowablePage.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class ChmDocument;
+
+/**
+ * @brief One topic of a CHM help file, as a continuous page.
+ *
+ * Nothing is decompressed until the page is first rendered; the topic's
+ * HTML, and the images and style sheets it links, are then read from the
+ * document's container and laid out.
+ */
+class ChmPage : public ReflowablePage
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent ChmDocument.
+     * @param pageIndex The 0-based index of this page.
+     * @param path The topic's path in the archive.
+     * @param title The topic's title from the table of contents, if any.
+     * @param parent Parent object.
+     */
+    ChmPage(ChmDocument* document, int pageIndex, const QString& path, const QString& title, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~ChmPage() override;
+
+    // --- Page Interface Implementation ---
+    QVariantMap metadata() const override;
+
+    /**
+     * @brief Get the topic's path in the archive.
+     * @return Path.
+     */
+    QString path() const;
+
+protected:
+    std::unique_ptr<LayoutDocument> createLayout() const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_CHMPAGE_H
@@ -9,6 +9,9 @@
  */
 #include "CbrDocument.h"
 #include "ComicPage.h" // Assuming this handles image-based pages
+#include "ComicReadAhead.h"
+#include "../../core/ArchiveReader.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
 #include <QFile>
 #include <QFileInfo>
@@ -16,60 +19,43 @@
 #include <QRegularExpression>
 #include <QTextStream>
 #include <QDebug>
-// Include headers for your RAR library (e.g., unrar's rar.hpp or a C wrapper)
-// #include "unrar.h" // Hypothetical
-// #include <rar.hpp> // Hypothetical C++ interface
 
 namespace QuantilyxDoc {
 
-// For demonstration, let's assume a C++ wrapper or a C interface is available.
-// This is a complex area due to RAR's proprietary nature.
-// Common approaches:
-// 1. Use unRAR library (based on unRAR source code, available under GNU GPL).
-// 2. Call the 'unrar' command-line tool using QProcess.
-// We'll outline the structure assuming a C++ wrapper exists (like libunarr or a custom wrapper around unRAR).
-
-// Example using a hypothetical C++ wrapper (like one might create around unRAR's C++ API)
-// #include "UnrarWrapper.h" // Hypothetical
-
 class CbrDocument::Private {
 public:
-    Private() : isLoaded(false) /*, rarArchive(nullptr)*/ {}
-    ~Private() {
-        // if (rarArchive) { /* Close rarArchive */ }
-    }
+    Private() : isLoaded(false), needsPassword(false) {}
 
-    // UnrarWrapper::Archive* rarArchive; // Hypothetical C++ wrapper object
+    ArchiveReader archive; // Entry index plus readers left where the last read stopped
     bool isLoaded;
+    bool needsPassword; // Encrypted entries and no password given
     QStringList imagePathsList;
     QStringList otherFilesList;
     QString comicInfoContent;
     QList<std::unique_ptr<ComicPage>> pages; // Own the page objects
+    std::unique_ptr<ComicReadAhead> readAhead; // Declared after pages: destroyed, and waited for, first
 
-    // Helper to read a file from the RAR archive using the hypothetical wrapper
+    // Helper to read a file from the RAR archive; safe from any thread
     QByteArray readFileFromRar(const QString& filePath) const {
-        // return rarArchive->readFile(filePath);
-        Q_UNUSED(filePath);
-        LOG_WARN("CbrDocument::readFileFromRar: Requires RAR library integration.");
-        return QByteArray(); // Placeholder
+        if (!archive.isOpen()) return QByteArray();
+        return archive.read(filePath);
     }
 
-    // Helper to list all files in the archive and categorize them using the hypothetical wrapper
+    // Helper to list all files in the archive and categorize them
     void listAndCategorizeFiles() {
-        // auto fileList = rarArchive->getFileList();
-        // QRegularExpression imageRegex(R"(\.(jpg|jpeg|png|gif|webp|bmp|tiff|tif)$)", QRegularExpression::CaseInsensitiveOption);
-        // for (const auto& file : fileList) {
-        //     if (imageRegex.match(file.name).hasMatch()) {
-        //         imagePathsList.append(file.name);
-        //     } else {
-        //         otherFilesList.append(file.name);
-        //     }
-        // }
-        // std::sort(imagePathsList.begin(), imagePathsList.end());
-        LOG_WARN("CbrDocument::listAndCategorizeFiles: Requires RAR library integration.");
-        // Placeholder: Assume some files exist
-        imagePathsList = QStringList() << "page001.jpg" << "page002.jpg"; // Placeholder
-        otherFilesList = QStringList() << "ComicInfo.xml"; // Placeholder
+        if (!archive.isOpen()) return;
+
+        QRegularExpression imageRegex(R"(\.(jpg|jpeg|png|gif|webp|bmp|tiff|tif)$)", QRegularExpression::CaseInsensitiveOption);
+        for (const QString& fileName : archive.entryNames()) {
+            if (imageRegex.match(fileName).hasMatch()) {
+                imagePathsList.append(fileName);
+            } else {
+                otherFilesList.append(fileName);
+            }
+        }
+        // Sort image paths to ensure correct page order (often relies on filename sorting)
+        std::sort(imagePathsList.begin(), imagePathsList.end());
+        LOG_DEBUG("CbrDocument: Found " << imagePathsList.size() << " image files and " << otherFilesList.size() << " other files.");
     }
 };
 
@@ -77,7 +63,8 @@ CbrDocument::CbrDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
-    LOG_INFO("CbrDocument created. Note: RAR support requires unRAR library.");
+    d->readAhead = std::make_unique<ComicReadAhead>(this);
+    LOG_INFO("CbrDocument created.");
 }
 
 CbrDocument::~CbrDocument()
@@ -87,71 +74,51 @@ CbrDocument::~CbrDocument()
 
 bool CbrDocument::load(const QString& filePath, const QString& password)
 {
-    // Close any previously loaded archive
-    // if (d->rarArchive) { /* Close d->rarArchive */ }
+    // Close any previously loaded archive, once decodes reading it are done
+    d->readAhead->cancel();
+    d->archive.close();
     d->isLoaded = false;
+    d->needsPassword = false;
     d->pages.clear();
     d->imagePathsList.clear();
     d->otherFilesList.clear();
+    d->comicInfoContent.clear();
 
-    // --- IMPORTANT: RAR LIBRARY INTEGRATION NEEDED HERE ---
-    // This is the complex part. You need to use a library like unRAR.
-    // Example with a hypothetical C++ wrapper:
-    // d->rarArchive = std::make_unique<UnrarWrapper::Archive>(filePath, password);
-    // if (!d->rarArchive->isOpen()) {
-    //     setLastError(tr("Failed to open CBR file as RAR archive."));
-    //     LOG_ERROR(lastError());
-    //     return false;
-    // }
-
-    // Example using QProcess to call 'unrar' command line tool:
-    /*
-    QProcess unrarProcess;
-    QStringList unrarArgs;
-    unrarArgs << "l" << "-p-" << filePath; // List contents, no password prompt
-    if (!password.isEmpty()) {
-        unrarArgs[2] = password; // Replace -p- with actual password if provided
-    }
-    unrarArgs << "-y"; // Assume yes for any prompts
-    unrarProcess.start("unrar", unrarArgs);
-    unrarProcess.waitForFinished();
+    LoadTrace trace(filePath, QStringLiteral("CBR"));
+    trace.phase(LoadTrace::Io);
 
-    if (unrarProcess.exitCode() != 0) {
-        setLastError(tr("unrar command failed: %1").arg(unrarProcess.readAllStandardError()));
+    // Open the CBR file and index its headers, without extracting anything
+    QString archiveError;
+    if (!d->archive.open(filePath, password, &archiveError)) {
+        setLastError(tr("Failed to open CBR file as RAR archive: %1").arg(archiveError));
         LOG_ERROR(lastError());
         return false;
     }
-
-    QString output = unrarProcess.readAllStandardOutput();
-    // Parse output to get file list... This is fragile and depends on unrar output format.
-    */
-
-    // For now, we'll log a warning and return false, indicating RAR support is not implemented.
-    LOG_ERROR("CbrDocument::load: RAR library integration is required but not implemented. Cannot load CBR files.");
-    setLastError(tr("RAR support is not available. CBR files require the unRAR library."));
-    return false;
-
-    // --- END RAR LIBRARY SECTION ---
+    d->needsPassword = d->archive.hasEncryptedEntries() && password.isEmpty();
 
     // Set file path and update file size
-    // setFilePath(filePath); // Only set if successfully opened
+    setFilePath(filePath);
 
     // List and categorize files
-    // d->listAndCategorizeFiles(); // Only call if archive is open
+    trace.phase(LoadTrace::Parse);
+    d->listAndCategorizeFiles();
 
     // Parse ComicInfo.xml if present
-    // if (d->otherFilesList.contains("ComicInfo.xml")) {
-    //     parseComicInfo();
-    // }
+    trace.phase(LoadTrace::Metadata);
+    if (d->otherFilesList.contains("ComicInfo.xml")) {
+        parseComicInfo();
+    }
 
     // Create ComicPage objects based on image list
-    // createPages(); // Only call if files are listed
+    trace.phase(LoadTrace::Pages);
+    createPages();
+    trace.finish();
 
-    // d->isLoaded = true;
-    // setState(Loaded);
-    // emit cbrLoaded();
-    // LOG_INFO("Successfully loaded CBR document: " << filePath << " (Images: " << pageCount() << ", Other files: " << d->otherFilesList.size() << ")");
-    // return true;
+    d->isLoaded = true;
+    setState(Loaded);
+    emit cbrLoaded();
+    LOG_INFO("Successfully loaded CBR document: " << filePath << " (Images: " << pageCount() << ", Other files: " << d->otherFilesList.size() << ")");
+    return true;
 }
 
 bool CbrDocument::save(const QString& filePath)
@@ -177,24 +144,21 @@ int CbrDocument::pageCount() const
 Page* CbrDocument::page(int index) const
 {
     if (index >= 0 && index < d->pages.size()) {
-        // return d->pages[index].get(); // Placeholder
-        LOG_DEBUG("CbrDocument::page: Requested page " << index << ", but ComicPage not yet implemented.");
-        return nullptr;
+        // Return raw pointer managed by unique_ptr.
+        return d->pages[index].get();
     }
     return nullptr;
 }
 
 bool CbrDocument::isLocked() const
 {
-    // This would be determined during the load process if a password is required and not provided/rejected.
-    // For now, assume false if loaded successfully.
-    return false;
+    // Encrypted entries cannot be read until a password is given
+    return d->needsPassword;
 }
 
 bool CbrDocument::isEncrypted() const
 {
-    // Similar to isLocked.
-    return false;
+    return d->archive.hasEncryptedEntries();
 }
 
 QString CbrDocument::formatVersion() const
@@ -233,21 +197,43 @@ QString CbrDocument::comicInfoXml() const
 
 bool CbrDocument::extractImage(const QString& imagePath, const QString& outputPath) const
 {
-    // QByteArray imageData = d->readFileFromRar(imagePath); // Requires RAR library
-    Q_UNUSED(imagePath);
-    Q_UNUSED(outputPath);
-    LOG_WARN("CbrDocument::extractImage: Requires RAR library integration.");
-    return false; // Placeholder
+    QByteArray imageData = d->readFileFromRar(imagePath);
+    if (imageData.isEmpty()) {
+        LOG_ERROR("CbrDocument::extractImage: Failed to read image data from archive: " << imagePath);
+        return false;
+    }
+
+    QFile outputFile(outputPath);
+    if (!outputFile.open(QIODevice::WriteOnly)) {
+        LOG_ERROR("CbrDocument::extractImage: Failed to open output file: " << outputPath);
+        return false;
+    }
+    const bool writeSuccess = (outputFile.write(imageData) == imageData.size());
+    outputFile.close();
+
+    if (writeSuccess) {
+        LOG_INFO("CbrDocument::extractImage: Extracted image to: " << outputPath);
+    } else {
+        LOG_ERROR("CbrDocument::extractImage: Failed to write image data to: " << outputPath);
+    }
+    return writeSuccess;
+}
+
+QByteArray CbrDocument::getFileContent(const QString& filePath) const
+{
+    return d->readFileFromRar(filePath);
 }
 
 // --- Helpers ---
 void CbrDocument::parseComicInfo()
 {
-    // QByteArray xmlData = d->readFileFromRar("ComicInfo.xml"); // Requires RAR library
-    LOG_WARN("CbrDocument::parseComicInfo: Requires RAR library integration.");
-    // if (!xmlData.isEmpty()) {
-    //     d->comicInfoContent = QString::fromUtf8(xmlData);
-    // }
+    QByteArray xmlData = d->readFileFromRar("ComicInfo.xml");
+    if (!xmlData.isEmpty()) {
+        d->comicInfoContent = QString::fromUtf8(xmlData);
+        LOG_DEBUG("CbrDocument: Parsed ComicInfo.xml");
+    } else {
+        LOG_WARN("CbrDocument: Failed to read ComicInfo.xml");
+    }
 }
 
 void CbrDocument::createPages()
@@ -255,10 +241,9 @@ void CbrDocument::createPages()
     d->pages.clear();
     d->pages.reserve(d->imagePathsList.size());
     for (int i = 0; i < d->imagePathsList.size(); ++i) {
-        // pages.append(std::make_unique<ComicPage>(this, i, d->imagePathsList[i])); // Placeholder
-        LOG_DEBUG("CbrDocument: Planned page " << i << " from image: " << d->imagePathsList[i]);
+        d->pages.append(std::make_unique<ComicPage>(this, i, d->imagePathsList[i]));
     }
     LOG_INFO("CbrDocument: Created " << d->pages.size() << " page objects.");
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -16,12 +16,6 @@
 #include <QMap>
 #include <QImage>
 
-// Forward declaration of UnRAR structures/functions (defined in unrar.h if using unrar library)
-// For this example, we'll assume a generic interface or a C++ wrapper around unrar.
-// extern "C" {
-//     #include "unrar.h" // Hypothetical header
-// }
-
 namespace QuantilyxDoc {
 
 class ComicPage; // Reuse the same page class if possible
@@ -30,8 +24,8 @@ class ComicPage; // Reuse the same page class if possible
  * @brief Comic Book RAR (CBR) document implementation.
  * 
  * Handles loading of CBR files (RAR archives containing image files).
- * Treats each image file as a page.
- * NOTE: RAR is proprietary. Using unrar library (based on unRAR source) is common but has licensing implications.
+ * Treats each image file as a page. The archive is read in-process through
+ * libarchive (see ArchiveReader), which also covers RAR5, 7z and tar comics.
  */
 class CbrDocument : public Document
 {
@@ -94,6 +88,14 @@ public:
      */
     bool extractImage(const QString& imagePath, const QString& outputPath) const;
 
+    /**
+     * @brief Get the raw content of a file within the archive.
+     * Safe to call from any thread.
+     * @param filePath Path of the file inside the archive.
+     * @return File content, or empty if missing.
+     */
+    QByteArray getFileContent(const QString& filePath) const;
+
 signals:
     /**
      * @brief Emitted when the CBR file is fully loaded and parsed.
@@ -104,8 +106,6 @@ private:
     class Private;
     std::unique_ptr<Private> d;
 
-    // Helper to load the RAR archive and list files
-    bool loadArchive(const QString& filePath, const QString& password);
     // Helper to parse ComicInfo.xml if present
     void parseComicInfo();
     // Helper to create ComicPage objects based on image list
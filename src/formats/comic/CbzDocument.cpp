@@ -9,80 +9,47 @@
  */
 #include "CbzDocument.h"
 #include "ComicPage.h" // Assuming this handles image-based pages
+#include "ComicReadAhead.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/ZipArchive.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QRegularExpression>
 #include <QTextStream>
 #include <QDebug>
-#include <zip.h> // Use libzip for CBZ (which is ZIP)
 
 namespace QuantilyxDoc {
 
 class CbzDocument::Private {
 public:
-    Private() : zipArchive(nullptr), isLoaded(false) {}
-    ~Private() {
-        if (zipArchive) {
-            zip_close(zipArchive);
-        }
-    }
+    Private() : isLoaded(false) {}
 
-    zip_t* zipArchive;
+    ZipArchive archive; // Entry index plus one libzip handle per concurrent reader
     bool isLoaded;
     QStringList imagePathsList;
     QStringList otherFilesList;
     QString comicInfoContent;
     QList<std::unique_ptr<ComicPage>> pages; // Own the page objects
+    std::unique_ptr<ComicReadAhead> readAhead; // Declared after pages: destroyed, and waited for, first
 
-    // Helper to read a file from the ZIP archive
+    // Helper to read a file from the ZIP archive; safe from any thread
     QByteArray readFileFromZip(const QString& filePath) const {
-        if (!zipArchive) return QByteArray();
-
-        QString pathInZip = filePath;
-        if (pathInZip.startsWith("/")) pathInZip.remove(0, 1);
-
-        zip_stat_t stat;
-        int result = zip_stat(zipArchive, pathInZip.toUtf8().constData(), 0, &stat);
-        if (result < 0) {
-            LOG_ERROR("CbzDocument: Failed to stat file in archive: " << filePath);
-            return QByteArray();
-        }
-
-        zip_file_t* file = zip_fopen(zipArchive, pathInZip.toUtf8().constData(), 0);
-        if (!file) {
-            LOG_ERROR("CbzDocument: Failed to open file in archive: " << filePath);
-            return QByteArray();
-        }
-
-        QByteArray data(stat.size, 0);
-        zip_int64_t bytesRead = zip_fread(file, data.data(), stat.size);
-        zip_fclose(file);
-
-        if (bytesRead != static_cast<zip_int64_t>(stat.size)) {
-            LOG_ERROR("CbzDocument: Failed to read full file content: " << filePath);
-            return QByteArray();
-        }
-
-        return data;
+        if (!archive.isOpen()) return QByteArray();
+        return archive.read(filePath);
     }
 
     // Helper to list all files in the archive and categorize them
     void listAndCategorizeFiles() {
-        if (!zipArchive) return;
+        if (!archive.isOpen()) return;
 
-        int numFiles = zip_get_num_entries(zipArchive, 0);
         QRegularExpression imageRegex(R"(\.(jpg|jpeg|png|gif|webp|bmp|tiff|tif)$)", QRegularExpression::CaseInsensitiveOption);
-        for (int i = 0; i < numFiles; ++i) {
-            const char* fileNameC = zip_get_name(zipArchive, i, 0);
-            if (fileNameC) {
-                QString fileName = QString::fromUtf8(fileNameC);
-                if (imageRegex.match(fileName).hasMatch()) {
-                    imagePathsList.append(fileName);
-                } else {
-                    otherFilesList.append(fileName);
-                }
+        for (const QString& fileName : archive.entryNames()) {
+            if (imageRegex.match(fileName).hasMatch()) {
+                imagePathsList.append(fileName);
+            } else {
+                otherFilesList.append(fileName);
             }
         }
         // Sort image paths to ensure correct page order (often relies on filename sorting)
@@ -95,6 +62,7 @@ CbzDocument::CbzDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
+    d->readAhead = std::make_unique<ComicReadAhead>(this);
     LOG_INFO("CbzDocument created.");
 }
 
@@ -107,23 +75,21 @@ bool CbzDocument::load(const QString& filePath, const QString& password)
 {
     Q_UNUSED(password); // CBZs typically don't use archive-level passwords
 
-    // Close any previously loaded archive
-    if (d->zipArchive) {
-        zip_close(d->zipArchive);
-        d->zipArchive = nullptr;
-    }
+    // Close any previously loaded archive, once decodes reading it are done
+    d->readAhead->cancel();
+    d->archive.close();
     d->isLoaded = false;
     d->pages.clear();
     d->imagePathsList.clear();
     d->otherFilesList.clear();
 
+    LoadTrace trace(filePath, QStringLiteral("CBZ"));
+    trace.phase(LoadTrace::Io);
+
     // Open the CBZ file as a ZIP archive
-    int zipError;
-    d->zipArchive = zip_open(filePath.toUtf8().constData(), ZIP_RDONLY, &zipError);
-    if (!d->zipArchive) {
-        char errorBuffer[256];
-        zip_error_to_str(errorBuffer, sizeof(errorBuffer), zipError, errno);
-        setLastError(tr("Failed to open CBZ file as ZIP archive: %1").arg(errorBuffer));
+    QString zipError;
+    if (!d->archive.open(filePath, &zipError)) {
+        setLastError(tr("Failed to open CBZ file as ZIP archive: %1").arg(zipError));
         LOG_ERROR(lastError());
         return false;
     }
@@ -132,15 +98,19 @@ bool CbzDocument::load(const QString& filePath, const QString& password)
     setFilePath(filePath);
 
     // List and categorize files
+    trace.phase(LoadTrace::Parse);
     d->listAndCategorizeFiles();
 
     // Parse ComicInfo.xml if present
+    trace.phase(LoadTrace::Metadata);
     if (d->otherFilesList.contains("ComicInfo.xml")) {
         parseComicInfo();
     }
 
     // Create ComicPage objects based on image list
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -173,9 +143,7 @@ Page* CbzDocument::page(int index) const
 {
     if (index >= 0 && index < d->pages.size()) {
         // Return raw pointer managed by unique_ptr.
-        // return d->pages[index].get(); // Placeholder - requires ComicPage implementation
-        LOG_DEBUG("CbzDocument::page: Requested page " << index << ", but ComicPage not yet implemented.");
-        return nullptr; // For now, return null until ComicPage is ready
+        return d->pages[index].get();
     }
     return nullptr;
 }
@@ -227,8 +195,9 @@ QString CbzDocument::comicInfoXml() const
 
 bool CbzDocument::extractImage(const QString& imagePath, const QString& outputPath) const
 {
-    QByteArray imageData = d->readFileFromZip(imagePath);
-    if (imageData.isEmpty()) {
+    // Copied a chunk at a time, so large scans are never inflated whole
+    std::unique_ptr<QIODevice> imageStream = openFileStream(imagePath);
+    if (!imageStream) {
         LOG_ERROR("CbzDocument::extractImage: Failed to read image data from archive: " << imagePath);
         return false;
     }
@@ -239,7 +208,17 @@ bool CbzDocument::extractImage(const QString& imagePath, const QString& outputPa
         return false;
     }
 
-    bool writeSuccess = (outputFile.write(imageData) == imageData.size());
+    const qint64 expected = imageStream->size();
+    qint64 copied = 0;
+    bool writeSuccess = true;
+    QByteArray chunk(64 * 1024, Qt::Uninitialized);
+    while (writeSuccess) {
+        const qint64 bytesRead = imageStream->read(chunk.data(), chunk.size());
+        if (bytesRead <= 0) break;
+        writeSuccess = (outputFile.write(chunk.constData(), bytesRead) == bytesRead);
+        copied += bytesRead;
+    }
+    writeSuccess = writeSuccess && copied == expected;
     outputFile.close();
 
     if (writeSuccess) {
@@ -250,6 +229,17 @@ bool CbzDocument::extractImage(const QString& imagePath, const QString& outputPa
     return writeSuccess;
 }
 
+QByteArray CbzDocument::getFileContent(const QString& filePath) const
+{
+    return d->readFileFromZip(filePath);
+}
+
+std::unique_ptr<QIODevice> CbzDocument::openFileStream(const QString& filePath) const
+{
+    if (!d->archive.isOpen()) return nullptr;
+    return d->archive.openStream(filePath);
+}
+
 // --- Helpers ---
 void CbzDocument::parseComicInfo()
 {
@@ -267,9 +257,7 @@ void CbzDocument::createPages()
     d->pages.clear();
     d->pages.reserve(d->imagePathsList.size());
     for (int i = 0; i < d->imagePathsList.size(); ++i) {
-        // Create the page object. This requires ComicPage to be implemented.
-        // pages.append(std::make_unique<ComicPage>(this, i, d->imagePathsList[i])); // Placeholder
-        LOG_DEBUG("CbzDocument: Planned page " << i << " from image: " << d->imagePathsList[i]);
+        d->pages.append(std::make_unique<ComicPage>(this, i, d->imagePathsList[i]));
     }
     LOG_INFO("CbzDocument: Created " << d->pages.size() << " page objects.");
 }
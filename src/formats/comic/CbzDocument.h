@@ -15,6 +15,7 @@
 #include <QList>
 #include <QMap>
 #include <QImage>
+#include <QIODevice>
 
 namespace QuantilyxDoc {
 
@@ -87,6 +88,24 @@ public:
      */
     bool extractImage(const QString& imagePath, const QString& outputPath) const;
 
+    /**
+     * @brief Get the raw content of a file within the archive.
+     * Safe to call from any thread.
+     * @param filePath Path of the file inside the archive.
+     * @return File content, or empty if missing.
+     */
+    QByteArray getFileContent(const QString& filePath) const;
+
+    /**
+     * @brief Open a file within the archive for streaming reads.
+     * The file is decompressed in chunks as it is read, so large images
+     * never have to be held in memory whole. Safe to call from any thread;
+     * the device must be destroyed before the document is reloaded.
+     * @param filePath Path of the file inside the archive.
+     * @return Sequential read-only device, or null if the file is missing.
+     */
+    std::unique_ptr<QIODevice> openFileStream(const QString& filePath) const;
+
 signals:
     /**
      * @brief Emitted when the CBZ file is fully loaded and parsed.
@@ -10,12 +10,22 @@
 #include "ComicPage.h"
 #include "CbzDocument.h" // Example of a document type that might own this page
 #include "CbrDocument.h" // Example of a document type that might own this page
+#include "../../core/ImageBufferPool.h"
+#include "../../core/ImageScaler.h"
 #include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
 #include <QImage>
 #include <QPainter>
 #include <QBuffer>
+#include <QCryptographicHash>
 #include <QFileInfo>
+#include <QImageReader>
 #include <QRegularExpression>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
 #include <QDebug>
 
 namespace QuantilyxDoc {
@@ -23,80 +33,297 @@ namespace QuantilyxDoc {
 class ComicPage::Private {
 public:
     Private(Document* doc, int pIndex, const QString& imgPath)
-        : document(doc), pageIndexVal(pIndex), imagePathVal(imgPath) {}
+        : document(doc), pageIndexVal(pIndex), imagePathVal(imgPath) {
+        registerMemoryConsumer();
+        QMutexLocker locker(&registryMutex());
+        registry().insert(this);
+    }
+
+    ~Private() {
+        QMutexLocker locker(&registryMutex());
+        registry().remove(this);
+    }
 
     Document* document;
     int pageIndexVal;
     QString imagePathVal;
-    QImage cachedImage; // Cache the loaded image
+    QImage cachedImage; // Full-resolution original, kept only with Advanced/ComicKeepOriginals
     QSize originalImageSize;
+    bool originalHasAlpha = false;
+    int originalDepth = 0;
     QString mimeType;
     bool loaded = false;
+    bool infoLoaded = false; // Header fields above are read
+    QImage sizedImage;   // Last decode at a render box; serves repeated renders and tile crops
+    QSize sizedBox;      // The width and height render() was called with for sizedImage
+    QSize lastRenderBox; // Box of the most recent render() call
+    QSize wantedBox;     // Box a read-ahead decode is queued for, if any
+    QMutex imageMutex; // Images are used by renders and dropped by MemoryBudget; guards every field above
+    QByteArray digest;       // Of the encoded image, once read
+    bool digestRead = false;
+    QMutex digestMutex;      // Guards digest and digestRead; hashing never blocks a render
 
-    // Helper to load the image from the document's archive or from a file path
-    bool loadImage() {
-        if (loaded && !cachedImage.isNull()) return true; // Already loaded
+    qint64 decodedBytes() {
+        QMutexLocker locker(&imageMutex);
+        return cachedImage.sizeInBytes() + sizedImage.sizeInBytes();
+    }
 
+    // Drop the decoded images; they are decoded again from the archive on demand
+    qint64 releaseImage() {
+        QMutexLocker locker(&imageMutex);
+        const qint64 freed = cachedImage.sizeInBytes() + sizedImage.sizeInBytes();
+        cachedImage = QImage();
+        loaded = false;
+        sizedImage = QImage();
+        sizedBox = QSize();
+        wantedBox = QSize();
+        return freed;
+    }
+
+    // Every live page, so MemoryBudget sees all decoded images as one consumer
+    static QMutex& registryMutex() {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    static QSet<Private*>& registry() {
+        static QSet<Private*> pages;
+        return pages;
+    }
+
+    static void registerMemoryConsumer() {
+        // Full-resolution originals are cheap to decode again, so they go first
+        static const int consumerId = [] {
+            const int id = MemoryBudget::instance().registerConsumer(
+                "Comic decoded images", MemoryBudget::Priority::Low,
+                []() {
+                    QMutexLocker locker(&registryMutex());
+                    qint64 total = 0;
+                    for (Private* page : registry()) {
+                        total += page->decodedBytes();
+                    }
+                    return total;
+                },
+                [](qint64 bytes) {
+                    QMutexLocker locker(&registryMutex());
+                    qint64 freed = 0;
+                    for (Private* page : registry()) {
+                        if (freed >= bytes) break;
+                        freed += page->releaseImage();
+                    }
+                    return freed;
+                });
+            MemoryBudget::instance().setDocumentAccounting(id,
+                []() {
+                    QMutexLocker locker(&registryMutex());
+                    QHash<quintptr, qint64> usage;
+                    for (Private* page : registry()) {
+                        usage[MemoryBudget::documentId(page->document)] += page->decodedBytes();
+                    }
+                    return usage;
+                },
+                [](quintptr documentId, qint64 bytes) {
+                    QMutexLocker locker(&registryMutex());
+                    qint64 freed = 0;
+                    for (Private* page : registry()) {
+                        if (freed >= bytes) break;
+                        if (MemoryBudget::documentId(page->document) == documentId) freed += page->releaseImage();
+                    }
+                    return freed;
+                });
+            return id;
+        }();
+        Q_UNUSED(consumerId);
+    }
+
+    // The encoded image: the archive's decompressing stream, or a buffer
+    // over the standalone file's mapping
+    struct EncodedSource {
+        std::shared_ptr<MappedFile> mapping; // Outlives bytes, which may point into it
+        QByteArray bytes;
+        std::unique_ptr<QIODevice> device;
+    };
+
+    bool openSource(EncodedSource& source) const {
         // Determine if this belongs to an archive-based document (CBZ, CBR) or a single image
-        // This requires checking the dynamic type of 'document' or having a specific path resolution method in the document.
         // For now, let's assume the imagePathVal is relative to an archive or is an absolute path for single images.
-        // We'll try to get the data via the Document's getFileContent method if it's archive-based.
-
         CbzDocument* cbzDoc = dynamic_cast<CbzDocument*>(document);
         CbrDocument* cbrDoc = dynamic_cast<CbrDocument*>(document);
 
-        QByteArray imageData;
         if (cbzDoc) {
-            // Load from CBZ archive
-            imageData = cbzDoc->getFileContent(imagePathVal); // This method needs to be added to CbzDocument if it doesn't exist for raw access
-            // Or use the Private access if necessary: cbzDoc->d->readFileFromZip(imagePathVal);
+            // Decoded straight from the decompressing stream, so a large
+            // scan is never held compressed and inflated at the same time
+            source.device = cbzDoc->openFileStream(imagePathVal);
         } else if (cbrDoc) {
-            // Load from CBR archive (requires RAR library integration)
-            // imageData = cbrDoc->getFileContent(imagePathVal); // This method needs RAR integration
-             LOG_ERROR("ComicPage::loadImage: CBR loading requires RAR library integration, which is not available.");
-             return false;
+            // RAR entries can only be read front to back; extracted whole
+            source.bytes = cbrDoc->getFileContent(imagePathVal);
+            if (!source.bytes.isEmpty()) {
+                QBuffer* buffer = new QBuffer(&source.bytes);
+                buffer->open(QIODevice::ReadOnly);
+                source.device.reset(buffer);
+            }
         } else {
-            // Assume it's a path to a standalone image file
-            QFile imageFile(imagePathVal);
-            if (!imageFile.open(QIODevice::ReadOnly)) {
-                LOG_ERROR("ComicPage::loadImage: Failed to open image file: " << imagePathVal);
-                return false;
+            // Assume it's a path to a standalone image file, decoded
+            // straight from its mapping when it can be mapped
+            source.mapping = MappedFile::open(imagePathVal);
+            if (source.mapping) source.bytes = source.mapping->bytes();
+            if (source.bytes.isEmpty()) {
+                QFile imageFile(imagePathVal);
+                if (!imageFile.open(QIODevice::ReadOnly)) {
+                    LOG_ERROR("ComicPage::loadImage: Failed to open image file: " << imagePathVal);
+                    return false;
+                }
+                source.bytes = imageFile.readAll();
+            }
+            if (!source.bytes.isEmpty()) {
+                QBuffer* buffer = new QBuffer(&source.bytes);
+                buffer->open(QIODevice::ReadOnly);
+                source.device.reset(buffer);
             }
-            imageData = imageFile.readAll();
-            imageFile.close();
         }
 
-        if (imageData.isEmpty()) {
+        if (!source.device) {
             LOG_ERROR("ComicPage::loadImage: No image data retrieved for: " << imagePathVal);
             return false;
         }
+        return true;
+    }
 
-        // Load image from byte array
-        QBuffer buffer(&imageData);
-        buffer.open(QIODevice::ReadOnly);
-        cachedImage.load(&buffer, nullptr); // nullptr lets Qt detect format
+    // SHA-1 of the encoded image, streamed from the source on first use.
+    // Renders depend on nothing else, so equal images render alike.
+    QByteArray contentDigest() {
+        QMutexLocker locker(&digestMutex);
+        if (digestRead) return digest;
+        digestRead = true;
+        EncodedSource source;
+        if (!openSource(source)) return digest;
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (hash.addData(source.device.get())) digest = hash.result();
+        return digest;
+    }
 
-        if (cachedImage.isNull()) {
-            LOG_ERROR("ComicPage::loadImage: Failed to load image from data: " << imagePathVal);
-            return false;
+    // Read the whole encoded image into memory; used by read-ahead, which
+    // reads on the I/O pool and decodes on the CPU pool
+    QByteArray readEncoded() const {
+        if (CbzDocument* cbzDoc = dynamic_cast<CbzDocument*>(document)) {
+            return cbzDoc->getFileContent(imagePathVal);
+        }
+        if (CbrDocument* cbrDoc = dynamic_cast<CbrDocument*>(document)) {
+            return cbrDoc->getFileContent(imagePathVal);
         }
+        EncodedSource source;
+        if (!openSource(source)) return QByteArray();
+        return source.device->readAll(); // A copy, so it does not point into the mapping
+    }
 
-        originalImageSize = cachedImage.size();
-        // Determine MIME type based on file extension or image format
+    // Decode the image, scaled while decoding when scaledSize is valid;
+    // JPEG scans are then reduced by libjpeg's DCT scaling and never
+    // exist at full resolution
+    QImage decode(QIODevice* device, const QSize& scaledSize) const {
+        QImageReader reader(device);
+        reader.setDecideFormatFromContent(true);
+        if (scaledSize.isValid()) reader.setScaledSize(scaledSize);
+        QImage image = reader.read();
+        if (image.isNull()) {
+            LOG_ERROR("ComicPage::loadImage: Failed to load image from data: " << imagePathVal << ": " << reader.errorString());
+        }
+        return image;
+    }
+
+    QImage decode(const QSize& scaledSize) const {
+        EncodedSource source;
+        if (!openSource(source)) return QImage();
+        return decode(source.device.get(), scaledSize);
+    }
+
+    // Decode for a render box, straight to the size shown when shrinking;
+    // only enlargements decode in full and go through the scaler
+    QImage decodeForBox(QIODevice* device, const QSize& originalSize, const QSize& box) const {
+        const QSize target = originalSize.scaled(box, Qt::KeepAspectRatio);
+        const bool shrink = !target.isEmpty() && target.width() < originalSize.width();
+        QImage image = decode(device, shrink ? target : QSize());
+        if (image.isNull()) return image;
+        image = ImageBufferPool::toPipelineFormat(std::move(image));
+        if (shrink && image.size() == target) return image;
+        return ImageScaler::scaled(image, box.width(), box.height(), Qt::KeepAspectRatio);
+    }
+
+    // Read the size and format from an image header without decoding it.
+    // Caller holds imageMutex.
+    bool readHeader(QIODevice* device) {
+        QImageReader reader(device);
+        reader.setDecideFormatFromContent(true);
+        const QSize size = reader.size();
+        const QImage::Format format = reader.imageFormat();
+        if (!size.isValid() || format == QImage::Format_Invalid) return false; // Some handlers only know after decoding
+        const QPixelFormat pixelFormat = QImage::toPixelFormat(format);
+        originalImageSize = size;
+        originalHasAlpha = pixelFormat.alphaUsage() == QPixelFormat::UsesAlpha;
+        originalDepth = pixelFormat.bitsPerPixel();
+        mimeType = mimeTypeForSuffix();
+        infoLoaded = true;
+        LOG_DEBUG("ComicPage::loadInfo: Page " << pageIndexVal << " is " << originalImageSize << " pixels");
+        return true;
+    }
+
+    // Read the header once, decoding the image only if it has to.
+    // Caller holds imageMutex.
+    bool loadInfo() {
+        if (infoLoaded) return true;
+        EncodedSource source;
+        if (!openSource(source)) return false;
+        if (readHeader(source.device.get())) return true;
+        source.device.reset(); // Returns its archive handle before decoding again
+        return loadImage();
+    }
+
+    // Keep the decode for a render box, replacing the previous one.
+    // Caller holds imageMutex.
+    void storeSized(const QSize& box, const QImage& image) {
+        sizedImage = image;
+        sizedBox = box;
+        if (wantedBox == box) wantedBox = QSize();
+    }
+
+    // Determine MIME type based on file extension
+    QString mimeTypeForSuffix() const {
         QFileInfo info(imagePathVal);
         QString suffix = info.suffix().toLower();
-        if (suffix == "jpg" || suffix == "jpeg") mimeType = "image/jpeg";
-        else if (suffix == "png") mimeType = "image/png";
-        else if (suffix == "gif") mimeType = "image/gif";
-        else if (suffix == "webp") mimeType = "image/webp";
-        else if (suffix == "bmp") mimeType = "image/bmp";
-        else if (suffix == "tiff" || suffix == "tif") mimeType = "image/tiff";
-        else mimeType = "image/unknown";
+        if (suffix == "jpg" || suffix == "jpeg") return "image/jpeg";
+        else if (suffix == "png") return "image/png";
+        else if (suffix == "gif") return "image/gif";
+        else if (suffix == "webp") return "image/webp";
+        else if (suffix == "bmp") return "image/bmp";
+        else if (suffix == "tiff" || suffix == "tif") return "image/tiff";
+        return "image/unknown";
+    }
+
+    // Helper to decode the full-resolution image into cachedImage.
+    // Caller holds imageMutex.
+    bool loadImage() {
+        if (loaded && !cachedImage.isNull()) return true; // Already loaded
+
+        cachedImage = decode(QSize());
+        if (cachedImage.isNull()) return false;
+
+        originalImageSize = cachedImage.size();
+        originalHasAlpha = cachedImage.hasAlphaChannel();
+        originalDepth = cachedImage.depth();
+        mimeType = mimeTypeForSuffix();
+        infoLoaded = true;
+        // Kept in the scaler's format so page turns do not convert the full scan
+        cachedImage = ImageBufferPool::toPipelineFormat(std::move(cachedImage));
 
         loaded = true;
         LOG_DEBUG("ComicPage::loadImage: Loaded image for page " << pageIndexVal << ", size: " << originalImageSize);
         return true;
     }
+
+    // Whether originals stay decoded between renders; off by default, as
+    // renders decode at the target size and the view caches what they return
+    static bool keepOriginals() {
+        return Settings::snapshot().comicKeepOriginals;
+    }
 };
 
 ComicPage::ComicPage(Document* document, int pageIndex, const QString& imagePath, QObject* parent)
@@ -115,18 +342,51 @@ QImage ComicPage::render(int width, int height, int dpi)
 {
     Q_UNUSED(dpi); // For simple image scaling, DPI might be handled by the caller via width/height
 
-    if (!d->loadImage()) {
-        LOG_WARN("ComicPage::render: Failed to load image for page " << d->pageIndexVal);
-        return QImage(); // Return null image
+    const QSize box(width, height);
+    QImage sourceImage;
+    QSize originalSize;
+    {
+        QMutexLocker locker(&d->imageMutex);
+        d->lastRenderBox = box;
+        if (d->sizedBox == box && !d->sizedImage.isNull()) {
+            return d->sizedImage; // Read ahead, or rendered for another tile
+        }
+        if (Private::keepOriginals() || d->loaded) {
+            if (!d->loadImage()) {
+                LOG_WARN("ComicPage::render: Failed to load image for page " << d->pageIndexVal);
+                return QImage(); // Return null image
+            }
+            sourceImage = d->cachedImage; // Shared copy; stays valid if the cache is released
+        } else if (!d->loadInfo()) {
+            LOG_WARN("ComicPage::render: Failed to load image for page " << d->pageIndexVal);
+            return QImage();
+        } else if (d->loaded) {
+            // loadInfo() had to decode the header; use that image once
+            sourceImage = d->cachedImage;
+            d->cachedImage = QImage();
+            d->loaded = false;
+        }
+        originalSize = d->originalImageSize;
+    }
+
+    QImage scaledImage;
+    if (!sourceImage.isNull()) {
+        // Scale the image to the requested size
+        scaledImage = ImageScaler::scaled(sourceImage, width, height, Qt::KeepAspectRatio);
+    } else if (originalSize.isValid()) {
+        Private::EncodedSource source;
+        if (d->openSource(source)) scaledImage = d->decodeForBox(source.device.get(), originalSize, box);
     }
 
-    if (d->cachedImage.isNull()) {
+    if (scaledImage.isNull()) {
         LOG_WARN("ComicPage::render: Cached image is null for page " << d->pageIndexVal);
         return QImage();
     }
 
-    // Scale the image to the requested size
-    QImage scaledImage = d->cachedImage.scaled(width, height, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    if (sourceImage.isNull()) {
+        QMutexLocker locker(&d->imageMutex);
+        d->storeSized(box, scaledImage);
+    }
 
     LOG_DEBUG("ComicPage::render: Rendered page " << d->pageIndexVal << " to size " << scaledImage.size());
     return scaledImage;
@@ -168,9 +428,15 @@ QList<QObject*> ComicPage::links() const
     return QList<QObject*>(); // Return empty list
 }
 
+QByteArray ComicPage::contentDigest() const
+{
+    return d->contentDigest();
+}
+
 QVariantMap ComicPage::metadata() const
 {
-    if (!d->loadImage()) {
+    QMutexLocker locker(&d->imageMutex);
+    if (!d->loadInfo()) {
          LOG_WARN("ComicPage::metadata: Failed to load image to get metadata for page " << d->pageIndexVal);
          return QVariantMap();
     }
@@ -180,8 +446,8 @@ QVariantMap ComicPage::metadata() const
     map["ImagePath"] = d->imagePathVal;
     map["OriginalSizePixels"] = d->originalImageSize;
     map["MimeType"] = d->mimeType;
-    map["HasAlpha"] = d->cachedImage.hasAlphaChannel();
-    map["ColorDepth"] = d->cachedImage.depth();
+    map["HasAlpha"] = d->originalHasAlpha;
+    map["ColorDepth"] = d->originalDepth;
     // Add more specific image metadata if available from QImage or loaded format
     return map;
 }
@@ -193,7 +459,8 @@ QString ComicPage::imagePath() const
 
 QSize ComicPage::imageSize() const
 {
-    if (!d->loadImage()) {
+    QMutexLocker locker(&d->imageMutex);
+    if (!d->loadInfo()) {
         LOG_WARN("ComicPage::imageSize: Failed to load image to get size for page " << d->pageIndexVal);
         return QSize();
     }
@@ -202,7 +469,8 @@ QSize ComicPage::imageSize() const
 
 QString ComicPage::imageMimeType() const
 {
-    if (!d->loadImage()) {
+    QMutexLocker locker(&d->imageMutex);
+    if (!d->loadInfo()) {
         LOG_WARN("ComicPage::imageMimeType: Failed to load image to get MIME type for page " << d->pageIndexVal);
         return QString();
     }
@@ -211,20 +479,80 @@ QString ComicPage::imageMimeType() const
 
 bool ComicPage::hasTransparency() const
 {
-    if (!d->loadImage()) {
+    QMutexLocker locker(&d->imageMutex);
+    if (!d->loadInfo()) {
         LOG_WARN("ComicPage::hasTransparency: Failed to load image to check transparency for page " << d->pageIndexVal);
         return false;
     }
-    return d->cachedImage.hasAlphaChannel();
+    return d->originalHasAlpha;
 }
 
 int ComicPage::colorDepth() const
 {
-    if (!d->loadImage()) {
+    QMutexLocker locker(&d->imageMutex);
+    if (!d->loadInfo()) {
         LOG_WARN("ComicPage::colorDepth: Failed to load image to get color depth for page " << d->pageIndexVal);
         return 0;
     }
-    return d->cachedImage.depth();
+    return d->originalDepth;
+}
+
+QSize ComicPage::lastRenderBox() const
+{
+    QMutexLocker locker(&d->imageMutex);
+    return d->lastRenderBox;
+}
+
+bool ComicPage::queueDecode(const QSize& box)
+{
+    QMutexLocker locker(&d->imageMutex);
+    if ((d->sizedBox == box && !d->sizedImage.isNull()) || d->wantedBox == box) return false;
+    d->wantedBox = box;
+    return true;
+}
+
+bool ComicPage::isDecodeWanted(const QSize& box) const
+{
+    QMutexLocker locker(&d->imageMutex);
+    return d->wantedBox == box;
+}
+
+QByteArray ComicPage::readEncoded() const
+{
+    return d->readEncoded();
+}
+
+bool ComicPage::decodeAhead(const QByteArray& encoded, const QSize& box)
+{
+    QByteArray bytes = encoded;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QSize originalSize;
+    {
+        QMutexLocker locker(&d->imageMutex);
+        if (!d->infoLoaded) d->readHeader(&buffer);
+        originalSize = d->originalImageSize;
+    }
+    if (!originalSize.isValid() || !buffer.seek(0)) return false;
+
+    // Decoded outside the lock, so renders of the page shown do not wait
+    const QImage image = d->decodeForBox(&buffer, originalSize, box);
+    QMutexLocker locker(&d->imageMutex);
+    if (image.isNull() || d->wantedBox != box) return false; // Failed, or released meanwhile
+    d->storeSized(box, image);
+    return true;
+}
+
+void ComicPage::abandonDecode(const QSize& box)
+{
+    QMutexLocker locker(&d->imageMutex);
+    if (d->wantedBox == box) d->wantedBox = QSize();
+}
+
+void ComicPage::releaseDecodes()
+{
+    d->releaseImage();
 }
 
 } // namespace QuantilyxDoc
\ No newline at end of file
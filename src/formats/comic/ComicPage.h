@@ -52,6 +52,7 @@ public:
     QObject* hitTest(const QPointF& position) const override; // Could return nullptr or an image object if supported
     QList<QObject*> links() const override; // Likely empty for static images
     QVariantMap metadata() const override;
+    QByteArray contentDigest() const override; // Hash of the encoded image
 
     // --- Image-Specific Page Properties ---
     /**
@@ -91,6 +92,17 @@ signals:
     void imageLoaded();
 
 private:
+    friend class ComicReadAhead; // Decodes pages ahead of the reader
+
+    // --- Read-ahead, called by ComicReadAhead from any thread ---
+    QSize lastRenderBox() const;         // Box of the most recent render(), or invalid
+    bool queueDecode(const QSize& box);  // Mark a decode at box as wanted; false if done or queued
+    bool isDecodeWanted(const QSize& box) const;
+    QByteArray readEncoded() const;      // Encoded image, read in full; for the I/O pool
+    bool decodeAhead(const QByteArray& encoded, const QSize& box); // For the CPU pool
+    void abandonDecode(const QSize& box);
+    void releaseDecodes();               // Drop every decoded image of this page
+
     class Private;
     std::unique_ptr<Private> d;
 };
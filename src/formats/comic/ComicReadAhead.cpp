@@ -0,0 +1,161 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ComicReadAhead.h"
+#include "ComicPage.h"
+#include "../../core/Document.h"
+#include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
+#include "../../core/ThreadPool.h"
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Shared with the decodes in flight; replaced after a cancel()
+struct ReadAheadState {
+    std::atomic<bool> canceled{false};
+    int inFlight = 0;
+    QMutex mutex;
+    QWaitCondition idle;
+
+    void started() {
+        QMutexLocker locker(&mutex);
+        ++inFlight;
+    }
+
+    void finished() {
+        QMutexLocker locker(&mutex);
+        --inFlight;
+        idle.wakeAll();
+    }
+
+    void wait() {
+        QMutexLocker locker(&mutex);
+        while (inFlight > 0) {
+            idle.wait(&mutex);
+        }
+    }
+};
+
+} // namespace
+
+class ComicReadAhead::Private {
+public:
+    explicit Private(Document* doc) : document(doc), state(std::make_shared<ReadAheadState>()) {}
+
+    Document* document;
+    std::shared_ptr<ReadAheadState> state;
+    QSize box;          // Render box of the last page shown, used for its neighbours
+    QSet<int> window;   // Pages asked to decode ahead
+
+    ComicPage* comicPage(int index) const {
+        return dynamic_cast<ComicPage*>(document->page(index));
+    }
+};
+
+ComicReadAhead::ComicReadAhead(Document* document)
+    : QObject(nullptr)
+    , d(new Private(document))
+{
+    connect(document, &Document::currentPageChanged, this, &ComicReadAhead::pageShown);
+}
+
+ComicReadAhead::~ComicReadAhead()
+{
+    cancel();
+}
+
+void ComicReadAhead::cancel()
+{
+    d->state->canceled = true;
+    d->state->wait();
+    d->state = std::make_shared<ReadAheadState>();
+    d->window.clear();
+}
+
+void ComicReadAhead::pageShown(int pageIndex)
+{
+    const int pageCount = d->document->pageCount();
+    if (pageIndex < 0 || pageIndex >= pageCount) return;
+
+    // Neighbours are decoded at the box the shown page was rendered at;
+    // until a page has been rendered there is nothing to match
+    if (ComicPage* shown = d->comicPage(pageIndex)) {
+        const QSize shownBox = shown->lastRenderBox();
+        if (shownBox.isValid()) d->box = shownBox;
+    }
+    const int ahead = Settings::instance().value<int>("Advanced/ComicReadAheadPages", 4);
+    if (!d->box.isValid() || ahead <= 0 || MemoryBudget::instance().isUnderPressure()) return;
+    const int behind = qMax(1, ahead / 2);
+
+    // Nearest first, forward pages ahead of backward ones at the same distance
+    QVector<int> order;
+    for (int distance = 1; distance <= ahead; ++distance) {
+        if (pageIndex + distance < pageCount) order.append(pageIndex + distance);
+        if (distance <= behind && pageIndex - distance >= 0) order.append(pageIndex - distance);
+    }
+
+    QSet<int> window;
+    window.insert(pageIndex);
+    for (int index : order) window.insert(index);
+    for (int index : qAsConst(d->window)) {
+        if (window.contains(index)) continue;
+        if (ComicPage* page = d->comicPage(index)) page->releaseDecodes();
+    }
+    d->window = window;
+
+    int queued = 0;
+    for (int index : order) {
+        ComicPage* page = d->comicPage(index);
+        if (!page || !page->queueDecode(d->box)) continue;
+        schedule(page, d->box);
+        ++queued;
+    }
+    if (queued > 0) {
+        LOG_DEBUG("ComicReadAhead: Decoding " << queued << " pages around page " << pageIndex << " at " << d->box);
+    }
+}
+
+void ComicReadAhead::schedule(ComicPage* page, const QSize& box)
+{
+    // The page is only touched while the state is not canceled; the
+    // document cancels and waits before its pages go away
+    std::shared_ptr<ReadAheadState> state = d->state;
+    state->started();
+    ThreadPool::ioInstance().submitDetached([state, page, box]() {
+        if (state->canceled || !page->isDecodeWanted(box)) {
+            state->finished();
+            return;
+        }
+        const QByteArray encoded = page->readEncoded();
+        if (encoded.isEmpty()) {
+            page->abandonDecode(box);
+            state->finished();
+            return;
+        }
+
+        ThreadPool::instance().submitDetached([state, page, box, encoded]() {
+            if (!state->canceled && page->isDecodeWanted(box) && !page->decodeAhead(encoded, box)) {
+                page->abandonDecode(box);
+            }
+            state->finished();
+        }, Task::Priority::Normal);
+    }, Task::Priority::Normal);
+}
+
+} // namespace QuantilyxDoc
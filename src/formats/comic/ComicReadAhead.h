@@ -0,0 +1,73 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_COMICREADAHEAD_H
+#define QUANTILYX_COMICREADAHEAD_H
+
+#include <QObject>
+#include <QSize>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class ComicPage;
+class Document;
+
+/**
+ * @brief Decodes the pages around the one being read, before they are turned to.
+ *
+ * Follows Document::currentPageChanged(). Each time a page is shown, the
+ * next pages (Advanced/ComicReadAheadPages, 4 by default, so two spreads)
+ * and half as many previous pages are read on the I/O pool and decoded on
+ * the CPU pool. They are decoded at the size the shown page was last
+ * rendered at, and the result waits in each ComicPage for its render().
+ * Pages that fall out of the window drop their decode.
+ *
+ * The owning document must call cancel() before destroying its pages.
+ */
+class ComicReadAhead : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document Document whose pages are ComicPage objects.
+     */
+    explicit ComicReadAhead(Document* document);
+
+    /**
+     * @brief Destructor. Waits for decodes in flight.
+     */
+    ~ComicReadAhead() override;
+
+    /**
+     * @brief Stop reading ahead and wait for decodes in flight.
+     * Reading ahead resumes at the next page change.
+     */
+    void cancel();
+
+public slots:
+    /**
+     * @brief Start decoding around a page.
+     * @param pageIndex Page now shown.
+     */
+    void pageShown(int pageIndex);
+
+private:
+    // Read a page on the I/O pool, then decode it on the CPU pool
+    void schedule(ComicPage* page, const QSize& box);
+
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_COMICREADAHEAD_H
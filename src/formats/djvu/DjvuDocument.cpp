@@ -8,44 +8,93 @@
  * (at your option) any later version.
  */
 #include "DjvuDocument.h"
-#include "DjvuPage.h" // Assuming this will be created
+#include "DjvuPage.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QTemporaryDir>
 #include <QTextStream>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
 #include <QDebug>
+#include <limits>
 #include <ddjvuapi.h> // Include DjVuLibre header
 
 namespace QuantilyxDoc {
 
 class DjvuDocument::Private {
 public:
-    Private() : context(nullptr), document(nullptr), pageCountVal(0), isLoaded(false) {}
+    Private() : context(nullptr), document(nullptr), pixelFormat(nullptr), pageCountVal(0), isLoaded(false),
+                useClock(0), memoryConsumerId(-1) {
+        // 0xffRRGGBB: opaque pixels in the pipeline's premultiplied ARGB32
+        unsigned int masks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+        pixelFormat = ddjvu_format_create(DDJVU_FORMAT_RGBMASK32, 4, masks);
+        ddjvu_format_set_row_order(pixelFormat, 1); // Top row first, as QImage stores them
+        ddjvu_format_set_y_direction(pixelFormat, 1);
+    }
     ~Private() {
-        if (document) {
-            ddjvu_document_release(document);
-        }
-        if (context) {
-            ddjvu_context_release(context);
+        close();
+        if (pixelFormat) {
+            ddjvu_format_release(pixelFormat);
         }
     }
 
+    // A page DjVuLibre has decoded, or is decoding in its own thread
+    struct DecodedPage {
+        std::shared_ptr<ddjvu_page_t> page; // Renders hold a reference while they draw
+        qint64 bytes = 0;
+        quint64 lastUse = 0;
+    };
+
     ddjvu_context_t* context;
     ddjvu_document_t* document;
+    ddjvu_format_t* pixelFormat;
     int pageCountVal;
     bool isLoaded;
     QString djvuVersionStr;
     QRectF boundingBox; // Calculated from page info
+    QVector<ddjvu_pageinfo_t> pageInfos; // Per page, read once at load
     QList<std::unique_ptr<DjvuPage>> pages; // Own the page objects
     QStringList embeddedFileNames;
     bool hasSharedAnnots = false;
 
-    // Helper to handle DjVuLibre messages (errors, warnings, progress)
-    void handleMessages() {
+    QMutex messageMutex; // One thread at a time pops the context's messages
+    mutable QMutex decodedMutex; // Protects decoded and useClock
+    QHash<int, DecodedPage> decoded;
+    quint64 useClock;
+    int memoryConsumerId;
+
+    // Release the document and everything decoded from it
+    void close() {
+        {
+            QMutexLocker locker(&decodedMutex);
+            decoded.clear(); // Pages are released before their document
+        }
+        if (document) {
+            ddjvu_document_release(document);
+            document = nullptr;
+        }
+        if (context) {
+            ddjvu_context_release(context);
+            context = nullptr;
+        }
+        pageInfos.clear();
+    }
+
+    // Helper to handle DjVuLibre messages (errors, warnings, progress).
+    // With wait, blocks until at least one message arrives.
+    // Caller holds messageMutex once pages can be decoded from other threads.
+    void handleMessages(bool wait) {
+        if (wait) ddjvu_message_wait(context);
         const ddjvu_message_t *msg;
-        while ((msg = ddjvu_message_wait(context))) {
+        while ((msg = ddjvu_message_peek(context))) {
             ddjvu_message_tag_t tag = msg->m_any.tag;
             switch (tag) {
                 case DDJVU_ERROR:
@@ -62,58 +111,128 @@ public:
                 case DDJVU_NEWSTREAM:
                     LOG_DEBUG("DjVuLibre New Stream");
                     break;
-                case DDJVU_JB2DECODE:
-                case DDJVU_PAGELAYOUT:
-                case DDJVU_PAGEDECODE:
-                case DDJVU_RELAYOUT:
-                case DDJVU_RELOAD:
-                case DDJVU_CHUNK:
-                    // These are internal progress messages, usually not logged unless debugging
+                default:
+                    // Layout and decoding progress, usually not logged unless debugging
                     break;
             }
             ddjvu_message_pop(context);
         }
     }
 
+    // Pump messages until done() holds. Completion is always followed by
+    // a message, so checking under the lock before waiting cannot miss it.
+    template <typename Done>
+    void waitUntil(Done done) {
+        while (!done()) {
+            QMutexLocker locker(&messageMutex);
+            if (done()) break;
+            handleMessages(true);
+        }
+    }
+
     // Helper to get page info (size, rotation) without fully decoding the page
     bool getPageInfo(int pageIndex, ddjvu_pageinfo_t* info) {
         if (!document || pageIndex < 0 || pageIndex >= pageCountVal) return false;
 
-        ddjvu_status_t status = ddjvu_document_get_pageinfo(document, pageIndex, info);
-        // Wait for the info request to complete
-        while (status < DDJVU_JOB_OK) {
-            handleMessages(); // Process messages to allow job to progress
-            status = ddjvu_document_get_pageinfo_status(document, pageIndex, 0);
-        }
+        ddjvu_status_t status = DDJVU_JOB_NOTSTARTED;
+        waitUntil([&]() {
+            status = ddjvu_document_get_pageinfo(document, pageIndex, info);
+            return status >= DDJVU_JOB_OK;
+        });
         return status == DDJVU_JOB_OK;
     }
+
+    // DjVuLibre does not report what a decoded page holds; the JB2 mask
+    // and IW44 wavelet data come to about two bytes per native pixel
+    qint64 estimatedBytes(int pageIndex) const {
+        if (pageIndex < 0 || pageIndex >= pageInfos.size()) return 0;
+        return 2 * static_cast<qint64>(pageInfos[pageIndex].width) * pageInfos[pageIndex].height;
+    }
+
+    static int cachedPageLimit() {
+        return qMax(1, Settings::instance().value<int>("Advanced/DjvuDecodedPages", 8));
+    }
+
+    // Start decoding a page, or find it in the cache. Caller holds decodedMutex.
+    std::shared_ptr<ddjvu_page_t> lookupOrCreate(int pageIndex) {
+        auto it = decoded.find(pageIndex);
+        if (it != decoded.end()) {
+            it->lastUse = ++useClock;
+            return it->page;
+        }
+        ddjvu_page_t* handle = ddjvu_page_create_by_pageno(document, pageIndex);
+        if (!handle) return nullptr;
+        DecodedPage entry;
+        entry.page = std::shared_ptr<ddjvu_page_t>(handle, [](ddjvu_page_t* page) { ddjvu_page_release(page); });
+        entry.bytes = estimatedBytes(pageIndex);
+        entry.lastUse = ++useClock;
+        decoded.insert(pageIndex, entry);
+        trim(cachedPageLimit(), 0);
+        return entry.page;
+    }
+
+    // Drop least recently used pages until at most maxPages remain or
+    // bytes have been freed. Renders in progress keep their own reference.
+    // Caller holds decodedMutex.
+    qint64 trim(int maxPages, qint64 bytes) {
+        qint64 freed = 0;
+        while (!decoded.isEmpty() && (decoded.size() > maxPages || freed < bytes)) {
+            auto oldest = decoded.begin();
+            for (auto it = decoded.begin(); it != decoded.end(); ++it) {
+                if (it->lastUse < oldest->lastUse) oldest = it;
+            }
+            freed += oldest->bytes;
+            decoded.erase(oldest);
+        }
+        return freed;
+    }
+
+    qint64 decodedBytes() const {
+        QMutexLocker locker(&decodedMutex);
+        qint64 total = 0;
+        for (const DecodedPage& entry : decoded) {
+            total += entry.bytes;
+        }
+        return total;
+    }
 };
 
 DjvuDocument::DjvuDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
+    // Decoded pages are rebuilt from the file, so they go before primary caches
+    Private* priv = d.get();
+    d->memoryConsumerId = MemoryBudget::instance().registerDocumentConsumer(
+        "DjVu decoded pages", MemoryBudget::Priority::Low, MemoryBudget::documentId(this),
+        [priv]() { return priv->decodedBytes(); },
+        [priv](qint64 bytes) {
+            QMutexLocker locker(&priv->decodedMutex);
+            return priv->trim(0, bytes);
+        });
+
+    // Decode the pages the reader is heading for while the current one is read
+    connect(this, &Document::currentPageChanged, this, [this](int index) {
+        prefetchPages(index + 1, Settings::instance().value<int>("Advanced/DjvuPrefetchPages", 2));
+    });
     LOG_INFO("DjvuDocument created.");
 }
 
 DjvuDocument::~DjvuDocument()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     LOG_INFO("DjvuDocument destroyed.");
 }
 
 bool DjvuDocument::load(const QString& filePath, const QString& password)
 {
     // Close any previously loaded document
-    if (d->document) {
-        ddjvu_document_release(d->document);
-        d->document = nullptr;
-    }
-    if (d->context) {
-        ddjvu_context_release(d->context);
-        d->context = nullptr;
-    }
-    d->isLoaded = false;
     d->pages.clear();
+    d->close();
+    d->isLoaded = false;
+
+    LoadTrace trace(filePath, QStringLiteral("DjVu"));
+    trace.phase(LoadTrace::Io);
 
     // Initialize DjVuLibre context
     d->context = ddjvu_context_create("QuantilyxDoc");
@@ -132,18 +251,19 @@ bool DjvuDocument::load(const QString& filePath, const QString& password)
     d->document = ddjvu_document_create_by_filename_utf8(d->context, filePath.toUtf8().constData(), 0 /* no cache */);
     if (!d->document) {
         // Check for errors/messages immediately after creation attempt
-        d->handleMessages();
+        d->handleMessages(false);
         setLastError(tr("Failed to load DjVu document. It may be corrupted or password-protected (and password was incorrect)."));
         LOG_ERROR(lastError());
         return false;
     }
 
     // Wait for document header to be loaded
-    ddjvu_status_t status = ddjvu_document_decoding_status(d->document);
-    while (status < DDJVU_JOB_OK) {
-        d->handleMessages();
+    trace.phase(LoadTrace::Parse);
+    ddjvu_status_t status = DDJVU_JOB_NOTSTARTED;
+    d->waitUntil([this, &status]() {
         status = ddjvu_document_decoding_status(d->document);
-    }
+        return status >= DDJVU_JOB_OK;
+    });
 
     if (status != DDJVU_JOB_OK) {
         setLastError(tr("Error decoding DjVu document header."));
@@ -155,6 +275,7 @@ bool DjvuDocument::load(const QString& filePath, const QString& password)
     setFilePath(filePath);
 
     // Query document info (page count, global metadata)
+    trace.phase(LoadTrace::Metadata);
     if (!queryDocumentInfo()) {
         setLastError(tr("Failed to query DjVu document information."));
         LOG_ERROR(lastError());
@@ -162,7 +283,9 @@ bool DjvuDocument::load(const QString& filePath, const QString& password)
     }
 
     // Create DjvuPage objects
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -196,9 +319,7 @@ Page* DjvuDocument::page(int index) const
 {
     if (index >= 0 && index < d->pages.size()) {
         // Return raw pointer managed by unique_ptr.
-        // return d->pages[index].get(); // Placeholder - requires DjvuPage implementation
-        LOG_DEBUG("DjvuDocument::page: Requested page " << index << ", but DjvuPage not yet implemented.");
-        return nullptr; // For now, return null until DjvuPage is ready
+        return d->pages[index].get();
     }
     return nullptr;
 }
@@ -288,15 +409,69 @@ double DjvuDocument::averageCompressionRatio() const
 
 bool DjvuDocument::exportPageAsImage(int pageIndex, const QString& outputPath, const QString& format) const
 {
-    // This would involve creating a ddjvu_page_t, rendering it using ddjvu_page_render,
-    // and saving the resulting ddjvu_rect_t to an image file using external libraries
-    // (like Qt's image I/O or specific TIFF/PNG libraries).
-    // This is a complex operation involving raw buffer manipulation.
-    LOG_WARN("DjvuDocument::exportPageAsImage: Not yet implemented.");
-    Q_UNUSED(pageIndex);
-    Q_UNUSED(outputPath);
-    Q_UNUSED(format);
-    return false; // Placeholder
+    if (pageIndex < 0 || pageIndex >= d->pages.size()) {
+        LOG_ERROR("DjvuDocument::exportPageAsImage: Invalid page index " << pageIndex);
+        return false;
+    }
+
+    // At the page's native resolution, as scanned
+    DjvuPage* djvuPage = d->pages[pageIndex].get();
+    const QSize pixelSize = djvuPage->pixelSize();
+    QImage image = djvuPage->render(pixelSize.width(), pixelSize.height(), djvuPage->nativeDpi());
+    if (image.isNull()) {
+        LOG_ERROR("DjvuDocument::exportPageAsImage: Failed to render page " << pageIndex);
+        return false;
+    }
+    const int dotsPerMeter = qRound(djvuPage->nativeDpi() / 0.0254);
+    image.setDotsPerMeterX(dotsPerMeter);
+    image.setDotsPerMeterY(dotsPerMeter);
+    if (!image.save(outputPath, format.toLatin1().constData())) {
+        LOG_ERROR("DjvuDocument::exportPageAsImage: Failed to write " << outputPath);
+        return false;
+    }
+    LOG_INFO("DjvuDocument::exportPageAsImage: Exported page " << pageIndex << " to " << outputPath);
+    return true;
+}
+
+std::shared_ptr<ddjvu_page_s> DjvuDocument::decodedPage(int pageIndex) const
+{
+    if (!d->document || pageIndex < 0 || pageIndex >= d->pageCountVal) return nullptr;
+    std::shared_ptr<ddjvu_page_t> page;
+    {
+        QMutexLocker locker(&d->decodedMutex);
+        page = d->lookupOrCreate(pageIndex);
+    }
+    if (!page) return nullptr;
+
+    // Decoding runs in DjVuLibre's own thread; wait for it to finish
+    d->waitUntil([&page]() { return ddjvu_page_decoding_done(page.get()); });
+    if (ddjvu_page_decoding_error(page.get())) {
+        LOG_ERROR("DjvuDocument: Failed to decode page " << pageIndex);
+        QMutexLocker locker(&d->decodedMutex);
+        d->decoded.remove(pageIndex); // Let a later render try again
+        return nullptr;
+    }
+    return page;
+}
+
+void DjvuDocument::prefetchPages(int firstIndex, int count) const
+{
+    if (!d->document || count <= 0 || MemoryBudget::instance().isUnderPressure()) return;
+    const int lastIndex = qMin(firstIndex + qMin(count, Private::cachedPageLimit() - 1), d->pageCountVal) - 1;
+    {
+        QMutexLocker locker(&d->decodedMutex);
+        for (int i = qMax(0, firstIndex); i <= lastIndex; ++i) {
+            d->lookupOrCreate(i); // Returns at once; DjVuLibre decodes in the background
+        }
+    }
+    // Drain what has queued up so far without waiting on the decodes
+    QMutexLocker locker(&d->messageMutex);
+    d->handleMessages(false);
+}
+
+const ddjvu_format_s* DjvuDocument::pixelFormat() const
+{
+    return d->pixelFormat;
 }
 
 // --- Helpers ---
@@ -324,11 +499,16 @@ bool DjvuDocument::queryDocumentInfo()
     // Calculate overall bounding box by iterating pages
     // This requires getting size info for each page.
     QRectF overallBounds;
+    d->pageInfos.resize(d->pageCountVal);
     for (int i = 0; i < d->pageCountVal; ++i) {
-        ddjvu_pageinfo_t info;
+        ddjvu_pageinfo_t& info = d->pageInfos[i];
         if (d->getPageInfo(i, &info)) {
             QRectF pageBounds(0, 0, info.width, info.height);
             overallBounds = overallBounds.united(pageBounds);
+        } else {
+            info.width = info.height = 0;
+            info.dpi = 0;
+            info.rotation = 0;
         }
     }
     d->boundingBox = overallBounds;
@@ -348,9 +528,11 @@ void DjvuDocument::createPages()
     d->pages.clear();
     d->pages.reserve(d->pageCountVal);
     for (int i = 0; i < d->pageCountVal; ++i) {
-        // Create the page object. This requires DjvuPage to be implemented.
-        // pages.append(std::make_unique<DjvuPage>(this, i)); // Placeholder
-        LOG_DEBUG("DjvuDocument: Planned page " << i);
+        // Sizes as rendered, with the page's initial rotation applied
+        const ddjvu_pageinfo_t& info = d->pageInfos[i];
+        const bool sideways = info.rotation == 1 || info.rotation == 3; // 90 or 270 degrees
+        const QSize pixelSize = sideways ? QSize(info.height, info.width) : QSize(info.width, info.height);
+        d->pages.append(std::make_unique<DjvuPage>(this, i, pixelSize, info.dpi));
     }
     LOG_INFO("DjvuDocument: Created " << d->pages.size() << " page objects.");
 }
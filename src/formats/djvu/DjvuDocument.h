@@ -19,6 +19,8 @@
 struct ddjvu_context_s;
 struct ddjvu_document_s;
 struct ddjvu_pageinfo_s;
+struct ddjvu_page_s;
+struct ddjvu_format_s;
 
 namespace QuantilyxDoc {
 
@@ -29,6 +31,9 @@ class DjvuPage; // Forward declaration
  * 
  * Handles loading and parsing of DjVu files using the DjVuLibre library.
  * DjVu is excellent for multi-layered documents (text, background image, foreground mask).
+ * Decoded pages are kept in a small cache tracked by MemoryBudget and shared
+ * by every render of a page; the pages after the current one are decoded
+ * in the background (Advanced/DjvuPrefetchPages) before they are scrolled to.
  */
 class DjvuDocument : public Document
 {
@@ -119,9 +124,19 @@ signals:
     void djvuLoaded();
 
 private:
+    friend class DjvuPage; // Renders through the decoded page cache
+
     class Private;
     std::unique_ptr<Private> d;
 
+    // Decoded page from the cache, decoding it first if needed; blocks
+    // until decoding ends. Null on failure. Safe from any thread.
+    std::shared_ptr<ddjvu_page_s> decodedPage(int pageIndex) const;
+    // Start decoding pages into the cache without waiting for them
+    void prefetchPages(int firstIndex, int count) const;
+    // 32-bit pixel layout matching ImageBufferPool::PipelineFormat
+    const ddjvu_format_s* pixelFormat() const;
+
     // Helper to initialize DjVuLibre context and load document
     bool initializeAndLoadDocument(const QString& filePath);
     // Helper to query document info (page count, global metadata)
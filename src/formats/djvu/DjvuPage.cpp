@@ -0,0 +1,128 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DjvuPage.h"
+#include "DjvuDocument.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/Logger.h"
+#include <QImage>
+#include <QVariantMap>
+#include <ddjvuapi.h>
+
+namespace QuantilyxDoc {
+
+class DjvuPage::Private {
+public:
+    Private(DjvuDocument* doc, int pIndex, const QSize& pixels, int resolution)
+        : document(doc), pageIndexVal(pIndex), pixelSizeVal(pixels), dpi(resolution) {}
+
+    DjvuDocument* document;
+    int pageIndexVal;
+    QSize pixelSizeVal;
+    int dpi;
+
+    // Rasterize one region of the page. DjVuLibre composites only the
+    // pixels of renderRect and takes the reduction from the ratio of
+    // pageRect to the page's native size.
+    QImage renderRegion(ddjvu_render_mode_t mode, const QSizeF& pageSize, const QRectF& rect, int width, int height) const {
+        if (rect.isEmpty() || pageSize.isEmpty() || width <= 0 || height <= 0) return QImage();
+        const std::shared_ptr<ddjvu_page_s> page = document->decodedPage(pageIndexVal);
+        if (!page) return QImage();
+
+        // One uniform scale so neighbouring tiles line up exactly
+        const qreal scale = qMin(width / rect.width(), height / rect.height());
+        ddjvu_rect_t pageRect;
+        pageRect.x = 0;
+        pageRect.y = 0;
+        pageRect.w = static_cast<unsigned int>(qMax(1, qRound(pageSize.width() * scale)));
+        pageRect.h = static_cast<unsigned int>(qMax(1, qRound(pageSize.height() * scale)));
+        ddjvu_rect_t renderRect;
+        renderRect.x = qRound(rect.left() * scale);
+        renderRect.y = qRound(rect.top() * scale);
+        renderRect.w = static_cast<unsigned int>(width);
+        renderRect.h = static_cast<unsigned int>(height);
+
+        QImage image = ImageBufferPool::instance().acquire(QSize(width, height));
+        if (image.isNull()) return QImage();
+        if (!ddjvu_page_render(page.get(), mode, &pageRect, &renderRect, document->pixelFormat(),
+                               static_cast<unsigned long>(image.bytesPerLine()), reinterpret_cast<char*>(image.bits()))) {
+            return QImage(); // Nothing to draw in this mode, or decoding failed
+        }
+        return image;
+    }
+};
+
+DjvuPage::DjvuPage(DjvuDocument* document, int pageIndex, const QSize& pixelSize, int dpi, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(document, pageIndex, pixelSize, dpi > 0 ? dpi : 300))
+{
+    // Points are 1/72 inch
+    setSize(QSizeF(pixelSize.width() * 72.0 / d->dpi, pixelSize.height() * 72.0 / d->dpi));
+    LOG_DEBUG("DjvuPage created for index " << pageIndex << ", " << pixelSize << " px at " << d->dpi << " dpi");
+}
+
+DjvuPage::~DjvuPage()
+{
+    LOG_DEBUG("DjvuPage for index " << d->pageIndexVal << " destroyed.");
+}
+
+QImage DjvuPage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage DjvuPage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    QImage image = d->renderRegion(DDJVU_RENDER_COLOR, size(), rect, width, height);
+    if (image.isNull()) {
+        LOG_ERROR("Failed to render rectangle " << rect << " of DjvuPage " << d->pageIndexVal);
+        return QImage();
+    }
+    LOG_DEBUG("Rendered rectangle " << rect << " from DjvuPage " << d->pageIndexVal << " to image size " << image.size());
+    return image;
+}
+
+bool DjvuPage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QImage DjvuPage::renderDraft(const QRectF& rect, int width, int height)
+{
+    // The bilevel mask alone skips compositing the background layer; pages
+    // without one (photos) fall back to the full render
+    const QSizeF pageSize = size();
+    const QRectF region = rect.isEmpty() ? QRectF(QPointF(0, 0), pageSize) : rect;
+    QImage image = d->renderRegion(DDJVU_RENDER_BLACK, pageSize, region, width, height);
+    if (!image.isNull()) return image;
+    return Page::renderDraft(rect, width, height);
+}
+
+QVariantMap DjvuPage::metadata() const
+{
+    QVariantMap map;
+    map["PageIndex"] = d->pageIndexVal;
+    map["PixelWidth"] = d->pixelSizeVal.width();
+    map["PixelHeight"] = d->pixelSizeVal.height();
+    map["Dpi"] = d->dpi;
+    return map;
+}
+
+QSize DjvuPage::pixelSize() const
+{
+    return d->pixelSizeVal;
+}
+
+int DjvuPage::nativeDpi() const
+{
+    return d->dpi;
+}
+
+} // namespace QuantilyxDoc
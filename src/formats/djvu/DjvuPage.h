@@ -0,0 +1,75 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DJVUPAGE_H
+#define QUANTILYX_DJVUPAGE_H
+
+#include "../../core/Page.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class DjvuDocument;
+
+/**
+ * @brief One page of a DjVu document, rendered with DjVuLibre.
+ *
+ * Renders only the requested region, at the reduction DjVuLibre picks for
+ * the scale, so tiles of a zoomed-in scan cost what they show and a
+ * thumbnail never composites the page at full resolution. The decoded page
+ * comes from its document's cache, shared by every render of the page.
+ */
+class DjvuPage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent DjvuDocument.
+     * @param pageIndex The 0-based index of this page.
+     * @param pixelSize Page size in pixels at its native resolution, rotation applied.
+     * @param dpi The page's native resolution.
+     * @param parent Parent object.
+     */
+    DjvuPage(DjvuDocument* document, int pageIndex, const QSize& pixelSize, int dpi, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~DjvuPage() override;
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QImage renderDraft(const QRectF& rect, int width, int height) override;
+    QVariantMap metadata() const override;
+
+    // --- DjVu-Specific Page Properties ---
+    /**
+     * @brief Get the page size at its native resolution.
+     * @return Size in pixels.
+     */
+    QSize pixelSize() const;
+
+    /**
+     * @brief Get the page's native resolution.
+     * @return Resolution in dots per inch.
+     */
+    int nativeDpi() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DJVUPAGE_H
@@ -9,7 +9,15 @@
  */
 #include "EpubDocument.h"
 #include "EpubPage.h" // Assuming this will be created
+#include "../../core/FontRegistry.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/MetadataDatabase.h"
+#include "../../core/ReflowablePage.h"
+#include "../../core/Settings.h"
+#include "../../core/ThreadPool.h"
+#include "../../core/ZipArchive.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
@@ -21,7 +29,13 @@
 #include <QRegularExpression>
 #include <QUuid> // For generating temporary directory names if needed
 #include <QDebug>
-#include <zip.h> // Include libzip header
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QWaitCondition>
+#include <atomic>
 
 namespace QuantilyxDoc {
 
@@ -30,14 +44,30 @@ namespace QuantilyxDoc {
 
 class EpubDocument::Private {
 public:
-    Private() : zipArchive(nullptr), isLoaded(false) {}
-    ~Private() {
-        if (zipArchive) {
-            zip_close(zipArchive);
-        }
+    Private() : isLoaded(false), paginated(false) {
+        options.width = qMax(100, Settings::instance().value<int>("Display/EpubLayoutWidth", 600));
+        const QString font = Settings::instance().value<QString>("Display/EpubFont", QString());
+        if (!font.isEmpty()) options.font.fromString(font);
     }
 
-    zip_t* zipArchive;
+    // One background pagination pass, shared with its tasks; canceled
+    // before the pages it lays out go away
+    struct Pagination {
+        std::atomic<bool> canceled{false};
+        std::atomic<int> remaining{0};
+        int inFlight = 0;
+        QMutex mutex;
+        QWaitCondition idle;
+
+        void wait() {
+            QMutexLocker locker(&mutex);
+            while (inFlight > 0) {
+                idle.wait(&mutex);
+            }
+        }
+    };
+
+    ZipArchive archive; // Entry index plus one libzip handle per concurrent reader
     QString containerPath; // Path to META-INF/container.xml inside the archive
     QString packagePath;   // Path to the .opf file inside the archive
     QString navigationPath; // Path to nav.xhtml or toc.ncx inside the archive
@@ -48,40 +78,52 @@ public:
     QStringList spine;               // List of manifest IDs in reading order
     QVariantList toc;              // Parsed TOC structure
     QList<std::unique_ptr<EpubPage>> pages; // Own the page objects
+    mutable QMutex pagesMutex; // Guards pages against the memory consumer
+    int memoryConsumerId;
     QStringList embeddedFontsList;
     QStringList imagePathsList;
     QList<QUrl> hyperlinksList;
+    mutable QMutex optionsMutex; // Protects options; pages read them on worker threads
+    LayoutOptions options;
+    std::shared_ptr<Pagination> pagination;
+    bool paginated;
+
+    // Stop the running pass and wait for chapters being laid out
+    void cancelPagination() {
+        if (!pagination) return;
+        pagination->canceled = true;
+        pagination->wait();
+        pagination.reset();
+        paginated = false;
+    }
 
-    // Helper to read a file from the ZIP archive
-    QByteArray readFileFromZip(const QString& filePath) const {
-        if (!zipArchive) return QByteArray();
-
-        QString pathInZip = filePath;
-        if (pathInZip.startsWith("/")) pathInZip.remove(0, 1); // Remove leading slash if present
-
-        zip_stat_t stat;
-        int result = zip_stat(zipArchive, pathInZip.toUtf8().constData(), 0, &stat);
-        if (result < 0) {
-            LOG_ERROR("EpubDocument: Failed to stat file in archive: " << filePath);
-            return QByteArray();
-        }
-
-        zip_file_t* file = zip_fopen(zipArchive, pathInZip.toUtf8().constData(), 0);
-        if (!file) {
-            LOG_ERROR("EpubDocument: Failed to open file in archive: " << filePath);
-            return QByteArray();
-        }
+    // Names a stored pagination: the book, then the options and archive
+    // contents it was laid out from, so a new edition under the same
+    // identifier or new layout code is paginated afresh
+    static constexpr int PaginationVersion = 1;
 
-        QByteArray data(stat.size, 0);
-        zip_int64_t bytesRead = zip_fread(file, data.data(), stat.size);
-        zip_fclose(file);
+    QString paginationBookId() const {
+        return uid.isEmpty() ? archive.filePath() : uid;
+    }
 
-        if (bytesRead != static_cast<zip_int64_t>(stat.size)) {
-            LOG_ERROR("EpubDocument: Failed to read full file content: " << filePath);
-            return QByteArray();
+    QByteArray paginationHash(const LayoutOptions& layout) const {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(QByteArray::number(PaginationVersion));
+        hash.addData(QByteArray::number(layout.width, 'g', 12));
+        hash.addData(layout.font.toString().toUtf8());
+        for (const QString& name : archive.entryNames()) {
+            if (const ZipArchive::Entry* entry = archive.entry(name)) {
+                hash.addData(name.toUtf8());
+                hash.addData(QByteArray::number(entry->size));
+            }
         }
+        return hash.result();
+    }
 
-        return data;
+    // Helper to read a file from the ZIP archive; safe from any thread
+    QByteArray readFileFromZip(const QString& filePath) const {
+        if (!archive.isOpen()) return QByteArray();
+        return archive.read(filePath);
     }
 
     // Helper to parse container.xml to find the package.opf path
@@ -194,7 +236,8 @@ public:
                 manifest.insert(id, href);
                 LOG_DEBUG("EpubDocument: Manifest item - ID: " << id << ", HREF: " << href << ", Type: " << mediaType);
                 // Identify embedded fonts and images
-                if (mediaType.startsWith("font/")) {
+                if (mediaType.startsWith("font/") || mediaType == QLatin1String("application/vnd.ms-opentype")
+                    || mediaType.startsWith("application/font-") || mediaType.startsWith("application/x-font-")) {
                     embeddedFontsList.append(href);
                 } else if (mediaType.startsWith("image/")) {
                     imagePathsList.append(href);
@@ -401,19 +444,37 @@ public:
         return list;
     }
 
+    // Hand the book's fonts to FontRegistry, which shares them with other
+    // books embedding the same files
+    void registerFonts(const EpubDocument* doc) {
+        const QString baseDir = QFileInfo(packagePath).path();
+        int families = 0;
+        for (const QString& href : embeddedFontsList) {
+            const QString path = QUrl::fromPercentEncoding(href.toUtf8());
+            const QString fontPath = (baseDir.isEmpty() || baseDir == QLatin1String(".")) ? path : baseDir + QLatin1Char('/') + path;
+            families += FontRegistry::instance().addFont(archive.read(ZipArchive::normalizePath(fontPath)), doc).size();
+        }
+        if (!embeddedFontsList.isEmpty()) {
+            LOG_DEBUG("EpubDocument: " << embeddedFontsList.size() << " embedded fonts provide " << families << " families");
+        }
+    }
+
     // Helper to create EpubPage objects based on the spine order
     void createPages(EpubDocument* doc) {
+        QMutexLocker locker(&pagesMutex);
         pages.clear();
         pages.reserve(spine.size());
+        // Manifest hrefs are relative to the package document
+        const QString baseDir = QFileInfo(packagePath).path();
         for (int i = 0; i < spine.size(); ++i) {
             QString manifestId = spine[i];
-            QString htmlPath = manifest.value(manifestId);
-            if (!htmlPath.isEmpty()) {
-                // Create the page object. This requires EpubPage to be implemented.
-                // For now, let's assume a factory function exists or EpubPage can be constructed directly if it has access to the doc/zip.
-                // A better design might be for EpubPage to hold a reference to EpubDocument and fetch its content on demand.
-                // pages.append(std::make_unique<EpubPage>(doc, i, htmlPath)); // Placeholder
-                LOG_DEBUG("EpubDocument: Planned page " << i << " from manifest ID " << manifestId << ", path: " << htmlPath);
+            QString href = manifest.value(manifestId);
+            if (!href.isEmpty()) {
+                href = QUrl::fromPercentEncoding(href.toUtf8());
+                const QString htmlPath = (baseDir.isEmpty() || baseDir == QLatin1String(".")) ? href : baseDir + QLatin1Char('/') + href;
+                // Pages read their HTML lazily, so creating them is cheap
+                pages.append(std::make_unique<EpubPage>(doc, pages.size(), htmlPath));
+                LOG_DEBUG("EpubDocument: Created page " << i << " from manifest ID " << manifestId << ", path: " << htmlPath);
             } else {
                 LOG_WARN("EpubDocument: Spine item ID '" << manifestId << "' not found in manifest!");
             }
@@ -426,11 +487,15 @@ EpubDocument::EpubDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
+    d->memoryConsumerId = ReflowablePage::registerLayoutConsumer("EPUB chapter layouts", this, &d->pagesMutex, &d->pages);
     LOG_INFO("EpubDocument created.");
 }
 
 EpubDocument::~EpubDocument()
 {
+    d->cancelPagination(); // Tasks in flight read the pages
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+    FontRegistry::instance().release(this);
     LOG_INFO("EpubDocument destroyed.");
 }
 
@@ -439,20 +504,24 @@ bool EpubDocument::load(const QString& filePath, const QString& password)
     Q_UNUSED(password); // EPUBs typically don't use archive-level passwords like ZIPs often do
 
     // Close any previously loaded document
-    if (d->zipArchive) {
-        zip_close(d->zipArchive);
-        d->zipArchive = nullptr;
-    }
+    d->cancelPagination();
+    d->archive.close();
     d->isLoaded = false;
-    d->pages.clear();
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+    }
+    d->embeddedFontsList.clear();
+    d->imagePathsList.clear();
+    FontRegistry::instance().release(this);
+
+    LoadTrace trace(filePath, QStringLiteral("EPUB"));
+    trace.phase(LoadTrace::Io);
 
     // Open the EPUB file as a ZIP archive
-    int zipError;
-    d->zipArchive = zip_open(filePath.toUtf8().constData(), ZIP_RDONLY, &zipError);
-    if (!d->zipArchive) {
-        char errorBuffer[256];
-        zip_error_to_str(errorBuffer, sizeof(errorBuffer), zipError, errno);
-        setLastError(tr("Failed to open EPUB file as ZIP archive: %1").arg(errorBuffer));
+    QString zipError;
+    if (!d->archive.open(filePath, &zipError)) {
+        setLastError(tr("Failed to open EPUB file as ZIP archive: %1").arg(zipError));
         LOG_ERROR(lastError());
         return false;
     }
@@ -461,6 +530,7 @@ bool EpubDocument::load(const QString& filePath, const QString& password)
     setFilePath(filePath);
 
     // 1. Parse container.xml to find package.opf
+    trace.phase(LoadTrace::Parse);
     if (!d->parseContainer()) {
         setLastError(tr("Failed to parse EPUB container.xml."));
         LOG_ERROR(lastError());
@@ -475,13 +545,16 @@ bool EpubDocument::load(const QString& filePath, const QString& password)
     }
 
     // 3. Parse navigation file (nav.xhtml or toc.ncx) to get TOC
+    trace.phase(LoadTrace::Toc);
     if (!d->parseNavigation()) {
         LOG_WARN("EpubDocument: Failed to parse navigation file, TOC might be incomplete.");
         // Don't fail the load entirely for a TOC parse error, just warn.
     }
 
     // 4. Create EpubPage objects based on the spine order
+    trace.phase(LoadTrace::Pages);
     d->createPages(this); // Pass 'this' pointer to allow pages to access the document's ZIP archive
+    d->registerFonts(this); // Before any chapter is laid out
 
     // Populate base Document metadata from EPUB metadata (if parsed from OPF)
     // This would involve reading <dc:title>, <dc:creator>, etc. from the OPF's <metadata> section.
@@ -494,6 +567,11 @@ bool EpubDocument::load(const QString& filePath, const QString& password)
     d->isLoaded = true;
     setState(Loaded);
     emit epubLoaded(); // Emit specific signal for EPUB loading
+
+    // 5. Lay the chapters out in the background, so page sizes are ready
+    // without parsing every chapter before the first one is shown
+    startPagination();
+    trace.finish();
     LOG_INFO("Successfully loaded EPUB document: " << filePath << " (Pages: " << pageCount() << ", TOC items: " << d->toc.size() << ")");
     return true;
 }
@@ -524,11 +602,8 @@ int EpubDocument::pageCount() const
 Page* EpubDocument::page(int index) const
 {
     if (index >= 0 && index < d->pages.size()) {
-        // Return raw pointer managed by unique_ptr. The page needs access to the ZIP archive to render/fetch content.
-        // This requires EpubPage to be implemented and correctly constructed with access to EpubDocument's Private members.
-        // return d->pages[index].get(); // Placeholder - requires EpubPage implementation
-        LOG_DEBUG("EpubDocument::page: Requested page " << index << ", but EpubPage not yet implemented.");
-        return nullptr; // For now, return null until EpubPage is ready
+        // Return raw pointer managed by unique_ptr. The page fetches its content through getFileContent().
+        return d->pages[index].get();
     }
     return nullptr;
 }
@@ -590,6 +665,12 @@ QByteArray EpubDocument::getFileContent(const QString& filePath) const
     return d->readFileFromZip(filePath);
 }
 
+std::unique_ptr<QIODevice> EpubDocument::openFileStream(const QString& filePath) const
+{
+    if (!d->archive.isOpen()) return nullptr;
+    return d->archive.openStream(filePath);
+}
+
 QStringList EpubDocument::embeddedFonts() const
 {
     return d->embeddedFontsList;
@@ -618,4 +699,93 @@ QList<QUrl> EpubDocument::hyperlinks() const
 // --- Helpers (defined in Private class) ---
 // parseOpf, parseNavigation, etc. are already defined within the Private class above.
 
+EpubDocument::LayoutOptions EpubDocument::layoutOptions() const
+{
+    QMutexLocker locker(&d->optionsMutex);
+    return d->options;
+}
+
+void EpubDocument::setLayoutOptions(const LayoutOptions& options)
+{
+    {
+        QMutexLocker locker(&d->optionsMutex);
+        if (qFuzzyCompare(d->options.width, options.width) && d->options.font == options.font) return;
+        d->options = options;
+        d->options.width = qMax<qreal>(100, options.width);
+    }
+    if (d->isLoaded) startPagination();
+}
+
+bool EpubDocument::isPaginated() const
+{
+    return d->paginated;
+}
+
+void EpubDocument::startPagination()
+{
+    d->cancelPagination();
+    if (d->pages.isEmpty()) {
+        d->paginated = true;
+        emit paginationFinished();
+        return;
+    }
+
+    // A book opened before with these options has its page sizes stored;
+    // chapters are then laid out only as they are rendered
+    const QString bookId = d->paginationBookId();
+    const QByteArray layoutHash = d->paginationHash(layoutOptions());
+    const QVector<QSizeF> storedSizes = MetadataDatabase::instance().retrievePagination(bookId, layoutHash);
+    if (storedSizes.size() == d->pages.size()) {
+        for (int i = 0; i < d->pages.size(); ++i) {
+            d->pages[i]->setSize(storedSizes[i]);
+        }
+        d->paginated = true;
+        LOG_DEBUG("EpubDocument: Restored the pagination of " << d->pages.size() << " chapters");
+        emit pageSizesChanged();
+        emit paginationFinished();
+        return;
+    }
+
+    std::shared_ptr<Private::Pagination> pagination = std::make_shared<Private::Pagination>();
+    pagination->remaining = d->pages.size();
+    pagination->inFlight = d->pages.size();
+    d->pagination = pagination;
+
+    // One task per chapter in spine order, so chapters parse in parallel and
+    // the first ones are ready first. A chapter a render needs sooner is
+    // laid out by that render; the task then finds the layout cached.
+    QPointer<EpubDocument> guard(this);
+    for (const std::unique_ptr<EpubPage>& pagePtr : d->pages) {
+        EpubPage* page = pagePtr.get();
+        ThreadPool::instance().submitDetached([this, guard, pagination, page, bookId, layoutHash]() {
+            const QSizeF size = pagination->canceled ? QSizeF() : page->ensureLayout();
+            const bool last = --pagination->remaining == 0;
+            if (!pagination->canceled) {
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [this, guard, pagination, page, size, last, bookId, layoutHash]() {
+                    // The page is only touched while its pass is current
+                    if (!guard || pagination->canceled) return;
+                    if (!size.isEmpty()) page->setSize(size);
+                    if (last && d->pagination == pagination) {
+                        d->paginated = true;
+                        LOG_DEBUG("EpubDocument: Paginated " << d->pages.size() << " chapters");
+                        QVector<QSizeF> sizes;
+                        sizes.reserve(d->pages.size());
+                        for (const std::unique_ptr<EpubPage>& laidOut : d->pages) {
+                            sizes.append(laidOut->size());
+                        }
+                        ThreadPool::ioInstance().submitDetached([bookId, layoutHash, sizes]() {
+                            MetadataDatabase::instance().storePagination(bookId, layoutHash, sizes);
+                        }, Task::Priority::Low);
+                        emit pageSizesChanged();
+                        emit paginationFinished();
+                    }
+                }, Qt::QueuedConnection);
+            }
+            QMutexLocker locker(&pagination->mutex);
+            --pagination->inFlight;
+            pagination->idle.wakeAll();
+        }, Task::Priority::Low);
+    }
+}
+
 } // namespace QuantilyxDoc
\ No newline at end of file
@@ -15,6 +15,8 @@
 #include <QList>
 #include <QMap>
 #include <QDomDocument> // For parsing OPF and NCX
+#include <QFont>
+#include <QIODevice>
 #include <QUrl>         // For resource paths
 
 namespace QuantilyxDoc {
@@ -38,6 +40,16 @@ public:
      */
     explicit EpubDocument(QObject* parent = nullptr);
 
+    /**
+     * @brief How reflowable chapters are laid out.
+     * Chapters are laid out in points at this width and scaled for zoom,
+     * so only a change here lays them out again.
+     */
+    struct LayoutOptions {
+        qreal width = 600;  ///< Layout width in points
+        QFont font;         ///< Default font for text without a CSS font
+    };
+
     /**
      * @brief Destructor.
      */
@@ -93,6 +105,17 @@ public:
      */
     QByteArray getFileContent(const QString& filePath) const;
 
+    /**
+     * @brief Open a file within the EPUB archive for streaming reads.
+     * The file is decompressed in chunks as it is read, so large fonts,
+     * media and images never have to be held in memory whole. Safe to
+     * call from any thread; the device must be destroyed before the
+     * document is reloaded.
+     * @param filePath Path of the file inside the archive.
+     * @return Sequential read-only device, or null if the file is missing.
+     */
+    std::unique_ptr<QIODevice> openFileStream(const QString& filePath) const;
+
     /**
      * @brief Get the list of all embedded fonts.
      * @return List of font file paths.
@@ -123,12 +146,41 @@ public:
      */
     QList<QUrl> hyperlinks() const;
 
+    // --- Layout ---
+    /**
+     * @brief Get the current layout options.
+     * Defaults come from Display/EpubLayoutWidth and Display/EpubFont.
+     * Safe to call from any thread.
+     * @return Layout options.
+     */
+    LayoutOptions layoutOptions() const;
+
+    /**
+     * @brief Change the layout options and paginate the spine again in the background.
+     * Page sizes are stored in MetadataDatabase per book and options once
+     * paginated, and restored from there at once the next time.
+     * @param options New options.
+     */
+    void setLayoutOptions(const LayoutOptions& options);
+
+    /**
+     * @brief Check if every chapter has been laid out with the current options.
+     * @return True once paginationFinished() has been emitted.
+     */
+    bool isPaginated() const;
+
 signals:
     /**
      * @brief Emitted when the EPUB file is fully loaded and parsed.
      */
     void epubLoaded();
 
+    /**
+     * @brief Emitted when background pagination has laid out every chapter
+     * and the page sizes are final.
+     */
+    void paginationFinished();
+
 private:
     class Private;
     std::unique_ptr<Private> d;
@@ -139,6 +191,8 @@ private:
     bool parseNavigation(const QDomDocument& navDoc);
     // Helper to create EpubPage objects based on spine order
     void createPages();
+    // Lay every chapter out on the CPU pool and apply the sizes on this thread
+    void startPagination();
 };
 
 } // namespace QuantilyxDoc
@@ -10,7 +10,7 @@
 #ifndef QUANTILYX_EPUBPAGE_H
 #define QUANTILYX_EPUBPAGE_H
 
-#include "../../core/Page.h"
+#include "../../core/ReflowablePage.h"
 #include <memory>
 #include <QSizeF>
 #include <QRectF>
@@ -24,9 +24,11 @@ class EpubDocument;
  * @brief EPUB page implementation.
  * 
  * Represents a single content document (usually an XHTML file) within an EPUB.
- * Handles rendering the HTML content and potentially extracting text.
+ * The chapter is laid out at the width and font of the document's layout
+ * options; a change of either lays it out again, a zoom change only scales
+ * the layout.
  */
-class EpubPage : public Page
+class EpubPage : public ReflowablePage
 {
     Q_OBJECT
 
@@ -46,8 +48,6 @@ public:
     ~EpubPage() override;
 
     // --- Page Interface Implementation ---
-    QImage render(int width, int height, int dpi = 72) override;
-    QString text() const override;
     QList<QRectF> searchText(const QString& text, bool caseSensitive = false, bool wholeWords = false) const override;
     QObject* hitTest(const QPointF& position) const override; // Might be complex for HTML
     QList<QObject*> links() const override; // Extract hyperlinks from the HTML content
@@ -97,7 +97,14 @@ signals:
      */
     void contentChanged();
 
+protected:
+    std::unique_ptr<LayoutDocument> createLayout() const override;
+    qreal layoutWidth() const override;
+    QString layoutKey() const override;
+
 private:
+    friend class EpubDocument; // Applies sizes from background pagination
+
     class Private;
     std::unique_ptr<Private> d;
 };
@@ -1,7 +1,7 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
@@ -9,86 +9,319 @@
  */
 #include "Fb2Document.h"
 #include "Fb2Page.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/ReflowablePage.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSaveFile>
 #include <QXmlStreamReader>
-#include <QBuffer>
-#include <QBase64Decoder>
 #include <QDebug>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Where a <binary> element's base64 text lies in the file
+struct BinaryRef {
+    qint64 offset = 0;
+    qint64 length = 0;
+    QString contentType;
+};
+
+// The href of an image or link, whatever prefix the xlink namespace has
+QString hrefOf(const QXmlStreamAttributes& attributes)
+{
+    for (const QXmlStreamAttribute& attribute : attributes) {
+        if (attribute.name() == QLatin1String("href")) return attribute.value().toString();
+    }
+    return QString();
+}
+
+QString imageHtml(const QXmlStreamAttributes& attributes)
+{
+    const QString href = hrefOf(attributes);
+    if (!href.startsWith(QLatin1Char('#'))) return QString(); // External images are not fetched
+    return QStringLiteral("<img src=\"fb2:%1\"/>").arg(href.mid(1).toHtmlEscaped());
+}
+
+// FictionBook body markup to the HTML subset QTextDocument renders. Every
+// function is entered on a start element and returns past its end.
+class Fb2HtmlWriter
+{
+public:
+    explicit Fb2HtmlWriter(QXmlStreamReader& reader) : xml(reader) {}
+
+    // Mixed content: text with emphasis, links and inline images
+    QString inlineHtml() {
+        QString html;
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isCharacters()) {
+                html += xml.text().toString().toHtmlEscaped();
+            } else if (xml.isEndElement()) {
+                break;
+            } else if (xml.isStartElement()) {
+                const QStringRef name = xml.name();
+                if (name == QLatin1String("strong")) html += QStringLiteral("<b>") + inlineHtml() + QStringLiteral("</b>");
+                else if (name == QLatin1String("emphasis")) html += QStringLiteral("<i>") + inlineHtml() + QStringLiteral("</i>");
+                else if (name == QLatin1String("strikethrough")) html += QStringLiteral("<s>") + inlineHtml() + QStringLiteral("</s>");
+                else if (name == QLatin1String("sub")) html += QStringLiteral("<sub>") + inlineHtml() + QStringLiteral("</sub>");
+                else if (name == QLatin1String("sup")) html += QStringLiteral("<sup>") + inlineHtml() + QStringLiteral("</sup>");
+                else if (name == QLatin1String("code")) html += QStringLiteral("<code>") + inlineHtml() + QStringLiteral("</code>");
+                else if (name == QLatin1String("a")) {
+                    const QString href = hrefOf(xml.attributes()).toHtmlEscaped();
+                    html += QStringLiteral("<a href=\"%1\">").arg(href) + inlineHtml() + QStringLiteral("</a>");
+                } else if (name == QLatin1String("image")) {
+                    html += imageHtml(xml.attributes());
+                    xml.skipCurrentElement();
+                } else {
+                    html += inlineHtml(); // Unknown inline markup keeps its text
+                }
+            }
+        }
+        return html;
+    }
+
+    // A title's paragraphs, one heading
+    QString titleHtml(int level) {
+        QStringList lines;
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("p")) lines.append(inlineHtml());
+            else xml.skipCurrentElement();
+        }
+        if (firstTitle.isEmpty()) {
+            for (const QString& line : lines) {
+                if (!firstTitle.isEmpty()) firstTitle += QLatin1Char(' ');
+                firstTitle += plainText(line);
+            }
+        }
+        return QStringLiteral("<h%1 align=\"center\">%2</h%1>").arg(qBound(1, level, 6)).arg(lines.join(QStringLiteral("<br/>")));
+    }
+
+    QString childrenHtml(int depth) {
+        QString html;
+        while (xml.readNextStartElement()) html += blockHtml(depth);
+        return html;
+    }
+
+    QString sectionHtml(int depth) {
+        QString html;
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("title")) html += titleHtml(depth);
+            else html += blockHtml(depth);
+        }
+        return html;
+    }
+
+    QString blockHtml(int depth) {
+        const QStringRef name = xml.name();
+        if (name == QLatin1String("p")) return QStringLiteral("<p>") + inlineHtml() + QStringLiteral("</p>");
+        if (name == QLatin1String("section")) return sectionHtml(depth + 1);
+        if (name == QLatin1String("empty-line")) {
+            xml.skipCurrentElement();
+            return QStringLiteral("<br/>");
+        }
+        if (name == QLatin1String("image")) {
+            const QString image = imageHtml(xml.attributes());
+            xml.skipCurrentElement();
+            return image.isEmpty() ? QString() : QStringLiteral("<p align=\"center\">") + image + QStringLiteral("</p>");
+        }
+        if (name == QLatin1String("subtitle")) return QStringLiteral("<h5 align=\"center\">") + inlineHtml() + QStringLiteral("</h5>");
+        if (name == QLatin1String("title")) return titleHtml(5);
+        if (name == QLatin1String("text-author")) return QStringLiteral("<p align=\"right\"><i>") + inlineHtml() + QStringLiteral("</i></p>");
+        if (name == QLatin1String("date")) return QStringLiteral("<p align=\"right\">") + inlineHtml() + QStringLiteral("</p>");
+        if (name == QLatin1String("v")) return inlineHtml() + QStringLiteral("<br/>");
+        if (name == QLatin1String("stanza")) return QStringLiteral("<p>") + childrenHtml(depth) + QStringLiteral("</p>");
+        if (name == QLatin1String("epigraph") || name == QLatin1String("cite") || name == QLatin1String("poem")
+            || name == QLatin1String("annotation")) {
+            return QStringLiteral("<blockquote>") + childrenHtml(depth) + QStringLiteral("</blockquote>");
+        }
+        if (name == QLatin1String("table")) {
+            return QStringLiteral("<table border=\"1\" cellspacing=\"0\" cellpadding=\"4\">") + childrenHtml(depth) + QStringLiteral("</table>");
+        }
+        if (name == QLatin1String("tr")) return QStringLiteral("<tr>") + childrenHtml(depth) + QStringLiteral("</tr>");
+        if (name == QLatin1String("td")) return QStringLiteral("<td>") + inlineHtml() + QStringLiteral("</td>");
+        if (name == QLatin1String("th")) return QStringLiteral("<th>") + inlineHtml() + QStringLiteral("</th>");
+        return childrenHtml(depth); // Unknown containers keep their content
+    }
+
+    QString firstTitle; // Plain text of the first title written since cleared
+
+private:
+    // Tags stripped, for titles; the markup is simple enough for that
+    static QString plainText(const QString& html) {
+        static const QRegularExpression tag(QStringLiteral("<[^>]*>"));
+        QString text = html;
+        text.remove(tag);
+        return text.replace(QLatin1String("&lt;"), QLatin1String("<")).replace(QLatin1String("&gt;"), QLatin1String(">"))
+                   .replace(QLatin1String("&quot;"), QLatin1String("\"")).replace(QLatin1String("&amp;"), QLatin1String("&"));
+    }
+
+    QXmlStreamReader& xml;
+};
+
+} // namespace
+
 class Fb2Document::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(0) {}
+    Private() : isLoaded(false), pageCountVal(0), memoryConsumerId(0) {}
     ~Private() = default;
 
+    struct Section {
+        QString html;
+        QString title;
+    };
+
     bool isLoaded;
     int pageCountVal;
     QString title;
     QStringList authors;
     QString genre;
     QString bookId;
-    QMap<QString, QByteArray> embeddedImages; // ID -> image data
+    QString coverImageId;
+    std::shared_ptr<MappedFile> mapping; // The file; binaries are decoded from it on demand
+    QHash<QString, BinaryRef> binaries;  // ID -> where its base64 is
+    QStringList binaryOrder;             // IDs in file order
+    QVector<Section> sections;
     QList<std::unique_ptr<Fb2Page>> pages;
-    QString fb2Content;
-
-    // Helper to parse the FB2 XML structure
-    bool parseFb2Xml(const QByteArray& xmlData) {
-        QXmlStreamReader xmlReader(xmlData);
-        QString currentTag;
-
-        while (!xmlReader.atEnd()) {
-            xmlReader.readNext();
-
-            if (xmlReader.isStartElement()) {
-                QString tagName = xmlReader.name().toString();
-                currentTag = tagName;
-
-                if (tagName == "title") {
-                    // Parse book title from title section
-                    title = xmlReader.readElementText();
-                } else if (tagName == "author") {
-                    // Parse author(s)
-                    QString author;
-                    while (!(xmlReader.isEndElement() && xmlReader.name() == "author") && !xmlReader.atEnd()) {
-                        xmlReader.readNext();
-                        if (xmlReader.isStartElement()) {
-                            author += xmlReader.readElementText() + " ";
+    mutable QMutex pagesMutex; // Guards pages against the memory consumer
+    int memoryConsumerId;
+
+    // The text part of the book: everything before the first <binary>,
+    // which by the FictionBook schema follows all bodies
+    static qint64 textLength(const QByteArray& data) {
+        const int first = data.indexOf("<binary");
+        return first < 0 ? data.size() : first;
+    }
+
+    // Find every <binary> by its bytes, without reading its content. The
+    // markup is ASCII in every encoding FictionBook files use.
+    void indexBinaries(const QByteArray& data, qint64 from) {
+        static const QRegularExpression idPattern(QStringLiteral("\\bid\\s*=\\s*[\"']([^\"']*)[\"']"));
+        static const QRegularExpression typePattern(QStringLiteral("\\bcontent-type\\s*=\\s*[\"']([^\"']*)[\"']"));
+        int position = static_cast<int>(from);
+        while ((position = data.indexOf("<binary", position)) >= 0) {
+            const int tagEnd = data.indexOf('>', position);
+            if (tagEnd < 0) break;
+            const int close = data.indexOf("</binary>", tagEnd);
+            if (close < 0) break;
+            const QString tag = QString::fromLatin1(data.constData() + position, tagEnd - position);
+            const QString id = idPattern.match(tag).captured(1);
+            if (!id.isEmpty() && !binaries.contains(id)) {
+                BinaryRef ref;
+                ref.offset = tagEnd + 1;
+                ref.length = close - tagEnd - 1;
+                ref.contentType = typePattern.match(tag).captured(1);
+                binaries.insert(id, ref);
+                binaryOrder.append(id);
+            }
+            position = close + 9;
+        }
+    }
+
+    void parseDescription(QXmlStreamReader& xml) {
+        while (xml.readNextStartElement()) {
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("title-info")) {
+                while (xml.readNextStartElement()) {
+                    const QStringRef field = xml.name();
+                    if (field == QLatin1String("book-title")) {
+                        title = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
+                    } else if (field == QLatin1String("author")) {
+                        QStringList parts;
+                        QString nickname;
+                        while (xml.readNextStartElement()) {
+                            const QStringRef part = xml.name();
+                            const QString value = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified();
+                            if (part == QLatin1String("first-name") || part == QLatin1String("middle-name") || part == QLatin1String("last-name")) {
+                                if (!value.isEmpty()) parts.append(value);
+                            } else if (part == QLatin1String("nickname")) {
+                                nickname = value;
+                            }
                         }
+                        const QString author = parts.isEmpty() ? nickname : parts.join(QLatin1Char(' '));
+                        if (!author.isEmpty()) authors.append(author);
+                    } else if (field == QLatin1String("genre")) {
+                        const QString value = xml.readElementText().trimmed();
+                        if (genre.isEmpty()) genre = value;
+                    } else if (field == QLatin1String("coverpage")) {
+                        while (xml.readNextStartElement()) {
+                            if (xml.name() == QLatin1String("image") && coverImageId.isEmpty()) {
+                                const QString href = hrefOf(xml.attributes());
+                                if (href.startsWith(QLatin1Char('#'))) coverImageId = href.mid(1);
+                            }
+                            xml.skipCurrentElement();
+                        }
+                    } else {
+                        xml.skipCurrentElement();
                     }
-                    if (!author.trimmed().isEmpty()) {
-                        authors.append(author.trimmed());
-                    }
-                } else if (tagName == "genre") {
-                    genre = xmlReader.readElementText();
-                } else if (tagName == "id") {
-                    bookId = xmlReader.readElementText();
-                } else if (tagName == "section") {
-                    // Count sections as pages
-                    pageCountVal++;
-                } else if (tagName == "binary") {
-                    // Parse embedded images
-                    QXmlStreamAttributes attrs = xmlReader.attributes();
-                    QString imageId = attrs.value("id").toString();
-                    if (!imageId.isEmpty()) {
-                        QString imageDataB64 = xmlReader.readElementText().trimmed();
-                        QByteArray imageData = QByteArray::fromBase64(imageDataB64.toUtf8());
-                        embeddedImages.insert(imageId, imageData);
-                        LOG_DEBUG("Fb2Document: Parsed embedded image: " << imageId);
-                    }
                 }
+            } else if (name == QLatin1String("document-info")) {
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("id")) bookId = xml.readElementText().trimmed();
+                    else xml.skipCurrentElement();
+                }
+            } else {
+                xml.skipCurrentElement();
             }
         }
+    }
 
-        if (xmlReader.hasError()) {
-            LOG_ERROR("Fb2Document: XML parsing error: " << xmlReader.errorString());
-            return false;
+    // Each top-level section is a page; what precedes the first section
+    // (the body's title, epigraphs, images) opens that page
+    void parseBody(QXmlStreamReader& xml) {
+        Fb2HtmlWriter writer(xml);
+        QString prelude;
+        QString preludeTitle;
+        const int firstSection = sections.size();
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("section")) {
+                writer.firstTitle.clear();
+                Section section;
+                section.html = prelude + writer.sectionHtml(1);
+                section.title = writer.firstTitle.isEmpty() ? preludeTitle : writer.firstTitle;
+                sections.append(section);
+                prelude.clear();
+                preludeTitle.clear();
+            } else if (xml.name() == QLatin1String("title")) {
+                writer.firstTitle.clear();
+                prelude += writer.titleHtml(1);
+                preludeTitle = writer.firstTitle;
+            } else {
+                prelude += writer.blockHtml(0);
+            }
         }
+        if (prelude.isEmpty()) return;
+        if (sections.size() > firstSection) {
+            sections.last().html += prelude; // Trailing matter of the body
+        } else {
+            sections.append(Section{prelude, preludeTitle});
+        }
+    }
 
-        LOG_DEBUG("Fb2Document: Parsed FB2 with title '" << title << "', " << authors.size() << " authors, " << pageCountVal << " sections.");
+    bool parseText(const QByteArray& text) {
+        QXmlStreamReader xml(text);
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (!xml.isStartElement()) continue;
+            const QStringRef name = xml.name();
+            if (name == QLatin1String("description")) parseDescription(xml);
+            else if (name == QLatin1String("body")) parseBody(xml);
+            else if (name != QLatin1String("FictionBook")) xml.skipCurrentElement();
+        }
+        // The text part stops where the binaries begin, before the root closes
+        if (xml.hasError() && xml.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+            LOG_ERROR("Fb2Document: XML parsing error at line " << xml.lineNumber() << ": " << xml.errorString());
+            return false;
+        }
         return true;
     }
 };
@@ -97,11 +330,13 @@ Fb2Document::Fb2Document(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
+    d->memoryConsumerId = ReflowablePage::registerLayoutConsumer("FB2 page layouts", this, &d->pagesMutex, &d->pages);
     LOG_INFO("Fb2Document created.");
 }
 
 Fb2Document::~Fb2Document()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     LOG_INFO("Fb2Document destroyed.");
 }
 
@@ -109,66 +344,171 @@ bool Fb2Document::load(const QString& filePath, const QString& password)
 {
     Q_UNUSED(password);
     d->isLoaded = false;
-    d->pages.clear();
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+    }
+    d->sections.clear();
+    d->binaries.clear();
+    d->binaryOrder.clear();
+    d->title.clear();
+    d->authors.clear();
+    d->genre.clear();
+    d->bookId.clear();
+    d->coverImageId.clear();
 
-    QFile fb2File(filePath);
-    if (!fb2File.open(QIODevice::ReadOnly)) {
+    LoadTrace trace(filePath, QStringLiteral("FB2"));
+    trace.phase(LoadTrace::Io);
+    d->mapping = MappedFile::open(filePath);
+    if (!d->mapping) {
         setLastError(tr("Failed to open FB2 file."));
         LOG_ERROR(lastError());
         return false;
     }
+    const QByteArray data = d->mapping->bytes();
 
-    QByteArray fb2Data = fb2File.readAll();
-    fb2File.close();
-
-    // Parse the FB2 XML
-    if (!d->parseFb2Xml(fb2Data)) {
+    // Only the text is parsed; the binaries, usually most of the file, are
+    // located by offset and decoded when a page shows them
+    trace.phase(LoadTrace::Parse);
+    const qint64 textLength = Private::textLength(data);
+    if (!d->parseText(QByteArray::fromRawData(data.constData(), static_cast<int>(textLength)))) {
         setLastError(tr("Failed to parse FB2 XML structure."));
         LOG_ERROR(lastError());
         return false;
     }
+    trace.phase(LoadTrace::Extras);
+    d->indexBinaries(data, textLength);
 
     setFilePath(filePath);
-    d->fb2Content = QString::fromUtf8(fb2Data); // Store for potential rendering/save
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
     emit fb2Loaded();
-    LOG_INFO("Successfully loaded FB2 document: " << filePath);
+    LOG_INFO("Successfully loaded FB2 document: " << filePath << ", " << d->pageCountVal << " pages, "
+             << d->binaries.size() << " binaries left undecoded");
     return true;
 }
 
 bool Fb2Document::save(const QString& filePath)
 {
-    // Saving FB2 involves writing the XML back to a file, potentially with modifications.
-    QFile outputFile(filePath.isEmpty() ? this->filePath() : filePath);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
+    // The document is not edited, so saving writes the original bytes
+    const QString targetPath = filePath.isEmpty() ? this->filePath() : filePath;
+    if (!d->mapping) {
         setLastError(tr("Failed to save FB2 file."));
         LOG_ERROR(lastError());
         return false;
     }
-
-    outputFile.write(d->fb2Content.toUtf8());
-    outputFile.close();
-    setFilePath(filePath.isEmpty() ? this->filePath() : filePath);
+    QSaveFile outputFile(targetPath);
+    if (!outputFile.open(QIODevice::WriteOnly)
+        || outputFile.write(reinterpret_cast<const char*>(d->mapping->data()), d->mapping->size()) != d->mapping->size()
+        || !outputFile.commit()) {
+        setLastError(tr("Failed to save FB2 file."));
+        LOG_ERROR(lastError());
+        return false;
+    }
+    setFilePath(targetPath);
     setModified(false);
-    LOG_INFO("Successfully saved FB2 document: " << outputFile.fileName());
+    LOG_INFO("Successfully saved FB2 document: " << targetPath);
     return true;
 }
 
-// ... (Rest of Fb2Document methods similar to others) ...
+Document::DocumentType Fb2Document::type() const
+{
+    return DocumentType::FictionBook;
+}
+
+int Fb2Document::pageCount() const
+{
+    return d->pageCountVal;
+}
+
+Page* Fb2Document::page(int index) const
+{
+    if (index >= 0 && index < d->pages.size()) {
+        return d->pages.at(index).get();
+    }
+    return nullptr;
+}
+
+bool Fb2Document::isLocked() const
+{
+    return false;
+}
+
+bool Fb2Document::isEncrypted() const
+{
+    return false;
+}
+
+QString Fb2Document::formatVersion() const
+{
+    return "FictionBook 2";
+}
+
+bool Fb2Document::supportsFeature(const QString& feature) const
+{
+    static const QSet<QString> supportedFeatures = {
+        "Text", "Images", "Reflowable", "Hyperlinks"
+    };
+    return supportedFeatures.contains(feature);
+}
+
+QString Fb2Document::bookTitle() const
+{
+    return d->title;
+}
+
+QStringList Fb2Document::bookAuthors() const
+{
+    return d->authors;
+}
+
+QString Fb2Document::bookGenre() const
+{
+    return d->genre;
+}
+
+QString Fb2Document::bookId() const
+{
+    return d->bookId;
+}
+
+QStringList Fb2Document::embeddedImageIds() const
+{
+    return d->binaryOrder;
+}
+
+QByteArray Fb2Document::getEmbeddedImage(const QString& imageId) const
+{
+    // Immutable after load, so renders may call this from any thread
+    const auto it = d->binaries.constFind(imageId);
+    if (it == d->binaries.constEnd() || !d->mapping) return QByteArray();
+    const QByteArray base64 = QByteArray::fromRawData(reinterpret_cast<const char*>(d->mapping->data()) + it->offset, static_cast<int>(it->length));
+    return QByteArray::fromBase64(base64); // Line breaks in the text are skipped
+}
 
 void Fb2Document::createPages()
 {
-    // Create one page per 'section' element in the FB2
-    d->pages.clear();
-    d->pages.reserve(d->pageCountVal);
-    for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<Fb2Page>(this, i)); // Placeholder
-        LOG_DEBUG("Fb2Document: Planned page " << i);
+    QVector<Private::Section> sections = d->sections;
+    if (!d->coverImageId.isEmpty() && d->binaries.contains(d->coverImageId)) {
+        sections.prepend(Private::Section{QStringLiteral("<p align=\"center\"><img src=\"fb2:%1\"/></p>").arg(d->coverImageId.toHtmlEscaped()),
+                                          tr("Cover")});
+    }
+
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+        d->pages.reserve(sections.size());
+        for (int i = 0; i < sections.size(); ++i) {
+            d->pages.append(std::make_unique<Fb2Page>(this, i, sections[i].html, sections[i].title));
+        }
     }
+    d->sections.clear(); // The pages hold the HTML now
+    d->pageCountVal = d->pages.size();
     LOG_INFO("Fb2Document: Created " << d->pages.size() << " page objects.");
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -23,6 +23,10 @@ class Fb2Page; // Forward declaration
  * @brief FictionBook (FB2) document implementation.
  * 
  * Handles loading and parsing of FB2 files (XML-based e-book format).
+ * The file is mapped and only its text is parsed, with a streaming reader;
+ * the base64 <binary> sections are located by offset and each image is
+ * decoded only when a page showing it is laid out. Each top-level section
+ * of a body is one page.
  */
 class Fb2Document : public Document
 {
@@ -0,0 +1,87 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "Fb2Page.h"
+#include "Fb2Document.h"
+#include "../../core/Logger.h"
+#include <QUrl>
+#include <QVariantMap>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// A4 width with 2/3 inch margins, in points
+const qreal PageWidth = 595.0;
+const qreal PageHeight = 842.0;
+const qreal Margin = 48.0;
+const qreal TextWidth = PageWidth - 2 * Margin;
+
+// Resolves fb2:<id> images from the document's binaries as the layout
+// needs them, decoded no larger than the text column
+class Fb2TextDocument : public LayoutDocument
+{
+public:
+    explicit Fb2TextDocument(const Fb2Document* document) : LayoutDocument(TextWidth), book(document) {}
+
+protected:
+    QVariant loadResource(int type, const QUrl& name) override {
+        if (type != QTextDocument::ImageResource || name.scheme() != QLatin1String("fb2") || !book) {
+            return QTextDocument::loadResource(type, name);
+        }
+        return decodeImage(book->getEmbeddedImage(name.path()), name.path());
+    }
+
+private:
+    const Fb2Document* book;
+};
+
+} // namespace
+
+class Fb2Page::Private {
+public:
+    Private(Fb2Document* doc, int pIndex, const QString& sectionHtml, const QString& sectionTitle)
+        : document(doc), pageIndexVal(pIndex), html(sectionHtml), title(sectionTitle) {}
+
+    Fb2Document* document;
+    int pageIndexVal;
+    QString html;
+    QString title;
+};
+
+Fb2Page::Fb2Page(Fb2Document* document, int pageIndex, const QString& html, const QString& title, QObject* parent)
+    : ReflowablePage(document, QSizeF(PageWidth, PageHeight), Margin, parent)
+    , d(new Private(document, pageIndex, html, title))
+{
+    if (!title.isEmpty()) setTitle(title);
+    LOG_DEBUG("Fb2Page created for index " << pageIndex);
+}
+
+Fb2Page::~Fb2Page()
+{
+    LOG_DEBUG("Fb2Page for index " << d->pageIndexVal << " destroyed.");
+}
+
+QVariantMap Fb2Page::metadata() const
+{
+    QVariantMap map;
+    map["PageIndex"] = d->pageIndexVal;
+    map["Title"] = d->title;
+    return map;
+}
+
+std::unique_ptr<LayoutDocument> Fb2Page::createLayout() const
+{
+    std::unique_ptr<LayoutDocument> layout(new Fb2TextDocument(d->document));
+    layout->setDocumentMargin(0);
+    layout->setHtml(d->html);
+    return layout;
+}
+
+} // namespace QuantilyxDoc
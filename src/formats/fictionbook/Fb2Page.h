@@ -0,0 +1,59 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FB2PAGE_H
+#define QUANTILYX_FB2PAGE_H
+
+#include "../../core/ReflowablePage.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Fb2Document;
+
+/**
+ * @brief One top-level section of a FictionBook, as a continuous page.
+ *
+ * Its images are decoded from the document's binaries when the section is
+ * laid out, and not before, so a book opens without decoding any of them.
+ */
+class Fb2Page : public ReflowablePage
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent Fb2Document.
+     * @param pageIndex The 0-based index of this page.
+     * @param html The section converted to HTML; images use fb2:<id> URLs.
+     * @param title The section's title, if any.
+     * @param parent Parent object.
+     */
+    Fb2Page(Fb2Document* document, int pageIndex, const QString& html, const QString& title, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~Fb2Page() override;
+
+    // --- Page Interface Implementation ---
+    QVariantMap metadata() const override;
+
+protected:
+    std::unique_ptr<LayoutDocument> createLayout() const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FB2PAGE_H
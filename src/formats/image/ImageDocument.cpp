@@ -8,13 +8,19 @@
  * (at your option) any later version.
  */
 #include "ImageDocument.h"
+#include "ImagePyramid.h"
+#include "TiledImagePage.h"
 #include "../comic/ComicPage.h" // Reuse ComicPage
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/Settings.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QImage>
 #include <QImageReader>
+#include <QBuffer>
 #include <QDebug>
 
 namespace QuantilyxDoc {
@@ -31,7 +37,8 @@ public:
     bool hasAlphaVal = false;
     int colorDepthVal = 0;
     QString colorSpaceVal;
-    std::unique_ptr<ComicPage> imagePage; // Reuse ComicPage for rendering
+    std::unique_ptr<ImagePyramid> pyramid; // Only for images too large to decode whole
+    std::unique_ptr<Page> imagePage; // ComicPage, or TiledImagePage over the pyramid
     QString imagePath; // Store path to the image file
 
     // Helper to extract image properties
@@ -48,23 +55,33 @@ public:
         else if (suffix == "tiff" || suffix == "tif") mimeTypeVal = "image/tiff";
         else mimeTypeVal = "image/unknown";
 
-        // Get image size and other properties using QImageReader
-        QImageReader reader(filePath);
+        // Get image size and other properties using QImageReader, reading
+        // the mapped file instead of copying it
+        const std::shared_ptr<MappedFile> mapping = MappedFile::open(filePath);
+        QByteArray mappedData = mapping ? mapping->bytes() : QByteArray();
+        QBuffer buffer(&mappedData);
+        QImageReader reader;
+        if (!mappedData.isEmpty() && buffer.open(QIODevice::ReadOnly)) {
+            reader.setDevice(&buffer);
+        } else {
+            reader.setFileName(filePath);
+        }
         if (!reader.canRead()) {
             LOG_ERROR("ImageDocument: QImageReader cannot read image: " << filePath);
             return false;
         }
 
         imageSizeVal = reader.size();
-        // QImageReader doesn't directly provide alpha, depth, color space easily.
-        // For that, load the QImage which is more expensive.
-        QImage image;
-        if (image.load(filePath)) {
-            hasAlphaVal = image.hasAlphaChannel();
-            colorDepthVal = image.depth();
-            // Color space is harder; Qt doesn't expose it directly without QColorSpace (Qt 5.14+)
-            colorSpaceVal = "sRGB"; // Assume sRGB as default
+        // The header's pixel format answers alpha and depth without decoding
+        // the image, which may be far larger than memory
+        const QImage::Format format = reader.imageFormat();
+        if (format != QImage::Format_Invalid) {
+            const QPixelFormat pixelFormat = QImage::toPixelFormat(format);
+            hasAlphaVal = pixelFormat.alphaUsage() == QPixelFormat::UsesAlpha;
+            colorDepthVal = pixelFormat.bitsPerPixel();
         }
+        // Color space is harder; Qt doesn't expose it directly without QColorSpace (Qt 5.14+)
+        colorSpaceVal = "sRGB"; // Assume sRGB as default
 
         LOG_DEBUG("ImageDocument: Extracted properties for " << filePath << " - Type: " << mimeTypeVal << ", Size: " << imageSizeVal);
         return true;
@@ -88,7 +105,10 @@ bool ImageDocument::load(const QString& filePath, const QString& password)
     Q_UNUSED(password);
     d->isLoaded = false;
 
+    LoadTrace trace(filePath, QStringLiteral("Image"));
+
     // Extract image properties
+    trace.phase(LoadTrace::Parse);
     if (!d->extractImageProperties(filePath)) {
         setLastError(tr("Failed to load image properties."));
         LOG_ERROR(lastError());
@@ -97,7 +117,9 @@ bool ImageDocument::load(const QString& filePath, const QString& password)
 
     setFilePath(filePath);
     d->imagePath = filePath;
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -145,9 +167,7 @@ int ImageDocument::pageCount() const
 Page* ImageDocument::page(int index) const
 {
     if (index == 0) {
-        // return d->imagePage.get(); // This is a ComicPage, which is a Page*
-        LOG_DEBUG("ImageDocument::page: Requested single image page.");
-        return nullptr; // Placeholder until ComicPage is fully integrated
+        return d->imagePage.get();
     }
     return nullptr;
 }
@@ -202,9 +222,23 @@ QString ImageDocument::colorSpace() const
 
 void ImageDocument::createPages()
 {
-    // Create a single ComicPage for the image
-    // d->imagePage = std::make_unique<ComicPage>(this, 0, d->imagePath); // Placeholder
-    LOG_INFO("ImageDocument: Created single image page object.");
+    d->imagePage.reset();
+    d->pyramid.reset();
+
+    // Past the threshold, decoding the whole image would cost its full size
+    // in memory on every render; tiles cost only what is on screen
+    const qint64 pixels = static_cast<qint64>(d->imageSizeVal.width()) * d->imageSizeVal.height();
+    const qint64 threshold = Settings::instance().value<qint64>("Advanced/ImagePyramidPixels", 50LL * 1000 * 1000);
+    if (pixels > threshold) d->pyramid = ImagePyramid::open(d->imagePath);
+
+    if (d->pyramid) {
+        d->imagePage.reset(new TiledImagePage(this, d->pyramid.get()));
+        d->pyramid->buildOverview();
+        LOG_INFO("ImageDocument: Created tiled page for " << d->imageSizeVal << " image.");
+    } else {
+        d->imagePage.reset(new ComicPage(this, 0, d->imagePath));
+        LOG_INFO("ImageDocument: Created single image page object.");
+    }
 }
 
 } // namespace QuantilyxDoc
\ No newline at end of file
@@ -17,12 +17,13 @@
 
 namespace QuantilyxDoc {
 
-class ComicPage; // Reuse ComicPage for single images
 
 /**
  * @brief Image document implementation for single-page image formats.
  * 
- * Handles loading of common image formats (JPEG, PNG, GIF, etc.).
+ * Handles loading of common image formats (JPEG, PNG, GIF, etc.). Images
+ * above a pixel-count threshold that can be decoded by region are opened
+ * through an ImagePyramid instead of being decoded whole.
  */
 class ImageDocument : public Document
 {
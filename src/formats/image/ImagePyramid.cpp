@@ -0,0 +1,706 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ImagePyramid.h"
+#include "../../core/Application.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/ImageCodec.h"
+#include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
+#include "../../core/ThreadPool.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QSaveFile>
+#include <QSet>
+#include <QVector>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#ifdef HAVE_TIFF
+#include <tiffio.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Edge of a pyramid tile, at every level
+const int TileSize = 256;
+
+// Generated files kept for this many images, most recently opened first
+const int MaxPyramidDirectories = 8;
+
+#ifdef HAVE_TIFF
+// Decoded TIFF bands kept for neighbouring tiles, at most
+const qint64 MaxBlockBytes = 64 * 1024 * 1024;
+#endif
+
+// On-disk tile: TileHeader followed by the ImageCodec payload
+struct TileHeader {
+    quint32 magic;
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    qint32 bytesPerLine;
+    qint32 method;
+    qint32 payloadSize;
+};
+
+const quint32 TileMagic = 0x51585054; // "QXPT"
+const quint32 TileVersion = 1;
+
+quint64 tileKey(int level, int x, int y)
+{
+    return (quint64(quint16(level)) << 48) | (quint64(quint32(y) & 0xffffff) << 24) | (quint32(x) & 0xffffff);
+}
+
+// Halve an image with a 2x2 box filter; odd edges average what they have
+QImage downsample(const QImage& source)
+{
+    const int width = (source.width() + 1) / 2;
+    const int height = (source.height() + 1) / 2;
+    QImage result(width, height, ImageBufferPool::PipelineFormat);
+    if (result.isNull()) return result;
+    for (int y = 0; y < height; ++y) {
+        const QRgb* top = reinterpret_cast<const QRgb*>(source.constScanLine(2 * y));
+        const QRgb* bottom = 2 * y + 1 < source.height() ? reinterpret_cast<const QRgb*>(source.constScanLine(2 * y + 1)) : top;
+        QRgb* out = reinterpret_cast<QRgb*>(result.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const int left = 2 * x;
+            const int right = qMin(left + 1, source.width() - 1);
+            const QRgb a = top[left], b = top[right], c = bottom[left], d = bottom[right];
+            out[x] = qRgba((qRed(a) + qRed(b) + qRed(c) + qRed(d) + 2) / 4,
+                           (qGreen(a) + qGreen(b) + qGreen(c) + qGreen(d) + 2) / 4,
+                           (qBlue(a) + qBlue(b) + qBlue(c) + qBlue(d) + 2) / 4,
+                           (qAlpha(a) + qAlpha(b) + qAlpha(c) + qAlpha(d) + 2) / 4);
+        }
+    }
+    return result;
+}
+
+// Where tiles of some levels come from
+class TileSource
+{
+public:
+    virtual ~TileSource() = default;
+    // True if the source has this level itself
+    virtual bool hasLevel(int level) const = 0;
+    // Read a rectangle of a level; levelSize is that level's full size
+    virtual QImage read(int level, const QRect& rect, const QSize& levelSize) = 0;
+    // True if reads cost enough that their tiles should be kept on disk
+    virtual bool isSlow() const = 0;
+};
+
+#ifdef HAVE_TIFF
+// TIFF through libtiff: tiles or bands of rows of the full image, and of
+// reduced-resolution directories when the file is a pyramid itself
+class TiffSource : public TileSource
+{
+public:
+    struct Directory {
+        tdir_t index;
+        QSize size;
+        bool tiled;
+        QSize block; // Native tile, or a band of TileSize rows
+    };
+
+    static std::unique_ptr<TiffSource> open(const QString& path) {
+        TIFFSetWarningHandler(nullptr); // Unknown tags are common and harmless
+        TIFF* tif = TIFFOpen(QFile::encodeName(path).constData(), "r");
+        if (!tif) return nullptr;
+        char message[1024];
+        if (!TIFFRGBAImageOK(tif, message)) {
+            LOG_WARN("ImagePyramid: libtiff cannot read " << path << ": " << message);
+            TIFFClose(tif);
+            return nullptr;
+        }
+
+        std::unique_ptr<TiffSource> source(new TiffSource(tif));
+        const Directory base = readDirectory(tif);
+        source->levels.append(base);
+        while (TIFFReadDirectory(tif)) {
+            uint32_t type = 0;
+            if (!TIFFGetField(tif, TIFFTAG_SUBFILETYPE, &type) || !(type & FILETYPE_REDUCEDIMAGE)) continue;
+            if (!TIFFRGBAImageOK(tif, message)) continue;
+            const Directory reduced = readDirectory(tif);
+            if (reduced.size.width() <= 0) continue;
+            const int level = qRound(std::log2(double(base.size.width()) / reduced.size.width()));
+            if (level < 1 || level > 30) continue;
+            const int expected = (base.size.width() + (1 << level) - 1) >> level;
+            if (qAbs(expected - reduced.size.width()) > 1) continue; // Not a power-of-two level
+            if (source->levels.size() <= level) source->levels.resize(level + 1);
+            if (source->levels[level].size.isEmpty()) source->levels[level] = reduced;
+        }
+        TIFFSetDirectory(tif, 0);
+        source->currentDirectory = 0;
+        return source;
+    }
+
+    ~TiffSource() override {
+        TIFFClose(tif);
+    }
+
+    QSize size() const { return levels.first().size; }
+
+    bool hasLevel(int level) const override {
+        return level < levels.size() && !levels[level].size.isEmpty();
+    }
+
+    bool isSlow() const override {
+        return false; // Native tiles and bands decode quickly
+    }
+
+    QImage read(int level, const QRect& rect, const QSize& levelSize) override {
+        Q_UNUSED(levelSize);
+        QImage result(rect.size(), ImageBufferPool::PipelineFormat);
+        if (result.isNull() || !hasLevel(level)) return QImage();
+        result.fill(Qt::transparent);
+
+        QMutexLocker locker(&mutex);
+        const Directory& directory = levels[level];
+        if (currentDirectory != directory.index) {
+            if (!TIFFSetDirectory(tif, directory.index)) return QImage();
+            currentDirectory = directory.index;
+        }
+        const QRect area = rect & QRect(QPoint(0, 0), directory.size);
+        const int firstX = area.left() / directory.block.width();
+        const int lastX = area.right() / directory.block.width();
+        const int firstY = area.top() / directory.block.height();
+        const int lastY = area.bottom() / directory.block.height();
+        for (int by = firstY; by <= lastY; ++by) {
+            for (int bx = firstX; bx <= lastX; ++bx) {
+                const QImage block = this->block(directory, bx, by);
+                if (block.isNull()) return QImage();
+                const QPoint origin(bx * directory.block.width(), by * directory.block.height());
+                const QRect part = area & QRect(origin, block.size());
+                for (int y = part.top(); y <= part.bottom(); ++y) {
+                    std::memcpy(result.scanLine(y - rect.top()) + (part.left() - rect.left()) * 4,
+                                block.constScanLine(y - origin.y()) + (part.left() - origin.x()) * 4,
+                                static_cast<size_t>(part.width()) * 4);
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    explicit TiffSource(TIFF* handle) : tif(handle), currentDirectory(0), blockBytes(0) {}
+
+    static Directory readDirectory(TIFF* tif) {
+        Directory directory;
+        directory.index = TIFFCurrentDirectory(tif);
+        uint32_t width = 0, height = 0;
+        TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+        directory.size = QSize(static_cast<int>(width), static_cast<int>(height));
+        directory.tiled = TIFFIsTiled(tif);
+        if (directory.tiled) {
+            uint32_t tileWidth = 0, tileHeight = 0;
+            TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tileWidth);
+            TIFFGetField(tif, TIFFTAG_TILELENGTH, &tileHeight);
+            directory.block = QSize(static_cast<int>(tileWidth), static_cast<int>(tileHeight));
+        } else {
+            directory.block = QSize(directory.size.width(), TileSize);
+        }
+        return directory;
+    }
+
+    // Decode one native tile or band, top row first. Caller holds mutex.
+    QImage block(const Directory& directory, int bx, int by) {
+        const quint64 key = tileKey(directory.index, bx, by);
+        for (int i = 0; i < blocks.size(); ++i) {
+            if (blocks[i].first == key) {
+                blocks.move(i, blocks.size() - 1);
+                return blocks.last().second;
+            }
+        }
+
+        const int x0 = bx * directory.block.width();
+        const int y0 = by * directory.block.height();
+        const int rows = qMin(directory.block.height(), directory.size.height() - y0);
+        QImage image;
+        if (directory.tiled) {
+            const int width = directory.block.width();
+            const int height = directory.block.height();
+            QVector<uint32_t> raster(width * height);
+            if (!TIFFReadRGBATile(tif, static_cast<uint32_t>(x0), static_cast<uint32_t>(y0), raster.data())) return QImage();
+            // Lower-left origin: image row r is raster row height - 1 - r
+            image = QImage(qMin(width, directory.size.width() - x0), rows, ImageBufferPool::PipelineFormat);
+            if (image.isNull()) return image;
+            for (int r = 0; r < image.height(); ++r) {
+                convertRow(raster.constData() + static_cast<qint64>(height - 1 - r) * width, image.scanLine(r), image.width());
+            }
+        } else {
+            TIFFRGBAImage reader;
+            char message[1024];
+            if (!TIFFRGBAImageBegin(&reader, tif, 0, message)) return QImage();
+            reader.req_orientation = ORIENTATION_TOPLEFT;
+            reader.row_offset = y0;
+            reader.col_offset = 0;
+            const int width = directory.size.width();
+            QVector<uint32_t> raster(width * rows);
+            const bool ok = TIFFRGBAImageGet(&reader, raster.data(), static_cast<uint32_t>(width), static_cast<uint32_t>(rows));
+            TIFFRGBAImageEnd(&reader);
+            if (!ok) return QImage();
+            image = QImage(width, rows, ImageBufferPool::PipelineFormat);
+            if (image.isNull()) return image;
+            for (int r = 0; r < rows; ++r) {
+                convertRow(raster.constData() + static_cast<qint64>(r) * width, image.scanLine(r), width);
+            }
+        }
+
+        blocks.append(qMakePair(key, image));
+        blockBytes += image.sizeInBytes();
+        while (blocks.size() > 1 && blockBytes > MaxBlockBytes) {
+            blockBytes -= blocks.first().second.sizeInBytes();
+            blocks.removeFirst();
+        }
+        return image;
+    }
+
+    // libtiff's RGBA output is already premultiplied
+    static void convertRow(const uint32_t* source, uchar* target, int width) {
+        QRgb* out = reinterpret_cast<QRgb*>(target);
+        for (int x = 0; x < width; ++x) {
+            const uint32_t pixel = source[x];
+            out[x] = qRgba(TIFFGetR(pixel), TIFFGetG(pixel), TIFFGetB(pixel), TIFFGetA(pixel));
+        }
+    }
+
+    TIFF* tif;
+    QMutex mutex; // libtiff handles are not thread-safe
+    QVector<Directory> levels; // By level; empty size where the file has none
+    tdir_t currentDirectory;
+    QList<QPair<quint64, QImage>> blocks; // Least recently used first
+    qint64 blockBytes;
+};
+#endif
+
+// Formats whose image reader can decode a clipped, scaled region, such as
+// JPEG; every tile of every level is decoded straight from the file
+class ReaderSource : public TileSource
+{
+public:
+    static std::unique_ptr<ReaderSource> open(const QString& path, QSize* size) {
+        std::unique_ptr<ReaderSource> source(new ReaderSource());
+        source->mapping = MappedFile::open(path);
+        if (source->mapping) source->data = source->mapping->bytes();
+        if (source->data.isEmpty()) {
+            QFile file(path);
+            if (file.open(QIODevice::ReadOnly)) source->data = file.readAll();
+        }
+        QBuffer buffer(&source->data);
+        if (!buffer.open(QIODevice::ReadOnly)) return nullptr;
+        QImageReader reader(&buffer);
+        reader.setDecideFormatFromContent(true);
+        if (!reader.canRead() || !reader.supportsOption(QImageIOHandler::ClipRect)) return nullptr;
+        *size = reader.size();
+        source->fullSize = *size;
+        return size->isEmpty() ? nullptr : std::move(source);
+    }
+
+    bool hasLevel(int) const override {
+        return true;
+    }
+
+    bool isSlow() const override {
+        return true; // Each tile decodes the file up to its rows
+    }
+
+    QImage read(int level, const QRect& rect, const QSize& levelSize) override {
+        Q_UNUSED(level);
+        // The tile's area at full resolution, decoded straight to tile size
+        const qreal scaleX = qreal(fullSize.width()) / levelSize.width();
+        const qreal scaleY = qreal(fullSize.height()) / levelSize.height();
+        const QRect clip = QRectF(rect.x() * scaleX, rect.y() * scaleY, rect.width() * scaleX, rect.height() * scaleY).toAlignedRect()
+                           & QRect(QPoint(0, 0), fullSize);
+        QByteArray bytes = data; // Shared, so each reader has its own buffer
+        QBuffer buffer(&bytes);
+        if (!buffer.open(QIODevice::ReadOnly)) return QImage();
+        QImageReader reader(&buffer);
+        reader.setDecideFormatFromContent(true);
+        reader.setClipRect(clip);
+        if (clip.size() != rect.size()) reader.setScaledSize(rect.size());
+        QImage image = reader.read();
+        if (image.isNull()) {
+            LOG_ERROR("ImagePyramid: Failed to decode " << clip << ": " << reader.errorString());
+            return image;
+        }
+        return ImageBufferPool::toPipelineFormat(std::move(image));
+    }
+
+private:
+    ReaderSource() = default;
+
+    std::shared_ptr<MappedFile> mapping; // Outlives data, which may point into it
+    QByteArray data;
+    QSize fullSize;
+};
+
+} // namespace
+
+class ImagePyramid::Private {
+public:
+    Private() : levels(1), cacheLimit(0), cachedBytes(0), useClock(0), canceled(false), memoryConsumerId(0) {}
+
+    struct Cached {
+        QImage image;
+        quint64 lastUse = 0;
+    };
+
+    QString filePath;
+    QSize fullSize;
+    int levels;
+    std::unique_ptr<TileSource> source;
+    QString diskDirectory; // Generated tiles of this file
+
+    mutable QMutex mutex; // Protects the cache and building
+    QWaitCondition built; // Woken when a tile is done
+    QHash<quint64, Cached> cache;
+    QSet<quint64> building;
+    qint64 cacheLimit;
+    qint64 cachedBytes;
+    quint64 useClock;
+    std::atomic<bool> canceled;
+    int memoryConsumerId;
+
+    QSize levelSize(int level) const {
+        return QSize((fullSize.width() + (1 << level) - 1) >> level, (fullSize.height() + (1 << level) - 1) >> level);
+    }
+
+    QRect tileRect(int level, int x, int y) const {
+        return QRect(x * TileSize, y * TileSize, TileSize, TileSize) & QRect(QPoint(0, 0), levelSize(level));
+    }
+
+    QString tilePath(int level, int x, int y) const {
+        return diskDirectory + QStringLiteral("/%1_%2_%3.qpt").arg(level).arg(x).arg(y);
+    }
+
+    // Drop least recently used tiles until under maxBytes. Caller holds mutex.
+    qint64 trim(qint64 maxBytes) {
+        qint64 freed = 0;
+        while (!cache.isEmpty() && cachedBytes > maxBytes) {
+            auto oldest = cache.begin();
+            for (auto it = cache.begin(); it != cache.end(); ++it) {
+                if (it->lastUse < oldest->lastUse) oldest = it;
+            }
+            const qint64 bytes = oldest->image.sizeInBytes();
+            cachedBytes -= bytes;
+            freed += bytes;
+            cache.erase(oldest);
+        }
+        return freed;
+    }
+
+    QImage loadTile(int level, int x, int y) const {
+        QFile file(tilePath(level, x, y));
+        if (!file.open(QIODevice::ReadOnly)) return QImage();
+        const QByteArray bytes = file.readAll();
+        if (bytes.size() < static_cast<int>(sizeof(TileHeader))) return QImage();
+        TileHeader header;
+        std::memcpy(&header, bytes.constData(), sizeof(header));
+        if (header.magic != TileMagic || header.version != TileVersion) return QImage();
+        if (header.payloadSize <= 0 || sizeof(header) + header.payloadSize > static_cast<quint64>(bytes.size())) return QImage();
+        ImageCodec::Encoded encoded;
+        encoded.data = bytes.mid(sizeof(header), header.payloadSize);
+        encoded.width = header.width;
+        encoded.height = header.height;
+        encoded.bytesPerLine = header.bytesPerLine;
+        encoded.format = static_cast<QImage::Format>(header.format);
+        encoded.method = static_cast<ImageCodec::Method>(header.method);
+        return ImageCodec::decode(encoded);
+    }
+
+    // Written on the I/O pool; a lost write only means the tile is built again
+    void storeTile(int level, int x, int y, const QImage& image) const {
+        const QString directory = diskDirectory;
+        const QString path = tilePath(level, x, y);
+        ThreadPool::ioInstance().submitDetached([directory, path, image]() {
+            const ImageCodec::Encoded encoded = ImageCodec::encode(image);
+            if (encoded.isNull() || !QDir().mkpath(directory)) return;
+            TileHeader header;
+            header.magic = TileMagic;
+            header.version = TileVersion;
+            header.width = encoded.width;
+            header.height = encoded.height;
+            header.format = static_cast<qint32>(encoded.format);
+            header.bytesPerLine = encoded.bytesPerLine;
+            header.method = static_cast<qint32>(encoded.method);
+            header.payloadSize = encoded.data.size();
+            QSaveFile file(path);
+            const bool ok = file.open(QIODevice::WriteOnly)
+                            && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+                            && file.write(encoded.data) == encoded.data.size()
+                            && file.commit();
+            if (!ok) LOG_WARN("ImagePyramid: Failed to write " << path);
+        }, Task::Priority::Low);
+    }
+
+    QImage produce(int level, int x, int y) {
+        if (canceled.load()) return QImage();
+        const QRect rect = tileRect(level, x, y);
+        const bool generated = !source->hasLevel(level);
+        if (generated || source->isSlow()) {
+            QImage stored = loadTile(level, x, y);
+            if (stored.size() == rect.size()) return stored;
+        }
+
+        QImage image;
+        if (!generated) {
+            image = source->read(level, rect, levelSize(level));
+        } else {
+            // Four tiles of the level above, halved
+            const QRect childRect = QRect(rect.topLeft() * 2, rect.size() * 2) & QRect(QPoint(0, 0), levelSize(level - 1));
+            QImage children(childRect.size(), ImageBufferPool::PipelineFormat);
+            if (children.isNull()) return QImage();
+            children.fill(Qt::transparent);
+            QPainter painter(&children);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            for (int j = 0; j < 2; ++j) {
+                for (int i = 0; i < 2; ++i) {
+                    const QRect child = tileRect(level - 1, 2 * x + i, 2 * y + j);
+                    if (child.isEmpty()) continue;
+                    const QImage childImage = tile(level - 1, 2 * x + i, 2 * y + j);
+                    if (childImage.isNull()) return QImage();
+                    painter.drawImage(child.topLeft() - childRect.topLeft(), childImage);
+                }
+            }
+            painter.end();
+            image = downsample(children);
+        }
+        if (!image.isNull() && (generated || source->isSlow())) storeTile(level, x, y, image);
+        return image;
+    }
+
+    // Find a tile or make it; one thread makes each tile while others wait
+    QImage tile(int level, int x, int y) {
+        const quint64 key = tileKey(level, x, y);
+        {
+            QMutexLocker locker(&mutex);
+            for (;;) {
+                auto it = cache.find(key);
+                if (it != cache.end()) {
+                    it->lastUse = ++useClock;
+                    return it->image;
+                }
+                if (!building.contains(key)) break;
+                built.wait(&mutex);
+            }
+            building.insert(key);
+        }
+
+        const QImage image = produce(level, x, y);
+
+        QMutexLocker locker(&mutex);
+        building.remove(key);
+        if (!image.isNull()) {
+            Cached entry;
+            entry.image = image;
+            entry.lastUse = ++useClock;
+            cache.insert(key, entry);
+            cachedBytes += image.sizeInBytes();
+            trim(cacheLimit);
+        }
+        built.wakeAll();
+        return image;
+    }
+
+    qint64 usage() const {
+        QMutexLocker locker(&mutex);
+        return cachedBytes;
+    }
+
+    // Tile directories of the open pyramids, with how many have each open
+    static QMutex& openDirectoriesMutex() {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    static QHash<QString, int>& openDirectories() {
+        static QHash<QString, int> directories;
+        return directories;
+    }
+
+    static QString diskRoot() {
+        return Application::instance()->cacheDirectory() + QLatin1String("/pyramids");
+    }
+
+    // Keep the generated tiles of the most recently opened images only
+    static void trimDiskCache(const QString& root) {
+        QVector<QPair<QDateTime, QString>> directories;
+        for (const QFileInfo& entry : QDir(root).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            const QFileInfo marker(entry.absoluteFilePath() + QLatin1String("/opened"));
+            directories.append(qMakePair(marker.exists() ? marker.lastModified() : entry.lastModified(), entry.absoluteFilePath()));
+        }
+        if (directories.size() <= MaxPyramidDirectories) return;
+        std::sort(directories.begin(), directories.end(),
+                  [](const QPair<QDateTime, QString>& a, const QPair<QDateTime, QString>& b) { return a.first > b.first; });
+        for (int i = MaxPyramidDirectories; i < directories.size(); ++i) {
+            QDir(directories[i].second).removeRecursively();
+        }
+    }
+};
+
+ImagePyramid::ImagePyramid()
+    : d(std::make_shared<Private>())
+{
+}
+
+std::unique_ptr<ImagePyramid> ImagePyramid::open(const QString& filePath)
+{
+    std::unique_ptr<ImagePyramid> pyramid(new ImagePyramid());
+    Private* priv = pyramid->d.get();
+    priv->filePath = filePath;
+
+#ifdef HAVE_TIFF
+    if (std::unique_ptr<TiffSource> tiff = TiffSource::open(filePath)) {
+        priv->fullSize = tiff->size();
+        priv->source = std::move(tiff);
+    } else
+#endif
+    if (std::unique_ptr<ReaderSource> reader = ReaderSource::open(filePath, &priv->fullSize)) {
+        priv->source = std::move(reader);
+    } else {
+        LOG_DEBUG("ImagePyramid: " << filePath << " cannot be decoded by region");
+        return nullptr;
+    }
+    if (priv->fullSize.isEmpty()) return nullptr;
+    while (qMax(priv->levelSize(priv->levels - 1).width(), priv->levelSize(priv->levels - 1).height()) > TileSize) {
+        ++priv->levels;
+    }
+
+    // Generated tiles belong to this version of the file
+    const QFileInfo info(filePath);
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    hasher.addData(info.absoluteFilePath().toUtf8());
+    hasher.addData(QByteArray::number(info.size()));
+    hasher.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    const QString root = Private::diskRoot();
+    priv->diskDirectory = root + QLatin1Char('/') + QString::fromLatin1(hasher.result().toHex());
+    {
+        QMutexLocker locker(&Private::openDirectoriesMutex());
+        ++Private::openDirectories()[priv->diskDirectory];
+    }
+    if (QDir().mkpath(priv->diskDirectory)) {
+        // The marker's mtime records when the file was last opened
+        QFile marker(priv->diskDirectory + QLatin1String("/opened"));
+        if (marker.open(QIODevice::WriteOnly | QIODevice::Truncate)) marker.close();
+        Private::trimDiskCache(root);
+    }
+
+    priv->cacheLimit = static_cast<qint64>(qMax(8, Settings::instance().value<int>("Advanced/ImagePyramidCacheMB", 128))) * 1024 * 1024;
+    priv->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "Image pyramid tiles", MemoryBudget::Priority::Low,
+        [priv]() { return priv->usage(); },
+        [priv](qint64 bytes) {
+            QMutexLocker locker(&priv->mutex);
+            return priv->trim(qMax<qint64>(0, priv->cachedBytes - bytes));
+        });
+
+    LOG_INFO("ImagePyramid: " << filePath << " is " << priv->fullSize << " in " << priv->levels << " levels");
+    return pyramid;
+}
+
+ImagePyramid::~ImagePyramid()
+{
+    // A background build stops at its next tile and frees Private when done
+    d->canceled = true;
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+    QMutexLocker locker(&Private::openDirectoriesMutex());
+    if (!d->diskDirectory.isEmpty() && --Private::openDirectories()[d->diskDirectory] <= 0) {
+        Private::openDirectories().remove(d->diskDirectory);
+    }
+}
+
+void ImagePyramid::clearDiskCache()
+{
+    QMutexLocker locker(&Private::openDirectoriesMutex());
+    int removed = 0;
+    for (const QFileInfo& entry : QDir(Private::diskRoot()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (Private::openDirectories().contains(entry.absoluteFilePath())) continue;
+        if (QDir(entry.absoluteFilePath()).removeRecursively()) ++removed;
+    }
+    LOG_INFO("ImagePyramid: Cleared the tiles of " << removed << " images");
+}
+
+QSize ImagePyramid::size() const
+{
+    return d->fullSize;
+}
+
+int ImagePyramid::levelCount() const
+{
+    return d->levels;
+}
+
+QImage ImagePyramid::region(const QRectF& rect, int width, int height) const
+{
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+
+    // The coarsest level with at least one source pixel per output pixel
+    const qreal scale = qMin(width / rect.width(), height / rect.height());
+    const int level = scale >= 1.0 ? 0 : qBound(0, static_cast<int>(std::floor(std::log2(1.0 / scale))), d->levels - 1);
+    const qreal factor = 1 << level;
+    const QRectF levelRect(rect.x() / factor, rect.y() / factor, rect.width() / factor, rect.height() / factor);
+    const QRect covered = levelRect.toAlignedRect() & QRect(QPoint(0, 0), d->levelSize(level));
+
+    QImage output = ImageBufferPool::instance().acquire(QSize(width, height));
+    if (output.isNull()) return QImage();
+    output.fill(Qt::transparent);
+    if (covered.isEmpty()) return output;
+
+    // Tiles are joined first, so scaling sees no seams between them
+    QImage joined(covered.size(), ImageBufferPool::PipelineFormat);
+    if (joined.isNull()) return QImage();
+    joined.fill(Qt::transparent);
+    QPainter painter(&joined);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (int y = covered.top() / TileSize; y <= covered.bottom() / TileSize; ++y) {
+        for (int x = covered.left() / TileSize; x <= covered.right() / TileSize; ++x) {
+            const QImage tile = d->tile(level, x, y);
+            if (tile.isNull()) return QImage();
+            painter.drawImage(d->tileRect(level, x, y).topLeft() - covered.topLeft(), tile);
+        }
+    }
+    painter.end();
+
+    QPainter target(&output);
+    target.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    target.setCompositionMode(QPainter::CompositionMode_Source);
+    target.drawImage(QRectF(0, 0, width, height), joined, levelRect.translated(-covered.topLeft()));
+    target.end();
+    return output;
+}
+
+void ImagePyramid::buildOverview()
+{
+    // The coarsest tile pulls in every level below it
+    std::shared_ptr<Private> priv = d;
+    ThreadPool::instance().submitDetached([priv]() {
+        priv->tile(priv->levels - 1, 0, 0);
+        LOG_DEBUG("ImagePyramid: Overview of " << priv->filePath << " ready");
+    }, Task::Priority::Low);
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,94 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_IMAGEPYRAMID_H
+#define QUANTILYX_IMAGEPYRAMID_H
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Tiled multi-resolution view of an image too large to decode whole.
+ *
+ * Level 0 is the image itself; each further level halves it, down to one
+ * tile. Tiles are decoded on demand: TIFF tiles and strips are read
+ * natively with libtiff, reduced-resolution TIFF directories provide their
+ * levels directly, and other formats are decoded tile by tile through an
+ * image reader that supports clipping. Levels with no source of their own
+ * are generated from the level above and stored on disk under
+ * Application::cacheDirectory(), so they are built once per file.
+ *
+ * Decoded tiles are kept in a memory-bounded cache, registered with
+ * MemoryBudget. Memory use follows the viewport, not the image size.
+ * Safe to use from several threads.
+ */
+class ImagePyramid
+{
+public:
+    /**
+     * @brief Open an image for tiled access.
+     * @param filePath Image file.
+     * @return Pyramid, or null if the format cannot be decoded by region.
+     */
+    static std::unique_ptr<ImagePyramid> open(const QString& filePath);
+
+    /**
+     * @brief Delete the generated tiles of the images that are not open.
+     * Open pyramids keep theirs, as they still read and write them.
+     */
+    static void clearDiskCache();
+
+    /**
+     * @brief Destructor. Stops a background build.
+     */
+    ~ImagePyramid();
+
+    /**
+     * @brief Get the full-resolution size.
+     * @return Size in pixels.
+     */
+    QSize size() const;
+
+    /**
+     * @brief Get the number of levels.
+     * @return Level count, at least 1.
+     */
+    int levelCount() const;
+
+    /**
+     * @brief Render part of the image from the coarsest level that still
+     * has the detail asked for.
+     * @param rect Area in full-resolution pixels.
+     * @param width Output width.
+     * @param height Output height.
+     * @return Image in the pipeline format, or null on failure.
+     */
+    QImage region(const QRectF& rect, int width, int height) const;
+
+    /**
+     * @brief Build the coarse levels on the thread pool, so the first
+     * zoomed-out view finds them ready. Returns at once.
+     */
+    void buildOverview();
+
+private:
+    ImagePyramid();
+
+    class Private;
+    std::shared_ptr<Private> d; // Shared with a background build
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_IMAGEPYRAMID_H
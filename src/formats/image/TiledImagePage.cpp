@@ -0,0 +1,64 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "TiledImagePage.h"
+#include "ImagePyramid.h"
+#include "../../core/Logger.h"
+#include <QVariantMap>
+
+namespace QuantilyxDoc {
+
+class TiledImagePage::Private {
+public:
+    explicit Private(ImagePyramid* p) : pyramid(p) {}
+
+    ImagePyramid* pyramid;
+};
+
+TiledImagePage::TiledImagePage(Document* document, ImagePyramid* pyramid, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(pyramid))
+{
+    setSize(QSizeF(pyramid->size()));
+    LOG_DEBUG("TiledImagePage created, " << pyramid->size() << " px in " << pyramid->levelCount() << " levels");
+}
+
+TiledImagePage::~TiledImagePage() = default;
+
+QImage TiledImagePage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage TiledImagePage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    QImage image = d->pyramid->region(rect, width, height);
+    if (image.isNull()) {
+        LOG_ERROR("Failed to render rectangle " << rect << " of tiled image");
+        return QImage();
+    }
+    return image;
+}
+
+bool TiledImagePage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QVariantMap TiledImagePage::metadata() const
+{
+    QVariantMap map;
+    map["PixelWidth"] = d->pyramid->size().width();
+    map["PixelHeight"] = d->pyramid->size().height();
+    map["Levels"] = d->pyramid->levelCount();
+    return map;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,58 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_TILEDIMAGEPAGE_H
+#define QUANTILYX_TILEDIMAGEPAGE_H
+
+#include "../../core/Page.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class ImagePyramid;
+
+/**
+ * @brief The page of an image too large to decode whole.
+ *
+ * Renders each region from the image's pyramid, at the level that matches
+ * the zoom, so a view costs the pixels it shows. One image pixel is one
+ * point.
+ */
+class TiledImagePage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent document.
+     * @param pyramid The image's pyramid; must outlive the page.
+     * @param parent Parent object.
+     */
+    TiledImagePage(Document* document, ImagePyramid* pyramid, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~TiledImagePage() override;
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QVariantMap metadata() const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_TILEDIMAGEPAGE_H
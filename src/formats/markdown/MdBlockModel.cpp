@@ -0,0 +1,675 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MdBlockModel.h"
+#include <QMultiHash>
+#include <QRegularExpression>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+enum class Kind { Paragraph, Heading, SetextHeading, Fence, IndentedCode, Rule, Html, Quote, List, Table };
+
+// Leading whitespace in columns, tabs to the next multiple of 4
+int indentOf(const QString& line)
+{
+    int columns = 0;
+    for (const QChar c : line) {
+        if (c == QLatin1Char(' ')) ++columns;
+        else if (c == QLatin1Char('\t')) columns += 4 - columns % 4;
+        else break;
+    }
+    return columns;
+}
+
+bool isBlank(const QString& line)
+{
+    return line.trimmed().isEmpty();
+}
+
+// Remove up to the given columns of leading whitespace
+QString stripIndent(const QString& line, int columns)
+{
+    int column = 0;
+    int i = 0;
+    while (i < line.size() && column < columns) {
+        if (line[i] == QLatin1Char(' ')) ++column;
+        else if (line[i] == QLatin1Char('\t')) column += 4 - column % 4;
+        else break;
+        ++i;
+    }
+    return line.mid(i);
+}
+
+bool isFenceOpen(const QString& line, QChar* fenceChar, int* fenceLength)
+{
+    static const QRegularExpression fence(QStringLiteral("^ {0,3}(`{3,}(?!.*`)|~{3,})"));
+    const QRegularExpressionMatch match = fence.match(line);
+    if (!match.hasMatch()) return false;
+    *fenceChar = match.captured(1).at(0);
+    *fenceLength = match.capturedLength(1);
+    return true;
+}
+
+bool isFenceClose(const QString& line, QChar fenceChar, int fenceLength)
+{
+    const QString trimmed = line.trimmed();
+    if (indentOf(line) > 3 || trimmed.size() < fenceLength) return false;
+    for (const QChar c : trimmed) {
+        if (c != fenceChar) return false;
+    }
+    return true;
+}
+
+bool isAtxHeading(const QString& line)
+{
+    static const QRegularExpression heading(QStringLiteral("^ {0,3}#{1,6}(\\s|$)"));
+    return heading.match(line).hasMatch();
+}
+
+bool isThematicBreak(const QString& line)
+{
+    static const QRegularExpression rule(QStringLiteral("^ {0,3}([-*_])(\\s*\\1){2,}\\s*$"));
+    return rule.match(line).hasMatch();
+}
+
+// 1 for a === underline, 2 for ---, else 0
+int setextLevel(const QString& line)
+{
+    static const QRegularExpression underline(QStringLiteral("^ {0,3}(=+|-+)\\s*$"));
+    const QRegularExpressionMatch match = underline.match(line);
+    if (!match.hasMatch()) return 0;
+    return match.captured(1).at(0) == QLatin1Char('=') ? 1 : 2;
+}
+
+struct ListMarker {
+    bool ordered = false;
+    int number = 1;
+    int contentIndent = 0; // Column where the item's content starts
+    QString content;       // The first line after the marker
+};
+
+bool isListMarker(const QString& line, ListMarker* marker = nullptr)
+{
+    static const QRegularExpression item(QStringLiteral("^( {0,3})([-+*]|(\\d{1,9})[.)])([ \\t]+|$)(.*)$"));
+    const QRegularExpressionMatch match = item.match(line);
+    if (!match.hasMatch() || isThematicBreak(line)) return false;
+    if (marker) {
+        marker->ordered = match.capturedLength(3) > 0;
+        marker->number = marker->ordered ? match.captured(3).toInt() : 1;
+        const int spaces = match.capturedLength(4);
+        // Five or more spaces start indented code inside the item
+        marker->contentIndent = match.capturedLength(1) + match.capturedLength(2) + (spaces >= 1 && spaces <= 4 ? spaces : 1);
+        marker->content = spaces > 4 ? match.captured(4).mid(1) + match.captured(5) : match.captured(5);
+    }
+    return true;
+}
+
+bool isQuote(const QString& line)
+{
+    return indentOf(line) <= 3 && line.trimmed().startsWith(QLatin1Char('>'));
+}
+
+bool isHtmlStart(const QString& line)
+{
+    static const QRegularExpression tag(QStringLiteral("^ {0,3}<(/?[A-Za-z][A-Za-z0-9-]*(\\s|/?>|$)|!--)"));
+    return tag.match(line).hasMatch();
+}
+
+bool isTableDelimiter(const QString& line)
+{
+    static const QRegularExpression delimiter(QStringLiteral("^ {0,3}\\|?\\s*:?-+:?\\s*(\\|\\s*:?-+:?\\s*)*\\|?\\s*$"));
+    return line.contains(QLatin1Char('-')) && delimiter.match(line).hasMatch();
+}
+
+// Lines that end a paragraph without a blank line before them
+bool interruptsParagraph(const QString& line)
+{
+    QChar fenceChar;
+    int fenceLength = 0;
+    ListMarker marker;
+    if (isAtxHeading(line) || isThematicBreak(line) || isQuote(line) || isFenceOpen(line, &fenceChar, &fenceLength)) return true;
+    if (isHtmlStart(line)) return true;
+    // Only lists that cannot be mistaken for wrapped text
+    return isListMarker(line, &marker) && !marker.content.trimmed().isEmpty() && (!marker.ordered || marker.number == 1);
+}
+
+// Find where the block starting at a non-blank line ends. The decision
+// looks no further than the first non-blank line after the block, which
+// is what lets an edit re-split from the block before it.
+int blockEnd(const QStringList& lines, int start, Kind* kind)
+{
+    const int count = lines.size();
+    const QString& first = lines[start];
+
+    QChar fenceChar;
+    int fenceLength = 0;
+    if (isFenceOpen(first, &fenceChar, &fenceLength)) {
+        *kind = Kind::Fence;
+        int i = start + 1;
+        while (i < count && !isFenceClose(lines[i], fenceChar, fenceLength)) ++i;
+        return qMin(count, i + 1);
+    }
+    if (isAtxHeading(first)) {
+        *kind = Kind::Heading;
+        return start + 1;
+    }
+    if (isThematicBreak(first)) {
+        *kind = Kind::Rule;
+        return start + 1;
+    }
+    if (indentOf(first) >= 4) {
+        *kind = Kind::IndentedCode;
+        int last = start;
+        for (int i = start + 1; i < count; ++i) {
+            if (isBlank(lines[i])) continue;
+            if (indentOf(lines[i]) < 4) break;
+            last = i;
+        }
+        return last + 1;
+    }
+    if (isHtmlStart(first)) {
+        *kind = Kind::Html;
+        int i = start + 1;
+        while (i < count && !isBlank(lines[i])) ++i;
+        return i;
+    }
+    if (isQuote(first)) {
+        *kind = Kind::Quote;
+        int i = start + 1;
+        while (i < count && !isBlank(lines[i]) && (isQuote(lines[i]) || !interruptsParagraph(lines[i]))) ++i;
+        return i;
+    }
+    if (isListMarker(first)) {
+        *kind = Kind::List;
+        int last = start;
+        int i = start + 1;
+        while (i < count) {
+            if (isBlank(lines[i])) {
+                // A blank line continues the list if what follows belongs to it
+                int next = i + 1;
+                while (next < count && isBlank(lines[next])) ++next;
+                if (next == count || (indentOf(lines[next]) < 2 && !isListMarker(lines[next]))) break;
+                i = next;
+                continue;
+            }
+            const QString& line = lines[i];
+            if (indentOf(line) < 2 && !isListMarker(line) && interruptsParagraph(line)) break;
+            last = i++;
+        }
+        return last + 1;
+    }
+
+    *kind = Kind::Paragraph;
+    int i = start + 1;
+    if (i < count && first.contains(QLatin1Char('|')) && isTableDelimiter(lines[i])) {
+        *kind = Kind::Table;
+        while (i < count && !isBlank(lines[i])) ++i;
+        return i;
+    }
+    while (i < count && !isBlank(lines[i])) {
+        if (setextLevel(lines[i])) {
+            *kind = Kind::SetextHeading;
+            return i + 1;
+        }
+        if (interruptsParagraph(lines[i])) break;
+        ++i;
+    }
+    return i;
+}
+
+QString escape(const QString& text)
+{
+    return text.toHtmlEscaped();
+}
+
+// Inline syntax. Code spans, tags and escaped characters are parked in a
+// stash behind private-use placeholders so later patterns cannot touch them.
+QString renderInline(const QString& text)
+{
+    QStringList stash;
+    auto keep = [&stash](const QString& html) {
+        stash.append(html);
+        return QChar(0xF000) + QString::number(stash.size() - 1) + QChar(0xF001);
+    };
+
+    // Code spans: a run of backticks closed by a run of the same length
+    QString s;
+    int i = 0;
+    while (i < text.size()) {
+        const int tick = text.indexOf(QLatin1Char('`'), i);
+        if (tick < 0) {
+            s += text.mid(i);
+            break;
+        }
+        int run = 1;
+        while (tick + run < text.size() && text[tick + run] == QLatin1Char('`')) ++run;
+        int close = tick + run;
+        int closeRun = 0;
+        while ((close = text.indexOf(QLatin1Char('`'), close)) >= 0) {
+            closeRun = 1;
+            while (close + closeRun < text.size() && text[close + closeRun] == QLatin1Char('`')) ++closeRun;
+            if (closeRun == run) break;
+            close += closeRun;
+        }
+        s += text.mid(i, tick - i);
+        if (close < 0) {
+            s += text.mid(tick, run);
+            i = tick + run;
+            continue;
+        }
+        QString code = text.mid(tick + run, close - tick - run);
+        code.replace(QLatin1Char('\n'), QLatin1Char(' '));
+        if (code.size() > 2 && code.startsWith(QLatin1Char(' ')) && code.endsWith(QLatin1Char(' '))) code = code.mid(1, code.size() - 2);
+        s += keep(QStringLiteral("<code>") + escape(code) + QStringLiteral("</code>"));
+        i = close + run;
+    }
+
+    static const QRegularExpression hardBreak(QStringLiteral("(?: {2,}|\\\\)\\n"));
+    s.replace(hardBreak, keep(QStringLiteral("<br/>")));
+
+    static const QRegularExpression escaped(QStringLiteral("\\\\([!-/:-@\\[-`{-~])"));
+    QString unescaped;
+    int last = 0;
+    QRegularExpressionMatchIterator matches = escaped.globalMatch(s);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        unescaped += s.mid(last, match.capturedStart() - last) + keep(escape(match.captured(1)));
+        last = match.capturedEnd();
+    }
+    s = escape(unescaped + s.mid(last));
+
+    // Images and links; the link text stays open to emphasis
+    static const QRegularExpression link(QStringLiteral(
+        "(!?)\\[([^\\]]*)\\]\\(\\s*([^\\s)]+)(?:\\s+&quot;(?:[^&]|&(?!quot;))*&quot;)?\\s*\\)"));
+    QString linked;
+    last = 0;
+    matches = link.globalMatch(s);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        linked += s.mid(last, match.capturedStart() - last);
+        if (!match.captured(1).isEmpty()) {
+            linked += keep(QStringLiteral("<img src=\"%1\" alt=\"%2\"/>").arg(match.captured(3), match.captured(2)));
+        } else {
+            linked += keep(QStringLiteral("<a href=\"%1\">").arg(match.captured(3))) + match.captured(2) + keep(QStringLiteral("</a>"));
+        }
+        last = match.capturedEnd();
+    }
+    s = linked + s.mid(last);
+
+    static const QRegularExpression autolink(QStringLiteral("&lt;((?:https?|ftp)://[^\\s&]+|mailto:[^\\s&]+)&gt;"));
+    QString autolinked;
+    last = 0;
+    matches = autolink.globalMatch(s);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        autolinked += s.mid(last, match.capturedStart() - last)
+                      + keep(QStringLiteral("<a href=\"%1\">%1</a>").arg(match.captured(1)));
+        last = match.capturedEnd();
+    }
+    s = autolinked + s.mid(last);
+
+    static const QRegularExpression strongStars(QStringLiteral("\\*\\*(?=\\S)(.+?)(?<=\\S)\\*\\*"));
+    static const QRegularExpression strongUnderscores(QStringLiteral("(?<![A-Za-z0-9])__(?=\\S)(.+?)(?<=\\S)__(?![A-Za-z0-9])"));
+    static const QRegularExpression emStar(QStringLiteral("\\*(?=\\S)(.+?)(?<=\\S)\\*"));
+    static const QRegularExpression emUnderscore(QStringLiteral("(?<![A-Za-z0-9])_(?=\\S)(.+?)(?<=\\S)_(?![A-Za-z0-9])"));
+    static const QRegularExpression strike(QStringLiteral("~~(?=\\S)(.+?)(?<=\\S)~~"));
+    s.replace(strongStars, QStringLiteral("<strong>\\1</strong>"));
+    s.replace(strongUnderscores, QStringLiteral("<strong>\\1</strong>"));
+    s.replace(emStar, QStringLiteral("<em>\\1</em>"));
+    s.replace(emUnderscore, QStringLiteral("<em>\\1</em>"));
+    s.replace(strike, QStringLiteral("<del>\\1</del>"));
+
+    static const QRegularExpression placeholder(QStringLiteral("\\x{F000}(\\d+)\\x{F001}"));
+    QString result;
+    last = 0;
+    matches = placeholder.globalMatch(s);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        result += s.mid(last, match.capturedStart() - last) + stash.value(match.captured(1).toInt());
+        last = match.capturedEnd();
+    }
+    return result + s.mid(last);
+}
+
+QString renderBlocks(const QStringList& lines, bool tight = false);
+
+QStringList tableCells(const QString& row)
+{
+    QString trimmed = row.trimmed();
+    if (trimmed.startsWith(QLatin1Char('|'))) trimmed.remove(0, 1);
+    if (trimmed.endsWith(QLatin1Char('|')) && !trimmed.endsWith(QLatin1String("\\|"))) trimmed.chop(1);
+    QStringList cells;
+    QString cell;
+    for (int i = 0; i < trimmed.size(); ++i) {
+        if (trimmed[i] == QLatin1Char('\\') && i + 1 < trimmed.size() && trimmed[i + 1] == QLatin1Char('|')) {
+            cell += QLatin1Char('|');
+            ++i;
+        } else if (trimmed[i] == QLatin1Char('|')) {
+            cells.append(cell.trimmed());
+            cell.clear();
+        } else {
+            cell += trimmed[i];
+        }
+    }
+    cells.append(cell.trimmed());
+    return cells;
+}
+
+QString renderTable(const QStringList& lines)
+{
+    const QStringList header = tableCells(lines[0]);
+    QStringList alignments;
+    for (const QString& spec : tableCells(lines[1])) {
+        const bool left = spec.startsWith(QLatin1Char(':'));
+        const bool right = spec.endsWith(QLatin1Char(':'));
+        alignments.append(left && right ? QStringLiteral(" align=\"center\"")
+                          : right       ? QStringLiteral(" align=\"right\"")
+                          : left        ? QStringLiteral(" align=\"left\"")
+                                        : QString());
+    }
+
+    QString html = QStringLiteral("<table border=\"1\" cellspacing=\"0\" cellpadding=\"4\"><thead><tr>");
+    for (int c = 0; c < header.size(); ++c) {
+        html += QStringLiteral("<th%1>%2</th>").arg(alignments.value(c), renderInline(header[c]));
+    }
+    html += QStringLiteral("</tr></thead><tbody>");
+    for (int r = 2; r < lines.size(); ++r) {
+        const QStringList cells = tableCells(lines[r]);
+        html += QStringLiteral("<tr>");
+        // Rows take the header's column count
+        for (int c = 0; c < header.size(); ++c) {
+            html += QStringLiteral("<td%1>%2</td>").arg(alignments.value(c), renderInline(cells.value(c)));
+        }
+        html += QStringLiteral("</tr>");
+    }
+    return html + QStringLiteral("</tbody></table>");
+}
+
+QString renderList(const QStringList& lines)
+{
+    struct Item {
+        QStringList content;
+    };
+    QVector<Item> items;
+    ListMarker first;
+    isListMarker(lines[0], &first);
+    int contentIndent = first.contentIndent;
+    items.append(Item{QStringList{first.content}});
+
+    bool loose = false;
+    bool pendingBlank = false;
+    for (int i = 1; i < lines.size(); ++i) {
+        const QString& line = lines[i];
+        ListMarker marker;
+        if (isBlank(line)) {
+            pendingBlank = true;
+            items.last().content.append(QString());
+            continue;
+        }
+        if (indentOf(line) >= contentIndent) {
+            if (pendingBlank) loose = true;
+            items.last().content.append(stripIndent(line, contentIndent));
+        } else if (isListMarker(line, &marker)) {
+            if (pendingBlank) loose = true;
+            contentIndent = marker.contentIndent;
+            items.append(Item{QStringList{marker.content}});
+        } else {
+            items.last().content.append(line.trimmed()); // Lazy continuation
+        }
+        pendingBlank = false;
+    }
+
+    QString html = first.ordered ? (first.number == 1 ? QStringLiteral("<ol>") : QStringLiteral("<ol start=\"%1\">").arg(first.number))
+                                 : QStringLiteral("<ul>");
+    for (Item& item : items) {
+        while (!item.content.isEmpty() && isBlank(item.content.last())) item.content.removeLast();
+        QString prefix;
+        if (!item.content.isEmpty()) {
+            QString& head = item.content.first();
+            if (head.startsWith(QLatin1String("[ ] "))) {
+                prefix = QString(QChar(0x2610)) + QLatin1Char(' ');
+                head.remove(0, 4);
+            } else if (head.startsWith(QLatin1String("[x] ")) || head.startsWith(QLatin1String("[X] "))) {
+                prefix = QString(QChar(0x2611)) + QLatin1Char(' ');
+                head.remove(0, 4);
+            }
+        }
+        html += QStringLiteral("<li>") + prefix + renderBlocks(item.content, !loose) + QStringLiteral("</li>");
+    }
+    return html + (first.ordered ? QStringLiteral("</ol>") : QStringLiteral("</ul>"));
+}
+
+QString renderBlock(const QStringList& lines, int start, int end, Kind kind, bool tight)
+{
+    const QStringList block = lines.mid(start, end - start);
+    switch (kind) {
+    case Kind::Heading: {
+        static const QRegularExpression atx(QStringLiteral("^ {0,3}(#{1,6})(?:[ \\t]+(.*?))?(?:[ \\t]+#+)?[ \\t]*$"));
+        const QRegularExpressionMatch match = atx.match(block[0]);
+        const int level = match.capturedLength(1);
+        return QStringLiteral("<h%1>%2</h%1>").arg(level).arg(renderInline(match.captured(2).trimmed()));
+    }
+    case Kind::SetextHeading: {
+        QStringList text;
+        for (int i = 0; i + 1 < block.size(); ++i) text.append(block[i].trimmed());
+        const int level = setextLevel(block.last());
+        return QStringLiteral("<h%1>%2</h%1>").arg(level).arg(renderInline(text.join(QLatin1Char('\n'))));
+    }
+    case Kind::Fence: {
+        QChar fenceChar;
+        int fenceLength = 0;
+        isFenceOpen(block[0], &fenceChar, &fenceLength);
+        const int fenceIndent = indentOf(block[0]);
+        const QString info = block[0].trimmed().mid(fenceLength).trimmed().section(QLatin1Char(' '), 0, 0);
+        const bool closed = block.size() > 1 && isFenceClose(block.last(), fenceChar, fenceLength);
+        QStringList code;
+        for (int i = 1; i < (closed ? block.size() - 1 : block.size()); ++i) code.append(stripIndent(block[i], fenceIndent));
+        const QString language = info.isEmpty() ? QString() : QStringLiteral(" class=\"language-%1\"").arg(escape(info));
+        return QStringLiteral("<pre><code%1>%2</code></pre>").arg(language, escape(code.join(QLatin1Char('\n'))));
+    }
+    case Kind::IndentedCode: {
+        QStringList code;
+        for (const QString& line : block) code.append(stripIndent(line, 4));
+        return QStringLiteral("<pre><code>%1</code></pre>").arg(escape(code.join(QLatin1Char('\n'))));
+    }
+    case Kind::Rule:
+        return QStringLiteral("<hr/>");
+    case Kind::Html:
+        return block.join(QLatin1Char('\n'));
+    case Kind::Quote: {
+        QStringList inner;
+        for (const QString& line : block) {
+            if (!isQuote(line)) {
+                inner.append(line); // Lazy continuation
+                continue;
+            }
+            QString content = line.trimmed().mid(1);
+            if (content.startsWith(QLatin1Char(' '))) content.remove(0, 1);
+            inner.append(content);
+        }
+        return QStringLiteral("<blockquote>") + renderBlocks(inner) + QStringLiteral("</blockquote>");
+    }
+    case Kind::List:
+        return renderList(block);
+    case Kind::Table:
+        return renderTable(block);
+    case Kind::Paragraph:
+        break;
+    }
+
+    QStringList text;
+    for (const QString& line : block) text.append(stripIndent(line, 3));
+    const QString content = renderInline(text.join(QLatin1Char('\n')).trimmed());
+    return tight ? content : QStringLiteral("<p>%1</p>").arg(content);
+}
+
+// Split and render; tight list items drop the paragraph tags
+QString renderBlocks(const QStringList& lines, bool tight)
+{
+    QString html;
+    int i = 0;
+    while (i < lines.size()) {
+        if (isBlank(lines[i])) {
+            ++i;
+            continue;
+        }
+        Kind kind;
+        const int end = blockEnd(lines, i, &kind);
+        html += renderBlock(lines, i, end, kind, tight);
+        i = end;
+    }
+    return html;
+}
+
+QStringList splitLines(const QString& text)
+{
+    QStringList lines = text.split(QLatin1Char('\n'));
+    for (QString& line : lines) {
+        if (line.endsWith(QLatin1Char('\r'))) line.chop(1);
+    }
+    return lines;
+}
+
+} // namespace
+
+class MdBlockModel::Private {
+public:
+    Private() : nextId(1), htmlDirty(true) {}
+
+    QStringList lines;
+    QVector<Block> blocks;
+    quint64 nextId;
+    mutable QString htmlCache;
+    mutable bool htmlDirty;
+};
+
+MdBlockModel::MdBlockModel()
+    : d(new Private())
+{
+}
+
+MdBlockModel::~MdBlockModel() = default;
+
+MdBlockModel::Change MdBlockModel::setText(const QString& markdown)
+{
+    const QStringList newLines = splitLines(markdown);
+    const QStringList& oldLines = d->lines;
+    const int oldCount = oldLines.size();
+    const int newCount = newLines.size();
+
+    // The edited range: everything between the common prefix and suffix
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && oldLines[prefix] == newLines[prefix]) ++prefix;
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix
+           && oldLines[oldCount - 1 - suffix] == newLines[newCount - 1 - suffix]) {
+        ++suffix;
+    }
+    Change change;
+    if (prefix == oldCount && prefix == newCount && !d->blocks.isEmpty()) return change;
+
+    // Re-split from the block before the one holding the first edited line:
+    // that block's end was decided by looking at the line after it
+    int first = 0;
+    while (first + 1 < d->blocks.size() && d->blocks[first + 1].firstLine <= prefix) ++first;
+    first = qMax(0, first - 1);
+    const int startLine = first == 0 ? 0 : d->blocks[first].firstLine;
+    const int delta = newCount - oldCount;
+    const int editEnd = newCount - suffix; // First line of the unchanged suffix, in the new text
+
+    QVector<Block> parsed;
+    QVector<Kind> kinds; // By parsed block
+    int resync = d->blocks.size(); // First old block kept after the edit
+    int candidate = first;
+    int line = startLine;
+    while (line < newCount) {
+        if (isBlank(newLines[line])) {
+            ++line;
+            continue;
+        }
+        // A block starting in the suffix where an old one started is
+        // followed by exactly the old blocks
+        if (line >= editEnd) {
+            while (candidate < d->blocks.size() && d->blocks[candidate].firstLine < line - delta) ++candidate;
+            if (candidate < d->blocks.size() && d->blocks[candidate].firstLine == line - delta) {
+                resync = candidate;
+                break;
+            }
+        }
+        Kind kind;
+        const int end = blockEnd(newLines, line, &kind);
+        Block block;
+        block.firstLine = line;
+        block.lineCount = end - line;
+        block.source = newLines.mid(line, end - line).join(QLatin1Char('\n'));
+        parsed.append(block);
+        kinds.append(kind);
+        line = end;
+    }
+
+    // Replaced blocks with identical source keep their ID and HTML, such
+    // as those around an edit that merely moved them
+    QMultiHash<QString, int> replaced;
+    for (int i = first; i < resync; ++i) replaced.insert(d->blocks[i].source, i);
+    for (int i = 0; i < parsed.size(); ++i) {
+        Block& block = parsed[i];
+        const auto it = replaced.find(block.source);
+        if (it != replaced.end()) {
+            const Block& old = d->blocks[it.value()];
+            block.id = old.id;
+            block.html = old.html;
+            replaced.erase(it);
+            continue;
+        }
+        const QStringList blockLines = newLines.mid(block.firstLine, block.lineCount);
+        block.id = d->nextId++;
+        block.html = renderBlock(blockLines, 0, blockLines.size(), kinds[i], false);
+        change.added.append(block.id);
+    }
+    for (auto it = replaced.cbegin(); it != replaced.cend(); ++it) change.removed.append(d->blocks[it.value()].id);
+
+    QVector<Block> blocks;
+    blocks.reserve(first + parsed.size() + d->blocks.size() - resync);
+    for (int i = 0; i < first; ++i) blocks.append(d->blocks[i]);
+    blocks += parsed;
+    for (int i = resync; i < d->blocks.size(); ++i) {
+        Block block = d->blocks[i];
+        block.firstLine += delta;
+        blocks.append(block);
+    }
+    d->blocks = blocks;
+    d->lines = newLines;
+    d->htmlDirty = true;
+    return change;
+}
+
+const QVector<MdBlockModel::Block>& MdBlockModel::blocks() const
+{
+    return d->blocks;
+}
+
+QString MdBlockModel::html() const
+{
+    if (d->htmlDirty) {
+        QString body;
+        for (const Block& block : d->blocks) body += block.html + QLatin1Char('\n');
+        d->htmlCache = QStringLiteral("<html><body>\n") + body + QStringLiteral("</body></html>");
+        d->htmlDirty = false;
+    }
+    return d->htmlCache;
+}
+
+QString MdBlockModel::render(const QString& markdown)
+{
+    return renderBlocks(splitLines(markdown));
+}
+
+} // namespace QuantilyxDoc
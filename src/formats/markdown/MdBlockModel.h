@@ -0,0 +1,93 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MDBLOCKMODEL_H
+#define QUANTILYX_MDBLOCKMODEL_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Markdown text split into top-level blocks, each rendered to HTML.
+ *
+ * A block is a heading, paragraph, list, block quote, code block, table,
+ * rule or HTML block. When the text changes, only the lines between the
+ * common prefix and suffix of the old and new text are split again, from
+ * the block before the edit until a block boundary lines up with the old
+ * text; every other block keeps its ID and its HTML. A block's ID never
+ * changes while its source does not, so layouts can be cached by ID.
+ *
+ * Covers CommonMark's block structure and common inline syntax, plus GFM
+ * tables, strikethrough and task lists; reference-style links are left
+ * as written.
+ */
+class MdBlockModel
+{
+public:
+    /**
+     * @brief One top-level block.
+     */
+    struct Block {
+        quint64 id = 0;    ///< Stable while the source is unchanged
+        int firstLine = 0; ///< 0-based line of the block's first line
+        int lineCount = 0; ///< Lines the block spans
+        QString source;    ///< The block's markdown
+        QString html;      ///< The block rendered to HTML
+    };
+
+    /**
+     * @brief What an update did to the blocks.
+     */
+    struct Change {
+        QVector<quint64> removed; ///< IDs no longer present
+        QVector<quint64> added;   ///< IDs new in this update
+        bool isEmpty() const { return removed.isEmpty() && added.isEmpty(); }
+    };
+
+    MdBlockModel();
+    ~MdBlockModel();
+
+    /**
+     * @brief Replace the text, re-parsing only the blocks the edit touches.
+     * @param markdown The whole new text.
+     * @return Blocks removed and added.
+     */
+    Change setText(const QString& markdown);
+
+    /**
+     * @brief Get the blocks in document order.
+     * @return Blocks.
+     */
+    const QVector<Block>& blocks() const;
+
+    /**
+     * @brief Get the whole document as HTML, joined from the blocks.
+     * @return HTML document.
+     */
+    QString html() const;
+
+    /**
+     * @brief Render a piece of markdown to an HTML fragment.
+     * @param markdown Text to render.
+     * @return HTML fragment.
+     */
+    static QString render(const QString& markdown);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MDBLOCKMODEL_H
@@ -8,14 +8,15 @@
  * (at your option) any later version.
  */
 #include "MdDocument.h"
+#include "MdBlockModel.h"
 #include "MdPage.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QTextStream>
 #include <QDebug>
-// #include "markdown/parser.h" // Hypothetical Markdown parser library
 
 namespace QuantilyxDoc {
 
@@ -26,18 +27,8 @@ public:
 
     bool isLoaded;
     QString markdownContentVal;
-    QString renderedHtmlCache;
+    MdBlockModel blocks; // Parsed and rendered block by block
     std::unique_ptr<MdPage> singlePage;
-
-    // Helper to render Markdown to HTML
-    QString renderMarkdownToHtml(const QString& markdown) const {
-        // This requires a Markdown parser library like Hoedown, Discount, or QTextDocument's limited support.
-        // QTextDocument doc;
-        // doc.setMarkdown(markdown); // Qt 5.14+
-        // return doc.toHtml();
-        LOG_WARN("MdDocument::renderMarkdownToHtml: Requires Markdown parser library.");
-        return "<html><body><p>Markdown rendering not available.</p></body></html>"; // Placeholder
-    }
 };
 
 MdDocument::MdDocument(QObject* parent)
@@ -57,6 +48,8 @@ bool MdDocument::load(const QString& filePath, const QString& password)
     Q_UNUSED(password);
     d->isLoaded = false;
 
+    LoadTrace trace(filePath, QStringLiteral("Markdown"));
+    trace.phase(LoadTrace::Io);
     QFile mdFile(filePath);
     if (!mdFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         setLastError(tr("Failed to open Markdown file."));
@@ -64,14 +57,16 @@ bool MdDocument::load(const QString& filePath, const QString& password)
         return false;
     }
 
-    d->markdownContentVal = mdFile.readAll();
+    d->markdownContentVal = QString::fromUtf8(mdFile.readAll());
     mdFile.close();
 
-    // Render to HTML cache
-    d->renderedHtmlCache = d->renderMarkdownToHtml(d->markdownContentVal);
-
     setFilePath(filePath);
+    trace.phase(LoadTrace::Parse);
     createPages();
+    const MdBlockModel::Change change = d->blocks.setText(d->markdownContentVal);
+    trace.phase(LoadTrace::Pages);
+    d->singlePage->updateBlocks(d->blocks, change.removed);
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -111,9 +106,7 @@ int MdDocument::pageCount() const
 Page* MdDocument::page(int index) const
 {
     if (index == 0) {
-        // return d->singlePage.get(); // Placeholder
-        LOG_DEBUG("MdDocument::page: Requested single page.");
-        return nullptr;
+        return d->singlePage.get();
     }
     return nullptr;
 }
@@ -148,13 +141,28 @@ QString MdDocument::markdownContent() const
 
 QString MdDocument::renderedHtml() const
 {
-    return d->renderedHtmlCache;
+    return d->blocks.html();
+}
+
+void MdDocument::setMarkdownContent(const QString& markdown)
+{
+    if (markdown == d->markdownContentVal && d->singlePage) return;
+    d->markdownContentVal = markdown;
+    if (!d->singlePage) createPages();
+
+    const MdBlockModel::Change change = d->blocks.setText(markdown);
+    if (!change.isEmpty()) {
+        d->singlePage->updateBlocks(d->blocks, change.removed);
+        emit blocksChanged(change.removed, change.added);
+    }
+    LOG_DEBUG("MdDocument: Edit replaced " << change.removed.size() << " blocks with " << change.added.size());
+    setModified(true);
 }
 
 void MdDocument::createPages()
 {
-    // Create a single page for the Markdown content
-    // d->singlePage = std::make_unique<MdPage>(this, 0); // Placeholder
+    // One continuous page holds every block
+    d->singlePage.reset(new MdPage(this));
     LOG_INFO("MdDocument: Created single page object.");
 }
 
@@ -13,6 +13,7 @@
 #include "../../core/Document.h"
 #include <memory>
 #include <QList>
+#include <QVector>
 
 namespace QuantilyxDoc {
 
@@ -21,8 +22,9 @@ class MdPage; // Forward declaration
 /**
  * @brief Markdown document implementation.
  * 
- * Handles loading and parsing of Markdown files (.md, .markdown).
- * Rendering to HTML or other formats is handled separately.
+ * Handles loading and parsing of Markdown files (.md, .markdown). The text
+ * is kept as a list of blocks; an edit re-parses and re-lays out only the
+ * blocks it touches, so live preview of long notes stays responsive.
  */
 class MdDocument : public Document
 {
@@ -47,9 +49,25 @@ public:
     QString markdownContent() const;
     QString renderedHtml() const; // Cached HTML rendering
 
+    /**
+     * @brief Replace the Markdown text, for example from an editor.
+     *
+     * Only the blocks between the unchanged start and end of the text are
+     * parsed again; the others keep their IDs, HTML and layout.
+     * @param markdown The whole new text.
+     */
+    void setMarkdownContent(const QString& markdown);
+
 signals:
     void mdLoaded();
 
+    /**
+     * @brief Emitted when an edit replaces blocks.
+     * @param removed IDs of blocks gone from the document.
+     * @param added IDs of blocks parsed for this edit.
+     */
+    void blocksChanged(const QVector<quint64>& removed, const QVector<quint64>& added);
+
 private:
     class Private;
     std::unique_ptr<Private> d;
@@ -0,0 +1,189 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MdPage.h"
+#include "MdBlockModel.h"
+#include "MdDocument.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/Logger.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QTextDocument>
+#include <algorithm>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// US Letter width with 3/4 inch margins, in points
+const qreal PageWidth = 612.0;
+const qreal Margin = 54.0;
+const qreal TextWidth = PageWidth - 2 * Margin;
+
+const char* const BlockStyle =
+    "pre { background-color: #f4f4f4; }"
+    "code { font-family: monospace; }"
+    "blockquote { color: #555555; margin-left: 16px; }";
+
+} // namespace
+
+class MdPage::Private {
+public:
+    explicit Private(MdDocument* doc) : document(doc) {}
+
+    // One block laid out at the text width. Shared with renders in flight,
+    // so an edit never deletes a layout that is being painted.
+    struct Layout {
+        std::unique_ptr<QTextDocument> document;
+        QString plainText;
+        qreal height = 0;
+        QMutex paintMutex; // QTextDocument is not reentrant
+    };
+
+    struct Placed {
+        std::shared_ptr<Layout> layout;
+        qreal top = 0; // In page points
+    };
+
+    MdDocument* document;
+    mutable QMutex mutex; // Protects layouts and placed
+    QHash<quint64, std::shared_ptr<Layout>> layouts;
+    QVector<Placed> placed; // In document order
+
+    static std::shared_ptr<Layout> layOut(const QString& html) {
+        std::shared_ptr<Layout> layout = std::make_shared<Layout>();
+        layout->document.reset(new QTextDocument());
+        layout->document->setDocumentMargin(0);
+        layout->document->setDefaultStyleSheet(QString::fromLatin1(BlockStyle));
+        layout->document->setHtml(html);
+        layout->document->setTextWidth(TextWidth);
+        layout->height = layout->document->size().height(); // Lays the block out
+        layout->plainText = layout->document->toPlainText();
+        return layout;
+    }
+
+    // The placed blocks crossing a vertical range
+    QVector<Placed> blocksIn(qreal top, qreal bottom) const {
+        QMutexLocker locker(&mutex);
+        auto first = std::upper_bound(placed.cbegin(), placed.cend(), top,
+                                      [](qreal y, const Placed& block) { return y < block.top + block.layout->height; });
+        QVector<Placed> result;
+        for (auto it = first; it != placed.cend() && it->top < bottom; ++it) result.append(*it);
+        return result;
+    }
+};
+
+MdPage::MdPage(MdDocument* document, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(document))
+{
+    setSize(QSizeF(PageWidth, PageWidth * 1.294)); // Letter until laid out
+    LOG_DEBUG("MdPage created.");
+}
+
+MdPage::~MdPage() = default;
+
+void MdPage::updateBlocks(const MdBlockModel& blocks, const QVector<quint64>& removed)
+{
+    // Lay out new blocks outside the lock; renders keep painting meanwhile
+    QHash<quint64, std::shared_ptr<Private::Layout>> layouts;
+    {
+        QMutexLocker locker(&d->mutex);
+        layouts = d->layouts;
+    }
+    for (quint64 id : removed) layouts.remove(id);
+    int laidOut = 0;
+    QVector<Private::Placed> placed;
+    placed.reserve(blocks.blocks().size());
+    qreal top = Margin;
+    for (const MdBlockModel::Block& block : blocks.blocks()) {
+        std::shared_ptr<Private::Layout>& layout = layouts[block.id];
+        if (!layout) {
+            layout = Private::layOut(block.html);
+            ++laidOut;
+        }
+        placed.append(Private::Placed{layout, top});
+        top += layout->height;
+    }
+    {
+        QMutexLocker locker(&d->mutex);
+        d->layouts = layouts;
+        d->placed = placed;
+    }
+    LOG_DEBUG("MdPage: Laid out " << laidOut << " of " << placed.size() << " blocks");
+
+    const QSizeF newSize(PageWidth, qMax(top + Margin, PageWidth * 1.294));
+    if (newSize != size()) {
+        setSize(newSize);
+        emit d->document->pageSizesChanged();
+    }
+    emit contentChanged();
+}
+
+QImage MdPage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage MdPage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+
+    QImage image = ImageBufferPool::instance().acquire(QSize(width, height));
+    if (image.isNull()) return QImage();
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    const qreal scale = qMin(width / rect.width(), height / rect.height());
+    painter.scale(scale, scale);
+    painter.translate(-rect.topLeft());
+
+    for (const Private::Placed& block : d->blocksIn(rect.top(), rect.bottom())) {
+        painter.save();
+        painter.translate(Margin, block.top);
+        const QRectF clip = rect.translated(-Margin, -block.top) & QRectF(0, 0, TextWidth, block.layout->height);
+        {
+            QMutexLocker locker(&block.layout->paintMutex);
+            block.layout->document->drawContents(&painter, clip);
+        }
+        painter.restore();
+    }
+    painter.end();
+    return image;
+}
+
+bool MdPage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QString MdPage::text() const
+{
+    QMutexLocker locker(&d->mutex);
+    QStringList blocks;
+    blocks.reserve(d->placed.size());
+    for (const Private::Placed& block : d->placed) blocks.append(block.layout->plainText);
+    return blocks.join(QLatin1Char('\n'));
+}
+
+QString MdPage::textInRegion(const QRectF& region) const
+{
+    // Whole blocks; a block is the unit the layout is kept in
+    QStringList blocks;
+    for (const Private::Placed& block : d->blocksIn(region.top(), region.bottom())) blocks.append(block.layout->plainText);
+    return blocks.join(QLatin1Char('\n'));
+}
+
+} // namespace QuantilyxDoc
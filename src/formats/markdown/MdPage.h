@@ -0,0 +1,68 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MDPAGE_H
+#define QUANTILYX_MDPAGE_H
+
+#include "../../core/Page.h"
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class MdDocument;
+class MdBlockModel;
+
+/**
+ * @brief The single, continuous page of a Markdown document.
+ *
+ * Each top-level block is laid out on its own and stacked; layouts are
+ * cached by block ID, so an edit lays out only the blocks it changed and
+ * the rest only move. Renders paint just the blocks the region crosses.
+ */
+class MdPage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent MdDocument.
+     * @param parent Parent object.
+     */
+    explicit MdPage(MdDocument* document, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~MdPage() override;
+
+    /**
+     * @brief Bring the layout up to date with the document's blocks.
+     * Call on the page's thread after the blocks change.
+     * @param blocks The document's blocks.
+     * @param removed IDs of blocks whose layouts are no longer needed.
+     */
+    void updateBlocks(const MdBlockModel& blocks, const QVector<quint64>& removed);
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QString text() const override;
+    QString textInRegion(const QRectF& region) const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MDPAGE_H
@@ -0,0 +1,454 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MobiContainer.h"
+#include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextCodec>
+#include <QVector>
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const int PalmDbHeaderSize = 78;
+const int RecordEntrySize = 8;
+
+// Compression types in the PalmDOC header
+const int NoCompression = 1;
+const int PalmDocCompression = 2;
+const int HuffCdicCompression = 17480;
+
+// EXTH record types
+const quint32 ExthAuthor = 100;
+const quint32 ExthPublisher = 101;
+const quint32 ExthSubject = 105;
+const quint32 ExthCoverOffset = 201;
+const quint32 ExthUpdatedTitle = 503;
+const quint32 ExthLanguage = 524;
+
+quint32 readU32(const uchar* p) { return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | p[3]; }
+quint16 readU16(const uchar* p) { return quint16((p[0] << 8) | p[1]); }
+
+bool looksLikeImage(const QByteArray& data)
+{
+    return data.startsWith("\xFF\xD8") || data.startsWith("\x89PNG") || data.startsWith("GIF8") || data.startsWith("BM");
+}
+
+// Size of one trailing entry, whose length is a varint read backwards
+qint64 trailingEntrySize(const uchar* data, qint64 size)
+{
+    qint64 result = 0;
+    int shift = 0;
+    while (size > 0) {
+        const uchar byte = data[--size];
+        result |= qint64(byte & 0x7F) << shift;
+        shift += 7;
+        if ((byte & 0x80) || shift >= 28) break;
+    }
+    return result;
+}
+
+// PalmDOC's LZ77 variant; output never exceeds a record's 4096 bytes by much
+QByteArray palmDocDecompress(const uchar* in, qint64 size, int expected)
+{
+    QByteArray out;
+    out.reserve(expected);
+    qint64 i = 0;
+    while (i < size) {
+        const uchar c = in[i++];
+        if (c >= 0x01 && c <= 0x08) {
+            // The next c bytes are literal
+            for (int n = 0; n < c && i < size; ++n) out.append(char(in[i++]));
+        } else if (c < 0x80) {
+            out.append(char(c));
+        } else if (c >= 0xC0) {
+            out.append(' ');
+            out.append(char(c ^ 0x80));
+        } else {
+            if (i >= size) break;
+            const int pair = (c << 8) | in[i++];
+            const int distance = (pair >> 3) & 0x7FF;
+            const int length = (pair & 0x7) + 3;
+            if (distance == 0 || distance > out.size()) return QByteArray(); // Corrupt
+            // Byte by byte, since the copy may overlap its own output
+            for (int n = 0; n < length; ++n) out.append(out.at(out.size() - distance));
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+class MobiContainer::Private {
+public:
+    Private() : compression(NoCompression), textLengthVal(0), textRecordCount(0), recordSize(4096),
+                encrypted(false), fileVersionVal(0), extraFlags(0), firstImageRecord(-1), coverRecindexVal(0),
+                imageCountVal(0), useClock(0), memoryConsumerId(0) {}
+
+    struct CachedRecord {
+        QByteArray data;
+        quint64 lastUse = 0;
+    };
+
+    std::shared_ptr<MappedFile> mapping;
+    QVector<qint64> offsets; // Start of each record; the end is the next start
+    int compression;
+    qint64 textLengthVal;
+    int textRecordCount;
+    int recordSize;
+    bool encrypted;
+    int fileVersionVal;
+    quint16 extraFlags; // Trailing entries on each text record
+    int firstImageRecord;
+    int coverRecindexVal;
+    int imageCountVal;
+    QByteArray codecName;
+    QString title;
+    QString author;
+    QStringList subjects;
+    QString publisher;
+    QString language;
+
+    mutable QMutex cacheMutex; // Protects cache and useClock
+    mutable QHash<int, CachedRecord> cache;
+    mutable quint64 useClock;
+    int memoryConsumerId;
+
+    static qint64 cacheLimit() {
+        return qint64(qMax(1, Settings::instance().value<int>("Advanced/MobiRecordCacheMB", 16))) * 1024 * 1024;
+    }
+
+    qint64 recordLength(int index) const {
+        const qint64 end = index + 1 < offsets.size() ? offsets[index + 1] : mapping->size();
+        return qMax<qint64>(0, end - offsets[index]);
+    }
+
+    QByteArray rawRecord(int index) const {
+        if (!mapping || index < 0 || index >= offsets.size()) return QByteArray();
+        return mapping->bytes(offsets[index], recordLength(index));
+    }
+
+    QString decode(const QByteArray& bytes) const {
+        QTextCodec* codec = QTextCodec::codecForName(codecName);
+        return codec ? codec->toUnicode(bytes) : QString::fromLatin1(bytes);
+    }
+
+    qint64 cachedBytes() const {
+        QMutexLocker locker(&cacheMutex);
+        qint64 total = 0;
+        for (const CachedRecord& record : cache) total += record.data.size();
+        return total;
+    }
+
+    // Least recently used records go first, until the cache fits maxBytes
+    // and bytes have been freed. Caller holds cacheMutex.
+    qint64 trim(qint64 maxBytes, qint64 bytes) const {
+        qint64 total = 0;
+        for (const CachedRecord& record : cache) total += record.data.size();
+        qint64 freed = 0;
+        while (!cache.isEmpty() && (total > maxBytes || freed < bytes)) {
+            auto oldest = cache.begin();
+            for (auto it = cache.begin(); it != cache.end(); ++it) {
+                if (it->lastUse < oldest->lastUse) oldest = it;
+            }
+            total -= oldest->data.size();
+            freed += oldest->data.size();
+            cache.erase(oldest);
+        }
+        return freed;
+    }
+
+    QByteArray decompressRecord(int textRecord) const {
+        const QByteArray raw = rawRecord(textRecord + 1);
+        const uchar* data = reinterpret_cast<const uchar*>(raw.constData());
+        qint64 size = raw.size();
+
+        // Strip the trailing entries, multibyte overlap last
+        for (quint16 flags = extraFlags >> 1; flags; flags >>= 1) {
+            if (flags & 1) size -= trailingEntrySize(data, size);
+        }
+        if ((extraFlags & 1) && size > 0) size -= (data[size - 1] & 0x3) + 1;
+        if (size < 0) return QByteArray();
+
+        if (compression == PalmDocCompression) return palmDocDecompress(data, size, recordSize);
+        return QByteArray(raw.constData(), int(size));
+    }
+
+    // A text record decompressed, through the cache
+    QByteArray textRecord(int index) const {
+        {
+            QMutexLocker locker(&cacheMutex);
+            auto it = cache.find(index);
+            if (it != cache.end()) {
+                it->lastUse = ++useClock;
+                return it->data;
+            }
+        }
+        // Decompressed without the lock; two threads racing on one record
+        // both decompress it and the first result is kept
+        const QByteArray data = decompressRecord(index);
+        if (data.isEmpty()) {
+            LOG_WARN("MobiContainer: Failed to decompress text record " << index);
+            return data;
+        }
+        QMutexLocker locker(&cacheMutex);
+        auto it = cache.find(index);
+        if (it == cache.end()) it = cache.insert(index, CachedRecord{data, 0});
+        it->lastUse = ++useClock;
+        const QByteArray result = it->data;
+        trim(cacheLimit(), 0);
+        return result;
+    }
+
+    void parseExth(const uchar* exth, qint64 available) {
+        if (available < 12 || memcmp(exth, "EXTH", 4) != 0) return;
+        const quint32 count = readU32(exth + 8);
+        qint64 pos = 12;
+        for (quint32 i = 0; i < count && pos + 8 <= available; ++i) {
+            const quint32 type = readU32(exth + pos);
+            const quint32 length = readU32(exth + pos + 4);
+            if (length < 8 || pos + length > available) break;
+            const QByteArray value(reinterpret_cast<const char*>(exth + pos + 8), int(length - 8));
+            switch (type) {
+            case ExthAuthor: author = author.isEmpty() ? decode(value) : author + QStringLiteral(", ") + decode(value); break;
+            case ExthPublisher: publisher = decode(value); break;
+            case ExthSubject: subjects.append(decode(value)); break;
+            case ExthUpdatedTitle: title = decode(value); break;
+            case ExthLanguage: language = decode(value); break;
+            case ExthCoverOffset:
+                if (value.size() >= 4) coverRecindexVal = int(readU32(reinterpret_cast<const uchar*>(value.constData()))) + 1;
+                break;
+            default: break;
+            }
+            pos += length;
+        }
+    }
+};
+
+MobiContainer::MobiContainer()
+    : d(new Private())
+{
+    // Records are decompressed again from the mapping, so they go early
+    Private* priv = d.get();
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        "MOBI text records", MemoryBudget::Priority::Low,
+        [priv]() { return priv->cachedBytes(); },
+        [priv](qint64 bytes) {
+            QMutexLocker locker(&priv->cacheMutex);
+            return priv->trim(0, bytes);
+        });
+}
+
+MobiContainer::~MobiContainer()
+{
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+}
+
+bool MobiContainer::open(const QString& filePath, QString* error)
+{
+    close();
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    std::shared_ptr<MappedFile> mapping = MappedFile::open(filePath);
+    if (!mapping) return fail(QCoreApplication::translate("MobiContainer", "Failed to open MOBI file."));
+    const uchar* data = mapping->data();
+    const qint64 size = mapping->size();
+    if (size < PalmDbHeaderSize) return fail(QCoreApplication::translate("MobiContainer", "File is too short to be a MOBI book."));
+
+    const QByteArray typeCreator(reinterpret_cast<const char*>(data + 60), 8);
+    if (typeCreator != "BOOKMOBI" && typeCreator != "TEXtREAd") {
+        return fail(QCoreApplication::translate("MobiContainer", "Not a MOBI or PalmDOC book."));
+    }
+
+    // The record table
+    const int recordCount = readU16(data + 76);
+    if (recordCount < 1 || PalmDbHeaderSize + qint64(recordCount) * RecordEntrySize > size) {
+        return fail(QCoreApplication::translate("MobiContainer", "MOBI record table is damaged."));
+    }
+    d->offsets.reserve(recordCount);
+    for (int i = 0; i < recordCount; ++i) {
+        const qint64 offset = readU32(data + PalmDbHeaderSize + i * RecordEntrySize);
+        if (offset > size || (!d->offsets.isEmpty() && offset < d->offsets.last())) {
+            d->offsets.clear();
+            return fail(QCoreApplication::translate("MobiContainer", "MOBI record table is damaged."));
+        }
+        d->offsets.append(offset);
+    }
+    d->mapping = mapping;
+
+    // Record 0: the PalmDOC header, then the MOBI header and EXTH
+    const QByteArray header = d->rawRecord(0);
+    const uchar* record0 = reinterpret_cast<const uchar*>(header.constData());
+    if (header.size() < 16) {
+        close();
+        return fail(QCoreApplication::translate("MobiContainer", "MOBI header is damaged."));
+    }
+    d->compression = readU16(record0);
+    d->textLengthVal = readU32(record0 + 4);
+    d->textRecordCount = qMin<int>(readU16(record0 + 8), recordCount - 1);
+    d->recordSize = qMax<int>(1, readU16(record0 + 10));
+    d->encrypted = readU16(record0 + 12) != 0;
+    d->codecName = "windows-1252";
+    d->title = QString::fromLatin1(reinterpret_cast<const char*>(data), int(qstrnlen(reinterpret_cast<const char*>(data), 32)));
+
+    if (header.size() >= 24 && memcmp(record0 + 16, "MOBI", 4) == 0) {
+        const quint32 mobiLength = readU32(record0 + 20);
+        auto field = [&](int offset) -> quint32 {
+            return offset + 4 <= header.size() && quint32(offset) + 4 <= 16 + mobiLength ? readU32(record0 + offset) : 0xFFFFFFFF;
+        };
+        if (field(28) == 65001) d->codecName = "UTF-8";
+        d->fileVersionVal = int(field(36));
+        const quint32 nameOffset = field(84);
+        const quint32 nameLength = field(88);
+        if (nameOffset != 0xFFFFFFFF && nameLength != 0xFFFFFFFF && qint64(nameOffset) + nameLength <= header.size()) {
+            d->title = d->decode(header.mid(int(nameOffset), int(nameLength)));
+        }
+        const quint32 firstImage = field(108);
+        if (firstImage != 0xFFFFFFFF && int(firstImage) < recordCount) d->firstImageRecord = int(firstImage);
+        if (mobiLength >= 0xE4 && header.size() >= 0xF4) d->extraFlags = readU16(record0 + 0xF2);
+        if ((field(128) & 0x40) && 16 + qint64(mobiLength) < header.size()) {
+            d->parseExth(record0 + 16 + mobiLength, header.size() - 16 - mobiLength);
+        }
+    }
+
+    if (d->firstImageRecord > 0) {
+        for (int i = d->firstImageRecord; i < recordCount && looksLikeImage(d->rawRecord(i)); ++i) ++d->imageCountVal;
+    }
+
+    if (d->encrypted) {
+        return fail(QCoreApplication::translate("MobiContainer", "The book is protected by DRM."));
+    }
+    if (d->compression == HuffCdicCompression) {
+        return fail(QCoreApplication::translate("MobiContainer", "Huffman-compressed MOBI books are not supported."));
+    }
+    if (d->compression != NoCompression && d->compression != PalmDocCompression) {
+        return fail(QCoreApplication::translate("MobiContainer", "Unknown MOBI compression %1.").arg(d->compression));
+    }
+
+    LOG_DEBUG("MobiContainer: Indexed " << recordCount << " records, " << d->textRecordCount << " of text ("
+              << d->textLengthVal << " bytes), " << d->imageCountVal << " images in " << filePath);
+    return true;
+}
+
+void MobiContainer::close()
+{
+    QMutexLocker locker(&d->cacheMutex);
+    d->cache.clear();
+    d->mapping.reset();
+    d->offsets.clear();
+    d->textLengthVal = 0;
+    d->textRecordCount = 0;
+    d->encrypted = false;
+    d->extraFlags = 0;
+    d->firstImageRecord = -1;
+    d->coverRecindexVal = 0;
+    d->imageCountVal = 0;
+    d->title.clear();
+    d->author.clear();
+    d->subjects.clear();
+    d->publisher.clear();
+    d->language.clear();
+}
+
+QString MobiContainer::title() const
+{
+    return d->title;
+}
+
+QString MobiContainer::author() const
+{
+    return d->author;
+}
+
+QStringList MobiContainer::subjects() const
+{
+    return d->subjects;
+}
+
+QString MobiContainer::publisher() const
+{
+    return d->publisher;
+}
+
+QString MobiContainer::language() const
+{
+    return d->language;
+}
+
+bool MobiContainer::isEncrypted() const
+{
+    return d->encrypted;
+}
+
+int MobiContainer::fileVersion() const
+{
+    return d->fileVersionVal;
+}
+
+qint64 MobiContainer::textLength() const
+{
+    return d->textLengthVal;
+}
+
+int MobiContainer::textRecordSize() const
+{
+    return d->recordSize;
+}
+
+QByteArray MobiContainer::textCodecName() const
+{
+    return d->codecName;
+}
+
+QByteArray MobiContainer::text(qint64 offset, qint64 length) const
+{
+    if (!d->mapping || offset < 0 || length <= 0 || offset >= d->textLengthVal) return QByteArray();
+    const qint64 end = qMin(d->textLengthVal, offset + length);
+    QByteArray result;
+    result.reserve(int(end - offset));
+    for (int record = int(offset / d->recordSize); record < d->textRecordCount; ++record) {
+        const qint64 recordStart = qint64(record) * d->recordSize;
+        if (recordStart >= end) break;
+        const QByteArray data = d->textRecord(record);
+        if (data.isEmpty()) return QByteArray();
+        const qint64 from = qMax<qint64>(0, offset - recordStart);
+        const qint64 to = qMin<qint64>(data.size(), end - recordStart);
+        if (to > from) result.append(data.constData() + from, int(to - from));
+    }
+    return result;
+}
+
+QByteArray MobiContainer::image(int recindex) const
+{
+    if (d->firstImageRecord < 0 || recindex < 1 || recindex > d->imageCountVal) return QByteArray();
+    return d->rawRecord(d->firstImageRecord + recindex - 1);
+}
+
+int MobiContainer::coverRecindex() const
+{
+    return d->coverRecindexVal <= d->imageCountVal ? d->coverRecindexVal : 0;
+}
+
+int MobiContainer::imageCount() const
+{
+    return d->imageCountVal;
+}
+
+} // namespace QuantilyxDoc
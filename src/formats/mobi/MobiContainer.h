@@ -0,0 +1,127 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MOBICONTAINER_H
+#define QUANTILYX_MOBICONTAINER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Indexed access to a MOBI (PalmDB) book.
+ *
+ * The file is mapped, and open() reads only the record table and the
+ * headers of record 0: record offsets, text length and compression, and
+ * the EXTH metadata. Text records are decompressed when read, one
+ * 4096-byte record at a time, into an LRU bounded by
+ * Advanced/MobiRecordCacheMB that MemoryBudget can also trim. Images are
+ * returned as views of the mapping. Nothing is unpacked to disk.
+ *
+ * PalmDOC and uncompressed books are read; Huffman (HUFF/CDIC) compressed
+ * and DRM-encrypted books are detected and refused.
+ */
+class MobiContainer
+{
+public:
+    MobiContainer();
+    ~MobiContainer();
+
+    /**
+     * @brief Map a book and index its records.
+     * @param filePath MOBI, AZW or PalmDOC file.
+     * @param error Receives a description on failure; may be null.
+     * @return True if the text can be read.
+     */
+    bool open(const QString& filePath, QString* error = nullptr);
+
+    /**
+     * @brief Unmap the book and drop the cache.
+     */
+    void close();
+
+    // --- Metadata, from the headers ---
+    QString title() const;
+    QString author() const;
+    QStringList subjects() const;
+    QString publisher() const;
+    QString language() const;
+
+    /**
+     * @brief Check whether the book is DRM-encrypted.
+     * Set even when open() refuses the book for it.
+     * @return True if encrypted.
+     */
+    bool isEncrypted() const;
+
+    /**
+     * @brief Get the MOBI file version.
+     * @return Version, or 0 for a plain PalmDOC book.
+     */
+    int fileVersion() const;
+
+    // --- Text ---
+    /**
+     * @brief Get the length of the decompressed text.
+     * @return Bytes, in textCodecName() encoding.
+     */
+    qint64 textLength() const;
+
+    /**
+     * @brief Get the uncompressed size of each text record.
+     * @return Bytes; every record but the last has this size.
+     */
+    int textRecordSize() const;
+
+    /**
+     * @brief Get the text encoding.
+     * @return "UTF-8" or "windows-1252".
+     */
+    QByteArray textCodecName() const;
+
+    /**
+     * @brief Read a range of the decompressed text, safe from any thread.
+     * Only the records the range covers are decompressed.
+     * @param offset First byte.
+     * @param length Number of bytes; clipped to the text.
+     * @return The bytes, or empty on a decompression fault.
+     */
+    QByteArray text(qint64 offset, qint64 length) const;
+
+    // --- Images ---
+    /**
+     * @brief Get an image by the 1-based recindex the markup uses.
+     * @param recindex Index relative to the first image record.
+     * @return Encoded image viewing the mapping, or empty.
+     */
+    QByteArray image(int recindex) const;
+
+    /**
+     * @brief Get the cover image's recindex.
+     * @return recindex, or 0 if the book names no cover.
+     */
+    int coverRecindex() const;
+
+    /**
+     * @brief Get the number of image records.
+     * @return Count.
+     */
+    int imageCount() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MOBICONTAINER_H
@@ -1,28 +1,41 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
  */
 #include "MobiDocument.h"
+#include "MobiContainer.h"
 #include "MobiPage.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
-#include <QFile>
-#include <QFileInfo>
-#include <QDir>
+#include "../../core/MemoryBudget.h"
+#include "../../core/ReflowablePage.h"
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegularExpression>
-#include <QTextStream>
-#include <QDebug>
-// #include "mobi/mobiparser.h" // Hypothetical MOBI parser library
+#include <QSet>
+#include <QTextCodec>
+#include <QVector>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Text records per page: 32 KB of markup, a chapter's worth or so
+const int RecordsPerPage = 8;
+
+// Tags a page may start at without cutting through a paragraph
+const char* const BlockTags[] = { "<mbp:pagebreak", "<p", "<h", "<div", "<blockquote", "<table", "<ul", "<ol" };
+
+} // namespace
+
 class MobiDocument::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(0), hasDrmVal(false) {}
+    Private() : isLoaded(false), pageCountVal(0), hasDrmVal(false), hasCover(false), memoryConsumerId(0) {}
     ~Private() = default;
 
     bool isLoaded;
@@ -32,23 +45,26 @@ public:
     QList<QString> subjects;
     bool hasDrmVal;
     QStringList fontList;
+    MobiContainer container;
+    bool hasCover; // Page 0 shows the cover image
     QList<std::unique_ptr<MobiPage>> pages;
+    mutable QMutex pagesMutex; // Guards pages against the memory consumer
+    int memoryConsumerId;
 
-    // Helper to load and parse the MOBI file
-    bool loadAndParseMobi(const QString& filePath) {
-        // This is complex, often involving conversion tools like KindleUnpack or libraries like libmobi.
-        // MOBI files (especially with DRM) are hard to parse directly.
-        // LOG_ERROR("MobiDocument::loadAndParseMobi: Requires MOBI parsing library, not implemented.");
-        // return false;
-        // For demonstration, assume a successful parse with dummy data.
-        title = "Sample MOBI Book";
-        author = "Unknown Author";
-        subjects = QStringList() << "Fiction" << "E-book";
-        pageCountVal = 10;
-        hasDrmVal = false; // Or true if DRM detected
-        fontList = QStringList() << "KindleFont";
-        LOG_WARN("MobiDocument::loadAndParseMobi: Placeholder implementation. Requires libmobi or similar.");
-        return true; // Placeholder success
+    // Where the text page starts: the first block tag at or after its
+    // records, so a page and the next agree on where they meet
+    qint64 textPageStart(int textPage) const {
+        const qint64 nominal = qint64(textPage) * RecordsPerPage * container.textRecordSize();
+        if (textPage <= 0) return 0;
+        if (nominal >= container.textLength()) return container.textLength();
+        const QByteArray window = container.text(nominal, container.textRecordSize());
+        int best = -1;
+        for (const char* tag : BlockTags) {
+            const int found = window.indexOf(tag);
+            if (found >= 0 && (best < 0 || found < best)) best = found;
+        }
+        if (best < 0) best = window.indexOf('<');
+        return nominal + qMax(0, best);
     }
 };
 
@@ -56,11 +72,13 @@ MobiDocument::MobiDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
-    LOG_INFO("MobiDocument created. Note: MOBI support requires a parser like libmobi.");
+    d->memoryConsumerId = ReflowablePage::registerLayoutConsumer("MOBI page layouts", this, &d->pagesMutex, &d->pages);
+    LOG_INFO("MobiDocument created.");
 }
 
 MobiDocument::~MobiDocument()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     LOG_INFO("MobiDocument destroyed.");
 }
 
@@ -68,22 +86,38 @@ bool MobiDocument::load(const QString& filePath, const QString& password)
 {
     Q_UNUSED(password);
     d->isLoaded = false;
-    d->pages.clear();
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+    }
+    d->pageCountVal = 0;
+
+    LoadTrace trace(filePath, QStringLiteral("MOBI"));
 
-    // Load and parse using MOBI library
-    if (!d->loadAndParseMobi(filePath)) {
-        setLastError("MOBI loading requires a MOBI parser, which is not available.");
-        LOG_ERROR(lastError());
+    // Only the record table and headers are read here
+    trace.phase(LoadTrace::Parse);
+    QString error;
+    const bool opened = d->container.open(filePath, &error);
+    d->hasDrmVal = d->container.isEncrypted();
+    d->title = d->container.title();
+    d->author = d->container.author();
+    d->subjects = d->container.subjects();
+    if (!opened) {
+        setLastError(error);
+        LOG_ERROR("MobiDocument: " << error << " " << filePath);
         return false;
     }
 
     setFilePath(filePath);
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
     emit mobiLoaded();
-    LOG_INFO("Successfully loaded MOBI document: " << filePath << " (DRM: " << d->hasDrmVal << ")");
+    LOG_INFO("Successfully loaded MOBI document: " << filePath << " (" << d->pageCountVal << " pages, "
+             << d->container.textLength() << " bytes of text left compressed)");
     return true;
 }
 
@@ -95,17 +129,116 @@ bool MobiDocument::save(const QString& filePath)
     return false;
 }
 
-// ... (Rest of MobiDocument methods similar to others) ...
+Document::DocumentType MobiDocument::type() const
+{
+    return DocumentType::Mobi;
+}
+
+int MobiDocument::pageCount() const
+{
+    return d->pageCountVal;
+}
+
+Page* MobiDocument::page(int index) const
+{
+    if (index >= 0 && index < d->pages.size()) {
+        return d->pages.at(index).get();
+    }
+    return nullptr;
+}
+
+bool MobiDocument::isLocked() const
+{
+    return d->hasDrmVal;
+}
+
+bool MobiDocument::isEncrypted() const
+{
+    return d->hasDrmVal;
+}
+
+QString MobiDocument::formatVersion() const
+{
+    const int version = d->container.fileVersion();
+    return version > 0 ? QStringLiteral("MOBI %1").arg(version) : QStringLiteral("PalmDOC");
+}
+
+bool MobiDocument::supportsFeature(const QString& feature) const
+{
+    static const QSet<QString> supportedFeatures = {
+        "Text", "Images", "Reflowable"
+    };
+    return supportedFeatures.contains(feature);
+}
+
+QString MobiDocument::mobiTitle() const
+{
+    return d->title;
+}
+
+QString MobiDocument::mobiAuthor() const
+{
+    return d->author;
+}
+
+QList<QString> MobiDocument::mobiSubjects() const
+{
+    return d->subjects;
+}
+
+bool MobiDocument::hasDrm() const
+{
+    return d->hasDrmVal;
+}
+
+QStringList MobiDocument::embeddedFonts() const
+{
+    return d->fontList;
+}
+
+QString MobiDocument::pageHtml(int index) const
+{
+    if (d->hasCover && index == 0) {
+        return QStringLiteral("<p align=\"center\"><img src=\"mobi:%1\"/></p>").arg(d->container.coverRecindex());
+    }
+    const int textPage = index - (d->hasCover ? 1 : 0);
+    if (textPage < 0 || index >= d->pageCountVal) return QString();
+
+    const qint64 start = d->textPageStart(textPage);
+    const qint64 end = d->textPageStart(textPage + 1);
+    const QByteArray bytes = d->container.text(start, end - start);
+    QTextCodec* codec = QTextCodec::codecForName(d->container.textCodecName());
+    QString html = codec ? codec->toUnicode(bytes) : QString::fromLatin1(bytes);
+
+    // Kindle markup numbers its images instead of linking them
+    static const QRegularExpression recindex(QStringLiteral("\\brecindex\\s*=\\s*[\"']?0*(\\d+)[\"']?"),
+                                             QRegularExpression::CaseInsensitiveOption);
+    html.replace(recindex, QStringLiteral("src=\"mobi:\\1\""));
+    return html;
+}
+
+QByteArray MobiDocument::embeddedImage(int recindex) const
+{
+    return d->container.image(recindex);
+}
 
 void MobiDocument::createPages()
 {
-    d->pages.clear();
-    d->pages.reserve(d->pageCountVal);
-    for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<MobiPage>(this, i)); // Placeholder
-        LOG_DEBUG("MobiDocument: Planned page " << i);
+    d->hasCover = d->container.coverRecindex() > 0;
+    const qint64 pageBytes = qint64(RecordsPerPage) * d->container.textRecordSize();
+    const int textPages = int(qMax<qint64>(1, (d->container.textLength() + pageBytes - 1) / pageBytes));
+
+    {
+        QMutexLocker locker(&d->pagesMutex);
+        d->pages.clear();
+        d->pages.reserve(textPages + (d->hasCover ? 1 : 0));
+        if (d->hasCover) d->pages.append(std::make_unique<MobiPage>(this, 0, tr("Cover")));
+        for (int i = 0; i < textPages; ++i) {
+            d->pages.append(std::make_unique<MobiPage>(this, d->pages.size(), QString()));
+        }
     }
+    d->pageCountVal = d->pages.size();
     LOG_INFO("MobiDocument: Created " << d->pages.size() << " page objects.");
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
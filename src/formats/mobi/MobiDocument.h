@@ -23,7 +23,9 @@ class MobiPage; // Forward declaration
  * @brief MOBI document implementation.
  * 
  * Handles loading and parsing of MOBI files (Amazon Kindle format).
- * Often requires conversion to HTML for display.
+ * The book is read through a MobiContainer, which indexes the records at
+ * load and decompresses text only when a page is laid out. Each page
+ * covers a fixed run of text records, cut at the nearest block tag.
  */
 class MobiDocument : public Document
 {
@@ -51,6 +53,20 @@ public:
     bool hasDrm() const;
     QStringList embeddedFonts() const;
 
+    /**
+     * @brief Get a page's HTML, decompressing its records. Safe from any thread.
+     * @param index Page index.
+     * @return HTML; images use mobi:<recindex> URLs.
+     */
+    QString pageHtml(int index) const;
+
+    /**
+     * @brief Get an embedded image. Safe from any thread.
+     * @param recindex 1-based image index, as the markup numbers them.
+     * @return Encoded image, or empty.
+     */
+    QByteArray embeddedImage(int recindex) const;
+
 signals:
     void mobiLoaded();
 
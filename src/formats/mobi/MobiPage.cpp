@@ -0,0 +1,87 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "MobiPage.h"
+#include "MobiDocument.h"
+#include "../../core/Logger.h"
+#include <QUrl>
+#include <QVariantMap>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Kindle books have no page size; an A5-like sheet reads like one
+const qreal PageWidth = 420.0;
+const qreal PageHeight = 595.0;
+const qreal Margin = 36.0;
+const qreal TextWidth = PageWidth - 2 * Margin;
+
+// Resolves mobi:<recindex> images from the book's records as the layout
+// needs them, decoded no larger than the text column
+class MobiTextDocument : public LayoutDocument
+{
+public:
+    explicit MobiTextDocument(const MobiDocument* document) : LayoutDocument(TextWidth), book(document) {}
+
+protected:
+    QVariant loadResource(int type, const QUrl& name) override {
+        if (type != QTextDocument::ImageResource || name.scheme() != QLatin1String("mobi") || !book) {
+            return QTextDocument::loadResource(type, name);
+        }
+        return decodeImage(book->embeddedImage(name.path().toInt()), name.path());
+    }
+
+private:
+    const MobiDocument* book;
+};
+
+} // namespace
+
+class MobiPage::Private {
+public:
+    Private(MobiDocument* doc, int pIndex, const QString& pageTitle)
+        : document(doc), pageIndexVal(pIndex), title(pageTitle) {}
+
+    MobiDocument* document;
+    int pageIndexVal;
+    QString title;
+};
+
+MobiPage::MobiPage(MobiDocument* document, int pageIndex, const QString& title, QObject* parent)
+    : ReflowablePage(document, QSizeF(PageWidth, PageHeight), Margin, parent)
+    , d(new Private(document, pageIndex, title))
+{
+    if (!title.isEmpty()) setTitle(title);
+    LOG_DEBUG("MobiPage created for index " << pageIndex);
+}
+
+MobiPage::~MobiPage()
+{
+    LOG_DEBUG("MobiPage for index " << d->pageIndexVal << " destroyed.");
+}
+
+QVariantMap MobiPage::metadata() const
+{
+    QVariantMap map;
+    map["PageIndex"] = d->pageIndexVal;
+    map["Title"] = d->title;
+    return map;
+}
+
+std::unique_ptr<LayoutDocument> MobiPage::createLayout() const
+{
+    if (!d->document) return nullptr;
+    std::unique_ptr<LayoutDocument> layout(new MobiTextDocument(d->document));
+    layout->setDocumentMargin(0);
+    layout->setHtml(d->document->pageHtml(d->pageIndexVal)); // Decompresses the page's records
+    return layout;
+}
+
+} // namespace QuantilyxDoc
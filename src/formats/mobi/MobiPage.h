@@ -0,0 +1,59 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_MOBIPAGE_H
+#define QUANTILYX_MOBIPAGE_H
+
+#include "../../core/ReflowablePage.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class MobiDocument;
+
+/**
+ * @brief A stretch of a MOBI book's text, as a continuous page.
+ *
+ * The page covers a fixed range of text records. Nothing is decompressed
+ * until the page is first rendered; its HTML is then read from the
+ * document's container and laid out, decoding the images it shows.
+ */
+class MobiPage : public ReflowablePage
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent MobiDocument.
+     * @param pageIndex The 0-based index of this page.
+     * @param title The page's title, if any.
+     * @param parent Parent object.
+     */
+    MobiPage(MobiDocument* document, int pageIndex, const QString& title, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~MobiPage() override;
+
+    // --- Page Interface Implementation ---
+    QVariantMap metadata() const override;
+
+protected:
+    std::unique_ptr<LayoutDocument> createLayout() const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_MOBIPAGE_H
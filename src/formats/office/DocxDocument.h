@@ -17,13 +17,18 @@
 
 namespace QuantilyxDoc {
 
-class DocxPage; // Forward declaration
+class FlowPage; // Forward declaration
 
 /**
  * @brief DOCX (Office Open XML) document implementation.
  * 
  * Handles loading and parsing of DOCX files (Microsoft Word documents).
  * DOCX is a ZIP archive containing XML files.
+ *
+ * The body is parsed with a streaming reader straight from the archive on
+ * a background thread, and paginated as it is parsed: load() returns at
+ * once, pages appear as they are laid out, and pageCountChanged() is
+ * emitted as their number grows. loaded() follows the last page.
  */
 class DocxDocument : public Document
 {
@@ -37,7 +42,7 @@ public:
     bool load(const QString& filePath, const QString& password = QString()) override;
     bool save(const QString& filePath = QString()) override;
     DocumentType type() const override;
-    int pageCount() const override; // Page count might be estimated from content
+    int pageCount() const override; // Pages laid out so far
     Page* page(int index) const override;
     bool isLocked() const override;
     bool isEncrypted() const override;
@@ -52,14 +57,25 @@ public:
     QList<QString> embeddedObjectNames() const;
     bool hasTrackChanges() const;
 
+    /**
+     * @brief Check whether the whole body has been paginated.
+     * @return True once the page count is final.
+     */
+    bool isPaginated() const;
+
 signals:
     void docxLoaded();
 
+    /**
+     * @brief Emitted when the last page has been laid out.
+     */
+    void paginationFinished();
+
 private:
     class Private;
     std::unique_ptr<Private> d;
 
-    void createPages();
+    void publishPages(quint64 generation, int count, bool finished, const QString& error);
 };
 
 } // namespace QuantilyxDoc
@@ -0,0 +1,66 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "FlowPage.h"
+#include "FlowPaginator.h"
+#include "../../core/Logger.h"
+#include <QVariantMap>
+
+namespace QuantilyxDoc {
+
+class FlowPage::Private {
+public:
+    Private(std::shared_ptr<FlowPaginator> p, int pIndex) : paginator(std::move(p)), pageIndexVal(pIndex) {}
+
+    std::shared_ptr<FlowPaginator> paginator;
+    int pageIndexVal;
+};
+
+FlowPage::FlowPage(Document* document, std::shared_ptr<FlowPaginator> paginator, int pageIndex, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(std::move(paginator), pageIndex))
+{
+    setSize(d->paginator->format().pageSize);
+}
+
+FlowPage::~FlowPage() = default;
+
+QImage FlowPage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage FlowPage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    QImage image = d->paginator->renderPage(d->pageIndexVal, rect, width, height);
+    if (image.isNull()) {
+        LOG_ERROR("Failed to render rectangle " << rect << " of page " << d->pageIndexVal);
+    }
+    return image;
+}
+
+bool FlowPage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QString FlowPage::text() const
+{
+    return d->paginator->pageText(d->pageIndexVal);
+}
+
+QVariantMap FlowPage::metadata() const
+{
+    QVariantMap map;
+    map["PageIndex"] = d->pageIndexVal;
+    return map;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,58 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FLOWPAGE_H
+#define QUANTILYX_FLOWPAGE_H
+
+#include "../../core/Page.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class FlowPaginator;
+
+/**
+ * @brief One page of a word-processing document, cut by a FlowPaginator.
+ *
+ * Used by DOCX and ODT, whose body is flowed text rather than fixed pages.
+ */
+class FlowPage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent document.
+     * @param paginator The document's paginator; shared so renders outlive a reload.
+     * @param pageIndex The 0-based index of this page; must be complete.
+     * @param parent Parent object.
+     */
+    FlowPage(Document* document, std::shared_ptr<FlowPaginator> paginator, int pageIndex, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~FlowPage() override;
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QString text() const override;
+    QVariantMap metadata() const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FLOWPAGE_H
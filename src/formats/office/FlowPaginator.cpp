@@ -0,0 +1,374 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "FlowPaginator.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/LayoutDocument.h"
+#include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include <QAbstractTextDocumentLayout>
+#include <QBuffer>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QUrl>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Blocks laid out together; enough for a page or two of ordinary text
+const int BlocksPerChunk = 48;
+const int CharsPerChunk = 32 * 1024;
+
+// Resolves images through the format's loader as the layout needs them
+class FlowTextDocument : public LayoutDocument
+{
+public:
+    explicit FlowTextDocument(const FlowPaginator::ImageLoader& imageLoader) : loader(imageLoader) {}
+
+protected:
+    QVariant loadResource(int type, const QUrl& name) override {
+        if (type != QTextDocument::ImageResource || !loader) return QTextDocument::loadResource(type, name);
+        return keepImage(loader(name.toString()));
+    }
+
+private:
+    FlowPaginator::ImageLoader loader;
+};
+
+} // namespace
+
+class FlowPaginator::Private {
+public:
+    Private() : used(0), pendingChars(0), clock(0), canceled(false), finished(false), memoryConsumerId(0) {}
+
+    // One chunk laid out. Shared with renders in flight, so a release by
+    // MemoryBudget never deletes a document that is being painted.
+    struct Layout {
+        std::unique_ptr<FlowTextDocument> document;
+        qint64 bytes = 0;
+        QMutex paintMutex; // QTextDocument is not reentrant
+    };
+
+    struct Chunk {
+        QString html;
+        std::shared_ptr<Layout> layout;
+        quint64 lastUse = 0;
+    };
+
+    // The part of a chunk, in its own coordinates, that a page shows
+    struct Slice {
+        int chunk;
+        qreal top;
+        qreal bottom;
+    };
+
+    PageFormat format;
+    ImageLoader loader;
+    mutable QMutex mutex; // Protects chunks, pages and clock
+    mutable QVector<Chunk> chunks; // Layouts come and go on const renders
+    QVector<QVector<Slice>> pages; // Completed pages
+    QVector<Slice> openPage;       // Producer only
+    qreal used;                    // Producer only: height taken on openPage
+    QStringList pending;           // Producer only: blocks of the next chunk
+    int pendingChars;
+    mutable quint64 clock;
+    std::atomic<bool> canceled;
+    std::atomic<bool> finished;
+    int memoryConsumerId;
+
+    qreal textWidth() const {
+        return qMax<qreal>(36, format.pageSize.width() - format.margins.left() - format.margins.right());
+    }
+
+    qreal textHeight() const {
+        return qMax<qreal>(36, format.pageSize.height() - format.margins.top() - format.margins.bottom());
+    }
+
+    std::shared_ptr<Layout> layOut(const QString& html) const {
+        std::shared_ptr<Layout> layout = std::make_shared<Layout>();
+        layout->document.reset(new FlowTextDocument(loader));
+        layout->document->setDocumentMargin(0);
+        layout->document->setDefaultFont(format.font);
+        layout->document->setHtml(html);
+        layout->document->setTextWidth(textWidth());
+        layout->document->size(); // Lays the chunk out
+        layout->bytes = sizeof(Layout) + layout->document->estimatedBytes();
+        return layout;
+    }
+
+    // Line bottoms, where a page may end without cutting through text
+    static QVector<qreal> lineBreaks(QTextDocument* document) {
+        QVector<qreal> breaks;
+        QAbstractTextDocumentLayout* documentLayout = document->documentLayout();
+        for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+            const QTextLayout* layout = block.layout();
+            if (!layout) continue;
+            const qreal top = documentLayout->blockBoundingRect(block).top();
+            for (int i = 0; i < layout->lineCount(); ++i) {
+                const QTextLine line = layout->lineAt(i);
+                breaks.append(top + line.y() + line.height());
+            }
+        }
+        std::sort(breaks.begin(), breaks.end());
+        return breaks;
+    }
+
+    void closePage() {
+        QMutexLocker locker(&mutex);
+        pages.append(openPage);
+        openPage.clear();
+        used = 0;
+    }
+
+    // Fill pages with a laid-out chunk, leaving the last page open
+    void paginate(int chunk, qreal height, const QVector<qreal>& breaks) {
+        const qreal pageHeight = textHeight();
+        qreal y = 0;
+        while (height - y > 0.5) {
+            const qreal available = pageHeight - used;
+            if (height - y <= available) {
+                openPage.append(Slice{chunk, y, height});
+                used += height - y;
+                return;
+            }
+            auto fits = std::upper_bound(breaks.cbegin(), breaks.cend(), y + available);
+            qreal cut = fits != breaks.cbegin() ? *(fits - 1) : -1;
+            if (cut <= y + 0.5) {
+                if (used > 0) {
+                    closePage(); // The next line starts a page
+                    continue;
+                }
+                cut = y + available; // A line taller than a page is cut
+            }
+            openPage.append(Slice{chunk, y, cut});
+            closePage();
+            y = cut;
+        }
+    }
+
+    void flushChunk() {
+        if (pending.isEmpty()) return;
+        const QString html = pending.join(QLatin1Char('\n'));
+        pending.clear();
+        pendingChars = 0;
+
+        const std::shared_ptr<Layout> layout = layOut(html);
+        const qreal height = layout->document->size().height();
+        const QVector<qreal> breaks = lineBreaks(layout->document.get());
+        int index;
+        {
+            QMutexLocker locker(&mutex);
+            index = chunks.size();
+            chunks.append(Chunk{html, layout, ++clock});
+        }
+        paginate(index, height, breaks);
+    }
+
+    // The chunk's layout, built again if it was released
+    std::shared_ptr<Layout> chunkLayout(int chunk) const {
+        QString html;
+        {
+            QMutexLocker locker(&mutex);
+            if (chunk < 0 || chunk >= chunks.size()) return nullptr;
+            if (chunks[chunk].layout) {
+                chunks[chunk].lastUse = ++clock;
+                return chunks[chunk].layout;
+            }
+            html = chunks[chunk].html;
+        }
+        const std::shared_ptr<Layout> built = layOut(html);
+        QMutexLocker locker(&mutex);
+        Chunk& entry = chunks[chunk];
+        if (!entry.layout) entry.layout = built; // Unless another render got there first
+        entry.lastUse = ++clock;
+        return entry.layout;
+    }
+
+    QVector<Slice> pageSlices(int page) const {
+        QMutexLocker locker(&mutex);
+        return page >= 0 && page < pages.size() ? pages[page] : QVector<Slice>();
+    }
+
+    qint64 layoutBytes() const {
+        QMutexLocker locker(&mutex);
+        qint64 total = 0;
+        for (const Chunk& chunk : chunks) {
+            if (chunk.layout) total += chunk.layout->bytes;
+        }
+        return total;
+    }
+
+    // Least recently painted chunks go first
+    qint64 releaseLayouts(qint64 bytes) {
+        QMutexLocker locker(&mutex);
+        QVector<int> order;
+        for (int i = 0; i < chunks.size(); ++i) {
+            if (chunks[i].layout) order.append(i);
+        }
+        std::sort(order.begin(), order.end(), [this](int a, int b) { return chunks[a].lastUse < chunks[b].lastUse; });
+        qint64 freed = 0;
+        for (int index : order) {
+            if (freed >= bytes) break;
+            freed += chunks[index].layout->bytes;
+            chunks[index].layout.reset();
+        }
+        return freed;
+    }
+};
+
+FlowPaginator::FlowPaginator(const PageFormat& format, ImageLoader loader, const char* consumerName)
+    : d(new Private())
+{
+    d->format = format;
+    d->loader = std::move(loader);
+    Private* priv = d.get();
+    d->memoryConsumerId = MemoryBudget::instance().registerConsumer(
+        consumerName, MemoryBudget::Priority::Normal,
+        [priv]() { return priv->layoutBytes(); },
+        [priv](qint64 bytes) { return priv->releaseLayouts(bytes); });
+}
+
+FlowPaginator::~FlowPaginator()
+{
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
+}
+
+void FlowPaginator::appendBlock(const QString& html)
+{
+    d->pending.append(html);
+    d->pendingChars += html.size();
+    if (d->pending.size() >= BlocksPerChunk || d->pendingChars >= CharsPerChunk) d->flushChunk();
+}
+
+void FlowPaginator::appendPageBreak()
+{
+    d->flushChunk();
+    if (!d->openPage.isEmpty()) d->closePage();
+}
+
+void FlowPaginator::finish()
+{
+    d->flushChunk();
+    bool empty;
+    {
+        QMutexLocker locker(&d->mutex);
+        empty = d->pages.isEmpty();
+    }
+    // An empty body still shows one blank page
+    if (!d->openPage.isEmpty() || empty) d->closePage();
+    d->finished = true;
+}
+
+void FlowPaginator::cancel()
+{
+    d->canceled = true;
+}
+
+bool FlowPaginator::isCanceled() const
+{
+    return d->canceled;
+}
+
+FlowPaginator::PageFormat FlowPaginator::format() const
+{
+    return d->format;
+}
+
+int FlowPaginator::pageCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->pages.size();
+}
+
+bool FlowPaginator::isFinished() const
+{
+    return d->finished;
+}
+
+QImage FlowPaginator::renderPage(int page, const QRectF& rect, int width, int height) const
+{
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+    const QVector<Private::Slice> slices = d->pageSlices(page);
+    if (slices.isEmpty() && page >= pageCount()) return QImage();
+
+    QImage image = ImageBufferPool::instance().acquire(QSize(width, height));
+    if (image.isNull()) return QImage();
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    const qreal scale = qMin(width / rect.width(), height / rect.height());
+    painter.scale(scale, scale);
+    painter.translate(-rect.topLeft());
+
+    // Slices stack from the top margin down
+    qreal y = d->format.margins.top();
+    for (const Private::Slice& slice : slices) {
+        const qreal sliceHeight = slice.bottom - slice.top;
+        const QPointF offset(d->format.margins.left(), y - slice.top);
+        const QRectF clip = QRectF(0, slice.top, d->textWidth(), sliceHeight) & rect.translated(-offset);
+        y += sliceHeight;
+        if (clip.isEmpty()) continue;
+        const std::shared_ptr<Private::Layout> layout = d->chunkLayout(slice.chunk);
+        if (!layout) continue;
+        painter.save();
+        painter.translate(offset);
+        {
+            QMutexLocker locker(&layout->paintMutex);
+            layout->document->drawContents(&painter, clip);
+        }
+        painter.restore();
+    }
+    painter.end();
+    return image;
+}
+
+QString FlowPaginator::pageText(int page) const
+{
+    QStringList lines;
+    for (const Private::Slice& slice : d->pageSlices(page)) {
+        const std::shared_ptr<Private::Layout> layout = d->chunkLayout(slice.chunk);
+        if (!layout) continue;
+        QMutexLocker locker(&layout->paintMutex);
+        QTextDocument* document = layout->document.get();
+        for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+            // A block belongs to the page its middle falls on
+            const qreal middle = document->documentLayout()->blockBoundingRect(block).center().y();
+            if (middle >= slice.top && middle < slice.bottom) lines.append(block.text());
+        }
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+QImage FlowPaginator::decodeImage(const QByteArray& data, int maxWidth)
+{
+    QByteArray bytes = data;
+    QBuffer buffer(&bytes);
+    if (bytes.isEmpty() || !buffer.open(QIODevice::ReadOnly)) return QImage();
+    QImageReader reader(&buffer);
+    const QSize size = reader.size();
+    if (size.width() > maxWidth) reader.setScaledSize(size.scaled(QSize(maxWidth, size.height()), Qt::KeepAspectRatio));
+    const QImage image = reader.read();
+    if (image.isNull()) LOG_WARN("FlowPaginator: Failed to decode image: " << reader.errorString());
+    return image;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,150 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FLOWPAGINATOR_H
+#define QUANTILYX_FLOWPAGINATOR_H
+
+#include <QFont>
+#include <QImage>
+#include <QMarginsF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Breaks a stream of HTML blocks into fixed-size pages as it arrives.
+ *
+ * A format's parser appends the body block by block from a background
+ * thread; consecutive blocks are laid out together in chunks, and each
+ * chunk is cut into pages at line boundaries as soon as it is laid out.
+ * Completed pages can be rendered from any thread while the rest of the
+ * body is still being parsed.
+ *
+ * Chunk layouts are released least recently used first when MemoryBudget
+ * asks and laid out again from their HTML when a page needs them; the
+ * page breaks do not move.
+ */
+class FlowPaginator
+{
+public:
+    /**
+     * @brief Size and margins of every page, in points.
+     */
+    struct PageFormat {
+        QSizeF pageSize = QSizeF(612, 792); ///< US Letter
+        QMarginsF margins = QMarginsF(72, 72, 72, 72);
+        QFont font;                         ///< Default font of the text
+    };
+
+    /**
+     * @brief Resolves an image referenced by the HTML, from any thread.
+     */
+    using ImageLoader = std::function<QImage(const QString& name)>;
+
+    /**
+     * @brief Constructor.
+     * @param format Page format.
+     * @param loader Resolves <img src> names; may be empty.
+     * @param consumerName Name of the MemoryBudget consumer.
+     */
+    FlowPaginator(const PageFormat& format, ImageLoader loader, const char* consumerName);
+
+    /**
+     * @brief Destructor.
+     */
+    ~FlowPaginator();
+
+    // --- Producer side: one thread ---
+
+    /**
+     * @brief Append one block-level HTML fragment, such as a paragraph.
+     * @param html Fragment.
+     */
+    void appendBlock(const QString& html);
+
+    /**
+     * @brief Start a new page, unless the current one is still empty.
+     */
+    void appendPageBreak();
+
+    /**
+     * @brief Lay out what is pending and close the last page.
+     */
+    void finish();
+
+    /**
+     * @brief Ask the producer to stop; it checks isCanceled() as it parses.
+     */
+    void cancel();
+
+    /**
+     * @brief Check whether cancel() was called.
+     * @return True if canceled.
+     */
+    bool isCanceled() const;
+
+    // --- Consumer side: any thread ---
+
+    /**
+     * @brief Get the page format.
+     * @return Format.
+     */
+    PageFormat format() const;
+
+    /**
+     * @brief Get the number of completed pages.
+     * @return Pages that can be rendered.
+     */
+    int pageCount() const;
+
+    /**
+     * @brief Check whether the whole body has been paginated.
+     * @return True after finish().
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief Render part of a completed page.
+     * @param page Page index.
+     * @param rect Area in page points.
+     * @param width Output width.
+     * @param height Output height.
+     * @return Image, or null if the page is not complete.
+     */
+    QImage renderPage(int page, const QRectF& rect, int width, int height) const;
+
+    /**
+     * @brief Get the text of a completed page.
+     * @param page Page index.
+     * @return Plain text of the blocks on the page.
+     */
+    QString pageText(int page) const;
+
+    /**
+     * @brief Decode an embedded image for an ImageLoader.
+     * Images wider than maxWidth are decoded scaled down, so a photo in a
+     * document does not hold its full resolution in every layout.
+     * @param data Encoded image.
+     * @param maxWidth Widest decoded width, in pixels.
+     * @return Image, or null if undecodable.
+     */
+    static QImage decodeImage(const QByteArray& data, int maxWidth);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FLOWPAGINATOR_H
@@ -1,81 +1,421 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
  */
 #include "OdtDocument.h"
-#include "OdtPage.h"
+#include "FlowPage.h"
+#include "FlowPaginator.h"
+#include "../../core/FontRegistry.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
-#include <QFile>
-#include <QFileInfo>
-#include <QDir>
+#include "../../core/ThreadPool.h"
+#include "../../core/ZipArchive.h"
+#include <QCoreApplication>
+#include <QHash>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QSet>
+#include <QVector>
 #include <QXmlStreamReader>
-#include <QZipReader> // Qt 5.12+
-#include <QDebug>
+#include <functional>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Images are decoded no wider than twice the text column of a Letter page
+const int MaxImageWidth = 936;
+
+// Producers disagree on namespace prefixes, never on local names
+QString attribute(const QXmlStreamReader& xml, QLatin1String name)
+{
+    for (const QXmlStreamAttribute& attr : xml.attributes()) {
+        if (attr.name() == name) return attr.value().toString();
+    }
+    return QString();
+}
+
+// An ODF length such as "2.5cm" or "8.5in", in points; 0 if unparsable
+qreal toPoints(const QString& length)
+{
+    static const QRegularExpression pattern(QStringLiteral("^\\s*([-+]?[0-9]*\\.?[0-9]+)\\s*(in|cm|mm|pt|pc|px)?\\s*$"));
+    const QRegularExpressionMatch match = pattern.match(length);
+    if (!match.hasMatch()) return 0;
+    const qreal value = match.captured(1).toDouble();
+    const QString unit = match.captured(2);
+    if (unit == QLatin1String("in")) return value * 72;
+    if (unit == QLatin1String("cm")) return value * 72 / 2.54;
+    if (unit == QLatin1String("mm")) return value * 72 / 25.4;
+    if (unit == QLatin1String("pc")) return value * 12;
+    if (unit == QLatin1String("px")) return value * 0.75;
+    return value;
+}
+
+// The properties of a paragraph or text style that are shown, with those
+// of its parent style folded in
+struct OdtStyle {
+    QString displayName;
+    bool bold = false;
+    bool italic = false;
+    bool underline = false;
+    bool strike = false;
+    qreal pointSize = 0;
+    QString color;
+    QString position; // "super" or "sub"
+    QString align;
+    bool breakBefore = false;
+    bool breakAfter = false;
+
+    QString css() const {
+        QStringList css;
+        if (bold) css << QStringLiteral("font-weight:bold");
+        if (italic) css << QStringLiteral("font-style:italic");
+        if (underline || strike) {
+            css << QStringLiteral("text-decoration:%1%2").arg(underline ? QStringLiteral("underline ") : QString(),
+                                                             strike ? QStringLiteral("line-through") : QString());
+        }
+        if (pointSize > 0) css << QStringLiteral("font-size:%1pt").arg(pointSize);
+        if (!color.isEmpty()) css << QStringLiteral("color:%1").arg(color);
+        if (!position.isEmpty()) css << QStringLiteral("vertical-align:%1").arg(position);
+        return css.join(QLatin1Char(';'));
+    }
+};
+
+using OdtStyles = QHash<QString, OdtStyle>; // Keyed family/name
+
+// Read a <style:style> element into styles, consuming it
+void readStyle(QXmlStreamReader& xml, OdtStyles& styles)
+{
+    const QString family = attribute(xml, QLatin1String("family"));
+    const QString name = attribute(xml, QLatin1String("name"));
+    const QString parent = attribute(xml, QLatin1String("parent-style-name"));
+    OdtStyle style = parent.isEmpty() ? OdtStyle() : styles.value(family + QLatin1Char('/') + parent);
+    style.displayName = attribute(xml, QLatin1String("display-name"));
+    if (style.displayName.isEmpty()) style.displayName = name;
+    style.breakBefore = false; // Breaks belong to the style that sets them
+    style.breakAfter = false;
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("paragraph-properties")) {
+            const QString align = attribute(xml, QLatin1String("text-align"));
+            if (align == QLatin1String("center")) style.align = QStringLiteral("center");
+            else if (align == QLatin1String("end") || align == QLatin1String("right")) style.align = QStringLiteral("right");
+            else if (align == QLatin1String("justify")) style.align = QStringLiteral("justify");
+            else if (!align.isEmpty()) style.align.clear();
+            style.breakBefore = attribute(xml, QLatin1String("break-before")) == QLatin1String("page");
+            style.breakAfter = attribute(xml, QLatin1String("break-after")) == QLatin1String("page");
+        } else if (xml.name() == QLatin1String("text-properties")) {
+            const QString weight = attribute(xml, QLatin1String("font-weight"));
+            if (!weight.isEmpty()) style.bold = weight == QLatin1String("bold") || weight.toInt() >= 600;
+            const QString fontStyle = attribute(xml, QLatin1String("font-style"));
+            if (!fontStyle.isEmpty()) style.italic = fontStyle != QLatin1String("normal");
+            const QString underline = attribute(xml, QLatin1String("text-underline-style"));
+            if (!underline.isEmpty()) style.underline = underline != QLatin1String("none");
+            const QString strike = attribute(xml, QLatin1String("text-line-through-style"));
+            if (!strike.isEmpty()) style.strike = strike != QLatin1String("none");
+            const QString size = attribute(xml, QLatin1String("font-size"));
+            if (!size.isEmpty() && !size.endsWith(QLatin1Char('%'))) style.pointSize = toPoints(size);
+            const QString color = attribute(xml, QLatin1String("color"));
+            if (color.startsWith(QLatin1Char('#'))) style.color = color;
+            const QString position = attribute(xml, QLatin1String("text-position"));
+            if (position.startsWith(QLatin1String("super"))) style.position = QStringLiteral("super");
+            else if (position.startsWith(QLatin1String("sub"))) style.position = QStringLiteral("sub");
+            else if (position.startsWith(QLatin1Char('-'))) style.position = QStringLiteral("sub");
+            else if (!position.isEmpty() && !position.startsWith(QLatin1Char('0'))) style.position = QStringLiteral("super");
+        }
+        xml.skipCurrentElement();
+    }
+    if (!name.isEmpty()) styles.insert(family + QLatin1Char('/') + name, style);
+}
+
+/**
+ * Converts the office:text body of content.xml to HTML blocks as it is
+ * read, handing each paragraph or top-level table to the paginator. The
+ * automatic styles it meets first are folded into the common ones from
+ * styles.xml. Covers headings, lists, spans, hyperlinks, tables, images
+ * and page breaks set by paragraph styles; tracked deletions, notes and
+ * annotations are dropped.
+ */
+class OdtBodyParser
+{
+public:
+    OdtBodyParser(const OdtStyles& commonStyles, FlowPaginator& flow, std::function<void()> onProgress)
+        : styles(commonStyles), paginator(flow), progress(std::move(onProgress))
+        , inParagraph(false), heading(0), listDepth(0), listItemFresh(false), frameWidth(0), frameHeight(0)
+    {
+        const FlowPaginator::PageFormat format = paginator.format();
+        textWidth = format.pageSize.width() - format.margins.left() - format.margins.right();
+    }
+
+    bool parse(QIODevice* device, QString* error) {
+        QXmlStreamReader xml(device);
+        while (!xml.atEnd()) {
+            if (paginator.isCanceled()) return false;
+            xml.readNext();
+            if (xml.isStartElement()) {
+                startElement(xml);
+            } else if (xml.isEndElement()) {
+                endElement(xml.name());
+            } else if (xml.isCharacters() && inParagraph) {
+                paragraphHtml += xml.text().toString().toHtmlEscaped();
+            }
+        }
+        if (xml.hasError()) {
+            if (error) *error = xml.errorString();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Table {
+        QString html;
+    };
+
+    OdtStyles styles;
+    FlowPaginator& paginator;
+    std::function<void()> progress;
+    qreal textWidth;
+    QVector<Table> tables; // Open tables, innermost last
+    QVector<bool> spans;   // Open spans and links; false if nothing was written for it
+
+    bool inParagraph;
+    QString paragraphHtml;
+    QString paragraphStyle;
+    int heading;
+    int listDepth;
+    bool listItemFresh; // The next paragraph is the first of a list item
+    qreal frameWidth;
+    qreal frameHeight;
+
+    void emitBlock(const QString& html) {
+        if (!tables.isEmpty()) {
+            tables.last().html += html;
+            return;
+        }
+        paginator.appendBlock(html);
+        progress();
+    }
+
+    void pageBreak() {
+        if (!tables.isEmpty()) return; // Tables are not split across pages by hand
+        paginator.appendPageBreak();
+        progress();
+    }
+
+    void emitParagraph() {
+        const OdtStyle style = styles.value(QStringLiteral("paragraph/") + paragraphStyle);
+        const QString css = style.css();
+        QString content = paragraphHtml.isEmpty() ? QStringLiteral("&nbsp;") : paragraphHtml;
+        if (!css.isEmpty()) content = QStringLiteral("<span style=\"%1\">%2</span>").arg(css, content);
+        const QString alignment = style.align.isEmpty() ? QString() : QStringLiteral(" align=\"%1\"").arg(style.align);
+        QString html;
+        if (heading > 0) {
+            html = QStringLiteral("<h%1%2>%3</h%1>").arg(heading).arg(alignment, content);
+        } else if (listDepth > 0 && listItemFresh) {
+            html = QStringLiteral("<ul style=\"-qt-list-indent:%1;\"><li%2>%3</li></ul>").arg(listDepth).arg(alignment, content);
+        } else if (listDepth > 0) {
+            // Later paragraphs of an item line up with its text
+            html = QStringLiteral("<p style=\"margin-left:%1px;\"%2>%3</p>").arg(listDepth * 40).arg(alignment, content);
+        } else {
+            html = QStringLiteral("<p%1>%2</p>").arg(alignment, content);
+        }
+        listItemFresh = false;
+        paragraphHtml.clear();
+        if (style.breakBefore) pageBreak();
+        emitBlock(html);
+        if (style.breakAfter) pageBreak();
+    }
+
+    QString image(const QString& href) const {
+        if (href.isEmpty() || href.contains(QLatin1String("://"))) return QString(); // Linked, not embedded
+        qreal width = frameWidth;
+        qreal height = frameHeight;
+        if (width > textWidth && width > 0) {
+            height *= textWidth / width;
+            width = textWidth;
+        }
+        const QString source = ZipArchive::normalizePath(href).toHtmlEscaped();
+        if (width <= 0 || height <= 0) return QStringLiteral("<img src=\"zip:%1\"/>").arg(source);
+        return QStringLiteral("<img src=\"zip:%1\" width=\"%2\" height=\"%3\"/>").arg(source).arg(qRound(width)).arg(qRound(height));
+    }
+
+    void startElement(QXmlStreamReader& xml) {
+        const QStringRef name = xml.name();
+        if (name == QLatin1String("style")) {
+            readStyle(xml, styles);
+        } else if (name == QLatin1String("p") || name == QLatin1String("h")) {
+            inParagraph = true;
+            paragraphHtml.clear();
+            paragraphStyle = attribute(xml, QLatin1String("style-name"));
+            heading = 0;
+            if (name == QLatin1String("h")) {
+                const QString level = attribute(xml, QLatin1String("outline-level"));
+                heading = qBound(1, level.isEmpty() ? 1 : level.toInt(), 6);
+            }
+        } else if (name == QLatin1String("span")) {
+            const QString css = styles.value(QStringLiteral("text/") + attribute(xml, QLatin1String("style-name"))).css();
+            spans.append(inParagraph && !css.isEmpty());
+            if (spans.last()) paragraphHtml += QStringLiteral("<span style=\"%1\">").arg(css);
+        } else if (name == QLatin1String("a")) {
+            const QString href = attribute(xml, QLatin1String("href"));
+            spans.append(inParagraph && !href.isEmpty());
+            if (spans.last()) paragraphHtml += QStringLiteral("<a href=\"%1\">").arg(href.toHtmlEscaped());
+        } else if (name == QLatin1String("s")) {
+            const int count = qBound(1, attribute(xml, QLatin1String("c")).toInt(), 256);
+            if (inParagraph) paragraphHtml += QStringLiteral("&nbsp;").repeated(count);
+        } else if (name == QLatin1String("tab")) {
+            if (inParagraph) paragraphHtml += QStringLiteral("&nbsp;&nbsp;&nbsp;&nbsp;");
+        } else if (name == QLatin1String("line-break")) {
+            if (inParagraph) paragraphHtml += QStringLiteral("<br/>");
+        } else if (name == QLatin1String("list")) {
+            ++listDepth;
+        } else if (name == QLatin1String("list-item") || name == QLatin1String("list-header")) {
+            listItemFresh = name == QLatin1String("list-item");
+        } else if (name == QLatin1String("frame")) {
+            frameWidth = toPoints(attribute(xml, QLatin1String("width")));
+            frameHeight = toPoints(attribute(xml, QLatin1String("height")));
+        } else if (name == QLatin1String("image")) {
+            const QString html = image(attribute(xml, QLatin1String("href")));
+            if (!html.isEmpty()) {
+                if (inParagraph) paragraphHtml += html;
+                else emitBlock(QStringLiteral("<p>%1</p>").arg(html));
+            }
+            xml.skipCurrentElement(); // Inline binary data is not read
+        } else if (name == QLatin1String("table")) {
+            tables.append(Table{QStringLiteral("<table border=\"1\" cellspacing=\"0\" cellpadding=\"4\" width=\"100%\">")});
+        } else if (name == QLatin1String("table-row")) {
+            if (!tables.isEmpty()) tables.last().html += QStringLiteral("<tr>");
+        } else if (name == QLatin1String("table-cell")) {
+            if (tables.isEmpty()) return;
+            const int span = attribute(xml, QLatin1String("number-columns-spanned")).toInt();
+            tables.last().html += span > 1 ? QStringLiteral("<td colspan=\"%1\">").arg(span) : QStringLiteral("<td>");
+        } else if (name == QLatin1String("covered-table-cell") || name == QLatin1String("tracked-changes")
+                   || name == QLatin1String("note-body") || name == QLatin1String("annotation")
+                   || name == QLatin1String("text-box") || name == QLatin1String("sequence-decls")
+                   || name == QLatin1String("table-columns") || name == QLatin1String("table-column")
+                   || name == QLatin1String("forms") || name == QLatin1String("font-face-decls")) {
+            xml.skipCurrentElement();
+        }
+    }
+
+    void endElement(const QStringRef& name) {
+        if (name == QLatin1String("p") || name == QLatin1String("h")) {
+            if (!inParagraph) return;
+            emitParagraph();
+            inParagraph = false;
+        } else if (name == QLatin1String("span")) {
+            if (!spans.isEmpty() && spans.takeLast()) paragraphHtml += QStringLiteral("</span>");
+        } else if (name == QLatin1String("a")) {
+            if (!spans.isEmpty() && spans.takeLast()) paragraphHtml += QStringLiteral("</a>");
+        } else if (name == QLatin1String("list")) {
+            listDepth = qMax(0, listDepth - 1);
+        } else if (name == QLatin1String("frame")) {
+            frameWidth = 0;
+            frameHeight = 0;
+        } else if (name == QLatin1String("table-cell")) {
+            if (!tables.isEmpty()) tables.last().html += QStringLiteral("</td>");
+        } else if (name == QLatin1String("table-row")) {
+            if (!tables.isEmpty()) tables.last().html += QStringLiteral("</tr>");
+        } else if (name == QLatin1String("table")) {
+            if (!tables.isEmpty()) emitBlock(tables.takeLast().html + QStringLiteral("</table>"));
+        }
+    }
+};
+
+} // namespace
+
 class OdtDocument::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(0) {}
-    ~Private() = default;
+    Private() : isLoaded(false), paginated(false), pageCountVal(0), loadGeneration(0) {}
+    ~Private() {
+        if (paginator) paginator->cancel(); // The parse in flight stops at its next element
+    }
 
     bool isLoaded;
+    bool paginated;
     int pageCountVal;
     QString title;
     QString author;
     QList<QString> keywords;
     QStringList styles;
     QList<QString> embeddedObjects;
-    QList<std::unique_ptr<OdtPage>> pages;
-    QZipReader zipReader;
-
-    // Helper to parse content.xml and meta.xml from ODT
-    bool parseOdtContent() {
-        // ODT structure: META-INF/manifest.xml, content.xml, meta.xml, styles.xml, etc.
-        QByteArray metaXml = zipReader.fileData("meta.xml");
-        if (!metaXml.isEmpty()) {
-            QXmlStreamReader metaReader(metaXml);
-            while (!metaReader.atEnd()) {
-                metaReader.readNext();
-                if (metaReader.isStartElement()) {
-                    QString tagName = metaReader.name().toString();
-                    if (tagName == "title") {
-                        title = metaReader.readElementText();
-                    } else if (tagName == "creator") {
-                        author = metaReader.readElementText();
-                    } else if (tagName == "keywords") {
-                        QString kwStr = metaReader.readElementText();
-                        keywords = kwStr.split(',', Qt::SkipEmptyParts);
-                    }
+    QList<std::unique_ptr<FlowPage>> pages;
+    std::shared_ptr<ZipArchive> archive;     // Shared with the parse and the image loader
+    std::shared_ptr<FlowPaginator> paginator; // Shared with the parse and the pages
+    quint64 loadGeneration; // Bumped by every load(); stale background parses are dropped
+    std::unique_ptr<LoadTrace> loadTrace; // Finished when the background parse is
+
+    // ODT structure: META-INF/manifest.xml, content.xml, meta.xml, styles.xml, etc.
+    void parseMeta() {
+        QXmlStreamReader metaReader(archive->read(QStringLiteral("meta.xml")));
+        while (!metaReader.atEnd()) {
+            metaReader.readNext();
+            if (metaReader.isStartElement()) {
+                QString tagName = metaReader.name().toString();
+                if (tagName == "title") {
+                    title = metaReader.readElementText();
+                } else if (tagName == "creator") {
+                    author = metaReader.readElementText();
+                } else if (tagName == "keywords") {
+                    QString kwStr = metaReader.readElementText();
+                    keywords = kwStr.split(',', Qt::SkipEmptyParts);
                 }
             }
         }
+    }
 
-        // Parse content.xml to estimate page count or get structure
-        QByteArray contentXml = zipReader.fileData("content.xml");
-        if (!contentXml.isEmpty()) {
-            // Count sections, paragraphs, or use other heuristics for page count.
-            // A real implementation would be more complex.
-            QXmlStreamReader contentReader(contentXml);
-            int paraCount = 0;
-            while (!contentReader.atEnd()) {
-                contentReader.readNext();
-                if (contentReader.isStartElement() && contentReader.name() == "p") {
-                    paraCount++;
+    // Common styles and the default master page's layout, from styles.xml
+    OdtStyles parseStyles(FlowPaginator::PageFormat* format) {
+        struct Layout {
+            QSizeF size;
+            QMarginsF margins;
+        };
+        OdtStyles result;
+        QHash<QString, Layout> layouts;
+        QString masterLayout;
+        QString layoutName;
+        QXmlStreamReader xml(archive->read(QStringLiteral("styles.xml")));
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (!xml.isStartElement()) continue;
+            if (xml.name() == QLatin1String("style")) {
+                const bool common = attribute(xml, QLatin1String("family")) == QLatin1String("paragraph");
+                const QString name = attribute(xml, QLatin1String("display-name"));
+                const QString fallback = attribute(xml, QLatin1String("name"));
+                readStyle(xml, result);
+                if (common) styles.append(name.isEmpty() ? fallback : name);
+            } else if (xml.name() == QLatin1String("page-layout")) {
+                layoutName = attribute(xml, QLatin1String("name"));
+            } else if (xml.name() == QLatin1String("page-layout-properties")) {
+                Layout& layout = layouts[layoutName];
+                layout.size = QSizeF(toPoints(attribute(xml, QLatin1String("page-width"))),
+                                     toPoints(attribute(xml, QLatin1String("page-height"))));
+                const qreal all = toPoints(attribute(xml, QLatin1String("margin")));
+                auto margin = [&](const char* side) {
+                    const QString value = attribute(xml, QLatin1String(side));
+                    return value.isEmpty() ? all : toPoints(value);
+                };
+                layout.margins = QMarginsF(margin("margin-left"), margin("margin-top"), margin("margin-right"), margin("margin-bottom"));
+            } else if (xml.name() == QLatin1String("master-page")) {
+                // The body flows on the default master page
+                if (masterLayout.isEmpty() || attribute(xml, QLatin1String("name")) == QLatin1String("Standard")) {
+                    masterLayout = attribute(xml, QLatin1String("page-layout-name"));
                 }
             }
-            pageCountVal = qMax(1, paraCount / 25); // Rough estimate: 25 paragraphs per page
-        } else {
-            pageCountVal = 1;
         }
 
-        LOG_DEBUG("OdtDocument: Parsed ODT with title '" << title << "', author '" << author << "', estimated pages: " << pageCountVal);
-        return true;
+        const auto layout = layouts.constFind(masterLayout);
+        if (layout != layouts.constEnd() && layout->size.width() > 72 && layout->size.height() > 72) {
+            format->pageSize = layout->size;
+            format->margins = layout->margins;
+        }
+        return result;
     }
 };
 
@@ -88,36 +428,86 @@ OdtDocument::OdtDocument(QObject* parent)
 
 OdtDocument::~OdtDocument()
 {
+    FontRegistry::instance().release(this);
     LOG_INFO("OdtDocument destroyed.");
 }
 
 bool OdtDocument::load(const QString& filePath, const QString& password)
 {
     Q_UNUSED(password);
+    if (d->paginator) d->paginator->cancel();
+    ++d->loadGeneration; // Drops pages still being published by the previous parse
     d->isLoaded = false;
+    d->paginated = false;
+    const bool hadPages = !d->pages.isEmpty();
     d->pages.clear();
+    d->pageCountVal = 0;
+    d->paginator.reset();
+    d->styles.clear();
+    d->embeddedObjects.clear();
+    d->loadTrace.reset();
+    FontRegistry::instance().release(this);
+    if (hadPages) emit pageCountChanged();
 
-    d->zipReader.setFileName(filePath);
-    if (!d->zipReader.exists() || !d->zipReader.isOpen()) {
+    std::unique_ptr<LoadTrace> trace(new LoadTrace(filePath, QStringLiteral("ODT")));
+    trace->phase(LoadTrace::Io);
+    std::shared_ptr<ZipArchive> archive = std::make_shared<ZipArchive>();
+    QString zipError;
+    if (!archive->open(filePath, &zipError) || !archive->contains(QStringLiteral("content.xml"))) {
         setLastError(tr("Failed to open ODT file as ZIP archive."));
-        LOG_ERROR(lastError());
+        LOG_ERROR(lastError() << " " << zipError);
         return false;
     }
-
+    d->archive = archive;
     setFilePath(filePath);
 
-    if (!d->parseOdtContent()) {
-        setLastError(tr("Failed to parse ODT content."));
-        LOG_ERROR(lastError());
-        return false;
+    trace->phase(LoadTrace::Metadata);
+    d->parseMeta();
+    trace->phase(LoadTrace::Parse);
+    FlowPaginator::PageFormat format;
+    const OdtStyles styles = d->parseStyles(&format);
+    for (const QString& entry : archive->entryNames()) {
+        if (entry.startsWith(QLatin1String("Pictures/")) || entry.startsWith(QLatin1String("Object"))) {
+            d->embeddedObjects.append(entry);
+        } else if (entry.startsWith(QLatin1String("Fonts/"))) {
+            FontRegistry::instance().addFont(archive->read(entry), this); // Before the body is laid out in it
+        }
     }
 
-    createPages();
+    std::shared_ptr<FlowPaginator> paginator = std::make_shared<FlowPaginator>(format, [archive](const QString& name) {
+        if (!name.startsWith(QLatin1String("zip:"))) return QImage();
+        return FlowPaginator::decodeImage(archive->read(name.mid(4)), MaxImageWidth);
+    }, "ODT page layouts");
+    d->paginator = paginator;
+    setState(Loading);
+    trace->phase(LoadTrace::Pages); // Parsing the body and cutting it into pages
+    d->loadTrace = std::move(trace);
 
-    d->isLoaded = true;
-    setState(Loaded);
-    emit odtLoaded();
-    LOG_INFO("Successfully loaded ODT document: " << filePath);
+    const quint64 generation = d->loadGeneration;
+    QPointer<OdtDocument> self(this);
+    ThreadPool::instance().submitDetached([self, generation, archive, paginator, styles]() {
+        int published = 0;
+        // Completed pages go to the main thread as they appear; self is only
+        // checked there, where the document is deleted
+        auto publish = [&](bool finished, const QString& error) {
+            const int count = paginator->pageCount();
+            if (!finished && count == published) return;
+            published = count;
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [self, generation, count, finished, error]() {
+                if (self) self->publishPages(generation, count, finished, error);
+            }, Qt::QueuedConnection);
+        };
+
+        OdtBodyParser parser(styles, *paginator, [&]() { publish(false, QString()); });
+        std::unique_ptr<QIODevice> body = archive->openStream(QStringLiteral("content.xml"));
+        QString error;
+        const bool parsed = body && parser.parse(body.get(), &error);
+        if (paginator->isCanceled()) return;
+        paginator->finish(); // A body that fails part way keeps the pages before the fault
+        publish(true, parsed ? QString() : tr("Failed to parse ODT content: %1").arg(error));
+    });
+
+    LOG_INFO("Opened ODT document " << filePath << "; paginating in the background.");
     return true;
 }
 
@@ -129,17 +519,109 @@ bool OdtDocument::save(const QString& filePath)
     return false;
 }
 
-// ... (Rest of OdtDocument methods similar to others) ...
+Document::DocumentType OdtDocument::type() const
+{
+    return DocumentType::Office;
+}
 
-void OdtDocument::createPages()
+int OdtDocument::pageCount() const
 {
-    d->pages.clear();
-    d->pages.reserve(d->pageCountVal);
-    for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<OdtPage>(this, i)); // Placeholder
-        LOG_DEBUG("OdtDocument: Planned page " << i);
+    return d->pageCountVal;
+}
+
+Page* OdtDocument::page(int index) const
+{
+    if (index >= 0 && index < d->pages.size()) {
+        return d->pages.at(index).get();
     }
-    LOG_INFO("OdtDocument: Created " << d->pages.size() << " page objects.");
+    return nullptr;
+}
+
+bool OdtDocument::isLocked() const
+{
+    return false;
+}
+
+bool OdtDocument::isEncrypted() const
+{
+    return false;
+}
+
+QString OdtDocument::formatVersion() const
+{
+    return "OpenDocument 1.2";
+}
+
+bool OdtDocument::supportsFeature(const QString& feature) const
+{
+    static const QSet<QString> supportedFeatures = {
+        "Text", "Images", "Tables", "Hyperlinks"
+    };
+    return supportedFeatures.contains(feature);
+}
+
+QString OdtDocument::documentTitle() const
+{
+    return d->title;
+}
+
+QString OdtDocument::documentAuthor() const
+{
+    return d->author;
+}
+
+QList<QString> OdtDocument::documentKeywords() const
+{
+    return d->keywords;
+}
+
+QStringList OdtDocument::styleNames() const
+{
+    return d->styles;
+}
+
+QList<QString> OdtDocument::embeddedObjectNames() const
+{
+    return d->embeddedObjects;
+}
+
+bool OdtDocument::isPaginated() const
+{
+    return d->paginated;
+}
+
+void OdtDocument::publishPages(quint64 generation, int count, bool finished, const QString& error)
+{
+    if (generation != d->loadGeneration) return; // A later load() replaced this document
+
+    const int before = d->pages.size();
+    for (int i = before; i < count; ++i) {
+        d->pages.append(std::make_unique<FlowPage>(this, d->paginator, i));
+    }
+    d->pageCountVal = d->pages.size();
+    if (d->pageCountVal != before) emit pageCountChanged();
+    if (!finished) return;
+
+    d->paginated = true;
+    if (d->loadTrace) {
+        d->loadTrace->finish(error.isEmpty());
+        d->loadTrace.reset();
+    }
+    emit paginationFinished();
+    if (!error.isEmpty()) {
+        // The pages before the fault stay readable
+        setLastError(error);
+        LOG_ERROR(error << " " << filePath());
+        setState(Error);
+        emit loadFailed(error);
+        return;
+    }
+
+    d->isLoaded = true;
+    LOG_INFO("Successfully loaded ODT document: " << filePath() << " (" << d->pageCountVal << " pages)");
+    setState(Loaded);
+    emit loaded();
+    emit odtLoaded();
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
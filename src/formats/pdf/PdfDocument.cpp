@@ -11,7 +11,14 @@
 #include "PdfPage.h"
 #include "PdfAnnotation.h"
 #include "PdfFormField.h" // Assuming this exists or will be created
+#include "../../annotations/AnnotationManager.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/Settings.h"
+#include "../../core/ThreadPool.h"
+#include "../../core/ReadAhead.h"
+#include "../../core/MappedFile.h"
+#include "../../core/RemoteFile.h"
 #include <poppler-qt5.h>
 #include <QFileInfo>
 #include <QDateTime>
@@ -19,35 +26,524 @@
 #include <QDir>
 #include <QSaveFile> // For safe saving
 #include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <QCoreApplication>
+#include <QPointer>
+#include <QRegularExpression>
 #include <qpdf/QPDF.hh>
 #include <qpdf/QPDFWriter.hh>
 #include <qpdf/QPDFPageObjectHelper.hh>
 #include <qpdf/Types.h>
 #include <qpdf/QPDFObjectHandle.hh>
+#include <qpdf/QPDFObjGen.hh>
 #include <qpdf/Pl_Buffer.hh>
 #include <qpdf/Pl_StdioFile.hh>
 #include <qpdf/QIntC.hh> // For integer types used by QPDF
 #include <qpdf/QPDFSystemError.hh>
 #include <qpdf/QUtil.hh> // For string conversion utilities if needed
 #include <memory> // For std::unique_ptr if managing QPDF lifecycle carefully
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <list>
+#include <map>
+#include <vector>
 
 namespace QuantilyxDoc {
 
+// One worker Poppler document; pages are released before the document
+struct PdfDocument::PopplerHandle {
+    std::unique_ptr<Poppler::Document> document;
+    std::vector<std::unique_ptr<Poppler::Page>> pages;
+    std::deque<int> loadedPages; // Indices with a loaded page, oldest first
+};
+
+namespace {
+
+// Nesting below which objects are not followed; deeper graphs still hash
+// up to it, so they can only be told apart less finely
+const int DigestMaxDepth = 32;
+
+// Feeds everything an object's rendering can depend on into a hash:
+// dictionaries by sorted key, arrays in order, streams by dictionary and
+// raw, still encoded, data. An indirect object is hashed where it is
+// first reached and by its order of appearance after that, so no object
+// number enters the hash. Back references (/Parent, /P) are skipped,
+// which keeps an annotation from pulling in the page tree.
+void hashObject(QPDFObjectHandle object, QCryptographicHash& hash, std::map<QPDFObjGen, int>& seen, int depth)
+{
+    if (depth > DigestMaxDepth) return;
+    if (object.isIndirect()) {
+        const auto inserted = seen.emplace(object.getObjGen(), int(seen.size()));
+        if (!inserted.second) {
+            hash.addData("@" + QByteArray::number(inserted.first->second));
+            return;
+        }
+    }
+    if (object.isStream()) {
+        hash.addData("stream");
+        hashObject(object.getDict(), hash, seen, depth + 1);
+        const auto data = object.getRawStreamData();
+        hash.addData(reinterpret_cast<const char*>(data->getBuffer()), int(data->getSize()));
+    } else if (object.isDictionary()) {
+        hash.addData("<<");
+        for (const std::string& key : object.getKeys()) {
+            if (key == "/Parent" || key == "/P") continue;
+            hash.addData(key.c_str(), int(key.size()));
+            hashObject(object.getKey(key), hash, seen, depth + 1);
+        }
+        hash.addData(">>");
+    } else if (object.isArray()) {
+        hash.addData("[");
+        for (int i = 0; i < object.getArrayNItems(); ++i) hashObject(object.getArrayItem(i), hash, seen, depth + 1);
+        hash.addData("]");
+    } else {
+        const std::string text = object.unparse();
+        hash.addData(text.c_str(), int(text.size()));
+    }
+    hash.addData(" ");
+}
+
+// True if every content stream of a page decodes to white space only
+bool drawsNothing(QPDFPageObjectHelper& page)
+{
+    for (QPDFObjectHandle stream : page.getPageContents()) {
+        const auto data = stream.getStreamData(qpdf_dl_generalized);
+        const char* bytes = reinterpret_cast<const char*>(data->getBuffer());
+        for (size_t i = 0; i < data->getSize(); ++i) {
+            if (!std::isspace(static_cast<unsigned char>(bytes[i]))) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 class PdfDocument::Private {
 public:
-    Private() : popplerDoc(nullptr), locked(false), encrypted(false), restrictionsRemoved(false) {}
-    ~Private() { delete popplerDoc; } // Poppler doc must be deleted explicitly
+    Private()
+        : popplerDoc(nullptr), locked(false), encrypted(false), restrictionsRemoved(false)
+        , openingHandles(0), handlesUnavailable(false)
+        , maxHandles(Settings::instance().value<int>("Advanced/PdfHandlesPerDocument", qMax(2, QThread::idealThreadCount())))
+        , residentLimit(qMax(1, Settings::instance().value<int>("Advanced/PdfResidentPages", 256)))
+        , loadGeneration(0), progressive(false) {}
+    ~Private() {
+        outlineLevels.clear(); // Items point into popplerDoc
+        delete popplerDoc; // Poppler doc must be deleted explicitly
+    }
 
     Poppler::Document* popplerDoc;
+
+    // Page digests (see pageContentDigest()), read through a QPDF instance
+    // of their own since Poppler does not expose raw page objects
+    struct PageDigest {
+        QByteArray digest;
+        bool blank = false;
+    };
+    mutable QMutex digestMutex; // Guards the digest fields; QPDF is not thread-safe
+    mutable std::unique_ptr<QPDF> digestSource;
+    mutable bool digestSourceFailed = false;
+    mutable QDateTime digestFileModified; // Of the file digestSource read
+    mutable QHash<int, PageDigest> pageDigests;
+
+    // Outline levels of popplerDoc read so far, by path of child indexes
+    // from the top level. Cleared whenever popplerDoc is replaced.
+    mutable QMutex outlineMutex;
+    mutable QHash<QVector<int>, QVector<Poppler::OutlineItem>> outlineLevels;
+
+    QVector<Poppler::OutlineItem> outlineLevelLocked(const QVector<int>& path) const {
+        auto it = outlineLevels.constFind(path);
+        if (it != outlineLevels.constEnd()) return *it;
+        QVector<Poppler::OutlineItem> level;
+        if (path.isEmpty()) {
+            if (popplerDoc) level = popplerDoc->outline();
+        } else {
+            const QVector<Poppler::OutlineItem> parent = outlineLevelLocked(path.mid(0, path.size() - 1));
+            if (path.last() >= 0 && path.last() < parent.size()) level = parent.at(path.last()).children();
+        }
+        outlineLevels.insert(path, level);
+        return level;
+    }
+
+    // Same destination form as convertTocElementToVariantList()
+    static TocEntry tocEntry(const Poppler::OutlineItem& item) {
+        TocEntry entry;
+        entry.title = item.name().trimmed();
+        entry.hasChildren = item.hasChildren();
+        const QSharedPointer<const Poppler::LinkDestination> destination = item.destination();
+        if (destination && destination->pageNumber() > 0) {
+            QVariantMap page{{"type", "page"}, {"page", destination->pageNumber() - 1}};
+            if (destination->isChangeTop()) page.insert("top", destination->top());
+            entry.destination = page;
+        } else if (!item.uri().isEmpty()) {
+            entry.destination = QVariantMap{{"type", "uri"}, {"uri", item.uri()}};
+        }
+        return entry;
+    }
+
+    static bool visitOutline(const QVector<Poppler::OutlineItem>& items, QVector<int>& path,
+                             const std::function<bool(const TocEntry&, const QVector<int>&)>& visitor) {
+        path.append(0);
+        for (int i = 0; i < items.size(); ++i) {
+            path.last() = i;
+            const Poppler::OutlineItem& item = items.at(i);
+            if (!visitor(tocEntry(item), path)) return false;
+            if (item.hasChildren() && !visitOutline(item.children(), path, visitor)) return false;
+        }
+        path.removeLast();
+        return true;
+    }
+
+    // Progressive open of linearized files. The first-page preview stays
+    // alive after the swap because pages lent out from it may still be in use.
+    std::unique_ptr<Poppler::Document> previewDoc;
+    std::unique_ptr<LoadTrace> loadTrace; // Carried from load() into completeProgressiveLoad()
+    quint64 loadGeneration; // Bumped by every load(); stale background loads are dropped
+    bool progressive;
+
+    // Worker handles, opened from the mapped file; declared before the
+    // handles so the mapping outlives them
+    std::shared_ptr<MappedFile> sourceMapping;
+    QByteArray sourceData; // Raw view of the mapping, or the file contents
+    // A remote file is parsed through a device over its block cache, which
+    // must outlive popplerDoc; it gets no worker handles
+    std::shared_ptr<RemoteFile> remote;
+    std::unique_ptr<QIODevice> remoteDevice;
+    QString password;      // Needed to open handles of an encrypted file
+    mutable QMutex handleMutex;
+    QWaitCondition handleReleased;
+    std::vector<std::unique_ptr<PopplerHandle>> handles;
+    QVector<PopplerHandle*> idleHandles;
+    int openingHandles;
+    bool handlesUnavailable;
+    int maxHandles;
+
     QString pdfVersionStr;
     bool locked;
     bool encrypted;
     bool restrictionsRemoved;
-    QList<std::unique_ptr<PdfPage>> pages; // Own the page objects
+
+    // Page objects, created on first access. Only the residentLimit most
+    // recently accessed ones keep their Poppler page loaded.
+    mutable QMutex pageMutex;
+    mutable std::vector<std::unique_ptr<PdfPage>> pages;
+    mutable std::list<int> residentPages; // Most recently accessed first
+    mutable QHash<int, std::list<int>::iterator> residentIndex;
+    int residentLimit;
     QList<std::unique_ptr<PdfAnnotation>> allAnnotations; // Own annotation objects associated with this doc
     QList<std::unique_ptr<PdfFormField>> formFields; // Own form field objects
     QStringList embeddedFileNames; // Cache list of embedded files
 
+    // Annotation object numbers per page, keyed by annotationKey(). Built
+    // from the file on disk on first lookup; cleared when object numbers
+    // may change (load, full rewrite).
+    QHash<int, QHash<QString, QPDFObjGen>> annotationObjects;
+
+    // /Subtype written for a new annotation of the given type
+    static std::string subtypeName(PdfAnnotation::Type type) {
+        switch (type) {
+        case PdfAnnotation::Type::FreeText: return "/FreeText";
+        case PdfAnnotation::Type::Line: return "/Line";
+        case PdfAnnotation::Type::Square: return "/Square";
+        case PdfAnnotation::Type::Circle: return "/Circle";
+        case PdfAnnotation::Type::Polygon: return "/Polygon";
+        case PdfAnnotation::Type::PolyLine: return "/PolyLine";
+        case PdfAnnotation::Type::Highlight: return "/Highlight";
+        case PdfAnnotation::Type::Underline: return "/Underline";
+        case PdfAnnotation::Type::Squiggly: return "/Squiggly";
+        case PdfAnnotation::Type::StrikeOut: return "/StrikeOut";
+        case PdfAnnotation::Type::Stamp: return "/Stamp";
+        case PdfAnnotation::Type::Caret: return "/Caret";
+        case PdfAnnotation::Type::Ink: return "/Ink";
+        default: return "/Text"; // Anything else becomes a sticky note
+        }
+    }
+
+    // /NM identifies an annotation; without one its /Rect has to do
+    static QString annotationKey(const QString& name, const QRectF& rect) {
+        if (!name.isEmpty()) return QStringLiteral("NM:") + name;
+        return QStringLiteral("R:%1,%2,%3,%4").arg(rect.x(), 0, 'g', 17).arg(rect.y(), 0, 'g', 17)
+                                             .arg(rect.width(), 0, 'g', 17).arg(rect.height(), 0, 'g', 17);
+    }
+
+    // What writing a journaled change needs of its annotation, read on the
+    // document's thread so the change can be written on any other
+    struct AnnotationEdit {
+        AnnotationChange change;
+        QString name;        // /NM, if the annotation has one
+        std::string subtype; // /Subtype for an added annotation
+    };
+
+    static QList<AnnotationEdit> captureEdits(const QList<AnnotationChange>& changes) {
+        QList<AnnotationEdit> edits;
+        edits.reserve(changes.size());
+        for (const AnnotationChange& change : changes) {
+            AnnotationEdit edit;
+            edit.change = change;
+            PdfAnnotation* pdfAnnot = qobject_cast<PdfAnnotation*>(change.annotation.data());
+            edit.name = pdfAnnot ? pdfAnnot->name() : QString();
+            edit.subtype = pdfAnnot ? subtypeName(pdfAnnot->type()) : std::string("/Text");
+            edits.append(edit);
+        }
+        return edits;
+    }
+
+    // Apply journaled annotation changes to a loaded file. objects caches its
+    // annotation object numbers per page; changedObjects receives what an
+    // incremental update must rewrite.
+    static void applyEdits(QPDF& qpdf, const QList<AnnotationEdit>& edits,
+                           QHash<int, QHash<QString, QPDFObjGen>>& objects,
+                           std::vector<QPDFObjectHandle>& changedObjects, QSet<int>& restructuredPages) {
+        std::vector<QPDFObjectHandle> allPages = qpdf.getAllPages();
+        const int pageCount = int(allPages.size());
+
+        auto rectArray = [](const QRectF& bounds) {
+            return QPDFObjectHandle::newArray({
+                QPDFObjectHandle::newReal(bounds.left()), QPDFObjectHandle::newReal(bounds.top()),
+                QPDFObjectHandle::newReal(bounds.right()), QPDFObjectHandle::newReal(bounds.bottom())
+            });
+        };
+        auto colorArray = [](const QColor& color) {
+            return QPDFObjectHandle::newArray({
+                QPDFObjectHandle::newReal(color.redF()), QPDFObjectHandle::newReal(color.greenF()),
+                QPDFObjectHandle::newReal(color.blueF())
+            });
+        };
+        // A direct annotation or /Annots array is written as part of the object holding it
+        auto holderOf = [](const QPDFObjectHandle& annotsArray, const QPDFObjectHandle& pageObj) {
+            return annotsArray.isIndirect() ? annotsArray : pageObj;
+        };
+
+        for (const AnnotationEdit& edit : edits) {
+            const AnnotationChange& change = edit.change;
+            if (change.pageIndex < 0 || change.pageIndex >= pageCount) {
+                LOG_WARN("QPDF: Annotation change refers to invalid page index: " << change.pageIndex);
+                continue;
+            }
+            QPDFObjectHandle pageObj = allPages[change.pageIndex];
+            QPDFObjectHandle annotsArray = pageObj.getKey("/Annots");
+
+            if (change.kind == AnnotationChange::Added) {
+                QPDFObjectHandle annotDict = QPDFObjectHandle::newDictionary();
+                annotDict.replaceKey("/Type", QPDFObjectHandle::newName("/Annot"));
+                annotDict.replaceKey("/Subtype", QPDFObjectHandle::newName(edit.subtype));
+                annotDict.replaceKey("/Rect", rectArray(change.bounds));
+                annotDict.replaceKey("/Contents", QPDFObjectHandle::newUnicodeString(change.contents.toStdString()));
+                annotDict.replaceKey("/C", colorArray(change.color));
+                if (!edit.name.isEmpty()) {
+                    annotDict.replaceKey("/NM", QPDFObjectHandle::newUnicodeString(edit.name.toStdString()));
+                }
+                annotDict.replaceKey("/P", pageObj);
+                QPDFObjectHandle annotObj = qpdf.makeIndirectObject(annotDict);
+                if (!annotsArray.isArray()) {
+                    annotsArray = qpdf.makeIndirectObject(QPDFObjectHandle::newArray());
+                    pageObj.replaceKey("/Annots", annotsArray);
+                    changedObjects.push_back(pageObj);
+                }
+                annotsArray.appendItem(annotObj);
+                changedObjects.push_back(annotObj);
+                changedObjects.push_back(holderOf(annotsArray, pageObj));
+                restructuredPages.insert(change.pageIndex);
+                LOG_DEBUG("QPDF: Added annotation on page " << change.pageIndex);
+                continue;
+            }
+
+            QPDFObjectHandle annotObj = findAnnotation(objects, pageObj, change.pageIndex, edit.name, change.originalBounds);
+            if (!annotObj.isInitialized()) {
+                LOG_WARN("QPDF: Could not find the QPDF object of a changed annotation on page " << change.pageIndex);
+                continue;
+            }
+
+            if (change.kind == AnnotationChange::Removed) {
+                for (int i = 0; i < annotsArray.getArrayNItems(); ++i) {
+                    QPDFObjectHandle item = annotsArray.getArrayItem(i);
+                    const bool same = annotObj.isIndirect()
+                        ? item.isIndirect() && item.getObjGen() == annotObj.getObjGen()
+                        : !item.isIndirect() && item.getKey("/Rect").unparse() == annotObj.getKey("/Rect").unparse();
+                    if (same) {
+                        annotsArray.eraseItem(i);
+                        break;
+                    }
+                }
+                changedObjects.push_back(holderOf(annotsArray, pageObj));
+                restructuredPages.insert(change.pageIndex);
+                LOG_DEBUG("QPDF: Removed annotation on page " << change.pageIndex);
+                continue;
+            }
+
+            annotObj.replaceKey("/Rect", rectArray(change.bounds));
+            if (change.contents != PdfDocument::getQpdfAnnotationContents(annotObj)) {
+                annotObj.replaceKey("/Contents", QPDFObjectHandle::newUnicodeString(change.contents.toStdString()));
+            }
+            if (change.color != PdfDocument::getQpdfAnnotationColor(annotObj)) {
+                annotObj.replaceKey("/C", colorArray(change.color));
+            }
+            // Apply other properties like border style, opacity, etc., as needed.
+            changedObjects.push_back(annotObj.isIndirect() ? annotObj : holderOf(annotsArray, pageObj));
+            LOG_DEBUG("QPDF: Modified annotation on page " << change.pageIndex);
+        }
+    }
+
+    // Annotation object on a page, by /NM name if it has one, else by the /Rect it has in the file
+    static QPDFObjectHandle findAnnotation(QHash<int, QHash<QString, QPDFObjGen>>& objects,
+                                           const QPDFObjectHandle& pageObj, int pageIndex,
+                                           const QString& name, const QRectF& bounds) {
+        // PdfAnnotation wraps a Poppler::Annotation, so the link to the QPDF object is made by
+        // identity: the /NM name when the annotation has one, else its /Rect as Poppler reports it.
+        // Object numbers of a page's annotations are collected once, so each later lookup is a
+        // hash probe instead of a walk over /Annots.
+        QPDFObjectHandle annotsArray = pageObj.getKey("/Annots");
+        if (!annotsArray.isArray()) return QPDFObjectHandle();
+
+        auto rectOf = [](const QPDFObjectHandle& annotObj) -> QRectF {
+            QPDFObjectHandle rectObj = annotObj.getKey("/Rect"); // /Rect is an array [l, b, r, t]
+            if (!rectObj.isArray() || rectObj.getArrayNItems() != 4) return QRectF();
+            double l = rectObj.getArrayItem(0).getNumericValue();
+            double b = rectObj.getArrayItem(1).getNumericValue();
+            double r = rectObj.getArrayItem(2).getNumericValue();
+            double t = rectObj.getArrayItem(3).getNumericValue();
+            return QRectF(l, b, r - l, t - b); // Convert PDF rect to QRectF
+        };
+        auto nameOf = [](const QPDFObjectHandle& annotObj) -> QString {
+            QPDFObjectHandle nameObj = annotObj.getKey("/NM");
+            return nameObj.isString() ? QString::fromStdString(nameObj.getUTF8Value()) : QString();
+        };
+
+        auto pageIt = objects.find(pageIndex);
+        if (pageIt == objects.end()) {
+            pageIt = objects.insert(pageIndex, QHash<QString, QPDFObjGen>());
+            for (size_t i = 0; i < annotsArray.getArrayNItems(); ++i) {
+                QPDFObjectHandle annotObj = annotsArray.getArrayItem(i);
+                if (!annotObj.isIndirect() || !annotObj.isDictionary()) continue; // Direct ones have no number to keep
+                const QString name = nameOf(annotObj);
+                if (!name.isEmpty()) pageIt->insert(annotationKey(name, QRectF()), annotObj.getObjGen());
+                const QRectF rect = rectOf(annotObj);
+                if (rect.isValid()) pageIt->insert(annotationKey(QString(), rect), annotObj.getObjGen());
+            }
+        }
+
+        QStringList keys;
+        if (!name.isEmpty()) keys.append(annotationKey(name, QRectF()));
+        keys.append(annotationKey(QString(), bounds));
+        QPDF* qpdf = pageObj.getOwningQPDF();
+        for (const QString& key : keys) {
+            auto objIt = pageIt->constFind(key);
+            if (qpdf && objIt != pageIt->constEnd()) {
+                return qpdf->getObjectByObjGen(objIt.value());
+            }
+        }
+
+        // Direct annotations are not indexed; match them by bounds
+        for (size_t i = 0; i < annotsArray.getArrayNItems(); ++i) {
+            QPDFObjectHandle annotObj = annotsArray.getArrayItem(i);
+            if (!annotObj.isIndirect() && rectOf(annotObj) == bounds) {
+                return annotObj;
+            }
+        }
+        return QPDFObjectHandle(); // Return uninitialized handle if not found    }
+
+    // Wait for every lease to come back, then close all worker handles
+    void closeHandles() {
+        QMutexLocker locker(&handleMutex);
+        while (idleHandles.size() != static_cast<int>(handles.size()) || openingHandles > 0) {
+            handleReleased.wait(&handleMutex);
+        }
+        idleHandles.clear();
+        handles.clear();
+        sourceData.clear();
+        sourceMapping.reset();
+        handlesUnavailable = false;
+    }
+
+    // Map the file so handles share its bytes instead of each reading it.
+    // The mapping is the one DocumentFactory opened, if it is still live.
+    void openSource(const QString& path) {
+        QMutexLocker locker(&handleMutex);
+        sourceMapping = MappedFile::open(path);
+        if (sourceMapping) {
+            sourceData = sourceMapping->bytes();
+        }
+        if (sourceData.isEmpty()) {
+            // Not mappable, or too large for a QByteArray view
+            QFile sourceFile(path);
+            if (!sourceFile.open(QIODevice::ReadOnly) || sourceFile.size() > std::numeric_limits<int>::max()) {
+                LOG_WARN("PdfDocument: Cannot reopen " << path << " for worker handles.");
+                handlesUnavailable = true;
+                return;
+            }
+            sourceData = sourceFile.readAll();
+        }
+    }
+
+    void resetPages(int count) {
+        QMutexLocker locker(&pageMutex);
+        residentPages.clear();
+        residentIndex.clear();
+        pages.clear();
+        pages.resize(count);
+    }
+
+    // Mark a page as just accessed and release the least recently used
+    // ones beyond the limit. Call with pageMutex held.
+    void touchPage(int index) const {
+        auto it = residentIndex.constFind(index);
+        if (it != residentIndex.constEnd()) {
+            residentPages.splice(residentPages.begin(), residentPages, it.value());
+            return;
+        }
+        residentPages.push_front(index);
+        residentIndex.insert(index, residentPages.begin());
+        while (static_cast<int>(residentPages.size()) > residentLimit) {
+            const int victim = residentPages.back();
+            residentPages.pop_back();
+            residentIndex.remove(victim);
+            if (pages[victim]) pages[victim]->releaseResources();
+        }
+    }
+
+    // Open the first-page section of a large linearized file as its own
+    // document. Null if the file is small, not linearized, or the section
+    // cannot be opened without the rest of the file.
+    static Poppler::Document* openFirstPageSection(const QString& path, const QString& password) {
+        if (!Settings::instance().value<bool>("Advanced/PdfStreamingOpen", true)) return nullptr;
+        QFile file(path);
+        const qint64 minSize = Settings::instance().value<int>("Advanced/PdfStreamingMinKB", 16384) * Q_INT64_C(1024);
+        if (!file.open(QIODevice::ReadOnly) || file.size() < minSize) return nullptr;
+
+        // The linearization dictionary must be the first object in the file
+        const QByteArray head = file.read(1024);
+        const int start = head.indexOf("/Linearized");
+        if (start < 0) return nullptr;
+        const int end = head.indexOf(">>", start);
+        if (end < 0) return nullptr;
+        const QString dict = QString::fromLatin1(head.mid(start, end - start));
+        auto number = [&dict](const char* key) -> qint64 {
+            const QRegularExpressionMatch match = QRegularExpression(QStringLiteral("/%1\\s+(\\d+)").arg(QLatin1String(key))).match(dict);
+            return match.hasMatch() ? match.captured(1).toLongLong() : -1;
+        };
+        const qint64 firstPageEnd = number("E");
+        // /L differs from the size once the file was updated incrementally;
+        // the hints no longer describe it then
+        if (number("L") != file.size() || firstPageEnd <= 0 || firstPageEnd >= file.size()) return nullptr;
+
+        file.seek(0);
+        std::unique_ptr<Poppler::Document> preview(
+            Poppler::Document::loadFromData(file.read(firstPageEnd), password.toUtf8(), password.toUtf8()));
+        if (!preview || preview->isLocked() || preview->numPages() < 1) return nullptr;
+        std::unique_ptr<Poppler::Page> firstPage(preview->page(0));
+        if (!firstPage) return nullptr;
+        return preview.release();
+    }
+
     // Helper to get Poppler's Page from index
     Poppler::Page* getPopplerPage(int index) const {
         if (popplerDoc && index >= 0 && index < popplerDoc->numPages()) {
@@ -66,21 +562,107 @@ PdfDocument::PdfDocument(QObject* parent)
 
 PdfDocument::~PdfDocument()
 {
+    d->closeHandles(); // Leases must come back before their documents go
     LOG_INFO("PdfDocument destroyed.");
 }
 
 bool PdfDocument::load(const QString& filePath, const QString& password)
 {
     // Delete old Poppler document if it exists
+    ++d->loadGeneration; // Drops a progressive load still in flight
+    d->progressive = false;
+    {
+        QMutexLocker outlineLocker(&d->outlineMutex);
+        d->outlineLevels.clear();
+    }
     delete d->popplerDoc;
     d->popplerDoc = nullptr;
-    d->pages.clear();
+    d->resetPages(0);
     d->allAnnotations.clear();
     d->formFields.clear();
     d->embeddedFileNames.clear();
-
-    // Load new Poppler document
-    d->popplerDoc = Poppler::Document::load(filePath, password);
+    d->annotationObjects.clear();
+    d->closeHandles();
+    d->previewDoc.reset();
+    d->loadTrace.reset();
+    d->remoteDevice.reset();
+    d->remote.reset();
+    d->password = password;
+
+    std::unique_ptr<LoadTrace> trace(new LoadTrace(filePath, QStringLiteral("PDF")));
+    trace->phase(LoadTrace::Io);
+
+    if (RemoteFile::isRemote(filePath)) {
+        // Poppler reads the trailer, the cross-reference and then only the
+        // objects asked for, each a range request on a cache miss
+        QString error;
+        d->remote = RemoteFile::open(filePath, &error);
+        if (!d->remote) {
+            setLastError(tr("Failed to open %1: %2").arg(filePath, error));
+            LOG_ERROR(lastError());
+            return false;
+        }
+        d->remoteDevice = d->remote->openDevice();
+        trace->phase(LoadTrace::Parse);
+        d->popplerDoc = Poppler::Document::load(d->remoteDevice.get(), password.toUtf8(), password.toUtf8());
+        QMutexLocker locker(&d->handleMutex);
+        d->handlesUnavailable = true;
+    } else if (Poppler::Document* preview = Private::openFirstPageSection(filePath, password)) {
+        // Large linearized files show their first page before the rest is read
+        d->popplerDoc = preview;
+        d->locked = false;
+        d->encrypted = !password.isEmpty();
+        d->popplerDoc->setRenderHint(Poppler::Document::Antialiasing, true);
+        d->popplerDoc->setRenderHint(Poppler::Document::TextAntialiasing, true);
+        setFilePath(filePath);
+        trace->phase(LoadTrace::Metadata);
+        populateMetadata();
+        trace->phase(LoadTrace::Pages);
+        d->resetPages(1);
+        {
+            // Worker handles need the whole file; until then pages render from the preview
+            QMutexLocker locker(&d->handleMutex);
+            d->handlesUnavailable = true;
+        }
+        d->progressive = true;
+        setState(Loading);
+        trace->phase(LoadTrace::Parse); // Runs until the full document arrives
+        d->loadTrace = std::move(trace);
+
+        ReadAhead::instance().prefetch(filePath);
+        const quint64 generation = d->loadGeneration;
+        QPointer<PdfDocument> self(this);
+        ThreadPool::ioInstance().submitDetached([self, generation, filePath, password]() {
+            std::shared_ptr<std::unique_ptr<Poppler::Document>> full =
+                std::make_shared<std::unique_ptr<Poppler::Document>>(Poppler::Document::load(filePath, password.toUtf8(), password.toUtf8()));
+            QString error;
+            if (!*full || (*full)->isLocked()) {
+                full->reset();
+                error = tr("Failed to load the rest of the PDF document.");
+            }
+            // self is only checked on the main thread, where the document is deleted
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [self, generation, full, error]() {
+                if (self) self->completeProgressiveLoad(generation, std::move(*full), error);
+            }, Qt::QueuedConnection);
+        }, Task::Priority::High);
+
+        LOG_INFO("Opened first page of linearized PDF " << filePath << "; loading the rest in the background.");
+        return true;
+    } else {
+        // Load new Poppler document, parsing the mapped bytes rather than
+        // reading the file through Poppler's own stream
+        d->openSource(filePath);
+        trace->phase(LoadTrace::Parse);
+        {
+            QMutexLocker locker(&d->handleMutex);
+            if (!d->sourceData.isEmpty()) {
+                d->popplerDoc = Poppler::Document::loadFromData(d->sourceData, password.toUtf8(), password.toUtf8());
+            }
+        }
+        if (!d->popplerDoc) {
+            d->popplerDoc = Poppler::Document::load(filePath, password);
+        }
+    }
     if (!d->popplerDoc) {
         setLastError(tr("Failed to load PDF document. It may be corrupted or password-protected (and password was incorrect/wrong permissions)."));
         LOG_ERROR(lastError());
@@ -106,19 +688,32 @@ bool PdfDocument::load(const QString& filePath, const QString& password)
         d->encrypted = false;
     }
 
+    d->popplerDoc->setRenderHint(Poppler::Document::Antialiasing, true);
+    d->popplerDoc->setRenderHint(Poppler::Document::TextAntialiasing, true);
+
     // Set file path and update file size
     setFilePath(filePath);
 
     // Populate metadata
+    trace->phase(LoadTrace::Metadata);
     populateMetadata();
 
-    // Create PdfPage wrappers
+    // PdfPage wrappers are created on first access
+    trace->phase(LoadTrace::Pages);
     int numPages = d->popplerDoc->numPages();
-    d->pages.reserve(numPages);
-    for (int i = 0; i < numPages; ++i) {
-        d->pages.append(createPdfPage(i));
-    }
+    d->resetPages(numPages);
+
+    trace->phase(LoadTrace::Extras);
+    populateExtras();
+    trace->finish();
+
+    LOG_INFO("Successfully loaded PDF document: " << filePath << " (" << numPages << " pages)");
+    setState(Loaded);
+    return true;
+}
 
+void PdfDocument::populateExtras()
+{
     // Load annotations, form fields, embedded files
     // This could be done lazily or on demand, but for now, load them all.
     // Annotations: Poppler provides access via Poppler::Page::annotations()
@@ -146,13 +741,72 @@ bool PdfDocument::load(const QString& filePath, const QString& password)
         }
     }
     emit embeddedFilesChanged();
+}
 
-    LOG_INFO("Successfully loaded PDF document: " << filePath << " (" << numPages << " pages)");
+void PdfDocument::completeProgressiveLoad(quint64 generation, std::unique_ptr<Poppler::Document> full, const QString& error)
+{
+    if (generation != d->loadGeneration) return; // A later load() replaced this document
+    d->progressive = false;
+    const std::unique_ptr<LoadTrace> trace = std::move(d->loadTrace);
+
+    if (!full) {
+        // The preview stays usable; only its first page is shown
+        if (trace) trace->finish(false);
+        setLastError(error);
+        LOG_ERROR(error << " " << filePath());
+        setState(Error);
+        emit loadFailed(error);
+        return;
+    }
+
+    full->setRenderHint(Poppler::Document::Antialiasing, true);
+    full->setRenderHint(Poppler::Document::TextAntialiasing, true);
+    d->previewDoc.reset(d->popplerDoc);
+    d->popplerDoc = full.release();
+    {
+        // The preview has only the first page section; its outline may be partial
+        QMutexLocker outlineLocker(&d->outlineMutex);
+        d->outlineLevels.clear();
+    }
+
+    if (trace) trace->phase(LoadTrace::Pages);
+    const int numPages = d->popplerDoc->numPages();
+    {
+        // Existing wrappers reload their page from the full document
+        QMutexLocker locker(&d->pageMutex);
+        for (const std::unique_ptr<PdfPage>& page : d->pages) {
+            if (page) page->releaseResources();
+        }
+        if (numPages >= static_cast<int>(d->pages.size())) {
+            d->pages.resize(numPages);
+        } else {
+            locker.unlock();
+            d->resetPages(numPages);
+        }
+    }
+
+    if (trace) trace->phase(LoadTrace::Io);
+    d->closeHandles();
+    d->openSource(filePath());
+    if (trace) trace->phase(LoadTrace::Metadata);
+    populateMetadata();
+    if (trace) trace->phase(LoadTrace::Extras);
+    populateExtras();
+    if (trace) trace->finish();
+
+    LOG_INFO("Finished progressive load of PDF document: " << filePath() << " (" << numPages << " pages)");
     setState(Loaded);
-    return true;
+    emit pageCountChanged();
+    emit tableOfContentsChanged();
+    emit loaded();
 }
 
 bool PdfDocument::save(const QString& filePath)
+{
+    return save(filePath, SaveMode::Auto);
+}
+
+bool PdfDocument::save(const QString& filePath, SaveMode mode)
 {
     if (!d->popplerDoc) {
         setLastError(tr("No document loaded to save."));
@@ -169,7 +823,6 @@ bool PdfDocument::save(const QString& filePath)
 
      // --- NEW LOGIC: Use QPDF for writing ---
     std::string originalPathStdString = filePath().toStdString(); // Path of the *currently loaded* file
-    std::string targetPathStdString = targetPath.toStdString();   // Path to *save* to
 
     // Check if we have pending modifications to apply
     if (!d->inMemoryStateModified) {
@@ -193,105 +846,16 @@ bool PdfDocument::save(const QString& filePath)
     }
 
     // --- Apply Pending Annotation Changes ---
-    // Get changes from AnnotationManager
-    // This requires AnnotationManager to have a method returning serialized changes for *this* document.
-    // Let's assume it returns a structure like: struct Change { int page_idx; QString id; QString action; QVariantMap props; };
-    // We need to map our QuantilyxDoc annotation objects to PDF annotation objects in the QPDF structure.
-
-    // A more robust way is if PdfAnnotation/PdfPage stored the original QPDF object handle or a way to find it.
-    // For now, let's assume a mapping exists or we find by properties like contents/bounds/name.
-
-    // Example: Iterate through all pages and potentially modified annotations
-    // This is complex because we need to find the *original* annotation in the QPDF structure.
-    // Poppler::Annotation provides its boundary, contents, etc. We can use these as identifiers.
-    // QPDF: Iterate pages
-    std::vector<QPDFObjectHandle> allPages = qpdf->getAllPages();
-    int pageCount = allPages.size();
-
-    // Get *all* annotations for *this* document from AnnotationManager that are marked as modified
-    // This is a key function we need to implement in AnnotationManager.
-    // It should return annotations associated with *this* PdfDocument instance that have isModified() == true.
-    // For this example, let's call a hypothetical method.
-    QList<Annotation*> modifiedAnnotations = AnnotationManager::instance().getModifiedAnnotationsForDocument(this);
-
-    for (Annotation* qAnnot : modifiedAnnotations) {
-        PdfAnnotation* pdfAnnot = dynamic_cast<PdfAnnotation*>(qAnnot);
-        if (pdfAnnot && pdfAnnot->document() == this) { // Ensure it belongs to this doc
-            int pageIndex = pdfAnnot->pageIndex(); // This requires PdfAnnotation to store its page index correctly
-            if (pageIndex >= 0 && pageIndex < pageCount) {
-                QPDFObjectHandle pageObj = allPages[pageIndex];
-                QPDFObjectHandle annotsArray = pageObj.getKey("/Annots");
-
-                if (annotsArray.isArray()) {
-                    bool foundAndModified = false;
-                    // Iterate the /Annots array on this page to find the matching annotation
-                    for (size_t i = 0; i < annotsArray.getArrayNItems(); ++i) {
-                        QPDFObjectHandle annotObj = annotsArray.getArrayItem(i);
-
-                        // Find by a unique identifier if possible (e.g., original contents + bounds combination, or a stored ID)
-                        // Poppler::Annotation *popplerAnnot = pdfAnnot->popplerAnnotation(); // Need to link back
-                        // This is the crux: linking QuantilyxDoc's PdfAnnotation to QPDF's object handle.
-                        // The most reliable way is if PdfAnnotation stored the QPDF handle during creation/loading via Poppler.
-                        // Since we didn't do that initially, matching by properties is less robust but possible for basic types.
-                        // Let's assume PdfAnnotation has a method to get its original Poppler object and we can match by boundary/content.
-                        // OR, we enhance PdfAnnotation to store its QPDF handle when loaded.
-
-                        // For now, let's assume PdfAnnotation has a method getQpdfObjectHandle() that returns the original handle if loaded via a method that captured it.
-                        // This requires modification of PdfAnnotation.
-                        // QPDFObjectHandle originalQpdfHandle = pdfAnnot->getQpdfObjectHandle();
-
-                        // If we can't directly link, we must find by matching properties.
-                        // This is fragile. Let's assume a hypothetical match function exists or is added to PdfAnnotation.
-                        // bool matches = pdfAnnot->matchesQpdfHandle(annotObj); // Hypothetical
-
-                        // Let's try matching by boundary and type as a proxy (still fragile but better than nothing for a demo).
-                        // We need the original boundary from the QPDF object and compare to PdfAnnotation's current state.
-                        // QPDFObjectHandle originalBounds = annotObj.getKey("/Rect"); // Get /Rect from QPDF object
-                        // QRectF qpdfBounds = ...; // Parse QPDFObjectHandle to QRectF
-                        // if (qpdfBounds == pdfAnnot->bounds() && ...) { // Check type etc.
-
-                        // For this example, let's assume we have a way to identify the correct QPDF object handle.
-                        // Let's call a hypothetical method that attempts to find the matching handle based on stored initial state.
-                        QPDFObjectHandle matchingAnnotObj = findQpdfAnnotationHandle(pageObj, pdfAnnot);
-                        if (!matchingAnnotObj.isInitialized() || matchingAnnotObj.getOID() != annotObj.getOID()) {
-                             // If the handles don't match based on our lookup, keep searching.
-                             continue;
-                        }
+    // AnnotationManager journals every add, edit and removal, folded per
+    // annotation, so only the net change since the last save is applied
+    quint64 savedRevision = 0;
+    const QList<AnnotationChange> changes = AnnotationManager::instance().pendingChanges(this, &savedRevision);
+    std::vector<QPDFObjectHandle> changedObjects; // Indirect objects an incremental update must rewrite
+    QSet<int> restructuredPages; // Pages whose /Annots gained or lost entries
 
-                        // Found the matching annotation object in QPDF structure
-                        // Apply changes from PdfAnnotation to the QPDF object handle
-                        // Example: Modify contents
-                        if (pdfAnnot->contents() != getQpdfAnnotationContents(annotObj)) { // Hypothetical getter
-                            LOG_DEBUG("QPDF: Modifying annotation contents on page " << pageIndex);
-                            annotObj.replaceKey("/Contents", QPDFObjectHandle::newUnicodeString(pdfAnnot->contents().toStdU32String()));
-                        }
-                        // Example: Modify color
-                        if (pdfAnnot->color() != getQpdfAnnotationColor(annotObj)) { // Hypothetical getter
-                            LOG_DEBUG("QPDF: Modifying annotation color on page " << pageIndex);
-                            QColor color = pdfAnnot->color();
-                            QPDFObjectHandle colorArray = QPDFObjectHandle::newArray({
-                                QPDFObjectHandle::newReal(color.redF()),
-                                QPDFObjectHandle::newReal(color.greenF()),
-                                QPDFObjectHandle::newReal(color.blueF())
-                            });
-                            annotObj.replaceKey("/C", colorArray);
-                        }
-                        // Apply other properties like border style, opacity, etc., as needed.
-                        foundAndModified = true;
-                        LOG_DEBUG("QPDF: Modified annotation on page " << pageIndex);
-                        break; // Stop searching once found and modified for this specific QuantilyxDoc annotation
-                    }
-                    if (!foundAndModified) {
-                        LOG_WARN("QPDF: Could not find matching QPDF object for modified QuantilyxDoc annotation on page " << pageIndex);
-                    }
-                } else {
-                    LOG_WARN("QPDF: Page " << pageIndex << " has no /Annots array. Cannot modify annotations.");
-                }
-            } else {
-                LOG_WARN("QPDF: Annotation refers to invalid page index: " << pageIndex);
-            }
-        }
-    }
+    Private::applyEdits(*qpdf, Private::captureEdits(changes), d->annotationObjects, changedObjects, restructuredPages);
+    // Object numbers of those pages' annotations are collected again on the next lookup
+    for (int pageIndex : qAsConst(restructuredPages)) d->annotationObjects.remove(pageIndex);
 
     // --- Apply Pending Form Field Changes ---
     // Similar process: get modified form fields, find their QPDF object handles, modify values.
@@ -302,21 +866,55 @@ bool PdfDocument::save(const QString& filePath)
     // QList<PdfFormField*> modifiedFormFields = getModifiedFormFields(); // Hypothetical method
     // for (PdfFormField* field : modifiedFormFields) { ... apply changes ... }
 
+    // --- Append only the changed objects when the file allows it ---
+    const bool sameFile = QFileInfo(targetPath).absoluteFilePath() == QFileInfo(this->filePath()).absoluteFilePath();
+    if (mode == SaveMode::Auto) {
+        mode = sameFile && Settings::instance().value<bool>("Advanced/PdfIncrementalSave", true)
+            ? SaveMode::Incremental : SaveMode::FullRewrite;
+    }
+    if (mode == SaveMode::Incremental) {
+        QString reason;
+        if (writeIncrementalUpdate(*qpdf, changedObjects, targetPath, &reason)) {
+            AnnotationManager::instance().markChangesSaved(this, savedRevision);
+            setFilePath(targetPath);
+            setModified(false);
+            d->inMemoryStateModified = false;
+            LOG_INFO("Saved PDF document incrementally (" << changedObjects.size() << " objects): " << targetPath);
+            return true;
+        }
+        LOG_INFO("PdfDocument: Incremental save not possible (" << reason << "); rewriting " << targetPath);
+    }
+
     // --- Write the modified QPDF object to the target file ---
-    LOG_DEBUG("QPDF: Writing modified file to: " << targetPathStdString);
-    QPDFWriter writer(*qpdf, targetPathStdString.c_str());
-    // Configure writer if needed
-    // writer.set PreserveUnreferencedObjects(true);
-    // writer.setMinimumVersion("1.4"); // Or keep original?
+    // The loaded file is memory-mapped and read lazily by QPDF, so it must
+    // not be truncated in place: write beside it, then replace it by name
+    // (the mapping keeps the old contents alive)
+    const QString writePath = sameFile ? targetPath + QStringLiteral(".part") : targetPath;
+    LOG_DEBUG("QPDF: Writing modified file to: " << writePath);
     try {
+        QPDFWriter writer(*qpdf, writePath.toStdString().c_str());
+        // Configure writer if needed
+        // writer.set PreserveUnreferencedObjects(true);
+        // writer.setMinimumVersion("1.4"); // Or keep original?
         writer.write();
     } catch (const std::exception& e) {
         setLastError(tr("QPDF failed to write file '%1': %2").arg(targetPath).arg(e.what()));
         LOG_ERROR(lastError());
+        if (sameFile) QFile::remove(writePath);
+        return false;
+    }
+    // One rename over the old file, so it is never missing; removing it
+    // first would lose the only copy if the rename then failed
+    if (sameFile && std::rename(QFile::encodeName(writePath).constData(), QFile::encodeName(targetPath).constData()) != 0) {
+        QFile::remove(writePath);
+        setLastError(tr("Failed to replace '%1' with the saved copy.").arg(targetPath));
+        LOG_ERROR(lastError());
         return false;
     }
 
     // --- Update internal state after successful save ---
+    d->annotationObjects.clear(); // The writer renumbers objects
+    AnnotationManager::instance().markChangesSaved(this, savedRevision);
     setFilePath(targetPath);
     setModified(false); // Qt's document modified flag
     d->inMemoryStateModified = false; // Internal QPDF-based modification flag
@@ -324,6 +922,165 @@ bool PdfDocument::save(const QString& filePath)
     return true;
 }
 
+Document::SnapshotWriter PdfDocument::captureSnapshot() const
+{
+    // Unsaved PDF state is the file plus the annotation journal; copying the
+    // journal's values is the whole capture
+    const QList<AnnotationChange> changes = AnnotationManager::instance().pendingChanges(const_cast<PdfDocument*>(this));
+    if (changes.isEmpty()) return Document::captureSnapshot();
+    const QString source = filePath();
+    if (source.isEmpty() || !d->popplerDoc) return SnapshotWriter();
+
+    const QList<Private::AnnotationEdit> edits = Private::captureEdits(changes);
+    return [source, edits](const QString& targetPath, const std::function<bool()>& cancelled) {
+        try {
+            QPDF qpdf;
+            qpdf.processFile(source.toStdString().c_str());
+            if (cancelled()) return false;
+
+            // Object numbers are looked up afresh; the document's cache belongs to its thread
+            QHash<int, QHash<QString, QPDFObjGen>> objects;
+            std::vector<QPDFObjectHandle> changedObjects;
+            QSet<int> restructuredPages;
+            Private::applyEdits(qpdf, edits, objects, changedObjects, restructuredPages);
+            if (cancelled()) return false;
+
+            QPDFWriter writer(qpdf, targetPath.toStdString().c_str());
+            writer.write();
+        } catch (const std::exception& e) {
+            LOG_ERROR("PdfDocument: Failed to write snapshot of " << source << ": " << e.what());
+            return false;
+        }
+        return true;
+    };
+}
+
+bool PdfDocument::writeIncrementalUpdate(QPDF& qpdf, const std::vector<QPDFObjectHandle>& objects,
+                                         const QString& targetPath, QString* reason) const
+{
+    // Objects are written unencrypted and as classic xref entries, so
+    // encrypted files and files indexed by xref streams need the full writer
+    if (qpdf.isEncrypted()) {
+        *reason = QStringLiteral("document is encrypted");
+        return false;
+    }
+
+    QFile source(filePath());
+    if (!source.open(QIODevice::ReadOnly) || source.size() < 32) {
+        *reason = QStringLiteral("cannot read the original file");
+        return false;
+    }
+    const qint64 originalSize = source.size();
+    source.seek(qMax<qint64>(0, originalSize - 1024));
+    const QByteArray tail = source.readAll();
+    const int keyword = tail.lastIndexOf("startxref");
+    if (keyword < 0) {
+        *reason = QStringLiteral("no startxref");
+        return false;
+    }
+    bool ok = false;
+    const qint64 previousXref = tail.mid(keyword + 9).trimmed().split('\n').value(0).trimmed().toLongLong(&ok);
+    if (!ok || previousXref <= 0 || previousXref >= originalSize || !source.seek(previousXref) || !source.read(4).startsWith("xref")) {
+        *reason = QStringLiteral("the last cross-reference section is a stream");
+        return false;
+    }
+    source.close();
+
+    // Serialize every changed object once; streams would need their data re-encoded
+    std::map<int, std::pair<int, std::string>> bodies; // Object ID -> (generation, text)
+    try {
+        for (const QPDFObjectHandle& object : objects) {
+            if (object.isStream()) {
+                *reason = QStringLiteral("a changed object is a stream");
+                return false;
+            }
+            bodies[object.getObjectID()] = std::make_pair(object.getGeneration(), object.unparseResolved());
+        }
+    } catch (const std::exception& e) {
+        *reason = QString::fromLocal8Bit(e.what());
+        return false;
+    }
+
+    // Nothing changed and nowhere else to go; the file already holds the document
+    const bool sameFile = QFileInfo(targetPath).absoluteFilePath() == QFileInfo(filePath()).absoluteFilePath();
+    if (bodies.empty() && sameFile) return true;
+
+    // The update is appended to a copy, which then replaces the target by
+    // name as a full rewrite does, so a failed save leaves the target as it was
+    const QString writePath = targetPath + QStringLiteral(".part");
+    QFile::remove(writePath); // Left by an interrupted save
+    if (!QFile::copy(filePath(), writePath)) {
+        *reason = QStringLiteral("cannot copy the original file");
+        return false;
+    }
+    auto commit = [&]() {
+        if (std::rename(QFile::encodeName(writePath).constData(), QFile::encodeName(targetPath).constData()) != 0) {
+            QFile::remove(writePath);
+            *reason = QStringLiteral("cannot replace the target with the saved copy");
+            return false;
+        }
+        return true;
+    };
+    if (bodies.empty()) return commit();
+
+    QFile target(writePath);
+    if (!target.open(QIODevice::ReadWrite | QIODevice::Append)) {
+        *reason = target.errorString();
+        QFile::remove(writePath);
+        return false;
+    }
+    const qint64 base = target.size();
+
+    QByteArray update("\n");
+    std::map<int, std::pair<int, qint64>> offsets; // Object ID -> (generation, byte offset)
+    for (const auto& body : bodies) {
+        offsets[body.first] = std::make_pair(body.second.first, base + update.size());
+        update += QByteArray::number(body.first) + ' ' + QByteArray::number(body.second.first) + " obj\n";
+        update += QByteArray::fromStdString(body.second.second);
+        update += "\nendobj\n";
+    }
+
+    // One xref subsection per run of consecutive object IDs
+    const qint64 xrefOffset = base + update.size();
+    update += "xref\n";
+    for (auto run = offsets.begin(); run != offsets.end();) {
+        auto next = run;
+        int count = 0;
+        while (next != offsets.end() && next->first == run->first + count) {
+            ++next;
+            ++count;
+        }
+        update += QByteArray::number(run->first) + ' ' + QByteArray::number(count) + '\n';
+        for (; run != next; ++run) {
+            update += QByteArray::number(run->second.second).rightJustified(10, '0') + ' '
+                    + QByteArray::number(run->second.first).rightJustified(5, '0') + " n\r\n";
+        }
+    }
+
+    QPDFObjectHandle trailer = QPDFObjectHandle::newDictionary();
+    const QPDFObjectHandle original = qpdf.getTrailer();
+    for (const char* key : {"/Root", "/Info", "/ID"}) {
+        if (original.hasKey(key)) trailer.replaceKey(key, original.getKey(key));
+    }
+    // Objects made since loading, such as new annotations, take IDs past the old /Size
+    long long size = original.hasKey("/Size") && original.getKey("/Size").isInteger()
+                     ? original.getKey("/Size").getIntValue() : 0;
+    size = std::max<long long>(size, offsets.rbegin()->first + 1);
+    trailer.replaceKey("/Size", QPDFObjectHandle::newInteger(size));
+    trailer.replaceKey("/Prev", QPDFObjectHandle::newInteger(previousXref));
+    update += "trailer\n" + QByteArray::fromStdString(trailer.unparse()) + "\nstartxref\n"
+            + QByteArray::number(xrefOffset) + "\n%%EOF\n";
+
+    if (target.write(update) != update.size() || !target.flush()) {
+        *reason = target.errorString();
+        target.close();
+        QFile::remove(writePath);
+        return false;
+    }
+    target.close();
+    return commit();
+}
+
 Document::DocumentType PdfDocument::type() const
 {
     return DocumentType::PDF;
@@ -331,15 +1088,42 @@ Document::DocumentType PdfDocument::type() const
 
 int PdfDocument::pageCount() const
 {
-    return d->popplerDoc ? d->popplerDoc->numPages() : 0;
+    // Follows the page table, which covers only page 1 during a progressive load
+    QMutexLocker locker(&d->pageMutex);
+    return static_cast<int>(d->pages.size());
 }
 
 Page* PdfDocument::page(int index) const
 {
-    if (index >= 0 && index < d->pages.size()) {
-        return d->pages[index].get(); // Return raw pointer managed by unique_ptr
+    QMutexLocker locker(&d->pageMutex);
+    if (index < 0 || index >= static_cast<int>(d->pages.size())) return nullptr;
+    std::unique_ptr<PdfPage>& page = d->pages[index];
+    if (!page) {
+        page = createPdfPage(index);
+        if (!page) return nullptr;
     }
-    return nullptr;
+    d->touchPage(index);
+    return page.get(); // Return raw pointer managed by unique_ptr
+}
+
+QList<Page*> PdfDocument::loadedPages() const
+{
+    QMutexLocker locker(&d->pageMutex);
+    QList<Page*> pages;
+    for (const std::unique_ptr<PdfPage>& page : d->pages) {
+        if (page) pages.append(page.get());
+    }
+    return pages;
+}
+
+QSizeF PdfDocument::pageSize(int index) const
+{
+    QMutexLocker locker(&d->pageMutex);
+    if (index < 0 || index >= static_cast<int>(d->pages.size())) return QSizeF();
+    if (d->pages[index]) return d->pages[index]->size();
+    // Poppler reads the size from the page dictionary; no PdfPage is built
+    std::unique_ptr<Poppler::Page> popplerPage(d->getPopplerPage(index));
+    return popplerPage ? popplerPage->pageSizeF() : QSizeF();
 }
 
 bool PdfDocument::isLocked() const
@@ -395,6 +1179,163 @@ bool PdfDocument::isLinearized() const
     return d->popplerDoc ? d->popplerDoc->isLinearized() : false;
 }
 
+bool PdfDocument::isLoadingProgressively() const
+{
+    return d->progressive;
+}
+
+PdfDocument::HandleLease PdfDocument::acquireHandle() const
+{
+    QMutexLocker locker(&d->handleMutex);
+    for (;;) {
+        if (!d->idleHandles.isEmpty()) {
+            return HandleLease(this, d->idleHandles.takeLast());
+        }
+        if (d->handlesUnavailable || d->sourceData.isEmpty()) {
+            return HandleLease();
+        }
+        if (static_cast<int>(d->handles.size()) + d->openingHandles < d->maxHandles) {
+            break;
+        }
+        d->handleReleased.wait(&d->handleMutex);
+    }
+
+    // Parse outside the lock; other threads may keep leasing meanwhile
+    ++d->openingHandles;
+    const QByteArray data = d->sourceData;
+    const QByteArray password = d->password.toUtf8();
+    locker.unlock();
+
+    std::unique_ptr<PopplerHandle> handle(new PopplerHandle);
+    handle->document.reset(Poppler::Document::loadFromData(data, password, password));
+    const bool opened = handle->document && !handle->document->isLocked();
+    if (opened) {
+        handle->document->setRenderHint(Poppler::Document::Antialiasing, true);
+        handle->document->setRenderHint(Poppler::Document::TextAntialiasing, true);
+        handle->pages.resize(handle->document->numPages());
+    }
+
+    locker.relock();
+    --d->openingHandles;
+    if (!opened) {
+        LOG_WARN("PdfDocument: Could not open a worker handle for " << filePath() << ".");
+        d->handlesUnavailable = true;
+        d->handleReleased.wakeAll(); // Let waiters see there is nothing to wait for
+        return HandleLease();
+    }
+    PopplerHandle* raw = handle.get();
+    d->handles.push_back(std::move(handle));
+    LOG_DEBUG("PdfDocument: Opened worker handle " << d->handles.size() << " of " << d->maxHandles << " for " << filePath());
+    return HandleLease(this, raw);
+}
+
+void PdfDocument::releaseHandle(PopplerHandle* handle) const
+{
+    QMutexLocker locker(&d->handleMutex);
+    if (static_cast<int>(d->handles.size()) > d->maxHandles) {
+        // The cap was lowered while this handle was leased
+        auto it = std::find_if(d->handles.begin(), d->handles.end(),
+                               [handle](const std::unique_ptr<PopplerHandle>& h) { return h.get() == handle; });
+        if (it != d->handles.end()) {
+            d->handles.erase(it);
+        }
+    } else {
+        d->idleHandles.append(handle);
+    }
+    d->handleReleased.wakeAll();
+}
+
+int PdfDocument::maxHandles() const
+{
+    QMutexLocker locker(&d->handleMutex);
+    return d->maxHandles;
+}
+
+void PdfDocument::setMaxHandles(int count)
+{
+    QMutexLocker locker(&d->handleMutex);
+    d->maxHandles = qMax(1, count);
+    while (static_cast<int>(d->handles.size()) > d->maxHandles && !d->idleHandles.isEmpty()) {
+        PopplerHandle* idle = d->idleHandles.takeLast();
+        auto it = std::find_if(d->handles.begin(), d->handles.end(),
+                               [idle](const std::unique_ptr<PopplerHandle>& h) { return h.get() == idle; });
+        if (it != d->handles.end()) {
+            d->handles.erase(it);
+        }
+    }
+    d->handleReleased.wakeAll(); // A raised cap lets waiters open new handles
+}
+
+int PdfDocument::handleCount() const
+{
+    QMutexLocker locker(&d->handleMutex);
+    return static_cast<int>(d->handles.size());
+}
+
+PdfDocument::HandleLease::HandleLease(HandleLease&& other) noexcept
+    : m_owner(other.m_owner)
+    , m_handle(other.m_handle)
+{
+    other.m_owner = nullptr;
+    other.m_handle = nullptr;
+}
+
+PdfDocument::HandleLease& PdfDocument::HandleLease::operator=(HandleLease&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_owner = other.m_owner;
+        m_handle = other.m_handle;
+        other.m_owner = nullptr;
+        other.m_handle = nullptr;
+    }
+    return *this;
+}
+
+PdfDocument::HandleLease::~HandleLease()
+{
+    release();
+}
+
+void PdfDocument::HandleLease::release()
+{
+    if (m_owner && m_handle) {
+        m_owner->releaseHandle(m_handle);
+    }
+    m_owner = nullptr;
+    m_handle = nullptr;
+}
+
+Poppler::Document* PdfDocument::HandleLease::document() const
+{
+    return m_handle ? m_handle->document.get() : nullptr;
+}
+
+Poppler::Page* PdfDocument::HandleLease::page(int index) const
+{
+    if (!m_handle || index < 0 || index >= static_cast<int>(m_handle->pages.size())) return nullptr;
+    std::unique_ptr<Poppler::Page>& page = m_handle->pages[index];
+    if (!page) {
+        page.reset(m_handle->document->page(index));
+        // Same residency limit as the document's own pages; the lease holder
+        // only uses the page it asked for last
+        m_handle->loadedPages.push_back(index);
+        while (static_cast<int>(m_handle->loadedPages.size()) > m_owner->d->residentLimit) {
+            const int oldest = m_handle->loadedPages.front();
+            m_handle->loadedPages.pop_front();
+            if (oldest != index) m_handle->pages[oldest].reset();
+        }
+    }
+    return page.get();
+}
+
+void PdfDocument::HandleLease::setAntialiasing(bool enabled)
+{
+    if (!m_handle) return;
+    m_handle->document->setRenderHint(Poppler::Document::Antialiasing, enabled);
+    m_handle->document->setRenderHint(Poppler::Document::TextAntialiasing, enabled);
+}
+
 Poppler::Document::PageLayout PdfDocument::pageLayout() const
 {
     return d->popplerDoc ? d->popplerDoc->pageLayout() : Poppler::Document::NoLayout;
@@ -518,6 +1459,72 @@ Poppler::Document* PdfDocument::popplerDocument() const
     return d->popplerDoc;
 }
 
+QByteArray PdfDocument::pageContentDigest(int pageIndex, bool* blank) const
+{
+    if (blank) *blank = false;
+    if (isModified() || pageIndex < 0) return QByteArray();
+    const QString path = filePath();
+    const QDateTime modified = QFileInfo(path).lastModified();
+
+    QMutexLocker locker(&d->digestMutex);
+    if (modified != d->digestFileModified) {
+        // Saved or replaced since; what was read describes the old file
+        d->digestSource.reset();
+        d->digestSourceFailed = false;
+        d->pageDigests.clear();
+        d->digestFileModified = modified;
+    }
+    auto cached = d->pageDigests.constFind(pageIndex);
+    if (cached != d->pageDigests.constEnd()) {
+        if (blank) *blank = cached->blank;
+        return cached->digest;
+    }
+    if (d->digestSourceFailed) return QByteArray();
+
+    if (!d->digestSource) {
+        // Only the xref is read here; objects are parsed as pages reach them
+        try {
+            auto source = std::make_unique<QPDF>();
+            source->setSuppressWarnings(true);
+            source->processFile(path.toStdString().c_str());
+            d->digestSource = std::move(source);
+        } catch (const std::exception& e) {
+            LOG_WARN("PdfDocument: QPDF cannot read " << path << " for page digests: " << e.what());
+            d->digestSourceFailed = true; // Not tried again for every page
+            return QByteArray();
+        }
+    }
+
+    Private::PageDigest result;
+    try {
+        std::vector<QPDFObjectHandle> pages = d->digestSource->getAllPages();
+        if (pageIndex >= int(pages.size())) return QByteArray();
+        QPDFPageObjectHelper page(pages[size_t(pageIndex)]);
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        std::map<QPDFObjGen, int> seen;
+        // Inherited attributes are looked up through the page tree
+        for (const char* key : {"/MediaBox", "/CropBox", "/Rotate", "/Resources", "/UserUnit"}) {
+            hash.addData(key);
+            hashObject(page.getAttribute(key, false), hash, seen, 0);
+        }
+        QPDFObjectHandle pageObject = page.getObjectHandle();
+        for (const char* key : {"/Contents", "/Annots", "/Group"}) {
+            hash.addData(key);
+            hashObject(pageObject.getKey(key), hash, seen, 0);
+        }
+        result.digest = hash.result();
+        const QPDFObjectHandle annotations = pageObject.getKey("/Annots");
+        result.blank = (!annotations.isArray() || annotations.getArrayNItems() == 0) && drawsNothing(page);
+    } catch (const std::exception& e) {
+        LOG_WARN("PdfDocument: Cannot digest page " << pageIndex << " of " << path << ": " << e.what());
+        result = Private::PageDigest(); // Kept empty, so the page is not read again
+    }
+    d->pageDigests.insert(pageIndex, result);
+    if (blank) *blank = result.blank;
+    return result.digest;
+}
+
 QList<PdfFormField*> PdfDocument::formFields() const
 {
     QList<PdfFormField*> ptrList;
@@ -611,29 +1618,9 @@ bool PdfDocument::removeRestrictions()
 
 QList<PdfAnnotation*> PdfDocument::annotationsForPage(int pageIndex) const
 {
-    QList<PdfAnnotation*> annotations;
-    if (pageIndex >= 0 && pageIndex < pageCount()) {
-        Poppler::Page* popplerPage = d->getPopplerPage(pageIndex);
-        if (popplerPage) {
-            auto popplerAnnots = popplerPage->annotations();
-            annotations.reserve(popplerAnnots.size());
-            for (auto* popplerAnnot : popplerAnnots) {
-                // Find or create a PdfAnnotation wrapper for this Poppler annotation
-                // This requires a mapping or a way to get our wrapper from the Poppler object.
-                // For now, assume we create new wrappers on demand or cache them.
-                // A more efficient way is to create wrappers when the page is first accessed
-                // and store them within the PdfPage object or a central map in PdfDocument.
-                // Let's assume PdfPage handles its own annotations for now.
-                // This method might just call page(pageIndex)->annotations() which is already implemented in base Document.
-                // Or, we iterate popplerAnnots and create PdfAnnotation wrappers here.
-                // PdfAnnotation* wrapper = new PdfAnnotation(popplerAnnot); // Need constructor
-                // annotations.append(wrapper);
-                // The ownership and lifecycle of these wrappers need careful management.
-                // It's likely better handled within PdfPage.
-            }
-        }
-    }
-    return annotations;
+    // PdfPage owns the wrappers and keeps them indexed by position
+    PdfPage* pdfPage = static_cast<PdfPage*>(page(pageIndex));
+    return pdfPage ? pdfPage->pdfAnnotations() : QList<PdfAnnotation*>();
 }
 
 bool PdfDocument::addAnnotationToPage(int pageIndex, PdfAnnotation* annotation)
@@ -677,6 +1664,25 @@ QVariantList PdfDocument::tableOfContents() const
     return tocList;
 }
 
+QList<TocEntry> PdfDocument::tableOfContentsChildren(const QVector<int>& path) const
+{
+    QMutexLocker locker(&d->outlineMutex);
+    const QVector<Poppler::OutlineItem> level = d->outlineLevelLocked(path);
+    QList<TocEntry> entries;
+    entries.reserve(level.size());
+    for (const Poppler::OutlineItem& item : level) entries.append(Private::tocEntry(item));
+    return entries;
+}
+
+bool PdfDocument::visitTableOfContents(const std::function<bool(const TocEntry&, const QVector<int>&)>& visitor) const
+{
+    // popplerDoc belongs to the document's thread; the walk reads its own copy
+    HandleLease lease = acquireHandle();
+    if (!lease.isValid()) return false;
+    QVector<int> path;
+    return Private::visitOutline(lease.document()->outline(), path, visitor);
+}
+
 QMap<QString, QVariant> PdfDocument::namedDestinations() const
 {
     QMap<QString, QVariant> destinations;
@@ -743,7 +1749,11 @@ std::unique_ptr<PdfPage> PdfDocument::createPdfPage(int index) const
     // and the given index. It passes the Poppler page object to the PdfPage constructor.
     Poppler::Page* popplerPage = d->getPopplerPage(index);
     if (popplerPage) {
-        return std::make_unique<PdfPage>(this, popplerPage, index);
+        std::unique_ptr<PdfPage> pdfPage = std::make_unique<PdfPage>(this, popplerPage, index);
+        // Pages may be created on a search or render worker; their signal
+        // connections belong with the document's thread
+        pdfPage->moveToThread(thread());
+        return pdfPage;
     }
     return nullptr;
 }
@@ -809,42 +1819,13 @@ QVariantList PdfDocument::convertTocElementToVariantList(const QDomElement& elem
 // Helper to find the QPDF object handle corresponding to a PdfAnnotation within a QPDF page object.
 // This is the critical link. It requires PdfAnnotation to store identifying information from its original load.
 // For now, this is a stub demonstrating the concept.
-QPDFObjectHandle PdfDocument::findQpdfAnnotationHandle(const QPDFObjectHandle& pageObj, PdfAnnotation* pdfAnnot) const {
-    // This function needs the PdfAnnotation to have stored information that can uniquely identify
-    // its corresponding object in the QPDF structure when the PDF was initially loaded *via QPDF*.
-    // Since PdfAnnotation wraps Poppler::Annotation, this link isn't direct.
-    // The *best* way is to load the PDF once with QPDF during PdfDocument::load, store the initial
-    // QPDF object handles for each annotation, and then use Poppler to *read* properties for the UI,
-    // but use the stored QPDF handles for *writing* changes.
-
-    // A less ideal way (but possible with Poppler loading) is to match based on properties like
-    // boundary rectangle, type, and potentially contents (if unique enough). This is fragile.
-    // Example:
-    QPDFObjectHandle annotsArray = pageObj.getKey("/Annots");
-    if (annotsArray.isArray()) {
-        QRectF targetBounds = pdfAnnot->bounds(); // This comes from Poppler::Annotation::boundary()
-        // We would need to iterate and compare /Rect keys in the QPDF objects.
-        for (size_t i = 0; i < annotsArray.getArrayNItems(); ++i) {
-            QPDFObjectHandle annotObj = annotsArray.getArrayItem(i);
-            QPDFObjectHandle rectObj = annotObj.getKey("/Rect"); // /Rect is an array [l, b, r, t]
-            if (rectObj.isArray() && rectObj.getArrayNItems() == 4) {
-                double l = rectObj.getArrayItem(0).getNumericValue();
-                double b = rectObj.getArrayItem(1).getNumericValue();
-                double r = rectObj.getArrayItem(2).getNumericValue();
-                double t = rectObj.getArrayItem(3).getNumericValue();
-                QRectF qpdfBounds(l, b, r - l, t - b); // Convert PDF rect to QRectF
-                if (qpdfBounds == targetBounds) { // Compare boundaries
-                    // Type check might be needed too: annotObj.getKey("/Subtype")
-                    return annotObj; // Found a potential match
-                }
-            }
-        }
-    }
-    return QPDFObjectHandle(); // Return uninitialized handle if not found
+QPDFObjectHandle PdfDocument::findQpdfAnnotationHandle(const QPDFObjectHandle& pageObj, int pageIndex,
+                                                     const QString& name, const QRectF& bounds) const {
+    return Private::findAnnotation(d->annotationObjects, pageObj, pageIndex, name, bounds);
 }
 
 // Helper to get contents from a QPDF annotation object handle (for comparison)
-QString PdfDocument::getQpdfAnnotationContents(const QPDFObjectHandle& annotObj) const {
+QString PdfDocument::getQpdfAnnotationContents(const QPDFObjectHandle& annotObj) {
     QPDFObjectHandle contentsObj = annotObj.getKey("/Contents");
     if (contentsObj.isString()) {
         // Handle both regular and unicode strings if necessary
@@ -858,7 +1839,7 @@ QString PdfDocument::getQpdfAnnotationContents(const QPDFObjectHandle& annotObj)
 }
 
 // Helper to get color from a QPDF annotation object handle (for comparison)
-QColor PdfDocument::getQpdfAnnotationColor(const QPDFObjectHandle& annotObj) const {
+QColor PdfDocument::getQpdfAnnotationColor(const QPDFObjectHandle& annotObj) {
     QPDFObjectHandle colorObj = annotObj.getKey("/C"); // /C key holds color array [r, g, b]
     if (colorObj.isArray() && colorObj.getArrayNItems() == 3) {
         double r = colorObj.getArrayItem(0).getNumericValue();
@@ -15,6 +15,10 @@
 #include <memory>
 #include <QMap>
 #include <QList>
+#include <vector>
+
+class QPDF;
+class QPDFObjectHandle;
 
 namespace QuantilyxDoc {
 
@@ -44,12 +48,41 @@ public:
      */
     ~PdfDocument() override;
 
+    /**
+     * @brief How save() writes the file.
+     */
+    enum class SaveMode {
+        Auto,         ///< Incremental when saving over the loaded file, else full rewrite
+        Incremental,  ///< Append the changed objects and a new xref section
+        FullRewrite   ///< Rewrite the whole file (Save As, optimize)
+    };
+
     // --- Document Interface Implementation ---
     bool load(const QString& filePath, const QString& password = QString()) override;
     bool save(const QString& filePath = QString()) override;
+
+    /**
+     * @brief Save with an explicit write strategy. An incremental update
+     * leaves the original bytes untouched and appends only the changed
+     * objects, so a single annotation edit does not rewrite a large file.
+     * It falls back to a full rewrite for encrypted files, files whose last
+     * cross-reference section is a stream, and changed stream objects.
+     * @param filePath Target path, or empty for the loaded file.
+     * @param mode Write strategy; Auto honours Advanced/PdfIncrementalSave.
+     * @return true on success.
+     */
+    bool save(const QString& filePath, SaveMode mode);
+
+    /**
+     * @brief Capture the file path and the pending annotation changes; the
+     * writer applies them to a fresh read of the file and writes it in full.
+     */
+    SnapshotWriter captureSnapshot() const override;
     DocumentType type() const override;
     int pageCount() const override;
     Page* page(int index) const override;
+    QList<Page*> loadedPages() const override;
+    QSizeF pageSize(int index) const override;
     bool isLocked() const override;
     bool isEncrypted() const override;
     QString formatVersion() const override;
@@ -68,6 +101,18 @@ public:
      */
     bool isLinearized() const;
 
+    /**
+     * @brief Check if a progressive load is still reading the full document.
+     * Large linearized files open from their first-page section, so page 1
+     * is available at once. The rest loads in the background. Until then
+     * pageCount() is 1, and the state is Loading. When the load finishes,
+     * pageCountChanged(), tableOfContentsChanged() and loaded() are emitted.
+     * Streaming is controlled by Advanced/PdfStreamingOpen and
+     * Advanced/PdfStreamingMinKB.
+     * @return true while the background load is pending.
+     */
+    bool isLoadingProgressively() const;
+
     /**
      * @brief Get the page layout mode.
      * @return Page layout mode.
@@ -141,6 +186,100 @@ public:
      */
     Poppler::Document* popplerDocument() const;
 
+    /**
+     * @brief Get a digest of what a page's rendering depends on in the file.
+     * The page's content streams, resources, annotations and boxes are
+     * hashed as stored, so the same page in two files has the same digest.
+     * Read through QPDF on first use and kept per page. Safe to call from
+     * any thread.
+     * @param pageIndex Page index.
+     * @param blank Set if the page's contents draw nothing and it has no annotations; may be null.
+     * @return SHA-1 digest; empty if the file cannot be read or has unsaved changes.
+     */
+    QByteArray pageContentDigest(int pageIndex, bool* blank = nullptr) const;
+
+    struct PopplerHandle;
+
+    /**
+     * @brief Exclusive use of one worker Poppler document.
+     *
+     * Returned by acquireHandle(). The handle goes back to the pool when the
+     * lease is destroyed. Leases must not outlive the PdfDocument.
+     */
+    class HandleLease
+    {
+    public:
+        HandleLease() = default;
+        HandleLease(HandleLease&& other) noexcept;
+        HandleLease& operator=(HandleLease&& other) noexcept;
+        HandleLease(const HandleLease&) = delete;
+        HandleLease& operator=(const HandleLease&) = delete;
+        ~HandleLease();
+
+        /**
+         * @brief Check if the lease holds a handle.
+         * @return True if a handle could be acquired.
+         */
+        bool isValid() const { return m_handle != nullptr; }
+
+        /**
+         * @brief Get the leased Poppler document.
+         * @return Document or nullptr if the lease is empty.
+         */
+        Poppler::Document* document() const;
+
+        /**
+         * @brief Get a page of the leased document, loaded on first use.
+         * @param index Page index.
+         * @return Page or nullptr if the lease is empty or the index is invalid.
+         */
+        Poppler::Page* page(int index) const;
+
+        /**
+         * @brief Turn antialiasing of the leased document on or off.
+         * Safe because no other thread renders with this handle meanwhile.
+         * @param enabled Whether to antialias graphics and text.
+         */
+        void setAntialiasing(bool enabled);
+
+    private:
+        friend class PdfDocument;
+        HandleLease(const PdfDocument* owner, PopplerHandle* handle) : m_owner(owner), m_handle(handle) {}
+        void release();
+
+        const PdfDocument* m_owner = nullptr;
+        PopplerHandle* m_handle = nullptr;
+    };
+
+    /**
+     * @brief Lease a Poppler document for use on the calling thread.
+     * Render and text-extraction workers each take their own handle, opened
+     * lazily from the same file bytes as the main document, so no two
+     * threads ever use one Poppler document at once. Blocks while all
+     * handles are leased and the cap is reached.
+     * @return Lease, empty if no worker handle could be opened.
+     */
+    HandleLease acquireHandle() const;
+
+    /**
+     * @brief Get the maximum number of worker handles for this document.
+     * @return Handle cap.
+     */
+    int maxHandles() const;
+
+    /**
+     * @brief Set the maximum number of worker handles for this document.
+     * Idle handles above the new cap are closed.
+     * @param count New cap, at least 1.
+     */
+    void setMaxHandles(int count);
+
+    /**
+     * @brief Get the number of worker handles currently open.
+     * @return Open handle count.
+     */
+    int handleCount() const;
+
     /**
      * @brief Get the list of all form fields in the document.
      * @return List of form fields.
@@ -216,6 +355,22 @@ public:
      */
     QVariantList tableOfContents() const override;
 
+    /**
+     * @brief Get one level of the outline.
+     * Poppler reads outline items one level at a time, so only the levels
+     * on the way to the one asked for are read; each is kept once read.
+     * @param path Child indexes from the top level down to the parent.
+     * @return Entries of that level.
+     */
+    QList<TocEntry> tableOfContentsChildren(const QVector<int>& path) const override;
+
+    /**
+     * @brief Walk the whole outline on a worker handle of its own.
+     * @param visitor Called with each entry and its path; returns false to stop.
+     * @return false if stopped, or if no worker handle could be opened.
+     */
+    bool visitTableOfContents(const std::function<bool(const TocEntry&, const QVector<int>&)>& visitor) const override;
+
     /**
      * @brief Get the list of named destinations.
      * @return Map of name -> destination.
@@ -255,11 +410,27 @@ private:
     class Private;
     std::unique_ptr<Private> d;
 
+    // Read form fields and embedded file names from the main document
+    void populateExtras();
+
+    // Write the original file plus the changed objects and an xref section
+    // to a .part copy, then rename it over targetPath
+    bool writeIncrementalUpdate(QPDF& qpdf, const std::vector<QPDFObjectHandle>& objects,
+                                const QString& targetPath, QString* reason) const;
+
+    // Swap the full document in for the first-page preview
+    void completeProgressiveLoad(quint64 generation, std::unique_ptr<Poppler::Document> full, const QString& error);
+
+    // Return a leased handle to the pool
+    void releaseHandle(PopplerHandle* handle) const;
+
     // Helper to create PdfPage objects
     std::unique_ptr<PdfPage> createPdfPage(int index) const;
-    QPDFObjectHandle findQpdfAnnotationHandle(const QPDFObjectHandle& pageObj, PdfAnnotation* pdfAnnot) const;
-    QString getQpdfAnnotationContents(const QPDFObjectHandle& annotObj) const;
-    QColor getQpdfAnnotationColor(const QPDFObjectHandle& annotObj) const;
+    // Annotation object on a page, by /NM name if it has one, else by the /Rect it has in the file
+    QPDFObjectHandle findQpdfAnnotationHandle(const QPDFObjectHandle& pageObj, int pageIndex,
+                                              const QString& name, const QRectF& bounds) const;
+    static QString getQpdfAnnotationContents(const QPDFObjectHandle& annotObj);
+    static QColor getQpdfAnnotationColor(const QPDFObjectHandle& annotObj);
 
     // Add a method to mark internal state as modified (called by AnnotationManager or setters)
     void setInMemoryStateModifiedFlag(bool modified);
@@ -11,7 +11,11 @@
 #include "PdfDocument.h"
 #include "PdfAnnotation.h"
 #include "PdfFormField.h"
+#include "../../annotations/AnnotationManager.h"
+#include "../../core/CancellationToken.h"
 #include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Tracing.h"
 #include <poppler-qt5.h>
 #include <QImage>
 #include <QPainter>
@@ -21,30 +25,260 @@
 #include <QList>
 #include <QVariantMap>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <utility>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Polled by Poppler between drawing operations; the payload is the token
+bool shouldAbortRender(const QVariant& payload)
+{
+    return static_cast<const CancellationToken*>(payload.value<void*>())->isCanceled();
+}
+
+// Renders under the calling thread's CancellationToken, so a canceled
+// render stops inside Poppler instead of finishing the page. The image of
+// an aborted render is partial; callers check the token before using it.
+QImage renderAbortable(const Poppler::Page& page, double xres, double yres, int x, int y, int w, int h)
+{
+    const CancellationToken token = CancellationToken::current();
+    if (!token.isCancelable()) return page.renderToImage(xres, yres, x, y, w, h);
+    if (token.isCanceled()) return QImage();
+    return page.renderToImage(xres, yres, x, y, w, h, Poppler::Page::Rotate0, nullptr, nullptr,
+                              shouldAbortRender,
+                              QVariant::fromValue(static_cast<void*>(const_cast<CancellationToken*>(&token))));
+}
+
+} // namespace
+
 class PdfPage::Private {
 public:
-    Private(PdfDocument* doc, Poppler::Page* pPage, int pIndex)
-        : document(doc), popplerPage(pPage), pdfPageIndex(pIndex) {}
+    Private(PdfPage* q_ptr, PdfDocument* doc, Poppler::Page* pPage, int pIndex)
+        : q(q_ptr), document(doc), popplerPage(pPage), pdfPageIndex(pIndex),
+          annotationsLoaded(false), formFieldsLoaded(false), textLastUse(0) {
+        registerMemoryConsumer();
+        QMutexLocker locker(&registryMutex());
+        registry().insert(this);
+    }
 
+    ~Private() {
+        QMutexLocker locker(&registryMutex());
+        registry().remove(this);
+    }
+
+    // One Poppler text box (usually a word) with a box per character. Its
+    // text and boxes are slices of buffers shared by the page's runs, so a
+    // page costs a handful of allocations however many words it has
+    struct TextRun {
+        int textStart = 0;
+        int textLength = 0;
+        int glyphStart = 0; // First of textLength boxes in TextData::glyphs
+        QRectF bounds;
+        bool spaceAfter = false;
+    };
+
+    // Extracted once per page and shared with readers, so a release by
+    // MemoryBudget never pulls the data out from under a search
+    struct TextData {
+        QString pageText;
+        QString runText;        // The text of every run, back to back
+        QVector<QRectF> glyphs; // The character boxes of every run, back to back
+        QVector<TextRun> runs;
+        qint64 bytes = 0;
+
+        QStringRef textOf(const TextRun& run) const { return runText.midRef(run.textStart, run.textLength); }
+    };
+
+    PdfPage* q;
     PdfDocument* document;
-    Poppler::Page* popplerPage;
+    // Shared so a caller keeps the page alive while it is released
+    mutable std::shared_ptr<Poppler::Page> popplerPage;
+    mutable QMutex residencyMutex; // Protects popplerPage
     int pdfPageIndex;
     mutable QList<std::unique_ptr<PdfAnnotation>> annotations; // Annotations for this page
     mutable bool annotationsLoaded; // Flag to avoid reloading
     mutable QList<std::unique_ptr<PdfFormField>> formFields; // Form fields for this page
     mutable bool formFieldsLoaded; // Flag to avoid reloading
+    mutable std::shared_ptr<const TextData> textData; // Survives releaseResources()
+    mutable quint64 textLastUse;
+    mutable QMutex textMutex; // Protects textData and textLastUse
+
+    static std::atomic<quint64>& textClock() {
+        static std::atomic<quint64> clock(0);
+        return clock;
+    }
+
+    // The page's text runs, extracted from Poppler on first use
+    std::shared_ptr<const TextData> text() const {
+        {
+            QMutexLocker locker(&textMutex);
+            if (textData) {
+                textLastUse = ++textClock();
+                return textData;
+            }
+        }
+
+        PdfDocument::HandleLease lease;
+        const std::shared_ptr<Poppler::Page> page = leasePage(lease);
+        if (!page) return nullptr;
+
+        std::shared_ptr<TextData> data = std::make_shared<TextData>();
+        data->pageText = page->text(QRectF()); // A null rect selects the whole page
+        const QList<Poppler::TextBox*> boxes = page->textList();
+        data->runs.reserve(boxes.size());
+        data->runText.reserve(data->pageText.size());
+        data->glyphs.reserve(data->pageText.size());
+        for (Poppler::TextBox* box : boxes) {
+            if (!box) continue;
+            const QString boxText = box->text();
+            TextRun run;
+            run.textStart = data->runText.size();
+            run.textLength = boxText.size();
+            run.glyphStart = data->glyphs.size();
+            run.bounds = box->boundingBox();
+            run.spaceAfter = box->hasSpaceAfter();
+            data->runText += boxText;
+            for (int i = 0; i < boxText.size(); ++i) {
+                data->glyphs.append(box->charBoundingBox(i));
+            }
+            data->runs.append(run);
+        }
+        qDeleteAll(boxes);
+        data->runText.squeeze();
+        data->glyphs.squeeze();
+        data->bytes = sizeof(TextData) + (data->pageText.size() + data->runText.size()) * qint64(sizeof(QChar))
+                    + data->glyphs.size() * qint64(sizeof(QRectF)) + data->runs.size() * qint64(sizeof(TextRun));
+        LOG_DEBUG("Cached " << data->runs.size() << " text runs for PDF page " << pdfPageIndex);
+
+        QMutexLocker locker(&textMutex);
+        if (!textData) textData = std::move(data); // Another thread may have filled it meanwhile
+        textLastUse = ++textClock();
+        return textData;
+    }
+
+    qint64 textBytes() const {
+        QMutexLocker locker(&textMutex);
+        return textData ? textData->bytes : 0;
+    }
+
+    qint64 releaseText() const {
+        QMutexLocker locker(&textMutex);
+        const qint64 freed = textData ? textData->bytes : 0;
+        textData.reset();
+        return freed;
+    }
+
+    // Every live page, so MemoryBudget sees all text caches as one consumer
+    static QMutex& registryMutex() {
+        static QMutex mutex;
+        return mutex;
+    }
+
+    static QSet<Private*>& registry() {
+        static QSet<Private*> pages;
+        return pages;
+    }
+
+    static void registerMemoryConsumer() {
+        static const int consumerId = [] {
+            const int id = MemoryBudget::instance().registerConsumer(
+                "PDF text layout", MemoryBudget::Priority::Normal,
+                []() {
+                    QMutexLocker locker(&registryMutex());
+                    qint64 total = 0;
+                    for (Private* page : registry()) {
+                        total += page->textBytes();
+                    }
+                    return total;
+                },
+                [](qint64 bytes) {
+                    // Least recently searched pages go first
+                    QMutexLocker locker(&registryMutex());
+                    QVector<QPair<quint64, Private*>> candidates;
+                    for (Private* page : registry()) {
+                        QMutexLocker textLocker(&page->textMutex);
+                        if (page->textData) candidates.append(qMakePair(page->textLastUse, page));
+                    }
+                    std::sort(candidates.begin(), candidates.end(),
+                              [](const QPair<quint64, Private*>& a, const QPair<quint64, Private*>& b) { return a.first < b.first; });
+                    qint64 freed = 0;
+                    for (const auto& candidate : candidates) {
+                        if (freed >= bytes) break;
+                        freed += candidate.second->releaseText();
+                    }
+                    return freed;
+                });
+            MemoryBudget::instance().setDocumentAccounting(id,
+                []() {
+                    QMutexLocker locker(&registryMutex());
+                    QHash<quintptr, qint64> usage;
+                    for (Private* page : registry()) {
+                        usage[MemoryBudget::documentId(page->document)] += page->textBytes();
+                    }
+                    return usage;
+                },
+                [](quintptr documentId, qint64 bytes) {
+                    QMutexLocker locker(&registryMutex());
+                    QVector<QPair<quint64, Private*>> candidates;
+                    for (Private* page : registry()) {
+                        if (MemoryBudget::documentId(page->document) != documentId) continue;
+                        QMutexLocker textLocker(&page->textMutex);
+                        if (page->textData) candidates.append(qMakePair(page->textLastUse, page));
+                    }
+                    std::sort(candidates.begin(), candidates.end(),
+                              [](const QPair<quint64, Private*>& a, const QPair<quint64, Private*>& b) { return a.first < b.first; });
+                    qint64 freed = 0;
+                    for (const auto& candidate : candidates) {
+                        if (freed >= bytes) break;
+                        freed += candidate.second->releaseText();
+                    }
+                    return freed;
+                });
+            return id;
+        }();
+        Q_UNUSED(consumerId);
+    }
+
+    // The document's own Poppler page, loaded again after a release
+    std::shared_ptr<Poppler::Page> mainPage() const {
+        QMutexLocker locker(&residencyMutex);
+        if (!popplerPage && document && document->popplerDocument()) {
+            popplerPage.reset(document->popplerDocument()->page(pdfPageIndex));
+        }
+        return popplerPage;
+    }
+
+    // Lease a worker handle and take its copy of this page, so concurrent
+    // renders and text extraction never share a Poppler document. Falls
+    // back to the document's own page if no handle can be opened.
+    std::shared_ptr<Poppler::Page> leasePage(PdfDocument::HandleLease& lease) const {
+        if (document) {
+            lease = document->acquireHandle();
+            if (Poppler::Page* page = lease.page(pdfPageIndex)) {
+                return std::shared_ptr<Poppler::Page>(std::shared_ptr<Poppler::Page>(), page); // Owned by the lease
+            }
+        }
+        return mainPage();
+    }
 
     // Helper to load annotations from Poppler page
     void loadAnnotations() const {
-        if (popplerPage && !annotationsLoaded) {
-            auto popplerAnnots = popplerPage->annotations();
+        if (annotationsLoaded) return;
+        const std::shared_ptr<Poppler::Page> page = mainPage();
+        if (page) {
+            auto popplerAnnots = page->annotations();
             annotations.reserve(popplerAnnots.size());
             for (auto* popplerAnnot : popplerAnnots) {
                 // Create PdfAnnotation wrapper
                 auto annot = std::make_unique<PdfAnnotation>(popplerAnnot, document, pdfPageIndex);
+                indexAnnotation(annot.get());
                 annotations.append(std::move(annot));
             }
             annotationsLoaded = true;
@@ -52,6 +286,19 @@ public:
         }
     }
 
+    // Make an annotation read from the file found by AnnotationManager's hit tests
+    void indexAnnotation(PdfAnnotation* annotation) const {
+        AnnotationManager::instance().indexAnnotation(document, pdfPageIndex, annotation);
+        followBounds(annotation);
+    }
+
+    // Keep AnnotationManager's index and change journal up to date as an annotation is edited
+    void followBounds(PdfAnnotation* annotation) const {
+        QObject::connect(annotation, &PdfAnnotation::propertiesChanged, q, [annotation]() {
+            AnnotationManager::instance().noteAnnotationModified(annotation);
+        });
+    }
+
     // Helper to load form fields from the document that belong to this page
     void loadFormFields() const {
         if (document && !formFieldsLoaded) {
@@ -89,8 +336,15 @@ public:
 
 PdfPage::PdfPage(PdfDocument* document, Poppler::Page* popplerPage, int pageIndex, QObject* parent)
     : Page(document, parent) // Call base Page constructor, passing PdfDocument as Document*
-    , d(new Private(document, popplerPage, pageIndex))
+    , d(new Private(this, document, popplerPage, pageIndex))
 {
+    // AnnotationManager indexes the annotations added through it; moves are passed on
+    connect(&AnnotationManager::instance(), &AnnotationManager::annotationAdded, this,
+            [this](Document* doc, int pageIndex, Annotation* annotation) {
+        if (doc != d->document || pageIndex != d->pdfPageIndex) return;
+        if (PdfAnnotation* pdfAnnot = dynamic_cast<PdfAnnotation*>(annotation)) d->followBounds(pdfAnnot);
+    });
+
     if (popplerPage) {
         // Set base Page properties from Poppler page
         setSize(popplerPage->pageSizeF()); // Size in points
@@ -111,7 +365,10 @@ PdfPage::~PdfPage()
 
 QImage PdfPage::render(int width, int height, int dpi)
 {
-    if (!d->popplerPage) {
+    TRACE_ZONE("PdfPage::render");
+    PdfDocument::HandleLease lease;
+    const std::shared_ptr<Poppler::Page> popplerPage = d->leasePage(lease);
+    if (!popplerPage) {
         LOG_ERROR("Cannot render PdfPage " << d->pdfPageIndex << ": Poppler page is null.");
         return QImage(); // Return null image
     }
@@ -119,14 +376,14 @@ QImage PdfPage::render(int width, int height, int dpi)
     // Calculate scale factors based on target pixel size and page size in points
     // Poppler's renderToImage takes a scale factor (e.g., 72 for 72 DPI).
     // We need to derive the scale from the desired pixel dimensions.
-    QSizeF pageSizePoints = d->popplerPage->pageSizeF();
+    QSizeF pageSizePoints = popplerPage->pageSizeF();
     qreal scaleX = (width > 0) ? (width / pageSizePoints.width()) * (dpi / 72.0) : 1.0;
     qreal scaleY = (height > 0) ? (height / pageSizePoints.height()) * (dpi / 72.0) : 1.0;
     // Use the smaller scale to fit within the bounds, or average/max depending on fit strategy
     qreal scale = qMin(scaleX, scaleY);
 
     // Render using Poppler
-    QImage image = d->popplerPage->renderToImage(scale * 72.0 / dpi, 0, 0, width, height); // Pass calculated DPI-like scale
+    QImage image = renderAbortable(*popplerPage, scale * 72.0 / dpi, 0, 0, width, height, -1); // Pass calculated DPI-like scale
 
     if (image.isNull()) {
         LOG_ERROR("Poppler failed to render page " << d->pdfPageIndex);
@@ -139,62 +396,88 @@ QImage PdfPage::render(int width, int height, int dpi)
     return image;
 }
 
-QString PdfPage::text() const
+QByteArray PdfPage::contentDigest() const
+{
+    return d->document ? d->document->pageContentDigest(d->pdfPageIndex) : QByteArray();
+}
+
+bool PdfPage::isBlank() const
 {
-    if (!d->popplerPage) return QString();
+    bool blank = false;
+    if (d->document) d->document->pageContentDigest(d->pdfPageIndex, &blank);
+    return blank;
+}
 
-    // Use Poppler's text extraction
-    // The coordinates are in PDF's coordinate system (bottom-left origin).
-    // Poppler::Page::text() can take a QRectF to get text from a specific area.
-    // For the whole page, pass an empty rect or the mediaBox.
-    QRectF pageRect = mediaBox(); // Use the full page area
-    QString pageText = d->popplerPage->text(pageRect);
-    LOG_DEBUG("Extracted text from PdfPage " << d->pdfPageIndex << ", length: " << pageText.length());
-    return pageText;
+QString PdfPage::text() const
+{
+    const std::shared_ptr<const Private::TextData> data = d->text();
+    return data ? data->pageText : QString();
 }
 
 QList<QRectF> PdfPage::searchText(const QString& text, bool caseSensitive, bool wholeWords) const
 {
+    Arena arena;
+    ArenaVector<QRectF> hits{ArenaAllocator<QRectF>(&arena)};
+    findText(text, caseSensitive, wholeWords, hits);
     QList<QRectF> results;
-    if (!d->popplerPage || text.isEmpty()) return results;
+    results.reserve(int(hits.size()));
+    for (const QRectF& hit : hits) results.append(hit);
+    return results;
+}
 
-    // Poppler doesn't have a direct "search and return rectangles" function.
-    // We need to get the text layout (character positions) and match manually,
-    // or use Poppler::Page::search() which updates the page object's highlight state
-    // (not ideal for backend searching).
-    // A common approach is to get the text and its bounding boxes using textList or similar.
-    // Poppler::Page::textList() returns a list of text boxes with positions and text.
-    // This is more reliable than trying to match against a single text string and guessing positions.
+void PdfPage::findText(const QString& text, bool caseSensitive, bool wholeWords, ArenaVector<QRectF>& hits) const
+{
+    if (text.isEmpty()) return;
+    const std::shared_ptr<const Private::TextData> data = d->text();
+    if (!data) return;
 
-    auto textBoxes = d->popplerPage->textList(); // Returns QList<Poppler::TextBox*>
+    // Matches within one text run; the match box is the union of its glyph boxes
+    const size_t before = hits.size();
     Qt::CaseSensitivity cs = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    for (const Private::TextRun& run : data->runs) {
+        const QStringRef runText = data->textOf(run);
+        int pos = 0;
+        while ((pos = runText.indexOf(text, pos, cs)) != -1) {
+            const int end = pos + text.length();
+            bool accept = true;
+            if (wholeWords) {
+                // Check if match is at word boundary
+                bool isWordBoundaryBefore = (pos == 0) || runText.at(pos - 1).isSpace();
+                bool isWordBoundaryAfter = (end == runText.length()) || runText.at(end).isSpace();
+                accept = isWordBoundaryBefore && isWordBoundaryAfter;
+            }
+            if (accept) {
+                QRectF box;
+                for (int i = pos; i < end; ++i) box |= data->glyphs.at(run.glyphStart + i);
+                hits.push_back(box);
+            }
+            pos = end; // Move past the current match
+        }
+    }
+    LOG_DEBUG("Searched for text '" << text << "' on PdfPage " << d->pdfPageIndex << ", found " << (hits.size() - before) << " matches.");
+}
 
-    for (auto* textBox : textBoxes) {
-        if (textBox) {
-            QString boxText = textBox->text();
-            // Perform search within this text box
-            int pos = 0;
-            while ((pos = boxText.indexOf(text, pos, cs)) != -1) {
-                // Calculate the approximate rectangle for the found text within the box
-                // This is complex as Poppler::TextBox gives the overall box and character positions.
-                // For simplicity, we'll add the whole box rectangle if it contains the text.
-                // A more accurate implementation would use Poppler::TextBox::charX/charY arrays.
-                if (wholeWords) {
-                    // Check if match is at word boundary
-                    bool isWordBoundaryBefore = (pos == 0) || boxText[pos - 1].isSpace();
-                    bool isWordBoundaryAfter = (pos + text.length() == boxText.length()) || boxText[pos + text.length()].isSpace();
-                    if (isWordBoundaryBefore && isWordBoundaryAfter) {
-                        results.append(textBox->boundingBox()); // Add the box containing the match
-                    }
-                } else {
-                    results.append(textBox->boundingBox()); // Add the box containing the match
-                }
-                pos += text.length(); // Move past the current match
+QString PdfPage::textInRegion(const QRectF& region) const
+{
+    QString result;
+    const std::shared_ptr<const Private::TextData> data = d->text();
+    if (!data || region.isEmpty()) return result;
+
+    const Private::TextRun* previous = nullptr;
+    for (const Private::TextRun& run : data->runs) {
+        if (!region.intersects(run.bounds)) continue;
+        if (previous) {
+            // A run that starts below the previous one begins a new line
+            if (run.bounds.top() >= previous->bounds.bottom()) {
+                result += QLatin1Char('\n');
+            } else if (previous->spaceAfter) {
+                result += QLatin1Char(' ');
             }
         }
+        result += data->textOf(run);
+        previous = &run;
     }
-    LOG_DEBUG("Searched for text '" << text << "' on PdfPage " << d->pdfPageIndex << ", found " << results.size() << " matches.");
-    return results;
+    return result;
 }
 
 QObject* PdfPage::hitTest(const QPointF& position) const
@@ -214,13 +497,23 @@ QObject* PdfPage::hitTest(const QPointF& position) const
     return nullptr;
 }
 
+QList<Annotation*> PdfPage::annotations() const
+{
+    d->loadAnnotations(); // Ensure annotations are loaded, and indexed for hit tests
+    QList<Annotation*> result;
+    result.reserve(d->annotations.size());
+    for (const auto& annot : d->annotations) result.append(annot.get());
+    return result + Page::annotations();
+}
+
 QList<QObject*> PdfPage::links() const
 {
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
     QList<QObject*> linkObjects;
-    if (!d->popplerPage) return linkObjects;
+    if (!popplerPage) return linkObjects;
 
     // Poppler::Page::links() returns QList<Poppler::Link*>
-    auto popplerLinks = d->popplerPage->links();
+    auto popplerLinks = popplerPage->links();
     linkObjects.reserve(popplerLinks.size());
     for (auto* popplerLink : popplerLinks) {
         if (popplerLink) {
@@ -237,12 +530,13 @@ QList<QObject*> PdfPage::links() const
 
 QVariantMap PdfPage::metadata() const
 {
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
     QVariantMap map;
-    if (d->popplerPage) {
+    if (popplerPage) {
         // Populate page-specific metadata
         map["Index"] = d->pdfPageIndex;
-        map["SizePoints"] = d->popplerPage->pageSizeF();
-        map["Rotation"] = d->popplerPage->rotation(); // Poppler::Page::Rotation enum or int?
+        map["SizePoints"] = popplerPage->pageSizeF();
+        map["Rotation"] = popplerPage->rotation(); // Poppler::Page::Rotation enum or int?
         // Add more specific page metadata if available from Poppler
         // map["Label"] = ...; // If page labels are available
     }
@@ -251,7 +545,19 @@ QVariantMap PdfPage::metadata() const
 
 Poppler::Page* PdfPage::popplerPage() const
 {
-    return d->popplerPage;
+    return d->mainPage().get();
+}
+
+void PdfPage::releaseResources()
+{
+    QMutexLocker locker(&d->residencyMutex);
+    d->popplerPage.reset();
+}
+
+bool PdfPage::isResident() const
+{
+    QMutexLocker locker(&d->residencyMutex);
+    return d->popplerPage != nullptr;
 }
 
 QString PdfPage::label() const
@@ -269,22 +575,26 @@ QString PdfPage::label() const
 
 int PdfPage::pdfRotation() const
 {
-    return d->popplerPage ? static_cast<int>(d->popplerPage->rotation()) : 0; // Poppler::Page::Rotation is an enum
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
+    return popplerPage ? static_cast<int>(popplerPage->rotation()) : 0; // Poppler::Page::Rotation is an enum
 }
 
 QRectF PdfPage::cropBox() const
 {
-    return d->popplerPage ? d->popplerPage->cropBox() : QRectF();
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
+    return popplerPage ? popplerPage->cropBox() : QRectF();
 }
 
 QRectF PdfPage::mediaBox() const
 {
-    return d->popplerPage ? d->popplerPage->pageSizeF() : QRectF(); // Media box is often the same as page size in Poppler
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
+    return popplerPage ? popplerPage->pageSizeF() : QRectF(); // Media box is often the same as page size in Poppler
 }
 
 bool PdfPage::hasAnnotations() const
 {
-    if (!d->popplerPage) return false;
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
+    if (!popplerPage) return false;
     d->loadAnnotations(); // Ensure annotations are loaded
     return !d->annotations.isEmpty();
 }
@@ -298,8 +608,9 @@ bool PdfPage::hasFormFields() const
 
 QList<PdfAnnotation*> PdfPage::pdfAnnotations() const
 {
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
     QList<PdfAnnotation*> ptrList;
-    if (!d->popplerPage) return ptrList;
+    if (!popplerPage) return ptrList;
 
     d->loadAnnotations(); // Ensure annotations are loaded
     ptrList.reserve(d->annotations.size());
@@ -325,48 +636,70 @@ QList<PdfFormField*> PdfPage::pdfFormFields() const
 QList<QRectF> PdfPage::textLayout() const
 {
     QList<QRectF> layout;
-    if (!d->popplerPage) return layout;
+    const std::shared_ptr<const Private::TextData> data = d->text();
+    if (!data) return layout;
 
-    auto textBoxes = d->popplerPage->textList();
-    layout.reserve(textBoxes.size());
-    for (auto* textBox : textBoxes) {
-        if (textBox) {
-            layout.append(textBox->boundingBox());
-        }
+    layout.reserve(data->runs.size());
+    for (const Private::TextRun& run : data->runs) {
+        layout.append(run.bounds);
     }
     return layout;
 }
 
-QImage PdfPage::renderRectangle(const QRectF& rect, int width, int height, int dpi) const
+QImage PdfPage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
 {
-    if (!d->popplerPage || rect.isEmpty()) return QImage();
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+    PdfDocument::HandleLease lease;
+    const std::shared_ptr<Poppler::Page> popplerPage = d->leasePage(lease);
+    if (!popplerPage) return QImage();
+
+    // One uniform scale so neighbouring tiles line up exactly
+    qreal scale = qMin(width / rect.width(), height / rect.height());
+    double resolution = 72.0 * scale;
+
+    // Poppler rasterizes only the requested window of the page at this
+    // resolution, so the cost scales with the region and not with the zoom.
+    int offsetX = qRound(rect.left() * scale);
+    int offsetY = qRound(rect.top() * scale);
+    QImage image = renderAbortable(*popplerPage, resolution, resolution, offsetX, offsetY, width, height);
+    if (image.isNull()) {
+        LOG_ERROR("Failed to render rectangle " << rect << " of PdfPage " << d->pdfPageIndex);
+        return QImage();
+    }
+    LOG_DEBUG("Rendered rectangle " << rect << " from PdfPage " << d->pdfPageIndex << " to image size " << image.size());
+    return image;
+}
 
-    // Calculate scale based on target pixel dimensions and source rectangle dimensions
-    qreal scaleX = (width > 0) ? (width / rect.width()) * (dpi / 72.0) : 1.0;
-    qreal scaleY = (height > 0) ? (height / rect.height()) * (dpi / 72.0) : 1.0;
-    qreal scale = qMin(scaleX, scaleY);
+bool PdfPage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QImage PdfPage::renderDraft(const QRectF& rect, int width, int height)
+{
+    if (width <= 0 || height <= 0) return QImage();
+    PdfDocument::HandleLease lease;
+    const std::shared_ptr<Poppler::Page> draftPage = d->leasePage(lease);
+    if (!lease.isValid()) {
+        // The shared page may be rendering elsewhere; its hints stay as they are
+        lease = PdfDocument::HandleLease();
+        return Page::renderDraft(rect, width, height);
+    }
 
-    // Poppler's renderToImage can render a cropped region, but the API is slightly different.
-    // We render the full page scaled and then crop the QImage, or use Poppler's internal cropping.
-    // Poppler::Page::renderToImage(scale, offsetX, offsetY, w, h)
-    // To render *only* the rect, we calculate the offset from the page's origin to the rect's origin.
-    QRectF pageMediaBox = mediaBox(); // Assuming media box origin is (0,0) in PDF space for this calculation
-    int offsetX = qRound((rect.left() - pageMediaBox.left()) * scale * 72.0 / dpi);
-    int offsetY = qRound((pageMediaBox.bottom() - rect.bottom()) * scale * 72.0 / dpi); // PDF Y is inverted compared to image Y
-    int scaledW = qRound(rect.width() * scale * 72.0 / dpi);
-    int scaledH = qRound(rect.height() * scale * 72.0 / dpi);
-
-    QImage fullPageImage = d->popplerPage->renderToImage(scale * 72.0 / dpi);
-    if (fullPageImage.isNull()) return QImage();
-
-    // Crop the full page image to the requested rectangle
-    QRect cropRect(offsetX, offsetY, scaledW, scaledH);
-    if (cropRect.intersects(fullPageImage.rect())) {
-        QImage croppedImage = fullPageImage.copy(cropRect);
-        LOG_DEBUG("Rendered rectangle " << rect << " from PdfPage " << d->pdfPageIndex << " to image size " << croppedImage.size());
-        return croppedImage;
+    QRectF region = rect.isEmpty() ? QRectF(QPointF(0, 0), draftPage->pageSizeF()) : rect;
+    if (region.isEmpty()) return QImage();
+    qreal scale = qMin(width / region.width(), height / region.height());
+    double resolution = 72.0 * scale;
+    lease.setAntialiasing(false); // The handle is ours alone until the lease ends
+    QImage image = renderAbortable(*draftPage, resolution, resolution,
+                                   qRound(region.left() * scale), qRound(region.top() * scale),
+                                   width, height);
+    lease.setAntialiasing(true);
+    if (image.isNull()) {
+        LOG_ERROR("Failed to render draft of PdfPage " << d->pdfPageIndex);
     }
-    return QImage(); // Return null if crop rect is outside the rendered page
+    return image;
 }
 
 QList<QRectF> PdfPage::imageLocations() const
@@ -390,10 +723,11 @@ QStringList PdfPage::fontsUsed() const
 
 QObject* PdfPage::hitTestLink(const QPointF& point) const
 {
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
     // Iterate through Poppler::Link objects and check if the point is inside their rectangle.
-    if (!d->popplerPage) return nullptr;
+    if (!popplerPage) return nullptr;
 
-    auto popplerLinks = d->popplerPage->links();
+    auto popplerLinks = popplerPage->links();
     for (auto* popplerLink : popplerLinks) {
         if (popplerLink && popplerLink->linkArea().contains(point)) { // linkArea() is in PDF coordinates
             // Return a wrapper object for the link, or the Poppler object if castable (it's not QObject)
@@ -407,24 +741,27 @@ QObject* PdfPage::hitTestLink(const QPointF& point) const
 
 QObject* PdfPage::hitTestAnnotation(const QPointF& point) const
 {
-    // Iterate through PdfAnnotation objects and check if the point is inside their rectangle/type-specific area.
-    if (!d->popplerPage) return nullptr;
+    d->loadAnnotations(); // Ensure annotations are loaded
+    // The topmost annotation whose rectangle holds the point, found through the page's grid
+    return AnnotationManager::instance().hitTest(d->document, d->pdfPageIndex, point);
+}
 
+QList<PdfAnnotation*> PdfPage::annotationsInRect(const QRectF& rect) const
+{
     d->loadAnnotations(); // Ensure annotations are loaded
-    for (const auto& pdfAnnot : d->annotations) {
-        if (pdfAnnot && pdfAnnot->bounds().contains(point)) { // Assuming bounds() returns QRectF in PDF coordinates
-            // Return the annotation object itself (it inherits from QObject)
-            return pdfAnnot.get();
-        }
+    QList<PdfAnnotation*> result;
+    for (Annotation* annotation : AnnotationManager::instance().findAnnotationsInRect(d->document, d->pdfPageIndex, rect)) {
+        if (PdfAnnotation* pdfAnnot = dynamic_cast<PdfAnnotation*>(annotation)) result.append(pdfAnnot);
     }
-    return nullptr;
+    return result;
 }
 
 QPointF PdfPage::pdfToPixel(const QPointF& pdfPoint, const QSize& renderSize) const
 {
-    if (!d->popplerPage || renderSize.isEmpty()) return QPointF();
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
+    if (!popplerPage || renderSize.isEmpty()) return QPointF();
 
-    QSizeF pageSizePoints = d->popplerPage->pageSizeF();
+    QSizeF pageSizePoints = popplerPage->pageSizeF();
     qreal scaleX = renderSize.width() / pageSizePoints.width();
     qreal scaleY = renderSize.height() / pageSizePoints.height();
 
@@ -438,9 +775,10 @@ QPointF PdfPage::pdfToPixel(const QPointF& pdfPoint, const QSize& renderSize) co
 
 QPointF PdfPage::pixelToPdf(const QPointF& pixelPoint, const QSize& renderSize) const
 {
-    if (!d->popplerPage || renderSize.isEmpty()) return QPointF();
+    const std::shared_ptr<Poppler::Page> popplerPage = d->mainPage();
+    if (!popplerPage || renderSize.isEmpty()) return QPointF();
 
-    QSizeF pageSizePoints = d->popplerPage->pageSizeF();
+    QSizeF pageSizePoints = popplerPage->pageSizeF();
     qreal scaleX = pageSizePoints.width() / renderSize.width();
     qreal scaleY = pageSizePoints.height() / renderSize.height();
 
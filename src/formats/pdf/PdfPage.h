@@ -35,7 +35,7 @@ public:
     /**
      * @brief Constructor.
      * @param document The parent PdfDocument this page belongs to.
-     * @param popplerPage The underlying Poppler page object.
+     * @param popplerPage The underlying Poppler page object. The page takes ownership.
      * @param pageIndex The 0-based index of this page within the document.
      * @param parent Parent object.
      */
@@ -48,19 +48,41 @@ public:
 
     // --- Page Interface Implementation ---
     QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QImage renderDraft(const QRectF& rect, int width, int height) override;
+    QByteArray contentDigest() const override; // See PdfDocument::pageContentDigest()
+    bool isBlank() const override;
     QString text() const override;
     QList<QRectF> searchText(const QString& text, bool caseSensitive = false, bool wholeWords = false) const override;
+    void findText(const QString& text, bool caseSensitive, bool wholeWords, ArenaVector<QRectF>& hits) const override;
+    QString textInRegion(const QRectF& region) const override;
     QObject* hitTest(const QPointF& position) const override;
+    QList<Annotation*> annotations() const override; // Those read from the file, then those added
     QList<QObject*> links() const override;
     QVariantMap metadata() const override;
 
     // --- PDF-Specific Page Properties ---
     /**
-     * @brief Get the underlying Poppler page object.
+     * @brief Get the underlying Poppler page object, reloading it if it was
+     * released. Valid until the page is next released.
      * @return Poppler page object or nullptr.
      */
     Poppler::Page* popplerPage() const;
 
+    /**
+     * @brief Drop the Poppler page object. The next use loads it again.
+     * Called by PdfDocument when the page leaves its residency window;
+     * calls already using the page keep their reference.
+     */
+    void releaseResources();
+
+    /**
+     * @brief Check if the Poppler page object is loaded.
+     * @return True if loaded.
+     */
+    bool isResident() const;
+
     /**
      * @brief Get the page label (custom page number string).
      * @return Page label or empty string if none.
@@ -111,20 +133,12 @@ public:
 
     /**
      * @brief Get the text layout information for this page.
+     * Text, search and layout queries share one extraction per page, kept
+     * until MemoryBudget asks for it back ("PDF text layout").
      * @return List of QRectF representing text boxes.
      */
     QList<QRectF> textLayout() const;
 
-    /**
-     * @brief Render a specific part of the page (e.g., for thumbnails or annotations).
-     * @param rect The rectangle in PDF coordinates to render.
-     * @param width Target width in pixels for the rendered rectangle.
-     * @param height Target height in pixels for the rendered rectangle.
-     * @param dpi DPI for rendering.
-     * @return Rendered image of the specified rectangle.
-     */
-    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) const;
-
     /**
      * @brief Get the list of images on this page.
      * @return List of image rectangles and potentially metadata.
@@ -151,6 +165,13 @@ public:
      */
     QObject* hitTestAnnotation(const QPointF& point) const;
 
+    /**
+     * @brief Get the annotations whose bounds touch a rectangle.
+     * @param rect Rectangle in PDF coordinates.
+     * @return Annotations in page order.
+     */
+    QList<PdfAnnotation*> annotationsInRect(const QRectF& rect) const;
+
     /**
      * @brief Convert a point from PDF coordinates to pixel coordinates based on the current render size.
      * @param pdfPoint The point in PDF coordinates (1/72 inch).
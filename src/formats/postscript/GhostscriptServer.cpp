@@ -0,0 +1,390 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "GhostscriptServer.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
+#ifdef HAVE_GHOSTSCRIPT
+#include <ghostscript/iapi.h>
+#include <ghostscript/ierrors.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Interpreter output is fed and collected in pieces of this size
+constexpr qint64 ChunkSize = 64 * 1024;
+
+// Messages kept from one render, for the log when it fails
+constexpr int MaxErrorText = 4096;
+
+} // namespace
+
+class GhostscriptServer::Private {
+public:
+    Private(const QString& path, const Layout& fileLayout)
+        : filePath(path), layout(fileLayout), instance(nullptr) {}
+
+    QString filePath;
+    Layout layout;
+    std::shared_ptr<MappedFile> mapping; // The file's bytes, fed to the interpreter
+    QByteArray fileData;                 // Copy of the file when it cannot be mapped
+    void* instance;
+    QMutex mutex;       // One render at a time; protects everything here
+    QByteArray output;  // Device output not yet turned into pixels
+    QByteArray errors;  // Interpreter messages of the pages being rendered
+
+    // Pages arrive as a stream of PPM images, converted row by row so a
+    // long range never holds more than one page of device output
+    PageSink sink;
+    int nextPage = 0;   // Page the next finished image belongs to
+    QImage image;       // Page being received; null until its header is in
+    int rowsDone = 0;
+    bool badOutput = false;
+
+    static int readInput(void*, char*, int) {
+        return 0; // No console input; the program comes through run_string
+    }
+
+    static int writeOutput(void* handle, const char* str, int len) {
+        Private* self = static_cast<Private*>(handle);
+        self->output.append(str, len);
+        self->consumeOutput();
+        return len;
+    }
+
+    static int writeErrors(void* handle, const char* str, int len) {
+        Private* self = static_cast<Private*>(handle);
+        if (self->errors.size() < MaxErrorText) self->errors.append(str, qMin(len, MaxErrorText - self->errors.size()));
+        return len;
+    }
+
+    // Length of a complete "P6 width height 255" header at the start of
+    // data, 0 while it is incomplete, -1 if it is not one
+    static int parseHeader(const char* data, int length, int* width, int* height) {
+        int values[3] = {0, 0, 0};
+        int field = -1; // -1 is the magic number
+        int pos = 0;
+        while (pos < length) {
+            const char c = data[pos];
+            if (c == '#') {
+                while (pos < length && data[pos] != '\n') ++pos;
+                if (pos == length) return 0;
+            } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                ++pos;
+            } else if (field == -1) {
+                if (length < pos + 2) return 0;
+                if (data[pos] != 'P' || data[pos + 1] != '6') return -1;
+                pos += 2;
+                field = 0;
+            } else {
+                if (c < '0' || c > '9') return -1;
+                int value = 0;
+                while (pos < length && data[pos] >= '0' && data[pos] <= '9') {
+                    value = value * 10 + (data[pos] - '0');
+                    if (value > 65535) return -1;
+                    ++pos;
+                }
+                // A number is complete only once the byte after it is in
+                if (pos == length) return 0;
+                values[field++] = value;
+                if (field == 3) {
+                    if (values[2] != 255 || values[0] <= 0 || values[1] <= 0) return -1;
+                    *width = values[0];
+                    *height = values[1];
+                    return pos + 1; // One whitespace byte ends the header
+                }
+            }
+        }
+        return 0;
+    }
+
+    void consumeOutput() {
+        if (badOutput) return;
+        int offset = 0;
+        while (offset < output.size()) {
+            if (image.isNull()) {
+                int width = 0;
+                int height = 0;
+                const int headerLength = parseHeader(output.constData() + offset, output.size() - offset, &width, &height);
+                if (headerLength == 0) break;
+                if (headerLength < 0) {
+                    LOG_ERROR("GhostscriptServer: Unexpected device output from " << filePath);
+                    badOutput = true;
+                    break;
+                }
+                image = ImageBufferPool::instance().acquire(QSize(width, height));
+                if (image.isNull()) {
+                    badOutput = true;
+                    break;
+                }
+                rowsDone = 0;
+                offset += headerLength;
+            }
+
+            // Whole rows only; a partial row waits for the next write
+            const int rowBytes = image.width() * 3;
+            while (rowsDone < image.height() && output.size() - offset >= rowBytes) {
+                const uchar* source = reinterpret_cast<const uchar*>(output.constData() + offset);
+                QRgb* target = reinterpret_cast<QRgb*>(image.scanLine(rowsDone));
+                for (int x = 0; x < image.width(); ++x, source += 3) {
+                    target[x] = qRgb(source[0], source[1], source[2]);
+                }
+                offset += rowBytes;
+                ++rowsDone;
+            }
+            if (rowsDone < image.height()) break;
+
+            QImage finished = std::move(image);
+            image = QImage();
+            if (sink) sink(nextPage, finished);
+            ++nextPage;
+        }
+        output.remove(0, offset);
+    }
+
+    const char* bytes() const {
+        return mapping ? reinterpret_cast<const char*>(mapping->data()) : fileData.constData();
+    }
+
+    qint64 byteCount() const {
+        return mapping ? mapping->size() : fileData.size();
+    }
+
+    // Feed PostScript to the interpreter; false on an interpreter error
+    bool run(const char* data, qint64 length) {
+#ifdef HAVE_GHOSTSCRIPT
+        int exitCode = 0;
+        int code = gsapi_run_string_begin(instance, 0, &exitCode);
+        for (qint64 offset = 0; code >= 0 || code == gs_error_NeedInput; offset += ChunkSize) {
+            if (offset >= length) break;
+            code = gsapi_run_string_continue(instance, data + offset,
+                                             static_cast<unsigned int>(qMin(ChunkSize, length - offset)), 0, &exitCode);
+        }
+        if (code < 0 && code != gs_error_NeedInput) {
+            gsapi_run_string_end(instance, 0, &exitCode);
+            return false;
+        }
+        return gsapi_run_string_end(instance, 0, &exitCode) >= 0;
+#else
+        Q_UNUSED(data);
+        Q_UNUSED(length);
+        return false;
+#endif
+    }
+
+    bool run(const QByteArray& program) {
+        return run(program.constData(), program.size());
+    }
+
+    // Start the interpreter and run the document's prolog and setup
+    bool start() {
+#ifndef HAVE_GHOSTSCRIPT
+        LOG_ERROR("GhostscriptServer: Built without Ghostscript; cannot render " << filePath);
+        return false;
+#else
+        if (byteCount() == 0) {
+            mapping = MappedFile::open(filePath);
+            if (!mapping) {
+                QFile file(filePath);
+                if (file.open(QIODevice::ReadOnly)) fileData = file.readAll();
+            }
+            if (byteCount() == 0) {
+                LOG_ERROR("GhostscriptServer: Cannot read " << filePath);
+                return false;
+            }
+        }
+
+        const int created = gsapi_new_instance(&instance, this);
+        if (created < 0) {
+            LOG_ERROR("GhostscriptServer: Cannot create a Ghostscript instance (" << created << ")");
+            instance = nullptr;
+            return false;
+        }
+        gsapi_set_stdio(instance, &Private::readInput, &Private::writeOutput, &Private::writeErrors);
+        gsapi_set_arg_encoding(instance, GS_ARG_ENCODING_UTF8);
+
+        // Pages are written to stdout as raw PPM; the program's own
+        // output goes to stderr so it never mixes with the image
+        const char* args[] = {
+            "quantilyxdoc", "-q", "-dNOPAUSE", "-dSAFER", "-dNOPROMPT",
+            "-sDEVICE=ppmraw", "-sOutputFile=-", "-sstdout=%stderr",
+            "-dTextAlphaBits=4", "-dGraphicsAlphaBits=4"
+        };
+        const int code = gsapi_init_with_args(instance, static_cast<int>(sizeof(args) / sizeof(args[0])), const_cast<char**>(args));
+        if (code < 0) {
+            LOG_ERROR("GhostscriptServer: Ghostscript failed to start (" << code << "): " << errors);
+            stop();
+            return false;
+        }
+
+        if (layout.hasPages() && !run(bytes(), layout.preambleLength)) {
+            LOG_ERROR("GhostscriptServer: Prolog of " << filePath << " failed: " << errors);
+            stop();
+            return false;
+        }
+        errors.clear();
+        LOG_DEBUG("GhostscriptServer: Interpreter ready for " << filePath);
+        return true;
+#endif
+    }
+
+    void stop() {
+        if (!instance) return;
+#ifdef HAVE_GHOSTSCRIPT
+        gsapi_exit(instance);
+        gsapi_delete_instance(instance);
+#endif
+        instance = nullptr;
+    }
+};
+
+GhostscriptServer::Layout GhostscriptServer::scanLayout(const QByteArray& data)
+{
+    Layout layout;
+    layout.pagesEnd = data.size();
+    static const QRegularExpression bboxRegex(QStringLiteral(R"(^%%BoundingBox:\s*(-?[\d.]+)\s+(-?[\d.]+)\s+(-?[\d.]+)\s+(-?[\d.]+))"));
+
+    int embedded = 0; // Depth of %%BeginDocument sections, whose comments are not ours
+    bool trailerFound = false;
+    int lineStart = 0;
+    while (lineStart < data.size()) {
+        // Lines end in \n, \r\n or a lone \r
+        int lineEnd = lineStart;
+        while (lineEnd < data.size() && data[lineEnd] != '\n' && data[lineEnd] != '\r') ++lineEnd;
+        const int lineLength = lineEnd - lineStart;
+        if (lineLength > 2 && data[lineStart] == '%' && data[lineStart + 1] == '%') {
+            const QByteArray line = QByteArray::fromRawData(data.constData() + lineStart, lineLength);
+            if (line.startsWith("%%BeginDocument")) {
+                ++embedded;
+            } else if (line.startsWith("%%EndDocument")) {
+                embedded = qMax(0, embedded - 1);
+            } else if (embedded == 0 && !trailerFound) {
+                if (line.startsWith("%%Page:")) {
+                    layout.pageStarts.append(lineStart);
+                } else if (line.startsWith("%%Trailer")) {
+                    layout.pagesEnd = lineStart;
+                    trailerFound = true;
+                } else if (line.startsWith("%%BoundingBox:") && layout.pageStarts.isEmpty()) {
+                    const QRegularExpressionMatch match = bboxRegex.match(QString::fromLatin1(line));
+                    if (match.hasMatch()) {
+                        const qreal llx = match.captured(1).toDouble();
+                        const qreal lly = match.captured(2).toDouble();
+                        layout.boundingBox = QRectF(llx, lly, match.captured(3).toDouble() - llx, match.captured(4).toDouble() - lly);
+                    }
+                }
+            }
+        }
+        lineStart = lineEnd + 1;
+        if (lineEnd + 1 < data.size() && data[lineEnd] == '\r' && data[lineEnd + 1] == '\n') ++lineStart;
+    }
+    if (!layout.pageStarts.isEmpty()) layout.preambleLength = layout.pageStarts.first();
+    return layout;
+}
+
+GhostscriptServer::GhostscriptServer(const QString& filePath, const Layout& layout)
+    : d(new Private(filePath, layout))
+{
+}
+
+GhostscriptServer::~GhostscriptServer()
+{
+    shutdown();
+}
+
+bool GhostscriptServer::start()
+{
+    QMutexLocker locker(&d->mutex);
+    return d->instance || d->start();
+}
+
+QImage GhostscriptServer::renderPage(int pageIndex, const QRectF& pageBox, int width, int height)
+{
+    QImage image;
+    renderPages(pageIndex, pageIndex, pageBox, width, height, [&image](int, const QImage& page) { image = page; });
+    if (image.isNull()) {
+        LOG_ERROR("GhostscriptServer: No image produced for page " << pageIndex << " of " << d->filePath);
+    }
+    return image;
+}
+
+bool GhostscriptServer::renderPages(int firstPage, int lastPage, const QRectF& pageBox, int width, int height, const PageSink& sink)
+{
+    if (pageBox.isEmpty() || width <= 0 || height <= 0 || firstPage < 0 || lastPage < firstPage) return false;
+    if (d->layout.hasPages() && lastPage >= d->layout.pageStarts.size()) return false;
+
+    QMutexLocker locker(&d->mutex);
+    if (!d->instance && !d->start()) return false;
+    d->output.clear();
+    d->errors.clear();
+    d->image = QImage();
+    d->badOutput = false;
+    d->sink = sink;
+    d->nextPage = firstPage;
+
+    // Separate x and y resolutions give exactly the requested pixel size
+    const QByteArray begin = QStringLiteral(
+        "/quantilyxsave save def\n"
+        "<< /PageSize [%1 %2] /HWResolution [%3 %4] >> setpagedevice\n"
+        "%5 %6 translate\n")
+        .arg(pageBox.width(), 0, 'f', 3).arg(pageBox.height(), 0, 'f', 3)
+        .arg(width * 72.0 / pageBox.width(), 0, 'f', 4).arg(height * 72.0 / pageBox.height(), 0, 'f', 4)
+        .arg(-pageBox.left(), 0, 'f', 3).arg(-pageBox.top(), 0, 'f', 3)
+        .toLatin1();
+
+    bool ok = d->run(begin);
+    if (ok && d->layout.hasPages()) {
+        // Only these pages' sections run; the prolog is already defined
+        for (int pageIndex = firstPage; ok && pageIndex <= lastPage; ++pageIndex) {
+            d->nextPage = pageIndex;
+            const qint64 start = d->layout.pageStarts[pageIndex];
+            const qint64 end = pageIndex + 1 < d->layout.pageStarts.size() ? d->layout.pageStarts[pageIndex + 1] : d->layout.pagesEnd;
+            ok = d->run(d->bytes() + start, qMin(end, d->byteCount()) - start);
+        }
+    } else if (ok) {
+        // No sections to pick from: run it all and output only the wanted showpages
+        const QByteArray pick = QStringLiteral(
+            "/quantilyxfirst %1 def /quantilyxlast %2 def /quantilyxcount 0 def\n"
+            "/quantilyxshowpage /showpage load def\n"
+            "/showpage { /quantilyxcount quantilyxcount 1 add def\n"
+            "  quantilyxcount quantilyxfirst ge quantilyxcount quantilyxlast le and\n"
+            "  { quantilyxshowpage } { erasepage initgraphics } ifelse } def\n")
+            .arg(firstPage + 1).arg(lastPage + 1).toLatin1();
+        ok = d->run(pick) && d->run(d->bytes(), d->byteCount());
+        // EPS files often never call showpage
+        if (ok) ok = d->run(QByteArrayLiteral("quantilyxcount 0 eq quantilyxfirst 1 eq and { quantilyxshowpage } if\n"));
+    }
+    if (ok) ok = d->run(QByteArrayLiteral("quantilyxsave restore\n"));
+
+    ok = ok && !d->badOutput;
+    d->sink = PageSink();
+    d->output.clear();
+    d->image = QImage();
+    if (!ok) {
+        // The interpreter's state is unknown after an error; start afresh next time
+        LOG_WARN("GhostscriptServer: Pages " << firstPage << "-" << lastPage << " of " << d->filePath << " failed: " << d->errors);
+        d->stop();
+    }
+    return ok;
+}
+
+void GhostscriptServer::shutdown()
+{
+    QMutexLocker locker(&d->mutex);
+    d->stop();
+}
+
+} // namespace QuantilyxDoc
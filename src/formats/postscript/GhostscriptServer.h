@@ -0,0 +1,127 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_GHOSTSCRIPTSERVER_H
+#define QUANTILYX_GHOSTSCRIPTSERVER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief One long-lived Ghostscript interpreter rendering the pages of a document.
+ *
+ * Runs in-process through the gsapi library. For files that follow the
+ * Document Structuring Conventions, the prolog and setup are interpreted
+ * once when the interpreter starts. Each render then only runs the page's
+ * own section, inside save/restore so pages stay independent. Files without
+ * %%Page: comments are run whole for every render, with showpage redefined
+ * so only the wanted page is output. That is still one interpreter, and
+ * never a process spawn.
+ *
+ * Renders are serialized: one interpreter runs one page at a time. After an
+ * error the interpreter is restarted on the next render. Several servers on
+ * the same file can render side by side when the library allows more than
+ * one instance per process.
+ */
+class GhostscriptServer
+{
+public:
+    /**
+     * @brief Where the parts of a DSC-structured file are.
+     */
+    struct Layout {
+        qint64 preambleLength = 0;  ///< Header, prolog and setup: everything before the first page
+        QVector<qint64> pageStarts; ///< Offset of each %%Page: comment
+        qint64 pagesEnd = 0;        ///< Offset of %%Trailer, or the file size
+        QRectF boundingBox;         ///< %%BoundingBox in points, lower-left origin; may be empty
+
+        /**
+         * @brief Check if the file has page sections to run one at a time.
+         * @return True if pages were found.
+         */
+        bool hasPages() const { return !pageStarts.isEmpty(); }
+    };
+
+    /**
+     * @brief Scan a PostScript file's DSC comments for its sections.
+     * Comments inside embedded documents (%%BeginDocument) are skipped.
+     * @param data Whole file contents.
+     * @return Layout; without pages if the file is not DSC-structured.
+     */
+    static Layout scanLayout(const QByteArray& data);
+
+    /**
+     * @brief Constructor. The interpreter starts at the first render.
+     * @param filePath PostScript file to render.
+     * @param layout Sections found by scanLayout().
+     */
+    GhostscriptServer(const QString& filePath, const Layout& layout);
+
+    /**
+     * @brief Receives each page of a range as soon as it is rasterized.
+     * Called on the rendering thread with the 0-based page index.
+     */
+    using PageSink = std::function<void(int pageIndex, const QImage& image)>;
+
+    /**
+     * @brief Destructor. Shuts the interpreter down.
+     */
+    ~GhostscriptServer();
+
+    /**
+     * @brief Render one page. Safe from any thread; renders run one at a time.
+     * @param pageIndex 0-based page.
+     * @param pageBox Page area in points, lower-left origin.
+     * @param width Target width in pixels.
+     * @param height Target height in pixels.
+     * @return Rendered page, or null on failure.
+     */
+    QImage renderPage(int pageIndex, const QRectF& pageBox, int width, int height);
+
+    /**
+     * @brief Render consecutive pages in one pass. Safe from any thread.
+     * Each page goes to the sink as it comes out of the interpreter, in page
+     * order, so the range is never held in memory at once.
+     * @param firstPage First 0-based page.
+     * @param lastPage Last 0-based page, inclusive.
+     * @param pageBox Page area in points, lower-left origin.
+     * @param width Target width in pixels.
+     * @param height Target height in pixels.
+     * @param sink Receives the pages.
+     * @return True if every page was interpreted without error.
+     */
+    bool renderPages(int firstPage, int lastPage, const QRectF& pageBox, int width, int height, const PageSink& sink);
+
+    /**
+     * @brief Start the interpreter now instead of at the first render.
+     * @return True if it runs; false if Ghostscript refused another instance
+     * or the file cannot be read.
+     */
+    bool start();
+
+    /**
+     * @brief Stop the interpreter. The next render starts it again.
+     */
+    void shutdown();
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_GHOSTSCRIPTSERVER_H
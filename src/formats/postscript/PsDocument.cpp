@@ -8,21 +8,43 @@
  * (at your option) any later version.
  */
 #include "PsDocument.h"
-#include "PsPage.h" // Assuming this will be created
+#include "PsPage.h"
+#include "GhostscriptServer.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MappedFile.h"
+#include "../../core/ThreadPool.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QRegularExpression>
 #include <QTextStream>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
 #include <QDebug>
+#include <atomic>
+#include <vector>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// Shared by the chunks of one exportAsImageSequence() call
+struct ExportState {
+    QMutex mutex;
+    QWaitCondition progress; // Woken as pages are saved and chunks finish
+    std::atomic<int> pagesDone{0};
+    std::atomic<bool> failed{false};
+    int chunksLeft = 0;
+};
+
+} // namespace
+
 class PsDocument::Private {
 public:
     Private() : isLoaded(false), psLevelVal(0), isEpsFile(false), pageCountVal(0) {}
-    ~Private() = default; // No specific resources to release here, Ghostscript integration would be elsewhere
+    ~Private() = default;
 
     bool isLoaded;
     int psLevelVal;
@@ -32,6 +54,23 @@ public:
     int pageCountVal;
     QString psCodeContent;
     QList<std::unique_ptr<PsPage>> pages; // Own the page objects
+    GhostscriptServer::Layout layout; // DSC sections, for rendering one page at a time
+    std::unique_ptr<GhostscriptServer> ghostscript; // Started at the first render
+
+    // Find the DSC page sections; the %%Page: comments are a more reliable
+    // count than %%Pages, which is often (atend)
+    void scanLayout(const QString& filePath) {
+        const std::shared_ptr<MappedFile> mapping = MappedFile::open(filePath);
+        QByteArray data = mapping ? mapping->bytes() : QByteArray();
+        if (data.isEmpty()) {
+            QFile psFile(filePath);
+            if (psFile.open(QIODevice::ReadOnly)) data = psFile.readAll();
+        }
+        layout = GhostscriptServer::scanLayout(data);
+        if (layout.hasPages()) pageCountVal = layout.pageStarts.size();
+        if (boundingBox.isEmpty()) boundingBox = layout.boundingBox;
+        LOG_DEBUG("PsDocument: " << layout.pageStarts.size() << " DSC page sections, prolog of " << layout.preambleLength << " bytes");
+    }
 
     // Helper to parse the beginning of the PS file for header info and DSC comments
     bool parseHeader(const QString& filePath) {
@@ -158,7 +197,7 @@ public:
         // A regex might be too simple. Ghostscript is the reliable way.
         int showpageCount = 0;
         int pos = 0;
-        QRegularExpression showpageRegex(R"\bshowpage\b"); // Word boundary to avoid 'nshowpage'
+        QRegularExpression showpageRegex(R"(\bshowpage\b)"); // Word boundary to avoid 'nshowpage'
         QRegularExpressionMatchIterator iter = showpageRegex.globalMatch(content);
         while (iter.hasNext()) {
             QRegularExpressionMatch match = iter.next();
@@ -202,15 +241,23 @@ bool PsDocument::load(const QString& filePath, const QString& password)
     // Reset state
     d->isLoaded = false;
     d->pages.clear();
+    d->ghostscript.reset();
+    d->pageCountVal = 0;
+    d->boundingBox = QRectF();
+
+    LoadTrace trace(filePath, QStringLiteral("PostScript"));
 
     // Parse header and DSC comments
+    trace.phase(LoadTrace::Metadata);
     if (!d->parseHeader(filePath)) {
         setLastError(tr("Failed to parse PostScript header/DSC comments."));
         LOG_ERROR(lastError());
         return false;
     }
 
-    // Count pages
+    // Locate the page sections, then count pages
+    trace.phase(LoadTrace::Parse);
+    d->scanLayout(filePath);
     if (!d->countPages(filePath)) {
         setLastError(tr("Failed to determine page count for PostScript document."));
         LOG_ERROR(lastError());
@@ -221,8 +268,10 @@ bool PsDocument::load(const QString& filePath, const QString& password)
     setFilePath(filePath);
 
     // Create PsPage objects based on estimated page count
-    // Actual rendering will likely require Ghostscript calls per page
+    trace.phase(LoadTrace::Pages);
+    d->ghostscript = std::make_unique<GhostscriptServer>(filePath, d->layout);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -250,16 +299,6 @@ int PsDocument::pageCount() const
     return d->pageCountVal;
 }
 
-Page* PsDocument::page(int index) const
-{
-    if (index >= 0 && index < d->pages.size()) {
-         return d->pages[index].get(); // Placeholder - requires PsPage implementation
-        LOG_DEBUG("PsDocument::page: Requested page " << index << ", but PsPage not yet implemented.");
-        return nullptr; // For now, return null until PsPage is ready
-    }
-    return nullptr;
-}
-
 Page* PsDocument::page(int index) const
 {
     if (index >= 0 && index < d->pages.size()) {
@@ -336,15 +375,112 @@ bool PsDocument::pageHasEpsStructures(int pageIndex) const
     return false; // Placeholder
 }
 
-bool PsDocument::exportAsImageSequence(const QString& outputDirectory, const QString& format, int resolution) const
+bool PsDocument::exportAsImageSequence(const QString& outputDirectory, const QString& format, int resolution)
 {
-    // This would typically involve calling Ghostscript (gs) command line tool for each page.
-    // Example gs command: gs -dNOPAUSE -dBATCH -sDEVICE=tiff24nc -r300 -sOutputFile=output_page_%d.tiff input.ps
-    LOG_WARN("PsDocument::exportAsImageSequence: Requires Ghostscript integration.");
-    Q_UNUSED(outputDirectory);
-    Q_UNUSED(format);
-    Q_UNUSED(resolution);
-    return false; // Placeholder
+    const int total = d->pageCountVal;
+    if (!d->isLoaded || total <= 0 || resolution <= 0 || format.isEmpty()) return false;
+    if (!QDir().mkpath(outputDirectory)) {
+        LOG_ERROR("PsDocument::exportAsImageSequence: Cannot create " << outputDirectory);
+        return false;
+    }
+
+    const QRectF box = pageBox();
+    const int width = qMax(1, qRound(box.width() * resolution / 72.0));
+    const int height = qMax(1, qRound(box.height() * resolution / 72.0));
+    const int digits = qMax(4, QString::number(total).size());
+    const QDir directory(outputDirectory);
+    const QByteArray imageFormat = format.toLatin1();
+    const int dotsPerMeter = qRound(resolution / 0.0254);
+
+    GhostscriptServer* shared = d->ghostscript.get();
+    const QString path = filePath();
+    const GhostscriptServer::Layout layout = d->layout;
+
+    // One interpreter per core, each on a contiguous run of pages so DSC
+    // files only interpret their own sections. Ghostscript builds limited to
+    // one instance per process refuse the second of two probe interpreters;
+    // every page then goes through the document's interpreter in one pass.
+    int chunks = qBound(1, ThreadPool::instance().maxThreadCount(), total);
+    std::vector<std::shared_ptr<GhostscriptServer>> started; // Probes, handed to the first chunks
+    if (chunks > 1) {
+        for (int i = 0; i < 2; ++i) {
+            auto worker = std::make_shared<GhostscriptServer>(path, layout);
+            if (!worker->start()) break;
+            started.push_back(worker);
+        }
+        if (started.size() < 2) {
+            started.clear(); // Frees the one instance for the shared interpreter
+            chunks = 1;
+            LOG_DEBUG("PsDocument: Ghostscript allows one instance; exporting " << path << " in one pass");
+        }
+    }
+    auto state = std::make_shared<ExportState>();
+    state->chunksLeft = chunks;
+
+    auto savePage = [=](int pageIndex, const QImage& page) {
+        if (state->failed.load()) return;
+        QImage image = page;
+        image.setDotsPerMeterX(dotsPerMeter);
+        image.setDotsPerMeterY(dotsPerMeter);
+        const QString path = directory.filePath(QStringLiteral("page_%1.%2").arg(pageIndex + 1, digits, 10, QLatin1Char('0')).arg(format));
+        if (!image.save(path, imageFormat.constData())) {
+            LOG_ERROR("PsDocument::exportAsImageSequence: Cannot write " << path);
+            state->failed = true;
+        }
+        state->pagesDone.fetch_add(1);
+        QMutexLocker locker(&state->mutex);
+        state->progress.wakeAll();
+    };
+
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        const int first = total * chunk / chunks;
+        const int last = total * (chunk + 1) / chunks - 1;
+        std::shared_ptr<GhostscriptServer> prestarted = chunk < int(started.size()) ? started[chunk] : nullptr;
+        auto renderChunk = [=]() {
+            // A worker that cannot start for lack of resources leaves its
+            // chunk to the document's interpreter
+            std::shared_ptr<GhostscriptServer> worker = prestarted;
+            if (chunks > 1 && !worker) {
+                worker = std::make_shared<GhostscriptServer>(path, layout);
+                if (!worker->start()) worker.reset();
+            }
+            GhostscriptServer* server = worker ? worker.get() : shared;
+            if (!server || !server->renderPages(first, last, box, width, height, savePage)) state->failed = true;
+            QMutexLocker locker(&state->mutex);
+            --state->chunksLeft;
+            state->progress.wakeAll();
+        };
+        if (chunks == 1) {
+            renderChunk();
+        } else {
+            ThreadPool::instance().submitDetached(renderChunk, Task::Priority::Low);
+        }
+    }
+    started.clear(); // Each probe now lives as long as its chunk
+
+    // Report from this thread, so the signal reaches its receivers directly
+    int reported = 0;
+    QMutexLocker locker(&state->mutex);
+    for (;;) {
+        const int done = state->pagesDone.load();
+        if (done != reported) {
+            reported = done;
+            locker.unlock();
+            emit exportProgress(done, total);
+            locker.relock();
+        }
+        if (state->chunksLeft == 0 && state->pagesDone.load() == reported) break;
+        state->progress.wait(&state->mutex);
+    }
+    locker.unlock();
+
+    const bool ok = !state->failed.load() && reported == total;
+    if (ok) {
+        LOG_INFO("PsDocument: Exported " << total << " pages of " << path << " to " << outputDirectory << " in " << chunks << " chunks");
+    } else {
+        LOG_ERROR("PsDocument::exportAsImageSequence: Export of " << path << " failed after " << reported << " of " << total << " pages");
+    }
+    return ok;
 }
 
 // --- Helpers ---
@@ -353,11 +489,21 @@ void PsDocument::createPages()
     d->pages.clear();
     d->pages.reserve(d->pageCountVal);
     for (int i = 0; i < d->pageCountVal; ++i) {
-        // Create the page object. This requires PsPage to be implemented.
-        // pages.append(std::make_unique<PsPage>(this, i)); // Placeholder
-        LOG_DEBUG("PsDocument: Planned page " << i);
+        d->pages.append(std::make_unique<PsPage>(this, i));
     }
     LOG_INFO("PsDocument: Created " << d->pages.size() << " page objects.");
 }
 
+QImage PsDocument::renderPage(int pageIndex, int width, int height) const
+{
+    if (!d->ghostscript) return QImage();
+    return d->ghostscript->renderPage(pageIndex, pageBox(), width, height);
+}
+
+QRectF PsDocument::pageBox() const
+{
+    // DSC gives one box for the document; US Letter when it gives none
+    return d->boundingBox.isEmpty() ? QRectF(0, 0, 612, 792) : d->boundingBox;
+}
+
 } // namespace QuantilyxDoc
\ No newline at end of file
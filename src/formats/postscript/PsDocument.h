@@ -14,6 +14,7 @@
 #include <memory>
 #include <QList>
 #include <QDateTime>
+#include <QImage>
 
 namespace QuantilyxDoc {
 
@@ -23,7 +24,8 @@ class PsPage; // Forward declaration
  * @brief PostScript document implementation.
  * 
  * Handles loading and parsing of PostScript (.ps, .eps) files.
- * Rendering typically requires an interpreter like Ghostscript.
+ * Pages are rendered by one Ghostscript interpreter kept for the life of
+ * the document (see GhostscriptServer).
  */
 class PsDocument : public Document
 {
@@ -93,12 +95,15 @@ public:
 
     /**
      * @brief Export the document as a high-quality image sequence.
+     * The pages are split into contiguous chunks rasterized side by side, one
+     * interpreter per chunk, and saved as page_0001.<format> and so on.
+     * Blocks until done; must not be called from a ThreadPool task.
      * @param outputDirectory Directory to save the images.
      * @param format Output image format (e.g., "tiff", "png").
      * @param resolution DPI for rendering.
      * @return True if export was successful.
      */
-    bool exportAsImageSequence(const QString& outputDirectory, const QString& format = "tiff", int resolution = 300) const;
+    bool exportAsImageSequence(const QString& outputDirectory, const QString& format = "tiff", int resolution = 300);
 
 signals:
     /**
@@ -106,10 +111,24 @@ signals:
      */
     void psLoaded();
 
+    /**
+     * @brief Emitted from the exporting thread as pages are saved by exportAsImageSequence().
+     * @param done Pages saved so far.
+     * @param total Pages to export.
+     */
+    void exportProgress(int done, int total);
+
 private:
+    friend class PsPage; // Renders through the document's interpreter
+
     class Private;
     std::unique_ptr<Private> d;
 
+    // Render a page through the interpreter; safe from any thread
+    QImage renderPage(int pageIndex, int width, int height) const;
+    // Page area in points, lower-left origin
+    QRectF pageBox() const;
+
     // Helper to parse the PS file header and DSC comments
     bool parseHeader();
     // Helper to count pages (often involves parsing for showpage commands or DSC pages)
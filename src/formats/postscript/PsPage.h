@@ -15,7 +15,6 @@
 #include <QSizeF>
 #include <QRectF>
 #include <QImage>
-#include <QProcess>
 
 namespace QuantilyxDoc {
 
@@ -25,7 +24,7 @@ class PsDocument;
  * @brief PostScript page implementation.
  * 
  * Represents a single page within a PostScript document.
- * Renders the page using Ghostscript command-line tool.
+ * Renders the page through its document's Ghostscript interpreter.
  */
 class PsPage : public Page
 {
@@ -64,7 +63,7 @@ private:
     class Private;
     std::unique_ptr<Private> d;
 
-    // Helper to render the page using Ghostscript and return QImage
+    // Helper to render the page through the document's interpreter
     QImage renderWithGhostscript(int width, int height, int dpi);
 };
 
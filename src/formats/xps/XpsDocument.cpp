@@ -9,21 +9,50 @@
  */
 #include "XpsDocument.h"
 #include "XpsPage.h"
+#include "XpsFixedPage.h"
+#include "../../core/LoadTrace.h"
 #include "../../core/Logger.h"
+#include "../../core/MemoryBudget.h"
+#include "../../core/Settings.h"
+#include "../../core/ZipArchive.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
 #include <QXmlStreamReader>
-#include <QZipReader> // Requires Qt5::Gui or Qt5::Core (Qt 5.12+)
 #include <QDebug>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// XPS page units are 1/96 inch
+const qreal PointsPerUnit = 72.0 / 96.0;
+
+// US Letter in page units, for pages whose size is announced nowhere
+const QSizeF DefaultPageSize(816, 1056);
+
+} // namespace
+
 class XpsDocument::Private {
 public:
-    Private() : isLoaded(false), pageCountVal(0) {}
+    Private() : isLoaded(false), pageCountVal(0), useClock(0), memoryConsumerId(0) {}
     ~Private() = default;
 
+    // A FixedPage as the FixedDocument lists it
+    struct PageRef {
+        QString part;  // Path of the .fpage part
+        QSizeF size;   // Page units; empty if the PageContent gives none
+    };
+
+    struct ParsedPage {
+        std::shared_ptr<const XpsFixedPage> page;
+        quint64 lastUse = 0;
+    };
+
     bool isLoaded;
     int pageCountVal;
     QString title;
@@ -31,14 +60,50 @@ public:
     QList<QString> keywords;
     bool hasSignatureVal = false;
     QList<std::unique_ptr<XpsPage>> pages;
-    QZipReader zipReader; // Qt's built-in ZIP reader
+    ZipArchive archive;
+    QVector<PageRef> pageRefs;
 
-    // Helper to parse the FixedDocumentSequence.fdseq file to get document structure and page count
+    mutable QMutex parsedMutex; // Protects parsed and useClock
+    QHash<int, ParsedPage> parsed;
+    quint64 useClock;
+    int memoryConsumerId;
+
+    static int parsedPageLimit() {
+        return qMax(1, Settings::instance().value<int>("Advanced/XpsParsedPages", 16));
+    }
+
+    // Drop least recently used pages until at most maxPages remain or
+    // bytes have been freed. Renders in progress keep their own reference.
+    // Caller holds parsedMutex.
+    qint64 trim(int maxPages, qint64 bytes) {
+        qint64 freed = 0;
+        while (!parsed.isEmpty() && (parsed.size() > maxPages || freed < bytes)) {
+            auto oldest = parsed.begin();
+            for (auto it = parsed.begin(); it != parsed.end(); ++it) {
+                if (it->lastUse < oldest->lastUse) oldest = it;
+            }
+            freed += oldest->page->byteCount();
+            parsed.erase(oldest);
+        }
+        return freed;
+    }
+
+    qint64 parsedBytes() const {
+        QMutexLocker locker(&parsedMutex);
+        qint64 total = 0;
+        for (const ParsedPage& entry : parsed) {
+            total += entry.page->byteCount();
+        }
+        return total;
+    }
+
+    // Helper to parse the FixedDocumentSequence.fdseq file to get document structure and page count.
+    // Only the sequence and its FixedDocuments are read; the pages themselves are not opened.
     bool parseFixedDocSequence() {
         // XPS structure: ROOT/_rels/.rels -> FixedDocumentSequence.fdseq -> FixedDocument.fdoc -> FixedPage.fpage
         // Also contains Documents/X/X.fdoc, Pages/X-Y/X-Y.fpage, etc.
 
-        QByteArray fdseqData = zipReader.fileData("_rels/.rels");
+        QByteArray fdseqData = archive.read("_rels/.rels");
         if (fdseqData.isEmpty()) {
             LOG_ERROR("XpsDocument: Could not find _rels/.rels in XPS archive.");
             return false;
@@ -51,8 +116,8 @@ public:
             relsReader.readNext();
             if (relsReader.isStartElement() && relsReader.name() == "Relationship") {
                 QXmlStreamAttributes attrs = relsReader.attributes();
-                if (attrs.value("Type").toString().endsWith("/document") && attrs.value("Target").toString().endsWith(".fdseq")) {
-                    fdseqPath = attrs.value("Target").toString();
+                if (attrs.value("Type").toString().endsWith("/fixedrepresentation") || attrs.value("Target").toString().endsWith(".fdseq")) {
+                    fdseqPath = XpsFixedPage::resolvePart(QString(), attrs.value("Target").toString());
                     break;
                 }
             }
@@ -63,7 +128,7 @@ public:
             return false;
         }
 
-        QByteArray fdseqContent = zipReader.fileData(fdseqPath);
+        QByteArray fdseqContent = archive.read(fdseqPath);
         if (fdseqContent.isEmpty()) {
             LOG_ERROR("XpsDocument: Could not read " << fdseqPath);
             return false;
@@ -78,7 +143,7 @@ public:
                 QXmlStreamAttributes attrs = fdseqReader.attributes();
                 QString fdocPath = attrs.value("Source").toString();
                 if (!fdocPath.isEmpty()) {
-                    fdocPaths.append(fdocPath);
+                    fdocPaths.append(XpsFixedPage::resolvePart(fdseqPath, fdocPath));
                 }
             }
         }
@@ -88,10 +153,10 @@ public:
             return false;
         }
 
-        // Parse each FixedDocument.fdoc to count pages (each PageContent entry is a page)
-        pageCountVal = 0;
+        // Each PageContent entry of a FixedDocument is a page
+        pageRefs.clear();
         for (const QString& fdocPath : fdocPaths) {
-            QByteArray fdocContent = zipReader.fileData(fdocPath);
+            QByteArray fdocContent = archive.read(fdocPath);
             if (fdocContent.isEmpty()) {
                 LOG_WARN("XpsDocument: Could not read " << fdocPath);
                 continue;
@@ -101,17 +166,22 @@ public:
             while (!fdocReader.atEnd()) {
                 fdocReader.readNext();
                 if (fdocReader.isStartElement() && fdocReader.name() == "PageContent") {
-                    pageCountVal++;
+                    QXmlStreamAttributes attrs = fdocReader.attributes();
+                    PageRef ref;
+                    ref.part = XpsFixedPage::resolvePart(fdocPath, attrs.value("Source").toString());
+                    ref.size = QSizeF(attrs.value("Width").toDouble(), attrs.value("Height").toDouble());
+                    pageRefs.append(ref);
                 }
             }
         }
+        pageCountVal = pageRefs.size();
 
         // Parse DocumentMetadata or CoreProperties for title/author if available
         // This is complex and involves parsing OPC (Open Packaging Conventions) properties.
         // For now, skip.
 
         LOG_DEBUG("XpsDocument: Parsed " << fdocPaths.size() << " FixedDocuments with " << pageCountVal << " total pages.");
-        return true;
+        return pageCountVal > 0;
     }
 };
 
@@ -119,11 +189,21 @@ XpsDocument::XpsDocument(QObject* parent)
     : Document(parent)
     , d(new Private())
 {
+    // Parsed pages are rebuilt from the package, so they go before primary caches
+    Private* priv = d.get();
+    d->memoryConsumerId = MemoryBudget::instance().registerDocumentConsumer(
+        "XPS parsed pages", MemoryBudget::Priority::Low, MemoryBudget::documentId(this),
+        [priv]() { return priv->parsedBytes(); },
+        [priv](qint64 bytes) {
+            QMutexLocker locker(&priv->parsedMutex);
+            return priv->trim(0, bytes);
+        });
     LOG_INFO("XpsDocument created.");
 }
 
 XpsDocument::~XpsDocument()
 {
+    MemoryBudget::instance().unregisterConsumer(d->memoryConsumerId);
     LOG_INFO("XpsDocument destroyed.");
 }
 
@@ -132,11 +212,18 @@ bool XpsDocument::load(const QString& filePath, const QString& password)
     Q_UNUSED(password);
     d->isLoaded = false;
     d->pages.clear();
+    {
+        QMutexLocker locker(&d->parsedMutex);
+        d->parsed.clear();
+    }
+
+    LoadTrace trace(filePath, QStringLiteral("XPS"));
+    trace.phase(LoadTrace::Io);
 
-    // Open XPS as ZIP archive using Qt's QZipReader
-    d->zipReader.setFileName(filePath);
-    if (!d->zipReader.exists() || !d->zipReader.isOpen()) {
-        setLastError(tr("Failed to open XPS file as ZIP archive."));
+    // Open XPS as ZIP archive
+    QString error;
+    if (!d->archive.open(filePath, &error)) {
+        setLastError(tr("Failed to open XPS file as ZIP archive: %1").arg(error));
         LOG_ERROR(lastError());
         return false;
     }
@@ -144,6 +231,7 @@ bool XpsDocument::load(const QString& filePath, const QString& password)
     setFilePath(filePath);
 
     // Parse document structure to get page count and metadata
+    trace.phase(LoadTrace::Parse);
     if (!d->parseFixedDocSequence()) {
         setLastError(tr("Failed to parse XPS document structure."));
         LOG_ERROR(lastError());
@@ -151,7 +239,9 @@ bool XpsDocument::load(const QString& filePath, const QString& password)
     }
 
     // Create page objects
+    trace.phase(LoadTrace::Pages);
     createPages();
+    trace.finish();
 
     d->isLoaded = true;
     setState(Loaded);
@@ -181,9 +271,7 @@ int XpsDocument::pageCount() const
 Page* XpsDocument::page(int index) const
 {
     if (index >= 0 && index < d->pages.size()) {
-         // return d->pages[index].get(); // Placeholder
-         LOG_DEBUG("XpsDocument::page: Planned page " << index);
-         return nullptr;
+        return d->pages[index].get();
     }
     return nullptr;
 }
@@ -235,11 +323,54 @@ void XpsDocument::createPages()
 {
     d->pages.clear();
     d->pages.reserve(d->pageCountVal);
+
+    // Pages the FixedDocument gives no size take the last size seen; the
+    // first page is read for one if needed. Parsing corrects them later.
+    QSizeF lastSize;
+    for (const Private::PageRef& ref : d->pageRefs) {
+        if (!ref.size.isEmpty()) {
+            lastSize = ref.size;
+            break;
+        }
+    }
+    if (lastSize.isEmpty() && !d->pageRefs.isEmpty()) lastSize = XpsFixedPage::readSize(d->archive, d->pageRefs.first().part);
+    if (lastSize.isEmpty()) lastSize = DefaultPageSize;
+
     for (int i = 0; i < d->pageCountVal; ++i) {
-        // pages.append(std::make_unique<XpsPage>(this, i)); // Placeholder
-        LOG_DEBUG("XpsDocument: Planned page " << i);
+        if (!d->pageRefs[i].size.isEmpty()) lastSize = d->pageRefs[i].size;
+        d->pages.append(std::make_unique<XpsPage>(this, i, lastSize * PointsPerUnit));
     }
     LOG_INFO("XpsDocument: Created " << d->pages.size() << " page objects.");
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+std::shared_ptr<const XpsFixedPage> XpsDocument::parsedPage(int index) const
+{
+    if (index < 0 || index >= d->pageRefs.size()) return nullptr;
+    {
+        QMutexLocker locker(&d->parsedMutex);
+        auto it = d->parsed.find(index);
+        if (it != d->parsed.end()) {
+            it->lastUse = ++d->useClock;
+            return it->page;
+        }
+    }
+
+    // Parsed without the lock so other pages are not held up; two threads
+    // racing on one page both parse it and the first result is kept
+    std::shared_ptr<const XpsFixedPage> page = XpsFixedPage::parse(d->archive, d->pageRefs[index].part);
+    if (!page) return nullptr;
+
+    QMutexLocker locker(&d->parsedMutex);
+    auto it = d->parsed.find(index);
+    if (it == d->parsed.end()) {
+        Private::ParsedPage entry;
+        entry.page = page;
+        it = d->parsed.insert(index, entry);
+    }
+    it->lastUse = ++d->useClock;
+    page = it->page;
+    d->trim(Private::parsedPageLimit(), 0);
+    return page;
+}
+
+} // namespace QuantilyxDoc
@@ -13,16 +13,21 @@
 #include "../../core/Document.h"
 #include <memory>
 #include <QList>
+#include <QString>
 
 namespace QuantilyxDoc {
 
 class XpsPage; // Forward declaration
+class XpsFixedPage;
 
 /**
  * @brief XPS document implementation.
  * 
  * Handles loading and parsing of XPS (Open XML Paper Specification) files.
  * XPS is Microsoft's fixed-document format, similar to PDF but based on XML and ZIP.
+ * Loading reads only the FixedDocumentSequence and its FixedDocuments; each
+ * FixedPage is parsed the first time it is rendered or searched, into a
+ * bounded cache of parsed pages.
  */
 class XpsDocument : public Document
 {
@@ -53,9 +58,14 @@ signals:
     void xpsLoaded();
 
 private:
+    friend class XpsPage; // Pages parse through the document's cache
+
     class Private;
     std::unique_ptr<Private> d;
 
+    // Parse a page, or find it parsed; safe from any thread
+    std::shared_ptr<const XpsFixedPage> parsedPage(int index) const;
+
     void createPages();
 };
 
@@ -0,0 +1,487 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "XpsFixedPage.h"
+#include "../../core/Logger.h"
+#include "../../core/ZipArchive.h"
+#include <QColor>
+#include <QFileInfo>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QPainterPath>
+#include <QStringList>
+#include <QTransform>
+#include <QXmlStreamReader>
+#include <cmath>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Glyphs are drawn at this pixel size and scaled to their em size, since
+// QFont sizes are whole pixels and XPS em sizes are not
+const int ReferenceFontPixels = 100;
+
+QTransform parseMatrix(const QString& text)
+{
+    const QStringList parts = text.split(QLatin1Char(','), QString::SkipEmptyParts);
+    if (parts.size() != 6) return QTransform();
+    return QTransform(parts[0].toDouble(), parts[1].toDouble(), parts[2].toDouble(),
+                      parts[3].toDouble(), parts[4].toDouble(), parts[5].toDouble());
+}
+
+QRectF parseRect(const QString& text)
+{
+    const QStringList parts = text.split(QLatin1Char(','), QString::SkipEmptyParts);
+    if (parts.size() != 4) return QRectF();
+    return QRectF(parts[0].toDouble(), parts[1].toDouble(), parts[2].toDouble(), parts[3].toDouble());
+}
+
+// #RRGGBB, #AARRGGBB, or scRGB as sc#[A,]R,G,B in linear 0..1
+QColor parseColor(const QString& text)
+{
+    const QString value = text.trimmed();
+    if (value.startsWith(QLatin1String("sc#"))) {
+        const QStringList parts = value.mid(3).split(QLatin1Char(','), QString::SkipEmptyParts);
+        if (parts.size() != 3 && parts.size() != 4) return QColor();
+        const int offset = parts.size() - 3;
+        auto channel = [](const QString& linear) {
+            return qBound(0.0, std::pow(qBound(0.0, linear.toDouble(), 1.0), 1.0 / 2.2), 1.0);
+        };
+        QColor color;
+        color.setRgbF(channel(parts[offset]), channel(parts[offset + 1]), channel(parts[offset + 2]),
+                      offset ? qBound(0.0, parts[0].toDouble(), 1.0) : 1.0);
+        return color;
+    }
+    return QColor(value); // Qt reads #AARRGGBB as XAML writes it
+}
+
+// Abbreviated geometry syntax, as in Path Data and PathGeometry Figures
+class GeometryParser
+{
+public:
+    explicit GeometryParser(const QString& data) : text(data), pos(0) {}
+
+    QPainterPath parse() {
+        QPainterPath path;
+        QChar command;
+        QPointF current;
+        QPointF lastControl;
+        bool haveControl = false;
+        while (skipSeparators()) {
+            if (text[pos].isLetter()) {
+                command = text[pos++];
+            } else if (command.isNull()) {
+                break; // Numbers before any command
+            }
+            const bool relative = command.isLower();
+            const QPointF base = relative ? current : QPointF();
+            switch (command.toUpper().unicode()) {
+            case 'F':
+                path.setFillRule(number() == 1 ? Qt::WindingFill : Qt::OddEvenFill);
+                command = QChar();
+                break;
+            case 'M':
+                current = base + point();
+                path.moveTo(current);
+                command = relative ? QChar('l') : QChar('L'); // Further pairs are line segments
+                haveControl = false;
+                break;
+            case 'L':
+                current = base + point();
+                path.lineTo(current);
+                haveControl = false;
+                break;
+            case 'H':
+                current.setX((relative ? current.x() : 0) + number());
+                path.lineTo(current);
+                haveControl = false;
+                break;
+            case 'V':
+                current.setY((relative ? current.y() : 0) + number());
+                path.lineTo(current);
+                haveControl = false;
+                break;
+            case 'C': {
+                const QPointF c1 = base + point();
+                const QPointF c2 = base + point();
+                current = base + point();
+                path.cubicTo(c1, c2, current);
+                lastControl = c2;
+                haveControl = true;
+                break;
+            }
+            case 'S': {
+                const QPointF c1 = haveControl ? current * 2 - lastControl : current;
+                const QPointF c2 = base + point();
+                current = base + point();
+                path.cubicTo(c1, c2, current);
+                lastControl = c2;
+                haveControl = true;
+                break;
+            }
+            case 'Q': {
+                const QPointF c = base + point();
+                current = base + point();
+                path.quadTo(c, current);
+                haveControl = false;
+                break;
+            }
+            case 'A': {
+                // Elliptical arcs are drawn as their chord
+                number(); number(); number(); number(); number();
+                current = base + point();
+                path.lineTo(current);
+                haveControl = false;
+                break;
+            }
+            case 'Z':
+                path.closeSubpath();
+                current = path.currentPosition();
+                command = QChar();
+                haveControl = false;
+                break;
+            default:
+                return path; // Unknown command: keep what was understood
+            }
+        }
+        return path;
+    }
+
+private:
+    bool skipSeparators() {
+        while (pos < text.size() && (text[pos].isSpace() || text[pos] == QLatin1Char(','))) ++pos;
+        return pos < text.size();
+    }
+
+    double number() {
+        skipSeparators();
+        const int start = pos;
+        if (pos < text.size() && (text[pos] == QLatin1Char('-') || text[pos] == QLatin1Char('+'))) ++pos;
+        while (pos < text.size() && (text[pos].isDigit() || text[pos] == QLatin1Char('.'))) ++pos;
+        if (pos < text.size() && (text[pos] == QLatin1Char('e') || text[pos] == QLatin1Char('E'))) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == QLatin1Char('-') || text[pos] == QLatin1Char('+'))) ++pos;
+            while (pos < text.size() && text[pos].isDigit()) ++pos;
+        }
+        if (pos == start) {
+            ++pos; // Skip what cannot be read rather than loop on it
+            return 0;
+        }
+        return text.midRef(start, pos - start).toDouble();
+    }
+
+    QPointF point() {
+        const double x = number();
+        return QPointF(x, number());
+    }
+
+    const QString& text;
+    int pos;
+};
+
+} // namespace
+
+// Interprets one FixedPage into an XpsFixedPage
+class XpsPageParser
+{
+public:
+    XpsPageParser(const ZipArchive& packageArchive, const QString& part, XpsFixedPage* target)
+        : archive(packageArchive), partPath(part), page(target) {}
+
+    bool run(const QByteArray& xaml) {
+        reader.addData(xaml);
+        while (!reader.atEnd()) {
+            reader.readNext();
+            if (!reader.isStartElement()) continue;
+            if (reader.name() != QLatin1String("FixedPage")) return false;
+            page->pageSize = QSizeF(reader.attributes().value(QLatin1String("Width")).toDouble(),
+                                    reader.attributes().value(QLatin1String("Height")).toDouble());
+            painter.begin(&page->drawing);
+            painter.setRenderHint(QPainter::Antialiasing, true);
+            painter.setRenderHint(QPainter::TextAntialiasing, true);
+            painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+            parseChildren();
+            painter.end();
+            break;
+        }
+        if (reader.hasError() && reader.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+            LOG_WARN("XpsFixedPage: " << partPath << " is malformed: " << reader.errorString());
+        }
+        return !page->pageSize.isEmpty();
+    }
+
+private:
+    struct Brush {
+        QColor color;        // Solid colour, when valid
+        QImage image;        // Image brush, when not null
+        QRectF viewbox;      // Source area of the image, in 1/96 inch of the image
+        QRectF viewport;     // Where that area lands, in page units
+        bool isSet() const { return color.isValid() || !image.isNull(); }
+    };
+
+    const ZipArchive& archive;
+    QString partPath;
+    XpsFixedPage* page;
+    QXmlStreamReader reader;
+    QPainter painter;
+    QHash<QString, QImage> images; // Resources used more than once on the page
+
+    // Elements inside the current one, until its end tag
+    void parseChildren() {
+        while (reader.readNextStartElement()) {
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("Canvas")) parseCanvas();
+            else if (name == QLatin1String("Path")) parsePath();
+            else if (name == QLatin1String("Glyphs")) parseGlyphs();
+            else reader.skipCurrentElement();
+        }
+    }
+
+    void applyCommon(const QXmlStreamAttributes& attributes) {
+        const QStringRef transform = attributes.value(QLatin1String("RenderTransform"));
+        if (!transform.isEmpty() && !transform.startsWith(QLatin1Char('{'))) {
+            painter.setTransform(parseMatrix(transform.toString()), true);
+        }
+        const QStringRef opacity = attributes.value(QLatin1String("Opacity"));
+        if (!opacity.isEmpty()) painter.setOpacity(painter.opacity() * qBound(0.0, opacity.toDouble(), 1.0));
+    }
+
+    // <X.RenderTransform><MatrixTransform Matrix="..."/></X.RenderTransform>
+    QTransform readTransformProperty() {
+        QTransform transform;
+        while (reader.readNextStartElement()) {
+            if (reader.name() == QLatin1String("MatrixTransform")) {
+                transform = parseMatrix(reader.attributes().value(QLatin1String("Matrix")).toString());
+            }
+            reader.skipCurrentElement();
+        }
+        return transform;
+    }
+
+    void parseCanvas() {
+        painter.save();
+        applyCommon(reader.attributes());
+        while (reader.readNextStartElement()) {
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("Canvas.RenderTransform")) painter.setTransform(readTransformProperty(), true);
+            else if (name == QLatin1String("Canvas")) parseCanvas();
+            else if (name == QLatin1String("Path")) parsePath();
+            else if (name == QLatin1String("Glyphs")) parseGlyphs();
+            else reader.skipCurrentElement();
+        }
+        painter.restore();
+    }
+
+    QImage loadImage(const QString& reference) {
+        const QString path = XpsFixedPage::resolvePart(partPath, reference);
+        auto it = images.constFind(path);
+        if (it != images.constEnd()) return it.value();
+        QImage image;
+        if (!image.loadFromData(archive.read(path))) {
+            LOG_WARN("XpsFixedPage: Cannot decode image " << path);
+        }
+        images.insert(path, image);
+        return image;
+    }
+
+    // <X.Fill> or <X.Stroke> holding one brush element
+    Brush readBrushProperty() {
+        Brush brush;
+        while (reader.readNextStartElement()) {
+            const QXmlStreamAttributes attributes = reader.attributes();
+            if (reader.name() == QLatin1String("SolidColorBrush")) {
+                brush.color = parseColor(attributes.value(QLatin1String("Color")).toString());
+                const QStringRef opacity = attributes.value(QLatin1String("Opacity"));
+                if (brush.color.isValid() && !opacity.isEmpty()) brush.color.setAlphaF(brush.color.alphaF() * qBound(0.0, opacity.toDouble(), 1.0));
+            } else if (reader.name() == QLatin1String("ImageBrush")) {
+                brush.image = loadImage(attributes.value(QLatin1String("ImageSource")).toString());
+                brush.viewbox = parseRect(attributes.value(QLatin1String("Viewbox")).toString());
+                brush.viewport = parseRect(attributes.value(QLatin1String("Viewport")).toString());
+            }
+            reader.skipCurrentElement();
+        }
+        return brush;
+    }
+
+    // <Path.Data><PathGeometry Figures="..."> or with PathFigure children
+    QPainterPath readGeometryProperty() {
+        QPainterPath path;
+        while (reader.readNextStartElement()) {
+            if (reader.name() != QLatin1String("PathGeometry")) {
+                reader.skipCurrentElement();
+                continue;
+            }
+            const QXmlStreamAttributes attributes = reader.attributes();
+            const QStringRef figures = attributes.value(QLatin1String("Figures"));
+            if (!figures.isEmpty()) path = GeometryParser(figures.toString()).parse();
+            if (attributes.value(QLatin1String("FillRule")) == QLatin1String("NonZero")) path.setFillRule(Qt::WindingFill);
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("PathFigure")) readFigure(&path);
+                else reader.skipCurrentElement();
+            }
+        }
+        return path;
+    }
+
+    void readFigure(QPainterPath* path) {
+        const QXmlStreamAttributes figure = reader.attributes();
+        QString figures = QLatin1String("M ") + figure.value(QLatin1String("StartPoint")).toString();
+        while (reader.readNextStartElement()) {
+            const QXmlStreamAttributes segment = reader.attributes();
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("PolyLineSegment")) {
+                figures += QLatin1String(" L ") + segment.value(QLatin1String("Points")).toString();
+            } else if (name == QLatin1String("PolyBezierSegment")) {
+                figures += QLatin1String(" C ") + segment.value(QLatin1String("Points")).toString();
+            } else if (name == QLatin1String("PolyQuadraticBezierSegment")) {
+                figures += QLatin1String(" Q ") + segment.value(QLatin1String("Points")).toString();
+            } else if (name == QLatin1String("ArcSegment")) {
+                figures += QLatin1String(" L ") + segment.value(QLatin1String("Point")).toString();
+            }
+            reader.skipCurrentElement();
+        }
+        if (figure.value(QLatin1String("IsClosed")) == QLatin1String("true")) figures += QLatin1String(" Z");
+        path->addPath(GeometryParser(figures).parse());
+    }
+
+    void fill(const QPainterPath& path, const Brush& brush) {
+        if (brush.color.isValid()) {
+            painter.fillPath(path, brush.color);
+            return;
+        }
+        if (brush.image.isNull() || brush.viewport.isEmpty()) return;
+        // Viewbox is in 1/96 inch of the image; without one the whole image is used
+        const qreal dpiX = brush.image.dotsPerMeterX() > 0 ? brush.image.dotsPerMeterX() * 0.0254 : 96.0;
+        const qreal dpiY = brush.image.dotsPerMeterY() > 0 ? brush.image.dotsPerMeterY() * 0.0254 : 96.0;
+        const QRectF source = brush.viewbox.isEmpty()
+            ? QRectF(brush.image.rect())
+            : QRectF(brush.viewbox.x() * dpiX / 96.0, brush.viewbox.y() * dpiY / 96.0,
+                     brush.viewbox.width() * dpiX / 96.0, brush.viewbox.height() * dpiY / 96.0);
+        painter.save();
+        painter.setClipPath(path, Qt::IntersectClip);
+        painter.drawImage(brush.viewport, brush.image, source);
+        painter.restore();
+    }
+
+    void parsePath() {
+        const QXmlStreamAttributes attributes = reader.attributes();
+        painter.save();
+        applyCommon(attributes);
+        QPainterPath path = GeometryParser(attributes.value(QLatin1String("Data")).toString()).parse();
+        Brush fillBrush;
+        fillBrush.color = parseColor(attributes.value(QLatin1String("Fill")).toString());
+        Brush strokeBrush;
+        strokeBrush.color = parseColor(attributes.value(QLatin1String("Stroke")).toString());
+        const qreal strokeWidth = attributes.hasAttribute(QLatin1String("StrokeThickness"))
+            ? attributes.value(QLatin1String("StrokeThickness")).toDouble() : 1.0;
+
+        while (reader.readNextStartElement()) {
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("Path.Data")) path = readGeometryProperty();
+            else if (name == QLatin1String("Path.Fill")) fillBrush = readBrushProperty();
+            else if (name == QLatin1String("Path.Stroke")) strokeBrush = readBrushProperty();
+            else if (name == QLatin1String("Path.RenderTransform")) painter.setTransform(readTransformProperty(), true);
+            else reader.skipCurrentElement();
+        }
+
+        if (!path.isEmpty()) {
+            if (fillBrush.isSet()) fill(path, fillBrush);
+            if (strokeBrush.color.isValid() && strokeWidth > 0) {
+                QPen pen(strokeBrush.color, strokeWidth);
+                pen.setJoinStyle(Qt::MiterJoin);
+                painter.strokePath(path, pen);
+            }
+        }
+        painter.restore();
+    }
+
+    void parseGlyphs() {
+        const QXmlStreamAttributes attributes = reader.attributes();
+        QString text = attributes.value(QLatin1String("UnicodeString")).toString();
+        if (text.startsWith(QLatin1String("{}"))) text.remove(0, 2); // Escape for strings starting with '{'
+        const qreal emSize = attributes.value(QLatin1String("FontRenderingEmSize")).toDouble();
+        const QPointF origin(attributes.value(QLatin1String("OriginX")).toDouble(), attributes.value(QLatin1String("OriginY")).toDouble());
+
+        painter.save();
+        applyCommon(attributes);
+        Brush brush;
+        brush.color = parseColor(attributes.value(QLatin1String("Fill")).toString());
+        while (reader.readNextStartElement()) {
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("Glyphs.Fill")) brush = readBrushProperty();
+            else if (name == QLatin1String("Glyphs.RenderTransform")) painter.setTransform(readTransformProperty(), true);
+            else reader.skipCurrentElement();
+        }
+
+        if (!text.isEmpty() && emSize > 0) {
+            QFont font;
+            font.setPixelSize(ReferenceFontPixels);
+            const QFontMetricsF metrics(font);
+            const qreal scale = emSize / ReferenceFontPixels;
+            const QRectF box(origin.x(), origin.y() - metrics.ascent() * scale,
+                             metrics.boundingRect(text).width() * scale, metrics.height() * scale);
+            page->runs.append(XpsFixedPage::TextRun{text, painter.transform().mapRect(box)});
+
+            painter.translate(origin);
+            painter.scale(scale, scale);
+            painter.setFont(font);
+            painter.setPen(brush.color.isValid() ? brush.color : QColor(Qt::black));
+            painter.drawText(QPointF(0, 0), text);
+        }
+        painter.restore();
+    }
+};
+
+std::shared_ptr<const XpsFixedPage> XpsFixedPage::parse(const ZipArchive& archive, const QString& partPath)
+{
+    const QByteArray xaml = archive.read(partPath);
+    if (xaml.isEmpty()) return nullptr;
+
+    std::shared_ptr<XpsFixedPage> page(new XpsFixedPage());
+    XpsPageParser parser(archive, partPath, page.get());
+    if (!parser.run(xaml)) {
+        LOG_ERROR("XpsFixedPage: " << partPath << " is not a FixedPage");
+        return nullptr;
+    }
+    page->bytes = page->drawing.size();
+    for (const TextRun& run : page->runs) {
+        page->bytes += run.text.size() * static_cast<qint64>(sizeof(QChar)) + static_cast<qint64>(sizeof(TextRun));
+    }
+    LOG_DEBUG("XpsFixedPage: Parsed " << partPath << ", " << page->runs.size() << " text runs, " << page->bytes << " bytes");
+    return page;
+}
+
+QSizeF XpsFixedPage::readSize(const ZipArchive& archive, const QString& partPath)
+{
+    // Only the root element is needed; stop inflating once it is read
+    const std::unique_ptr<QIODevice> stream = archive.openStream(partPath);
+    if (!stream) return QSizeF();
+    QXmlStreamReader reader(stream.get());
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            if (reader.name() != QLatin1String("FixedPage")) return QSizeF();
+            return QSizeF(reader.attributes().value(QLatin1String("Width")).toDouble(),
+                          reader.attributes().value(QLatin1String("Height")).toDouble());
+        }
+    }
+    return QSizeF();
+}
+
+QString XpsFixedPage::resolvePart(const QString& basePart, const QString& target)
+{
+    if (target.startsWith(QLatin1Char('/'))) return ZipArchive::normalizePath(target);
+    return ZipArchive::normalizePath(QFileInfo(basePart).path() + QLatin1Char('/') + target);
+}
+
+} // namespace QuantilyxDoc
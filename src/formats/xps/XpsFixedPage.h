@@ -0,0 +1,107 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_XPSFIXEDPAGE_H
+#define QUANTILYX_XPSFIXEDPAGE_H
+
+#include <QByteArray>
+#include <QPicture>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class ZipArchive;
+
+/**
+ * @brief The parsed content of one XPS FixedPage part.
+ *
+ * The page's XAML is interpreted once into a recorded picture, replayed at
+ * any scale by each render, and its Glyphs runs are kept for text
+ * extraction and search. Covers Canvas, Path (abbreviated geometry, solid
+ * and image brushes) and Glyphs with transforms and opacity; embedded fonts
+ * are replaced by the default font. Immutable once parsed, so it can be
+ * shared between threads.
+ */
+class XpsFixedPage
+{
+public:
+    /**
+     * @brief One Glyphs element's text.
+     */
+    struct TextRun {
+        QString text;  ///< Unicode string of the run
+        QRectF bounds; ///< Approximate extent in page units (1/96 inch)
+    };
+
+    /**
+     * @brief Parse a FixedPage part.
+     * @param archive Package the part and its resources come from.
+     * @param partPath Path of the .fpage part inside the package.
+     * @return Parsed page, or null if the part is missing or not a FixedPage.
+     */
+    static std::shared_ptr<const XpsFixedPage> parse(const ZipArchive& archive, const QString& partPath);
+
+    /**
+     * @brief Read only a FixedPage's size, without interpreting its content.
+     * @param archive Package the part comes from.
+     * @param partPath Path of the .fpage part inside the package.
+     * @return Width and height in page units, or an empty size.
+     */
+    static QSizeF readSize(const ZipArchive& archive, const QString& partPath);
+
+    /**
+     * @brief Resolve a part reference the way OPC does.
+     * @param basePart Part holding the reference.
+     * @param target Absolute ("/Documents/1/...") or relative reference.
+     * @return Normalized path inside the package.
+     */
+    static QString resolvePart(const QString& basePart, const QString& target);
+
+    /**
+     * @brief Get the page size.
+     * @return Width and height in page units (1/96 inch).
+     */
+    QSizeF size() const { return pageSize; }
+
+    /**
+     * @brief Get the page's drawing, in page units.
+     * @return Recorded picture.
+     */
+    const QPicture& picture() const { return drawing; }
+
+    /**
+     * @brief Get the page's text runs, in document order.
+     * @return Runs.
+     */
+    const QVector<TextRun>& textRuns() const { return runs; }
+
+    /**
+     * @brief Get the memory the parsed page holds.
+     * @return Approximate size in bytes.
+     */
+    qint64 byteCount() const { return bytes; }
+
+private:
+    XpsFixedPage() = default;
+
+    QSizeF pageSize;
+    QPicture drawing;
+    QVector<TextRun> runs;
+    qint64 bytes = 0;
+
+    friend class XpsPageParser;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_XPSFIXEDPAGE_H
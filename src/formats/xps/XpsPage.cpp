@@ -0,0 +1,125 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "XpsPage.h"
+#include "XpsDocument.h"
+#include "XpsFixedPage.h"
+#include "../../core/ImageBufferPool.h"
+#include "../../core/Logger.h"
+#include <QImage>
+#include <QPainter>
+#include <QPointer>
+#include <QStringList>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// XPS page units are 1/96 inch
+const qreal PointsPerUnit = 72.0 / 96.0;
+
+} // namespace
+
+class XpsPage::Private {
+public:
+    Private(XpsDocument* doc, int pIndex) : document(doc), pageIndexVal(pIndex) {}
+
+    XpsDocument* document;
+    int pageIndexVal;
+};
+
+XpsPage::XpsPage(XpsDocument* document, int pageIndex, const QSizeF& pageSize, QObject* parent)
+    : Page(document, parent)
+    , d(new Private(document, pageIndex))
+{
+    setSize(pageSize);
+}
+
+XpsPage::~XpsPage() = default;
+
+QImage XpsPage::render(int width, int height, int dpi)
+{
+    return renderFitted(width, height, dpi);
+}
+
+QImage XpsPage::renderRectangle(const QRectF& rect, int width, int height, int dpi)
+{
+    Q_UNUSED(dpi); // Output size is governed by width and height
+    if (rect.isEmpty() || width <= 0 || height <= 0) return QImage();
+    const std::shared_ptr<const XpsFixedPage> content = d->document->parsedPage(d->pageIndexVal);
+    if (!content) {
+        LOG_ERROR("Failed to parse XpsPage " << d->pageIndexVal);
+        return QImage();
+    }
+
+    // The FixedDocument may not have announced the size; the part is authoritative
+    const QSizeF actual = content->size() * PointsPerUnit;
+    if (qAbs(actual.width() - size().width()) > 0.5 || qAbs(actual.height() - size().height()) > 0.5) {
+        QPointer<XpsPage> self(this);
+        QMetaObject::invokeMethod(this, [self, actual]() {
+            if (!self) return;
+            self->setSize(actual);
+            if (self->d->document) emit self->d->document->pageSizesChanged();
+        }, Qt::QueuedConnection);
+    }
+
+    QImage image = ImageBufferPool::instance().acquire(QSize(width, height));
+    if (image.isNull()) return QImage();
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter.scale(width / rect.width(), height / rect.height());
+    painter.translate(-rect.topLeft());
+    painter.scale(PointsPerUnit, PointsPerUnit);
+    painter.drawPicture(QPointF(0, 0), content->picture());
+    painter.end();
+    LOG_DEBUG("Rendered rectangle " << rect << " from XpsPage " << d->pageIndexVal << " to image size " << image.size());
+    return image;
+}
+
+bool XpsPage::rendersRegionsDirectly() const
+{
+    return true;
+}
+
+QString XpsPage::text() const
+{
+    const std::shared_ptr<const XpsFixedPage> content = d->document->parsedPage(d->pageIndexVal);
+    if (!content) return QString();
+    QStringList lines;
+    for (const XpsFixedPage::TextRun& run : content->textRuns()) lines.append(run.text);
+    return lines.join(QLatin1Char('\n'));
+}
+
+QList<QRectF> XpsPage::searchText(const QString& text, bool caseSensitive, bool wholeWords) const
+{
+    QList<QRectF> results;
+    if (text.isEmpty()) return results;
+    const std::shared_ptr<const XpsFixedPage> content = d->document->parsedPage(d->pageIndexVal);
+    if (!content) return results;
+
+    const Qt::CaseSensitivity sensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    for (const XpsFixedPage::TextRun& run : content->textRuns()) {
+        for (int from = run.text.indexOf(text, 0, sensitivity); from >= 0; from = run.text.indexOf(text, from + 1, sensitivity)) {
+            const int end = from + text.size();
+            if (wholeWords && ((from > 0 && run.text[from - 1].isLetterOrNumber()) ||
+                               (end < run.text.size() && run.text[end].isLetterOrNumber()))) {
+                continue;
+            }
+            // Glyph advances are not kept; characters are taken as equally wide
+            const qreal charWidth = run.bounds.width() / run.text.size();
+            const QRectF match(run.bounds.left() + from * charWidth, run.bounds.top(), text.size() * charWidth, run.bounds.height());
+            results.append(QRectF(match.topLeft() * PointsPerUnit, match.size() * PointsPerUnit));
+        }
+    }
+    return results;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,60 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_XPSPAGE_H
+#define QUANTILYX_XPSPAGE_H
+
+#include "../../core/Page.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class XpsDocument;
+
+/**
+ * @brief One FixedPage of an XPS document.
+ *
+ * Holds no content of its own: the page's XAML is parsed the first time it
+ * is rendered or its text is needed, and the result is kept in the
+ * document's bounded cache of parsed pages.
+ */
+class XpsPage : public Page
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The parent XpsDocument.
+     * @param pageIndex The 0-based index of this page.
+     * @param pageSize Page size in points, as announced by the FixedDocument.
+     * @param parent Parent object.
+     */
+    XpsPage(XpsDocument* document, int pageIndex, const QSizeF& pageSize, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~XpsPage() override;
+
+    // --- Page Interface Implementation ---
+    QImage render(int width, int height, int dpi = 72) override;
+    QImage renderRectangle(const QRectF& rect, int width, int height, int dpi = 72) override;
+    bool rendersRegionsDirectly() const override;
+    QString text() const override;
+    QList<QRectF> searchText(const QString& text, bool caseSensitive = false, bool wholeWords = false) const override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_XPSPAGE_H
@@ -11,26 +11,37 @@
 #include "ui/MainWindow.h"
 #include "core/Application.h"
 #include "core/Logger.h"
+#include "core/BinaryLog.h"
 #include "core/ConfigManager.h"
 #include "core/Settings.h"
+#include "core/StartupTrace.h"
+#include "core/Tracing.h"
+#include "core/MetricsServer.h"
 #include "core/RecentFiles.h"
 #include "core/BackupManager.h"
 #include "core/CrashHandler.h"
 #include "core/ProfileManager.h"
 #include "core/MetadataDatabase.h"
+#include "core/ThumbnailStore.h"
 #include "core/DuplicateDetector.h"
 #include "search/FullTextIndex.h"
 #include "automation/MacroRecorder.h"
 #include "automation/ScriptingEngine.h"
+#include "automation/BatchRunner.h"
+#include "automation/BenchmarkRunner.h"
+#include "automation/PageExporter.h"
+#include "automation/FormatConverter.h"
 #include "security/PasswordRemover.h"
 #include "security/RestrictionBypass.h"
 #include "ocr/OcrEngine.h"
+#include "ocr/OcrResultCache.h"
 #include "ui/CommandPalette.h"
 #include "ui/QuickActionsPanel.h"
 #include "ui/AboutDialog.h"
 #include "ui/PreferencesDialog.h"
 #include <QDir>
 #include <QStandardPaths>
+#include <QFile>
 #include <QFileInfo>
 #include <QCommandLineParser>
 #include <QTimer>
@@ -40,6 +51,10 @@
 #include <QMetaType> // For registering custom types if needed
 #include <QElapsedTimer> // For timing initialization steps
 #include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTextStream>
 #include <QThread> // For potential thread management during init
 
 // Register custom types if any are used across threads/signals
@@ -47,10 +62,39 @@
 
 int main(int argc, char *argv[])
 {
+    // Documents opened from a file manager go to the running instance
+    // before any of the startup below is paid for
+    if (QuantilyxDoc::Application::forwardToRunningInstance(argc, argv)) {
+        return 0;
+    }
+
+    // Tracing starts before QApplication so its construction is timed too
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--trace-startup") == 0 && i + 1 < argc) {
+            QuantilyxDoc::StartupTrace::begin(QString::fromLocal8Bit(argv[i + 1]));
+        } else if (qstrncmp(argv[i], "--trace-startup=", 16) == 0) {
+            QuantilyxDoc::StartupTrace::begin(QString::fromLocal8Bit(argv[i] + 16));
+        }
+    }
+    QuantilyxDoc::StartupTrace::Scope startupTrace("Startup");
+
+    // Batch runs create no windows, so they need no display
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--batch-script") == 0 || qstrcmp(argv[i], "--run-script") == 0
+            || qstrcmp(argv[i], "--benchmark") == 0 || qstrcmp(argv[i], "--render") == 0
+            || qstrncmp(argv[i], "--render=", 9) == 0 || qstrcmp(argv[i], "--convert") == 0
+            || qstrncmp(argv[i], "--convert=", 10) == 0) {
+            if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+            break;
+        }
+    }
+
     // Use QuantilyxDoc's custom Application class which inherits from QApplication.
     // This ensures the custom application-wide settings, event handling, etc., are used.
     // The Application class constructor sets up basic QApplication properties.
+    QuantilyxDoc::StartupTrace::Scope applicationTrace("QApplication");
     QuantilyxDoc::Application app(argc, argv);
+    applicationTrace.end();
 
     // --- Register Custom Types (if any) ---
     // qRegisterMetaType<MyCustomType>("MyCustomType");
@@ -74,6 +118,82 @@ int main(int argc, char *argv[])
     QCommandLineOption configPathOption(QStringList() << "config",
                                         "Specify a custom configuration file path.",
                                         "config_path");
+    QCommandLineOption decodeLogOption(QStringList() << "decode-log",
+                                       "Print a binary log file as text and exit.",
+                                       "log_file");
+    QCommandLineOption jsonOption(QStringList() << "json",
+                                  "With --decode-log, print one JSON object per line.");
+
+    QCommandLineOption batchScriptOption(QStringList() << "batch-script",
+                                         "Run a script over the input documents without a user interface and exit.",
+                                         "script");
+    QCommandLineOption inputsOption(QStringList() << "inputs",
+                                    "With --batch-script, a document, wildcard pattern or @list file; may be repeated.",
+                                    "pattern");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "With --batch-script, number of documents processed at once; with --render, pages; with --convert, threads (default: one per CPU).",
+                                  "count");
+    QCommandLineOption batchTimeoutOption(QStringList() << "batch-timeout",
+                                          "With --batch-script, seconds allowed per document (default: no limit).",
+                                          "seconds");
+    QCommandLineOption batchReportOption(QStringList() << "batch-report",
+                                         "With --batch-script, write a JSON report of every document's result.",
+                                         "report_file");
+    QCommandLineOption runScriptOption(QStringList() << "run-script",
+                                       "Run a script on the --script-input document and exit (used by --batch-script workers).",
+                                       "script");
+    QCommandLineOption scriptInputOption(QStringList() << "script-input",
+                                         "Document for --run-script.",
+                                         "file_path");
+    QCommandLineOption traceStartupOption(QStringList() << "trace-startup",
+                                          "Write the timings of each startup phase to a Chrome trace file.",
+                                          "trace_file");
+    QCommandLineOption traceOption(QStringList() << "trace",
+                                   "In a build with ENABLE_TRACING, record the render, cache, load and search zones and write them at exit as a Chrome trace.",
+                                   "trace_file");
+    QCommandLineOption benchmarkOption(QStringList() << "benchmark",
+                                       "Time the render, cache, index and parsing hot paths without a user interface and exit.");
+    QCommandLineOption benchmarkFilterOption(QStringList() << "benchmark-filter",
+                                             "With --benchmark, only run benchmarks whose name matches a regular expression.",
+                                             "pattern");
+    QCommandLineOption benchmarkCorpusOption(QStringList() << "benchmark-corpus",
+                                             "With --benchmark, directory of PDF, EPUB and CBZ files for the macrobenchmarks.",
+                                             "directory");
+    QCommandLineOption benchmarkRepetitionsOption(QStringList() << "benchmark-repetitions",
+                                                  "With --benchmark, times each benchmark is timed (default: 5).",
+                                                  "count");
+    QCommandLineOption benchmarkOutOption(QStringList() << "benchmark-out",
+                                          "With --benchmark, write the results as Google Benchmark JSON.",
+                                          "report_file");
+    QCommandLineOption benchmarkBaselineOption(QStringList() << "benchmark-baseline",
+                                               "With --benchmark, compare against a report kept from --benchmark-out and fail on regressions.",
+                                               "report_file");
+    QCommandLineOption benchmarkThresholdOption(QStringList() << "benchmark-threshold",
+                                                "With --benchmark-baseline, allowed slowdown or memory growth in percent (default: 10).",
+                                                "percent");
+    QCommandLineOption renderOption(QStringList() << "render",
+                                    "Render pages of a document to images without a user interface and exit.",
+                                    "file_path");
+    QCommandLineOption pagesOption(QStringList() << "pages",
+                                   "With --render or --convert, pages such as 1-3,7,10- (default: all).",
+                                   "ranges");
+    QCommandLineOption dpiOption(QStringList() << "dpi",
+                                 "With --render or --convert, resolution in dots per inch (default: 150).",
+                                 "dpi");
+    QCommandLineOption imageFormatOption(QStringList() << "format",
+                                         "With --render, png, jpg or webp; with --convert, also pdf (default: from the output name, else png or pdf).",
+                                         "format");
+    QCommandLineOption qualityOption(QStringList() << "quality",
+                                     "With --render or --convert, quality of jpg and webp images, 0 to 100; with --convert to pdf, embeds pages as jpg.",
+                                     "quality");
+    QCommandLineOption convertOption(QStringList() << "convert",
+                                     "Convert a document to PDF or images without a user interface and exit; needs --output.",
+                                     "file_path");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "With --render or --convert, output file; %1 stands for the page number, with --render - for standard output (default: -).",
+                                    "pattern");
+    runScriptOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    scriptInputOption.setFlags(QCommandLineOption::HiddenFromHelp);
 
     parser.addPositionalArgument("file", "Document file to open.", "[file]");
     parser.addOption(fileArgument);
@@ -81,8 +201,58 @@ int main(int argc, char *argv[])
     parser.addOption(disablePluginsOption);
     parser.addOption(verboseOption);
     parser.addOption(configPathOption);
-
+    parser.addOption(decodeLogOption);
+    parser.addOption(jsonOption);
+    parser.addOption(batchScriptOption);
+    parser.addOption(inputsOption);
+    parser.addOption(jobsOption);
+    parser.addOption(batchTimeoutOption);
+    parser.addOption(batchReportOption);
+    parser.addOption(runScriptOption);
+    parser.addOption(scriptInputOption);
+    parser.addOption(traceStartupOption);
+    parser.addOption(traceOption);
+    parser.addOption(renderOption);
+    parser.addOption(pagesOption);
+    parser.addOption(dpiOption);
+    parser.addOption(imageFormatOption);
+    parser.addOption(qualityOption);
+    parser.addOption(outputOption);
+    parser.addOption(convertOption);
+    parser.addOption(benchmarkOption);
+    parser.addOption(benchmarkFilterOption);
+    parser.addOption(benchmarkCorpusOption);
+    parser.addOption(benchmarkRepetitionsOption);
+    parser.addOption(benchmarkOutOption);
+    parser.addOption(benchmarkBaselineOption);
+    parser.addOption(benchmarkThresholdOption);
+
+    QuantilyxDoc::StartupTrace::Scope parseTrace("Command line");
     parser.process(app);
+    parseTrace.end();
+
+    // Offline log decoding needs none of the systems below
+    if (parser.isSet(decodeLogOption)) {
+        QuantilyxDoc::BinaryLogReader reader;
+        QTextStream err(stderr);
+        if (!reader.open(parser.value(decodeLogOption))) {
+            err << reader.errorString() << "\n";
+            return 1;
+        }
+        QTextStream out(stdout);
+        const bool json = parser.isSet(jsonOption);
+        QuantilyxDoc::BinaryLogReader::Entry entry;
+        while (reader.next(entry)) {
+            if (json) out << QJsonDocument(QuantilyxDoc::BinaryLogReader::toJson(entry)).toJson(QJsonDocument::Compact) << "\n";
+            else out << QuantilyxDoc::BinaryLogReader::toText(entry) << "\n";
+        }
+        out.flush();
+        if (!reader.errorString().isEmpty()) {
+            err << reader.errorString() << "\n";
+            return 1;
+        }
+        return 0;
+    }
 
     QStringList fileNames = parser.positionalArguments();
     if (parser.isSet(fileArgument)) {
@@ -91,8 +261,25 @@ int main(int argc, char *argv[])
     QString startupProfile = parser.value(profileArgument);
     bool disablePlugins = parser.isSet(disablePluginsOption);
     bool verboseLogging = parser.isSet(verboseOption);
+
+    // Written however main() returns, the headless modes included
+    struct TraceWriter {
+        ~TraceWriter() { QuantilyxDoc::Tracing::finish(); }
+    } traceWriter;
+    if (parser.isSet(traceOption) && !QuantilyxDoc::Tracing::begin(parser.value(traceOption))) {
+        QTextStream(stderr) << "--trace needs a build configured with ENABLE_TRACING\n";
+    }
     QString customConfigPath = parser.value(configPathOption);
 
+#ifndef Q_OS_UNIX
+    // The fast path above is Unix only; elsewhere hand the files over now that Qt is up
+    if (!fileNames.isEmpty()) {
+        QStringList absolutePaths;
+        for (const QString& fileName : fileNames) absolutePaths.append(QFileInfo(fileName).absoluteFilePath());
+        if (QuantilyxDoc::Application::sendFilesToExistingInstance(absolutePaths)) return 0;
+    }
+#endif
+
     // --- Application Initialization Sequence ---
     // This is the critical startup phase where all core systems are initialized.
     bool initSuccess = true;
@@ -100,11 +287,17 @@ int main(int argc, char *argv[])
     QElapsedTimer initTimer;
     initTimer.start();
 
+    // Images rendered to standard output must not be interleaved with log lines
+    if (parser.isSet(renderOption) && (!parser.isSet(outputOption) || parser.value(outputOption) == QLatin1String("-"))) {
+        QuantilyxDoc::Logger::instance().setConsoleOutput(false);
+    }
+
     LOG_INFO("=== Starting QuantilyxDoc Initialization ===");
     LOG_DEBUG("Command line args: " << app.arguments().join(" "));
 
     // 0. Early Logger Initialization (before other systems)
     LOG_DEBUG("Initializing Logger (early)..."); // This might not log anywhere yet if logger isn't fully set up
+    QuantilyxDoc::StartupTrace::Scope loggerTrace("Logger");
     if (!QuantilyxDoc::Logger::instance().initialize()) {
         initError = "Failed to initialize Logger.";
         initSuccess = false;
@@ -115,8 +308,11 @@ int main(int argc, char *argv[])
         }
     }
 
+    loggerTrace.end();
+
     // 1. Initialize ConfigManager (loads basic configuration needed for other systems)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("ConfigManager");
         LOG_DEBUG("Initializing ConfigManager...");
         if (!QuantilyxDoc::ConfigManager::instance().initialize(customConfigPath)) { // Pass custom path if provided
             initError = "Failed to initialize ConfigManager.";
@@ -128,6 +324,7 @@ int main(int argc, char *argv[])
 
     // 2. Initialize Settings (loads user preferences from file based on config/profile)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("Settings");
         LOG_DEBUG("Loading Settings...");
         // Settings might depend on the profile loaded by ProfileManager
         if (!QuantilyxDoc::Settings::instance().isEnabled()) { // Check if settings system itself is enabled/configured
@@ -135,10 +332,205 @@ int main(int argc, char *argv[])
         }
         QuantilyxDoc::Settings::instance().load(); // Load settings from file
         LOG_INFO("Settings loaded successfully.");
+        if (QuantilyxDoc::Settings::instance().value<bool>("Advanced/BinaryLog", false)) {
+            QuantilyxDoc::Logger::instance().setBinaryOutput(true);
+        }
+    }
+
+    // Batch runs need nothing past settings: a worker opens its one
+    // document itself, and the driver only starts workers
+    if (initSuccess && parser.isSet(runScriptOption)) {
+        return QuantilyxDoc::BatchRunner::runOne(parser.value(runScriptOption), parser.value(scriptInputOption));
+    }
+    if (initSuccess && parser.isSet(batchScriptOption)) {
+        QTextStream out(stdout);
+        QTextStream err(stderr);
+        const QStringList inputs = QuantilyxDoc::BatchRunner::expandInputs(parser.values(inputsOption) + fileNames);
+        if (inputs.isEmpty()) {
+            err << "No input documents; give files, patterns or @lists with --inputs\n";
+            return 2;
+        }
+
+        QuantilyxDoc::BatchRunner runner;
+        runner.setScript(parser.value(batchScriptOption));
+        runner.setJobs(parser.value(jobsOption).toInt());
+        runner.setTimeoutSeconds(parser.value(batchTimeoutOption).toInt());
+        QObject::connect(&runner, &QuantilyxDoc::BatchRunner::itemFinished,
+                         [&out](const QuantilyxDoc::BatchRunner::Result& result, int finished, int total) {
+            out << QString("[%1/%2] %3 %4 (%5 ms)").arg(finished).arg(total)
+                       .arg(result.success ? "OK  " : "FAIL", result.input).arg(result.elapsedMs);
+            if (!result.success) out << ": " << result.error;
+            out << "\n";
+            out.flush();
+        });
+        const int failed = runner.run(inputs);
+        out << (inputs.size() - failed) << " of " << inputs.size() << " documents succeeded\n";
+        out.flush();
+
+        if (parser.isSet(batchReportOption)) {
+            QFile report(parser.value(batchReportOption));
+            if (!report.open(QIODevice::WriteOnly | QIODevice::Truncate)
+                || report.write(QJsonDocument(runner.report()).toJson()) < 0) {
+                err << "Cannot write batch report: " << report.errorString() << "\n";
+                return 2;
+            }
+        }
+        return failed > 0 ? 1 : 0;
+    }
+
+    if (initSuccess && parser.isSet(renderOption)) {
+        QTextStream err(stderr);
+        QuantilyxDoc::PageExporter exporter;
+        const QString output = parser.isSet(outputOption) ? parser.value(outputOption) : QStringLiteral("-");
+        QString format = parser.value(imageFormatOption);
+        if (format.isEmpty() && output != QLatin1String("-")) format = QFileInfo(output).suffix();
+        if (format.isEmpty()) format = QStringLiteral("png");
+        if (!exporter.setFormat(format)) {
+            err << "Cannot write " << format << " images; supported: png, jpg" << "\n";
+            return 2;
+        }
+        exporter.setOutput(output);
+        if (parser.isSet(dpiOption)) exporter.setDpi(parser.value(dpiOption).toInt());
+        if (parser.isSet(qualityOption)) exporter.setQuality(parser.value(qualityOption).toInt());
+        exporter.setJobs(parser.value(jobsOption).toInt());
+        // Standard output may carry the images, so progress goes to standard error
+        QObject::connect(&exporter, &QuantilyxDoc::PageExporter::pageFailed, [&err](int pageIndex, const QString& error) {
+            err << "Page " << (pageIndex + 1) << " failed: " << error << "\n";
+            err.flush();
+        });
+        if (verboseLogging) {
+            QObject::connect(&exporter, &QuantilyxDoc::PageExporter::pageExported,
+                             [&err](int pageIndex, const QString& path, qint64 elapsedMs) {
+                err << "Page " << (pageIndex + 1) << " -> " << path << " (" << elapsedMs << " ms)\n";
+                err.flush();
+            });
+        }
+        const int failed = exporter.run(parser.value(renderOption), parser.value(pagesOption));
+        if (failed < 0) {
+            err << exporter.errorString() << "\n";
+            return 2;
+        }
+        return failed > 0 ? 1 : 0;
+    }
+
+    if (initSuccess && parser.isSet(convertOption)) {
+        QTextStream out(stdout);
+        QTextStream err(stderr);
+        const QString output = parser.value(outputOption);
+        if (output.isEmpty() || output == QLatin1String("-")) {
+            err << "--convert needs an output file; give one with --output\n";
+            return 2;
+        }
+        QuantilyxDoc::FormatConverter converter;
+        QString format = parser.value(imageFormatOption);
+        if (format.isEmpty()) format = QFileInfo(output).suffix();
+        if (format.isEmpty()) format = QStringLiteral("pdf");
+        if (!converter.setFormat(format)) {
+            err << "Cannot write " << format << "; supported: pdf, png, jpg" << "\n";
+            return 2;
+        }
+        converter.setOutput(output);
+        if (parser.isSet(dpiOption)) converter.setDpi(parser.value(dpiOption).toInt());
+        if (parser.isSet(qualityOption)) converter.setQuality(parser.value(qualityOption).toInt());
+        converter.setJobs(parser.value(jobsOption).toInt());
+        QObject::connect(&converter, &QuantilyxDoc::FormatConverter::pageFailed, [&err](int pageIndex, const QString& error) {
+            err << "Page " << (pageIndex + 1) << " failed: " << error << "\n";
+            err.flush();
+        });
+        if (verboseLogging) {
+            QObject::connect(&converter, &QuantilyxDoc::FormatConverter::progress, [&out](int pagesDone, int pageCount) {
+                out << "[" << pagesDone << "/" << pageCount << "]\n";
+                out.flush();
+            });
+        }
+        const int failed = converter.run(parser.value(convertOption), parser.value(pagesOption));
+        if (failed < 0) {
+            err << converter.errorString() << "\n";
+            return 2;
+        }
+        return failed > 0 ? 1 : 0;
+    }
+
+    if (initSuccess && parser.isSet(benchmarkOption)) {
+        QTextStream out(stdout);
+        QTextStream err(stderr);
+        QJsonObject baseline;
+        if (parser.isSet(benchmarkBaselineOption)) {
+            QFile file(parser.value(benchmarkBaselineOption));
+            if (file.open(QIODevice::ReadOnly)) baseline = QJsonDocument::fromJson(file.readAll()).object();
+            if (baseline.isEmpty()) {
+                err << "Cannot read benchmark baseline " << file.fileName() << "\n";
+                return 2;
+            }
+        }
+
+        QuantilyxDoc::BenchmarkRunner runner;
+        QString filter = parser.value(benchmarkFilterOption);
+        if (filter.isEmpty() && !baseline.isEmpty()) {
+            // A gate runs what its baseline measured
+            QStringList names;
+            for (const QString& name : QuantilyxDoc::BenchmarkRunner::reportNames(baseline)) names.append(QRegularExpression::escape(name));
+            filter = QString("^(%1)$").arg(names.join('|'));
+        }
+        runner.setFilter(filter);
+        runner.setCorpus(parser.value(benchmarkCorpusOption));
+        if (parser.isSet(benchmarkRepetitionsOption)) runner.setRepetitions(parser.value(benchmarkRepetitionsOption).toInt());
+        QObject::connect(&runner, &QuantilyxDoc::BenchmarkRunner::benchmarkFinished,
+                         [&out](const QuantilyxDoc::BenchmarkRunner::Result& result, int finished, int total) {
+            out << QString("[%1/%2] %3").arg(finished).arg(total).arg(result.name, -48);
+            if (!result.skipped.isEmpty()) {
+                out << " skipped: " << result.skipped << "\n";
+            } else {
+                out << QString(" %1 us median, +/- %2%, %3 iterations")
+                           .arg(result.medianNs / 1000.0, 0, 'f', 2)
+                           .arg(result.meanNs > 0 ? 100.0 * result.stddevNs / result.meanNs : 0.0, 0, 'f', 1)
+                           .arg(result.iterations);
+                if (result.itemsPerSecond > 0) out << QString(", %1 items/s").arg(result.itemsPerSecond, 0, 'f', 0);
+                out << "\n";
+            }
+            out.flush();
+        });
+        const int ran = runner.run();
+        out << ran << " of " << runner.results().size() << " benchmarks ran\n";
+        out.flush();
+
+        if (parser.isSet(benchmarkOutOption)) {
+            QFile report(parser.value(benchmarkOutOption));
+            if (!report.open(QIODevice::WriteOnly | QIODevice::Truncate)
+                || report.write(QJsonDocument(runner.report()).toJson()) < 0) {
+                err << "Cannot write benchmark report: " << report.errorString() << "\n";
+                return 2;
+            }
+        }
+        if (ran == 0) return 1;
+
+        if (!baseline.isEmpty()) {
+            const double threshold = parser.isSet(benchmarkThresholdOption) ? parser.value(benchmarkThresholdOption).toDouble() : 10.0;
+            int regressions = 0;
+            for (const QuantilyxDoc::BenchmarkRunner::Comparison& comparison : runner.compareWith(baseline, threshold)) {
+                if (!comparison.regression) continue;
+                ++regressions;
+                const bool memory = comparison.metric == QLatin1String("peak_rss");
+                out << QString("REGRESSION %1 %2: %3 -> %4 %5 (%6%7%")
+                           .arg(comparison.name, comparison.metric)
+                           .arg(memory ? comparison.baseline / 1048576 : comparison.baseline / 1000, 0, 'f', 2)
+                           .arg(memory ? comparison.current / 1048576 : comparison.current / 1000, 0, 'f', 2)
+                           .arg(memory ? "MiB" : "us")
+                           .arg(comparison.changePercent >= 0 ? "+" : "")
+                           .arg(comparison.changePercent, 0, 'f', 1);
+                if (!memory && comparison.pValue < 1) out << QString(", p = %1").arg(comparison.pValue, 0, 'f', 4);
+                out << ")\n";
+            }
+            out << regressions << " regressions beyond " << threshold << "% against " << parser.value(benchmarkBaselineOption) << "\n";
+            out.flush();
+            if (regressions > 0) return 1;
+        }
+        return 0;
     }
 
     // 3. Initialize Profile Manager (must come after Settings to potentially override them)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("ProfileManager");
         LOG_DEBUG("Initializing ProfileManager...");
         if (!QuantilyxDoc::ProfileManager::instance().initialize()) {
             initError = "Failed to initialize ProfileManager.";
@@ -158,6 +550,7 @@ int main(int argc, char *argv[])
 
     // 4. Initialize Crash Handler (early, so it can catch crashes during init)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("CrashHandler");
         LOG_DEBUG("Installing CrashHandler...");
         if (!QuantilyxDoc::CrashHandler::instance().install()) {
             LOG_WARN("Could not install crash handler. Application stability might be affected if a crash occurs.");
@@ -169,6 +562,7 @@ int main(int argc, char *argv[])
 
     // 5. Initialize Backup Manager (settings dependent)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("BackupManager");
         LOG_DEBUG("Initializing BackupManager...");
         // BackupManager reads settings like 'EnableAutoBackup', 'BackupInterval', etc.
         // QuantilyxDoc::BackupManager::instance().setEnabled(Settings::instance().value<bool>("General/EnableAutoBackup", true));
@@ -180,6 +574,7 @@ int main(int argc, char *argv[])
 
     // 6. Initialize Recent Files (loads list from storage)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("RecentFiles");
         LOG_DEBUG("Loading RecentFiles...");
         QuantilyxDoc::RecentFiles::instance().load();
         LOG_INFO("RecentFiles loaded successfully.");
@@ -187,6 +582,7 @@ int main(int argc, char *argv[])
 
     // 7. Initialize Metadata Database (opens connection/file)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("MetadataDatabase");
         LOG_DEBUG("Initializing MetadataDatabase...");
         QString dbPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/metadata.db";
         QDir().mkpath(QFileInfo(dbPath).absolutePath()); // Ensure directory exists
@@ -196,18 +592,32 @@ int main(int argc, char *argv[])
         } else {
             LOG_INFO("MetadataDatabase initialized successfully at: " << dbPath);
         }
+
+        // Thumbnails sit next to the metadata; without them documents just open slower
+        QString thumbnailPath = QFileInfo(dbPath).absolutePath() + "/thumbnails.db";
+        if (!QuantilyxDoc::ThumbnailStore::instance().initialize(thumbnailPath)) {
+            LOG_WARN("ThumbnailStore could not be initialized; thumbnails will not persist.");
+        }
+
+        // So are OCR results; without them scans are recognized again when reopened
+        QString ocrCachePath = QFileInfo(dbPath).absolutePath() + "/ocr_results.db";
+        if (!QuantilyxDoc::OcrResultCache::instance().initialize(ocrCachePath)) {
+            LOG_WARN("OcrResultCache could not be initialized; OCR results will not persist.");
+        }
     }
 
     // 8. Initialize Duplicate Detector (uses MetadataDatabase)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("DuplicateDetector");
         LOG_DEBUG("Initializing DuplicateDetector...");
-        // DuplicateDetector might need access to MetadataDB or other indexing systems.
-        // QuantilyxDoc::DuplicateDetector::instance().setMetadataDatabase(&MetadataDatabase::instance());
+        // Text signatures of documents seen before; without them every document is read again
+        QuantilyxDoc::DuplicateDetector::instance().initialize();
         LOG_INFO("DuplicateDetector initialized.");
     }
 
     // 9. Initialize Full-Text Index (opens connection/file, potentially loads cache)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("FullTextIndex");
         LOG_DEBUG("Initializing FullTextIndex...");
         QString indexPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/fts_index";
         QDir().mkpath(indexPath);
@@ -221,6 +631,7 @@ int main(int argc, char *argv[])
 
     // 10. Initialize Password Remover (locates external tools like QPDF)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("PasswordRemover");
         LOG_DEBUG("Initializing PasswordRemover...");
         // PasswordRemover might search for 'qpdf' executable or similar during initialization.
         // QuantilyxDoc::PasswordRemover::instance().findExternalTool(); // Or happens in constructor
@@ -229,28 +640,28 @@ int main(int argc, char *argv[])
 
     // 11. Initialize Restriction Bypass (locates external tools like QPDF)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("RestrictionBypass");
         LOG_DEBUG("Initializing RestrictionBypass...");
         // RestrictionBypass might search for 'qpdf' executable or similar during initialization.
         // QuantilyxDoc::RestrictionBypass::instance().findExternalTool(); // Or happens in constructor
         LOG_INFO("RestrictionBypass initialized (external tools located).");
     }
 
-    // 12. Initialize OCR Engine (loads language data, initializes Tesseract/PaddleOCR)
+    // 12. Configure OCR Engine; language data loads on first use or when warmed up below
     if (initSuccess) {
-        LOG_DEBUG("Initializing OcrEngine...");
+        QuantilyxDoc::StartupTrace::Scope trace("OcrEngine");
+        LOG_DEBUG("Configuring OcrEngine...");
         QString lang = QuantilyxDoc::Settings::instance().value<QString>("Ocr/Language", "eng");
-        QString dataPath = QuantilyxDoc::Settings::instance().value<QString>("Ocr/TessDataPath", QString()); // Could be empty, uses default
-        if (!QuantilyxDoc::OcrEngine::instance().initialize(lang, dataPath)) {
-            // OCR is not critical for basic startup, warn and continue
-            LOG_WARN("Failed to initialize OCR Engine. OCR features will be unavailable.");
-            // initSuccess = true; // Keep initSuccess as true to allow the app to run without OCR
-        } else {
-            LOG_INFO("OcrEngine initialized successfully for language: " << lang);
-        }
+        QString backend = QuantilyxDoc::Settings::instance().value<QString>("Ocr/Backend", "tesseract");
+        QString dataPath = QuantilyxDoc::Settings::instance().value<QString>(
+            backend == "paddleocr" ? "Ocr/PaddleModelPath" : "Ocr/TessDataPath", QString()); // Could be empty, uses default
+        QuantilyxDoc::OcrEngine::instance().deferInitialization(lang, dataPath);
+        LOG_INFO("OcrEngine configured for language: " << lang << " (initialized on first use)");
     }
 
     // 13. Initialize Macro Recorder
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("MacroRecorder");
         LOG_DEBUG("Initializing MacroRecorder...");
         // QuantilyxDoc::MacroRecorder::instance(); // Singleton created/accessed, might initialize in constructor
         LOG_INFO("MacroRecorder initialized.");
@@ -258,6 +669,7 @@ int main(int argc, char *argv[])
 
     // 14. Initialize Scripting Engine (loads language interpreter if applicable)
     if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("ScriptingEngine");
         LOG_DEBUG("Initializing ScriptingEngine...");
         // QString scriptLanguage = Settings::instance().value<QString>("Scripting/Language", "python");
         // if (!QuantilyxDoc::ScriptingEngine::instance().initialize(scriptLanguage)) {
@@ -271,14 +683,24 @@ int main(int argc, char *argv[])
 
     // 15. Initialize Plugins (if enabled)
     if (initSuccess && !disablePlugins) {
+        QuantilyxDoc::StartupTrace::Scope trace("Plugins");
         LOG_DEBUG("Initializing Plugins...");
-        // The Application class might have a method to load plugins based on settings or a list.
-        // app.initializePlugins(); // Hypothetical method in Application
-        LOG_INFO("Plugins initialized (or plugin loading deferred until after UI is loaded).");
+        // Reads plugin metadata only; each library loads when first used
+        app.loadPlugins();
+        LOG_INFO("Plugins indexed (each is loaded when first used).");
     } else if (disablePlugins) {
         LOG_INFO("Plugin initialization skipped (--no-plugins).");
     }
 
+#ifdef HAVE_WEB_INTERFACE
+    // 16. Start the metrics endpoint (off unless Advanced/MetricsPort is set)
+    if (initSuccess) {
+        QuantilyxDoc::StartupTrace::Scope trace("MetricsServer");
+        if (QuantilyxDoc::MetricsServer::instance().startFromSettings()) {
+            LOG_INFO("Metrics served on port " << QuantilyxDoc::MetricsServer::instance().serverPort());
+        }
+    }
+#endif
 
     // --- Initialization Result ---
     qint64 initTimeMs = initTimer.elapsed();
@@ -294,9 +716,11 @@ int main(int argc, char *argv[])
     // --- Show Splash Screen ---
     // The splash screen provides visual feedback during the potentially long initialization.
     // It should be created *after* core systems that might log are initialized, so it can show messages.
+    QuantilyxDoc::StartupTrace::Scope splashTrace("Splash screen");
     QuantilyxDoc::SplashScreen splash;
     splash.show();
     app.processEvents(); // Ensure splash is painted immediately
+    splashTrace.end();
 
     splash.showMessage(QObject::tr("Loading user interface..."), Qt::AlignBottom | Qt::AlignHCenter, Qt::white);
     app.processEvents();
@@ -306,55 +730,46 @@ int main(int argc, char *argv[])
     splash.showMessage(QObject::tr("Initializing main window..."), Qt::AlignBottom | Qt::AlignHCenter, Qt::white);
     app.processEvents();
 
+    QuantilyxDoc::StartupTrace::Scope windowTrace("MainWindow");
     QuantilyxDoc::MainWindow window; // MainWindow constructor should connect to core systems, potentially show its own progress
+    windowTrace.end();
 
+    QuantilyxDoc::StartupTrace::Scope showTrace("Show window");
     splash.finish(&window); // Hide splash screen when main window is shown and ready
     window.show(); // Make the main window visible
+    showTrace.end();
 
     splash.showMessage(QObject::tr("Ready"), Qt::AlignBottom | Qt::AlignHCenter, Qt::white);
     app.processEvents(); // Allow final splash message to be seen briefly
 
     // --- Load initial file if provided via command line ---
     if (!fileNames.isEmpty()) {
-        QString filePath = fileNames.first(); // Open the first file specified
-        if (QFileInfo::exists(filePath)) {
-            LOG_INFO("Opening file from command line: " << filePath);
-            // MainWindow needs a method to open a document.
-            // This might involve DocumentFactory, showing a loading indicator, etc.
-            window.openDocument(filePath);
-        } else {
+        QStringList existing;
+        QStringList missing;
+        for (const QString& filePath : fileNames) {
+            (QFileInfo::exists(filePath) ? existing : missing).append(filePath);
+        }
+        for (const QString& filePath : missing) {
             LOG_WARN("Command line file does not exist: " << filePath);
-            QMessageBox::warning(&window, QObject::tr("File Not Found"),
-                                 QObject::tr("The file specified on the command line does not exist:\n%1").arg(filePath));
         }
-        // Future: Handle subsequent files (e.g., open in new tabs/windows if supported)
-        for (int i = 1; i < fileNames.size(); ++i) {
-             QString nextPath = fileNames[i];
-             if (QFileInfo::exists(nextPath)) {
-                 LOG_INFO("Additional file specified on command line (not opened in this instance): " << nextPath);
-                 // Example: window.openDocumentInNewTab(nextPath); // Hypothetical method
-             } else {
-                 LOG_WARN("Additional command line file does not exist: " << nextPath);
-             }
+        if (!missing.isEmpty()) {
+            QMessageBox::warning(&window, QObject::tr("File Not Found"),
+                                 QObject::tr("The file specified on the command line does not exist:\n%1").arg(missing.join("\n")));
         }
+        // Files load concurrently and appear as each finishes
+        LOG_INFO("Opening " << existing.size() << " file(s) from command line.");
+        window.openDocuments(existing);
     }
 
     // --- Handle Startup Tasks (e.g., restore session, check for updates) ---
     splash.showMessage(QObject::tr("Handling startup tasks..."), Qt::AlignBottom | Qt::AlignHCenter, Qt::white);
     app.processEvents();
 
-    // Example: Restore last session (open last files) - This logic typically resides in MainWindow
+    // Restore last session: the last screen shows at once while its documents load.
+    // Files named on the command line take its place.
     bool restoreSession = QuantilyxDoc::Settings::instance().value<bool>("General/RestoreSession", true);
-    if (restoreSession) {
-        // This logic would typically be in MainWindow or a SessionManager class
-        // QStringList lastFiles = Settings::instance().value<QStringList>("Session/LastOpenFiles", QStringList());
-        // for (const QString& file : lastFiles) {
-        //     if (QFileInfo::exists(file)) {
-        //         window.openDocument(file);
-        //     }
-        // }
-        LOG_DEBUG("Session restore logic would run here if enabled.");
-        // window.restoreLastSession(); // Hypothetical MainWindow method
+    if (restoreSession && fileNames.isEmpty()) {
+        window.restoreSession();
     }
 
     // Example: Check for updates (asynchronously, maybe after a delay)
@@ -366,6 +781,21 @@ int main(int argc, char *argv[])
         });
     }
 
+    // Optionally load OCR data in the background once the window has settled
+    if (QuantilyxDoc::Settings::instance().value<bool>("Advanced/OcrWarmUp", false)) {
+        const int delayMs = QuantilyxDoc::Settings::instance().value<int>("Advanced/OcrWarmUpDelayMs", 3000);
+        QTimer::singleShot(delayMs, &window, []() { QuantilyxDoc::OcrEngine::instance().warmUp(); });
+    }
+
+    // The trace ends once the event loop has run, so the first paint is in it
+    startupTrace.end();
+    if (QuantilyxDoc::StartupTrace::isEnabled()) {
+        QTimer::singleShot(0, &window, []() {
+            QuantilyxDoc::StartupTrace::instant("Event loop running");
+            QuantilyxDoc::StartupTrace::finish();
+        });
+    }
+
     LOG_INFO("QuantilyxDoc startup sequence finished. Starting event loop.");
 
     // --- Start the Qt Event Loop ---
@@ -394,11 +824,11 @@ int main(int argc, char *argv[])
 
     // Save full-text index changes (if any were made during the session)
     LOG_DEBUG("Committing full-text index changes...");
-    // QuantilyxDoc::FullTextIndex::instance().commit(); // Assuming this flushes changes
+    QuantilyxDoc::FullTextIndex::instance().commit();
 
     // Save duplicate detector state/cache (if applicable)
     LOG_DEBUG("Saving duplicate detector state...");
-    // QuantilyxDoc::DuplicateDetector::instance().saveState(); // Assuming this method exists
+    QuantilyxDoc::DuplicateDetector::instance().saveState();
 
     // Uninstall the crash handler
     LOG_DEBUG("Uninstalling crash handler...");
@@ -420,6 +850,7 @@ int main(int argc, char *argv[])
     LOG_DEBUG("Shutting down plugins...");
     // app.shutdownPlugins(); // Hypothetical method in Application
 
+    QuantilyxDoc::StartupTrace::finish(); // Does nothing unless the loop quit before the trace was written
     LOG_INFO("QuantilyxDoc shutdown sequence complete.");
     return returnCode; // Return the exit code from QApplication::exec()
 }
\ No newline at end of file
@@ -0,0 +1,419 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DocumentOcrJob.h"
+#include "OcrEngine.h"
+#include "../core/CancellationToken.h"
+#include "../core/Document.h"
+#include "../core/Page.h"
+#include "../core/Logger.h"
+#include "../core/ThreadPool.h"
+#include "../search/FullTextIndex.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstddef>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// On-disk layout: CheckpointHeader, the document path and the OCR language
+// in UTF-8, then per recognized page a PageRecord and its text in UTF-8,
+// appended as pages finish. Native byte order; checkpoints stay on this
+// machine. A record torn by a crash is cut off on the next load.
+struct CheckpointHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 pageCount;
+    quint32 dpi;
+    qint64 fileSize;
+    qint64 modified;
+    quint32 pathBytes;
+    quint32 languageBytes;
+    quint32 complete; // Set once every page is recorded
+    quint32 reserved;
+};
+
+struct PageRecord {
+    quint32 page;
+    float confidence;
+    quint32 textBytes;
+    quint32 reserved;
+};
+
+const quint32 CheckpointMagic = 0x51584F43; // "QXOC"
+const quint32 CheckpointVersion = 1;
+const char CheckpointSuffix[] = ".qxoc";
+const quint32 MaxStringBytes = 1u << 16;
+const quint32 MaxPageTextBytes = 16u << 20;
+
+QString checkpointDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/ocr";
+}
+
+QString checkpointFileFor(const QString& filePath)
+{
+    const QByteArray key = QCryptographicHash::hash(filePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return checkpointDirectory() + QLatin1Char('/') + QString::fromLatin1(key) + QLatin1String(CheckpointSuffix);
+}
+
+// Read the header, path and language; leaves the file at the first record
+bool readHeader(QFile& file, CheckpointHeader* header, QString* filePath, QString* language)
+{
+    if (file.read(reinterpret_cast<char*>(header), sizeof(*header)) != sizeof(*header)
+        || header->magic != CheckpointMagic || header->version != CheckpointVersion
+        || header->pathBytes > MaxStringBytes || header->languageBytes > MaxStringBytes) {
+        return false;
+    }
+    const QByteArray path = file.read(header->pathBytes);
+    const QByteArray lang = file.read(header->languageBytes);
+    if (path.size() != int(header->pathBytes) || lang.size() != int(header->languageBytes)) return false;
+    *filePath = QString::fromUtf8(path);
+    *language = QString::fromUtf8(lang);
+    return true;
+}
+
+} // namespace
+
+class DocumentOcrJob::Private {
+public:
+    Private(DocumentOcrJob* q_ptr, Document* doc)
+        : q(q_ptr), document(doc), dpi(0), doneCount(0), doneAtStart(0)
+        , journalFailed(false), running(false) {}
+
+    DocumentOcrJob* q;
+    Document* document;
+    QString filePath;
+    QString checkpointFile;
+    QString language;
+    int dpi;
+
+    mutable QMutex mutex; // Protects the page results and the journal
+    QStringList texts;
+    QVector<bool> done;
+    int doneCount;
+    int doneAtStart;
+    QElapsedTimer clock;
+    QFile journal;
+    bool journalFailed;
+
+    CancellationToken token; // Of the current run; renders and recognition check it
+    std::atomic<bool> running;
+    QMutex runMutex;
+    QWaitCondition stopped;
+
+    float rateLocked() const {
+        const qint64 elapsedMs = clock.isValid() ? clock.elapsed() : 0;
+        return elapsedMs > 0 ? float(doneCount - doneAtStart) * 60000.0f / float(elapsedMs) : 0.0f;
+    }
+
+    // Take the pages of a checkpoint written for this file and these
+    // settings. Called with mutex held, before the run.
+    bool loadCheckpoint(const QFileInfo& info) {
+        QFile file(checkpointFile);
+        if (!file.open(QIODevice::ReadWrite)) return false;
+
+        CheckpointHeader header;
+        QString storedPath, storedLanguage;
+        if (!readHeader(file, &header, &storedPath, &storedLanguage)
+            || storedPath != filePath || storedLanguage != language
+            || header.pageCount != quint32(texts.size()) || header.dpi != quint32(dpi)
+            || header.fileSize != info.size() || header.modified != info.lastModified().toMSecsSinceEpoch()) {
+            return false;
+        }
+
+        qint64 good = file.pos();
+        for (;;) {
+            PageRecord record;
+            if (file.read(reinterpret_cast<char*>(&record), sizeof(record)) != sizeof(record)
+                || record.page >= header.pageCount || record.textBytes > MaxPageTextBytes) {
+                break;
+            }
+            const QByteArray text = file.read(record.textBytes);
+            if (text.size() != int(record.textBytes)) break;
+            texts[int(record.page)] = QString::fromUtf8(text);
+            if (!done[int(record.page)]) {
+                done[int(record.page)] = true;
+                ++doneCount;
+            }
+            good = file.pos();
+        }
+        // A record torn by a crash would hide the ones appended after it
+        if (file.size() > good && !file.resize(good)) return false;
+        return true;
+    }
+
+    // Start an empty checkpoint. Called with mutex held, before the run.
+    bool writeCheckpointHeader(const QFileInfo& info) {
+        QFile file(checkpointFile);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        const QByteArray path = filePath.toUtf8();
+        const QByteArray lang = language.toUtf8();
+        const CheckpointHeader header = {CheckpointMagic, CheckpointVersion, quint32(texts.size()), quint32(dpi),
+                                         info.size(), info.lastModified().toMSecsSinceEpoch(),
+                                         quint32(path.size()), quint32(lang.size()), 0, 0};
+        return file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+               && file.write(path) == path.size() && file.write(lang) == lang.size() && file.flush();
+    }
+
+    bool markCheckpointComplete() {
+        QFile file(checkpointFile);
+        const quint32 complete = 1;
+        return file.open(QIODevice::ReadWrite) && file.seek(offsetof(CheckpointHeader, complete))
+               && file.write(reinterpret_cast<const char*>(&complete), sizeof(complete)) == sizeof(complete);
+    }
+
+    // Render a batch of pages and recognize them together
+    void recognizePages(const QVector<int>& indices) {
+        QVector<int> rendered;
+        QList<QImage> images;
+        for (int index : indices) {
+            Page* page = document->page(index);
+            if (!page) continue;
+            const QSizeF size = page->size();
+            if (size.isEmpty()) continue;
+            const QImage image = page->render(qMax(1, qRound(size.width() * dpi / 72.0)), qMax(1, qRound(size.height() * dpi / 72.0)), dpi);
+            if (CancellationToken::currentIsCanceled()) return; // The image may be partial
+            if (image.isNull()) {
+                LOG_WARN("DocumentOcrJob: Could not render page " << index << " of " << filePath);
+                continue;
+            }
+            rendered.append(index);
+            images.append(image);
+        }
+        if (images.isEmpty()) return;
+        const QList<OcrResult> results = OcrEngine::instance().recognizeBatch(images);
+        if (CancellationToken::currentIsCanceled()) return; // Not journaled as recognized
+        for (int k = 0; k < rendered.size() && k < results.size(); ++k) record(rendered[k], results[k]);
+    }
+
+    void record(int index, const OcrResult& result) {
+        int pagesDone;
+        float rate;
+        {
+            QMutexLocker locker(&mutex);
+            texts[index] = result.text;
+            if (!done[index]) {
+                done[index] = true;
+                ++doneCount;
+            }
+
+            // One write per record, flushed, so a crash loses at most the pages in progress
+            const QByteArray text = result.text.toUtf8();
+            const PageRecord pageRecord = {quint32(index), result.confidence, quint32(text.size()), 0};
+            QByteArray bytes(reinterpret_cast<const char*>(&pageRecord), sizeof(pageRecord));
+            bytes.append(text);
+            if (!journalFailed && (journal.write(bytes) != bytes.size() || !journal.flush())) {
+                journalFailed = true;
+                LOG_WARN("DocumentOcrJob: Cannot write checkpoint " << checkpointFile << ": " << journal.errorString());
+            }
+            pagesDone = doneCount;
+            rate = rateLocked();
+        }
+        emit q->pageRecognized(index, result.confidence);
+        emit q->progress(pagesDone, texts.size(), rate);
+    }
+
+    void run() {
+        CancellationScope scope(token);
+        QVector<int> remaining;
+        int pageTotal;
+        int pagesDone;
+        {
+            QMutexLocker locker(&mutex);
+            for (int i = 0; i < done.size(); ++i) {
+                if (!done[i]) remaining.append(i);
+            }
+            pageTotal = texts.size();
+            pagesDone = doneCount;
+        }
+        emit q->started(pagesDone, pageTotal);
+
+        // Batches as the backend prefers them; one page each for Tesseract.
+        // Once canceled, forEach skips the batches not started and the
+        // running ones stop inside their render or recognition.
+        const int batchSize = qMax(1, OcrEngine::instance().preferredBatchSize());
+        const int batchCount = (remaining.size() + batchSize - 1) / batchSize;
+        ThreadPool::instance().forEach(batchCount, [this, &remaining, batchSize](int i) {
+            recognizePages(remaining.mid(i * batchSize, batchSize));
+        }, Task::Priority::Low);
+
+        QStringList pages;
+        float rate;
+        {
+            QMutexLocker locker(&mutex);
+            journal.close();
+            pages = texts;
+            pagesDone = doneCount;
+            rate = rateLocked();
+        }
+
+        const bool success = pagesDone == pageTotal;
+        if (success) {
+            if (!markCheckpointComplete()) LOG_WARN("DocumentOcrJob: Cannot mark checkpoint " << checkpointFile << " complete.");
+            if (FullTextIndex::instance().isReady() && !FullTextIndex::instance().indexText(document, pages)) {
+                LOG_WARN("DocumentOcrJob: Could not index the text of " << filePath);
+            }
+            LOG_INFO("DocumentOcrJob: Recognized " << pageTotal << " pages of " << filePath << " at " << rate << " pages/min.");
+        } else if (token.isCanceled()) {
+            LOG_INFO("DocumentOcrJob: Canceled with " << pagesDone << " of " << pageTotal << " pages of " << filePath << " recognized.");
+        } else {
+            LOG_WARN("DocumentOcrJob: " << pageTotal - pagesDone << " pages of " << filePath << " could not be recognized.");
+            emit q->failed(QString("%1 of %2 pages could not be recognized.").arg(pageTotal - pagesDone).arg(pageTotal));
+        }
+
+        emit q->finished(success);
+
+        // Last touch of the job: its destructor may go ahead from here
+        QMutexLocker locker(&runMutex);
+        running = false;
+        stopped.wakeAll();
+    }
+};
+
+DocumentOcrJob::DocumentOcrJob(Document* document, QObject* parent)
+    : QObject(parent)
+    , d(new Private(this, document))
+{
+    if (document) d->filePath = document->filePath();
+    if (!d->filePath.isEmpty()) d->checkpointFile = checkpointFileFor(d->filePath);
+}
+
+DocumentOcrJob::~DocumentOcrJob()
+{
+    cancel();
+    QMutexLocker locker(&d->runMutex);
+    while (d->running) d->stopped.wait(&d->runMutex);
+}
+
+Document* DocumentOcrJob::document() const
+{
+    return d->document;
+}
+
+bool DocumentOcrJob::start(bool restart)
+{
+    if (d->running) return false;
+    if (!d->document || d->filePath.isEmpty()) {
+        emit failed("The document has no file to keep a checkpoint for.");
+        return false;
+    }
+    OcrEngine& engine = OcrEngine::instance();
+    if (!engine.isReady()) {
+        LOG_ERROR("DocumentOcrJob: OcrEngine is not ready.");
+        emit failed("OCR Engine not initialized.");
+        return false;
+    }
+    const int pageTotal = d->document->pageCount();
+    if (pageTotal <= 0) {
+        emit failed("The document has no pages.");
+        return false;
+    }
+
+    const QFileInfo info(d->filePath);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->dpi = engine.resolution();
+        d->language = engine.currentLanguage();
+        d->texts = QVector<QString>(pageTotal).toList();
+        d->done.fill(false, pageTotal);
+        d->doneCount = 0;
+        d->journalFailed = false;
+
+        QDir().mkpath(checkpointDirectory());
+        const bool resumed = !restart && d->loadCheckpoint(info);
+        if (!resumed && !d->writeCheckpointHeader(info)) {
+            LOG_WARN("DocumentOcrJob: Cannot write checkpoint " << d->checkpointFile << "; progress will not survive a restart.");
+            d->journalFailed = true;
+        }
+        if (!d->journalFailed && !d->journal.isOpen()) {
+            d->journal.setFileName(d->checkpointFile);
+            if (!d->journal.open(QIODevice::WriteOnly | QIODevice::Append)) d->journalFailed = true;
+        }
+        if (resumed) LOG_INFO("DocumentOcrJob: Resuming " << d->filePath << " with " << d->doneCount << " of " << pageTotal << " pages done.");
+
+        d->doneAtStart = d->doneCount;
+        d->clock.start();
+    }
+
+    d->token = CancellationToken::create(CancellationToken());
+    d->running = true;
+    ThreadPool::instance().submitDetached([this]() { d->run(); }, Task::Priority::Low);
+    return true;
+}
+
+void DocumentOcrJob::cancel()
+{
+    if (d->running) d->token.cancel();
+}
+
+bool DocumentOcrJob::isRunning() const
+{
+    return d->running;
+}
+
+int DocumentOcrJob::pageCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->texts.size();
+}
+
+int DocumentOcrJob::pagesDone() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->doneCount;
+}
+
+float DocumentOcrJob::pagesPerMinute() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->rateLocked();
+}
+
+QStringList DocumentOcrJob::pageTexts() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->texts;
+}
+
+QString DocumentOcrJob::checkpointPath() const
+{
+    return d->checkpointFile;
+}
+
+QStringList DocumentOcrJob::unfinishedFiles()
+{
+    QStringList files;
+    QDirIterator it(checkpointDirectory(), QStringList() << QString("*") + CheckpointSuffix, QDir::Files);
+    while (it.hasNext()) {
+        QFile file(it.next());
+        CheckpointHeader header;
+        QString filePath, language;
+        if (file.open(QIODevice::ReadOnly) && readHeader(file, &header, &filePath, &language)
+            && !header.complete && QFileInfo::exists(filePath)) {
+            files.append(filePath);
+        }
+    }
+    files.sort();
+    return files;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,162 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DOCUMENTOCRJOB_H
+#define QUANTILYX_DOCUMENTOCRJOB_H
+
+#include <QObject>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document; // Forward declaration
+
+/**
+ * @brief Recognizes every page of a document in the background, resumably.
+ *
+ * Pages are rendered at OcrEngine::resolution() on the CPU thread pool and
+ * recognized in batches of OcrEngine::preferredBatchSize(): one page at a
+ * time per Tesseract handle, or several at once on the GPU. Each page's
+ * text is appended to a checkpoint file in the application data directory
+ * as soon as it is recognized, so a job started again for the same file,
+ * after a crash or after the application was closed mid-run, only
+ * recognizes the pages still missing. A
+ * checkpoint is used only while the file's size and modification time and
+ * the engine's resolution and language are those it was written with.
+ *
+ * Once every page is done the text is handed to FullTextIndex, and the
+ * checkpoint stays as the document's OCR text.
+ *
+ * Signals are emitted from worker threads. The document must outlive the
+ * job; deleting the job cancels it and waits for the pages in progress.
+ */
+class DocumentOcrJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param document The document to recognize.
+     * @param parent Parent object.
+     */
+    explicit DocumentOcrJob(Document* document, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor. Cancels the job and waits for it to stop.
+     */
+    ~DocumentOcrJob() override;
+
+    /**
+     * @brief Get the document being recognized.
+     * @return Pointer to the document.
+     */
+    Document* document() const;
+
+    /**
+     * @brief Start recognizing the pages not in the checkpoint.
+     * @param restart If true, discard the checkpoint and recognize every page.
+     * @return True if the job started; false if it is running, the engine
+     *         is not ready or the document has no file or pages.
+     */
+    bool start(bool restart = false);
+
+    /**
+     * @brief Stop soon; pages in progress are abandoned mid-render or
+     * mid-recognition. The checkpoint keeps what is done.
+     */
+    void cancel();
+
+    /**
+     * @brief Check if the job is running.
+     * @return True between start() and finished().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Get the number of pages in the document.
+     * @return Page count, known once started.
+     */
+    int pageCount() const;
+
+    /**
+     * @brief Get the number of pages recognized, including those from the checkpoint.
+     * @return Count of recognized pages.
+     */
+    int pagesDone() const;
+
+    /**
+     * @brief Get the recognition rate of the current or last run.
+     * Pages taken from the checkpoint do not count.
+     * @return Pages recognized per minute.
+     */
+    float pagesPerMinute() const;
+
+    /**
+     * @brief Get the recognized text of every page.
+     * @return Text per page, in page order; empty for pages not done yet.
+     */
+    QStringList pageTexts() const;
+
+    /**
+     * @brief Get the checkpoint file of the document.
+     * @return Path of the checkpoint file.
+     */
+    QString checkpointPath() const;
+
+    /**
+     * @brief Get the files with a checkpoint of an unfinished job, to offer resuming them.
+     * @return Paths of documents whose recognition was interrupted.
+     */
+    static QStringList unfinishedFiles();
+
+signals:
+    /**
+     * @brief Emitted when the job starts.
+     * @param pagesDone Pages already recognized, from the checkpoint.
+     * @param pageCount Pages in the document.
+     */
+    void started(int pagesDone, int pageCount);
+
+    /**
+     * @brief Emitted after each page is recognized and checkpointed.
+     * @param pageIndex Index of the page.
+     * @param confidence Recognition confidence (0.0 - 1.0).
+     */
+    void pageRecognized(int pageIndex, float confidence);
+
+    /**
+     * @brief Emitted after each page with the job's progress.
+     * @param pagesDone Pages recognized, including those from the checkpoint.
+     * @param pageCount Pages in the document.
+     * @param pagesPerMinute Recognition rate of this run.
+     */
+    void progress(int pagesDone, int pageCount, float pagesPerMinute);
+
+    /**
+     * @brief Emitted when the job stops.
+     * @param success True if every page was recognized.
+     */
+    void finished(bool success);
+
+    /**
+     * @brief Emitted when the job cannot start or pages could not be recognized.
+     * @param error Error message.
+     */
+    void failed(const QString& error);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DOCUMENTOCRJOB_H
@@ -0,0 +1,36 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "OcrBackend.h"
+#include "TesseractBackend.h"
+#include "PaddleOcrBackend.h"
+
+namespace QuantilyxDoc {
+
+std::unique_ptr<OcrBackend> OcrBackend::create(const QString& name)
+{
+    const QString key = name.toLower();
+    if (key == QLatin1String("tesseract")) return std::unique_ptr<OcrBackend>(new TesseractBackend());
+#ifdef HAVE_PADDLEOCR
+    if (key == QLatin1String("paddleocr")) return std::unique_ptr<OcrBackend>(new PaddleOcrBackend());
+#endif
+    return nullptr;
+}
+
+QStringList OcrBackend::availableBackends()
+{
+    QStringList names;
+    names << "tesseract";
+#ifdef HAVE_PADDLEOCR
+    names << "paddleocr";
+#endif
+    return names;
+}
+
+} // namespace QuantilyxDoc
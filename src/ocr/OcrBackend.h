@@ -0,0 +1,114 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_OCRBACKEND_H
+#define QUANTILYX_OCRBACKEND_H
+
+#include "OcrEngine.h"
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Recognition library behind OcrEngine.
+ *
+ * A backend turns images into OcrResult. OcrEngine does everything around
+ * it, the same for each backend: result caching, preprocessing when the
+ * backend wants it, and mapping boxes back to the image passed in. The
+ * engine selects a backend from the Ocr/Backend setting.
+ *
+ * recognize() is called from several threads at once; a backend limits
+ * the work it runs in parallel itself.
+ */
+class OcrBackend
+{
+public:
+    virtual ~OcrBackend() = default;
+
+    /**
+     * @brief Create a backend by name.
+     * @param name Backend name, as in availableBackends().
+     * @return The backend, or null if it is unknown or not built in.
+     */
+    static std::unique_ptr<OcrBackend> create(const QString& name);
+
+    /**
+     * @brief Get the names of the backends built in.
+     * @return Backend names, the default first.
+     */
+    static QStringList availableBackends();
+
+    /**
+     * @brief Get the backend's name.
+     * @return Name, as in availableBackends().
+     */
+    virtual QString name() const = 0;
+
+    /**
+     * @brief Get the data directory used when none is given.
+     * @return Path of the language data or model directory.
+     */
+    virtual QString defaultDatapath() const = 0;
+
+    /**
+     * @brief Set the backend up for a language, loading its data.
+     * May be called again while recognitions run; they finish with the old setup.
+     * @param language Language code, several joined with '+'.
+     * @param datapath Language data or model directory.
+     * @return True if the backend can recognize with this setup.
+     */
+    virtual bool configure(const QString& language, const QString& datapath) = 0;
+
+    /**
+     * @brief Get the languages the data directory holds.
+     * @param datapath Language data or model directory.
+     * @return Language codes.
+     */
+    virtual QStringList supportedLanguages(const QString& datapath) const = 0;
+
+    /**
+     * @brief Get the number of recognize() calls that can run at once.
+     * @return Maximum concurrent recognitions.
+     */
+    virtual int maxConcurrentRecognitions() const = 0;
+
+    /**
+     * @brief Get the number of images best handed to recognize() together.
+     * @return Preferred batch size; 1 if batching brings nothing.
+     */
+    virtual int preferredBatchSize() const = 0;
+
+    /**
+     * @brief Check if images should go through OcrPreprocessor first.
+     * @return True for engines that want clean binary images.
+     */
+    virtual bool wantsPreprocessing() const = 0;
+
+    /**
+     * @brief Check if the results are worth keeping in OcrResultCache.
+     * @return False while the backend only produces placeholders.
+     */
+    virtual bool resultsCacheable() const = 0;
+
+    /**
+     * @brief Recognize a batch of images.
+     * @param images Images to recognize; none is null.
+     * @param dpi Resolution the images were rendered at.
+     * @return One result per image, in order, with boxes in image coordinates.
+     */
+    virtual QList<OcrResult> recognize(const QList<QImage>& images, int dpi) = 0;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_OCRBACKEND_H
@@ -0,0 +1,197 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "OcrElementIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const int MaxGridSide = 256;
+// Posting lists intersected for a search; the rest would cost more than checking
+const int MaxIntersectedTrigrams = 3;
+
+// Closed-interval overlap, so zero-width regions and boxes still meet
+bool overlaps(const QRectF& a, const QRectF& b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+} // namespace
+
+OcrElementIndex::OcrElementIndex()
+    : m_columns(0), m_rows(0)
+{
+}
+
+OcrElementIndex::~OcrElementIndex() = default;
+
+quint64 OcrElementIndex::trigramKey(const QChar* at)
+{
+    return (quint64(at[0].unicode()) << 32) | (quint64(at[1].unicode()) << 16) | quint64(at[2].unicode());
+}
+
+void OcrElementIndex::clear()
+{
+    m_boxes.clear();
+    m_bounds = QRectF();
+    m_columns = 0;
+    m_rows = 0;
+    m_cells.clear();
+    m_trigrams.clear();
+    m_lines.clear();
+}
+
+void OcrElementIndex::build(const QVector<QPair<QString, QRectF>>& elements)
+{
+    clear();
+    if (elements.isEmpty()) return;
+
+    m_boxes.reserve(elements.size());
+    bool first = true;
+    for (const auto& element : elements) {
+        const QRectF box = element.second.normalized();
+        m_boxes.append(box);
+        if (box.isNull()) continue; // Elements without a box are found by text only
+        m_bounds = first ? box : m_bounds.united(box);
+        first = false;
+    }
+
+    // Grid cells about as many as elements / ElementsPerCell, square-ish in page units
+    if (!first) {
+        const int cellCount = qMax(1, m_boxes.size() / ElementsPerCell);
+        const qreal aspect = m_bounds.height() > 0 ? m_bounds.width() / m_bounds.height() : 1.0;
+        m_columns = qBound(1, int(std::lround(std::sqrt(cellCount * aspect))), MaxGridSide);
+        m_rows = qBound(1, (cellCount + m_columns - 1) / m_columns, MaxGridSide);
+        m_cells.resize(m_columns * m_rows);
+        const qreal cellWidth = m_bounds.width() > 0 ? m_bounds.width() / m_columns : 1.0;
+        const qreal cellHeight = m_bounds.height() > 0 ? m_bounds.height() / m_rows : 1.0;
+        for (int i = 0; i < m_boxes.size(); ++i) {
+            if (m_boxes[i].isNull()) continue;
+            const int c0 = qBound(0, int((m_boxes[i].left() - m_bounds.left()) / cellWidth), m_columns - 1);
+            const int c1 = qBound(0, int((m_boxes[i].right() - m_bounds.left()) / cellWidth), m_columns - 1);
+            const int r0 = qBound(0, int((m_boxes[i].top() - m_bounds.top()) / cellHeight), m_rows - 1);
+            const int r1 = qBound(0, int((m_boxes[i].bottom() - m_bounds.top()) / cellHeight), m_rows - 1);
+            for (int r = r0; r <= r1; ++r) {
+                for (int c = c0; c <= c1; ++c) m_cells[r * m_columns + c].append(i);
+            }
+        }
+    }
+
+    // Each element once per trigram, so posting lists stay ascending and unique
+    for (int i = 0; i < elements.size(); ++i) {
+        const QString folded = elements[i].first.toCaseFolded();
+        for (int at = 0; at + 3 <= folded.size(); ++at) {
+            QVector<int>& postings = m_trigrams[trigramKey(folded.constData() + at)];
+            if (postings.isEmpty() || postings.last() != i) postings.append(i);
+        }
+    }
+
+    // Lines: elements in order of their tops join the open line they overlap most
+    QVector<int> order;
+    for (int i = 0; i < m_boxes.size(); ++i) {
+        if (!m_boxes[i].isNull()) order.append(i);
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return m_boxes[a].top() < m_boxes[b].top() || (m_boxes[a].top() == m_boxes[b].top() && m_boxes[a].left() < m_boxes[b].left());
+    });
+    QVector<QPair<qreal, qreal>> extents; // Top and bottom of each line
+    QVector<int> open;
+    for (int i : order) {
+        const QRectF& box = m_boxes[i];
+        // Later elements start lower, so a line ending above this one is done
+        open.erase(std::remove_if(open.begin(), open.end(), [&](int line) { return extents[line].second < box.top(); }), open.end());
+        int best = -1;
+        qreal bestOverlap = 0;
+        for (int line : open) {
+            const qreal overlap = qMin(extents[line].second, box.bottom()) - qMax(extents[line].first, box.top());
+            const qreal needed = 0.5 * qMin(extents[line].second - extents[line].first, box.height());
+            if (overlap >= needed && overlap > bestOverlap) {
+                best = line;
+                bestOverlap = overlap;
+            }
+        }
+        if (best < 0) {
+            best = m_lines.size();
+            m_lines.append(QVector<int>());
+            extents.append(qMakePair(box.top(), box.bottom()));
+            open.append(best);
+        } else {
+            extents[best].first = qMin(extents[best].first, box.top());
+            extents[best].second = qMax(extents[best].second, box.bottom());
+        }
+        m_lines[best].append(i);
+    }
+    for (QVector<int>& line : m_lines) {
+        std::sort(line.begin(), line.end(), [this](int a, int b) { return m_boxes[a].left() < m_boxes[b].left(); });
+    }
+}
+
+QVector<int> OcrElementIndex::intersecting(const QRectF& region) const
+{
+    QVector<int> found;
+    if (m_cells.isEmpty()) return found;
+    const QRectF area = region.normalized();
+    if (!overlaps(area, m_bounds)) return found;
+
+    const qreal cellWidth = m_bounds.width() > 0 ? m_bounds.width() / m_columns : 1.0;
+    const qreal cellHeight = m_bounds.height() > 0 ? m_bounds.height() / m_rows : 1.0;
+    const int c0 = qBound(0, int((area.left() - m_bounds.left()) / cellWidth), m_columns - 1);
+    const int c1 = qBound(0, int((area.right() - m_bounds.left()) / cellWidth), m_columns - 1);
+    const int r0 = qBound(0, int((area.top() - m_bounds.top()) / cellHeight), m_rows - 1);
+    const int r1 = qBound(0, int((area.bottom() - m_bounds.top()) / cellHeight), m_rows - 1);
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            for (int i : m_cells[r * m_columns + c]) {
+                if (overlaps(m_boxes[i], area)) found.append(i);
+            }
+        }
+    }
+    // A box spanning several cells is met in each
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+QVector<int> OcrElementIndex::candidates(const QString& text) const
+{
+    const QString folded = text.toCaseFolded();
+    QVector<int> result;
+    if (folded.size() < 3) {
+        result.reserve(m_boxes.size());
+        for (int i = 0; i < m_boxes.size(); ++i) result.append(i);
+        return result;
+    }
+
+    QVector<const QVector<int>*> lists;
+    for (int at = 0; at + 3 <= folded.size(); ++at) {
+        const auto it = m_trigrams.constFind(trigramKey(folded.constData() + at));
+        if (it == m_trigrams.constEnd()) return result; // No element holds this trigram
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) { return a->size() < b->size(); });
+    result = *lists.first();
+    for (int k = 1; k < qMin(lists.size(), MaxIntersectedTrigrams) && !result.isEmpty(); ++k) {
+        QVector<int> both;
+        std::set_intersection(result.constBegin(), result.constEnd(), lists[k]->constBegin(), lists[k]->constEnd(),
+                              std::back_inserter(both));
+        result.swap(both);
+    }
+    return result;
+}
+
+const QVector<QVector<int>>& OcrElementIndex::lines() const
+{
+    return m_lines;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,91 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_OCRELEMENTINDEX_H
+#define QUANTILYX_OCRELEMENTINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Finds a page's OCR elements by place and by text without a pass over all of them.
+ *
+ * Element boxes are binned into a uniform grid of about
+ * ElementsPerCell elements a cell, so a region looks only at the cells it
+ * covers. Case-folded element text is indexed by its trigrams, so a
+ * search of three or more characters only checks the elements holding
+ * its rarest trigram; shorter ones check every element. Lines are found
+ * once, when the index is built.
+ *
+ * Built from a fixed list of elements and not thread-safe.
+ */
+class OcrElementIndex
+{
+public:
+    /// Elements a grid cell holds on average
+    static const int ElementsPerCell = 2;
+
+    OcrElementIndex();
+    ~OcrElementIndex();
+
+    /**
+     * @brief Index elements, replacing those indexed before.
+     * @param elements Element text and box, as OcrPage holds them.
+     */
+    void build(const QVector<QPair<QString, QRectF>>& elements);
+
+    /**
+     * @brief Drop every element.
+     */
+    void clear();
+
+    /**
+     * @brief Get the elements whose boxes intersect a region.
+     * @param region Region in the boxes' coordinates.
+     * @return Element indices, ascending.
+     */
+    QVector<int> intersecting(const QRectF& region) const;
+
+    /**
+     * @brief Get the elements whose text may contain a string.
+     * Every element that does is returned; some that do not may be.
+     * @param text String searched for.
+     * @return Element indices, ascending.
+     */
+    QVector<int> candidates(const QString& text) const;
+
+    /**
+     * @brief Get the elements grouped into lines.
+     * Elements overlapping vertically by half the shorter one's height
+     * share a line.
+     * @return Per line, top to bottom, its element indices left to right.
+     */
+    const QVector<QVector<int>>& lines() const;
+
+private:
+    static quint64 trigramKey(const QChar* at);
+
+    QVector<QRectF> m_boxes;
+    QRectF m_bounds;
+    int m_columns;
+    int m_rows;
+    QVector<QVector<int>> m_cells;
+    QHash<quint64, QVector<int>> m_trigrams;
+    QVector<QVector<int>> m_lines;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_OCRELEMENTINDEX_H
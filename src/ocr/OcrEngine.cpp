@@ -8,7 +8,15 @@
  * (at your option) any later version.
  */
 #include "OcrEngine.h"
+#include "OcrBackend.h"
+#include "OcrPreprocessor.h"
+#include "OcrResultCache.h"
+#include "../core/CancellationToken.h"
+#include "../core/LatencyHistogram.h"
 #include "../core/Logger.h"
+#include "../core/Settings.h"
+#include "../core/ThreadPool.h"
+#include <QElapsedTimer>
 #include <QImage>
 #include <QRectF>
 #include <QFuture>
@@ -16,43 +24,118 @@
 #include <QThread>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QTransform>
+#include <QVector>
 #include <QDebug>
-// #include <tesseract/baseapi.h> // Hypothetical Tesseract C++ API header
-// #include <leptonica/allheaders.h> // Hypothetical Leptonica header for image handling with Tesseract
 
 namespace QuantilyxDoc {
 
+namespace {
+
+const char* const DefaultBackend = "tesseract";
+
+OcrResult emptyResult()
+{
+    OcrResult result;
+    result.confidence = 0.0f;
+    return result;
+}
+
+} // namespace
+
 class OcrEngine::Private {
 public:
     Private(OcrEngine* q_ptr)
-        : q(q_ptr), initialized(false), resolutionVal(300), confidenceThresholdVal(0.5f) {}
+        : q(q_ptr), initialized(false), attempted(false), resolutionVal(300), confidenceThresholdVal(0.5f) {}
 
     OcrEngine* q;
-    mutable QMutex mutex; // Protect access to the Tesseract API instance if shared across threads
-    // tesseract::TessBaseAPI* tessApi; // Hypothetical Tesseract API instance
+    mutable QMutex mutex; // Protects the settings and the backend pointer
+    QMutex initMutex;     // Held for a whole deferred initialization, so it runs once
     bool initialized;
+    bool attempted;       // A backend was set up, whether or not it worked
     QString currentLanguageCode;
     QString datapathStr;
     int resolutionVal;
     float confidenceThresholdVal;
+    // Shared with the recognitions running, so a switch of backend leaves them be
+    std::shared_ptr<OcrBackend> backend;
+    LatencyHistogram recognitionLatency;
+
+    std::shared_ptr<OcrBackend> currentBackend() const {
+        QMutexLocker locker(&mutex);
+        return backend;
+    }
+
+    // Create and set up a backend, falling back to the default if it is not built in
+    bool setUp(const QString& name, const QString& language, const QString& datapath) {
+        std::shared_ptr<OcrBackend> created(OcrBackend::create(name));
+        if (!created) {
+            LOG_WARN("OcrEngine: OCR backend '" << name << "' is not available, using " << DefaultBackend);
+            created = std::shared_ptr<OcrBackend>(OcrBackend::create(DefaultBackend));
+        }
+        const QString path = datapath.isEmpty() ? created->defaultDatapath() : datapath;
+        const bool success = created->configure(language, path);
+
+        QMutexLocker locker(&mutex);
+        currentLanguageCode = language;
+        datapathStr = path;
+        backend = created;
+        initialized = success;
+        attempted = true;
+        return success;
+    }
+
+    // Set the backend up on first use, with the language and datapath given
+    // to deferInitialization() or else the settings. Loading language data
+    // can take seconds, so whichever thread needs OCR first pays for it
+    // and the others wait for the same result.
+    bool ensureInitialized() {
+        {
+            QMutexLocker locker(&mutex);
+            if (attempted) return initialized;
+        }
+        QMutexLocker initLocker(&initMutex);
+        QString language;
+        QString path;
+        {
+            QMutexLocker locker(&mutex);
+            if (attempted) return initialized;
+            language = currentLanguageCode;
+            path = datapathStr;
+        }
+        const QString name = Settings::instance().value<QString>("Ocr/Backend", DefaultBackend);
+        if (language.isEmpty()) language = Settings::instance().value<QString>("Ocr/Language", "eng");
+        if (path.isEmpty()) {
+            path = Settings::instance().value<QString>(name == "paddleocr" ? "Ocr/PaddleModelPath" : "Ocr/TessDataPath", QString());
+        }
+        return q->initialize(language, path);
+    }
+
+    static bool preprocessing() {
+        return Settings::instance().value<bool>("Advanced/OcrPreprocess", true);
+    }
+
+    // Key of an image in OcrResultCache under the current settings; empty if the cache is closed
+    QByteArray cacheKey(const QImage& image, const OcrBackend& engine, int dpi, bool preprocessed) const {
+        if (!OcrResultCache::instance().isReady()) return QByteArray();
+        QString language;
+        {
+            QMutexLocker locker(&mutex);
+            language = currentLanguageCode;
+        }
+        return OcrResultCache::keyFor(image, engine.name(), language, dpi, preprocessed);
+    }
 
-    // Helper to convert QImage to Pix (Leptonica format) for Tesseract
-    // Pix* qImageToPix(const QImage& image) const {
-    //     // This conversion is complex and depends on the image format.
-    //     // Leptonica provides functions like pixCreateFromQImage or similar.
-    //     // For now, assume a conversion exists.
-    //     // Example using hypothetical function:
-    //     // return pixCreateFromQImage(image);
-    //     LOG_WARN("OcrEngine::qImageToPix: Requires Leptonica integration.");
-    //     return nullptr; // Placeholder
-    // }
-
-    // Helper to convert Pix (Leptonica format) back to QImage
-    // QImage pixToQImage(Pix* pix) const {
-    //     // Reverse conversion
-    //     LOG_WARN("OcrEngine::pixToQImage: Requires Leptonica integration.");
-    //     return QImage(); // Placeholder
-    // }
+    // Clean the image up when the backend wants it, before it is handed over,
+    // so backends hold their resources only while recognizing
+    static OcrPreprocessor::Result prepare(const QImage& image, int dpi, bool preprocessed) {
+        if (!preprocessed) {
+            OcrPreprocessor::Result unchanged;
+            unchanged.image = image;
+            return unchanged;
+        }
+        return OcrPreprocessor::process(image, dpi);
+    }
 };
 
 // Static instance pointer
@@ -70,83 +153,89 @@ OcrEngine::OcrEngine(QObject* parent)
     : QObject(parent)
     , d(new Private(this))
 {
-    // d->tessApi = new tesseract::TessBaseAPI(); // Initialize Tesseract API
     LOG_INFO("OcrEngine created.");
 }
 
 OcrEngine::~OcrEngine()
 {
-    // if (d->tessApi) {
-    //     d->tessApi->End(); // Cleanup Tesseract
-    //     delete d->tessApi;
-    // }
     LOG_INFO("OcrEngine destroyed.");
 }
 
 bool OcrEngine::initialize(const QString& language, const QString& datapath)
 {
-    QMutexLocker locker(&d->mutex);
-
-    // This is where the actual Tesseract initialization happens.
-    // int initResult = d->tessApi->Init(datapath.isEmpty() ? nullptr : datapath.toUtf8().constData(), language.toUtf8().constData());
-    // if (initResult != 0) {
-    //     LOG_ERROR("OcrEngine: Failed to initialize Tesseract API for language '" << language << "', datapath: " << datapath);
-    //     d->initialized = false;
-    //     emit initializationComplete(false);
-    //     return false;
-    // }
+    const QString name = Settings::instance().value<QString>("Ocr/Backend", DefaultBackend);
+    const bool success = d->setUp(name, language, datapath);
+    if (success) {
+        LOG_INFO("OcrEngine: Initialized " << backendName() << " with language '" << language << "', datapath: " << this->datapath()
+                 << ", up to " << maxConcurrentRecognitions() << " recognitions at once");
+    } else {
+        LOG_ERROR("OcrEngine: Failed to initialize " << backendName() << " for language '" << language << "', datapath: " << this->datapath());
+    }
+    emit initializationComplete(success);
+    return success;
+}
 
-    // d->tessApi->SetVariable("tessedit_char_whitelist", ""); // Optionally set whitelist
+void OcrEngine::deferInitialization(const QString& language, const QString& datapath)
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->attempted) return;
     d->currentLanguageCode = language;
-    d->datapathStr = datapath.isEmpty() ? "/usr/share/tessdata" : datapath; // Default path
-    d->initialized = true;
+    d->datapathStr = datapath;
+}
 
-    LOG_INFO("OcrEngine: Initialized with language '" << language << "', datapath: " << d->datapathStr);
-    emit initializationComplete(true);
-    return true;
+void OcrEngine::warmUp()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->attempted) return;
+    }
+    LOG_DEBUG("OcrEngine: Warming up in the background");
+    ThreadPool::instance().submitDetached([this]() { d->ensureInitialized(); }, Task::Priority::Low);
 }
 
-bool OcrEngine::isReady() const
+bool OcrEngine::isInitialized() const
 {
     QMutexLocker locker(&d->mutex);
-    return d->initialized;
+    return d->attempted;
 }
 
-QString OcrEngine::recognizeText(const QImage& image) const
+bool OcrEngine::isReady() const
 {
-    if (!isReady() || image.isNull()) return QString();
-
-    // QMutexLocker locker(&d->mutex); // Lock during Tesseract call
-    // Pix* pixImage = d->qImageToPix(image);
-    // if (!pixImage) {
-    //     LOG_ERROR("OcrEngine::recognizeText: Failed to convert QImage to Pix.");
-    //     return QString();
-    // }
+    return d->ensureInitialized();
+}
 
-    // d->tessApi->SetImage(pixImage);
-    // d->tessApi->SetSourceResolution(d->resolutionVal); // Set DPI
+QString OcrEngine::backendName() const
+{
+    const std::shared_ptr<OcrBackend> backend = d->currentBackend();
+    return backend ? backend->name() : QString();
+}
 
-    // char* outText = d->tessApi->GetUTF8Text();
-    // QString result(outText);
-    // delete[] outText;
+QStringList OcrEngine::availableBackends()
+{
+    return OcrBackend::availableBackends();
+}
 
-    // pixDestroy(&pixImage); // Clean up Pix
+bool OcrEngine::setBackend(const QString& name, const QString& datapath)
+{
+    if (name.compare(backendName(), Qt::CaseInsensitive) == 0 && datapath.isEmpty()) return isReady();
+    const bool success = d->setUp(name, currentLanguage(), datapath);
+    if (success) {
+        LOG_INFO("OcrEngine: Switched to " << backendName() << ", datapath: " << this->datapath());
+    } else {
+        LOG_ERROR("OcrEngine: Failed to switch to OCR backend '" << name << "'");
+    }
+    emit initializationComplete(success);
+    return success;
+}
 
-    LOG_WARN("OcrEngine::recognizeText: Requires Tesseract integration. Returning placeholder.");
-    return "OCR text placeholder"; // Placeholder
+QString OcrEngine::recognizeText(const QImage& image) const
+{
+    return recognizeDetailed(image).text;
 }
 
 QString OcrEngine::recognizeText(const QImage& image, const QRectF& region) const
 {
-    if (!isReady() || image.isNull() || region.isEmpty()) return QString();
-
-    // Crop image to region first, then call full-image recognizeText
-    // QRect rect = region.toRect(); // Convert to integer QRect
-    // QImage croppedImage = image.copy(rect);
-    // return recognizeText(croppedImage);
-
-    LOG_WARN("OcrEngine::recognizeText (region): Requires Tesseract integration. Returning placeholder.");
-    return "OCR text for region placeholder"; // Placeholder
+    return recognizeDetailed(image, region).text;
 }
 
 QFuture<QString> OcrEngine::recognizeTextAsync(const QImage& image) const
@@ -159,55 +248,82 @@ QFuture<QString> OcrEngine::recognizeTextAsync(const QImage& image) const
 
 OcrResult OcrEngine::recognizeDetailed(const QImage& image) const
 {
-    OcrResult result;
-    if (!isReady() || image.isNull()) return result;
-
-    // Similar to recognizeText, but use Tesseract's HOCR or BoxText functions
-    // to get bounding boxes and confidences.
-    // This requires more complex parsing of Tesseract's output formats.
-    // result.text = ...;
-    // result.boundingBoxes = ...; // Parsed from HOCR or Boxes
-    // result.confidence = ...; // Average or per-word confidence
-
-    LOG_WARN("OcrEngine::recognizeDetailed: Requires Tesseract HOCR/BoxText integration. Returning placeholder.");
-    result.text = "Detailed OCR text placeholder";
-    result.confidence = 0.8f;
-    result.language = currentLanguage();
-    return result; // Placeholder
+    return recognizeBatch(QList<QImage>() << image).value(0, emptyResult());
 }
 
 OcrResult OcrEngine::recognizeDetailed(const QImage& image, const QRectF& region) const
 {
-    // Crop image and call detailed OCR on the cropped part
-    // QRect rect = region.toRect();
-    // QImage croppedImage = image.copy(rect);
-    // return recognizeDetailed(croppedImage);
+    const QRect rect = region.toAlignedRect().intersected(image.rect());
+    if (rect.isEmpty()) return emptyResult();
 
-    LOG_WARN("OcrEngine::recognizeDetailed (region): Requires Tesseract HOCR/BoxText integration. Returning placeholder.");
-    OcrResult result;
-    result.text = "Detailed OCR text for region placeholder";
-    result.confidence = 0.8f;
-    result.language = currentLanguage();
-    return result; // Placeholder
+    OcrResult result = recognizeDetailed(image.copy(rect));
+    for (QRectF& box : result.boundingBoxes) box.translate(rect.topLeft());
+    return result;
+}
+
+QList<OcrResult> OcrEngine::recognizeBatch(const QList<QImage>& images) const
+{
+    QList<OcrResult> results;
+    for (int i = 0; i < images.size(); ++i) results.append(emptyResult());
+    const std::shared_ptr<OcrBackend> backend = d->currentBackend();
+    if (!isReady() || !backend) return results;
+
+    const int dpi = resolution();
+    const QString language = currentLanguage();
+    const bool preprocessed = backend->wantsPreprocessing() && Private::preprocessing();
+
+    // Images recognized before are answered from the cache; the rest go to the backend together
+    QVector<int> pending;
+    QVector<QByteArray> keys;
+    QVector<QTransform> toOriginal;
+    QList<QImage> prepared;
+    for (int i = 0; i < images.size(); ++i) {
+        if (images[i].isNull()) continue;
+        const QByteArray key = d->cacheKey(images[i], *backend, dpi, preprocessed);
+        if (!key.isEmpty() && OcrResultCache::instance().find(key, &results[i])) continue;
+        const OcrPreprocessor::Result cleaned = Private::prepare(images[i], dpi, preprocessed);
+        pending.append(i);
+        keys.append(key);
+        toOriginal.append(cleaned.toOriginal);
+        prepared.append(cleaned.image);
+    }
+    if (pending.isEmpty() || CancellationToken::currentIsCanceled()) return results;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<OcrResult> recognized = backend->recognize(prepared, dpi);
+    // A backend stopped midway returns partial results; they are not cached
+    if (CancellationToken::currentIsCanceled()) return results;
+    const qint64 perImageUs = timer.nsecsElapsed() / 1000 / pending.size();
+    for (int k = 0; k < pending.size(); ++k) d->recognitionLatency.record(perImageUs);
+    const bool cacheable = backend->resultsCacheable();
+    for (int k = 0; k < pending.size(); ++k) {
+        OcrResult result = recognized.value(k, emptyResult());
+        // Boxes are found on the straightened image; report them on the one given
+        for (QRectF& box : result.boundingBoxes) box = toOriginal[k].mapRect(box);
+        result.language = language;
+        if (cacheable && !keys[k].isEmpty()) OcrResultCache::instance().store(keys[k], result);
+        results[pending[k]] = result;
+    }
+    return results;
+}
+
+const LatencyHistogram& OcrEngine::recognitionLatency() const
+{
+    return d->recognitionLatency;
+}
+
+int OcrEngine::preferredBatchSize() const
+{
+    const std::shared_ptr<OcrBackend> backend = d->currentBackend();
+    return backend ? backend->preferredBatchSize() : 1;
 }
 
 QStringList OcrEngine::supportedLanguages() const
 {
-    // Tesseract does not provide a direct API to list installed languages.
-    // You need to scan the tessdata directory for .traineddata files.
-    // QDir tessdataDir(d->datapathStr);
-    // QStringList filters;
-    // filters << "*.traineddata";
-    // QStringList langFiles = tessdataDir.entryList(filters);
-    // QStringList langs;
-    // for (const QString& file : langFiles) {
-    //     QString langCode = file.left(file.lastIndexOf('.')); // Remove .traineddata extension
-    //     langs.append(langCode);
-    // }
-    // return langs;
-
-    LOG_WARN("OcrEngine::supportedLanguages: Requires scanning tessdata directory. Returning placeholder.");
-    return QStringList() << "eng" << "deu" << "fra"; // Placeholder
+    d->ensureInitialized();
+    const std::shared_ptr<OcrBackend> backend = d->currentBackend();
+    return backend ? backend->supportedLanguages(datapath()) : QStringList();
 }
 
 QString OcrEngine::currentLanguage() const
@@ -218,19 +334,22 @@ QString OcrEngine::currentLanguage() const
 
 bool OcrEngine::setLanguage(const QString& language)
 {
-    // if (!isReady()) return false;
-    // int initResult = d->tessApi->Init(d->datapathStr.isEmpty() ? nullptr : d->datapathStr.toUtf8().constData(), language.toUtf8().constData());
-    // if (initResult != 0) {
-    //     LOG_ERROR("OcrEngine: Failed to set Tesseract language to '" << language << "'");
-    //     return false;
-    // }
-    // d->currentLanguageCode = language;
-    // LOG_INFO("OcrEngine: Language set to '" << language << "'");
-    // return true;
-
-    LOG_WARN("OcrEngine::setLanguage: Requires Tesseract integration. Returning true.");
-    d->currentLanguageCode = language;
-    return true; // Placeholder
+    std::shared_ptr<OcrBackend> backend;
+    QString path;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->currentLanguageCode == language) return true;
+        d->currentLanguageCode = language;
+        backend = d->backend;
+        path = d->datapathStr;
+    }
+
+    if (backend && !backend->configure(language, path)) {
+        LOG_ERROR("OcrEngine: Failed to set language to '" << language << "'");
+        return false;
+    }
+    LOG_INFO("OcrEngine: Language set to '" << language << "'");
+    return true;
 }
 
 QString OcrEngine::datapath() const
@@ -241,11 +360,18 @@ QString OcrEngine::datapath() const
 
 void OcrEngine::setDatapath(const QString& path)
 {
-    QMutexLocker locker(&d->mutex);
-    if (d->datapathStr != path) {
+    std::shared_ptr<OcrBackend> backend;
+    QString language;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->datapathStr == path) return;
         d->datapathStr = path;
-        LOG_INFO("OcrEngine: Datapath set to '" << path << "'");
-        // Re-initialization might be needed if API is already initialized
+        backend = d->backend;
+        language = d->currentLanguageCode;
+    }
+    LOG_INFO("OcrEngine: Datapath set to '" << path << "'");
+    if (backend && !backend->configure(language, path)) {
+        LOG_WARN("OcrEngine: " << backend->name() << " cannot use datapath '" << path << "'");
     }
 }
 
@@ -279,4 +405,10 @@ void OcrEngine::setConfidenceThreshold(float threshold)
     }
 }
 
+int OcrEngine::maxConcurrentRecognitions() const
+{
+    const std::shared_ptr<OcrBackend> backend = d->currentBackend();
+    return backend ? backend->maxConcurrentRecognitions() : 1;
+}
+
 } // namespace QuantilyxDoc
\ No newline at end of file
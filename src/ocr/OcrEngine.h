@@ -14,6 +14,8 @@
 #include <QImage>
 #include <QRectF>
 #include <QList>
+#include <QStringList>
+#include <QVector>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <memory>
@@ -21,14 +23,18 @@
 
 namespace QuantilyxDoc {
 
+class LatencyHistogram;
+
 /**
  * @brief Structure holding the result of an OCR operation on a specific region of an image.
  */
 struct OcrResult {
     QString text;                 // The recognized text
-    QList<QRectF> boundingBoxes;  // Bounding boxes for individual words/lines within the text
+    QVector<QRectF> boundingBoxes; // Bounding boxes for individual words/lines within the text
     float confidence;             // Confidence level (0.0 to 1.0)
     QString language;             // Language detected or used for recognition
+    QStringList elementTexts;     // Text of each box, if the engine reports it
+    QList<float> elementConfidences; // Confidence of each box, if the engine reports it
 };
 
 /**
@@ -36,6 +42,25 @@ struct OcrResult {
  * 
  * Provides methods for performing OCR on images and text regions.
  * Can operate synchronously or asynchronously.
+ *
+ * Recognition itself is done by an OcrBackend, chosen by the Ocr/Backend
+ * setting from availableBackends(): Tesseract on the CPU by default, or
+ * PaddleOCR on the GPU when built with ENABLE_OCR_PADDLEOCR. Backends that
+ * batch are best given preferredBatchSize() images at a time through
+ * recognizeBatch().
+ *
+ * Unless Advanced/OcrPreprocess is off, images for backends that want it
+ * are binarized, straightened and despeckled by OcrPreprocessor before
+ * recognition; bounding boxes are still given in the coordinates of the
+ * image passed in.
+ *
+ * Detailed results are kept by OcrResultCache, when it is open, under the
+ * image, the backend and the settings, and an image recognized before is
+ * answered from there without the backend.
+ *
+ * Nothing is loaded at startup: the backend and its language data are set
+ * up the first time OCR is needed (isReady() or a recognition), or ahead
+ * of that by warmUp() on a background thread.
  */
 class OcrEngine : public QObject
 {
@@ -63,17 +88,61 @@ public:
      * @brief Initialize the OCR engine.
      * Loads language data and sets up the underlying library.
      * @param language Language code to use (e.g., "eng", "deu", "fra").
-     * @param datapath Path to Tesseract data files (tessdata).
+     * @param datapath Path to the backend's data files (tessdata, or PaddleOCR models);
+     *                 empty for the backend's default.
      * @return True if initialization was successful.
      */
     bool initialize(const QString& language = "eng", const QString& datapath = QString());
 
     /**
-     * @brief Check if the OCR engine is initialized and ready.
+     * @brief Choose the language and data to initialize with on first use, without loading them.
+     * Ignored once the engine is initialized.
+     * @param language Language code to use.
+     * @param datapath Path to the backend's data files; empty for the Ocr/ setting or the backend's default.
+     */
+    void deferInitialization(const QString& language, const QString& datapath = QString());
+
+    /**
+     * @brief Initialize on a background thread if not initialized yet.
+     * Lets the first recognition start without waiting for language data.
+     */
+    void warmUp();
+
+    /**
+     * @brief Check if initialization has run, without running it.
+     * @return True once initialize() has been tried, whatever its outcome.
+     */
+    bool isInitialized() const;
+
+    /**
+     * @brief Check if the OCR engine is ready, initializing it on first call.
+     * The first call blocks while the backend loads its data, unless warmUp()
+     * has already done that.
      * @return True if ready.
      */
     bool isReady() const;
 
+    /**
+     * @brief Get the name of the backend recognizing.
+     * @return Backend name, as in availableBackends(); empty before initialize().
+     */
+    QString backendName() const;
+
+    /**
+     * @brief Get the names of the OCR backends built in.
+     * @return Backend names, the default first.
+     */
+    static QStringList availableBackends();
+
+    /**
+     * @brief Switch to another backend, keeping the language.
+     * Recognitions running finish on the old one.
+     * @param name Backend name, as in availableBackends().
+     * @param datapath Data directory for it; empty for the backend's default.
+     * @return True if the backend is ready.
+     */
+    bool setBackend(const QString& name, const QString& datapath = QString());
+
     /**
      * @brief Perform OCR on an entire image synchronously.
      * @param image The image to recognize text from.
@@ -112,6 +181,28 @@ public:
      */
     OcrResult recognizeDetailed(const QImage& image, const QRectF& region) const;
 
+    /**
+     * @brief Perform detailed OCR on several images together.
+     * Backends that batch, such as PaddleOCR, recognize them in one pass.
+     * @param images The images to recognize text from.
+     * @return One detailed result per image, in order.
+     */
+    QList<OcrResult> recognizeBatch(const QList<QImage>& images) const;
+
+    /**
+     * @brief Get the number of images best given to recognizeBatch() at once.
+     * @return Preferred batch size; 1 for backends that do not batch.
+     */
+    int preferredBatchSize() const;
+
+    /**
+     * @brief Get how long the backend took per image.
+     * A batch counts once per image it held, each with an equal share of
+     * its time; answers from OcrResultCache are not counted.
+     * @return Histogram of recognition times.
+     */
+    const LatencyHistogram& recognitionLatency() const;
+
     /**
      * @brief Get the list of supported languages.
      * @return List of language codes (e.g., "eng", "deu").
@@ -132,13 +223,13 @@ public:
     bool setLanguage(const QString& language);
 
     /**
-     * @brief Get the path to the Tesseract data directory.
+     * @brief Get the path to the backend's data directory.
      * @return Datapath string.
      */
     QString datapath() const;
 
     /**
-     * @brief Set the path to the Tesseract data directory.
+     * @brief Set the path to the backend's data directory.
      * @param path Datapath string.
      */
     void setDatapath(const QString& path);
@@ -168,6 +259,12 @@ public:
      */
     void setConfidenceThreshold(float threshold);
 
+    /**
+     * @brief Get the number of recognitions that can run at once.
+     * @return Maximum concurrent recognitions of the backend.
+     */
+    int maxConcurrentRecognitions() const;
+
 signals:
     /**
      * @brief Emitted when OCR initialization is complete.
@@ -194,6 +291,7 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static OcrEngine* s_instance;
 };
 
 } // namespace QuantilyxDoc
@@ -9,6 +9,7 @@
  */
 #include "OcrPage.h"
 #include "OcrEngine.h"
+#include "OcrElementIndex.h"
 #include "../core/Document.h"
 #include "../core/Page.h"
 #include "../core/Logger.h"
@@ -16,6 +17,7 @@
 #include <QRectF>
 #include <QPair>
 #include <QList>
+#include <QVector>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
 #include <QMutex>
@@ -32,9 +34,10 @@ public:
     Page* page;
     bool processed;
     QString fullText;
-    QList<QPair<QString, QRectF>> elements;
+    QVector<QPair<QString, QRectF>> elements; // Contiguous; a QList would allocate each pair
     QList<float> confidences;
     float avgConfidence;
+    OcrElementIndex index; // Over elements, rebuilt with them
     mutable QMutex mutex; // Protect access to the stored OCR data
 };
 
@@ -75,7 +78,7 @@ QString OcrPage::fullText() const
 QList<QPair<QString, QRectF>> OcrPage::textElements() const
 {
     QMutexLocker locker(&d->mutex);
-    return d->elements;
+    return d->elements.toList();
 }
 
 float OcrPage::averageConfidence() const
@@ -105,12 +108,13 @@ bool OcrPage::performOcr(bool force)
 
     emit ocrStarted();
 
-    // Get the page image from the Page object
-    // This might involve rendering the page at a high resolution.
-    int dpi = OcrEngine::instance().resolution(); // Use engine's resolution setting
-    // Assume Page::render(width, height, dpi) exists and returns a QImage
-    // QImage pageImage = d->page->render(0, 0, dpi); // 0, 0 means render entire page
-    QImage pageImage; // Placeholder
+    // Render the whole page at the engine's resolution; page sizes are in points
+    const int dpi = OcrEngine::instance().resolution();
+    QImage pageImage;
+    if (d->page) {
+        const QSizeF points = d->page->size();
+        pageImage = d->page->render(qRound(points.width() * dpi / 72.0), qRound(points.height() * dpi / 72.0), dpi);
+    }
 
     if (pageImage.isNull()) {
         LOG_ERROR("OcrPage::performOcr: Failed to render page image for OCR.");
@@ -137,7 +141,8 @@ bool OcrPage::performOcr(bool force)
 
 QFuture<bool> OcrPage::performOcrAsync(bool force)
 {
-    // Use QtConcurrent to run performOcr in a separate thread
+    // Use QtConcurrent to run performOcr in a separate thread; OcrEngine hands
+    // each call its own engine handle, so pages submitted together run in parallel.
     // This emits signals from the worker thread, so UI should connect with Qt::QueuedConnection.
     return QtConcurrent::run([this, force]() {
         return this->performOcr(force);
@@ -152,7 +157,8 @@ QList<QRectF> OcrPage::searchText(const QString& searchText, bool caseSensitive,
     QMutexLocker locker(&d->mutex);
     Qt::CaseSensitivity cs = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
 
-    for (int i = 0; i < d->elements.size(); ++i) {
+    // Only elements sharing the search text's trigrams can hold it
+    for (int i : d->index.candidates(searchText)) {
         const auto& element = d->elements[i];
         QString elementText = element.first;
         QRectF elementRect = element.second;
@@ -193,6 +199,24 @@ QList<QRectF> OcrPage::searchText(const QString& searchText, bool caseSensitive,
 
 OcrResult OcrPage::ocrResultForRegion(const QRectF& region) const
 {
+    if (isProcessed()) {
+        // The elements in the region, in the engine's reading order
+        QMutexLocker locker(&d->mutex);
+        OcrResult result;
+        result.confidence = 0.0f;
+        QStringList texts;
+        for (int i : d->index.intersecting(region)) {
+            texts.append(d->elements[i].first);
+            result.boundingBoxes.append(d->elements[i].second);
+            result.elementTexts.append(d->elements[i].first);
+            result.elementConfidences.append(d->confidences.value(i));
+            result.confidence += d->confidences.value(i);
+        }
+        if (!texts.isEmpty()) result.confidence /= texts.size();
+        result.text = texts.join(QLatin1Char(' '));
+        return result;
+    }
+
     // This would involve performing OCR specifically on the given region of the page image.
     // Get page image, crop to region, call OcrEngine::recognizeDetailed(image, region).
     // QImage pageImage = d->page->render(0, 0, OcrEngine::instance().resolution());
@@ -237,11 +261,20 @@ QList<QPair<QString, QRectF>> OcrPage::words() const
 
 QList<QPair<QString, QRectF>> OcrPage::lines() const
 {
-    // Lines are usually represented as elements in the OCR result if using HOCR/Line segmentation.
-    // If elements are phrases/words, group them by Y-coordinate proximity to form lines.
-    // This requires more complex spatial clustering.
-    LOG_WARN("OcrPage::lines: Requires spatial clustering of elements or HOCR line-level results.");
-    return QList<QPair<QString, QRectF>>(); // Placeholder
+    // Elements are grouped into lines by vertical overlap when the index is built
+    QList<QPair<QString, QRectF>> lineList;
+    if (!isProcessed()) return lineList;
+    QMutexLocker locker(&d->mutex);
+    for (const QVector<int>& line : d->index.lines()) {
+        QStringList texts;
+        QRectF rect;
+        for (int i : line) {
+            texts.append(d->elements[i].first);
+            rect = rect.isNull() ? d->elements[i].second : rect.united(d->elements[i].second);
+        }
+        lineList.append(qMakePair(texts.join(QLatin1Char(' ')), rect));
+    }
+    return lineList;
 }
 
 QList<QPair<QString, QRectF>> OcrPage::paragraphs() const
@@ -259,11 +292,15 @@ void OcrPage::storeOcrResults(const OcrResult& result)
     d->elements.clear();
     d->confidences.clear();
 
-    // This is a simplification. OcrResult.boundingBoxes and OcrResult.text need to be mapped correctly.
-    // Tesseract's HOCR output provides structured text with bounding boxes for words/phrases/lines.
-    // Parsing HOCR or the detailed box output is needed to populate elements correctly.
-    // For now, assume result.text is a single element (which is often not the case).
-    if (!result.text.isEmpty()) {
+    if (!result.boundingBoxes.isEmpty() && result.elementTexts.size() == result.boundingBoxes.size()) {
+        // The engine reported each element with its box
+        d->elements.reserve(result.boundingBoxes.size());
+        for (int i = 0; i < result.boundingBoxes.size(); ++i) {
+            d->elements.append(qMakePair(result.elementTexts[i], result.boundingBoxes[i]));
+            d->confidences.append(result.elementConfidences.value(i, result.confidence));
+        }
+    } else if (!result.text.isEmpty()) {
+        // Without elements, the whole text is one element
         QRectF pageRect; // Need page dimensions to map relative box coordinates if needed
         if (d->page) {
             // pageRect = QRectF(QPointF(0, 0), d->page->size()); // Assuming Page::size() returns QSizeF
@@ -281,6 +318,7 @@ void OcrPage::storeOcrResults(const OcrResult& result)
     }
     d->avgConfidence = d->confidences.isEmpty() ? 0.0f : sumConf / d->confidences.size();
 
+    d->index.build(d->elements);
     d->processed = true;
     LOG_DEBUG("OcrPage::storeOcrResults: Stored OCR data for page, elements: " << d->elements.size());
 }
@@ -28,6 +28,8 @@ class Page; // Forward declaration
  * 
  * Stores the recognized text, bounding boxes, and confidences for a page.
  * Can trigger OCR on the page's content if it hasn't been processed yet.
+ * The stored elements are indexed by OcrElementIndex, so region queries,
+ * searches and lines do not go through every element of a dense page.
  */
 class OcrPage : public QObject
 {
@@ -0,0 +1,447 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "OcrPreprocessor.h"
+#include <QVector>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#define QUANTILYX_OCRPREPROCESSOR_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define QUANTILYX_OCRPREPROCESSOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Sauvola's dynamic range of the standard deviation for 8-bit samples
+const float SauvolaRange = 128.0f;
+const int MinWindow = 15;
+const int MaxWindow = 127; // Keeps a window's sum of squares within 31 bits
+const int DefaultDpi = 300;
+
+// Skew search: coarse steps over the whole range, then fine ones around the best
+const float CoarseStepDegrees = 0.5f;
+const float FineStepDegrees = 0.05f;
+const float MinSkewDegrees = 0.1f; // Less is left alone
+const int MaxSkewPoints = 200000;
+const int MinSkewPoints = 100;
+
+// BT.601 luma weights in 1/256
+const int WeightR = 77;
+const int WeightG = 150;
+const int WeightB = 29;
+
+void grayRow(const quint32* src, uchar* dst, int width)
+{
+    int x = 0;
+#if defined(QUANTILYX_OCRPREPROCESSOR_SSE2)
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i wr = _mm_set1_epi32(WeightR);
+    const __m128i wg = _mm_set1_epi32(WeightG);
+    const __m128i wb = _mm_set1_epi32(WeightB);
+    const __m128i round = _mm_set1_epi32(128);
+    for (; x + 16 <= width; x += 16) {
+        __m128i luma[4];
+        for (int k = 0; k < 4; ++k) {
+            const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x + 4 * k));
+            const __m128i b = _mm_and_si128(p, mask);
+            const __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+            const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+            // The high halves of the lanes are zero, so 16-bit products are exact
+            const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)),
+                                              _mm_add_epi32(_mm_mullo_epi16(b, wb), round));
+            luma[k] = _mm_srli_epi32(sum, 8);
+        }
+        const __m128i low = _mm_packs_epi32(luma[0], luma[1]);
+        const __m128i high = _mm_packs_epi32(luma[2], luma[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(low, high));
+    }
+#elif defined(QUANTILYX_OCRPREPROCESSOR_NEON)
+    const uint8x8_t wr = vdup_n_u8(WeightR);
+    const uint8x8_t wg = vdup_n_u8(WeightG);
+    const uint8x8_t wb = vdup_n_u8(WeightB);
+    for (; x + 16 <= width; x += 16) {
+        // Bytes of each pixel in memory: blue, green, red, alpha
+        const uint8x16x4_t p = vld4q_u8(reinterpret_cast<const uint8_t*>(src + x));
+        uint16x8_t low = vmull_u8(vget_low_u8(p.val[2]), wr);
+        low = vmlal_u8(low, vget_low_u8(p.val[1]), wg);
+        low = vmlal_u8(low, vget_low_u8(p.val[0]), wb);
+        uint16x8_t high = vmull_u8(vget_high_u8(p.val[2]), wr);
+        high = vmlal_u8(high, vget_high_u8(p.val[1]), wg);
+        high = vmlal_u8(high, vget_high_u8(p.val[0]), wb);
+        vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(low, 8), vrshrn_n_u16(high, 8)));
+    }
+#endif
+    for (; x < width; ++x) {
+        const quint32 p = src[x];
+        dst[x] = uchar((qRed(p) * WeightR + qGreen(p) * WeightG + qBlue(p) * WeightB + 128) >> 8);
+    }
+}
+
+// Add a row's samples and squares to the column sums, or take them off
+void addRowToColumns(const uchar* row, quint32* sums, quint32* squares, int width, bool subtract)
+{
+    int x = 0;
+#if defined(QUANTILYX_OCRPREPROCESSOR_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 8 <= width; x += 8) {
+        const __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x)), zero);
+        const __m128i sq = _mm_mullo_epi16(v, v); // At most 255^2, exact in 16 bits
+        const __m128i parts[4] = {_mm_unpacklo_epi16(v, zero), _mm_unpackhi_epi16(v, zero),
+                                  _mm_unpacklo_epi16(sq, zero), _mm_unpackhi_epi16(sq, zero)};
+        quint32* targets[4] = {sums + x, sums + x + 4, squares + x, squares + x + 4};
+        for (int k = 0; k < 4; ++k) {
+            __m128i* target = reinterpret_cast<__m128i*>(targets[k]);
+            const __m128i current = _mm_loadu_si128(target);
+            _mm_storeu_si128(target, subtract ? _mm_sub_epi32(current, parts[k]) : _mm_add_epi32(current, parts[k]));
+        }
+    }
+#elif defined(QUANTILYX_OCRPREPROCESSOR_NEON)
+    for (; x + 8 <= width; x += 8) {
+        const uint8x8_t v = vld1_u8(row + x);
+        const uint16x8_t v16 = vmovl_u8(v);
+        const uint16x8_t sq = vmull_u8(v, v);
+        uint32x4_t s0 = vld1q_u32(sums + x), s1 = vld1q_u32(sums + x + 4);
+        uint32x4_t q0 = vld1q_u32(squares + x), q1 = vld1q_u32(squares + x + 4);
+        if (subtract) {
+            s0 = vsubw_u16(s0, vget_low_u16(v16));
+            s1 = vsubw_u16(s1, vget_high_u16(v16));
+            q0 = vsubw_u16(q0, vget_low_u16(sq));
+            q1 = vsubw_u16(q1, vget_high_u16(sq));
+        } else {
+            s0 = vaddw_u16(s0, vget_low_u16(v16));
+            s1 = vaddw_u16(s1, vget_high_u16(v16));
+            q0 = vaddw_u16(q0, vget_low_u16(sq));
+            q1 = vaddw_u16(q1, vget_high_u16(sq));
+        }
+        vst1q_u32(sums + x, s0);
+        vst1q_u32(sums + x + 4, s1);
+        vst1q_u32(squares + x, q0);
+        vst1q_u32(squares + x + 4, q1);
+    }
+#endif
+    for (; x < width; ++x) {
+        const quint32 v = row[x];
+        if (subtract) {
+            sums[x] -= v;
+            squares[x] -= v * v;
+        } else {
+            sums[x] += v;
+            squares[x] += v * v;
+        }
+    }
+}
+
+// Sauvola's threshold decision for one pixel; the vector paths compute the same
+inline uchar sauvolaPixel(uchar pixel, quint32 sum, quint32 squares, float inverseCount, float k)
+{
+    const float mean = float(sum) * inverseCount;
+    const float variance = float(squares) * inverseCount - mean * mean;
+    const float deviation = std::sqrt(std::max(variance, 0.0f));
+    const float threshold = mean * (1.0f + k * (deviation * (1.0f / SauvolaRange) - 1.0f));
+    return float(pixel) > threshold ? 255 : 0;
+}
+
+// Threshold the pixels whose window lies within the row, x in [from, to).
+// prefix and prefixSquares are the row's running column sums; sums are
+// differences of them taken modulo 2^32, exact since a window's are smaller.
+void sauvolaInterior(const uchar* src, uchar* dst, const quint32* prefix, const quint32* prefixSquares,
+                     int from, int to, int radius, float inverseCount, float k)
+{
+    int x = from;
+#if defined(QUANTILYX_OCRPREPROCESSOR_SSE2)
+    const __m128 inv = _mm_set1_ps(inverseCount);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 kk = _mm_set1_ps(k);
+    const __m128 range = _mm_set1_ps(1.0f / SauvolaRange);
+    const __m128i zeroI = _mm_setzero_si128();
+    for (; x + 4 <= to; x += 4) {
+        const __m128i s = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prefix + x + radius + 1)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefix + x - radius)));
+        const __m128i q = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixSquares + x + radius + 1)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixSquares + x - radius)));
+        const __m128 mean = _mm_mul_ps(_mm_cvtepi32_ps(s), inv);
+        const __m128 variance = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(q), inv), _mm_mul_ps(mean, mean));
+        const __m128 deviation = _mm_sqrt_ps(_mm_max_ps(variance, zero));
+        const __m128 threshold = _mm_mul_ps(mean, _mm_add_ps(one, _mm_mul_ps(kk, _mm_sub_ps(_mm_mul_ps(deviation, range), one))));
+        quint32 four;
+        std::memcpy(&four, src + x, sizeof(four));
+        const __m128i pixels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(four)), zeroI), zeroI);
+        const __m128i paper = _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(pixels), threshold));
+        const __m128i bytes = _mm_packs_epi16(_mm_packs_epi32(paper, paper), zeroI);
+        four = quint32(_mm_cvtsi128_si32(bytes));
+        std::memcpy(dst + x, &four, sizeof(four));
+    }
+#elif defined(QUANTILYX_OCRPREPROCESSOR_NEON) && defined(__aarch64__)
+    const float32x4_t inv = vdupq_n_f32(inverseCount);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t kk = vdupq_n_f32(k);
+    const float32x4_t range = vdupq_n_f32(1.0f / SauvolaRange);
+    for (; x + 4 <= to; x += 4) {
+        const uint32x4_t s = vsubq_u32(vld1q_u32(prefix + x + radius + 1), vld1q_u32(prefix + x - radius));
+        const uint32x4_t q = vsubq_u32(vld1q_u32(prefixSquares + x + radius + 1), vld1q_u32(prefixSquares + x - radius));
+        const float32x4_t mean = vmulq_f32(vcvtq_f32_u32(s), inv);
+        const float32x4_t variance = vsubq_f32(vmulq_f32(vcvtq_f32_u32(q), inv), vmulq_f32(mean, mean));
+        const float32x4_t deviation = vsqrtq_f32(vmaxq_f32(variance, zero));
+        const float32x4_t threshold = vmulq_f32(mean, vaddq_f32(one, vmulq_f32(kk, vsubq_f32(vmulq_f32(deviation, range), one))));
+        const float32x4_t pixels = {float(src[x]), float(src[x + 1]), float(src[x + 2]), float(src[x + 3])};
+        const uint16x4_t paper = vmovn_u32(vcgtq_f32(pixels, threshold));
+        const uint8x8_t bytes = vmovn_u16(vcombine_u16(paper, paper));
+        vst1_lane_u32(reinterpret_cast<uint32_t*>(dst + x), vreinterpret_u32_u8(bytes), 0);
+    }
+#endif
+    for (; x < to; ++x) {
+        dst[x] = sauvolaPixel(src[x], prefix[x + radius + 1] - prefix[x - radius],
+                              prefixSquares[x + radius + 1] - prefixSquares[x - radius], inverseCount, k);
+    }
+}
+
+// Clear ink pixels with fewer than two ink neighbours. The rows are those
+// of a copy padded with a line of paper, so x - 1 and x + 1 always exist.
+void despeckleRow(const uchar* above, const uchar* row, const uchar* below, uchar* dst, int width)
+{
+    int x = 0;
+#if defined(QUANTILYX_OCRPREPROCESSOR_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi8(2);
+    for (; x + 16 <= width; x += 16) {
+        __m128i count = zero;
+        const uchar* neighbours[8] = {above + x, above + x + 1, above + x + 2, row + x,
+                                      row + x + 2, below + x, below + x + 1, below + x + 2};
+        for (const uchar* n : neighbours) {
+            count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(n)), zero));
+        }
+        const __m128i centre = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+        const __m128i lonely = _mm_and_si128(_mm_cmpeq_epi8(centre, zero), _mm_cmplt_epi8(count, two));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_or_si128(centre, lonely));
+    }
+#elif defined(QUANTILYX_OCRPREPROCESSOR_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t two = vdupq_n_u8(2);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t count = zero;
+        const uchar* neighbours[8] = {above + x, above + x + 1, above + x + 2, row + x,
+                                      row + x + 2, below + x, below + x + 1, below + x + 2};
+        for (const uchar* n : neighbours) count = vsubq_u8(count, vceqq_u8(vld1q_u8(n), zero));
+        const uint8x16_t centre = vld1q_u8(row + x + 1);
+        const uint8x16_t lonely = vandq_u8(vceqq_u8(centre, zero), vcltq_u8(count, two));
+        vst1q_u8(dst + x, vorrq_u8(centre, lonely));
+    }
+#endif
+    for (; x < width; ++x) {
+        const uchar centre = row[x + 1];
+        if (centre != 0) {
+            dst[x] = centre;
+            continue;
+        }
+        const int count = (above[x] == 0) + (above[x + 1] == 0) + (above[x + 2] == 0) + (row[x] == 0)
+                          + (row[x + 2] == 0) + (below[x] == 0) + (below[x + 1] == 0) + (below[x + 2] == 0);
+        dst[x] = count < 2 ? 255 : 0;
+    }
+}
+
+// Sharpness of the ink's row profile along lines tilted by an angle
+double profileScore(const QVector<QPointF>& points, double radians, int bins, double offset)
+{
+    const double c = std::cos(radians);
+    const double s = std::sin(radians);
+    QVector<int> histogram(bins, 0);
+    for (const QPointF& p : points) {
+        const int bin = int(p.y() * c - p.x() * s + offset);
+        if (bin >= 0 && bin < bins) ++histogram[bin];
+    }
+    double score = 0.0;
+    for (int count : histogram) score += double(count) * count;
+    return score;
+}
+
+} // namespace
+
+OcrPreprocessor::Result OcrPreprocessor::process(const QImage& image, int dpi)
+{
+    Result result;
+    if (image.isNull()) return result;
+    const int window = qBound(MinWindow, (dpi > 0 ? dpi : DefaultDpi) / 10, MaxWindow);
+    // Specks go before the skew is measured, so they do not blur the profile
+    const QImage clean = despeckle(binarize(grayscale(image), window));
+    result.skewDegrees = estimateSkew(clean);
+    result.image = deskew(clean, result.skewDegrees, &result.toOriginal);
+    return result;
+}
+
+QImage OcrPreprocessor::grayscale(const QImage& image)
+{
+    if (image.isNull() || image.format() == QImage::Format_Grayscale8) return image;
+    const QImage source = image.convertToFormat(QImage::Format_RGB32);
+    QImage gray(source.size(), QImage::Format_Grayscale8);
+    for (int y = 0; y < source.height(); ++y) {
+        grayRow(reinterpret_cast<const quint32*>(source.constScanLine(y)), gray.scanLine(y), source.width());
+    }
+    return gray;
+}
+
+QImage OcrPreprocessor::binarize(const QImage& gray, int window, float k)
+{
+    if (gray.isNull()) return gray;
+    const QImage source = gray.format() == QImage::Format_Grayscale8 ? gray : grayscale(gray);
+    const int width = source.width();
+    const int height = source.height();
+    const int radius = qBound(1, window, MaxWindow) / 2;
+
+    // Column sums over the rows of the current window, then their running
+    // sums along the row, so each window's sums take two subtractions
+    QVector<quint32> sums(width, 0), squares(width, 0);
+    QVector<quint32> prefix(width + 1, 0), prefixSquares(width + 1, 0);
+    for (int y = 0; y < qMin(radius, height); ++y) addRowToColumns(source.constScanLine(y), sums.data(), squares.data(), width, false);
+
+    QImage binary(width, height, QImage::Format_Grayscale8);
+    for (int y = 0; y < height; ++y) {
+        if (y + radius < height) addRowToColumns(source.constScanLine(y + radius), sums.data(), squares.data(), width, false);
+        if (y - radius - 1 >= 0) addRowToColumns(source.constScanLine(y - radius - 1), sums.data(), squares.data(), width, true);
+        const int rows = qMin(height - 1, y + radius) - qMax(0, y - radius) + 1;
+
+        for (int x = 0; x < width; ++x) {
+            prefix[x + 1] = prefix[x] + sums[x];
+            prefixSquares[x + 1] = prefixSquares[x] + squares[x];
+        }
+
+        const uchar* src = source.constScanLine(y);
+        uchar* dst = binary.scanLine(y);
+        const int interiorFrom = qMin(radius, width);
+        const int interiorTo = qMax(interiorFrom, width - radius);
+        // Windows cut by the left and right edges hold fewer pixels
+        auto edge = [&](int x) {
+            const int x0 = qMax(0, x - radius);
+            const int x1 = qMin(width - 1, x + radius);
+            dst[x] = sauvolaPixel(src[x], prefix[x1 + 1] - prefix[x0], prefixSquares[x1 + 1] - prefixSquares[x0],
+                                  1.0f / float(rows * (x1 - x0 + 1)), k);
+        };
+        for (int x = 0; x < interiorFrom; ++x) edge(x);
+        sauvolaInterior(src, dst, prefix.constData(), prefixSquares.constData(), interiorFrom, interiorTo, radius,
+                        1.0f / float(rows * (2 * radius + 1)), k);
+        for (int x = interiorTo; x < width; ++x) edge(x);
+    }
+    return binary;
+}
+
+float OcrPreprocessor::estimateSkew(const QImage& binary, float maxDegrees)
+{
+    if (binary.isNull() || binary.format() != QImage::Format_Grayscale8) return 0.0f;
+
+    // Ink at half resolution: a 2x2 block with any ink is one point
+    const int width = binary.width() / 2;
+    const int height = binary.height() / 2;
+    QVector<QPointF> points;
+    for (int y = 0; y < height; ++y) {
+        const uchar* top = binary.constScanLine(2 * y);
+        const uchar* bottom = binary.constScanLine(2 * y + 1);
+        for (int x = 0; x < width; ++x) {
+            if (!(top[2 * x] & top[2 * x + 1] & bottom[2 * x] & bottom[2 * x + 1])) points.append(QPointF(x, y));
+        }
+    }
+    if (points.size() < MinSkewPoints) return 0.0f;
+    if (points.size() > MaxSkewPoints) {
+        // An even sample of the points keeps the profile's shape
+        QVector<QPointF> sample;
+        sample.reserve(MaxSkewPoints);
+        const double step = double(points.size()) / MaxSkewPoints;
+        for (int i = 0; i < MaxSkewPoints; ++i) sample.append(points[int(i * step)]);
+        points.swap(sample);
+    }
+
+    const double offset = width * std::sin(qDegreesToRadians(double(maxDegrees))) + 1.0;
+    const int bins = height + 2 * int(offset) + 2;
+    auto search = [&](float from, float to, float step, float best) {
+        double bestScore = -1.0;
+        for (float degrees = from; degrees <= to + step / 2; degrees += step) {
+            const double score = profileScore(points, qDegreesToRadians(double(degrees)), bins, offset);
+            if (score > bestScore) {
+                bestScore = score;
+                best = degrees;
+            }
+        }
+        return best;
+    };
+    const float coarse = search(-maxDegrees, maxDegrees, CoarseStepDegrees, 0.0f);
+    const float fine = search(qMax(-maxDegrees, coarse - CoarseStepDegrees), qMin(maxDegrees, coarse + CoarseStepDegrees),
+                              FineStepDegrees, coarse);
+    return std::fabs(fine) < MinSkewDegrees ? 0.0f : fine;
+}
+
+QImage OcrPreprocessor::deskew(const QImage& binary, float degrees, QTransform* toOriginal)
+{
+    if (toOriginal) *toOriginal = QTransform();
+    if (binary.isNull() || degrees == 0.0f) return binary;
+    const QImage source = binary.format() == QImage::Format_Grayscale8 ? binary : grayscale(binary);
+    const int width = source.width();
+    const int height = source.height();
+    const double radians = qDegreesToRadians(double(degrees));
+    const double c = std::cos(radians);
+    const double s = std::sin(radians);
+    const double cx = (width - 1) / 2.0;
+    const double cy = (height - 1) / 2.0;
+
+    // Each output pixel takes the nearest source pixel along the tilted line
+    // through it; coordinates are stepped in 16.16 fixed point
+    QImage straight(width, height, QImage::Format_Grayscale8);
+    const int stepX = qRound(c * 65536.0);
+    const int stepY = qRound(s * 65536.0);
+    for (int y = 0; y < height; ++y) {
+        int sx = qRound((cx - cx * c - (y - cy) * s) * 65536.0) + 32768;
+        int sy = qRound((cy - cx * s + (y - cy) * c) * 65536.0) + 32768;
+        uchar* dst = straight.scanLine(y);
+        for (int x = 0; x < width; ++x, sx += stepX, sy += stepY) {
+            const int px = sx >> 16;
+            const int py = sy >> 16;
+            dst[x] = (px >= 0 && px < width && py >= 0 && py < height) ? source.constScanLine(py)[px] : 255;
+        }
+    }
+    if (toOriginal) *toOriginal = QTransform(c, s, -s, c, cx - cx * c + cy * s, cy - cx * s - cy * c);
+    return straight;
+}
+
+QImage OcrPreprocessor::despeckle(const QImage& binary)
+{
+    if (binary.isNull()) return binary;
+    const QImage source = binary.format() == QImage::Format_Grayscale8 ? binary : grayscale(binary);
+    const int width = source.width();
+    const int height = source.height();
+
+    QImage padded(width + 2, height + 2, QImage::Format_Grayscale8);
+    padded.fill(255);
+    for (int y = 0; y < height; ++y) std::memcpy(padded.scanLine(y + 1) + 1, source.constScanLine(y), size_t(width));
+
+    QImage clean(width, height, QImage::Format_Grayscale8);
+    for (int y = 0; y < height; ++y) {
+        despeckleRow(padded.constScanLine(y), padded.constScanLine(y + 1), padded.constScanLine(y + 2), clean.scanLine(y), width);
+    }
+    return clean;
+}
+
+QString OcrPreprocessor::instructionSet()
+{
+#if defined(QUANTILYX_OCRPREPROCESSOR_SSE2)
+    return QStringLiteral("SSE2");
+#elif defined(QUANTILYX_OCRPREPROCESSOR_NEON)
+    return QStringLiteral("NEON");
+#else
+    return QStringLiteral("scalar");
+#endif
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,318 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "OcrResultCache.h"
+#include "../core/Settings.h"
+#include "../core/Logger.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Encoding of a result: EncodedHeader, the text and language in UTF-8,
+// then per element an EncodedElement and its text in UTF-8. Native byte
+// order; the cache stays on this machine.
+struct EncodedHeader {
+    quint32 magic;
+    quint32 version;
+    float confidence;
+    quint32 elementCount;
+    quint32 textBytes;
+    quint32 languageBytes;
+};
+
+struct EncodedElement {
+    float x;
+    float y;
+    float width;
+    float height;
+    float confidence;
+    quint32 textBytes;
+};
+
+const quint32 EncodingMagic = 0x51584F52; // "QXOR"
+const quint32 EncodingVersion = 1;
+// Stores between two prunings
+const int PruneInterval = 256;
+const int DefaultMaxEntries = 20000;
+
+QByteArray encode(const OcrResult& result)
+{
+    const QByteArray text = result.text.toUtf8();
+    const QByteArray language = result.language.toUtf8();
+    const EncodedHeader header = {EncodingMagic, EncodingVersion, result.confidence, quint32(result.boundingBoxes.size()),
+                                  quint32(text.size()), quint32(language.size())};
+    QByteArray bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes.append(text);
+    bytes.append(language);
+    for (int i = 0; i < result.boundingBoxes.size(); ++i) {
+        const QRectF& box = result.boundingBoxes[i];
+        const QByteArray elementText = result.elementTexts.value(i).toUtf8();
+        const EncodedElement element = {float(box.x()), float(box.y()), float(box.width()), float(box.height()),
+                                        result.elementConfidences.value(i, result.confidence), quint32(elementText.size())};
+        bytes.append(reinterpret_cast<const char*>(&element), sizeof(element));
+        bytes.append(elementText);
+    }
+    return bytes;
+}
+
+bool decode(const QByteArray& bytes, OcrResult* result)
+{
+    const char* at = bytes.constData();
+    const char* end = at + bytes.size();
+    auto take = [&](void* target, qint64 size) {
+        if (end - at < size) return false;
+        std::memcpy(target, at, size_t(size));
+        at += size;
+        return true;
+    };
+    auto takeText = [&](quint32 size, QString* target) {
+        if (end - at < qint64(size)) return false;
+        *target = QString::fromUtf8(at, int(size));
+        at += size;
+        return true;
+    };
+
+    EncodedHeader header;
+    OcrResult decoded;
+    if (!take(&header, sizeof(header)) || header.magic != EncodingMagic || header.version != EncodingVersion
+        || !takeText(header.textBytes, &decoded.text) || !takeText(header.languageBytes, &decoded.language)) {
+        return false;
+    }
+    decoded.confidence = header.confidence;
+    for (quint32 i = 0; i < header.elementCount; ++i) {
+        EncodedElement element;
+        QString elementText;
+        if (!take(&element, sizeof(element)) || !takeText(element.textBytes, &elementText)) return false;
+        decoded.boundingBoxes.append(QRectF(element.x, element.y, element.width, element.height));
+        decoded.elementTexts.append(elementText);
+        decoded.elementConfidences.append(element.confidence);
+    }
+    *result = decoded;
+    return true;
+}
+
+} // namespace
+
+class OcrResultCache::Private {
+public:
+    Private() : ready(false), maxEntriesVal(DefaultMaxEntries), storesSincePrune(0) {}
+
+    mutable QMutex mutex; // Protect access to the QSqlDatabase connection
+    bool ready;
+    QString dbPathStr;
+    QSqlDatabase sqlDb;
+    int maxEntriesVal;
+    int storesSincePrune;
+
+    bool createTables() {
+        QSqlQuery query(sqlDb);
+        if (!query.exec(R"(
+            CREATE TABLE IF NOT EXISTS ocr_results (
+                key BLOB PRIMARY KEY, -- OcrResultCache::keyFor()
+                data BLOB,            -- Encoded OcrResult
+                last_used INTEGER     -- msecs since epoch, for pruning
+            );
+        )")) {
+            LOG_ERROR("OcrResultCache: Failed to create table: " << query.lastError().text());
+            return false;
+        }
+        if (!query.exec("CREATE INDEX IF NOT EXISTS idx_ocr_last_used ON ocr_results(last_used);")) {
+            LOG_WARN("OcrResultCache: Failed to create index: " << query.lastError().text()); // Non-fatal
+        }
+        return true;
+    }
+
+    // Helper to delete the least recently used entries beyond the limit;
+    // caller holds the mutex
+    void pruneLocked() {
+        storesSincePrune = 0;
+        QSqlQuery query(sqlDb);
+        query.prepare("DELETE FROM ocr_results WHERE key IN "
+                      "(SELECT key FROM ocr_results ORDER BY last_used DESC LIMIT -1 OFFSET :keep);");
+        query.bindValue(":keep", maxEntriesVal);
+        if (!query.exec()) {
+            LOG_WARN("OcrResultCache: Failed to prune: " << query.lastError().text());
+        } else if (query.numRowsAffected() > 0) {
+            LOG_DEBUG("OcrResultCache: Pruned " << query.numRowsAffected() << " results.");
+        }
+    }
+};
+
+// Static instance pointer
+OcrResultCache* OcrResultCache::s_instance = nullptr;
+
+OcrResultCache& OcrResultCache::instance()
+{
+    if (!s_instance) {
+        s_instance = new OcrResultCache();
+    }
+    return *s_instance;
+}
+
+OcrResultCache::OcrResultCache(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    d->maxEntriesVal = Settings::instance().value<int>("Advanced/OcrCachePages", DefaultMaxEntries);
+}
+
+OcrResultCache::~OcrResultCache()
+{
+    if (d->sqlDb.isOpen()) {
+        d->sqlDb.close();
+    }
+}
+
+bool OcrResultCache::initialize(const QString& dbPath)
+{
+    QMutexLocker locker(&d->mutex);
+
+    if (d->ready) {
+        LOG_WARN("OcrResultCache::initialize: Already initialized.");
+        return true;
+    }
+
+    QString path = dbPath;
+    if (path.isEmpty()) {
+        path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/ocr_results.db";
+        QDir().mkpath(QFileInfo(path).absolutePath());
+    }
+
+    d->sqlDb = QSqlDatabase::addDatabase("QSQLITE", "ocr_cache_connection");
+    d->sqlDb.setDatabaseName(path);
+    if (!d->sqlDb.open()) {
+        LOG_ERROR("OcrResultCache: Failed to open database: " << d->sqlDb.lastError().text());
+        return false;
+    }
+    if (!d->createTables()) {
+        d->sqlDb.close();
+        return false;
+    }
+
+    d->dbPathStr = path;
+    d->ready = true;
+    d->pruneLocked();
+    LOG_INFO("OcrResultCache: Initialized successfully at: " << path);
+    return true;
+}
+
+bool OcrResultCache::isReady() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->ready;
+}
+
+QByteArray OcrResultCache::keyFor(const QImage& image, const QString& backend, const QString& language, int dpi, bool preprocessed)
+{
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    const QString settings = QString("%1x%2:%3:%4:%5:%6:%7:%8").arg(image.width()).arg(image.height())
+                                 .arg(int(image.format())).arg(backend, language).arg(dpi).arg(preprocessed ? 1 : 0)
+                                 .arg(EncodingVersion);
+    hasher.addData(settings.toUtf8());
+    // Only the bytes of pixels: row padding may hold anything
+    const int rowBytes = (image.width() * image.depth() + 7) / 8;
+    for (int y = 0; y < image.height(); ++y) {
+        hasher.addData(reinterpret_cast<const char*>(image.constScanLine(y)), rowBytes);
+    }
+    return hasher.result();
+}
+
+bool OcrResultCache::find(const QByteArray& key, OcrResult* result)
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready || key.isEmpty()) return false;
+
+    QSqlQuery query(d->sqlDb);
+    query.prepare("SELECT data FROM ocr_results WHERE key = :key;");
+    query.bindValue(":key", key);
+    if (!query.exec()) {
+        LOG_ERROR("OcrResultCache: Failed to read result: " << query.lastError().text());
+        return false;
+    }
+    if (!query.next()) return false;
+    if (!decode(query.value(0).toByteArray(), result)) {
+        LOG_WARN("OcrResultCache: Discarding an unreadable result.");
+        QSqlQuery remove(d->sqlDb);
+        remove.prepare("DELETE FROM ocr_results WHERE key = :key;");
+        remove.bindValue(":key", key);
+        remove.exec();
+        return false;
+    }
+
+    QSqlQuery touch(d->sqlDb);
+    touch.prepare("UPDATE ocr_results SET last_used = :used WHERE key = :key;");
+    touch.bindValue(":used", QDateTime::currentMSecsSinceEpoch());
+    touch.bindValue(":key", key);
+    if (!touch.exec()) LOG_WARN("OcrResultCache: Failed to update result entry: " << touch.lastError().text());
+    return true;
+}
+
+bool OcrResultCache::store(const QByteArray& key, const OcrResult& result)
+{
+    if (key.isEmpty()) return false;
+    const QByteArray data = encode(result);
+
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) return false;
+
+    QSqlQuery query(d->sqlDb);
+    query.prepare("INSERT OR REPLACE INTO ocr_results (key, data, last_used) VALUES (:key, :data, :used);");
+    query.bindValue(":key", key);
+    query.bindValue(":data", data);
+    query.bindValue(":used", QDateTime::currentMSecsSinceEpoch());
+    if (!query.exec()) {
+        LOG_ERROR("OcrResultCache: Failed to store result: " << query.lastError().text());
+        return false;
+    }
+    if (++d->storesSincePrune >= PruneInterval) d->pruneLocked();
+    return true;
+}
+
+void OcrResultCache::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) return;
+    QSqlQuery query(d->sqlDb);
+    if (!query.exec("DELETE FROM ocr_results;")) {
+        LOG_ERROR("OcrResultCache: Failed to clear: " << query.lastError().text());
+    }
+}
+
+int OcrResultCache::maxEntries() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maxEntriesVal;
+}
+
+void OcrResultCache::setMaxEntries(int count)
+{
+    QMutexLocker locker(&d->mutex);
+    d->maxEntriesVal = qMax(0, count);
+    if (d->ready) d->pruneLocked();
+}
+
+QString OcrResultCache::databasePath() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->dbPathStr;
+}
+
+} // namespace QuantilyxDoc
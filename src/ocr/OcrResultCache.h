@@ -0,0 +1,127 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_OCRRESULTCACHE_H
+#define QUANTILYX_OCRRESULTCACHE_H
+
+#include "OcrEngine.h"
+#include <QObject>
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Persistent store of OCR results, keyed by what was recognized.
+ *
+ * Keeps each recognized page's text, elements, boxes and confidences in an
+ * SQLite database next to MetadataDatabase, so a page seen before is not
+ * recognized again, whichever file it is in. Entries are keyed by a hash
+ * of the image's pixels together with the backend, language, resolution
+ * and preprocessing used, so a change of any of them recognizes anew.
+ *
+ * Results are stored in a compact binary encoding. The least recently used
+ * entries are pruned beyond maxEntries(), from Advanced/OcrCachePages.
+ */
+class OcrResultCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit OcrResultCache(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor.
+     */
+    ~OcrResultCache() override;
+
+    /**
+     * @brief Get singleton instance.
+     * @return Reference to the global OcrResultCache instance.
+     */
+    static OcrResultCache& instance();
+
+    /**
+     * @brief Open the database, creating tables if they don't exist.
+     * @param dbPath Path to the database file; empty for the default location.
+     * @return True if initialization was successful.
+     */
+    bool initialize(const QString& dbPath = QString());
+
+    /**
+     * @brief Check if the cache is open.
+     * @return True if ready.
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Compute the key of an image recognized with given settings.
+     * @param image The image handed to the engine.
+     * @param backend Name of the backend recognizing it.
+     * @param language Engine language code.
+     * @param dpi Engine resolution.
+     * @param preprocessed Whether the image goes through OcrPreprocessor.
+     * @return Key for find() and store().
+     */
+    static QByteArray keyFor(const QImage& image, const QString& backend, const QString& language, int dpi, bool preprocessed);
+
+    /**
+     * @brief Look up a stored result.
+     * @param key Key from keyFor().
+     * @param result Set to the stored result if found.
+     * @return True if a result was found.
+     */
+    bool find(const QByteArray& key, OcrResult* result);
+
+    /**
+     * @brief Store a result, replacing any under the same key.
+     * @param key Key from keyFor().
+     * @param result Result to store.
+     * @return True if the operation was successful.
+     */
+    bool store(const QByteArray& key, const OcrResult& result);
+
+    /**
+     * @brief Delete every stored result.
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of results kept before the oldest are pruned.
+     * @return Entry limit.
+     */
+    int maxEntries() const;
+
+    /**
+     * @brief Set the number of results kept before the oldest are pruned.
+     * @param count Entry limit.
+     */
+    void setMaxEntries(int count);
+
+    /**
+     * @brief Get the path to the database file.
+     * @return Database file path string.
+     */
+    QString databasePath() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+    static OcrResultCache* s_instance;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_OCRRESULTCACHE_H
@@ -0,0 +1,496 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "PaddleOcrBackend.h"
+
+#ifdef HAVE_PADDLEOCR
+
+#include "../core/CancellationToken.h"
+#include "../core/Logger.h"
+#include "../core/Settings.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <paddle_inference_api.h>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Detector input: longest side at most this, both sides multiples of DetectionAlign
+const int DetectionMaxSide = 1536;
+const int DetectionAlign = 32;
+// DB post-processing, as PaddleOCR's defaults
+const float DetectionThreshold = 0.3f;
+const float BoxThreshold = 0.6f;
+const qreal UnclipRatio = 1.5;
+const int MinBoxSide = 3;
+// Recognizer input height of the PP-OCRv3/v4 models, and the widest crop passed
+const int RecognitionHeight = 48;
+const int MaxCropWidth = 1280;
+const int DefaultCropBatch = 32;
+const int DefaultPageBatch = 8;
+const int DefaultGpuMemoryMB = 2048;
+
+// Detector normalization of RGB, ImageNet statistics
+const float DetectionMean[3] = {0.485f, 0.456f, 0.406f};
+const float DetectionStd[3] = {0.229f, 0.224f, 0.225f};
+
+// Text line found by the detector, cropped and scaled for the recognizer
+struct Crop {
+    int page;
+    QRectF box;   // In page image coordinates
+    QImage image; // RGB888, RecognitionHeight high
+};
+
+int alignUp(int value, int alignment)
+{
+    return qMax(alignment, (value + alignment - 1) / alignment * alignment);
+}
+
+// Boxes of the text regions of one probability map, in page image coordinates
+QVector<QRectF> boxesFromMap(const float* map, int mapWidth, int width, int height, qreal scale, const QSize& page)
+{
+    QVector<QRectF> boxes;
+    QVector<quint8> visited(width * height, 0);
+    QVector<int> stack;
+    for (int start = 0; start < width * height; ++start) {
+        const int sx = start % width;
+        const int sy = start / width;
+        if (visited[start] || map[sy * mapWidth + sx] <= DetectionThreshold) continue;
+
+        // Flood the 4-connected region above the threshold
+        int left = sx, right = sx, top = sy, bottom = sy;
+        double scoreSum = 0;
+        int pixels = 0;
+        visited[start] = 1;
+        stack.append(start);
+        while (!stack.isEmpty()) {
+            const int at = stack.takeLast();
+            const int x = at % width;
+            const int y = at / width;
+            scoreSum += map[y * mapWidth + x];
+            ++pixels;
+            left = qMin(left, x);
+            right = qMax(right, x);
+            top = qMin(top, y);
+            bottom = qMax(bottom, y);
+            const int neighbours[4] = {x > 0 ? at - 1 : -1, x + 1 < width ? at + 1 : -1,
+                                       y > 0 ? at - width : -1, y + 1 < height ? at + width : -1};
+            for (int next : neighbours) {
+                if (next < 0 || visited[next] || map[(next / width) * mapWidth + next % width] <= DetectionThreshold) continue;
+                visited[next] = 1;
+                stack.append(next);
+            }
+        }
+
+        const int boxWidth = right - left + 1;
+        const int boxHeight = bottom - top + 1;
+        if (qMin(boxWidth, boxHeight) < MinBoxSide || scoreSum / pixels < BoxThreshold) continue;
+
+        // The detector marks shrunken text kernels; grow them back out
+        const qreal offset = UnclipRatio * boxWidth * boxHeight / (2.0 * (boxWidth + boxHeight));
+        const QRectF grown(left - offset, top - offset, boxWidth + 2 * offset, boxHeight + 2 * offset);
+        const QRectF box = QRectF(grown.x() / scale, grown.y() / scale, grown.width() / scale, grown.height() / scale)
+                               .intersected(QRectF(QPointF(0, 0), QSizeF(page)));
+        if (!box.isEmpty()) boxes.append(box);
+    }
+    return boxes;
+}
+
+// Greedy CTC decoding: best class per step, repeats merged, blanks (class 0) dropped
+QString decodeCtc(const float* probabilities, int steps, int classes, const QStringList& dictionary, float* confidence)
+{
+    QString text;
+    float scoreSum = 0;
+    int emitted = 0;
+    int previous = 0;
+    for (int t = 0; t < steps; ++t) {
+        const float* row = probabilities + t * classes;
+        const int best = int(std::max_element(row, row + classes) - row);
+        if (best != 0 && best != previous) {
+            // Classes past the dictionary are the space the models append
+            text += best <= dictionary.size() ? dictionary[best - 1] : QStringLiteral(" ");
+            scoreSum += row[best];
+            ++emitted;
+        }
+        previous = best;
+    }
+    *confidence = emitted > 0 ? scoreSum / emitted : 0.0f;
+    return text;
+}
+
+} // namespace
+
+class PaddleOcrBackend::Private {
+public:
+    Private() : modelsLoaded(false) {}
+
+    mutable QMutex mutex;   // Protects the configuration
+    QString language;
+    QString datapath;
+    QStringList dictionary; // Recognizer classes 1.., class 0 being the CTC blank
+    bool modelsLoaded;
+
+    QMutex gpuMutex;        // One batch on the GPU at a time; also guards the predictors
+    std::shared_ptr<paddle_infer::Predictor> detector;   // DB text detector
+    std::shared_ptr<paddle_infer::Predictor> recognizer; // CRNN recognizer
+
+    static QStringList loadDictionary(const QString& path) {
+        QStringList entries;
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return entries;
+        QTextStream stream(&file);
+        stream.setCodec("UTF-8");
+        while (!stream.atEnd()) {
+            const QString line = stream.readLine();
+            if (!line.isEmpty()) entries.append(line);
+        }
+        return entries;
+    }
+
+    static bool modelPresent(const QString& directory) {
+        return QFileInfo::exists(directory + "/inference.pdmodel") && QFileInfo::exists(directory + "/inference.pdiparams");
+    }
+
+    // Set the predictors up on the GPU. Called with gpuMutex held.
+    bool loadModelsLocked(const QString& path) {
+        const int memoryMB = qMax(64, Settings::instance().value<int>("Advanced/OcrGpuMemoryMB", DefaultGpuMemoryMB));
+        auto makePredictor = [memoryMB](const QString& directory) {
+            paddle_infer::Config config;
+            config.SetModel(QFile::encodeName(directory + "/inference.pdmodel").toStdString(),
+                            QFile::encodeName(directory + "/inference.pdiparams").toStdString());
+            config.EnableUseGpu(memoryMB, 0); // Initial memory pool in MB, device 0
+            config.SwitchIrOptim(true);
+            config.EnableMemoryOptim();
+            return paddle_infer::CreatePredictor(config);
+        };
+        detector.reset();
+        recognizer.reset();
+        try {
+            detector = makePredictor(path + "/det");
+            recognizer = makePredictor(path + "/rec");
+        } catch (const std::exception& e) {
+            LOG_ERROR("PaddleOcrBackend: Cannot load the models in " << path << ": " << e.what());
+            detector.reset();
+            recognizer.reset();
+            return false;
+        }
+        if (!detector || !recognizer) {
+            LOG_ERROR("PaddleOcrBackend: Cannot load the models in " << path);
+            detector.reset();
+            recognizer.reset();
+            return false;
+        }
+        LOG_INFO("PaddleOcrBackend: Loaded the models in " << path);
+        return true;
+    }
+
+    // Run the detector on an NCHW batch; one probability map per image. Called with gpuMutex held.
+    QVector<float> runDetectorLocked(const QVector<float>& input, int count, int height, int width) {
+        QVector<float> maps;
+        if (!detector) return maps;
+        try {
+            auto in = detector->GetInputHandle(detector->GetInputNames()[0]);
+            in->Reshape({count, 3, height, width});
+            in->CopyFromCpu(input.constData());
+            if (!detector->Run()) return maps;
+            auto out = detector->GetOutputHandle(detector->GetOutputNames()[0]); // count x 1 x height x width
+            const std::vector<int> shape = out->shape();
+            if (shape.size() != 4 || shape[0] != count || shape[2] != height || shape[3] != width) return maps;
+            maps.resize(count * height * width);
+            out->CopyToCpu(maps.data());
+        } catch (const std::exception& e) {
+            LOG_ERROR("PaddleOcrBackend: Text detection failed: " << e.what());
+            maps.clear();
+        }
+        return maps;
+    }
+
+    // Run the recognizer on an NCHW batch; per image, steps x classes probabilities. Called with gpuMutex held.
+    QVector<float> runRecognizerLocked(const QVector<float>& input, int count, int width, int* steps, int* classes) {
+        QVector<float> probabilities;
+        *steps = 0;
+        *classes = 0;
+        if (!recognizer) return probabilities;
+        try {
+            auto in = recognizer->GetInputHandle(recognizer->GetInputNames()[0]);
+            in->Reshape({count, 3, RecognitionHeight, width});
+            in->CopyFromCpu(input.constData());
+            if (!recognizer->Run()) return probabilities;
+            auto out = recognizer->GetOutputHandle(recognizer->GetOutputNames()[0]);
+            const std::vector<int> shape = out->shape(); // count x steps x classes
+            if (shape.size() != 3 || shape[0] != count) return probabilities;
+            probabilities.resize(count * shape[1] * shape[2]);
+            out->CopyToCpu(probabilities.data());
+            *steps = shape[1];
+            *classes = shape[2];
+        } catch (const std::exception& e) {
+            LOG_ERROR("PaddleOcrBackend: Text recognition failed: " << e.what());
+            probabilities.clear();
+        }
+        return probabilities;
+    }
+
+    // Scale the pages into one padded, normalized detector batch
+    static QVector<float> detectionBatch(const QList<QImage>& images, QVector<qreal>* scales, int* height, int* width) {
+        QList<QImage> scaled;
+        int maxHeight = 0, maxWidth = 0;
+        for (const QImage& image : images) {
+            const qreal scale = qMin<qreal>(1.0, qreal(DetectionMaxSide) / qMax(image.width(), image.height()));
+            const QImage rgb = image.scaled(qMax(1, qRound(image.width() * scale)), qMax(1, qRound(image.height() * scale)),
+                                            Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_RGB888);
+            scales->append(scale);
+            maxHeight = qMax(maxHeight, rgb.height());
+            maxWidth = qMax(maxWidth, rgb.width());
+            scaled.append(rgb);
+        }
+        *height = alignUp(maxHeight, DetectionAlign);
+        *width = alignUp(maxWidth, DetectionAlign);
+
+        const int plane = *height * *width;
+        QVector<float> tensor(scaled.size() * 3 * plane, 0.0f);
+        for (int n = 0; n < scaled.size(); ++n) {
+            float* base = tensor.data() + n * 3 * plane;
+            for (int y = 0; y < scaled[n].height(); ++y) {
+                const uchar* row = scaled[n].constScanLine(y);
+                for (int x = 0; x < scaled[n].width(); ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        base[c * plane + y * *width + x] = (row[x * 3 + c] / 255.0f - DetectionMean[c]) / DetectionStd[c];
+                    }
+                }
+            }
+        }
+        return tensor;
+    }
+
+    // Pack crops into a recognizer batch as wide as the widest, zero padded
+    static QVector<float> recognitionBatch(const QVector<const Crop*>& crops, int* width) {
+        *width = 0;
+        for (const Crop* crop : crops) *width = qMax(*width, crop->image.width());
+        const int plane = RecognitionHeight * *width;
+        QVector<float> tensor(crops.size() * 3 * plane, 0.0f);
+        for (int n = 0; n < crops.size(); ++n) {
+            float* base = tensor.data() + n * 3 * plane;
+            const QImage& image = crops[n]->image;
+            for (int y = 0; y < RecognitionHeight; ++y) {
+                const uchar* row = image.constScanLine(y);
+                for (int x = 0; x < image.width(); ++x) {
+                    for (int c = 0; c < 3; ++c) base[c * plane + y * *width + x] = row[x * 3 + c] / 127.5f - 1.0f;
+                }
+            }
+        }
+        return tensor;
+    }
+
+    // Join a page's recognized lines into its text, in reading order
+    static void assemble(OcrResult* result) {
+        QVector<int> order(result->boundingBoxes.size());
+        for (int i = 0; i < order.size(); ++i) order[i] = i;
+        const QVector<QRectF>& boxes = result->boundingBoxes;
+        std::sort(order.begin(), order.end(), [&boxes](int a, int b) { return boxes[a].top() < boxes[b].top(); });
+
+        QString text;
+        qreal lineBottom = -1;
+        QVector<int> line;
+        auto flush = [&]() {
+            std::sort(line.begin(), line.end(), [&boxes](int a, int b) { return boxes[a].left() < boxes[b].left(); });
+            QStringList words;
+            for (int i : line) {
+                if (!result->elementTexts[i].isEmpty()) words.append(result->elementTexts[i]);
+            }
+            if (!words.isEmpty()) {
+                if (!text.isEmpty()) text += QLatin1Char('\n');
+                text += words.join(QLatin1Char(' '));
+            }
+            line.clear();
+        };
+        for (int i : order) {
+            // A box whose middle is above the line's bottom continues the line
+            if (!line.isEmpty() && boxes[i].center().y() > lineBottom) flush();
+            lineBottom = line.isEmpty() ? boxes[i].bottom() : qMax(lineBottom, boxes[i].bottom());
+            line.append(i);
+        }
+        if (!line.isEmpty()) flush();
+        result->text = text;
+    }
+};
+
+PaddleOcrBackend::PaddleOcrBackend()
+    : d(new Private())
+{
+}
+
+PaddleOcrBackend::~PaddleOcrBackend() = default;
+
+QString PaddleOcrBackend::name() const
+{
+    return QStringLiteral("paddleocr");
+}
+
+QString PaddleOcrBackend::defaultDatapath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/paddleocr";
+}
+
+bool PaddleOcrBackend::configure(const QString& language, const QString& datapath)
+{
+    if (!Private::modelPresent(datapath + "/det") || !Private::modelPresent(datapath + "/rec")) {
+        LOG_ERROR("PaddleOcrBackend: No det/ and rec/ models in " << datapath);
+        return false;
+    }
+    const QStringList dictionary = Private::loadDictionary(datapath + "/dict.txt");
+    if (dictionary.isEmpty()) {
+        LOG_ERROR("PaddleOcrBackend: Cannot read the recognizer dictionary " << datapath << "/dict.txt");
+        return false;
+    }
+
+    // Waits for the batch on the GPU, which finishes with the old models
+    QMutexLocker gpuLocker(&d->gpuMutex);
+    const bool loaded = d->loadModelsLocked(datapath);
+    QMutexLocker locker(&d->mutex);
+    d->language = language;
+    d->datapath = datapath;
+    d->dictionary = dictionary;
+    d->modelsLoaded = loaded;
+    return loaded;
+}
+
+QStringList PaddleOcrBackend::supportedLanguages(const QString& datapath) const
+{
+    // The recognizer is trained for one script; its language comes with the models
+    const QString language = QFileInfo(datapath).fileName();
+    QMutexLocker locker(&d->mutex);
+    return QStringList() << (d->language.isEmpty() ? language : d->language);
+}
+
+int PaddleOcrBackend::maxConcurrentRecognitions() const
+{
+    return 1; // The GPU takes one batch at a time
+}
+
+int PaddleOcrBackend::preferredBatchSize() const
+{
+    return qMax(1, Settings::instance().value<int>("Advanced/OcrGpuBatchPages", DefaultPageBatch));
+}
+
+bool PaddleOcrBackend::wantsPreprocessing() const
+{
+    return false;
+}
+
+bool PaddleOcrBackend::resultsCacheable() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->modelsLoaded;
+}
+
+QList<OcrResult> PaddleOcrBackend::recognize(const QList<QImage>& images, int dpi)
+{
+    Q_UNUSED(dpi); // Both models work at their own scale
+    QList<OcrResult> results;
+    for (int i = 0; i < images.size(); ++i) {
+        OcrResult empty;
+        empty.confidence = 0.0f;
+        results.append(empty);
+    }
+    QStringList dictionary;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (!d->modelsLoaded) {
+            LOG_WARN("PaddleOcrBackend::recognize: No models loaded. Returning empty results.");
+            return results;
+        }
+        dictionary = d->dictionary;
+    }
+
+    // Detect the text lines of every page in one pass
+    QVector<qreal> scales;
+    int mapHeight, mapWidth;
+    const QVector<float> detectionInput = Private::detectionBatch(images, &scales, &mapHeight, &mapWidth);
+    if (CancellationToken::currentIsCanceled()) return results;
+    QVector<float> maps;
+    {
+        QMutexLocker gpuLocker(&d->gpuMutex);
+        maps = d->runDetectorLocked(detectionInput, images.size(), mapHeight, mapWidth);
+    }
+    if (maps.size() != images.size() * mapHeight * mapWidth) {
+        LOG_ERROR("PaddleOcrBackend::recognize: Text detection failed for a batch of " << images.size() << " pages.");
+        return results;
+    }
+
+    QVector<Crop> crops;
+    for (int n = 0; n < images.size(); ++n) {
+        const int width = qMin(mapWidth, qRound(images[n].width() * scales[n]));
+        const int height = qMin(mapHeight, qRound(images[n].height() * scales[n]));
+        const QVector<QRectF> boxes = boxesFromMap(maps.constData() + n * mapHeight * mapWidth, mapWidth, width, height,
+                                                   scales[n], images[n].size());
+        for (const QRectF& box : boxes) {
+            const QImage line = images[n].copy(box.toAlignedRect());
+            const int cropWidth = qBound(1, int(std::ceil(qreal(RecognitionHeight) * line.width() / qMax(1, line.height()))), MaxCropWidth);
+            const Crop crop = {n, box, line.scaled(cropWidth, RecognitionHeight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                                           .convertToFormat(QImage::Format_RGB888)};
+            crops.append(crop);
+        }
+    }
+
+    // Crops of similar aspect share a batch, so batches are little padding
+    QVector<const Crop*> sorted;
+    sorted.reserve(crops.size());
+    for (const Crop& crop : crops) sorted.append(&crop);
+    std::sort(sorted.begin(), sorted.end(), [](const Crop* a, const Crop* b) { return a->image.width() < b->image.width(); });
+
+    const int cropBatch = qMax(1, Settings::instance().value<int>("Advanced/OcrGpuBatchCrops", DefaultCropBatch));
+    QVector<float> confidenceSums(images.size(), 0.0f);
+    for (int first = 0; first < sorted.size(); first += cropBatch) {
+        // Lines of a canceled batch stay unread; the caller drops the results
+        if (CancellationToken::currentIsCanceled()) break;
+        const QVector<const Crop*> batch = sorted.mid(first, cropBatch);
+        int batchWidth;
+        const QVector<float> input = Private::recognitionBatch(batch, &batchWidth);
+        int steps, classes;
+        QVector<float> probabilities;
+        {
+            QMutexLocker gpuLocker(&d->gpuMutex);
+            probabilities = d->runRecognizerLocked(input, batch.size(), batchWidth, &steps, &classes);
+        }
+        if (steps <= 0 || classes <= 1 || probabilities.size() != batch.size() * steps * classes) {
+            LOG_ERROR("PaddleOcrBackend::recognize: Text recognition failed for a batch of " << batch.size() << " lines.");
+            continue;
+        }
+        for (int k = 0; k < batch.size(); ++k) {
+            float confidence;
+            const QString text = decodeCtc(probabilities.constData() + k * steps * classes, steps, classes, dictionary, &confidence);
+            OcrResult& result = results[batch[k]->page];
+            result.boundingBoxes.append(batch[k]->box);
+            result.elementTexts.append(text);
+            result.elementConfidences.append(confidence);
+            confidenceSums[batch[k]->page] += confidence;
+        }
+    }
+
+    for (int n = 0; n < results.size(); ++n) {
+        OcrResult& result = results[n];
+        if (!result.boundingBoxes.isEmpty()) result.confidence = confidenceSums[n] / result.boundingBoxes.size();
+        Private::assemble(&result);
+    }
+    return results;
+}
+
+} // namespace QuantilyxDoc
+
+#endif // HAVE_PADDLEOCR
@@ -0,0 +1,62 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_PADDLEOCRBACKEND_H
+#define QUANTILYX_PADDLEOCRBACKEND_H
+
+#ifdef HAVE_PADDLEOCR
+
+#include "OcrBackend.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief OCR backend on PaddleOCR models, recognizing on the GPU.
+ *
+ * Runs the PP-OCR pipeline through Paddle Inference: a DB text detector
+ * finds the text lines of every page in a batch in one pass, then the
+ * line crops of all those pages, sorted by aspect ratio so little of each
+ * batch is padding, go through the CRNN recognizer in batches of
+ * Advanced/OcrGpuBatchCrops. Text is decoded by CTC against the model's
+ * dictionary. Pages are best handed over Advanced/OcrGpuBatchPages at a
+ * time; the GPU runs one batch at a time, while callers keep rendering and
+ * cropping the next ones.
+ *
+ * The datapath holds det/ and rec/ model directories, each with
+ * inference.pdmodel and inference.pdiparams, and the recognizer's
+ * dictionary as dict.txt. Models take colour page images, so OcrEngine
+ * does not preprocess them.
+ */
+class PaddleOcrBackend : public OcrBackend
+{
+public:
+    PaddleOcrBackend();
+    ~PaddleOcrBackend() override;
+
+    QString name() const override;
+    QString defaultDatapath() const override;
+    bool configure(const QString& language, const QString& datapath) override;
+    QStringList supportedLanguages(const QString& datapath) const override;
+    int maxConcurrentRecognitions() const override;
+    int preferredBatchSize() const override;
+    bool wantsPreprocessing() const override;
+    bool resultsCacheable() const override;
+    QList<OcrResult> recognize(const QList<QImage>& images, int dpi) override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // HAVE_PADDLEOCR
+
+#endif // QUANTILYX_PADDLEOCRBACKEND_H
@@ -0,0 +1,271 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "TesseractBackend.h"
+#include "../core/CancellationToken.h"
+#include "../core/Logger.h"
+#include "../core/Settings.h"
+#include "../core/ThreadPool.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QVector>
+// #include <tesseract/baseapi.h> // Hypothetical Tesseract C++ API header
+// #include <leptonica/allheaders.h> // Hypothetical Leptonica header for image handling with Tesseract
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Approximate memory one Tesseract handle takes per loaded language
+const int EngineMBPerLanguage = 80;
+const int DefaultEngineMemoryMB = 1024;
+
+// One Tesseract handle; recognizes one image at a time
+struct EngineHandle {
+    // tesseract::TessBaseAPI api; // Hypothetical Tesseract API instance
+    int generation = -1; // Configuration the handle was set up with; -1 before the first
+};
+
+} // namespace
+
+class TesseractBackend::Private {
+public:
+    Private() : handleCount(0), maxHandles(1), generation(0) {}
+
+    ~Private() {
+        for (EngineHandle* handle : idleHandles) destroyHandle(handle);
+    }
+
+    mutable QMutex mutex; // Protects the configuration and the handle pool
+    QString language;
+    QString datapath;
+    QVector<EngineHandle*> idleHandles;
+    int handleCount;                // Handles in existence, idle or checked out
+    int maxHandles;
+    int generation;                 // Bumped when the language or datapath change
+    QWaitCondition handleReturned;
+
+    // A handle checked out for the lifetime of the lease; null if none could be set up
+    struct Lease {
+        explicit Lease(Private* p) : d(p), handle(p->acquireHandle()) {}
+        ~Lease() { if (handle) d->releaseHandle(handle); }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Private* d;
+        EngineHandle* handle;
+    };
+
+    // Size the pool from the worker count and the memory allowance. Called with mutex held.
+    void updatePoolSizeLocked() {
+        const int languages = qMax(1, language.split(QLatin1Char('+'), Qt::SkipEmptyParts).size());
+        const int memoryMB = Settings::instance().value<int>("Advanced/OcrEngineMemoryMB", DefaultEngineMemoryMB);
+        maxHandles = qBound(1, memoryMB / (EngineMBPerLanguage * languages), qMax(1, ThreadPool::instance().maxThreadCount()));
+        while (handleCount > maxHandles && !idleHandles.isEmpty()) {
+            destroyHandle(idleHandles.takeLast());
+            --handleCount;
+        }
+        handleReturned.wakeAll();
+    }
+
+    // Check out a handle set up for the current configuration, waiting if all are in use
+    EngineHandle* acquireHandle() {
+        QMutexLocker locker(&mutex);
+        while (idleHandles.isEmpty() && handleCount >= maxHandles) handleReturned.wait(&mutex);
+        EngineHandle* handle;
+        if (!idleHandles.isEmpty()) {
+            handle = idleHandles.takeLast();
+        } else {
+            handle = new EngineHandle;
+            ++handleCount;
+        }
+        if (handle->generation == generation) return handle;
+
+        // Setting up loads the language data, which takes a while; others keep recognizing
+        const QString setupLanguage = language;
+        const QString setupPath = datapath;
+        const int setupGeneration = generation;
+        locker.unlock();
+        if (setupHandle(handle, setupLanguage, setupPath)) {
+            handle->generation = setupGeneration;
+            return handle;
+        }
+        destroyHandle(handle);
+        locker.relock();
+        --handleCount;
+        handleReturned.wakeOne();
+        return nullptr;
+    }
+
+    void releaseHandle(EngineHandle* handle) {
+        QMutexLocker locker(&mutex);
+        if (handleCount > maxHandles) {
+            // The pool shrank while the handle was out
+            destroyHandle(handle);
+            --handleCount;
+        } else {
+            idleHandles.append(handle);
+        }
+        handleReturned.wakeOne();
+    }
+
+    static bool setupHandle(EngineHandle* handle, const QString& language, const QString& path) {
+        Q_UNUSED(handle);
+        // handle->api.End();
+        // int initResult = handle->api.Init(path.isEmpty() ? nullptr : path.toUtf8().constData(), language.toUtf8().constData());
+        // if (initResult != 0) {
+        //     LOG_ERROR("TesseractBackend: Failed to initialize Tesseract API for language '" << language << "', datapath: " << path);
+        //     return false;
+        // }
+        // handle->api.SetVariable("tessedit_char_whitelist", ""); // Optionally set whitelist
+        LOG_DEBUG("TesseractBackend: Set up an engine handle for language '" << language << "', datapath: " << path);
+        return true;
+    }
+
+    static void destroyHandle(EngineHandle* handle) {
+        // handle->api.End(); // Cleanup Tesseract
+        delete handle;
+    }
+
+    // Helper to convert QImage to Pix (Leptonica format) for Tesseract
+    // Pix* qImageToPix(const QImage& image) const {
+    //     // This conversion is complex and depends on the image format.
+    //     // Leptonica provides functions like pixCreateFromQImage or similar.
+    //     // For now, assume a conversion exists.
+    //     // Example using hypothetical function:
+    //     // return pixCreateFromQImage(image);
+    //     LOG_WARN("TesseractBackend::qImageToPix: Requires Leptonica integration.");
+    //     return nullptr; // Placeholder
+    // }
+};
+
+TesseractBackend::TesseractBackend()
+    : d(new Private())
+{
+}
+
+TesseractBackend::~TesseractBackend() = default;
+
+QString TesseractBackend::name() const
+{
+    return QStringLiteral("tesseract");
+}
+
+QString TesseractBackend::defaultDatapath() const
+{
+    return QStringLiteral("/usr/share/tessdata");
+}
+
+bool TesseractBackend::configure(const QString& language, const QString& datapath)
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->language = language;
+        d->datapath = datapath;
+        // Idle handles are set up again for it when next checked out
+        ++d->generation;
+        d->updatePoolSizeLocked();
+    }
+
+    // Set up the first handle now, so a bad language or datapath shows here;
+    // the others are set up as recognitions need them
+    return Private::Lease(d.get()).handle != nullptr;
+}
+
+QStringList TesseractBackend::supportedLanguages(const QString& datapath) const
+{
+    // Tesseract does not provide a direct API to list installed languages.
+    // You need to scan the tessdata directory for .traineddata files.
+    // QDir tessdataDir(datapath);
+    // QStringList filters;
+    // filters << "*.traineddata";
+    // QStringList langFiles = tessdataDir.entryList(filters);
+    // QStringList langs;
+    // for (const QString& file : langFiles) {
+    //     QString langCode = file.left(file.lastIndexOf('.')); // Remove .traineddata extension
+    //     langs.append(langCode);
+    // }
+    // return langs;
+    Q_UNUSED(datapath);
+
+    LOG_WARN("TesseractBackend::supportedLanguages: Requires scanning tessdata directory. Returning placeholder.");
+    return QStringList() << "eng" << "deu" << "fra"; // Placeholder
+}
+
+int TesseractBackend::maxConcurrentRecognitions() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maxHandles;
+}
+
+int TesseractBackend::preferredBatchSize() const
+{
+    return 1; // A handle takes one image at a time; parallelism comes from the pool
+}
+
+bool TesseractBackend::wantsPreprocessing() const
+{
+    return true;
+}
+
+bool TesseractBackend::resultsCacheable() const
+{
+    return false; // Placeholders until Tesseract is linked in
+}
+
+QList<OcrResult> TesseractBackend::recognize(const QList<QImage>& images, int dpi)
+{
+    Q_UNUSED(dpi);
+    QList<OcrResult> results;
+    Private::Lease lease(d.get());
+    for (const QImage& image : images) {
+        Q_UNUSED(image);
+        OcrResult result;
+        result.confidence = 0.0f;
+        if (!lease.handle || CancellationToken::currentIsCanceled()) {
+            results.append(result);
+            continue;
+        }
+
+        // Pix* pixImage = d->qImageToPix(image);
+        // if (!pixImage) {
+        //     LOG_ERROR("TesseractBackend::recognize: Failed to convert QImage to Pix.");
+        //     results.append(result);
+        //     continue;
+        // }
+        // lease.handle->api.SetImage(pixImage);
+        // lease.handle->api.SetSourceResolution(dpi); // Set DPI
+
+        // Recognition polls the monitor between words, so a canceled token
+        // stops it mid-page:
+        // ETEXT_DESC monitor;
+        // monitor.cancel = [](void*, int) { return CancellationToken::currentIsCanceled(); };
+        // lease.handle->api.Recognize(&monitor);
+
+        // Use Tesseract's HOCR or BoxText functions to get bounding boxes
+        // and confidences. This requires more complex parsing of
+        // Tesseract's output formats.
+        // result.text = ...;
+        // result.boundingBoxes = ...; // Parsed from HOCR or Boxes
+        // result.elementTexts = ...; // Word of each box
+        // result.elementConfidences = ...; // Confidence of each word
+        // result.confidence = ...; // Average over the words
+
+        // pixDestroy(&pixImage); // Clean up Pix
+
+        LOG_WARN("TesseractBackend::recognize: Requires Tesseract HOCR/BoxText integration. Returning placeholder.");
+        result.text = "Detailed OCR text placeholder";
+        result.confidence = 0.8f;
+        results.append(result); // Placeholder
+    }
+    return results;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,52 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_TESSERACTBACKEND_H
+#define QUANTILYX_TESSERACTBACKEND_H
+
+#include "OcrBackend.h"
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief OCR backend on Tesseract, recognizing on the CPU.
+ *
+ * A Tesseract handle recognizes one image at a time, so the backend keeps
+ * a pool of them, all set up with the same language and datapath, and each
+ * recognition checks one out. The pool holds at most one handle per
+ * worker thread and no more than Advanced/OcrEngineMemoryMB allows, at
+ * roughly 80 MB per language per handle; recognitions beyond that wait
+ * for a handle to come back. Handles are created on first use and set up
+ * again after the language or datapath changes.
+ */
+class TesseractBackend : public OcrBackend
+{
+public:
+    TesseractBackend();
+    ~TesseractBackend() override;
+
+    QString name() const override;
+    QString defaultDatapath() const override;
+    bool configure(const QString& language, const QString& datapath) override;
+    QStringList supportedLanguages(const QString& datapath) const override;
+    int maxConcurrentRecognitions() const override;
+    int preferredBatchSize() const override;
+    bool wantsPreprocessing() const override;
+    bool resultsCacheable() const override;
+    QList<OcrResult> recognize(const QList<QImage>& images, int dpi) override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_TESSERACTBACKEND_H
@@ -8,120 +8,435 @@
  * (at your option) any later version.
  */
 #include "ContentComparison.h"
+#include "../core/CancellationToken.h"
 #include "../core/Document.h"
 #include "../core/Page.h"
 #include "../core/Logger.h"
+#include "../core/MetadataDatabase.h"
+#include "../core/ThreadPool.h"
+#include "../core/PerceptualHash.h"
+#include "TextDiff.h"
+#include "ImageDiff.h"
 #include <QImage>
 #include <QPainter>
-#include <QTextDocument> // For basic text comparison
-#include <QTextBlock>
-#include <QTextFragment>
 #include <QRegularExpression>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QDebug>
+#include <atomic>
+#include <cstring>
+#include <limits>
 
 namespace QuantilyxDoc {
 
-class ContentComparison::Private {
-public:
-    Private(ContentComparison* q_ptr)
-        : q(q_ptr), similarityThresholdVal(0.8f) {}
+namespace {
 
-    ContentComparison* q;
-    mutable QMutex mutex; // Protect access if needed during comparison
-    float similarityThresholdVal;
+// Resolution pages are rendered at for image comparison
+const int ImageCompareDpi = 100;
 
-    // Helper to calculate similarity between two strings (e.g., using Levenshtein distance)
-    float calculateStringSimilarity(const QString& str1, const QString& str2) const {
-        if (str1 == str2) return 1.0f;
-        if (str1.isEmpty() && str2.isEmpty()) return 1.0f;
-        if (str1.isEmpty() || str2.isEmpty()) return 0.0f;
-
-        // Use Qt's built-in fuzzy matching or implement Levenshtein distance
-        // Qt doesn't have a direct Levenshtein function, so we'll use a simple ratio of common characters.
-        // A more robust implementation would use an algorithm like difflib or a dedicated library.
-        int len1 = str1.size();
-        int len2 = str2.size();
-        int commonLength = 0;
-        int minLength = qMin(len1, len2);
-
-        for (int i = 0; i < minLength; ++i) {
-            if (str1[i] == str2[i]) {
-                commonLength++;
-            }
+// Changed lines with less in common than this are reported as a whole:
+// their word and character edits would be noise
+const float MinRefinedSimilarity = 0.5f;
+
+// Lines of text with the page each comes from
+struct TextLines {
+    QStringList lines;
+    QVector<int> pages;
+
+    void append(const QString& text, int page) {
+        const QStringList pageLines = TextDiff::splitLines(text);
+        lines.append(pageLines);
+        pages.insert(pages.size(), pageLines.size(), page);
+    }
+
+    // Page of a line, or of the last line for a position past the end
+    int pageAt(int index) const {
+        if (pages.isEmpty()) return -1;
+        return pages[qBound(0, index, pages.size() - 1)];
+    }
+};
+
+QString joinedLines(const QStringList& lines, int start, int count)
+{
+    return QStringList(lines.mid(start, count)).join(QLatin1Char('\n'));
+}
+
+QString joinedParts(const QStringList& parts, int start, int count)
+{
+    QString text;
+    for (int i = start; i < start + count; ++i) text += parts[i];
+    return text;
+}
+
+// Shingle hashes kept per page, and words per shingle
+const int MinHashSlots = 32;
+const int ShingleWords = 3;
+
+// Pages less alike than this are never paired
+const float MinPageSimilarity = 0.3f;
+
+// Alignment cells computed at most; beyond that only a band around the diagonal is
+const qint64 MaxAlignCells = 16 * 1024 * 1024;
+
+// How a page looks, cheaply, for pairing pages across documents
+struct PageFingerprint {
+    QString text;
+    bool textLoaded = false;        // False for fingerprints restored from the store
+    bool hasText = false;
+    quint32 minHash[MinHashSlots];  // Smallest shingle hash under each slot's seed
+    bool hasImage = false;
+    quint64 imageHash = 0;          // Difference hash of a 9x8 rendering
+};
+
+quint32 mixHash(quint32 h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// MinHash over runs of ShingleWords case-folded words, so the share of
+// equal slots estimates how many shingles two pages share
+void fingerprintText(PageFingerprint& fingerprint, const QString& text)
+{
+    QStringList words;
+    for (const QString& part : TextDiff::splitWords(text)) {
+        if (part.at(0).isLetterOrNumber() || part.at(0).isSurrogate()) words.append(part.toCaseFolded());
+    }
+    fingerprint.text = text;
+    fingerprint.textLoaded = true;
+    fingerprint.hasText = !words.isEmpty();
+    std::fill(fingerprint.minHash, fingerprint.minHash + MinHashSlots, std::numeric_limits<quint32>::max());
+    const int shingleCount = qMax(1, words.size() - ShingleWords + 1);
+    for (int i = 0; i < shingleCount && fingerprint.hasText; ++i) {
+        const quint32 hash = qHash(QStringList(words.mid(i, ShingleWords)).join(QLatin1Char(' ')));
+        for (int slot = 0; slot < MinHashSlots; ++slot) {
+            fingerprint.minHash[slot] = qMin(fingerprint.minHash[slot], mixHash(hash ^ (0x9e3779b9u * quint32(slot + 1))));
         }
+    }
+}
 
-        float similarity = static_cast<float>(commonLength) / qMax(len1, len2);
-        LOG_DEBUG("ContentComparison: String similarity for '" << str1.left(20) << "' vs '" << str2.left(20) << "' = " << similarity);
-        return similarity;
+// Difference hash of a small rendering; robust to scaling and small shifts
+void fingerprintImage(PageFingerprint& fingerprint, Page* page)
+{
+    const QSizeF size = page->size();
+    const qreal longest = qMax(size.width(), size.height());
+    if (longest <= 0.0) return;
+    const qreal scale = 64.0 / longest;
+    const QImage rendering = page->render(qMax(9, qRound(size.width() * scale)), qMax(8, qRound(size.height() * scale)),
+                                          qMax(1, qRound(72.0 * scale)));
+    if (rendering.isNull()) return;
+    fingerprint.imageHash = PerceptualHash::dHash(rendering);
+    fingerprint.hasImage = true;
+}
+
+// A page's text, extracted now if its fingerprint came from the store
+const QString& pageText(PageFingerprint& fingerprint, Document* document, int pageIndex)
+{
+    if (!fingerprint.textLoaded) {
+        Page* page = document->page(pageIndex);
+        if (page) fingerprint.text = page->text();
+        fingerprint.textLoaded = true;
     }
+    return fingerprint.text;
+}
 
-    // Helper to compare two images (e.g., using SSIM or simple pixel difference)
-    float calculateImageSimilarity(const QImage& img1, const QImage& img2) const {
-        if (img1.isNull() || img2.isNull()) return img1.isNull() == img2.isNull() ? 1.0f : 0.0f;
-        if (img1.size() != img2.size()) return 0.0f; // Different sizes are completely different
+// Page fingerprints as kept in the fingerprint store's page_shingles:
+// a StoredPagesHeader, then one StoredPage per page
+struct StoredPagesHeader {
+    quint32 magic;
+    quint32 slots;
+    quint32 shingleWords;
+    quint32 pageCount;
+};
 
-        // For simplicity, compare raw pixel data. This is very basic.
-        // A real implementation would use Structural Similarity Index Measure (SSIM) or other perceptual metrics.
-        if (img1 == img2) return 1.0f;
+struct StoredPage {
+    quint32 minHash[MinHashSlots];
+    quint64 imageHash;
+    quint32 flags;
+    quint32 reserved;
+};
+
+const quint32 StoredPagesMagic = 0x51585046; // "QXPF"
+const quint32 StoredHasText = 1;
+const quint32 StoredHasImage = 2;
+
+QByteArray encodePages(const QVector<PageFingerprint>& fingerprints)
+{
+    const StoredPagesHeader header = {StoredPagesMagic, quint32(MinHashSlots), quint32(ShingleWords), quint32(fingerprints.size())};
+    QByteArray data(int(sizeof(header) + fingerprints.size() * sizeof(StoredPage)), Qt::Uninitialized);
+    memcpy(data.data(), &header, sizeof(header));
+    StoredPage* pages = reinterpret_cast<StoredPage*>(data.data() + sizeof(header));
+    for (int i = 0; i < fingerprints.size(); ++i) {
+        std::copy(fingerprints[i].minHash, fingerprints[i].minHash + MinHashSlots, pages[i].minHash);
+        pages[i].imageHash = fingerprints[i].imageHash;
+        pages[i].flags = (fingerprints[i].hasText ? StoredHasText : 0) | (fingerprints[i].hasImage ? StoredHasImage : 0);
+        pages[i].reserved = 0;
+    }
+    return data;
+}
+
+// Fills fingerprints from stored data for as many pages; false if the data
+// is of another layout or page count
+bool decodePages(const QByteArray& data, QVector<PageFingerprint>& fingerprints)
+{
+    StoredPagesHeader header;
+    if (data.size() < int(sizeof(header))) return false;
+    memcpy(&header, data.constData(), sizeof(header));
+    if (header.magic != StoredPagesMagic || header.slots != quint32(MinHashSlots)
+        || header.shingleWords != quint32(ShingleWords) || header.pageCount != quint32(fingerprints.size())
+        || data.size() != int(sizeof(header) + fingerprints.size() * sizeof(StoredPage))) {
+        return false;
+    }
+    for (int i = 0; i < fingerprints.size(); ++i) {
+        StoredPage page;
+        memcpy(&page, data.constData() + sizeof(header) + i * sizeof(StoredPage), sizeof(page));
+        PageFingerprint& fingerprint = fingerprints[i];
+        std::copy(page.minHash, page.minHash + MinHashSlots, fingerprint.minHash);
+        fingerprint.imageHash = page.imageHash;
+        fingerprint.hasText = (page.flags & StoredHasText) != 0;
+        fingerprint.hasImage = (page.flags & StoredHasImage) != 0;
+        fingerprint.textLoaded = false;
+    }
+    return true;
+}
 
-        QImage converted1 = img1.convertToFormat(QImage::Format_ARGB32);
-        QImage converted2 = img2.convertToFormat(QImage::Format_ARGB32);
+float pageSimilarity(const PageFingerprint& left, const PageFingerprint& right)
+{
+    float textSimilarity = -1.0f;
+    if (left.hasText && right.hasText) {
+        int equal = 0;
+        for (int slot = 0; slot < MinHashSlots; ++slot) equal += left.minHash[slot] == right.minHash[slot];
+        textSimilarity = float(equal) / MinHashSlots;
+    } else if (left.hasText != right.hasText) {
+        textSimilarity = 0.0f;
+    }
+    float imageSimilarity = -1.0f;
+    if (left.hasImage && right.hasImage) {
+        imageSimilarity = 1.0f - float(PerceptualHash::distance(left.imageHash, right.imageHash)) / 64.0f;
+    }
 
-        const uchar* data1 = converted1.constBits();
-        const uchar* data2 = converted2.constBits();
-        int byteCount = converted1.sizeInBytes();
+    if (textSimilarity >= 0.0f && imageSimilarity >= 0.0f) return 0.7f * textSimilarity + 0.3f * imageSimilarity;
+    if (textSimilarity >= 0.0f && (left.hasText || right.hasText)) return textSimilarity;
+    if (imageSimilarity >= 0.0f) return imageSimilarity;
+    return textSimilarity >= 0.0f ? textSimilarity : 1.0f; // Two blank pages
+}
 
-        int differentBytes = 0;
-        for (int i = 0; i < byteCount; ++i) {
-            if (data1[i] != data2[i]) {
-                differentBytes++;
+// Pairs pages in order so the pairs' similarity adds up to the most, as
+// in a sequence alignment with free gaps. Returns the path through both
+// documents: a pair, or a page of one side with -1 for the other.
+QVector<QPair<int, int>> alignPages(const QVector<PageFingerprint>& left, const QVector<PageFingerprint>& right)
+{
+    const int n = left.size();
+    const int m = right.size();
+    // Rows cover a band around the diagonal from (0, 0) to (n, m)
+    const int band = (qint64(n + 1) * (m + 1) <= MaxAlignCells) ? m + 1
+                   : int(qMax<qint64>(qAbs(n - m) + 1, MaxAlignCells / (qMax(n, m) + 1) / 2));
+    auto firstColumn = [=](int i) { return qMax(0, int(qint64(i) * m / qMax(1, n)) - band); };
+    auto lastColumn = [=](int i) { return qMin(m, int(qint64(i) * m / qMax(1, n)) + band); };
+
+    enum Step : uchar { Diagonal, Up, Left };
+    const float none = -std::numeric_limits<float>::infinity();
+    QVector<float> previous(m + 1, none);
+    QVector<float> current(m + 1, none);
+    QVector<QVector<uchar>> steps(n + 1);
+    for (int i = 0; i <= n; ++i) {
+        const int from = firstColumn(i);
+        const int to = lastColumn(i);
+        steps[i].fill(Left, to - from + 1);
+        std::fill(current.begin(), current.end(), none);
+        for (int j = from; j <= to; ++j) {
+            if (i == 0 || j == 0) {
+                current[j] = 0.0f;
+                steps[i][j - from] = i == 0 ? Left : Up;
+                continue;
+            }
+            float best = previous[j];
+            uchar step = Up;
+            if (j > from && current[j - 1] > best) {
+                best = current[j - 1];
+                step = Left;
+            }
+            const float similarity = pageSimilarity(left[i - 1], right[j - 1]);
+            if (similarity >= MinPageSimilarity && previous[j - 1] != none) {
+                const float paired = previous[j - 1] + similarity - MinPageSimilarity;
+                if (paired >= best) {
+                    best = paired;
+                    step = Diagonal;
+                }
             }
+            current[j] = best;
+            steps[i][j - from] = step;
         }
+        std::swap(previous, current);
+    }
 
-        float similarity = 1.0f - (static_cast<float>(differentBytes) / byteCount);
+    QVector<QPair<int, int>> path;
+    int i = n;
+    int j = m;
+    while (i > 0 || j > 0) {
+        const uchar step = (i == 0) ? uchar(Left) : (j == 0) ? uchar(Up) : steps[i][j - firstColumn(i)];
+        if (step == Diagonal) {
+            path.append(qMakePair(--i, --j));
+        } else if (step == Up) {
+            path.append(qMakePair(--i, -1));
+        } else {
+            path.append(qMakePair(-1, --j));
+        }
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+} // namespace
+
+class ContentComparison::Private {
+public:
+    Private(ContentComparison* q_ptr)
+        : q(q_ptr), similarityThresholdVal(0.8f), granularityVal(ContentComparison::Words) {}
+
+    ContentComparison* q;
+    mutable QMutex mutex; // Protect access if needed during comparison
+    CancellationToken asyncToken; // Shared by the asynchronous comparisons since the last cancel
+    float similarityThresholdVal;
+    ContentComparison::Granularity granularityVal;
+
+    // Share of two strings left unchanged by their shortest character edit
+    float calculateStringSimilarity(const QString& str1, const QString& str2) const {
+        return TextDiff::similarity(str1, str2);
+    }
+
+    // Mean tile SSIM of two images, tolerating small shifts and scale differences
+    float calculateImageSimilarity(const QImage& img1, const QImage& img2) const {
+        const float similarity = ImageDiff::compare(img1, img2).similarity;
         LOG_DEBUG("ContentComparison: Image similarity = " << similarity);
         return similarity;
     }
 
-    // Helper to compare two pieces of text
-    QList<Difference> compareText(const QString& leftText, const QString& rightText, int leftPage, int rightPage) const {
+    // Renders two pages and reports each region where they look different
+    QList<Difference> comparePageImages(Document* leftDoc, int leftPageIndex, Document* rightDoc, int rightPageIndex) const {
         QList<Difference> diffs;
-        if (leftText == rightText) {
-            LOG_DEBUG("ContentComparison: Text on pages " << leftPage << " and " << rightPage << " are identical.");
-            return diffs; // No differences
+        Page* leftPage = leftDoc->page(leftPageIndex);
+        Page* rightPage = rightDoc->page(rightPageIndex);
+        if (!leftPage || !rightPage) {
+            LOG_WARN("ContentComparison: One of the pages to compare is null.");
+            return diffs;
+        }
+
+        auto render = [](Page* page) {
+            const QSizeF size = page->size() * ImageCompareDpi / 72.0;
+            return page->render(qMax(1, qRound(size.width())), qMax(1, qRound(size.height())), ImageCompareDpi);
+        };
+        const QImage leftImage = render(leftPage);
+        const QImage rightImage = render(rightPage);
+        const ImageDiff::Result result = ImageDiff::compare(leftImage, rightImage);
+
+        // Regions are in rendered pixels; bounds are in page points
+        const qreal toPoints = 72.0 / ImageCompareDpi;
+        auto points = [toPoints](const QRect& rect) {
+            return QRectF(rect.x() * toPoints, rect.y() * toPoints, rect.width() * toPoints, rect.height() * toPoints);
+        };
+        for (int i = 0; i < result.leftRegions.size(); ++i) {
+            Difference imgDiff;
+            imgDiff.type = Difference::Image;
+            imgDiff.leftPageIndex = leftPageIndex;
+            imgDiff.rightPageIndex = rightPageIndex;
+            imgDiff.leftBounds = points(result.leftRegions[i]);
+            imgDiff.rightBounds = points(result.rightRegions[i]);
+            imgDiff.description = QString("Image difference on pages %1 and %2, similarity: %3").arg(leftPageIndex + 1).arg(rightPageIndex + 1).arg(result.similarity);
+            imgDiff.similarityScore = result.similarity;
+            diffs.append(imgDiff);
+        }
+        if (!diffs.isEmpty()) {
+            LOG_DEBUG("ContentComparison: Pages " << leftPageIndex << " and " << rightPageIndex << " differ in " << diffs.size() << " regions, offset " << result.offset.x() << "," << result.offset.y());
+        }
+        return diffs;
+    }
+
+    // Records one changed stretch of text unless it only changes spacing
+    // or is similar enough to pass the threshold
+    void addTextDifference(QList<Difference>& diffs, const QString& leftText, const QString& rightText,
+                           int leftPage, int rightPage, float threshold) const {
+        if (leftText.trimmed().isEmpty() && rightText.trimmed().isEmpty()) return;
+        const float simScore = calculateStringSimilarity(leftText, rightText);
+        if (simScore >= threshold) return;
+
+        Difference diff;
+        diff.type = Difference::Text;
+        diff.leftPageIndex = leftPage;
+        diff.rightPageIndex = rightPage;
+        diff.leftText = leftText;
+        diff.rightText = rightText;
+        if (rightText.isEmpty()) {
+            diff.description = QString("Text deleted from page %1: '%2'").arg(leftPage + 1).arg(leftText);
+        } else if (leftText.isEmpty()) {
+            diff.description = QString("Text inserted on page %1: '%2'").arg(rightPage + 1).arg(rightText);
+        } else {
+            diff.description = QString("Text changed on pages %1 and %2: '%3' vs '%4'").arg(leftPage + 1).arg(rightPage + 1).arg(leftText).arg(rightText);
+        }
+        diff.similarityScore = simScore;
+        diffs.append(diff);
+        LOG_DEBUG("ContentComparison: Found text diff: " << diff.description);
+    }
+
+    // Helper to compare two texts line by line, narrowing changed lines
+    // down to words or characters
+    QList<Difference> compareText(const TextLines& left, const TextLines& right) const {
+        float threshold;
+        ContentComparison::Granularity granularity;
+        {
+            QMutexLocker locker(&mutex);
+            threshold = similarityThresholdVal;
+            granularity = granularityVal;
         }
 
-        // Use QTextDocument for a basic comparison (or a diff library for more sophistication)
-        QTextDocument doc1, doc2;
-        doc1.setPlainText(leftText);
-        doc2.setPlainText(rightText);
-
-        // A very simple line-by-line comparison for demonstration
-        QStringList lines1 = leftText.split('\n');
-        QStringList lines2 = rightText.split('\n');
-
-        int maxLines = qMax(lines1.size(), lines2.size());
-        for (int i = 0; i < maxLines; ++i) {
-            QString line1 = (i < lines1.size()) ? lines1[i] : QString();
-            QString line2 = (i < lines2.size()) ? lines2[i] : QString();
-
-            if (line1 != line2) {
-                float simScore = calculateStringSimilarity(line1, line2);
-                if (simScore < similarityThresholdVal) {
-                    Difference diff;
-                    diff.type = Difference::Text;
-                    diff.leftPageIndex = leftPage;
-                    diff.rightPageIndex = rightPage;
-                    diff.leftText = line1;
-                    diff.rightText = line2;
-                    diff.description = QString("Text difference at line %1: '%2' vs '%3'").arg(i).arg(line1).arg(line2);
-                    diff.similarityScore = simScore;
-                    diffs.append(diff);
-                    LOG_DEBUG("ContentComparison: Found text diff: " << diff.description);
+        QList<Difference> diffs;
+        for (const TextDiff::Hunk& hunk : TextDiff::compareStrings(left.lines, right.lines)) {
+            const QString leftText = joinedLines(left.lines, hunk.leftStart, hunk.leftCount);
+            const QString rightText = joinedLines(right.lines, hunk.rightStart, hunk.rightCount);
+            const int leftPage = left.pageAt(hunk.leftStart);
+            const int rightPage = right.pageAt(hunk.rightStart);
+            if (granularity == ContentComparison::Lines || hunk.leftCount == 0 || hunk.rightCount == 0
+                || calculateStringSimilarity(leftText, rightText) < MinRefinedSimilarity) {
+                addTextDifference(diffs, leftText, rightText, leftPage, rightPage, threshold);
+                continue;
+            }
+
+            // The words of the changed lines, and the line each word is on
+            const QStringList leftWords = TextDiff::splitWords(leftText);
+            const QStringList rightWords = TextDiff::splitWords(rightText);
+            auto wordLines = [](const QStringList& words, int firstLine) {
+                QVector<int> lines;
+                lines.reserve(words.size() + 1);
+                int line = firstLine;
+                for (const QString& word : words) {
+                    lines.append(line);
+                    line += word.count(QLatin1Char('\n'));
+                }
+                lines.append(line);
+                return lines;
+            };
+            const QVector<int> leftLineOf = wordLines(leftWords, hunk.leftStart);
+            const QVector<int> rightLineOf = wordLines(rightWords, hunk.rightStart);
+
+            for (const TextDiff::Hunk& wordHunk : TextDiff::compareStrings(leftWords, rightWords)) {
+                const QString leftPart = joinedParts(leftWords, wordHunk.leftStart, wordHunk.leftCount);
+                const QString rightPart = joinedParts(rightWords, wordHunk.rightStart, wordHunk.rightCount);
+                const int wordLeftPage = left.pageAt(leftLineOf[wordHunk.leftStart]);
+                const int wordRightPage = right.pageAt(rightLineOf[wordHunk.rightStart]);
+                if (granularity == ContentComparison::Words || leftPart.isEmpty() || rightPart.isEmpty()) {
+                    addTextDifference(diffs, leftPart, rightPart, wordLeftPage, wordRightPage, threshold);
+                    continue;
+                }
+                for (const TextDiff::Hunk& charHunk : TextDiff::compareCharacters(leftPart, rightPart)) {
+                    addTextDifference(diffs, leftPart.mid(charHunk.leftStart, charHunk.leftCount),
+                                      rightPart.mid(charHunk.rightStart, charHunk.rightCount),
+                                      wordLeftPage, wordRightPage, threshold);
                 }
             }
         }
@@ -141,23 +456,11 @@ public:
         }
 
         // Compare text content
-        QString leftText = leftPage->text();
-        QString rightText = rightPage->text();
-        allDiffs.append(compareText(leftText, rightText, leftPageIndex, rightPageIndex));
-
-        // Compare rendered images (if needed)
-        // QImage leftImage = leftPage->render(width, height, dpi); // Need consistent render settings
-        // QImage rightImage = rightPage->render(width, height, dpi);
-        // float imageSim = calculateImageSimilarity(leftImage, rightImage);
-        // if (imageSim < similarityThresholdVal) {
-        //     Difference imgDiff;
-        //     imgDiff.type = Difference::Image;
-        //     imgDiff.leftPageIndex = leftPageIndex;
-        //     imgDiff.rightPageIndex = rightPageIndex;
-        //     imgDiff.description = QString("Image difference on pages %1 and %2, similarity: %3").arg(leftPageIndex).arg(rightPageIndex).arg(imageSim);
-        //     imgDiff.similarityScore = imageSim;
-        //     allDiffs.append(imgDiff);
-        // }
+        TextLines leftLines;
+        TextLines rightLines;
+        leftLines.append(leftPage->text(), leftPageIndex);
+        rightLines.append(rightPage->text(), rightPageIndex);
+        allDiffs.append(compareText(leftLines, rightLines));
 
         // Compare other properties like size, rotation, annotations (if applicable and accessible via Page interface)
         // QSizeF leftSize = leftPage->size();
@@ -216,30 +519,128 @@ QList<Difference> ContentComparison::compareDocuments(Document* leftDoc, Documen
 
     QList<Difference> allDifferences;
 
-    if (compareText || compareImages) { // Compare page by page
+    if (compareText || compareImages) {
         int pageCount1 = leftDoc->pageCount();
         int pageCount2 = rightDoc->pageCount();
-        int maxPages = qMax(pageCount1, pageCount2);
-
-        for (int i = 0; i < maxPages; ++i) {
-            bool pageExists1 = (i < pageCount1);
-            bool pageExists2 = (i < pageCount2);
-
-            if (!pageExists1 || !pageExists2) {
-                Difference pageCountDiff;
-                pageCountDiff.type = Difference::Structure;
-                pageCountDiff.leftPageIndex = pageExists1 ? i : -1;
-                pageCountDiff.rightPageIndex = pageExists2 ? i : -1;
-                pageCountDiff.description = QString("Page count mismatch: Document 1 has %1 pages, Document 2 has %2 pages.").arg(pageCount1).arg(pageCount2);
-                pageCountDiff.similarityScore = 0.0f;
-                allDifferences.append(pageCountDiff);
-                continue;
+
+        if (pageCount1 != pageCount2) {
+            Difference pageCountDiff;
+            pageCountDiff.type = Difference::Structure;
+            pageCountDiff.leftPageIndex = -1;
+            pageCountDiff.rightPageIndex = -1;
+            pageCountDiff.description = QString("Page count mismatch: Document 1 has %1 pages, Document 2 has %2 pages.").arg(pageCount1).arg(pageCount2);
+            pageCountDiff.similarityScore = 0.0f;
+            allDifferences.append(pageCountDiff);
+        }
+
+        // Fingerprints of unchanged files come from the store, shared with
+        // DuplicateDetector; files it found byte-identical need no pages compared
+        MetadataDatabase& store = MetadataDatabase::instance();
+        const DocumentFingerprint leftStored = store.retrieveFingerprint(leftDoc->filePath());
+        const DocumentFingerprint rightStored = store.retrieveFingerprint(rightDoc->filePath());
+        if (!leftStored.contentHash.isEmpty() && leftStored.contentHash == rightStored.contentHash
+            && leftStored.fileSize == rightStored.fileSize) {
+            LOG_DEBUG("ContentComparison: Files have identical content; skipping page comparison.");
+            pageCount1 = pageCount2 = 0;
+        }
+
+        // Fingerprint every page of both documents in parallel; pages
+        // without text get a rendered fingerprint even for text comparison
+        QVector<PageFingerprint> leftPrints(pageCount1);
+        QVector<PageFingerprint> rightPrints(pageCount2);
+        const bool leftRestored = pageCount1 > 0 && decodePages(leftStored.pageShingles, leftPrints);
+        const bool rightRestored = pageCount2 > 0 && decodePages(rightStored.pageShingles, rightPrints);
+        std::atomic<bool> leftChanged{!leftRestored};
+        std::atomic<bool> rightChanged{!rightRestored};
+        const int totalPages = pageCount1 + pageCount2;
+        std::atomic<int> fingerprinted{0};
+        const CancellationToken canceled = CancellationToken::current();
+        ThreadPool::instance().forEach(totalPages, [&](int index) {
+            const bool isLeft = index < pageCount1;
+            const int pageIndex = isLeft ? index : index - pageCount1;
+            Page* page = isLeft ? leftDoc->page(pageIndex) : rightDoc->page(pageIndex);
+            PageFingerprint& fingerprint = isLeft ? leftPrints[pageIndex] : rightPrints[pageIndex];
+            if (page) {
+                if (!(isLeft ? leftRestored : rightRestored)) fingerprintText(fingerprint, page->text());
+                if ((compareImages || !fingerprint.hasText) && !fingerprint.hasImage) {
+                    fingerprintImage(fingerprint, page);
+                    (isLeft ? leftChanged : rightChanged) = true;
+                }
+            }
+            const int count = ++fingerprinted;
+            if (count * 40 / totalPages != (count - 1) * 40 / totalPages) emit d->q->comparisonProgress(count * 40 / totalPages);
+        });
+        auto storePages = [&store](const DocumentFingerprint& stored, const QVector<PageFingerprint>& prints, bool changed) {
+            if (!changed || prints.isEmpty() || stored.filePath.isEmpty()) return;
+            DocumentFingerprint update;
+            update.filePath = stored.filePath;
+            update.fileSize = stored.fileSize;
+            update.modified = stored.modified;
+            update.pageShingles = encodePages(prints);
+            store.storeFingerprint(update);
+        };
+        if (canceled.isCanceled()) {
+            // Some fingerprints are missing; none is stored
+            emit comparisonFailed("Comparison was canceled.");
+            LOG_DEBUG("ContentComparison: Canceled while fingerprinting pages.");
+            return {};
+        }
+        storePages(leftStored, leftPrints, leftChanged);
+        storePages(rightStored, rightPrints, rightChanged);
+
+        const QVector<QPair<int, int>> path = alignPages(leftPrints, rightPrints);
+        QVector<int> pairs; // Steps of path that pair two pages
+        for (int step = 0; step < path.size(); ++step) {
+            if (path[step].first >= 0 && path[step].second >= 0) pairs.append(step);
+        }
+        LOG_DEBUG("ContentComparison: Paired " << pairs.size() << " of " << pageCount1 << " and " << pageCount2 << " pages.");
+
+        // Diff the pairs in parallel, passing on each pair's differences as they are found
+        QVector<QList<Difference>> pairDiffs(pairs.size());
+        std::atomic<int> compared{0};
+        ThreadPool::instance().forEach(pairs.size(), [&](int index) {
+            const int leftIndex = path[pairs[index]].first;
+            const int rightIndex = path[pairs[index]].second;
+            QList<Difference>& diffs = pairDiffs[index];
+            if (compareText) {
+                TextLines leftLines;
+                TextLines rightLines;
+                leftLines.append(pageText(leftPrints[leftIndex], leftDoc, leftIndex), leftIndex);
+                rightLines.append(pageText(rightPrints[rightIndex], rightDoc, rightIndex), rightIndex);
+                diffs.append(d->compareText(leftLines, rightLines));
             }
+            if (compareImages) diffs.append(d->comparePageImages(leftDoc, leftIndex, rightDoc, rightIndex));
+            if (!diffs.isEmpty()) emit d->q->differencesFound(diffs);
+            const int count = ++compared;
+            emit d->q->comparisonProgress(40 + count * 60 / qMax(1, int(pairs.size())));
+        });
+        if (canceled.isCanceled()) {
+            emit comparisonFailed("Comparison was canceled.");
+            LOG_DEBUG("ContentComparison: Canceled while comparing page pairs.");
+            return {};
+        }
 
-            // Compare the specific page
-            QList<Difference> pageDiffs = d->comparePagesInternal(leftDoc, i, rightDoc, i);
-            allDifferences.append(pageDiffs);
+        int pair = 0;
+        for (const QPair<int, int>& step : path) {
+            if (step.first >= 0 && step.second >= 0) {
+                allDifferences.append(pairDiffs[pair++]);
+                continue;
+            }
+            Difference pageDiff;
+            pageDiff.type = Difference::Structure;
+            pageDiff.leftPageIndex = step.first;
+            pageDiff.rightPageIndex = step.second;
+            if (step.first >= 0) {
+                pageDiff.leftText = pageText(leftPrints[step.first], leftDoc, step.first);
+                pageDiff.description = QString("Page %1 of document 1 has no counterpart in document 2.").arg(step.first + 1);
+            } else {
+                pageDiff.rightText = pageText(rightPrints[step.second], rightDoc, step.second);
+                pageDiff.description = QString("Page %1 of document 2 has no counterpart in document 1.").arg(step.second + 1);
+            }
+            pageDiff.similarityScore = 0.0f;
+            allDifferences.append(pageDiff);
         }
+        emit d->q->comparisonProgress(100);
     }
 
     // Compare metadata if requested
@@ -279,11 +680,26 @@ QFuture<QList<Difference>> ContentComparison::compareDocumentsAsync(Document* le
                                                                    bool compareMetadata,
                                                                    bool compareStructure) const
 {
-    return QtConcurrent::run([this, leftDoc, rightDoc, compareText, compareImages, compareFormatting, compareMetadata, compareStructure]() {
+    CancellationToken token;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (!d->asyncToken.isCancelable()) d->asyncToken = CancellationToken::create();
+        token = d->asyncToken;
+    }
+    return QtConcurrent::run([this, leftDoc, rightDoc, compareText, compareImages, compareFormatting, compareMetadata, compareStructure, token]() {
+        // The page loops and the renders under them see the token as current
+        CancellationScope scope(token);
         return this->compareDocuments(leftDoc, rightDoc, compareText, compareImages, compareFormatting, compareMetadata, compareStructure);
     });
 }
 
+void ContentComparison::cancelComparisons() const
+{
+    QMutexLocker locker(&d->mutex);
+    d->asyncToken.cancel();
+    d->asyncToken = CancellationToken(); // Later comparisons get a fresh one
+}
+
 QList<Difference> ContentComparison::comparePages(Document* leftDoc, int leftPageIndex,
                                                   Document* rightDoc, int rightPageIndex,
                                                   const QRectF& regionLeft,
@@ -338,6 +754,21 @@ void ContentComparison::setSimilarityThreshold(float threshold)
     }
 }
 
+ContentComparison::Granularity ContentComparison::granularity() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->granularityVal;
+}
+
+void ContentComparison::setGranularity(Granularity granularity)
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->granularityVal != granularity) {
+        d->granularityVal = granularity;
+        LOG_INFO("ContentComparison: Granularity set to " << int(granularity));
+    }
+}
+
 QStringList ContentComparison::supportedReportFormats() const
 {
     return QStringList() << "html" << "json"; // Add more as implemented
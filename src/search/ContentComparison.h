@@ -44,12 +44,38 @@ struct Difference {
  * 
  * Provides methods to analyze differences in text, images, formatting, structure, etc.
  * Can compare entire documents or specific regions/pages.
+ *
+ * Documents are compared page by page once their pages are paired up:
+ * each page gets a fingerprint, a MinHash of its word shingles plus, for
+ * pages without text or when images are compared, a 64-bit difference
+ * hash of a thumbnail, and pages are aligned in order by fingerprint
+ * similarity. An inserted or removed page is then reported as such rather
+ * than shifting every page after it. Fingerprints and paired pages are
+ * both worked on in parallel on the ThreadPool. Page fingerprints are
+ * kept in MetadataDatabase's fingerprint store, so comparing a file again
+ * only extracts the text of the pages it diffs, and two files already
+ * hashed identical there are not compared page by page at all.
+ *
+ * The text of a pair is compared with TextDiff line by line, so an
+ * inserted line shifts what follows instead of making it all differ.
+ * Changed lines are then narrowed down to the words or characters that
+ * changed, as set by setGranularity(), unless they have too little in
+ * common for that to help.
  */
 class ContentComparison : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief How finely changed text is reported.
+     */
+    enum Granularity {
+        Lines,      // One difference per run of changed lines
+        Words,      // One difference per run of changed words
+        Characters  // One difference per run of changed characters
+    };
+
     /**
      * @brief Constructor.
      * @param parent Parent object.
@@ -76,7 +102,8 @@ public:
      * @param compareFormatting Whether to compare formatting (if applicable).
      * @param compareMetadata Whether to compare metadata (title, author, etc.).
      * @param compareStructure Whether to compare document structure (TOC, page count, etc.).
-     * @return List of differences found.
+     * @return List of differences found, in page order; empty if the calling
+     *         thread's CancellationToken was canceled meanwhile.
      */
     QList<Difference> compareDocuments(Document* leftDoc, Document* rightDoc,
                                       bool compareText = true,
@@ -87,6 +114,8 @@ public:
 
     /**
      * @brief Compare two documents asynchronously.
+     * The differences of each page pair are passed on by differencesFound()
+     * as soon as the pair is done; the future holds them all, in page order.
      * @param leftDoc The first document to compare.
      * @param rightDoc The second document to compare.
      * @param compareText Whether to compare text content.
@@ -103,6 +132,13 @@ public:
                                                      bool compareMetadata = false,
                                                      bool compareStructure = false) const;
 
+    /**
+     * @brief Stop the asynchronous comparisons in progress.
+     * Each stops at its next page or page pair, emits comparisonFailed() and
+     * leaves an empty list in its future.
+     */
+    void cancelComparisons() const;
+
     /**
      * @brief Compare two specific pages from different documents.
      * @param leftPage The first page to compare.
@@ -150,6 +186,18 @@ public:
      */
     void setSimilarityThreshold(float threshold);
 
+    /**
+     * @brief Get how finely changed text is reported.
+     * @return Granularity (Words by default).
+     */
+    Granularity granularity() const;
+
+    /**
+     * @brief Set how finely changed text is reported.
+     * @param granularity Lines, words or characters.
+     */
+    void setGranularity(Granularity granularity);
+
     /**
      * @brief Get the list of supported output formats for reports.
      * @return List of format strings (e.g., "html", "png", "json").
@@ -168,6 +216,13 @@ signals:
      */
     void comparisonFinished(const QList<QuantilyxDoc::Difference>& differences);
 
+    /**
+     * @brief Emitted from a worker thread whenever a page pair has been compared.
+     * Pairs finish in no particular order.
+     * @param differences The pair's differences.
+     */
+    void differencesFound(const QList<QuantilyxDoc::Difference>& differences);
+
     /**
      * @brief Emitted when a comparison task fails.
      * @param error Error message.
@@ -183,6 +238,7 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static ContentComparison* s_instance;
 };
 
 } // namespace QuantilyxDoc
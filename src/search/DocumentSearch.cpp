@@ -0,0 +1,272 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "DocumentSearch.h"
+#include "../core/Arena.h"
+#include "../core/Document.h"
+#include "../core/Page.h"
+#include "../core/ThreadPool.h"
+#include "../core/Logger.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QVector>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Pages between two progressChanged() signals
+const int ProgressInterval = 32;
+
+// One search over one document, shared by every thread scanning it
+struct Scan {
+    const Document* document = nullptr;
+    QString text;
+    bool caseSensitive = false;
+    bool wholeWords = false;
+    QVector<int> order; // Page indices in the order they are handed out
+
+    std::atomic<int> next{0};     // Next slot in order to claim
+    std::atomic<int> done{0};     // Claimed slots that are finished
+    std::atomic<int> matching{0}; // Pages with hits
+    std::atomic<bool> canceled{false};
+    int claimed = -1;             // Set by close()
+
+    QMutex mutex;
+    QWaitCondition pageDone;
+
+    // Called on the scanning thread
+    std::function<void(int, const QList<QRectF>&)> onMatch;
+    std::function<void(int)> onProgress;
+    std::function<void(int)> onFinished;
+
+    // Claim and scan pages until none are left. The hits of each page
+    // go to this thread's arena, taken back before the next page.
+    void run() {
+        Arena arena;
+        for (;;) {
+            const int slot = next++;
+            if (slot >= order.size()) return;
+            if (!canceled) scanPage(order.at(slot), &arena);
+            arena.reset();
+            finishPage();
+        }
+    }
+
+    void scanPage(int index, Arena* arena) {
+        Page* page = document->page(index);
+        if (!page) return;
+        ArenaVector<QRectF> hits{ArenaAllocator<QRectF>(arena)};
+        page->findText(text, caseSensitive, wholeWords, hits);
+        if (hits.empty()) return;
+        ++matching;
+        if (!onMatch) return;
+        // Only pages with hits pay for the list handed out with the signal
+        QList<QRectF> rects;
+        rects.reserve(int(hits.size()));
+        for (const QRectF& hit : hits) rects.append(hit);
+        onMatch(index, rects);
+    }
+
+    void finishPage() {
+        const int count = ++done;
+        if (!canceled) {
+            if (count == order.size()) {
+                if (onFinished) onFinished(matching.load());
+            } else if (count % ProgressInterval == 0 && onProgress) {
+                onProgress(count);
+            }
+        }
+        QMutexLocker locker(&mutex);
+        pageDone.wakeAll();
+    }
+
+    // Stop handing out pages; returns how many were claimed before
+    int close() {
+        claimed = qMin(next.exchange(order.size()), order.size());
+        return claimed;
+    }
+
+    bool isIdle() const {
+        return done.load() >= claimed;
+    }
+
+    // Wait until the claimed pages are finished, after close()
+    void wait() {
+        QMutexLocker locker(&mutex);
+        while (done.load() < claimed) {
+            pageDone.wait(&mutex);
+        }
+    }
+
+    // Start page first, then alternating after and before it
+    static QVector<int> nearestFirst(int pageCount, int startPage) {
+        QVector<int> order;
+        order.reserve(pageCount);
+        startPage = qBound(0, startPage, pageCount - 1);
+        order.append(startPage);
+        for (int distance = 1; order.size() < pageCount; ++distance) {
+            if (startPage + distance < pageCount) order.append(startPage + distance);
+            if (startPage - distance >= 0) order.append(startPage - distance);
+        }
+        return order;
+    }
+
+    // Spread the scan over the CPU pool; helpers that start late find
+    // nothing left to claim and return at once
+    static void fanOut(const std::shared_ptr<Scan>& scan, int helpers) {
+        for (int i = 0; i < helpers; ++i) {
+            ThreadPool::instance().submitDetached([scan]() { scan->run(); }, Task::Priority::High);
+        }
+    }
+};
+
+} // namespace
+
+class DocumentSearch::Private {
+public:
+    Private() : generation(0) {}
+
+    std::shared_ptr<Scan> current;
+    QList<std::shared_ptr<Scan>> retired; // Canceled scans with pages still in flight
+    quint64 generation; // Bumped per search; stale queued signals are dropped
+    QPointer<Document> document;
+    QMetaObject::Connection closedConnection;
+
+    void prune() {
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [](const std::shared_ptr<Scan>& scan) { return scan->isIdle(); }),
+                      retired.end());
+    }
+
+    void waitForRetired() {
+        for (const std::shared_ptr<Scan>& scan : retired) {
+            scan->wait();
+        }
+        retired.clear();
+    }
+};
+
+DocumentSearch::DocumentSearch(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+}
+
+DocumentSearch::~DocumentSearch()
+{
+    cancel();
+    d->waitForRetired(); // Scans post to this object and read the document
+}
+
+void DocumentSearch::start(Document* document, const QString& text, int startPage,
+                           bool caseSensitive, bool wholeWords)
+{
+    cancel();
+
+    const int pageCount = document ? document->pageCount() : 0;
+    if (text.isEmpty() || pageCount <= 0) {
+        emit finished(0);
+        return;
+    }
+
+    std::shared_ptr<Scan> scan = std::make_shared<Scan>();
+    scan->document = document;
+    scan->text = text;
+    scan->caseSensitive = caseSensitive;
+    scan->wholeWords = wholeWords;
+    scan->order = Scan::nearestFirst(pageCount, startPage);
+
+    const quint64 generation = ++d->generation;
+    scan->onMatch = [this, generation](int pageIndex, const QList<QRectF>& rects) {
+        QMetaObject::invokeMethod(this, [this, generation, pageIndex, rects]() {
+            if (generation == d->generation) emit matchesFound(pageIndex, rects);
+        }, Qt::QueuedConnection);
+    };
+    scan->onProgress = [this, generation, pageCount](int scanned) {
+        QMetaObject::invokeMethod(this, [this, generation, scanned, pageCount]() {
+            if (generation == d->generation) emit progressChanged(scanned, pageCount);
+        }, Qt::QueuedConnection);
+    };
+    scan->onFinished = [this, generation, pageCount](int matching) {
+        QMetaObject::invokeMethod(this, [this, generation, matching, pageCount]() {
+            if (generation != d->generation) return;
+            d->current.reset();
+            QObject::disconnect(d->closedConnection);
+            emit progressChanged(pageCount, pageCount);
+            emit finished(matching);
+        }, Qt::QueuedConnection);
+    };
+
+    // Pages must not be scanned once their document starts closing
+    d->document = document;
+    d->closedConnection = connect(document, &Document::closed, this, [this]() {
+        cancel();
+        d->waitForRetired();
+    });
+
+    d->current = scan;
+    Scan::fanOut(scan, ThreadPool::instance().maxThreadCount());
+    LOG_DEBUG("DocumentSearch: Searching " << pageCount << " pages for '" << text << "' from page " << startPage);
+}
+
+void DocumentSearch::cancel()
+{
+    if (d->current) {
+        d->current->canceled = true;
+        d->current->close();
+        d->retired.append(d->current);
+        d->current.reset();
+        ++d->generation;
+        QObject::disconnect(d->closedConnection);
+    }
+    d->prune();
+}
+
+bool DocumentSearch::isRunning() const
+{
+    return d->current != nullptr;
+}
+
+QList<int> DocumentSearch::findPages(const Document* document, const QString& text,
+                                      bool caseSensitive, bool wholeWords)
+{
+    QList<int> pages;
+    const int pageCount = document ? document->pageCount() : 0;
+    if (text.isEmpty() || pageCount <= 0) return pages;
+
+    std::shared_ptr<Scan> scan = std::make_shared<Scan>();
+    scan->document = document;
+    scan->text = text;
+    scan->caseSensitive = caseSensitive;
+    scan->wholeWords = wholeWords;
+    scan->order = Scan::nearestFirst(pageCount, 0);
+
+    // No match is reported after wait() returns, so the locals may be captured
+    QMutex pagesMutex;
+    scan->onMatch = [&pages, &pagesMutex](int pageIndex, const QList<QRectF>&) {
+        QMutexLocker locker(&pagesMutex);
+        pages.append(pageIndex);
+    };
+
+    Scan::fanOut(scan, ThreadPool::instance().maxThreadCount() - 1);
+    scan->run(); // Returns once every page is claimed
+    scan->close();
+    scan->wait();
+
+    std::sort(pages.begin(), pages.end());
+    return pages;
+}
+
+} // namespace QuantilyxDoc
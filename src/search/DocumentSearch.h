@@ -0,0 +1,111 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_DOCUMENTSEARCH_H
+#define QUANTILYX_DOCUMENTSEARCH_H
+
+#include <QObject>
+#include <QList>
+#include <QRectF>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Searches every page of a document in parallel and streams the hits.
+ *
+ * Page scans are spread over the CPU ThreadPool. Pages are handed out
+ * nearest to the start page first, so hits around the reader's position
+ * arrive first. They arrive through matchesFound() on the owner's thread.
+ * Starting a new search or calling cancel() drops the old one without
+ * waiting for it.
+ */
+class DocumentSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit DocumentSearch(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor. Waits for pages still being scanned.
+     */
+    ~DocumentSearch() override;
+
+    /**
+     * @brief Start searching, replacing any search in progress.
+     * @param document Document to search.
+     * @param text Text to find.
+     * @param startPage Page to fan out from, usually the current page.
+     * @param caseSensitive Case sensitive search.
+     * @param wholeWords Whole words only.
+     */
+    void start(Document* document, const QString& text, int startPage = 0,
+               bool caseSensitive = false, bool wholeWords = false);
+
+    /**
+     * @brief Stop the current search. No signals arrive for it afterwards.
+     */
+    void cancel();
+
+    /**
+     * @brief Check if a search is in progress.
+     * @return True while pages remain to be scanned.
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Search a document in parallel and wait for the result.
+     * The calling thread scans pages too, so this is safe to call from a
+     * ThreadPool worker.
+     * @param document Document to search.
+     * @param text Text to find.
+     * @param caseSensitive Case sensitive search.
+     * @param wholeWords Whole words only.
+     * @return Sorted indices of the pages containing the text.
+     */
+    static QList<int> findPages(const Document* document, const QString& text,
+                                bool caseSensitive = false, bool wholeWords = false);
+
+signals:
+    /**
+     * @brief Emitted for each page with at least one hit.
+     * @param pageIndex Page index.
+     * @param rects Hit rectangles in page coordinates.
+     */
+    void matchesFound(int pageIndex, const QList<QRectF>& rects);
+
+    /**
+     * @brief Emitted now and then while pages are scanned.
+     * @param scannedPages Pages scanned so far.
+     * @param totalPages Pages in the document.
+     */
+    void progressChanged(int scannedPages, int totalPages);
+
+    /**
+     * @brief Emitted once every page of a search has been scanned.
+     * @param matchingPages Number of pages with hits.
+     */
+    void finished(int matchingPages);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_DOCUMENTSEARCH_H
@@ -0,0 +1,284 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "FederatedSearch.h"
+#include "../core/Application.h"
+#include "../core/CancellationToken.h"
+#include "../core/Document.h"
+#include "../core/Page.h"
+#include "../core/Settings.h"
+#include "../core/ThreadPool.h"
+#include "../core/Logger.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// One search, shared by the index query and the tasks reading live documents
+struct Run {
+    QString query;
+    int maxResults = 50;
+    int contextLength = 100;
+    QVector<Document*> documents; // Read live
+    QSet<QString> liveFiles;      // Their paths; the index's copies are stale
+
+    CancellationToken token = CancellationToken::create(CancellationToken());
+    std::atomic<int> next{0};      // Next live document to claim
+    std::atomic<int> remaining{0}; // Live documents left, plus the index query
+
+    QMutex mutex;
+    QWaitCondition idle;
+    int active = 0; // Tasks submitted and not yet returned
+
+    // Called on the worker threads
+    std::function<void(const QList<SearchResult>&)> onResults;
+    std::function<void()> onFinished;
+
+    // Counted on the submitting thread, so wait() cannot miss a task that has not started
+    static void submit(const std::shared_ptr<Run>& run, ThreadPool& pool, void (Run::*job)(), Task::Priority priority) {
+        {
+            QMutexLocker locker(&run->mutex);
+            ++run->active;
+        }
+        pool.submitDetached([run, job]() {
+            ((*run).*job)();
+            QMutexLocker locker(&run->mutex);
+            --run->active;
+            run->idle.wakeAll();
+        }, priority);
+    }
+
+    void queryIndex() {
+        if (token.isCanceled()) {
+            finishPart();
+            return;
+        }
+        QList<SearchResult> results = FullTextIndex::instance().query(query, maxResults, contextLength);
+        results.erase(std::remove_if(results.begin(), results.end(),
+                                     [this](const SearchResult& result) { return liveFiles.contains(result.filePath); }),
+                      results.end());
+        if (!token.isCanceled() && !results.isEmpty() && onResults) onResults(results);
+        finishPart();
+    }
+
+    // Claim and read live documents until none are left
+    void readLive() {
+        CancellationScope scope(token);
+        for (;;) {
+            const int slot = next++;
+            if (slot >= documents.size()) return;
+            SearchResult result;
+            if (!token.isCanceled() && readDocument(documents.at(slot), &result) && onResults) {
+                onResults({result});
+            }
+            finishPart();
+        }
+    }
+
+    bool readDocument(Document* document, SearchResult* result) const {
+        QStringList pageTexts;
+        const int pageCount = document->pageCount();
+        pageTexts.reserve(pageCount);
+        for (int i = 0; i < pageCount; ++i) {
+            if (token.isCanceled()) return false;
+            Page* page = document->page(i);
+            pageTexts.append(page ? page->text() : QString());
+        }
+
+        int firstPage = -1;
+        int firstOffset = 0;
+        const double score = FullTextIndex::instance().scoreText(query, pageTexts, &firstPage, &firstOffset);
+        if (score <= 0.0 || firstPage < 0) return false;
+
+        // The word the first hit is in, and the text around it as query() cuts it
+        const QString& text = pageTexts.at(firstPage);
+        int end = firstOffset;
+        while (end < text.size() && text.at(end).isLetterOrNumber()) ++end;
+        result->document = document;
+        result->filePath = document->filePath();
+        result->pageIndex = firstPage;
+        result->text = text.mid(firstOffset, end - firstOffset);
+        result->score = float(score);
+        const int start = qMax(0, firstOffset - contextLength / 2);
+        const int stop = qMin(text.size(), end + contextLength / 2);
+        result->context = text.mid(start, stop - start);
+        return true;
+    }
+
+    void finishPart() {
+        if (--remaining == 0 && !token.isCanceled() && onFinished) onFinished();
+    }
+
+    bool isIdle() {
+        QMutexLocker locker(&mutex);
+        return active == 0;
+    }
+
+    void wait() {
+        QMutexLocker locker(&mutex);
+        while (active > 0) {
+            idle.wait(&mutex);
+        }
+    }
+};
+
+} // namespace
+
+class FederatedSearch::Private {
+public:
+    Private() : generation(0), maxResults(0) {}
+
+    std::shared_ptr<Run> current;
+    QList<std::shared_ptr<Run>> retired; // Canceled runs with tasks still in flight
+    quint64 generation; // Bumped per search; stale queued signals are dropped
+    QList<SearchResult> results; // Best first
+    int maxResults;
+    QList<QMetaObject::Connection> closedConnections;
+
+    void disconnectDocuments() {
+        for (const QMetaObject::Connection& connection : closedConnections) QObject::disconnect(connection);
+        closedConnections.clear();
+    }
+
+    void prune() {
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [](const std::shared_ptr<Run>& run) { return run->isIdle(); }),
+                      retired.end());
+    }
+
+    void waitForRetired() {
+        for (const std::shared_ptr<Run>& run : retired) {
+            run->wait();
+        }
+        retired.clear();
+    }
+
+    static int workerLimit() {
+        const int threads = ThreadPool::instance().maxThreadCount();
+        return qBound(1, Settings::instance().value<int>("Advanced/FederatedSearchWorkers", threads / 2), qMax(1, threads));
+    }
+};
+
+FederatedSearch::FederatedSearch(QObject* parent)
+    : QObject(parent)
+    , d(new Private())
+{
+    qRegisterMetaType<SearchResult>("QuantilyxDoc::SearchResult");
+}
+
+FederatedSearch::~FederatedSearch()
+{
+    cancel();
+    d->waitForRetired(); // Runs post to this object and read the documents
+}
+
+void FederatedSearch::start(const QString& query, int maxResults, int contextLength)
+{
+    cancel();
+    d->results.clear();
+    d->maxResults = qMax(0, maxResults);
+    if (query.trimmed().isEmpty() || d->maxResults == 0) {
+        emit finished(0);
+        return;
+    }
+
+    std::shared_ptr<Run> run = std::make_shared<Run>();
+    run->query = query;
+    run->maxResults = d->maxResults;
+    run->contextLength = contextLength;
+
+    // What the index holds as saved is answered from it; the rest is read
+    FullTextIndex& index = FullTextIndex::instance();
+    const bool indexReady = index.isReady();
+    for (Document* document : Application::instance()->openDocuments()) {
+        const QString filePath = document->filePath();
+        if (indexReady && !document->isModified() && !filePath.isEmpty() && index.isIndexed(filePath)) continue;
+        run->documents.append(document);
+        if (!filePath.isEmpty()) run->liveFiles.insert(filePath);
+    }
+    run->remaining = run->documents.size() + (indexReady ? 1 : 0);
+    if (run->remaining == 0) {
+        emit finished(0);
+        return;
+    }
+
+    const quint64 generation = ++d->generation;
+    run->onResults = [this, generation](const QList<SearchResult>& results) {
+        QMetaObject::invokeMethod(this, [this, generation, results]() {
+            if (generation != d->generation) return;
+            for (const SearchResult& result : results) {
+                const auto at = std::upper_bound(d->results.begin(), d->results.end(), result.score,
+                                                 [](float score, const SearchResult& kept) { return score > kept.score; });
+                const int rank = int(at - d->results.begin());
+                if (rank >= d->maxResults) continue;
+                d->results.insert(rank, result);
+                if (d->results.size() > d->maxResults) d->results.removeLast();
+                emit resultFound(result, rank);
+            }
+        }, Qt::QueuedConnection);
+    };
+    run->onFinished = [this, generation]() {
+        QMetaObject::invokeMethod(this, [this, generation]() {
+            if (generation != d->generation) return;
+            d->current.reset();
+            d->disconnectDocuments();
+            emit finished(d->results.size());
+        }, Qt::QueuedConnection);
+    };
+
+    // Pages must not be read once their document starts closing
+    for (Document* document : run->documents) {
+        d->closedConnections.append(connect(document, &Document::closed, this, [this]() {
+            cancel();
+            d->waitForRetired();
+        }));
+    }
+
+    d->current = run;
+    if (indexReady) Run::submit(run, ThreadPool::ioInstance(), &Run::queryIndex, Task::Priority::Normal);
+    const int workers = qMin(Private::workerLimit(), run->documents.size());
+    for (int i = 0; i < workers; ++i) {
+        Run::submit(run, ThreadPool::instance(), &Run::readLive, Task::Priority::Low);
+    }
+    LOG_DEBUG("FederatedSearch: Searching for '" << query << "' in the index and " << run->documents.size()
+              << " open documents on " << workers << " workers");
+}
+
+void FederatedSearch::cancel()
+{
+    if (d->current) {
+        d->current->token.cancel();
+        d->retired.append(d->current);
+        d->current.reset();
+        ++d->generation;
+        d->disconnectDocuments();
+    }
+    d->prune();
+}
+
+bool FederatedSearch::isRunning() const
+{
+    return d->current != nullptr;
+}
+
+QList<SearchResult> FederatedSearch::results() const
+{
+    return d->results;
+}
+
+} // namespace QuantilyxDoc
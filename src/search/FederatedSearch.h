@@ -0,0 +1,98 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_FEDERATEDSEARCH_H
+#define QUANTILYX_FEDERATEDSEARCH_H
+
+#include "FullTextIndex.h"
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Searches the library and every open document at once.
+ *
+ * Closed documents, and open ones saved as indexed, are answered by
+ * FullTextIndex. Open documents that are modified, unsaved or not indexed
+ * are read live: their pages' text is scored with
+ * FullTextIndex::scoreText(), so both kinds rank on one scale. Live
+ * documents are handed out one at a time to at most
+ * Advanced/FederatedSearchWorkers low priority tasks on the CPU
+ * ThreadPool (half its threads by default), which leaves the others to
+ * render the active view. Results are merged by score as they come and
+ * arrive through resultFound() on the owner's thread. Starting a new
+ * search or calling cancel() drops the old one without waiting for it.
+ */
+class FederatedSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit FederatedSearch(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor. Waits for documents still being read.
+     */
+    ~FederatedSearch() override;
+
+    /**
+     * @brief Start searching, replacing any search in progress.
+     * @param query The search query, as for FullTextIndex::query().
+     * @param maxResults Maximum number of results to keep.
+     * @param contextLength Number of characters of context to include around the match.
+     */
+    void start(const QString& query, int maxResults = 50, int contextLength = 100);
+
+    /**
+     * @brief Stop the current search. No signals arrive for it afterwards.
+     */
+    void cancel();
+
+    /**
+     * @brief Check if a search is in progress.
+     * @return True until the index and every live document have answered.
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Get the results merged so far.
+     * @return At most maxResults results, best first.
+     */
+    QList<SearchResult> results() const;
+
+signals:
+    /**
+     * @brief Emitted for each result that makes the best maxResults so far.
+     * A result ranked last may be pushed out later by better ones.
+     * @param result The result.
+     * @param rank Its position in results(), 0 for the best.
+     */
+    void resultFound(const QuantilyxDoc::SearchResult& result, int rank);
+
+    /**
+     * @brief Emitted once the index and every live document have answered.
+     * @param resultCount Number of results kept.
+     */
+    void finished(int resultCount);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_FEDERATEDSEARCH_H
@@ -1,91 +1,1510 @@
 /**
  * QuantilyxDoc - Professional Document Editor
  * Copyright (C) 2025 R² Innovative Software
- * 
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
  */
 #include "FullTextIndex.h"
+#include "IndexSegment.h"
+#include "Tokenizer.h"
+#include "../core/CancellationToken.h"
 #include "../core/Document.h"
+#include "../core/DocumentFactory.h"
+#include "../core/LatencyHistogram.h"
+#include "../core/Page.h"
 #include "../core/Logger.h"
+#include "../core/Settings.h"
+#include "../core/ThreadPool.h"
+#include "../core/Tracing.h"
 #include <QHash>
-#include <QMultiHash>
 #include <QMap>
 #include <QSet>
 #include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QTimer>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
 #include <QDir>
 #include <QStandardPaths>
-#include <QTextStream>
 #include <QFile>
 #include <QFileInfo>
-#include <QRegularExpression>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QSaveFile>
 #include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <limits>
+#include <numeric>
 
 namespace QuantilyxDoc {
 
-// For this example, we'll implement a *very basic* in-memory index using Qt containers.
-// This is NOT suitable for large corpora or production use. A proper solution would use
-// CLucene, Xapian, or SQLite FTS.
+namespace {
 
-struct IndexedDocumentData {
-    QString fullText; // Cached full text for quick access during queries
-    QHash<QString, QList<int>> wordPositions; // Word -> List of character positions in fullText
-    // Could also store page-specific text mappings if needed
+// Past this many segments a query touches too many dictionaries; merge them
+const int MaxSegmentsBeforeMerge = 10;
+
+const char* const ManifestName = "segments.json";
+const char* const SegmentSuffix = ".seg";
+
+// BM25 term frequency saturation and document length normalisation
+const double Bm25K1 = 1.2;
+const double Bm25B = 0.75;
+
+const quint32 NoDocument = std::numeric_limits<quint32>::max();
+
+// How long a bulk indexing worker waits for a document that loads in the background
+const unsigned long BulkLoadTimeoutMs = 120000;
+
+// Changes in watched directories are collected this long before a rescan
+const int RescanDelayMs = 2000;
+
+// Size, modification time and content hash of an indexed file
+struct FileSignature {
+    qint64 size = -1; // -1 if the file is missing
+    qint64 modified = 0;
+    quint64 hash = 0;
+};
+
+FileSignature fileSignature(const QString& filePath, bool withHash)
+{
+    FileSignature signature;
+    const QFileInfo info(filePath);
+    if (!info.isFile()) return signature;
+    signature.size = info.size();
+    signature.modified = info.lastModified().toMSecsSinceEpoch();
+    if (withHash) {
+        QFile file(filePath);
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        if (file.open(QIODevice::ReadOnly) && hash.addData(&file)) {
+            std::memcpy(&signature.hash, hash.result().constData(), sizeof(signature.hash));
+        }
+    }
+    return signature;
+}
+
+// An indexed document found unchanged after its file was touched
+struct TouchedFile {
+    quint32 docId;
+    QString filePath;
+    FileSignature signature;
+};
+
+// One document's terms and text, before it has an id
+struct ExtractedDocument {
+    QHash<QByteArray, QVector<IndexPosting>> postings;
+    QByteArray textChunk;
+    int tokenCount = 0;
+    int pageCount = 0;
+};
+
+// Documents indexed by one bulk worker, written as a segment of its own
+struct ShardBuffer {
+    QHash<QByteArray, QVector<IndexPosting>> terms;
+    QVector<IndexSegmentDocument> documents;
+    QHash<quint32, QByteArray> texts;
+    QVector<TouchedFile> touched;
+    qint64 bytes = 0;
+};
+
+// Wait for a document's background loading, if any, to finish or for stop
+bool waitUntilLoaded(Document* document, const std::atomic<bool>& stop)
+{
+    // Shared with the connections, which may still be running when this returns
+    struct Wait {
+        QMutex mutex;
+        QWaitCondition finished;
+        bool done = false;
+    };
+    const auto wait = std::make_shared<Wait>();
+    auto wake = [wait]() {
+        QMutexLocker locker(&wait->mutex);
+        wait->done = true;
+        wait->finished.wakeAll();
+    };
+    // Both are emitted on the main thread; the connections are direct
+    const QMetaObject::Connection loaded = QObject::connect(document, &Document::loaded, wake);
+    const QMetaObject::Connection failed = QObject::connect(document, &Document::loadFailed, wake);
+
+    QElapsedTimer timer;
+    timer.start();
+    {
+        QMutexLocker locker(&wait->mutex);
+        while (!wait->done && document->state() == Document::Loading && !stop
+               && !timer.hasExpired(qint64(BulkLoadTimeoutMs))) {
+            wait->finished.wait(&wait->mutex, 100); // The state is checked again in case the signal came before the connection
+        }
+    }
+    QObject::disconnect(loaded);
+    QObject::disconnect(failed);
+    return document->state() == Document::Loaded;
+}
+
+// Counts shared by the workers of one indexFiles() call
+struct BulkBatch {
+    QHash<QString, quint32> replaces; // Changed files and the documents they replace
+    QHash<quint32, quint64> hashes;   // Content hashes of the replaced documents
+    int total = 0;
+    std::atomic<int> done{0};
+    std::atomic<int> indexed{0};
+    std::atomic<int> failed{0};
+    std::atomic<int> workers{0};
 };
 
+// Documents in the buffer holding one term, like a segment's posting list
+struct BufferedList {
+    QVector<quint32> docs;
+    QVector<IndexDocStats> stats;
+    QVector<int> starts;            // Each document's first posting
+    QVector<IndexPosting> postings;
+    quint32 maxFreq = 0;
+};
+
+BufferedList bufferedList(const QVector<IndexPosting>& postings)
+{
+    BufferedList list;
+    list.postings = postings;
+    for (int i = 0; i < postings.size(); ++i) {
+        if (i > 0 && postings[i].docId == postings[i - 1].docId) {
+            list.stats.last().freq += postings[i].freq;
+            ++list.stats.last().pageCount;
+        } else {
+            list.docs.append(postings[i].docId);
+            list.stats.append(IndexDocStats{postings[i].freq, 1, postings[i].page, postings[i].offset});
+            list.starts.append(i);
+        }
+        list.maxFreq = qMax(list.maxFreq, list.stats.last().freq);
+    }
+    return list;
+}
+
+// A term's documents one at a time, from a segment or the buffer
+class TermIterator
+{
+public:
+    TermIterator(const IndexSegment::Cursor& cursor, int token)
+        : m_cursor(cursor), m_list(nullptr), m_pos(0), m_token(token), m_bound(0.0) {}
+    TermIterator(const BufferedList* list, int token)
+        : m_list(list), m_pos(0), m_token(token), m_bound(0.0) {}
+
+    int token() const { return m_token; }
+    double bound() const { return m_bound; }
+    void setBound(double bound) { m_bound = bound; }
+    quint32 maxFreq() const { return m_list ? m_list->maxFreq : m_cursor.maxFreq(); }
+
+    quint32 doc() const {
+        if (m_list) return m_pos < m_list->docs.size() ? m_list->docs[m_pos] : NoDocument;
+        return m_cursor.atEnd() ? NoDocument : m_cursor.docs()[m_pos];
+    }
+
+    const IndexDocStats& stats() {
+        return m_list ? m_list->stats[m_pos] : m_cursor.stats()[m_pos];
+    }
+
+    void next() {
+        ++m_pos;
+        if (!m_list && m_pos >= m_cursor.docCount()) {
+            m_cursor.nextBlock();
+            m_pos = 0;
+        }
+    }
+
+    // Append the current document's postings, page by page
+    void pages(QVector<IndexPosting>& out) {
+        if (!m_list) {
+            m_cursor.pages(m_pos, out);
+            return;
+        }
+        const int end = m_pos + 1 < m_list->starts.size() ? m_list->starts[m_pos + 1] : m_list->postings.size();
+        for (int i = m_list->starts[m_pos]; i < end; ++i) out.append(m_list->postings[i]);
+    }
+
+    // To the first document at or after docId
+    void advanceTo(quint32 docId) {
+        if (m_list) {
+            m_pos = int(std::lower_bound(m_list->docs.constBegin() + m_pos, m_list->docs.constEnd(), docId) - m_list->docs.constBegin());
+            return;
+        }
+        if (m_cursor.atEnd()) return;
+        if (m_cursor.lastDoc() < docId) {
+            if (!m_cursor.skipTo(docId)) return;
+            m_pos = 0;
+        }
+        m_pos = int(std::lower_bound(m_cursor.docs() + m_pos, m_cursor.docs() + m_cursor.docCount(), docId) - m_cursor.docs());
+    }
+
+private:
+    IndexSegment::Cursor m_cursor;
+    const BufferedList* m_list;
+    int m_pos;
+    int m_token;
+    double m_bound; // Highest score the term can add to a document
+};
+
+// The documents of a query unit in one source: its terms' lists, merged
+class UnitIterator
+{
+public:
+    void add(const TermIterator& term, int docFreq) {
+        m_terms.push_back(term);
+        m_size += docFreq;
+        settle();
+    }
+
+    bool isEmpty() const { return m_terms.empty(); }
+    int size() const { return m_size; } // Documents, counted once per term
+    quint32 doc() const { return m_doc; }
+
+    void next() {
+        for (TermIterator& term : m_terms) {
+            if (term.doc() == m_doc) term.next();
+        }
+        settle();
+    }
+
+    void advanceTo(quint32 docId) {
+        for (TermIterator& term : m_terms) {
+            if (term.doc() < docId) term.advanceTo(docId);
+        }
+        settle();
+    }
+
+    // Statistics of the current document over all terms; term receives the one found first
+    IndexDocStats stats(int* term) {
+        IndexDocStats combined{0, 0, 0, 0};
+        bool first = true;
+        for (TermIterator& iterator : m_terms) {
+            if (iterator.doc() != m_doc) continue;
+            const IndexDocStats& stats = iterator.stats();
+            combined.freq += stats.freq;
+            combined.pageCount += stats.pageCount;
+            if (first || stats.firstPage < combined.firstPage || (stats.firstPage == combined.firstPage && stats.firstOffset < combined.firstOffset)) {
+                combined.firstPage = stats.firstPage;
+                combined.firstOffset = stats.firstOffset;
+                *term = iterator.token();
+                first = false;
+            }
+        }
+        return combined;
+    }
+
+    void pages(QVector<IndexPosting>& out) {
+        for (TermIterator& term : m_terms) {
+            if (term.doc() == m_doc) term.pages(out);
+        }
+    }
+
+private:
+    void settle() {
+        m_doc = NoDocument;
+        for (const TermIterator& term : m_terms) m_doc = qMin(m_doc, term.doc());
+    }
+
+    std::vector<TermIterator> m_terms;
+    int m_size = 0;
+    quint32 m_doc = NoDocument;
+};
+
+// Most indexed terms a prefix stands for; the commonest are kept
+const int MaxPrefixTerms = 16;
+
+// Most matches of a query kept for answering its refinements
+const int MaxRememberedMatches = 65536;
+
+// A part of a query every result holds: a term, or one of the terms a
+// prefix stands for
+struct QueryUnit {
+    QByteArray text;           // The term, or the prefix
+    bool prefix = false;
+    bool truncated = false;    // The prefix stands for more than MaxPrefixTerms terms
+    QVector<QByteArray> terms; // Indexed terms it matches
+};
+
+struct ParsedQuery {
+    QVector<QueryUnit> units;
+    QVector<QVector<int>> phrases; // Units that follow one another on a page
+
+    bool isStructured() const {
+        return !phrases.isEmpty() || std::any_of(units.cbegin(), units.cend(), [](const QueryUnit& unit) { return unit.prefix; });
+    }
+};
+
+// Words in double quotes make a phrase, and a word ending in '*' is a
+// prefix. An unclosed quote still starts a phrase, as it does while it is
+// typed. Prefixes are not stemmed: a partial word has no stem.
+ParsedQuery parseQuery(const QString& query, const Tokenizer& tokenizer)
+{
+    ParsedQuery parsed;
+    auto unitOf = [&parsed](const QByteArray& text, bool prefix) {
+        for (int i = 0; i < parsed.units.size(); ++i) {
+            if (parsed.units[i].text == text && parsed.units[i].prefix == prefix) return i;
+        }
+        QueryUnit unit;
+        unit.text = text;
+        unit.prefix = prefix;
+        if (!prefix) unit.terms.append(text);
+        parsed.units.append(unit);
+        return parsed.units.size() - 1;
+    };
+
+    const Tokenizer unstemmed(false);
+    const QStringList parts = query.split(QLatin1Char('"'));
+    for (int p = 0; p < parts.size(); ++p) {
+        if (p % 2 == 1) {
+            QVector<int> phrase;
+            tokenizer.tokenize(parts[p], [&](const QByteArray& term, int) { phrase.append(unitOf(term, false)); });
+            if (phrase.size() > 1) parsed.phrases.append(phrase);
+            continue;
+        }
+        for (const QString& word : parts[p].simplified().split(QLatin1Char(' '), QString::SkipEmptyParts)) {
+            QVector<QByteArray> terms;
+            tokenizer.tokenize(word, [&terms](const QByteArray& term, int) { terms.append(term); });
+            if (word.endsWith(QLatin1Char('*')) && !terms.isEmpty()) {
+                unstemmed.tokenize(word, [&terms](const QByteArray& term, int) { terms.last() = term; }); // The word's last term, unstemmed
+                for (int i = 0; i + 1 < terms.size(); ++i) unitOf(terms[i], false);
+                unitOf(terms.last(), true);
+            } else {
+                for (const QByteArray& term : terms) unitOf(term, false);
+            }
+        }
+    }
+    return parsed;
+}
+
+// Whether every document matching current also matches previous, so
+// previous's matches can stand in for the index
+bool refines(const ParsedQuery& previous, const ParsedQuery& current)
+{
+    for (const QueryUnit& old : previous.units) {
+        const bool covered = std::any_of(current.units.cbegin(), current.units.cend(), [&old](const QueryUnit& unit) {
+            if (!old.prefix) return !unit.prefix && unit.text == old.text;
+            return !old.truncated && unit.text.startsWith(old.text);
+        });
+        if (!covered) return false;
+    }
+    auto words = [](const ParsedQuery& query, const QVector<int>& phrase) {
+        QVector<QByteArray> texts;
+        for (int unit : phrase) texts.append(query.units[unit].text);
+        return texts;
+    };
+    for (const QVector<int>& old : previous.phrases) {
+        const QVector<QByteArray> oldWords = words(previous, old);
+        const bool kept = std::any_of(current.phrases.cbegin(), current.phrases.cend(), [&](const QVector<int>& phrase) {
+            return words(current, phrase) == oldWords;
+        });
+        if (!kept) return false;
+    }
+    return true;
+}
+
+struct ScoredDocument {
+    double score = 0.0;
+    quint32 docId = 0;
+    quint32 page = 0;
+    quint32 offset = 0;
+    int token = -1; // Query token found first in the document
+    int term = 0;   // Which of the token's terms, for prefixes
+};
+
+double inverseFrequency(int docFreq, int documentTotal)
+{
+    return std::log(1.0 + (qMax(documentTotal, docFreq) - docFreq + 0.5) / (docFreq + 0.5));
+}
+
+// Add a token's BM25 weight, and move the document's first hit to it if it comes earlier
+void addScore(ScoredDocument& document, int token, double idf, const IndexDocStats& stats, quint32 length, double averageLength)
+{
+    const double tf = double(stats.freq);
+    document.score += idf * tf * (Bm25K1 + 1.0) / (tf + Bm25K1 * (1.0 - Bm25B + Bm25B * length / averageLength));
+    if (document.token < 0 || stats.firstPage < document.page || (stats.firstPage == document.page && stats.firstOffset < document.offset)) {
+        document.page = stats.firstPage;
+        document.offset = stats.firstOffset;
+        document.token = token;
+    }
+}
+
+// The best k documents seen so far, as a min-heap
+class TopDocuments
+{
+public:
+    explicit TopDocuments(int k) : m_k(qMax(0, k)) {}
+
+    bool isFull() const { return m_heap.size() >= m_k; }
+    bool isEmpty() const { return m_heap.isEmpty(); }
+
+    // A document must score above this to enter
+    double threshold() const { return isFull() && m_k > 0 ? m_heap.first().score : 0.0; }
+
+    void offer(const ScoredDocument& document) {
+        if (m_k == 0) return;
+        if (!isFull()) {
+            m_heap.append(document);
+            std::push_heap(m_heap.begin(), m_heap.end(), lower);
+        } else if (document.score > m_heap.first().score) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), lower);
+            m_heap.last() = document;
+            std::push_heap(m_heap.begin(), m_heap.end(), lower);
+        }
+    }
+
+    QVector<ScoredDocument> sorted() const {
+        QVector<ScoredDocument> result = m_heap;
+        std::sort_heap(result.begin(), result.end(), lower); // Best first, given the inverted order
+        return result;
+    }
+
+private:
+    static bool lower(const ScoredDocument& a, const ScoredDocument& b) { return a.score > b.score; }
+
+    int m_k;
+    QVector<ScoredDocument> m_heap;
+};
+
+} // namespace
+
 class FullTextIndex::Private {
 public:
     Private(FullTextIndex* q_ptr)
-        : q(q_ptr), ready(false) {}
+        : q(q_ptr), ready(false), nextDocId(1), nextSegment(1), pendingBytes(0), totalLength(0)
+        , contentVersion(0), queryCacheCapacity(0), manifestDirty(false), merging(false), bulkWorkers(0), stopping(false), generation(0)
+        , watching(false), watchSyncQueued(false), watcher(nullptr), rescanTimer(nullptr) {}
+
+    struct DocInfo {
+        QString filePath;
+        quint32 pageCount = 0;
+        quint32 length = 0; // Indexed words, for BM25
+        FileSignature signature; // Of the file when it was indexed or last found unchanged
+    };
 
     FullTextIndex* q;
-    mutable QMutex mutex; // Protect access to the index maps
+    mutable QMutex mutex; // Protects everything below
+    QWaitCondition workDone; // A merge or a bulk worker finished
     bool ready;
     QString indexPathStr;
-    QHash<Document*, IndexedDocumentData> docIndex; // Map Document* to its indexed data
-    QMultiHash<QString, Document*> wordToDocs; // Map Word -> Set of Documents containing it
-    QSet<Document*> indexedDocuments; // Track which documents are indexed
+    quint32 nextDocId;
+    int nextSegment;
+    QList<std::shared_ptr<IndexSegment>> segments; // Oldest first; bulk indexing interleaves their id ranges
+    QHash<QByteArray, QVector<IndexPosting>> pendingTerms; // Added since the last commit
+    QVector<IndexSegmentDocument> pendingDocs;
+    QHash<quint32, QByteArray> pendingTexts; // Compressed page text of the buffered documents
+    qint64 pendingBytes;
+    QSet<quint32> deleted;              // Removed documents still in segments or the buffer
+    QHash<quint32, DocInfo> docs;       // Indexed documents, not removed
+    quint64 totalLength;                // Of the documents in docs
+    QHash<QString, quint32> docIdByPath;
+    QHash<quint32, QPointer<Document>> openDocuments; // Where contexts can be cut from
+    QSet<quint32> touched;              // Documents whose signature is newer than their segment's
+    quint64 contentVersion;             // Bumped whenever documents are added or removed
+    // The last query with a prefix or a phrase, so the next keystroke can
+    // narrow its matches and its dictionary ranges instead of the index
+    struct RecentQuery {
+        ParsedQuery parsed;
+        QVector<quint32> matches; // Ascending; empty if there were too many to keep
+        bool complete = false;
+        quint64 version = 0;
+        QHash<QByteArray, QVector<QPair<std::weak_ptr<IndexSegment>, QPair<int, int>>>> ranges; // Per prefix and segment
+    };
+    mutable RecentQuery recentQuery;
+    // Results of recent queries, valid while contentVersion is unchanged
+    struct CachedQuery {
+        QList<SearchResult> results; // Without their documents, which may close
+        quint64 version;
+        std::list<QString>::iterator lruPos;
+    };
+    int queryCacheCapacity;               // Advanced/FullTextQueryCache, read at initialization
+    mutable std::list<QString> queryLru;  // Least recently used first
+    mutable QHash<QString, CachedQuery> queryCache;
+    mutable LatencyHistogram queryLatency;
+    bool manifestDirty;
+    bool merging;
+    int bulkWorkers;         // Bulk indexing workers still running
+    std::atomic<bool> stopping; // Set by the destructor; read by bulk workers without the lock
+    quint64 generation; // Bumped by clear(), so a merge in flight is dropped
+    Tokenizer tokenizer; // Fixed for the life of the index: its terms are in the segments
+    bool watching;           // Advanced/FullTextWatchFiles, read at initialization
+    bool watchSyncQueued;
+    // Owned by q and only used on its thread
+    QFileSystemWatcher* watcher;
+    QTimer* rescanTimer;
+    QSet<QString> changedDirectories;
+
+    static qint64 bufferLimit() {
+        return qint64(qMax(1, Settings::instance().value<int>("Advanced/FullTextBufferMB", 32))) * 1024 * 1024;
+    }
+
+    static Tokenizer configuredTokenizer() {
+        return Tokenizer(Settings::instance().value<bool>("Advanced/FullTextStemming", false));
+    }
+
+    Tokenizer currentTokenizer() const {
+        QMutexLocker locker(&mutex);
+        return tokenizer;
+    }
+
+    static FileSignature signatureOf(const IndexSegmentDocument& document) {
+        FileSignature signature;
+        signature.size = document.fileSize;
+        signature.modified = document.modified;
+        signature.hash = document.contentHash;
+        return signature;
+    }
+
+    static IndexSegmentDocument segmentDocument(quint32 docId, const QString& filePath, const ExtractedDocument& extracted,
+                                                const FileSignature& signature) {
+        return IndexSegmentDocument{docId, quint32(extracted.pageCount), quint32(extracted.tokenCount), filePath,
+                                    signature.size, signature.modified, signature.hash};
+    }
+
+    // Mask an indexed document until a merge drops it. Caller holds mutex.
+    void tombstone(quint32 docId) {
+        const DocInfo info = docs.take(docId);
+        docIdByPath.remove(info.filePath);
+        totalLength -= info.length;
+        openDocuments.remove(docId);
+        touched.remove(docId);
+        deleted.insert(docId);
+        ++contentVersion;
+        manifestDirty = true;
+    }
+
+    // Record a new signature for a document whose text did not change. Caller holds mutex.
+    void touch(quint32 docId, const FileSignature& signature) {
+        const auto it = docs.find(docId);
+        if (it == docs.end()) return;
+        it->signature = signature;
+        touched.insert(docId);
+        manifestDirty = true;
+    }
+
+    // A document's compressed page text as stored, to tell whether re-extracted text changed
+    QByteArray storedText(quint32 docId) const {
+        QMutexLocker locker(&mutex);
+        const auto pending = pendingTexts.constFind(docId);
+        if (pending != pendingTexts.constEnd()) return *pending;
+        for (const auto& segment : segments) {
+            const int index = segment->indexOf(docId);
+            if (index < 0) continue;
+            const QByteArray chunk = segment->textChunk(index);
+            return QByteArray(chunk.constData(), chunk.size()); // The segment may be merged away
+        }
+        return QByteArray();
+    }
+
+    // The same words with other spacing or case give the same results
+    static QString queryKey(const QString& query, int maxResults, int contextLength) {
+        return QStringLiteral("%1 %2 ").arg(maxResults).arg(contextLength) + query.simplified().toCaseFolded();
+    }
+
+    // Caller holds mutex
+    bool cachedResults(const QString& key, QList<SearchResult>* results) const {
+        const auto it = queryCache.find(key);
+        if (it == queryCache.end()) return false;
+        if (it->version != contentVersion) {
+            queryLru.erase(it->lruPos);
+            queryCache.erase(it);
+            return false;
+        }
+        queryLru.splice(queryLru.end(), queryLru, it->lruPos);
+        *results = it->results;
+        for (SearchResult& result : *results) result.document = openDocuments.value(docIdByPath.value(result.filePath, NoDocument)).data();
+        return true;
+    }
+
+    // Caller holds mutex
+    void cacheResults(const QString& key, QList<SearchResult> results, quint64 version) const {
+        if (queryCacheCapacity <= 0 || version != contentVersion) return;
+        for (SearchResult& result : results) result.document = nullptr;
+        const auto it = queryCache.find(key);
+        if (it != queryCache.end()) {
+            it->results = results;
+            it->version = version;
+            queryLru.splice(queryLru.end(), queryLru, it->lruPos);
+            return;
+        }
+        queryLru.push_back(key);
+        queryCache.insert(key, CachedQuery{results, version, std::prev(queryLru.end())});
+        while (queryCache.size() > queryCacheCapacity) {
+            queryCache.remove(queryLru.front());
+            queryLru.pop_front();
+        }
+    }
 
-    // Helper to tokenize text (simple split by whitespace/punctuation)
-    QStringList tokenizeText(const QString& text) const {
-        QRegularExpression re(R"([\W]+)"); // Split on non-word characters
-        QStringList tokens = text.split(re, Qt::SkipEmptyParts);
-        // Convert to lowercase for case-insensitive indexing
-        for (auto& token : tokens) {
-            token = token.toLower();
+    QString manifestPath() const {
+        return indexPathStr + QLatin1Char('/') + QLatin1String(ManifestName);
+    }
+
+    QString newSegmentPath() {
+        return indexPathStr + QStringLiteral("/%1").arg(nextSegment++, 8, 10, QLatin1Char('0')) + QLatin1String(SegmentSuffix);
+    }
+
+    // Caller holds mutex
+    bool writeManifest() {
+        QJsonArray segmentNames;
+        for (const auto& segment : segments) segmentNames.append(QFileInfo(segment->filePath()).fileName());
+        QList<quint32> deletedIds = deleted.values();
+        std::sort(deletedIds.begin(), deletedIds.end());
+        QJsonArray deletedArray;
+        for (quint32 id : deletedIds) deletedArray.append(double(id));
+
+        QJsonObject manifest;
+        manifest["version"] = 1;
+        manifest["nextDocId"] = double(nextDocId);
+        manifest["nextSegment"] = nextSegment;
+        manifest["segments"] = segmentNames;
+        manifest["deleted"] = deletedArray;
+        manifest["stemming"] = tokenizer.isStemming();
+        QJsonArray touchedArray;
+        for (quint32 id : touched) {
+            const auto it = docs.constFind(id);
+            if (it == docs.constEnd()) continue;
+            QJsonObject entry;
+            entry["doc"] = double(id);
+            entry["size"] = double(it->signature.size);
+            entry["modified"] = double(it->signature.modified);
+            entry["hash"] = QString::number(it->signature.hash, 16);
+            touchedArray.append(entry);
+        }
+        manifest["touched"] = touchedArray;
+
+        QSaveFile file(manifestPath());
+        const QByteArray json = QJsonDocument(manifest).toJson(QJsonDocument::Compact);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+            LOG_ERROR("FullTextIndex: Failed to write " << manifestPath() << ": " << file.errorString());
+            return false;
         }
-        return tokens;
+        manifestDirty = false;
+        return true;
     }
 
-    // Helper to index a single document's text
-    void indexDocumentText(Document* doc, const QString& text) {
-        IndexedDocumentData data;
-        data.fullText = text;
-        QStringList tokens = tokenizeText(text);
+    // Caller holds mutex
+    void loadManifest() {
+        QFile file(manifestPath());
+        if (!file.open(QIODevice::ReadOnly)) return; // A new index
+        const QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+        nextDocId = quint32(qMax(1.0, manifest["nextDocId"].toDouble()));
+        nextSegment = qMax(1, manifest["nextSegment"].toInt());
+        tokenizer = Tokenizer(manifest["stemming"].toBool());
+        for (const auto& id : manifest["deleted"].toArray()) deleted.insert(quint32(id.toDouble()));
 
-        QHash<QString, QSet<int>> uniquePositions; // Use QSet to avoid duplicate positions for a word in a doc
-        for (int i = 0; i < tokens.size(); ++i) {
-            QString word = tokens[i];
-            int posInText = text.indexOf(word, uniquePositions[word].isEmpty() ? 0 : uniquePositions[word].last() + 1, Qt::CaseInsensitive);
-            if (posInText != -1) {
-                 uniquePositions[word].insert(posInText);
+        QSet<QString> listed;
+        for (const auto& name : manifest["segments"].toArray()) {
+            const QString path = indexPathStr + QLatin1Char('/') + name.toString();
+            QString error;
+            std::shared_ptr<IndexSegment> segment = IndexSegment::open(path, &error);
+            if (!segment) {
+                LOG_ERROR("FullTextIndex: " << error << " Its documents are no longer searchable.");
+                continue;
             }
+            listed.insert(QFileInfo(path).fileName());
+            for (const IndexSegmentDocument& document : segment->documents()) {
+                if (deleted.contains(document.docId)) continue;
+                docs.insert(document.docId, DocInfo{document.filePath, document.pageCount, document.length, signatureOf(document)});
+                totalLength += document.length;
+                docIdByPath.insert(document.filePath, document.docId);
+            }
+            segments.append(segment);
+        }
+        for (const auto& value : manifest["touched"].toArray()) {
+            const QJsonObject entry = value.toObject();
+            const auto it = docs.find(quint32(entry["doc"].toDouble()));
+            if (it == docs.end()) continue;
+            it->signature.size = qint64(entry["size"].toDouble());
+            it->signature.modified = qint64(entry["modified"].toDouble());
+            it->signature.hash = entry["hash"].toString().toULongLong(nullptr, 16);
+            touched.insert(it.key());
+        }
+
+        // Output of a merge or commit that never made it into the manifest
+        const QStringList files = QDir(indexPathStr).entryList({QStringLiteral("*") + QLatin1String(SegmentSuffix), QStringLiteral("*.txt")}, QDir::Files);
+        for (const QString& name : files) {
+            const QString segmentName = QFileInfo(name).completeBaseName() + QLatin1String(SegmentSuffix);
+            if (!listed.contains(segmentName)) QFile::remove(indexPathStr + QLatin1Char('/') + name);
         }
+    }
 
-        // Convert QSet to QList for storage
-        for (auto it = uniquePositions.begin(); it != uniquePositions.end(); ++it) {
-            data.wordPositions.insert(it.key(), it.value().values());
-            // Update global word-to-docs map
-            wordToDocs.insert(it.key(), doc);
+    // Write documents as a segment, leaving out the postings of those in skip
+    static std::shared_ptr<IndexSegment> writeSegment(const QString& path, const QHash<QByteArray, QVector<IndexPosting>>& terms,
+                                                      const QVector<IndexSegmentDocument>& documents,
+                                                      const QHash<quint32, QByteArray>& texts,
+                                                      const QSet<quint32>& skip, QString* error) {
+        QList<QByteArray> sorted = terms.keys();
+        std::sort(sorted.begin(), sorted.end());
+        IndexSegmentWriter writer(path);
+        QVector<IndexPosting> live;
+        for (const QByteArray& term : sorted) {
+            const QVector<IndexPosting>& postings = terms[term];
+            live.clear();
+            for (const IndexPosting& posting : postings) {
+                if (!skip.contains(posting.docId)) live.append(posting);
+            }
+            if (!writer.addTerm(term, live.constData(), live.size())) break;
         }
+        for (const IndexSegmentDocument& document : documents) writer.addDocument(document, texts.value(document.docId));
 
-        docIndex.insert(doc, data);
-        indexedDocuments.insert(doc);
-        LOG_DEBUG("FullTextIndex: Indexed document '" << doc->title() << "' with " << tokens.size() << " tokens.");
+        std::shared_ptr<IndexSegment> segment = writer.finish(error) ? IndexSegment::open(path, error) : nullptr;
+        if (!segment) IndexSegment::removeFiles(path);
+        return segment;
+    }
+
+    // Get the text page by page and split it into terms. Pages that cache
+    // their text (PdfPage) hand it out without re-extracting.
+    static ExtractedDocument extract(Document* document, const Tokenizer& tokenizer) {
+        QStringList pageTexts;
+        for (int i = 0; i < document->pageCount(); ++i) {
+            if (CancellationToken::currentIsCanceled()) break; // addOrReplace() drops the partial text
+            Page* page = document->page(i);
+            pageTexts.append(page ? page->text() : QString());
+        }
+        return extract(pageTexts, tokenizer);
+    }
+
+    // Split text given page by page into terms
+    static ExtractedDocument extract(const QStringList& pageTexts, const Tokenizer& tokenizer) {
+        ExtractedDocument extracted;
+        extracted.pageCount = pageTexts.size();
+        for (int i = 0; i < extracted.pageCount; ++i) {
+            if (CancellationToken::currentIsCanceled()) break;
+            QHash<QByteArray, IndexPosting> onPage;
+            tokenizer.tokenize(pageTexts[i], [&](const QByteArray& term, int offset) {
+                ++extracted.tokenCount;
+                auto it = onPage.find(term);
+                if (it == onPage.end()) onPage.insert(term, IndexPosting{0, quint32(i), 1, quint32(offset)});
+                else ++it->freq;
+            });
+            for (auto it = onPage.constBegin(); it != onPage.constEnd(); ++it) {
+                extracted.postings[it.key()].append(it.value()); // Pages in order, so postings stay sorted
+            }
+        }
+        // Kept for snippets, so results need neither the document nor its text in memory
+        extracted.textChunk = IndexSegment::packPageTexts(pageTexts);
+        return extracted;
+    }
+
+    // Add a document's postings under its id; returns the bytes added
+    static qint64 appendPostings(QHash<QByteArray, QVector<IndexPosting>>& terms, quint32 docId, ExtractedDocument& extracted) {
+        qint64 bytes = 0;
+        for (auto it = extracted.postings.begin(); it != extracted.postings.end(); ++it) {
+            QVector<IndexPosting>& list = terms[it.key()];
+            if (list.isEmpty()) bytes += it.key().size() + qint64(sizeof(QVector<IndexPosting>));
+            for (IndexPosting& posting : it.value()) {
+                posting.docId = docId;
+                list.append(posting);
+            }
+            bytes += qint64(it.value().size()) * qint64(sizeof(IndexPosting));
+        }
+        return bytes + extracted.textChunk.size();
+    }
+
+    // Write the buffer as a segment. Caller holds mutex.
+    bool flushPending() {
+        if (!pendingDocs.isEmpty()) {
+            QVector<IndexSegmentDocument> liveDocs;
+            for (const IndexSegmentDocument& document : pendingDocs) {
+                if (!deleted.contains(document.docId)) liveDocs.append(document);
+            }
+
+            if (!liveDocs.isEmpty()) {
+                const QString path = newSegmentPath();
+                QString error;
+                const std::shared_ptr<IndexSegment> segment = writeSegment(path, pendingTerms, liveDocs, pendingTexts, deleted, &error);
+                if (!segment) {
+                    // The buffer is kept for the next attempt
+                    LOG_ERROR("FullTextIndex: Commit failed: " << error);
+                    return false;
+                }
+                segments.append(segment);
+                LOG_DEBUG("FullTextIndex: Wrote segment " << path << " (" << liveDocs.size() << " documents, " << segment->termCount() << " terms)");
+            }
+
+            // Documents removed before they reached a segment need no mask
+            for (const IndexSegmentDocument& document : pendingDocs) deleted.remove(document.docId);
+            pendingTerms.clear();
+            pendingDocs.clear();
+            pendingTexts.clear();
+            pendingBytes = 0;
+            manifestDirty = true;
+        }
+        return !manifestDirty || writeManifest();
+    }
+
+    // Write a bulk worker's documents as a segment and put it in the index.
+    // Only the segment's name and its registration take the lock.
+    bool publishShard(ShardBuffer& shard, const std::shared_ptr<BulkBatch>& batch, quint64 batchGeneration) {
+        if (shard.documents.isEmpty() && shard.touched.isEmpty()) return true;
+        QString path;
+        std::shared_ptr<IndexSegment> segment;
+        if (!shard.documents.isEmpty()) {
+            {
+                QMutexLocker locker(&mutex);
+                if (batchGeneration != generation) return false; // Cleared meanwhile
+                path = newSegmentPath();
+            }
+            QString error;
+            segment = writeSegment(path, shard.terms, shard.documents, shard.texts, QSet<quint32>(), &error);
+            if (!segment) {
+                LOG_ERROR("FullTextIndex: Bulk indexing could not write a segment: " << error);
+                return false;
+            }
+        }
+        const QVector<IndexSegmentDocument> documents = shard.documents;
+        const QVector<TouchedFile> touchedFiles = shard.touched;
+        shard = ShardBuffer();
+
+        QMutexLocker locker(&mutex);
+        if (batchGeneration != generation) {
+            if (segment) IndexSegment::removeFiles(path);
+            return false;
+        }
+        if (segment) segments.append(segment);
+        int added = 0;
+        for (const IndexSegmentDocument& document : documents) {
+            const quint32 current = docIdByPath.value(document.filePath, NoDocument);
+            if (current != NoDocument && current != batch->replaces.value(document.filePath, NoDocument)) {
+                deleted.insert(document.docId); // Added meanwhile through addDocument()
+                continue;
+            }
+            if (current != NoDocument) tombstone(current); // The old version, until now still searchable
+            docIdByPath.insert(document.filePath, document.docId);
+            docs.insert(document.docId, DocInfo{document.filePath, document.pageCount, document.length, signatureOf(document)});
+            totalLength += quint64(document.length);
+            ++added;
+        }
+        ++contentVersion;
+        for (const TouchedFile& file : touchedFiles) {
+            if (docIdByPath.value(file.filePath, NoDocument) == file.docId) touch(file.docId, file.signature);
+        }
+        batch->indexed += added;
+        manifestDirty = true;
+        writeManifest();
+        if (segment) {
+            LOG_DEBUG("FullTextIndex: Bulk worker wrote segment " << path << " (" << added << " documents)");
+            FullTextIndex* index = q;
+            QMetaObject::invokeMethod(index, [index]() { emit index->indexContentChanged(); }, Qt::QueuedConnection);
+        }
+        return true;
+    }
+
+    // Index one file of a bulk share into the worker's buffer
+    void indexShardFile(ShardBuffer& shard, const QString& filePath, quint32 docId, const std::shared_ptr<BulkBatch>& batch,
+                        const Tokenizer& tokenizer) {
+        const quint32 previous = batch->replaces.value(filePath, NoDocument);
+        const FileSignature signature = fileSignature(filePath, true);
+        if (previous != NoDocument && signature.hash != 0 && signature.hash == batch->hashes.value(previous)) {
+            shard.touched.append(TouchedFile{previous, filePath, signature}); // Same bytes, new time stamp
+            return;
+        }
+
+        QString error;
+        Document* document = DocumentFactory::instance().loadDocument(filePath, QString(), &error);
+        if (document && waitUntilLoaded(document, stopping)) {
+            ExtractedDocument extracted = extract(document, tokenizer);
+            if (previous != NoDocument && extracted.textChunk == storedText(previous)) {
+                shard.touched.append(TouchedFile{previous, filePath, signature}); // Saved again, or only metadata changed
+            } else {
+                shard.bytes += appendPostings(shard.terms, docId, extracted);
+                shard.documents.append(segmentDocument(docId, filePath, extracted, signature));
+                shard.texts.insert(docId, extracted.textChunk);
+            }
+        } else {
+            if (document) error = document->lastError();
+            LOG_WARN("FullTextIndex: Cannot index " << filePath << ": " << error);
+            ++batch->failed;
+        }
+        delete document;
+    }
+
+    // Runs on an I/O worker: one share of a bulk batch, ids from firstId on
+    void runShard(const QStringList& files, quint32 firstId, const std::shared_ptr<BulkBatch>& batch,
+                  quint64 batchGeneration, const Tokenizer& tokenizer, qint64 limit) {
+        ShardBuffer shard;
+        bool publishing = true;
+        FullTextIndex* index = q;
+        const int step = qMax(1, batch->total / 100);
+        for (int i = 0; i < files.size() && publishing && !stopping; ++i) {
+            indexShardFile(shard, files[i], firstId + quint32(i), batch, tokenizer);
+            if (shard.bytes > limit) publishing = publishShard(shard, batch, batchGeneration);
+            const int done = ++batch->done;
+            if (done % step == 0 || done == batch->total) {
+                const int total = batch->total;
+                QMetaObject::invokeMethod(index, [index, done, total]() { emit index->bulkIndexingProgress(done, total); }, Qt::QueuedConnection);
+            }
+        }
+        if (publishing) publishShard(shard, batch, batchGeneration);
+
+        // The last worker merges what the batch wrote; the index outlives
+        // this call until bulkWorkers is decremented
+        const bool last = --batch->workers == 0;
+        if (last) {
+            if (!stopping) index->optimize();
+            requestWatchSync();
+        }
+        QMutexLocker locker(&mutex);
+        --bulkWorkers;
+        workDone.wakeAll();
+        if (last) {
+            const int indexed = batch->indexed;
+            const int failed = batch->failed;
+            LOG_INFO("FullTextIndex: Bulk indexing done: " << indexed << " indexed, " << failed << " failed.");
+            QMetaObject::invokeMethod(index, [index, indexed, failed]() { emit index->bulkIndexingFinished(indexed, failed); }, Qt::QueuedConnection);
+        }
+    }
+
+    // Split files between bulk workers. Files already indexed are skipped
+    // unless replaces names the document they replace.
+    int startBulk(const QStringList& filePaths, const QHash<QString, quint32>& replaces) {
+        auto batch = std::make_shared<BulkBatch>();
+        QStringList files;
+        quint32 firstId = 0;
+        quint64 batchGeneration = 0;
+        Tokenizer batchTokenizer;
+        int workers = 0;
+        {
+            QMutexLocker locker(&mutex);
+            if (!ready || stopping) return 0;
+            QSet<QString> seen;
+            for (const QString& path : filePaths) {
+                if (path.isEmpty()) continue;
+                const QString filePath = QFileInfo(path).absoluteFilePath();
+                if (seen.contains(filePath)) continue;
+                const quint32 current = docIdByPath.value(filePath, NoDocument);
+                const quint32 replaced = replaces.value(filePath, NoDocument);
+                if (current != replaced) continue; // Indexed, or changed since replaces was made
+                if (current != NoDocument) {
+                    batch->replaces.insert(filePath, current);
+                    batch->hashes.insert(current, docs.value(current).signature.hash);
+                }
+                seen.insert(filePath);
+                files.append(filePath);
+            }
+            if (files.isEmpty()) return 0;
+
+            // One range of ids for the batch, so workers number their files without the lock
+            firstId = nextDocId;
+            nextDocId += quint32(files.size());
+            manifestDirty = true;
+            batchGeneration = generation;
+            batchTokenizer = tokenizer;
+            workers = qBound(1, ThreadPool::instance().maxThreadCount(), files.size());
+            bulkWorkers += workers;
+        }
+
+        // Workers run on the I/O pool: they mostly wait on files and on
+        // backends that finish loading on the CPU pool
+        const qint64 limit = qMax<qint64>(4 * 1024 * 1024, bufferLimit() / workers);
+        batch->total = files.size();
+        batch->workers = workers;
+        for (int w = 0; w < workers; ++w) {
+            const int from = int(qint64(files.size()) * w / workers);
+            const int to = int(qint64(files.size()) * (w + 1) / workers);
+            const QStringList share = files.mid(from, to - from);
+            const quint32 shareId = firstId + quint32(from);
+            ThreadPool::ioInstance().submitDetached([this, share, shareId, batch, batchGeneration, batchTokenizer, limit]() {
+                runShard(share, shareId, batch, batchGeneration, batchTokenizer, limit);
+            });
+        }
+        LOG_INFO("FullTextIndex: Indexing " << files.size() << " files on " << workers << " workers.");
+        return files.size();
+    }
+
+    // Runs on an I/O worker: compare indexed files with their signatures,
+    // mask those that are gone and re-index those that changed. With no
+    // directories given, every indexed file is checked.
+    void rescan(const QSet<QString>& directories) {
+        QVector<QPair<quint32, DocInfo>> candidates;
+        {
+            QMutexLocker locker(&mutex);
+            for (auto it = docs.constBegin(); it != docs.constEnd(); ++it) {
+                if (directories.isEmpty() || directories.contains(QFileInfo(it->filePath).absolutePath())) {
+                    candidates.append(qMakePair(it.key(), it.value()));
+                }
+            }
+        }
+
+        QStringList changed;
+        QHash<QString, quint32> replaces;
+        QVector<quint32> missing;
+        for (const auto& candidate : candidates) {
+            if (stopping) break;
+            const FileSignature signature = fileSignature(candidate.second.filePath, false);
+            if (signature.size < 0) {
+                missing.append(candidate.first);
+            } else if (signature.size != candidate.second.signature.size || signature.modified != candidate.second.signature.modified) {
+                changed.append(candidate.second.filePath);
+                replaces.insert(candidate.second.filePath, candidate.first);
+            }
+        }
+
+        int removed = 0;
+        {
+            QMutexLocker locker(&mutex);
+            for (quint32 docId : missing) {
+                if (!docs.contains(docId)) continue;
+                tombstone(docId);
+                ++removed;
+            }
+            if (removed > 0) writeManifest();
+        }
+        if (removed > 0) {
+            FullTextIndex* index = q;
+            QMetaObject::invokeMethod(index, [index]() { emit index->indexContentChanged(); }, Qt::QueuedConnection);
+        }
+        const int queued = changed.isEmpty() ? 0 : startBulk(changed, replaces);
+        if (removed > 0 || queued > 0) {
+            LOG_INFO("FullTextIndex: Rescan of " << candidates.size() << " files: " << removed << " removed, " << queued << " changed.");
+        }
+        if (removed > 0) requestWatchSync();
+    }
+
+    // Run rescan() on the I/O pool; the destructor waits for it like for a bulk worker
+    void startRescan(const QSet<QString>& directories) {
+        {
+            QMutexLocker locker(&mutex);
+            if (!ready || stopping) return;
+            ++bulkWorkers;
+        }
+        ThreadPool::ioInstance().submitDetached([this, directories]() {
+            rescan(directories);
+            QMutexLocker locker(&mutex);
+            --bulkWorkers;
+            workDone.wakeAll();
+        }, Task::Priority::Low);
+    }
+
+    // Have syncWatcher() run soon on q's thread. Safe from any thread.
+    void requestWatchSync() {
+        {
+            QMutexLocker locker(&mutex);
+            if (!watching || watchSyncQueued) return;
+            watchSyncQueued = true;
+        }
+        QMetaObject::invokeMethod(q, [this]() { syncWatcher(); }, Qt::QueuedConnection);
+    }
+
+    // Watch the directories of the indexed files. Directories rather than
+    // files: one watch covers all of a directory's files, and watches are
+    // a limited resource.
+    void syncWatcher() {
+        QSet<QString> wanted;
+        {
+            QMutexLocker locker(&mutex);
+            watchSyncQueued = false;
+            if (!watching) return;
+            for (const DocInfo& info : docs) wanted.insert(QFileInfo(info.filePath).absolutePath());
+        }
+        if (!watcher) {
+            watcher = new QFileSystemWatcher(q);
+            rescanTimer = new QTimer(q);
+            rescanTimer->setSingleShot(true);
+            rescanTimer->setInterval(RescanDelayMs);
+            QObject::connect(watcher, &QFileSystemWatcher::directoryChanged, q, [this](const QString& directory) {
+                changedDirectories.insert(directory);
+                rescanTimer->start(); // A save touches a directory several times
+            });
+            QObject::connect(rescanTimer, &QTimer::timeout, q, [this]() {
+                const QSet<QString> directories = changedDirectories;
+                changedDirectories.clear();
+                startRescan(directories);
+            });
+        }
+
+        const QStringList watched = watcher->directories();
+        QStringList stale;
+        for (const QString& directory : watched) {
+            if (!wanted.remove(directory)) stale.append(directory);
+        }
+        if (!stale.isEmpty()) watcher->removePaths(stale);
+        if (!wanted.isEmpty()) {
+            const QStringList failed = watcher->addPaths(wanted.values());
+            if (!failed.isEmpty()) LOG_WARN("FullTextIndex: Cannot watch " << failed.size() << " directories, e.g. " << failed.first());
+        }
+    }
+
+    // Index an open document, or re-index it if replace is set and its
+    // text changed. The text is pageTexts if given, else extracted from the
+    // document. Callers check ready.
+    bool addOrReplace(Document* document, bool replace, const QStringList* pageTexts = nullptr) {
+        const QString filePath = document->filePath();
+        if (filePath.isEmpty()) {
+            LOG_WARN("FullTextIndex: Document '" << document->title() << "' has no file and cannot be indexed.");
+            return false;
+        }
+        quint32 previous;
+        {
+            QMutexLocker locker(&mutex);
+            previous = docIdByPath.value(filePath, NoDocument);
+        }
+        if (!replace && previous != NoDocument) {
+            LOG_WARN("FullTextIndex: Document '" << document->title() << "' is already indexed.");
+            return true; // updateDocument() re-indexes it
+        }
+        if (replace && previous == NoDocument) {
+            LOG_WARN("FullTextIndex: Attempted to update non-indexed document '" << document->title() << "'");
+            return false;
+        }
+
+        emit q->indexingStarted(document);
+
+        // Without the lock: this might involve OCR
+        ExtractedDocument extracted = pageTexts ? extract(*pageTexts, currentTokenizer()) : extract(document, currentTokenizer());
+        if (CancellationToken::currentIsCanceled()) {
+            // Part of the text must not stand for all of it
+            emit q->indexingFinished(document, false);
+            LOG_DEBUG("FullTextIndex: Indexing of '" << document->title() << "' was canceled.");
+            return false;
+        }
+        const FileSignature signature = fileSignature(filePath, true);
+
+        bool flushFailed = false;
+        bool mergeDue = false;
+        {
+            const QByteArray stored = previous == NoDocument ? QByteArray() : storedText(previous);
+            QMutexLocker locker(&mutex);
+            if (docIdByPath.value(filePath, NoDocument) != previous) return true; // Indexed or removed meanwhile by another thread
+            if (previous != NoDocument && extracted.textChunk == stored) {
+                touch(previous, signature);
+                openDocuments.insert(previous, document);
+                locker.unlock();
+                emit q->indexingFinished(document, true);
+                LOG_DEBUG("FullTextIndex: Text of '" << document->title() << "' is unchanged.");
+                return true;
+            }
+            if (previous != NoDocument) tombstone(previous);
+
+            const quint32 docId = nextDocId++;
+            pendingBytes += appendPostings(pendingTerms, docId, extracted);
+            pendingDocs.append(segmentDocument(docId, filePath, extracted, signature));
+            pendingTexts.insert(docId, extracted.textChunk);
+            docs.insert(docId, DocInfo{filePath, quint32(extracted.pageCount), quint32(extracted.tokenCount), signature});
+            totalLength += quint64(extracted.tokenCount);
+            docIdByPath.insert(filePath, docId);
+            openDocuments.insert(docId, document);
+            ++contentVersion;
+            manifestDirty = true;
+
+            // The buffer is the only part of the index held in memory
+            if (pendingBytes > bufferLimit()) {
+                flushFailed = !flushPending();
+                mergeDue = segments.size() > MaxSegmentsBeforeMerge;
+            }
+        }
+        if (flushFailed) LOG_WARN("FullTextIndex: Buffer could not be written; it stays in memory.");
+        if (mergeDue) q->optimize();
+        if (previous == NoDocument) requestWatchSync();
+
+        emit q->indexingFinished(document, true);
+        emit q->indexContentChanged();
+        LOG_DEBUG("FullTextIndex: " << (previous == NoDocument ? "Added" : "Re-indexed") << " document '" << document->title()
+                  << "' with " << extracted.tokenCount << " tokens.");
+        return true;
+    }
+
+    // Find a phrase on the pages its words share, in the stored page text
+    static bool findPhrase(const ParsedQuery& parsed, const QVector<int>& phrase, std::vector<UnitIterator>& iterators,
+                           const std::function<QString(quint32)>& pageText, const Tokenizer& tokenizer,
+                           quint32* page, quint32* offset) {
+        QVector<quint32> common;
+        QVector<IndexPosting> postings;
+        for (int i = 0; i < phrase.size(); ++i) {
+            postings.clear();
+            iterators[size_t(phrase[i])].pages(postings);
+            QVector<quint32> pages;
+            for (const IndexPosting& posting : postings) pages.append(posting.page);
+            std::sort(pages.begin(), pages.end());
+            pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+            if (i == 0) {
+                common = pages;
+                continue;
+            }
+            QVector<quint32> both;
+            std::set_intersection(common.cbegin(), common.cend(), pages.cbegin(), pages.cend(), std::back_inserter(both));
+            common = both;
+            if (common.isEmpty()) return false;
+        }
+        for (quint32 candidate : common) {
+            QVector<QByteArray> words;
+            QVector<int> offsets;
+            tokenizer.tokenize(pageText(candidate), [&](const QByteArray& term, int at) {
+                words.append(term);
+                offsets.append(at);
+            });
+            for (int start = 0; start + phrase.size() <= words.size(); ++start) {
+                int matched = 0;
+                while (matched < phrase.size() && words[start + matched] == parsed.units[phrase[matched]].text) ++matched;
+                if (matched == phrase.size()) {
+                    *page = candidate;
+                    *offset = quint32(offsets[start]);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Answer a query with prefixes or phrases a document at a time: each
+    // unit must be in the document, and each phrase on one of its pages.
+    // A refinement of the previous such query only visits its matches.
+    void queryStructured(ParsedQuery& parsed, const RecentQuery& recent, quint64 version,
+                         const QList<std::shared_ptr<IndexSegment>>& segments,
+                         const QHash<QByteArray, QVector<IndexPosting>>& pending,
+                         const QHash<quint32, QByteArray>& pendingTexts,
+                         const QHash<quint32, DocInfo>& documents, double averageLength,
+                         const Tokenizer& tokenizer, TopDocuments& top) const {
+        const bool narrowing = recent.complete && recent.version == version && refines(recent.parsed, parsed);
+
+        // A prefix stands for its commonest terms. The dictionary range of a
+        // shorter prefix from the last query bounds the search for a longer one.
+        QHash<QByteArray, QVector<QPair<std::weak_ptr<IndexSegment>, QPair<int, int>>>> ranges;
+        for (QueryUnit& unit : parsed.units) {
+            if (!unit.prefix) continue;
+            QByteArray shorter;
+            for (auto it = recent.ranges.constBegin(); it != recent.ranges.constEnd(); ++it) {
+                if (unit.text.startsWith(it.key()) && it.key().size() >= shorter.size()) shorter = it.key();
+            }
+            const auto known = recent.ranges.constFind(shorter);
+            QHash<QByteArray, int> frequencies;
+            auto& unitRanges = ranges[unit.text];
+            for (const auto& segment : segments) {
+                int from = 0;
+                int to = -1;
+                if (known != recent.ranges.constEnd()) {
+                    for (const auto& range : *known) {
+                        if (range.first.lock() != segment) continue;
+                        from = range.second.first;
+                        to = range.second.second;
+                        break;
+                    }
+                }
+                const QPair<int, int> range = segment->prefixRange(unit.text, from, to);
+                unitRanges.append(qMakePair(std::weak_ptr<IndexSegment>(segment), range));
+                for (int i = range.first; i < range.second; ++i) frequencies[segment->termAt(i)] += segment->docFreqAt(i);
+            }
+            for (auto it = pending.constBegin(); it != pending.constEnd(); ++it) {
+                if (it.key().startsWith(unit.text)) frequencies[it.key()] += it->size(); // Pages, near enough
+            }
+
+            QVector<QPair<int, QByteArray>> ranked;
+            for (auto it = frequencies.constBegin(); it != frequencies.constEnd(); ++it) ranked.append(qMakePair(-it.value(), it.key()));
+            std::sort(ranked.begin(), ranked.end()); // Commonest first, then in byte order
+            unit.truncated = ranked.size() > MaxPrefixTerms;
+            unit.terms.clear();
+            for (int i = 0; i < qMin(ranked.size(), MaxPrefixTerms); ++i) {
+                unit.terms.append(QByteArray(ranked[i].second.constData(), ranked[i].second.size())); // Off the mapping
+            }
+        }
+
+        // Per source, then per unit, the merged lists of the unit's terms
+        QHash<QByteArray, BufferedList> buffered;
+        for (const QueryUnit& unit : parsed.units) {
+            for (const QByteArray& term : unit.terms) {
+                const auto postings = pending.constFind(term);
+                if (postings != pending.constEnd() && !postings->isEmpty() && !buffered.contains(term)) buffered.insert(term, bufferedList(*postings));
+            }
+        }
+        const int unitCount = parsed.units.size();
+        std::vector<std::vector<UnitIterator>> sources(size_t(segments.size() + 1), std::vector<UnitIterator>(size_t(unitCount)));
+        QVector<int> docFreqs(unitCount, 0);
+        for (int source = 0; source <= segments.size(); ++source) {
+            for (int u = 0; u < unitCount; ++u) {
+                UnitIterator& iterator = sources[size_t(source)][size_t(u)];
+                const QVector<QByteArray>& terms = parsed.units[u].terms;
+                for (int m = 0; m < terms.size(); ++m) {
+                    if (source < segments.size()) {
+                        const IndexSegment::Cursor cursor = segments[source]->cursor(terms[m]);
+                        if (cursor.isValid()) iterator.add(TermIterator(cursor, m), cursor.docFreq());
+                    } else {
+                        const auto list = buffered.constFind(terms[m]);
+                        if (list != buffered.constEnd()) iterator.add(TermIterator(&*list, m), list->docs.size());
+                    }
+                }
+                docFreqs[u] += iterator.size();
+            }
+        }
+        QVector<double> idf(unitCount);
+        for (int u = 0; u < unitCount; ++u) idf[u] = inverseFrequency(qMin(docFreqs[u], qMax(1, documents.size())), documents.size());
+
+        BufferedList previous;
+        if (narrowing) previous.docs = recent.matches;
+        QVector<quint32> matches;
+        bool overflow = false;
+        for (int source = 0; source <= segments.size(); ++source) {
+            std::vector<UnitIterator>& iterators = sources[size_t(source)];
+            if (std::any_of(iterators.cbegin(), iterators.cend(), [](const UnitIterator& iterator) { return iterator.isEmpty(); })) continue;
+
+            // Leapfrog from the shortest list; the last query's matches are shorter still
+            UnitIterator filter;
+            std::vector<UnitIterator*> legs;
+            if (narrowing) {
+                filter.add(TermIterator(&previous, 0), previous.docs.size());
+                legs.push_back(&filter);
+            }
+            for (UnitIterator& iterator : iterators) legs.push_back(&iterator);
+            std::sort(legs.begin() + (narrowing ? 1 : 0), legs.end(), [](const UnitIterator* a, const UnitIterator* b) { return a->size() < b->size(); });
+
+            auto pageText = [&](quint32 docId, quint32 page) {
+                return source < segments.size() ? segments[source]->pageText(docId, page)
+                                                : IndexSegment::unpackPageText(pendingTexts.value(docId), page);
+            };
+            quint32 target = legs[0]->doc();
+            while (target != NoDocument) {
+                bool agreed = true;
+                for (size_t i = 1; i < legs.size(); ++i) {
+                    legs[i]->advanceTo(target);
+                    if (legs[i]->doc() != target) {
+                        target = legs[i]->doc();
+                        agreed = false;
+                        break;
+                    }
+                }
+                if (target == NoDocument) break;
+                if (!agreed) {
+                    legs[0]->advanceTo(target);
+                    target = legs[0]->doc();
+                    continue;
+                }
+
+                const auto info = documents.constFind(target);
+                if (info != documents.constEnd()) {
+                    ScoredDocument document;
+                    document.docId = target;
+                    for (int u = 0; u < unitCount; ++u) {
+                        int term = 0;
+                        const IndexDocStats stats = iterators[size_t(u)].stats(&term);
+                        addScore(document, u, idf[u], stats, info->length, averageLength);
+                        if (document.token == u) document.term = term;
+                    }
+                    // A phrase's place is the hit shown
+                    bool found = true;
+                    const quint32 docId = target;
+                    for (int p = 0; p < parsed.phrases.size() && found; ++p) {
+                        quint32 page = 0;
+                        quint32 offset = 0;
+                        found = findPhrase(parsed, parsed.phrases[p], iterators,
+                                           [&](quint32 candidate) { return pageText(docId, candidate); }, tokenizer, &page, &offset);
+                        if (found && p == 0) {
+                            document.page = page;
+                            document.offset = offset;
+                            document.token = unitCount;
+                            document.term = 0;
+                        }
+                    }
+                    if (found) {
+                        top.offer(document);
+                        if (matches.size() < MaxRememberedMatches) matches.append(target);
+                        else overflow = true;
+                    }
+                }
+                legs[0]->next();
+                target = legs[0]->doc();
+            }
+        }
+
+        std::sort(matches.begin(), matches.end()); // Segments interleave their ids
+        QMutexLocker locker(&mutex);
+        if (version != contentVersion) return; // Outdated already
+        recentQuery.parsed = parsed;
+        recentQuery.matches = overflow ? QVector<quint32>() : matches;
+        recentQuery.complete = !overflow;
+        recentQuery.version = version;
+        recentQuery.ranges = ranges;
+    }
+
+    // Runs on an I/O worker over segments nobody writes to
+    static std::shared_ptr<IndexSegment> mergeSegments(const QList<std::shared_ptr<IndexSegment>>& inputs,
+                                                       const QSet<quint32>& removed, const QString& path, QString* error) {
+        IndexSegmentWriter writer(path);
+        QVector<int> cursors(inputs.size(), 0);
+        QVector<IndexPosting> merged;
+        for (;;) {
+            // Each dictionary is sorted, so the least current term is next
+            QByteArray term;
+            bool found = false;
+            for (int i = 0; i < inputs.size(); ++i) {
+                if (cursors[i] >= inputs[i]->termCount()) continue;
+                const QByteArray candidate = inputs[i]->termAt(cursors[i]);
+                if (!found || candidate < term) {
+                    term = candidate;
+                    found = true;
+                }
+            }
+            if (!found) break;
+            term = QByteArray(term.constData(), term.size()); // Outlives the cursor it came from
+
+            // Inputs are in order of their first document, so the lists
+            // usually just follow each other; bulk segments can overlap
+            merged.clear();
+            bool ordered = true;
+            for (int i = 0; i < inputs.size(); ++i) {
+                if (cursors[i] >= inputs[i]->termCount() || inputs[i]->termAt(cursors[i]) != term) continue;
+                for (const IndexPosting& posting : inputs[i]->postingsAt(cursors[i])) {
+                    if (removed.contains(posting.docId)) continue;
+                    if (!merged.isEmpty() && merged.last().docId > posting.docId) ordered = false;
+                    merged.append(posting);
+                }
+                ++cursors[i];
+            }
+            if (!ordered) {
+                std::stable_sort(merged.begin(), merged.end(), [](const IndexPosting& a, const IndexPosting& b) {
+                    return a.docId < b.docId; // Pages of one document come from one input, already in order
+                });
+            }
+            if (!writer.addTerm(term, merged.constData(), merged.size())) break;
+        }
+
+        // Documents must be in id order too; their text is copied still compressed
+        QVector<QPair<const IndexSegmentDocument*, QByteArray>> documents;
+        for (const auto& input : inputs) {
+            for (int i = 0; i < input->documents().size(); ++i) {
+                const IndexSegmentDocument& document = input->documents()[i];
+                if (!removed.contains(document.docId)) documents.append(qMakePair(&document, input->textChunk(i)));
+            }
+        }
+        if (documents.isEmpty()) return nullptr; // Everything was removed; no segment is needed
+        std::sort(documents.begin(), documents.end(), [](const QPair<const IndexSegmentDocument*, QByteArray>& a,
+                                                         const QPair<const IndexSegmentDocument*, QByteArray>& b) {
+            return a.first->docId < b.first->docId;
+        });
+        for (const auto& document : documents) writer.addDocument(*document.first, document.second);
+        return writer.finish(error) ? IndexSegment::open(path, error) : nullptr;
+    }
+
+    void finishMerge(const QList<std::shared_ptr<IndexSegment>>& inputs, const QSet<quint32>& removed,
+                     const std::shared_ptr<IndexSegment>& merged, const QString& path, quint64 mergeGeneration,
+                     const QString& error) {
+        QMutexLocker locker(&mutex);
+        merging = false;
+        workDone.wakeAll(); // The destructor waits until the lock is released
+        if (mergeGeneration != generation || (!merged && !error.isEmpty())) {
+            if (!error.isEmpty()) LOG_ERROR("FullTextIndex: Merge failed: " << error);
+            IndexSegment::removeFiles(path);
+            return;
+        }
+
+        // Segments committed during the merge came after the inputs
+        QList<std::shared_ptr<IndexSegment>> replaced;
+        if (merged) replaced.append(merged);
+        replaced.append(segments.mid(inputs.size()));
+        segments = replaced;
+        deleted.subtract(removed);
+        writeManifest();
+        for (const auto& input : inputs) IndexSegment::removeFiles(input->filePath()); // Mappings in use stay valid
+        LOG_INFO("FullTextIndex: Merged " << inputs.size() << " segments, dropped " << removed.size() << " removed documents.");
+        FullTextIndex* index = q;
+        QMetaObject::invokeMethod(index, [index]() { emit index->indexOptimized(); }, Qt::QueuedConnection);
     }
 };
 
@@ -109,6 +1528,12 @@ FullTextIndex::FullTextIndex(QObject* parent)
 
 FullTextIndex::~FullTextIndex()
 {
+    QMutexLocker locker(&d->mutex);
+    d->stopping = true;
+    while (d->merging || d->bulkWorkers > 0) {
+        d->workDone.wait(&d->mutex);
+    }
+    if (d->ready) d->flushPending();
     LOG_INFO("FullTextIndex destroyed.");
 }
 
@@ -116,13 +1541,32 @@ bool FullTextIndex::initialize(const QString& indexPath)
 {
     QMutexLocker locker(&d->mutex);
 
-    // For a basic in-memory index, initialization just means setting the path and marking ready.
-    // For a disk-based index (Lucene/Xapian/SQLite), this would open the database/index files.
+    if (d->ready) {
+        LOG_WARN("FullTextIndex::initialize: Already initialized.");
+        return true;
+    }
+
     d->indexPathStr = indexPath.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/search_index" : indexPath;
-    QDir().mkpath(d->indexPathStr); // Ensure directory exists if using disk storage later
+    if (!QDir().mkpath(d->indexPathStr)) {
+        LOG_ERROR("FullTextIndex: Cannot create index directory " << d->indexPathStr);
+        return false;
+    }
+    d->tokenizer = Private::configuredTokenizer(); // Unless the manifest says otherwise
+    d->loadManifest();
 
     d->ready = true;
-    LOG_INFO("FullTextIndex: Initialized at path: " << d->indexPathStr);
+    d->watching = Settings::instance().value<bool>("Advanced/FullTextWatchFiles", true);
+    d->queryCacheCapacity = Settings::instance().value<int>("Advanced/FullTextQueryCache", 64);
+    LOG_INFO("FullTextIndex: Initialized at path: " << d->indexPathStr << " (" << d->segments.size()
+             << " segments, " << d->docs.size() << " documents)");
+    const bool watching = d->watching;
+    locker.unlock();
+
+    // Catch up on changes made while nothing was watching
+    if (watching) {
+        d->requestWatchSync();
+        d->startRescan(QSet<QString>());
+    }
     return true;
 }
 
@@ -135,32 +1579,7 @@ bool FullTextIndex::isReady() const
 bool FullTextIndex::addDocument(Document* document)
 {
     if (!isReady() || !document) return false;
-
-    QMutexLocker locker(&d->mutex);
-
-    // Check if already indexed
-    if (d->indexedDocuments.contains(document)) {
-        LOG_WARN("FullTextIndex: Document '" << document->title() << "' is already indexed.");
-        return true; // Or maybe call updateDocument instead?
-    }
-
-    emit indexingStarted(document);
-
-    // Get full text from document. This might involve calling OCR if text is not available.
-    // For now, assume Document has a method to get all text from all pages.
-    // QString fullText = document->getAllText(); // Hypothetical method
-
-    // For this basic example, let's assume we have the text.
-    // In a real implementation, you'd iterate pages, get text (potentially via OCRPage),
-    // and concatenate it.
-    QString fullText = "Sample text content from document " + document->title(); // Placeholder
-
-    d->indexDocumentText(document, fullText);
-
-    emit indexingFinished(document, true);
-    emit indexContentChanged();
-    LOG_DEBUG("FullTextIndex: Added document '" << document->title() << "' to index.");
-    return true;
+    return d->addOrReplace(document, false);
 }
 
 bool FullTextIndex::removeDocument(Document* document)
@@ -169,27 +1588,17 @@ bool FullTextIndex::removeDocument(Document* document)
 
     QMutexLocker locker(&d->mutex);
 
-    if (!d->indexedDocuments.contains(document)) {
+    const auto it = d->docIdByPath.constFind(document->filePath());
+    if (it == d->docIdByPath.constEnd()) {
         LOG_WARN("FullTextIndex: Attempted to remove non-indexed document '" << document->title() << "'");
         return false;
     }
 
-    // Remove from docIndex
-    d->docIndex.remove(document);
-
-    // Remove from wordToDocs (iterate and remove entries pointing to this doc)
-    auto it = d->wordToDocs.begin();
-    while (it != d->wordToDocs.end()) {
-        if (it.value() == document) {
-            it = d->wordToDocs.erase(it);
-        } else {
-            ++it;
-        }
-    }
-
-    // Remove from set
-    d->indexedDocuments.remove(document);
+    // Postings stay in their segment, masked, until a merge drops them
+    d->tombstone(*it);
 
+    locker.unlock();
+    d->requestWatchSync();
     emit indexContentChanged();
     LOG_DEBUG("FullTextIndex: Removed document '" << document->title() << "' from index.");
     return true;
@@ -197,84 +1606,314 @@ bool FullTextIndex::removeDocument(Document* document)
 
 bool FullTextIndex::updateDocument(Document* document)
 {
-    // For a basic index, updating means removing and re-adding.
-    // More sophisticated indexes might have incremental update mechanisms.
-    bool removed = removeDocument(document);
-    if (removed) {
-        return addDocument(document);
+    if (!isReady() || !document) return false;
+    return d->addOrReplace(document, true);
+}
+
+bool FullTextIndex::indexText(Document* document, const QStringList& pageTexts)
+{
+    if (!isReady() || !document) return false;
+    bool indexed;
+    {
+        QMutexLocker locker(&d->mutex);
+        indexed = d->docIdByPath.contains(document->filePath());
     }
-    return false;
+    return d->addOrReplace(document, indexed, &pageTexts);
 }
 
 QList<SearchResult> FullTextIndex::query(const QString& query, int maxResults, int contextLength) const
 {
     if (!isReady() || query.isEmpty()) return {};
 
-    QMutexLocker locker(&d->mutex);
-
+    TRACE_ZONE("FullTextIndex::query");
+    LatencyHistogram::Scope latency(d->queryLatency);
     emit queryStarted();
 
-    QStringList queryTokens = d->tokenizeText(query);
-    QList<SearchResult> results;
-    QHash<Document*, int> docScores; // Document -> Score (number of query terms matched)
+    const QString key = Private::queryKey(query, maxResults, contextLength);
+    {
+        QMutexLocker locker(&d->mutex);
+        QList<SearchResult> cached;
+        if (d->cachedResults(key, &cached)) {
+            locker.unlock();
+            emit queryFinished(cached);
+            LOG_DEBUG("FullTextIndex: Query '" << query << "' answered from the cache.");
+            return cached;
+        }
+    }
 
-    // Simple scoring: count matching terms
-    for (const QString& token : queryTokens) {
-        auto range = d->wordToDocs.equal_range(token);
-        for (auto it = range.first; it != range.second; ++it) {
-            Document* doc = it.value();
-            docScores[doc]++;
+    const Tokenizer tokenizer = d->currentTokenizer();
+    ParsedQuery parsed = parseQuery(query, tokenizer);
+    const bool structured = parsed.isStructured();
+
+    // The segments are immutable; only the buffer needs the lock
+    QList<std::shared_ptr<IndexSegment>> segments;
+    QHash<QByteArray, QVector<IndexPosting>> pending;
+    QHash<quint32, QByteArray> pendingTexts;
+    QHash<quint32, Private::DocInfo> documents;
+    quint64 totalLength = 0;
+    quint64 version = 0;
+    Private::RecentQuery recent;
+    {
+        QMutexLocker locker(&d->mutex);
+        segments = d->segments;
+        for (const QueryUnit& unit : parsed.units) {
+            if (!unit.prefix) {
+                pending.insert(unit.text, d->pendingTerms.value(unit.text));
+                continue;
+            }
+            for (auto it = d->pendingTerms.constBegin(); it != d->pendingTerms.constEnd(); ++it) {
+                if (it.key().startsWith(unit.text)) pending.insert(it.key(), it.value());
+            }
         }
+        if (structured) {
+            pendingTexts = d->pendingTexts;
+            recent = d->recentQuery;
+        }
+        documents = d->docs;
+        totalLength = d->totalLength;
+        version = d->contentVersion;
     }
+    const int documentTotal = documents.size();
 
-    // Sort documents by score (descending)
-    QList<QPair<Document*, int>> scoredDocs = docScores.toList();
-    std::sort(scoredDocs.begin(), scoredDocs.end(), [](const QPair<Document*, int>& a, const QPair<Document*, int>& b) {
-        return a.second > b.second; // Higher score first
-    });
+    // What each token stands for in results; phrases come after the units
+    QVector<QVector<QByteArray>> labels;
+    QList<QByteArray> queryTokens;
+    QVector<BufferedList> buffered;
+    TopDocuments top(maxResults);
+
+    // BM25 over the documents not removed at the snapshot
+    const double averageLength = documents.isEmpty() ? 1.0 : qMax(1.0, double(totalLength) / documents.size());
+    if (structured) {
+        d->queryStructured(parsed, recent, version, segments, pending, pendingTexts, documents, averageLength, tokenizer, top);
+        for (const QueryUnit& unit : parsed.units) labels.append(unit.terms);
+        for (const QVector<int>& phrase : parsed.phrases) {
+            QByteArray text;
+            for (int unit : phrase) text += (text.isEmpty() ? QByteArray() : QByteArray(" ")) + parsed.units[unit].text;
+            labels.append(QVector<QByteArray>{text});
+        }
+    } else {
+        for (const QueryUnit& unit : parsed.units) {
+            queryTokens.append(unit.text);
+            labels.append(QVector<QByteArray>{unit.text});
+        }
+        // The buffer, per token, in the shape of a segment's posting list
+        for (const QByteArray& token : queryTokens) buffered.append(bufferedList(pending.value(token)));
+    }
 
-    // Extract text snippets for top results
-    int count = 0;
-    for (const auto& pair : scoredDocs) {
-        if (count >= maxResults) break;
+    QVector<double> idf(queryTokens.size(), 0.0);
+    bool allPresent = !queryTokens.isEmpty();
+    for (int t = 0; t < queryTokens.size(); ++t) {
+        int docFreq = buffered[t].docs.size();
+        for (const auto& segment : segments) docFreq += segment->cursor(queryTokens[t]).docFreq();
+        if (docFreq == 0) allPresent = false;
+        else idf[t] = inverseFrequency(docFreq, documentTotal);
+    }
+    // Shortest possible document, so the bound holds for any length
+    auto bound = [&idf](int t, quint32 maxFreq) {
+        const double tf = double(maxFreq);
+        return idf[t] * tf * (Bm25K1 + 1.0) / (tf + Bm25K1 * (1.0 - Bm25B));
+    };
+    auto score = [&idf, averageLength](ScoredDocument& document, int t, const IndexDocStats& stats, quint32 length) {
+        addScore(document, t, idf[t], stats, length, averageLength);
+    };
 
-        Document* doc = pair.first;
-        const IndexedDocumentData& data = d->docIndex[doc]; // Safe because docScores came from wordToDocs
+    // Documents with every term. Each segment holds its own documents, so
+    // they are intersected segment by segment, rarest term first, a block of
+    // the rarest term's ids at a time; skip tables pass over the blocks of
+    // the other terms that cannot match, and a block whose best possible
+    // score cannot enter the top results is not intersected at all.
+    if (allPresent && queryTokens.size() > 1) {
+        QVector<int> order(queryTokens.size());
+        quint32 candidates[IndexSegment::BlockSize];
+        quint32 scratch[IndexSegment::BlockSize];
+        for (const auto& segment : segments) {
+            QVector<IndexSegment::Cursor> cursors;
+            for (const QByteArray& token : queryTokens) cursors.append(segment->cursor(token));
+            if (std::any_of(cursors.cbegin(), cursors.cend(), [](const IndexSegment::Cursor& c) { return !c.isValid(); })) continue;
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&cursors](int a, int b) { return cursors[a].docFreq() < cursors[b].docFreq(); });
+            double othersBound = 0.0;
+            for (int o = 1; o < order.size(); ++o) othersBound += bound(order[o], cursors[order[o]].maxFreq());
 
-        // Find the first occurrence of any query token in the document's text
-        int bestPos = -1;
-        QString bestMatch;
-        for (const QString& token : queryTokens) {
-            int pos = data.fullText.indexOf(token, 0, Qt::CaseInsensitive);
-            if (pos != -1 && (bestPos == -1 || pos < bestPos)) {
-                bestPos = pos;
-                bestMatch = token;
+            QVector<IndexSegment::Cursor> statistics = cursors;
+            bool exhausted = false;
+            for (IndexSegment::Cursor& lead = cursors[order[0]]; !lead.atEnd() && !exhausted; lead.nextBlock()) {
+                if (top.isFull() && bound(order[0], lead.blockMaxFreq()) + othersBound <= top.threshold()) continue;
+                int count = lead.docCount();
+                std::copy(lead.docs(), lead.docs() + count, candidates);
+                for (int o = 1; o < order.size() && count > 0; ++o) {
+                    IndexSegment::Cursor& other = cursors[order[o]];
+                    if (!other.skipTo(candidates[0])) {
+                        exhausted = true; // No later document can have this term
+                        count = 0;
+                        break;
+                    }
+                    int kept = 0;
+                    while (!other.atEnd() && other.docs()[0] <= candidates[count - 1]) {
+                        kept += IndexSegment::intersect(candidates, count, other.docs(), other.docCount(), scratch + kept);
+                        if (other.lastDoc() >= candidates[count - 1]) break;
+                        other.nextBlock();
+                    }
+                    std::copy(scratch, scratch + kept, candidates);
+                    count = kept;
+                }
+                // Statistics only for the documents that matched, from cursors of their own
+                for (int i = 0; i < count; ++i) {
+                    const auto info = documents.constFind(candidates[i]);
+                    if (info == documents.constEnd()) continue;
+                    ScoredDocument document;
+                    document.docId = candidates[i];
+                    for (int t = 0; t < queryTokens.size(); ++t) {
+                        IndexSegment::Cursor& cursor = statistics[t];
+                        cursor.skipTo(candidates[i]);
+                        const quint32* position = std::lower_bound(cursor.docs(), cursor.docs() + cursor.docCount(), candidates[i]);
+                        score(document, t, cursor.stats()[position - cursor.docs()], info->length);
+                    }
+                    top.offer(document);
+                }
             }
         }
 
-        if (bestPos != -1) {
-            // Extract context
-            int start = qMax(0, bestPos - contextLength / 2);
-            int end = qMin(data.fullText.size(), bestPos + bestMatch.size() + contextLength / 2);
-            QString context = data.fullText.mid(start, end - start);
+        QVector<int> bufferOrder(queryTokens.size());
+        std::iota(bufferOrder.begin(), bufferOrder.end(), 0);
+        std::sort(bufferOrder.begin(), bufferOrder.end(), [&buffered](int a, int b) { return buffered[a].docs.size() < buffered[b].docs.size(); });
+        QVector<quint32> common = buffered[bufferOrder[0]].docs;
+        QVector<quint32> next(common.size());
+        for (int o = 1; o < bufferOrder.size() && !common.isEmpty(); ++o) {
+            const QVector<quint32>& docs = buffered[bufferOrder[o]].docs;
+            common.resize(IndexSegment::intersect(common.constData(), common.size(), docs.constData(), docs.size(), next.data()));
+            std::copy(next.constBegin(), next.constBegin() + common.size(), common.begin());
+        }
+        for (quint32 docId : common) {
+            const auto info = documents.constFind(docId);
+            if (info == documents.constEnd()) continue;
+            ScoredDocument document;
+            document.docId = docId;
+            for (int t = 0; t < queryTokens.size(); ++t) {
+                const BufferedList& list = buffered[t];
+                score(document, t, list.stats[int(std::lower_bound(list.docs.constBegin(), list.docs.constEnd(), docId) - list.docs.constBegin())], info->length);
+            }
+            top.offer(document);
+        }
+    }
 
-            SearchResult result;
-            result.document = doc;
-            result.pageIndex = -1; // Not page-specific in this basic example
-            result.text = bestMatch;
-            result.context = context;
-            result.score = pair.second; // Use the count of matched terms as score
+    // Without a document holding every term, rank those holding some of
+    // them with MaxScore: terms are ordered by the most they can add, and
+    // once the weakest ones together cannot lift a document into the top
+    // results, only documents with a stronger term are visited.
+    if (top.isEmpty() && !structured) {
+        for (int source = 0; source <= segments.size(); ++source) {
+            std::vector<TermIterator> terms;
+            for (int t = 0; t < queryTokens.size(); ++t) {
+                if (idf[t] == 0.0) continue;
+                if (source < segments.size()) {
+                    const IndexSegment::Cursor cursor = segments[source]->cursor(queryTokens[t]);
+                    if (cursor.isValid()) terms.emplace_back(cursor, t);
+                } else if (!buffered[t].docs.isEmpty()) {
+                    terms.emplace_back(&buffered[t], t);
+                }
+            }
+            for (TermIterator& term : terms) term.setBound(bound(term.token(), term.maxFreq()));
+            std::sort(terms.begin(), terms.end(), [](const TermIterator& a, const TermIterator& b) { return a.bound() < b.bound(); });
+            QVector<double> upTo(int(terms.size())); // Bound of terms 0..i together
+            for (int i = 0; i < int(terms.size()); ++i) upTo[i] = terms[i].bound() + (i > 0 ? upTo[i - 1] : 0.0);
+
+            for (;;) {
+                const double threshold = top.threshold();
+                int essential = 0;
+                while (essential < int(terms.size()) && top.isFull() && upTo[essential] <= threshold) ++essential;
+                if (essential == int(terms.size())) break;
+
+                quint32 docId = NoDocument;
+                for (int i = essential; i < int(terms.size()); ++i) docId = qMin(docId, terms[i].doc());
+                if (docId == NoDocument) break;
+
+                const auto info = documents.constFind(docId);
+                ScoredDocument document;
+                document.docId = docId;
+                for (int i = essential; i < int(terms.size()); ++i) {
+                    if (terms[i].doc() != docId) continue;
+                    if (info != documents.constEnd()) score(document, terms[i].token(), terms[i].stats(), info->length);
+                    terms[i].next();
+                }
+                if (info == documents.constEnd()) continue; // Removed
+                for (int i = essential - 1; i >= 0; --i) {
+                    if (document.score + upTo[i] <= threshold) break;
+                    terms[i].advanceTo(docId);
+                    if (terms[i].doc() == docId) score(document, terms[i].token(), terms[i].stats(), info->length);
+                }
+                top.offer(document);
+            }
+        }
+    }
 
+    const QVector<ScoredDocument> ranked = top.sorted();
+
+    QList<SearchResult> results;
+    QList<QPointer<Document>> sources;
+    QVector<ScoredDocument> kept;
+    QVector<QByteArray> bufferedTexts;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (const ScoredDocument& hit : ranked) {
+            const auto info = d->docs.constFind(hit.docId);
+            if (info == d->docs.constEnd()) continue; // Removed since the snapshot
+            SearchResult result;
+            result.document = nullptr;
+            result.filePath = info->filePath;
+            result.pageIndex = int(hit.page);
+            result.text = QString::fromUtf8(labels[hit.token].value(hit.term));
+            result.score = float(hit.score);
             results.append(result);
-            count++;
+            sources.append(d->openDocuments.value(hit.docId));
+            kept.append(hit);
+            bufferedTexts.append(d->pendingTexts.value(hit.docId));
         }
     }
 
+    // The context comes from the page text stored at indexing, which the
+    // offsets refer to; only the one page is decompressed
+    for (int i = 0; i < results.size(); ++i) {
+        SearchResult& result = results[i];
+        result.document = sources[i].data();
+        QString text;
+        if (!bufferedTexts[i].isEmpty()) {
+            text = IndexSegment::unpackPageText(bufferedTexts[i], kept[i].page);
+        } else {
+            for (const auto& segment : segments) {
+                text = segment->pageText(kept[i].docId, kept[i].page);
+                if (!text.isEmpty()) break;
+            }
+        }
+        if (text.isEmpty()) continue;
+        const int position = qMin(int(kept[i].offset), text.size());
+        const int start = qMax(0, position - contextLength / 2);
+        const int end = qMin(text.size(), position + result.text.size() + contextLength / 2);
+        result.context = text.mid(start, end - start);
+    }
+
+    {
+        QMutexLocker locker(&d->mutex);
+        d->cacheResults(key, results, version);
+    }
+
     emit queryFinished(results);
     LOG_DEBUG("FullTextIndex: Query '" << query << "' returned " << results.size() << " results.");
     return results;
 }
 
+QList<SearchResult> FullTextIndex::queryAsYouType(const QString& text, int maxResults, int contextLength) const
+{
+    // The word being typed is a prefix, unless it is finished or in a phrase
+    QString query = text;
+    const bool inPhrase = text.count(QLatin1Char('"')) % 2 == 1;
+    if (!query.isEmpty() && !query.at(query.size() - 1).isSpace() && !inPhrase
+        && !query.endsWith(QLatin1Char('*')) && !query.endsWith(QLatin1Char('"'))) {
+        query += QLatin1Char('*');
+    }
+    return this->query(query, maxResults, contextLength);
+}
+
 QFuture<QList<SearchResult>> FullTextIndex::queryAsync(const QString& query, int maxResults, int contextLength) const
 {
     // Use QtConcurrent to run the query in a separate thread
@@ -283,45 +1922,152 @@ QFuture<QList<SearchResult>> FullTextIndex::queryAsync(const QString& query, int
     });
 }
 
+double FullTextIndex::scoreText(const QString& query, const QStringList& pageTexts,
+                                int* firstPage, int* firstOffset) const
+{
+    if (firstPage) *firstPage = -1;
+    if (firstOffset) *firstOffset = 0;
+    if (query.isEmpty()) return 0.0;
+
+    const Tokenizer tokenizer = d->currentTokenizer();
+    QHash<QByteArray, int> tokens; // Query token to its slot
+    tokenizer.tokenize(query, [&tokens](const QByteArray& term, int) {
+        if (!tokens.contains(term)) tokens.insert(term, tokens.size());
+    });
+    if (tokens.isEmpty()) return 0.0;
+
+    // Term frequencies and the document's first hit, as the index records them
+    QVector<IndexDocStats> stats(tokens.size(), IndexDocStats{0, 0, 0, 0});
+    quint32 length = 0;
+    int firstToken = -1;
+    for (int page = 0; page < pageTexts.size(); ++page) {
+        tokenizer.tokenize(pageTexts.at(page), [&](const QByteArray& term, int offset) {
+            ++length;
+            const auto it = tokens.constFind(term);
+            if (it == tokens.constEnd()) return;
+            IndexDocStats& entry = stats[it.value()];
+            if (entry.freq++ == 0) {
+                entry.firstPage = quint32(page);
+                entry.firstOffset = quint32(offset);
+            }
+            if (firstToken < 0) {
+                firstToken = it.value();
+                if (firstPage) *firstPage = page;
+                if (firstOffset) *firstOffset = offset;
+            }
+        });
+    }
+    if (firstToken < 0) return 0.0;
+
+    QVector<int> docFreqs(tokens.size(), 0);
+    int documentTotal;
+    double averageLength;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (auto it = tokens.constBegin(); it != tokens.constEnd(); ++it) {
+            int docFreq = bufferedList(d->pendingTerms.value(it.key())).docs.size();
+            for (const auto& segment : d->segments) docFreq += segment->cursor(it.key()).docFreq();
+            docFreqs[it.value()] = docFreq;
+        }
+        documentTotal = d->docs.size();
+        averageLength = d->docs.isEmpty() ? 1.0 : qMax(1.0, double(d->totalLength) / d->docs.size());
+    }
+
+    ScoredDocument document;
+    for (int t = 0; t < stats.size(); ++t) {
+        if (stats[t].freq == 0) continue;
+        addScore(document, t, inverseFrequency(docFreqs[t] + 1, documentTotal + 1), stats[t], length, averageLength);
+    }
+    return document.score;
+}
+
+bool FullTextIndex::isIndexed(const QString& filePath) const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->docIdByPath.contains(filePath);
+}
+
 int FullTextIndex::documentCount() const
 {
     QMutexLocker locker(&d->mutex);
-    return d->indexedDocuments.size();
+    return d->docs.size();
 }
 
 int FullTextIndex::termCount() const
 {
     QMutexLocker locker(&d->mutex);
-    // This is an approximation. A real index would store this count.
-    QSet<QString> uniqueTerms;
-    for (auto it = d->wordToDocs.begin(); it != d->wordToDocs.end(); ++it) {
-        uniqueTerms.insert(it.key());
-    }
-    return uniqueTerms.size();
+    qint64 total = d->pendingTerms.size();
+    for (const auto& segment : d->segments) total += segment->termCount();
+    return int(qMin<qint64>(total, std::numeric_limits<int>::max()));
+}
+
+const LatencyHistogram& FullTextIndex::queryLatency() const
+{
+    return d->queryLatency;
 }
 
 void FullTextIndex::commit()
 {
-    // For an in-memory index, commit might mean saving to disk.
-    // For a library-based index, this might flush pending writes.
-    LOG_DEBUG("FullTextIndex: Commit called (in-memory index, no-op for now).");
-    // Example disk save: serialize d->docIndex and d->wordToDocs to files
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) return;
+    if (d->flushPending()) {
+        LOG_DEBUG("FullTextIndex: Committed; " << d->segments.size() << " segments.");
+    }
 }
 
 void FullTextIndex::optimize()
 {
-    // Optimization depends on the underlying technology.
-    // For an in-memory index, perhaps compact data structures.
-    // For Lucene/Xapian, call their optimize/compact functions.
-    LOG_DEBUG("FullTextIndex: Optimize called (no-op for basic in-memory index).");
+    QMutexLocker locker(&d->mutex);
+    if (!d->ready) return;
+    if (d->merging) {
+        LOG_DEBUG("FullTextIndex: Optimize called while a merge is running.");
+        return;
+    }
+    if (!d->flushPending()) return;
+    if (d->segments.size() < 2 && d->deleted.isEmpty()) return; // Already one clean segment
+
+    // The merge reads a snapshot; commits during it add segments after it
+    QList<std::shared_ptr<IndexSegment>> inputs = d->segments;
+    std::stable_sort(inputs.begin(), inputs.end(), [](const std::shared_ptr<IndexSegment>& a, const std::shared_ptr<IndexSegment>& b) {
+        const quint32 first = a->documents().isEmpty() ? 0 : a->documents().first().docId;
+        return first < (b->documents().isEmpty() ? 0 : b->documents().first().docId);
+    });
+    const QSet<quint32> removed = d->deleted;
+    const QString path = d->newSegmentPath();
+    const quint64 generation = d->generation;
+    d->merging = true;
+    Private* priv = d.get();
+    ThreadPool::ioInstance().submitDetached([priv, inputs, removed, path, generation]() {
+        QString error;
+        const std::shared_ptr<IndexSegment> merged = Private::mergeSegments(inputs, removed, path, &error);
+        priv->finishMerge(inputs, removed, merged, path, generation, error);
+    }, Task::Priority::Low);
+    LOG_DEBUG("FullTextIndex: Merging " << inputs.size() << " segments in the background.");
 }
 
 void FullTextIndex::clear()
 {
     QMutexLocker locker(&d->mutex);
-    d->docIndex.clear();
-    d->wordToDocs.clear();
-    d->indexedDocuments.clear();
+    ++d->generation;
+    for (const auto& segment : d->segments) IndexSegment::removeFiles(segment->filePath());
+    d->segments.clear();
+    d->pendingTerms.clear();
+    d->pendingDocs.clear();
+    d->pendingTexts.clear();
+    d->pendingBytes = 0;
+    d->deleted.clear();
+    d->docs.clear();
+    d->totalLength = 0;
+    d->docIdByPath.clear();
+    d->openDocuments.clear();
+    d->touched.clear();
+    ++d->contentVersion;
+    d->queryCache.clear();
+    d->queryLru.clear();
+    d->tokenizer = Private::configuredTokenizer(); // Nothing is indexed with the old setting any more
+    if (d->ready) d->writeManifest();
+    locker.unlock();
+    d->requestWatchSync();
     emit indexContentChanged();
     LOG_DEBUG("FullTextIndex: Cleared all indexed data.");
 }
@@ -332,4 +2078,4 @@ QString FullTextIndex::indexPath() const
     return d->indexPathStr;
 }
 
-} // namespace QuantilyxDoc
\ No newline at end of file
+} // namespace QuantilyxDoc
@@ -17,19 +17,22 @@
 #include <QSet>
 #include <QMutex>
 #include <QFuture>
+#include <QStringList>
 #include <memory>
 #include <functional>
 
 namespace QuantilyxDoc {
 
 class Document; // Forward declaration
+class LatencyHistogram;
 
 /**
  * @brief Structure holding information about a search result hit.
  */
 struct SearchResult {
-    Document* document;     // Pointer to the document containing the hit
-    int pageIndex;          // Page index where the hit occurred (-1 if not page-specific)
+    Document* document;     // Pointer to the document containing the hit, null if it is not open
+    QString filePath;       // Path of the document containing the hit
+    int pageIndex;          // Page index of the first hit in the document
     QString text;           // The matching text snippet
     QString context;        // Context surrounding the match
     float score;            // Relevance score (higher is more relevant)
@@ -39,7 +42,26 @@ struct SearchResult {
 /**
  * @brief Builds and queries a full-text search index across multiple documents.
  * 
- * Uses an underlying indexing library (e.g., CLucene, Xapian, SQLite FTS) or a custom implementation.
+ * The index lives in segment files under indexPath(), each a sorted term
+ * dictionary with per-page posting lists (see IndexSegment), listed in a
+ * segments.json manifest. Segments are memory-mapped at query time, so the
+ * corpus is not held in RAM. Postings record the page and offset of each
+ * hit, and each page's text is stored compressed beside its segment, so a
+ * result names its page and its context is cut from that page alone,
+ * whether or not the document is open. Added documents collect
+ * in a buffer bounded by Advanced/FullTextBufferMB until commit() writes
+ * it as a new segment; removed documents are masked until optimize()
+ * merges the segments in the background and drops them. Documents are
+ * identified by their file path. Text is split into terms by Tokenizer,
+ * with stemming if Advanced/FullTextStemming was on when the index was
+ * created or last cleared. indexFiles() indexes many files at once on
+ * parallel workers, each writing segments of its own.
+ *
+ * Each document keeps the size, modification time and content hash its
+ * file had when indexed. With Advanced/FullTextWatchFiles on, the
+ * directories of indexed files are watched: a file that is gone is masked
+ * like a removed document, and one whose size or time changed is loaded
+ * again only if its hash changed, and re-indexed only if its text did.
  */
 class FullTextIndex : public QObject
 {
@@ -84,6 +106,19 @@ public:
      */
     bool addDocument(Document* document);
 
+    /**
+     * @brief Index files in the background without opening them in the editor.
+     * The files are split between as many workers as the CPU pool has
+     * threads; each loads, extracts and tokenizes its share with no lock
+     * held and writes a segment whenever its own buffer fills, and the
+     * segments are merged once all are done. Files already indexed are
+     * skipped. Progress is reported by bulkIndexingProgress() and the end
+     * by bulkIndexingFinished().
+     * @param filePaths Files to index.
+     * @return Number of files queued.
+     */
+    int indexFiles(const QStringList& filePaths);
+
     /**
      * @brief Remove a document's content from the index.
      * @param document The document to remove from the index.
@@ -93,13 +128,48 @@ public:
 
     /**
      * @brief Update the index for a document if its content has changed.
+     * The document's text is extracted again; if it differs from the
+     * indexed text, the old version is masked and the new one added.
      * @param document The document to update in the index.
      * @return True if update was successful.
      */
     bool updateDocument(Document* document);
 
+    /**
+     * @brief Index a document with text obtained otherwise, such as by OCR.
+     * Adds the document, or re-indexes it if it is indexed and the text
+     * differs, as updateDocument() does, but with the given page text in
+     * place of the document's own.
+     * @param document The document the text belongs to.
+     * @param pageTexts Text of each page, in page order.
+     * @return True if indexing was successful.
+     */
+    bool indexText(Document* document, const QStringList& pageTexts);
+
+    /**
+     * @brief Check every indexed file in the background and catch up with the changes.
+     * Missing files are removed from the index and changed ones re-indexed
+     * as by indexFiles(). Runs by itself at initialization and, for the
+     * directories concerned, when a watched directory changes.
+     */
+    void refreshFiles();
+
     /**
      * @brief Query the index for a specific term or phrase.
+     * Documents containing every word of the query are returned, ranked by
+     * BM25; if there are none, documents containing some of the words are.
+     * Only the best maxResults are kept, and documents whose best possible
+     * score cannot reach them are skipped rather than scored.
+     *
+     * Words in double quotes must follow one another on a page, and a word
+     * ending in '*' matches the commonest indexed words it starts. Such
+     * queries only return documents matching all of their parts. Phrases are
+     * checked against the stored page text of the documents holding every
+     * word.
+     *
+     * The results of the last Advanced/FullTextQueryCache queries (64 by
+     * default) are kept and returned again for the same query and options
+     * until a document is added or removed.
      * @param query The search query string.
      * @param maxResults Maximum number of results to return.
      * @param contextLength Number of characters of context to include around the match.
@@ -107,6 +177,18 @@ public:
      */
     QList<SearchResult> query(const QString& query, int maxResults = 50, int contextLength = 100) const;
 
+    /**
+     * @brief Query the index for text being typed into a search box.
+     * The last word is a prefix unless the text ends in a space. When the
+     * text refines the previous such query, e.g. by one more letter, only
+     * that query's matches are visited.
+     * @param text The text typed so far.
+     * @param maxResults Maximum number of results to return.
+     * @param contextLength Number of characters of context to include around the match.
+     * @return List of search results.
+     */
+    QList<SearchResult> queryAsYouType(const QString& text, int maxResults = 20, int contextLength = 100) const;
+
     /**
      * @brief Query the index asynchronously.
      * @param query The search query string.
@@ -116,6 +198,28 @@ public:
      */
     QFuture<QList<SearchResult>> queryAsync(const QString& query, int maxResults = 50, int contextLength = 100) const;
 
+    /**
+     * @brief Score text that is not in the index as query() would score it.
+     * The index's term statistics are used, with the text counted as one
+     * more document, so a document searched live ranks on the same scale
+     * as indexed ones. Quotes and '*' are read as plain words. Before
+     * initialize(), every word counts as rare.
+     * @param query The search query string.
+     * @param pageTexts Text of each page.
+     * @param firstPage Set to the page of the first query word, or -1.
+     * @param firstOffset Set to the offset of that word in its page's text.
+     * @return BM25 score; 0 if no word of the query occurs.
+     */
+    double scoreText(const QString& query, const QStringList& pageTexts,
+                     int* firstPage = nullptr, int* firstOffset = nullptr) const;
+
+    /**
+     * @brief Check if a file is in the index.
+     * @param filePath Path of the document file.
+     * @return True if it was indexed and not removed since.
+     */
+    bool isIndexed(const QString& filePath) const;
+
     /**
      * @brief Get the total number of documents indexed.
      * @return Document count.
@@ -124,19 +228,28 @@ public:
 
     /**
      * @brief Get the total number of terms indexed.
+     * Terms present in several segments are counted once per segment
+     * until optimize() merges them.
      * @return Term count.
      */
     int termCount() const;
 
+    /**
+     * @brief Get how long queries took.
+     * @return Histogram of query() durations, cached answers included.
+     */
+    const LatencyHistogram& queryLatency() const;
+
     /**
      * @brief Commit pending changes to the index.
-     * Ensures all added/removed/updated documents are written to storage.
+     * Writes the buffered documents as a new segment and records removals.
      */
     void commit();
 
     /**
-     * @brief Optimize the index for performance.
-     * This might involve merging segments (in Lucene-like indexes) or rebuilding (in custom indexes).
+     * @brief Merge all segments into one in the background, dropping removed documents.
+     * Queries keep using the old segments until the merge is in place.
+     * Runs by itself once there are more than a few segments.
      */
     void optimize();
 
@@ -181,11 +294,33 @@ signals:
      */
     void indexContentChanged();
 
+    /**
+     * @brief Emitted when a background merge started by optimize() is in place.
+     */
+    void indexOptimized();
+
+    /**
+     * @brief Emitted now and then while indexFiles() runs.
+     * @param done Files processed so far.
+     * @param total Files queued.
+     */
+    void bulkIndexingProgress(int done, int total);
+
+    /**
+     * @brief Emitted when every worker of an indexFiles() call is done.
+     * @param indexed Files added to the index.
+     * @param failed Files that could not be loaded.
+     */
+    void bulkIndexingFinished(int indexed, int failed);
+
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static FullTextIndex* s_instance;
 };
 
 } // namespace QuantilyxDoc
 
+Q_DECLARE_METATYPE(QuantilyxDoc::SearchResult)
+
 #endif // QUANTILYX_FULLTEXTINDEX_H
\ No newline at end of file
@@ -0,0 +1,298 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ImageDiff.h"
+#include "../core/ImageScaler.h"
+#include "../core/PixelFormat.h"
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#define QUANTILYX_IMAGEDIFF_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define QUANTILYX_IMAGEDIFF_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// SSIM stabilizers for 8-bit samples: (0.01 * 255)^2 and (0.03 * 255)^2
+const double C1 = 6.5025;
+const double C2 = 58.5225;
+
+// Sums over the pixel pairs of one tile
+struct TileSums {
+    quint64 x = 0;
+    quint64 y = 0;
+    quint64 xx = 0;
+    quint64 yy = 0;
+    quint64 xy = 0;
+    int count = 0;
+};
+
+void addRowsScalar(const uchar* x, int xStride, const uchar* y, int yStride, int width, int rows, TileSums& sums)
+{
+    for (int row = 0; row < rows; ++row, x += xStride, y += yStride) {
+        quint32 sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+        for (int i = 0; i < width; ++i) {
+            const quint32 a = x[i];
+            const quint32 b = y[i];
+            sx += a;
+            sy += b;
+            sxx += a * a;
+            syy += b * b;
+            sxy += a * b;
+        }
+        sums.x += sx;
+        sums.y += sy;
+        sums.xx += sxx;
+        sums.yy += syy;
+        sums.xy += sxy;
+    }
+    sums.count += width * rows;
+}
+
+// Rows exactly TileSize pixels wide; at most TileSize of them, so no
+// 32-bit lane overflows
+void addRows16(const uchar* x, int xStride, const uchar* y, int yStride, int rows, TileSums& sums)
+{
+#if defined(QUANTILYX_IMAGEDIFF_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sx = zero, sy = zero, sxx = zero, syy = zero, sxy = zero;
+    for (int row = 0; row < rows; ++row, x += xStride, y += yStride) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y));
+        sx = _mm_add_epi64(sx, _mm_sad_epu8(a, zero));
+        sy = _mm_add_epi64(sy, _mm_sad_epu8(b, zero));
+        const __m128i aLow = _mm_unpacklo_epi8(a, zero);
+        const __m128i aHigh = _mm_unpackhi_epi8(a, zero);
+        const __m128i bLow = _mm_unpacklo_epi8(b, zero);
+        const __m128i bHigh = _mm_unpackhi_epi8(b, zero);
+        sxx = _mm_add_epi32(sxx, _mm_add_epi32(_mm_madd_epi16(aLow, aLow), _mm_madd_epi16(aHigh, aHigh)));
+        syy = _mm_add_epi32(syy, _mm_add_epi32(_mm_madd_epi16(bLow, bLow), _mm_madd_epi16(bHigh, bHigh)));
+        sxy = _mm_add_epi32(sxy, _mm_add_epi32(_mm_madd_epi16(aLow, bLow), _mm_madd_epi16(aHigh, bHigh)));
+    }
+    auto lanes64 = [](__m128i v) {
+        alignas(16) quint64 out[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(out), v);
+        return out[0] + out[1];
+    };
+    auto lanes32 = [](__m128i v) {
+        alignas(16) quint32 out[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(out), v);
+        return quint64(out[0]) + out[1] + out[2] + out[3];
+    };
+    sums.x += lanes64(sx);
+    sums.y += lanes64(sy);
+    sums.xx += lanes32(sxx);
+    sums.yy += lanes32(syy);
+    sums.xy += lanes32(sxy);
+    sums.count += ImageDiff::TileSize * rows;
+#elif defined(QUANTILYX_IMAGEDIFF_NEON)
+    uint32x4_t sx = vdupq_n_u32(0), sy = sx, sxx = sx, syy = sx, sxy = sx;
+    for (int row = 0; row < rows; ++row, x += xStride, y += yStride) {
+        const uint8x16_t a = vld1q_u8(x);
+        const uint8x16_t b = vld1q_u8(y);
+        sx = vpadalq_u16(sx, vpaddlq_u8(a));
+        sy = vpadalq_u16(sy, vpaddlq_u8(b));
+        sxx = vpadalq_u16(sxx, vmull_u8(vget_low_u8(a), vget_low_u8(a)));
+        sxx = vpadalq_u16(sxx, vmull_u8(vget_high_u8(a), vget_high_u8(a)));
+        syy = vpadalq_u16(syy, vmull_u8(vget_low_u8(b), vget_low_u8(b)));
+        syy = vpadalq_u16(syy, vmull_u8(vget_high_u8(b), vget_high_u8(b)));
+        sxy = vpadalq_u16(sxy, vmull_u8(vget_low_u8(a), vget_low_u8(b)));
+        sxy = vpadalq_u16(sxy, vmull_u8(vget_high_u8(a), vget_high_u8(b)));
+    }
+    auto lanes = [](uint32x4_t v) {
+        return quint64(vgetq_lane_u32(v, 0)) + vgetq_lane_u32(v, 1) + vgetq_lane_u32(v, 2) + vgetq_lane_u32(v, 3);
+    };
+    sums.x += lanes(sx);
+    sums.y += lanes(sy);
+    sums.xx += lanes(sxx);
+    sums.yy += lanes(syy);
+    sums.xy += lanes(sxy);
+    sums.count += ImageDiff::TileSize * rows;
+#else
+    addRowsScalar(x, xStride, y, yStride, ImageDiff::TileSize, rows, sums);
+#endif
+}
+
+double ssim(const TileSums& sums)
+{
+    if (sums.count == 0) return 1.0;
+    const double n = sums.count;
+    const double meanX = sums.x / n;
+    const double meanY = sums.y / n;
+    const double varianceX = sums.xx / n - meanX * meanX;
+    const double varianceY = sums.yy / n - meanY * meanY;
+    const double covariance = sums.xy / n - meanX * meanY;
+    return ((2.0 * meanX * meanY + C1) * (2.0 * covariance + C2))
+         / ((meanX * meanX + meanY * meanY + C1) * (varianceX + varianceY + C2));
+}
+
+// Ink per row and column: dark pixels count most
+void inkProfiles(const QImage& gray, QVector<quint32>& rows, QVector<quint32>& columns)
+{
+    rows.fill(0, gray.height());
+    columns.fill(0, gray.width());
+    quint32* column = columns.data();
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar* line = gray.constScanLine(y);
+        quint32 sum = 0;
+        for (int x = 0; x < gray.width(); ++x) {
+            const quint32 ink = 255u - line[x];
+            sum += ink;
+            column[x] += ink;
+        }
+        rows[y] = sum;
+    }
+}
+
+// Shift s within maxShift for which b[i + s] best matches a[i]
+int bestShift(const QVector<quint32>& a, const QVector<quint32>& b, int maxShift)
+{
+    int best = 0;
+    double bestCost = -1.0;
+    for (int shift = -maxShift; shift <= maxShift; ++shift) {
+        const int first = qMax(0, -shift);
+        const int last = qMin(a.size(), b.size() - shift);
+        if (last - first < a.size() / 2) continue;
+        quint64 cost = 0;
+        for (int i = first; i < last; ++i) cost += quint64(std::abs(qint64(a[i]) - qint64(b[i + shift])));
+        const double meanCost = double(cost) / (last - first);
+        if (bestCost < 0.0 || meanCost < bestCost || (meanCost == bestCost && std::abs(shift) < std::abs(best))) {
+            best = shift;
+            bestCost = meanCost;
+        }
+    }
+    return best;
+}
+
+// SSIM of a left tile against the right image moved by offset. Returns
+// false if less than half the tile has a counterpart.
+bool tileScore(const QImage& left, const QImage& right, const QRect& tile, const QPoint& offset, double* score)
+{
+    const QRect clipped = tile & right.rect().translated(-offset);
+    if (clipped.isEmpty() || clipped.width() * clipped.height() * 2 < tile.width() * tile.height()) return false;
+
+    const int leftStride = left.bytesPerLine();
+    const int rightStride = right.bytesPerLine();
+    const uchar* x = left.constBits() + clipped.y() * leftStride + clipped.x();
+    const uchar* y = right.constBits() + (clipped.y() + offset.y()) * rightStride + clipped.x() + offset.x();
+    TileSums sums;
+    if (clipped.width() == ImageDiff::TileSize) addRows16(x, leftStride, y, rightStride, clipped.height(), sums);
+    else addRowsScalar(x, leftStride, y, rightStride, clipped.width(), clipped.height(), sums);
+    *score = ssim(sums);
+    return true;
+}
+
+} // namespace
+
+ImageDiff::Result ImageDiff::compare(const QImage& left, const QImage& right, float tileThreshold)
+{
+    Result result;
+    if (left.isNull() || right.isNull()) {
+        result.similarity = left.isNull() == right.isNull() ? 1.0f : 0.0f;
+        return result;
+    }
+
+    // Grey scans are compared as they are and scaled in one channel
+    const QImage leftGray = PixelFormat::toGrayscale8(left);
+    const QImage rightGray = PixelFormat::toGrayscale8(right.size() == left.size() ? right : ImageScaler::scaled(right, left.size()));
+    if (leftGray.isNull() || rightGray.size() != leftGray.size()) {
+        result.similarity = 0.0f;
+        return result;
+    }
+    const int width = leftGray.width();
+    const int height = leftGray.height();
+
+    QVector<quint32> leftRows, leftColumns, rightRows, rightColumns;
+    inkProfiles(leftGray, leftRows, leftColumns);
+    inkProfiles(rightGray, rightRows, rightColumns);
+    result.offset = QPoint(bestShift(leftColumns, rightColumns, qMax(1, width * MaxShiftPercent / 100)),
+                           bestShift(leftRows, rightRows, qMax(1, height * MaxShiftPercent / 100)));
+
+    const int tilesX = (width + TileSize - 1) / TileSize;
+    const int tilesY = (height + TileSize - 1) / TileSize;
+    QVector<char> changed(tilesX * tilesY, 0);
+    double total = 0.0;
+    int scored = 0;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const QRect tile = QRect(tx * TileSize, ty * TileSize, TileSize, TileSize) & leftGray.rect();
+            double score = 0.0;
+            if (!tileScore(leftGray, rightGray, tile, result.offset, &score)) continue;
+            // Local jitter, e.g. from scanning, gets one pixel of slack
+            for (int dy = -1; dy <= 1 && score < tileThreshold; ++dy) {
+                for (int dx = -1; dx <= 1 && score < tileThreshold; ++dx) {
+                    double moved = 0.0;
+                    if ((dx || dy) && tileScore(leftGray, rightGray, tile, result.offset + QPoint(dx, dy), &moved)) {
+                        score = qMax(score, moved);
+                    }
+                }
+            }
+            total += qBound(0.0, score, 1.0);
+            ++scored;
+            if (score < tileThreshold) changed[ty * tilesX + tx] = 1;
+        }
+    }
+    result.similarity = scored > 0 ? float(total / scored) : 1.0f;
+
+    // Touching changed tiles, diagonals included, make one region
+    const double scaleX = double(right.width()) / width;
+    const double scaleY = double(right.height()) / height;
+    QVector<int> stack;
+    for (int start = 0; start < changed.size(); ++start) {
+        if (changed[start] != 1) continue;
+        int minX = tilesX, minY = tilesY, maxX = -1, maxY = -1;
+        changed[start] = 2;
+        stack.append(start);
+        while (!stack.isEmpty()) {
+            const int index = stack.takeLast();
+            const int tx = index % tilesX;
+            const int ty = index / tilesX;
+            minX = qMin(minX, tx);
+            minY = qMin(minY, ty);
+            maxX = qMax(maxX, tx);
+            maxY = qMax(maxY, ty);
+            for (int ny = qMax(0, ty - 1); ny <= qMin(tilesY - 1, ty + 1); ++ny) {
+                for (int nx = qMax(0, tx - 1); nx <= qMin(tilesX - 1, tx + 1); ++nx) {
+                    const int neighbour = ny * tilesX + nx;
+                    if (changed[neighbour] == 1) {
+                        changed[neighbour] = 2;
+                        stack.append(neighbour);
+                    }
+                }
+            }
+        }
+        const QRect region = QRect(minX * TileSize, minY * TileSize,
+                                   (maxX - minX + 1) * TileSize, (maxY - minY + 1) * TileSize) & leftGray.rect();
+        const QRect moved = region.translated(result.offset);
+        const QRect rightRegion = QRect(int(moved.x() * scaleX), int(moved.y() * scaleY),
+                                        qMax(1, int(moved.width() * scaleX)), qMax(1, int(moved.height() * scaleY))) & right.rect();
+        result.leftRegions.append(region);
+        result.rightRegions.append(rightRegion);
+    }
+    return result;
+}
+
+QString ImageDiff::instructionSet()
+{
+#if defined(QUANTILYX_IMAGEDIFF_SSE2)
+    return QStringLiteral("SSE2");
+#elif defined(QUANTILYX_IMAGEDIFF_NEON)
+    return QStringLiteral("NEON");
+#else
+    return QStringLiteral("scalar");
+#endif
+}
+
+} // namespace QuantilyxDoc
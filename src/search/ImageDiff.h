@@ -0,0 +1,72 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_IMAGEDIFF_H
+#define QUANTILYX_IMAGEDIFF_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QVector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Finds where two renderings or scans of a page differ.
+ *
+ * Both images are brought to the left one's size with ImageScaler and
+ * compared in grey levels, read by PixelFormat's kernel for their format;
+ * Grayscale8 images are used as they are. A global shift of the right image is first
+ * estimated from the row and column ink profiles, within MaxShiftPercent
+ * of each side, so a scan placed a few pixels off does not differ
+ * everywhere. The images are then cut into TileSize tiles and each tile
+ * pair is scored by SSIM, its sums taken with SSE2 or NEON where
+ * available; a tile that fails is tried again one pixel off in each
+ * direction before it counts as changed. Touching changed tiles are
+ * reported as one rectangle.
+ */
+class ImageDiff
+{
+public:
+    /// Side of a comparison tile, in pixels
+    static const int TileSize = 16;
+
+    /// Largest global shift searched, in percent of each side
+    static const int MaxShiftPercent = 2;
+
+    /**
+     * @brief Outcome of a comparison.
+     */
+    struct Result {
+        float similarity = 1.0f;     // Mean SSIM over the tiles, 0.0 to 1.0
+        QPoint offset;               // Shift of the right image's content, in left image pixels
+        QVector<QRect> leftRegions;  // Changed regions in left image pixels
+        QVector<QRect> rightRegions; // The same regions in right image pixels
+    };
+
+    /**
+     * @brief Compare two images.
+     * @param left Left image; any format.
+     * @param right Right image; any format, scaled to the left one's size if it differs.
+     * @param tileThreshold SSIM below which a tile counts as changed.
+     * @return Similarity and changed regions; similarity 0.0 if only one image is null.
+     */
+    static Result compare(const QImage& left, const QImage& right, float tileThreshold = 0.9f);
+
+    /**
+     * @brief Get the instruction set the tile sums use on this machine.
+     * @return "SSE2", "NEON" or "scalar".
+     */
+    static QString instructionSet();
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_IMAGEDIFF_H
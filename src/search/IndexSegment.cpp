@@ -0,0 +1,788 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "IndexSegment.h"
+#include "../core/Logger.h"
+#include "../core/MappedFile.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#define QUANTILYX_INDEX_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define QUANTILYX_INDEX_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const quint32 SegmentMagic = 0x51584653; // "QXFS"
+const quint32 SegmentVersion = 5;        // 1 stored postings uncompressed, 2 had no document lengths, 3 no page text, 4 no file state
+
+// File layout: header, posting lists, dictionary, document table, term pool.
+// A posting list is its skip table followed by its blocks. Skip tables and
+// dictionary entries are read in place, so both stay aligned.
+struct SegmentHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 termCount;
+    quint32 docCount;
+    quint64 dictionaryOffset;
+    quint64 documentsOffset;
+    quint64 poolOffset;
+    quint64 poolSize;
+};
+
+struct DictionaryEntry {
+    quint64 skipOffset;
+    quint32 blockCount;
+    quint32 docFreq;
+    quint32 postingCount;
+    quint32 termOffset; // Into the pool
+    quint32 termLength;
+    quint32 maxFreq;    // Highest frequency in any document, for score bounds
+};
+
+// A block holds docCount varint id deltas from the previous block's last id,
+// then at statsOffset four varints per document (IndexDocStats), then at
+// pagesOffset each document's pages after its first as (page delta, freq,
+// offset) varints.
+struct SkipEntry {
+    quint64 offset;
+    quint32 lastDocId;
+    quint32 length;
+    quint32 docCount;
+    quint32 statsOffset;
+    quint32 pagesOffset;
+    quint32 maxFreq;    // Highest frequency in the block
+};
+
+// Document table record; the UTF-8 path follows it
+struct DocumentRecord {
+    quint64 textOffset; // The document's chunk in the text file
+    quint32 textLength;
+    quint32 docId;
+    quint32 pageCount;
+    quint32 length;
+    quint32 pathLength;
+    quint32 reserved;
+    qint64 fileSize;
+    qint64 modified;
+    quint64 contentHash;
+};
+
+// A document's chunk in the text file starts with its page count and a
+// (offset, length) pair per page, relative to the chunk; each page is
+// qCompress()ed UTF-8.
+struct PageTextEntry {
+    quint32 offset;
+    quint32 length;
+};
+
+static_assert(sizeof(SegmentHeader) % 8 == 0, "Posting lists must start aligned");
+static_assert(sizeof(DictionaryEntry) % 8 == 0, "Dictionary entries must stay aligned");
+static_assert(sizeof(SkipEntry) % 8 == 0, "Skip entries must stay aligned");
+
+QString tr(const char* text)
+{
+    return QCoreApplication::translate("IndexSegment", text);
+}
+
+inline void writeVarint(QByteArray& out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+inline bool readVarint(const uchar*& p, const uchar* end, quint32& value)
+{
+    quint32 result = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const uchar byte = *p++;
+        result |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+int intersectScalar(const quint32* a, int countA, const quint32* b, int countB, quint32* out, int i, int j, int k)
+{
+    while (i < countA && j < countB) {
+        if (a[i] < b[j]) ++i;
+        else if (b[j] < a[i]) ++j;
+        else {
+            out[k++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+} // namespace
+
+class IndexSegment::Private {
+public:
+    Private() : header(), entries(nullptr), pool(nullptr) {}
+
+    std::shared_ptr<MappedFile> mapping;
+    SegmentHeader header;
+    const DictionaryEntry* entries;
+    const char* pool;
+    QVector<IndexSegmentDocument> documents;
+    QVector<QPair<quint64, quint32>> texts; // Chunk of each document in the text file
+    std::shared_ptr<MappedFile> textMapping;
+
+    QByteArray chunk(int index) const {
+        const QPair<quint64, quint32>& text = texts[index];
+        if (!textMapping || text.second == 0 || text.first + text.second > quint64(textMapping->size())) return QByteArray();
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(textMapping->data() + text.first), int(text.second));
+    }
+
+    // Byte order, which is the order the writer was given terms in
+    int compare(const DictionaryEntry& entry, const QByteArray& term) const {
+        const int common = qMin(int(entry.termLength), term.size());
+        const int result = std::memcmp(pool + entry.termOffset, term.constData(), size_t(common));
+        if (result != 0) return result;
+        return int(entry.termLength) - term.size();
+    }
+
+};
+
+IndexSegment::Cursor::Cursor()
+    : m_segment(nullptr), m_skips(nullptr), m_blockCount(0), m_docFreq(0), m_maxFreq(0), m_block(0), m_count(0)
+    , m_statsDecoded(false), m_pageDoc(0), m_pagePos(nullptr)
+{
+}
+
+bool IndexSegment::Cursor::load()
+{
+    m_count = 0;
+    m_statsDecoded = false;
+    m_pageDoc = 0;
+    m_pagePos = nullptr;
+    if (atEnd()) return false;
+
+    SkipEntry skip;
+    std::memcpy(&skip, m_skips + quint64(m_block) * sizeof(SkipEntry), sizeof(skip));
+    const quint64 limit = m_segment->d->header.dictionaryOffset;
+    if (skip.docCount == 0 || skip.docCount > quint32(BlockSize) || skip.offset + skip.length > limit
+        || skip.statsOffset > skip.pagesOffset || skip.pagesOffset > skip.length) {
+        LOG_WARN("IndexSegment: Damaged posting block in " << m_segment->filePath());
+        m_block = m_blockCount;
+        return false;
+    }
+
+    const uchar* block = m_segment->d->mapping->data() + skip.offset;
+    const uchar* p = block;
+    const uchar* end = block + skip.statsOffset;
+    quint32 docId = 0;
+    if (m_block > 0) {
+        SkipEntry previous;
+        std::memcpy(&previous, m_skips + quint64(m_block - 1) * sizeof(SkipEntry), sizeof(previous));
+        docId = previous.lastDocId;
+    }
+    for (quint32 i = 0; i < skip.docCount; ++i) {
+        quint32 delta = 0;
+        if (!readVarint(p, end, delta)) {
+            LOG_WARN("IndexSegment: Damaged posting block in " << m_segment->filePath());
+            m_block = m_blockCount;
+            return false;
+        }
+        docId += delta;
+        m_docs[i] = docId;
+    }
+    m_count = int(skip.docCount);
+    return true;
+}
+
+bool IndexSegment::Cursor::nextBlock()
+{
+    if (atEnd()) return false;
+    ++m_block;
+    return load();
+}
+
+bool IndexSegment::Cursor::skipTo(quint32 docId)
+{
+    if (atEnd()) return false;
+    if (lastDoc() >= docId) return true;
+
+    // Binary search over the skip table from the current block
+    quint32 low = m_block + 1;
+    quint32 high = m_blockCount;
+    while (low < high) {
+        const quint32 middle = low + (high - low) / 2;
+        SkipEntry skip;
+        std::memcpy(&skip, m_skips + quint64(middle) * sizeof(SkipEntry), sizeof(skip));
+        if (skip.lastDocId < docId) low = middle + 1;
+        else high = middle;
+    }
+    m_block = low;
+    return load();
+}
+
+quint32 IndexSegment::Cursor::lastDoc() const
+{
+    SkipEntry skip;
+    std::memcpy(&skip, m_skips + quint64(m_block) * sizeof(SkipEntry), sizeof(skip));
+    return skip.lastDocId;
+}
+
+quint32 IndexSegment::Cursor::blockMaxFreq() const
+{
+    SkipEntry skip;
+    std::memcpy(&skip, m_skips + quint64(m_block) * sizeof(SkipEntry), sizeof(skip));
+    return skip.maxFreq;
+}
+
+const IndexDocStats* IndexSegment::Cursor::stats()
+{
+    if (m_statsDecoded || m_count == 0) return m_stats;
+
+    SkipEntry skip;
+    std::memcpy(&skip, m_skips + quint64(m_block) * sizeof(SkipEntry), sizeof(skip));
+    const uchar* block = m_segment->d->mapping->data() + skip.offset;
+    const uchar* p = block + skip.statsOffset;
+    const uchar* end = block + skip.pagesOffset;
+    for (int i = 0; i < m_count; ++i) {
+        IndexDocStats& stats = m_stats[i];
+        if (!readVarint(p, end, stats.freq) || !readVarint(p, end, stats.pageCount)
+            || !readVarint(p, end, stats.firstPage) || !readVarint(p, end, stats.firstOffset)) {
+            LOG_WARN("IndexSegment: Damaged posting block in " << m_segment->filePath());
+            std::memset(m_stats + i, 0, sizeof(IndexDocStats) * size_t(m_count - i));
+            break;
+        }
+    }
+    m_statsDecoded = true;
+    m_pageDoc = 0;
+    m_pagePos = block + skip.pagesOffset;
+    return m_stats;
+}
+
+void IndexSegment::Cursor::pages(int index, QVector<IndexPosting>& out)
+{
+    if (index < 0 || index >= m_count) return;
+    stats();
+
+    SkipEntry skip;
+    std::memcpy(&skip, m_skips + quint64(m_block) * sizeof(SkipEntry), sizeof(skip));
+    const uchar* block = m_segment->d->mapping->data() + skip.offset;
+    const uchar* end = block + skip.length;
+    if (index < m_pageDoc) {
+        m_pageDoc = 0;
+        m_pagePos = block + skip.pagesOffset;
+    }
+
+    // Documents are read in turn, so a caller going forward decodes each page once
+    quint32 value = 0;
+    for (; m_pageDoc < index; ++m_pageDoc) {
+        const quint32 pageCount = m_stats[m_pageDoc].pageCount;
+        const quint32 values = pageCount > 0 ? (pageCount - 1) * 3 : 0;
+        for (quint32 n = 0; n < values; ++n) {
+            if (!readVarint(m_pagePos, end, value)) return;
+        }
+    }
+
+    const IndexDocStats& stats = m_stats[index];
+    if (stats.pageCount == 0) return;
+    const int first = out.size();
+    out.append(IndexPosting{ m_docs[index], stats.firstPage, 0, stats.firstOffset });
+    quint32 page = stats.firstPage;
+    quint32 remaining = stats.freq;
+    for (quint32 n = 1; n < stats.pageCount; ++n) {
+        quint32 delta = 0, freq = 0, offset = 0;
+        if (!readVarint(m_pagePos, end, delta) || !readVarint(m_pagePos, end, freq) || !readVarint(m_pagePos, end, offset)) break;
+        page += delta;
+        out.append(IndexPosting{ m_docs[index], page, freq, offset });
+        remaining -= qMin(remaining, freq);
+    }
+    out[first].freq = remaining; // The first page has what the others leave of the total
+    ++m_pageDoc;
+}
+
+IndexSegment::IndexSegment()
+    : d(new Private())
+{
+}
+
+IndexSegment::~IndexSegment() = default;
+
+std::shared_ptr<IndexSegment> IndexSegment::open(const QString& filePath, QString* error)
+{
+    std::shared_ptr<MappedFile> mapping = MappedFile::open(filePath);
+    if (!mapping) {
+        if (error) *error = tr("Cannot map index segment %1.").arg(filePath);
+        return nullptr;
+    }
+    const quint64 size = quint64(mapping->size());
+    const uchar* data = mapping->data();
+    auto damaged = [&]() -> std::shared_ptr<IndexSegment> {
+        if (error) *error = tr("Index segment %1 is damaged.").arg(filePath);
+        return nullptr;
+    };
+
+    SegmentHeader header;
+    if (size < sizeof(header)) return damaged();
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != SegmentMagic) return damaged();
+    if (header.version != SegmentVersion) {
+        if (error) *error = tr("Index segment %1 was written by another version.").arg(filePath);
+        return nullptr;
+    }
+    if (header.dictionaryOffset % 8 != 0
+        || header.dictionaryOffset + quint64(header.termCount) * sizeof(DictionaryEntry) > header.documentsOffset
+        || header.documentsOffset > header.poolOffset || header.poolOffset + header.poolSize > size) {
+        return damaged();
+    }
+
+    std::shared_ptr<IndexSegment> segment(new IndexSegment());
+    segment->d->mapping = mapping;
+    segment->d->header = header;
+    segment->d->entries = reinterpret_cast<const DictionaryEntry*>(data + header.dictionaryOffset);
+    segment->d->pool = reinterpret_cast<const char*>(data + header.poolOffset);
+
+    // Entries are checked once here; blocks are checked as they are decoded
+    for (quint32 i = 0; i < header.termCount; ++i) {
+        const DictionaryEntry& entry = segment->d->entries[i];
+        if (entry.skipOffset < sizeof(header) || entry.skipOffset % 8 != 0
+            || entry.skipOffset + quint64(entry.blockCount) * sizeof(SkipEntry) > header.dictionaryOffset
+            || quint64(entry.termOffset) + entry.termLength > header.poolSize) {
+            return damaged();
+        }
+    }
+
+    quint64 position = header.documentsOffset;
+    bool hasText = false;
+    segment->d->documents.reserve(int(header.docCount));
+    for (quint32 i = 0; i < header.docCount; ++i) {
+        DocumentRecord record;
+        if (position + sizeof(record) > header.poolOffset) return damaged();
+        std::memcpy(&record, data + position, sizeof(record));
+        hasText = hasText || record.textLength > 0;
+        position += sizeof(record);
+        if (position + record.pathLength > header.poolOffset) return damaged();
+        IndexSegmentDocument document;
+        document.docId = record.docId;
+        document.pageCount = record.pageCount;
+        document.length = record.length;
+        document.filePath = QString::fromUtf8(reinterpret_cast<const char*>(data + position), int(record.pathLength));
+        document.fileSize = record.fileSize;
+        document.modified = record.modified;
+        document.contentHash = record.contentHash;
+        position += record.pathLength;
+        segment->d->documents.append(document);
+        segment->d->texts.append(qMakePair(record.textOffset, record.textLength));
+    }
+
+    // Without its text, the segment still answers queries, only without snippets
+    if (hasText) {
+        segment->d->textMapping = MappedFile::open(textFilePath(filePath));
+        if (!segment->d->textMapping) LOG_WARN("IndexSegment: Page text of " << filePath << " is missing.");
+    }
+    return segment;
+}
+
+QString IndexSegment::filePath() const
+{
+    return d->mapping->filePath();
+}
+
+IndexSegment::Cursor IndexSegment::cursor(const QByteArray& term) const
+{
+    int low = 0;
+    int high = int(d->header.termCount) - 1;
+    while (low <= high) {
+        const int middle = low + (high - low) / 2;
+        const DictionaryEntry& entry = d->entries[middle];
+        const int order = d->compare(entry, term);
+        if (order == 0) return cursorAt(middle);
+        if (order < 0) low = middle + 1;
+        else high = middle - 1;
+    }
+    return Cursor();
+}
+
+int IndexSegment::termCount() const
+{
+    return int(d->header.termCount);
+}
+
+QByteArray IndexSegment::termAt(int index) const
+{
+    const DictionaryEntry& entry = d->entries[index];
+    return QByteArray::fromRawData(d->pool + entry.termOffset, int(entry.termLength));
+}
+
+QPair<int, int> IndexSegment::prefixRange(const QByteArray& prefix, int from, int to) const
+{
+    const int count = int(d->header.termCount);
+    int low = qBound(0, from, count);
+    int high = to < 0 ? count : qBound(low, to, count);
+    // The dictionary is sorted, so the terms with the prefix follow the first one not below it
+    int first = low;
+    for (int length = high - low; length > 0;) {
+        const int half = length / 2;
+        if (d->compare(d->entries[first + half], prefix) < 0) {
+            first += half + 1;
+            length -= half + 1;
+        } else {
+            length = half;
+        }
+    }
+    int last = first;
+    for (int length = high - first; length > 0;) {
+        const int half = length / 2;
+        if (termAt(last + half).startsWith(prefix)) {
+            last += half + 1;
+            length -= half + 1;
+        } else {
+            length = half;
+        }
+    }
+    return qMakePair(first, last);
+}
+
+int IndexSegment::docFreqAt(int index) const
+{
+    return int(d->entries[index].docFreq);
+}
+
+QVector<IndexPosting> IndexSegment::postingsAt(int index) const
+{
+    const DictionaryEntry& entry = d->entries[index];
+    QVector<IndexPosting> postings;
+    postings.reserve(int(entry.postingCount));
+    for (Cursor cursor = cursorAt(index); !cursor.atEnd(); cursor.nextBlock()) {
+        for (int i = 0; i < cursor.docCount(); ++i) cursor.pages(i, postings);
+    }
+    return postings;
+}
+
+IndexSegment::Cursor IndexSegment::cursorAt(int index) const
+{
+    const DictionaryEntry& entry = d->entries[index];
+    Cursor cursor;
+    cursor.m_segment = this;
+    cursor.m_skips = d->mapping->data() + entry.skipOffset;
+    cursor.m_blockCount = entry.blockCount;
+    cursor.m_docFreq = entry.docFreq;
+    cursor.m_maxFreq = entry.maxFreq;
+    cursor.load();
+    return cursor;
+}
+
+const QVector<IndexSegmentDocument>& IndexSegment::documents() const
+{
+    return d->documents;
+}
+
+int IndexSegment::indexOf(quint32 docId) const
+{
+    const auto it = std::lower_bound(d->documents.constBegin(), d->documents.constEnd(), docId,
+                                     [](const IndexSegmentDocument& document, quint32 id) { return document.docId < id; });
+    if (it == d->documents.constEnd() || it->docId != docId) return -1;
+    return int(it - d->documents.constBegin());
+}
+
+QString IndexSegment::pageText(quint32 docId, quint32 page) const
+{
+    const int index = indexOf(docId);
+    return index < 0 ? QString() : unpackPageText(d->chunk(index), page);
+}
+
+QString IndexSegment::unpackPageText(const QByteArray& chunk, quint32 page)
+{
+    quint32 count = 0;
+    if (chunk.size() < int(sizeof(count))) return QString();
+    std::memcpy(&count, chunk.constData(), sizeof(count));
+    const quint64 tableEnd = sizeof(count) + quint64(page + 1) * sizeof(PageTextEntry);
+    if (page >= count || tableEnd > quint64(chunk.size())) return QString();
+    PageTextEntry entry;
+    std::memcpy(&entry, chunk.constData() + sizeof(count) + quint64(page) * sizeof(PageTextEntry), sizeof(entry));
+    if (entry.length == 0 || quint64(entry.offset) + entry.length > quint64(chunk.size())) return QString();
+    return QString::fromUtf8(qUncompress(reinterpret_cast<const uchar*>(chunk.constData() + entry.offset), int(entry.length)));
+}
+
+QByteArray IndexSegment::textChunk(int index) const
+{
+    return d->chunk(index);
+}
+
+QByteArray IndexSegment::packPageTexts(const QStringList& pages)
+{
+    const quint32 count = quint32(pages.size());
+    QByteArray chunk(int(sizeof(count) + count * sizeof(PageTextEntry)), '\0');
+    std::memcpy(chunk.data(), &count, sizeof(count));
+    for (int i = 0; i < pages.size(); ++i) {
+        PageTextEntry entry = { quint32(chunk.size()), 0 };
+        if (!pages[i].isEmpty()) {
+            const QByteArray compressed = qCompress(pages[i].toUtf8());
+            entry.length = quint32(compressed.size());
+            chunk += compressed;
+        }
+        std::memcpy(chunk.data() + sizeof(count) + quint64(i) * sizeof(PageTextEntry), &entry, sizeof(entry));
+    }
+    return chunk;
+}
+
+QString IndexSegment::textFilePath(const QString& filePath)
+{
+    QString path = filePath;
+    if (path.endsWith(QLatin1String(".seg"))) path.chop(4);
+    return path + QLatin1String(".txt");
+}
+
+void IndexSegment::removeFiles(const QString& filePath)
+{
+    QFile::remove(filePath);
+    QFile::remove(textFilePath(filePath));
+}
+
+int IndexSegment::intersect(const quint32* a, int countA, const quint32* b, int countB, quint32* out)
+{
+    int i = 0, j = 0, k = 0;
+#if defined(QUANTILYX_INDEX_SSE2)
+    // Each id of four from a is compared with four from b in all rotations;
+    // the block with the smaller maximum is then done with.
+    while (i + 4 <= countA && j + 4 <= countB) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        const __m128i c0 = _mm_cmpeq_epi32(va, vb);
+        const __m128i c1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+        const __m128i c2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+        const __m128i c3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(c0, c1), _mm_or_si128(c2, c3))));
+        while (mask) {
+            out[k++] = a[i + __builtin_ctz(mask)];
+            mask &= mask - 1;
+        }
+        const quint32 maxA = a[i + 3];
+        const quint32 maxB = b[j + 3];
+        if (maxA <= maxB) i += 4;
+        if (maxB <= maxA) j += 4;
+    }
+#elif defined(QUANTILYX_INDEX_NEON)
+    while (i + 4 <= countA && j + 4 <= countB) {
+        const uint32x4_t va = vld1q_u32(a + i);
+        const uint32x4_t vb = vld1q_u32(b + j);
+        uint32x4_t any = vceqq_u32(va, vb);
+        any = vorrq_u32(any, vceqq_u32(va, vextq_u32(vb, vb, 1)));
+        any = vorrq_u32(any, vceqq_u32(va, vextq_u32(vb, vb, 2)));
+        any = vorrq_u32(any, vceqq_u32(va, vextq_u32(vb, vb, 3)));
+        if (vgetq_lane_u32(any, 0)) out[k++] = a[i];
+        if (vgetq_lane_u32(any, 1)) out[k++] = a[i + 1];
+        if (vgetq_lane_u32(any, 2)) out[k++] = a[i + 2];
+        if (vgetq_lane_u32(any, 3)) out[k++] = a[i + 3];
+        const quint32 maxA = a[i + 3];
+        const quint32 maxB = b[j + 3];
+        if (maxA <= maxB) i += 4;
+        if (maxB <= maxA) j += 4;
+    }
+#endif
+    return intersectScalar(a, countA, b, countB, out, i, j, k);
+}
+
+class IndexSegmentWriter::Private {
+public:
+    explicit Private(const QString& path)
+        : file(path), textFile(IndexSegment::textFilePath(path)), position(0), textPosition(0), failed(false), finished(false) {}
+
+    QSaveFile file;
+    QSaveFile textFile;
+    QVector<QPair<quint64, quint32>> texts;
+    QVector<DictionaryEntry> entries;
+    QVector<IndexSegmentDocument> documents;
+    QByteArray pool;
+    QByteArray lastTerm;
+    quint64 position;
+    quint64 textPosition;
+    bool failed;
+    bool finished;
+
+    bool write(const void* data, qint64 length) {
+        if (failed) return false;
+        if (file.write(static_cast<const char*>(data), length) != length) {
+            failed = true;
+            return false;
+        }
+        position += quint64(length);
+        return true;
+    }
+
+    // One block of up to BlockSize documents; each range is [first, last) in postings
+    static void encodeBlock(const IndexPosting* postings, const QVector<QPair<int, int>>& ranges,
+                            quint32 previousDoc, QByteArray& out, SkipEntry& skip) {
+        QByteArray stats;
+        QByteArray pages;
+        skip.maxFreq = 0;
+        for (const auto& range : ranges) {
+            const IndexPosting& first = postings[range.first];
+            writeVarint(out, first.docId - previousDoc);
+            previousDoc = first.docId;
+
+            quint32 freq = 0;
+            for (int i = range.first; i < range.second; ++i) freq += postings[i].freq;
+            skip.maxFreq = qMax(skip.maxFreq, freq);
+            writeVarint(stats, freq);
+            writeVarint(stats, quint32(range.second - range.first));
+            writeVarint(stats, first.page);
+            writeVarint(stats, first.offset);
+            for (int i = range.first + 1; i < range.second; ++i) {
+                writeVarint(pages, postings[i].page - postings[i - 1].page);
+                writeVarint(pages, postings[i].freq);
+                writeVarint(pages, postings[i].offset);
+            }
+        }
+        skip.lastDocId = previousDoc;
+        skip.docCount = quint32(ranges.size());
+        skip.statsOffset = quint32(out.size());
+        out += stats;
+        skip.pagesOffset = quint32(out.size());
+        out += pages;
+        skip.length = quint32(out.size());
+    }
+};
+
+IndexSegmentWriter::IndexSegmentWriter(const QString& filePath)
+    : d(new Private(filePath))
+{
+    // The header is written again with the offsets on finish()
+    const SegmentHeader header = {};
+    d->failed = !d->file.open(QIODevice::WriteOnly) || !d->textFile.open(QIODevice::WriteOnly);
+    d->write(&header, sizeof(header));
+}
+
+IndexSegmentWriter::~IndexSegmentWriter()
+{
+    if (!d->finished) {
+        d->file.cancelWriting();
+        d->textFile.cancelWriting();
+    }
+}
+
+bool IndexSegmentWriter::addTerm(const QByteArray& term, const IndexPosting* postings, int count)
+{
+    if (d->failed) return false;
+    if (count <= 0 || term.isEmpty()) return true;
+    Q_ASSERT(d->entries.isEmpty() || d->lastTerm < term);
+
+    // Cut the list into blocks of whole documents
+    QVector<SkipEntry> skips;
+    QByteArray blocks;
+    QVector<QPair<int, int>> ranges;
+    quint32 previousDoc = 0;
+    quint32 docFreq = 0;
+    quint32 maxFreq = 0;
+    for (int i = 0; i < count;) {
+        int j = i + 1;
+        while (j < count && postings[j].docId == postings[i].docId) ++j;
+        ranges.append(qMakePair(i, j));
+        ++docFreq;
+        i = j;
+        if (ranges.size() == IndexSegment::BlockSize || i == count) {
+            SkipEntry skip;
+            QByteArray block;
+            Private::encodeBlock(postings, ranges, previousDoc, block, skip);
+            skip.offset = quint64(blocks.size()); // Made absolute below
+            blocks += block;
+            skips.append(skip);
+            previousDoc = skip.lastDocId;
+            maxFreq = qMax(maxFreq, skip.maxFreq);
+            ranges.clear();
+        }
+    }
+
+    DictionaryEntry entry;
+    entry.skipOffset = d->position;
+    entry.blockCount = quint32(skips.size());
+    entry.docFreq = docFreq;
+    entry.postingCount = quint32(count);
+    entry.termOffset = quint32(d->pool.size());
+    entry.termLength = quint32(term.size());
+    entry.maxFreq = maxFreq;
+
+    const quint64 blocksStart = d->position + quint64(skips.size()) * sizeof(SkipEntry);
+    for (SkipEntry& skip : skips) skip.offset += blocksStart;
+    d->write(skips.constData(), qint64(skips.size()) * qint64(sizeof(SkipEntry)));
+    d->write(blocks.constData(), blocks.size());
+    static const char padding[8] = {};
+    if (!d->write(padding, qint64((8 - d->position % 8) % 8))) return false;
+
+    d->pool.append(term);
+    d->entries.append(entry);
+    d->lastTerm = term;
+    return true;
+}
+
+void IndexSegmentWriter::addDocument(const IndexSegmentDocument& document, const QByteArray& textChunk)
+{
+    d->documents.append(document);
+    d->texts.append(qMakePair(d->textPosition, quint32(textChunk.size())));
+    if (textChunk.isEmpty() || d->failed) return;
+    if (d->textFile.write(textChunk) != textChunk.size()) {
+        d->failed = true;
+        return;
+    }
+    d->textPosition += quint64(textChunk.size());
+}
+
+bool IndexSegmentWriter::finish(QString* error)
+{
+    SegmentHeader header;
+    header.magic = SegmentMagic;
+    header.version = SegmentVersion;
+    header.termCount = quint32(d->entries.size());
+    header.docCount = quint32(d->documents.size());
+    header.dictionaryOffset = d->position;
+    d->write(d->entries.constData(), qint64(d->entries.size()) * qint64(sizeof(DictionaryEntry)));
+
+    header.documentsOffset = d->position;
+    for (int i = 0; i < d->documents.size(); ++i) {
+        const IndexSegmentDocument& document = d->documents[i];
+        const QByteArray path = document.filePath.toUtf8();
+        const DocumentRecord record = { d->texts[i].first, d->texts[i].second, document.docId, document.pageCount,
+                                        document.length, quint32(path.size()), 0,
+                                        document.fileSize, document.modified, document.contentHash };
+        d->write(&record, sizeof(record));
+        d->write(path.constData(), path.size());
+    }
+
+    header.poolOffset = d->position;
+    header.poolSize = quint64(d->pool.size());
+    d->write(d->pool.constData(), d->pool.size());
+
+    // The text goes first: a segment on disk always has its text
+    const bool textWritten = !d->failed && d->textFile.commit();
+    const bool ok = textWritten && d->file.seek(0)
+                    && d->file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header))
+                    && d->file.commit();
+    d->finished = ok;
+    if (!ok) {
+        const QString reason = textWritten || d->failed ? d->file.errorString() : d->textFile.errorString();
+        if (error) *error = tr("Failed to write index segment %1: %2").arg(d->file.fileName(), reason);
+        LOG_WARN("IndexSegmentWriter: Failed to write " << d->file.fileName() << ": " << reason);
+        if (textWritten) QFile::remove(d->textFile.fileName());
+    }
+    return ok;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,386 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_INDEXSEGMENT_H
+#define QUANTILYX_INDEXSEGMENT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <memory>
+
+class QSaveFile;
+
+namespace QuantilyxDoc {
+
+class MappedFile;
+
+/**
+ * @brief One occurrence record of a term: the term appears freq times on a
+ * page of a document, first at character offset.
+ */
+struct IndexPosting {
+    quint32 docId;
+    quint32 page;
+    quint32 freq;
+    quint32 offset;
+};
+
+/**
+ * @brief How a term occurs in one document: freq times over pageCount
+ * pages, first on firstPage at character firstOffset.
+ */
+struct IndexDocStats {
+    quint32 freq;
+    quint32 pageCount;
+    quint32 firstPage;
+    quint32 firstOffset;
+};
+
+/**
+ * @brief A document stored in a segment, with the state of its file when
+ * it was indexed.
+ */
+struct IndexSegmentDocument {
+    quint32 docId;
+    quint32 pageCount;
+    quint32 length; // Indexed words
+    QString filePath;
+    qint64 fileSize;
+    qint64 modified;     // Milliseconds since the epoch
+    quint64 contentHash; // Leading bytes of the file's MD5
+};
+
+/**
+ * @brief Read-only, memory-mapped segment of the full-text index.
+ *
+ * A segment file holds a sorted term dictionary, the posting lists it
+ * points into, and the documents whose postings it holds. A posting list
+ * is cut into blocks of up to BlockSize documents, behind a skip table
+ * giving each block's last document id, position and highest term
+ * frequency. Within a block the
+ * document ids are delta-encoded varints, followed by each document's
+ * IndexDocStats and then its remaining pages, so a query decodes only the
+ * ids of blocks it has not skipped, and the rest only for documents that
+ * matched. Blocks are read straight from the mapping, so the OS page cache
+ * decides how much of the index is resident.
+ *
+ * Each page's text is kept compressed in a text file next to the segment,
+ * so snippets can be cut at a posting's offset without the document open
+ * and without the corpus's text in memory.
+ */
+class IndexSegment
+{
+public:
+    /// Documents per posting block
+    static const int BlockSize = 128;
+
+    /**
+     * @brief Walks one term's posting list block by block.
+     *
+     * Only valid while its segment is alive. Blocks are visited in
+     * document order; a damaged block ends the list.
+     */
+    class Cursor
+    {
+    public:
+        Cursor();
+
+        /**
+         * @brief Check whether the term exists in the segment.
+         * @return False for a cursor over an absent term.
+         */
+        bool isValid() const { return m_segment != nullptr; }
+
+        /**
+         * @brief Get the number of documents containing the term.
+         * @return Document frequency.
+         */
+        int docFreq() const { return int(m_docFreq); }
+
+        /**
+         * @brief Get the term's highest frequency in any one document.
+         * @return Frequency, for bounding scores.
+         */
+        quint32 maxFreq() const { return m_maxFreq; }
+
+        /**
+         * @brief Check whether every block has been visited.
+         * @return True past the last block.
+         */
+        bool atEnd() const { return m_block >= m_blockCount; }
+
+        /**
+         * @brief Move to the next block.
+         * @return False at the end of the list.
+         */
+        bool nextBlock();
+
+        /**
+         * @brief Move forward to the first block whose last id is at least docId.
+         * Uses the skip table; never moves backwards.
+         * @param docId Document id.
+         * @return False if no such block exists.
+         */
+        bool skipTo(quint32 docId);
+
+        /**
+         * @brief Get the current block's document ids, ascending.
+         * @return docCount() decoded ids.
+         */
+        const quint32* docs() const { return m_docs; }
+
+        /**
+         * @brief Get the number of documents in the current block.
+         * @return Document count, 0 at the end.
+         */
+        int docCount() const { return m_count; }
+
+        /**
+         * @brief Get the current block's last document id without decoding it.
+         * @return Last id of the block.
+         */
+        quint32 lastDoc() const;
+
+        /**
+         * @brief Get the term's highest frequency in a document of the current block.
+         * @return Frequency, for bounding scores without decoding the block's statistics.
+         */
+        quint32 blockMaxFreq() const;
+
+        /**
+         * @brief Get the current block's per-document statistics.
+         * Decoded on first use for each block.
+         * @return docCount() entries, parallel to docs().
+         */
+        const IndexDocStats* stats();
+
+        /**
+         * @brief Decode the pages of one document of the current block.
+         * @param index Position within the block.
+         * @param out Receives the document's postings.
+         */
+        void pages(int index, QVector<IndexPosting>& out);
+
+    private:
+        friend class IndexSegment;
+        bool load();
+
+        const IndexSegment* m_segment;
+        const uchar* m_skips;
+        quint32 m_blockCount;
+        quint32 m_docFreq;
+        quint32 m_maxFreq;
+        quint32 m_block;
+        int m_count;
+        bool m_statsDecoded;
+        int m_pageDoc;             // Document the page reader is at
+        const uchar* m_pagePos;
+        quint32 m_docs[BlockSize];
+        IndexDocStats m_stats[BlockSize];
+    };
+
+    /**
+     * @brief Map and validate a segment file.
+     * @param filePath Segment file.
+     * @param error Receives a description on failure; may be null.
+     * @return The segment, or null if the file is missing, damaged or in an older format.
+     */
+    static std::shared_ptr<IndexSegment> open(const QString& filePath, QString* error = nullptr);
+
+    ~IndexSegment();
+
+    /**
+     * @brief Get the segment file's path.
+     * @return File path.
+     */
+    QString filePath() const;
+
+    /**
+     * @brief Look up a term's posting list.
+     * @param term Lower-case UTF-8 term.
+     * @return A cursor on the first block, invalid if the term is absent.
+     */
+    Cursor cursor(const QByteArray& term) const;
+
+    /**
+     * @brief Get the number of distinct terms.
+     * @return Term count.
+     */
+    int termCount() const;
+
+    /**
+     * @brief Get a term by dictionary position, for merging in order.
+     * @param index Position, 0 to termCount() - 1.
+     * @return The term, as raw data over the mapping.
+     */
+    QByteArray termAt(int index) const;
+
+    /**
+     * @brief Find the terms starting with a prefix, by binary search of the dictionary.
+     * @param prefix Lower-case UTF-8 prefix.
+     * @param from Start of the positions searched, e.g. the range of a shorter prefix.
+     * @param to End of the positions searched; -1 for termCount().
+     * @return First matching position and one past the last; equal if none match.
+     */
+    QPair<int, int> prefixRange(const QByteArray& prefix, int from = 0, int to = -1) const;
+
+    /**
+     * @brief Get the number of documents containing a term, by dictionary position.
+     * @param index Position, 0 to termCount() - 1.
+     * @return Document frequency.
+     */
+    int docFreqAt(int index) const;
+
+    /**
+     * @brief Get a cursor on a term's posting list by dictionary position.
+     * @param index Position, 0 to termCount() - 1.
+     * @return A cursor on the first block.
+     */
+    Cursor cursorAt(int index) const;
+
+    /**
+     * @brief Decode a term's whole posting list by dictionary position.
+     * @param index Position, 0 to termCount() - 1.
+     * @return Postings sorted by document and page.
+     */
+    QVector<IndexPosting> postingsAt(int index) const;
+
+    /**
+     * @brief Get the documents this segment holds postings for.
+     * @return Documents in id order.
+     */
+    const QVector<IndexSegmentDocument>& documents() const;
+
+    /**
+     * @brief Find a document by id.
+     * @param docId Document id.
+     * @return Position in documents(), or -1 if the segment does not hold it.
+     */
+    int indexOf(quint32 docId) const;
+
+    /**
+     * @brief Get the text of one page of a document, decompressed from the text file.
+     * @param docId Document id.
+     * @param page Page index.
+     * @return The page text; empty if the document, the page or its text is missing.
+     */
+    QString pageText(quint32 docId, quint32 page) const;
+
+    /**
+     * @brief Get a document's compressed page text, for copying into a merged segment.
+     * @param index Position in documents().
+     * @return Raw data over the text file's mapping; empty if there is none.
+     */
+    QByteArray textChunk(int index) const;
+
+    /**
+     * @brief Compress a document's page text into one chunk.
+     * @param pages Text of each page.
+     * @return Chunk for IndexSegmentWriter::addDocument().
+     */
+    static QByteArray packPageTexts(const QStringList& pages);
+
+    /**
+     * @brief Decompress one page's text from a chunk.
+     * @param chunk Chunk from packPageTexts() or textChunk().
+     * @param page Page index.
+     * @return The page text; empty if the page or its text is missing.
+     */
+    static QString unpackPageText(const QByteArray& chunk, quint32 page);
+
+    /**
+     * @brief Get the path of the text file that goes with a segment.
+     * @param filePath Segment file.
+     * @return Text file path, the segment's with a .txt suffix.
+     */
+    static QString textFilePath(const QString& filePath);
+
+    /**
+     * @brief Delete a segment file and its text file.
+     * Mappings already open stay valid.
+     * @param filePath Segment file.
+     */
+    static void removeFiles(const QString& filePath);
+
+    /**
+     * @brief Intersect two ascending lists of distinct document ids.
+     * Compares four ids at a time with SSE2 or NEON where available.
+     * @param a First list.
+     * @param countA Length of a.
+     * @param b Second list.
+     * @param countB Length of b.
+     * @param out Receives the common ids, ascending; room for min(countA, countB).
+     * @return Number of common ids.
+     */
+    static int intersect(const quint32* a, int countA, const quint32* b, int countB, quint32* out);
+
+private:
+    IndexSegment();
+
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+/**
+ * @brief Writes a segment file term by term.
+ *
+ * Terms must be added in byte order; each posting list is encoded and
+ * written as it is added, so a merge of large segments only keeps the
+ * dictionary in memory. The
+ * file is written through QSaveFile and appears only on finish().
+ */
+class IndexSegmentWriter
+{
+public:
+    /**
+     * @brief Start writing a segment.
+     * @param filePath Destination file.
+     */
+    explicit IndexSegmentWriter(const QString& filePath);
+
+    /**
+     * @brief Discard the file unless finish() succeeded.
+     */
+    ~IndexSegmentWriter();
+
+    /**
+     * @brief Append a term and its postings.
+     * @param term Lower-case UTF-8 term, greater than the previous one.
+     * @param postings Postings sorted by document and page.
+     * @param count Number of postings; terms without any are skipped.
+     * @return False on a write error.
+     */
+    bool addTerm(const QByteArray& term, const IndexPosting* postings, int count);
+
+    /**
+     * @brief Record a document of the segment.
+     * @param document Document id, page count and path.
+     * @param textChunk The document's page text from IndexSegment::packPageTexts(), or
+     * another segment's textChunk(); written out right away. May be empty.
+     */
+    void addDocument(const IndexSegmentDocument& document, const QByteArray& textChunk = QByteArray());
+
+    /**
+     * @brief Write the dictionary and document table and commit the file.
+     * @param error Receives a description on failure; may be null.
+     * @return True if the segment is on disk.
+     */
+    bool finish(QString* error = nullptr);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_INDEXSEGMENT_H
@@ -0,0 +1,298 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "TextDiff.h"
+#include <QHash>
+#include <QPair>
+#include <algorithm>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Nesting of patience passes before the rest is left to Myers; reversed
+// input would otherwise pair one line per pass
+const int MaxPatienceDepth = 32;
+
+class Differ
+{
+public:
+    Differ(const quint32* left, const quint32* right, QVector<TextDiff::Hunk>& out)
+        : a(left), b(right), hunks(out) {}
+
+    // Compares a[aStart..aEnd) with b[bStart..bEnd)
+    void run(int aStart, int aEnd, int bStart, int bEnd, bool patience, int depth) {
+        while (aStart < aEnd && bStart < bEnd && a[aStart] == b[bStart]) {
+            ++aStart;
+            ++bStart;
+        }
+        while (aStart < aEnd && bStart < bEnd && a[aEnd - 1] == b[bEnd - 1]) {
+            --aEnd;
+            --bEnd;
+        }
+        if (aStart == aEnd || bStart == bEnd) {
+            add(aStart, aEnd, bStart, bEnd);
+            return;
+        }
+        if (patience && depth < MaxPatienceDepth && anchor(aStart, aEnd, bStart, bEnd, depth)) return;
+
+        int x = 0;
+        int y = 0;
+        if (!bisect(aStart, aEnd - aStart, bStart, bEnd - bStart, &x, &y)) {
+            add(aStart, aEnd, bStart, bEnd);
+            return;
+        }
+        run(aStart, aStart + x, bStart, bStart + y, false, depth);
+        run(aStart + x, aEnd, bStart + y, bEnd, false, depth);
+    }
+
+private:
+    const quint32* a;
+    const quint32* b;
+    QVector<TextDiff::Hunk>& hunks;
+    QVector<int> forward;
+    QVector<int> backward;
+
+    // Records a[aStart..aEnd) as replaced by b[bStart..bEnd), joining it to
+    // a hunk that ends where it starts
+    void add(int aStart, int aEnd, int bStart, int bEnd) {
+        if (aStart == aEnd && bStart == bEnd) return;
+        if (!hunks.isEmpty()) {
+            TextDiff::Hunk& last = hunks.last();
+            if (last.leftStart + last.leftCount == aStart && last.rightStart + last.rightCount == bStart) {
+                last.leftCount += aEnd - aStart;
+                last.rightCount += bEnd - bStart;
+                return;
+            }
+        }
+        hunks.append({aStart, aEnd - aStart, bStart, bEnd - bStart});
+    }
+
+    // Pairs the symbols found exactly once on each side along their longest
+    // increasing run and compares the stretches between pairs. Returns false
+    // if there is nothing to pair.
+    bool anchor(int aStart, int aEnd, int bStart, int bEnd, int depth) {
+        struct Occurrence {
+            int leftCount;
+            int rightCount;
+            int rightPos;
+        };
+        QHash<quint32, Occurrence> seen;
+        seen.reserve(aEnd - aStart);
+        for (int i = aStart; i < aEnd; ++i) {
+            Occurrence& occurrence = seen[a[i]];
+            ++occurrence.leftCount;
+        }
+        for (int j = bStart; j < bEnd; ++j) {
+            auto it = seen.find(b[j]);
+            if (it == seen.end()) continue;
+            ++it->rightCount;
+            it->rightPos = j;
+        }
+
+        // Unique pairs in left order, then the longest run increasing on the right
+        QVector<QPair<int, int>> pairs;
+        for (int i = aStart; i < aEnd; ++i) {
+            const Occurrence occurrence = seen.value(a[i]);
+            if (occurrence.leftCount == 1 && occurrence.rightCount == 1) pairs.append(qMakePair(i, occurrence.rightPos));
+        }
+        if (pairs.isEmpty()) return false;
+
+        QVector<int> tails;            // Pair ending the best run of each length
+        QVector<int> previous(pairs.size(), -1);
+        for (int p = 0; p < pairs.size(); ++p) {
+            const int rightPos = pairs[p].second;
+            const auto at = std::lower_bound(tails.begin(), tails.end(), rightPos,
+                                             [&pairs](int tail, int value) { return pairs[tail].second < value; });
+            const int length = int(at - tails.begin());
+            if (length > 0) previous[p] = tails[length - 1];
+            if (at == tails.end()) tails.append(p);
+            else *at = p;
+        }
+        QVector<int> chain;
+        for (int p = tails.last(); p >= 0; p = previous[p]) chain.append(p);
+        std::reverse(chain.begin(), chain.end());
+
+        int leftFrom = aStart;
+        int rightFrom = bStart;
+        for (int p : chain) {
+            run(leftFrom, pairs[p].first, rightFrom, pairs[p].second, true, depth + 1);
+            leftFrom = pairs[p].first + 1;
+            rightFrom = pairs[p].second + 1;
+        }
+        run(leftFrom, aEnd, rightFrom, bEnd, true, depth + 1);
+        return true;
+    }
+
+    // Finds where the forward and backward searches of a[aStart..+n) and
+    // b[bStart..+m) meet. Neither side may start or end with a common symbol.
+    bool bisect(int aStart, int n, int bStart, int m, int* splitX, int* splitY) {
+        const quint32* left = a + aStart;
+        const quint32* right = b + bStart;
+        const int maxD = qMin((n + m + 1) / 2, TextDiff::MaxEditCost);
+        const int offset = maxD;
+        const int length = 2 * maxD + 2;
+        if (forward.size() < length) {
+            forward.resize(length);
+            backward.resize(length);
+        }
+        std::fill(forward.begin(), forward.begin() + length, -1);
+        std::fill(backward.begin(), backward.begin() + length, -1);
+        forward[offset + 1] = 0;
+        backward[offset + 1] = 0;
+
+        const int delta = n - m;
+        // With an odd delta the forward search finds the overlap, otherwise the backward one
+        const bool front = (delta % 2 != 0);
+        int k1start = 0;
+        int k1end = 0;
+        int k2start = 0;
+        int k2end = 0;
+        for (int d = 0; d < maxD; ++d) {
+            for (int k1 = -d + k1start; k1 <= d - k1end; k1 += 2) {
+                const int k1Offset = offset + k1;
+                int x1;
+                if (k1 == -d || (k1 != d && forward[k1Offset - 1] < forward[k1Offset + 1])) x1 = forward[k1Offset + 1];
+                else x1 = forward[k1Offset - 1] + 1;
+                int y1 = x1 - k1;
+                while (x1 < n && y1 < m && left[x1] == right[y1]) {
+                    ++x1;
+                    ++y1;
+                }
+                forward[k1Offset] = x1;
+                if (x1 > n) {
+                    k1end += 2;  // Ran off the right of the graph
+                } else if (y1 > m) {
+                    k1start += 2;  // Ran off the bottom
+                } else if (front) {
+                    const int k2Offset = offset + delta - k1;
+                    if (k2Offset >= 0 && k2Offset < length && backward[k2Offset] != -1) {
+                        if (x1 >= n - backward[k2Offset]) {
+                            *splitX = x1;
+                            *splitY = y1;
+                            return true;
+                        }
+                    }
+                }
+            }
+
+            for (int k2 = -d + k2start; k2 <= d - k2end; k2 += 2) {
+                const int k2Offset = offset + k2;
+                int x2;
+                if (k2 == -d || (k2 != d && backward[k2Offset - 1] < backward[k2Offset + 1])) x2 = backward[k2Offset + 1];
+                else x2 = backward[k2Offset - 1] + 1;
+                int y2 = x2 - k2;
+                while (x2 < n && y2 < m && left[n - x2 - 1] == right[m - y2 - 1]) {
+                    ++x2;
+                    ++y2;
+                }
+                backward[k2Offset] = x2;
+                if (x2 > n) {
+                    k2end += 2;
+                } else if (y2 > m) {
+                    k2start += 2;
+                } else if (!front) {
+                    const int k1Offset = offset + delta - k2;
+                    if (k1Offset >= 0 && k1Offset < length && forward[k1Offset] != -1) {
+                        const int x1 = forward[k1Offset];
+                        const int y1 = offset + x1 - k1Offset;
+                        if (x1 >= n - x2) {
+                            *splitX = x1;
+                            *splitY = y1;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+
+bool isWordPart(QChar c)
+{
+    return c.isLetterOrNumber() || c.isMark() || c.isSurrogate();
+}
+
+} // namespace
+
+QVector<TextDiff::Hunk> TextDiff::compare(const QVector<quint32>& left, const QVector<quint32>& right, bool patience)
+{
+    QVector<Hunk> hunks;
+    Differ(left.constData(), right.constData(), hunks).run(0, left.size(), 0, right.size(), patience, 0);
+    return hunks;
+}
+
+QVector<TextDiff::Hunk> TextDiff::compareStrings(const QStringList& left, const QStringList& right)
+{
+    // Equal strings get equal symbols, so comparing symbols is comparing strings
+    QHash<QString, quint32> ids;
+    ids.reserve(left.size() + right.size());
+    auto intern = [&ids](const QStringList& items) {
+        QVector<quint32> symbols;
+        symbols.reserve(items.size());
+        for (const QString& item : items) {
+            auto it = ids.constFind(item);
+            if (it == ids.constEnd()) it = ids.insert(item, quint32(ids.size()));
+            symbols.append(it.value());
+        }
+        return symbols;
+    };
+    const QVector<quint32> leftSymbols = intern(left);
+    const QVector<quint32> rightSymbols = intern(right);
+    return compare(leftSymbols, rightSymbols, true);
+}
+
+QVector<TextDiff::Hunk> TextDiff::compareCharacters(const QString& left, const QString& right)
+{
+    QVector<quint32> leftSymbols(left.size());
+    QVector<quint32> rightSymbols(right.size());
+    std::copy(left.utf16(), left.utf16() + left.size(), leftSymbols.begin());
+    std::copy(right.utf16(), right.utf16() + right.size(), rightSymbols.begin());
+    return compare(leftSymbols, rightSymbols, false);
+}
+
+QStringList TextDiff::splitLines(const QString& text)
+{
+    QStringList lines = text.split(QLatin1Char('\n'));
+    for (QString& line : lines) {
+        if (line.endsWith(QLatin1Char('\r'))) line.chop(1);
+    }
+    return lines;
+}
+
+QStringList TextDiff::splitWords(const QString& text)
+{
+    QStringList parts;
+    int start = 0;
+    while (start < text.size()) {
+        const QChar first = text.at(start);
+        int end = start + 1;
+        if (isWordPart(first)) {
+            while (end < text.size() && isWordPart(text.at(end))) ++end;
+        } else if (first.isSpace()) {
+            while (end < text.size() && text.at(end).isSpace()) ++end;
+        }
+        parts.append(text.mid(start, end - start));
+        start = end;
+    }
+    return parts;
+}
+
+float TextDiff::similarity(const QString& left, const QString& right)
+{
+    if (left == right) return 1.0f;
+    if (left.isEmpty() || right.isEmpty()) return 0.0f;
+
+    int changed = 0;
+    for (const Hunk& hunk : compareCharacters(left, right)) changed += hunk.leftCount + hunk.rightCount;
+    return 1.0f - float(changed) / float(left.size() + right.size());
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,101 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_TEXTDIFF_H
+#define QUANTILYX_TEXTDIFF_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Finds the shortest edit between two sequences of lines, words or characters.
+ *
+ * Sequences are compared with Myers' O(ND) algorithm in its linear-space
+ * form: each step searches forwards and backwards at once for the middle
+ * snake of the edit, then splits there, so memory stays proportional to
+ * the input however different the two sides are. Before that, items that
+ * occur exactly once on each side are paired patience-style, along their
+ * longest common run in order, and the stretches between them compared on
+ * their own; a moved paragraph or a repeated header then does not pair
+ * unrelated lines. A stretch needing more than MaxEditCost edits is
+ * reported as replaced wholesale rather than searched further.
+ */
+class TextDiff
+{
+public:
+    /// Edits searched for within one stretch before it is given up as replaced
+    static const int MaxEditCost = 4096;
+
+    /**
+     * @brief A changed stretch: leftCount items at leftStart became rightCount items at rightStart.
+     * One of the counts is 0 for a pure insertion or deletion. Items
+     * between hunks are equal on both sides.
+     */
+    struct Hunk {
+        int leftStart;
+        int leftCount;
+        int rightStart;
+        int rightCount;
+    };
+
+    /**
+     * @brief Compare two sequences of symbols.
+     * @param left Symbols of the left side, e.g. interned lines.
+     * @param right Symbols of the right side.
+     * @param patience Whether to pair unique symbols first; worth it for lines and words, not characters.
+     * @return Hunks in order.
+     */
+    static QVector<Hunk> compare(const QVector<quint32>& left, const QVector<quint32>& right, bool patience = true);
+
+    /**
+     * @brief Compare two lists of lines or words.
+     * @param left Items of the left side.
+     * @param right Items of the right side.
+     * @return Hunks in order, in items.
+     */
+    static QVector<Hunk> compareStrings(const QStringList& left, const QStringList& right);
+
+    /**
+     * @brief Compare two strings character by character.
+     * @param left Left text.
+     * @param right Right text.
+     * @return Hunks in order, in UTF-16 code units.
+     */
+    static QVector<Hunk> compareCharacters(const QString& left, const QString& right);
+
+    /**
+     * @brief Split text into lines, dropping the line breaks.
+     * @param text Text with \\n or \\r\\n line breaks.
+     * @return Lines; one empty line for empty text.
+     */
+    static QStringList splitLines(const QString& text);
+
+    /**
+     * @brief Split text into words, runs of spaces and single punctuation marks.
+     * Joining the parts gives the text back.
+     * @param text Text to split.
+     * @return Parts in order.
+     */
+    static QStringList splitWords(const QString& text);
+
+    /**
+     * @brief Measure how much of two strings survives their shortest character edit.
+     * @param left Left text.
+     * @param right Right text.
+     * @return Twice the unchanged characters over both lengths: 1.0 for equal strings, 0.0 for nothing in common.
+     */
+    static float similarity(const QString& left, const QString& right);
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_TEXTDIFF_H
@@ -0,0 +1,311 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "Tokenizer.h"
+#include <QTextBoundaryFinder>
+#include <cstring>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// The Porter (1980) suffix stripper over b[0..k], after Martin Porter's
+// reference implementation. Suffixes are length-prefixed strings.
+class PorterStemmer
+{
+public:
+    PorterStemmer(char* buffer, int last) : b(buffer), k(last), j(0) {}
+
+    // Returns the index of the stem's last character
+    int run() {
+        if (k <= 1) return k; // Words of one or two letters are left alone
+        step1ab();
+        if (k > 0) {
+            step1c();
+            step2();
+            step3();
+            step4();
+            step5();
+        }
+        return k;
+    }
+
+private:
+    char* b;
+    int k;
+    int j;
+
+    bool cons(int i) const {
+        switch (b[i]) {
+        case 'a': case 'e': case 'i': case 'o': case 'u':
+            return false;
+        case 'y':
+            return i == 0 ? true : !cons(i - 1);
+        default:
+            return true;
+        }
+    }
+
+    // Number of vowel-consonant sequences in b[0..j]
+    int m() const {
+        int n = 0;
+        int i = 0;
+        for (;;) {
+            if (i > j) return n;
+            if (!cons(i)) break;
+            ++i;
+        }
+        ++i;
+        for (;;) {
+            for (;;) {
+                if (i > j) return n;
+                if (cons(i)) break;
+                ++i;
+            }
+            ++i;
+            ++n;
+            for (;;) {
+                if (i > j) return n;
+                if (!cons(i)) break;
+                ++i;
+            }
+            ++i;
+        }
+    }
+
+    bool vowelInStem() const {
+        for (int i = 0; i <= j; ++i) {
+            if (!cons(i)) return true;
+        }
+        return false;
+    }
+
+    bool doubleConsonant(int at) const {
+        return at >= 1 && b[at] == b[at - 1] && cons(at);
+    }
+
+    // Consonant-vowel-consonant ending at i, the last not w, x or y
+    bool cvc(int i) const {
+        if (i < 2 || !cons(i) || cons(i - 1) || !cons(i - 2)) return false;
+        return b[i] != 'w' && b[i] != 'x' && b[i] != 'y';
+    }
+
+    bool ends(const char* s) {
+        const int length = s[0];
+        if (length > k + 1 || s[length] != b[k]) return false;
+        if (std::memcmp(b + k - length + 1, s + 1, size_t(length)) != 0) return false;
+        j = k - length;
+        return true;
+    }
+
+    void setTo(const char* s) {
+        const int length = s[0];
+        std::memmove(b + j + 1, s + 1, size_t(length));
+        k = j + length;
+    }
+
+    void replace(const char* s) {
+        if (m() > 0) setTo(s);
+    }
+
+    // Plurals and -ed or -ing
+    void step1ab() {
+        if (b[k] == 's') {
+            if (ends("\04" "sses")) k -= 2;
+            else if (ends("\03" "ies")) setTo("\01" "i");
+            else if (b[k - 1] != 's') --k;
+        }
+        if (ends("\03" "eed")) {
+            if (m() > 0) --k;
+        } else if ((ends("\02" "ed") || ends("\03" "ing")) && vowelInStem()) {
+            k = j;
+            if (ends("\02" "at")) setTo("\03" "ate");
+            else if (ends("\02" "bl")) setTo("\03" "ble");
+            else if (ends("\02" "iz")) setTo("\03" "ize");
+            else if (doubleConsonant(k)) {
+                --k;
+                if (b[k] == 'l' || b[k] == 's' || b[k] == 'z') ++k;
+            } else if (m() == 1 && cvc(k)) {
+                setTo("\01" "e");
+            }
+        }
+    }
+
+    // Terminal y to i when there is another vowel in the stem
+    void step1c() {
+        if (ends("\01" "y") && vowelInStem()) b[k] = 'i';
+    }
+
+    // Double suffixes to single ones
+    void step2() {
+        switch (b[k - 1]) {
+        case 'a':
+            if (ends("\07" "ational")) { replace("\03" "ate"); break; }
+            if (ends("\06" "tional")) { replace("\04" "tion"); break; }
+            break;
+        case 'c':
+            if (ends("\04" "enci")) { replace("\04" "ence"); break; }
+            if (ends("\04" "anci")) { replace("\04" "ance"); break; }
+            break;
+        case 'e':
+            if (ends("\04" "izer")) { replace("\03" "ize"); break; }
+            break;
+        case 'l':
+            if (ends("\03" "bli")) { replace("\03" "ble"); break; }
+            if (ends("\04" "alli")) { replace("\02" "al"); break; }
+            if (ends("\05" "entli")) { replace("\03" "ent"); break; }
+            if (ends("\03" "eli")) { replace("\01" "e"); break; }
+            if (ends("\05" "ousli")) { replace("\03" "ous"); break; }
+            break;
+        case 'o':
+            if (ends("\07" "ization")) { replace("\03" "ize"); break; }
+            if (ends("\05" "ation")) { replace("\03" "ate"); break; }
+            if (ends("\04" "ator")) { replace("\03" "ate"); break; }
+            break;
+        case 's':
+            if (ends("\05" "alism")) { replace("\02" "al"); break; }
+            if (ends("\07" "iveness")) { replace("\03" "ive"); break; }
+            if (ends("\07" "fulness")) { replace("\03" "ful"); break; }
+            if (ends("\07" "ousness")) { replace("\03" "ous"); break; }
+            break;
+        case 't':
+            if (ends("\05" "aliti")) { replace("\02" "al"); break; }
+            if (ends("\05" "iviti")) { replace("\03" "ive"); break; }
+            if (ends("\06" "biliti")) { replace("\03" "ble"); break; }
+            break;
+        case 'g':
+            if (ends("\04" "logi")) { replace("\03" "log"); break; }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // -ic-, -full, -ness and the like
+    void step3() {
+        switch (b[k]) {
+        case 'e':
+            if (ends("\05" "icate")) { replace("\02" "ic"); break; }
+            if (ends("\05" "ative")) { replace("\00" ""); break; }
+            if (ends("\05" "alize")) { replace("\02" "al"); break; }
+            break;
+        case 'i':
+            if (ends("\05" "iciti")) { replace("\02" "ic"); break; }
+            break;
+        case 'l':
+            if (ends("\04" "ical")) { replace("\02" "ic"); break; }
+            if (ends("\03" "ful")) { replace("\00" ""); break; }
+            break;
+        case 's':
+            if (ends("\04" "ness")) { replace("\00" ""); break; }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // -ant, -ence and the like, in a long enough stem
+    void step4() {
+        switch (b[k - 1]) {
+        case 'a':
+            if (ends("\02" "al")) break;
+            return;
+        case 'c':
+            if (ends("\04" "ance") || ends("\04" "ence")) break;
+            return;
+        case 'e':
+            if (ends("\02" "er")) break;
+            return;
+        case 'i':
+            if (ends("\02" "ic")) break;
+            return;
+        case 'l':
+            if (ends("\04" "able") || ends("\04" "ible")) break;
+            return;
+        case 'n':
+            if (ends("\03" "ant") || ends("\05" "ement") || ends("\04" "ment") || ends("\03" "ent")) break;
+            return;
+        case 'o':
+            if (ends("\03" "ion") && j >= 0 && (b[j] == 's' || b[j] == 't')) break;
+            if (ends("\02" "ou")) break;
+            return;
+        case 's':
+            if (ends("\03" "ism")) break;
+            return;
+        case 't':
+            if (ends("\03" "ate") || ends("\03" "iti")) break;
+            return;
+        case 'u':
+            if (ends("\03" "ous")) break;
+            return;
+        case 'v':
+            if (ends("\03" "ive")) break;
+            return;
+        case 'z':
+            if (ends("\03" "ize")) break;
+            return;
+        default:
+            return;
+        }
+        if (m() > 1) k = j;
+    }
+
+    // A final -e, and -ll to -l, in a long enough stem
+    void step5() {
+        j = k;
+        if (b[k] == 'e') {
+            const int a = m();
+            if (a > 1 || (a == 1 && !cvc(k - 1))) --k;
+        }
+        if (b[k] == 'l' && doubleConsonant(k) && m() > 1) --k;
+    }
+};
+
+} // namespace
+
+Tokenizer::Tokenizer(bool stemming)
+    : m_stemming(stemming)
+{
+}
+
+bool Tokenizer::isStemming() const
+{
+    return m_stemming;
+}
+
+void Tokenizer::tokenize(const QString& text, const std::function<void(const QByteArray& term, int offset)>& sink) const
+{
+    QTextBoundaryFinder finder(QTextBoundaryFinder::Word, text);
+    int start = 0;
+    for (int end = finder.toNextBoundary(); end >= 0; start = end, end = finder.toNextBoundary()) {
+        // Between boundaries is a word, a run of spaces or a punctuation mark
+        if (!(finder.boundaryReasons() & QTextBoundaryFinder::EndOfItem)) continue;
+        const QChar first = text.at(start);
+        if (!first.isLetterOrNumber() && !first.isHighSurrogate()) continue;
+
+        QByteArray term = text.midRef(start, end - start).toString().toCaseFolded().toUtf8();
+        if (term.size() > MaxTermBytes) continue;
+        if (m_stemming) term = stem(term);
+        sink(term, start);
+    }
+}
+
+QByteArray Tokenizer::stem(const QByteArray& word)
+{
+    for (char c : word) {
+        if (c < 'a' || c > 'z') return word;
+    }
+    QByteArray stemmed = word;
+    stemmed.detach();
+    const int last = PorterStemmer(stemmed.data(), stemmed.size() - 1).run();
+    stemmed.truncate(last + 1);
+    return stemmed;
+}
+
+} // namespace QuantilyxDoc
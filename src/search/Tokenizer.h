@@ -0,0 +1,69 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_TOKENIZER_H
+#define QUANTILYX_TOKENIZER_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Splits text into index terms in one pass.
+ *
+ * Words are found with Unicode word boundaries (UAX #29, through
+ * QTextBoundaryFinder), so scripts without spaces and words with
+ * apostrophes or combining marks break the way the user expects. Each
+ * term is case-folded UTF-8 and reported with the character offset where
+ * its word starts. With stemming on, English words are reduced to their
+ * Porter stem, so "indexing" and "indexed" find each other; words with
+ * other letters are left as they are. Terms longer than MaxTermBytes are
+ * dropped: they are hashes and encodings, not words.
+ */
+class Tokenizer
+{
+public:
+    /// Longest term kept, in UTF-8 bytes
+    static const int MaxTermBytes = 64;
+
+    /**
+     * @brief Create a tokenizer.
+     * @param stemming Whether to reduce English words to their stems.
+     */
+    explicit Tokenizer(bool stemming = false);
+
+    /**
+     * @brief Check whether stemming is on.
+     * @return True if terms are stemmed.
+     */
+    bool isStemming() const;
+
+    /**
+     * @brief Report every term of a text, in order.
+     * @param text Text to split.
+     * @param sink Called with each term and the offset of its word in text.
+     */
+    void tokenize(const QString& text, const std::function<void(const QByteArray& term, int offset)>& sink) const;
+
+    /**
+     * @brief Reduce a lower-case English word to its Porter stem.
+     * @param word Word of ASCII letters; anything else is returned unchanged.
+     * @return The stem.
+     */
+    static QByteArray stem(const QByteArray& word);
+
+private:
+    bool m_stemming;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_TOKENIZER_H
@@ -10,10 +10,10 @@
 #include "PasswordRemover.h"
 #include "../core/Document.h"
 #include "../core/Logger.h"
+#include "PdfRewriteJob.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
-#include <QProcess>
 #include <QStandardPaths>
 #include <QMutex>
 #include <QMutexLocker>
@@ -31,6 +31,21 @@ public:
     mutable QMutex mutex; // Protect access if needed during process execution
     QString externalToolPathStr;
 
+    // Forward a job's signals, queued to this object's thread, and delete it when done
+    void watch(PdfRewriteJob* job, bool singleFile) {
+        QObject::connect(job, &PdfRewriteJob::fileStarted, q, &PasswordRemover::removalStarted);
+        QObject::connect(job, &PdfRewriteJob::fileFinished, q, &PasswordRemover::removalFinished);
+        QObject::connect(job, &PdfRewriteJob::fileFailed, q, &PasswordRemover::removalFailed);
+        if (singleFile) {
+            QObject::connect(job, &PdfRewriteJob::fileProgress, q,
+                             [this](const QString&, int percent) { emit q->removalProgress(percent); });
+        } else {
+            QObject::connect(job, &PdfRewriteJob::progress, q,
+                             [this](int done, int total) { emit q->removalProgress(done * 100 / qMax(1, total)); });
+        }
+        QObject::connect(job, &PdfRewriteJob::finished, job, &QObject::deleteLater);
+    }
+
     // Helper to find the QPDF executable
     QString findQpdfExecutable() const {
         QStringList possibleNames = {
@@ -90,53 +105,17 @@ PasswordRemover::~PasswordRemover()
 
 bool PasswordRemover::removePassword(const QString& inputFilePath, const QString& outputFilePath, const QString& userPassword)
 {
-    QString qpdfPath = d->findQpdfExecutable();
-    if (qpdfPath.isEmpty()) {
-        LOG_ERROR("PasswordRemover::removePassword: QPDF executable not found.");
-        emit removalFailed(inputFilePath, "QPDF tool not found. Please install QPDF.");
-        return false;
-    }
-
     emit removalStarted(inputFilePath);
-
-    // Build QPDF command arguments
-    // Example: qpdf --password=<user_password> --remove-password input.pdf output.pdf
-    QStringList args;
-    if (!userPassword.isEmpty()) {
-        args << "--password=" + userPassword;
-    } else {
-        // If no password provided, qpdf might try to open without one (if it's an open-password doc with only owner pwd)
-        // Or it might fail. Let's assume owner password removal works without user password if possible.
-        // QPDF might have other flags for specific scenarios.
+    if (userPassword.isEmpty()) {
         LOG_WARN("PasswordRemover::removePassword: No password provided. Attempting removal without password (may fail if file is open-password protected).");
     }
-    args << "--remove-password" << inputFilePath << outputFilePath;
-
-    LOG_DEBUG("PasswordRemover::removePassword: Executing: " << qpdfPath << " " << args.join(" "));
-
-    // Run QPDF process
-    QProcess qpdfProcess;
-    qpdfProcess.start(qpdfPath, args);
-    bool finished = qpdfProcess.waitForFinished(-1); // Wait indefinitely, or set a timeout
-
-    if (!finished) {
-        QString error = "QPDF process did not finish.";
-        LOG_ERROR("PasswordRemover::removePassword: " << error);
-        emit removalFailed(inputFilePath, error);
-        return false;
-    }
-
-    if (qpdfProcess.exitCode() != 0) {
-        QString errorOutput = qpdfProcess.readAllStandardError();
-        LOG_ERROR("PasswordRemover::removePassword: QPDF failed with exit code " << qpdfProcess.exitCode() << ". Error: " << errorOutput);
-        emit removalFailed(inputFilePath, errorOutput);
-        return false;
-    }
 
-    // Check if output file was created
-    if (!QFile::exists(outputFilePath)) {
-        QString error = "QPDF did not create output file: " + outputFilePath;
-        LOG_ERROR("PasswordRemover::removePassword: " << error);
+    // Streamed through libqpdf in this thread; removePasswordInBackground() keeps the caller free
+    QString error;
+    const bool success = PdfRewriteJob::rewriteFile(PdfRewriteJob::Mode::RemovePassword, inputFilePath, outputFilePath,
+                                                    userPassword, [this](int percent) { emit removalProgress(percent); },
+                                                    nullptr, &error);
+    if (!success) {
         emit removalFailed(inputFilePath, error);
         return false;
     }
@@ -146,6 +125,31 @@ bool PasswordRemover::removePassword(const QString& inputFilePath, const QString
     return true;
 }
 
+PdfRewriteJob* PasswordRemover::removePasswordInBackground(const QString& inputFilePath, const QString& outputFilePath, const QString& userPassword)
+{
+    PdfRewriteJob* job = new PdfRewriteJob(PdfRewriteJob::Mode::RemovePassword, this);
+    job->setPassword(userPassword);
+    job->addFile(inputFilePath, outputFilePath);
+    d->watch(job, true);
+    job->start();
+    return job;
+}
+
+PdfRewriteJob* PasswordRemover::removePasswordsInDirectory(const QString& inputDir, const QString& outputDir, const QString& userPassword, int jobs)
+{
+    PdfRewriteJob* job = new PdfRewriteJob(PdfRewriteJob::Mode::RemovePassword, this);
+    job->setPassword(userPassword);
+    job->setJobs(jobs);
+    if (job->addDirectory(inputDir, outputDir) == 0) {
+        LOG_WARN("PasswordRemover::removePasswordsInDirectory: No PDF files in " << inputDir);
+        delete job;
+        return nullptr;
+    }
+    d->watch(job, false);
+    job->start();
+    return job;
+}
+
 bool PasswordRemover::removePasswordFromDocument(Document* document, const QString& userPassword)
 {
     if (!document) {
@@ -17,6 +17,7 @@
 namespace QuantilyxDoc {
 
 class Document; // Forward declaration
+class PdfRewriteJob;
 
 /**
  * @brief Removes passwords from documents that support it.
@@ -56,6 +57,30 @@ public:
      */
     bool removePassword(const QString& inputFilePath, const QString& outputFilePath, const QString& userPassword = QString());
 
+    /**
+     * @brief Remove the password from a document file in the background.
+     * Returns at once; the removal* signals report the outcome. The file is
+     * rewritten in one streaming pass, so files of any size can be processed.
+     * @param inputFilePath Path to the input file.
+     * @param outputFilePath Path to save the output file.
+     * @param userPassword The user password (if required for opening, but not owner password).
+     * @return The running job, for cancel(); it deletes itself once finished.
+     */
+    PdfRewriteJob* removePasswordInBackground(const QString& inputFilePath, const QString& outputFilePath, const QString& userPassword = QString());
+
+    /**
+     * @brief Remove the password from every PDF of a directory, several files at once.
+     * Outputs keep their relative names under outputDir. removalProgress()
+     * reports the share of files done.
+     * @param inputDir Directory to read, with its subdirectories.
+     * @param outputDir Directory to write.
+     * @param userPassword The password every file is opened with.
+     * @param jobs Files processed at once; 0 or less means one per CPU.
+     * @return The running job, for cancel() and its per-file signals; it deletes
+     *         itself once finished. Null if the directory holds no PDF.
+     */
+    PdfRewriteJob* removePasswordsInDirectory(const QString& inputDir, const QString& outputDir, const QString& userPassword = QString(), int jobs = 0);
+
     /**
      * @brief Remove the password from an already loaded Document object.
      * This might involve saving the document to a temporary file, unlocking it, and reloading.
@@ -120,6 +145,7 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static PasswordRemover* s_instance;
 
     // Helper to find the external tool executable (e.g., qpdf)
     QString findExternalTool() const;
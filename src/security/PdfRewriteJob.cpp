@@ -0,0 +1,261 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "PdfRewriteJob.h"
+#include "../core/Logger.h"
+#include "../core/ThreadPool.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/QPDFWriter.hh>
+#include <cstdio>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Thrown from the progress reporter to abandon a write
+struct RewriteCanceled {};
+
+class Reporter : public QPDFWriter::ProgressReporter
+{
+public:
+    Reporter(const std::function<void(int)>& progress, const std::atomic<bool>* canceled)
+        : m_progress(progress), m_canceled(canceled) {}
+
+    void reportProgress(int percent) override {
+        if (m_canceled && m_canceled->load()) throw RewriteCanceled();
+        if (m_progress) m_progress(percent);
+    }
+
+private:
+    const std::function<void(int)>& m_progress;
+    const std::atomic<bool>* m_canceled;
+};
+
+} // namespace
+
+class PdfRewriteJob::Private {
+public:
+    Private(PdfRewriteJob* q_ptr, Mode m)
+        : q(q_ptr), mode(m), jobs(0), done(0), failed(0), cancelRequested(false), running(false) {}
+
+    PdfRewriteJob* q;
+    Mode mode;
+    QString password;
+    int jobs;
+    QVector<QPair<QString, QString>> files; // Input, output
+
+    std::unique_ptr<ThreadPool> pool;
+    std::atomic<int> done;
+    std::atomic<int> failed;
+    std::atomic<bool> cancelRequested;
+    std::atomic<bool> running;
+    QMutex runMutex;
+    QWaitCondition stopped;
+
+    int jobCount() const {
+        return jobs > 0 ? jobs : qMax(1, QThread::idealThreadCount());
+    }
+
+    void rewrite(const QString& input, const QString& output) {
+        QString error;
+        bool written = false;
+        if (cancelRequested) {
+            error = QStringLiteral("Canceled");
+        } else {
+            emit q->fileStarted(input);
+            written = rewriteFile(mode, input, output, password,
+                                  [this, &input](int percent) { emit q->fileProgress(input, percent); },
+                                  &cancelRequested, &error);
+        }
+        if (written) {
+            emit q->fileFinished(input, output);
+        } else {
+            ++failed;
+            emit q->fileFailed(input, error);
+        }
+
+        const int finishedCount = ++done;
+        emit q->progress(finishedCount, files.size());
+        if (finishedCount == files.size()) {
+            const int failedCount = failed;
+            LOG_INFO("PdfRewriteJob: " << (files.size() - failedCount) << " of " << files.size() << " files rewritten.");
+            emit q->finished(failedCount);
+            // Last: once running is false the job may be deleted
+            QMutexLocker locker(&runMutex);
+            running = false;
+            stopped.wakeAll();
+        }
+    }
+};
+
+PdfRewriteJob::PdfRewriteJob(Mode mode, QObject* parent)
+    : QObject(parent)
+    , d(new Private(this, mode))
+{
+}
+
+PdfRewriteJob::~PdfRewriteJob()
+{
+    cancel();
+    waitForFinished();
+}
+
+void PdfRewriteJob::setPassword(const QString& password)
+{
+    d->password = password;
+}
+
+void PdfRewriteJob::setJobs(int jobs)
+{
+    d->jobs = jobs;
+}
+
+int PdfRewriteJob::jobs() const
+{
+    return d->jobCount();
+}
+
+void PdfRewriteJob::addFile(const QString& inputPath, const QString& outputPath)
+{
+    if (d->running) return;
+    d->files.append(qMakePair(inputPath, outputPath));
+}
+
+int PdfRewriteJob::addDirectory(const QString& inputDir, const QString& outputDir, bool recursive)
+{
+    if (d->running) return 0;
+    const QDir input(inputDir);
+    const QDir output(outputDir);
+    int added = 0;
+    QDirIterator it(inputDir, QStringList() << "*.pdf" << "*.PDF", QDir::Files,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        d->files.append(qMakePair(path, output.filePath(input.relativeFilePath(path))));
+        ++added;
+    }
+    LOG_DEBUG("PdfRewriteJob: " << added << " PDF files found in " << inputDir);
+    return added;
+}
+
+int PdfRewriteJob::fileCount() const
+{
+    return d->files.size();
+}
+
+bool PdfRewriteJob::start()
+{
+    if (d->running || d->files.isEmpty()) return false;
+    d->running = true;
+    d->cancelRequested = false;
+    d->done = 0;
+    d->failed = 0;
+    if (!d->pool || d->pool->maxThreadCount() != d->jobCount()) {
+        d->pool.reset(new ThreadPool("PDF rewrite", d->jobCount()));
+    }
+    LOG_INFO("PdfRewriteJob: Rewriting " << d->files.size() << " files, " << d->jobCount() << " at a time.");
+    for (const auto& file : d->files) {
+        const QString input = file.first;
+        const QString output = file.second;
+        d->pool->submitDetached([this, input, output]() { d->rewrite(input, output); });
+    }
+    return true;
+}
+
+void PdfRewriteJob::cancel()
+{
+    d->cancelRequested = true;
+}
+
+bool PdfRewriteJob::isRunning() const
+{
+    return d->running;
+}
+
+void PdfRewriteJob::waitForFinished()
+{
+    QMutexLocker locker(&d->runMutex);
+    while (d->running) d->stopped.wait(&d->runMutex);
+}
+
+bool PdfRewriteJob::rewriteFile(Mode mode, const QString& inputPath, const QString& outputPath, const QString& password,
+                                const std::function<void(int)>& progress, const std::atomic<bool>* canceled,
+                                QString* error)
+{
+    auto fail = [&](const QString& message) {
+        LOG_ERROR("PdfRewriteJob: " << inputPath << ": " << message);
+        if (error) *error = message;
+        return false;
+    };
+
+    const QFileInfo inputInfo(inputPath);
+    if (!inputInfo.isFile()) return fail(QStringLiteral("File not found"));
+    if (inputInfo.absoluteFilePath() == QFileInfo(outputPath).absoluteFilePath()) {
+        return fail(QStringLiteral("Output would overwrite the input"));
+    }
+    if (!QDir().mkpath(QFileInfo(outputPath).absolutePath())) {
+        return fail(QStringLiteral("Cannot create the directory of %1").arg(outputPath));
+    }
+
+    // Written beside the output and renamed once complete
+    const QString partialPath = outputPath + QStringLiteral(".part");
+    const QByteArray password8 = password.toUtf8();
+    try {
+        QPDF pdf;
+        pdf.setSuppressWarnings(true);
+        // Only the cross-reference table is read here; objects load as they are written
+        pdf.processFile(QFile::encodeName(inputPath).constData(),
+                        password.isEmpty() ? nullptr : password8.constData());
+        if (!pdf.isEncrypted()) {
+            LOG_DEBUG("PdfRewriteJob: " << inputPath << " is not encrypted; rewritten anyway.");
+        }
+
+        QPDFWriter writer(pdf, QFile::encodeName(partialPath).constData());
+        writer.setPreserveEncryption(false);
+        writer.setDecodeLevel(qpdf_dl_none); // Streams are decrypted, never decoded
+        writer.setObjectStreamMode(qpdf_o_generate);
+        writer.registerProgressReporter(std::make_shared<Reporter>(progress, canceled));
+        writer.write();
+        if (pdf.anyWarnings()) LOG_WARN("PdfRewriteJob: " << inputPath << " was damaged; QPDF repaired what it could.");
+    } catch (const RewriteCanceled&) {
+        QFile::remove(partialPath);
+        if (error) *error = QStringLiteral("Canceled");
+        LOG_INFO("PdfRewriteJob: Rewrite of " << inputPath << " canceled.");
+        return false;
+    } catch (const QPDFExc& e) {
+        QFile::remove(partialPath);
+        if (e.getErrorCode() == qpdf_e_password) return fail(QStringLiteral("Invalid password"));
+        return fail(QString::fromStdString(e.getMessageDetail()));
+    } catch (const std::exception& e) {
+        QFile::remove(partialPath);
+        return fail(QString::fromLocal8Bit(e.what()));
+    }
+
+    // Replaces an existing output in one step, so it is never left missing
+    if (std::rename(QFile::encodeName(partialPath).constData(), QFile::encodeName(outputPath).constData()) != 0) {
+        QFile::remove(partialPath);
+        return fail(QStringLiteral("Cannot write %1").arg(outputPath));
+    }
+    LOG_INFO("PdfRewriteJob: " << inputPath << (mode == Mode::RemovePassword ? " unlocked" : " unrestricted")
+             << ", written to " << outputPath);
+    return true;
+}
+
+} // namespace QuantilyxDoc
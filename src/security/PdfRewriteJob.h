@@ -0,0 +1,188 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_PDFREWRITEJOB_H
+#define QUANTILYX_PDFREWRITEJOB_H
+
+#include <QObject>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Rewrites PDF files without their encryption, in the background.
+ *
+ * Each file is opened with libqpdf, which reads the cross-reference table
+ * and loads objects only as the writer reaches them; stream data is
+ * decrypted and copied through without being decoded, and the output packs
+ * small objects into object streams. Memory use therefore follows the
+ * object count rather than the file size, and multi-gigabyte files are
+ * written in one pass.
+ *
+ * Up to jobs() files are rewritten at once on a pool of the job's own.
+ * Output is written next to its final name and renamed into place when
+ * complete, so a canceled or failed file leaves nothing behind.
+ *
+ * Signals are emitted from worker threads. Deleting the job cancels it and
+ * waits for the files in progress.
+ */
+class PdfRewriteJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief What the rewrite removes.
+     */
+    enum class Mode {
+        RemovePassword,    ///< Open with the given password; write without encryption
+        RemoveRestrictions ///< Open without a password; write without encryption or permissions
+    };
+
+    /**
+     * @brief Constructor.
+     * @param mode What the rewrite removes.
+     * @param parent Parent object.
+     */
+    explicit PdfRewriteJob(Mode mode, QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor. Cancels the job and waits for it to stop.
+     */
+    ~PdfRewriteJob() override;
+
+    /**
+     * @brief Set the password the files are opened with.
+     * @param password User or owner password; empty for none.
+     */
+    void setPassword(const QString& password);
+
+    /**
+     * @brief Set how many files are rewritten at once.
+     * @param jobs File count; 0 or less means one per CPU.
+     */
+    void setJobs(int jobs);
+
+    /**
+     * @brief Get how many files are rewritten at once.
+     * @return File count.
+     */
+    int jobs() const;
+
+    /**
+     * @brief Add a file to rewrite.
+     * @param inputPath PDF to read.
+     * @param outputPath File to write; must differ from inputPath.
+     */
+    void addFile(const QString& inputPath, const QString& outputPath);
+
+    /**
+     * @brief Add every PDF of a directory, written to another one under the same relative names.
+     * @param inputDir Directory to read.
+     * @param outputDir Directory to write; created as needed.
+     * @param recursive Also take the PDFs of subdirectories.
+     * @return Number of files added.
+     */
+    int addDirectory(const QString& inputDir, const QString& outputDir, bool recursive = true);
+
+    /**
+     * @brief Get the number of files added.
+     * @return File count.
+     */
+    int fileCount() const;
+
+    /**
+     * @brief Start rewriting the files added.
+     * @return True if started; false if running or there is nothing to do.
+     */
+    bool start();
+
+    /**
+     * @brief Stop. Files in progress are abandoned at their next progress step.
+     */
+    void cancel();
+
+    /**
+     * @brief Check if the job is running.
+     * @return True between start() and finished().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Block until the job stops.
+     */
+    void waitForFinished();
+
+    /**
+     * @brief Rewrite one file in the calling thread.
+     * @param mode What the rewrite removes.
+     * @param inputPath PDF to read.
+     * @param outputPath File to write.
+     * @param password Password to open it with; empty for none.
+     * @param progress Called with 0-100 as the output is written; may be empty.
+     * @param canceled Checked at each progress step; may be null.
+     * @param error Receives the reason on failure; may be null.
+     * @return True if the output was written.
+     */
+    static bool rewriteFile(Mode mode, const QString& inputPath, const QString& outputPath, const QString& password,
+                            const std::function<void(int)>& progress, const std::atomic<bool>* canceled,
+                            QString* error);
+
+signals:
+    /**
+     * @brief Emitted when a file is opened.
+     * @param inputPath Path of the file.
+     */
+    void fileStarted(const QString& inputPath);
+
+    /**
+     * @brief Emitted as a file is written.
+     * @param inputPath Path of the file.
+     * @param percent Progress of the file (0-100).
+     */
+    void fileProgress(const QString& inputPath, int percent);
+
+    /**
+     * @brief Emitted when a file is written.
+     * @param inputPath Path of the file.
+     * @param outputPath Path of the output.
+     */
+    void fileFinished(const QString& inputPath, const QString& outputPath);
+
+    /**
+     * @brief Emitted when a file cannot be rewritten, or was canceled.
+     * @param inputPath Path of the file.
+     * @param error Error message.
+     */
+    void fileFailed(const QString& inputPath, const QString& error);
+
+    /**
+     * @brief Emitted after each file.
+     * @param filesDone Files finished or failed so far.
+     * @param fileCount Files in the job.
+     */
+    void progress(int filesDone, int fileCount);
+
+    /**
+     * @brief Emitted when the job stops.
+     * @param failedCount Files that were not written.
+     */
+    void finished(int failedCount);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_PDFREWRITEJOB_H
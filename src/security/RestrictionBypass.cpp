@@ -10,6 +10,7 @@
 #include "RestrictionBypass.h"
 #include "../core/Document.h"
 #include "../core/Logger.h"
+#include "PdfRewriteJob.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
@@ -31,6 +32,21 @@ public:
     mutable QMutex mutex; // Protect access if needed during process execution
     QString externalToolPathStr;
 
+    // Forward a job's signals, queued to this object's thread, and delete it when done
+    void watch(PdfRewriteJob* job, bool singleFile) {
+        QObject::connect(job, &PdfRewriteJob::fileStarted, q, &RestrictionBypass::bypassStarted);
+        QObject::connect(job, &PdfRewriteJob::fileFinished, q, &RestrictionBypass::bypassFinished);
+        QObject::connect(job, &PdfRewriteJob::fileFailed, q, &RestrictionBypass::bypassFailed);
+        if (singleFile) {
+            QObject::connect(job, &PdfRewriteJob::fileProgress, q,
+                             [this](const QString&, int percent) { emit q->bypassProgress(percent); });
+        } else {
+            QObject::connect(job, &PdfRewriteJob::progress, q,
+                             [this](int done, int total) { emit q->bypassProgress(done * 100 / qMax(1, total)); });
+        }
+        QObject::connect(job, &PdfRewriteJob::finished, job, &QObject::deleteLater);
+    }
+
     // Helper to find the QPDF executable
     QString findQpdfExecutable() const {
         QStringList possibleNames = {
@@ -133,51 +149,16 @@ RestrictionBypass::~RestrictionBypass()
 
 bool RestrictionBypass::bypassRestrictions(const QString& inputFilePath, const QString& outputFilePath)
 {
-    QString qpdfPath = d->findQpdfExecutable();
-    if (qpdfPath.isEmpty()) {
-        LOG_ERROR("RestrictionBypass::bypassRestrictions: QPDF executable not found.");
-        emit bypassFailed(inputFilePath, "QPDF tool not found. Please install QPDF.");
-        return false;
-    }
-
     emit bypassStarted(inputFilePath);
 
-    // Build QPDF command arguments to remove restrictions
-    // Example: qpdf --decrypt input.pdf output.pdf
-    // Note: --decrypt removes encryption AND restrictions if it has the owner password (often the master key).
-    // If only user password is known, it might not remove all restrictions.
-    // QPDF also has --set-encrypt flags to *set* permissions to allow everything.
-    QStringList args;
-    args << "--decrypt"; // This is the primary command for removing restrictions via owner password
-    // Alternative: args << "--set-encrypt=none"; // Explicitly set no encryption/permissions (requires owner password to read original)
-    // Another alternative: args << "--stream-data=uncompress" << "--object-streams=disable"; // Sometimes helps with weird restrictions
-    args << inputFilePath << outputFilePath;
-
-    LOG_DEBUG("RestrictionBypass::bypassRestrictions: Executing: " << qpdfPath << " " << args.join(" "));
-
-    // Run QPDF process
-    QProcess qpdfProcess;
-    qpdfProcess.start(qpdfPath, args);
-    bool finished = qpdfProcess.waitForFinished(-1);
-
-    if (!finished) {
-        QString error = "QPDF process did not finish.";
-        LOG_ERROR("RestrictionBypass::bypassRestrictions: " << error);
-        emit bypassFailed(inputFilePath, error);
-        return false;
-    }
-
-    if (qpdfProcess.exitCode() != 0) {
-        QString errorOutput = qpdfProcess.readAllStandardError();
-        LOG_ERROR("RestrictionBypass::bypassRestrictions: QPDF failed with exit code " << qpdfProcess.exitCode() << ". Error: " << errorOutput);
-        emit bypassFailed(inputFilePath, errorOutput);
-        return false;
-    }
-
-    // Check if output file was created
-    if (!QFile::exists(outputFilePath)) {
-        QString error = "QPDF did not create output file: " + outputFilePath;
-        LOG_ERROR("RestrictionBypass::bypassRestrictions: " << error);
+    // Opened without a password and written without encryption, which drops
+    // the permission flags with it. Streamed through libqpdf in this thread;
+    // bypassRestrictionsInBackground() keeps the caller free.
+    QString error;
+    const bool success = PdfRewriteJob::rewriteFile(PdfRewriteJob::Mode::RemoveRestrictions, inputFilePath, outputFilePath,
+                                                    QString(), [this](int percent) { emit bypassProgress(percent); },
+                                                    nullptr, &error);
+    if (!success) {
         emit bypassFailed(inputFilePath, error);
         return false;
     }
@@ -187,6 +168,29 @@ bool RestrictionBypass::bypassRestrictions(const QString& inputFilePath, const Q
     return true;
 }
 
+PdfRewriteJob* RestrictionBypass::bypassRestrictionsInBackground(const QString& inputFilePath, const QString& outputFilePath)
+{
+    PdfRewriteJob* job = new PdfRewriteJob(PdfRewriteJob::Mode::RemoveRestrictions, this);
+    job->addFile(inputFilePath, outputFilePath);
+    d->watch(job, true);
+    job->start();
+    return job;
+}
+
+PdfRewriteJob* RestrictionBypass::bypassRestrictionsInDirectory(const QString& inputDir, const QString& outputDir, int jobs)
+{
+    PdfRewriteJob* job = new PdfRewriteJob(PdfRewriteJob::Mode::RemoveRestrictions, this);
+    job->setJobs(jobs);
+    if (job->addDirectory(inputDir, outputDir) == 0) {
+        LOG_WARN("RestrictionBypass::bypassRestrictionsInDirectory: No PDF files in " << inputDir);
+        delete job;
+        return nullptr;
+    }
+    d->watch(job, false);
+    job->start();
+    return job;
+}
+
 bool RestrictionBypass::bypassRestrictionsFromDocument(Document* document)
 {
     if (!document) {
@@ -17,6 +17,7 @@
 namespace QuantilyxDoc {
 
 class Document; // Forward declaration
+class PdfRewriteJob;
 
 /**
  * @brief Bypasses document restrictions (e.g., printing, copying, editing).
@@ -55,6 +56,28 @@ public:
      */
     bool bypassRestrictions(const QString& inputFilePath, const QString& outputFilePath);
 
+    /**
+     * @brief Bypass restrictions from a document file in the background.
+     * Returns at once; the bypass* signals report the outcome. The file is
+     * rewritten in one streaming pass, so files of any size can be processed.
+     * @param inputFilePath Path to the input file.
+     * @param outputFilePath Path to save the output file.
+     * @return The running job, for cancel(); it deletes itself once finished.
+     */
+    PdfRewriteJob* bypassRestrictionsInBackground(const QString& inputFilePath, const QString& outputFilePath);
+
+    /**
+     * @brief Bypass restrictions from every PDF of a directory, several files at once.
+     * Outputs keep their relative names under outputDir. bypassProgress()
+     * reports the share of files done.
+     * @param inputDir Directory to read, with its subdirectories.
+     * @param outputDir Directory to write.
+     * @param jobs Files processed at once; 0 or less means one per CPU.
+     * @return The running job, for cancel() and its per-file signals; it deletes
+     *         itself once finished. Null if the directory holds no PDF.
+     */
+    PdfRewriteJob* bypassRestrictionsInDirectory(const QString& inputDir, const QString& outputDir, int jobs = 0);
+
     /**
      * @brief Bypass restrictions from an already loaded Document object.
      * This might involve saving the document to a temporary file, bypassing restrictions, and reloading.
@@ -125,6 +148,7 @@ signals:
 private:
     class Private;
     std::unique_ptr<Private> d;
+    static RestrictionBypass* s_instance;
 
     // Helper to find the external tool executable (e.g., qpdf)
     QString findExternalTool() const;
@@ -0,0 +1,265 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "CommandIndex.h"
+#include "../core/Logger.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const ushort FieldSeparator = 0x1f;
+const double UsageHalfLifeSeconds = 7 * 24 * 3600.0;
+
+// Per matched character
+const int MatchScore = 16;
+const int ConsecutiveBonus = 24;
+const int WordStartBonus = 32;
+const int TitlePrefixBonus = 48;
+const int TitleBonus = 8;
+const int MaxGapPenalty = 8;
+
+bool isWordChar(ushort c)
+{
+    return QChar(c).isLetterOrNumber();
+}
+
+// Folded characters, without menu mnemonics ("&Open" -> "open")
+void appendFolded(QVector<ushort>& out, const QString& text)
+{
+    const QString folded = text.toCaseFolded();
+    for (int i = 0; i < folded.size(); ++i) {
+        const ushort c = folded.at(i).unicode();
+        if (c == '&' && i + 1 < folded.size() && folded.at(i + 1) != QLatin1Char('&')) continue;
+        if (c == '&') ++i; // "&&" is a literal ampersand
+        out.append(c);
+    }
+}
+
+} // namespace
+
+CommandIndex::CommandIndex() = default;
+
+void CommandIndex::setCommands(const QList<Command>& commands)
+{
+    m_commands = commands;
+    m_dirty = true;
+}
+
+quint64 CommandIndex::maskOf(const ushort* text, int size)
+{
+    quint64 mask = 0;
+    for (int i = 0; i < size; ++i) {
+        const ushort c = text[i];
+        int bit;
+        if (c >= 'a' && c <= 'z') bit = c - 'a';
+        else if (c >= '0' && c <= '9') bit = 26 + (c - '0');
+        else bit = 36 + c % 28; // Everything else shares the upper bits
+        mask |= quint64(1) << bit;
+    }
+    return mask;
+}
+
+void CommandIndex::build()
+{
+    m_entries.clear();
+    m_masks.clear();
+    m_entries.reserve(m_commands.size());
+    m_masks.reserve(m_commands.size());
+    for (const Command& command : qAsConst(m_commands)) {
+        Entry entry;
+        appendFolded(entry.text, command.title);
+        entry.titleEnd = entry.text.size();
+        for (const QString& field : {command.category, command.shortcut, command.description}) {
+            entry.text.append(FieldSeparator);
+            appendFolded(entry.text, field);
+        }
+        entry.wordStart.resize(entry.text.size());
+        for (int i = 0; i < entry.text.size(); ++i) {
+            const bool word = isWordChar(entry.text.at(i));
+            const bool after = i == 0 || !isWordChar(entry.text.at(i - 1));
+            entry.wordStart[i] = word && after ? 1 : 0;
+        }
+        entry.priority = command.priority;
+        entry.id = command.id;
+        entry.title = command.title;
+        // Separators and spaces are never in a query, so they stay out of the mask
+        QVector<ushort> letters;
+        for (ushort c : qAsConst(entry.text)) {
+            if (c != FieldSeparator && c != ' ') letters.append(c);
+        }
+        m_masks.append(maskOf(letters.constData(), letters.size()));
+        m_entries.append(entry);
+    }
+    m_commands.clear(); // A shared copy left here would make every later addCommand() copy the list
+    m_lastQuery.clear();
+    m_lastCandidates.clear();
+    m_dirty = false;
+    LOG_DEBUG("CommandIndex: Indexed " << m_entries.size() << " commands");
+}
+
+// 0 if the query is not a subsequence of the entry's text
+int CommandIndex::scoreEntry(const Entry& entry, const QVector<ushort>& query)
+{
+    const ushort* text = entry.text.constData();
+    const quint8* wordStart = entry.wordStart.constData();
+    const int size = entry.text.size();
+    int score = 0;
+    int position = 0;
+    int previous = -2;
+    for (ushort c : query) {
+        int found = -1;
+        for (int i = position; i < size; ++i) {
+            if (text[i] == c) {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0) return 0;
+        // A word start further on in the same field beats a match inside a word
+        if (found != previous + 1 && !wordStart[found]) {
+            for (int i = found + 1; i < size && text[i] != FieldSeparator; ++i) {
+                if (text[i] == c && wordStart[i]) {
+                    found = i;
+                    break;
+                }
+            }
+        }
+
+        score += MatchScore;
+        if (found == previous + 1) score += ConsecutiveBonus;
+        else if (previous >= 0) score -= qMin(found - previous - 1, MaxGapPenalty);
+        if (wordStart[found]) score += WordStartBonus;
+        if (found < entry.titleEnd) score += TitleBonus;
+        previous = found;
+        position = found + 1;
+    }
+    if (!query.isEmpty() && entry.titleEnd >= query.size()
+        && std::equal(query.constBegin(), query.constEnd(), text)) {
+        score += TitlePrefixBonus;
+    }
+    return qMax(1, score);
+}
+
+int CommandIndex::frecencyBoost(const QString& id, qint64 now) const
+{
+    auto it = m_usage.constFind(id);
+    if (it == m_usage.constEnd()) return 0;
+    const double decayed = it->score * std::pow(0.5, double(now - it->lastUsed) / UsageHalfLifeSeconds);
+    return int(24 * std::log2(1 + decayed));
+}
+
+QVector<int> CommandIndex::search(const QString& query, int limit)
+{
+    if (m_dirty) build();
+    QVector<int> results;
+    if (limit <= 0 || m_entries.isEmpty()) return results;
+
+    QVector<ushort> folded;
+    appendFolded(folded, query);
+    folded.erase(std::remove(folded.begin(), folded.end(), ushort(' ')), folded.end());
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QVector<QPair<int, int>> scored; // Score, entry
+    if (folded.isEmpty()) {
+        for (int i = 0; i < m_entries.size(); ++i) {
+            scored.append({frecencyBoost(m_entries.at(i).id, now) + m_entries.at(i).priority, i});
+        }
+        m_lastQuery.clear();
+        m_lastCandidates.clear();
+    } else {
+        // Whatever matches the extended query matched the shorter one
+        const bool narrowing = !m_lastQuery.isEmpty() && folded.size() > m_lastQuery.size()
+            && std::equal(m_lastQuery.constBegin(), m_lastQuery.constEnd(), folded.constBegin());
+        QVector<int> candidates;
+        const quint64 queryMask = maskOf(folded.constData(), folded.size());
+        if (narrowing) {
+            for (int i : qAsConst(m_lastCandidates)) {
+                if ((queryMask & ~m_masks.at(i)) == 0) candidates.append(i);
+            }
+        } else {
+            const quint64* masks = m_masks.constData();
+            const int count = m_masks.size();
+            candidates.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                if ((queryMask & ~masks[i]) == 0) candidates.append(i);
+            }
+        }
+
+        m_lastCandidates.clear();
+        for (int i : qAsConst(candidates)) {
+            const Entry& entry = m_entries.at(i);
+            const int score = scoreEntry(entry, folded);
+            if (score <= 0) continue;
+            m_lastCandidates.append(i);
+            scored.append({score + frecencyBoost(entry.id, now) + entry.priority, i});
+        }
+        m_lastQuery = folded;
+    }
+
+    const int count = qMin(limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+                      [this](const QPair<int, int>& a, const QPair<int, int>& b) {
+                          if (a.first != b.first) return a.first > b.first;
+                          return m_entries.at(a.second).title.localeAwareCompare(m_entries.at(b.second).title) < 0;
+                      });
+    results.reserve(count);
+    for (int i = 0; i < count; ++i) results.append(scored.at(i).second);
+    return results;
+}
+
+void CommandIndex::recordUse(const QString& id)
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    Usage& usage = m_usage[id];
+    usage.score = usage.score * std::pow(0.5, double(now - usage.lastUsed) / UsageHalfLifeSeconds) + 1;
+    usage.lastUsed = now;
+}
+
+void CommandIndex::loadUsage(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const QJsonObject object = it.value().toObject();
+        Usage usage;
+        usage.score = object.value("score").toDouble();
+        usage.lastUsed = qint64(object.value("lastUsed").toDouble());
+        if (usage.score > 0) m_usage.insert(it.key(), usage);
+    }
+}
+
+bool CommandIndex::saveUsage(const QString& path) const
+{
+    QJsonObject root;
+    for (auto it = m_usage.constBegin(); it != m_usage.constEnd(); ++it) {
+        QJsonObject object;
+        object.insert("score", it->score);
+        object.insert("lastUsed", double(it->lastUsed));
+        root.insert(it.key(), object);
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0
+        || !file.commit()) {
+        LOG_WARN("CommandIndex: Cannot write command usage to " << path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,109 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_COMMANDINDEX_H
+#define QUANTILYX_COMMANDINDEX_H
+
+#include "CommandPalette.h"
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Fuzzy search index over the command palette's commands.
+ *
+ * Each command's title, category, shortcut and description are case
+ * folded once, with word starts marked, and summarised in a 64-bit mask
+ * of the characters they contain. A search first drops every command
+ * whose mask lacks one of the query's characters, a loop over one flat
+ * array of masks that compilers vectorize, and scores only the rest. A
+ * query that extends the previous one only rescans the previous matches.
+ * Commands used often and recently rank higher (frecency).
+ */
+class CommandIndex
+{
+public:
+    /**
+     * @brief Constructor for an empty index.
+     */
+    CommandIndex();
+
+    /**
+     * @brief Replace the commands; the index is built on the next search.
+     * @param commands Commands, in the order search() results refer to.
+     */
+    void setCommands(const QList<Command>& commands);
+
+    /**
+     * @brief Find the best matches for a query.
+     * Query characters must appear in order; spaces are ignored. Matches at
+     * word starts, runs of consecutive characters and matches in the title
+     * score higher. An empty query ranks every command by frecency.
+     * @param query What was typed.
+     * @param limit Maximum number of results.
+     * @return Indexes into the commands, best first.
+     */
+    QVector<int> search(const QString& query, int limit);
+
+    /**
+     * @brief Record that a command was run, for frecency.
+     * @param id Command ID.
+     */
+    void recordUse(const QString& id);
+
+    /**
+     * @brief Read usage recorded in an earlier session.
+     * @param path JSON file written by saveUsage().
+     */
+    void loadUsage(const QString& path);
+
+    /**
+     * @brief Write the recorded usage.
+     * @param path JSON file.
+     * @return True if written.
+     */
+    bool saveUsage(const QString& path) const;
+
+private:
+    struct Entry {
+        QVector<ushort> text;       // Folded fields, separated by FieldSeparator
+        QVector<quint8> wordStart;  // 1 where a word starts
+        int titleEnd = 0;           // Characters before this belong to the title
+        int priority = 0;
+        QString id;
+        QString title;
+    };
+
+    struct Usage {
+        double score = 0;           // Uses, each decayed by age
+        qint64 lastUsed = 0;        // Seconds since epoch
+    };
+
+    static quint64 maskOf(const ushort* text, int size);
+    static int scoreEntry(const Entry& entry, const QVector<ushort>& query);
+    void build();
+    int frecencyBoost(const QString& id, qint64 now) const;
+
+    QList<Command> m_commands;
+    QVector<Entry> m_entries;
+    QVector<quint64> m_masks;       // Parallel to m_entries, kept apart so the filter loop reads only masks
+    bool m_dirty = false;
+
+    // Matches of the previous query, for narrowing when it is extended
+    QVector<ushort> m_lastQuery;
+    QVector<int> m_lastCandidates;
+
+    QHash<QString, Usage> m_usage;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_COMMANDINDEX_H
@@ -8,6 +8,7 @@
  * (at your option) any later version.
  */
 #include "CommandPalette.h"
+#include "CommandIndex.h"
 #include "../core/Settings.h"
 #include "../core/Logger.h"
 #include <QVBoxLayout>
@@ -41,7 +42,8 @@ namespace QuantilyxDoc {
 class CommandPalette::Private {
 public:
     Private(CommandPalette* q_ptr)
-        : q(q_ptr), maxResultsVal(15), closeOnExecuteVal(true), isShownVal(false) {}
+        : q(q_ptr), maxResultsVal(15), closeOnExecuteVal(true), isShownVal(false), indexDirty(false)
+        , usagePath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/command_usage.json") {}
 
     CommandPalette* q;
     QLineEdit* searchLineEdit;
@@ -58,85 +60,41 @@ public:
     QString currentQueryStr;
     mutable QMutex mutex; // Protect access to command list during async operations
 
+    // Search index over allCommands, rebuilt on the first search after a change
+    mutable CommandIndex index;
+    mutable bool indexDirty;
+    QString usagePath;
+
+    // Must be called with the mutex held; indexes into allCommands, best first
+    QVector<int> matchingCommands(const QString& query) const {
+        if (indexDirty) {
+            index.setCommands(allCommands);
+            indexDirty = false;
+        }
+        return index.search(query, maxResultsVal);
+    }
+
     // Helper to filter commands based on the current query string
     void filterCommands(const QString& query) {
         QMutexLocker locker(&mutex); // Lock during read of command list and filtering
         QStringList results;
 
-        if (query.isEmpty()) {
-            // If query is empty, show top-level categories or most frequent commands
-            QSet<QString> categories;
-            for (const auto& cmd : allCommands) {
-                categories.insert(cmd.category);
-            }
-            for (const QString& cat : categories) {
-                results.append(cat + " (Category)");
-            }
-        } else {
-            // Simple fuzzy search across title, category, description
-            QString lowerQuery = query.toLower();
-            QList<Command> matchedCommands;
-            for (const auto& cmd : allCommands) {
-                if (cmd.title.toLower().contains(lowerQuery) ||
-                    cmd.category.toLower().contains(lowerQuery) ||
-                    cmd.description.toLower().contains(lowerQuery)) {
-                    matchedCommands.append(cmd);
-                }
-            }
-
-            // Sort results: prioritize by priority, then by title
-            std::sort(matchedCommands.begin(), matchedCommands.end(), [](const Command& a, const Command& b) {
-                if (a.priority != b.priority) {
-                    return a.priority > b.priority; // Higher priority first
-                }
-                return a.title.localeAwareCompare(b.title) < 0; // Alphabetical
-            });
-
-            // Take up to maxResults
-            int count = qMin(matchedCommands.size(), maxResultsVal);
-            for (int i = 0; i < count; ++i) {
-                const Command& cmd = matchedCommands[i];
-                // Format result item text
-                QString itemText = QString("%1 (%2)").arg(cmd.title).arg(cmd.category);
-                if (!cmd.shortcut.isEmpty()) {
-                    itemText += QString(" [%1]").arg(cmd.shortcut);
-                }
-                results.append(itemText);
+        // An empty query lists the most used commands first
+        currentFilteredCommands.clear();
+        for (int i : matchingCommands(query)) {
+            const Command& cmd = allCommands[i];
+            currentFilteredCommands.append(cmd);
+            // Format result item text
+            QString itemText = QString("%1 (%2)").arg(cmd.title).arg(cmd.category);
+            if (!cmd.shortcut.isEmpty()) {
+                itemText += QString(" [%1]").arg(cmd.shortcut);
             }
+            results.append(itemText);
         }
 
         // Set the filtered results to the proxy model
         static_cast<QStringListModel*>(proxyModel->sourceModel())->setStringList(results);
 
-        // Update the internal list of *matched* commands for execution mapping
-        // This needs a better design - the model should ideally store Command structs, not just strings.
-        // For now, we'll rebuild a map of *filtered* commands on the fly.
-        // A more robust approach uses a custom QAbstractListModel storing Command objects.
-        currentFilteredCommands.clear();
-        if (query.isEmpty()) {
-             // Show categories - this logic needs refinement. For now, add all commands if query is empty.
-             currentFilteredCommands = allCommands;
-        } else {
-             // Use the matchedCommands list from above
-             // (This logic is duplicated from filtering, inefficient but simple for now)
-             QString lowerQuery = query.toLower();
-             for (const auto& cmd : allCommands) {
-                 if (cmd.title.toLower().contains(lowerQuery) ||
-                     cmd.category.toLower().contains(lowerQuery) ||
-                     cmd.description.toLower().contains(lowerQuery)) {
-                     currentFilteredCommands.append(cmd);
-                 }
-             }
-             // Apply same sorting as above
-             std::sort(currentFilteredCommands.begin(), currentFilteredCommands.end(), [](const Command& a, const Command& b) {
-                 if (a.priority != b.priority) {
-                     return a.priority > b.priority;
-                 }
-                 return a.title.localeAwareCompare(b.title) < 0;
-             });
-             currentFilteredCommands = currentFilteredCommands.mid(0, maxResultsVal);
-        }
-
         emit q->resultsChanged(results.size());
         LOG_DEBUG("CommandPalette: Filtered to " << results.size() << " commands for query: '" << query << "'");
     }
@@ -191,6 +149,8 @@ CommandPalette::CommandPalette(QWidget* parent)
     d->placeholderLabel->hide(); // Hidden initially, shown by filterResults if necessary
     mainLayout->addWidget(d->placeholderLabel);
 
+    d->index.loadUsage(d->usagePath);
+
     // Debounce timer for search
     d->searchDebounceTimer = new QTimer(this);
     d->searchDebounceTimer->setSingleShot(true);
@@ -201,7 +161,7 @@ CommandPalette::CommandPalette(QWidget* parent)
     // Connect search box changes
     connect(d->searchLineEdit, &QLineEdit::textChanged, [this](const QString& text) {
         d->currentQueryStr = text;
-        d->searchDebounceTimer->start(150); // Wait 150ms after user stops typing
+        d->searchDebounceTimer->start(0); // Keystrokes already queued are filtered once
         emit queryChanged(text);
     });
 
@@ -296,10 +256,12 @@ void CommandPalette::addCommand(const QString& id, const QString& title, const Q
     if (existingCmdIt != d->allCommands.end()) {
         LOG_WARN("CommandPalette::addCommand: Command with ID already exists, overwriting: " << id);
         *existingCmdIt = Command{id, title, category, description, shortcut, std::move(handler), icon, priority};
+        d->commandMap.insert(id, *existingCmdIt);
     } else {
         d->allCommands.append(Command{id, title, category, description, shortcut, std::move(handler), icon, priority});
         d->commandMap.insert(id, d->allCommands.back()); // Update map
     }
+    d->indexDirty = true;
 
     // If the palette is currently visible and the query matches, update the list
     if (isShown() && d->currentQueryStr.isEmpty()) { // Simple update if query is empty
@@ -318,6 +280,7 @@ void CommandPalette::removeCommand(const QString& id)
     if (it != d->allCommands.end()) {
         d->allCommands.erase(it);
         d->commandMap.remove(id);
+        d->indexDirty = true;
         LOG_DEBUG("CommandPalette: Removed command (ID: " << id << ")");
 
         // Update list if visible
@@ -338,31 +301,10 @@ QList<Command> CommandPalette::allCommands() const
 QList<Command> CommandPalette::searchCommands(const QString& query) const
 {
     QMutexLocker locker(&d->mutex);
-    // Re-implement the search logic from filterCommands to return the actual Command objects
     QList<Command> results;
-    QString lowerQuery = query.toLower();
-
-    for (const auto& cmd : d->allCommands) {
-        if (cmd.title.toLower().contains(lowerQuery) ||
-            cmd.category.toLower().contains(lowerQuery) ||
-            cmd.description.toLower().contains(lowerQuery)) {
-            results.append(cmd);
-        }
+    for (int i : d->matchingCommands(query)) {
+        results.append(d->allCommands[i]);
     }
-
-    // Sort results: prioritize by priority, then by title
-    std::sort(results.begin(), results.end(), [](const Command& a, const Command& b) {
-        if (a.priority != b.priority) {
-            return a.priority > b.priority;
-        }
-        return a.title.localeAwareCompare(b.title) < 0;
-    });
-
-    // Limit results
-    if (results.size() > d->maxResultsVal) {
-        results = results.mid(0, d->maxResultsVal);
-    }
-
     return results;
 }
 
@@ -372,6 +314,7 @@ void CommandPalette::clearCommands()
     d->allCommands.clear();
     d->commandMap.clear();
     d->currentFilteredCommands.clear();
+    d->indexDirty = true;
     d->listModel->setStringList(QStringList()); // Clear the UI model
     LOG_DEBUG("CommandPalette: Cleared all commands.");
 }
@@ -429,6 +372,8 @@ void CommandPalette::executeCommandById(const QString& commandId)
 void CommandPalette::executeCommand(const Command& cmd)
 {
     LOG_INFO("CommandPalette: Executing command '" << cmd.title << "' (ID: " << cmd.id << ")");
+    d->index.recordUse(cmd.id); // Ranks it higher next time
+    d->index.saveUsage(d->usagePath);
     if (cmd.handler) {
         cmd.handler(); // Execute the associated function
     }
@@ -8,11 +8,11 @@
  * (at your option) any later version.
  */
 #include "ContentsWidget.h"
+#include "TocModel.h"
 #include "../core/Document.h"
 #include "../core/Logger.h"
 #include <QVBoxLayout>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTreeView>
 #include <QLabel>
 #include <QHeaderView>
 #include <QApplication> // For accessing main window signals if needed
@@ -27,17 +27,31 @@ ContentsWidget::ContentsWidget(QWidget* parent)
     m_layout = new QVBoxLayout(this);
     m_noContentsLabel = new QLabel(tr("No table of contents available."), this);
     m_noContentsLabel->setAlignment(Qt::AlignCenter);
-    m_treeWidget = new QTreeWidget(this);
-    m_treeWidget->setHeaderLabel(tr("Contents"));
-    m_treeWidget->setRootIsDecorated(true); // Show expand/collapse icons
-    m_treeWidget->setAlternatingRowColors(true);
-    m_treeWidget->setUniformRowHeights(true);
+    m_searchEdit = new QLineEdit(this);
+    m_searchEdit->setPlaceholderText(tr("Search contents"));
+    m_searchEdit->setClearButtonEnabled(true);
+    m_model = new TocModel(this);
+    m_treeView = new QTreeView(this);
+    m_treeView->setModel(m_model);
+    m_treeView->setHeaderHidden(true);
+    m_treeView->setRootIsDecorated(true); // Show expand/collapse icons
+    m_treeView->setAlternatingRowColors(true);
+    m_treeView->setUniformRowHeights(true); // Rows are not measured one by one
+    m_searchResults = new QListWidget(this);
+    m_searchResults->setUniformItemSizes(true);
 
     m_layout->addWidget(m_noContentsLabel);
-    m_layout->addWidget(m_treeWidget);
-    m_treeWidget->hide(); // Hide initially, show when contents exist
-
-    connect(m_treeWidget, &QTreeWidget::itemActivated, this, &ContentsWidget::onTocItemActivated);
+    m_layout->addWidget(m_searchEdit);
+    m_layout->addWidget(m_treeView);
+    m_layout->addWidget(m_searchResults);
+    m_searchEdit->hide(); // Hide initially, show when contents exist
+    m_treeView->hide();
+    m_searchResults->hide();
+
+    connect(m_treeView, &QTreeView::activated, this, &ContentsWidget::onTocItemActivated);
+    connect(m_searchEdit, &QLineEdit::textChanged, this, &ContentsWidget::onSearchTextChanged);
+    connect(m_searchResults, &QListWidget::itemActivated, this, &ContentsWidget::onSearchHitActivated);
+    connect(m_model, &TocModel::indexReady, this, &ContentsWidget::showSearchResults);
 
     LOG_INFO("ContentsWidget initialized.");
 }
@@ -52,19 +66,16 @@ void ContentsWidget::setDocument(Document* doc)
     if (m_document == doc) return;
 
     // Disconnect from old document signals if necessary
-    // (Not directly connected here, but maybe via MainWindow)
+    if (m_document) {
+        disconnect(m_document, &Document::tableOfContentsChanged, this, &ContentsWidget::onTableOfContentsChanged);
+    }
 
     m_document = doc; // Use QPointer
 
     if (doc) {
-        // Update UI based on new document's TOC
-        if (doc->hasTableOfContents()) {
-            QVariantList toc = doc->tableOfContents();
-            populateContents(toc);
-        } else {
-            clearContents();
-            m_noContentsLabel->setText(tr("Document has no table of contents."));
-        }
+        // A progressive load delivers the TOC after the first page
+        connect(doc, &Document::tableOfContentsChanged, this, &ContentsWidget::onTableOfContentsChanged);
+        onTableOfContentsChanged();
     } else {
         clearContents();
         m_noContentsLabel->setText(tr("No document loaded."));
@@ -82,14 +93,24 @@ void ContentsWidget::onCurrentDocumentChanged(Document* doc)
     setDocument(doc);
 }
 
-void ContentsWidget::onTocItemActivated(QTreeWidgetItem* item, int column)
+void ContentsWidget::onTableOfContentsChanged()
 {
-    Q_UNUSED(column);
-    if (!item || !m_document) return;
+    if (!m_document) return;
 
-    // The destination information should be stored in the item's data.
-    // We populated it in populateTreeItem using Qt::UserRole.
-    QVariant destination = item->data(0, Qt::UserRole);
+    // Update UI based on the document's TOC
+    if (m_document->hasTableOfContents()) {
+        populateContents();
+    } else {
+        clearContents();
+        m_noContentsLabel->setText(tr("Document has no table of contents."));
+    }
+}
+
+void ContentsWidget::onTocItemActivated(const QModelIndex& index)
+{
+    if (!index.isValid() || !m_document) return;
+
+    QVariant destination = index.data(TocModel::DestinationRole);
     if (destination.isValid()) {
         LOG_DEBUG("ContentsWidget: Item activated, requesting navigation to: " << destination.toString());
         emit navigateRequested(destination);
@@ -100,55 +121,92 @@ void ContentsWidget::onTocItemActivated(QTreeWidgetItem* item, int column)
 
 void ContentsWidget::clearContents()
 {
-    m_treeWidget->clear();
+    m_model->setDocument(nullptr);
+    m_searchEdit->clear();
+    m_searchEdit->hide();
+    m_searchResults->clear();
+    m_searchResults->hide();
     m_noContentsLabel->show();
-    m_treeWidget->hide();
+    m_treeView->hide();
     LOG_DEBUG("ContentsWidget cleared.");
 }
 
-void ContentsWidget::populateContents(const QVariantList& tocData)
+void ContentsWidget::populateContents()
 {
-    m_treeWidget->clear();
-
-    for (const auto& itemVariant : tocData) {
-        if (itemVariant.type() == QVariant::Map) {
-            QVariantMap itemMap = itemVariant.toMap();
-            QTreeWidgetItem* topLevelItem = new QTreeWidgetItem(m_treeWidget);
-            populateTreeItem(topLevelItem, itemMap);
-        }
-    }
-
-    if (m_treeWidget->topLevelItemCount() > 0) {
+    // Only the top level is read now; deeper levels are read as they are expanded
+    m_model->setDocument(m_document);
+    m_model->fetchMore(QModelIndex());
+    m_searchEdit->clear();
+    m_searchResults->clear();
+    m_searchResults->hide();
+
+    if (m_model->rowCount() > 0) {
         m_noContentsLabel->hide();
-        m_treeWidget->show();
-        m_treeWidget->expandAll(); // Expand the tree by default
+        m_searchEdit->show();
+        m_treeView->show();
     } else {
         m_noContentsLabel->setText(tr("Table of contents is empty."));
         m_noContentsLabel->show();
-        m_treeWidget->hide();
+        m_searchEdit->hide();
+        m_treeView->hide();
     }
-    LOG_DEBUG("ContentsWidget populated with " << m_treeWidget->topLevelItemCount() << " top-level items.");
+    LOG_DEBUG("ContentsWidget populated with " << m_model->rowCount() << " top-level items.");
 }
 
-void ContentsWidget::populateTreeItem(QTreeWidgetItem* parentItem, const QVariantMap& itemData)
+void ContentsWidget::onSearchTextChanged(const QString& text)
 {
-    // Set title
-    QString title = itemData.value("title", "Untitled").toString();
-    parentItem->setText(0, title);
-
-    // Store destination data in the item
-    QVariant destination = itemData.value("destination");
-    parentItem->setData(0, Qt::UserRole, destination);
-
-    // Recursively add children
-    QVariantList children = itemData.value("children", QVariantList()).toList();
-    for (const auto& childVariant : children) {
-        if (childVariant.type() == QVariant::Map) {
-            QVariantMap childMap = childVariant.toMap();
-            QTreeWidgetItem* childItem = new QTreeWidgetItem(parentItem);
-            populateTreeItem(childItem, childMap);
+    if (text.trimmed().isEmpty()) {
+        m_searchResults->hide();
+        m_treeView->show();
+        return;
+    }
+    m_model->startIndexing(); // showSearchResults() runs again once the index is ready
+    showSearchResults();
+}
+
+void ContentsWidget::showSearchResults()
+{
+    const QString text = m_searchEdit->text();
+    if (text.trimmed().isEmpty()) return;
+
+    m_searchResults->clear();
+    if (!m_model->isIndexReady()) {
+        QListWidgetItem* item = new QListWidgetItem(tr("Indexing contents..."), m_searchResults);
+        item->setFlags(Qt::NoItemFlags);
+    } else {
+        const QList<TocModel::SearchHit> hits = m_model->search(text);
+        for (const TocModel::SearchHit& hit : hits) {
+            QListWidgetItem* item = new QListWidgetItem(hit.title, m_searchResults);
+            item->setToolTip(hit.context.isEmpty() ? hit.title : hit.context);
+            item->setData(Qt::UserRole, hit.destination);
+            QVariantList path;
+            for (int row : hit.path) path.append(row);
+            item->setData(Qt::UserRole + 1, path);
+        }
+        if (hits.isEmpty()) {
+            QListWidgetItem* item = new QListWidgetItem(tr("No matching entries."), m_searchResults);
+            item->setFlags(Qt::NoItemFlags);
         }
     }
+    m_treeView->hide();
+    m_searchResults->show();
+}
+
+void ContentsWidget::onSearchHitActivated(QListWidgetItem* item)
+{
+    if (!item || !m_document) return;
+
+    // Show the entry in the tree too, reading the levels above it
+    QVector<int> path;
+    for (const QVariant& row : item->data(Qt::UserRole + 1).toList()) path.append(row.toInt());
+    const QModelIndex index = m_model->indexForPath(path);
+    if (index.isValid()) {
+        m_treeView->setCurrentIndex(index);
+        m_treeView->scrollTo(index);
+    }
+
+    const QVariant destination = item->data(Qt::UserRole);
+    if (destination.isValid()) emit navigateRequested(destination);
 }
 
 } // namespace QuantilyxDoc
\ No newline at end of file
@@ -11,7 +11,9 @@
 #define QUANTILYX_CONTENTSWIDGET_H
 
 #include <QWidget>
-#include <QTreeWidget>
+#include <QTreeView>
+#include <QListWidget>
+#include <QLineEdit>
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QPointer>
@@ -20,11 +22,14 @@
 namespace QuantilyxDoc {
 
 class Document;
+class TocModel;
 
 /**
  * @brief Widget for displaying document contents like Table of Contents or Bookmarks.
  * 
  * Shows a hierarchical list of document sections and allows navigation.
+ * The tree reads each level of the outline when it is expanded, and the
+ * search field looks titles up in an index built in the background.
  */
 class ContentsWidget : public QWidget
 {
@@ -63,17 +68,23 @@ signals:
 
 private slots:
     void onCurrentDocumentChanged(Document* doc);
-    void onTocItemActivated(QTreeWidgetItem* item, int column);
+    void onTocItemActivated(const QModelIndex& index);
+    void onTableOfContentsChanged();
+    void onSearchTextChanged(const QString& text);
+    void onSearchHitActivated(QListWidgetItem* item);
 
 private:
     QPointer<Document> m_document; // Use QPointer for safety
     QVBoxLayout* m_layout;
     QLabel* m_noContentsLabel;
-    QTreeWidget* m_treeWidget;
+    QLineEdit* m_searchEdit;
+    QTreeView* m_treeView;
+    QListWidget* m_searchResults;
+    TocModel* m_model;
 
     void clearContents();
-    void populateContents(const QVariantList& tocData);
-    void populateTreeItem(QTreeWidgetItem* parentItem, const QVariantMap& itemData);
+    void populateContents();
+    void showSearchResults();
 };
 
 } // namespace QuantilyxDoc
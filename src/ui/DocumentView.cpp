@@ -11,30 +11,65 @@
 #include "../core/Document.h"
 #include "../core/Page.h"
 #include "../core/PageCache.h"
+#include "../core/PixelFormat.h"
+#include "../core/ColorTransform.h"
 #include "../core/RenderThread.h"
+#include "../core/RenderRegistry.h"
+#include "../core/ThumbnailStore.h"
+#include "../core/FrameStats.h"
+#include "../core/MemoryBudget.h"
 #include "../core/Settings.h"
 #include "../core/Selection.h"
 #include "../core/UndoStack.h"
 #include "../core/Logger.h"
+#include "../annotations/AnnotationManager.h"
 #include "../core/Selection.h" // Assuming this exists or will be adapted
 #include "../core/Clipboard.h" // Assuming this exists or we use QApplication::clipboard()
+#ifdef HAVE_OPENGL
+#include "GpuTileRenderer.h"
+#include <QOpenGLWidget>
+#include <QOpenGLContext>
+#include <QMatrix4x4>
+#endif
 #include <QPainter>
 #include <QPaintEvent>
+#include <QRegion>
+#include <QFontMetrics>
 #include <QResizeEvent>
 #include <QWheelEvent>
 #include <QKeyEvent>
 #include <QScrollBar>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
 #include <QApplication>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
 #include <QClipboard>
 #include <QMimeData>
 #include <QMenu>
 #include <QAction>
 #include <QCursor>
+#include <QTransform>
 #include <QDebug>
+#include <QVector>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
 
 namespace QuantilyxDoc {
 
+namespace {
+
+// View whose goToPage() is changing its document's current page. Other
+// views of the same document keep their own position.
+const DocumentView* navigatingView = nullptr;
+
+} // namespace
+
 class DocumentView::Private {
 public:
     Private(DocumentView* q_ptr)
@@ -42,7 +77,10 @@ public:
           zoomMode(FitPage), viewMode(SinglePage), rotation(0),
           pageSpacing(10), isPanning(false), lastPanPoint(0, 0),
           isSelecting(false), selectionStartPoint(0, 0), selectionEndPoint(0, 0),
-          renderRequestCounter(0) {}
+          scrollDirection(1), scrollVelocity(0),
+          lastScrollMs(0), averageTileRenderMs(0), prefetchTimer(nullptr) {
+        scrollClock.start();
+    }
 
     DocumentView* q;
     QPointer<Document> document; // Use QPointer for safety
@@ -62,52 +100,696 @@ public:
     bool isSelecting;
     QPoint selectionStartPoint;
     QPoint selectionEndPoint;
-    QRectF currentSelectionRect; // Document coordinates (PDF points)
+    QRectF currentSelectionRect; // Document coordinates (pixels)
     QString selectedText; // Cached text for the current selection
 
+    // Hover state; the annotation is only compared, never dereferenced
+    int hoveredPage = -1;
+    Annotation* hoveredAnnotation = nullptr;
+
     // Rendering
     quintptr currentRenderRequestId;
-    int renderRequestCounter; // For generating unique IDs
+    QSet<int> requestedPages; // Pages this view has queued tile renders for
+    qreal devicePixelRatio = 1.0; // Of the viewport's screen, as of the last paint
+
+    // Queued renders farther than this many viewport heights away are canceled
+    static constexpr int PrefetchScreens = 1;
+
+    // Scroll tracking for the prefetcher
+    QElapsedTimer scrollClock;
+    int scrollDirection;        // +1 down, -1 up
+    qreal scrollVelocity;       // Smoothed, in pixels per second
+    qint64 lastScrollMs;
+    qreal averageTileRenderMs;  // Smoothed worker time per tile, 0 until measured
+    QSet<int> prefetchPages;    // Pages ahead of the viewport kept queued on scroll
+    QTimer* prefetchTimer;      // Coalesces prefetching after bursts of scroll events
+
+    // Kinetic wheel scrolling: each notch adds velocity that decays
+    // exponentially, so the landing offset is known from the first notch
+    static constexpr qreal FlingDecayPerSecond = 8.0;   // Remaining distance is velocity / decay
+    static constexpr qreal FlingStopVelocity = 30.0;    // Pixels per second
+    static constexpr qreal MaxFlingVelocity = 30000.0;
+    static constexpr int WheelStepPixels = 40;          // Per scroll line of a notch
+    static constexpr int LowResZoomDivisor = 4;         // Pages passed during a fling render at this fraction
+    bool smoothScrolling = true;
+    QTimer* flingTimer = nullptr;   // Ticks at the screen refresh rate while flinging
+    QElapsedTimer flingClock;
+    qreal flingPosition = 0;        // Vertical offset, unrounded
+    qreal flingVelocity = 0;        // Pixels per second, positive down
+    QSet<int> landingPages;         // Pages at the predicted stop, rendered first and never canceled
+    QSet<int> lowResPages;          // Pages given a low-resolution pass during this fling
+
+    // Frame statistics overlay
+    bool statsOverlayVisible = false;
+    QTimer* statsTimer = nullptr; // Refreshes the overlay while it is shown
+
+    // Session restore: where documents shown before were left, by file
+    // path, and the previous session's screen standing in for unrendered tiles
+    QHash<QString, QVariantMap> viewStates;
+    QString placeholderPath;
+    QImage placeholder;
+    QPoint placeholderOffset;
+    qreal placeholderZoom = 0;
+
+    // Prefetched images may take at most this share of the PageCache budget
+    static constexpr int PrefetchCacheShareDivisor = 4;
+
+    // Helper to record a scroll by the given number of pixels and schedule prefetching
+    void noteScroll(int delta) {
+        if (delta == 0) return;
+        const qint64 now = scrollClock.elapsed();
+        const qint64 elapsed = qBound<qint64>(16, now - lastScrollMs, 500);
+        lastScrollMs = now;
+
+        const int direction = delta > 0 ? 1 : -1;
+        if (direction != scrollDirection) {
+            scrollVelocity = 0; // Reversing starts from rest
+        }
+        scrollDirection = direction;
+        const qreal instant = qAbs(delta) * 1000.0 / elapsed;
+        scrollVelocity = 0.5 * scrollVelocity + 0.5 * instant;
+        if (prefetchTimer) prefetchTimer->start();
+    }
 
-    // Cached page sizes for layout calculations
-    mutable QHash<int, QSize> cachedPageSizePixels;
+    // Helper to fold a measured render time into the per-tile average
+    void noteRenderTime(qint64 renderTimeMs) {
+        if (renderTimeMs <= 0) return;
+        averageTileRenderMs = averageTileRenderMs > 0 ? 0.8 * averageTileRenderMs + 0.2 * renderTimeMs
+                                                      : static_cast<qreal>(renderTimeMs);
+    }
 
-    // Helper to calculate page size in pixels based on zoom/rotation
-    QSize calculatePageSizePixels(int pageIndex) const {
-        if (!document) return QSize();
-        Page* page = document->page(pageIndex);
-        if (!page) return QSize();
+    // How many pages to render ahead: enough to cover the pages that scroll
+    // into view while one page renders, capped by the page cache budget
+    int prefetchPageCount(const QSize& pageSize) const {
+        if (pageSize.isEmpty() || MemoryBudget::instance().isUnderPressure()) return 0;
+        const int maxPages = Settings::snapshot().prefetchPages;
+        if (maxPages <= 0) return 0;
+
+        // Tiles are cut from the image in device pixels
+        const qreal tileSize = PageCache::TileSize / devicePixelRatio;
+        const int columns = qCeil(qMin(pageSize.width(), q->viewport()->width()) / tileSize);
+        const int rows = qCeil(pageSize.height() / tileSize);
+        const qreal pageRenderMs = averageTileRenderMs * columns * rows / qMax(1, RenderThread::instance().workerCount());
+        const qreal pagesPerSecond = scrollVelocity / (pageSize.height() + pageSpacing);
+        int count = 1 + qCeil(pagesPerSecond * pageRenderMs / 1000.0);
+
+        const qint64 pageBytes = static_cast<qint64>(qMin(pageSize.width(), q->viewport()->width()) * pageSize.height() * 4
+                                                     * devicePixelRatio * devicePixelRatio);
+        const qint64 allowance = PageCache::instance().maxSizeBytes() / PrefetchCacheShareDivisor;
+        count = qMin<qint64>(count, allowance / qMax<qint64>(1, pageBytes));
+        return qBound(0, count, maxPages);
+    }
 
-        QSizeF pageSizePoints = page->size();
-        qreal dpi = 72.0; // Base DPI for calculations
-        qreal scale = zoomLevel * (dpi / 72.0); // Adjust for zoom and target DPI
-        QSize size = QSize(qRound(pageSizePoints.width() * scale), qRound(pageSizePoints.height() * scale));
+    // Helper to queue the render of one tile unless it is cached or already in flight.
+    // pageSize must be the page's image at zoom, which is imageZoom() if 0.
+    void requestTile(int pageIndex, const QSize& pageSize, int column, int row, int priority, qreal zoom = 0) {
+        if (zoom <= 0) zoom = imageZoom();
+        const int tileSize = PageCache::TileSize;
+        const QRect tileRect = QRect(column * tileSize, row * tileSize, tileSize, tileSize)
+                                   .intersected(QRect(QPoint(0, 0), pageSize));
+        if (tileRect.isEmpty()) return;
+
+        RenderThread::RenderRequest request;
+        request.page = document->page(pageIndex);
+        request.targetSize = pageSize;
+        request.zoomLevel = zoom;
+        request.rotation = rotation;
+        request.clipRect = tileToPageRect(tileRect, pageSize, zoom);
+        request.highQuality = true; // Or determine based on zoom level
+        request.devicePixelRatio = devicePixelRatio;
+        request.requestId = RenderThread::nextRequestId();
+        request.documentId = reinterpret_cast<quintptr>(document.data()); // Lets the worker use and fill the page caches
+        request.tileX = column;
+        request.tileY = row;
+        request.priority = priority;
+        requestedPages.insert(pageIndex);
+        FrameStats::instance().noteRenderRequested(request.requestId, pageIndex, column, row);
+
+        // Store the request ID so we know which result is ours
+        currentRenderRequestId = request.requestId;
+
+        RenderThread::instance().submitRequest(request);
+    }
 
-        // Apply rotation effect on size
-        if (rotation == 90 || rotation == 270) {
-            size.transpose(); // Swap width/height
+    // Helper to render the next pages in the scroll direction into PageCache,
+    // at their distance from the viewport as priority so visible tiles win
+    void prefetchAhead() {
+        if (!document) return;
+        const int pageCount = document->pageCount();
+        const QRectF viewportRect(documentOffset, q->viewport()->size());
+
+        int firstVisible = -1;
+        int lastVisible = -1;
+        prefetchPages.clear();
+        if (!pagesInSpan(documentOffset.y(), documentOffset.y() + q->viewport()->height(), &firstVisible, &lastVisible)) return;
+
+        const int start = scrollDirection > 0 ? lastVisible + 1 : firstVisible - 1;
+        const int count = prefetchPageCount(calculatePageSizePixels(qBound(0, start, pageCount - 1)));
+        const int tileSize = PageCache::TileSize;
+        const quintptr documentId = reinterpret_cast<quintptr>(document.data());
+        for (int n = 0; n < count; ++n) {
+            const int i = start + n * scrollDirection;
+            if (i < 0 || i >= pageCount) break;
+            const QSize pageSize = calculatePageSizePixels(i);
+            const QRectF pageRect(0, pageTop(i), pageSize.width(), pageSize.height());
+            const int priority = viewportDistance(pageRect, viewportRect);
+            prefetchPages.insert(i);
+
+            // The columns in view horizontally, all rows
+            const QSize image = imageSize(i);
+            const QRect columnsInView = toImageRect(QRectF(viewportRect.left(), 0, viewportRect.width(), pageSize.height()),
+                                                    pageSize, image);
+            if (columnsInView.isEmpty()) continue;
+            PageCache::CacheKey key;
+            key.documentId = documentId;
+            key.pageIndex = i;
+            key.zoomLevel = imageZoom();
+            key.rotation = rotation;
+            key.targetSize = image;
+            for (int row = 0; row <= (image.height() - 1) / tileSize; ++row) {
+                for (int column = columnsInView.left() / tileSize; column <= columnsInView.right() / tileSize; ++column) {
+                    key.tileX = column;
+                    key.tileY = row;
+                    if (PageCache::instance().contains(key) || RenderRegistry::instance().isInFlight(key)) continue;
+                    requestTile(i, image, column, row, priority);
+                }
+            }
+        }
+        if (!prefetchPages.isEmpty()) {
+            LOG_DEBUG("DocumentView: Prefetching " << prefetchPages.size() << " pages from " << start
+                      << " at " << qRound(scrollVelocity) << " px/s.");
+        }
+    }
+
+    // Helper to measure how far a page is from the viewport, in pixels (0 if visible)
+    static int viewportDistance(const QRectF& pageRect, const QRectF& viewportRect) {
+        const qreal dx = qMax<qreal>(0, qMax(viewportRect.left() - pageRect.right(), pageRect.left() - viewportRect.right()));
+        const qreal dy = qMax<qreal>(0, qMax(viewportRect.top() - pageRect.bottom(), pageRect.top() - viewportRect.bottom()));
+        return qRound(dx + dy);
+    }
+
+    // Helper to reorder queued renders after a scroll: nearest pages first,
+    // and pages that left the prefetch window canceled outright
+    void updateRenderPriorities() {
+        if (!document || requestedPages.isEmpty()) return;
+
+        const QRectF viewportRect(documentOffset, q->viewport()->size());
+        const int window = PrefetchScreens * q->viewport()->height();
+        // While flinging, nearness to where the view will stop decides the order
+        const bool predicting = isFlinging();
+        const QRectF targetRect = predicting ? landingRect() : viewportRect;
+        QHash<int, int> distances;
+        QHash<int, int> priorities;
+        for (int i : qAsConst(requestedPages)) {
+            const QSize pageSize = calculatePageSizePixels(i);
+            if (pageSize.isEmpty()) continue; // No longer in the document
+            const QRectF pageRect(0, pageTop(i), pageSize.width(), pageSize.height());
+            distances.insert(i, viewportDistance(pageRect, viewportRect));
+            if (predicting) priorities.insert(i, viewportDistance(pageRect, targetRect));
         }
+
+        for (auto it = requestedPages.begin(); it != requestedPages.end();) {
+            if (distances.value(*it, window + 1) > window && !prefetchPages.contains(*it) && !landingPages.contains(*it)) {
+                if (Page* page = document->page(*it)) {
+                    RenderThread::instance().cancelRequestsForPage(page);
+                }
+                lowResPages.remove(*it);
+                it = requestedPages.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        const QHash<int, int>& order = predicting ? priorities : distances;
+        RenderThread::instance().reprioritize(reinterpret_cast<quintptr>(document.data()),
+            [&order](int pageIndex) { return order.value(pageIndex, RenderThread::BackgroundPriority); });
+    }
+
+    bool isFlinging() const {
+        return flingTimer && flingTimer->isActive();
+    }
+
+    // Helper to get the vertical offset a fling comes to rest at
+    qreal landingOffset() const {
+        const qreal offset = flingPosition + flingVelocity / FlingDecayPerSecond;
+        return qBound<qreal>(0, offset, q->verticalScrollBar()->maximum());
+    }
+
+    // Helper to get the document rect the viewport will show once the fling stops
+    QRectF landingRect() const {
+        return QRectF(QPointF(documentOffset.x(), landingOffset()), q->viewport()->size());
+    }
+
+    // Helper to add one wheel step to the fling, starting it if needed
+    void addFlingImpulse(qreal distance) {
+        if (!isFlinging()) {
+            flingPosition = q->verticalScrollBar()->value();
+            flingVelocity = 0;
+            lowResPages.clear();
+            flingClock.start();
+            const QScreen* screen = q->window()->windowHandle() ? q->window()->windowHandle()->screen()
+                                                                : QGuiApplication::primaryScreen();
+            const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0;
+            flingTimer->start(qMax(4, qRound(1000.0 / refreshRate)));
+        }
+        if (flingVelocity != 0 && (distance > 0) != (flingVelocity > 0)) {
+            flingVelocity = 0; // Reversing stops first
+        }
+        // Adds exactly distance to where the fling stops
+        flingVelocity = qBound(-MaxFlingVelocity, flingVelocity + distance * FlingDecayPerSecond, MaxFlingVelocity);
+        requestLandingTiles();
+        updateRenderPriorities();
+    }
+
+    // Helper to advance the fling by the time since the last frame
+    void flingStep() {
+        if (q->verticalScrollBar()->isSliderDown()) {
+            stopFling(); // The user took over
+            return;
+        }
+        const qreal dt = qMin<qreal>(0.1, flingClock.restart() / 1000.0);
+        const qreal decay = std::exp(-FlingDecayPerSecond * dt);
+        flingPosition += flingVelocity / FlingDecayPerSecond * (1 - decay);
+        flingVelocity *= decay;
+
+        const int maximum = q->verticalScrollBar()->maximum();
+        const bool atEdge = flingPosition <= 0 || flingPosition >= maximum;
+        const bool settled = qAbs(flingVelocity) < FlingStopVelocity;
+        if (atEdge || settled) {
+            flingPosition = qBound<qreal>(0, settled ? landingOffset() : flingPosition, maximum);
+        }
+        const int before = q->verticalScrollBar()->value();
+        q->verticalScrollBar()->setValue(qRound(flingPosition));
+        noteScroll(q->verticalScrollBar()->value() - before);
+        if (atEdge || settled) stopFling();
+    }
+
+    void stopFling() {
+        if (!isFlinging()) return;
+        flingTimer->stop();
+        flingVelocity = 0;
+        landingPages.clear();
+        lowResPages.clear();
+        updateRenderPriorities();
+        q->viewport()->update(); // Pages shown from low-resolution passes get their full tiles
+    }
+
+    // Helper to queue the tiles the viewport will show when the fling stops,
+    // ahead of everything passed on the way
+    void requestLandingTiles() {
+        landingPages.clear();
+        if (!document) return;
+        const QRectF landing = landingRect();
+        int first = -1;
+        int last = -1;
+        if (!pagesInSpan(qFloor(landing.top()), qCeil(landing.bottom()), &first, &last)) return;
+
+        const int tileSize = PageCache::TileSize;
+        PageCache::CacheKey key;
+        key.documentId = reinterpret_cast<quintptr>(document.data());
+        key.zoomLevel = imageZoom();
+        key.rotation = rotation;
+        for (int i = first; i <= last; ++i) {
+            const QSize pageSize = calculatePageSizePixels(i);
+            const QSize image = imageSize(i);
+            const QRectF pageRect(0, pageTop(i), pageSize.width(), pageSize.height());
+            const QRect visible = toImageRect(pageRect.intersected(landing).translated(0, -pageRect.top()), pageSize, image);
+            if (visible.isEmpty()) continue;
+            landingPages.insert(i);
+            key.pageIndex = i;
+            key.targetSize = image;
+            for (int row = visible.top() / tileSize; row <= visible.bottom() / tileSize; ++row) {
+                for (int column = visible.left() / tileSize; column <= visible.right() / tileSize; ++column) {
+                    key.tileX = column;
+                    key.tileY = row;
+                    if (PageCache::instance().contains(key) || RenderRegistry::instance().isInFlight(key)) continue;
+                    requestTile(i, image, column, row, 0);
+                }
+            }
+        }
+    }
+
+    // Zoom tiles are rendered and cached at: the render zoom in device
+    // pixels, so a 2x screen gets sharp images instead of upscaled ones
+    qreal imageZoom() const {
+        return renderZoom() * devicePixelRatio;
+    }
+
+    // Helper to get the size of a page's image at imageZoom(), the pixels tiles are cut from
+    QSize imageSize(int pageIndex) const {
+        if (qFuzzyCompare(devicePixelRatio, 1.0)) return calculatePageSizePixels(pageIndex);
+        return pageSizeAtZoom(pageIndex, imageZoom());
+    }
+
+    // Helper to map part of a page in layout pixels onto its image, clipped to the image
+    static QRect toImageRect(const QRectF& pageRect, const QSize& pageSize, const QSize& imageSize) {
+        if (pageSize.isEmpty()) return QRect();
+        const qreal sx = static_cast<qreal>(imageSize.width()) / pageSize.width();
+        const qreal sy = static_cast<qreal>(imageSize.height()) / pageSize.height();
+        return QRectF(pageRect.x() * sx, pageRect.y() * sy, pageRect.width() * sx, pageRect.height() * sy)
+            .toAlignedRect().intersected(QRect(QPoint(0, 0), imageSize));
+    }
+
+    // Helper to map part of a page's image back to layout pixels
+    static QRectF fromImageRect(const QRect& imageRect, const QSize& pageSize, const QSize& imageSize) {
+        if (imageSize.isEmpty()) return QRectF();
+        const qreal sx = static_cast<qreal>(pageSize.width()) / imageSize.width();
+        const qreal sy = static_cast<qreal>(pageSize.height()) / imageSize.height();
+        return QRectF(imageRect.x() * sx, imageRect.y() * sy, imageRect.width() * sx, imageRect.height() * sy);
+    }
+
+    // Helper to follow the device pixel ratio of the screen the view is on.
+    // Only a ratio change moves to other cache keys; tiles of the old ratio
+    // stay cached and show scaled until the new ones arrive, and moving back
+    // finds them again. Returns true if the ratio changed.
+    bool updateDevicePixelRatio() {
+        const qreal ratio = q->viewport()->devicePixelRatioF();
+        if (qFuzzyCompare(ratio, devicePixelRatio)) return false;
+        LOG_DEBUG("DocumentView: Device pixel ratio changed from " << devicePixelRatio << " to " << ratio);
+        devicePixelRatio = ratio;
+        return true;
+    }
+
+    // Helper to get a page's size in pixels at another zoom than the render zoom
+    QSize pageSizeAtZoom(int pageIndex, qreal zoom) const {
+        ensureLayout();
+        if (pageIndex < 0 || pageIndex >= layout.pointSizes.size()) return QSize();
+        const QSizeF& points = layout.pointSizes.at(pageIndex);
+        QSize size(qMax(1, qRound(points.width() * zoom)), qMax(1, qRound(points.height() * zoom)));
+        if (rotation == 90 || rotation == 270) size.transpose();
         return size;
     }
 
-    // Helper to get document size in pixels (total scrollable area)
-    QSizeF documentSizePixels() const {
-        if (!document || document->pageCount() == 0) return QSizeF();
+    // Helper to render a page the fling only passes over, whole and at a
+    // fraction of the zoom, so it shows scaled instead of blank. Queued
+    // behind the landing pages by its distance from them.
+    void requestLowResPass(int pageIndex) {
+        if (lowResPages.contains(pageIndex)) return;
+        lowResPages.insert(pageIndex);
+        const qreal zoom = PageCache::snapZoom(imageZoom() / LowResZoomDivisor);
+        if (zoom >= imageZoom()) return;
+        const QSize pageSize = pageSizeAtZoom(pageIndex, zoom);
+        if (pageSize.isEmpty()) return;
+
+        const QSize fullSize = calculatePageSizePixels(pageIndex);
+        const int priority = qMax(1, viewportDistance(QRectF(0, pageTop(pageIndex), fullSize.width(), fullSize.height()),
+                                                      landingRect()));
+        const int tileSize = PageCache::TileSize;
+        PageCache::CacheKey key;
+        key.documentId = reinterpret_cast<quintptr>(document.data());
+        key.pageIndex = pageIndex;
+        key.zoomLevel = zoom;
+        key.rotation = rotation;
+        key.targetSize = pageSize;
+        for (int row = 0; row <= (pageSize.height() - 1) / tileSize; ++row) {
+            for (int column = 0; column <= (pageSize.width() - 1) / tileSize; ++column) {
+                key.tileX = column;
+                key.tileY = row;
+                if (PageCache::instance().contains(key) || RenderRegistry::instance().isInFlight(key)) continue;
+                requestTile(pageIndex, pageSize, column, row, priority, zoom);
+            }
+        }
+    }
 
-        int pageCount = document->pageCount();
-        int totalHeight = 0;
+    // Page layout index: every page's size at the render zoom and the
+    // prefix sums of their heights plus spacing, so finding the pages at an
+    // offset is a binary search instead of a walk over the whole document.
+    // Rebuilt lazily: a spacing change shifts the offsets, a rotation swaps
+    // the sizes, and a zoom change rescales the page sizes read once per
+    // document; only a new page count reads the pages again.
+    struct LayoutIndex {
+        const Document* document = nullptr;
+        QVector<QSizeF> pointSizes;  // Unrotated page sizes in points
+        QVector<QSize> pixelSizes;   // Rotated sizes at the render zoom
+        QVector<int> tops;           // tops[i] is the top of page i; one extra entry past the last page
         int maxWidth = 0;
+        qreal zoom = 0;
+        int rotation = 0;
+        int spacing = 0;
+    };
+    mutable LayoutIndex layout;
+
+    // Helper to recompute the offsets and width from the pixel sizes
+    void rebuildOffsets() const {
+        const int count = layout.pixelSizes.size();
+        layout.tops.resize(count + 1);
+        layout.maxWidth = 0;
+        int y = 0;
+        for (int i = 0; i < count; ++i) {
+            layout.tops[i] = y;
+            y += layout.pixelSizes.at(i).height() + pageSpacing;
+            layout.maxWidth = qMax(layout.maxWidth, layout.pixelSizes.at(i).width());
+        }
+        layout.tops[count] = y;
+    }
+
+    // Helper to bring the layout index up to date with the current zoom,
+    // rotation, spacing and page count. O(1) when nothing changed.
+    void ensureLayout() const {
+        const int pageCount = document ? document->pageCount() : 0;
+        const qreal zoom = renderZoom();
+        bool sizesChanged = false;
+
+        if (layout.document != document.data() || layout.pointSizes.size() != pageCount) {
+            layout.document = document.data();
+            layout.pointSizes.resize(pageCount);
+            // Sizes only; pages are not created until they are shown
+            for (int i = 0; i < pageCount; ++i) {
+                layout.pointSizes[i] = document->pageSize(i);
+            }
+            layout.zoom = 0; // Forces the pixel sizes below
+        }
+
+        if (!qFuzzyCompare(layout.zoom, zoom)) {
+            // Pixels per point at 72 DPI, rounded as rendered
+            layout.pixelSizes.resize(pageCount);
+            const bool swapped = (rotation == 90 || rotation == 270);
+            for (int i = 0; i < pageCount; ++i) {
+                const QSizeF& points = layout.pointSizes.at(i);
+                QSize size(qRound(points.width() * zoom), qRound(points.height() * zoom));
+                if (swapped) size.transpose();
+                layout.pixelSizes[i] = size;
+            }
+            layout.zoom = zoom;
+            layout.rotation = rotation;
+            sizesChanged = true;
+        } else if (layout.rotation != rotation) {
+            if ((layout.rotation % 180) != (rotation % 180)) {
+                for (QSize& size : layout.pixelSizes) size.transpose();
+                sizesChanged = true;
+            }
+            layout.rotation = rotation;
+        }
 
-        for (int i = 0; i < pageCount; ++i) {
-            QSize pageSize = calculatePageSizePixels(i);
-            if (pageSize.width() > maxWidth) maxWidth = pageSize.width();
-            totalHeight += pageSize.height();
-            if (i < pageCount - 1) { // Add spacing between pages, except after the last one
-                totalHeight += pageSpacing;
+        if (sizesChanged || layout.tops.size() != pageCount + 1) {
+            rebuildOffsets();
+        } else if (layout.spacing != pageSpacing) {
+            const int delta = pageSpacing - layout.spacing;
+            for (int i = 1; i < layout.tops.size(); ++i) {
+                layout.tops[i] += i * delta;
             }
         }
+        layout.spacing = pageSpacing;
+    }
+
+    // Helper to get the top of a page in document pixels
+    int pageTop(int pageIndex) const {
+        ensureLayout();
+        return (pageIndex >= 0 && pageIndex < layout.tops.size()) ? layout.tops.at(pageIndex) : 0;
+    }
+
+    // Helper to find the pages overlapping a vertical span of the document.
+    // Returns false if there are none.
+    bool pagesInSpan(int top, int bottom, int* first, int* last) const {
+        ensureLayout();
+        const int count = layout.pixelSizes.size();
+        if (count == 0 || bottom <= top) return false;
+        // Last page starting at or above each end of the span
+        auto pageAtOffset = [this, count](int y) {
+            auto it = std::upper_bound(layout.tops.constBegin(), layout.tops.constBegin() + count, y);
+            return qMax(0, static_cast<int>(it - layout.tops.constBegin()) - 1);
+        };
+        int firstPage = pageAtOffset(top);
+        if (layout.tops.at(firstPage) + layout.pixelSizes.at(firstPage).height() <= top) {
+            ++firstPage; // The span starts in the spacing below this page
+        }
+        const int lastPage = pageAtOffset(bottom - 1);
+        if (firstPage > lastPage) return false;
+        *first = firstPage;
+        *last = lastPage;
+        return true;
+    }
+
+    // Zoom pages are laid out and rendered at: the user's zoom snapped to a
+    // PageCache bucket, so small zoom changes keep hitting the same tiles
+    qreal renderZoom() const {
+        const qreal snapped = PageCache::snapZoom(zoomLevel);
+        if (zoomMode != CustomZoom && snapped > zoomLevel) {
+            // Fit modes round down so the page never overflows the viewport
+            const int bucket = PageCache::zoomBucket(zoomLevel) - 1;
+            return std::exp2(static_cast<qreal>(bucket) / PageCache::ZoomBucketsPerDoubling);
+        }
+        return snapped;
+    }
+
+#ifdef HAVE_OPENGL
+    // OpenGL viewport: tiles stay resident as textures and a frame only
+    // changes the view matrix. Null when painting in software.
+    QOpenGLWidget* glViewport = nullptr;
+    std::unique_ptr<GpuTileRenderer> gpuTiles;
+    QOpenGLContext* gpuContext = nullptr; // Context the textures belong to
+
+    // Tile draws collected during a paint and issued in one native block
+    struct GpuDraw {
+        PageCache::CacheKey key;
+        QRectF target;  // Document pixels
+        QRectF source;  // Tile pixels, empty for the whole tile
+        QImage upload;  // Set if the tile is not resident yet
+    };
+    mutable QVector<GpuDraw> gpuDraws;
+
+    // Helper to get the tile renderer if the viewport is OpenGL
+    GpuTileRenderer* activeGpuTiles() {
+        if (!glViewport || !gpuTiles) return nullptr;
+        QOpenGLContext* context = glViewport->context();
+        if (context && context != gpuContext) {
+            // Textures die with their context, e.g. when the window is reparented
+            gpuContext = context;
+            QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, q, [this]() {
+                glViewport->makeCurrent();
+                gpuTiles->releaseResources();
+                glViewport->doneCurrent();
+                gpuContext = nullptr;
+            }, Qt::DirectConnection);
+        }
+        return gpuTiles.get();
+    }
 
-        return QSizeF(maxWidth, totalHeight);
+    // Helper to drop textures with the context current; drop() returns
+    // whether anything went, which is then repainted from PageCache
+    template <typename Drop>
+    void dropGpuTextures(Drop drop) {
+        if (!gpuTiles || !gpuContext) return; // No textures yet
+        glViewport->makeCurrent();
+        const bool dropped = drop();
+        glViewport->doneCurrent();
+        if (dropped) q->viewport()->update();
+    }
+
+    // Helper to issue the collected tile draws. Tiles OpenGL cannot draw
+    // are painted in software instead.
+    void flushGpuDraws(QPainter& painter) {
+        if (gpuDraws.isEmpty()) return;
+        bool drawn = false;
+        painter.beginNativePainting();
+        QMatrix4x4 view;
+        view.translate(-documentOffset.x(), -documentOffset.y());
+        if (gpuTiles->beginFrame(q->viewport()->size(), view)) {
+            for (const GpuDraw& draw : qAsConst(gpuDraws)) {
+                if (!draw.upload.isNull()) gpuTiles->upload(draw.key, draw.upload);
+                gpuTiles->draw(draw.key, draw.target, draw.source);
+            }
+            gpuTiles->endFrame();
+            drawn = true;
+        }
+        painter.endNativePainting();
+        if (!drawn) {
+            for (const GpuDraw& draw : qAsConst(gpuDraws)) {
+                if (draw.upload.isNull()) continue;
+                const QRectF source = draw.source.isEmpty() ? QRectF(draw.upload.rect()) : draw.source;
+                painter.drawImage(draw.target.translated(-documentOffset), draw.upload, source);
+            }
+        }
+        gpuDraws.clear();
+    }
+#endif
+
+    // Helper to draw the part of a missing tile that a rendering at another
+    // zoom level has cached, scaled to the current size. tileRect and
+    // pageSize are in layout pixels. Returns true if anything was drawn.
+    bool drawScaledFallback(QPainter& painter, const PageCache::CacheKey& nearest,
+                            const QRectF& tileRect, const QSize& pageSize, const QPointF& pageOrigin) const {
+        const qreal sx = static_cast<qreal>(nearest.targetSize.width()) / pageSize.width();
+        const qreal sy = static_cast<qreal>(nearest.targetSize.height()) / pageSize.height();
+        const QRectF sourceRect(tileRect.x() * sx, tileRect.y() * sy, tileRect.width() * sx, tileRect.height() * sy);
+        const QRect sourceBounds = sourceRect.toAlignedRect().intersected(QRect(QPoint(0, 0), nearest.targetSize));
+        if (sourceBounds.isEmpty()) return false;
+
+        const int tileSize = PageCache::TileSize;
+        PageCache::CacheKey key = nearest;
+        bool drawn = false;
+        for (int row = sourceBounds.top() / tileSize; row <= sourceBounds.bottom() / tileSize; ++row) {
+            for (int column = sourceBounds.left() / tileSize; column <= sourceBounds.right() / tileSize; ++column) {
+                key.tileX = column;
+                key.tileY = row;
+#ifdef HAVE_OPENGL
+                if (gpuTiles && gpuContext && gpuTiles->contains(key)) {
+                    // Resident: scaling is just a different quad for the same texture
+                    const QRectF tileBounds = QRectF(column * tileSize, row * tileSize, tileSize, tileSize)
+                                                  .intersected(QRectF(QPointF(0, 0), nearest.targetSize));
+                    const QRectF part = tileBounds.intersected(sourceRect);
+                    if (part.isEmpty()) continue;
+                    const QRectF target(pageOrigin.x() + part.x() / sx, pageOrigin.y() + part.y() / sy,
+                                        part.width() / sx, part.height() / sy);
+                    gpuDraws.append({key, target.translated(documentOffset), part.translated(-tileBounds.topLeft()), QImage()});
+                    drawn = true;
+                    continue;
+                }
+#endif
+                // Scans are cached compact and expanded only to be drawn
+                QImage tile = PixelFormat::toPipelineFormat(PageCache::instance().get(key));
+                if (tile.isNull()) continue;
+
+                const QRectF tileBounds(column * tileSize, row * tileSize, tile.width(), tile.height());
+                const QRectF part = tileBounds.intersected(sourceRect);
+                if (part.isEmpty()) continue;
+                const QRectF target(pageOrigin.x() + part.x() / sx, pageOrigin.y() + part.y() / sy,
+                                    part.width() / sx, part.height() / sy);
+                painter.drawImage(target, tile, part.translated(-tileBounds.topLeft()));
+                drawn = true;
+            }
+        }
+        return drawn;
+    }
+
+    // Helper to calculate page size in pixels based on zoom/rotation
+    QSize calculatePageSizePixels(int pageIndex) const {
+        ensureLayout();
+        if (pageIndex < 0 || pageIndex >= layout.pixelSizes.size()) return QSize();
+        return layout.pixelSizes.at(pageIndex);
+    }
+
+    // Helper to map a tile of the rotated page image back to the region of
+    // the unrotated page it shows, in page points. zoom is the one the page
+    // image is rendered at, the render zoom if 0.
+    QRectF tileToPageRect(const QRect& tileRect, const QSize& pageSizePixels, qreal zoom = 0) const {
+        QSize unrotatedSize = pageSizePixels;
+        if (rotation == 90 || rotation == 270) {
+            unrotatedSize.transpose();
+        }
+
+        // Same transform the render worker applies to the unrotated image
+        QTransform toDisplay;
+        switch (rotation) {
+            case 90: toDisplay.translate(unrotatedSize.height(), 0); break;
+            case 180: toDisplay.translate(unrotatedSize.width(), unrotatedSize.height()); break;
+            case 270: toDisplay.translate(0, unrotatedSize.width()); break;
+            default: break;
+        }
+        toDisplay.rotate(rotation);
+
+        QRectF unrotatedRect = toDisplay.inverted().mapRect(QRectF(tileRect));
+        const qreal scale = zoom > 0 ? zoom : renderZoom(); // Pixels per point at 72 DPI, as in calculatePageSizePixels()
+        return QRectF(unrotatedRect.topLeft() / scale, unrotatedRect.size() / scale);
+    }
+
+    // Helper to get document size in pixels (total scrollable area)
+    QSizeF documentSizePixels() const {
+        if (!document || document->pageCount() == 0) return QSizeF();
+
+        ensureLayout();
+        // No spacing after the last page
+        return QSizeF(layout.maxWidth, layout.tops.last() - pageSpacing);
     }
 
     // Helper to convert viewport coordinates to document coordinates
@@ -122,11 +804,185 @@ public:
 
     // Helper to schedule a repaint for a specific page rect
     void scheduleRepaintForPageRect(int pageIndex, const QRectF& pageRect) {
-        QSize pageSize = calculatePageSizePixels(pageIndex);
-        // Calculate the viewport rect for this page section
-        QRect viewportRect = QRect(documentToViewport(pageRect.topLeft()).toPoint(),
-                                   QSize(qRound(pageRect.width()), qRound(pageRect.height())));
-        q->viewport()->update(viewportRect);
+        const QRect viewRect = pageRect.translated(pageViewportRect(pageIndex).topLeft()).toAlignedRect();
+        q->viewport()->update(viewRect);
+    }
+
+    // Helper to find the page under a viewport point and the point on it, in
+    // unrotated page points. Returns false between and beside pages.
+    bool pagePointAt(const QPoint& viewportPos, int* pageIndex, QPointF* pagePoint) const {
+        const QPointF docPos = viewportToDocument(viewportPos);
+        int first, last;
+        if (!pagesInSpan(qFloor(docPos.y()), qFloor(docPos.y()) + 1, &first, &last)) return false;
+
+        const QSize pageSize = calculatePageSizePixels(first);
+        const QPoint local(qFloor(docPos.x()), qFloor(docPos.y()) - pageTop(first));
+        if (!QRect(QPoint(0, 0), pageSize).contains(local)) return false;
+        *pageIndex = first;
+        *pagePoint = tileToPageRect(QRect(local, QSize(1, 1)), pageSize).center();
+        return true;
+    }
+
+    // Helper to track the annotation under the pointer: one hash lookup and
+    // one grid cell in AnnotationManager per event
+    void updateHover(const QPoint& viewportPos) {
+        int pageIndex = -1;
+        QPointF pagePoint;
+        Annotation* annotation = nullptr;
+        if (document && pagePointAt(viewportPos, &pageIndex, &pagePoint)) {
+            if (pageIndex != hoveredPage) {
+                // Pages index the annotations they read from the file on first use
+                if (Page* page = document->page(pageIndex)) page->annotations();
+            }
+            annotation = AnnotationManager::instance().hitTest(document, pageIndex, pagePoint);
+        }
+        hoveredPage = pageIndex;
+        if (annotation == hoveredAnnotation) return;
+        hoveredAnnotation = annotation;
+        q->setCursor(annotation ? Qt::PointingHandCursor : Qt::ArrowCursor);
+        emit q->annotationHovered(annotation ? pageIndex : -1, annotation);
+    }
+
+    // Helper to get the viewport rect of a page
+    QRect pageViewportRect(int pageIndex) const {
+        return QRect(QPoint(0, pageTop(pageIndex)) - documentOffset, calculatePageSizePixels(pageIndex));
+    }
+
+    // Helper to repaint the part of the viewport a finished render covers.
+    // Tiles of another zoom are drawn scaled while exact ones render, so
+    // their area is mapped onto the page at its current size.
+    void invalidateRender(const PageCache::CacheKey& key) {
+        if (!document || key.documentId != reinterpret_cast<quintptr>(document.data())) return;
+        if (key.rotation != rotation || key.pageIndex < 0 || key.pageIndex >= document->pageCount()) return;
+
+        const QRect pageRect = pageViewportRect(key.pageIndex);
+        if (key.tileX < 0 || key.tileY < 0 || key.targetSize.isEmpty()) {
+            q->viewport()->update(pageRect);
+            return;
+        }
+        const int tileSize = PageCache::TileSize;
+        const qreal sx = static_cast<qreal>(pageRect.width()) / key.targetSize.width();
+        const qreal sy = static_cast<qreal>(pageRect.height()) / key.targetSize.height();
+        const QRectF tileRect(key.tileX * tileSize * sx, key.tileY * tileSize * sy, tileSize * sx, tileSize * sy);
+        q->viewport()->update(tileRect.translated(pageRect.topLeft()).toAlignedRect().intersected(pageRect));
+    }
+
+    // Pen width plus antialiasing spill of the selection outline
+    static constexpr int SelectionMargin = 2;
+
+    // Helper to get the band a selection outline covers in the viewport
+    QRegion selectionOutline(const QRectF& selection) const {
+        if (selection.isNull()) return QRegion();
+        const QRect rect = selection.translated(-documentOffset).toAlignedRect();
+        const QRect outer = rect.adjusted(-SelectionMargin, -SelectionMargin, SelectionMargin, SelectionMargin);
+        const QRect inner = rect.adjusted(SelectionMargin, SelectionMargin, -SelectionMargin, -SelectionMargin);
+        return QRegion(outer).subtracted(QRegion(inner));
+    }
+
+    // Helper to repaint what changes when the selection rectangle moves:
+    // the area inside exactly one of the two rects, and both outlines
+    void invalidateSelection(const QRectF& before, const QRectF& after) {
+        QRegion dirty = selectionOutline(before) + selectionOutline(after);
+        const QRegion oldArea(before.translated(-documentOffset).toAlignedRect());
+        const QRegion newArea(after.translated(-documentOffset).toAlignedRect());
+        dirty += oldArea.xored(newArea);
+        q->viewport()->update(dirty);
+    }
+
+    // Helper to get the viewport rect of the frame statistics overlay
+    QRect statsOverlayRect() const {
+        const QFontMetrics metrics(q->font());
+        const int lines = 4;
+        return QRect(8, 8, metrics.horizontalAdvance(QLatin1Char('0')) * 46 + 16, metrics.height() * lines + 12);
+    }
+
+    // Helper to draw the frame statistics of the last second over the view
+    void drawStatsOverlay(QPainter& painter) const {
+        const FrameStats::Summary stats = FrameStats::instance().summary(1000);
+        const QStringList lines = {
+            QString("Paint: %1 fps, avg %2 ms, max %3 ms")
+                .arg(stats.framesPerSecond, 0, 'f', 0).arg(stats.averagePaintMs, 0, 'f', 1).arg(stats.maxPaintMs, 0, 'f', 1),
+            QString("Tiles: %1% from cache").arg(stats.cacheHitRate * 100.0, 0, 'f', 0),
+            QString("Render queue: %1 queued, %2 active").arg(stats.queuedRenders).arg(stats.activeRenders),
+            QString("Render latency: avg %1 ms, max %2 ms (%3)")
+                .arg(stats.averageLatencyMs, 0, 'f', 0).arg(stats.maxLatencyMs, 0, 'f', 0).arg(stats.renders)
+        };
+
+        const QRect rect = statsOverlayRect();
+        painter.save();
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(0, 0, 0, 170));
+        painter.drawRoundedRect(rect, 4, 4);
+        painter.setPen(Qt::white);
+        painter.setFont(q->font());
+        const int lineHeight = QFontMetrics(q->font()).height();
+        for (int i = 0; i < lines.size(); ++i) {
+            painter.drawText(QRect(rect.left() + 8, rect.top() + 6 + i * lineHeight, rect.width() - 16, lineHeight),
+                             Qt::AlignLeft | Qt::AlignVCenter, lines.at(i));
+        }
+        painter.restore();
+    }
+
+    QVariantMap currentViewState() const {
+        return QVariantMap{{"page", currentPageIndex}, {"zoom", zoomLevel}, {"zoomMode", static_cast<int>(zoomMode)},
+                           {"viewMode", static_cast<int>(viewMode)}, {"rotation", rotation},
+                           {"scrollX", documentOffset.x()}, {"scrollY", documentOffset.y()}};
+    }
+
+    // Helper to put the shown document where a saved state left it
+    void applyViewState(const QVariantMap& state) {
+        if (!document || state.isEmpty()) return;
+        viewMode = static_cast<ViewMode>(state.value("viewMode", static_cast<int>(viewMode)).toInt());
+        rotation = ((state.value("rotation", rotation).toInt() % 360) + 360) % 360 / 90 * 90;
+        currentPageIndex = qBound(0, state.value("page").toInt(), qMax(0, document->pageCount() - 1));
+        zoomMode = static_cast<ZoomMode>(state.value("zoomMode", static_cast<int>(zoomMode)).toInt());
+        if (zoomMode == FitPage || zoomMode == FitWidth) {
+            updateZoomForMode();
+        } else if (state.value("zoom").toReal() > 0) {
+            zoomLevel = state.value("zoom").toReal();
+        }
+        documentOffset = QPoint(state.value("scrollX").toInt(), state.value("scrollY").toInt());
+        updateScrollBars(); // Clamps the offset to the document
+
+        const DocumentView* outerView = navigatingView;
+        navigatingView = q;
+        document->setCurrentPageIndex(currentPageIndex);
+        navigatingView = outerView;
+        emit q->zoomLevelChanged(zoomLevel);
+        emit q->currentPageChanged(currentPageIndex);
+        q->viewport()->update();
+    }
+
+    // The placeholder lines up with the tiles only while the view is as it was captured
+    bool placeholderMatches() const {
+        if (placeholder.isNull() || !document || document->filePath() != placeholderPath) return false;
+        const QSize viewportPixels = (QSizeF(q->viewport()->size()) * devicePixelRatio).toSize();
+        return documentOffset == placeholderOffset && qFuzzyCompare(zoomLevel, placeholderZoom)
+            && placeholder.size() == viewportPixels;
+    }
+
+    void clearPlaceholder() {
+        placeholder = QImage();
+        placeholderPath.clear();
+    }
+
+    // Helper to scroll the viewport contents to a new offset. The unchanged
+    // part is moved on screen and only the exposed band is repainted.
+    void scrollTo(const QPoint& offset) {
+        const QPoint delta = documentOffset - offset;
+        documentOffset = offset;
+        updateRenderPriorities();
+        if (delta.isNull()) return;
+        if (qAbs(delta.x()) >= q->viewport()->width() || qAbs(delta.y()) >= q->viewport()->height()) {
+            q->viewport()->update();
+        } else {
+            q->viewport()->scroll(delta.x(), delta.y());
+            if (statsOverlayVisible) {
+                // The overlay stays put while the blit moved a copy of it
+                const QRect overlay = statsOverlayRect();
+                q->viewport()->update(overlay | overlay.translated(delta));
+            }
+        }
     }
 
     // Helper to update scrollbars based on document size and viewport size
@@ -190,6 +1046,9 @@ public:
 
     // Helper to handle a completed render result
     void handleRenderResult(const RenderThread::RenderResult& result) {
+        if (result.success) {
+            noteRenderTime(result.renderTimeMs); // Any view's tiles measure the workers equally well
+        }
         if (result.requestId != currentRenderRequestId) {
             // This result is for an old request, ignore it
             LOG_DEBUG("Ignoring stale render result for request ID: " << result.requestId);
@@ -202,8 +1061,8 @@ public:
             // We need to store this info alongside the request ID.
             // For now, we'll assume a simple page-index-based request.
             // A more robust system would have a map requestId -> PageInfo.
-            LOG_DEBUG("Render result received for request ID: " << result.requestId << ", updating view.");
-            q->viewport()->update(); // Trigger repaint
+            // The tile itself is repainted from RenderRegistry::renderFinished, which knows its key
+            LOG_DEBUG("Render result received for request ID: " << result.requestId);
         } else {
             LOG_ERROR("Render failed for request ID " << result.requestId << ": " << result.errorMessage);
             // Update status bar or show error?
@@ -225,9 +1084,45 @@ DocumentView::DocumentView(QWidget* parent)
 
     // Connect scrollbars to handle scrolling
     connect(horizontalScrollBar(), &QScrollBar::valueChanged,
-            [this](int value) { d->documentOffset.setX(value); viewport()->update(); });
+            [this](int value) { d->scrollTo(QPoint(value, d->documentOffset.y())); });
     connect(verticalScrollBar(), &QScrollBar::valueChanged,
-            [this](int value) { d->documentOffset.setY(value); viewport()->update(); });
+            [this](int value) { d->scrollTo(QPoint(d->documentOffset.x(), value)); });
+
+    // Prefetch once a burst of scroll events has settled
+    d->prefetchTimer = new QTimer(this);
+    d->prefetchTimer->setSingleShot(true);
+    d->prefetchTimer->setInterval(30);
+    connect(d->prefetchTimer, &QTimer::timeout, this, [this]() { d->prefetchAhead(); });
+
+    // Wheel notches fling the view instead of jumping it
+    d->smoothScrolling = Settings::instance().value<bool>("Display/SmoothScrolling", true);
+    d->flingTimer = new QTimer(this);
+    d->flingTimer->setTimerType(Qt::PreciseTimer);
+    connect(d->flingTimer, &QTimer::timeout, this, [this]() { d->flingStep(); });
+
+    // A new color mode is drawn from the cached tiles, transformed on first paint
+    connect(&ColorTransform::instance(), &ColorTransform::transformChanged,
+            this, [this]() { viewport()->update(); });
+
+#ifdef HAVE_OPENGL
+    if (Settings::instance().value<bool>("Display/GpuAcceleration", true)) {
+        d->glViewport = new QOpenGLWidget();
+        setViewport(d->glViewport);
+        d->gpuTiles.reset(new GpuTileRenderer());
+        LOG_INFO("DocumentView: Using an OpenGL viewport.");
+
+        // Textures are copies of cached tiles; drop them when the tiles change
+        connect(&PageCache::instance(), &PageCache::imageReplaced, this, [this](const PageCache::CacheKey& key) {
+            d->dropGpuTextures([this, &key]() { return d->gpuTiles->remove(key); });
+        }, Qt::QueuedConnection);
+        connect(&PageCache::instance(), &PageCache::documentCleared, this, [this](quintptr documentId) {
+            d->dropGpuTextures([this, documentId]() { d->gpuTiles->clearForDocument(documentId); return true; });
+        }, Qt::QueuedConnection);
+        connect(&PageCache::instance(), &PageCache::cleared, this, [this]() {
+            d->dropGpuTextures([this]() { d->gpuTiles->clear(); return true; });
+        }, Qt::QueuedConnection);
+    }
+#endif
 
     // Connect to RenderThread to handle results
     connect(&RenderThread::instance(), &RenderThread::renderCompleted,
@@ -235,8 +1130,41 @@ DocumentView::DocumentView(QWidget* parent)
                 d->handleRenderResult(result);
             });
 
-    // Connect to Settings to react to changes (e.g., background color)
-    // connect(&Settings::instance(), &Settings::valueChanged, this, &DocumentView::onSettingsChanged);
+    // Tiles rendered for this document by any request, including ones this
+    // view joined or left to another view, need a repaint
+    connect(&RenderRegistry::instance(), &RenderRegistry::renderFinished, this,
+            [this](const PageCache::CacheKey& key, bool success) {
+                if (success) {
+                    d->invalidateRender(key);
+                }
+            }, Qt::QueuedConnection);
+
+    // Annotations are drawn into the page, so their page needs a repaint
+    auto updatePage = [this](Document* doc, int pageIndex, Annotation*) {
+        if (doc == d->document && pageIndex >= 0 && pageIndex < doc->pageCount()) {
+            viewport()->update(d->pageViewportRect(pageIndex));
+        }
+    };
+    connect(&AnnotationManager::instance(), &AnnotationManager::annotationAdded, this, updatePage);
+    connect(&AnnotationManager::instance(), &AnnotationManager::annotationRemoved, this, updatePage);
+    connect(&AnnotationManager::instance(), &AnnotationManager::annotationsChanged, this,
+            [this](Document* doc) {
+                if (doc == d->document) viewport()->update(); // Bulk change; no one page
+            });
+
+    // Frame statistics overlay, also reachable from the View menu
+    d->statsTimer = new QTimer(this);
+    d->statsTimer->setInterval(500);
+    connect(d->statsTimer, &QTimer::timeout, this, [this]() { viewport()->update(d->statsOverlayRect()); });
+    setStatsOverlayVisible(Settings::instance().value<bool>("Display/ShowFrameStats", false));
+
+    // Painting reads the background from Settings::snapshot(); a new one needs a repaint
+    connect(&Settings::instance(), &Settings::valueChanged, this,
+            [this](const QString& key, const QVariant&) {
+                if (key == "Display/BackgroundColor") {
+                    viewport()->update();
+                }
+            });
 
     LOG_INFO("DocumentView initialized.");
 }
@@ -247,19 +1175,41 @@ DocumentView::~DocumentView()
     if (d->currentRenderRequestId != 0) {
         RenderThread::instance().cancelRequest(d->currentRenderRequestId);
     }
+#ifdef HAVE_OPENGL
+    if (d->glViewport && d->gpuContext) {
+        d->glViewport->makeCurrent();
+        d->gpuTiles->releaseResources();
+        d->glViewport->doneCurrent();
+    }
+#endif
     LOG_INFO("DocumentView destroyed.");
 }
 
 void DocumentView::setDocument(Document* document)
 {
     if (d->document == document) return;
+    d->stopFling();
 
     // Disconnect from old document signals if necessary
     if (d->document) {
-        // disconnect(d->document, ...);
+        if (!d->document->filePath().isEmpty()) {
+            d->viewStates.insert(d->document->filePath(), d->currentViewState());
+        }
+        disconnect(d->document, &Document::pageCountChanged, this, nullptr);
+        disconnect(d->document, &Document::pageSizesChanged, this, nullptr);
     }
 
     d->document = document; // Use QPointer
+    d->layout = Private::LayoutIndex(); // A new document may reuse the old one's address
+    d->hoveredPage = -1;
+    d->hoveredAnnotation = nullptr;
+#ifdef HAVE_OPENGL
+    if (d->gpuTiles && d->gpuContext && d->document) {
+        d->glViewport->makeCurrent();
+        d->gpuTiles->clearForDocument(reinterpret_cast<quintptr>(d->document.data()));
+        d->glViewport->doneCurrent();
+    }
+#endif
     d->currentPageIndex = 0; // Reset to first page
 
     if (document) {
@@ -268,16 +1218,30 @@ void DocumentView::setDocument(Document* document)
             setDocument(nullptr); // Clear if document is closed elsewhere
         });
         connect(document, &Document::currentPageChanged, this, [this](int index) {
+            if (navigatingView && navigatingView != this) return; // Another view of the same document moved
             d->currentPageIndex = index;
             goToPage(index); // Ensure view reflects the change
         });
         // Connect to page count changes to update scroll bars
-        // connect(document, &Document::pageCountChanged, this, [this]() { d->updateScrollBars(); });
+        connect(document, &Document::pageCountChanged, this, [this]() {
+            d->updateScrollBars(); // The layout index notices the new count
+            viewport()->update();
+        });
+        connect(document, &Document::pageSizesChanged, this, [this]() {
+            d->layout.document = nullptr; // Makes the layout index read the sizes again
+            d->updateScrollBars();
+            viewport()->update();
+        });
 
         // Update zoom mode if set to auto-fit
         if (d->zoomMode == FitPage || d->zoomMode == FitWidth) {
             d->updateZoomForMode();
         }
+        // Back where it was left, if it was shown before or restored from a session
+        const auto saved = d->viewStates.constFind(document->filePath());
+        if (saved != d->viewStates.constEnd()) {
+            d->applyViewState(saved.value());
+        }
         LOG_INFO("DocumentView set to document: " << document->filePath());
     } else {
         LOG_INFO("DocumentView cleared (no document).");
@@ -351,9 +1315,13 @@ void DocumentView::goToPage(int pageIndex)
 
     int oldPageIndex = d->currentPageIndex;
     d->currentPageIndex = pageIndex;
+    d->stopFling();
 
     // Update document's current page index
+    const DocumentView* outerView = navigatingView;
+    navigatingView = this;
     d->document->setCurrentPageIndex(pageIndex);
+    navigatingView = outerView;
 
     // Update zoom if in FitPage/Width mode
     if (d->zoomMode == FitPage || d->zoomMode == FitWidth) {
@@ -362,10 +1330,7 @@ void DocumentView::goToPage(int pageIndex)
 
     // Scroll to the new page
     QSize pageSize = d->calculatePageSizePixels(pageIndex);
-    int targetY = 0;
-    for (int i = 0; i < pageIndex; ++i) {
-        targetY += d->calculatePageSizePixels(i).height() + d->pageSpacing;
-    }
+    int targetY = d->pageTop(pageIndex);
     // Calculate the target position to center the page vertically if possible
     int viewHeight = viewport()->height();
     int scrollY = targetY - (viewHeight - pageSize.height()) / 2;
@@ -412,115 +1377,246 @@ void DocumentView::setPageSpacing(int spacing)
     }
 }
 
+void DocumentView::setStatsOverlayVisible(bool visible)
+{
+    if (d->statsOverlayVisible == visible) return;
+    d->statsOverlayVisible = visible;
+    if (visible) {
+        FrameStats::instance().setEnabled(true);
+        d->statsTimer->start();
+    } else {
+        d->statsTimer->stop();
+    }
+    viewport()->update(d->statsOverlayRect());
+}
+
+bool DocumentView::isStatsOverlayVisible() const
+{
+    return d->statsOverlayVisible;
+}
+
+QVariantMap DocumentView::viewState(const Document* document) const
+{
+    if (!document || document == d->document) {
+        return d->document ? d->currentViewState() : QVariantMap();
+    }
+    return d->viewStates.value(document->filePath());
+}
+
+void DocumentView::setViewState(Document* document, const QVariantMap& state)
+{
+    if (!document) return;
+    if (document == d->document) {
+        d->applyViewState(state);
+    } else {
+        d->viewStates.insert(document->filePath(), state);
+    }
+}
+
+QImage DocumentView::captureViewport()
+{
+    return viewport()->grab().toImage();
+}
+
+void DocumentView::setPlaceholder(const QString& filePath, const QImage& image, const QVariantMap& state)
+{
+    d->placeholderPath = filePath;
+    d->placeholder = image;
+    d->placeholderOffset = QPoint(state.value("scrollX").toInt(), state.value("scrollY").toInt());
+    d->placeholderZoom = state.value("zoom").toReal();
+    viewport()->update();
+}
+
 void DocumentView::paintEvent(QPaintEvent* event)
 {
+    const qint64 frameStartUs = FrameStats::instance().nowUs();
+    int cacheHits = 0;
+    int cacheMisses = 0;
+
     QPainter painter(viewport());
     painter.setRenderHint(QPainter::Antialiasing);
     painter.setRenderHint(QPainter::SmoothPixmapTransform);
 
     if (!d->document) {
-        // Draw a blank background
+        // Draw a blank background, or the restored session's screen while its document loads
         painter.fillRect(event->rect(), palette().window());
+        if (!d->placeholder.isNull()) {
+            painter.drawImage(QRectF(viewport()->rect()), d->placeholder);
+        }
         return;
     }
+    d->updateDevicePixelRatio(); // Moving to a screen of another density retiles here
+    const bool usePlaceholder = d->placeholderMatches();
+
+    // Only the damaged part of the viewport is repainted; the painter is
+    // already clipped to it. An OpenGL viewport redraws its whole frame.
+    QRegion dirty = event->region();
+#ifdef HAVE_OPENGL
+    GpuTileRenderer* gpuTiles = d->activeGpuTiles();
+    if (gpuTiles) {
+        dirty = QRegion(viewport()->rect());
+    }
+#endif
+    const QRect dirtyRect = dirty.boundingRect();
 
     // Draw background
-    painter.fillRect(painter.viewport(), Settings::instance().value<QColor>("Display/BackgroundColor", Qt::white));
+    painter.fillRect(dirtyRect, Settings::snapshot().backgroundColor);
 
-    // Iterate through visible pages and draw them
-    int pageCount = d->document->pageCount();
+    // Determine which pages are damaged based on scroll offset and the dirty area
+    QRectF viewportRect = QRectF(dirtyRect).translated(d->documentOffset);
     int firstVisiblePage = -1;
     int lastVisiblePage = -1;
+    const bool anyVisible = d->pagesInSpan(d->documentOffset.y() + dirtyRect.top(),
+                                           d->documentOffset.y() + dirtyRect.top() + dirtyRect.height(),
+                                           &firstVisiblePage, &lastVisiblePage);
 
-    // Determine which pages are visible based on scroll offset and viewport size
-    QRectF viewportRect = QRectF(d->documentOffset, viewport()->size());
-    int currentY = 0;
-    
-    // --- Draw Selection Rectangle ---
-    if (!d->currentSelectionRect.isEmpty()) {
-        // The selection rect is in document coordinates. Transform it to viewport coordinates for painting.
-        QRectF viewportSelectionRect = d->currentSelectionRect.translated(-d->documentOffset.x(), -d->documentOffset.y());
-
-        // Draw a semi-transparent overlay for the selection
-        painter.save();
-        painter.setPen(QPen(Qt::blue, 1, Qt::DashLine));
-        painter.setBrush(QColor(0, 0, 255, 50)); // Semi-transparent blue
-        painter.drawRect(viewportSelectionRect);
-        painter.restore();
-    }
-
-    for (int i = 0; i < pageCount; ++i) {
+    // Iterate through visible pages and draw them
+    for (int i = firstVisiblePage; anyVisible && i <= lastVisiblePage; ++i) {
         QSize pageSize = d->calculatePageSizePixels(i);
+        const int currentY = d->pageTop(i);
         QRectF pageRect(0, currentY, pageSize.width(), pageSize.height());
 
-        if (pageRect.intersects(viewportRect)) {
-            if (firstVisiblePage == -1) firstVisiblePage = i;
-            lastVisiblePage = i;
-
+        if (pageRect.intersects(viewportRect)) { // Narrow pages may be scrolled out horizontally
             // Draw page background
-            painter.fillRect(pageRect.translated(-d->documentOffset), Qt::lightGray);
+            QRectF pageViewRect = pageRect.translated(-d->documentOffset);
+            painter.fillRect(pageViewRect, Qt::lightGray);
 
             // --- Attempt to Render Page Content ---
-            // This is where the core rendering logic connects to the UI.
-            // We need to get the page image.
-            // 1. Check PageCache
+            // Pages are cached as fixed-size tiles and only the tiles that
+            // intersect the viewport are fetched or requested, so memory use
+            // follows the viewport size rather than the zoom level.
+            // Tiles are cut from the page's image in device pixels and
+            // drawn back at layout size, one image pixel per screen pixel.
+            const QSize imageSize = d->imageSize(i);
+            const QRect visibleRect = Private::toImageRect(pageRect.intersected(viewportRect).translated(0, -currentY),
+                                                           pageSize, imageSize);
+            const int tileSize = PageCache::TileSize;
+            const int firstColumn = visibleRect.left() / tileSize;
+            const int lastColumn = visibleRect.right() / tileSize;
+            const int firstRow = visibleRect.top() / tileSize;
+            const int lastRow = visibleRect.bottom() / tileSize;
+
             PageCache::CacheKey cacheKey;
             cacheKey.documentId = reinterpret_cast<quintptr>(d->document.data());
             cacheKey.pageIndex = i;
-            cacheKey.zoomLevel = d->zoomLevel;
+            cacheKey.zoomLevel = d->imageZoom();
             cacheKey.rotation = d->rotation;
-            cacheKey.targetSize = pageSize;
+            cacheKey.targetSize = imageSize;
+            const quint32 colorTransform = ColorTransform::instance().currentId();
+
+            // Looked up on the first missing tile: a rendering of this page
+            // at another zoom to show scaled until the exact tiles arrive
+            PageCache::CacheKey nearestKey;
+            int nearestState = -1; // -1 not looked up, 0 none, 1 found
+            // Failing that, the image stored from an earlier session
+            QImage storedPreview;
+
+            for (int row = firstRow; row <= lastRow; ++row) {
+                for (int column = firstColumn; column <= lastColumn; ++column) {
+                    QRect tileRect = QRect(column * tileSize, row * tileSize, tileSize, tileSize)
+                                         .intersected(QRect(QPoint(0, 0), imageSize));
+                    if (tileRect.isEmpty()) continue;
+                    const QRectF tileLayoutRect = Private::fromImageRect(tileRect, pageSize, imageSize);
+                    QRectF tileViewRect = tileLayoutRect.translated(pageViewRect.topLeft());
+                    if (!dirty.intersects(tileViewRect.toAlignedRect())) continue; // Outside the damaged region
+
+                    // 1. Check video memory, then PageCache
+                    cacheKey.tileX = column;
+                    cacheKey.tileY = row;
+                    // Tiles are rendered as is and shown in the current color mode
+                    PageCache::CacheKey shownKey = cacheKey;
+                    shownKey.colorTransform = colorTransform;
+#ifdef HAVE_OPENGL
+                    const QRectF tileDocumentRect = tileLayoutRect.translated(pageRect.topLeft());
+                    if (gpuTiles && gpuTiles->contains(shownKey)) {
+                        d->gpuDraws.append({shownKey, tileDocumentRect, QRectF(), QImage()});
+                        ++cacheHits;
+                        continue;
+                    }
+#endif
+                    // Scans are cached compact and expanded only to be drawn
+                    QImage cachedTile = PixelFormat::toPipelineFormat(PageCache::instance().get(shownKey));
+                    if (!cachedTile.isNull()) {
+                        ++cacheHits;
+#ifdef HAVE_OPENGL
+                        if (gpuTiles) {
+                            d->gpuDraws.append({shownKey, tileDocumentRect, QRectF(), cachedTile}); // Uploaded once
+                            continue;
+                        }
+#endif
+                        painter.drawImage(tileViewRect, cachedTile); // Unscaled on screen at the device ratio
+                        continue;
+                    }
 
-            QImage cachedImage = PageCache::instance().get(cacheKey);
-            if (!cachedImage.isNull()) {
-                // Use cached image
-                painter.drawImage(pageRect.translated(-d->documentOffset).topLeft().toPoint(), cachedImage);
-            } else {
-                // No cache hit, request render via RenderThread
-                // Check if a request is already pending for this exact state
-                if (PageCache::instance().contains(cacheKey)) {
-                     // A request might be in progress, draw a placeholder or wait indicator
-                     painter.fillRect(pageRect.translated(-d->documentOffset), Qt::darkGray);
-                     painter.setPen(Qt::white);
-                     painter.drawText(pageRect.translated(-d->documentOffset), Qt::AlignCenter, tr("Loading..."));
-                } else {
-                     // Submit a new render request
-                     RenderThread::RenderRequest request;
-                     request.page = d->document->page(i);
-                     request.targetSize = pageSize;
-                     request.zoomLevel = d->zoomLevel;
-                     request.rotation = d->rotation;
-                     request.clipRect = QRectF(); // Render full page for now
-                     request.highQuality = true; // Or determine based on zoom level
-                     request.requestId = ++(d->renderRequestCounter); // Generate unique ID
-
-                     // Store the request ID so we know which result is ours
-                     d->currentRenderRequestId = request.requestId;
-
-                     RenderThread::instance().submitRequest(request);
-                     LOG_DEBUG("Submitted render request for page " << i << ", Request ID: " << request.requestId);
-
-                     // Draw a placeholder while rendering
-                     painter.fillRect(pageRect.translated(-d->documentOffset), Qt::darkGray);
-                     painter.setPen(Qt::white);
-                     painter.drawText(pageRect.translated(-d->documentOffset), Qt::AlignCenter, tr("Rendering..."));
+                    // 2. No cache hit, request the tile via RenderThread unless
+                    // it is already queued or rendering
+                    ++cacheMisses;
+                    if (!RenderRegistry::instance().isInFlight(cacheKey)) {
+                        if (d->isFlinging() && !d->landingPages.contains(i)) {
+                            // Only passing through: a coarse pass, after the pages the fling stops at
+                            d->requestLowResPass(i);
+                        } else {
+                            // Visible now; updateRenderPriorities() adjusts it on scroll
+                            d->requestTile(i, imageSize, column, row, 0);
+                        }
+                    }
+
+                    if (usePlaceholder) {
+                        // The previous session's pixels are exactly what this tile will show
+                        const qreal ratio = d->devicePixelRatio;
+                        painter.drawImage(tileViewRect, d->placeholder,
+                                          QRectF(tileViewRect.topLeft() * ratio, tileViewRect.size() * ratio));
+                        continue;
+                    }
+
+                    // Draw the nearest cached zoom scaled, or a placeholder, while rendering
+                    painter.fillRect(tileViewRect, Qt::darkGray);
+                    if (nearestState < 0) {
+                        nearestState = PageCache::instance().findNearestZoom(cacheKey, &nearestKey) ? 1 : 0;
+                        nearestKey.colorTransform = colorTransform;
+                    }
+                    if (nearestState > 0) {
+                        d->drawScaledFallback(painter, nearestKey, tileLayoutRect, pageSize, pageViewRect.topLeft());
+                    } else if (d->rotation == 0) { // Stored images are unrotated
+                        if (storedPreview.isNull()) {
+                            storedPreview = ColorTransform::instance().apply(
+                                ThumbnailStore::instance().bestImage(d->document->filePath(), i), colorTransform);
+                        }
+                        if (!storedPreview.isNull()) {
+                            const qreal sx = static_cast<qreal>(storedPreview.width()) / pageSize.width();
+                            const qreal sy = static_cast<qreal>(storedPreview.height()) / pageSize.height();
+                            const QRectF source(tileLayoutRect.x() * sx, tileLayoutRect.y() * sy,
+                                                tileLayoutRect.width() * sx, tileLayoutRect.height() * sy);
+                            painter.drawImage(tileViewRect, storedPreview, source);
+                        }
+                    }
                 }
             }
             // --- End Rendering Logic ---
         }
-
-        currentY += pageSize.height() + d->pageSpacing; // Move to next page position
     }
+#ifdef HAVE_OPENGL
+    if (gpuTiles) {
+        d->flushGpuDraws(painter);
+    }
+#endif
 
     // Draw selection rectangle if active
     if (d->isSelecting) {
-        QRectF selRect = QRectF(d->selectionStartPoint, d->selectionEndPoint).normalized();
-        selRect.translate(-d->documentOffset); // Adjust for scroll offset
+        const QRectF selRect = d->currentSelectionRect.translated(-d->documentOffset);
         painter.setPen(QPen(Qt::blue, 1, Qt::DashLine));
         painter.setBrush(QColor(0, 0, 255, 50)); // Semi-transparent blue
         painter.drawRect(selRect);
     }
 
+    if (d->statsOverlayVisible && dirty.intersects(d->statsOverlayRect())) {
+        d->drawStatsOverlay(painter);
+    }
+    FrameStats::instance().recordFrame(frameStartUs, cacheHits, cacheMisses);
+    if (!d->placeholder.isNull() && (!usePlaceholder || (cacheMisses == 0 && dirty == QRegion(viewport()->rect())))) {
+        d->clearPlaceholder(); // Moved away, or every tile it stood in for has arrived
+    }
+
     // Draw page borders (optional, for debugging or visual clarity)
     // painter.setPen(Qt::gray);
     // for (int i = firstVisiblePage; i <= lastVisiblePage; ++i) {
@@ -554,20 +1650,35 @@ void DocumentView::wheelEvent(QWheelEvent* event)
 
         setZoomLevel(zoomLevel() * factor);
         event->accept(); // Handle the event here
+    } else if (d->smoothScrolling && d->document && event->pixelDelta().isNull() && event->angleDelta().y() != 0) {
+        // Mouse wheel notches; touchpads send pixel deltas that are smooth already
+        const qreal steps = event->angleDelta().y() / 120.0;
+        d->addFlingImpulse(-steps * QApplication::wheelScrollLines() * Private::WheelStepPixels);
+        event->accept();
     } else {
-        // Default scroll behavior
+        // Default scroll behavior; the resulting offset change feeds the prefetcher
+        d->stopFling();
+        const int before = verticalScrollBar()->value();
         QAbstractScrollArea::wheelEvent(event);
+        d->noteScroll(verticalScrollBar()->value() - before);
     }
 }
 
 void DocumentView::mousePressEvent(QMouseEvent* event)
 {
-    if (event->button() == Qt::LeftButton) {
+    d->stopFling(); // A click stops the view where it is
+    if (event->button() == Qt::LeftButton && !(event->modifiers() & Qt::ShiftModifier)) {
+        d->updateHover(event->pos());
+    }
+    if (event->button() == Qt::LeftButton && !(event->modifiers() & Qt::ShiftModifier) && d->hoveredAnnotation) {
+        emit annotationClicked(d->hoveredPage, d->hoveredAnnotation);
+    } else if (event->button() == Qt::LeftButton) {
         if (event->modifiers() & Qt::ShiftModifier) {
             // Start selection
             d->isSelecting = true;
             d->selectionStartPoint = d->selectionEndPoint = event->pos();
-            viewport()->update(); // Trigger repaint to show selection rect
+            d->currentSelectionRect = QRectF(d->viewportToDocument(event->pos()), QSizeF(0, 0));
+            d->invalidateSelection(QRectF(), d->currentSelectionRect);
         } else {
             // Start panning
             d->isPanning = true;
@@ -597,7 +1708,7 @@ void DocumentView::mousePressEvent(QMouseEvent* event)
             d->selectionEndPoint = event->pos();
             // Convert viewport point to document coordinates (PDF points)
             d->currentSelectionRect = QRectF(d->viewportToDocument(event->pos()), QSizeF(0, 0));
-            viewport()->update(); // Trigger repaint to show selection rect
+            d->invalidateSelection(QRectF(), d->currentSelectionRect);
         } else {
             // Start panning (existing logic)
             d->isPanning = true;
@@ -612,15 +1723,13 @@ void DocumentView::mouseMoveEvent(QMouseEvent* event)
 {
     if (d->isPanning) {
         QPoint delta = event->pos() - d->lastPanPoint;
-        d->documentOffset += delta;
-        d->documentOffset.setX(qMax(0, d->documentOffset.x()));
-        d->documentOffset.setY(qMax(0, d->documentOffset.y()));
-        // Update scrollbars to reflect new offset
-        horizontalScrollBar()->setValue(d->documentOffset.x());
-        verticalScrollBar()->setValue(d->documentOffset.y());
+        const QPoint target = d->documentOffset + delta;
+        // The scrollbars clamp the offset and scroll the viewport
+        horizontalScrollBar()->setValue(qMax(0, target.x()));
+        verticalScrollBar()->setValue(qMax(0, target.y()));
         d->lastPanPoint = event->pos();
-        viewport()->update(); // Repaint
     } else if (d->isSelecting) {
+        const QRectF previousSelectionRect = d->currentSelectionRect;
         d->selectionEndPoint = event->pos(); // Update endpoint in viewport coordinates
         // Calculate selection rectangle in document coordinates
         QPointF startDoc = d->viewportToDocument(d->selectionStartPoint);
@@ -663,7 +1772,9 @@ void DocumentView::mouseMoveEvent(QMouseEvent* event)
                 }
             }
         }
-        viewport()->update(); // Repaint to update selection rect
+        d->invalidateSelection(previousSelectionRect, d->currentSelectionRect);
+    } else if (event->buttons() == Qt::NoButton) {
+        d->updateHover(event->pos());
     }
     event->accept();
 }
@@ -699,9 +1810,10 @@ void DocumentView::mouseReleaseEvent(QMouseEvent* event)
             }
 
             // Clear selection visuals
+            const QRectF previousSelectionRect = d->currentSelectionRect;
             d->currentSelectionRect = QRectF();
             d->selectedText.clear();
-            viewport()->update();
+            d->invalidateSelection(previousSelectionRect, QRectF());
         }
     }
     event->accept();
@@ -709,6 +1821,8 @@ void DocumentView::mouseReleaseEvent(QMouseEvent* event)
 
 void DocumentView::keyPressEvent(QKeyEvent* event)
 {
+    d->stopFling();
+    const int scrollBefore = verticalScrollBar()->value();
     bool handled = false;
     switch (event->key()) {
         case Qt::Key_Plus:
@@ -788,6 +1902,7 @@ void DocumentView::keyPressEvent(QKeyEvent* event)
     } else {
         event->accept();
     }
+    d->noteScroll(verticalScrollBar()->value() - scrollBefore);
 }
 
 void DocumentView::contextMenuEvent(QContextMenuEvent* event)
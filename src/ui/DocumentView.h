@@ -10,6 +10,8 @@
 #ifndef QUANTILYX_DOCUMENTVIEW_H
 #define QUANTILYX_DOCUMENTVIEW_H
 
+#include <QImage>
+#include <QVariantMap>
 #include <QWidget>
 #include <memory>
 
@@ -17,6 +19,7 @@ namespace QuantilyxDoc {
 
 class Document;
 class Page;
+class Annotation;
 class DocumentRenderer;
 
 /**
@@ -134,6 +137,53 @@ public:
      */
     void setPageSpacing(int spacing);
 
+    /**
+     * @brief Show or hide the frame statistics overlay. Showing it starts
+     * FrameStats recording.
+     * @param visible True to show
+     */
+    void setStatsOverlayVisible(bool visible);
+
+    /**
+     * @brief Check if the frame statistics overlay is shown
+     * @return True if shown
+     */
+    bool isStatsOverlayVisible() const;
+
+    /**
+     * @brief Get where a document is viewed, for session restore
+     * @param document Document; nullptr for the one shown
+     * @return Page, zoom, zoom mode, view mode, rotation and scroll offset;
+     *         empty if the document was never shown in this view
+     */
+    QVariantMap viewState(const Document* document = nullptr) const;
+
+    /**
+     * @brief Set where a document is viewed
+     * Applied at once if the document is shown, otherwise when it next is.
+     * @param document Document
+     * @param state State from viewState()
+     */
+    void setViewState(Document* document, const QVariantMap& state);
+
+    /**
+     * @brief Capture what the viewport shows
+     * @return Image in device pixels
+     */
+    QImage captureViewport();
+
+    /**
+     * @brief Show an earlier session's viewport until the document's tiles render
+     * The image stands in for tiles not yet rendered while the document at
+     * filePath is shown as state left it; it is dropped once the view moves
+     * or every visible tile is rendered. Before the document arrives it
+     * fills the empty view.
+     * @param filePath Document the image shows
+     * @param image Image from captureViewport()
+     * @param state View state the image was captured in
+     */
+    void setPlaceholder(const QString& filePath, const QImage& image, const QVariantMap& state);
+
 signals:
     /**
      * @brief Emitted when current page changes
@@ -152,6 +202,20 @@ signals:
      */
     void documentModified();
 
+    /**
+     * @brief Emitted when the pointer moves onto an annotation or off one
+     * @param pageIndex Page of the annotation, or -1
+     * @param annotation Annotation under the pointer, or nullptr
+     */
+    void annotationHovered(int pageIndex, QuantilyxDoc::Annotation* annotation);
+
+    /**
+     * @brief Emitted when an annotation is clicked
+     * @param pageIndex Page of the annotation
+     * @param annotation Annotation clicked
+     */
+    void annotationClicked(int pageIndex, QuantilyxDoc::Annotation* annotation);
+
 protected:
     /**
      * @brief Handle paint event
@@ -167,6 +231,8 @@ protected:
 
     /**
      * @brief Handle mouse wheel event
+     * Ctrl zooms. Otherwise wheel notches start or extend a kinetic scroll
+     * (Display/SmoothScrolling) whose landing page is rendered first.
      * @param event Wheel event
      */
     void wheelEvent(QWheelEvent* event) override;
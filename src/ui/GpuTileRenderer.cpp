@@ -0,0 +1,260 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "GpuTileRenderer.h"
+
+#ifdef HAVE_OPENGL
+
+#include "../core/Settings.h"
+#include "../core/Logger.h"
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <list>
+#include <unordered_map>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+const char* const VertexShader =
+    "attribute highp vec2 position;\n"
+    "attribute highp vec2 texCoord;\n"
+    "uniform highp mat4 matrix;\n"
+    "varying highp vec2 v_texCoord;\n"
+    "void main() {\n"
+    "    v_texCoord = texCoord;\n"
+    "    gl_Position = matrix * vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+const char* const FragmentShader =
+    "uniform sampler2D tile;\n"
+    "varying highp vec2 v_texCoord;\n"
+    "void main() {\n"
+    "    gl_FragColor = texture2D(tile, v_texCoord);\n"
+    "}\n";
+
+} // namespace
+
+class GpuTileRenderer::Private {
+public:
+    struct Entry {
+        std::unique_ptr<QOpenGLTexture> texture;
+        QSize size;
+        qint64 bytes;
+        std::list<PageCache::CacheKey>::iterator lruPosition;
+    };
+
+    Private() : initialized(false), failed(false), inFrame(false), bytes(0) {}
+
+    QOpenGLFunctions gl;
+    std::unique_ptr<QOpenGLShaderProgram> program;
+    bool initialized;
+    bool failed;
+    bool inFrame; // Between beginFrame() and endFrame(); eviction waits
+    QMatrix4x4 matrix; // Projection times view for the current frame
+
+    std::unordered_map<PageCache::CacheKey, Entry, PageCache::CacheKeyHash> textures;
+    std::list<PageCache::CacheKey> lru; // Most recently drawn first
+    qint64 bytes;
+
+    qint64 budgetBytes() const {
+        return static_cast<qint64>(Settings::snapshot().gpuTextureCacheMB) * 1024 * 1024;
+    }
+
+    bool initialize() {
+        if (initialized || failed) return initialized;
+        gl.initializeOpenGLFunctions();
+        program.reset(new QOpenGLShaderProgram());
+        if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, VertexShader) ||
+            !program->addShaderFromSourceCode(QOpenGLShader::Fragment, FragmentShader) ||
+            !program->link()) {
+            LOG_ERROR("GpuTileRenderer: Failed to build tile shader: " << program->log());
+            program.reset();
+            failed = true;
+            return false;
+        }
+        initialized = true;
+        LOG_INFO("GpuTileRenderer: OpenGL tile drawing initialized.");
+        return true;
+    }
+
+    void touch(Entry& entry, const PageCache::CacheKey& key) {
+        lru.erase(entry.lruPosition);
+        lru.push_front(key);
+        entry.lruPosition = lru.begin();
+    }
+
+    void remove(std::unordered_map<PageCache::CacheKey, Entry, PageCache::CacheKeyHash>::iterator it) {
+        bytes -= it->second.bytes;
+        lru.erase(it->second.lruPosition);
+        textures.erase(it);
+    }
+
+    void evictToBudget() {
+        const qint64 budget = budgetBytes();
+        while (bytes > budget && !lru.empty()) {
+            auto it = textures.find(lru.back());
+            if (it == textures.end()) {
+                lru.pop_back();
+                continue;
+            }
+            remove(it);
+        }
+    }
+};
+
+GpuTileRenderer::GpuTileRenderer()
+    : d(new Private())
+{
+}
+
+GpuTileRenderer::~GpuTileRenderer() = default;
+
+bool GpuTileRenderer::contains(const PageCache::CacheKey& key) const
+{
+    return d->textures.find(key) != d->textures.end();
+}
+
+void GpuTileRenderer::upload(const PageCache::CacheKey& key, const QImage& image)
+{
+    if (!d->initialized || image.isNull()) return;
+
+    auto existing = d->textures.find(key);
+    if (existing != d->textures.end()) {
+        d->remove(existing);
+    }
+
+    std::unique_ptr<QOpenGLTexture> texture(new QOpenGLTexture(QOpenGLTexture::Target2D));
+    texture->setData(image, QOpenGLTexture::DontGenerateMipMaps);
+    texture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+    texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+
+    d->lru.push_front(key);
+    Private::Entry entry;
+    entry.texture = std::move(texture);
+    entry.size = image.size();
+    entry.bytes = static_cast<qint64>(image.width()) * image.height() * 4;
+    entry.lruPosition = d->lru.begin();
+    d->bytes += entry.bytes;
+    d->textures.emplace(key, std::move(entry));
+    if (!d->inFrame) d->evictToBudget(); // A frame may still draw the oldest tiles
+}
+
+bool GpuTileRenderer::beginFrame(const QSize& viewportSize, const QMatrix4x4& view)
+{
+    if (!d->initialize()) return false;
+
+    QMatrix4x4 projection;
+    projection.ortho(0, viewportSize.width(), viewportSize.height(), 0, -1, 1);
+    d->matrix = projection * view;
+
+    d->gl.glDisable(GL_BLEND); // Tiles are opaque
+    d->gl.glDisable(GL_DEPTH_TEST);
+    d->gl.glActiveTexture(GL_TEXTURE0);
+    d->program->bind();
+    d->program->setUniformValue("matrix", d->matrix);
+    d->program->setUniformValue("tile", 0);
+    d->program->enableAttributeArray("position");
+    d->program->enableAttributeArray("texCoord");
+    d->inFrame = true;
+    return true;
+}
+
+bool GpuTileRenderer::draw(const PageCache::CacheKey& key, const QRectF& target, const QRectF& source)
+{
+    if (!d->initialized) return false;
+    auto it = d->textures.find(key);
+    if (it == d->textures.end()) return false;
+    Private::Entry& entry = it->second;
+    d->touch(entry, key);
+
+    const QRectF sourceRect = source.isEmpty() ? QRectF(QPointF(0, 0), entry.size) : source;
+    const GLfloat left = sourceRect.left() / entry.size.width();
+    const GLfloat right = sourceRect.right() / entry.size.width();
+    const GLfloat top = sourceRect.top() / entry.size.height();
+    const GLfloat bottom = sourceRect.bottom() / entry.size.height();
+
+    // Texture row 0 is the first scan line of the image, so t grows downwards like y
+    const GLfloat positions[] = {
+        GLfloat(target.left()), GLfloat(target.top()),
+        GLfloat(target.right()), GLfloat(target.top()),
+        GLfloat(target.left()), GLfloat(target.bottom()),
+        GLfloat(target.right()), GLfloat(target.bottom())
+    };
+    const GLfloat texCoords[] = {
+        left, top,
+        right, top,
+        left, bottom,
+        right, bottom
+    };
+
+    entry.texture->bind();
+    d->program->setAttributeArray("position", positions, 2);
+    d->program->setAttributeArray("texCoord", texCoords, 2);
+    d->gl.glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    entry.texture->release();
+    return true;
+}
+
+void GpuTileRenderer::endFrame()
+{
+    if (!d->initialized) return;
+    d->program->disableAttributeArray("position");
+    d->program->disableAttributeArray("texCoord");
+    d->program->release();
+    // The frame's tiles were drawn last, so they are the last to go
+    d->inFrame = false;
+    d->evictToBudget();
+}
+
+void GpuTileRenderer::clearForDocument(quintptr documentId)
+{
+    for (auto it = d->textures.begin(); it != d->textures.end();) {
+        auto current = it++;
+        if (current->first.documentId == documentId) {
+            d->remove(current);
+        }
+    }
+}
+
+bool GpuTileRenderer::remove(const PageCache::CacheKey& key)
+{
+    auto it = d->textures.find(key);
+    if (it == d->textures.end()) return false;
+    d->remove(it);
+    return true;
+}
+
+void GpuTileRenderer::clear()
+{
+    d->textures.clear();
+    d->lru.clear();
+    d->bytes = 0;
+}
+
+void GpuTileRenderer::releaseResources()
+{
+    d->textures.clear();
+    d->lru.clear();
+    d->bytes = 0;
+    d->program.reset();
+    d->initialized = false;
+    d->failed = false;
+    d->inFrame = false;
+}
+
+qint64 GpuTileRenderer::residentBytes() const
+{
+    return d->bytes;
+}
+
+} // namespace QuantilyxDoc
+
+#endif // HAVE_OPENGL
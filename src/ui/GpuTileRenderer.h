@@ -0,0 +1,126 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_GPUTILERENDERER_H
+#define QUANTILYX_GPUTILERENDERER_H
+
+#ifdef HAVE_OPENGL
+
+#include "../core/PageCache.h"
+#include <QImage>
+#include <QMatrix4x4>
+#include <QRectF>
+#include <QSize>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+/**
+ * @brief Draws cached page tiles as OpenGL textures.
+ *
+ * Each tile is uploaded once and kept in video memory under its PageCache
+ * key, up to Advanced/GpuTextureCacheMB (least recently drawn tiles go
+ * first). A frame then only sets the view matrix and draws textured quads,
+ * so panning and scaled previews during zoom cost no image copies. Used by
+ * DocumentView when its viewport is a QOpenGLWidget; all calls must be
+ * made with that widget's context current, between
+ * QPainter::beginNativePainting() and endNativePainting().
+ */
+class GpuTileRenderer
+{
+public:
+    /**
+     * @brief Constructor. No GL calls are made until beginFrame().
+     */
+    GpuTileRenderer();
+
+    /**
+     * @brief Destructor. Call releaseResources() first while the context is current.
+     */
+    ~GpuTileRenderer();
+
+    /**
+     * @brief Check if a tile is resident in video memory.
+     * @param key Tile key.
+     * @return True if the tile can be drawn without an upload.
+     */
+    bool contains(const PageCache::CacheKey& key) const;
+
+    /**
+     * @brief Upload a tile, replacing any texture under the same key.
+     * Within a frame nothing is evicted until endFrame(), so the tiles the
+     * frame has yet to draw stay resident.
+     * @param key Tile key.
+     * @param image Tile image.
+     */
+    void upload(const PageCache::CacheKey& key, const QImage& image);
+
+    /**
+     * @brief Start a frame.
+     * @param viewportSize Size of the viewport in device-independent pixels.
+     * @param view Transform from document pixels to viewport pixels.
+     * @return False if OpenGL could not be initialized; nothing is drawn then.
+     */
+    bool beginFrame(const QSize& viewportSize, const QMatrix4x4& view);
+
+    /**
+     * @brief Draw part of a resident tile.
+     * @param key Tile key.
+     * @param target Target rectangle in document pixels.
+     * @param source Source rectangle in tile pixels, or an empty rect for the whole tile.
+     * @return False if the tile is not resident.
+     */
+    bool draw(const PageCache::CacheKey& key, const QRectF& target, const QRectF& source = QRectF());
+
+    /**
+     * @brief Finish a frame, evict down to the budget and restore the GL
+     * state QPainter expects.
+     */
+    void endFrame();
+
+    /**
+     * @brief Drop all textures of a document.
+     * @param documentId PageCache document ID.
+     */
+    void clearForDocument(quintptr documentId);
+
+    /**
+     * @brief Drop the texture of a tile, e.g. when PageCache replaced its image.
+     * Needs the context current.
+     * @param key Tile key.
+     * @return True if a texture was dropped.
+     */
+    bool remove(const PageCache::CacheKey& key);
+
+    /**
+     * @brief Drop all textures, keeping the GL objects. Needs the context current.
+     */
+    void clear();
+
+    /**
+     * @brief Delete all textures and GL objects. Needs the context current.
+     */
+    void releaseResources();
+
+    /**
+     * @brief Get the video memory held by resident tiles.
+     * @return Size in bytes.
+     */
+    qint64 residentBytes() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // HAVE_OPENGL
+
+#endif // QUANTILYX_GPUTILERENDERER_H
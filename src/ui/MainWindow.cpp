@@ -10,17 +10,24 @@
 #include "MainWindow.h"
 #include "../core/Application.h"
 #include "../core/DocumentFactory.h"
+#include "../core/DocumentHandle.h"
 #include "../core/UndoStack.h"
 #include "../core/RecentFiles.h"
 #include "../core/Settings.h"
 #include "../core/BackupManager.h"
 #include "../core/PageCache.h"
+#include "../core/FrameStats.h"
+#include "../core/PrintSpooler.h"
+#include "../core/RemoteFile.h"
+#include "../core/ThumbnailStore.h"
+#include "../search/DocumentSearch.h"
 #include "DocumentView.h"
 #include "PreferencesDialog.h"
 #include "AboutDialog.h"
 #include "CommandPalette.h"
 #include "QuickActionsPanel.h"
 #include "ContentsWidget.h"
+#include "ThumbnailsWidget.h"
 #include <QMenuBar>
 #include <QToolBar>
 #include <QStatusBar>
@@ -36,10 +43,15 @@
 #include <QAction>
 #include <QActionGroup>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
 #include <QMessageBox>
 #include <QProgressDialog>
 #include <QProgressBar>
+#include <QPrintDialog>
+#include <QPrinter>
 #include <QTimer>
+#include <QHash>
 #include <QDir>
 #include <QStandardPaths>
 #include <QMimeData>
@@ -54,11 +66,26 @@ namespace QuantilyxDoc {
 class MainWindow::Private {
 public:
     Private(MainWindow* q_ptr)
-        : q(q_ptr), documentView(nullptr), currentDocument(nullptr) {}
+        : q(q_ptr), documentView(nullptr), currentDocument(nullptr), documentSearch(nullptr), searchHitPages(0) {}
 
     MainWindow* q;
     DocumentView* documentView;
     QPointer<Document> currentDocument; // Use QPointer for safety
+    QList<DocumentHandle> documentHandles; // One per document this window has open
+
+    // Batches from openDocuments() still being delivered
+    struct OpenBatch {
+        bool shown = false;
+        QStringList failed;
+        QStringList then; // Opened as another batch once this one finishes
+    };
+    QHash<int, OpenBatch> openBatches;
+    QHash<QString, QVariantMap> restoredStates; // View states from the last session, by path, until opened
+
+    // Find: hits stream in, nearest the current page first
+    DocumentSearch* documentSearch;
+    QString searchText;
+    int searchHitPages; // Pages with hits in the search in progress
 
     // UI Elements
     QMenuBar* menuBar;
@@ -74,6 +101,7 @@ public:
     QDockWidget* commandPaletteDock;
     QDockWidget* quickActionsDock;
     ContentsWidget* contentsWidget; // Add this member
+    ThumbnailsWidget* thumbnailsWidget;
 
     // Actions
     QAction* newAction;
@@ -98,6 +126,8 @@ public:
     QAction* actualSizeAction;
     QAction* fullScreenAction;
     QAction* presentationAction;
+    QAction* frameStatsAction;
+    QAction* exportFrameStatsAction;
 
     QAction* preferencesAction;
     QAction* aboutAction;
@@ -132,8 +162,13 @@ public:
     void updateUiForDocument(Document* doc);
     // Helper to update status bar
     void updateStatusBar();
+    void holdDocument(DocumentHandle handle);
     // Helper to connect signals
     void connectSignals();
+    // Helper to show search hits as they stream in
+    void connectSearch();
+    // Helper to register an opened document, optionally showing it
+    void adoptDocument(Document* doc, const QString& filePath, bool show);
 };
 
 // Define static const strings
@@ -172,16 +207,22 @@ void MainWindow::Private::createActions() {
     closeAction->setStatusTip(tr("Close the current document"));
     connect(closeAction, &QAction::triggered, [this]() {
         if (currentDocument) {
-            // Application::instance().unregisterDocument(currentDocument);
-            // currentDocument->close(); // Assuming Document has a close method
+            Document* closing = currentDocument;
             updateUiForDocument(nullptr); // Clear UI
+            // Closes the document unless another view still holds it
+            for (int i = 0; i < documentHandles.size(); ++i) {
+                if (documentHandles.at(i).get() == closing) {
+                    documentHandles.removeAt(i);
+                    break;
+                }
+            }
         }
     });
 
     printAction = new QAction(tr("&Print..."), q);
     printAction->setShortcuts(QKeySequence::Print);
     printAction->setStatusTip(tr("Print the document"));
-    // connect(printAction, &QAction::triggered, q, &MainWindow::printDocument);
+    connect(printAction, &QAction::triggered, q, &MainWindow::printDocument);
 
     exitAction = new QAction(tr("E&xit"), q);
     exitAction->setShortcuts(QKeySequence::Quit);
@@ -253,6 +294,16 @@ void MainWindow::Private::createActions() {
     presentationAction->setStatusTip(tr("Start presentation mode"));
     connect(presentationAction, &QAction::triggered, q, &MainWindow::startPresentation);
 
+    frameStatsAction = new QAction(tr("Frame &Statistics"), q);
+    frameStatsAction->setShortcut(QKeySequence(tr("Ctrl+Shift+F12")));
+    frameStatsAction->setStatusTip(tr("Show paint times, cache hits and render latency over the page"));
+    frameStatsAction->setCheckable(true);
+    connect(frameStatsAction, &QAction::toggled, q, &MainWindow::toggleFrameStatistics);
+
+    exportFrameStatsAction = new QAction(tr("&Export Frame Statistics..."), q);
+    exportFrameStatsAction->setStatusTip(tr("Save the recorded frame statistics as CSV or a Chrome trace"));
+    connect(exportFrameStatsAction, &QAction::triggered, q, &MainWindow::exportFrameStatistics);
+
     // Settings & Help Actions
     preferencesAction = new QAction(tr("&Preferences..."), q);
     preferencesAction->setMenuRole(QAction::PreferencesRole);
@@ -318,6 +369,9 @@ void MainWindow::Private::createMenus() {
     viewMenu->addAction(fullScreenAction);
     viewMenu->addAction(presentationAction);
     viewMenu->addSeparator();
+    viewMenu->addAction(frameStatsAction);
+    viewMenu->addAction(exportFrameStatsAction);
+    viewMenu->addSeparator();
     // Add dock widget toggle actions
     viewMenu->addAction(contentsDock->toggleViewAction());
     viewMenu->addAction(thumbnailsDock->toggleViewAction());
@@ -376,7 +430,8 @@ void MainWindow::Private::createDockWidgets() {
     // Thumbnails Dock
     thumbnailsDock = new QDockWidget(tr("Thumbnails"), q);
     thumbnailsDock->setObjectName("ThumbnailsDock");
-    thumbnailsDock->setWidget(new ThumbnailsWidget(q)); // Assuming ThumbnailsWidget exists
+    thumbnailsWidget = new ThumbnailsWidget(q);
+    thumbnailsDock->setWidget(thumbnailsWidget);
     thumbnailsDock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
     q->addDockWidget(Qt::LeftDockWidgetArea, thumbnailsDock);
 
@@ -455,7 +510,32 @@ void MainWindow::Private::createStatusBar() {
             });
 }
 
+void MainWindow::Private::connectSearch() {
+    documentSearch = new DocumentSearch(q);
+    connect(documentSearch, &DocumentSearch::matchesFound, q, [this](int pageIndex, const QList<QRectF>& rects) {
+        Q_UNUSED(rects);
+        // The first hit is the one nearest the reader
+        if (searchHitPages++ == 0 && documentView) documentView->goToPage(pageIndex);
+        statusLabel->setText(tr("Found '%1' on %n page(s)", nullptr, searchHitPages).arg(searchText));
+    });
+    connect(documentSearch, &DocumentSearch::progressChanged, q, [this](int scannedPages, int totalPages) {
+        progressBar->setRange(0, totalPages);
+        progressBar->setValue(scannedPages);
+        progressBar->setVisible(true);
+    });
+    connect(documentSearch, &DocumentSearch::finished, q, [this](int matchingPages) {
+        progressBar->setVisible(false);
+        statusLabel->setText(matchingPages > 0
+            ? tr("Found '%1' on %n page(s)", nullptr, matchingPages).arg(searchText)
+            : tr("'%1' not found").arg(searchText));
+    });
+}
+
 void MainWindow::Private::updateUiForDocument(Document* doc) {
+    if (documentSearch && doc != currentDocument) {
+        documentSearch->cancel();
+        progressBar->setVisible(false);
+    }
     currentDocument = doc; // Use QPointer
 
     if (doc) {
@@ -467,10 +547,12 @@ void MainWindow::Private::updateUiForDocument(Document* doc) {
 
         // Update ContentsWidget
         contentsWidget->setDocument(doc); // Pass the document to the ContentsWidget
+        thumbnailsWidget->setDocument(doc);
 
         // Connect document signals to update UI
         connect(doc, &Document::currentPageChanged, q, [this](int index) {
             pageSpinBox->setValue(index + 1); // Update spinbox when page changes
+            thumbnailsWidget->setCurrentPage(index);
         });
         // Update undo/redo actions based on UndoStack
         undoAction->setEnabled(UndoStack::instance().canUndo());
@@ -484,6 +566,7 @@ void MainWindow::Private::updateUiForDocument(Document* doc) {
 
         // Clear ContentsWidget
         contentsWidget->setDocument(nullptr); // Clear when no document
+        thumbnailsWidget->setDocument(nullptr);
 
         undoAction->setEnabled(false);
         redoAction->setEnabled(false);
@@ -499,7 +582,69 @@ void MainWindow::Private::updateStatusBar() {
     }
 }
 
+void MainWindow::Private::holdDocument(DocumentHandle handle) {
+    for (const DocumentHandle& held : qAsConst(documentHandles)) {
+        if (held.get() == handle.get()) return; // This window's reference is enough; handle drops the extra one
+    }
+    documentHandles.append(std::move(handle));
+}
+
+void MainWindow::Private::adoptDocument(Document* doc, const QString& filePath, bool show) {
+    // Register document with Application; a file open elsewhere is shared, not loaded twice
+    Document* shared = Application::instance()->registerDocument(doc);
+    if (shared != doc) doc->deleteLater();
+    doc = shared;
+    holdDocument(DocumentHandle::adopt(doc));
+    const auto restored = restoredStates.find(filePath);
+    if (restored != restoredStates.end()) {
+        documentView->setViewState(doc, restored.value()); // Applied when shown
+        restoredStates.erase(restored);
+    }
+    if (show) {
+        // Set the document in the view
+        documentView->setDocument(doc);
+        // Update UI
+        updateUiForDocument(doc);
+    }
+    // Add to recent files
+    RecentFiles::instance().addFile(filePath);
+    LOG_INFO("Opened document: " << filePath);
+}
+
 void MainWindow::Private::connectSignals() {
+    // Documents of a batch arrive as each finishes loading
+    DocumentFactory& factory = DocumentFactory::instance();
+    connect(&factory, &DocumentFactory::documentOpened, q, [this](int batchId, const QString& filePath, Document* doc) {
+        auto batch = openBatches.find(batchId);
+        if (batch == openBatches.end()) return;
+        adoptDocument(doc, filePath, !batch->shown);
+        batch->shown = true;
+    });
+    connect(&factory, &DocumentFactory::documentOpenFailed, q, [this](int batchId, const QString& filePath, const QString& error) {
+        auto batch = openBatches.find(batchId);
+        if (batch == openBatches.end()) return;
+        batch->failed.append(filePath);
+        LOG_ERROR("Failed to open document: " << filePath << " (" << error << ")");
+    });
+    connect(&factory, &DocumentFactory::batchOpenFinished, q, [this](int batchId) {
+        const auto batch = openBatches.find(batchId);
+        if (batch == openBatches.end()) return;
+        const QStringList failed = batch->failed;
+        const QStringList then = batch->then;
+        openBatches.erase(batch);
+        if (!documentView->document()) {
+            documentView->setPlaceholder(QString(), QImage(), QVariantMap()); // Its document failed to open
+        }
+        if (!then.isEmpty()) {
+            Private::OpenBatch next;
+            next.shown = documentView->document() != nullptr; // Shows one only if the last batch showed none
+            openBatches.insert(DocumentFactory::instance().openDocuments(then), next);
+        }
+        if (!failed.isEmpty()) {
+            QMessageBox::critical(q, MainWindow::tr("Error"), MainWindow::tr("Failed to open %n document(s):\n%1", "", failed.size()).arg(failed.join("\n")));
+        }
+    });
+
     // Connect UndoStack signals to update UI actions
     connect(&UndoStack::instance(), &UndoStack::canUndoChanged,
             undoAction, &QAction::setEnabled);
@@ -507,6 +652,11 @@ void MainWindow::Private::connectSignals() {
             redoAction, &QAction::setEnabled);
     // Connect RecentFiles to update menu
     // connect(&RecentFiles::instance(), &RecentFiles::recentFilesChanged, q, &MainWindow::updateRecentFilesMenu);
+    connect(thumbnailsWidget, &ThumbnailsWidget::pageActivated, q, [this](int pageIndex) {
+        if (documentView && currentDocument && pageIndex < currentDocument->pageCount()) {
+            documentView->goToPage(pageIndex);
+        }
+    });
     connect(contentsWidget, &ContentsWidget::navigateRequested, q, [this](const QVariant& destination) {
         // The destination could be a map like {"type": "page", "page": 5} or a string
         // For now, let's handle the simple page type.
@@ -550,6 +700,7 @@ MainWindow::MainWindow(QWidget* parent)
     d->createDockWidgets();
     d->createStatusBar();
     d->connectSignals();
+    d->connectSearch();
 
     // Central widget - Document View
     d->documentView = new DocumentView(this);
@@ -578,16 +729,13 @@ MainWindow::~MainWindow()
 
 bool MainWindow::openDocument(const QString& filePath)
 {
-    // Use DocumentFactory to create the appropriate Document instance
-    Document* doc = DocumentFactory::instance().createDocument(filePath);
-    if (doc) {
-        // Register document with Application
-        Application::instance().registerDocument(doc);
-        // Set the document in the view
+    // Shares the document if another view has the file open, else loads it
+    DocumentHandle handle = DocumentHandle::open(filePath);
+    if (handle) {
+        Document* doc = handle.get();
+        d->holdDocument(std::move(handle));
         d->documentView->setDocument(doc);
-        // Update UI
         d->updateUiForDocument(doc);
-        // Add to recent files
         RecentFiles::instance().addFile(filePath);
         LOG_INFO("Opened document: " << filePath);
         return true;
@@ -598,6 +746,71 @@ bool MainWindow::openDocument(const QString& filePath)
     }
 }
 
+void MainWindow::openDocuments(const QStringList& filePaths)
+{
+    if (filePaths.size() == 1) {
+        openDocument(filePaths.first());
+        return;
+    }
+    if (filePaths.isEmpty()) return;
+    d->openBatches.insert(DocumentFactory::instance().openDocuments(filePaths), Private::OpenBatch());
+}
+
+bool MainWindow::saveSession()
+{
+    // The shown document first, so it is the first to load next time
+    QVariantList documents;
+    Document* shown = d->documentView->document();
+    if (shown && !shown->filePath().isEmpty()) {
+        QVariantMap state = d->documentView->viewState();
+        state.insert("path", shown->filePath());
+        documents.append(state);
+        ThumbnailStore::instance().storeImage(shown->filePath(), 0, d->documentView->captureViewport(),
+                                              ThumbnailStore::Kind::Viewport);
+    }
+    for (const DocumentHandle& handle : qAsConst(d->documentHandles)) {
+        Document* doc = handle.get();
+        if (!doc || doc == shown || doc->filePath().isEmpty()) continue;
+        QVariantMap state = d->documentView->viewState(doc);
+        state.insert("path", doc->filePath());
+        documents.append(state);
+    }
+    Settings::instance().setValue("Session/Documents", documents);
+    LOG_INFO("Saved session of " << documents.size() << " document(s).");
+    return true;
+}
+
+bool MainWindow::restoreSession()
+{
+    const QVariantList documents = Settings::instance().value<QVariantList>("Session/Documents", QVariantList());
+    QStringList paths;
+    for (const QVariant& entry : documents) {
+        const QVariantMap state = entry.toMap();
+        const QString path = state.value("path").toString();
+        if (path.isEmpty() || paths.contains(path)) continue;
+        if (!RemoteFile::isRemote(path) && !QFileInfo::exists(path)) {
+            LOG_WARN("Session document no longer exists: " << path);
+            continue;
+        }
+        paths.append(path);
+        d->restoredStates.insert(path, state);
+    }
+    if (paths.isEmpty()) return false;
+
+    // The last screen shows at once; the shown document loads alone first,
+    // then the rest together in the background
+    const QString active = paths.takeFirst();
+    const QImage screen = ThumbnailStore::instance().image(active, 0, ThumbnailStore::Kind::Viewport);
+    if (!screen.isNull()) {
+        d->documentView->setPlaceholder(active, screen, d->restoredStates.value(active));
+    }
+    Private::OpenBatch first;
+    first.then = paths;
+    d->openBatches.insert(DocumentFactory::instance().openDocuments(QStringList() << active), first);
+    LOG_INFO("Restoring session of " << paths.size() + 1 << " document(s), " << active << " first.");
+    return true;
+}
+
 bool MainWindow::newDocument()
 {
     // Placeholder for creating a new, blank document
@@ -612,6 +825,7 @@ void MainWindow::closeEvent(QCloseEvent* event)
     // Check if any documents are modified and prompt to save
     // For now, assume user can close without saving
     // Save window state
+    saveSession();
     Settings& settings = Settings::instance();
     settings.setValue("MainWindow/Geometry", saveGeometry());
     settings.setValue("MainWindow/State", saveState());
@@ -633,14 +847,15 @@ void MainWindow::dropEvent(QDropEvent* event)
 {
     const QMimeData* mimeData = event->mimeData();
     if (mimeData->hasUrls()) {
-        QList<QUrl> urlList = mimeData->urls();
-        if (!urlList.isEmpty()) {
-            QString filePath = urlList.first().toLocalFile();
-            if (!filePath.isEmpty()) {
-                openDocument(filePath);
-                event->acceptProposedAction();
-                return;
-            }
+        QStringList filePaths;
+        for (const QUrl& url : mimeData->urls()) {
+            const QString filePath = url.toLocalFile();
+            if (!filePath.isEmpty()) filePaths.append(filePath);
+        }
+        if (!filePaths.isEmpty()) {
+            openDocuments(filePaths);
+            event->acceptProposedAction();
+            return;
         }
     }
     event->ignore();
@@ -662,9 +877,15 @@ void MainWindow::openDocumentDialog()
 
 void MainWindow::findText()
 {
-    // Placeholder for find dialog
-    LOG_WARN("Find dialog is not fully implemented yet.");
-    QMessageBox::information(this, tr("Info"), tr("The Find dialog is not yet implemented."));
+    if (!d->currentDocument || !d->documentView) return;
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Find"), tr("Find text:"), QLineEdit::Normal, d->searchText, &ok);
+    if (!ok || text.isEmpty()) return;
+
+    d->searchText = text;
+    d->searchHitPages = 0;
+    d->statusLabel->setText(tr("Searching for '%1'...").arg(text));
+    d->documentSearch->start(d->currentDocument, text, d->documentView->currentPageIndex());
 }
 
 void MainWindow::zoomIn()
@@ -720,6 +941,65 @@ void MainWindow::startPresentation()
     QMessageBox::information(this, tr("Info"), tr("Presentation mode is not yet implemented."));
 }
 
+void MainWindow::toggleFrameStatistics(bool visible)
+{
+    if (d->documentView) {
+        d->documentView->setStatsOverlayVisible(visible);
+    }
+}
+
+void MainWindow::exportFrameStatistics()
+{
+    QString selectedFilter;
+    const QString csvFilter = tr("CSV Files (*.csv)");
+    const QString traceFilter = tr("Chrome Trace Files (*.json)");
+    const QString filePath = QFileDialog::getSaveFileName(this, tr("Export Frame Statistics"), QString(),
+                                                          csvFilter + ";;" + traceFilter, &selectedFilter);
+    if (filePath.isEmpty()) return;
+
+    const bool trace = selectedFilter == traceFilter || filePath.endsWith(".json", Qt::CaseInsensitive);
+    const bool ok = trace ? FrameStats::instance().exportChromeTrace(filePath)
+                          : FrameStats::instance().exportCsv(filePath);
+    if (!ok) {
+        QMessageBox::warning(this, tr("Export Failed"), tr("Could not write %1.").arg(filePath));
+    }
+}
+
+void MainWindow::printDocument()
+{
+    Document* document = d->currentDocument;
+    if (!document || document->pageCount() == 0) return;
+
+    QPrinter printer(QPrinter::HighResolution);
+    printer.setDocName(QFileInfo(document->filePath()).completeBaseName());
+    QPrintDialog dialog(&printer, this);
+    dialog.setMinMax(1, document->pageCount());
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    QVector<int> pages;
+    const int first = printer.printRange() == QPrinter::PageRange ? printer.fromPage() : 1;
+    const int last = printer.printRange() == QPrinter::PageRange ? printer.toPage() : document->pageCount();
+    for (int page = first; page <= last; ++page) pages.append(page - 1);
+
+    PrintSpooler spooler;
+    QProgressDialog progress(tr("Printing %1...").arg(QFileInfo(document->filePath()).fileName()), tr("Cancel"),
+                             0, pages.size(), this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    connect(&progress, &QProgressDialog::canceled, &spooler, &PrintSpooler::cancel);
+    connect(&spooler, &PrintSpooler::pagePrinted, &progress, [&progress](int, int printed, int) {
+        progress.setValue(printed);
+    });
+
+    const bool ok = spooler.print(document, &printer, pages);
+    const bool canceled = progress.wasCanceled();
+    progress.reset();
+    if (!ok && !canceled) {
+        QMessageBox::warning(this, tr("Print Failed"), tr("Could not print %1: %2")
+                             .arg(QFileInfo(document->filePath()).fileName(), spooler.errorString()));
+    }
+}
+
 void MainWindow::showPreferences()
 {
     PreferencesDialog dialog(this);
@@ -50,6 +50,15 @@ public:
      */
     bool openDocument(const QString& filePath);
 
+    /**
+     * @brief Open several documents at once
+     *
+     * The files load concurrently; the first to finish is shown and the
+     * others are registered as they arrive. Failures are reported together.
+     * @param filePaths Paths to document files
+     */
+    void openDocuments(const QStringList& filePaths);
+
     /**
      * @brief Create a new blank document
      * @return true if created successfully
@@ -194,6 +203,23 @@ private slots:
      */
     void updateUIState();
 
+    /**
+     * @brief Show or hide the frame statistics overlay
+     * @param visible True to show
+     */
+    void toggleFrameStatistics(bool visible);
+
+    /**
+     * @brief Export recorded frame statistics to a file
+     */
+    void exportFrameStatistics();
+
+    /**
+     * @brief Print the current document
+     * Pages are rendered on worker threads while a progress dialog offers to cancel.
+     */
+    void printDocument();
+
 private:
     /**
      * @brief Create UI components
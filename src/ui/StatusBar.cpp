@@ -10,6 +10,7 @@
 #include "StatusBar.h"
 #include "../core/Document.h"
 #include "../core/Logger.h"
+#include "../core/MetricsHub.h"
 #include <QLabel>
 #include <QProgressBar>
 #include <QSpinBox>
@@ -45,6 +46,7 @@ public:
     QLabel* rotationValueLabel; // Displays current rotation (e.g., "0°")
     QProgressBar* progressBar; // For showing operation progress
     QLabel* statusTextLabel; // For permanent status text (e.g., "Ready", "Rendering...")
+    QLabel* activityLabel; // Background work, from MetricsHub; hidden when idle
 
     int currentPageIndex;
     qreal zoomLevelVal;
@@ -133,7 +135,19 @@ public:
         // Add progress bar as a permanent item, likely near the right
         q->addPermanentWidget(progressBar);
 
+        // --- Background Activity (hidden while idle) ---
+        activityLabel = new QLabel(q);
+        activityLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        activityLabel->setVisible(false);
+        q->addPermanentWidget(activityLabel);
+
         // Connect signals
+        MetricsHub& hub = MetricsHub::instance();
+        QObject::connect(&hub, &MetricsHub::metricsUpdated, q,
+                         [this](const MetricsHub::Snapshot& snapshot) { updateActivityLabel(snapshot); });
+        if (!hub.isRunning()) hub.start();
+        updateActivityLabel(hub.snapshot());
+
         QObject::connect(pageSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
                          q, [this](int value) { emit q->pageChanged(value - 1); }); // Emit 0-based index
 
@@ -161,6 +175,32 @@ public:
         LOG_DEBUG("StatusBar: Custom widgets initialized.");
     }
 
+    // Helper to show one metrics sample; at most MetricsHubHz calls a second
+    void updateActivityLabel(const MetricsHub::Snapshot& s) {
+        const auto megabytes = [](qint64 bytes) { return QString::number(bytes / (1024.0 * 1024.0), 'f', 1); };
+        activityLabel->setToolTip(tr("Tasks: %1 queued, %2 running (I/O: %3 queued, %4 running)\n"
+                                     "Renders: %5 pending, %6 active\n"
+                                     "Loads: %7 queued, %8 active\n"
+                                     "Page cache: %9 MB in %10 items, disk cache: %11 MB")
+                                      .arg(s.cpuQueuedTasks).arg(s.cpuRunningTasks)
+                                      .arg(s.ioQueuedTasks).arg(s.ioRunningTasks)
+                                      .arg(s.pendingRenders).arg(s.activeRenders)
+                                      .arg(s.queuedLoads).arg(s.activeLoads)
+                                      .arg(megabytes(s.pageCacheBytes)).arg(s.pageCacheItems)
+                                      .arg(megabytes(s.diskCacheBytes)));
+        if (s.isIdle()) {
+            activityLabel->setVisible(false);
+            return;
+        }
+        const int tasks = s.cpuQueuedTasks + s.cpuRunningTasks + s.ioQueuedTasks + s.ioRunningTasks
+            + s.queuedLoads + s.activeLoads;
+        activityLabel->setText(tr("Tasks: %1  Renders: %2  Cache: %3 MB")
+                                   .arg(tasks)
+                                   .arg(s.pendingRenders + s.activeRenders)
+                                   .arg(megabytes(s.pageCacheBytes)));
+        activityLabel->setVisible(true);
+    }
+
     // Helper to update the page count label text
     void updatePageCountLabel() {
         if (document) {
@@ -225,7 +265,7 @@ void StatusBar::setDocument(Document* doc)
     // Disconnect from old document signals if necessary
     if (d->document) {
         // disconnect(d->document, &Document::currentPageChanged, ...);
-        // disconnect(d->document, &Document::pageCountChanged, ...);
+        disconnect(d->document, &Document::pageCountChanged, this, nullptr);
     }
 
     d->document = doc; // Use QPointer
@@ -235,9 +275,11 @@ void StatusBar::setDocument(Document* doc)
         // connect(doc, &Document::currentPageChanged, this, [this](int index) {
         //     setCurrentPage(index);
         // });
-        // connect(doc, &Document::pageCountChanged, this, [this]() {
-        //     d->updatePageCountLabel();
-        // });
+        connect(doc, &Document::pageCountChanged, this, [this]() {
+            if (!d->document) return;
+            d->pageSpinBox->setRange(1, d->document->pageCount());
+            d->updatePageCountLabel();
+        });
 
         // Update UI based on new document state
         d->pageSpinBox->setRange(1, doc->pageCount());
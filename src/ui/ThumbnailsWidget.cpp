@@ -0,0 +1,303 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "ThumbnailsWidget.h"
+#include "../core/Document.h"
+#include "../core/Page.h"
+#include "../core/Settings.h"
+#include "../core/ThumbnailStore.h"
+#include "../core/Logger.h"
+#include <QAbstractListModel>
+#include <QCache>
+#include <QHash>
+#include <QPainter>
+#include <QPixmap>
+#include <QPointer>
+#include <QResizeEvent>
+#include <QScrollBar>
+#include <QTimer>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+// Longest edge of a thumbnail on screen, in device-independent pixels
+const int ThumbnailEdge = 128;
+// Rows either side of the visible ones that are requested too
+const int PrefetchRows = 4;
+
+} // namespace
+
+class ThumbnailsWidget::Private {
+public:
+    // One row per page; delegates everything to Private
+    class Model : public QAbstractListModel {
+    public:
+        explicit Model(Private* owner) : d(owner) {}
+
+        int rowCount(const QModelIndex& parent = QModelIndex()) const override {
+            return parent.isValid() ? 0 : d->pageCount;
+        }
+
+        QVariant data(const QModelIndex& index, int role) const override {
+            if (!index.isValid() || index.row() >= d->pageCount) return QVariant();
+            switch (role) {
+            case Qt::DisplayRole:
+                return QString::number(index.row() + 1);
+            case Qt::ToolTipRole:
+                return ThumbnailsWidget::tr("Page %1").arg(index.row() + 1);
+            case Qt::DecorationRole:
+                // Never requests anything; visible rows were requested on scroll
+                if (const QPixmap* pixmap = d->cache.object(index.row())) return *pixmap;
+                return d->placeholder;
+            default:
+                return QVariant();
+            }
+        }
+
+        void refresh(int row) {
+            const QModelIndex changed = index(row);
+            emit dataChanged(changed, changed, {Qt::DecorationRole});
+        }
+
+        void reset(int pageCount) {
+            beginResetModel();
+            d->pageCount = pageCount;
+            endResetModel();
+        }
+
+    private:
+        Private* d;
+    };
+
+    Private(ThumbnailsWidget* q_ptr) : q(q_ptr), model(this) {}
+
+    ThumbnailsWidget* q;
+    QPointer<Document> document;
+    QString filePath;
+    int pageCount = 0;
+    Model model;
+    QCache<int, QPixmap> cache;             // Page index -> thumbnail, cost in KB
+    QPixmap placeholder;
+    QHash<quintptr, int> pendingPages;      // Request ID -> page index
+    QHash<int, quintptr> pendingRequests;   // Page index -> request ID
+    QTimer updateTimer;                     // Coalesces scroll and resize steps into one request pass
+    bool syncingCurrent = false;
+    QMetaObject::Connection closedConnection;
+    QMetaObject::Connection pageCountConnection;
+
+    qreal devicePixelRatio() const {
+        return q->devicePixelRatioF();
+    }
+
+    void makePlaceholder() {
+        const qreal ratio = devicePixelRatio();
+        const QSize size(qRound(ThumbnailEdge * 0.75), ThumbnailEdge); // Portrait until rendered
+        placeholder = QPixmap(size * ratio);
+        placeholder.setDevicePixelRatio(ratio);
+        placeholder.fill(Qt::white);
+        QPainter painter(&placeholder);
+        painter.setPen(q->palette().color(QPalette::Mid));
+        painter.drawRect(QRectF(0, 0, size.width() - 1, size.height() - 1));
+    }
+
+    void insertThumbnail(int pageIndex, QImage image) {
+        const qreal ratio = devicePixelRatio();
+        const int edge = qRound(ThumbnailEdge * ratio);
+        if (qMax(image.width(), image.height()) > edge) {
+            image = image.scaled(edge, edge, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        QPixmap* pixmap = new QPixmap(QPixmap::fromImage(image));
+        pixmap->setDevicePixelRatio(ratio);
+        const int costKb = qMax(1, pixmap->width() * pixmap->height() * pixmap->depth() / 8 / 1024);
+        cache.insert(pageIndex, pixmap, costKb);
+        model.refresh(pageIndex);
+    }
+
+    void cancelRequest(int pageIndex) {
+        const quintptr requestId = pendingRequests.take(pageIndex);
+        pendingPages.remove(requestId);
+        RenderThread::instance().cancelRequest(requestId);
+    }
+
+    void cancelAll() {
+        for (auto it = pendingPages.constBegin(); it != pendingPages.constEnd(); ++it) {
+            RenderThread::instance().cancelRequest(it.key());
+        }
+        pendingPages.clear();
+        pendingRequests.clear();
+    }
+
+    // Rows on screen plus PrefetchRows either side, as [first, last]
+    QPair<int, int> wantedRows() const {
+        if (pageCount == 0) return {0, -1};
+        const QRect area = q->viewport()->rect();
+        QModelIndex first = q->indexAt(area.topLeft() + QPoint(area.width() / 2, 1));
+        QModelIndex last = q->indexAt(area.bottomLeft() + QPoint(area.width() / 2, -1));
+        const int firstRow = first.isValid() ? first.row() : 0;
+        int lastRow = last.isValid() ? last.row() : pageCount - 1;
+        if (!last.isValid()) {
+            // Below the last row, or between rows: bound by how many rows fit
+            const int rowHeight = qMax(1, q->gridSize().height());
+            lastRow = qMin(pageCount - 1, firstRow + area.height() / rowHeight + 1);
+        }
+        return {qMax(0, firstRow - PrefetchRows), qMin(pageCount - 1, lastRow + PrefetchRows)};
+    }
+
+    void requestVisible() {
+        if (!document || pageCount == 0) return;
+        const QPair<int, int> rows = wantedRows();
+
+        // Scrolled past: nobody will see these
+        const QList<int> pending = pendingRequests.keys();
+        for (int pageIndex : pending) {
+            if (pageIndex < rows.first || pageIndex > rows.second) cancelRequest(pageIndex);
+        }
+
+        ThumbnailStore& store = ThumbnailStore::instance();
+        const bool storeReady = store.isReady();
+        const qreal ratio = devicePixelRatio();
+        for (int i = rows.first; i <= rows.second; ++i) {
+            if (cache.contains(i) || pendingRequests.contains(i)) continue;
+            if (storeReady) {
+                const QImage stored = store.image(filePath, i, ThumbnailStore::Kind::Thumbnail);
+                if (!stored.isNull()) {
+                    insertThumbnail(i, stored);
+                    continue;
+                }
+            }
+
+            Page* page = document->page(i);
+            if (!page || page->size().isEmpty()) continue;
+            const QSizeF pointSize = page->size();
+            const qreal scale = ThumbnailEdge * ratio / qMax(pointSize.width(), pointSize.height());
+            const QSize targetSize(qMax(1, qRound(pointSize.width() * scale)), qMax(1, qRound(pointSize.height() * scale)));
+
+            const quintptr requestId = RenderThread::nextRequestId();
+            pendingPages.insert(requestId, i);
+            pendingRequests.insert(i, requestId);
+            RenderThread::RenderRequest request(page, targetSize, scale, 0, QRectF(), false, requestId);
+            request.priority = RenderThread::BackgroundPriority; // The document view always goes first
+            RenderThread::instance().submitRequest(request);
+        }
+    }
+
+    void scheduleUpdate() {
+        if (!updateTimer.isActive()) updateTimer.start();
+    }
+};
+
+ThumbnailsWidget::ThumbnailsWidget(QWidget* parent)
+    : QListView(parent)
+    , d(new Private(this))
+{
+    const int budgetMb = qMax(1, Settings::instance().value<int>("Advanced/ThumbnailCacheMB", 24));
+    d->cache.setMaxCost(budgetMb * 1024);
+    d->makePlaceholder();
+
+    d->updateTimer.setSingleShot(true);
+    d->updateTimer.setInterval(0);
+    connect(&d->updateTimer, &QTimer::timeout, this, [this]() { d->requestVisible(); });
+
+    // Identical rows let the view lay out any number of pages without asking each for its size
+    setModel(&d->model);
+    setViewMode(QListView::IconMode);
+    setFlow(QListView::TopToBottom);
+    setWrapping(false);
+    setMovement(QListView::Static);
+    setResizeMode(QListView::Adjust);
+    setUniformItemSizes(true);
+    setLayoutMode(QListView::Batched);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    setIconSize(QSize(ThumbnailEdge, ThumbnailEdge));
+    setGridSize(QSize(ThumbnailEdge + 24, ThumbnailEdge + fontMetrics().height() + 16));
+
+    connect(selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex& current) {
+        if (!d->syncingCurrent && current.isValid()) emit pageActivated(current.row());
+    });
+    connect(&RenderThread::instance(), &RenderThread::renderCompleted,
+            this, &ThumbnailsWidget::onRenderCompleted, Qt::QueuedConnection);
+}
+
+ThumbnailsWidget::~ThumbnailsWidget()
+{
+    d->cancelAll();
+}
+
+void ThumbnailsWidget::setDocument(Document* doc)
+{
+    if (d->document == doc) return;
+    d->cancelAll();
+    QObject::disconnect(d->closedConnection);
+    QObject::disconnect(d->pageCountConnection);
+    d->cache.clear();
+
+    d->document = doc;
+    d->filePath = doc ? doc->filePath() : QString();
+    d->model.reset(doc ? doc->pageCount() : 0);
+
+    if (doc) {
+        // Renders hold the document's pages; none may be left queued once it closes
+        d->closedConnection = connect(doc, &Document::closed, this, [this]() { setDocument(nullptr); });
+        d->pageCountConnection = connect(doc, &Document::pageCountChanged, this, [this]() {
+            if (!d->document) return;
+            d->cancelAll();
+            d->model.reset(d->document->pageCount());
+            d->scheduleUpdate();
+        });
+        setCurrentPage(doc->currentPageIndex());
+        d->scheduleUpdate();
+        LOG_DEBUG("ThumbnailsWidget: Showing " << d->pageCount << " pages of " << d->filePath);
+    }
+}
+
+Document* ThumbnailsWidget::document() const
+{
+    return d->document;
+}
+
+void ThumbnailsWidget::setCurrentPage(int pageIndex)
+{
+    if (pageIndex < 0 || pageIndex >= d->pageCount) return;
+    const QModelIndex index = d->model.index(pageIndex);
+    if (index == currentIndex()) return;
+    d->syncingCurrent = true;
+    setCurrentIndex(index);
+    scrollTo(index);
+    d->syncingCurrent = false;
+}
+
+void ThumbnailsWidget::resizeEvent(QResizeEvent* event)
+{
+    QListView::resizeEvent(event);
+    d->scheduleUpdate();
+}
+
+void ThumbnailsWidget::scrollContentsBy(int dx, int dy)
+{
+    QListView::scrollContentsBy(dx, dy);
+    d->scheduleUpdate();
+}
+
+void ThumbnailsWidget::onRenderCompleted(const RenderThread::RenderResult& result)
+{
+    auto it = d->pendingPages.find(result.requestId);
+    if (it == d->pendingPages.end()) return; // Not ours, or canceled
+    const int pageIndex = it.value();
+    d->pendingPages.erase(it);
+    d->pendingRequests.remove(pageIndex);
+    if (!result.success || result.image.isNull()) {
+        LOG_DEBUG("ThumbnailsWidget: Render of page " << pageIndex << " failed: " << result.errorMessage);
+        return;
+    }
+    d->insertThumbnail(pageIndex, result.image);
+}
+
+} // namespace QuantilyxDoc
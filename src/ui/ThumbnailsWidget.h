@@ -0,0 +1,87 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_THUMBNAILSWIDGET_H
+#define QUANTILYX_THUMBNAILSWIDGET_H
+
+#include "../core/ThreadRender.h"
+#include <QListView>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Sidebar strip of page thumbnails.
+ *
+ * Every page has a row of the same size, so the view lays out a 10,000
+ * page document without touching its pages. Only the rows on screen, and
+ * a few either side, get an image: from the in-memory thumbnail cache,
+ * else from ThumbnailStore, else rendered at thumbnail size with
+ * RenderThread::BackgroundPriority so the document view always goes
+ * first. Renders for rows scrolled away are canceled. The cache has its
+ * own budget (Advanced/ThumbnailCacheMB) and stays out of PageCache.
+ */
+class ThumbnailsWidget : public QListView
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor.
+     * @param parent Parent widget.
+     */
+    explicit ThumbnailsWidget(QWidget* parent = nullptr);
+
+    /**
+     * @brief Destructor. Cancels renders in flight.
+     */
+    ~ThumbnailsWidget() override;
+
+    /**
+     * @brief Show a document's pages.
+     * @param doc The document, or nullptr to clear.
+     */
+    void setDocument(Document* doc);
+
+    /**
+     * @brief Get the currently shown document.
+     * @return Pointer to the document, or nullptr.
+     */
+    Document* document() const;
+
+    /**
+     * @brief Highlight a page and scroll it into view.
+     * @param pageIndex Zero-based page index.
+     */
+    void setCurrentPage(int pageIndex);
+
+signals:
+    /**
+     * @brief Emitted when the user picks a page.
+     * @param pageIndex Zero-based page index.
+     */
+    void pageActivated(int pageIndex);
+
+protected:
+    void resizeEvent(QResizeEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    void onRenderCompleted(const QuantilyxDoc::RenderThread::RenderResult& result);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_THUMBNAILSWIDGET_H
@@ -0,0 +1,272 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#include "TocModel.h"
+#include "../core/Document.h"
+#include "../core/Logger.h"
+#include "../core/ThreadPool.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QWaitCondition>
+#include <atomic>
+#include <vector>
+
+namespace QuantilyxDoc {
+
+namespace {
+
+struct Node {
+    TocEntry entry;
+    Node* parent = nullptr;
+    int row = 0;
+    bool fetched = false;
+    std::vector<std::unique_ptr<Node>> children;
+
+    QVector<int> path() const {
+        QVector<int> path;
+        for (const Node* node = this; node->parent; node = node->parent) path.prepend(node->row);
+        return path;
+    }
+};
+
+struct IndexEntry {
+    QString folded;     // Case folded title, what search() matches against
+    QString title;
+    QString context;
+    QVariant destination;
+    QVector<int> path;
+};
+
+// One background index build; the model waits for it before letting go of the document
+struct IndexBuild {
+    std::atomic_bool canceled{false};
+    QMutex mutex;
+    QWaitCondition doneCondition;
+    bool done = false;
+
+    void finish() {
+        QMutexLocker locker(&mutex);
+        done = true;
+        doneCondition.wakeAll();
+    }
+
+    void wait() {
+        QMutexLocker locker(&mutex);
+        while (!done) doneCondition.wait(&mutex);
+    }
+};
+
+} // namespace
+
+class TocModel::Private {
+public:
+    QPointer<Document> document;
+    Node root;
+    QMetaObject::Connection closedConnection;
+
+    QVector<IndexEntry> index;
+    bool indexReady = false;
+    std::shared_ptr<IndexBuild> build;
+    quint64 generation = 0; // Bumped per document; results of an older build are dropped
+
+    Node* nodeFor(const QModelIndex& index) const {
+        return index.isValid() ? static_cast<Node*>(index.internalPointer()) : const_cast<Node*>(&root);
+    }
+
+    void cancelIndexing() {
+        if (build) {
+            build->canceled = true;
+            build->wait(); // The walk reads the document
+            build.reset();
+        }
+        ++generation;
+    }
+
+    void reset() {
+        root.children.clear();
+        root.fetched = false;
+        root.entry.hasChildren = document != nullptr;
+        index.clear();
+        indexReady = false;
+    }
+};
+
+TocModel::TocModel(QObject* parent)
+    : QAbstractItemModel(parent)
+    , d(new Private())
+{
+}
+
+TocModel::~TocModel()
+{
+    d->cancelIndexing();
+}
+
+void TocModel::setDocument(Document* document)
+{
+    beginResetModel();
+    d->cancelIndexing();
+    QObject::disconnect(d->closedConnection);
+    d->document = document;
+    d->reset();
+    if (document) {
+        // Builds must stop before the document's outline goes away
+        d->closedConnection = connect(document, &Document::closed, this, [this]() { setDocument(nullptr); });
+    }
+    endResetModel();
+}
+
+QModelIndex TocModel::indexForPath(const QVector<int>& path)
+{
+    QModelIndex current;
+    for (int row : path) {
+        if (canFetchMore(current)) fetchMore(current);
+        if (row < 0 || row >= rowCount(current)) return QModelIndex();
+        current = index(row, 0, current);
+    }
+    return current;
+}
+
+void TocModel::startIndexing()
+{
+    if (!d->document || d->indexReady || d->build) return;
+
+    auto build = std::make_shared<IndexBuild>();
+    d->build = build;
+    const quint64 generation = d->generation;
+    Document* document = d->document;
+    ThreadPool::ioInstance().submitDetached([this, build, generation, document]() {
+        QElapsedTimer timer;
+        timer.start();
+        QVector<IndexEntry> entries;
+        QStringList titles; // Titles on the way down to the current entry
+        const bool complete = document->visitTableOfContents([&](const TocEntry& entry, const QVector<int>& path) {
+            if (build->canceled) return false;
+            while (titles.size() >= path.size()) titles.removeLast();
+            entries.append({entry.title.toCaseFolded(), entry.title, titles.join(QStringLiteral(" \u203A ")),
+                            entry.destination, path});
+            titles.append(entry.title);
+            return true;
+        });
+        if (!build->canceled) {
+            if (!complete) LOG_WARN("TocModel: Could not read the whole outline; search covers " << entries.size() << " entries");
+            LOG_DEBUG("TocModel: Indexed " << entries.size() << " outline entries in " << timer.elapsed() << " ms");
+            QMetaObject::invokeMethod(this, [this, generation, entries]() {
+                if (generation != d->generation) return;
+                d->index = entries;
+                d->indexReady = true;
+                d->build.reset();
+                emit indexReady();
+            }, Qt::QueuedConnection);
+        }
+        build->finish();
+    }, Task::Priority::Low);
+}
+
+bool TocModel::isIndexReady() const
+{
+    return d->indexReady;
+}
+
+QList<TocModel::SearchHit> TocModel::search(const QString& text, int limit) const
+{
+    QList<SearchHit> hits;
+    const QString folded = text.trimmed().toCaseFolded();
+    if (folded.isEmpty()) return hits;
+    for (const IndexEntry& entry : qAsConst(d->index)) {
+        if (!entry.folded.contains(folded)) continue;
+        hits.append({entry.title, entry.context, entry.destination, entry.path});
+        if (hits.size() >= limit) break;
+    }
+    return hits;
+}
+
+QModelIndex TocModel::index(int row, int column, const QModelIndex& parent) const
+{
+    const Node* node = d->nodeFor(parent);
+    if (column != 0 || row < 0 || row >= static_cast<int>(node->children.size())) return QModelIndex();
+    return createIndex(row, column, node->children[row].get());
+}
+
+QModelIndex TocModel::parent(const QModelIndex& child) const
+{
+    if (!child.isValid()) return QModelIndex();
+    const Node* parent = d->nodeFor(child)->parent;
+    if (!parent || parent == &d->root) return QModelIndex();
+    return createIndex(parent->row, 0, const_cast<Node*>(parent));
+}
+
+int TocModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.column() > 0) return 0;
+    return static_cast<int>(d->nodeFor(parent)->children.size());
+}
+
+int TocModel::columnCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return 1;
+}
+
+bool TocModel::hasChildren(const QModelIndex& parent) const
+{
+    const Node* node = d->nodeFor(parent);
+    // Unread levels show an expand arrow; expanding reads them
+    return node->fetched ? !node->children.empty() : node->entry.hasChildren;
+}
+
+bool TocModel::canFetchMore(const QModelIndex& parent) const
+{
+    const Node* node = d->nodeFor(parent);
+    return d->document && !node->fetched && node->entry.hasChildren;
+}
+
+void TocModel::fetchMore(const QModelIndex& parent)
+{
+    Node* node = d->nodeFor(parent);
+    if (!d->document || node->fetched) return;
+    node->fetched = true;
+
+    const QList<TocEntry> entries = d->document->tableOfContentsChildren(node->path());
+    if (entries.isEmpty()) {
+        node->entry.hasChildren = false;
+        if (parent.isValid()) emit dataChanged(parent, parent); // Drops the expand arrow
+        return;
+    }
+
+    beginInsertRows(parent, 0, entries.size() - 1);
+    node->children.reserve(entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        std::unique_ptr<Node> child(new Node);
+        child->entry = entries.at(i);
+        child->parent = node;
+        child->row = i;
+        node->children.push_back(std::move(child));
+    }
+    endInsertRows();
+}
+
+QVariant TocModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+    const TocEntry& entry = d->nodeFor(index)->entry;
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return entry.title.isEmpty() ? tr("Untitled") : entry.title;
+    case DestinationRole:
+        return entry.destination;
+    default:
+        return QVariant();
+    }
+}
+
+} // namespace QuantilyxDoc
@@ -0,0 +1,120 @@
+/**
+ * QuantilyxDoc - Professional Document Editor
+ * Copyright (C) 2025 R² Innovative Software
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef QUANTILYX_TOCMODEL_H
+#define QUANTILYX_TOCMODEL_H
+
+#include <QAbstractItemModel>
+#include <QVariant>
+#include <QVector>
+#include <memory>
+
+namespace QuantilyxDoc {
+
+class Document;
+
+/**
+ * @brief Table of contents model that reads the outline as it is expanded.
+ *
+ * Each level comes from Document::tableOfContentsChildren() the first
+ * time a view asks for it (canFetchMore()/fetchMore()), so opening a
+ * document with tens of thousands of outline entries reads only the top
+ * level. Searching by title uses an index built on the I/O pool from
+ * Document::visitTableOfContents(), started by the first search.
+ */
+class TocModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Extra data roles.
+     */
+    enum Role {
+        DestinationRole = Qt::UserRole // Where the entry points, as in Document::tableOfContents()
+    };
+
+    /**
+     * @brief One search result.
+     */
+    struct SearchHit {
+        QString title;
+        QString context;        // Titles of the entries above it, outermost first
+        QVariant destination;
+        QVector<int> path;      // For indexForPath()
+    };
+
+    /**
+     * @brief Constructor.
+     * @param parent Parent object.
+     */
+    explicit TocModel(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor. Waits for an index build in flight.
+     */
+    ~TocModel() override;
+
+    /**
+     * @brief Show a document's outline, read from the top level again.
+     * Also called when the outline changes.
+     * @param document The document, or nullptr to empty the model.
+     */
+    void setDocument(Document* document);
+
+    /**
+     * @brief Get the index of an entry, reading the levels above it if needed.
+     * @param path Child indexes from the top level down.
+     * @return Index, invalid if the path does not exist.
+     */
+    QModelIndex indexForPath(const QVector<int>& path);
+
+    /**
+     * @brief Start building the search index, unless built or building.
+     * indexReady() follows once search() can answer.
+     */
+    void startIndexing();
+
+    /**
+     * @brief Check if the search index is built.
+     * @return True once search() covers the whole outline.
+     */
+    bool isIndexReady() const;
+
+    /**
+     * @brief Find entries whose title contains some text, ignoring case.
+     * @param text Text to look for.
+     * @param limit Maximum number of hits.
+     * @return Hits in outline order; empty until the index is ready.
+     */
+    QList<SearchHit> search(const QString& text, int limit = 500) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+signals:
+    /**
+     * @brief Emitted when the search index has been built.
+     */
+    void indexReady();
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace QuantilyxDoc
+
+#endif // QUANTILYX_TOCMODEL_H